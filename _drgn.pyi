@@ -21,6 +21,7 @@ from typing import (
     Optional,
     Sequence,
     Tuple,
+    TypeVar,
     Union,
     overload,
 )
@@ -30,6 +31,8 @@ if sys.version_info < (3, 8):
 else:
     from typing import Protocol
 
+_T = TypeVar("_T")
+
 # This is effectively typing.SupportsIndex without @typing.runtime_checkable
 # (both of which are only available since Python 3.8), with a more
 # self-explanatory name.
@@ -59,6 +62,13 @@ class Program:
     The main functionality of a ``Program`` is looking up objects (i.e.,
     variables, constants, or functions). This is usually done with the
     :meth:`[] <.__getitem__>` operator.
+
+    Once a program has been set up, it may be used from multiple threads at
+    once: reading memory and looking up types, objects, and stack traces are
+    thread-safe and release the global interpreter lock, as do
+    :meth:`load_debug_info()` and :meth:`Object.read_()`. Other ways of setting
+    up the program (e.g., :meth:`set_core_dump()` or adding memory segments or
+    finders) must not be done concurrently with other uses of the program.
     """
 
     def __init__(self, platform: Optional[Platform] = None) -> None:
@@ -232,6 +242,31 @@ class Program:
             is positional-only.
         """
         ...
+    def symbolize(
+        self, addresses: Iterable[IntegerLike]
+    ) -> List[Tuple[Optional[str], int, Optional[str], int, int]]:
+        """
+        Get the symbol and source location of multiple addresses.
+
+        This is faster than looking up each address individually, especially
+        for large numbers of addresses from the same modules, such as program
+        counters from a trace buffer.
+
+        Addresses are used as is. Return addresses should have 1 subtracted so
+        that they resolve to the call instruction.
+
+        >>> prog.symbolize([0xffffffffabc59a90])
+        [('schedule', 0, 'kernel/sched/core.c', 6373, 1)]
+
+        :param addresses: Addresses to look up.
+        :return: List with a (*symbol_name*, *offset*, *filename*, *line*,
+            *column*) tuple for each address, in the same order as
+            *addresses*. *symbol_name* is ``None`` if no symbol contains the
+            address, in which case *offset* is 0. *filename* is ``None`` if the
+            source location is not known, in which case *line* and *column*
+            are 0. *column* may also be 0 if only the line is known.
+        """
+        ...
     def stack_trace(
         self,
         # Object is already IntegerLike, but this explicitly documents that it
@@ -254,14 +289,137 @@ class Program:
         task_struct *`` object, in which case this will unwind the stack for
         that task. See :func:`drgn.helpers.linux.pid.find_task()`.
 
-        This is implemented for the Linux kernel (both live and core dumps) as
-        well as userspace core dumps; it is not yet implemented for live
-        userspace processes.
+        This is implemented for the Linux kernel (both live and core dumps),
+        userspace core dumps, and live userspace processes. For a live process,
+        the thread is briefly stopped with :manpage:`ptrace(2)` to get its
+        registers and is resumed once its stack has been unwound, so this
+        requires permission to trace the process.
 
         :param thread: Thread ID, ``struct pt_regs`` object, or
             ``struct task_struct *`` object.
         """
         ...
+    def stack_trace_groups(
+        self, threads: Iterable[Thread], *, raw: bool = False
+    ) -> List[Tuple[StackTrace, List[int]]]:
+        """
+        Get the stack traces for multiple threads in the program, grouping
+        identical stack traces.
+
+        Stack traces are identical if they have the same program counters in
+        the same order. Threads are unwound like :meth:`stack_traces()`, and
+        only one stack trace is kept for each group, so this is much faster
+        than formatting every stack trace and comparing the strings.
+
+        >>> for trace, tids in sorted(
+        ...     prog.stack_trace_groups(prog.threads()),
+        ...     key=lambda group: len(group[1]),
+        ...     reverse=True,
+        ... ):
+        ...     print(f"{len(tids)} threads:")
+        ...     print(trace)
+
+        :param threads: Threads to unwind.
+        :param raw: Unwind raw stack traces. See :meth:`stack_traces()`.
+        :return: List of (*trace*, *tids*) tuples, one for each group of
+            identical stack traces, in the order that the groups first appear
+            in *threads*. *trace* is the stack trace of the first thread in the
+            group, and *tids* is a list of the thread IDs of every thread in
+            the group.
+        """
+        ...
+    def stack_traces(
+        self, threads: Iterable[Thread], *, raw: bool = False
+    ) -> List[StackTrace]:
+        """
+        Get the stack traces for multiple threads in the program.
+
+        This is equivalent to ``[thread.stack_trace() for thread in threads]``,
+        but the threads are unwound in parallel, and call frame information
+        looked up while unwinding one thread is reused for the others. This is
+        much faster when getting the stack traces of many threads.
+
+        >>> traces = prog.stack_traces(prog.threads())
+
+        If *raw* is ``True``, then only the registers of each frame are
+        recorded while unwinding, and the debugging information for a frame is
+        looked up when its name, source location, or variables are first
+        accessed. This is much cheaper if only the program counters are needed.
+        Raw stack traces don't expand inline frames; each frame is reported as
+        the innermost function containing its program counter.
+
+        >>> pcs = [
+        ...     tuple(frame.pc for frame in trace)
+        ...     for trace in prog.stack_traces(prog.threads(), raw=True)
+        ... ]
+
+        :param threads: Threads to unwind.
+        :param raw: Whether to unwind raw stack traces.
+        :return: List of stack traces in the same order as *threads*.
+        """
+        ...
+    def sample_stack_traces(
+        self, threads: Iterable[Thread], samples: int, interval: float = 0.01
+    ) -> str:
+        """
+        Repeatedly take the stack traces of multiple threads and count how
+        often each distinct stack trace was seen.
+
+        This takes *samples* snapshots of the raw stack traces (see
+        :meth:`stack_traces()`) of *threads*, waiting *interval* seconds
+        between the start of each snapshot. Threads that can't be unwound in a
+        snapshot, e.g., because they are running or have exited, are skipped
+        for that snapshot.
+
+        For the live Linux kernel, the memory cache and the address translation
+        cache are enabled while sampling, and only the stacks and
+        ``task_struct`` of *threads* are invalidated between snapshots, so
+        every other memory read and all debugging information are reused.
+
+        The result is in the folded format used by flame graph tools: one line
+        for each distinct stack trace, containing its function names from
+        outermost to innermost separated by semicolons, followed by a space and
+        the number of times that it was seen.
+
+        >>> threads = list(prog.threads())
+        >>> with open("out.folded", "w") as f:
+        ...     f.write(prog.sample_stack_traces(threads, 100))
+
+        :param threads: Threads to sample. On the Linux kernel, these should
+            not exit while sampling.
+        :param samples: Number of snapshots to take.
+        :param interval: Time between snapshots in seconds.
+        :return: Folded stack traces.
+        """
+        ...
+    def find_frame_objects(
+        self, traces: Iterable[StackTrace], function: str, names: Iterable[str]
+    ) -> List[Optional[Tuple[Optional[Object], ...]]]:
+        """
+        Find objects in the frame of a function in multiple stack traces.
+
+        For each trace, this finds the innermost frame in the function named
+        *function* and looks up each of *names* in it. The debugging
+        information for a name is only looked up once for each distinct
+        program counter, so this is much faster than indexing every frame
+        separately.
+
+        >>> traces = prog.stack_traces(prog.threads())
+        >>> for trace, row in zip(
+        ...     traces, prog.find_frame_objects(traces, "__mutex_lock", ["lock"])
+        ... ):
+        ...     if row is not None and row[0] is not None:
+        ...         print(row[0].owner)
+
+        :param traces: Stack traces to search.
+        :param function: Name of the function to find.
+        :param names: Names of the objects to find in the function's frame.
+        :return: List with one entry per trace, in the same order as *traces*.
+            The entry is ``None`` if no frame in the trace is in *function*.
+            Otherwise, it is a tuple of the objects named by *names*, with
+            ``None`` for names that weren't found in the frame.
+        """
+        ...
     @overload
     def type(self, name: str, filename: Optional[str] = None) -> Type:
         """
@@ -299,6 +457,48 @@ class Program:
         :return: The exact same type.
         """
         ...
+    def types(self, kinds: Optional[Iterable[TypeKind]] = None) -> Iterator[Type]:
+        """
+        Get all of the types of the given kinds in the program's debugging
+        information.
+
+        >>> for type in prog.types([TypeKind.STRUCT]):
+        ...     print(type.tag)
+        ...
+
+        This is much faster than looking up every type by name with
+        :meth:`type()`: all of the types are created up front, and searching
+        the debugging information is parallelized.
+
+        Only types in the global namespace are included. Each type is returned
+        once, in no particular order. Types with the same name that are defined
+        in different files are returned separately.
+
+        :param kinds: Kinds of types to get. Only :attr:`TypeKind.INT`,
+            :attr:`TypeKind.BOOL`, :attr:`TypeKind.FLOAT`,
+            :attr:`TypeKind.STRUCT`, :attr:`TypeKind.UNION`,
+            :attr:`TypeKind.CLASS`, :attr:`TypeKind.ENUM`, and
+            :attr:`TypeKind.TYPEDEF` are supported. Defaults to all of those.
+        :raises ValueError: if an unsupported kind is given
+        """
+        ...
+    def member_path(self, type: Union[str, Type], member: str) -> MemberPath:
+        """
+        Compile a member designator against a type so that the member can be
+        accessed in many objects quickly.
+
+        >>> util_avg = prog.member_path('struct task_struct', 'se.avg.util_avg')
+        >>> util_avg(task)
+        (unsigned long)0
+
+        :param type: Type containing the member.
+        :param member: Name of the member in *type*. May include one or more
+            member references and zero or more array subscripts.
+        :raises TypeError: if *type* is not a structure, union, or class type
+        :raises LookupError: if *type* does not have a member with the given
+            name
+        """
+        ...
     def threads(self) -> Iterator[Thread]:
         """Get an iterator over all of the threads in the program."""
         ...
@@ -355,6 +555,105 @@ class Program:
         :raises ValueError: if *size* is negative
         """
         ...
+    def read_view(
+        self, address: IntegerLike, size: IntegerLike, physical: bool = False
+    ) -> memoryview:
+        """
+        Like :meth:`read()`, but return a read-only :class:`memoryview`.
+
+        If the program is a core dump that is mapped into memory (see
+        ``DRGN_USE_MMAP_FOR_CORE_DUMP``) and the address range is contained in
+        one segment of it, then the view refers directly to the core dump
+        without copying it. Otherwise, the memory is read into a new buffer.
+        This is useful for passing large buffers to functions like
+        :func:`struct.unpack_from()`.
+
+        The view remains valid for as long as it is referenced, and it keeps
+        the program alive.
+
+        :param address: The starting address.
+        :param size: The number of bytes to read.
+        :param physical: Whether *address* is a physical memory address.
+        :raises FaultError: if the address range is invalid or the type of
+            address (physical or virtual) is not supported by the program
+        :raises ValueError: if *size* is negative
+        """
+        ...
+    def try_read(
+        self, address: IntegerLike, size: IntegerLike, physical: bool = False
+    ) -> Optional[bytes]:
+        """
+        Read memory like :meth:`read()`, but return ``None`` instead of raising
+        :class:`FaultError` if the address range is invalid.
+
+        This is much cheaper than catching :class:`FaultError` when faults are
+        expected, e.g., when checking whether a possibly freed pointer can be
+        dereferenced, since no exception is created.
+
+        :param address: The starting address.
+        :param size: The number of bytes to read.
+        :param physical: Whether *address* is a physical memory address; see
+            :meth:`read()`.
+        :return: The bytes read, or ``None`` if the read faulted.
+        :raises ValueError: if *size* is negative
+        """
+        ...
+    def read_batch(
+        self,
+        requests: Iterable[Tuple[IntegerLike, IntegerLike]],
+        physical: bool = False,
+    ) -> List[Union[bytes, FaultError]]:
+        """
+        Read multiple ranges of memory in the program.
+
+        This is equivalent to calling :meth:`read()` for each request, except
+        that requests for nearby addresses are combined into fewer reads, and a
+        fault for one request doesn't prevent the others from being read.
+
+        :param requests: Iterable of (*address*, *size*) pairs.
+        :param physical: Whether the addresses are physical memory addresses;
+            see :meth:`read()`.
+        :return: List with the bytes read for each request, or a
+            :class:`FaultError` if the request's address range is invalid.
+        :raises ValueError: if a size is negative
+        """
+        ...
+    def read_members(
+        self,
+        type: Union[str, Type],
+        members: Sequence[Union[str, MemberPath]],
+        addresses: Union[range, Sequence[IntegerLike]],
+    ) -> Tuple[memoryview, ...]:
+        """
+        Read scalar members of many objects of the same type into arrays.
+
+        This is much faster than creating an :class:`Object` for each member of
+        each object and converting it with :meth:`Object.value_()`. Each object
+        is only read once for all of the members.
+
+        >>> flags, refcount = prog.read_members(
+        ...     "struct page",
+        ...     ["flags", "_refcount.counter"],
+        ...     range(vmemmap.value_(), vmemmap.value_() + 1024 * 64, 64),
+        ... )
+        >>> numpy.count_nonzero(numpy.asarray(refcount))
+        1017
+
+        :param type: Type of the objects.
+        :param members: Members to read. Strings are compiled against *type*
+            like :meth:`member_path()`.
+        :param addresses: Addresses of the objects. A :class:`range` (e.g., for
+            an array of objects) is not expanded into a list first.
+        :return: One array per member, in the same order as *members*. An array
+            is a :class:`memoryview` of 64-bit signed integers (format ``q``)
+            for signed integer members, 64-bit unsigned integers (format
+            ``Q``) for unsigned integer, boolean, and pointer members, or
+            doubles (format ``d``) for floating-point members.
+        :raises TypeError: if a member doesn't have an integer, boolean,
+            pointer, or floating-point type
+        :raises FaultError: if an object can't be read
+        """
+        ...
     def read_u8(self, address: IntegerLike, physical: bool = False) -> int:
         """ """
         ...
@@ -387,6 +686,300 @@ class Program:
         :raises FaultError: if the address is invalid; see :meth:`read()`
         """
         ...
+    def read_word_or(
+        self, address: IntegerLike, default: _T, physical: bool = False
+    ) -> Union[int, _T]:
+        """
+        Read a program word-sized unsigned integer like :meth:`read_word()`,
+        but return *default* instead of raising :class:`FaultError` if the
+        address is invalid. See :meth:`try_read()`.
+
+        >>> print(prog.read_word_or(0, None))
+        None
+
+        :param address: Address of the integer.
+        :param default: Value to return if the read faults.
+        :param physical: Whether *address* is a physical memory address; see
+            :meth:`read()`.
+        """
+        ...
+    def search_memory(
+        self,
+        value: Union[IntegerLike, bytes],
+        min_address: IntegerLike = 0,
+        max_address: Optional[IntegerLike] = None,
+        *,
+        max_value: Optional[IntegerLike] = None,
+        size: Optional[IntegerLike] = None,
+        alignment: Optional[IntegerLike] = None,
+        physical: bool = False,
+        page_flags_mask: IntegerLike = 0,
+        page_flags_value: Optional[IntegerLike] = None,
+    ) -> List[int]:
+        """
+        Search the program's memory for a word value, a range of word values,
+        or a byte pattern.
+
+        This is much faster than searching the results of :meth:`read()` in
+        Python: memory is read in large chunks and searched in parallel by
+        :attr:`num_threads` threads. Only memory in the program's memory
+        segments is searched, and memory that can't be read is skipped.
+
+        >>> prog.search_memory(task.value_(), physical=True)
+        [4301258824, 4526917248]
+
+        The virtual address space of the Linux kernel is a single segment
+        translated through the page tables, so a virtual search of the kernel
+        should be limited to a range that is known to be mapped. Physical
+        searches are usually preferable.
+
+        :param value: Word to search for, or bytes to search for.
+        :param min_address: Start address of the memory to search (inclusive).
+        :param max_address: End address of the memory to search (inclusive).
+            Defaults to the end of the address space.
+        :param max_value: If given, search for words in the range [*value*,
+            *max_value*] instead of words equal to *value*.
+        :param size: Size of the words to search for in bytes: 1, 2, 4, or 8.
+            Defaults to the program's word size.
+        :param alignment: Required alignment of matching addresses. Defaults
+            to *size* for words and 1 for bytes.
+        :param physical: Whether the addresses are physical memory addresses;
+            see :meth:`read()`.
+        :param page_flags_mask: If non-zero, only search pages of the Linux
+            kernel where ``page->flags & page_flags_mask ==
+            page_flags_value``. This requires *physical*.
+        :param page_flags_value: See *page_flags_mask*. Defaults to
+            *page_flags_mask*.
+        :return: Sorted list of the addresses of the matches.
+        """
+        ...
+    memory_cache_size: int
+    """
+    Maximum number of bytes of memory to cache for each of the virtual and
+    physical address spaces of the program.
+
+    Memory is read and cached in 4 KiB blocks. Caching is enabled by default
+    for core dumps, whose memory can't change, and when a segment is added
+    with :meth:`add_memory_block_segment()`. It is disabled by default for
+    live programs and for memory segments added with
+    :meth:`add_memory_segment()`.
+
+    This can be set to enable caching for a live program (in which case
+    :meth:`invalidate_memory_cache()` should be called whenever the program's
+    memory may have changed) or to change the limit. Setting it to 0 disables
+    caching.
+
+    Consecutive uncached blocks needed by one read are read from the core dump
+    at once, which is much faster for compressed kdumps.
+    """
+    def memory_cache_stats(self) -> Tuple[int, int]:
+        """
+        Get statistics about the memory cache.
+
+        For a compressed kdump, the number of misses is the number of pages that
+        were decompressed.
+
+        :return: Tuple of the number of blocks that were read from the cache and
+            the number of blocks that were read into the cache.
+        """
+        ...
+    def invalidate_memory_cache(self) -> None:
+        """
+        Discard all cached memory.
+
+        This also discards cached address translations; see
+        :meth:`invalidate_translation_cache()`.
+
+        See :attr:`memory_cache_size`.
+        """
+        ...
+    def prefetch(
+        self, address: IntegerLike, size: IntegerLike, physical: bool = False
+    ) -> None:
+        """
+        Start reading memory into the memory cache in a background thread.
+
+        This is a hint that the memory will be read soon, for example, the next
+        node of a linked list while the current one is being processed. It lets
+        reads from slow storage, like a vmcore on a network filesystem, overlap
+        with other work.
+
+        This does nothing if the memory cache is disabled (see
+        :attr:`memory_cache_size`). Only memory read from a core dump file is
+        prefetched.
+
+        :param address: Starting address.
+        :param size: Number of bytes to prefetch.
+        :param physical: Whether *address* is a physical memory address.
+        """
+        ...
+    translation_cache_enabled: bool
+    """
+    Whether to cache virtual address translations done by walking the page
+    table.
+
+    The Linux kernel uses page table walks to read memory that isn't in the
+    core dump and to read the memory of user processes (e.g., with
+    :func:`~drgn.helpers.linux.mm.access_process_vm()`). Translations of pages,
+    including huge pages, are cached for each page table. Caching is enabled by
+    default for core dumps and disabled by default for live programs.
+
+    If this is enabled for a live program, :meth:`invalidate_translation_cache()`
+    should be called whenever the program's page tables may have changed.
+    """
+    def invalidate_translation_cache(self) -> None:
+        """
+        Discard all cached address translations.
+
+        See :attr:`translation_cache_enabled`.
+        """
+        ...
+    def translation_cache_stats(self) -> Tuple[int, int]:
+        """
+        Get statistics about the address translation cache.
+
+        :return: Tuple of the number of translations that were found in the
+            cache and the number of translations that required a page table
+            walk.
+        """
+        ...
+    def stats(self) -> Dict[str, int]:
+        """
+        Get counters and cumulative timings of the work done by this program.
+
+        The counters accumulate from when the program was created or from the
+        last call to :meth:`reset_stats()`. Keys ending in ``_ns`` are
+        wall-clock times in nanoseconds. The keys are:
+
+        * ``memory_reads``, ``memory_read_bytes``: reads of the program's
+          memory.
+        * ``{kind}_segment_reads``, ``{kind}_segment_read_bytes``: reads from
+          each kind of memory segment. *kind* is ``file`` (the core dump,
+          ``/proc/kcore``, or ``/proc/$pid/mem``), ``page_table`` (kernel
+          memory read by walking the page table), ``kdump``, or ``custom``
+          (segments added with :meth:`add_memory_segment()` or
+          :meth:`add_memory_block_segment()`). Reads served
+          from the memory cache don't read from any segment.
+        * ``memory_cache_hits``, ``memory_cache_misses``: see
+          :meth:`memory_cache_stats()`.
+        * ``page_table_walks``, ``page_table_walk_ns``: address translations
+          done by walking page tables.
+        * ``linear_translations``: address translations in linearly mapped
+          kernel regions, like the direct mapping, that didn't need to walk
+          page tables.
+        * ``translation_cache_hits``, ``translation_cache_misses``: see
+          :meth:`translation_cache_stats()`.
+        * ``read_modules_ns``, ``dwarf_index_first_pass_ns``,
+          ``dwarf_index_second_pass_ns``, ``dwarf_index_debug_names_ns``: phases
+          of loading and indexing debugging information.
+        * ``dwarf_types``, ``dwarf_type_cache_hits``, ``dwarf_type_ns``: types
+          created from DWARF and lookups that found an already created type.
+        * ``cfi_cache_hits``, ``dwarf_cfi_lookups``, ``orc_lookups``,
+          ``cfi_lookup_ns``: call frame information lookups for stack traces.
+          ``cfi_lookup_ns`` only includes lookups that weren't cached.
+
+        More keys may be added in the future.
+        """
+        ...
+    def reset_stats(self) -> None:
+        """
+        Reset the counters returned by :meth:`stats()`, including those
+        returned by :meth:`memory_cache_stats()` and
+        :meth:`translation_cache_stats()`, to zero.
+        """
+        ...
+    def start_memory_trace(self) -> None:
+        """
+        Start recording the pages of memory read from this program.
+
+        Every read is recorded, including reads done internally by drgn, so
+        that the recorded pages can be saved with
+        :meth:`write_memory_trace_core()` and a script can later be replayed
+        against them without access to the original program. Any previously
+        recorded trace is discarded.
+        """
+        ...
+    def stop_memory_trace(self) -> Optional[int]:
+        """
+        Stop recording the pages of memory read from this program.
+
+        The recorded pages are kept for :meth:`write_memory_trace_core()`.
+
+        :return: Number of pages recorded, or ``None`` if no trace was started.
+        """
+        ...
+    def add_memory_trace_objects(
+        self,
+        objs: Iterable[Object],
+        follow: Optional[Iterable[str]] = None,
+        depth: IntegerLike = 0,
+    ) -> None:
+        """
+        Record the memory of the given objects and of the objects reachable
+        from them, so that it is saved by :meth:`write_memory_trace_core()`.
+
+        This can be used to extract a small core dump containing only the
+        data structures of interest from a large one. If no trace was started
+        with :meth:`start_memory_trace()`, an empty one is created first, but
+        reads are not recorded automatically.
+
+        >>> prog.add_memory_trace_objects(
+        ...     [prog["init_task"]], follow=["parent", "mm"], depth=2
+        ... )
+        >>> prog.write_memory_trace_core("init_task.core")
+
+        For each object, if it is a reference, its memory is recorded, and if
+        it is a pointer, the memory that it points to is recorded. Then, the
+        objects pointed to by the pointer members of recorded structures,
+        unions, and classes (including members of nested structures, unions,
+        and classes, but not of arrays) are recorded, and so on, up to *depth*
+        pointers away. Null pointers and pointers that can't be read are
+        skipped.
+
+        :param objs: Objects to record. They must be references or pointers.
+        :param follow: Names of the pointer members to follow. If ``None``,
+            all pointer members are followed.
+        :param depth: Maximum number of pointers to follow from each object.
+        """
+        ...
+    def write_memory_trace_core(self, path: Path) -> None:
+        """
+        Write the pages recorded by :meth:`start_memory_trace()` and
+        :meth:`add_memory_trace_objects()` to an ELF core dump.
+
+        The pages are read from this program again, so this should be called
+        before the program's memory changes. Pages that can't be read are
+        omitted. The core dump also contains the ELF notes of this program's
+        core dump, if any, or a ``VMCOREINFO`` note if this is the Linux kernel.
+        It can be opened with :meth:`set_core_dump()`.
+
+        :param path: Path of the file to create or overwrite.
+        :raises ValueError: if nothing was recorded with
+            :meth:`start_memory_trace()` or :meth:`add_memory_trace_objects()`
+        """
+        ...
+    num_threads: int
+    """
+    Number of threads used for parallel work in this program, like indexing
+    debugging information and getting many stack traces.
+
+    0 (the default) means the number of CPUs in :attr:`thread_cpus` if it is
+    set, otherwise the OpenMP default (which can be set for the whole process
+    with the ``OMP_NUM_THREADS`` environment variable). This should not be
+    changed while debugging information is being loaded.
+    """
+    thread_cpus: Optional[Tuple[int, ...]]
+    """
+    Sorted CPU numbers that worker threads doing parallel work in this program
+    are restricted to, or ``None`` if they are not restricted (the default).
+
+    This can be set to any iterable of CPU numbers. Worker threads are bound to
+    the CPUs when they start working for this program, but the calling thread,
+    which also does some of the work, is never moved. Binding is best-effort,
+    so CPUs that are offline or not allowed for the process are not reported as
+    errors. This should not be changed while debugging information is being
+    loaded.
+    """
     def add_memory_segment(
         self,
         address: IntegerLike,
@@ -412,8 +1005,51 @@ class Program:
             another :ref:`buffer <python:binaryseq>` type.
         """
         ...
+    def add_memory_block_segment(
+        self,
+        address: IntegerLike,
+        size: IntegerLike,
+        read_fn: Callable[[List[Tuple[int, int, memoryview]], bool], None],
+        physical: bool = False,
+    ) -> None:
+        """
+        Define a region of memory in the program which is read in whole
+        blocks.
+
+        This is like :meth:`add_memory_segment()`, but it is meant for memory
+        that is expensive to read, like memory fetched over a network. Memory
+        is only requested in page-aligned blocks of 4096 bytes. All of the
+        blocks needed by one read of the program's memory that aren't already
+        cached are requested in one call, with consecutive blocks coalesced
+        into one range. Blocks are kept in the memory cache so that each one
+        is only fetched once until it is evicted or the cache is invalidated.
+        If :attr:`memory_cache_size` is zero, it is set to a default size.
+
+        >>> def read_blocks(ranges, physical):
+        ...     for address, offset, buf in ranges:
+        ...         buf[:] = remote.read(address, len(buf))
+        ...
+        >>> prog.add_memory_block_segment(0xffff0000, 0x10000, read_blocks)
+
+        :param address: Address of the segment. Must be a multiple of 4096.
+        :param size: Size of the segment in bytes. Must be a multiple of 4096.
+        :param read_fn: Callable to call to read memory from the segment. It is
+            passed a list of ranges to read and whether the addresses are
+            physical: ``(ranges, physical)``. Each range is a tuple of the
+            address, the offset in bytes from the beginning of the segment,
+            and a writable :class:`memoryview` to fill with the contents of
+            memory: ``(address, offset, buf)``. The ranges are sorted by
+            address. The views are released when the callable returns, so
+            they must not be used after that.
+        :param physical: Whether to add a physical memory segment. If
+            ``False``, then this adds a virtual memory segment.
+        """
+        ...
     def add_type_finder(
-        self, fn: Callable[[TypeKind, str, Optional[str]], Type]
+        self,
+        fn: Callable[[TypeKind, str, Optional[str]], Type],
+        *,
+        cache: bool = False,
     ) -> None:
         """
         Register a callback for finding types in the program.
@@ -422,13 +1058,26 @@ class Program:
         until the type is found. So, more recently added callbacks take
         precedence.
 
+        The results of :meth:`type()` are cached until another callback is
+        added or more debugging information is loaded. Lookups that call a
+        callback registered without *cache* aren't cached, so such a callback
+        may find a type on a later call that it didn't find before.
+
         :param fn: Callable taking a :class:`TypeKind`, name, and filename:
             ``(kind, name, filename)``. The filename should be matched with
             :func:`filename_matches()`. This should return a :class:`Type`.
+        :param cache: Whether the results of *fn* can be cached. If ``True``,
+            *fn* is only called once for each combination of kind, name, and
+            filename, including lookups for which it returns ``None``, which
+            saves calling back into Python for repeated lookups. The results
+            are kept for the lifetime of the program.
         """
         ...
     def add_object_finder(
-        self, fn: Callable[[Program, str, FindObjectFlags, Optional[str]], Object]
+        self,
+        fn: Callable[[Program, str, FindObjectFlags, Optional[str]], Object],
+        *,
+        cache: bool = False,
     ) -> None:
         """
         Register a callback for finding objects in the program.
@@ -437,10 +1086,20 @@ class Program:
         until the object is found. So, more recently added callbacks take
         precedence.
 
+        If no callback finds an object and every callback was registered with
+        *cache*, apart from drgn's own debugging information lookup, that
+        result is cached until another callback is added or more debugging
+        information is loaded. Otherwise, every callback is called again on
+        the next lookup.
+
         :param fn: Callable taking a program, name, :class:`FindObjectFlags`,
             and filename: ``(prog, name, flags, filename)``. The filename
             should be matched with :func:`filename_matches()`. This should
             return an :class:`Object`.
+        :param cache: Whether the results of *fn* can be cached. If ``True``,
+            *fn* is only called once for each combination of name, flags, and
+            filename, including lookups for which it returns ``None``. The
+            results are kept for the lifetime of the program.
         """
         ...
     def set_core_dump(self, path: Path) -> None:
@@ -451,6 +1110,12 @@ class Program:
         mapped executable and libraries. It does not load any debugging
         symbols; see :meth:`load_default_debug_info()`.
 
+        Linux kernel vmcores in ELF format may be compressed in the `zstd
+        seekable format
+        <https://github.com/facebook/zstd/blob/dev/contrib/seekable_format/zstd_seekable_compression_format.md>`_
+        if drgn was built with libzstd. Only the parts of the file that are
+        read are decompressed.
+
         :param path: Core dump file path.
         """
         ...
@@ -515,6 +1180,47 @@ class Program:
         This is equivalent to ``load_debug_info(None, True)``.
         """
         ...
+    def unload_debug_info(self, name: str) -> None:
+        """
+        Unload the debugging information for a module to reclaim the memory
+        used to index it.
+
+        Types and objects defined by the module can no longer be looked up,
+        but any :class:`Type`, :class:`Object`, :class:`Symbol`, or
+        :class:`StackTrace` that was already created from it stays valid, so
+        the module's file stays open. Loading the module again (e.g., with
+        :meth:`load_debug_info()`) indexes it again.
+
+        Only named modules can be unloaded: the Linux kernel (``"kernel"``)
+        and its loadable modules (e.g., ``"ext4"``).
+
+        :param name: Module name.
+        :raises LookupError: if no module with the given name is loaded
+        """
+        ...
+    def set_debug_file_fetcher(
+        self, fn: Optional[Callable[[bytes], Optional[Path]]]
+    ) -> None:
+        """
+        Set a callback for fetching debugging information files that can't be
+        found locally, e.g., from a remote server.
+
+        When :meth:`load_debug_info()` finds no debugging information for a
+        file with a build ID, it calls this with the build ID. The callback is
+        called from several threads at once for different build IDs so that
+        downloads overlap with each other and with indexing the files that
+        were already found, so it must be thread-safe and must not use this
+        program.
+
+        If the ``DRGN_DEBUG_FILE_CACHE_DIR`` environment variable is set,
+        fetched files are saved in that directory, and files found there are
+        used without calling the callback.
+
+        :param fn: Callable taking the build ID and returning the path of the
+            debugging information file, or ``None`` if it can't be found.
+            ``None`` to not fetch missing files.
+        """
+        ...
     cache: Dict[Any, Any]
     """
     Dictionary for caching program metadata.
@@ -1306,9 +2012,48 @@ class Object:
             ``void``)
         """
         ...
+    def snapshot_(self) -> Object:
+        """
+        Get a copy of this reference object whose value is read all at once
+        the first time it is needed.
+
+        The first time that a member or element of the returned object is
+        accessed, or that its value is converted (e.g., with :meth:`value_()`,
+        :meth:`read_()`, or :class:`int()`), the entire object is read and
+        saved. Members and elements of the returned object (and their members
+        and elements, etc.) are still reference objects with the same address
+        as usual, but converting their values uses the saved copy instead of
+        reading memory again. This avoids reading memory once per member
+        without having to choose between a reference and :meth:`read_()`.
+
+        >>> task = prog['init_task'].snapshot_()
+        >>> task.pid.value_(), task.tgid.value_(), int(task.se.avg.util_avg)
+        (0, 0, 1)
+
+        Because the values are only read once, they don't reflect later changes
+        in a running program. Call ``snapshot_()`` again to get a new snapshot.
+        Objects reached through a pointer are only part of the snapshot if they
+        are inside of this object.
+
+        If this object is not a reference to a structure, union, class, or
+        array, then this returns the object unchanged.
+        """
+        ...
     def to_bytes_(self) -> bytes:
         """Return the binary representation of this object's value."""
         ...
+    def to_bytes_view_(self) -> memoryview:
+        """
+        Return the binary representation of this object's value as a read-only
+        :class:`memoryview`.
+
+        This is like :meth:`to_bytes_()`, but it avoids copying when possible:
+        for a value object, the view refers to the object's own buffer, and for
+        a reference object, it refers directly to the memory of the program
+        when that is possible (see :meth:`Program.read_view()`). The view keeps
+        the object or program alive.
+        """
+        ...
     @classmethod
     def from_bytes_(
         cls,
@@ -1335,6 +2080,8 @@ class Object:
         self,
         *,
         columns: Optional[IntegerLike] = None,
+        max_elements: Optional[IntegerLike] = None,
+        max_size: Optional[IntegerLike] = None,
         dereference: Optional[bool] = None,
         symbolize: Optional[bool] = None,
         string: Optional[bool] = None,
@@ -1371,6 +2118,12 @@ class Object:
 
         :param columns: Number of columns to limit output to when the
             expression can be reasonably wrapped. Defaults to no limit.
+        :param max_elements: Maximum number of elements of each array to
+            format. The remaining elements are replaced by ``...``. Defaults to
+            no limit.
+        :param max_size: Approximate maximum number of characters to output.
+            Once this is reached, the remaining members and elements are
+            replaced by ``...``. Defaults to no limit.
         :param dereference: If this object is a pointer, include the
             dereferenced value. This does not apply to structure, union, or
             class members, or array elements, as dereferencing those could lead
@@ -1508,6 +2261,45 @@ def container_of(ptr: Object, type: Union[str, Type], member: str) -> Object:
     """
     ...
 
+class MemberPath:
+    """
+    A ``MemberPath`` is a member designator compiled against a type with
+    :meth:`Program.member_path()`.
+
+    Accessing a member with :meth:`Object.member_()` or an attribute looks up
+    the member by name every time. A ``MemberPath`` does the lookup once, so it
+    is faster for getting the same member of many objects.
+    """
+
+    def __call__(self, obj: Object) -> Object:
+        """
+        Get the member of an object.
+
+        This is equivalent to ``obj.a.b.c`` if *obj* has the type of the path,
+        or ``obj.a.b.c`` on a pointer (i.e., ``obj->a.b.c`` in C) if *obj* is a
+        pointer to the type of the path. A structure, union, or class type with
+        the same name and size as the type of the path is also accepted, like
+        the same type defined in different compilation units.
+
+        :param obj: Object or pointer to object containing the member.
+        :raises TypeError: if *obj* doesn't have the type of the path or a
+            pointer to it
+        """
+        ...
+    type: Type
+    """Type containing the member."""
+
+    member_type: Type
+    """Type of the member."""
+
+    bit_offset: int
+    """Offset of the member from the beginning of :attr:`type` in bits."""
+
+    bit_field_size: Optional[int]
+    """
+    Size in bits of the member if it is a bit field, ``None`` if it is not.
+    """
+
 class Symbol:
     """
     A ``Symbol`` represents an entry in the symbol table of a program, i.e., an
@@ -1835,6 +2627,12 @@ class Type:
     """
     List of members of this type, or ``None`` if this is an incomplete type.
     This is present for structure, union, and class types.
+
+    For types created from debugging information, this is a :class:`tuple`
+    whose :class:`TypeMember` items only convert their name and offset to
+    Python objects when they are first accessed. In addition to integers and
+    slices, it may be indexed by the name of a direct member (not a member of
+    an anonymous structure or union).
     """
 
     enumerators: Optional[Sequence[TypeEnumerator]]
@@ -1846,6 +2644,8 @@ class Type:
     parameters: Sequence[TypeParameter]
     """
     List of parameters of this type. This is only present for function types.
+
+    Like :attr:`members`, this may also be indexed by parameter name.
     """
 
     is_variadic: bool
@@ -2283,10 +3083,72 @@ class OutOfBoundsError(Exception):
 
 _elfutils_version: str
 _with_libkdumpfile: bool
+_with_libzstd: bool
+
+def _decode_enum_type_flags(value: int, type: Type, bit_numbers: bool = True) -> str:
+    """
+    Decode a bitmask of flags defined by an enumerated type. *value* must be
+    non-negative and fit in 64 bits. The flags of the type are compiled into a
+    table the first time it is decoded. See
+    :func:`drgn.helpers.decode_enum_type_flags()`.
+    """
+    ...
 
 def _linux_helper_read_vm(
     prog: Program, pgtable: Object, address: IntegerLike, size: IntegerLike
 ) -> bytes: ...
+def _linux_helper_pgtable_mappings(
+    prog: Program,
+    pgtable: IntegerLike,
+    start: IntegerLike = 0,
+    end: Optional[IntegerLike] = None,
+) -> bytes: ...
+def _linux_helper_reverse_map(
+    prog: Program, pgtables: bytes, ends: bytes, phys_addrs: bytes
+) -> bytes: ...
+def _linux_helper_find_page_pfns(
+    prog: Program,
+    flags_mask: IntegerLike = 0,
+    flags_value: Optional[IntegerLike] = None,
+    *,
+    mapping: Optional[IntegerLike] = None,
+    min_refcount: Optional[IntegerLike] = None,
+) -> bytes: ...
+class _LinuxHelperHeapGraph:
+    num_referrers: int
+    def __len__(self) -> int: ...
+    def find(self, address: IntegerLike) -> Optional[Tuple[int, int]]: ...
+    def referrers(self, address: IntegerLike) -> List[int]: ...
+
+def _linux_helper_heap_graph(
+    prog: Program, scan_pages: bool = False
+) -> _LinuxHelperHeapGraph: ...
+class _LinuxHelperPipeline:
+    def run(self, root: Object) -> List[Tuple[Any, ...]]: ...
+
+def _linux_helper_pipeline(
+    prog: Program,
+    type: Union[str, Type],
+    source: str,
+    member: Optional[str],
+    filters: Sequence[Tuple[Union[str, MemberPath], str, Union[IntegerLike, float]]],
+    projections: Sequence[Union[str, MemberPath]],
+) -> _LinuxHelperPipeline: ...
+def _linux_helper_printk_records(
+    prog: Program, min_seq: IntegerLike = 0
+) -> List[
+    Tuple[
+        bytes,
+        int,
+        int,
+        int,
+        int,
+        Optional[int],
+        Optional[int],
+        bool,
+        Dict[bytes, bytes],
+    ]
+]: ...
 def _linux_helper_radix_tree_lookup(root: Object, index: IntegerLike) -> Object:
     """
     Look up the entry at a given index in a radix tree.
@@ -2297,6 +3159,69 @@ def _linux_helper_radix_tree_lookup(root: Object, index: IntegerLike) -> Object:
     """
     ...
 
+def _linux_helper_radix_tree_for_each(
+    root: Object, *, skip_values: bool = False
+) -> Iterator[Tuple[int, Object]]:
+    """
+    Iterate over all of the entries in a radix tree.
+
+    Each node of the tree is read once, so this is efficient even for large
+    trees like the page cache of a big file.
+
+    :param root: ``struct radix_tree_root *``
+    :param skip_values: Whether to skip value entries (called exceptional
+        entries before Linux 4.20), like the shadow entries of evicted pages
+        in the page cache.
+    :return: Iterator of (index, ``void *``) tuples in order of increasing
+        index.
+    """
+    ...
+
+def _linux_helper_idr_for_each(idr: Object) -> Iterator[Tuple[int, Object]]:
+    """
+    Iterate over all of the entries in an IDR.
+
+    :param idr: ``struct idr *``
+    :return: Iterator of (index, ``void *``) tuples.
+    """
+    ...
+
+def _linux_helper_for_each_set_bit(
+    bitmap: Object, size: IntegerLike
+) -> Iterator[int]:
+    """
+    Iterate over all set (one) bits in a bitmap.
+
+    The bitmap is read all at once, and each word is searched with a single
+    instruction, so this is efficient even for large bitmaps.
+
+    :param bitmap: ``unsigned long *``
+    :param size: Size of *bitmap* in bits.
+    """
+    ...
+
+def _linux_helper_for_each_clear_bit(
+    bitmap: Object, size: IntegerLike
+) -> Iterator[int]:
+    """
+    Iterate over all clear (zero) bits in a bitmap.
+
+    Like :func:`for_each_set_bit()`, the bitmap is read all at once.
+
+    :param bitmap: ``unsigned long *``
+    :param size: Size of *bitmap* in bits.
+    """
+    ...
+
+def _linux_helper_bitmap_weight(bitmap: Object, size: IntegerLike) -> int:
+    """
+    Return the number of set (one) bits in a bitmap.
+
+    :param bitmap: ``unsigned long *``
+    :param size: Size of *bitmap* in bits.
+    """
+    ...
+
 def _linux_helper_per_cpu_ptr(ptr: Object, cpu: IntegerLike) -> Object:
     """
     Return the per-CPU pointer for a given CPU.
@@ -2313,6 +3238,128 @@ def _linux_helper_per_cpu_ptr(ptr: Object, cpu: IntegerLike) -> Object:
     """
     ...
 
+def _linux_helper_per_cpu_values(
+    ptr: Object, member: Optional[str] = None, mask: Optional[Object] = None
+) -> Dict[int, int]:
+    """
+    Return the value of a per-CPU integer or pointer for every CPU in a mask.
+
+    This is much faster than calling :func:`per_cpu_ptr()` for each CPU.
+
+    >>> per_cpu_values(prog["vm_event_states"], "event[0]")
+    {0: 1981854, 1: 1763595, 2: 1697366, 3: 1726474}
+
+    :param ptr: Per-CPU pointer (``type __percpu *``) or variable (``type
+        __percpu``).
+    :param member: Member of ``type`` to read (e.g., ``"count"`` or
+        ``"stats[3]"``), or ``None`` to read ``type`` itself.
+    :param mask: ``struct cpumask`` or ``struct cpumask *`` of CPUs to read.
+        Defaults to the online CPUs.
+    :return: Dictionary from CPU number to value.
+    """
+    ...
+
+def _linux_helper_per_cpu_sum(
+    ptr: Object, member: Optional[str] = None, mask: Optional[Object] = None
+) -> int:
+    """
+    Return the sum of a per-CPU integer over every CPU in a mask.
+
+    This takes the same arguments as :func:`per_cpu_values()`.
+    """
+    ...
+
+def _linux_helper_list_for_each_entry(
+    type: Union[str, Type], head: Object, member: str
+) -> Iterator[Object]:
+    """
+    Iterate over all of the entries in a list.
+
+    :param type: Entry type.
+    :param head: ``struct list_head *``
+    :param member: Name of list node member in entry type.
+    :return: Iterator of ``type *`` objects.
+    """
+    ...
+
+def _linux_helper_list_for_each_entry_reverse(
+    type: Union[str, Type], head: Object, member: str
+) -> Iterator[Object]:
+    """
+    Iterate over all of the entries in a list in reverse order.
+
+    :param type: Entry type.
+    :param head: ``struct list_head *``
+    :param member: Name of list node member in entry type.
+    :return: Iterator of ``type *`` objects.
+    """
+    ...
+
+def _linux_helper_hlist_for_each_entry(
+    type: Union[str, Type], head: Object, member: str
+) -> Iterator[Object]:
+    """
+    Iterate over all of the entries in a hash list.
+
+    :param type: Entry type.
+    :param head: ``struct hlist_head *``
+    :param member: Name of list node member in entry type.
+    :return: Iterator of ``type *`` objects.
+    """
+    ...
+
+def _linux_helper_hlist_nulls_for_each_entry(
+    type: Union[str, Type], head: Object, member: str
+) -> Iterator[Object]:
+    """
+    Iterate over all the entries in a nulls hash list.
+
+    :param type: Entry type.
+    :param head: ``struct hlist_nulls_head *``
+    :param member: Name of list node member in entry type.
+    :return: Iterator of ``type *`` objects.
+    """
+    ...
+
+def _linux_helper_rbtree_inorder_for_each(root: Object) -> Iterator[Object]:
+    """
+    Iterate over all of the nodes in a red-black tree, in sort order.
+
+    :param root: ``struct rb_root *``
+    :return: Iterator of ``struct rb_node *`` objects.
+    """
+    ...
+
+def _linux_helper_rbtree_inorder_for_each_entry(
+    type: Union[str, Type], root: Object, member: str
+) -> Iterator[Object]:
+    """
+    Iterate over all of the entries in a red-black tree in sorted order.
+
+    :param type: Entry type.
+    :param root: ``struct rb_root *``
+    :param member: Name of ``struct rb_node`` member in entry type.
+    :return: Iterator of ``type *`` objects.
+    """
+    ...
+
+def _linux_helper_slab_cache_for_each_allocated_object(
+    slab_cache: Object, type: Union[str, Type]
+) -> Iterator[Object]:
+    """
+    Iterate over all allocated objects in a given slab cache.
+
+    The page array is scanned in bulk, and the freelist of each slab is decoded
+    into a bitmap, so this is much faster than walking the slab cache with
+    other helpers. Slabs are decoded in parallel by :attr:`Program.num_threads`
+    threads.
+
+    :param slab_cache: ``struct kmem_cache *``
+    :param type: Type of object in the slab cache.
+    :return: Iterator of ``type *`` objects.
+    """
+    ...
+
 def _linux_helper_idle_task(prog: Program, cpu: IntegerLike) -> Object:
     """
     Return the idle thread (PID 0, a.k.a swapper) for the given CPU.
@@ -2364,12 +3411,146 @@ def _linux_helper_find_task(
     """
     Return the task with the given PID.
 
+    For core dumps, tasks in the initial PID namespace are looked up in an
+    index of every task, which is built the first time that it is needed. This
+    can be disabled with the ``DRGN_INDEX_TASKS`` environment variable.
+
     :param prog_or_ns: ``struct pid_namespace *`` object, or :class:`Program`
         to use initial PID namespace.
     :return: ``struct task_struct *``
     """
     ...
 
+def _linux_helper_find_thread_group(
+    prog: Program, tgid: IntegerLike
+) -> List[Object]:
+    """
+    Return all of the threads in the thread group with the given ID in the
+    initial PID namespace.
+
+    :param tgid: Thread group ID (the PID of the thread group leader).
+    :return: List of ``struct task_struct *`` objects, or an empty list if the
+        thread group doesn't exist.
+    """
+    ...
+
+def _linux_helper_find_tasks_by_comm(
+    prog: Program, comm: Union[str, bytes]
+) -> List[Object]:
+    """
+    Return all of the tasks with the given command name (``task->comm``).
+
+    Note that the kernel truncates command names to 15 bytes.
+
+    :return: List of ``struct task_struct *`` objects.
+    """
+    ...
+
+def _linux_helper_for_each_file(task: Object) -> List[Tuple[int, Object]]:
+    """
+    Get all of the files open in a given task.
+
+    :param task: ``struct task_struct *``
+    :return: List of (fd, ``struct file *``) tuples sorted by fd.
+    """
+    ...
+
+def _linux_helper_for_each_task_file(
+    prog: Program,
+) -> List[Tuple[Object, int, Object]]:
+    """
+    Get all of the files open in every task. The tasks are walked in
+    parallel, and tasks whose file descriptor tables can't be read (e.g.,
+    because they are exiting) are skipped.
+
+    :return: List of (``struct task_struct *``, fd, ``struct file *``) tuples.
+    """
+    ...
+
+def _linux_helper_d_path(vfsmnt: Object, dentry: IntegerLike) -> bytes:
+    """
+    Return the full path of a dentry given a mount and dentry.
+
+    :param vfsmnt: ``struct vfsmount *``
+    :param dentry: ``struct dentry *``
+    """
+    ...
+
+def _linux_helper_dentry_path(dentry: Object) -> bytes:
+    """
+    Return the path of a dentry from the root of its filesystem.
+
+    :param dentry: ``struct dentry *``
+    """
+    ...
+
+def _linux_helper_d_paths(
+    prog: Program, paths: Iterable[Tuple[IntegerLike, IntegerLike]]
+) -> List[bytes]:
+    """
+    Return the full paths of many dentries.
+
+    This is equivalent to ``[d_path(vfsmnt, dentry) for vfsmnt, dentry in
+    paths]``, but the paths of common parent directories and mounts are only
+    computed once. For core dumps, they are also cached between calls to
+    :func:`d_path()`, :func:`dentry_path()`, and this function.
+
+    :param paths: Iterable of (``struct vfsmount *``, ``struct dentry *``)
+        pairs.
+    """
+    ...
+
+def _linux_helper_css_descendants_pre(
+    css: Object, root_path: bytes, members: Sequence[MemberPath] = ()
+) -> List[Tuple[Object, bytes, Tuple[Object, ...]]]:
+    """
+    Get the online descendants of a css in pre-order, the paths of their
+    cgroups, and the values of the given member paths for each. See
+    :func:`drgn.helpers.linux.cgroup.css_for_each_descendant_pre_with_path()`.
+
+    :param css: ``struct cgroup_subsys_state *``
+    :param root_path: Path of the cgroup of *css*.
+    """
+    ...
+
+def _linux_helper_sk_hash_sockets(
+    buckets: Object, num_buckets: IntegerLike, head_member: str, node_member: str
+) -> List[Tuple[int, int, bytes, bytes, int, int, int, int, int]]:
+    """
+    Get the sockets in an array of hash buckets as (socket address, family,
+    source address, destination address, source port, destination port, state,
+    inode number, network namespace address) tuples. See
+    :func:`drgn.helpers.linux.net.inet_hashinfo_sockets()`.
+
+    :param buckets: Pointer to the first bucket.
+    :param num_buckets: Number of buckets.
+    :param head_member: Name of the ``struct hlist_nulls_head`` or ``struct
+        hlist_head`` member of the bucket type.
+    :param node_member: Name of the list node member of ``struct sock``.
+    """
+    ...
+
+def _linux_helper_bpf_progs(
+    prog: Program,
+) -> List[Tuple[int, int, int, int, bytes, bytes, int, int, int, int]]:
+    """
+    Get all BPF programs as (program address, ID, type, expected attach type,
+    name, BTF name, number of instructions, JITed size, JITed image address,
+    auxiliary data address) tuples. See
+    :func:`drgn.helpers.linux.bpf.bpf_prog_info_for_each()`.
+    """
+    ...
+
+def _linux_helper_bpf_maps(
+    prog: Program,
+) -> List[Tuple[int, int, int, bytes, int, int, int]]:
+    """
+    Get all BPF maps as (map address, ID, type, name, key size, value size,
+    maximum number of entries) tuples. See
+    :func:`drgn.helpers.linux.bpf.bpf_map_info_for_each()`.
+    """
+    ...
+
 def _linux_helper_kaslr_offset(prog: Program) -> int:
     """
     Get the kernel address space layout randomization offset (zero if it is
@@ -52,6 +52,7 @@ from _drgn import (
     FindObjectFlags,
     IntegerLike,
     Language,
+    MemberPath,
     MissingDebugInfoError,
     Object,
     ObjectAbsentError,
@@ -93,6 +94,7 @@ from _drgn import (
 from _drgn import (  # noqa: F401
     _elfutils_version as _elfutils_version,
     _with_libkdumpfile as _with_libkdumpfile,
+    _with_libzstd as _with_libzstd,
 )
 from drgn.internal.version import __version__ as __version__  # noqa: F401
 
@@ -102,6 +104,7 @@ __all__ = (
     "FindObjectFlags",
     "IntegerLike",
     "Language",
+    "MemberPath",
     "MissingDebugInfoError",
     "NULL",
     "Object",
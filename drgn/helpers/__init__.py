@@ -21,6 +21,7 @@ import enum
 import typing
 from typing import Container, Iterable, Tuple
 
+from _drgn import _decode_enum_type_flags
 from drgn import IntegerLike, Type
 
 
@@ -223,6 +224,10 @@ def decode_enum_type_flags(
     :param bit_numbers: Whether the enumerator values specify the bit numbers
          or values of the flags.
     """
+    value = value.__index__()
+    if 0 <= value < 1 << 64:
+        return _decode_enum_type_flags(value, type, bit_numbers)
+
     enumerators = type.enumerators
     if enumerators is None:
         raise TypeError("cannot decode incomplete enumerated type")
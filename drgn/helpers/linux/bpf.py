@@ -12,20 +12,78 @@ etc.
 
 
 import itertools
-from typing import Iterator
+from typing import Iterator, NamedTuple
 
+from _drgn import _linux_helper_bpf_maps, _linux_helper_bpf_progs
 from drgn import IntegerLike, Object, Program, cast
 from drgn.helpers.linux.idr import idr_for_each
 from drgn.helpers.linux.list import list_for_each_entry
 
 __all__ = (
+    "BpfMapInfo",
+    "BpfProgInfo",
     "bpf_map_for_each",
+    "bpf_map_info_for_each",
     "bpf_prog_for_each",
+    "bpf_prog_info_for_each",
     "cgroup_bpf_prog_for_each",
     "cgroup_bpf_prog_for_each_effective",
 )
 
 
+class BpfProgInfo(NamedTuple):
+    """Commonly displayed fields of a BPF program."""
+
+    address: int
+    """
+    Address of the ``struct bpf_prog``. Use ``Object(prog, "struct bpf_prog
+    *", address)`` to get the program itself.
+    """
+    id: int
+    """Program ID."""
+    type: int
+    """``enum bpf_prog_type``."""
+    expected_attach_type: int
+    """``enum bpf_attach_type``, or 0 before Linux 4.17."""
+    name: bytes
+    """Name (possibly truncated), or empty before Linux 4.15."""
+    btf_name: bytes
+    """
+    Name of the program's function from its BTF information, or empty if it
+    doesn't have BTF information.
+    """
+    len: int
+    """Number of instructions."""
+    jited_len: int
+    """Size of the JITed image in bytes."""
+    bpf_func: int
+    """Address of the JITed image."""
+    aux: int
+    """Address of the ``struct bpf_prog_aux``."""
+
+
+class BpfMapInfo(NamedTuple):
+    """Commonly displayed fields of a BPF map."""
+
+    address: int
+    """
+    Address of the ``struct bpf_map``. Use ``Object(prog, "struct bpf_map *",
+    address)`` to get the map itself.
+    """
+    id: int
+    """Map ID."""
+    map_type: int
+    """``enum bpf_map_type``."""
+    name: bytes
+    """Name (possibly truncated), or empty before Linux 4.15."""
+    key_size: int
+    """Size of keys in bytes."""
+    value_size: int
+    """Size of values in bytes."""
+    max_entries: int
+    """Maximum number of entries."""
+
+
 def bpf_map_for_each(prog: Program) -> Iterator[Object]:
     """
     Iterate over all BPF maps.
@@ -36,6 +94,19 @@ def bpf_map_for_each(prog: Program) -> Iterator[Object]:
         yield cast("struct bpf_map *", entry)
 
 
+def bpf_map_info_for_each(prog: Program) -> Iterator[BpfMapInfo]:
+    """
+    Iterate over all BPF maps along with their commonly displayed fields.
+
+    This walks ``map_idr`` natively and reads each map once, so it is much
+    faster than :func:`bpf_map_for_each()` followed by reading the members of
+    each map.
+
+    :return: Iterator of :class:`BpfMapInfo` in order of ID.
+    """
+    return map(BpfMapInfo._make, _linux_helper_bpf_maps(prog))
+
+
 def bpf_prog_for_each(prog: Program) -> Iterator[Object]:
     """
     Iterate over all BPF programs.
@@ -46,6 +117,19 @@ def bpf_prog_for_each(prog: Program) -> Iterator[Object]:
         yield cast("struct bpf_prog *", entry)
 
 
+def bpf_prog_info_for_each(prog: Program) -> Iterator[BpfProgInfo]:
+    """
+    Iterate over all BPF programs along with their commonly displayed fields.
+
+    This walks ``prog_idr`` natively and reads each program and its ``struct
+    bpf_prog_aux`` once, so it is much faster than :func:`bpf_prog_for_each()`
+    followed by reading the members of each program.
+
+    :return: Iterator of :class:`BpfProgInfo` in order of ID.
+    """
+    return map(BpfProgInfo._make, _linux_helper_bpf_progs(prog))
+
+
 def cgroup_bpf_prog_for_each(
     cgrp: Object, bpf_attach_type: IntegerLike
 ) -> Iterator[Object]:
@@ -12,7 +12,14 @@ Linux virtual filesystem (VFS) layer, including mounts, dentries, and inodes.
 import os
 from typing import Iterator, Optional, Tuple, Union, overload
 
-from drgn import IntegerLike, Object, Path, Program, container_of, sizeof
+from _drgn import (
+    _linux_helper_d_path,
+    _linux_helper_d_paths as d_paths,
+    _linux_helper_dentry_path,
+    _linux_helper_for_each_file,
+    _linux_helper_for_each_task_file as for_each_task_file,
+)
+from drgn import IntegerLike, Object, Path, Program, container_of
 from drgn.helpers import escape_ascii_string
 from drgn.helpers.linux.list import (
     hlist_empty,
@@ -24,6 +31,7 @@ from drgn.helpers.linux.list import (
 __all__ = (
     "path_lookup",
     "d_path",
+    "d_paths",
     "dentry_path",
     "inode_path",
     "inode_paths",
@@ -34,6 +42,7 @@ __all__ = (
     "print_mounts",
     "fget",
     "for_each_file",
+    "for_each_task_file",
     "print_files",
 )
 
@@ -156,35 +165,10 @@ def d_path(  # type: ignore  # Need positional-only arguments.
 ) -> bytes:
     if dentry is None:
         vfsmnt = path_or_vfsmnt.mnt
-        dentry = path_or_vfsmnt.dentry.read_()
+        dentry = path_or_vfsmnt.dentry
     else:
         vfsmnt = path_or_vfsmnt
-        dentry = dentry.read_()
-    mnt = container_of(vfsmnt, "struct mount", "mnt")
-
-    d_op = dentry.d_op.read_()
-    if d_op and d_op.d_dname:
-        return b"[" + dentry.d_inode.i_sb.s_type.name.string_() + b"]"
-
-    components = []
-    while True:
-        if dentry == mnt.mnt.mnt_root:
-            mnt_parent = mnt.mnt_parent.read_()
-            if mnt == mnt_parent:
-                break
-            dentry = mnt.mnt_mountpoint.read_()
-            mnt = mnt_parent
-            continue
-        d_parent = dentry.d_parent.read_()
-        if dentry == d_parent:
-            break
-        components.append(dentry.d_name.name.string_())
-        components.append(b"/")
-        dentry = d_parent
-    if components:
-        return b"".join(reversed(components))
-    else:
-        return b"/"
+    return _linux_helper_d_path(vfsmnt, dentry)
 
 
 def dentry_path(dentry: Object) -> bytes:
@@ -193,14 +177,7 @@ def dentry_path(dentry: Object) -> bytes:
 
     :param dentry: ``struct dentry *``
     """
-    components = []
-    while True:
-        d_parent = dentry.d_parent.read_()
-        if dentry == d_parent:
-            break
-        components.append(dentry.d_name.name.string_())
-        dentry = d_parent
-    return b"/".join(reversed(components))
+    return _linux_helper_dentry_path(dentry)
 
 
 def inode_path(inode: Object) -> Optional[bytes]:
@@ -339,15 +316,7 @@ def for_each_file(task: Object) -> Iterator[Tuple[int, Object]]:
     :param task: ``struct task_struct *``
     :return: Iterator of (fd, ``struct file *``) tuples.
     """
-    fdt = task.files.fdt.read_()
-    bits_per_long = 8 * sizeof(fdt.open_fds.type_.type)
-    for i in range((fdt.max_fds.value_() + bits_per_long - 1) // bits_per_long):
-        word = fdt.open_fds[i].value_()
-        for j in range(bits_per_long):
-            if word & (1 << j):
-                fd = i * bits_per_long + j
-                file = fdt.fd[fd].read_()
-                yield fd, file
+    return iter(_linux_helper_for_each_file(task))
 
 
 def print_files(task: Object) -> None:
@@ -356,7 +325,10 @@ def print_files(task: Object) -> None:
 
     :param task: ``struct task_struct *``
     """
-    for fd, file in for_each_file(task):
-        path = d_path(file.f_path)
+    files = list(for_each_file(task))
+    paths = d_paths(
+        task.prog_, [(file.f_path.mnt, file.f_path.dentry) for _, file in files]
+    )
+    for (fd, file), path in zip(files, paths):
         escaped_path = escape_ascii_string(path, escape_backslash=True)
         print(f"{fd} {escaped_path} ({file.type_.type_name()})0x{file.value_():x}")
@@ -12,6 +12,11 @@ hlist_head``) in :linux:`include/linux/list.h`.
 
 from typing import Iterator, Union
 
+from _drgn import (
+    _linux_helper_hlist_for_each_entry as hlist_for_each_entry,
+    _linux_helper_list_for_each_entry as list_for_each_entry,
+    _linux_helper_list_for_each_entry_reverse as list_for_each_entry_reverse,
+)
 from drgn import NULL, Object, Type, container_of
 from drgn.helpers import ValidationError
 
@@ -158,38 +163,6 @@ def list_for_each_reverse(head: Object) -> Iterator[Object]:
         pos = pos.prev.read_()
 
 
-def list_for_each_entry(
-    type: Union[str, Type], head: Object, member: str
-) -> Iterator[Object]:
-    """
-    Iterate over all of the entries in a list.
-
-    :param type: Entry type.
-    :param head: ``struct list_head *``
-    :param member: Name of list node member in entry type.
-    :return: Iterator of ``type *`` objects.
-    """
-    type = head.prog_.type(type)
-    for pos in list_for_each(head):
-        yield container_of(pos, type, member)
-
-
-def list_for_each_entry_reverse(
-    type: Union[str, Type], head: Object, member: str
-) -> Iterator[Object]:
-    """
-    Iterate over all of the entries in a list in reverse order.
-
-    :param type: Entry type.
-    :param head: ``struct list_head *``
-    :param member: Name of list node member in entry type.
-    :return: Iterator of ``type *`` objects.
-    """
-    type = head.prog_.type(type)
-    for pos in list_for_each_reverse(head):
-        yield container_of(pos, type, member)
-
-
 def validate_list(head: Object) -> None:
     """
     Validate that the ``next`` and ``prev`` pointers in a list are consistent.
@@ -261,19 +234,3 @@ def hlist_for_each(head: Object) -> Iterator[Object]:
     while pos:
         yield pos
         pos = pos.next.read_()
-
-
-def hlist_for_each_entry(
-    type: Union[str, Type], head: Object, member: str
-) -> Iterator[Object]:
-    """
-    Iterate over all of the entries in a hash list.
-
-    :param type: Entry type.
-    :param head: ``struct hlist_head *``
-    :param member: Name of list node member in entry type.
-    :return: Iterator of ``type *`` objects.
-    """
-    type = head.prog_.type(type)
-    for pos in hlist_for_each(head):
-        yield container_of(pos, type, member)
@@ -11,9 +11,10 @@ hlist_nulls_node``) in :linux:`include/linux/list_nulls.h` where the end of
 list is not a ``NULL`` pointer, but a "nulls" marker.
 """
 
-from typing import Iterator, Union
-
-from drgn import Object, Type, container_of
+from _drgn import (
+    _linux_helper_hlist_nulls_for_each_entry as hlist_nulls_for_each_entry,
+)
+from drgn import Object
 
 __all__ = (
     "hlist_nulls_empty",
@@ -38,21 +39,3 @@ def hlist_nulls_empty(head: Object) -> bool:
     :param head: ``struct hlist_nulls_head *``
     """
     return is_a_nulls(head.first)
-
-
-def hlist_nulls_for_each_entry(
-    type: Union[str, Type], head: Object, member: str
-) -> Iterator[Object]:
-    """
-    Iterate over all the entries in a nulls hash list.
-
-    :param type: Entry type.
-    :param head: ``struct hlist_nulls_head *``
-    :param member: Name of list node member in entry type.
-    :return: Iterator of ``type *`` objects.
-    """
-    type = head.prog_.type(type)
-    pos = head.first
-    while not is_a_nulls(pos):
-        yield container_of(pos, type, member)
-        pos = pos.next
@@ -7,15 +7,25 @@ Memory Management
 
 The ``drgn.helpers.linux.mm`` module provides helpers for working with the
 Linux memory management (MM) subsystem. Only x86-64 support is currently
-implemented.
+implemented, except that :func:`access_process_vm()`,
+:func:`access_remote_vm()`, :func:`pgtable_mappings()`,
+:func:`find_phys_mappings()`, and the helpers built on them also support
+AArch64.
 """
 
+import array
 import operator
-from typing import Iterator, List, Optional, Union, overload
+from typing import Iterable, Iterator, List, Optional, Tuple, Union, overload
 
-from _drgn import _linux_helper_read_vm
+from _drgn import (
+    _linux_helper_find_page_pfns,
+    _linux_helper_pgtable_mappings,
+    _linux_helper_read_vm,
+    _linux_helper_reverse_map,
+)
 from drgn import IntegerLike, Object, Program, cast
 from drgn.helpers import decode_enum_type_flags
+from drgn.helpers.linux.pid import for_each_task
 
 __all__ = (
     "access_process_vm",
@@ -23,11 +33,14 @@ __all__ = (
     "cmdline",
     "decode_page_flags",
     "environ",
+    "find_page_pfns",
+    "find_phys_mappings",
     "for_each_page",
     "page_to_pfn",
     "page_to_virt",
     "pfn_to_page",
     "pfn_to_virt",
+    "pgtable_mappings",
     "virt_to_page",
     "virt_to_pfn",
 )
@@ -44,6 +57,47 @@ def for_each_page(prog: Program) -> Iterator[Object]:
         yield vmemmap + i
 
 
+def find_page_pfns(
+    prog: Program,
+    flags_mask: IntegerLike = 0,
+    flags_value: Optional[IntegerLike] = None,
+    *,
+    mapping: Optional[IntegerLike] = None,
+    min_refcount: Optional[IntegerLike] = None,
+) -> "array.array[int]":
+    """
+    Find the page frame numbers (PFNs) of all pages matching the given
+    criteria.
+
+    This is much faster than filtering :func:`for_each_page()`: the page array
+    is read in large chunks and filtered without creating an object for each
+    page. Holes in the page array are skipped.
+
+    >>> PG_slab = prog.constant("PG_slab")
+    >>> len(find_page_pfns(prog, 1 << PG_slab))
+    9063
+
+    :param flags_mask: Mask of page flags (``page->flags``) to check.
+    :param flags_value: Required value of ``page->flags & flags_mask``. If
+        ``None``, all of the flags in *flags_mask* must be set.
+    :param mapping: If not ``None``, only find pages with this ``page->mapping``.
+    :param min_refcount: If not ``None``, only find pages with at least this
+        reference count (``page->_refcount``).
+    :return: Array of PFNs in increasing order.
+    """
+    pfns = array.array("Q")
+    pfns.frombytes(
+        _linux_helper_find_page_pfns(
+            prog,
+            flags_mask,
+            flags_value,
+            mapping=mapping,
+            min_refcount=min_refcount,
+        )
+    )
+    return pfns
+
+
 def decode_page_flags(page: Object) -> str:
     """
     Get a human-readable representation of the flags set on a page.
@@ -251,6 +305,89 @@ def access_remote_vm(mm: Object, address: IntegerLike, size: IntegerLike) -> byt
     return _linux_helper_read_vm(mm.prog_, mm.pgd, address, size)
 
 
+def pgtable_mappings(
+    pgd: Object, start: IntegerLike = 0, end: Optional[IntegerLike] = None
+) -> List[Tuple[int, int, int, int]]:
+    """
+    Get all of the mapped ranges of a page table.
+
+    The page table is walked in one pass, which is much faster than translating
+    addresses one at a time. Adjacent ranges that are virtually and physically
+    contiguous and have the same page table entry flags are merged.
+
+    >>> mm = find_task(prog, 1490152).mm
+    >>> for virt_addr, phys_addr, size, flags in pgtable_mappings(
+    ...     mm.pgd, end=mm.task_size
+    ... ):
+    ...     print(hex(virt_addr), hex(phys_addr), hex(size))
+    ...
+    0x55d5b7a6b000 0x10b4a7000 0x1000
+    ...
+
+    :param pgd: ``pgd_t *``
+    :param start: First virtual address to include.
+    :param end: Virtual address to stop at (exclusive). If ``None``, the
+        entire address space after *start* is included.
+    :return: List of (*virt_addr*, *phys_addr*, *size*, *flags*) tuples in
+        increasing order of virtual address. *flags* are the
+        architecture-specific flags of the page table entry.
+    """
+    mappings = array.array("Q")
+    mappings.frombytes(_linux_helper_pgtable_mappings(pgd.prog_, pgd, start, end))
+    it = iter(mappings)
+    return list(zip(it, it, it, it))
+
+
+def find_phys_mappings(
+    prog: Program,
+    phys_addrs: Iterable[IntegerLike],
+    mms: Optional[Iterable[Object]] = None,
+) -> List[List[Tuple[Object, int]]]:
+    """
+    Find the user virtual addresses that map physical addresses.
+
+    The user page tables of every address space are walked in parallel and
+    indexed by physical address in one pass, so finding many addresses at once
+    is much faster than finding them separately.
+
+    >>> pfn = 0x10b4a7
+    >>> for mm, address in find_phys_mappings(prog, [pfn << 12])[0]:
+    ...     print(hex(mm), hex(address))
+    ...
+    0xffff8a4c4b2a8000 0x55d5b7a6b000
+
+    :param phys_addrs: Physical addresses to find.
+    :param mms: ``struct mm_struct *`` address spaces to search. If ``None``,
+        the address spaces of all tasks are searched.
+    :return: For each address in *phys_addrs*, a list of (*mm*, *virt_addr*)
+        tuples, where *mm* is the ``struct mm_struct *`` containing a mapping
+        of the address at *virt_addr*.
+    """
+    if mms is None:
+        seen = set()
+        mm_list = []
+        for task in for_each_task(prog):
+            mm = task.mm.read_()
+            if mm and mm.value_() not in seen:
+                seen.add(mm.value_())
+                mm_list.append(mm)
+    else:
+        mm_list = list(mms)
+    pgtables = array.array("Q", [mm.pgd.value_() for mm in mm_list])
+    ends = array.array("Q", [mm.task_size.value_() for mm in mm_list])
+    addrs = array.array("Q", [operator.index(addr) for addr in phys_addrs])
+    found = array.array("Q")
+    found.frombytes(
+        _linux_helper_reverse_map(
+            prog, pgtables.tobytes(), ends.tobytes(), addrs.tobytes()
+        )
+    )
+    result: List[List[Tuple[Object, int]]] = [[] for _ in addrs]
+    for i in range(0, len(found), 3):
+        result[found[i]].append((mm_list[found[i + 1]], found[i + 2]))
+    return result
+
+
 def cmdline(task: Object) -> List[bytes]:
     """
     Get the list of command line arguments of a task.
@@ -10,13 +10,18 @@ per-CPU allocations from :linux:`include/linux/percpu.h` and per-CPU counters
 from :linux:`include/linux/percpu_counter.h`.
 """
 
-from _drgn import _linux_helper_per_cpu_ptr as per_cpu_ptr
+from _drgn import (
+    _linux_helper_per_cpu_ptr as per_cpu_ptr,
+    _linux_helper_per_cpu_sum as per_cpu_sum,
+    _linux_helper_per_cpu_values as per_cpu_values,
+)
 from drgn import IntegerLike, Object
-from drgn.helpers.linux.cpumask import for_each_online_cpu
 
 __all__ = (
     "per_cpu",
     "per_cpu_ptr",
+    "per_cpu_sum",
+    "per_cpu_values",
     "percpu_counter_sum",
 )
 
@@ -44,8 +49,4 @@ def percpu_counter_sum(fbc: Object) -> int:
 
     :param fbc: ``struct percpu_counter *``
     """
-    ret = fbc.count.value_()
-    ptr = fbc.counters
-    for cpu in for_each_online_cpu(fbc.prog_):
-        ret += per_cpu_ptr(ptr, cpu)[0].value_()
-    return ret
+    return fbc.count.value_() + per_cpu_sum(fbc.counters)
@@ -14,6 +14,8 @@ from typing import Iterator, Union
 from _drgn import (
     _linux_helper_find_pid as find_pid,
     _linux_helper_find_task as find_task,
+    _linux_helper_find_tasks_by_comm as find_tasks_by_comm,
+    _linux_helper_find_thread_group as find_thread_group,
     _linux_helper_pid_task as pid_task,
 )
 from drgn import Object, Program, cast, container_of
@@ -23,6 +25,8 @@ from drgn.helpers.linux.list import hlist_for_each_entry
 __all__ = (
     "find_pid",
     "find_task",
+    "find_tasks_by_comm",
+    "find_thread_group",
     "for_each_pid",
     "for_each_task",
     "pid_task",
@@ -0,0 +1,90 @@
+# Copyright (c) Meta Platforms, Inc. and affiliates.
+# SPDX-License-Identifier: GPL-3.0-or-later
+
+"""
+Pipelines
+---------
+
+The ``drgn.helpers.linux.pipeline`` module provides a way to iterate over
+kernel objects, filter them on their members, and get some of their members
+without creating an :class:`~drgn.Object` for each one.
+"""
+
+from typing import Any, List, Optional, Sequence, Tuple, Union
+
+from _drgn import _linux_helper_pipeline
+from drgn import IntegerLike, MemberPath, Object, Program, Type
+
+__all__ = ("Pipeline",)
+
+
+class Pipeline:
+    """
+    Compiled "iterate, filter, project" query over kernel objects.
+
+    The members are compiled against *type* once. Running the pipeline walks
+    the source natively, reads the members of many entries at a time, and
+    only converts the selected members of matching entries to Python.
+
+    >>> pipeline = Pipeline(
+    ...     prog,
+    ...     "struct task_struct",
+    ...     "list",
+    ...     member="tasks",
+    ...     where=[("flags", "&", PF_KTHREAD), ("pid", ">", 100)],
+    ...     select=["pid", "se.sum_exec_runtime"],
+    ... )
+    >>> pipeline.run(prog["init_task"].tasks.address_of_())
+    [(18446620439656368384, 101, 2597583), ...]
+
+    :param type: Type of the entries.
+    :param source: Where the entries come from:
+
+        * ``"list"``, ``"list_reverse"``: ``struct list_head *``, like
+          :func:`~drgn.helpers.linux.list.list_for_each_entry()` and
+          :func:`~drgn.helpers.linux.list.list_for_each_entry_reverse()`.
+        * ``"hlist"``: ``struct hlist_head *``.
+        * ``"hlist_nulls"``: ``struct hlist_nulls_head *``.
+        * ``"rbtree"``: ``struct rb_root *``, in order.
+        * ``"radix_tree"``, ``"xarray"``: ``struct radix_tree_root *`` or
+          ``struct xarray *`` of ``type *`` entries. Value entries are skipped.
+        * ``"slab"``: allocated objects in a ``struct kmem_cache *``.
+        * ``"array"``: array of *type*, or array of ``type *`` (skipping null
+          pointers).
+    :param member: Name of the list or red-black tree node member in *type*.
+        Required for list and red-black tree sources.
+    :param where: Filters as ``(member, operator, value)`` tuples. The operator
+        is one of ``"=="``, ``"!="``, ``"<"``, ``"<="``, ``">"``, ``">="``, or
+        ``"&"`` (bitwise and is non-zero). Only entries matching every filter
+        are returned.
+    :param select: Members to return for each matching entry.
+    :raises TypeError: if a member doesn't have an integer, boolean, pointer,
+        or floating-point type
+    """
+
+    def __init__(
+        self,
+        prog: Program,
+        type: Union[str, Type],
+        source: str,
+        *,
+        member: Optional[str] = None,
+        where: Sequence[
+            Tuple[Union[str, MemberPath], str, Union[IntegerLike, float]]
+        ] = (),
+        select: Sequence[Union[str, MemberPath]] = (),
+    ) -> None:
+        self._pipeline = _linux_helper_pipeline(
+            prog, type, source, member, where, select
+        )
+
+    def run(self, root: Object) -> List[Tuple[Any, ...]]:
+        """
+        Run the pipeline.
+
+        :param root: List head, red-black tree root, radix tree root, or slab
+            cache pointer, or array object, depending on the source.
+        :return: One tuple per matching entry, in iteration order, containing
+            the address of the entry followed by the selected members.
+        """
+        return self._pipeline.run(root)
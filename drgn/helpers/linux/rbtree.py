@@ -11,6 +11,10 @@ red-black trees from :linux:`include/linux/rbtree.h`.
 
 from typing import Callable, Generator, Iterator, Tuple, TypeVar, Union
 
+from _drgn import (
+    _linux_helper_rbtree_inorder_for_each as rbtree_inorder_for_each,
+    _linux_helper_rbtree_inorder_for_each_entry as rbtree_inorder_for_each_entry,
+)
 from drgn import NULL, Object, Type, container_of
 from drgn.helpers import ValidationError
 
@@ -159,39 +163,6 @@ def rb_prev(node: Object) -> Object:
     return parent
 
 
-def rbtree_inorder_for_each(root: Object) -> Iterator[Object]:
-    """
-    Iterate over all of the nodes in a red-black tree, in sort order.
-
-    :param root: ``struct rb_root *``
-    :return: Iterator of ``struct rb_node *`` objects.
-    """
-
-    def aux(node: Object) -> Iterator[Object]:
-        if node:
-            yield from aux(node.rb_left.read_())
-            yield node
-            yield from aux(node.rb_right.read_())
-
-    yield from aux(root.rb_node.read_())
-
-
-def rbtree_inorder_for_each_entry(
-    type: Union[str, Type], root: Object, member: str
-) -> Iterator[Object]:
-    """
-    Iterate over all of the entries in a red-black tree in sorted order.
-
-    :param type: Entry type.
-    :param root: ``struct rb_root *``
-    :param member: Name of ``struct rb_node`` member in entry type.
-    :return: Iterator of ``type *`` objects.
-    """
-    type = root.prog_.type(type)
-    for node in rbtree_inorder_for_each(root):
-        yield container_of(node, type, member)
-
-
 KeyType = TypeVar("KeyType")
 
 
@@ -15,16 +15,19 @@ Linux slab allocator.
     <drgn.helpers.linux.slab.slab_cache_is_merged>`.
 """
 
-from typing import Iterator, Optional, Set, Union
+import operator
+from typing import Iterator, List, Optional, Union
 
-from drgn import FaultError, Object, Program, Type, cast, sizeof
+from _drgn import (
+    _linux_helper_heap_graph,
+    _linux_helper_slab_cache_for_each_allocated_object,
+)
+from drgn import IntegerLike, Object, Program, Type, TypeKind
 from drgn.helpers import escape_ascii_string
-from drgn.helpers.linux.cpumask import for_each_online_cpu
 from drgn.helpers.linux.list import list_for_each_entry
-from drgn.helpers.linux.mm import for_each_page, page_to_virt
-from drgn.helpers.linux.percpu import per_cpu_ptr
 
 __all__ = (
+    "SlabHeapGraph",
     "find_slab_cache",
     "for_each_slab_cache",
     "print_slab_caches",
@@ -114,6 +117,9 @@ def slab_cache_for_each_allocated_object(
     Only the SLUB and SLAB allocators are supported; SLOB does not store enough
     information to identify objects in a slab cache.
 
+    Slabs are decoded in parallel by :attr:`drgn.Program.num_threads` threads.
+    Set it to 1 to walk the slab cache on the calling thread only.
+
     >>> dentry_cache = find_slab_cache(prog, "dentry")
     >>> next(slab_cache_for_each_allocated_object(dentry_cache, "struct dentry"))
     *(struct dentry *)0xffff905e41404000 = {
@@ -124,123 +130,79 @@ def slab_cache_for_each_allocated_object(
     :param type: Type of object in the slab cache.
     :return: Iterator of ``type *`` objects.
     """
-    prog = slab_cache.prog_
-    slab_cache_size = slab_cache.size.value_()
-    pointer_type = prog.pointer_type(prog.type(type))
-
-    try:
-        freelist_type = prog.type("freelist_idx_t *")
-        slub = False
-    except LookupError:
-        slub = True
-
-    if slub:
-        try:
-            red_left_pad = slab_cache.red_left_pad.value_()
-        except AttributeError:
-            red_left_pad = 0
-
-        # In SLUB, the freelist is a linked list with the next pointer located
-        # at ptr + slab_cache->offset.
-        try:
-            freelist_offset = slab_cache.offset.value_()
-        except AttributeError:
-            raise ValueError("SLOB is not supported") from None
-
-        # If CONFIG_SLAB_FREELIST_HARDENED is enabled, then the next pointer is
-        # obfuscated using slab_cache->random.
-        try:
-            freelist_random = slab_cache.random.value_()
-        except AttributeError:
-
-            def _freelist_dereference(ptr_addr: int) -> int:
-                return prog.read_word(ptr_addr)
-
-        else:
-            ulong_size = sizeof(prog.type("unsigned long"))
-
-            def _freelist_dereference(ptr_addr: int) -> int:
-                # *ptr_addr ^ slab_cache->random ^ byteswap(ptr_addr)
-                return (
-                    prog.read_word(ptr_addr)
-                    ^ freelist_random
-                    ^ int.from_bytes(ptr_addr.to_bytes(ulong_size, "little"), "big")
-                )
-
-        def _slub_get_freelist(freelist: Object, freelist_set: Set[int]) -> None:
-            ptr = freelist.value_()
-            while ptr:
-                freelist_set.add(ptr)
-                ptr = _freelist_dereference(ptr + freelist_offset)
-
-        cpu_freelists: Set[int] = set()
-        cpu_slab = slab_cache.cpu_slab.read_()
-        # Since Linux kernel commit bb192ed9aa71 ("mm/slub: Convert most struct
-        # page to struct slab by spatch") (in v5.17), the current slab for a
-        # CPU is `struct slab *slab`. Before that, it is `struct page *page`.
-        cpu_slab_attr = "slab" if hasattr(cpu_slab, "slab") else "page"
-        for cpu in for_each_online_cpu(prog):
-            this_cpu_slab = per_cpu_ptr(cpu_slab, cpu)
-            slab = getattr(this_cpu_slab, cpu_slab_attr).read_()
-            if slab and slab.slab_cache == slab_cache:
-                _slub_get_freelist(this_cpu_slab.freelist, cpu_freelists)
-
-        def _slab_page_objects(page: Object, slab: Object) -> Iterator[Object]:
-            freelist: Set[int] = set()
-            _slub_get_freelist(slab.freelist, freelist)
-            addr = page_to_virt(page).value_() + red_left_pad
-            end = addr + slab_cache_size * slab.objects
-            while addr < end:
-                if addr not in freelist and addr not in cpu_freelists:
-                    yield Object(prog, pointer_type, value=addr)
-                addr += slab_cache_size
-
-    else:
-        try:
-            obj_offset = slab_cache.obj_offset.value_()
-        except AttributeError:
-            obj_offset = 0
-
-        slab_cache_num = slab_cache.num.value_()
-
-        cpu_cache = slab_cache.cpu_cache.read_()
-        cpu_caches_avail: Set[int] = set()
-        for cpu in for_each_online_cpu(prog):
-            ac = per_cpu_ptr(cpu_cache, cpu)
-            for i in range(ac.avail):
-                cpu_caches_avail.add(ac.entry[i].value_())
-
-        def _slab_freelist(slab: Object) -> Set[int]:
-            # In SLAB, the freelist is an array of free object indices.
-            freelist = cast(freelist_type, slab.freelist)
-            return {freelist[i].value_() for i in range(slab.active, slab_cache_num)}
-
-        def _slab_page_objects(page: Object, slab: Object) -> Iterator[Object]:
-            freelist = _slab_freelist(slab)
-            s_mem = slab.s_mem.value_()
-            for i in range(slab_cache_num):
-                if i in freelist:
-                    continue
-                addr = s_mem + i * slab_cache_size + obj_offset
-                if addr in cpu_caches_avail:
-                    continue
-                yield Object(prog, pointer_type, value=addr)
-
-    # Linux kernel commit d122019bf061cccc4583eb9ad40bf58c2fe517be ("mm: Split
-    # slab into its own type") (in v5.17) moved slab information from struct
-    # page to struct slab. The former can be casted to the latter.
-    try:
-        slab_type = prog.type("struct slab *")
-    except LookupError:
-        slab_type = prog.type("struct page *")
-
-    PG_slab_mask = 1 << prog.constant("PG_slab")
-    for page in for_each_page(prog):
-        try:
-            if not page.flags & PG_slab_mask:
-                continue
-        except FaultError:
-            continue
-        slab = cast(slab_type, page)
-        if slab.slab_cache == slab_cache:
-            yield from _slab_page_objects(page, slab)
+    # The freelist and page scanning are done in C; see
+    # linux_helper_slab_object_iterator in libdrgn. Delegate from a generator
+    # so that errors are raised on the first iteration.
+    yield from _linux_helper_slab_cache_for_each_allocated_object(slab_cache, type)
+
+
+class SlabHeapGraph:
+    """
+    Index of which allocated slab objects point to which.
+
+    Building the index scans every aligned, pointer-sized word of every
+    allocated object in every slab cache for a value pointing into another
+    allocated slab object. This is done once, in parallel, so that finding the
+    referrers of an object afterwards only takes time proportional to their
+    number.
+
+    >>> graph = SlabHeapGraph(prog)
+    >>> for address in graph.referrers(file):
+    ...     print(hex(address), hex(graph.object_containing(address)))
+
+    The index is a snapshot, so it is mostly useful for core dumps. Like
+    :func:`slab_cache_for_each_allocated_object()`, only the SLUB and SLAB
+    allocators are supported.
+
+    :param scan_pages: Also scan memory outside of slabs (e.g., page allocator
+        memory) for references. These referrers aren't inside of an indexed
+        object.
+    """
+
+    def __init__(self, prog: Program, scan_pages: bool = False) -> None:
+        self._graph = _linux_helper_heap_graph(prog, scan_pages)
+
+    def __len__(self) -> int:
+        """Return the number of indexed objects."""
+        return len(self._graph)
+
+    @property
+    def num_referrers(self) -> int:
+        """Total number of references found."""
+        return self._graph.num_referrers
+
+    @staticmethod
+    def _address(obj: Union[Object, IntegerLike]) -> int:
+        if isinstance(obj, Object):
+            if obj.type_.unaliased_kind() == TypeKind.POINTER:
+                return obj.value_()
+            address = obj.address_
+            if address is None:
+                raise ValueError("object must be a pointer or reference")
+            return address
+        return operator.index(obj)
+
+    def object_containing(self, obj: Union[Object, IntegerLike]) -> Optional[int]:
+        """
+        Get the start address of the allocated slab object containing an
+        address.
+
+        :param obj: Address, pointer, or reference object.
+        :return: Object address, or ``None`` if the address isn't in an
+            allocated slab object.
+        """
+        found = self._graph.find(self._address(obj))
+        return None if found is None else found[0]
+
+    def referrers(self, obj: Union[Object, IntegerLike]) -> List[int]:
+        """
+        Get the addresses of the words pointing into the allocated slab object
+        containing an address.
+
+        Words in the object itself are not included.
+
+        :param obj: Address, pointer, or reference object.
+        :return: Sorted list of addresses. This is empty if the address isn't
+            in an allocated slab object.
+        """
+        return self._graph.referrers(self._address(obj))
@@ -1,7 +1,15 @@
 // Copyright (c) Meta Platforms, Inc. and affiliates.
 // SPDX-License-Identifier: GPL-3.0-or-later
 
+#include <byteswap.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include "bitops.h"
+#include "drgn.h"
+#include "error.h"
 #include "platform.h" // IWYU pragma: associated
+#include "program.h"
 
 /*
  * The ABI specification can be found at:
@@ -43,6 +51,163 @@ apply_elf_reloc_aarch64(const struct drgn_relocating_section *relocating,
 	}
 }
 
+/*
+ * The page table geometry depends on the page size (4K, 16K, or 64K) and the
+ * number of virtual address bits. The largest tables are 64K and there are at
+ * most 4 levels.
+ */
+#define AARCH64_MAX_PGTABLE_LEVELS 4
+#define AARCH64_MAX_PGTABLE_ENTRIES 8192
+
+struct pgtable_iterator_aarch64 {
+	uint16_t index[AARCH64_MAX_PGTABLE_LEVELS];
+	uint64_t table[AARCH64_MAX_PGTABLE_LEVELS][AARCH64_MAX_PGTABLE_ENTRIES];
+};
+
+static void pgtable_iterator_arch_init_aarch64(void *buf)
+{
+	struct pgtable_iterator_aarch64 *arch = buf;
+	/* The tables are always filled before they're used. */
+	memset(arch->index, 0xff, sizeof(arch->index));
+}
+
+static struct drgn_error *
+linux_kernel_pgtable_iterator_next_aarch64(struct pgtable_iterator *it,
+					   uint64_t *virt_addr_ret,
+					   uint64_t *phys_addr_ret)
+{
+	static const uint64_t VALID = 0x1;
+	/* A table descriptor, or a page descriptor at the last level. */
+	static const uint64_t TABLE = 0x2;
+	static const uint64_t CONT = UINT64_C(1) << 52;
+	struct drgn_error *err;
+	struct drgn_program *prog = it->prog;
+	struct pgtable_iterator_aarch64 *arch = (void *)it->arch;
+	bool bswap = drgn_platform_bswap(&prog->platform);
+
+	int page_shift = ctz(prog->vmcoreinfo.page_size);
+	if (page_shift != 12 && page_shift != 14 && page_shift != 16) {
+		return drgn_error_format(DRGN_ERROR_OTHER,
+					 "unsupported AArch64 page size %" PRIu64,
+					 prog->vmcoreinfo.page_size);
+	}
+	int pgtable_shift = page_shift - 3;
+	/* VA_BITS was added to VMCOREINFO in Linux 4.12. Assume the default. */
+	int va_bits = prog->vmcoreinfo.va_bits ? prog->vmcoreinfo.va_bits : 48;
+	int levels = (va_bits - page_shift + pgtable_shift - 1) / pgtable_shift;
+	if (va_bits > 52 || levels > AARCH64_MAX_PGTABLE_LEVELS ||
+	    (va_bits > 48 && page_shift != 16)) {
+		return drgn_error_format(DRGN_ERROR_OTHER,
+					 "unsupported AArch64 virtual address size %d",
+					 va_bits);
+	}
+	/* The top level may have fewer entries than the others. */
+	uint16_t top_entries =
+		1 << (va_bits - page_shift - pgtable_shift * (levels - 1));
+	uint16_t entries = 1 << pgtable_shift;
+	/* Bits 47:page_shift. With 64K pages, bits 15:12 are bits 51:48. */
+	uint64_t address_mask =
+		(UINT64_C(1) << 48) - (UINT64_C(1) << page_shift);
+	/*
+	 * log2 of the number of entries covered by a block or page with the
+	 * contiguous bit at the last two levels.
+	 */
+	int cont_shift[2] = {
+		page_shift == 12 ? 4 : page_shift == 14 ? 7 : 5,
+		page_shift == 14 ? 5 : page_shift == 12 ? 4 : 5,
+	};
+	uint64_t user_end = UINT64_C(1) << va_bits;
+	int level;
+
+	/* Find the lowest level with cached entries. */
+	for (level = 0; level < levels; level++) {
+		if (arch->index[level] <
+		    (level == levels - 1 ? top_entries : entries))
+			break;
+	}
+	/* For every level below that, refill the cache/return pages. */
+	for (;; level--) {
+		uint64_t table;
+		bool table_physical;
+		if (level == levels) {
+			/*
+			 * Only the top and bottom va_bits of the address space
+			 * are mapped, by TTBR1 and TTBR0, respectively.
+			 */
+			if (it->virt_addr >= user_end &&
+			    it->virt_addr < -user_end) {
+				*virt_addr_ret = user_end;
+				*phys_addr_ret = UINT64_MAX;
+				it->flags = 0;
+				it->virt_addr = -user_end;
+				return NULL;
+			}
+			/*
+			 * Kernel addresses are always translated by
+			 * swapper_pg_dir, even for a process's page table.
+			 */
+			if (it->virt_addr >= -user_end)
+				table = prog->vmcoreinfo.swapper_pg_dir;
+			else
+				table = it->pgtable;
+			table_physical = false;
+		} else {
+			uint16_t index = arch->index[level]++;
+			uint64_t entry = arch->table[level][index];
+			if (bswap)
+				entry = bswap_64(entry);
+			table = entry & address_mask;
+			if (page_shift == 16)
+				table |= (entry & 0xf000) << 36;
+			if (!(entry & VALID) || !(entry & TABLE) || level == 0) {
+				/* Bit 1 clear at the last level is reserved. */
+				bool mapped = ((entry & VALID) &&
+					       (level > 0 || (entry & TABLE)));
+				int shift = page_shift + pgtable_shift * level;
+				/*
+				 * A contiguous range of entries maps an aligned
+				 * range of physical memory, so return it all at
+				 * once.
+				 */
+				if (mapped && (entry & CONT) && level < 2) {
+					int n = cont_shift[level];
+					shift += n;
+					arch->index[level] =
+						(index | ((1 << n) - 1)) + 1;
+				}
+				uint64_t mask = (UINT64_C(1) << shift) - 1;
+				*virt_addr_ret = it->virt_addr & ~mask;
+				if (mapped) {
+					*phys_addr_ret = table & ~mask;
+					it->flags = entry & ~address_mask;
+					if (page_shift == 16)
+						it->flags &= ~UINT64_C(0xf000);
+				} else {
+					*phys_addr_ret = UINT64_MAX;
+					it->flags = 0;
+				}
+				it->virt_addr = (it->virt_addr | mask) + 1;
+				return NULL;
+			}
+			table_physical = true;
+		}
+		uint16_t num_entries =
+			level == levels ? top_entries : entries;
+		uint16_t index = (it->virt_addr >>
+				  (page_shift + pgtable_shift * (level - 1))) &
+				 (num_entries - 1);
+		/* Like on x86-64, always read to the end of the table. */
+		err = drgn_program_read_memory(prog,
+					       &arch->table[level - 1][index],
+					       table + 8 * index,
+					       8 * (num_entries - index),
+					       table_physical);
+		if (err)
+			return err;
+		arch->index[level - 1] = index;
+	}
+}
+
 const struct drgn_architecture_info arch_info_aarch64 = {
 	.name = "AArch64",
 	.arch = DRGN_ARCH_AARCH64,
@@ -50,4 +215,8 @@ const struct drgn_architecture_info arch_info_aarch64 = {
 			  DRGN_PLATFORM_IS_LITTLE_ENDIAN),
 	.register_by_name = drgn_register_by_name_unknown,
 	.apply_elf_reloc = apply_elf_reloc_aarch64,
+	.pgtable_iterator_arch_size = sizeof(struct pgtable_iterator_aarch64),
+	.pgtable_iterator_arch_init = pgtable_iterator_arch_init_aarch64,
+	.linux_kernel_pgtable_iterator_next =
+		linux_kernel_pgtable_iterator_next_aarch64,
 };
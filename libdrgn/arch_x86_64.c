@@ -617,7 +617,7 @@ linux_kernel_live_direct_mapping_fallback_x86_64(struct drgn_program *prog,
 	unsigned long page_offset_base_address;
 
 	*size_ret = UINT64_C(1) << 46;
-	err = proc_kallsyms_symbol_addr("page_offset_base",
+	err = proc_kallsyms_symbol_addr(prog, "page_offset_base",
 					&page_offset_base_address);
 	if (!err) {
 		return drgn_program_read_word(prog, page_offset_base_address,
@@ -634,6 +634,37 @@ linux_kernel_live_direct_mapping_fallback_x86_64(struct drgn_program *prog,
 	}
 }
 
+static size_t
+linux_kernel_linear_mappings_x86_64(struct drgn_program *prog,
+				    uint64_t page_offset,
+				    struct drgn_linear_mapping *ret)
+{
+	size_t n = 0;
+	/*
+	 * The direct mapping maps all of physical memory starting at
+	 * PAGE_OFFSET. Its size is the maximum physical address space.
+	 */
+	ret[n++] = (struct drgn_linear_mapping){
+		.virt_addr = page_offset,
+		.size = UINT64_C(1) << (prog->vmcoreinfo.pgtable_l5_enabled ?
+					52 : 46),
+		.phys_addr = 0,
+	};
+	/*
+	 * The kernel image is mapped at __START_KERNEL_map, offset by
+	 * phys_base. We can only use this if VMCOREINFO tells us both
+	 * phys_base and KERNEL_IMAGE_SIZE (so that we don't cover modules).
+	 */
+	if (prog->vmcoreinfo.kernel_image_size) {
+		ret[n++] = (struct drgn_linear_mapping){
+			.virt_addr = UINT64_C(0xffffffff80000000),
+			.size = prog->vmcoreinfo.kernel_image_size,
+			.phys_addr = prog->vmcoreinfo.phys_base,
+		};
+	}
+	return n;
+}
+
 struct pgtable_iterator_x86_64 {
 	uint16_t index[5];
 	uint64_t table[5][512];
@@ -685,6 +716,7 @@ linux_kernel_pgtable_iterator_next_x86_64(struct pgtable_iterator *it,
 			    it->virt_addr < end_non_canonical) {
 				*virt_addr_ret = start_non_canonical;
 				*phys_addr_ret = UINT64_MAX;
+				it->flags = 0;
 				it->virt_addr = end_non_canonical;
 				return NULL;
 			}
@@ -700,10 +732,13 @@ linux_kernel_pgtable_iterator_next_x86_64(struct pgtable_iterator *it,
 						 (PAGE_SHIFT +
 						  PGTABLE_SHIFT * level)) - 1;
 				*virt_addr_ret = it->virt_addr & ~mask;
-				if (entry & PRESENT)
+				if (entry & PRESENT) {
 					*phys_addr_ret = table & ~mask;
-				else
+					it->flags = entry & ~ADDRESS_MASK;
+				} else {
 					*phys_addr_ret = UINT64_MAX;
+					it->flags = 0;
+				}
 				it->virt_addr = (it->virt_addr | mask) + 1;
 				return NULL;
 			}
@@ -748,4 +783,5 @@ const struct drgn_architecture_info arch_info_x86_64 = {
 	.pgtable_iterator_arch_init = pgtable_iterator_arch_init_x86_64,
 	.linux_kernel_pgtable_iterator_next =
 		linux_kernel_pgtable_iterator_next_x86_64,
+	.linux_kernel_linear_mappings = linux_kernel_linear_mappings_x86_64,
 };
@@ -0,0 +1,66 @@
+// Copyright (c) Meta Platforms, Inc. and affiliates.
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <stdalign.h>
+#include <stdlib.h>
+
+#include "arena.h"
+
+/* Size of each chunk that isn't for a single large allocation. */
+#define DRGN_ARENA_CHUNK_SIZE (64 * 1024)
+
+struct drgn_arena_chunk {
+	struct drgn_arena_chunk *next;
+	alignas(max_align_t) char data[];
+};
+
+void drgn_arena_deinit(struct drgn_arena *arena)
+{
+	struct drgn_arena_chunk *chunk = arena->chunks;
+	while (chunk) {
+		struct drgn_arena_chunk *next = chunk->next;
+		free(chunk);
+		chunk = next;
+	}
+}
+
+void *drgn_arena_alloc_slow(struct drgn_arena *arena, size_t size,
+			    size_t align)
+{
+	const size_t chunk_data_size =
+		DRGN_ARENA_CHUNK_SIZE - sizeof(struct drgn_arena_chunk);
+	/*
+	 * Allocations bigger than a quarter of a chunk get their own chunk so
+	 * that they don't waste the rest of the current one.
+	 */
+	if (size > chunk_data_size / 4) {
+		if (size > SIZE_MAX - sizeof(struct drgn_arena_chunk))
+			return NULL;
+		struct drgn_arena_chunk *chunk =
+			malloc(sizeof(*chunk) + size);
+		if (!chunk)
+			return NULL;
+		/*
+		 * Put it behind the current chunk so we keep allocating from
+		 * the current one.
+		 */
+		if (arena->chunks) {
+			chunk->next = arena->chunks->next;
+			arena->chunks->next = chunk;
+		} else {
+			chunk->next = NULL;
+			arena->chunks = chunk;
+		}
+		return chunk->data;
+	}
+
+	struct drgn_arena_chunk *chunk = malloc(DRGN_ARENA_CHUNK_SIZE);
+	if (!chunk)
+		return NULL;
+	chunk->next = arena->chunks;
+	arena->chunks = chunk;
+	/* The chunk data is maximally aligned, so no padding is needed. */
+	arena->pos = (uintptr_t)chunk->data + size;
+	arena->end = (uintptr_t)chunk->data + chunk_data_size;
+	return chunk->data;
+}
@@ -0,0 +1,101 @@
+// Copyright (c) Meta Platforms, Inc. and affiliates.
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/**
+ * @file
+ *
+ * Arena allocator.
+ *
+ * See @ref Arenas.
+ */
+
+#ifndef DRGN_ARENA_H
+#define DRGN_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @ingroup Internals
+ *
+ * @defgroup Arenas Arenas
+ *
+ * Bump allocator for objects with the same lifetime.
+ *
+ * An arena hands out memory from large chunks and frees all of it at once when
+ * it is deinitialized. Allocating from an arena is much cheaper than @c
+ * malloc(), and objects allocated together are contiguous in memory.
+ * Individual allocations cannot be freed.
+ *
+ * Arenas are not thread-safe; the caller must provide locking if needed.
+ *
+ * @{
+ */
+
+struct drgn_arena_chunk;
+
+/** Arena allocator. */
+struct drgn_arena {
+	/** Most recently allocated chunk. */
+	struct drgn_arena_chunk *chunks;
+	/** Next free byte in the current chunk. */
+	uintptr_t pos;
+	/** End of the current chunk. */
+	uintptr_t end;
+};
+
+/** Initialize an empty @ref drgn_arena. */
+static inline void drgn_arena_init(struct drgn_arena *arena)
+{
+	arena->chunks = NULL;
+	arena->pos = arena->end = 0;
+}
+
+/** Free all memory allocated from a @ref drgn_arena. */
+void drgn_arena_deinit(struct drgn_arena *arena);
+
+void *drgn_arena_alloc_slow(struct drgn_arena *arena, size_t size,
+			    size_t align);
+
+/**
+ * Allocate memory from a @ref drgn_arena.
+ *
+ * @param[in] size Size of the allocation in bytes.
+ * @param[in] align Alignment of the allocation. Must be a power of two no
+ * greater than `alignof(max_align_t)`.
+ * @return Allocated memory, which is not initialized, or @c NULL if out of
+ * memory. It is valid until @ref drgn_arena_deinit().
+ */
+static inline void *drgn_arena_alloc(struct drgn_arena *arena, size_t size,
+				     size_t align)
+{
+	uintptr_t pos = (arena->pos + align - 1) & ~(uintptr_t)(align - 1);
+	if (pos <= arena->end && size <= arena->end - pos) {
+		arena->pos = pos + size;
+		return (void *)pos;
+	}
+	return drgn_arena_alloc_slow(arena, size, align);
+}
+
+/**
+ * Copy memory into a @ref drgn_arena.
+ *
+ * @param[in] src Memory to copy.
+ * @param[in] size Number of bytes to copy.
+ * @param[in] align Alignment of the copy. See @ref drgn_arena_alloc().
+ * @return Copy, or @c NULL if out of memory.
+ */
+static inline void *drgn_arena_memdup(struct drgn_arena *arena,
+				      const void *src, size_t size,
+				      size_t align)
+{
+	void *dst = drgn_arena_alloc(arena, size, align);
+	if (dst)
+		memcpy(dst, src, size);
+	return dst;
+}
+
+/** @} */
+
+#endif /* DRGN_ARENA_H */
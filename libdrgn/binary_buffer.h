@@ -19,6 +19,7 @@
 #include <stddef.h>
 #include <string.h>
 
+#include "bitops.h"
 #include "util.h"
 
 /**
@@ -474,6 +475,46 @@ binary_buffer_skip_leb128(struct binary_buffer *bb)
 	return binary_buffer_error_at(bb, bb->pos, "expected LEB128 number");
 }
 
+/**
+ * Skip past @p n consecutive LEB128 numbers at the current buffer position.
+ *
+ * This is equivalent to calling @ref binary_buffer_skip_leb128() @p n times,
+ * but it finds the bytes that end each number eight bytes at a time.
+ */
+static inline struct drgn_error *
+binary_buffer_skip_leb128s(struct binary_buffer *bb, size_t n)
+{
+	const char *pos = bb->pos;
+	while (n > 0 && bb->end - pos >= 8) {
+		uint64_t word;
+		memcpy(&word, pos, sizeof(word));
+		if (!HOST_LITTLE_ENDIAN)
+			word = bswap_64(word);
+		/* The high bit of every byte that ends a number is clear. */
+		uint64_t ends = ~word & UINT64_C(0x8080808080808080);
+		size_t num_ends = popcount(ends);
+		if (num_ends >= n) {
+			/* Find the nth end. */
+			while (--n)
+				ends &= ends - 1;
+			bb->pos = pos + ctz(ends) / 8 + 1;
+			return NULL;
+		}
+		pos += 8;
+		n -= num_ends;
+	}
+	while (n > 0) {
+		if (unlikely(pos >= bb->end)) {
+			return binary_buffer_error_at(bb, bb->pos,
+						      "expected LEB128 number");
+		}
+		if (!(*(uint8_t *)(pos++) & 0x80))
+			n--;
+	}
+	bb->pos = pos;
+	return NULL;
+}
+
 /**
  * Get a null-terminated string at the current buffer position and advance the
  * position.
@@ -40,6 +40,18 @@
  */
 #define ctz(x) generic_bitop(x, PP_UNIQUE(_x), builtin_bitop_impl, ctz)
 
+/**
+ * Count the number of 1-bits in @p x.
+ *
+ * ```
+ * popcount(0) == popcount(0b0) == 0
+ * popcount(13) == popcount(0b1101) == 3
+ * ```
+ *
+ * @param[in] x Integer.
+ */
+#define popcount(x) generic_bitop(x, PP_UNIQUE(_x), builtin_bitop_impl, popcount)
+
 /**
  * Find Last Set bit.
  *
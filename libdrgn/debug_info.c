@@ -14,11 +14,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include "debug_info.h"
 #include "error.h"
 #include "linux_kernel.h"
+#include "minmax.h"
+#include "openmp.h"
 #include "program.h"
 #include "util.h"
 
@@ -30,9 +34,11 @@ static const char * const drgn_debug_scn_names[] = {
 	[DRGN_SCN_DEBUG_STR_OFFSETS] = ".debug_str_offsets",
 	[DRGN_SCN_DEBUG_LINE] = ".debug_line",
 	[DRGN_SCN_DEBUG_LINE_STR] = ".debug_line_str",
+	[DRGN_SCN_DEBUG_NAMES] = ".debug_names",
 	[DRGN_SCN_DEBUG_ADDR] = ".debug_addr",
 	[DRGN_SCN_DEBUG_FRAME] = ".debug_frame",
 	[DRGN_SCN_EH_FRAME] = ".eh_frame",
+	[DRGN_SCN_EH_FRAME_HDR] = ".eh_frame_hdr",
 	[DRGN_SCN_ORC_UNWIND_IP] = ".orc_unwind_ip",
 	[DRGN_SCN_ORC_UNWIND] = ".orc_unwind",
 	[DRGN_SCN_DEBUG_LOC] = ".debug_loc",
@@ -243,6 +249,25 @@ drgn_debug_info_module_finish_indexing(struct drgn_debug_info *dbinfo,
 	}
 }
 
+/*
+ * If indexing a pinned module again failed, go back to the unloaded state
+ * instead of freeing it.
+ */
+static void
+drgn_debug_info_module_restore_pinned(struct drgn_debug_info_module *module)
+{
+	if (module->pinned && module->state != DRGN_DEBUG_INFO_MODULE_INDEXED)
+		module->state = DRGN_DEBUG_INFO_MODULE_UNLOADED;
+}
+
+/* Whether a module is kept when the modules that weren't indexed are freed. */
+static inline bool
+drgn_debug_info_module_is_kept(struct drgn_debug_info_module *module)
+{
+	return (module->state == DRGN_DEBUG_INFO_MODULE_INDEXED ||
+		module->state == DRGN_DEBUG_INFO_MODULE_UNLOADED);
+}
+
 /*
  * Wrapper around dwfl_report_end() that works around a libdwfl bug which causes
  * it to close stdin when it frees some modules that were reported by
@@ -264,6 +289,8 @@ static int my_dwfl_report_end(struct drgn_debug_info *dbinfo,
 		dup2(fd, 0);
 		close(fd);
 	}
+	/* The set of modules may have changed. */
+	drgn_symbol_index_clear(&dbinfo->symbols);
 	return ret;
 }
 
@@ -287,13 +314,15 @@ static int drgn_dwfl_module_removed(Dwfl_Module *dwfl_module, void *userdatap,
 	if (arg->finish_indexing && module &&
 	    module->state == DRGN_DEBUG_INFO_MODULE_INDEXING)
 		drgn_debug_info_module_finish_indexing(arg->dbinfo, module);
+	if (module)
+		drgn_debug_info_module_restore_pinned(module);
 	if (arg->free_all || !module ||
-	    module->state != DRGN_DEBUG_INFO_MODULE_INDEXED) {
+	    !drgn_debug_info_module_is_kept(module)) {
 		drgn_debug_info_module_destroy(module);
 	} else {
 		/*
-		 * The module was already indexed. Report it again so libdwfl
-		 * doesn't remove it.
+		 * The module was already indexed (or unloaded). Report it again
+		 * so libdwfl doesn't remove it.
 		 */
 		Dwarf_Addr end;
 		dwfl_module_info(dwfl_module, NULL, NULL, &end, NULL, NULL,
@@ -317,8 +346,9 @@ static void drgn_debug_info_free_modules(struct drgn_debug_info *dbinfo,
 				drgn_debug_info_module_finish_indexing(dbinfo,
 								       module);
 			}
+			drgn_debug_info_module_restore_pinned(module);
 			if (free_all ||
-			    module->state != DRGN_DEBUG_INFO_MODULE_INDEXED) {
+			    !drgn_debug_info_module_is_kept(module)) {
 				if (module == *nextp) {
 					if (nextp == it.entry && !next) {
 						it = drgn_debug_info_module_table_delete_iterator(&dbinfo->modules,
@@ -394,6 +424,23 @@ err:
 	return &drgn_enomem;
 }
 
+/*
+ * Index a module that was unloaded again. Its ELF file is still open and its
+ * sections are still cached, so it doesn't need to be reported again.
+ */
+static struct drgn_error *
+drgn_debug_info_reload_module(struct drgn_debug_info_load_state *load,
+			      struct drgn_debug_info_module *module,
+			      bool *new_ret)
+{
+	if (!drgn_debug_info_module_vector_append(&load->new_modules, &module))
+		return &drgn_enomem;
+	module->state = DRGN_DEBUG_INFO_MODULE_NEW;
+	if (new_ret)
+		*new_ret = true;
+	return NULL;
+}
+
 static struct drgn_error *
 drgn_debug_info_report_module(struct drgn_debug_info_load_state *load,
 			      const void *build_id, size_t build_id_len,
@@ -426,6 +473,12 @@ drgn_debug_info_report_module(struct drgn_debug_info_load_state *load,
 			err = NULL;
 			goto free;
 		}
+		if (it.entry &&
+		    (*it.entry)->state == DRGN_DEBUG_INFO_MODULE_UNLOADED) {
+			err = drgn_debug_info_reload_module(load, *it.entry,
+							    new_ret);
+			goto free;
+		}
 	}
 
 	if (!dwfl_module) {
@@ -450,8 +503,14 @@ drgn_debug_info_report_module(struct drgn_debug_info_load_state *load,
 	dwfl_module_info(dwfl_module, &userdatap, NULL, NULL, NULL, NULL, NULL,
 			 NULL);
 	if (*userdatap) {
-		/* We've already reported this file at this offset. */
-		err = NULL;
+		struct drgn_debug_info_module *existing = *userdatap;
+		if (existing->state == DRGN_DEBUG_INFO_MODULE_UNLOADED) {
+			err = drgn_debug_info_reload_module(load, existing,
+							    new_ret);
+		} else {
+			/* We've already reported this file at this offset. */
+			err = NULL;
+		}
 		goto free;
 	}
 	if (new_ret)
@@ -635,10 +694,6 @@ DEFINE_HASH_MAP(drgn_mapped_files, const char *,
 
 struct userspace_core_report_state {
 	struct drgn_mapped_files files;
-	void *phdr_buf;
-	size_t phdr_buf_capacity;
-	void *segment_buf;
-	size_t segment_buf_capacity;
 };
 
 static struct drgn_error *parse_nt_file_error(struct binary_buffer *bb,
@@ -1044,78 +1099,202 @@ core_get_phdr(void *arg_, size_t i, GElf_Phdr *ret)
 	return NULL;
 }
 
-struct userspace_core_identified_file {
+/* Possible file in a userspace core dump and what we know about it. */
+struct userspace_core_mapped_file {
+	const char *path;
+	const struct drgn_mapped_file_segment *segments;
+	size_t num_segments;
+	/* Mapped segment that may contain the ELF file header. */
+	const struct drgn_mapped_file_segment *ehdr_segment;
+	Elf64_Ehdr ehdr_buf;
+	/* Whether ehdr_buf was read from the core dump. */
+	bool have_ehdr;
+	GElf_Ehdr ehdr;
+	struct core_get_phdr_arg phdr_arg;
+	/* Program headers from the core dump, or NULL if not dumped. */
+	void *phdr_buf;
+	/* Note segments from the core dump. */
+	void *note_buf;
+	size_t note_requests_start, num_note_requests;
+	uint64_t bias;
+	/* The build ID points into note_buf. */
 	const void *build_id;
 	size_t build_id_len;
 	uint64_t start, end;
 	bool ignore;
 	bool have_address_range;
+	/* File at path if it matches, otherwise NULL and -1. */
+	Elf *elf;
+	int fd;
 };
 
-static struct drgn_error *
-userspace_core_identify_file(struct drgn_program *prog,
-			     struct userspace_core_report_state *core,
-			     const struct drgn_mapped_file_segment *segments,
-			     size_t num_segments,
-			     const struct drgn_mapped_file_segment *ehdr_segment,
-			     struct userspace_core_identified_file *ret)
+DEFINE_VECTOR(userspace_core_mapped_file_vector,
+	      struct userspace_core_mapped_file)
+DEFINE_VECTOR(drgn_memory_read_request_vector, struct drgn_memory_read_request)
+
+static void
+userspace_core_mapped_file_deinit(struct userspace_core_mapped_file *file)
 {
-	struct drgn_error *err;
+	if (file->elf) {
+		elf_end(file->elf);
+		close(file->fd);
+	}
+	free(file->note_buf);
+	free(file->phdr_buf);
+}
 
-	Elf64_Ehdr ehdr_buf;
-	err = drgn_program_read_memory(prog, &ehdr_buf, ehdr_segment->start,
-				       sizeof(ehdr_buf), false);
-	if (err) {
-		if (err->code == DRGN_ERROR_FAULT) {
-			drgn_error_destroy(err);
-			err = NULL;
-		}
+/*
+ * Read memory from a core dump in a batch. Memory that wasn't dumped is
+ * expected, so this only returns errors other than faults. The faults are left
+ * in the requests for the caller to check and free.
+ */
+static struct drgn_error *
+userspace_core_read_memory_batch(struct drgn_program *prog,
+				 struct drgn_memory_read_request *requests,
+				 size_t num_requests)
+{
+	struct drgn_error *err =
+		drgn_program_read_memory_batch(prog, requests, num_requests,
+					       false);
+	if (err)
 		return err;
+	for (size_t i = 0; i < num_requests; i++) {
+		if (requests[i].err &&
+		    requests[i].err->code != DRGN_ERROR_FAULT) {
+			err = requests[i].err;
+			requests[i].err = NULL;
+			break;
+		}
 	}
-	if (memcmp(&ehdr_buf, ELFMAG, SELFMAG) != 0) {
-		ret->ignore = true;
-		return NULL;
+	if (err) {
+		for (size_t i = 0; i < num_requests; i++) {
+			drgn_error_destroy(requests[i].err);
+			requests[i].err = NULL;
+		}
 	}
+	return err;
+}
 
-	GElf_Ehdr ehdr;
-	struct core_get_phdr_arg arg;
-	read_ehdr(&ehdr_buf, &ehdr, &arg.is_64_bit, &arg.bswap);
-	if (ehdr.e_type == ET_CORE ||
-	    ehdr.e_phnum == 0 ||
-	    ehdr.e_phentsize !=
-	    (arg.is_64_bit ? sizeof(Elf64_Phdr) : sizeof(Elf32_Phdr))) {
-		ret->ignore = true;
-		return NULL;
+/* Find the segments of the mapped files that may start with an ELF header. */
+static struct drgn_error *
+userspace_core_find_mapped_files(struct userspace_core_report_state *core,
+				 struct userspace_core_mapped_file_vector *files)
+{
+	for (struct drgn_mapped_files_iterator it =
+	     drgn_mapped_files_first(&core->files);
+	     it.entry; it = drgn_mapped_files_next(it)) {
+		const struct drgn_mapped_file_segment *segments =
+			it.entry->value.data;
+		size_t num_segments = it.entry->value.size;
+		for (size_t i = 0; i < num_segments; i++) {
+			/*
+			 * There should always be a full page mapped, so even if
+			 * it's a 32-bit file, we can read the 64-bit size.
+			 */
+			if (segments[i].file_offset != 0 ||
+			    segments[i].end - segments[i].start <
+			    sizeof(Elf64_Ehdr))
+				continue;
+			struct userspace_core_mapped_file *file =
+				userspace_core_mapped_file_vector_append_entry(files);
+			if (!file)
+				return &drgn_enomem;
+			memset(file, 0, sizeof(*file));
+			file->path = it.entry->key;
+			file->segments = segments;
+			file->num_segments = num_segments;
+			file->ehdr_segment = &segments[i];
+			file->fd = -1;
+		}
 	}
+	return NULL;
+}
+
+/*
+ * Read the file headers and program headers of all of the mapped files from
+ * the core dump and determine their address ranges.
+ */
+static struct drgn_error *
+userspace_core_read_file_headers(struct drgn_program *prog,
+				 struct userspace_core_mapped_file_vector *files)
+{
+	struct drgn_error *err;
 
-	if (ehdr.e_phnum > SIZE_MAX / ehdr.e_phentsize ||
-	    !alloc_or_reuse(&core->phdr_buf, &core->phdr_buf_capacity,
-			    ehdr.e_phnum * ehdr.e_phentsize))
+	struct drgn_memory_read_request *requests =
+		malloc_array(files->size, sizeof(*requests));
+	if (!requests)
 		return &drgn_enomem;
 
-	/*
-	 * Check whether the mapped segment containing the file header also
-	 * contains the program headers. This seems to be the case in practice.
-	 */
-	uint64_t ehdr_segment_file_end =
-		(ehdr_segment->file_offset +
-		 (ehdr_segment->end - ehdr_segment->start));
-	if (ehdr_segment_file_end < ehdr.e_phoff ||
-	    ehdr_segment_file_end - ehdr.e_phoff <
-	    ehdr.e_phnum * ehdr.e_phentsize)
-		return NULL;
+	for (size_t i = 0; i < files->size; i++) {
+		struct userspace_core_mapped_file *file = &files->data[i];
+		requests[i] = (struct drgn_memory_read_request){
+			.address = file->ehdr_segment->start,
+			.count = sizeof(file->ehdr_buf),
+			.buf = &file->ehdr_buf,
+		};
+	}
+	err = userspace_core_read_memory_batch(prog, requests, files->size);
+	if (err)
+		goto out;
+	for (size_t i = 0; i < files->size; i++) {
+		if (requests[i].err)
+			drgn_error_destroy(requests[i].err);
+		else
+			files->data[i].have_ehdr = true;
+	}
 
-	err = drgn_program_read_memory(prog, core->phdr_buf,
-				       ehdr_segment->start + ehdr.e_phoff,
-				       ehdr.e_phnum * ehdr.e_phentsize, false);
-	if (err) {
-		if (err->code == DRGN_ERROR_FAULT) {
-			drgn_error_destroy(err);
-			err = NULL;
+	size_t num_requests = 0;
+	for (size_t i = 0; i < files->size; i++) {
+		struct userspace_core_mapped_file *file = &files->data[i];
+		if (!file->have_ehdr)
+			continue;
+		if (memcmp(&file->ehdr_buf, ELFMAG, SELFMAG) != 0) {
+			file->ignore = true;
+			continue;
 		}
-		return err;
+
+		GElf_Ehdr *ehdr = &file->ehdr;
+		read_ehdr(&file->ehdr_buf, ehdr, &file->phdr_arg.is_64_bit,
+			  &file->phdr_arg.bswap);
+		if (ehdr->e_type == ET_CORE ||
+		    ehdr->e_phnum == 0 ||
+		    ehdr->e_phentsize !=
+		    (file->phdr_arg.is_64_bit ?
+		     sizeof(Elf64_Phdr) : sizeof(Elf32_Phdr))) {
+			file->ignore = true;
+			continue;
+		}
+
+		/*
+		 * Check whether the mapped segment containing the file header
+		 * also contains the program headers. This seems to be the case
+		 * in practice.
+		 */
+		const struct drgn_mapped_file_segment *ehdr_segment =
+			file->ehdr_segment;
+		size_t phdrs_size = (size_t)ehdr->e_phnum * ehdr->e_phentsize;
+		uint64_t ehdr_segment_file_end =
+			(ehdr_segment->file_offset +
+			 (ehdr_segment->end - ehdr_segment->start));
+		if (ehdr_segment_file_end < ehdr->e_phoff ||
+		    ehdr_segment_file_end - ehdr->e_phoff < phdrs_size)
+			continue;
+
+		file->phdr_buf = malloc(phdrs_size);
+		if (!file->phdr_buf) {
+			err = &drgn_enomem;
+			goto out;
+		}
+		file->phdr_arg.phdr_buf = file->phdr_buf;
+		requests[num_requests++] = (struct drgn_memory_read_request){
+			.address = ehdr_segment->start + ehdr->e_phoff,
+			.count = phdrs_size,
+			.buf = file->phdr_buf,
+		};
 	}
-	arg.phdr_buf = core->phdr_buf;
+	err = userspace_core_read_memory_batch(prog, requests, num_requests);
+	if (err)
+		goto out;
 
 	/*
 	 * In theory, if the program has a huge number of program headers, they
@@ -1128,48 +1307,132 @@ userspace_core_identify_file(struct drgn_program *prog,
 	 * file. However, we need the address range to report the build ID to
 	 * libdwfl, so we do it this way.
 	 */
-	uint64_t bias;
-	err = userspace_core_elf_address_range(ehdr.e_type, ehdr.e_phnum,
-					       core_get_phdr, &arg, segments,
-					       num_segments, ehdr_segment,
-					       &bias, &ret->start, &ret->end);
-	if (err)
-		return err;
-	if (ret->start >= ret->end) {
-		ret->ignore = true;
-		return NULL;
+	size_t j = 0;
+	for (size_t i = 0; i < files->size; i++) {
+		struct userspace_core_mapped_file *file = &files->data[i];
+		if (!file->phdr_buf)
+			continue;
+		struct drgn_memory_read_request *request = &requests[j++];
+		if (request->err) {
+			drgn_error_destroy(request->err);
+			free(file->phdr_buf);
+			file->phdr_buf = NULL;
+			continue;
+		}
+		if (err)
+			continue;
+		err = userspace_core_elf_address_range(file->ehdr.e_type,
+						       file->ehdr.e_phnum,
+						       core_get_phdr,
+						       &file->phdr_arg,
+						       file->segments,
+						       file->num_segments,
+						       file->ehdr_segment,
+						       &file->bias,
+						       &file->start,
+						       &file->end);
+		if (err)
+			continue;
+		if (file->start >= file->end)
+			file->ignore = true;
+		else
+			file->have_address_range = true;
 	}
-	ret->have_address_range = true;
+out:
+	free(requests);
+	return err;
+}
 
-	for (uint16_t i = 0; i < ehdr.e_phnum; i++) {
-		GElf_Phdr phdr;
-		core_get_phdr(&arg, i, &phdr);
-		if (phdr.p_type == PT_NOTE) {
-			if (phdr.p_filesz > SIZE_MAX ||
-			    !alloc_or_reuse(&core->segment_buf,
-					    &core->segment_buf_capacity,
-					    phdr.p_filesz))
-				return &drgn_enomem;
-			err = drgn_program_read_memory(prog, core->segment_buf,
-						       phdr.p_vaddr + bias,
-						       phdr.p_filesz, false);
-			if (err) {
-				if (err->code == DRGN_ERROR_FAULT) {
-					drgn_error_destroy(err);
-					continue;
-				} else {
-					return err;
-				}
+/*
+ * Read the note segments of all of the mapped files with known address ranges
+ * from the core dump and find their build IDs.
+ */
+static struct drgn_error *
+userspace_core_read_build_ids(struct drgn_program *prog,
+			      struct userspace_core_mapped_file_vector *files)
+{
+	struct drgn_error *err;
+
+	struct drgn_memory_read_request_vector requests = VECTOR_INIT;
+	for (size_t i = 0; i < files->size; i++) {
+		struct userspace_core_mapped_file *file = &files->data[i];
+		if (!file->have_address_range)
+			continue;
+
+		size_t note_size = 0;
+		for (uint16_t k = 0; k < file->ehdr.e_phnum; k++) {
+			GElf_Phdr phdr;
+			core_get_phdr(&file->phdr_arg, k, &phdr);
+			if (phdr.p_type != PT_NOTE)
+				continue;
+			if (phdr.p_filesz > SIZE_MAX - note_size) {
+				err = &drgn_enomem;
+				goto out;
 			}
-			ret->build_id = read_build_id(core->segment_buf,
-						      phdr.p_filesz,
-						      phdr.p_align, arg.bswap,
-						      &ret->build_id_len);
-			if (ret->build_id)
-				break;
+			note_size += phdr.p_filesz;
+		}
+		if (!note_size)
+			continue;
+		file->note_buf = malloc(note_size);
+		if (!file->note_buf) {
+			err = &drgn_enomem;
+			goto out;
 		}
+
+		file->note_requests_start = requests.size;
+		char *buf = file->note_buf;
+		for (uint16_t k = 0; k < file->ehdr.e_phnum; k++) {
+			GElf_Phdr phdr;
+			core_get_phdr(&file->phdr_arg, k, &phdr);
+			if (phdr.p_type != PT_NOTE)
+				continue;
+			struct drgn_memory_read_request request = {
+				.address = phdr.p_vaddr + file->bias,
+				.count = phdr.p_filesz,
+				.buf = buf,
+			};
+			if (!drgn_memory_read_request_vector_append(&requests,
+								    &request)) {
+				err = &drgn_enomem;
+				goto out;
+			}
+			buf += phdr.p_filesz;
+		}
+		file->num_note_requests =
+			requests.size - file->note_requests_start;
 	}
-	return NULL;
+	err = userspace_core_read_memory_batch(prog, requests.data,
+					       requests.size);
+	if (err)
+		goto out;
+
+	for (size_t i = 0; i < files->size; i++) {
+		struct userspace_core_mapped_file *file = &files->data[i];
+		size_t r = file->note_requests_start;
+		size_t end = r + file->num_note_requests;
+		for (uint16_t k = 0;
+		     k < file->ehdr.e_phnum && r < end && !file->build_id;
+		     k++) {
+			GElf_Phdr phdr;
+			core_get_phdr(&file->phdr_arg, k, &phdr);
+			if (phdr.p_type != PT_NOTE)
+				continue;
+			struct drgn_memory_read_request *request =
+				&requests.data[r++];
+			if (request->err)
+				continue;
+			file->build_id = read_build_id(request->buf,
+						       request->count,
+						       phdr.p_align,
+						       file->phdr_arg.bswap,
+						       &file->build_id_len);
+		}
+	}
+	for (size_t i = 0; i < requests.size; i++)
+		drgn_error_destroy(requests.data[i].err);
+out:
+	drgn_memory_read_request_vector_deinit(&requests);
+	return err;
 }
 
 static struct drgn_error *elf_file_get_phdr(void *arg, size_t i,
@@ -1180,156 +1443,88 @@ static struct drgn_error *elf_file_get_phdr(void *arg, size_t i,
 	return NULL;
 }
 
-static struct drgn_error *
-userspace_core_maybe_report_file(struct drgn_debug_info_load_state *load,
-				 struct userspace_core_report_state *core,
-				 const char *path,
-				 const struct drgn_mapped_file_segment *segments,
-				 size_t num_segments)
+/*
+ * Open the file at the path of a mapped file and check that it matches what
+ * was in the core dump. This doesn't touch the program, so it can be called for
+ * multiple files in parallel.
+ */
+static void
+userspace_core_open_mapped_file(struct userspace_core_mapped_file *file)
 {
 	struct drgn_error *err;
-	struct drgn_program *prog = load->dbinfo->prog;
-	for (size_t ehdr_idx = 0; ehdr_idx < num_segments; ehdr_idx++) {
-		const struct drgn_mapped_file_segment *ehdr_segment =
-			&segments[ehdr_idx];
-		/*
-		 * There should always be a full page mapped, so even if it's a
-		 * 32-bit file, we can read the 64-bit size.
-		 */
-		if (ehdr_segment->file_offset != 0 ||
-		    ehdr_segment->end - ehdr_segment->start < sizeof(Elf64_Ehdr))
-			continue;
-
-		/*
-		 * This logic is complicated because we're dealing with two data
-		 * sources that we can't completely trust: the memory in the
-		 * core dump and the file at the path found in the core dump.
-		 *
-		 * First, we try to identify the mapped file contents in the
-		 * core dump. Ideally, this will find a build ID. However, this
-		 * can fail for a few reasons:
-		 *
-		 * 1. The file is not an ELF file.
-		 * 2. The ELF file is not an executable or library.
-		 * 3. The ELF file does not have a build ID.
-		 * 4. The file header was not dumped to the core dump, in which
-		 *    case we can't tell whether this is an ELF file. Dumping
-		 *    the first page of an executable file has been the default
-		 *    behavior since Linux kernel commit 895021552d6f
-		 *    ("coredump: default
-		 *    CONFIG_CORE_DUMP_DEFAULT_ELF_HEADERS=y") (in v2.6.37), but
-		 *    it can be disabled at kernel build time or toggled at
-		 *    runtime.
-		 * 5. The build ID or the necessary ELF metadata were not dumped
-		 *    in the core dump. This can happen if the necessary program
-		 *    headers or note segment were not in the first page of the
-		 *    file.
-		 * 6. The file is mapped but not actually loaded into the
-		 *    program (e.g., if the program is a tool like a profiler or
-		 *    a debugger that mmaps binaries [like drgn itself!]).
-		 *
-		 * In cases 1 and 2, we can simply ignore the file. In cases
-		 * 3-5, we blindly trust the path in the core dump. We can
-		 * sometimes detect case 6 in
-		 * userspace_core_elf_address_range().
-		 *
-		 * There is also the possibility that the program modified or
-		 * corrupted the ELF metadata in memory (more likely if the file
-		 * was explicitly mmap'd, since the metadata will usually be
-		 * read-only if it was loaded properly). We don't deal with that
-		 * yet.
-		 */
-		struct userspace_core_identified_file identity = {};
-		err = userspace_core_identify_file(prog, core, segments,
-						   num_segments, ehdr_segment,
-						   &identity);
-		if (err)
-			return err;
-		if (identity.ignore)
-			continue;
 
-#define CLEAR_ELF() do {	\
-	elf = NULL;		\
-	fd = -1;		\
-} while (0)
-#define CLOSE_ELF() do {	\
-	elf_end(elf);		\
-	close(fd);		\
-	CLEAR_ELF();		\
-} while (0)
-		int fd;
-		Elf *elf;
-		/*
-		 * There are a few things that can go wrong here:
-		 *
-		 * 1. The path no longer exists.
-		 * 2. The path refers to a different ELF file than was in the
-		 *    core dump.
-		 * 3. The path refers to something which isn't a valid ELF file.
-		 */
-		err = open_elf_file(path, &fd, &elf);
-		if (err) {
+	/*
+	 * There are a few things that can go wrong here:
+	 *
+	 * 1. The path no longer exists.
+	 * 2. The path refers to a different ELF file than was in the core
+	 *    dump.
+	 * 3. The path refers to something which isn't a valid ELF file.
+	 */
+	err = open_elf_file(file->path, &file->fd, &file->elf);
+	if (err) {
+		drgn_error_destroy(err);
+		file->elf = NULL;
+		file->fd = -1;
+		return;
+	}
+	if (file->build_id_len > 0 &&
+	    !build_id_matches(file->elf, file->build_id, file->build_id_len))
+		goto close;
+
+	if (!file->have_address_range) {
+		GElf_Ehdr ehdr_mem, *ehdr;
+		size_t phnum;
+		if (!(ehdr = gelf_getehdr(file->elf, &ehdr_mem)) ||
+		    elf_getphdrnum(file->elf, &phnum) != 0)
+			goto close;
+		uint64_t bias;
+		err = userspace_core_elf_address_range(ehdr->e_type, phnum,
+						       elf_file_get_phdr,
+						       file->elf,
+						       file->segments,
+						       file->num_segments,
+						       file->ehdr_segment,
+						       &bias, &file->start,
+						       &file->end);
+		if (err || file->start >= file->end) {
 			drgn_error_destroy(err);
-			CLEAR_ELF();
-		} else if (identity.build_id_len > 0) {
-			if (!build_id_matches(elf, identity.build_id,
-					      identity.build_id_len))
-				CLOSE_ELF();
-		}
-
-		if (elf && !identity.have_address_range) {
-			GElf_Ehdr ehdr_mem, *ehdr;
-			size_t phnum;
-			if ((ehdr = gelf_getehdr(elf, &ehdr_mem)) &&
-			    (elf_getphdrnum(elf, &phnum) == 0)) {
-				uint64_t bias;
-				err = userspace_core_elf_address_range(ehdr->e_type,
-								       phnum,
-								       elf_file_get_phdr,
-								       elf,
-								       segments,
-								       num_segments,
-								       ehdr_segment,
-								       &bias,
-								       &identity.start,
-								       &identity.end);
-				if (err || identity.start >= identity.end) {
-					drgn_error_destroy(err);
-					CLOSE_ELF();
-				} else {
-					identity.have_address_range = true;
-				}
-			} else {
-				CLOSE_ELF();
-			}
-		}
-
-		if (elf) {
-			err = drgn_debug_info_report_elf(load, path, fd, elf,
-							 identity.start,
-							 identity.end, NULL,
-							 NULL);
-			if (err)
-				return err;
-		} else {
-			if (!identity.have_address_range)
-				identity.start = identity.end = 0;
-			Dwfl_Module *dwfl_module =
-				dwfl_report_module(load->dbinfo->dwfl, path,
-						   identity.start,
-						   identity.end);
-			if (!dwfl_module)
-				return drgn_error_libdwfl();
-			if (identity.build_id_len > 0 &&
-			    dwfl_module_report_build_id(dwfl_module,
-							identity.build_id,
-							identity.build_id_len,
-							0))
-				return drgn_error_libdwfl();
+			goto close;
 		}
-#undef CLOSE_ELF
-#undef CLEAR_ELF
+		file->have_address_range = true;
 	}
+	return;
+
+close:
+	elf_end(file->elf);
+	close(file->fd);
+	file->elf = NULL;
+	file->fd = -1;
+}
+
+static struct drgn_error *
+userspace_core_report_mapped_file(struct drgn_debug_info_load_state *load,
+				  struct userspace_core_mapped_file *file)
+{
+	if (file->elf) {
+		Elf *elf = file->elf;
+		file->elf = NULL;
+		return drgn_debug_info_report_elf(load, file->path, file->fd,
+						  elf, file->start, file->end,
+						  NULL, NULL);
+	}
+
+	if (!file->have_address_range)
+		file->start = file->end = 0;
+	Dwfl_Module *dwfl_module = dwfl_report_module(load->dbinfo->dwfl,
+						      file->path, file->start,
+						      file->end);
+	if (!dwfl_module)
+		return drgn_error_libdwfl();
+	if (file->build_id_len > 0 &&
+	    dwfl_module_report_build_id(dwfl_module, file->build_id,
+					file->build_id_len, 0))
+		return drgn_error_libdwfl();
 	return NULL;
 }
 
@@ -1337,19 +1532,78 @@ static struct drgn_error *
 userspace_core_report_mapped_files(struct drgn_debug_info_load_state *load,
 				   struct userspace_core_report_state *core)
 {
-
 	struct drgn_error *err;
-	for (struct drgn_mapped_files_iterator it =
-	     drgn_mapped_files_first(&core->files);
-	     it.entry; it = drgn_mapped_files_next(it)) {
-		err = userspace_core_maybe_report_file(load, core,
-						       it.entry->key,
-						       it.entry->value.data,
-						       it.entry->value.size);
+	struct drgn_program *prog = load->dbinfo->prog;
+
+	/*
+	 * This logic is complicated because we're dealing with two data sources
+	 * that we can't completely trust: the memory in the core dump and the
+	 * file at the path found in the core dump.
+	 *
+	 * First, we try to identify the mapped file contents in the core dump.
+	 * Ideally, this will find a build ID. However, this can fail for a few
+	 * reasons:
+	 *
+	 * 1. The file is not an ELF file.
+	 * 2. The ELF file is not an executable or library.
+	 * 3. The ELF file does not have a build ID.
+	 * 4. The file header was not dumped to the core dump, in which case we
+	 *    can't tell whether this is an ELF file. Dumping the first page of
+	 *    an executable file has been the default behavior since Linux
+	 *    kernel commit 895021552d6f ("coredump: default
+	 *    CONFIG_CORE_DUMP_DEFAULT_ELF_HEADERS=y") (in v2.6.37), but it can
+	 *    be disabled at kernel build time or toggled at runtime.
+	 * 5. The build ID or the necessary ELF metadata were not dumped in the
+	 *    core dump. This can happen if the necessary program headers or
+	 *    note segment were not in the first page of the file.
+	 * 6. The file is mapped but not actually loaded into the program (e.g.,
+	 *    if the program is a tool like a profiler or a debugger that mmaps
+	 *    binaries [like drgn itself!]).
+	 *
+	 * In cases 1 and 2, we can simply ignore the file. In cases 3-5, we
+	 * blindly trust the path in the core dump. We can sometimes detect
+	 * case 6 in userspace_core_elf_address_range().
+	 *
+	 * There is also the possibility that the program modified or corrupted
+	 * the ELF metadata in memory (more likely if the file was explicitly
+	 * mmap'd, since the metadata will usually be read-only if it was loaded
+	 * properly). We don't deal with that yet.
+	 *
+	 * Programs can map thousands of files, so we read the metadata of all
+	 * of them from the core dump in a few batches, then open the files in
+	 * parallel, and finally report them in order.
+	 */
+	struct userspace_core_mapped_file_vector files = VECTOR_INIT;
+	err = userspace_core_find_mapped_files(core, &files);
+	if (err)
+		goto out;
+	err = userspace_core_read_file_headers(prog, &files);
+	if (err)
+		goto out;
+	err = userspace_core_read_build_ids(prog, &files);
+	if (err)
+		goto out;
+
+	#pragma omp parallel for schedule(dynamic) \
+		num_threads(drgn_program_num_parallel_threads(prog))
+	for (size_t i = 0; i < files.size; i++) {
+		drgn_program_bind_parallel_thread(prog);
+		if (!files.data[i].ignore)
+			userspace_core_open_mapped_file(&files.data[i]);
+	}
+
+	for (size_t i = 0; i < files.size; i++) {
+		if (files.data[i].ignore)
+			continue;
+		err = userspace_core_report_mapped_file(load, &files.data[i]);
 		if (err)
-			return err;
+			break;
 	}
-	return NULL;
+out:
+	for (size_t i = 0; i < files.size; i++)
+		userspace_core_mapped_file_deinit(&files.data[i]);
+	userspace_core_mapped_file_vector_deinit(&files);
+	return err;
 }
 
 static struct drgn_error *
@@ -1367,8 +1621,6 @@ userspace_core_report_debug_info(struct drgn_debug_info_load_state *load,
 		goto out;
 	err = userspace_core_report_mapped_files(load, &core);
 out:
-	free(core.segment_buf);
-	free(core.phdr_buf);
 	for (struct drgn_mapped_files_iterator it =
 	     drgn_mapped_files_first(&core.files);
 	     it.entry; it = drgn_mapped_files_next(it))
@@ -1532,7 +1784,8 @@ static inline struct drgn_error *get_reloc_sym_value(const void *syms,
 
 static struct drgn_error *
 apply_elf_relas(const struct drgn_relocating_section *relocating,
-		Elf_Data *reloc_data, Elf_Data *symtab_data,
+		Elf_Data *reloc_data, size_t start, size_t end,
+		Elf_Data *symtab_data,
 		const uint64_t *sh_addrs, size_t shdrnum,
 		const struct drgn_platform *platform)
 {
@@ -1545,12 +1798,14 @@ apply_elf_relas(const struct drgn_relocating_section *relocating,
 	const void *relocs = reloc_data->d_buf;
 	size_t reloc_size = is_64_bit ? sizeof(Elf64_Rela) : sizeof(Elf32_Rela);
 	size_t num_relocs = reloc_data->d_size / reloc_size;
+	if (end > num_relocs)
+		end = num_relocs;
 
 	const void *syms = symtab_data->d_buf;
 	size_t sym_size = is_64_bit ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym);
 	size_t num_syms = symtab_data->d_size / sym_size;
 
-	for (size_t i = 0; i < num_relocs; i++) {
+	for (size_t i = start; i < end; i++) {
 		uint64_t r_offset;
 		uint32_t r_sym;
 		uint32_t r_type;
@@ -1602,7 +1857,8 @@ apply_elf_relas(const struct drgn_relocating_section *relocating,
 
 static struct drgn_error *
 apply_elf_rels(const struct drgn_relocating_section *relocating,
-	       Elf_Data *reloc_data, Elf_Data *symtab_data,
+	       Elf_Data *reloc_data, size_t start, size_t end,
+	       Elf_Data *symtab_data,
 	       const uint64_t *sh_addrs, size_t shdrnum,
 	       const struct drgn_platform *platform)
 {
@@ -1615,12 +1871,14 @@ apply_elf_rels(const struct drgn_relocating_section *relocating,
 	const void *relocs = reloc_data->d_buf;
 	size_t reloc_size = is_64_bit ? sizeof(Elf64_Rel) : sizeof(Elf32_Rel);
 	size_t num_relocs = reloc_data->d_size / reloc_size;
+	if (end > num_relocs)
+		end = num_relocs;
 
 	const void *syms = symtab_data->d_buf;
 	size_t sym_size = is_64_bit ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym);
 	size_t num_syms = symtab_data->d_size / sym_size;
 
-	for (size_t i = 0; i < num_relocs; i++) {
+	for (size_t i = start; i < end; i++) {
 		uint64_t r_offset;
 		uint32_t r_sym;
 		uint32_t r_type;
@@ -1663,11 +1921,33 @@ apply_elf_rels(const struct drgn_relocating_section *relocating,
 	return NULL;
 }
 
+/* Number of relocations applied by each task in relocate_elf_file(). */
+#define DRGN_RELOCATION_CHUNK_SIZE 16384
+
+/* Range of relocations in a relocation section applied by one task. */
+struct drgn_relocation_chunk {
+	struct drgn_relocating_section relocating;
+	Elf_Scn *reloc_scn;
+	Elf_Data *reloc_data;
+	Elf_Data *symtab_data;
+	size_t start;
+	size_t end;
+	bool rela;
+};
+
+DEFINE_VECTOR(drgn_relocation_chunk_vector, struct drgn_relocation_chunk)
+
 /*
  * Before the debugging information in a relocatable ELF file (e.g., Linux
  * kernel module) can be used, it must have ELF relocations applied. This is
  * usually done by libdwfl. However, libdwfl is relatively slow at it. This is a
  * much faster implementation.
+ *
+ * The relocation sections are read serially, since libelf isn't thread-safe,
+ * and split into chunks. The chunks are applied as OpenMP tasks. This is
+ * called from within the parallel loop over modules, so threads that have run
+ * out of modules help with the chunks of a large module instead of waiting for
+ * it.
  */
 static struct drgn_error *relocate_elf_file(Elf *elf)
 {
@@ -1696,6 +1976,7 @@ static struct drgn_error *relocate_elf_file(Elf *elf)
 	uint64_t *sh_addrs = calloc(shdrnum, sizeof(sh_addrs[0]));
 	if (!sh_addrs && shdrnum > 0)
 		return &drgn_enomem;
+	struct drgn_relocation_chunk_vector chunks = VECTOR_INIT;
 
 	Elf_Scn *scn = NULL;
 	while ((scn = elf_nextscn(elf, scn))) {
@@ -1770,49 +2051,473 @@ static struct drgn_error *relocate_elf_file(Elf *elf)
 			    (err = read_elf_section(symtab_scn, &symtab_data)))
 				goto out;
 
-			struct drgn_relocating_section relocating = {
-				.buf = data->d_buf,
-				.buf_size = data->d_size,
-				.addr = sh_addrs[elf_ndxscn(scn)],
-				.bswap = drgn_platform_bswap(&platform),
-			};
-
+			size_t reloc_size;
 			if (reloc_shdr->sh_type == SHT_RELA) {
-				err = apply_elf_relas(&relocating, reloc_data,
-						      symtab_data, sh_addrs,
-						      shdrnum, &platform);
+				reloc_size = (drgn_platform_is_64_bit(&platform) ?
+					      sizeof(Elf64_Rela) :
+					      sizeof(Elf32_Rela));
 			} else {
-				err = apply_elf_rels(&relocating, reloc_data,
-						     symtab_data, sh_addrs,
-						     shdrnum, &platform);
+				reloc_size = (drgn_platform_is_64_bit(&platform) ?
+					      sizeof(Elf64_Rel) :
+					      sizeof(Elf32_Rel));
 			}
-			if (err)
-				goto out;
-
+			size_t num_relocs = reloc_data->d_size / reloc_size;
 			/*
-			 * Mark the relocation section as empty so that libdwfl
-			 * doesn't try to apply it again.
+			 * Always add at least one chunk so that the relocation
+			 * section is marked as applied below.
 			 */
-			reloc_shdr->sh_size = 0;
-			if (!gelf_update_shdr(reloc_scn, reloc_shdr)) {
-				err = drgn_error_libelf();
-				goto out;
-			}
-			reloc_data->d_size = 0;
+			size_t start = 0;
+			do {
+				struct drgn_relocation_chunk *chunk =
+					drgn_relocation_chunk_vector_append_entry(&chunks);
+				if (!chunk) {
+					err = &drgn_enomem;
+					goto out;
+				}
+				chunk->relocating = (struct drgn_relocating_section){
+					.buf = data->d_buf,
+					.buf_size = data->d_size,
+					.addr = sh_addrs[elf_ndxscn(scn)],
+					.bswap = drgn_platform_bswap(&platform),
+				};
+				chunk->reloc_scn = reloc_scn;
+				chunk->reloc_data = reloc_data;
+				chunk->symtab_data = symtab_data;
+				chunk->start = start;
+				chunk->end = min(num_relocs,
+						 start + DRGN_RELOCATION_CHUNK_SIZE);
+				chunk->rela = reloc_shdr->sh_type == SHT_RELA;
+				start = chunk->end;
+			} while (start < num_relocs);
 		}
 	}
-	err = NULL;
-out:
-	free(sh_addrs);
-	return err;
-}
-
-static struct drgn_error *
-drgn_debug_info_find_sections(struct drgn_debug_info_module *module)
-{
-	struct drgn_error *err;
+
+	err = NULL;
+	#pragma omp taskloop grainsize(1) shared(err)
+	for (size_t i = 0; i < chunks.size; i++) {
+		if (err)
+			continue;
+		struct drgn_relocation_chunk *chunk = &chunks.data[i];
+		struct drgn_error *chunk_err;
+		if (chunk->rela) {
+			chunk_err = apply_elf_relas(&chunk->relocating,
+						    chunk->reloc_data,
+						    chunk->start, chunk->end,
+						    chunk->symtab_data,
+						    sh_addrs, shdrnum,
+						    &platform);
+		} else {
+			chunk_err = apply_elf_rels(&chunk->relocating,
+						   chunk->reloc_data,
+						   chunk->start, chunk->end,
+						   chunk->symtab_data, sh_addrs,
+						   shdrnum, &platform);
+		}
+		if (chunk_err) {
+			#pragma omp critical(drgn_relocate_elf_file_error)
+			if (err)
+				drgn_error_destroy(chunk_err);
+			else
+				err = chunk_err;
+		}
+	}
+	if (err)
+		goto out;
+
+	for (size_t i = 0; i < chunks.size; i++) {
+		struct drgn_relocation_chunk *chunk = &chunks.data[i];
+		if (chunk->start != 0)
+			continue;
+		/*
+		 * Mark the relocation section as empty so that libdwfl doesn't
+		 * try to apply it again.
+		 */
+		GElf_Shdr *reloc_shdr, reloc_shdr_mem;
+		reloc_shdr = gelf_getshdr(chunk->reloc_scn, &reloc_shdr_mem);
+		if (!reloc_shdr) {
+			err = drgn_error_libelf();
+			goto out;
+		}
+		reloc_shdr->sh_size = 0;
+		if (!gelf_update_shdr(chunk->reloc_scn, reloc_shdr)) {
+			err = drgn_error_libelf();
+			goto out;
+		}
+		chunk->reloc_data->d_size = 0;
+	}
+out:
+	drgn_relocation_chunk_vector_deinit(&chunks);
+	free(sh_addrs);
+	return err;
+}
+
+#if !_ELFUTILS_PREREQ(0, 175)
+static Elf *dwelf_elf_begin(int fd)
+{
+	return elf_begin(fd, ELF_C_READ_MMAP_PRIVATE, NULL);
+}
+#endif
+
+/*
+ * Get the sections of an ELF file with SHF_COMPRESSED set. The returned array
+ * must be freed with free().
+ */
+static struct drgn_error *find_compressed_elf_sections(Elf *elf,
+						       Elf_Scn ***scns_ret,
+						       size_t *num_scns_ret)
+{
+	size_t shdrnum;
+	if (elf_getshdrnum(elf, &shdrnum))
+		return drgn_error_libelf();
+	Elf_Scn **scns = malloc_array(shdrnum, sizeof(scns[0]));
+	if (!scns && shdrnum > 0)
+		return &drgn_enomem;
+	size_t num_scns = 0;
+	Elf_Scn *scn = NULL;
+	while ((scn = elf_nextscn(elf, scn))) {
+		GElf_Shdr shdr_mem, *shdr = gelf_getshdr(scn, &shdr_mem);
+		if (!shdr) {
+			free(scns);
+			return drgn_error_libelf();
+		}
+		if (shdr->sh_flags & SHF_COMPRESSED)
+			scns[num_scns++] = scn;
+	}
+	*scns_ret = scns;
+	*num_scns_ret = num_scns;
+	return NULL;
+}
+
+static void decompress_elf_sections_taskloop(Elf_Scn **scns, size_t num_scns,
+					     struct drgn_error **err)
+{
+	#pragma omp taskloop grainsize(1)
+	for (size_t i = 0; i < num_scns; i++) {
+		if (*err)
+			continue;
+		if (elf_compress(scns[i], 0, 0) < 0) {
+			struct drgn_error *scn_err = drgn_error_libelf();
+			#pragma omp critical(drgn_decompress_elf_sections_error)
+			if (*err)
+				drgn_error_destroy(scn_err);
+			else
+				*err = scn_err;
+		}
+	}
+}
+
+/*
+ * Decompress sections of an ELF file concurrently. Otherwise, libdw
+ * decompresses them one at a time while we hold the dwfl_module_getdwarf()
+ * lock. elf_compress() only modifies the section that it is given.
+ */
+static struct drgn_error *decompress_elf_sections(Elf_Scn **scns,
+						  size_t num_scns)
+{
+	struct drgn_error *err = NULL;
+	if (omp_in_parallel()) {
+		/*
+		 * When we're reading modules in parallel, the other threads in
+		 * the team run the tasks once they run out of modules.
+		 */
+		decompress_elf_sections_taskloop(scns, num_scns, &err);
+	} else {
+		#pragma omp parallel
+		#pragma omp single
+		decompress_elf_sections_taskloop(scns, num_scns, &err);
+	}
+	return err;
+}
+
+/*
+ * Get the path of the file for a build ID in a cache directory:
+ * $dir/$build_id.debug$suffix.
+ */
+static char *
+build_id_cache_path(const char *dir, const void *build_id_,
+		    size_t build_id_len, const char *suffix)
+{
+	size_t dir_len = strlen(dir);
+	size_t suffix_len = strlen(suffix);
+	char *path = malloc(dir_len + 1 + 2 * build_id_len +
+			    sizeof(".debug") - 1 + suffix_len + 1);
+	if (!path)
+		return NULL;
+	char *p = path;
+	memcpy(p, dir, dir_len);
+	p += dir_len;
+	*p++ = '/';
+	const uint8_t *build_id = build_id_;
+	for (size_t i = 0; i < build_id_len; i++) {
+		static const char hex[] = "0123456789abcdef";
+		*p++ = hex[build_id[i] >> 4];
+		*p++ = hex[build_id[i] & 0xf];
+	}
+	memcpy(p, ".debug", sizeof(".debug") - 1);
+	p += sizeof(".debug") - 1;
+	memcpy(p, suffix, suffix_len + 1);
+	return path;
+}
+
+/*
+ * Write the contents of decompressed sections at their new offsets. Under
+ * ELF_F_LAYOUT, elf_update() doesn't write the data that elf_compress()
+ * replaced, so we do it ourselves.
+ */
+static bool write_decompressed_elf_sections(int fd, Elf_Scn **scns,
+					    size_t num_scns)
+{
+	for (size_t i = 0; i < num_scns; i++) {
+		GElf_Shdr shdr_mem, *shdr = gelf_getshdr(scns[i], &shdr_mem);
+		if (!shdr)
+			return false;
+		Elf_Data *data = NULL;
+		while ((data = elf_getdata(scns[i], data))) {
+			const char *buf = data->d_buf;
+			size_t written = 0;
+			while (written < data->d_size) {
+				uint64_t offset =
+					shdr->sh_offset + data->d_off + written;
+				ssize_t r = pwrite(fd, buf + written,
+						   data->d_size - written,
+						   offset);
+				if (r < 0) {
+					if (errno == EINTR)
+						continue;
+					return false;
+				}
+				written += r;
+			}
+		}
+	}
+	return true;
+}
+
+/*
+ * Check that a written copy of an ELF file has the same contents for the given
+ * decompressed sections and that they are no longer compressed, so that a bad
+ * copy never makes it into the cache.
+ */
+static bool verify_decompressed_elf_file(int fd, Elf_Scn **scns,
+					 size_t num_scns)
+{
+	bool ret = false;
+	Elf *elf = elf_begin(fd, ELF_C_READ, NULL);
+	if (!elf)
+		return false;
+	for (size_t i = 0; i < num_scns; i++) {
+		Elf_Scn *scn = elf_getscn(elf, elf_ndxscn(scns[i]));
+		if (!scn)
+			goto out;
+		GElf_Shdr shdr_mem, *shdr = gelf_getshdr(scn, &shdr_mem);
+		if (!shdr || (shdr->sh_flags & SHF_COMPRESSED))
+			goto out;
+		Elf_Data *data = elf_rawdata(scn, NULL);
+		if (!data)
+			goto out;
+		size_t offset = 0;
+		Elf_Data *expected = NULL;
+		while ((expected = elf_getdata(scns[i], expected))) {
+			if (expected->d_off + expected->d_size > data->d_size ||
+			    memcmp((char *)data->d_buf + expected->d_off,
+				   expected->d_buf, expected->d_size) != 0)
+				goto out;
+			offset = expected->d_off + expected->d_size;
+		}
+		if (offset != data->d_size)
+			goto out;
+	}
+	ret = true;
+out:
+	elf_end(elf);
+	return ret;
+}
+
+/*
+ * Write a copy of a module's ELF file with its compressed sections
+ * decompressed to the cache. The decompressed sections are appended to the end
+ * of the file, which is safe because SHF_COMPRESSED can't be used for
+ * allocated sections. This is best-effort, so it doesn't return an error.
+ */
+static void
+drgn_decompressed_cache_write(const char *dir,
+			      struct drgn_debug_info_module *module,
+			      const char *path)
+{
+	size_t size;
+	char *image = elf_rawfile(module->elf, &size);
+	if (!image)
+		return;
+	char *tmp_path = build_id_cache_path(dir, module->build_id,
+					     module->build_id_len, ".XXXXXX");
+	if (!tmp_path)
+		return;
+	if (mkdir(dir, 0777) < 0 && errno != EEXIST)
+		goto out;
+	int fd = mkstemp(tmp_path);
+	if (fd < 0)
+		goto out;
+	size_t written = 0;
+	while (written < size) {
+		ssize_t r = write(fd, image + written, size - written);
+		if (r < 0) {
+			if (errno == EINTR)
+				continue;
+			goto out_fd;
+		}
+		written += r;
+	}
+
+	bool success = false;
+	Elf *elf = elf_begin(fd, ELF_C_RDWR, NULL);
+	if (!elf)
+		goto out_fd;
+	Elf_Scn **scns;
+	size_t num_scns;
+	struct drgn_error *err = find_compressed_elf_sections(elf, &scns,
+							     &num_scns);
+	if (err) {
+		drgn_error_destroy(err);
+		goto out_elf;
+	}
+	err = decompress_elf_sections(scns, num_scns);
+	if (err) {
+		drgn_error_destroy(err);
+		goto out_scns;
+	}
+	/*
+	 * Lay the file out ourselves so that everything else, including the
+	 * program headers, stays where it was.
+	 */
+	elf_flagelf(elf, ELF_C_SET, ELF_F_LAYOUT);
+	uint64_t offset = size;
+	for (size_t i = 0; i < num_scns; i++) {
+		GElf_Shdr shdr_mem, *shdr = gelf_getshdr(scns[i], &shdr_mem);
+		if (!shdr)
+			goto out_scns;
+		uint64_t align = shdr->sh_addralign ? shdr->sh_addralign : 1;
+		offset = (offset + align - 1) / align * align;
+		shdr->sh_offset = offset;
+		if (!gelf_update_shdr(scns[i], shdr))
+			goto out_scns;
+		offset += shdr->sh_size;
+	}
+	success = (elf_update(elf, ELF_C_WRITE) >= 0 &&
+		   write_decompressed_elf_sections(fd, scns, num_scns) &&
+		   verify_decompressed_elf_file(fd, scns, num_scns));
+out_scns:
+	free(scns);
+out_elf:
+	elf_end(elf);
+	if (close(fd) < 0 || !success || rename(tmp_path, path) < 0)
+		unlink(tmp_path);
+	goto out;
+
+out_fd:
+	close(fd);
+	unlink(tmp_path);
+out:
+	free(tmp_path);
+}
+
+/*
+ * Replace a module's ELF file with its cached decompressed copy, writing the
+ * copy first if it doesn't exist yet.
+ *
+ * @return @c true if the module now uses the cached copy, @c false if not.
+ */
+static bool drgn_decompressed_cache_open(const char *dir,
+					 struct drgn_debug_info_module *module)
+{
+	char *path = build_id_cache_path(dir, module->build_id,
+					 module->build_id_len, "");
+	if (!path)
+		return false;
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		drgn_decompressed_cache_write(dir, module, path);
+		fd = open(path, O_RDONLY | O_CLOEXEC);
+	}
+	free(path);
+	if (fd < 0)
+		return false;
+
+	Elf *elf = dwelf_elf_begin(fd);
+	if (!elf)
+		goto err_fd;
+	/*
+	 * Only use the copy if it is for the same file and still has nothing
+	 * to decompress.
+	 */
+	const void *build_id;
+	ssize_t build_id_len = dwelf_elf_gnu_build_id(elf, &build_id);
+	if (build_id_len != module->build_id_len ||
+	    memcmp(build_id, module->build_id, build_id_len) != 0)
+		goto err_elf;
+	Elf_Scn **scns;
+	size_t num_scns;
+	struct drgn_error *err = find_compressed_elf_sections(elf, &scns,
+							     &num_scns);
+	if (err) {
+		drgn_error_destroy(err);
+		goto err_elf;
+	}
+	free(scns);
+	if (num_scns)
+		goto err_elf;
+
+	/* The old build ID points into the old ELF file. */
+	elf_end(module->elf);
+	if (module->fd != -1)
+		close(module->fd);
+	module->elf = elf;
+	module->fd = fd;
+	module->build_id = build_id;
+	return true;
+
+err_elf:
+	elf_end(elf);
+err_fd:
+	close(fd);
+	return false;
+}
+
+/*
+ * Decompress the compressed sections of a module's ELF file, using the cache
+ * of decompressed files in the directory from the
+ * `DRGN_DECOMPRESSED_DEBUG_INFO_CACHE_DIR` environment variable if it is set.
+ */
+static struct drgn_error *
+drgn_debug_info_module_decompress(struct drgn_debug_info_module *module)
+{
+	Elf_Scn **scns;
+	size_t num_scns;
+	struct drgn_error *err = find_compressed_elf_sections(module->elf,
+							     &scns, &num_scns);
+	if (err)
+		return err;
+	if (num_scns == 0)
+		goto out;
+
+	const char *dir = getenv("DRGN_DECOMPRESSED_DEBUG_INFO_CACHE_DIR");
+	if (dir && dir[0] && module->build_id_len &&
+	    drgn_decompressed_cache_open(dir, module))
+		goto out;
+	err = decompress_elf_sections(scns, num_scns);
+out:
+	free(scns);
+	return err;
+}
+
+static struct drgn_error *
+drgn_debug_info_find_sections(struct drgn_debug_info_module *module)
+{
+	struct drgn_error *err;
 
 	if (module->elf) {
+		err = drgn_debug_info_module_decompress(module);
+		if (err)
+			return err;
 		err = relocate_elf_file(module->elf);
 		if (err)
 			return err;
@@ -1955,6 +2660,264 @@ drgn_debug_info_module_cache_section(struct drgn_debug_info_module *module,
 	return read_elf_section(module->scns[scn], &module->scn_data[scn]);
 }
 
+/*
+ * Give the kernel advice about the pages entirely within a section so that we
+ * don't affect neighboring data.
+ */
+static void advise_elf_data(Elf_Data *data, uintptr_t page_mask, int advice)
+{
+	if (!data || !data->d_buf)
+		return;
+	uintptr_t start = ((uintptr_t)data->d_buf + ~page_mask) & page_mask;
+	uintptr_t end = ((uintptr_t)data->d_buf + data->d_size) & page_mask;
+	if (start < end)
+		madvise((void *)start, end - start, advice);
+}
+
+/*
+ * Start reading the sections that indexing reads from beginning to end so that
+ * the I/O overlaps with parsing.
+ *
+ * elf_rawdata() doesn't copy or convert sections, so for files that are mapped
+ * (which is how we and libdwfl open them), the data points straight into the
+ * file mapping. This only populates the page cache, so the pages are still
+ * shared with other processes and can be reclaimed. Sections that are only
+ * read where DIEs point to, including .debug_info when it has a name index,
+ * are left to be faulted in lazily.
+ */
+static void
+drgn_debug_info_module_prefetch_sections(struct drgn_debug_info_module *module)
+{
+	uintptr_t page_mask = ~(uintptr_t)(sysconf(_SC_PAGESIZE) - 1);
+	advise_elf_data(module->scn_data[DRGN_SCN_DEBUG_ABBREV], page_mask,
+			MADV_WILLNEED);
+	if (module->scn_data[DRGN_SCN_DEBUG_NAMES]) {
+		advise_elf_data(module->scn_data[DRGN_SCN_DEBUG_NAMES],
+				page_mask, MADV_WILLNEED);
+	} else {
+		advise_elf_data(module->scn_data[DRGN_SCN_DEBUG_INFO],
+				page_mask, MADV_WILLNEED);
+		advise_elf_data(module->scn_data[DRGN_SCN_DEBUG_TYPES],
+				page_mask, MADV_WILLNEED);
+	}
+}
+
+void
+drgn_debug_info_module_evict_sections(struct drgn_debug_info_module *module)
+{
+#ifdef MADV_PAGEOUT
+	/*
+	 * Unlike MADV_DONTNEED, MADV_PAGEOUT preserves the contents of private
+	 * and anonymous pages (e.g., relocated or decompressed sections), so
+	 * this is safe no matter how the section was read.
+	 */
+	uintptr_t page_mask = ~(uintptr_t)(sysconf(_SC_PAGESIZE) - 1);
+	for (size_t i = 0; i < DRGN_NUM_DEBUG_SCN_DATA_PRECACHE; i++)
+		advise_elf_data(module->scn_data[i], page_mask, MADV_PAGEOUT);
+	advise_elf_data(module->alt_debug_info_data, page_mask, MADV_PAGEOUT);
+	advise_elf_data(module->alt_debug_str_data, page_mask, MADV_PAGEOUT);
+#endif
+}
+
+/* Debugging information file fetched for a module that is missing it. */
+struct drgn_debug_file_fetch {
+	/*
+	 * First file reported for the module. This is only valid until the
+	 * modules that weren't indexed are freed.
+	 */
+	struct drgn_debug_info_module *module;
+	void *build_id;
+	size_t build_id_len;
+	uint64_t start, end;
+	char *name;
+	/* Fetched file, or NULL if it wasn't found or there was an error. */
+	char *path;
+	struct drgn_error *err;
+};
+
+DEFINE_VECTOR_FUNCTIONS(drgn_debug_file_fetch_vector)
+
+static void drgn_debug_file_fetch_destroy(struct drgn_debug_file_fetch *fetch)
+{
+	if (fetch) {
+		drgn_error_destroy(fetch->err);
+		free(fetch->path);
+		free(fetch->name);
+		free(fetch->build_id);
+		free(fetch);
+	}
+}
+
+static void
+drgn_debug_file_fetch_vector_clear(struct drgn_debug_file_fetch_vector *fetches)
+{
+	for (size_t i = 0; i < fetches->size; i++)
+		drgn_debug_file_fetch_destroy(fetches->data[i]);
+	fetches->size = 0;
+}
+
+/*
+ * Save a fetched file in the cache, preferably as a hard link. This is
+ * best-effort.
+ *
+ * @return Whether the file is now in the cache.
+ */
+static bool
+drgn_debug_file_cache_write(const struct drgn_debug_file_fetch *fetch,
+			    const char *dir, const char *src_path,
+			    const char *path)
+{
+	if (mkdir(dir, 0777) < 0 && errno != EEXIST)
+		return false;
+	if (link(src_path, path) == 0 || errno == EEXIST)
+		return true;
+
+	bool success = false;
+	int src_fd = open(src_path, O_RDONLY);
+	if (src_fd < 0)
+		return false;
+	char *tmp_path = build_id_cache_path(dir, fetch->build_id,
+					     fetch->build_id_len, ".XXXXXX");
+	if (!tmp_path)
+		goto out_src_fd;
+	int fd = mkstemp(tmp_path);
+	if (fd < 0)
+		goto out_tmp_path;
+	char buf[64 * 1024];
+	for (;;) {
+		ssize_t r = read(src_fd, buf, sizeof(buf));
+		if (r < 0) {
+			if (errno == EINTR)
+				continue;
+			goto out_fd;
+		}
+		if (r == 0)
+			break;
+		size_t written = 0;
+		while (written < r) {
+			ssize_t w = write(fd, buf + written, r - written);
+			if (w < 0) {
+				if (errno == EINTR)
+					continue;
+				goto out_fd;
+			}
+			written += w;
+		}
+	}
+	success = true;
+out_fd:
+	if (close(fd) < 0 || !success || rename(tmp_path, path) < 0) {
+		unlink(tmp_path);
+		success = false;
+	}
+out_tmp_path:
+	free(tmp_path);
+out_src_fd:
+	close(src_fd);
+	return success;
+}
+
+/*
+ * Fetch a missing debugging information file, using the cache in the directory
+ * from the `DRGN_DEBUG_FILE_CACHE_DIR` environment variable if it is set. This
+ * only calls the fetcher, so it can run concurrently with indexing.
+ */
+static void drgn_debug_file_fetch(struct drgn_program *prog,
+				  struct drgn_debug_file_fetch *fetch)
+{
+	const char *dir = getenv("DRGN_DEBUG_FILE_CACHE_DIR");
+	char *cache_path = NULL;
+	if (dir && dir[0]) {
+		cache_path = build_id_cache_path(dir, fetch->build_id,
+						 fetch->build_id_len, "");
+		if (cache_path && access(cache_path, R_OK) == 0) {
+			fetch->path = cache_path;
+			return;
+		}
+	}
+
+	char *path = NULL;
+	fetch->err = prog->debug_file_fetch_fn(fetch->build_id,
+					       fetch->build_id_len,
+					       prog->debug_file_fetch_arg,
+					       &path);
+	if (fetch->err) {
+		free(path);
+	} else if (path && cache_path &&
+		   drgn_debug_file_cache_write(fetch, dir, path, cache_path)) {
+		free(path);
+		fetch->path = cache_path;
+		return;
+	} else {
+		fetch->path = path;
+	}
+	free(cache_path);
+}
+
+/*
+ * Start fetching the debugging information for a module that doesn't have any.
+ * The fetch runs as an OpenMP task, so it overlaps with indexing other modules
+ * and is done by the end of the enclosing parallel region.
+ */
+static struct drgn_error *
+drgn_debug_info_start_fetch(struct drgn_debug_info_load_state *load,
+			    struct drgn_debug_info_module *head)
+{
+	struct drgn_debug_file_fetch *fetch = calloc(1, sizeof(*fetch));
+	if (!fetch)
+		return &drgn_enomem;
+	fetch->module = head;
+	fetch->build_id = memdup(head->build_id, head->build_id_len);
+	fetch->build_id_len = head->build_id_len;
+	fetch->start = head->start;
+	fetch->end = head->end;
+	if (head->name)
+		fetch->name = strdup(head->name);
+	if (!fetch->build_id || (head->name && !fetch->name)) {
+		drgn_debug_file_fetch_destroy(fetch);
+		return &drgn_enomem;
+	}
+
+	bool appended;
+	#pragma omp critical(drgn_debug_info_start_fetch)
+	appended = drgn_debug_file_fetch_vector_append(&load->fetches, &fetch);
+	if (!appended) {
+		drgn_debug_file_fetch_destroy(fetch);
+		return &drgn_enomem;
+	}
+
+	struct drgn_program *prog = load->dbinfo->prog;
+	#pragma omp task
+	drgn_debug_file_fetch(prog, fetch);
+	return NULL;
+}
+
+/* Report why none of the files of a module have debugging information. */
+static struct drgn_error *
+drgn_debug_info_report_module_errors(struct drgn_debug_info_load_state *load,
+				     struct drgn_debug_info_module *head)
+{
+	struct drgn_error *err = NULL;
+	for (struct drgn_debug_info_module *module = head; module;
+	     module = module->next) {
+		const char *name =
+			dwfl_module_info(module->dwfl_module, NULL, NULL, NULL,
+					 NULL, NULL, NULL, NULL);
+		if (module->err) {
+			err = drgn_debug_info_report_error(load, name, NULL,
+							   module->err);
+			module->err = NULL;
+		} else {
+			err = drgn_debug_info_report_error(load, name,
+							   "no debugging information",
+							   NULL);
+		}
+		if (err)
+			break;
+	}
+	return err;
+}
+
 static struct drgn_error *
 drgn_debug_info_read_module(struct drgn_debug_info_load_state *load,
 			    struct drgn_dwarf_index_state *index,
@@ -1962,6 +2925,11 @@ drgn_debug_info_read_module(struct drgn_debug_info_load_state *load,
 {
 	struct drgn_error *err;
 	struct drgn_debug_info_module *module;
+	if (head->pinned) {
+		/* Unloaded modules already have their sections cached. */
+		head->state = DRGN_DEBUG_INFO_MODULE_INDEXING;
+		return drgn_dwarf_index_read_module(index, head);
+	}
 	for (module = head; module; module = module->next) {
 		err = drgn_debug_info_find_sections(module);
 		if (err) {
@@ -1975,6 +2943,7 @@ drgn_debug_info_read_module(struct drgn_debug_info_load_state *load,
 				module->err = err;
 				continue;
 			}
+			drgn_debug_info_module_prefetch_sections(module);
 			module->state = DRGN_DEBUG_INFO_MODULE_INDEXING;
 			return drgn_dwarf_index_read_module(index,
 							    module);
@@ -1982,29 +2951,121 @@ drgn_debug_info_read_module(struct drgn_debug_info_load_state *load,
 	}
 	/*
 	 * We checked all of the files and didn't find debugging information.
-	 * Report why for each one.
+	 * If we can fetch it, do that while other modules are indexed, and
+	 * only report errors if that doesn't work. Otherwise, report why for
+	 * each file now.
 	 *
 	 * (If we did find debugging information, we discard errors on the
 	 * unused files.)
 	 */
-	err = NULL;
+	if (load->fetch_debug_files && head->build_id_len)
+		return drgn_debug_info_start_fetch(load, head);
 	#pragma omp critical(drgn_debug_info_read_module_error)
-	for (module = head; module; module = module->next) {
-		const char *name =
-			dwfl_module_info(module->dwfl_module, NULL, NULL, NULL,
-					 NULL, NULL, NULL, NULL);
-		if (module->err) {
-			err = drgn_debug_info_report_error(load, name, NULL,
-							   module->err);
-			module->err = NULL;
-		} else {
+	err = drgn_debug_info_report_module_errors(load, head);
+	return err;
+}
+
+/*
+ * Report errors for the modules that we couldn't fetch debugging information
+ * for. This must be called before the modules that weren't indexed are freed.
+ */
+static struct drgn_error *
+drgn_debug_info_report_fetch_errors(struct drgn_debug_info_load_state *load,
+				    struct drgn_debug_file_fetch_vector *fetches)
+{
+	struct drgn_error *err;
+	for (size_t i = 0; i < fetches->size; i++) {
+		struct drgn_debug_file_fetch *fetch = fetches->data[i];
+		struct drgn_debug_info_module *module = fetch->module;
+		if (fetch->path)
+			continue;
+		if (fetch->err) {
+			const char *name =
+				dwfl_module_info(module->dwfl_module, NULL,
+						 NULL, NULL, NULL, NULL, NULL,
+						 NULL);
 			err = drgn_debug_info_report_error(load, name,
-							   "no debugging information",
-							   NULL);
+							   "could not fetch debugging information",
+							   fetch->err);
+			fetch->err = NULL;
+		} else {
+			err = drgn_debug_info_report_module_errors(load,
+								   module);
 		}
 		if (err)
+			return err;
+	}
+	return NULL;
+}
+
+static struct drgn_error *
+drgn_debug_info_report_fetched_file(struct drgn_debug_info_load_state *load,
+				    struct drgn_debug_file_fetch *fetch)
+{
+	struct drgn_program *prog = load->dbinfo->prog;
+	struct drgn_error *err;
+
+	int fd;
+	Elf *elf;
+	err = open_elf_file(fetch->path, &fd, &elf);
+	if (err)
+		return drgn_debug_info_report_error(load, fetch->path, NULL,
+						    err);
+	if ((prog->flags & DRGN_PROGRAM_IS_LINUX_KERNEL) && fetch->name) {
+		err = linux_kernel_cache_fetched_module_sections(prog,
+								 fetch->name,
+								 elf);
+		if (err) {
+			elf_end(elf);
+			close(fd);
+			return drgn_debug_info_report_error(load, fetch->path,
+							    "could not get section addresses",
+							    err);
+		}
+	}
+	return drgn_debug_info_report_elf(load, fetch->path, fd, elf,
+					  fetch->start, fetch->end, fetch->name,
+					  NULL);
+}
+
+static struct drgn_error *
+drgn_debug_info_update_index(struct drgn_debug_info_load_state *load);
+
+/* Report and index the fetched debugging information files. */
+static struct drgn_error *
+drgn_debug_info_report_fetched(struct drgn_debug_info_load_state *load,
+			       struct drgn_debug_file_fetch_vector *fetches)
+{
+	struct drgn_debug_info *dbinfo = load->dbinfo;
+	struct drgn_error *err = NULL;
+
+	size_t i;
+	for (i = 0; i < fetches->size; i++) {
+		if (fetches->data[i]->path)
 			break;
 	}
+	if (i == fetches->size)
+		return NULL;
+
+	/* The modules from the first round have been indexed or freed. */
+	load->new_modules.size = 0;
+	dwfl_report_begin_add(dbinfo->dwfl);
+	for (; i < fetches->size; i++) {
+		struct drgn_debug_file_fetch *fetch = fetches->data[i];
+		if (fetch->path) {
+			err = drgn_debug_info_report_fetched_file(load, fetch);
+			if (err)
+				break;
+		}
+	}
+	my_dwfl_report_end(dbinfo, NULL, NULL);
+	if (err)
+		return err;
+
+	/* Don't fetch again for the files that we just fetched. */
+	load->fetch_debug_files = false;
+	err = drgn_debug_info_update_index(load);
+	load->fetch_debug_files = true;
 	return err;
 }
 
@@ -2023,8 +3084,11 @@ drgn_debug_info_update_index(struct drgn_debug_info_load_state *load)
 	if (!drgn_dwarf_index_state_init(&index, dbinfo))
 		return &drgn_enomem;
 	struct drgn_error *err = NULL;
-	#pragma omp parallel for schedule(dynamic)
+	uint64_t start_time = monotonic_ns();
+	#pragma omp parallel for schedule(dynamic) \
+		num_threads(drgn_program_num_parallel_threads(dbinfo->prog))
 	for (size_t i = 0; i < load->new_modules.size; i++) {
+		drgn_program_bind_parallel_thread(dbinfo->prog);
 		if (err)
 			continue;
 		struct drgn_error *module_err =
@@ -2038,11 +3102,25 @@ drgn_debug_info_update_index(struct drgn_debug_info_load_state *load)
 				err = module_err;
 		}
 	}
+	dbinfo->timings.read_modules += monotonic_ns() - start_time;
+	/*
+	 * The fetches are done by the implicit barrier at the end of the
+	 * parallel loop. Take them so that indexing the fetched files starts
+	 * with none.
+	 */
+	struct drgn_debug_file_fetch_vector fetches = load->fetches;
+	load->fetches = (struct drgn_debug_file_fetch_vector)VECTOR_INIT;
+	if (!err)
+		err = drgn_debug_info_report_fetch_errors(load, &fetches);
 	if (!err)
 		err = drgn_dwarf_info_update_index(&index);
 	drgn_dwarf_index_state_deinit(&index);
-	if (!err)
+	if (!err) {
 		drgn_debug_info_free_modules(dbinfo, true, false);
+		err = drgn_debug_info_report_fetched(load, &fetches);
+	}
+	drgn_debug_file_fetch_vector_clear(&fetches);
+	drgn_debug_file_fetch_vector_deinit(&fetches);
 	return err;
 }
 
@@ -2095,6 +3173,8 @@ struct drgn_error *drgn_debug_info_load(struct drgn_debug_info *dbinfo,
 		.load_default = load_default,
 		.load_main = load_main,
 		.new_modules = VECTOR_INIT,
+		.fetch_debug_files = prog->debug_file_fetch_fn != NULL,
+		.fetches = VECTOR_INIT,
 		.max_errors = max_errors ? atoi(max_errors) : 5,
 	};
 	dwfl_report_begin_add(dbinfo->dwfl);
@@ -2148,6 +3228,83 @@ bool drgn_debug_info_is_indexed(struct drgn_debug_info *dbinfo,
 	return c_string_set_search(&dbinfo->module_names, &name).entry != NULL;
 }
 
+struct drgn_debug_info_unload_arg {
+	const char *name;
+	struct drgn_debug_info_module_vector modules;
+};
+
+static int drgn_debug_info_find_unload_module(Dwfl_Module *dwfl_module,
+					      void **userdatap,
+					      const char *name,
+					      Dwarf_Addr base, void *_arg)
+{
+	struct drgn_debug_info_unload_arg *arg = _arg;
+	struct drgn_debug_info_module *module = *userdatap;
+	if (module && module->state == DRGN_DEBUG_INFO_MODULE_INDEXED &&
+	    module->name && strcmp(module->name, arg->name) == 0 &&
+	    !drgn_debug_info_module_vector_append(&arg->modules, &module))
+		return DWARF_CB_ABORT;
+	return DWARF_CB_OK;
+}
+
+struct drgn_error *drgn_debug_info_unload(struct drgn_debug_info *dbinfo,
+					  const char *name)
+{
+	struct drgn_error *err;
+	struct drgn_debug_info_unload_arg arg = {
+		.name = name,
+		.modules = VECTOR_INIT,
+	};
+	if (dwfl_getmodules(dbinfo->dwfl, drgn_debug_info_find_unload_module,
+			    &arg, 0)) {
+		err = &drgn_enomem;
+		goto out;
+	}
+	if (!arg.modules.size) {
+		err = drgn_error_format(DRGN_ERROR_LOOKUP,
+					"debugging information for '%s' is not loaded",
+					name);
+		goto out;
+	}
+
+	for (size_t i = 0; i < arg.modules.size; i++)
+		arg.modules.data[i]->state = DRGN_DEBUG_INFO_MODULE_UNLOADED;
+	err = drgn_dwarf_info_rebuild_index(dbinfo);
+	if (err) {
+		for (size_t i = 0; i < arg.modules.size; i++) {
+			arg.modules.data[i]->state =
+				DRGN_DEBUG_INFO_MODULE_INDEXED;
+		}
+		goto out;
+	}
+
+	c_string_set_delete(&dbinfo->module_names, &name);
+	for (size_t i = 0; i < arg.modules.size; i++) {
+		struct drgn_debug_info_module *module = arg.modules.data[i];
+		module->pinned = true;
+		/*
+		 * The unwinding tables are only needed when the module is
+		 * indexed, so free them. They are parsed again if the module
+		 * is loaded again.
+		 */
+		drgn_orc_module_info_deinit(module);
+		memset(&module->orc, 0, sizeof(module->orc));
+		module->parsed_orc = false;
+		drgn_dwarf_module_info_deinit(module);
+		memset(&module->dwarf, 0, sizeof(module->dwarf));
+		module->parsed_frames = false;
+		/*
+		 * The sections may still be referenced, so they can't be freed,
+		 * but the kernel can reclaim their pages.
+		 */
+		drgn_debug_info_module_evict_sections(module);
+	}
+	err = NULL;
+out:
+	drgn_debug_info_module_vector_deinit(&arg.modules);
+	return err;
+}
+
 struct drgn_error *drgn_debug_info_create(struct drgn_program *prog,
 					  struct drgn_debug_info **ret)
 {
@@ -2170,6 +3327,8 @@ struct drgn_error *drgn_debug_info_create(struct drgn_program *prog,
 	drgn_debug_info_module_table_init(&dbinfo->modules);
 	c_string_set_init(&dbinfo->module_names);
 	drgn_dwarf_info_init(dbinfo);
+	drgn_symbol_index_init(&dbinfo->symbols);
+	memset(&dbinfo->timings, 0, sizeof(dbinfo->timings));
 	*ret = dbinfo;
 	return NULL;
 }
@@ -2183,6 +3342,7 @@ void drgn_debug_info_destroy(struct drgn_debug_info *dbinfo)
 	drgn_debug_info_free_modules(dbinfo, false, true);
 	assert(drgn_debug_info_module_table_empty(&dbinfo->modules));
 	drgn_debug_info_module_table_deinit(&dbinfo->modules);
+	drgn_symbol_index_deinit(&dbinfo->symbols);
 	dwfl_end(dbinfo->dwfl);
 	free(dbinfo);
 }
@@ -2202,33 +3362,30 @@ drgn_debug_info_module_find_cfi(struct drgn_program *prog,
 	uint64_t unbiased_pc = pc - bias;
 
 	if (prog->prefer_orc_unwinder) {
+		prog->stats.orc_lookups++;
 		err = drgn_debug_info_find_orc_cfi(module, unbiased_pc, row_ret,
 						   interrupted_ret,
 						   ret_addr_regno_ret);
 		if (err != &drgn_not_found)
 			return err;
+		prog->stats.dwarf_cfi_lookups++;
 		return drgn_debug_info_find_dwarf_cfi(module, unbiased_pc,
 						      row_ret, interrupted_ret,
 						      ret_addr_regno_ret);
 	} else {
+		prog->stats.dwarf_cfi_lookups++;
 		err = drgn_debug_info_find_dwarf_cfi(module, unbiased_pc,
 						     row_ret, interrupted_ret,
 						     ret_addr_regno_ret);
 		if (err != &drgn_not_found)
 			return err;
+		prog->stats.orc_lookups++;
 		return drgn_debug_info_find_orc_cfi(module, unbiased_pc,
 						    row_ret, interrupted_ret,
 						    ret_addr_regno_ret);
 	}
 }
 
-#if !_ELFUTILS_PREREQ(0, 175)
-static Elf *dwelf_elf_begin(int fd)
-{
-	return elf_begin(fd, ELF_C_READ_MMAP_PRIVATE, NULL);
-}
-#endif
-
 struct drgn_error *open_elf_file(const char *path, int *fd_ret, Elf **elf_ret)
 {
 	struct drgn_error *err;
@@ -24,6 +24,7 @@
 #include "orc_info.h"
 #include "platform.h"
 #include "string_builder.h"
+#include "symbol_index.h"
 #include "vector.h"
 
 /**
@@ -47,6 +48,11 @@ enum drgn_debug_info_module_state {
 	DRGN_DEBUG_INFO_MODULE_INDEXING,
 	/** Indexed. Must not be freed until @ref drgn_debug_info_destroy(). */
 	DRGN_DEBUG_INFO_MODULE_INDEXED,
+	/**
+	 * Indexed and then unloaded by @ref drgn_debug_info_unload(). Must not
+	 * be freed until @ref drgn_debug_info_destroy().
+	 */
+	DRGN_DEBUG_INFO_MODULE_UNLOADED,
 } __attribute__((__packed__));
 
 enum drgn_debug_info_scn {
@@ -58,6 +64,7 @@ enum drgn_debug_info_scn {
 	DRGN_SCN_DEBUG_STR_OFFSETS,
 	DRGN_SCN_DEBUG_LINE,
 	DRGN_SCN_DEBUG_LINE_STR,
+	DRGN_SCN_DEBUG_NAMES,
 
 	DRGN_NUM_DEBUG_SCN_DATA_PRECACHE,
 
@@ -65,6 +72,7 @@ enum drgn_debug_info_scn {
 	DRGN_SCN_DEBUG_ADDR = DRGN_NUM_DEBUG_SCN_DATA_PRECACHE,
 	DRGN_SCN_DEBUG_FRAME,
 	DRGN_SCN_EH_FRAME,
+	DRGN_SCN_EH_FRAME_HDR,
 	DRGN_SCN_ORC_UNWIND_IP,
 	DRGN_SCN_ORC_UNWIND,
 	DRGN_SCN_DEBUG_LOC,
@@ -116,6 +124,14 @@ struct drgn_debug_info_module {
 	bool parsed_frames;
 	/** Whether ORC unwinder data has been parsed. */
 	bool parsed_orc;
+	/**
+	 * Whether this module's debugging information has ever been unloaded.
+	 *
+	 * Types, symbols, and stack frames may point into the ELF file of an
+	 * unloaded module, so it stays open, and its sections stay cached so
+	 * that it can be indexed again without reading it again.
+	 */
+	bool pinned;
 
 	/*
 	 * path, elf, and fd are used when an ELF file was reported with
@@ -143,6 +159,16 @@ struct drgn_error *
 drgn_debug_info_module_cache_section(struct drgn_debug_info_module *module,
 				     enum drgn_debug_info_scn scn);
 
+/**
+ * Ask the kernel to evict the pages of the sections cached by @ref
+ * drgn_debug_info_module_cache_section() for indexing.
+ *
+ * The sections remain valid and are read back in on demand. This is only a
+ * hint, so it doesn't return an error.
+ */
+void
+drgn_debug_info_module_evict_sections(struct drgn_debug_info_module *module);
+
 struct drgn_error *
 drgn_error_debug_info_scn(struct drgn_debug_info_module *module,
 			  enum drgn_debug_info_scn scn, const char *ptr,
@@ -176,6 +202,25 @@ DEFINE_HASH_TABLE_TYPE(drgn_debug_info_module_table,
 
 DEFINE_HASH_SET_TYPE(c_string_set, const char *)
 
+/**
+ * Cumulative wall clock time spent in each phase of loading debugging
+ * information, in nanoseconds. This is only used for benchmarking.
+ */
+struct drgn_debug_info_timings {
+	/**
+	 * Finding, decompressing, relocating, and reading the sections of new
+	 * modules. These are done per module in one parallel loop, so they are
+	 * timed together.
+	 */
+	uint64_t read_modules;
+	/** First DWARF indexing pass (abbreviation tables and file names). */
+	uint64_t first_pass;
+	/** Second DWARF indexing pass (adding DIEs to the index). */
+	uint64_t second_pass;
+	/** Indexing `.debug_names` sections. */
+	uint64_t debug_names;
+};
+
 /** Cache of debugging information. */
 struct drgn_debug_info {
 	/** Program owning this cache. */
@@ -194,6 +239,10 @@ struct drgn_debug_info {
 	struct c_string_set module_names;
 	/** DWARF debugging information. */
 	struct drgn_dwarf_info dwarf;
+	/** Index of ELF symbol tables, built on the first symbol search. */
+	struct drgn_symbol_index symbols;
+	/** Time spent loading debugging information. */
+	struct drgn_debug_info_timings timings;
 };
 
 /** Create a @ref drgn_debug_info. */
@@ -206,6 +255,11 @@ void drgn_debug_info_destroy(struct drgn_debug_info *dbinfo);
 DEFINE_VECTOR_TYPE(drgn_debug_info_module_vector,
 		   struct drgn_debug_info_module *)
 
+struct drgn_debug_file_fetch;
+
+DEFINE_VECTOR_TYPE(drgn_debug_file_fetch_vector,
+		   struct drgn_debug_file_fetch *)
+
 /** State tracked while loading debugging information. */
 struct drgn_debug_info_load_state {
 	struct drgn_debug_info * const dbinfo;
@@ -215,6 +269,13 @@ struct drgn_debug_info_load_state {
 	const bool load_main;
 	/** Newly added modules to be indexed. */
 	struct drgn_debug_info_module_vector new_modules;
+	/**
+	 * Whether to fetch missing debugging information files with @ref
+	 * drgn_program::debug_file_fetch_fn.
+	 */
+	bool fetch_debug_files;
+	/** Fetches started while indexing @ref new_modules. */
+	struct drgn_debug_file_fetch_vector fetches;
 	/** Formatted errors reported by @ref drgn_debug_info_report_error(). */
 	struct string_builder errors;
 	/** Number of errors reported by @ref drgn_debug_info_report_error(). */
@@ -257,7 +318,7 @@ drgn_debug_info_report_error(struct drgn_debug_info_load_state *load,
  * @param[in] end The (exclusive) end address of the loaded file, or 0 if the
  * file is not loaded.
  * @param[in] name An optional name for the module. This is only used for @ref
- * drgn_debug_info_is_indexed().
+ * drgn_debug_info_is_indexed() and @ref drgn_debug_info_unload().
  * @param[out] new_ret Whether the module was newly created and reported. This
  * is @c false if a module with the same build ID and address range was already
  * loaded or a file with the same path and address range was already reported.
@@ -287,6 +348,16 @@ struct drgn_error *drgn_debug_info_load(struct drgn_debug_info *dbinfo,
 bool drgn_debug_info_is_indexed(struct drgn_debug_info *dbinfo,
 				const char *name);
 
+/**
+ * Unload the debugging information of the indexed modules with the given name.
+ *
+ * This removes the modules' DIEs from the DWARF index and frees their parsed
+ * call frame information and ORC unwinder data. See @ref
+ * drgn_program_unload_debug_info().
+ */
+struct drgn_error *drgn_debug_info_unload(struct drgn_debug_info *dbinfo,
+					  const char *name);
+
 /**
  * Get the language of the program's `main` function or `NULL` if it could not
  * be found.
@@ -301,6 +372,22 @@ struct drgn_error *drgn_debug_info_find_type(enum drgn_type_kind kind,
 					     const char *filename, void *arg,
 					     struct drgn_qualified_type *ret);
 
+/**
+ * Create a type for every DIE of the given kinds in the global namespace of the
+ * DWARF index.
+ *
+ * This indexes any deferred DWARF first.
+ *
+ * @param[in] kinds Bitmask of `1 << kind` for each @ref drgn_type_kind to get.
+ * Only the named kinds that are indexed are supported: integer, boolean,
+ * floating-point, structure, union, class, enumerated, and typedef types.
+ * @param[in,out] ret Vector to append the types to.
+ */
+struct drgn_typep_vector;
+struct drgn_error *drgn_debug_info_types(struct drgn_debug_info *dbinfo,
+					 uint64_t kinds,
+					 struct drgn_typep_vector *ret);
+
 /** @ref drgn_object_find_fn() that uses debugging information. */
 struct drgn_error *
 drgn_debug_info_find_object(const char *name, size_t name_len,
@@ -0,0 +1,319 @@
+// Copyright (c) Meta Platforms, Inc. and affiliates.
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <assert.h>
+#include <dwarf.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "debug_info.h"
+#include "dwarf_index_cache.h"
+#include "util.h"
+
+/*
+ * A cache file consists of a struct drgn_dwarf_index_cache_header, followed by
+ * the build ID padded to a multiple of 8 bytes, followed by the array of
+ * struct drgn_dwarf_index_cache_die, followed by the array of struct
+ * drgn_dwarf_index_cache_specification. Everything is in host byte order; the
+ * cache is only meant to be shared between processes on the same machine.
+ */
+
+static const char drgn_dwarf_index_cache_magic[8] = "DRGNDIDX";
+
+/*
+ * This must be incremented whenever the file format or the contents of the
+ * index change.
+ */
+static const uint32_t DRGN_DWARF_INDEX_CACHE_VERSION = 1;
+
+struct drgn_dwarf_index_cache_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t build_id_len;
+	/*
+	 * Sizes of the sections that offsets are relative to. This guards
+	 * against reusing a cache file for different debugging information with
+	 * the same build ID (e.g., a stripped file).
+	 */
+	uint64_t scn_sizes[DRGN_DWARF_INDEX_CACHE_NUM_SCNS];
+	uint64_t num_dies;
+	uint64_t num_specifications;
+};
+
+static_assert(sizeof(struct drgn_dwarf_index_cache_header) % 8 == 0,
+	      "DWARF index cache header is misaligned");
+static_assert(sizeof(struct drgn_dwarf_index_cache_die) % 8 == 0,
+	      "DWARF index cache DIE is misaligned");
+static_assert(sizeof(struct drgn_dwarf_index_cache_specification) % 8 == 0,
+	      "DWARF index cache specification is misaligned");
+
+static Elf_Data *
+drgn_dwarf_index_cache_scn_data(struct drgn_debug_info_module *module,
+				enum drgn_dwarf_index_cache_scn scn)
+{
+	switch (scn) {
+	case DRGN_DWARF_INDEX_CACHE_SCN_DEBUG_INFO:
+		return module->scn_data[DRGN_SCN_DEBUG_INFO];
+	case DRGN_DWARF_INDEX_CACHE_SCN_DEBUG_TYPES:
+		return module->scn_data[DRGN_SCN_DEBUG_TYPES];
+	case DRGN_DWARF_INDEX_CACHE_SCN_DEBUG_STR:
+		return module->scn_data[DRGN_SCN_DEBUG_STR];
+	case DRGN_DWARF_INDEX_CACHE_SCN_ALT_DEBUG_INFO:
+		return module->alt_debug_info_data;
+	case DRGN_DWARF_INDEX_CACHE_SCN_ALT_DEBUG_STR:
+		return module->alt_debug_str_data;
+	default:
+		return NULL;
+	}
+}
+
+bool drgn_dwarf_index_cache_encode(struct drgn_debug_info_module *module,
+				   const char *ptr,
+				   enum drgn_dwarf_index_cache_scn *scn_ret,
+				   uint64_t *offset_ret)
+{
+	for (int i = 0; i < DRGN_DWARF_INDEX_CACHE_NUM_SCNS; i++) {
+		Elf_Data *data = drgn_dwarf_index_cache_scn_data(module, i);
+		if (!data || !data->d_buf)
+			continue;
+		const char *start = data->d_buf;
+		if (ptr >= start && ptr < start + data->d_size) {
+			*scn_ret = i;
+			*offset_ret = ptr - start;
+			return true;
+		}
+	}
+	return false;
+}
+
+const char *drgn_dwarf_index_cache_decode(struct drgn_debug_info_module *module,
+					  enum drgn_dwarf_index_cache_scn scn,
+					  uint64_t offset)
+{
+	Elf_Data *data = drgn_dwarf_index_cache_scn_data(module, scn);
+	if (!data || !data->d_buf || offset >= data->d_size)
+		return NULL;
+	return (const char *)data->d_buf + offset;
+}
+
+static void
+drgn_dwarf_index_cache_scn_sizes(struct drgn_debug_info_module *module,
+				 uint64_t sizes[DRGN_DWARF_INDEX_CACHE_NUM_SCNS])
+{
+	for (int i = 0; i < DRGN_DWARF_INDEX_CACHE_NUM_SCNS; i++) {
+		Elf_Data *data = drgn_dwarf_index_cache_scn_data(module, i);
+		sizes[i] = data && data->d_buf ? data->d_size : 0;
+	}
+}
+
+static char *drgn_dwarf_index_cache_path(const char *dir,
+					 struct drgn_debug_info_module *module,
+					 const char *suffix)
+{
+	size_t dir_len = strlen(dir);
+	size_t suffix_len = strlen(suffix);
+	char *path = malloc(dir_len + 1 + 2 * module->build_id_len +
+			    sizeof(".dwidx") - 1 + suffix_len + 1);
+	if (!path)
+		return NULL;
+	char *p = path;
+	memcpy(p, dir, dir_len);
+	p += dir_len;
+	*p++ = '/';
+	const uint8_t *build_id = module->build_id;
+	for (size_t i = 0; i < module->build_id_len; i++) {
+		static const char hex[] = "0123456789abcdef";
+		*p++ = hex[build_id[i] >> 4];
+		*p++ = hex[build_id[i] & 0xf];
+	}
+	memcpy(p, ".dwidx", sizeof(".dwidx") - 1);
+	p += sizeof(".dwidx") - 1;
+	memcpy(p, suffix, suffix_len + 1);
+	return path;
+}
+
+static inline size_t build_id_padded_len(size_t build_id_len)
+{
+	return (build_id_len + 7) & ~(size_t)7;
+}
+
+bool drgn_dwarf_index_cache_open(const char *dir,
+				 struct drgn_debug_info_module *module,
+				 struct drgn_dwarf_index_cache *ret)
+{
+	if (!module->build_id_len)
+		return false;
+
+	char *path = drgn_dwarf_index_cache_path(dir, module, "");
+	if (!path)
+		return false;
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	free(path);
+	if (fd < 0)
+		return false;
+
+	bool success = false;
+	struct stat st;
+	if (fstat(fd, &st) < 0 ||
+	    st.st_size < sizeof(struct drgn_dwarf_index_cache_header))
+		goto out_fd;
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED)
+		goto out_fd;
+
+	const struct drgn_dwarf_index_cache_header *header = map;
+	if (memcmp(header->magic, drgn_dwarf_index_cache_magic,
+		   sizeof(header->magic)) != 0 ||
+	    header->version != DRGN_DWARF_INDEX_CACHE_VERSION ||
+	    header->build_id_len != module->build_id_len)
+		goto out_map;
+
+	uint64_t scn_sizes[DRGN_DWARF_INDEX_CACHE_NUM_SCNS];
+	drgn_dwarf_index_cache_scn_sizes(module, scn_sizes);
+	if (memcmp(header->scn_sizes, scn_sizes, sizeof(scn_sizes)) != 0)
+		goto out_map;
+
+	size_t build_id_offset = sizeof(*header);
+	size_t dies_offset =
+		build_id_offset + build_id_padded_len(module->build_id_len);
+	size_t remaining = st.st_size - dies_offset;
+	if (st.st_size < dies_offset ||
+	    memcmp((char *)map + build_id_offset, module->build_id,
+		   module->build_id_len) != 0 ||
+	    header->num_dies > remaining / sizeof(ret->dies[0]))
+		goto out_map;
+	remaining -= header->num_dies * sizeof(ret->dies[0]);
+	if (header->num_specifications !=
+	    remaining / sizeof(ret->specifications[0]) ||
+	    remaining % sizeof(ret->specifications[0]) != 0)
+		goto out_map;
+
+	const struct drgn_dwarf_index_cache_die *dies =
+		(void *)((char *)map + dies_offset);
+	const struct drgn_dwarf_index_cache_specification *specifications =
+		(void *)(dies + header->num_dies);
+	/*
+	 * Check every entry up front so that indexing from the cache can't
+	 * fail.
+	 */
+	for (size_t i = 0; i < header->num_dies; i++) {
+		const char *name =
+			drgn_dwarf_index_cache_decode(module, dies[i].name_scn,
+						      dies[i].name_offset);
+		if (!name ||
+		    !drgn_dwarf_index_cache_decode(module, dies[i].addr_scn,
+						   dies[i].addr_offset) ||
+		    dies[i].tag == DW_TAG_namespace)
+			goto out_map;
+		/*
+		 * .debug_str is truncated to end with a null byte, but strings
+		 * in other sections need to be checked.
+		 */
+		if (dies[i].name_scn != DRGN_DWARF_INDEX_CACHE_SCN_DEBUG_STR &&
+		    dies[i].name_scn != DRGN_DWARF_INDEX_CACHE_SCN_ALT_DEBUG_STR) {
+			Elf_Data *data =
+				drgn_dwarf_index_cache_scn_data(module,
+								dies[i].name_scn);
+			if (!memchr(name, '\0',
+				    (const char *)data->d_buf + data->d_size - name))
+				goto out_map;
+		}
+	}
+	for (size_t i = 0; i < header->num_specifications; i++) {
+		if (!drgn_dwarf_index_cache_decode(module,
+						   specifications[i].declaration_scn,
+						   specifications[i].declaration_offset) ||
+		    !drgn_dwarf_index_cache_decode(module,
+						   specifications[i].addr_scn,
+						   specifications[i].addr_offset))
+			goto out_map;
+	}
+
+	ret->module = module;
+	ret->map = map;
+	ret->size = st.st_size;
+	ret->dies = dies;
+	ret->num_dies = header->num_dies;
+	ret->specifications = specifications;
+	ret->num_specifications = header->num_specifications;
+	success = true;
+
+out_map:
+	if (!success)
+		munmap(map, st.st_size);
+out_fd:
+	close(fd);
+	return success;
+}
+
+void drgn_dwarf_index_cache_close(struct drgn_dwarf_index_cache *cache)
+{
+	munmap(cache->map, cache->size);
+}
+
+void
+drgn_dwarf_index_cache_write(const char *dir,
+			     struct drgn_debug_info_module *module,
+			     const struct drgn_dwarf_index_cache_die *dies,
+			     size_t num_dies,
+			     const struct drgn_dwarf_index_cache_specification *specifications,
+			     size_t num_specifications)
+{
+	if (!module->build_id_len)
+		return;
+
+	size_t dies_offset = (sizeof(struct drgn_dwarf_index_cache_header) +
+			      build_id_padded_len(module->build_id_len));
+	size_t dies_size = num_dies * sizeof(dies[0]);
+	size_t specifications_size =
+		num_specifications * sizeof(specifications[0]);
+	size_t size = dies_offset + dies_size + specifications_size;
+	/* Zero the buffer so that we don't write uninitialized padding. */
+	char *buf = calloc(1, size);
+	if (!buf)
+		return;
+	struct drgn_dwarf_index_cache_header *header = (void *)buf;
+	memcpy(header->magic, drgn_dwarf_index_cache_magic,
+	       sizeof(header->magic));
+	header->version = DRGN_DWARF_INDEX_CACHE_VERSION;
+	header->build_id_len = module->build_id_len;
+	drgn_dwarf_index_cache_scn_sizes(module, header->scn_sizes);
+	header->num_dies = num_dies;
+	header->num_specifications = num_specifications;
+	memcpy(buf + sizeof(*header), module->build_id, module->build_id_len);
+	memcpy(buf + dies_offset, dies, dies_size);
+	memcpy(buf + dies_offset + dies_size, specifications,
+	       specifications_size);
+
+	char *path = drgn_dwarf_index_cache_path(dir, module, "");
+	char *tmp_path = drgn_dwarf_index_cache_path(dir, module, ".XXXXXX");
+	if (!path || !tmp_path)
+		goto out;
+	if (mkdir(dir, 0777) < 0 && errno != EEXIST)
+		goto out;
+	int fd = mkstemp(tmp_path);
+	if (fd < 0)
+		goto out;
+	size_t written = 0;
+	while (written < size) {
+		ssize_t r = write(fd, buf + written, size - written);
+		if (r < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		written += r;
+	}
+	if (close(fd) < 0 || written < size || rename(tmp_path, path) < 0)
+		unlink(tmp_path);
+out:
+	free(tmp_path);
+	free(path);
+	free(buf);
+}
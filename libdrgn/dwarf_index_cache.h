@@ -0,0 +1,149 @@
+// Copyright (c) Meta Platforms, Inc. and affiliates.
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/**
+ * @file
+ *
+ * On-disk cache of the DWARF name index.
+ *
+ * See @ref DebugInfo.
+ */
+
+#ifndef DRGN_DWARF_INDEX_CACHE_H
+#define DRGN_DWARF_INDEX_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct drgn_debug_info_module;
+
+/**
+ * @ingroup DebugInfo
+ *
+ * @{
+ */
+
+/**
+ * Section that a pointer stored in a DWARF index cache file is relative to.
+ *
+ * Pointers into debugging information are stored as an offset from the
+ * beginning of one of these sections so that they are valid regardless of
+ * where the sections are loaded in memory.
+ */
+enum drgn_dwarf_index_cache_scn {
+	DRGN_DWARF_INDEX_CACHE_SCN_DEBUG_INFO,
+	DRGN_DWARF_INDEX_CACHE_SCN_DEBUG_TYPES,
+	DRGN_DWARF_INDEX_CACHE_SCN_DEBUG_STR,
+	DRGN_DWARF_INDEX_CACHE_SCN_ALT_DEBUG_INFO,
+	DRGN_DWARF_INDEX_CACHE_SCN_ALT_DEBUG_STR,
+	DRGN_DWARF_INDEX_CACHE_NUM_SCNS,
+} __attribute__((__packed__));
+
+/** Indexed DIE in a DWARF index cache file. */
+struct drgn_dwarf_index_cache_die {
+	/** Hash of filename containing declaration. */
+	uint64_t file_name_hash;
+	/** Offset of the name of the DIE in @ref name_scn. */
+	uint64_t name_offset;
+	/** Offset of the DIE in @ref addr_scn. */
+	uint64_t addr_offset;
+	/** DIE tag. */
+	uint8_t tag;
+	enum drgn_dwarf_index_cache_scn name_scn;
+	enum drgn_dwarf_index_cache_scn addr_scn;
+};
+
+/** DIE with a `DW_AT_specification` attribute in a DWARF index cache file. */
+struct drgn_dwarf_index_cache_specification {
+	/** Offset of the declaration DIE in @ref declaration_scn. */
+	uint64_t declaration_offset;
+	/** Offset of the DIE in @ref addr_scn. */
+	uint64_t addr_offset;
+	enum drgn_dwarf_index_cache_scn declaration_scn;
+	enum drgn_dwarf_index_cache_scn addr_scn;
+};
+
+/** DWARF index cache file mapped into memory. */
+struct drgn_dwarf_index_cache {
+	/** Module that the cache file was opened for. */
+	struct drgn_debug_info_module *module;
+	/** Mapped file. */
+	void *map;
+	/** Size of mapped file. */
+	size_t size;
+	/** Indexed DIEs. */
+	const struct drgn_dwarf_index_cache_die *dies;
+	/** Number of DIEs in @ref dies. */
+	size_t num_dies;
+	/** DIEs with a `DW_AT_specification` attribute. */
+	const struct drgn_dwarf_index_cache_specification *specifications;
+	/** Number of entries in @ref specifications. */
+	size_t num_specifications;
+};
+
+/**
+ * Open and map the DWARF index cache file for a module.
+ *
+ * The cache file is named after the module's build ID. It is only used if it
+ * was written by a compatible version of drgn for the same debugging
+ * information.
+ *
+ * @param[in] dir Cache directory.
+ * @param[out] ret Returned cache. Must be closed with @ref
+ * drgn_dwarf_index_cache_close().
+ * @return @c true if a valid cache file was found, @c false if not.
+ */
+bool drgn_dwarf_index_cache_open(const char *dir,
+				 struct drgn_debug_info_module *module,
+				 struct drgn_dwarf_index_cache *ret);
+
+/** Unmap a DWARF index cache file. */
+void drgn_dwarf_index_cache_close(struct drgn_dwarf_index_cache *cache);
+
+/**
+ * Write the DWARF index cache file for a module.
+ *
+ * The file is written to a temporary file and atomically renamed into place,
+ * so concurrent readers never see a partial file. Failures are not fatal, so
+ * this doesn't return an error.
+ *
+ * @param[in] dir Cache directory.
+ * @param[in] dies Indexed DIEs in the module.
+ * @param[in] num_dies Number of DIEs in @p dies.
+ * @param[in] specifications DIEs in the module with a `DW_AT_specification`
+ * attribute.
+ * @param[in] num_specifications Number of entries in @p specifications.
+ */
+void
+drgn_dwarf_index_cache_write(const char *dir,
+			     struct drgn_debug_info_module *module,
+			     const struct drgn_dwarf_index_cache_die *dies,
+			     size_t num_dies,
+			     const struct drgn_dwarf_index_cache_specification *specifications,
+			     size_t num_specifications);
+
+/**
+ * Convert a pointer into a module's debugging information to a cached section
+ * offset.
+ *
+ * @return @c true on success, @c false if @p ptr is not in a cached section.
+ */
+bool drgn_dwarf_index_cache_encode(struct drgn_debug_info_module *module,
+				   const char *ptr,
+				   enum drgn_dwarf_index_cache_scn *scn_ret,
+				   uint64_t *offset_ret);
+
+/**
+ * Convert a cached section offset to a pointer into a module's debugging
+ * information.
+ *
+ * @return Pointer, or @c NULL if the offset is out of bounds.
+ */
+const char *drgn_dwarf_index_cache_decode(struct drgn_debug_info_module *module,
+					  enum drgn_dwarf_index_cache_scn scn,
+					  uint64_t offset);
+
+/** @} */
+
+#endif /* DRGN_DWARF_INDEX_CACHE_H */
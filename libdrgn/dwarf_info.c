@@ -14,42 +14,146 @@
 #include <stdlib.h>
 #include <string.h>
 
-#ifdef _OPENMP
-#include <omp.h>
-#else
-typedef struct {} omp_lock_t;
-#define omp_init_lock(lock) do {} while (0)
-#define omp_destroy_lock(lock) do {} while (0)
-#define omp_set_lock(lock) do {} while (0)
-#define omp_unset_lock(lock) do {} while (0)
-static inline int omp_get_thread_num(void)
-{
-	return 0;
-}
-static inline int omp_get_max_threads(void)
-{
-	return 1;
-}
-#endif
-
 #include "array.h"
 #include "debug_info.h" // IWYU pragma: associated
+#include "dwarf_index_cache.h"
 #include "error.h"
 #include "language.h"
 #include "lazy_object.h"
 #include "minmax.h"
 #include "object.h"
+#include "openmp.h"
 #include "path.h"
 #include "program.h"
 #include "register_state.h"
 #include "serialize.h"
+#include "string_builder.h"
 #include "type.h"
 #include "util.h"
 
+DEFINE_VECTOR_FUNCTIONS(drgn_dwarf_cie_vector)
+DEFINE_HASH_MAP_FUNCTIONS(drgn_dwarf_cie_map, int_key_hash_pair, scalar_key_eq)
+
+/** DIE with an address range in a @ref drgn_dwarf_unit_scopes. */
+struct drgn_dwarf_unit_scope {
+	Dwarf_Die die;
+	/**
+	 * Index of the closest ancestor of @ref die in @ref
+	 * drgn_dwarf_unit_scopes::scopes, or @c UINT32_MAX if its parent is the
+	 * unit DIE.
+	 */
+	uint32_t parent;
+};
+
+/**
+ * Part of the address space of a unit whose innermost scope is the same.
+ *
+ * This starts at @ref start and ends where the next one starts.
+ */
+struct drgn_dwarf_scope_range {
+	uint64_t start;
+	/**
+	 * Index of the innermost scope in @ref drgn_dwarf_unit_scopes::scopes,
+	 * or @c UINT32_MAX if no scope other than the unit DIE covers this
+	 * range.
+	 */
+	uint32_t scope;
+};
+
+/**
+ * Index of the DIEs with address ranges in a unit.
+ *
+ * This flattens the tree of nested scopes (subprograms, inlined subroutines,
+ * lexical blocks, etc.) into a sorted list of address ranges so that the scopes
+ * containing an address can be found with a binary search instead of walking
+ * the DIEs.
+ */
+struct drgn_dwarf_unit_scopes {
+	Dwarf_Die unit_die;
+	struct drgn_dwarf_unit_scope *scopes;
+	struct drgn_dwarf_scope_range *ranges;
+	size_t num_ranges;
+};
+
+DEFINE_HASH_MAP_FUNCTIONS(drgn_dwarf_unit_scopes_map, int_key_hash_pair,
+			  scalar_key_eq)
+
+static void drgn_dwarf_unit_scopes_destroy(struct drgn_dwarf_unit_scopes *unit)
+{
+	if (unit) {
+		free(unit->ranges);
+		free(unit->scopes);
+		free(unit);
+	}
+}
+
+/** Entry in a @ref drgn_dwarf_location_list. */
+struct drgn_dwarf_location_list_entry {
+	/** Start of the unbiased PC range covered by this entry. */
+	uint64_t start;
+	/** Size of the PC range covered by this entry. */
+	uint64_t length;
+	/** Location description. */
+	const char *expr;
+	/** Size of @ref expr. */
+	size_t expr_size;
+};
+
+/**
+ * Decoded DWARF location list.
+ *
+ * The entries are in the order they appear in the list, since the first one
+ * containing a PC is used.
+ */
+struct drgn_dwarf_location_list {
+	struct drgn_dwarf_location_list_entry *entries;
+	size_t num_entries;
+	/**
+	 * Location description used when no entry contains a PC
+	 * (`DW_LLE_default_location`), or @c NULL if the location is unknown
+	 * in that case.
+	 */
+	const char *default_expr;
+	/** Size of @ref default_expr. */
+	size_t default_expr_size;
+};
+
+DEFINE_HASH_MAP_FUNCTIONS(drgn_dwarf_location_list_map, int_key_hash_pair,
+			  scalar_key_eq)
+
+static void
+drgn_dwarf_location_list_destroy(struct drgn_dwarf_location_list *list)
+{
+	if (list) {
+		free(list->entries);
+		free(list);
+	}
+}
+
 void drgn_dwarf_module_info_deinit(struct drgn_debug_info_module *module)
 {
+	struct drgn_dwarf_location_list_map *location_lists =
+		module->dwarf.location_lists;
+	if (location_lists) {
+		for (struct drgn_dwarf_location_list_map_iterator it =
+		     drgn_dwarf_location_list_map_first(location_lists);
+		     it.entry; it = drgn_dwarf_location_list_map_next(it))
+			drgn_dwarf_location_list_destroy(it.entry->value);
+		drgn_dwarf_location_list_map_deinit(location_lists);
+		free(location_lists);
+	}
+	if (module->dwarf.unit_scopes) {
+		for (struct drgn_dwarf_unit_scopes_map_iterator it =
+		     drgn_dwarf_unit_scopes_map_first(module->dwarf.unit_scopes);
+		     it.entry; it = drgn_dwarf_unit_scopes_map_next(it))
+			drgn_dwarf_unit_scopes_destroy(it.entry->value);
+		drgn_dwarf_unit_scopes_map_deinit(module->dwarf.unit_scopes);
+		free(module->dwarf.unit_scopes);
+	}
+	if (module->dwarf.eh_frame_hdr_table)
+		drgn_dwarf_cie_map_deinit(&module->dwarf.cie_map);
 	free(module->dwarf.fdes);
-	free(module->dwarf.cies);
+	drgn_dwarf_cie_vector_deinit(&module->dwarf.cies);
 }
 
 static inline uintptr_t
@@ -60,12 +164,17 @@ drgn_dwarf_specification_to_key(const struct drgn_dwarf_specification *entry)
 DEFINE_HASH_TABLE_FUNCTIONS(drgn_dwarf_specification_map,
 			    drgn_dwarf_specification_to_key, int_key_hash_pair,
 			    scalar_key_eq)
+DEFINE_VECTOR_FUNCTIONS(drgn_dwarf_index_module_vector)
+DEFINE_HASH_MAP_FUNCTIONS(drgn_dwarf_file_name_id_map, int_key_hash_pair,
+			  scalar_key_eq)
 
 /**
  * Placeholder for drgn_dwarf_index_cu::file_name_hashes if the CU has no
  * filenames.
  */
 static const uint64_t no_file_name_hashes[1] = { 0 };
+/** Placeholder for drgn_dwarf_index_cu::file_name_ids. */
+static const uint32_t no_file_name_ids[1] = { 0 };
 
 /** DWARF compilation unit indexed in a @ref drgn_namespace_dwarf_index. */
 struct drgn_dwarf_index_cu {
@@ -88,6 +197,11 @@ struct drgn_dwarf_index_cu {
 	 * DRGN_SCN_DEBUG_TYPES).
 	 */
 	enum drgn_debug_info_scn scn;
+	/**
+	 * Whether the DIEs in this CU are indexed from a `.debug_names` name
+	 * index (@ref drgn_dwarf_index_names) instead of by parsing the CU.
+	 */
+	bool use_debug_names;
 	/**
 	 * Mapping from DWARF abbreviation code to instructions for that
 	 * abbreviation.
@@ -115,6 +229,11 @@ struct drgn_dwarf_index_cu {
 	 * indexed by the line number program file numbers.
 	 */
 	uint64_t *file_name_hashes;
+	/**
+	 * IDs of the file names in @ref file_name_hashes (see @ref
+	 * drgn_dwarf_info::file_name_ids).
+	 */
+	uint32_t *file_name_ids;
 	/** Number of file names in the line number program header. */
 	size_t num_file_names;
 	/**
@@ -126,6 +245,26 @@ struct drgn_dwarf_index_cu {
 
 DEFINE_VECTOR_FUNCTIONS(drgn_dwarf_index_cu_vector)
 
+/** Name index from a `.debug_names` section. */
+struct drgn_dwarf_index_names {
+	/** Module containing name index. */
+	struct drgn_debug_info_module *module;
+	/** Address of name index data. */
+	const char *buf;
+	/** Length of name index data. */
+	size_t len;
+	/**
+	 * Index of the first `.debug_info` CU of @ref module in @ref
+	 * drgn_dwarf_info::index_cus (or in the per-thread array in @ref
+	 * drgn_dwarf_index_state::cus while it is pending).
+	 */
+	size_t first_cu;
+	/** Number of `.debug_info` CUs in @ref module. */
+	size_t num_cus;
+};
+
+DEFINE_VECTOR_FUNCTIONS(drgn_dwarf_index_names_vector)
+
 DEFINE_HASH_MAP_FUNCTIONS(drgn_dwarf_type_map, ptr_key_hash_pair, scalar_key_eq)
 
 /** DIE which needs to be indexed. */
@@ -140,19 +279,43 @@ struct drgn_dwarf_index_pending_die {
 
 DEFINE_VECTOR_FUNCTIONS(drgn_dwarf_index_pending_die_vector)
 
-/** DIE indexed in a @ref drgn_namespace_dwarf_index. */
+/**
+ * Value of @ref drgn_dwarf_index_die::next for the last DIE with a name. This
+ * also limits the number of DIEs in a @ref drgn_dwarf_index_shard.
+ */
+#define DRGN_DWARF_INDEX_DIE_END ((UINT32_C(1) << 24) - 1)
+
+/**
+ * DIE indexed in a @ref drgn_namespace_dwarf_index.
+ *
+ * There is one of these for every named DIE in the program, so it is packed
+ * into 16 bytes.
+ */
 struct drgn_dwarf_index_die {
 	/**
 	 * The next DIE with the same name (as an index into @ref
-	 * drgn_dwarf_index_shard::dies), or `UINT32_MAX` if this is the last
-	 * DIE.
+	 * drgn_dwarf_index_shard::dies), or @ref DRGN_DWARF_INDEX_DIE_END if
+	 * this is the last DIE.
 	 */
-	uint32_t next;
+	uint32_t next : 24;
 	/** DIE tag. */
-	uint8_t tag;
+	uint32_t tag : 8;
+	/**
+	 * Offset of this DIE in `.debug_info`, or the size of `.debug_info`
+	 * plus the offset of this DIE in `.debug_types`.
+	 *
+	 * drgn_dwarf_index_read_module() checks that this fits.
+	 */
+	uint32_t offset;
+	/**
+	 * Module containing this DIE (as an index into @ref
+	 * drgn_dwarf_info::index_modules).
+	 */
+	uint32_t module;
 	union {
 		/**
-		 * Hash of filename containing declaration.
+		 * ID of the hash of the filename containing the declaration
+		 * (see @ref drgn_dwarf_info::file_name_ids).
 		 *
 		 * DIEs with the same name but different tags or files are
 		 * considered distinct. We only compare the hash of the file
@@ -163,19 +326,35 @@ struct drgn_dwarf_index_die {
 		 * This is used if `tag != DW_TAG_namespace` (namespaces are
 		 * merged, so they don't need this).
 		 */
-		uint64_t file_name_hash;
-		/** Nested namespace if `tag == DW_TAG_namespace`. */
-		struct drgn_namespace_dwarf_index *namespace;
+		uint32_t file_name_id;
+		/**
+		 * Nested namespace if `tag == DW_TAG_namespace` (as an index
+		 * into @ref drgn_dwarf_index_shard::namespaces).
+		 */
+		uint32_t namespace;
 	};
-	/** Module containing this DIE. */
-	struct drgn_debug_info_module *module;
-	/** Address of this DIE. */
-	uintptr_t addr;
 };
 
+static_assert(sizeof(struct drgn_dwarf_index_die) == 16,
+	      "drgn_dwarf_index_die is not packed");
+
+static uint32_t drgn_dwarf_index_die_offset(struct drgn_debug_info_module *module,
+					    uintptr_t addr)
+{
+	Elf_Data *data = module->scn_data[DRGN_SCN_DEBUG_INFO];
+	uintptr_t start = (uintptr_t)data->d_buf;
+	if (addr >= start && addr < start + data->d_size)
+		return addr - start;
+	/* Otherwise, it must be in .debug_types. */
+	return (data->d_size +
+		(addr - (uintptr_t)module->scn_data[DRGN_SCN_DEBUG_TYPES]->d_buf));
+}
+
 DEFINE_HASH_MAP(drgn_dwarf_index_die_map, struct nstring, uint32_t,
 		nstring_hash_pair, nstring_eq)
 DEFINE_VECTOR(drgn_dwarf_index_die_vector, struct drgn_dwarf_index_die)
+DEFINE_VECTOR(drgn_namespace_dwarf_index_vector,
+	      struct drgn_namespace_dwarf_index *)
 
 #define DRGN_DWARF_INDEX_SHARD_BITS 8
 static const size_t DRGN_DWARF_INDEX_NUM_SHARDS = 1 << DRGN_DWARF_INDEX_SHARD_BITS;
@@ -195,8 +374,42 @@ struct drgn_dwarf_index_shard {
 	 * These are stored in one array for cache locality.
 	 */
 	struct drgn_dwarf_index_die_vector dies;
+	/** Nested namespaces of namespace DIEs in @ref dies. */
+	struct drgn_namespace_dwarf_index_vector namespaces;
+};
+
+DEFINE_VECTOR(drgn_dwarf_raw_name_vector, struct nstring)
+DEFINE_HASH_MAP(drgn_dwarf_canonical_name_map, struct nstring,
+		struct drgn_dwarf_raw_name_vector, nstring_hash_pair,
+		nstring_eq)
+
+/**
+ * Index of the names with template arguments in a @ref
+ * drgn_namespace_dwarf_index by their canonical spelling (see @ref
+ * drgn_cpp_canonicalize_name()).
+ */
+struct drgn_dwarf_canonical_names {
+	/** Map from canonical name to names in the namespace index. */
+	struct drgn_dwarf_canonical_name_map map;
+	/** Number of DIEs in the namespace index when this was built. */
+	size_t num_dies;
 };
 
+static void
+drgn_dwarf_canonical_names_destroy(struct drgn_dwarf_canonical_names *names)
+{
+	if (!names)
+		return;
+	for (struct drgn_dwarf_canonical_name_map_iterator it =
+	     drgn_dwarf_canonical_name_map_first(&names->map);
+	     it.entry; it = drgn_dwarf_canonical_name_map_next(it)) {
+		free((char *)it.entry->key.str);
+		drgn_dwarf_raw_name_vector_deinit(&it.entry->value);
+	}
+	drgn_dwarf_canonical_name_map_deinit(&names->map);
+	free(names);
+}
+
 static void
 drgn_namespace_dwarf_index_init(struct drgn_namespace_dwarf_index *dindex,
 				struct drgn_debug_info *dbinfo)
@@ -205,23 +418,23 @@ drgn_namespace_dwarf_index_init(struct drgn_namespace_dwarf_index *dindex,
 	dindex->dbinfo = dbinfo;
 	drgn_dwarf_index_pending_die_vector_init(&dindex->pending_dies);
 	dindex->saved_err = NULL;
+	dindex->canonical_names = NULL;
 }
 
 static void
 drgn_namespace_dwarf_index_deinit(struct drgn_namespace_dwarf_index *dindex)
 {
+	drgn_dwarf_canonical_names_destroy(dindex->canonical_names);
 	drgn_error_destroy(dindex->saved_err);
 	drgn_dwarf_index_pending_die_vector_deinit(&dindex->pending_dies);
 	if (dindex->shards) {
 		for (size_t i = 0; i < DRGN_DWARF_INDEX_NUM_SHARDS; i++) {
 			struct drgn_dwarf_index_shard *shard = &dindex->shards[i];
-			for (size_t j = 0; j < shard->dies.size; j++) {
-				struct drgn_dwarf_index_die *die = &shard->dies.data[j];
-				if (die->tag == DW_TAG_namespace) {
-					drgn_namespace_dwarf_index_deinit(die->namespace);
-					free(die->namespace);
-				}
+			for (size_t j = 0; j < shard->namespaces.size; j++) {
+				drgn_namespace_dwarf_index_deinit(shard->namespaces.data[j]);
+				free(shard->namespaces.data[j]);
 			}
+			drgn_namespace_dwarf_index_vector_deinit(&shard->namespaces);
 			drgn_dwarf_index_die_vector_deinit(&shard->dies);
 			drgn_dwarf_index_die_map_deinit(&shard->map);
 			omp_destroy_lock(&shard->lock);
@@ -230,11 +443,40 @@ drgn_namespace_dwarf_index_deinit(struct drgn_namespace_dwarf_index *dindex)
 	}
 }
 
+/*
+ * Initialize the parts of a drgn_dwarf_info that make up the DWARF index (as
+ * opposed to the type caches).
+ */
+static void drgn_dwarf_info_init_index(struct drgn_dwarf_info *dwarf,
+				       struct drgn_debug_info *dbinfo)
+{
+	drgn_namespace_dwarf_index_init(&dwarf->global, dbinfo);
+	drgn_dwarf_specification_map_init(&dwarf->specifications);
+	drgn_dwarf_index_cu_vector_init(&dwarf->index_cus);
+	dwarf->num_indexed_cus = 0;
+	drgn_dwarf_index_module_vector_init(&dwarf->index_modules);
+	struct drgn_dwarf_file_name_ids *file_name_ids = &dwarf->file_name_ids;
+	for (size_t i = 0; i < DRGN_DWARF_FILE_NAME_ID_NUM_SHARDS; i++)
+		drgn_dwarf_file_name_id_map_init(&file_name_ids->shards[i]);
+	drgn_dwarf_index_names_vector_init(&dwarf->index_names);
+	dwarf->deferred_err = NULL;
+}
+
 void drgn_dwarf_info_init(struct drgn_debug_info *dbinfo)
 {
-	drgn_namespace_dwarf_index_init(&dbinfo->dwarf.global, dbinfo);
-	drgn_dwarf_specification_map_init(&dbinfo->dwarf.specifications);
-	drgn_dwarf_index_cu_vector_init(&dbinfo->dwarf.index_cus);
+	drgn_dwarf_info_init_index(&dbinfo->dwarf, dbinfo);
+	for (size_t i = 0; i < DRGN_DWARF_FILE_NAME_ID_NUM_SHARDS; i++)
+		omp_init_lock(&dbinfo->dwarf.file_name_id_locks[i]);
+	char *env = getenv("DRGN_LAZY_DWARF_INDEX");
+	dbinfo->dwarf.lazy = env && atoi(env);
+	env = getenv("DRGN_STREAM_DWARF_INDEX");
+	dbinfo->dwarf.stream = env && atoi(env);
+	env = getenv("DRGN_PREFETCH_DWARF_NAMESPACES");
+	dbinfo->dwarf.prefetch_namespaces = env && atoi(env);
+	env = getenv("DRGN_USE_DEBUG_NAMES");
+	dbinfo->dwarf.use_debug_names = !env || atoi(env);
+	env = getenv("DRGN_LOW_MEMORY_DEBUG_INFO");
+	dbinfo->dwarf.low_memory = env && atoi(env);
 	drgn_dwarf_type_map_init(&dbinfo->dwarf.types);
 	drgn_dwarf_type_map_init(&dbinfo->dwarf.cant_be_incomplete_array_types);
 	dbinfo->dwarf.depth = 0;
@@ -242,21 +484,56 @@ void drgn_dwarf_info_init(struct drgn_debug_info *dbinfo)
 
 static void drgn_dwarf_index_cu_deinit(struct drgn_dwarf_index_cu *cu)
 {
+	if (cu->file_name_ids != no_file_name_ids)
+		free(cu->file_name_ids);
 	if (cu->file_name_hashes != no_file_name_hashes)
 		free(cu->file_name_hashes);
 	free(cu->abbrev_insns);
 	free(cu->abbrev_decls);
 }
 
+static void drgn_dwarf_info_deinit_index(struct drgn_dwarf_info *dwarf)
+{
+	for (size_t i = 0; i < dwarf->index_cus.size; i++)
+		drgn_dwarf_index_cu_deinit(&dwarf->index_cus.data[i]);
+	drgn_dwarf_index_cu_vector_deinit(&dwarf->index_cus);
+	drgn_dwarf_index_names_vector_deinit(&dwarf->index_names);
+	struct drgn_dwarf_file_name_ids *file_name_ids = &dwarf->file_name_ids;
+	for (size_t i = 0; i < DRGN_DWARF_FILE_NAME_ID_NUM_SHARDS; i++)
+		drgn_dwarf_file_name_id_map_deinit(&file_name_ids->shards[i]);
+	drgn_dwarf_index_module_vector_deinit(&dwarf->index_modules);
+	drgn_error_destroy(dwarf->deferred_err);
+	drgn_dwarf_specification_map_deinit(&dwarf->specifications);
+	drgn_namespace_dwarf_index_deinit(&dwarf->global);
+}
+
+/* Exchange the DWARF indexes (but not the type caches) of a and b. */
+static void drgn_dwarf_info_swap_index(struct drgn_dwarf_info *a,
+				       struct drgn_dwarf_info *b)
+{
+#define SWAP_FIELD(field) do {		\
+	typeof(a->field) tmp = a->field;	\
+	a->field = b->field;		\
+	b->field = tmp;			\
+} while (0)
+	SWAP_FIELD(global);
+	SWAP_FIELD(specifications);
+	SWAP_FIELD(index_cus);
+	SWAP_FIELD(index_modules);
+	SWAP_FIELD(file_name_ids);
+	SWAP_FIELD(num_indexed_cus);
+	SWAP_FIELD(index_names);
+	SWAP_FIELD(deferred_err);
+#undef SWAP_FIELD
+}
+
 void drgn_dwarf_info_deinit(struct drgn_debug_info *dbinfo)
 {
 	drgn_dwarf_type_map_deinit(&dbinfo->dwarf.cant_be_incomplete_array_types);
 	drgn_dwarf_type_map_deinit(&dbinfo->dwarf.types);
-	for (size_t i = 0; i < dbinfo->dwarf.index_cus.size; i++)
-		drgn_dwarf_index_cu_deinit(&dbinfo->dwarf.index_cus.data[i]);
-	drgn_dwarf_index_cu_vector_deinit(&dbinfo->dwarf.index_cus);
-	drgn_dwarf_specification_map_deinit(&dbinfo->dwarf.specifications);
-	drgn_namespace_dwarf_index_deinit(&dbinfo->dwarf.global);
+	drgn_dwarf_info_deinit_index(&dbinfo->dwarf);
+	for (size_t i = 0; i < DRGN_DWARF_FILE_NAME_ID_NUM_SHARDS; i++)
+		omp_destroy_lock(&dbinfo->dwarf.file_name_id_locks[i]);
 }
 
 /*
@@ -346,9 +623,10 @@ static inline struct drgn_error *drgn_check_address_size(uint8_t address_size)
  * a bespoke DWARF parser specialized for the task of scanning over DIEs
  * quickly.
  *
- * Although the DWARF standard defines ".debug_pubnames" and ".debug_names"
- * sections, GCC and Clang currently don't emit them by default, so we don't use
- * them.
+ * The DWARF standard also defines ".debug_pubnames" and ".debug_names"
+ * sections. GCC and Clang don't emit them by default, but if a module has a
+ * usable ".debug_names" section, we use it to find the DIEs to index instead of
+ * scanning every DIE in its CUs (see drgn_dwarf_index_read_names()).
  *
  * Every namespace has a separate index (@ref drgn_namespace_dwarf_index). The
  * global namespace is indexed immediately upon loading debugging information.
@@ -361,6 +639,7 @@ struct drgn_dwarf_index_pending_cu {
 	size_t len;
 	bool is_64_bit;
 	enum drgn_debug_info_scn scn;
+	bool use_debug_names;
 };
 
 DEFINE_VECTOR_FUNCTIONS(drgn_dwarf_index_pending_cu_vector)
@@ -379,7 +658,7 @@ enum drgn_dwarf_index_abbrev_insn {
 	 * Instructions > 0 and <= INSN_MAX_SKIP indicate a number of bytes to
 	 * be skipped over.
 	 */
-	INSN_MAX_SKIP = 193,
+	INSN_MAX_SKIP = 192,
 
 	/* These instructions indicate an attribute that can be skipped over. */
 	INSN_SKIP_BLOCK,
@@ -387,6 +666,11 @@ enum drgn_dwarf_index_abbrev_insn {
 	INSN_SKIP_BLOCK2,
 	INSN_SKIP_BLOCK4,
 	INSN_SKIP_LEB128,
+	/*
+	 * This instruction has a one-byte operand: the number of consecutive
+	 * LEB128 attributes to skip (at least 2).
+	 */
+	INSN_SKIP_LEB128S,
 	INSN_SKIP_STRING,
 
 	/* These instructions indicate an attribute that should be parsed. */
@@ -427,8 +711,7 @@ enum drgn_dwarf_index_abbrev_insn {
 	INSN_DECL_FILE_DATA8,
 	INSN_DECL_FILE_UDATA,
 	/*
-	 * This instruction is the only one with an operand: the ULEB128
-	 * implicit constant.
+	 * This instruction has a ULEB128 operand: the implicit constant.
 	 */
 	INSN_DECL_FILE_IMPLICIT,
 	INSN_DECLARATION_FLAG,
@@ -529,27 +812,110 @@ drgn_namespace_dwarf_index_alloc_shards(struct drgn_namespace_dwarf_index *dinde
 		omp_init_lock(&shard->lock);
 		drgn_dwarf_index_die_map_init(&shard->map);
 		drgn_dwarf_index_die_vector_init(&shard->dies);
+		drgn_namespace_dwarf_index_vector_init(&shard->namespaces);
 	}
 	return true;
 }
 
+/** DIE indexed from a CU which will be written to a DWARF index cache file. */
+struct drgn_dwarf_index_cache_die_record {
+	/** Module containing the CU that the DIE was indexed from. */
+	struct drgn_debug_info_module *module;
+	struct drgn_dwarf_index_cache_die die;
+};
+
+/**
+ * DIE with `DW_AT_specification` which will be written to a DWARF index cache
+ * file.
+ */
+struct drgn_dwarf_index_cache_specification_record {
+	/** Module containing the DIE. */
+	struct drgn_debug_info_module *module;
+	struct drgn_dwarf_index_cache_specification specification;
+};
+
+DEFINE_VECTOR(drgn_dwarf_index_cache_vector, struct drgn_dwarf_index_cache)
+DEFINE_VECTOR(drgn_dwarf_index_cache_die_record_vector,
+	      struct drgn_dwarf_index_cache_die_record)
+DEFINE_VECTOR(drgn_dwarf_index_cache_specification_record_vector,
+	      struct drgn_dwarf_index_cache_specification_record)
+
+/** Per-thread DWARF index cache state. */
+struct drgn_dwarf_index_cache_state {
+	/** Cache files which will be indexed instead of reading the module. */
+	struct drgn_dwarf_index_cache_vector opened;
+	/** DIEs indexed from CUs. */
+	struct drgn_dwarf_index_cache_die_record_vector dies;
+	/** DIEs with `DW_AT_specification` indexed from CUs. */
+	struct drgn_dwarf_index_cache_specification_record_vector specifications;
+	/**
+	 * Modules which can't be cached (e.g., because they contain namespaces,
+	 * which are indexed lazily from the CU).
+	 */
+	struct drgn_dwarf_index_module_vector uncacheable;
+};
+
 bool drgn_dwarf_index_state_init(struct drgn_dwarf_index_state *state,
 				 struct drgn_debug_info *dbinfo)
 {
 	state->dbinfo = dbinfo;
-	state->max_threads = omp_get_max_threads();
+	state->max_threads = drgn_program_num_parallel_threads(dbinfo->prog);
 	state->cus = malloc_array(state->max_threads, sizeof(*state->cus));
 	if (!state->cus)
 		return false;
-	for (size_t i = 0; i < state->max_threads; i++)
+	state->names = malloc_array(state->max_threads, sizeof(*state->names));
+	if (!state->names) {
+		free(state->cus);
+		return false;
+	}
+	for (size_t i = 0; i < state->max_threads; i++) {
 		drgn_dwarf_index_pending_cu_vector_init(&state->cus[i]);
+		drgn_dwarf_index_names_vector_init(&state->names[i]);
+	}
+
+	state->cache_dir = getenv("DRGN_DWARF_INDEX_CACHE_DIR");
+	if (state->cache_dir && !state->cache_dir[0])
+		state->cache_dir = NULL;
+	state->cache = NULL;
+	if (state->cache_dir) {
+		state->cache = malloc_array(state->max_threads,
+					    sizeof(*state->cache));
+		if (!state->cache) {
+			drgn_dwarf_index_state_deinit(state);
+			return false;
+		}
+		for (size_t i = 0; i < state->max_threads; i++) {
+			struct drgn_dwarf_index_cache_state *cache =
+				&state->cache[i];
+			drgn_dwarf_index_cache_vector_init(&cache->opened);
+			drgn_dwarf_index_cache_die_record_vector_init(&cache->dies);
+			drgn_dwarf_index_cache_specification_record_vector_init(&cache->specifications);
+			drgn_dwarf_index_module_vector_init(&cache->uncacheable);
+		}
+	}
 	return true;
 }
 
 void drgn_dwarf_index_state_deinit(struct drgn_dwarf_index_state *state)
 {
-	for (size_t i = 0; i < state->max_threads; i++)
+	if (state->cache) {
+		for (size_t i = 0; i < state->max_threads; i++) {
+			struct drgn_dwarf_index_cache_state *cache =
+				&state->cache[i];
+			drgn_dwarf_index_module_vector_deinit(&cache->uncacheable);
+			drgn_dwarf_index_cache_specification_record_vector_deinit(&cache->specifications);
+			drgn_dwarf_index_cache_die_record_vector_deinit(&cache->dies);
+			for (size_t j = 0; j < cache->opened.size; j++)
+				drgn_dwarf_index_cache_close(&cache->opened.data[j]);
+			drgn_dwarf_index_cache_vector_deinit(&cache->opened);
+		}
+		free(state->cache);
+	}
+	for (size_t i = 0; i < state->max_threads; i++) {
+		drgn_dwarf_index_names_vector_deinit(&state->names[i]);
 		drgn_dwarf_index_pending_cu_vector_deinit(&state->cus[i]);
+	}
+	free(state->names);
 	free(state->cus);
 }
 
@@ -589,122 +955,530 @@ drgn_dwarf_index_read_cus(struct drgn_dwarf_index_state *state,
 		}
 		cu->len = buffer.bb.pos - cu->buf;
 		cu->scn = scn;
+		cu->use_debug_names = false;
 	}
 	return NULL;
 }
 
-struct drgn_error *
-drgn_dwarf_index_read_module(struct drgn_dwarf_index_state *state,
-			     struct drgn_debug_info_module *module)
+/*
+ * DWARF 5 .debug_names sections.
+ *
+ * A .debug_names section contains one or more name indexes. Each name index
+ * maps names to the DIEs with that name in a list of CUs. If every entry in a
+ * name index records whether it has a parent, then we can find the top-level
+ * DIEs that we need to index from the name index and only parse those DIEs
+ * instead of every DIE in the CUs.
+ *
+ * We only use name indexes which produce the same index as parsing the CUs.
+ * Other name indexes are ignored and we parse their CUs instead. In particular:
+ *
+ * - Type units are not supported.
+ * - Name indexes with namespace or class entries are not supported, since C++
+ *   relies on DW_AT_specification, which is only found by parsing every DIE.
+ * - Name indexes without any enumerators are assumed to be from a producer
+ *   that doesn't index enumerators, in which case we would miss the
+ *   enumerators of anonymous enumerated types.
+ */
+
+struct drgn_debug_names_attrib {
+	/* DW_IDX_*. */
+	uint64_t idx;
+	/* DW_FORM_*. */
+	uint64_t form;
+};
+
+struct drgn_debug_names_abbrev {
+	uint64_t tag;
+	/* Index of the first attribute in drgn_debug_names::attribs. */
+	size_t attribs;
+	size_t num_attribs;
+};
+
+DEFINE_VECTOR(drgn_debug_names_attrib_vector, struct drgn_debug_names_attrib)
+DEFINE_VECTOR(drgn_debug_names_abbrev_vector, struct drgn_debug_names_abbrev)
+
+/* Parsed header and abbreviation table of a .debug_names name index. */
+struct drgn_debug_names {
+	bool is_64_bit;
+	uint32_t comp_unit_count;
+	uint32_t name_count;
+	const char *cu_list;
+	const char *str_offsets;
+	const char *entry_offsets;
+	const char *entry_pool;
+	const char *end;
+	/* Indexed on the abbreviation code minus one. */
+	struct drgn_debug_names_abbrev_vector abbrevs;
+	struct drgn_debug_names_attrib_vector attribs;
+};
+
+static void drgn_debug_names_deinit(struct drgn_debug_names *names)
 {
-	struct drgn_error *err;
-	err = drgn_dwarf_index_read_cus(state, module, DRGN_SCN_DEBUG_INFO);
-	if (!err && module->scn_data[DRGN_SCN_DEBUG_TYPES]) {
-		err = drgn_dwarf_index_read_cus(state, module,
-						DRGN_SCN_DEBUG_TYPES);
+	drgn_debug_names_abbrev_vector_deinit(&names->abbrevs);
+	drgn_debug_names_attrib_vector_deinit(&names->attribs);
+}
+
+static bool debug_names_form_is_supported(uint64_t form)
+{
+	switch (form) {
+	case DW_FORM_flag_present:
+	case DW_FORM_data1:
+	case DW_FORM_data2:
+	case DW_FORM_data4:
+	case DW_FORM_data8:
+	case DW_FORM_udata:
+	case DW_FORM_ref1:
+	case DW_FORM_ref2:
+	case DW_FORM_ref4:
+	case DW_FORM_ref8:
+	case DW_FORM_ref_udata:
+		return true;
+	default:
+		return false;
 	}
-	return err;
 }
 
-static struct drgn_error *dw_form_to_insn(struct drgn_dwarf_index_cu *cu,
-					  struct binary_buffer *bb,
-					  uint64_t form, uint8_t *insn_ret)
+static struct drgn_error *debug_names_read_form(struct binary_buffer *bb,
+						uint64_t form, uint64_t *ret)
 {
-	struct drgn_error *err;
 	switch (form) {
-	case DW_FORM_addr:
-		*insn_ret = cu->address_size;
+	case DW_FORM_flag_present:
+		*ret = 1;
 		return NULL;
 	case DW_FORM_data1:
 	case DW_FORM_ref1:
-	case DW_FORM_flag:
-	case DW_FORM_strx1:
-	case DW_FORM_addrx1:
-		*insn_ret = 1;
-		return NULL;
+		return binary_buffer_next_u8_into_u64(bb, ret);
 	case DW_FORM_data2:
 	case DW_FORM_ref2:
-	case DW_FORM_strx2:
-	case DW_FORM_addrx2:
-		*insn_ret = 2;
-		return NULL;
-	case DW_FORM_strx3:
-	case DW_FORM_addrx3:
-		*insn_ret = 3;
-		return NULL;
+		return binary_buffer_next_u16_into_u64(bb, ret);
 	case DW_FORM_data4:
 	case DW_FORM_ref4:
-	case DW_FORM_ref_sup4:
-	case DW_FORM_strx4:
-	case DW_FORM_addrx4:
-		*insn_ret = 4;
-		return NULL;
+		return binary_buffer_next_u32_into_u64(bb, ret);
 	case DW_FORM_data8:
 	case DW_FORM_ref8:
-	case DW_FORM_ref_sig8:
-	case DW_FORM_ref_sup8:
-		*insn_ret = 8;
-		return NULL;
-	case DW_FORM_data16:
-		*insn_ret = 16;
-		return NULL;
-	case DW_FORM_block:
-	case DW_FORM_exprloc:
-		*insn_ret = INSN_SKIP_BLOCK;
-		return NULL;
-	case DW_FORM_block1:
-		*insn_ret = INSN_SKIP_BLOCK1;
-		return NULL;
-	case DW_FORM_block2:
-		*insn_ret = INSN_SKIP_BLOCK2;
-		return NULL;
-	case DW_FORM_block4:
-		*insn_ret = INSN_SKIP_BLOCK4;
-		return NULL;
-	case DW_FORM_sdata:
+		return binary_buffer_next_u64(bb, ret);
 	case DW_FORM_udata:
 	case DW_FORM_ref_udata:
-	case DW_FORM_strx:
-	case DW_FORM_addrx:
-	case DW_FORM_loclistx:
-	case DW_FORM_rnglistx:
-		*insn_ret = INSN_SKIP_LEB128;
-		return NULL;
-	case DW_FORM_ref_addr:
-		if (cu->version < 3) {
-			*insn_ret = cu->address_size;
-			return NULL;
-		}
-		/* fallthrough */
-	case DW_FORM_sec_offset:
-	case DW_FORM_strp:
-	case DW_FORM_strp_sup:
-	case DW_FORM_line_strp:
-	case DW_FORM_GNU_ref_alt:
-	case DW_FORM_GNU_strp_alt:
-		*insn_ret = cu->is_64_bit ? 8 : 4;
-		return NULL;
-	case DW_FORM_string:
-		*insn_ret = INSN_SKIP_STRING;
-		return NULL;
-	case DW_FORM_implicit_const:
-		if ((err = binary_buffer_skip_leb128(bb)))
-			return err;
-		/* fallthrough */
-	case DW_FORM_flag_present:
-		*insn_ret = 0;
-		return NULL;
-	case DW_FORM_indirect:
-		*insn_ret = INSN_INDIRECT;
-		return NULL;
+		return binary_buffer_next_uleb128(bb, ret);
 	default:
-		return binary_buffer_error(bb,
-					   "unknown attribute form %#" PRIx64,
-					   form);
+		/* Checked by debug_names_form_is_supported(). */
+		UNREACHABLE();
 	}
 }
 
-static struct drgn_error *dw_at_sibling_to_insn(struct binary_buffer *bb,
+/*
+ * Parse the name index at the current position of buffer and advance buffer
+ * past it. If the name index is one that we can use, *usable_ret is set to true
+ * and names must be deinitialized with drgn_debug_names_deinit().
+ */
+static struct drgn_error *
+drgn_debug_names_parse(struct drgn_debug_info_buffer *buffer,
+		       struct drgn_debug_names *names, bool *usable_ret)
+{
+	struct drgn_error *err;
+
+	*usable_ret = false;
+
+	uint32_t unit_length32;
+	if ((err = binary_buffer_next_u32(&buffer->bb, &unit_length32)))
+		return err;
+	names->is_64_bit = unit_length32 == UINT32_C(0xffffffff);
+	uint64_t unit_length;
+	if (names->is_64_bit) {
+		if ((err = binary_buffer_next_u64(&buffer->bb, &unit_length)))
+			return err;
+	} else {
+		unit_length = unit_length32;
+	}
+	if (unit_length > buffer->bb.end - buffer->bb.pos) {
+		return binary_buffer_error(&buffer->bb,
+					   "name index length is out of bounds");
+	}
+	names->end = buffer->bb.pos + unit_length;
+
+	/* Parse the rest of the name index without going past its end. */
+	struct drgn_debug_info_buffer unit = *buffer;
+	unit.bb.end = names->end;
+	buffer->bb.pos = names->end;
+
+	uint16_t version;
+	if ((err = binary_buffer_next_u16(&unit.bb, &version)))
+		return err;
+	if (version != 5)
+		return NULL;
+	uint32_t local_type_unit_count, foreign_type_unit_count;
+	uint32_t bucket_count, abbrev_table_size, augmentation_string_size;
+	if ((err = binary_buffer_skip(&unit.bb, 2)) || /* padding */
+	    (err = binary_buffer_next_u32(&unit.bb, &names->comp_unit_count)) ||
+	    (err = binary_buffer_next_u32(&unit.bb, &local_type_unit_count)) ||
+	    (err = binary_buffer_next_u32(&unit.bb,
+					  &foreign_type_unit_count)) ||
+	    (err = binary_buffer_next_u32(&unit.bb, &bucket_count)) ||
+	    (err = binary_buffer_next_u32(&unit.bb, &names->name_count)) ||
+	    (err = binary_buffer_next_u32(&unit.bb, &abbrev_table_size)) ||
+	    (err = binary_buffer_next_u32(&unit.bb,
+					  &augmentation_string_size)) ||
+	    (err = binary_buffer_skip(&unit.bb, augmentation_string_size)))
+		return err;
+	if (local_type_unit_count || foreign_type_unit_count)
+		return NULL;
+
+	uint64_t offset_size = names->is_64_bit ? 8 : 4;
+	names->cu_list = unit.bb.pos;
+	if ((err = binary_buffer_skip(&unit.bb,
+				      names->comp_unit_count * offset_size)))
+		return err;
+	/*
+	 * We iterate over every name, so we don't need the hash table (the
+	 * array of buckets followed by the array of hashes, which is only
+	 * present if there are buckets).
+	 */
+	if (bucket_count &&
+	    (err = binary_buffer_skip(&unit.bb,
+				      (bucket_count +
+				       (uint64_t)names->name_count) * 4)))
+		return err;
+	names->str_offsets = unit.bb.pos;
+	if ((err = binary_buffer_skip(&unit.bb,
+				      names->name_count * offset_size)))
+		return err;
+	names->entry_offsets = unit.bb.pos;
+	if ((err = binary_buffer_skip(&unit.bb,
+				      names->name_count * offset_size)))
+		return err;
+	if (abbrev_table_size > unit.bb.end - unit.bb.pos) {
+		return binary_buffer_error(&unit.bb,
+					   "name index abbreviation table is out of bounds");
+	}
+	names->entry_pool = unit.bb.pos + abbrev_table_size;
+	unit.bb.end = names->entry_pool;
+
+	drgn_debug_names_abbrev_vector_init(&names->abbrevs);
+	drgn_debug_names_attrib_vector_init(&names->attribs);
+	bool has_enumerators = false;
+	for (;;) {
+		uint64_t code;
+		if ((err = binary_buffer_next_uleb128(&unit.bb, &code)))
+			goto err;
+		if (code == 0)
+			break;
+		/* As with DIE abbreviations, we assume sequential codes. */
+		if (code != names->abbrevs.size + 1)
+			goto unusable;
+		struct drgn_debug_names_abbrev *abbrev =
+			drgn_debug_names_abbrev_vector_append_entry(&names->abbrevs);
+		if (!abbrev) {
+			err = &drgn_enomem;
+			goto err;
+		}
+		if ((err = binary_buffer_next_uleb128(&unit.bb, &abbrev->tag)))
+			goto err;
+		if (abbrev->tag == DW_TAG_namespace ||
+		    abbrev->tag == DW_TAG_class_type)
+			goto unusable;
+		if (abbrev->tag == DW_TAG_enumerator)
+			has_enumerators = true;
+		abbrev->attribs = names->attribs.size;
+
+		bool has_compile_unit = false;
+		bool has_die_offset = false;
+		bool has_parent = false;
+		for (;;) {
+			struct drgn_debug_names_attrib attrib;
+			if ((err = binary_buffer_next_uleb128(&unit.bb,
+							      &attrib.idx)) ||
+			    (err = binary_buffer_next_uleb128(&unit.bb,
+							      &attrib.form)))
+				goto err;
+			if (attrib.idx == 0 && attrib.form == 0)
+				break;
+			if (!debug_names_form_is_supported(attrib.form))
+				goto unusable;
+			if (attrib.idx == DW_IDX_compile_unit)
+				has_compile_unit = true;
+			else if (attrib.idx == DW_IDX_die_offset)
+				has_die_offset = true;
+			else if (attrib.idx == DW_IDX_parent)
+				has_parent = true;
+			if (!drgn_debug_names_attrib_vector_append(&names->attribs,
+								   &attrib)) {
+				err = &drgn_enomem;
+				goto err;
+			}
+		}
+		abbrev->num_attribs = names->attribs.size - abbrev->attribs;
+		/*
+		 * Without DW_IDX_parent, we can't tell whether an entry is a
+		 * top-level DIE.
+		 */
+		if (!has_die_offset || !has_parent ||
+		    (!has_compile_unit && names->comp_unit_count != 1))
+			goto unusable;
+	}
+	if (!has_enumerators)
+		goto unusable;
+	*usable_ret = true;
+	return NULL;
+
+unusable:
+	err = NULL;
+err:
+	drgn_debug_names_deinit(names);
+	return err;
+}
+
+static struct drgn_dwarf_index_pending_cu *
+find_pending_cu(struct drgn_dwarf_index_pending_cu_vector *cus, size_t lo,
+		const char *buf)
+{
+	size_t hi = cus->size;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (cus->data[mid].buf < buf)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo < cus->size && cus->data[lo].buf == buf ? &cus->data[lo] : NULL;
+}
+
+/*
+ * Find the usable name indexes in a module's .debug_names section and mark the
+ * CUs that they cover. The module's .debug_info CUs must have just been read
+ * into the current thread's pending CUs starting at first_cu.
+ */
+static struct drgn_error *
+drgn_dwarf_index_read_names(struct drgn_dwarf_index_state *state,
+			    struct drgn_debug_info_module *module,
+			    size_t first_cu)
+{
+	struct drgn_error *err;
+	struct drgn_dwarf_index_pending_cu_vector *cus =
+		&state->cus[omp_get_thread_num()];
+	struct drgn_dwarf_index_names_vector *names_vector =
+		&state->names[omp_get_thread_num()];
+	size_t old_names_size = names_vector->size;
+	Elf_Data *debug_info = module->scn_data[DRGN_SCN_DEBUG_INFO];
+
+	struct drgn_debug_info_buffer buffer;
+	drgn_debug_info_buffer_init(&buffer, module, DRGN_SCN_DEBUG_NAMES);
+	while (binary_buffer_has_next(&buffer.bb)) {
+		const char *buf = buffer.bb.pos;
+		struct drgn_debug_names names;
+		bool usable;
+		if ((err = drgn_debug_names_parse(&buffer, &names, &usable)))
+			goto err;
+		if (!usable)
+			continue;
+		size_t offset_size = names.is_64_bit ? 8 : 4;
+		const char *cu_list_end =
+			names.cu_list + names.comp_unit_count * offset_size;
+		drgn_debug_names_deinit(&names);
+
+		/*
+		 * Every CU in the name index must be one that we read. Check
+		 * them all before marking any of them.
+		 */
+		for (int mark = 0; mark < 2; mark++) {
+			struct binary_buffer cu_list = buffer.bb;
+			cu_list.pos = names.cu_list;
+			cu_list.end = cu_list_end;
+			while (binary_buffer_has_next(&cu_list)) {
+				uint64_t offset;
+				if ((err = binary_buffer_next_uint(&cu_list,
+								   offset_size,
+								   &offset)))
+					goto err;
+				struct drgn_dwarf_index_pending_cu *cu = NULL;
+				if (offset < debug_info->d_size) {
+					cu = find_pending_cu(cus, first_cu,
+							     (char *)debug_info->d_buf
+							     + offset);
+				}
+				if (!cu) {
+					usable = false;
+					break;
+				}
+				if (mark)
+					cu->use_debug_names = true;
+			}
+			if (!usable)
+				break;
+		}
+		if (!usable)
+			continue;
+
+		if (!drgn_dwarf_index_names_vector_append(names_vector,
+							  &(struct drgn_dwarf_index_names){
+								.module = module,
+								.buf = buf,
+								.len = buffer.bb.pos - buf,
+								.first_cu = first_cu,
+								.num_cus = cus->size - first_cu,
+							  })) {
+			err = &drgn_enomem;
+			goto err;
+		}
+	}
+	return NULL;
+
+err:
+	for (size_t i = first_cu; i < cus->size; i++)
+		cus->data[i].use_debug_names = false;
+	names_vector->size = old_names_size;
+	if (err == &drgn_enomem)
+		return err;
+	/*
+	 * A malformed .debug_names section isn't fatal because we can parse the
+	 * CUs instead.
+	 */
+	drgn_error_destroy(err);
+	return NULL;
+}
+
+struct drgn_error *
+drgn_dwarf_index_read_module(struct drgn_dwarf_index_state *state,
+			     struct drgn_debug_info_module *module)
+{
+	struct drgn_error *err;
+
+	/* DIE offsets are stored in 32 bits in struct drgn_dwarf_index_die. */
+	uint64_t size = module->scn_data[DRGN_SCN_DEBUG_INFO]->d_size;
+	if (module->scn_data[DRGN_SCN_DEBUG_TYPES])
+		size += module->scn_data[DRGN_SCN_DEBUG_TYPES]->d_size;
+	if (size > UINT32_MAX) {
+		const char *name = dwfl_module_info(module->dwfl_module, NULL,
+						    NULL, NULL, NULL, NULL,
+						    NULL, NULL);
+		return drgn_error_format(DRGN_ERROR_OTHER,
+					 "%s: debugging information is too large to index",
+					 name);
+	}
+
+	if (state->cache) {
+		struct drgn_dwarf_index_cache_state *cache =
+			&state->cache[omp_get_thread_num()];
+		struct drgn_dwarf_index_cache *opened =
+			drgn_dwarf_index_cache_vector_append_entry(&cache->opened);
+		if (!opened)
+			return &drgn_enomem;
+		/* If we have a valid cache file, we don't need to read CUs. */
+		if (drgn_dwarf_index_cache_open(state->cache_dir, module,
+						opened))
+			return NULL;
+		cache->opened.size--;
+	}
+	size_t first_cu = state->cus[omp_get_thread_num()].size;
+	err = drgn_dwarf_index_read_cus(state, module, DRGN_SCN_DEBUG_INFO);
+	if (!err && state->dbinfo->dwarf.use_debug_names &&
+	    module->scn_data[DRGN_SCN_DEBUG_NAMES])
+		err = drgn_dwarf_index_read_names(state, module, first_cu);
+	if (!err && module->scn_data[DRGN_SCN_DEBUG_TYPES]) {
+		err = drgn_dwarf_index_read_cus(state, module,
+						DRGN_SCN_DEBUG_TYPES);
+	}
+	return err;
+}
+
+static struct drgn_error *dw_form_to_insn(struct drgn_dwarf_index_cu *cu,
+					  struct binary_buffer *bb,
+					  uint64_t form, uint8_t *insn_ret)
+{
+	struct drgn_error *err;
+	switch (form) {
+	case DW_FORM_addr:
+		*insn_ret = cu->address_size;
+		return NULL;
+	case DW_FORM_data1:
+	case DW_FORM_ref1:
+	case DW_FORM_flag:
+	case DW_FORM_strx1:
+	case DW_FORM_addrx1:
+		*insn_ret = 1;
+		return NULL;
+	case DW_FORM_data2:
+	case DW_FORM_ref2:
+	case DW_FORM_strx2:
+	case DW_FORM_addrx2:
+		*insn_ret = 2;
+		return NULL;
+	case DW_FORM_strx3:
+	case DW_FORM_addrx3:
+		*insn_ret = 3;
+		return NULL;
+	case DW_FORM_data4:
+	case DW_FORM_ref4:
+	case DW_FORM_ref_sup4:
+	case DW_FORM_strx4:
+	case DW_FORM_addrx4:
+		*insn_ret = 4;
+		return NULL;
+	case DW_FORM_data8:
+	case DW_FORM_ref8:
+	case DW_FORM_ref_sig8:
+	case DW_FORM_ref_sup8:
+		*insn_ret = 8;
+		return NULL;
+	case DW_FORM_data16:
+		*insn_ret = 16;
+		return NULL;
+	case DW_FORM_block:
+	case DW_FORM_exprloc:
+		*insn_ret = INSN_SKIP_BLOCK;
+		return NULL;
+	case DW_FORM_block1:
+		*insn_ret = INSN_SKIP_BLOCK1;
+		return NULL;
+	case DW_FORM_block2:
+		*insn_ret = INSN_SKIP_BLOCK2;
+		return NULL;
+	case DW_FORM_block4:
+		*insn_ret = INSN_SKIP_BLOCK4;
+		return NULL;
+	case DW_FORM_sdata:
+	case DW_FORM_udata:
+	case DW_FORM_ref_udata:
+	case DW_FORM_strx:
+	case DW_FORM_addrx:
+	case DW_FORM_loclistx:
+	case DW_FORM_rnglistx:
+		*insn_ret = INSN_SKIP_LEB128;
+		return NULL;
+	case DW_FORM_ref_addr:
+		if (cu->version < 3) {
+			*insn_ret = cu->address_size;
+			return NULL;
+		}
+		/* fallthrough */
+	case DW_FORM_sec_offset:
+	case DW_FORM_strp:
+	case DW_FORM_strp_sup:
+	case DW_FORM_line_strp:
+	case DW_FORM_GNU_ref_alt:
+	case DW_FORM_GNU_strp_alt:
+		*insn_ret = cu->is_64_bit ? 8 : 4;
+		return NULL;
+	case DW_FORM_string:
+		*insn_ret = INSN_SKIP_STRING;
+		return NULL;
+	case DW_FORM_implicit_const:
+		if ((err = binary_buffer_skip_leb128(bb)))
+			return err;
+		/* fallthrough */
+	case DW_FORM_flag_present:
+		*insn_ret = 0;
+		return NULL;
+	case DW_FORM_indirect:
+		*insn_ret = INSN_INDIRECT;
+		return NULL;
+	default:
+		return binary_buffer_error(bb,
+					   "unknown attribute form %#" PRIx64,
+					   form);
+	}
+}
+
+static struct drgn_error *dw_at_sibling_to_insn(struct binary_buffer *bb,
 						uint64_t form,
 						uint8_t *insn_ret)
 {
@@ -1146,12 +1920,31 @@ read_abbrev_decl(struct drgn_debug_info_buffer *buffer,
 		if (insn != 0) {
 			if (insn <= INSN_MAX_SKIP) {
 				if (last_insn + insn <= INSN_MAX_SKIP) {
-					insns->data[insns->size - 1] += insn;
+					last_insn += insn;
+					insns->data[insns->size - 1] = last_insn;
 					continue;
 				} else if (last_insn < INSN_MAX_SKIP) {
 					insn = last_insn + insn - INSN_MAX_SKIP;
 					insns->data[insns->size - 1] = INSN_MAX_SKIP;
 				}
+			} else if (insn == INSN_SKIP_LEB128) {
+				/*
+				 * Skip runs of LEB128 attributes (e.g., udata and
+				 * sdata constants) with one instruction.
+				 */
+				if (last_insn == INSN_SKIP_LEB128) {
+					insns->data[insns->size - 1] =
+						INSN_SKIP_LEB128S;
+					insn = 2;
+					last_insn = INSN_SKIP_LEB128S;
+					if (!uint8_vector_append(insns, &insn))
+						return &drgn_enomem;
+					continue;
+				} else if (last_insn == INSN_SKIP_LEB128S &&
+					   insns->data[insns->size - 1] < UINT8_MAX) {
+					insns->data[insns->size - 1]++;
+					continue;
+				}
 			}
 			last_insn = insn;
 
@@ -1889,38 +2682,165 @@ err:
 	return err;
 }
 
-static struct drgn_error *
-index_specification(struct drgn_debug_info *dbinfo, uintptr_t declaration,
-		    struct drgn_debug_info_module *module, uintptr_t addr)
+/*
+ * Get the ID of a file name hash in drgn_dwarf_info::file_name_ids, adding it
+ * if necessary. This only locks the shard of the hash.
+ */
+static bool drgn_dwarf_file_name_id(struct drgn_dwarf_info *dwarf,
+				    uint64_t hash, uint32_t *ret)
 {
-	struct drgn_dwarf_specification entry = {
-		.declaration = declaration,
-		.module = module,
-		.addr = addr,
-	};
-	struct hash_pair hp = drgn_dwarf_specification_map_hash(&declaration);
-	int ret;
-	#pragma omp critical(drgn_index_specification)
-	ret = drgn_dwarf_specification_map_insert_hashed(&dbinfo->dwarf.specifications,
-							 &entry, hp,
-							 NULL);
-	/*
-	 * There may be duplicates if multiple DIEs reference one declaration,
-	 * but we ignore them.
-	 */
-	return ret < 0 ? &drgn_enomem : NULL;
+	if (hash == 0) {
+		*ret = 0;
+		return true;
+	}
+	uint32_t shard = hash >> (64 - DRGN_DWARF_FILE_NAME_ID_SHARD_BITS);
+	struct drgn_dwarf_file_name_id_map *map =
+		&dwarf->file_name_ids.shards[shard];
+	bool success = false;
+	omp_set_lock(&dwarf->file_name_id_locks[shard]);
+	size_t size = drgn_dwarf_file_name_id_map_size(map);
+	if (size < (UINT32_MAX >> DRGN_DWARF_FILE_NAME_ID_SHARD_BITS)) {
+		uint32_t index = size + 1;
+		struct drgn_dwarf_file_name_id_map_entry entry = {
+			.key = hash,
+			.value = (index << DRGN_DWARF_FILE_NAME_ID_SHARD_BITS) |
+				 shard,
+		};
+		struct drgn_dwarf_file_name_id_map_iterator it;
+		if (drgn_dwarf_file_name_id_map_insert(map, &entry, &it) >= 0) {
+			*ret = it.entry->value;
+			success = true;
+		}
+	}
+	omp_unset_lock(&dwarf->file_name_id_locks[shard]);
+	return success;
 }
 
-static struct drgn_error *read_indirect_insn(struct drgn_dwarf_index_cu *cu,
-					     struct binary_buffer *bb,
-					     uint8_t insn, uint8_t *insn_ret,
-					     uint8_t *die_flags)
+/* Get the IDs of the file names read by read_file_name_table(). */
+static struct drgn_error *read_file_name_ids(struct drgn_dwarf_info *dwarf,
+					     struct drgn_dwarf_index_cu *cu)
 {
-	struct drgn_error *err;
-	uint64_t form;
-	if ((err = binary_buffer_next_uleb128(bb, &form)))
-		return err;
-	if (form == DW_FORM_implicit_const) {
+	if (cu->file_name_hashes == no_file_name_hashes)
+		return NULL;
+	uint32_t *ids = malloc_array(cu->num_file_names, sizeof(ids[0]));
+	if (!ids)
+		return &drgn_enomem;
+	for (size_t i = 0; i < cu->num_file_names; i++) {
+		if (!drgn_dwarf_file_name_id(dwarf, cu->file_name_hashes[i],
+					     &ids[i])) {
+			free(ids);
+			return &drgn_enomem;
+		}
+	}
+	cu->file_name_ids = ids;
+	return NULL;
+}
+
+static bool
+drgn_dwarf_index_cache_set_uncacheable(struct drgn_dwarf_index_cache_state *cache,
+				       struct drgn_debug_info_module *module)
+{
+	/* Avoid repeatedly adding the same module in the common case. */
+	if (cache->uncacheable.size &&
+	    cache->uncacheable.data[cache->uncacheable.size - 1] == module)
+		return true;
+	return drgn_dwarf_index_module_vector_append(&cache->uncacheable,
+						     &module);
+}
+
+static bool
+drgn_dwarf_index_cache_add_specification(struct drgn_dwarf_index_cache_state *cache,
+					 uintptr_t declaration,
+					 struct drgn_debug_info_module *module,
+					 uintptr_t addr)
+{
+	struct drgn_dwarf_index_cache_specification_record *record =
+		drgn_dwarf_index_cache_specification_record_vector_append_entry(&cache->specifications);
+	if (!record)
+		return false;
+	record->module = module;
+	if (!drgn_dwarf_index_cache_encode(module, (const char *)declaration,
+					   &record->specification.declaration_scn,
+					   &record->specification.declaration_offset) ||
+	    !drgn_dwarf_index_cache_encode(module, (const char *)addr,
+					   &record->specification.addr_scn,
+					   &record->specification.addr_offset)) {
+		cache->specifications.size--;
+		return drgn_dwarf_index_cache_set_uncacheable(cache, module);
+	}
+	return true;
+}
+
+static bool
+drgn_dwarf_index_cache_add_die(struct drgn_dwarf_index_cache_state *cache,
+			       struct drgn_dwarf_index_cu *cu, const char *name,
+			       uint8_t tag, uint64_t file_name_hash,
+			       struct drgn_debug_info_module *module,
+			       uintptr_t addr)
+{
+	/*
+	 * Namespaces are indexed lazily from the CU, and definitions found in
+	 * another module can't be represented in this module's cache.
+	 */
+	if (tag == DW_TAG_namespace || module != cu->module)
+		return drgn_dwarf_index_cache_set_uncacheable(cache, cu->module);
+	struct drgn_dwarf_index_cache_die_record *record =
+		drgn_dwarf_index_cache_die_record_vector_append_entry(&cache->dies);
+	if (!record)
+		return false;
+	record->module = module;
+	record->die.file_name_hash = file_name_hash;
+	record->die.tag = tag;
+	if (!drgn_dwarf_index_cache_encode(module, name, &record->die.name_scn,
+					   &record->die.name_offset) ||
+	    !drgn_dwarf_index_cache_encode(module, (const char *)addr,
+					   &record->die.addr_scn,
+					   &record->die.addr_offset)) {
+		cache->dies.size--;
+		return drgn_dwarf_index_cache_set_uncacheable(cache, module);
+	}
+	return true;
+}
+
+static struct drgn_error *
+index_specification(struct drgn_debug_info *dbinfo,
+		    struct drgn_dwarf_index_cache_state *cache,
+		    uintptr_t declaration,
+		    struct drgn_debug_info_module *module, uintptr_t addr)
+{
+	if (cache &&
+	    !drgn_dwarf_index_cache_add_specification(cache, declaration,
+						      module, addr))
+		return &drgn_enomem;
+
+	struct drgn_dwarf_specification entry = {
+		.declaration = declaration,
+		.module = module,
+		.addr = addr,
+	};
+	struct hash_pair hp = drgn_dwarf_specification_map_hash(&declaration);
+	int ret;
+	#pragma omp critical(drgn_index_specification)
+	ret = drgn_dwarf_specification_map_insert_hashed(&dbinfo->dwarf.specifications,
+							 &entry, hp,
+							 NULL);
+	/*
+	 * There may be duplicates if multiple DIEs reference one declaration,
+	 * but we ignore them.
+	 */
+	return ret < 0 ? &drgn_enomem : NULL;
+}
+
+static struct drgn_error *read_indirect_insn(struct drgn_dwarf_index_cu *cu,
+					     struct binary_buffer *bb,
+					     uint8_t insn, uint8_t *insn_ret,
+					     uint8_t *die_flags)
+{
+	struct drgn_error *err;
+	uint64_t form;
+	if ((err = binary_buffer_next_uleb128(bb, &form)))
+		return err;
+	if (form == DW_FORM_implicit_const) {
 		return binary_buffer_error(bb,
 					   "DW_FORM_implicit_const in DW_FORM_indirect");
 	}
@@ -1954,6 +2874,7 @@ static struct drgn_error *read_indirect_insn(struct drgn_dwarf_index_cu *cu,
  */
 static struct drgn_error *
 index_cu_first_pass(struct drgn_debug_info *dbinfo,
+		    struct drgn_dwarf_index_cache_state *cache,
 		    struct drgn_dwarf_index_cu_buffer *buffer,
 		    struct path_hash_cache *path_hash_cache)
 {
@@ -2021,6 +2942,11 @@ indirect_insn:;
 									   &skip)))
 					return err;
 				goto skip;
+			case INSN_SKIP_LEB128S:
+				if ((err = binary_buffer_skip_leb128s(&buffer->bb,
+								      *insnp++)))
+					return err;
+				break;
 			case INSN_SKIP_LEB128:
 			case INSN_NAME_STRX:
 			case INSN_DECL_FILE_UDATA:
@@ -2300,7 +3226,9 @@ skip:
 					return err;
 				if ((err = read_file_name_table(path_hash_cache,
 								cu, comp_dir,
-								stmt_list)))
+								stmt_list)) ||
+				    (err = read_file_name_ids(&dbinfo->dwarf,
+							      cu)))
 					return err;
 			}
 		} else if (specification) {
@@ -2313,11 +3241,19 @@ skip:
 			 * DW_AT_specification "chains" in the future.
 			 */
 			if (!declaration &&
-			    (err = index_specification(dbinfo, specification,
+			    (err = index_specification(dbinfo, cache,
+						       specification,
 						       cu->module, die_addr)))
 				return err;
 		}
 
+		/*
+		 * If the CU is indexed from .debug_names, we only need the file
+		 * name table and string offsets from the CU DIE.
+		 */
+		if (depth == 0 && cu->use_debug_names)
+			break;
+
 		if (insn & INSN_DIE_FLAG_CHILDREN) {
 			if (sibling &&
 			    (insn & INSN_DIE_FLAG_TAG_MASK) != DW_TAG_namespace)
@@ -2360,106 +3296,253 @@ drgn_dwarf_find_definition(struct drgn_debug_info *dbinfo, uintptr_t die_addr,
 
 static bool append_die_entry(struct drgn_debug_info *dbinfo,
 			     struct drgn_dwarf_index_shard *shard, uint8_t tag,
-			     uint64_t file_name_hash,
+			     uint32_t file_name_id,
 			     struct drgn_debug_info_module *module,
 			     uintptr_t addr)
 {
-	if (shard->dies.size == UINT32_MAX)
+	if (shard->dies.size == DRGN_DWARF_INDEX_DIE_END)
 		return false;
+	if (tag == DW_TAG_namespace) {
+		struct drgn_namespace_dwarf_index **namespacep =
+			drgn_namespace_dwarf_index_vector_append_entry(&shard->namespaces);
+		if (!namespacep)
+			return false;
+		*namespacep = malloc(sizeof(**namespacep));
+		if (!*namespacep) {
+			shard->namespaces.size--;
+			return false;
+		}
+		drgn_namespace_dwarf_index_init(*namespacep, dbinfo);
+	}
 	struct drgn_dwarf_index_die *die =
 		drgn_dwarf_index_die_vector_append_entry(&shard->dies);
-	if (!die)
+	if (!die) {
+		if (tag == DW_TAG_namespace)
+			free(shard->namespaces.data[--shard->namespaces.size]);
 		return false;
-	die->next = UINT32_MAX;
-	die->tag = tag;
-	if (die->tag == DW_TAG_namespace) {
-		die->namespace = malloc(sizeof(*die->namespace));
-		if (!die->namespace) {
-			shard->dies.size--;
-			return false;
-		}
-		drgn_namespace_dwarf_index_init(die->namespace, dbinfo);
-	} else {
-		die->file_name_hash = file_name_hash;
 	}
-	die->module = module;
-	die->addr = addr;
+	die->next = DRGN_DWARF_INDEX_DIE_END;
+	die->tag = tag;
+	if (tag == DW_TAG_namespace)
+		die->namespace = shard->namespaces.size - 1;
+	else
+		die->file_name_id = file_name_id;
+	die->module = module->dwarf.index_id;
+	die->offset = drgn_dwarf_index_die_offset(module, addr);
 
 	return true;
 }
 
-static bool index_die(struct drgn_namespace_dwarf_index *ns,
-		      struct drgn_dwarf_index_cu *cu, const char *name,
-		      uint8_t tag, uint64_t file_name_hash,
-		      struct drgn_debug_info_module *module, uintptr_t addr)
+/* Index a DIE in a shard, which must be locked. */
+static bool index_die_locked(struct drgn_namespace_dwarf_index *ns,
+			     struct drgn_dwarf_index_shard *shard,
+			     struct drgn_dwarf_index_cu *cu,
+			     const struct nstring *name, struct hash_pair hp,
+			     uint8_t tag, uint32_t file_name_id,
+			     struct drgn_debug_info_module *module,
+			     uintptr_t addr)
 {
-	bool success = false;
-	struct drgn_dwarf_index_die_map_entry entry = {
-		.key = { name, strlen(name) },
-	};
-	struct hash_pair hp = drgn_dwarf_index_die_map_hash(&entry.key);
-	struct drgn_dwarf_index_shard *shard =
-		&ns->shards[hash_pair_to_shard(hp)];
-	omp_set_lock(&shard->lock);
 	struct drgn_dwarf_index_die_map_iterator it =
-		drgn_dwarf_index_die_map_search_hashed(&shard->map, &entry.key,
-						       hp);
+		drgn_dwarf_index_die_map_search_hashed(&shard->map, name, hp);
 	struct drgn_dwarf_index_die *die;
 	if (!it.entry) {
-		if (!append_die_entry(ns->dbinfo, shard, tag, file_name_hash,
+		if (!append_die_entry(ns->dbinfo, shard, tag, file_name_id,
 				      module, addr))
-			goto err;
-		entry.value = shard->dies.size - 1;
+			return false;
+		struct drgn_dwarf_index_die_map_entry entry = {
+			.key = *name,
+			.value = shard->dies.size - 1,
+		};
 		if (drgn_dwarf_index_die_map_insert_searched(&shard->map,
 							     &entry, hp,
 							     NULL) < 0)
-			goto err;
+			return false;
 		die = &shard->dies.data[shard->dies.size - 1];
 		goto out;
 	}
 
 	die = &shard->dies.data[it.entry->value];
 	for (;;) {
-		const uint64_t die_file_name_hash =
-			die->tag == DW_TAG_namespace ? 0 : die->file_name_hash;
-		if (die->tag == tag && die_file_name_hash == file_name_hash)
+		const uint32_t die_file_name_id =
+			die->tag == DW_TAG_namespace ? 0 : die->file_name_id;
+		if (die->tag == tag && die_file_name_id == file_name_id)
 			goto out;
 
-		if (die->next == UINT32_MAX)
+		if (die->next == DRGN_DWARF_INDEX_DIE_END)
 			break;
 		die = &shard->dies.data[die->next];
 	}
 
 	size_t index = die - shard->dies.data;
-	if (!append_die_entry(ns->dbinfo, shard, tag, file_name_hash, module,
+	if (!append_die_entry(ns->dbinfo, shard, tag, file_name_id, module,
 			      addr))
-		goto err;
+		return false;
 	die = &shard->dies.data[shard->dies.size - 1];
 	shard->dies.data[index].next = shard->dies.size - 1;
 out:
 	if (tag == DW_TAG_namespace) {
 		struct drgn_dwarf_index_pending_die *pending =
-			drgn_dwarf_index_pending_die_vector_append_entry(&die->namespace->pending_dies);
+			drgn_dwarf_index_pending_die_vector_append_entry(&shard->namespaces.data[die->namespace]->pending_dies);
 		if (!pending)
-			goto err;
+			return false;
 		pending->cu = cu - ns->dbinfo->dwarf.index_cus.data;
 		pending->addr = addr;
 	}
-	success = true;
-err:
+	return true;
+}
+
+static bool index_die(struct drgn_namespace_dwarf_index *ns,
+		      struct drgn_dwarf_index_cu *cu, const char *name,
+		      uint8_t tag, uint32_t file_name_id,
+		      struct drgn_debug_info_module *module, uintptr_t addr)
+{
+	struct nstring key = { name, strlen(name) };
+	struct hash_pair hp = drgn_dwarf_index_die_map_hash(&key);
+	struct drgn_dwarf_index_shard *shard =
+		&ns->shards[hash_pair_to_shard(hp)];
+	omp_set_lock(&shard->lock);
+	bool success = index_die_locked(ns, shard, cu, &key, hp, tag,
+					file_name_id, module, addr);
+	omp_unset_lock(&shard->lock);
+	return success;
+}
+
+/**
+ * Maximum number of DIEs that a thread batches for each shard before indexing
+ * them.
+ */
+#define DRGN_DWARF_INDEX_DIE_BATCH_SIZE 32
+
+/** DIE found by the second pass that is batched until its shard is locked. */
+struct drgn_dwarf_index_batched_die {
+	struct nstring name;
+	struct hash_pair hp;
+	struct drgn_dwarf_index_cu *cu;
+	struct drgn_debug_info_module *module;
+	uintptr_t addr;
+	uint32_t file_name_id;
+	uint8_t tag;
+};
+
+/**
+ * DIEs batched by one thread during the second pass.
+ *
+ * Taking a shard lock for every DIE scales poorly with many threads, so each
+ * thread collects DIEs per shard and indexes a whole batch each time it takes a
+ * lock.
+ */
+struct drgn_dwarf_index_die_batch {
+	/** Number of DIEs batched for each shard. */
+	uint8_t size[1 << DRGN_DWARF_INDEX_SHARD_BITS];
+	struct drgn_dwarf_index_batched_die
+		dies[1 << DRGN_DWARF_INDEX_SHARD_BITS]
+		    [DRGN_DWARF_INDEX_DIE_BATCH_SIZE];
+};
+
+static struct drgn_dwarf_index_die_batch *
+drgn_dwarf_index_die_batch_create(void)
+{
+	struct drgn_dwarf_index_die_batch *batch = malloc(sizeof(*batch));
+	if (batch)
+		memset(batch->size, 0, sizeof(batch->size));
+	return batch;
+}
+
+/* Index the DIEs batched for a shard. */
+static bool flush_die_batch(struct drgn_namespace_dwarf_index *ns,
+			    struct drgn_dwarf_index_die_batch *batch,
+			    size_t shard_index)
+{
+	size_t n = batch->size[shard_index];
+	if (!n)
+		return true;
+	batch->size[shard_index] = 0;
+	struct drgn_dwarf_index_shard *shard = &ns->shards[shard_index];
+	bool success = true;
+	omp_set_lock(&shard->lock);
+	for (size_t i = 0; i < n; i++) {
+		struct drgn_dwarf_index_batched_die *die =
+			&batch->dies[shard_index][i];
+		if (!index_die_locked(ns, shard, die->cu, &die->name, die->hp,
+				      die->tag, die->file_name_id, die->module,
+				      die->addr)) {
+			success = false;
+			break;
+		}
+	}
 	omp_unset_lock(&shard->lock);
 	return success;
 }
 
-/* Second pass: index the actual DIEs. */
+/*
+ * Index the DIEs remaining in a batch. Each thread starts at a different shard
+ * so that they don't all contend for the same locks.
+ */
+static bool flush_die_batches(struct drgn_namespace_dwarf_index *ns,
+			      struct drgn_dwarf_index_die_batch *batch)
+{
+	size_t start = omp_get_thread_num() % DRGN_DWARF_INDEX_NUM_SHARDS;
+	for (size_t i = 0; i < DRGN_DWARF_INDEX_NUM_SHARDS; i++) {
+		if (!flush_die_batch(ns, batch,
+				     (start + i) % DRGN_DWARF_INDEX_NUM_SHARDS))
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Index a DIE, or add it to a batch if batch is not NULL. The batch must be
+ * flushed with flush_die_batches() before the DIEs are guaranteed to be
+ * indexed.
+ */
+static bool batch_die(struct drgn_namespace_dwarf_index *ns,
+		      struct drgn_dwarf_index_die_batch *batch,
+		      struct drgn_dwarf_index_cu *cu, const char *name,
+		      uint8_t tag, uint32_t file_name_id,
+		      struct drgn_debug_info_module *module, uintptr_t addr)
+{
+	if (!batch)
+		return index_die(ns, cu, name, tag, file_name_id, module, addr);
+	struct nstring key = { name, strlen(name) };
+	struct hash_pair hp = drgn_dwarf_index_die_map_hash(&key);
+	size_t shard_index = hash_pair_to_shard(hp);
+	if (batch->size[shard_index] == DRGN_DWARF_INDEX_DIE_BATCH_SIZE &&
+	    !flush_die_batch(ns, batch, shard_index))
+		return false;
+	batch->dies[shard_index][batch->size[shard_index]++] =
+		(struct drgn_dwarf_index_batched_die){
+			.name = key,
+			.hp = hp,
+			.cu = cu,
+			.module = module,
+			.addr = addr,
+			.file_name_id = file_name_id,
+			.tag = tag,
+		};
+	return true;
+}
+
+/*
+ * Second pass: index the actual DIEs. If cache is not NULL, the DIEs are also
+ * recorded so that they can be written to the DWARF index cache. If batch is
+ * not NULL, the DIEs are batched with batch_die().
+ *
+ * If top_level_name is not NULL, then the buffer is positioned at a top-level
+ * DIE found in a .debug_names name index, and only that DIE (and its children
+ * if it is an enumerated type) is indexed with the given name.
+ */
 static struct drgn_error *
 index_cu_second_pass(struct drgn_namespace_dwarf_index *ns,
-		     struct drgn_dwarf_index_cu_buffer *buffer)
+		     struct drgn_dwarf_index_cache_state *cache,
+		     struct drgn_dwarf_index_die_batch *batch,
+		     struct drgn_dwarf_index_cu_buffer *buffer,
+		     const char *top_level_name)
 {
 	struct drgn_error *err;
 	struct drgn_dwarf_index_cu *cu = buffer->cu;
 	Elf_Data *debug_str = cu->module->scn_data[DRGN_SCN_DEBUG_STR];
-	unsigned int depth = 0;
+	const unsigned int start_depth = top_level_name ? 1 : 0;
+	unsigned int depth = start_depth;
 	uint8_t depth1_tag = 0;
 	size_t depth1_addr = 0;
 	for (;;) {
@@ -2469,7 +3552,7 @@ index_cu_second_pass(struct drgn_namespace_dwarf_index *ns,
 		if ((err = binary_buffer_next_uleb128(&buffer->bb, &code)))
 			return err;
 		if (code == 0) {
-			if (depth-- > 1)
+			if (depth-- > start_depth + 1)
 				continue;
 			else
 				break;
@@ -2512,6 +3595,11 @@ indirect_insn:;
 									   &skip)))
 					return err;
 				goto skip;
+			case INSN_SKIP_LEB128S:
+				if ((err = binary_buffer_skip_leb128s(&buffer->bb,
+								      *insnp++)))
+					return err;
+				break;
 			case INSN_SPECIFICATION_REF_UDATA:
 				specification = true;
 				/* fallthrough */
@@ -2749,6 +3837,23 @@ skip:
 		if (depth == 1) {
 			depth1_tag = tag;
 			depth1_addr = die_addr;
+			/*
+			 * The name index may also have entries for other names
+			 * of the DIE, like DW_AT_linkage_name, which we ignore.
+			 * It also has entries for definitions with
+			 * DW_AT_specification, whose name comes from the
+			 * declaration. We have no other way to find the
+			 * declaration, so we index the definition directly.
+			 */
+			if (top_level_name && tag) {
+				if (name && name != top_level_name &&
+				    strcmp(name, top_level_name) != 0) {
+					name = NULL;
+				} else if (!name && specification) {
+					name = top_level_name;
+					specification = false;
+				}
+			}
 		}
 		if (depth == (tag == DW_TAG_enumerator ? 2 : 1) && name &&
 		    !specification) {
@@ -2774,6 +3879,7 @@ skip:
 			}
 
 			uint64_t file_name_hash;
+			uint32_t file_name_id;
 			if (decl_file_ptr) {
 				if (decl_file >= cu->num_file_names) {
 					return binary_buffer_error_at(&buffer->bb,
@@ -2782,11 +3888,19 @@ skip:
 								      decl_file);
 				}
 				file_name_hash = cu->file_name_hashes[decl_file];
+				file_name_id = cu->file_name_ids[decl_file];
 			} else {
 				file_name_hash = 0;
+				file_name_id = 0;
 			}
-			if (!index_die(ns, cu, name, tag, file_name_hash,
-				       module, die_addr))
+			if (!batch_die(ns, batch, cu, name, tag, file_name_id,
+				       module, die_addr) ||
+			    (cache &&
+			     !drgn_dwarf_index_cache_add_die(cache, cu, name,
+							     tag,
+							     file_name_hash,
+							     module,
+							     die_addr)))
 				return &drgn_enomem;
 		}
 
@@ -2798,20 +3912,233 @@ next:
 			 * over the children of the top-level DIE even if it has
 			 * a sibling pointer.
 			 */
+			if (top_level_name && depth == 1 &&
+			    tag != DW_TAG_enumeration_type)
+				break;
 			if (sibling && tag != DW_TAG_enumeration_type &&
 			    depth > 0)
 				buffer->bb.pos = sibling;
 			else
 				depth++;
-		} else if (depth == 0) {
+		} else if (depth == start_depth) {
 			break;
 		}
 	}
 	return NULL;
 }
 
+static struct drgn_dwarf_index_cu *
+find_index_cu(struct drgn_dwarf_index_cu_vector *cus, size_t lo, size_t hi,
+	      const char *buf)
+{
+	size_t end = hi;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (cus->data[mid].buf < buf)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo < end && cus->data[lo].buf == buf ? &cus->data[lo] : NULL;
+}
+
+/* Index the entries for one name in a .debug_names name index. */
+static struct drgn_error *
+index_debug_names_name(struct drgn_namespace_dwarf_index *ns,
+		       struct drgn_dwarf_index_cache_state *cache,
+		       struct drgn_debug_info_module *module,
+		       const struct drgn_debug_names *names,
+		       struct drgn_dwarf_index_cu **unit_cus, size_t i)
+{
+	struct drgn_error *err;
+	size_t offset_size = names->is_64_bit ? 8 : 4;
+	Elf_Data *debug_str = module->scn_data[DRGN_SCN_DEBUG_STR];
+
+	struct drgn_debug_info_buffer buffer;
+	drgn_debug_info_buffer_init(&buffer, module, DRGN_SCN_DEBUG_NAMES);
+	uint64_t str_offset, entry_offset;
+	buffer.bb.pos = names->str_offsets + i * offset_size;
+	if ((err = binary_buffer_next_uint(&buffer.bb, offset_size,
+					   &str_offset)))
+		return err;
+	if (!debug_str || str_offset >= debug_str->d_size) {
+		return binary_buffer_error(&buffer.bb,
+					   "name index string offset is out of bounds");
+	}
+	const char *name = (const char *)debug_str->d_buf + str_offset;
+	buffer.bb.pos = names->entry_offsets + i * offset_size;
+	if ((err = binary_buffer_next_uint(&buffer.bb, offset_size,
+					   &entry_offset)))
+		return err;
+	if (entry_offset >= names->end - names->entry_pool) {
+		return binary_buffer_error(&buffer.bb,
+					   "name index entry offset is out of bounds");
+	}
+	buffer.bb.pos = names->entry_pool + entry_offset;
+	buffer.bb.end = names->end;
+
+	for (;;) {
+		uint64_t code;
+		if ((err = binary_buffer_next_uleb128(&buffer.bb, &code)))
+			return err;
+		if (code == 0)
+			return NULL;
+		if (code > names->abbrevs.size) {
+			return binary_buffer_error(&buffer.bb,
+						   "unknown name index abbreviation code %" PRIu64,
+						   code);
+		}
+		const struct drgn_debug_names_abbrev *abbrev =
+			&names->abbrevs.data[code - 1];
+
+		uint64_t cu_index = 0, die_offset = 0;
+		bool top_level = false;
+		for (size_t j = 0; j < abbrev->num_attribs; j++) {
+			const struct drgn_debug_names_attrib *attrib =
+				&names->attribs.data[abbrev->attribs + j];
+			uint64_t value;
+			if ((err = debug_names_read_form(&buffer.bb,
+							 attrib->form, &value)))
+				return err;
+			if (attrib->idx == DW_IDX_compile_unit) {
+				cu_index = value;
+			} else if (attrib->idx == DW_IDX_die_offset) {
+				die_offset = value;
+			} else if (attrib->idx == DW_IDX_parent) {
+				/*
+				 * DW_FORM_flag_present means that the DIE has
+				 * no parent in the name index. Any other form
+				 * is a reference to the parent's entry.
+				 */
+				top_level = attrib->form == DW_FORM_flag_present;
+			}
+		}
+		/*
+		 * Like the second pass, we only index top-level DIEs.
+		 * Enumerators of top-level enumerated types are indexed along
+		 * with the enumerated type's entry.
+		 */
+		if (!top_level)
+			continue;
+
+		if (cu_index >= names->comp_unit_count) {
+			return binary_buffer_error(&buffer.bb,
+						   "invalid name index CU index %" PRIu64,
+						   cu_index);
+		}
+		struct drgn_dwarf_index_cu *cu = unit_cus[cu_index];
+		if (die_offset < cu_header_size(cu) || die_offset >= cu->len) {
+			return binary_buffer_error(&buffer.bb,
+						   "name index DIE offset is out of bounds");
+		}
+		uintptr_t die_addr = (uintptr_t)cu->buf + die_offset;
+		if (abbrev->tag == DW_TAG_enumerator) {
+			/*
+			 * This is an enumerator of an anonymous enumerated
+			 * type, which isn't in the name index. We can't easily
+			 * find the enumeration_type DIE from here, so unlike
+			 * the second pass, the enumerator name points to the
+			 * enumerator DIE itself. See
+			 * drgn_debug_info_find_object().
+			 */
+			if (!index_die(ns, cu, name, DW_TAG_enumerator, 0,
+				       module, die_addr) ||
+			    (cache &&
+			     !drgn_dwarf_index_cache_add_die(cache, cu, name,
+							     DW_TAG_enumerator,
+							     0, module,
+							     die_addr)))
+				return &drgn_enomem;
+		} else {
+			struct drgn_dwarf_index_cu_buffer die_buffer;
+			drgn_dwarf_index_cu_buffer_init(&die_buffer, cu);
+			die_buffer.bb.pos = (const char *)die_addr;
+			if ((err = index_cu_second_pass(ns, cache, NULL,
+							&die_buffer, name)))
+				return err;
+		}
+	}
+}
+
+/*
+ * Index the CUs covered by a .debug_names name index. This must be called after
+ * the first pass on the CUs.
+ */
+static struct drgn_error *
+index_debug_names(struct drgn_debug_info *dbinfo,
+		  struct drgn_dwarf_index_cache_state *cache,
+		  const struct drgn_dwarf_index_names *index_names)
+{
+	struct drgn_error *err;
+	struct drgn_debug_info_module *module = index_names->module;
+	const char *debug_info = module->scn_data[DRGN_SCN_DEBUG_INFO]->d_buf;
+
+	struct drgn_debug_info_buffer buffer;
+	drgn_debug_info_buffer_init(&buffer, module, DRGN_SCN_DEBUG_NAMES);
+	buffer.bb.pos = index_names->buf;
+	struct drgn_debug_names names;
+	bool usable;
+	if ((err = drgn_debug_names_parse(&buffer, &names, &usable)))
+		return err;
+	/* Checked by drgn_dwarf_index_read_names(). */
+	assert(usable);
+
+	size_t offset_size = names.is_64_bit ? 8 : 4;
+	struct drgn_dwarf_index_cu **unit_cus =
+		malloc_array(names.comp_unit_count, sizeof(unit_cus[0]));
+	if (!unit_cus && names.comp_unit_count) {
+		err = &drgn_enomem;
+		goto out;
+	}
+	buffer.bb.pos = names.cu_list;
+	for (uint32_t i = 0; i < names.comp_unit_count; i++) {
+		uint64_t offset;
+		if ((err = binary_buffer_next_uint(&buffer.bb, offset_size,
+						   &offset)))
+			goto out;
+		unit_cus[i] = find_index_cu(&dbinfo->dwarf.index_cus,
+					    index_names->first_cu,
+					    index_names->first_cu +
+					    index_names->num_cus,
+					    debug_info + offset);
+		/* Also checked by drgn_dwarf_index_read_names(). */
+		assert(unit_cus[i]);
+	}
+
+	#pragma omp parallel for schedule(dynamic) \
+		num_threads(drgn_program_num_parallel_threads(dbinfo->prog))
+	for (size_t i = 0; i < names.name_count; i++) {
+		drgn_program_bind_parallel_thread(dbinfo->prog);
+		if (err)
+			continue;
+		struct drgn_dwarf_index_cache_state *thread_cache =
+			cache ? &cache[omp_get_thread_num()] : NULL;
+		struct drgn_error *name_err =
+			index_debug_names_name(&dbinfo->dwarf.global,
+					       thread_cache, module, &names,
+					       unit_cus, i);
+		if (name_err) {
+			#pragma omp critical(drgn_dwarf_info_update_index_error)
+			if (err)
+				drgn_error_destroy(name_err);
+			else
+				err = name_err;
+		}
+	}
+
+out:
+	free(unit_cus);
+	drgn_debug_names_deinit(&names);
+	return err;
+}
+
 static void drgn_dwarf_index_rollback(struct drgn_debug_info *dbinfo)
 {
+	struct drgn_debug_info_module **modules =
+		dbinfo->dwarf.index_modules.data;
+	/* The canonical names may refer to the modules being rolled back. */
+	drgn_dwarf_canonical_names_destroy(dbinfo->dwarf.global.canonical_names);
+	dbinfo->dwarf.global.canonical_names = NULL;
 	for (size_t i = 0; i < DRGN_DWARF_INDEX_NUM_SHARDS; i++) {
 		struct drgn_dwarf_index_shard *shard =
 			&dbinfo->dwarf.global.shards[i];
@@ -2823,12 +4150,15 @@ static void drgn_dwarf_index_rollback(struct drgn_debug_info *dbinfo)
 		while (shard->dies.size) {
 			struct drgn_dwarf_index_die *die =
 				&shard->dies.data[shard->dies.size - 1];
-			if (die->module->state ==
+			if (modules[die->module]->state ==
 			    DRGN_DEBUG_INFO_MODULE_INDEXED)
 				break;
 			if (die->tag == DW_TAG_namespace) {
-				drgn_namespace_dwarf_index_deinit(die->namespace);
-				free(die->namespace);
+				/* Namespaces are in the same order as DIEs. */
+				struct drgn_namespace_dwarf_index *namespace =
+					shard->namespaces.data[--shard->namespaces.size];
+				drgn_namespace_dwarf_index_deinit(namespace);
+				free(namespace);
 			}
 			shard->dies.size--;
 		}
@@ -2842,9 +4172,9 @@ static void drgn_dwarf_index_rollback(struct drgn_debug_info *dbinfo)
 		for (size_t index = 0; index < shard->dies.size; index++) {
 			struct drgn_dwarf_index_die *die =
 				&shard->dies.data[index];
-			if (die->next != UINT32_MAX &&
+			if (die->next != DRGN_DWARF_INDEX_DIE_END &&
 			    die->next >= shard->dies.size)
-				die->next = UINT32_MAX;
+				die->next = DRGN_DWARF_INDEX_DIE_END;
 		}
 
 		/* Finally, delete the new entries in the map. */
@@ -2872,42 +4202,264 @@ static void drgn_dwarf_index_rollback(struct drgn_debug_info *dbinfo)
 	}
 }
 
-struct drgn_error *
-drgn_dwarf_info_update_index(struct drgn_dwarf_index_state *state)
+/*
+ * Add the DIEs with DW_AT_specification from opened DWARF index cache files.
+ * This must be done before the second pass so that declarations in other
+ * modules can be resolved.
+ */
+static struct drgn_error *
+drgn_dwarf_index_specifications_from_cache(struct drgn_dwarf_index_state *state)
 {
-	struct drgn_debug_info *dbinfo = state->dbinfo;
-	struct drgn_dwarf_index_cu_vector *cus = &dbinfo->dwarf.index_cus;
-
-	if (!drgn_namespace_dwarf_index_alloc_shards(&dbinfo->dwarf.global))
-		return &drgn_enomem;
+	struct drgn_error *err;
+	for (size_t i = 0; i < state->max_threads; i++) {
+		struct drgn_dwarf_index_cache_vector *opened =
+			&state->cache[i].opened;
+		for (size_t j = 0; j < opened->size; j++) {
+			struct drgn_dwarf_index_cache *cache = &opened->data[j];
+			for (size_t k = 0; k < cache->num_specifications; k++) {
+				const struct drgn_dwarf_index_cache_specification *specification =
+					&cache->specifications[k];
+				/* These were validated when the file was opened. */
+				const char *declaration =
+					drgn_dwarf_index_cache_decode(cache->module,
+								      specification->declaration_scn,
+								      specification->declaration_offset);
+				const char *addr =
+					drgn_dwarf_index_cache_decode(cache->module,
+								      specification->addr_scn,
+								      specification->addr_offset);
+				err = index_specification(state->dbinfo, NULL,
+							  (uintptr_t)declaration,
+							  cache->module,
+							  (uintptr_t)addr);
+				if (err)
+					return err;
+			}
+		}
+	}
+	return NULL;
+}
 
-	size_t old_cus_size = cus->size;
-	size_t new_cus_size = old_cus_size;
-	for (size_t i = 0; i < state->max_threads; i++)
-		new_cus_size += state->cus[i].size;
-	if (!drgn_dwarf_index_cu_vector_reserve(cus, new_cus_size))
-		return &drgn_enomem;
+/* Index the DIEs from an opened DWARF index cache file. */
+static bool drgn_dwarf_index_from_cache_file(struct drgn_debug_info *dbinfo,
+					     struct drgn_dwarf_index_cache *cache)
+{
+	struct drgn_namespace_dwarf_index *ns = &dbinfo->dwarf.global;
+	bool success = true;
+	#pragma omp parallel \
+		num_threads(drgn_program_num_parallel_threads(dbinfo->prog))
+	{
+		drgn_program_bind_parallel_thread(dbinfo->prog);
+		/*
+		 * Consecutive DIEs are usually from the same file, so remember
+		 * the last file name ID to avoid taking a lock for every DIE.
+		 */
+		uint64_t last_file_name_hash = 0;
+		uint32_t last_file_name_id = 0;
+		#pragma omp for schedule(static, 4096)
+		for (size_t i = 0; i < cache->num_dies; i++) {
+			if (!success)
+				continue;
+			const struct drgn_dwarf_index_cache_die *die =
+				&cache->dies[i];
+			if (die->file_name_hash != last_file_name_hash) {
+				if (!drgn_dwarf_file_name_id(&dbinfo->dwarf,
+							     die->file_name_hash,
+							     &last_file_name_id)) {
+					success = false;
+					continue;
+				}
+				last_file_name_hash = die->file_name_hash;
+			}
+			const char *name =
+				drgn_dwarf_index_cache_decode(cache->module,
+							      die->name_scn,
+							      die->name_offset);
+			const char *addr =
+				drgn_dwarf_index_cache_decode(cache->module,
+							      die->addr_scn,
+							      die->addr_offset);
+			/*
+			 * The CU is only needed for namespaces, which are never
+			 * cached.
+			 */
+			if (!index_die(ns, NULL, name, die->tag,
+				       last_file_name_id, cache->module,
+				       (uintptr_t)addr))
+				success = false;
+		}
+	}
+	return success;
+}
+
+/* Index the DIEs from opened DWARF index cache files. */
+static struct drgn_error *
+drgn_dwarf_index_from_cache(struct drgn_dwarf_index_state *state)
+{
 	for (size_t i = 0; i < state->max_threads; i++) {
-		for (size_t j = 0; j < state->cus[i].size; j++) {
-			struct drgn_dwarf_index_pending_cu *pending_cu =
-				&state->cus[i].data[j];
-			cus->data[cus->size++] = (struct drgn_dwarf_index_cu){
-				.module = pending_cu->module,
-				.buf = pending_cu->buf,
-				.len = pending_cu->len,
-				.is_64_bit = pending_cu->is_64_bit,
-				.scn = pending_cu->scn,
-				.file_name_hashes =
-					(uint64_t *)no_file_name_hashes,
-				.num_file_names =
-					array_size(no_file_name_hashes),
-			};
+		struct drgn_dwarf_index_cache_vector *opened =
+			&state->cache[i].opened;
+		for (size_t j = 0; j < opened->size; j++) {
+			if (!drgn_dwarf_index_from_cache_file(state->dbinfo,
+							      &opened->data[j]))
+				return &drgn_enomem;
+		}
+	}
+	return NULL;
+}
+
+static int drgn_dwarf_index_module_ptr_cmp(const void *a, const void *b)
+{
+	uintptr_t ptr_a = (uintptr_t)*(struct drgn_debug_info_module * const *)a;
+	uintptr_t ptr_b = (uintptr_t)*(struct drgn_debug_info_module * const *)b;
+	return (ptr_a > ptr_b) - (ptr_a < ptr_b);
+}
+
+/*
+ * The records start with the module pointer, so they can all be sorted by
+ * module with the same comparison function.
+ */
+static_assert(offsetof(struct drgn_dwarf_index_cache_die_record, module) == 0,
+	      "module must be first");
+static_assert(offsetof(struct drgn_dwarf_index_cache_specification_record,
+		       module) == 0,
+	      "module must be first");
+
+/*
+ * Write DWARF index cache files for the modules that were indexed from CUs.
+ * Failures are ignored since the cache is only an optimization.
+ */
+static void drgn_dwarf_index_write_cache(struct drgn_dwarf_index_state *state,
+					 size_t old_cus_size)
+{
+	struct drgn_dwarf_index_cu_vector *cus = &state->dbinfo->dwarf.index_cus;
+
+	/*
+	 * Gather the modules and the per-thread records into flat arrays sorted
+	 * by module.
+	 */
+	struct drgn_dwarf_index_module_vector modules = VECTOR_INIT;
+	struct drgn_dwarf_index_module_vector uncacheable = VECTOR_INIT;
+	struct drgn_dwarf_index_cache_die_record_vector dies = VECTOR_INIT;
+	struct drgn_dwarf_index_cache_specification_record_vector
+		specifications = VECTOR_INIT;
+	struct drgn_dwarf_index_cache_die *module_dies = NULL;
+	struct drgn_dwarf_index_cache_specification *module_specifications =
+		NULL;
+	for (size_t i = old_cus_size; i < cus->size; i++) {
+		if ((!modules.size ||
+		     modules.data[modules.size - 1] != cus->data[i].module) &&
+		    !drgn_dwarf_index_module_vector_append(&modules,
+							   &cus->data[i].module))
+			goto out;
+	}
+	for (size_t i = 0; i < state->max_threads; i++) {
+		struct drgn_dwarf_index_cache_state *cache = &state->cache[i];
+		if (!drgn_dwarf_index_module_vector_reserve(&uncacheable,
+							   uncacheable.size +
+							   cache->uncacheable.size) ||
+		    !drgn_dwarf_index_cache_die_record_vector_reserve(&dies,
+								      dies.size +
+								      cache->dies.size) ||
+		    !drgn_dwarf_index_cache_specification_record_vector_reserve(&specifications,
+										specifications.size +
+										cache->specifications.size))
+			goto out;
+		memcpy(uncacheable.data + uncacheable.size,
+		       cache->uncacheable.data,
+		       cache->uncacheable.size * sizeof(uncacheable.data[0]));
+		uncacheable.size += cache->uncacheable.size;
+		memcpy(dies.data + dies.size, cache->dies.data,
+		       cache->dies.size * sizeof(dies.data[0]));
+		dies.size += cache->dies.size;
+		memcpy(specifications.data + specifications.size,
+		       cache->specifications.data,
+		       cache->specifications.size *
+		       sizeof(specifications.data[0]));
+		specifications.size += cache->specifications.size;
+	}
+	qsort(modules.data, modules.size, sizeof(modules.data[0]),
+	      drgn_dwarf_index_module_ptr_cmp);
+	qsort(uncacheable.data, uncacheable.size, sizeof(uncacheable.data[0]),
+	      drgn_dwarf_index_module_ptr_cmp);
+	qsort(dies.data, dies.size, sizeof(dies.data[0]),
+	      drgn_dwarf_index_module_ptr_cmp);
+	qsort(specifications.data, specifications.size,
+	      sizeof(specifications.data[0]), drgn_dwarf_index_module_ptr_cmp);
+
+	module_dies = malloc_array(dies.size, sizeof(*module_dies));
+	module_specifications = malloc_array(specifications.size,
+					     sizeof(*module_specifications));
+	if ((dies.size && !module_dies) ||
+	    (specifications.size && !module_specifications))
+		goto out;
+
+	size_t uncacheable_i = 0, dies_i = 0, specifications_i = 0;
+	for (size_t i = 0; i < modules.size; i++) {
+		struct drgn_debug_info_module *module = modules.data[i];
+		/* Skip duplicates from modules with multiple sections. */
+		if (i > 0 && module == modules.data[i - 1])
+			continue;
+
+		while (uncacheable_i < uncacheable.size &&
+		       uncacheable.data[uncacheable_i] < module)
+			uncacheable_i++;
+		bool cacheable = (uncacheable_i >= uncacheable.size ||
+				  uncacheable.data[uncacheable_i] != module);
+
+		size_t num_dies = 0;
+		while (dies_i < dies.size &&
+		       (uintptr_t)dies.data[dies_i].module <= (uintptr_t)module) {
+			if (dies.data[dies_i].module == module)
+				module_dies[num_dies++] = dies.data[dies_i].die;
+			dies_i++;
+		}
+		size_t num_specifications = 0;
+		while (specifications_i < specifications.size &&
+		       (uintptr_t)specifications.data[specifications_i].module <=
+		       (uintptr_t)module) {
+			if (specifications.data[specifications_i].module == module) {
+				module_specifications[num_specifications++] =
+					specifications.data[specifications_i].specification;
+			}
+			specifications_i++;
+		}
+
+		if (cacheable) {
+			drgn_dwarf_index_cache_write(state->cache_dir, module,
+						     module_dies, num_dies,
+						     module_specifications,
+						     num_specifications);
 		}
 	}
 
+out:
+	free(module_specifications);
+	free(module_dies);
+	drgn_dwarf_index_cache_specification_record_vector_deinit(&specifications);
+	drgn_dwarf_index_cache_die_record_vector_deinit(&dies);
+	drgn_dwarf_index_module_vector_deinit(&uncacheable);
+	drgn_dwarf_index_module_vector_deinit(&modules);
+}
+
+/*
+ * Run both indexing passes on the CUs in drgn_dwarf_info::index_cus in
+ * [start, end). cache is the per-thread DWARF index cache state, or NULL if the
+ * cache is disabled.
+ */
+static struct drgn_error *
+drgn_dwarf_index_cus(struct drgn_debug_info *dbinfo,
+		     struct drgn_dwarf_index_cache_state *cache,
+		     size_t start, size_t end)
+{
+	struct drgn_dwarf_index_cu_vector *cus = &dbinfo->dwarf.index_cus;
+	struct drgn_debug_info_timings *timings = &dbinfo->timings;
 	struct drgn_error *err = NULL;
-	#pragma omp parallel
+	uint64_t start_time = monotonic_ns();
+	#pragma omp parallel \
+		num_threads(drgn_program_num_parallel_threads(dbinfo->prog))
 	{
+		drgn_program_bind_parallel_thread(dbinfo->prog);
 		struct path_hash_cache path_hash_cache;
 		path_hash_vector_init(&path_hash_cache.directories);
 		path_hash_cache.entry_formats = NULL;
@@ -2922,16 +4474,22 @@ drgn_dwarf_info_update_index(struct drgn_dwarf_index_state *state)
 				err = &drgn_enomem;
 		}
 		#pragma omp for schedule(dynamic)
-		for (size_t i = old_cus_size; i < cus->size; i++) {
+		for (size_t i = start; i < end; i++) {
 			if (err)
 				continue;
 			struct drgn_dwarf_index_cu *cu = &cus->data[i];
 			struct drgn_dwarf_index_cu_buffer cu_buffer;
 			drgn_dwarf_index_cu_buffer_init(&cu_buffer, cu);
 			struct drgn_error *cu_err = read_cu(&cu_buffer);
-			if (!cu_err)
-				cu_err = index_cu_first_pass(dbinfo, &cu_buffer,
+			if (!cu_err) {
+				struct drgn_dwarf_index_cache_state *thread_cache =
+					cache ? &cache[omp_get_thread_num()] :
+					NULL;
+				cu_err = index_cu_first_pass(dbinfo,
+							     thread_cache,
+							     &cu_buffer,
 							     &path_hash_cache);
+			}
 			if (cu_err) {
 				#pragma omp critical(drgn_dwarf_info_update_index_error)
 				if (err)
@@ -2949,35 +4507,148 @@ drgn_dwarf_info_update_index(struct drgn_dwarf_index_state *state)
 			chunk = next_chunk;
 		}
 	}
+	uint64_t end_time = monotonic_ns();
+	timings->first_pass += end_time - start_time;
+	start_time = end_time;
 	if (err)
-		goto err;
+		return err;
 
-	#pragma omp parallel for schedule(dynamic)
-	for (size_t i = old_cus_size; i < cus->size; i++) {
-		if (err)
-			continue;
-		struct drgn_dwarf_index_cu *cu = &cus->data[i];
-		struct drgn_dwarf_index_cu_buffer buffer;
-		drgn_dwarf_index_cu_buffer_init(&buffer, cu);
-		buffer.bb.pos += cu_header_size(cu);
-		struct drgn_error *cu_err =
-			index_cu_second_pass(&dbinfo->dwarf.global, &buffer);
-		if (cu_err) {
-			#pragma omp critical(drgn_dwarf_info_update_index_error)
+	#pragma omp parallel \
+		num_threads(drgn_program_num_parallel_threads(dbinfo->prog))
+	{
+		drgn_program_bind_parallel_thread(dbinfo->prog);
+		/*
+		 * If we can't allocate a batch, fall back to indexing DIEs one
+		 * at a time.
+		 */
+		struct drgn_dwarf_index_die_batch *batch =
+			drgn_dwarf_index_die_batch_create();
+		#pragma omp for schedule(dynamic) nowait
+		for (size_t i = start; i < end; i++) {
 			if (err)
-				drgn_error_destroy(cu_err);
-			else
-				err = cu_err;
+				continue;
+			struct drgn_dwarf_index_cu *cu = &cus->data[i];
+			if (cu->use_debug_names)
+				continue;
+			struct drgn_dwarf_index_cu_buffer buffer;
+			drgn_dwarf_index_cu_buffer_init(&buffer, cu);
+			buffer.bb.pos += cu_header_size(cu);
+			struct drgn_dwarf_index_cache_state *thread_cache =
+				cache ? &cache[omp_get_thread_num()] : NULL;
+			struct drgn_error *cu_err =
+				index_cu_second_pass(&dbinfo->dwarf.global,
+						     thread_cache, batch,
+						     &buffer, NULL);
+			if (cu_err) {
+				#pragma omp critical(drgn_dwarf_info_update_index_error)
+				if (err)
+					drgn_error_destroy(cu_err);
+				else
+					err = cu_err;
+			}
 		}
+		/*
+		 * Threads that run out of CUs start flushing while the others
+		 * are still indexing.
+		 */
+		if (batch && !err &&
+		    !flush_die_batches(&dbinfo->dwarf.global, batch)) {
+			#pragma omp critical(drgn_dwarf_info_update_index_error)
+			if (!err)
+				err = &drgn_enomem;
+		}
+		free(batch);
 	}
-	if (err) {
-		drgn_dwarf_index_rollback(dbinfo);
-err:
-		for (size_t i = old_cus_size; i < cus->size; i++)
-			drgn_dwarf_index_cu_deinit(&cus->data[i]);
-		cus->size = old_cus_size;
+	end_time = monotonic_ns();
+	timings->second_pass += end_time - start_time;
+	start_time = end_time;
+	if (err)
+		return err;
+
+	/*
+	 * Name indexes are parallelized internally, and there is usually only
+	 * one per module, so index them one at a time.
+	 */
+	struct drgn_dwarf_index_names_vector *index_names =
+		&dbinfo->dwarf.index_names;
+	size_t i = index_names->size;
+	while (i > 0 && index_names->data[i - 1].first_cu >= start)
+		i--;
+	for (; i < index_names->size && index_names->data[i].first_cu < end;
+	     i++) {
+		err = index_debug_names(dbinfo, cache, &index_names->data[i]);
+		if (err)
+			return err;
 	}
-	return err;
+	timings->debug_names += monotonic_ns() - start_time;
+	return NULL;
+}
+
+/*
+ * Free the abbreviation tables and file name hashes of the CUs in
+ * drgn_dwarf_info::index_cus in [start, end) and evict the sections that they
+ * were indexed from. This is only done in low memory mode.
+ *
+ * CUs containing namespaces keep their tables because the namespaces are
+ * indexed later by index_namespace().
+ */
+static void drgn_dwarf_index_release_memory(struct drgn_debug_info *dbinfo,
+					    size_t start, size_t end)
+{
+	struct drgn_dwarf_index_cu_vector *cus = &dbinfo->dwarf.index_cus;
+	if (!dbinfo->dwarf.low_memory || start == end)
+		return;
+
+	/* This is best-effort, so give up if we can't allocate this. */
+	bool *keep = calloc(end - start, sizeof(keep[0]));
+	if (!keep)
+		return;
+	for (size_t i = 0; i < DRGN_DWARF_INDEX_NUM_SHARDS; i++) {
+		struct drgn_dwarf_index_shard *shard =
+			&dbinfo->dwarf.global.shards[i];
+		for (size_t j = 0; j < shard->namespaces.size; j++) {
+			struct drgn_dwarf_index_pending_die_vector *pending =
+				&shard->namespaces.data[j]->pending_dies;
+			for (size_t k = 0; k < pending->size; k++) {
+				size_t cu = pending->data[k].cu;
+				if (cu >= start && cu < end)
+					keep[cu - start] = true;
+			}
+		}
+	}
+
+	struct drgn_debug_info_module *last_module = NULL;
+	for (size_t i = start; i < end; i++) {
+		struct drgn_dwarf_index_cu *cu = &cus->data[i];
+		if (!keep[i - start]) {
+			drgn_dwarf_index_cu_deinit(cu);
+			cu->abbrev_decls = NULL;
+			cu->num_abbrev_decls = 0;
+			cu->abbrev_insns = NULL;
+			cu->file_name_hashes = (uint64_t *)no_file_name_hashes;
+			cu->file_name_ids = (uint32_t *)no_file_name_ids;
+			cu->num_file_names = array_size(no_file_name_hashes);
+		}
+		/* The CUs of a module are contiguous. */
+		if (cu->module != last_module) {
+			drgn_debug_info_module_evict_sections(cu->module);
+			last_module = cu->module;
+		}
+	}
+	free(keep);
+}
+
+/* Index one of the pending DIEs of a namespace. */
+static struct drgn_error *
+index_namespace_pending_die(struct drgn_namespace_dwarf_index *ns, size_t i)
+{
+	struct drgn_dwarf_index_pending_die *pending = &ns->pending_dies.data[i];
+	struct drgn_dwarf_index_cu *cu =
+		&ns->dbinfo->dwarf.index_cus.data[pending->cu];
+	struct drgn_dwarf_index_cu_buffer buffer;
+	drgn_dwarf_index_cu_buffer_init(&buffer, cu);
+	buffer.bb.pos = (char *)pending->addr;
+	return index_cu_second_pass(ns, NULL, NULL, &buffer, NULL);
 }
 
 static struct drgn_error *index_namespace(struct drgn_namespace_dwarf_index *ns)
@@ -2991,19 +4662,15 @@ static struct drgn_error *index_namespace(struct drgn_namespace_dwarf_index *ns)
 	if (!drgn_namespace_dwarf_index_alloc_shards(ns))
 		return &drgn_enomem;
 
+	struct drgn_program *prog = ns->dbinfo->prog;
 	struct drgn_error *err = NULL;
-	#pragma omp parallel for schedule(dynamic)
+	#pragma omp parallel for schedule(dynamic) \
+		num_threads(drgn_program_num_parallel_threads(prog))
 	for (size_t i = 0; i < ns->pending_dies.size; i++) {
+		drgn_program_bind_parallel_thread(prog);
 		if (!err) {
-			struct drgn_dwarf_index_pending_die *pending =
-				&ns->pending_dies.data[i];
-			struct drgn_dwarf_index_cu *cu =
-				&ns->dbinfo->dwarf.index_cus.data[pending->cu];
-			struct drgn_dwarf_index_cu_buffer buffer;
-			drgn_dwarf_index_cu_buffer_init(&buffer, cu);
-			buffer.bb.pos = (char *)pending->addr;
 			struct drgn_error *cu_err =
-				index_cu_second_pass(ns, &buffer);
+				index_namespace_pending_die(ns, i);
 			if (cu_err) {
 				#pragma omp critical(drgn_index_namespace_error)
 				if (err)
@@ -3022,6 +4689,401 @@ static struct drgn_error *index_namespace(struct drgn_namespace_dwarf_index *ns)
 	return err;
 }
 
+/*
+ * Append the namespaces nested directly in a namespace that have pending DIEs
+ * to a vector.
+ */
+static bool
+append_pending_namespaces(struct drgn_namespace_dwarf_index *ns,
+			  struct drgn_namespace_dwarf_index_vector *ret)
+{
+	if (!ns->shards)
+		return true;
+	for (size_t i = 0; i < DRGN_DWARF_INDEX_NUM_SHARDS; i++) {
+		struct drgn_namespace_dwarf_index_vector *namespaces =
+			&ns->shards[i].namespaces;
+		for (size_t j = 0; j < namespaces->size; j++) {
+			struct drgn_namespace_dwarf_index *nested =
+				namespaces->data[j];
+			if (nested->pending_dies.size && !nested->saved_err &&
+			    !drgn_namespace_dwarf_index_vector_append(ret,
+								      &nested))
+				return false;
+		}
+	}
+	return true;
+}
+
+/*
+ * Index the pending DIEs of several namespaces in one parallel region.
+ * Otherwise the same as index_namespace(), except that errors are only saved
+ * in the namespace.
+ */
+static void
+index_namespaces(struct drgn_debug_info *dbinfo,
+		 struct drgn_namespace_dwarf_index_vector *namespaces)
+{
+	#pragma omp parallel \
+		num_threads(drgn_program_num_parallel_threads(dbinfo->prog))
+	#pragma omp single
+	for (size_t i = 0; i < namespaces->size; i++) {
+		struct drgn_namespace_dwarf_index *ns = namespaces->data[i];
+		if (!drgn_namespace_dwarf_index_alloc_shards(ns))
+			continue;
+		#pragma omp taskloop nogroup
+		for (size_t j = 0; j < ns->pending_dies.size; j++) {
+			drgn_program_bind_parallel_thread(dbinfo->prog);
+			if (ns->saved_err)
+				continue;
+			struct drgn_error *cu_err =
+				index_namespace_pending_die(ns, j);
+			if (cu_err) {
+				#pragma omp critical(drgn_index_namespace_error)
+				if (ns->saved_err)
+					drgn_error_destroy(cu_err);
+				else
+					ns->saved_err = cu_err;
+			}
+		}
+	}
+	for (size_t i = 0; i < namespaces->size; i++) {
+		struct drgn_namespace_dwarf_index *ns = namespaces->data[i];
+		if (ns->shards && !ns->saved_err) {
+			ns->pending_dies.size = 0;
+			drgn_dwarf_index_pending_die_vector_shrink_to_fit(&ns->pending_dies);
+		}
+	}
+}
+
+/*
+ * Index every namespace with pending DIEs, one level of nesting at a time, so
+ * that the first lookup in a namespace doesn't have to. This is best-effort:
+ * errors are saved in the namespace and returned by lookups in it.
+ */
+static void drgn_dwarf_info_prefetch_namespaces(struct drgn_debug_info *dbinfo)
+{
+	struct drgn_namespace_dwarf_index_vector level = VECTOR_INIT;
+	struct drgn_namespace_dwarf_index_vector next_level = VECTOR_INIT;
+	if (!append_pending_namespaces(&dbinfo->dwarf.global, &level))
+		goto out;
+	while (level.size) {
+		index_namespaces(dbinfo, &level);
+		for (size_t i = 0; i < level.size; i++) {
+			if (!append_pending_namespaces(level.data[i],
+						       &next_level))
+				goto out;
+		}
+		struct drgn_namespace_dwarf_index_vector tmp = level;
+		level = next_level;
+		next_level = tmp;
+		next_level.size = 0;
+	}
+out:
+	drgn_namespace_dwarf_index_vector_deinit(&next_level);
+	drgn_namespace_dwarf_index_vector_deinit(&level);
+}
+
+/*
+ * Index the CUs whose indexing was deferred by drgn_dwarf_info_update_index().
+ * This must be called before using a nested namespace index or before
+ * concluding that something is missing from the global namespace index or the
+ * specification map.
+ */
+static struct drgn_error *
+drgn_dwarf_info_index_deferred(struct drgn_debug_info *dbinfo)
+{
+	struct drgn_dwarf_info *dwarf = &dbinfo->dwarf;
+	if (dwarf->num_indexed_cus == dwarf->index_cus.size)
+		return NULL;
+	if (dwarf->deferred_err)
+		return drgn_error_copy(dwarf->deferred_err);
+	struct drgn_error *err =
+		drgn_dwarf_index_cus(dbinfo, NULL, dwarf->num_indexed_cus,
+				     dwarf->index_cus.size);
+	if (err) {
+		/*
+		 * The modules have already been reported as indexed, so we
+		 * can't roll back. Save the error so that we never use a
+		 * partial index.
+		 */
+		dwarf->deferred_err = err;
+		return drgn_error_copy(err);
+	}
+	drgn_dwarf_index_release_memory(dbinfo, dwarf->num_indexed_cus,
+					dwarf->index_cus.size);
+	dwarf->num_indexed_cus = dwarf->index_cus.size;
+	if (dwarf->prefetch_namespaces)
+		drgn_dwarf_info_prefetch_namespaces(dbinfo);
+	return NULL;
+}
+
+/*
+ * Assign the next ID in drgn_dwarf_info::index_modules to a module whose DIEs
+ * are about to be indexed.
+ */
+static bool drgn_dwarf_index_add_module(struct drgn_dwarf_info *dwarf,
+					struct drgn_debug_info_module *module,
+					size_t old_modules_size)
+{
+	struct drgn_dwarf_index_module_vector *modules = &dwarf->index_modules;
+	/* The CUs of a module are contiguous. */
+	if (modules->size > old_modules_size &&
+	    modules->data[modules->size - 1] == module)
+		return true;
+	if (modules->size >= UINT32_MAX)
+		return false;
+	module->dwarf.index_id = modules->size;
+	return drgn_dwarf_index_module_vector_append(modules, &module);
+}
+
+/*
+ * Whether the CUs of a module are indexed as soon as they are loaded in
+ * streaming mode. Only vmlinux is; loadable kernel modules are indexed by the
+ * first lookup that doesn't find a match in vmlinux.
+ */
+static inline bool
+drgn_dwarf_index_module_is_eager(struct drgn_debug_info_module *module)
+{
+	return module->name && strcmp(module->name, "kernel") == 0;
+}
+
+/*
+ * Move one thread's pending CUs and the name indexes that refer to them to the
+ * end of drgn_dwarf_info::index_cus and drgn_dwarf_info::index_names, which
+ * must have enough capacity. If filter is true, only the CUs of modules for
+ * which drgn_dwarf_index_module_is_eager() returns eager are moved.
+ */
+static void
+drgn_dwarf_index_move_pending_cus(struct drgn_dwarf_info *dwarf,
+				  struct drgn_dwarf_index_pending_cu_vector *pending_cus,
+				  struct drgn_dwarf_index_names_vector *pending_names,
+				  bool filter, bool eager)
+{
+	struct drgn_dwarf_index_cu_vector *cus = &dwarf->index_cus;
+	struct drgn_dwarf_index_names_vector *index_names = &dwarf->index_names;
+	/*
+	 * Pending name indexes refer to this thread's pending CUs and are
+	 * sorted by their first CU.
+	 */
+	size_t k = 0;
+	for (size_t j = 0; j < pending_cus->size; j++) {
+		struct drgn_dwarf_index_pending_cu *pending_cu =
+			&pending_cus->data[j];
+		while (k < pending_names->size &&
+		       pending_names->data[k].first_cu < j)
+			k++;
+		if (filter &&
+		    eager != drgn_dwarf_index_module_is_eager(pending_cu->module))
+			continue;
+		while (k < pending_names->size &&
+		       pending_names->data[k].first_cu == j) {
+			struct drgn_dwarf_index_names *names =
+				&index_names->data[index_names->size++];
+			*names = pending_names->data[k++];
+			names->first_cu = cus->size;
+		}
+		cus->data[cus->size++] = (struct drgn_dwarf_index_cu){
+			.module = pending_cu->module,
+			.buf = pending_cu->buf,
+			.len = pending_cu->len,
+			.is_64_bit = pending_cu->is_64_bit,
+			.scn = pending_cu->scn,
+			.use_debug_names = pending_cu->use_debug_names,
+			.file_name_hashes = (uint64_t *)no_file_name_hashes,
+			.file_name_ids = (uint32_t *)no_file_name_ids,
+			.num_file_names = array_size(no_file_name_hashes),
+		};
+	}
+}
+
+struct drgn_error *
+drgn_dwarf_info_update_index(struct drgn_dwarf_index_state *state)
+{
+	struct drgn_debug_info *dbinfo = state->dbinfo;
+	struct drgn_dwarf_index_cu_vector *cus = &dbinfo->dwarf.index_cus;
+	struct drgn_error *err;
+
+	struct drgn_dwarf_index_names_vector *index_names =
+		&dbinfo->dwarf.index_names;
+	size_t old_cus_size = cus->size;
+	size_t new_cus_size = old_cus_size;
+	size_t old_names_size = index_names->size;
+	size_t new_names_size = old_names_size;
+	size_t old_modules_size = dbinfo->dwarf.index_modules.size;
+	/*
+	 * Opened cache files are closed when the index state is deinitialized,
+	 * so indexing can only be deferred if the cache is disabled.
+	 */
+	bool stream = dbinfo->dwarf.stream && !state->cache;
+	size_t num_eager_cus = 0;
+	for (size_t i = 0; i < state->max_threads; i++) {
+		new_cus_size += state->cus[i].size;
+		new_names_size += state->names[i].size;
+		for (size_t j = 0; stream && j < state->cus[i].size; j++) {
+			struct drgn_dwarf_index_pending_cu *pending_cu =
+				&state->cus[i].data[j];
+			if (drgn_dwarf_index_module_is_eager(pending_cu->module))
+				num_eager_cus++;
+		}
+	}
+
+	bool defer = ((dbinfo->dwarf.lazy && !state->cache) ||
+		      (stream && !num_eager_cus));
+	if (!defer) {
+		/* Rolling back on failure assumes that old CUs are indexed. */
+		err = drgn_dwarf_info_index_deferred(dbinfo);
+		if (err)
+			return err;
+	}
+
+	if (!drgn_namespace_dwarf_index_alloc_shards(&dbinfo->dwarf.global))
+		return &drgn_enomem;
+
+	if (!drgn_dwarf_index_cu_vector_reserve(cus, new_cus_size) ||
+	    !drgn_dwarf_index_names_vector_reserve(index_names,
+						   new_names_size))
+		return &drgn_enomem;
+	/*
+	 * In streaming mode, the eager CUs are moved first so that they can be
+	 * indexed now and the rest deferred.
+	 */
+	for (int pass = stream ? 0 : 1; pass < 2; pass++) {
+		for (size_t i = 0; i < state->max_threads; i++) {
+			drgn_dwarf_index_move_pending_cus(&dbinfo->dwarf,
+							  &state->cus[i],
+							  &state->names[i],
+							  stream, pass == 0);
+		}
+	}
+	size_t eager_cus_end = stream ? old_cus_size + num_eager_cus : cus->size;
+
+	for (size_t i = old_cus_size; i < cus->size; i++) {
+		if (!drgn_dwarf_index_add_module(&dbinfo->dwarf,
+						 cus->data[i].module,
+						 old_modules_size)) {
+			err = &drgn_enomem;
+			goto err;
+		}
+	}
+	if (state->cache) {
+		for (size_t i = 0; i < state->max_threads; i++) {
+			struct drgn_dwarf_index_cache_vector *opened =
+				&state->cache[i].opened;
+			for (size_t j = 0; j < opened->size; j++) {
+				if (!drgn_dwarf_index_add_module(&dbinfo->dwarf,
+								 opened->data[j].module,
+								 old_modules_size)) {
+					err = &drgn_enomem;
+					goto err;
+				}
+			}
+		}
+	}
+
+	if (defer)
+		return NULL;
+
+	err = NULL;
+	if (state->cache) {
+		err = drgn_dwarf_index_specifications_from_cache(state);
+		if (err) {
+			drgn_dwarf_index_rollback(dbinfo);
+			goto err;
+		}
+	}
+
+	err = drgn_dwarf_index_cus(dbinfo, state->cache, old_cus_size,
+				   eager_cus_end);
+	if (!err && state->cache)
+		err = drgn_dwarf_index_from_cache(state);
+	if (!err && state->cache)
+		drgn_dwarf_index_write_cache(state, old_cus_size);
+	if (err) {
+		drgn_dwarf_index_rollback(dbinfo);
+err:
+		for (size_t i = old_cus_size; i < cus->size; i++)
+			drgn_dwarf_index_cu_deinit(&cus->data[i]);
+		cus->size = old_cus_size;
+		index_names->size = old_names_size;
+		dbinfo->dwarf.index_modules.size = old_modules_size;
+	} else {
+		drgn_dwarf_index_release_memory(dbinfo, old_cus_size,
+						eager_cus_end);
+		dbinfo->dwarf.num_indexed_cus = eager_cus_end;
+		if (dbinfo->dwarf.prefetch_namespaces &&
+		    eager_cus_end == cus->size)
+			drgn_dwarf_info_prefetch_namespaces(dbinfo);
+	}
+	return err;
+}
+
+struct drgn_error *
+drgn_dwarf_info_rebuild_index(struct drgn_debug_info *dbinfo)
+{
+	struct drgn_error *err = NULL;
+	struct drgn_dwarf_info *dwarf = &dbinfo->dwarf;
+
+	/*
+	 * Namespaces are merged across modules and DIEs refer to CUs and
+	 * modules by position, so entries can't easily be deleted from the
+	 * middle of the index. Instead, build a new index from the modules
+	 * that are still indexed and swap it in if that succeeds.
+	 */
+	struct drgn_dwarf_info old;
+	drgn_dwarf_info_init_index(&old, dbinfo);
+	drgn_dwarf_info_swap_index(dwarf, &old);
+
+	struct drgn_debug_info_module **modules = old.index_modules.data;
+	size_t num_modules = old.index_modules.size;
+	for (size_t i = 0; i < num_modules; i++) {
+		if (modules[i]->state == DRGN_DEBUG_INFO_MODULE_INDEXED)
+			modules[i]->state = DRGN_DEBUG_INFO_MODULE_INDEXING;
+	}
+
+	struct drgn_dwarf_index_state state;
+	if (!drgn_dwarf_index_state_init(&state, dbinfo)) {
+		err = &drgn_enomem;
+		goto out;
+	}
+	#pragma omp parallel for schedule(dynamic) \
+		num_threads(state.max_threads)
+	for (size_t i = 0; i < num_modules; i++) {
+		drgn_program_bind_parallel_thread(dbinfo->prog);
+		if (err ||
+		    modules[i]->state != DRGN_DEBUG_INFO_MODULE_INDEXING)
+			continue;
+		struct drgn_error *module_err =
+			drgn_dwarf_index_read_module(&state, modules[i]);
+		if (module_err) {
+			#pragma omp critical(drgn_dwarf_info_update_index_error)
+			if (err)
+				drgn_error_destroy(module_err);
+			else
+				err = module_err;
+		}
+	}
+	if (!err)
+		err = drgn_dwarf_info_update_index(&state);
+	drgn_dwarf_index_state_deinit(&state);
+
+out:
+	for (size_t i = 0; i < num_modules; i++) {
+		if (modules[i]->state == DRGN_DEBUG_INFO_MODULE_INDEXING)
+			modules[i]->state = DRGN_DEBUG_INFO_MODULE_INDEXED;
+	}
+	/*
+	 * On failure, put the old index back (along with the IDs that the
+	 * modules had in it) and free the partial one.
+	 */
+	if (err) {
+		drgn_dwarf_info_swap_index(dwarf, &old);
+		for (size_t i = 0; i < num_modules; i++)
+			modules[i]->dwarf.index_id = i;
+	}
+	drgn_dwarf_info_deinit_index(&old);
+	return err;
+}
+
 /**
  * Iterator over DWARF debugging information.
  *
@@ -3031,16 +5093,46 @@ static struct drgn_error *index_namespace(struct drgn_namespace_dwarf_index *ns)
 struct drgn_dwarf_index_iterator {
 	const uint64_t *tags;
 	size_t num_tags;
+	struct drgn_debug_info *dbinfo;
+	struct drgn_namespace_dwarf_index *ns;
+	struct nstring key;
+	struct hash_pair hp;
 	struct drgn_dwarf_index_shard *shard;
 	uint32_t index;
+	/** Index of the last DIE visited in @ref shard. */
+	uint32_t last;
 };
 
+static void
+drgn_dwarf_index_iterator_search(struct drgn_dwarf_index_iterator *it)
+{
+	if (it->ns->shards) {
+		it->shard = &it->ns->shards[hash_pair_to_shard(it->hp)];
+		struct drgn_dwarf_index_die_map_iterator map_it =
+			drgn_dwarf_index_die_map_search_hashed(&it->shard->map,
+							       &it->key,
+							       it->hp);
+		it->index = (map_it.entry ?
+			     map_it.entry->value : DRGN_DWARF_INDEX_DIE_END);
+	} else {
+		it->shard = NULL;
+		it->index = DRGN_DWARF_INDEX_DIE_END;
+	}
+	it->last = DRGN_DWARF_INDEX_DIE_END;
+}
+
 /**
  * Create an iterator over DIEs in a DWARF index namespace.
  *
+ * Deferred CUs are indexed by @ref drgn_dwarf_index_iterator_next() when the
+ * global namespace runs out of matches, so a lookup that is satisfied by the
+ * CUs that are already indexed doesn't wait for the rest. Nested namespaces
+ * are indexed from every CU up front.
+ *
  * @param[out] it DWARF index iterator to initialize.
  * @param[in] ns Namespace DWARF index.
- * @param[in] name Name of DIE to search for.
+ * @param[in] name Name of DIE to search for. Must remain valid for the
+ * lifetime of the iterator.
  * @param[in] name_len Length of @c name.
  * @param[in] tags List of DIE tags to search for.
  * @param[in] num_tags Number of tags in @p tags, or zero to search for any tag.
@@ -3052,23 +5144,22 @@ drgn_dwarf_index_iterator_init(struct drgn_dwarf_index_iterator *it,
 			       const char *name, size_t name_len,
 			       const uint64_t *tags, size_t num_tags)
 {
-	struct drgn_error *err = index_namespace(ns);
+	struct drgn_error *err;
+	if (ns != &ns->dbinfo->dwarf.global) {
+		err = drgn_dwarf_info_index_deferred(ns->dbinfo);
+		if (err)
+			return err;
+	}
+	err = index_namespace(ns);
 	if (err)
 		return err;
-	if (ns->shards) {
-		struct nstring key = { name, name_len };
-		struct hash_pair hp = drgn_dwarf_index_die_map_hash(&key);
-		it->shard = &ns->shards[hash_pair_to_shard(hp)];
-		struct drgn_dwarf_index_die_map_iterator map_it =
-			drgn_dwarf_index_die_map_search_hashed(&it->shard->map,
-							       &key, hp);
-		it->index = map_it.entry ? map_it.entry->value : UINT32_MAX;
-	} else {
-		it->shard = NULL;
-		it->index = UINT32_MAX;
-	}
 	it->tags = tags;
 	it->num_tags = num_tags;
+	it->dbinfo = ns->dbinfo;
+	it->ns = ns;
+	it->key = (struct nstring){ name, name_len };
+	it->hp = drgn_dwarf_index_die_map_hash(&it->key);
+	drgn_dwarf_index_iterator_search(it);
 	return NULL;
 }
 
@@ -3088,51 +5179,96 @@ drgn_dwarf_index_iterator_matches_tag(struct drgn_dwarf_index_iterator *it,
 /**
  * Get the next matching DIE from a DWARF index iterator.
  *
- * If matching any name, this is O(n), where n is the number of indexed DIEs. If
- * matching by name, this is O(1) on average and O(n) worst case.
+ * This is O(1) on average and O(n) worst case, where n is the number of
+ * indexed DIEs.
  *
  * Note that this returns the parent `DW_TAG_enumeration_type` for indexed
  * `DW_TAG_enumerator` DIEs.
  *
+ * If there are no more matches in the indexed CUs, this indexes any deferred
+ * CUs and continues with the DIEs that they added. That may reallocate the
+ * index, so DIEs previously returned by the iterator must not be used after
+ * calling this again.
+ *
  * @param[in] it DWARF index iterator.
- * @return Next DIE, or @c NULL if there are no more matching DIEs.
+ * @param[out] ret Returned DIE, or @c NULL if there are no more matching DIEs.
+ * @return @c NULL on success, non-@c NULL on error.
  */
-static struct drgn_dwarf_index_die *
-drgn_dwarf_index_iterator_next(struct drgn_dwarf_index_iterator *it)
+static struct drgn_error *
+drgn_dwarf_index_iterator_next(struct drgn_dwarf_index_iterator *it,
+			       struct drgn_dwarf_index_die **ret)
 {
-	while (it->index != UINT32_MAX) {
-		struct drgn_dwarf_index_die *die =
-			&it->shard->dies.data[it->index];
-		it->index = die->next;
-		if (drgn_dwarf_index_iterator_matches_tag(it, die))
-			return die;
+	struct drgn_dwarf_info *dwarf = &it->dbinfo->dwarf;
+	for (;;) {
+		while (it->index != DRGN_DWARF_INDEX_DIE_END) {
+			struct drgn_dwarf_index_die *die =
+				&it->shard->dies.data[it->index];
+			it->last = it->index;
+			it->index = die->next;
+			if (drgn_dwarf_index_iterator_matches_tag(it, die)) {
+				*ret = die;
+				return NULL;
+			}
+		}
+		if (dwarf->num_indexed_cus == dwarf->index_cus.size) {
+			*ret = NULL;
+			return NULL;
+		}
+		struct drgn_error *err =
+			drgn_dwarf_info_index_deferred(it->dbinfo);
+		if (err)
+			return err;
+		/* New DIEs are appended to the end of the chain. */
+		if (it->last == DRGN_DWARF_INDEX_DIE_END)
+			drgn_dwarf_index_iterator_search(it);
+		else
+			it->index = it->shard->dies.data[it->last].next;
 	}
-	return NULL;
+}
+
+/** Get the module containing a DIE returned by a DWARF index iterator. */
+static inline struct drgn_debug_info_module *
+drgn_dwarf_index_iterator_module(struct drgn_dwarf_index_iterator *it,
+				 struct drgn_dwarf_index_die *die)
+{
+	return it->dbinfo->dwarf.index_modules.data[die->module];
+}
+
+/**
+ * Get the nested namespace of a `DW_TAG_namespace` DIE returned by a DWARF
+ * index iterator.
+ */
+static inline struct drgn_namespace_dwarf_index *
+drgn_dwarf_index_iterator_namespace(struct drgn_dwarf_index_iterator *it,
+				    struct drgn_dwarf_index_die *die)
+{
+	return it->shard->namespaces.data[die->namespace];
 }
 
 /**
  * Get a @c Dwarf_Die from a @ref drgn_dwarf_index_die.
  *
+ * @param[in] module Module containing the DIE (from @ref
+ * drgn_dwarf_index_iterator_module()).
  * @param[in] die Indexed DIE.
  * @param[out] die_ret Returned DIE.
  * @return @c NULL on success, non-@c NULL on error.
  */
 static struct drgn_error *
-drgn_dwarf_index_get_die(struct drgn_dwarf_index_die *die, Dwarf_Die *die_ret)
+drgn_dwarf_index_get_die(struct drgn_debug_info_module *module,
+			 struct drgn_dwarf_index_die *die, Dwarf_Die *die_ret)
 {
 	Dwarf_Addr bias;
-	Dwarf *dwarf = dwfl_module_getdwarf(die->module->dwfl_module, &bias);
+	Dwarf *dwarf = dwfl_module_getdwarf(module->dwfl_module, &bias);
 	if (!dwarf)
 		return drgn_error_libdwfl();
-	uintptr_t start =
-		(uintptr_t)die->module->scn_data[DRGN_SCN_DEBUG_INFO]->d_buf;
-	size_t size = die->module->scn_data[DRGN_SCN_DEBUG_INFO]->d_size;
-	if (die->addr >= start && die->addr < start + size) {
-		if (!dwarf_offdie(dwarf, die->addr - start, die_ret))
+	size_t debug_info_size = module->scn_data[DRGN_SCN_DEBUG_INFO]->d_size;
+	if (die->offset < debug_info_size) {
+		if (!dwarf_offdie(dwarf, die->offset, die_ret))
 			return drgn_error_libdw();
 	} else {
-		start = (uintptr_t)die->module->scn_data[DRGN_SCN_DEBUG_TYPES]->d_buf;
-		if (!dwarf_offdie_types(dwarf, die->addr - start, die_ret))
+		if (!dwarf_offdie_types(dwarf, die->offset - debug_info_size,
+					die_ret))
 			return drgn_error_libdw();
 	}
 	return NULL;
@@ -3189,9 +5325,12 @@ drgn_debug_info_main_language(struct drgn_debug_info *dbinfo,
 	if (err)
 		return err;
 	struct drgn_dwarf_index_die *index_die;
-	while ((index_die = drgn_dwarf_index_iterator_next(&it))) {
+	while (!(err = drgn_dwarf_index_iterator_next(&it, &index_die)) &&
+	       index_die) {
+		struct drgn_debug_info_module *module =
+			drgn_dwarf_index_iterator_module(&it, index_die);
 		Dwarf_Die die;
-		err = drgn_dwarf_index_get_die(index_die, &die);
+		err = drgn_dwarf_index_get_die(module, index_die, &die);
 		if (err) {
 			drgn_error_destroy(err);
 			continue;
@@ -3205,6 +5344,8 @@ drgn_debug_info_main_language(struct drgn_debug_info *dbinfo,
 		if (*ret)
 			return NULL;
 	}
+	if (err)
+		return err;
 	*ret = NULL;
 	return NULL;
 }
@@ -3386,6 +5527,320 @@ next_unit:;
 #undef TOP
 }
 
+/*
+ * Start iterating over the DIEs in the unit containing the DIE at the given
+ * offset. it->dies is set to the unit DIE.
+ */
+static struct drgn_error *
+drgn_dwarf_die_iterator_init_unit(struct drgn_dwarf_die_iterator *it,
+				  Dwarf *dwarf, Dwarf_Off offset)
+{
+	drgn_dwarf_die_iterator_init(it, dwarf);
+	Dwarf_Die *cu_die = dwarf_die_vector_append_entry(&it->dies);
+	if (!cu_die)
+		return &drgn_enomem;
+	if (!dwarf_offdie(dwarf, offset, cu_die))
+		return drgn_error_libdw();
+	if (dwarf_next_unit(dwarf, offset - dwarf_cuoffset(cu_die),
+			    &it->next_cu_off, NULL, NULL, NULL, NULL, NULL,
+			    NULL, NULL))
+		return drgn_error_libdw();
+	it->cu_end = ((const char *)cu_die->addr
+		      - dwarf_dieoffset(cu_die)
+		      + it->next_cu_off);
+	return NULL;
+}
+
+DEFINE_VECTOR(drgn_dwarf_scope_vector, struct drgn_dwarf_unit_scope)
+DEFINE_VECTOR(drgn_dwarf_scope_range_vector,
+	      struct drgn_dwarf_scope_range)
+
+/* PC range of a scope while building a drgn_dwarf_unit_scopes. */
+struct drgn_dwarf_pc_range {
+	uint64_t start, end;
+	uint32_t scope;
+	uint32_t depth;
+};
+
+DEFINE_VECTOR(drgn_dwarf_pc_range_vector,
+	      struct drgn_dwarf_pc_range)
+
+static int drgn_dwarf_pc_range_compare(const void *_a,
+						  const void *_b)
+{
+	const struct drgn_dwarf_pc_range *a = _a, *b = _b;
+	/*
+	 * Sort by start address, then outermost first: longest range first,
+	 * then shallowest DIE first.
+	 */
+	if (a->start != b->start)
+		return a->start < b->start ? -1 : 1;
+	if (a->end != b->end)
+		return a->end > b->end ? -1 : 1;
+	if (a->depth != b->depth)
+		return a->depth < b->depth ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Start a drgn_dwarf_unit_scope_range at the given address. A later range at
+ * the same address replaces an earlier one, and a range with the same scope as
+ * the previous range is merged into it.
+ */
+static bool
+drgn_dwarf_scope_range_start(struct drgn_dwarf_scope_range_vector *ranges,
+				  uint64_t start, uint32_t scope)
+{
+	if (ranges->size > 0) {
+		struct drgn_dwarf_scope_range *last =
+			&ranges->data[ranges->size - 1];
+		if (last->start == start) {
+			last->scope = scope;
+			if (ranges->size > 1 && last[-1].scope == scope)
+				ranges->size--;
+			return true;
+		}
+		if (last->scope == scope)
+			return true;
+	} else if (scope == UINT32_MAX) {
+		return true;
+	}
+	struct drgn_dwarf_scope_range range = { start, scope };
+	return drgn_dwarf_scope_range_vector_append(ranges, &range);
+}
+
+/*
+ * Flatten the (normally properly nested) PC ranges of the scopes in a unit so
+ * that each address maps to its innermost scope.
+ */
+static struct drgn_error *
+drgn_dwarf_flatten_scopes(struct drgn_dwarf_pc_range_vector *pc_ranges,
+			  struct drgn_dwarf_scope_range_vector *ranges)
+{
+	struct drgn_error *err;
+
+	qsort(pc_ranges->data, pc_ranges->size, sizeof(pc_ranges->data[0]),
+	      drgn_dwarf_pc_range_compare);
+
+	/* Stack of the ranges containing the current address. */
+	struct drgn_dwarf_pc_range_vector stack = VECTOR_INIT;
+	for (size_t i = 0; i <= pc_ranges->size; i++) {
+		struct drgn_dwarf_pc_range *range =
+			i < pc_ranges->size ? &pc_ranges->data[i] : NULL;
+		struct drgn_dwarf_pc_range *top =
+			stack.size ? &stack.data[stack.size - 1] : NULL;
+		/* Close the ranges that end before this one starts. */
+		while (top && (!range || top->end <= range->start)) {
+			uint64_t end = top->end;
+			stack.size--;
+			top = stack.size ? &stack.data[stack.size - 1] : NULL;
+			if (!drgn_dwarf_scope_range_start(ranges, end,
+							  top ? top->scope :
+							  UINT32_MAX))
+				goto enomem;
+		}
+		if (!range)
+			break;
+		/*
+		 * If the range isn't nested in the enclosing one (which is
+		 * invalid DWARF), truncate it.
+		 */
+		uint64_t end = top ? min(range->end, top->end) : range->end;
+		if (range->start >= end)
+			continue;
+		if (!drgn_dwarf_scope_range_start(ranges, range->start,
+						  range->scope))
+			goto enomem;
+		top = drgn_dwarf_pc_range_vector_append_entry(&stack);
+		if (!top)
+			goto enomem;
+		*top = *range;
+		top->end = end;
+	}
+	err = NULL;
+out:
+	drgn_dwarf_pc_range_vector_deinit(&stack);
+	return err;
+
+enomem:
+	err = &drgn_enomem;
+	goto out;
+}
+
+/*
+ * Build the index of the scopes in the unit whose unit DIE is at the given
+ * offset. This visits the same DIEs as a search for a PC would: every DIE with
+ * an address range whose ancestors below the unit DIE all have address ranges.
+ */
+static struct drgn_error *
+drgn_dwarf_unit_scopes_create(Dwarf *dwarf, Dwarf_Off offset,
+			      struct drgn_dwarf_unit_scopes **ret)
+{
+	struct drgn_error *err;
+
+	struct drgn_dwarf_scope_vector scopes = VECTOR_INIT;
+	struct drgn_dwarf_pc_range_vector pc_ranges = VECTOR_INIT;
+	struct drgn_dwarf_scope_range_vector ranges = VECTOR_INIT;
+	/* Index in scopes of each DIE in it.dies, or UINT32_MAX. */
+	struct uint32_vector scope_stack = VECTOR_INIT;
+
+	struct drgn_dwarf_die_iterator it;
+	err = drgn_dwarf_die_iterator_init_unit(&it, dwarf, offset);
+	if (err)
+		goto out;
+	if (!uint32_vector_append(&scope_stack, &(uint32_t){ UINT32_MAX }))
+		goto enomem;
+
+	bool children = true;
+	while (!(err = drgn_dwarf_die_iterator_next(&it, children, 1))) {
+		Dwarf_Die *die = &it.dies.data[it.dies.size - 1];
+		scope_stack.size = it.dies.size - 1;
+		uint32_t parent = scope_stack.data[scope_stack.size - 1];
+		if (scopes.size >= UINT32_MAX) {
+			err = drgn_error_create(DRGN_ERROR_OUT_OF_BOUNDS,
+						"too many scopes in unit");
+			goto out;
+		}
+		uint32_t scope = scopes.size;
+		uint32_t depth = it.dies.size - 1;
+
+		ptrdiff_t range_offset = 0;
+		Dwarf_Addr base, start, end;
+		size_t num_pc_ranges = pc_ranges.size;
+		while ((range_offset = dwarf_ranges(die, range_offset, &base,
+						    &start, &end)) > 0) {
+			if (start >= end)
+				continue;
+			struct drgn_dwarf_pc_range range = {
+				.start = start,
+				.end = end,
+				.scope = scope,
+				.depth = depth,
+			};
+			if (!drgn_dwarf_pc_range_vector_append(&pc_ranges,
+							       &range))
+				goto enomem;
+		}
+		if (range_offset < 0) {
+			err = drgn_error_libdw();
+			goto out;
+		}
+		children = pc_ranges.size > num_pc_ranges;
+		if (children) {
+			struct drgn_dwarf_unit_scope *entry =
+				drgn_dwarf_scope_vector_append_entry(&scopes);
+			if (!entry)
+				goto enomem;
+			entry->die = *die;
+			entry->parent = parent;
+			if (!uint32_vector_append(&scope_stack, &scope))
+				goto enomem;
+		}
+	}
+	if (err != &drgn_stop)
+		goto out;
+
+	err = drgn_dwarf_flatten_scopes(&pc_ranges, &ranges);
+	if (err)
+		goto out;
+
+	struct drgn_dwarf_unit_scopes *unit = malloc(sizeof(*unit));
+	if (!unit)
+		goto enomem;
+	unit->unit_die = it.dies.data[0];
+	drgn_dwarf_scope_vector_shrink_to_fit(&scopes);
+	unit->scopes = scopes.data;
+	drgn_dwarf_scope_range_vector_shrink_to_fit(&ranges);
+	unit->ranges = ranges.data;
+	unit->num_ranges = ranges.size;
+	*ret = unit;
+	scopes = (struct drgn_dwarf_scope_vector)VECTOR_INIT;
+	ranges = (struct drgn_dwarf_scope_range_vector)VECTOR_INIT;
+	err = NULL;
+out:
+	drgn_dwarf_die_iterator_deinit(&it);
+	uint32_vector_deinit(&scope_stack);
+	drgn_dwarf_scope_range_vector_deinit(&ranges);
+	drgn_dwarf_pc_range_vector_deinit(&pc_ranges);
+	drgn_dwarf_scope_vector_deinit(&scopes);
+	return err;
+
+enomem:
+	err = &drgn_enomem;
+	goto out;
+}
+
+/* Get the index of the scopes of a unit, building it if necessary. */
+static struct drgn_error *
+drgn_debug_info_module_unit_scopes(struct drgn_debug_info_module *module,
+				   Dwarf *dwarf, Dwarf_Off offset,
+				   struct drgn_dwarf_unit_scopes **ret)
+{
+	struct drgn_error *err;
+
+	if (!module->dwarf.unit_scopes) {
+		module->dwarf.unit_scopes =
+			malloc(sizeof(*module->dwarf.unit_scopes));
+		if (!module->dwarf.unit_scopes)
+			return &drgn_enomem;
+		drgn_dwarf_unit_scopes_map_init(module->dwarf.unit_scopes);
+	}
+
+	struct drgn_dwarf_unit_scopes_map_iterator it =
+		drgn_dwarf_unit_scopes_map_search(module->dwarf.unit_scopes,
+						  &offset);
+	if (it.entry) {
+		*ret = it.entry->value;
+		return NULL;
+	}
+
+	struct drgn_dwarf_unit_scopes_map_entry entry = { .key = offset };
+	err = drgn_dwarf_unit_scopes_create(dwarf, offset, &entry.value);
+	if (err)
+		return err;
+	if (drgn_dwarf_unit_scopes_map_insert(module->dwarf.unit_scopes,
+					      &entry, NULL) < 0) {
+		drgn_dwarf_unit_scopes_destroy(entry.value);
+		return &drgn_enomem;
+	}
+	*ret = entry.value;
+	return NULL;
+}
+
+/*
+ * Get the chain of scopes in a unit containing a PC, from the unit DIE to the
+ * innermost scope.
+ */
+static struct drgn_error *
+drgn_dwarf_unit_scopes_find(struct drgn_dwarf_unit_scopes *unit, uint64_t pc,
+			    Dwarf_Die **dies_ret, size_t *length_ret)
+{
+	/* Find the last range starting at or before pc. */
+	size_t lo = 0, hi = unit->num_ranges;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (unit->ranges[mid].start <= pc)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	uint32_t scope = lo ? unit->ranges[lo - 1].scope : UINT32_MAX;
+
+	size_t length = 1;
+	for (uint32_t i = scope; i != UINT32_MAX; i = unit->scopes[i].parent)
+		length++;
+	Dwarf_Die *dies = malloc_array(length, sizeof(dies[0]));
+	if (!dies)
+		return &drgn_enomem;
+	dies[0] = unit->unit_die;
+	size_t j = length;
+	for (uint32_t i = scope; i != UINT32_MAX; i = unit->scopes[i].parent)
+		dies[--j] = unit->scopes[i].die;
+	*dies_ret = dies;
+	*length_ret = length;
+	return NULL;
+}
+
 struct drgn_error *
 drgn_debug_info_module_find_dwarf_scopes(struct drgn_debug_info_module *module,
 					 uint64_t pc, uint64_t *bias_ret,
@@ -3407,64 +5862,40 @@ drgn_debug_info_module_find_dwarf_scopes(struct drgn_debug_info_module *module,
 	if (dwarf_getaranges(dwarf, &aranges, &naranges) < 0)
 		return drgn_error_libdw();
 
-	struct drgn_dwarf_die_iterator it;
-	bool children;
-	size_t subtree;
-	Dwarf_Off offset;
-	if (dwarf_getarangeinfo(dwarf_getarange_addr(aranges, pc), NULL, NULL,
-				&offset) >= 0) {
-		drgn_dwarf_die_iterator_init(&it, dwarf);
-		Dwarf_Die *cu_die = dwarf_die_vector_append_entry(&it.dies);
-		if (!cu_die) {
-			err = &drgn_enomem;
-			goto err;
-		}
-		if (!dwarf_offdie(dwarf, offset, cu_die)) {
-			err = drgn_error_libdw();
-			goto err;
-		}
-		if (dwarf_next_unit(dwarf, offset - dwarf_cuoffset(cu_die),
-				    &it.next_cu_off, NULL, NULL, NULL, NULL,
-				    NULL, NULL, NULL)) {
-			err = drgn_error_libdw();
-			goto err;
-		}
-		it.cu_end = ((const char *)cu_die->addr
-			     - dwarf_dieoffset(cu_die)
-			     + it.next_cu_off);
-		children = true;
-		subtree = 1;
-	} else {
+	Dwarf_Off offset;
+	if (dwarf_getarangeinfo(dwarf_getarange_addr(aranges, pc), NULL, NULL,
+				&offset) < 0) {
 		/*
 		 * Range was not found. .debug_aranges could be missing or
 		 * incomplete, so fall back to checking each CU.
 		 */
+		struct drgn_dwarf_die_iterator it;
 		drgn_dwarf_die_iterator_init(&it, dwarf);
-		children = false;
-		subtree = 0;
-	}
-
-	/* Now find DIEs containing the PC. */
-	while (!(err = drgn_dwarf_die_iterator_next(&it, children, subtree))) {
-		int r = dwarf_haspc(&it.dies.data[it.dies.size - 1], pc);
-		if (r > 0) {
-			children = true;
-			subtree = it.dies.size;
-		} else if (r < 0) {
-			err = drgn_error_libdw();
-			goto err;
+		while (!(err = drgn_dwarf_die_iterator_next(&it, false, 0))) {
+			int r = dwarf_haspc(&it.dies.data[0], pc);
+			if (r > 0) {
+				offset = dwarf_dieoffset(&it.dies.data[0]);
+				break;
+			} else if (r < 0) {
+				err = drgn_error_libdw();
+				break;
+			}
+		}
+		drgn_dwarf_die_iterator_deinit(&it);
+		if (err == &drgn_stop) {
+			*dies_ret = NULL;
+			*length_ret = 0;
+			return NULL;
+		} else if (err) {
+			return err;
 		}
 	}
-	if (err != &drgn_stop)
-		goto err;
-
-	*dies_ret = it.dies.data;
-	*length_ret = it.dies.size;
-	return NULL;
 
-err:
-	drgn_dwarf_die_iterator_deinit(&it);
-	return err;
+	struct drgn_dwarf_unit_scopes *unit;
+	err = drgn_debug_info_module_unit_scopes(module, dwarf, offset, &unit);
+	if (err)
+		return err;
+	return drgn_dwarf_unit_scopes_find(unit, pc, dies_ret, length_ret);
 }
 
 struct drgn_error *drgn_find_die_ancestors(Dwarf_Die *die, Dwarf_Die **dies_ret,
@@ -3728,11 +6159,15 @@ drgn_dwarf_read_loclistx(struct drgn_debug_info_module *module,
 	return NULL;
 }
 
+DEFINE_VECTOR(drgn_dwarf_loclist_entry_vector,
+	      struct drgn_dwarf_location_list_entry)
+
 static struct drgn_error *
 drgn_dwarf5_location_list(struct drgn_debug_info_module *module,
 			  Dwarf_Word offset, Dwarf_Die *cu_die,
-			  uint8_t address_size, uint64_t pc,
-			  const char **expr_ret, size_t *expr_size_ret)
+			  uint8_t address_size,
+			  struct drgn_dwarf_loclist_entry_vector *entries,
+			  struct drgn_dwarf_location_list *ret)
 {
 	struct drgn_error *err;
 
@@ -3756,8 +6191,8 @@ drgn_dwarf5_location_list(struct drgn_debug_info_module *module,
 	uint64_t base;
 	bool base_valid = false;
 	/* Default is unknown. May be overridden by DW_LLE_default_location. */
-	*expr_ret = NULL;
-	*expr_size_ret = 0;
+	ret->default_expr = NULL;
+	ret->default_expr_size = 0;
 	for (;;) {
 		uint8_t kind;
 		if ((err = binary_buffer_next_u8(&buffer.bb, &kind)))
@@ -3790,11 +6225,15 @@ counted_location_description:
 				return binary_buffer_error(&buffer.bb,
 							   "location description size is out of bounds");
 			}
-			if (pc >= start && pc - start < length) {
-				*expr_ret = buffer.bb.pos;
-				*expr_size_ret = expr_size;
-				return NULL;
-			}
+			struct drgn_dwarf_location_list_entry entry = {
+				.start = start,
+				.length = length,
+				.expr = buffer.bb.pos,
+				.expr_size = expr_size,
+			};
+			if (!drgn_dwarf_loclist_entry_vector_append(entries,
+								    &entry))
+				return &drgn_enomem;
 			buffer.bb.pos += expr_size;
 			break;
 		case DW_LLE_startx_length:
@@ -3829,8 +6268,8 @@ counted_location_description:
 				return binary_buffer_error(&buffer.bb,
 							   "location description size is out of bounds");
 			}
-			*expr_ret = buffer.bb.pos;
-			*expr_size_ret = expr_size;
+			ret->default_expr = buffer.bb.pos;
+			ret->default_expr_size = expr_size;
 			buffer.bb.pos += expr_size;
 			break;
 		case DW_LLE_base_address:
@@ -3869,8 +6308,9 @@ counted_location_description:
 static struct drgn_error *
 drgn_dwarf4_location_list(struct drgn_debug_info_module *module,
 			  Dwarf_Word offset, Dwarf_Die *cu_die,
-			  uint8_t address_size, uint64_t pc,
-			  const char **expr_ret, size_t *expr_size_ret)
+			  uint8_t address_size,
+			  struct drgn_dwarf_loclist_entry_vector *entries,
+			  struct drgn_dwarf_location_list *ret)
 {
 	struct drgn_error *err;
 
@@ -3892,6 +6332,8 @@ drgn_dwarf4_location_list(struct drgn_debug_info_module *module,
 	uint64_t address_max = uint_max(address_size);
 	uint64_t base;
 	bool base_valid = false;
+	ret->default_expr = NULL;
+	ret->default_expr_size = 0;
 	for (;;) {
 		uint64_t start, end;
 		if ((err = binary_buffer_next_uint(&buffer.bb, address_size,
@@ -3900,8 +6342,6 @@ drgn_dwarf4_location_list(struct drgn_debug_info_module *module,
 						   &end)))
 			return err;
 		if (start == 0 && end == 0) {
-			*expr_ret = NULL;
-			*expr_size_ret = 0;
 			return NULL;
 		} else if (start == address_max) {
 			base = end;
@@ -3922,16 +6362,89 @@ drgn_dwarf4_location_list(struct drgn_debug_info_module *module,
 				return binary_buffer_error(&buffer.bb,
 							   "location description size is out of bounds");
 			}
-			if (base + start <= pc && pc < base + end) {
-				*expr_ret = buffer.bb.pos;
-				*expr_size_ret = expr_size;
-				return NULL;
-			}
+			struct drgn_dwarf_location_list_entry entry = {
+				.start = base + start,
+				.expr = buffer.bb.pos,
+				.expr_size = expr_size,
+			};
+			/* An empty or inverted range never matches. */
+			if (base + end > base + start)
+				entry.length = (base + end) - (base + start);
+			else
+				entry.length = 0;
+			if (!drgn_dwarf_loclist_entry_vector_append(entries,
+								    &entry))
+				return &drgn_enomem;
 			buffer.bb.pos += expr_size;
 		}
 	}
 }
 
+/*
+ * Get a location list, decoding it and caching it in the module if this is the
+ * first time it has been used.
+ */
+static struct drgn_error *
+drgn_dwarf_location_list(struct drgn_debug_info_module *module,
+			 Dwarf_Word offset, Dwarf_Die *cu_die,
+			 Dwarf_Half cu_version, uint8_t address_size,
+			 struct drgn_dwarf_location_list **ret)
+{
+	struct drgn_error *err;
+
+	if (!module->dwarf.location_lists) {
+		module->dwarf.location_lists =
+			malloc(sizeof(*module->dwarf.location_lists));
+		if (!module->dwarf.location_lists)
+			return &drgn_enomem;
+		drgn_dwarf_location_list_map_init(module->dwarf.location_lists);
+	}
+
+	uint64_t key = offset | (cu_version >= 5 ? UINT64_C(1) << 63 : 0);
+	struct drgn_dwarf_location_list_map_iterator it =
+		drgn_dwarf_location_list_map_search(module->dwarf.location_lists,
+						    &key);
+	if (it.entry) {
+		*ret = it.entry->value;
+		return NULL;
+	}
+
+	struct drgn_dwarf_location_list *list = malloc(sizeof(*list));
+	if (!list)
+		return &drgn_enomem;
+	struct drgn_dwarf_loclist_entry_vector entries = VECTOR_INIT;
+	if (cu_version >= 5) {
+		err = drgn_dwarf5_location_list(module, offset, cu_die,
+						address_size, &entries, list);
+	} else {
+		err = drgn_dwarf4_location_list(module, offset, cu_die,
+						address_size, &entries, list);
+	}
+	if (err)
+		goto err;
+	drgn_dwarf_loclist_entry_vector_shrink_to_fit(&entries);
+	list->entries = entries.data;
+	list->num_entries = entries.size;
+	entries = (struct drgn_dwarf_loclist_entry_vector)VECTOR_INIT;
+
+	struct drgn_dwarf_location_list_map_entry entry = {
+		.key = key,
+		.value = list,
+	};
+	if (drgn_dwarf_location_list_map_insert(module->dwarf.location_lists,
+						&entry, NULL) < 0) {
+		drgn_dwarf_location_list_destroy(list);
+		return &drgn_enomem;
+	}
+	*ret = list;
+	return NULL;
+
+err:
+	drgn_dwarf_loclist_entry_vector_deinit(&entries);
+	free(list);
+	return err;
+}
+
 static struct drgn_error *
 drgn_dwarf_location(struct drgn_debug_info_module *module,
 		    Dwarf_Attribute *attr,
@@ -3978,17 +6491,24 @@ drgn_dwarf_location(struct drgn_debug_info_module *module,
 				 NULL, NULL, NULL);
 		pc.value = pc.value - !regs->interrupted - bias;
 
-		if (cu_version >= 5) {
-			return drgn_dwarf5_location_list(module, offset,
-							 &cu_die, address_size,
-							 pc.value, expr_ret,
-							 expr_size_ret);
-		} else {
-			return drgn_dwarf4_location_list(module, offset,
-							 &cu_die, address_size,
-							 pc.value, expr_ret,
-							 expr_size_ret);
+		struct drgn_dwarf_location_list *list;
+		err = drgn_dwarf_location_list(module, offset, &cu_die,
+					       cu_version, address_size, &list);
+		if (err)
+			return err;
+		for (size_t i = 0; i < list->num_entries; i++) {
+			const struct drgn_dwarf_location_list_entry *entry =
+				&list->entries[i];
+			if (pc.value >= entry->start &&
+			    pc.value - entry->start < entry->length) {
+				*expr_ret = entry->expr;
+				*expr_size_ret = entry->expr_size;
+				return NULL;
+			}
 		}
+		*expr_ret = list->default_expr;
+		*expr_size_ret = list->default_expr_size;
+		return NULL;
 	}
 	default: {
 		Dwarf_Block block;
@@ -4544,6 +7064,17 @@ drgn_dwarf_frame_base(struct drgn_program *prog,
 	if (err)
 		return err;
 
+	/* This is the most common frame base, so handle it directly. */
+	if (expr_size == 1 && expr[0] == DW_OP_call_frame_cfa) {
+		if (!regs)
+			return &drgn_not_found;
+		struct optional_uint64 cfa = drgn_register_state_get_cfa(regs);
+		if (!cfa.has_value)
+			return &drgn_not_found;
+		*ret = cfa.value;
+		return NULL;
+	}
+
 	struct drgn_dwarf_expression_context ctx;
 	if ((err = drgn_dwarf_expression_context_init(&ctx, prog, module,
 						      die->cu, NULL, regs, expr,
@@ -4945,6 +7476,131 @@ static struct drgn_error *read_bits(struct drgn_program *prog, void *dst,
 	}
 }
 
+static uint64_t
+drgn_dwarf_location_bias_address(struct drgn_debug_info_module *module,
+				 uint64_t address)
+{
+	Dwarf_Addr start, end, bias;
+	dwfl_module_info(module->dwfl_module, NULL, &start, &end, &bias, NULL,
+			 NULL, NULL);
+	/*
+	 * If the address is not in the module's address range, then it's
+	 * probably something special like a Linux per-CPU variable (which isn't
+	 * actually a variable address but an offset). Don't apply the bias in
+	 * that case.
+	 */
+	if (start <= address + bias && address + bias < end)
+		address += bias;
+	return address;
+}
+
+static struct drgn_error *
+drgn_simple_dwarf_location_buffer_error(struct binary_buffer *bb,
+					const char *pos, const char *message)
+{
+	/* The full evaluator will report the error. */
+	return &drgn_not_found;
+}
+
+/*
+ * Most variables and parameters are described by a single DW_OP_regN,
+ * DW_OP_bregN, or DW_OP_fbreg operation. Translate those directly instead of
+ * going through the full expression evaluator. Returns &drgn_not_found if the
+ * expression isn't one of these or the result isn't trivially available, in
+ * which case the caller should fall back to the full evaluator.
+ */
+static struct drgn_error *
+drgn_object_from_simple_dwarf_location(struct drgn_program *prog,
+				       struct drgn_debug_info_module *module,
+				       const struct drgn_object_type *type,
+				       const char *expr, size_t expr_size,
+				       Dwarf_Die *function_die,
+				       const struct drgn_register_state *regs,
+				       struct drgn_object *ret)
+{
+	struct drgn_error *err;
+	bool little_endian = drgn_platform_is_little_endian(&module->platform);
+
+	if (!regs || expr_size == 0)
+		return &drgn_not_found;
+
+	struct binary_buffer bb;
+	binary_buffer_init(&bb, expr, expr_size, little_endian,
+			   drgn_simple_dwarf_location_buffer_error);
+	uint8_t opcode;
+	if ((err = binary_buffer_next_u8(&bb, &opcode)))
+		return err;
+	uint64_t dwarf_regno;
+	int64_t offset;
+	bool is_register = false;
+	uint64_t base;
+	switch (opcode) {
+	case DW_OP_reg0 ... DW_OP_reg31:
+		dwarf_regno = opcode - DW_OP_reg0;
+		is_register = true;
+		break;
+	case DW_OP_regx:
+		if ((err = binary_buffer_next_uleb128(&bb, &dwarf_regno)))
+			return err;
+		is_register = true;
+		break;
+	case DW_OP_breg0 ... DW_OP_breg31:
+		dwarf_regno = opcode - DW_OP_breg0;
+		goto breg;
+	case DW_OP_bregx:
+		if ((err = binary_buffer_next_uleb128(&bb, &dwarf_regno)))
+			return err;
+breg:
+		if ((err = binary_buffer_next_sleb128(&bb, &offset)))
+			return err;
+		break;
+	case DW_OP_fbreg: {
+		if ((err = binary_buffer_next_sleb128(&bb, &offset)))
+			return err;
+		if (binary_buffer_has_next(&bb))
+			return &drgn_not_found;
+		int remaining_ops = MAX_DWARF_EXPR_OPS;
+		err = drgn_dwarf_frame_base(prog, module, function_die, regs,
+					    &remaining_ops, &base);
+		if (err)
+			return err;
+		goto address;
+	}
+	default:
+		return &drgn_not_found;
+	}
+	if (binary_buffer_has_next(&bb))
+		return &drgn_not_found;
+
+	drgn_register_number regno =
+		module->platform.arch->dwarf_regno_to_internal(dwarf_regno);
+	if (!drgn_register_state_has_register(regs, regno))
+		return &drgn_not_found;
+	const struct drgn_register_layout *layout =
+		&prog->platform.arch->register_layout[regno];
+	if (is_register) {
+		/*
+		 * Only handle objects that fit in the register exactly or in
+		 * its low-order bytes.
+		 */
+		if (type->bit_size == 0 || type->bit_size % 8 != 0 ||
+		    type->bit_size / 8 > layout->size)
+			return &drgn_not_found;
+		const char *src = (const char *)&regs->buf[layout->offset];
+		if (!little_endian)
+			src += layout->size - type->bit_size / 8;
+		return drgn_object_set_from_buffer_internal(ret, type, src, 0);
+	}
+	copy_lsbytes(&base, sizeof(base), HOST_LITTLE_ENDIAN,
+		     &regs->buf[layout->offset], layout->size, little_endian);
+
+address:;
+	uint64_t address = ((base + offset)
+			    & drgn_platform_address_mask(&module->platform));
+	address = drgn_dwarf_location_bias_address(module, address);
+	return drgn_object_set_reference_internal(ret, type, address, 0);
+}
+
 static struct drgn_error *
 drgn_object_from_dwarf_location(struct drgn_program *prog,
 				struct drgn_debug_info_module *module,
@@ -4966,6 +7622,12 @@ drgn_object_from_dwarf_location(struct drgn_program *prog,
 	if (err)
 		return err;
 
+	err = drgn_object_from_simple_dwarf_location(prog, module, &type, expr,
+						     expr_size, function_die,
+						     regs, ret);
+	if (err != &drgn_not_found)
+		return err;
+
 	union drgn_value value;
 	char *value_buf = NULL;
 
@@ -5223,17 +7885,7 @@ absent:
 		drgn_object_reinit(ret, &type, DRGN_OBJECT_ABSENT);
 		err = NULL;
 	} else if (bit_offset >= 0) {
-		Dwarf_Addr start, end, bias;
-		dwfl_module_info(module->dwfl_module, NULL, &start, &end, &bias,
-				 NULL, NULL, NULL);
-		/*
-		 * If the address is not in the module's address range, then
-		 * it's probably something special like a Linux per-CPU variable
-		 * (which isn't actually a variable address but an offset).
-		 * Don't apply the bias in that case.
-		 */
-		if (start <= address + bias && address + bias < end)
-			address += bias;
+		address = drgn_dwarf_location_bias_address(module, address);
 		err = drgn_object_set_reference_internal(ret, &type, address,
 							 bit_offset);
 	} else if (type.encoding == DRGN_OBJECT_ENCODING_BUFFER) {
@@ -5495,24 +8147,30 @@ drgn_debug_info_find_complete(struct drgn_debug_info *dbinfo, uint64_t tag,
 	 * Find a matching DIE. Note that drgn_dwarf_index does not contain DIEs
 	 * with DW_AT_declaration, so this will always be a complete type.
 	 */
-	struct drgn_dwarf_index_die *index_die =
-		drgn_dwarf_index_iterator_next(&it);
+	struct drgn_dwarf_index_die *index_die;
+	err = drgn_dwarf_index_iterator_next(&it, &index_die);
+	if (err)
+		return err;
 	if (!index_die)
 		return &drgn_not_found;
+	struct drgn_debug_info_module *module =
+		drgn_dwarf_index_iterator_module(&it, index_die);
+	Dwarf_Die die;
+	err = drgn_dwarf_index_get_die(module, index_die, &die);
+	if (err)
+		return err;
 	/*
 	 * Look for another matching DIE. If there is one, then we can't be sure
 	 * which type this is, so leave it incomplete rather than guessing.
 	 */
-	if (drgn_dwarf_index_iterator_next(&it))
-		return &drgn_not_found;
-
-	Dwarf_Die die;
-	err = drgn_dwarf_index_get_die(index_die, &die);
+	err = drgn_dwarf_index_iterator_next(&it, &index_die);
 	if (err)
 		return err;
+	if (index_die)
+		return &drgn_not_found;
+
 	struct drgn_qualified_type qualified_type;
-	err = drgn_type_from_dwarf(dbinfo, index_die->module, &die,
-				   &qualified_type);
+	err = drgn_type_from_dwarf(dbinfo, module, &die, &qualified_type);
 	if (err)
 		return err;
 	*ret = qualified_type.type;
@@ -6541,9 +9199,23 @@ drgn_type_from_dwarf_internal(struct drgn_debug_info *dbinfo,
 	if (dwarf_flag(die, DW_AT_declaration, &declaration))
 		return drgn_error_libdw();
 	if (declaration) {
+		/* The definition is usually already indexed; try that first. */
 		uintptr_t die_addr;
-		if (drgn_dwarf_find_definition(dbinfo, (uintptr_t)die->addr,
-					       &module, &die_addr)) {
+		bool found = drgn_dwarf_find_definition(dbinfo,
+							(uintptr_t)die->addr,
+							&module, &die_addr);
+		struct drgn_dwarf_info *dwarf_info = &dbinfo->dwarf;
+		if (!found &&
+		    dwarf_info->num_indexed_cus < dwarf_info->index_cus.size) {
+			struct drgn_error *err =
+				drgn_dwarf_info_index_deferred(dbinfo);
+			if (err)
+				return err;
+			found = drgn_dwarf_find_definition(dbinfo,
+							   (uintptr_t)die->addr,
+							   &module, &die_addr);
+		}
+		if (found) {
 			Dwarf_Addr bias;
 			Dwarf *dwarf = dwfl_module_getdwarf(module->dwfl_module,
 							    &bias);
@@ -6582,6 +9254,7 @@ drgn_type_from_dwarf_internal(struct drgn_debug_info *dbinfo,
 							       &entry.key, hp);
 		}
 		if (it.entry) {
+			dbinfo->prog->stats.dwarf_type_cache_hits++;
 			ret->type = it.entry->value.type;
 			ret->qualifiers = it.entry->value.qualifiers;
 			return NULL;
@@ -6593,6 +9266,8 @@ drgn_type_from_dwarf_internal(struct drgn_debug_info *dbinfo,
 	if (err)
 		return err;
 
+	/* Only time the outermost type so that nested types aren't counted. */
+	uint64_t start_time = dbinfo->dwarf.depth ? 0 : monotonic_ns();
 	ret->qualifiers = 0;
 	dbinfo->dwarf.depth++;
 	entry.value.is_incomplete_array = false;
@@ -6676,8 +9351,11 @@ drgn_type_from_dwarf_internal(struct drgn_debug_info *dbinfo,
 		break;
 	}
 	dbinfo->dwarf.depth--;
+	if (!dbinfo->dwarf.depth)
+		dbinfo->prog->stats.dwarf_type_ns += monotonic_ns() - start_time;
 	if (err)
 		return err;
+	dbinfo->prog->stats.dwarf_types++;
 
 	entry.value.type = ret->type;
 	entry.value.qualifiers = ret->qualifiers;
@@ -6698,6 +9376,154 @@ drgn_type_from_dwarf_internal(struct drgn_debug_info *dbinfo,
 	return NULL;
 }
 
+/*
+ * Find the first "::" in a canonical C++ name that isn't inside of a template
+ * argument list.
+ */
+static const char *cpp_find_scope_operator(const char *name, size_t len)
+{
+	int depth = 0;
+	for (size_t i = 0; i < len; i++) {
+		if (name[i] == '<' || name[i] == '(') {
+			depth++;
+		} else if (name[i] == '>' || name[i] == ')') {
+			if (depth)
+				depth--;
+		} else if (!depth && name[i] == ':' && i + 1 < len &&
+			   name[i + 1] == ':') {
+			return &name[i];
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Add a name from a namespace index to the names that share its canonical
+ * spelling. sb is scratch space.
+ */
+static bool
+drgn_dwarf_canonical_names_add(struct drgn_dwarf_canonical_names *names,
+			       const struct nstring *raw,
+			       struct string_builder *sb)
+{
+	sb->len = 0;
+	if (!drgn_cpp_canonicalize_name(raw->str, raw->len, sb))
+		return false;
+	struct nstring key = { sb->str, sb->len };
+	struct hash_pair hp = drgn_dwarf_canonical_name_map_hash(&key);
+	struct drgn_dwarf_canonical_name_map_iterator it =
+		drgn_dwarf_canonical_name_map_search_hashed(&names->map, &key,
+							    hp);
+	if (!it.entry) {
+		struct drgn_dwarf_canonical_name_map_entry entry = {
+			.key = { memdup(sb->str, sb->len), sb->len },
+			.value = VECTOR_INIT,
+		};
+		if (!entry.key.str)
+			return false;
+		if (drgn_dwarf_canonical_name_map_insert_searched(&names->map,
+								  &entry, hp,
+								  &it) < 0) {
+			free((char *)entry.key.str);
+			return false;
+		}
+	}
+	return drgn_dwarf_raw_name_vector_append(&it.entry->value, raw);
+}
+
+/*
+ * Get the canonical name map of a namespace, (re)building it if any DIEs were
+ * added since it was last built.
+ */
+static struct drgn_error *
+drgn_namespace_canonical_names(struct drgn_namespace_dwarf_index *ns,
+			       struct drgn_dwarf_canonical_name_map **ret)
+{
+	struct drgn_error *err;
+
+	/* The map must cover every CU. */
+	err = drgn_dwarf_info_index_deferred(ns->dbinfo);
+	if (err)
+		return err;
+	err = index_namespace(ns);
+	if (err)
+		return err;
+
+	size_t num_dies = 0;
+	if (ns->shards) {
+		for (size_t i = 0; i < DRGN_DWARF_INDEX_NUM_SHARDS; i++)
+			num_dies += ns->shards[i].dies.size;
+	}
+	if (ns->canonical_names && ns->canonical_names->num_dies == num_dies) {
+		*ret = &ns->canonical_names->map;
+		return NULL;
+	}
+	drgn_dwarf_canonical_names_destroy(ns->canonical_names);
+	ns->canonical_names = malloc(sizeof(*ns->canonical_names));
+	if (!ns->canonical_names)
+		return &drgn_enomem;
+	struct drgn_dwarf_canonical_names *names = ns->canonical_names;
+	drgn_dwarf_canonical_name_map_init(&names->map);
+	names->num_dies = num_dies;
+
+	struct string_builder sb = {};
+	for (size_t i = 0; ns->shards && i < DRGN_DWARF_INDEX_NUM_SHARDS; i++) {
+		for (struct drgn_dwarf_index_die_map_iterator it =
+		     drgn_dwarf_index_die_map_first(&ns->shards[i].map);
+		     it.entry; it = drgn_dwarf_index_die_map_next(it)) {
+			struct nstring *raw = &it.entry->key;
+			if (memchr(raw->str, '<', raw->len) &&
+			    !drgn_dwarf_canonical_names_add(names, raw, &sb)) {
+				free(sb.str);
+				drgn_dwarf_canonical_names_destroy(names);
+				ns->canonical_names = NULL;
+				return &drgn_enomem;
+			}
+		}
+	}
+	free(sb.str);
+	*ret = &names->map;
+	return NULL;
+}
+
+static struct drgn_error *
+drgn_namespace_find_type(struct drgn_namespace_dwarf_index *ns,
+			 enum drgn_type_kind kind, uint64_t tag,
+			 const char *name, size_t name_len,
+			 const char *filename, struct drgn_qualified_type *ret)
+{
+	struct drgn_error *err;
+	struct drgn_dwarf_index_iterator it;
+	err = drgn_dwarf_index_iterator_init(&it, ns, name, name_len, &tag, 1);
+	if (err)
+		return err;
+	struct drgn_dwarf_index_die *index_die;
+	while (!(err = drgn_dwarf_index_iterator_next(&it, &index_die)) &&
+	       index_die) {
+		struct drgn_debug_info_module *module =
+			drgn_dwarf_index_iterator_module(&it, index_die);
+		Dwarf_Die die;
+		err = drgn_dwarf_index_get_die(module, index_die, &die);
+		if (err)
+			return err;
+		if (die_matches_filename(&die, filename)) {
+			err = drgn_type_from_dwarf(ns->dbinfo, module, &die,
+						   ret);
+			if (err)
+				return err;
+			/*
+			 * For DW_TAG_base_type, we need to check that the type
+			 * we found was the right kind.
+			 */
+			if (drgn_type_kind(ret->type) == kind)
+				return NULL;
+		}
+	}
+	if (err)
+		return err;
+	return &drgn_not_found;
+}
+
 struct drgn_error *drgn_debug_info_find_type(enum drgn_type_kind kind,
 					     const char *name, size_t name_len,
 					     const char *filename, void *arg,
@@ -6732,31 +9558,206 @@ struct drgn_error *drgn_debug_info_find_type(enum drgn_type_kind kind,
 		UNREACHABLE();
 	}
 
-	struct drgn_dwarf_index_iterator it;
-	err = drgn_dwarf_index_iterator_init(&it, &dbinfo->dwarf.global, name,
-					     name_len, &tag, 1);
+	/*
+	 * C names and unqualified C++ names without template arguments are
+	 * looked up directly.
+	 */
+	if (!memchr(name, ':', name_len) && !memchr(name, '<', name_len)) {
+		return drgn_namespace_find_type(&dbinfo->dwarf.global, kind,
+						tag, name, name_len, filename,
+						ret);
+	}
+
+	struct string_builder sb = {};
+	if (!drgn_cpp_canonicalize_name(name, name_len, &sb)) {
+		free(sb.str);
+		return &drgn_enomem;
+	}
+	struct drgn_namespace_dwarf_index *ns = &dbinfo->dwarf.global;
+	const char *p = sb.str, *end = sb.str + sb.len;
+	const char *colons;
+	/* Resolve the enclosing namespaces. */
+	while ((colons = cpp_find_scope_operator(p, end - p))) {
+		/*
+		 * Members of class templates are indexed under their class,
+		 * not a namespace.
+		 */
+		if (memchr(p, '<', colons - p)) {
+			err = &drgn_not_found;
+			goto out;
+		}
+		struct drgn_dwarf_index_iterator it;
+		uint64_t ns_tag = DW_TAG_namespace;
+		err = drgn_dwarf_index_iterator_init(&it, ns, p, colons - p,
+						     &ns_tag, 1);
+		if (err)
+			goto out;
+		struct drgn_dwarf_index_die *index_die;
+		err = drgn_dwarf_index_iterator_next(&it, &index_die);
+		if (err)
+			goto out;
+		if (!index_die) {
+			err = &drgn_not_found;
+			goto out;
+		}
+		ns = drgn_dwarf_index_iterator_namespace(&it, index_die);
+		p = colons + 2;
+	}
+
+	/* Try the canonical spelling first, then any other spellings. */
+	err = drgn_namespace_find_type(ns, kind, tag, p, end - p, filename,
+				       ret);
+	if (err != &drgn_not_found || !memchr(p, '<', end - p))
+		goto out;
+	struct drgn_dwarf_canonical_name_map *map;
+	err = drgn_namespace_canonical_names(ns, &map);
+	if (err)
+		goto out;
+	struct nstring key = { p, end - p };
+	struct drgn_dwarf_canonical_name_map_iterator it =
+		drgn_dwarf_canonical_name_map_search(map, &key);
+	err = &drgn_not_found;
+	if (!it.entry)
+		goto out;
+	/*
+	 * Copy the names since looking up a type may index deferred CUs and
+	 * invalidate the map.
+	 */
+	struct nstring *raw_names =
+		memdup(it.entry->value.data,
+		       it.entry->value.size * sizeof(raw_names[0]));
+	size_t num_raw_names = it.entry->value.size;
+	if (!raw_names) {
+		err = &drgn_enomem;
+		goto out;
+	}
+	for (size_t i = 0; i < num_raw_names; i++) {
+		if (nstring_eq(&raw_names[i], &key))
+			continue;
+		err = drgn_namespace_find_type(ns, kind, tag, raw_names[i].str,
+					       raw_names[i].len, filename, ret);
+		if (err != &drgn_not_found)
+			break;
+	}
+	free(raw_names);
+out:
+	free(sb.str);
+	return err;
+}
+
+DEFINE_VECTOR_FUNCTIONS(drgn_typep_vector)
+
+struct drgn_error *drgn_debug_info_types(struct drgn_debug_info *dbinfo,
+					 uint64_t kinds,
+					 struct drgn_typep_vector *ret)
+{
+	struct drgn_error *err;
+
+	uint64_t tags[6];
+	size_t num_tags = 0;
+	if (kinds & ((UINT64_C(1) << DRGN_TYPE_INT) |
+		     (UINT64_C(1) << DRGN_TYPE_BOOL) |
+		     (UINT64_C(1) << DRGN_TYPE_FLOAT)))
+		tags[num_tags++] = DW_TAG_base_type;
+	if (kinds & (UINT64_C(1) << DRGN_TYPE_STRUCT))
+		tags[num_tags++] = DW_TAG_structure_type;
+	if (kinds & (UINT64_C(1) << DRGN_TYPE_UNION))
+		tags[num_tags++] = DW_TAG_union_type;
+	if (kinds & (UINT64_C(1) << DRGN_TYPE_CLASS))
+		tags[num_tags++] = DW_TAG_class_type;
+	if (kinds & (UINT64_C(1) << DRGN_TYPE_ENUM))
+		tags[num_tags++] = DW_TAG_enumeration_type;
+	if (kinds & (UINT64_C(1) << DRGN_TYPE_TYPEDEF))
+		tags[num_tags++] = DW_TAG_typedef;
+	if (!num_tags)
+		return NULL;
+
+	/* Every DIE must be indexed before we walk the index. */
+	err = drgn_dwarf_info_index_deferred(dbinfo);
 	if (err)
 		return err;
-	struct drgn_dwarf_index_die *index_die;
-	while ((index_die = drgn_dwarf_index_iterator_next(&it))) {
-		Dwarf_Die die;
-		err = drgn_dwarf_index_get_die(index_die, &die);
-		if (err)
-			return err;
-		if (die_matches_filename(&die, filename)) {
-			err = drgn_type_from_dwarf(dbinfo, index_die->module,
-						   &die, ret);
+	struct drgn_namespace_dwarf_index *ns = &dbinfo->dwarf.global;
+	err = index_namespace(ns);
+	if (err)
+		return err;
+	if (!ns->shards)
+		return NULL;
+
+	/*
+	 * Find the matching DIEs in each shard in parallel. Converting them
+	 * can't be parallelized because libdw and the DWARF type cache aren't
+	 * thread-safe, but this scan touches every DIE in the index.
+	 */
+	struct uint32_vector *matches =
+		malloc_array(DRGN_DWARF_INDEX_NUM_SHARDS, sizeof(*matches));
+	if (!matches)
+		return &drgn_enomem;
+	for (size_t i = 0; i < DRGN_DWARF_INDEX_NUM_SHARDS; i++)
+		uint32_vector_init(&matches[i]);
+	bool oom = false;
+	#pragma omp parallel for schedule(dynamic) \
+		num_threads(drgn_program_num_parallel_threads(dbinfo->prog))
+	for (size_t i = 0; i < DRGN_DWARF_INDEX_NUM_SHARDS; i++) {
+		drgn_program_bind_parallel_thread(dbinfo->prog);
+		struct drgn_dwarf_index_shard *shard = &ns->shards[i];
+		for (uint32_t j = 0; j < shard->dies.size; j++) {
+			size_t k;
+			for (k = 0; k < num_tags; k++) {
+				if (shard->dies.data[j].tag == tags[k])
+					break;
+			}
+			if (k < num_tags &&
+			    !uint32_vector_append(&matches[i], &j)) {
+				#pragma omp atomic write
+				oom = true;
+				break;
+			}
+		}
+	}
+	if (oom) {
+		err = &drgn_enomem;
+		goto out;
+	}
+
+	struct drgn_debug_info_module **index_modules =
+		dbinfo->dwarf.index_modules.data;
+	for (size_t i = 0; i < DRGN_DWARF_INDEX_NUM_SHARDS; i++) {
+		struct drgn_dwarf_index_shard *shard = &ns->shards[i];
+		for (size_t j = 0; j < matches[i].size; j++) {
+			struct drgn_dwarf_index_die *index_die =
+				&shard->dies.data[matches[i].data[j]];
+			struct drgn_debug_info_module *module =
+				index_modules[index_die->module];
+			Dwarf_Die die;
+			err = drgn_dwarf_index_get_die(module, index_die, &die);
 			if (err)
-				return err;
+				goto out;
+			struct drgn_qualified_type qualified_type;
+			err = drgn_type_from_dwarf(dbinfo, module, &die,
+						   &qualified_type);
+			if (err)
+				goto out;
 			/*
 			 * For DW_TAG_base_type, we need to check that the type
-			 * we found was the right kind.
+			 * is one of the requested kinds.
 			 */
-			if (drgn_type_kind(ret->type) == kind)
-				return NULL;
+			enum drgn_type_kind kind =
+				drgn_type_kind(qualified_type.type);
+			if (!(kinds & (UINT64_C(1) << kind)))
+				continue;
+			if (!drgn_typep_vector_append(ret,
+						      &qualified_type.type)) {
+				err = &drgn_enomem;
+				goto out;
+			}
 		}
 	}
-	return &drgn_not_found;
+	err = NULL;
+out:
+	for (size_t i = 0; i < DRGN_DWARF_INDEX_NUM_SHARDS; i++)
+		uint32_vector_deinit(&matches[i]);
+	free(matches);
+	return err;
 }
 
 struct drgn_error *
@@ -6782,11 +9783,13 @@ drgn_debug_info_find_object(const char *name, size_t name_len,
 						     colons - name, &ns_tag, 1);
 		if (err)
 			return err;
-		struct drgn_dwarf_index_die *index_die =
-			drgn_dwarf_index_iterator_next(&it);
+		struct drgn_dwarf_index_die *index_die;
+		err = drgn_dwarf_index_iterator_next(&it, &index_die);
+		if (err)
+			return err;
 		if (!index_die)
 			return &drgn_not_found;
-		ns = index_die->namespace;
+		ns = drgn_dwarf_index_iterator_namespace(&it, index_die);
 		name_len -= colons + 2 - name;
 		name = colons + 2;
 	}
@@ -6806,24 +9809,44 @@ drgn_debug_info_find_object(const char *name, size_t name_len,
 	if (err)
 		return err;
 	struct drgn_dwarf_index_die *index_die;
-	while ((index_die = drgn_dwarf_index_iterator_next(&it))) {
+	while (!(err = drgn_dwarf_index_iterator_next(&it, &index_die)) &&
+	       index_die) {
+		struct drgn_debug_info_module *module =
+			drgn_dwarf_index_iterator_module(&it, index_die);
 		Dwarf_Die die;
-		err = drgn_dwarf_index_get_die(index_die, &die);
+		err = drgn_dwarf_index_get_die(module, index_die, &die);
 		if (err)
 			return err;
+		if (dwarf_tag(&die) == DW_TAG_enumerator) {
+			/*
+			 * Enumerators of anonymous enumerated types indexed
+			 * from .debug_names point to the enumerator DIE rather
+			 * than the enumeration_type DIE.
+			 */
+			Dwarf_Die *ancestors;
+			size_t num_ancestors;
+			err = drgn_find_die_ancestors(&die, &ancestors,
+						      &num_ancestors);
+			if (err)
+				return err;
+			die = ancestors[num_ancestors - 1];
+			free(ancestors);
+			if (dwarf_tag(&die) != DW_TAG_enumeration_type)
+				continue;
+		}
 		if (!die_matches_filename(&die, filename))
 			continue;
 		if (dwarf_tag(&die) == DW_TAG_enumeration_type) {
-			return drgn_object_from_dwarf_enumerator(dbinfo,
-								 index_die->module,
+			return drgn_object_from_dwarf_enumerator(dbinfo, module,
 								 &die, name,
 								 ret);
 		} else {
-			return drgn_object_from_dwarf(dbinfo, index_die->module,
-						      &die, NULL, NULL, NULL,
-						      ret);
+			return drgn_object_from_dwarf(dbinfo, module, &die,
+						      NULL, NULL, NULL, ret);
 		}
 	}
+	if (err)
+		return err;
 	return &drgn_not_found;
 }
 
@@ -6831,28 +9854,7 @@ drgn_debug_info_find_object(const char *name, size_t name_len,
  * Call frame information.
  */
 
-struct drgn_dwarf_cie {
-	/* Whether this CIE is from .eh_frame. */
-	bool is_eh;
-	/* Size of an address in this CIE in bytes. */
-	uint8_t address_size;
-	/* DW_EH_PE_* encoding of addresses in this CIE. */
-	uint8_t address_encoding;
-	/* Whether this CIE has a 'z' augmentation. */
-	bool have_augmentation_length;
-	/* Whether this CIE is for a signal handler ('S' augmentation). */
-	bool signal_frame;
-	drgn_register_number return_address_register;
-	uint64_t code_alignment_factor;
-	int64_t data_alignment_factor;
-	const char *initial_instructions;
-	size_t initial_instructions_size;
-};
-
 DEFINE_VECTOR(drgn_dwarf_fde_vector, struct drgn_dwarf_fde)
-DEFINE_VECTOR(drgn_dwarf_cie_vector, struct drgn_dwarf_cie)
-DEFINE_HASH_MAP(drgn_dwarf_cie_map, size_t, size_t, int_key_hash_pair,
-		scalar_key_eq)
 
 static struct drgn_error *
 drgn_dwarf_cfi_next_encoded(struct drgn_debug_info_buffer *buffer,
@@ -7130,13 +10132,156 @@ unknown_augmentation:
 	return NULL;
 }
 
+/*
+ * Parse the header of the CIE or FDE at the current position of a buffer. On
+ * return, the buffer is positioned after the CIE ID or CIE pointer, and its end
+ * is set to the end of the entry. If the entry is an FDE, its CIE pointer is
+ * returned as an offset from the beginning of the section.
+ */
+static struct drgn_error *
+drgn_dwarf_cfi_next_entry(struct drgn_debug_info_buffer *buffer,
+			  bool *terminator_ret, bool *is_fde_ret,
+			  size_t *cie_pointer_ret)
+{
+	bool is_eh = buffer->scn == DRGN_SCN_EH_FRAME;
+	Elf_Data *data = buffer->module->scn_data[buffer->scn];
+	struct drgn_error *err;
+
+	uint32_t tmp;
+	if ((err = binary_buffer_next_u32(&buffer->bb, &tmp)))
+		return err;
+	bool is_64_bit = tmp == UINT32_C(0xffffffff);
+	uint64_t length;
+	if (is_64_bit) {
+		if ((err = binary_buffer_next_u64(&buffer->bb, &length)))
+			return err;
+	} else {
+		length = tmp;
+	}
+	/*
+	 * Technically, a length of zero is only a terminator in .eh_frame, but
+	 * other consumers (binutils, elfutils, GDB) handle it the same way in
+	 * .debug_frame.
+	 */
+	if (length == 0) {
+		*terminator_ret = true;
+		return NULL;
+	}
+	*terminator_ret = false;
+	if (length > buffer->bb.end - buffer->bb.pos) {
+		return binary_buffer_error(&buffer->bb,
+					   "entry length is out of bounds");
+	}
+	buffer->bb.end = buffer->bb.pos + length;
+
+	/*
+	 * The Linux Standard Base Core Specification [1] states that the CIE
+	 * ID in .eh_frame is always 4 bytes. However, other consumers handle
+	 * it the same as in .debug_frame (8 bytes for the 64-bit format).
+	 *
+	 * 1: https://refspecs.linuxfoundation.org/LSB_5.0.0/LSB-Core-generic/LSB-Core-generic/ehframechpt.html
+	 */
+	uint64_t cie_pointer, cie_id;
+	if (is_64_bit) {
+		if ((err = binary_buffer_next_u64(&buffer->bb, &cie_pointer)))
+			return err;
+		cie_id = is_eh ? 0 : UINT64_C(0xffffffffffffffff);
+	} else {
+		if ((err = binary_buffer_next_u32_into_u64(&buffer->bb,
+							   &cie_pointer)))
+			return err;
+		cie_id = is_eh ? 0 : UINT64_C(0xffffffff);
+	}
+
+	if (cie_pointer == cie_id) {
+		*is_fde_ret = false;
+		return NULL;
+	}
+	if (is_eh) {
+		size_t pointer_offset = (buffer->bb.pos - (is_64_bit ? 8 : 4)
+					 - (char *)data->d_buf);
+		if (cie_pointer > pointer_offset) {
+			return binary_buffer_error(&buffer->bb,
+						   "CIE pointer is out of bounds");
+		}
+		cie_pointer = pointer_offset - cie_pointer;
+	} else if (cie_pointer > data->d_size) {
+		return binary_buffer_error(&buffer->bb,
+					   "CIE pointer is out of bounds");
+	}
+	*is_fde_ret = true;
+	*cie_pointer_ret = cie_pointer;
+	return NULL;
+}
+
+/*
+ * Parse the rest of an FDE after drgn_dwarf_cfi_next_entry(). The CIE is looked
+ * up in cie_map, or parsed and added to cie_map and cies if it hasn't been seen
+ * yet.
+ */
+static struct drgn_error *
+drgn_parse_dwarf_fde(struct drgn_debug_info_buffer *buffer,
+		     size_t cie_pointer, struct drgn_dwarf_cie_map *cie_map,
+		     struct drgn_dwarf_cie_vector *cies,
+		     struct drgn_dwarf_fde *fde)
+{
+	struct drgn_error *err;
+
+	struct drgn_dwarf_cie_map_entry entry = {
+		.key = cie_pointer,
+		.value = cies->size,
+	};
+	struct drgn_dwarf_cie_map_iterator it;
+	int r = drgn_dwarf_cie_map_insert(cie_map, &entry, &it);
+	struct drgn_dwarf_cie *cie;
+	if (r > 0) {
+		cie = drgn_dwarf_cie_vector_append_entry(cies);
+		if (!cie) {
+			drgn_dwarf_cie_map_delete_iterator(cie_map, it);
+			return &drgn_enomem;
+		}
+		err = drgn_parse_dwarf_cie(buffer->module, buffer->scn,
+					   cie_pointer, cie);
+		if (err) {
+			cies->size--;
+			drgn_dwarf_cie_map_delete_iterator(cie_map, it);
+			return err;
+		}
+	} else if (r == 0) {
+		cie = &cies->data[it.entry->value];
+	} else {
+		return &drgn_enomem;
+	}
+	fde->cie = it.entry->value;
+	if ((err = drgn_dwarf_cfi_next_encoded(buffer, cie->address_size,
+					       cie->address_encoding, 0,
+					       &fde->initial_location)) ||
+	    (err = drgn_dwarf_cfi_next_encoded(buffer, cie->address_size,
+					       cie->address_encoding & 0xf, 0,
+					       &fde->address_range)))
+		return err;
+	if (cie->have_augmentation_length) {
+		uint64_t augmentation_length;
+		if ((err = binary_buffer_next_uleb128(&buffer->bb,
+						      &augmentation_length)))
+			return err;
+		if (augmentation_length > buffer->bb.end - buffer->bb.pos) {
+			return binary_buffer_error(&buffer->bb,
+						   "augmentation length is out of bounds");
+		}
+		buffer->bb.pos += augmentation_length;
+	}
+	fde->instructions = buffer->bb.pos;
+	fde->instructions_size = buffer->bb.end - buffer->bb.pos;
+	return NULL;
+}
+
 static struct drgn_error *
 drgn_parse_dwarf_frames(struct drgn_debug_info_module *module,
 			enum drgn_debug_info_scn scn,
 			struct drgn_dwarf_cie_vector *cies,
 			struct drgn_dwarf_fde_vector *fdes)
 {
-	bool is_eh = scn == DRGN_SCN_EH_FRAME;
 	struct drgn_error *err;
 
 	if (!module->scns[scn])
@@ -7150,126 +10295,25 @@ drgn_parse_dwarf_frames(struct drgn_debug_info_module *module,
 
 	struct drgn_dwarf_cie_map cie_map = HASH_TABLE_INIT;
 	while (binary_buffer_has_next(&buffer.bb)) {
-		uint32_t tmp;
-		if ((err = binary_buffer_next_u32(&buffer.bb, &tmp)))
+		bool terminator, is_fde;
+		size_t cie_pointer;
+		err = drgn_dwarf_cfi_next_entry(&buffer, &terminator, &is_fde,
+						&cie_pointer);
+		if (err)
 			goto out;
-		bool is_64_bit = tmp == UINT32_C(0xffffffff);
-		uint64_t length;
-		if (is_64_bit) {
-			if ((err = binary_buffer_next_u64(&buffer.bb, &length)))
-				goto out;
-		} else {
-			length = tmp;
-		}
-		/*
-		 * Technically, a length of zero is only a terminator in
-		 * .eh_frame, but other consumers (binutils, elfutils, GDB)
-		 * handle it the same way in .debug_frame.
-		 */
-		if (length == 0)
+		if (terminator)
 			break;
-		if (length > buffer.bb.end - buffer.bb.pos) {
-			err = binary_buffer_error(&buffer.bb,
-						  "entry length is out of bounds");
-			goto out;
-		}
-		buffer.bb.end = buffer.bb.pos + length;
-
-		/*
-		 * The Linux Standard Base Core Specification [1] states that
-		 * the CIE ID in .eh_frame is always 4 bytes. However, other
-		 * consumers handle it the same as in .debug_frame (8 bytes for
-		 * the 64-bit format).
-		 *
-		 * 1: https://refspecs.linuxfoundation.org/LSB_5.0.0/LSB-Core-generic/LSB-Core-generic/ehframechpt.html
-		 */
-		uint64_t cie_pointer, cie_id;
-		if (is_64_bit) {
-			if ((err = binary_buffer_next_u64(&buffer.bb,
-							  &cie_pointer)))
-				goto out;
-			cie_id = is_eh ? 0 : UINT64_C(0xffffffffffffffff);
-		} else {
-			if ((err = binary_buffer_next_u32_into_u64(&buffer.bb,
-								   &cie_pointer)))
-				goto out;
-			cie_id = is_eh ? 0 : UINT64_C(0xffffffff);
-		}
-
-		if (cie_pointer != cie_id) {
-			if (is_eh) {
-				size_t pointer_offset =
-					(buffer.bb.pos
-					 - (is_64_bit ? 8 : 4)
-					 - (char *)data->d_buf);
-				if (cie_pointer > pointer_offset) {
-					err = binary_buffer_error(&buffer.bb,
-								  "CIE pointer is out of bounds");
-					goto out;
-				}
-				cie_pointer = pointer_offset - cie_pointer;
-			} else if (cie_pointer > data->d_size) {
-				err = binary_buffer_error(&buffer.bb,
-							  "CIE pointer is out of bounds");
-				goto out;
-			}
+		if (is_fde) {
 			struct drgn_dwarf_fde *fde =
 				drgn_dwarf_fde_vector_append_entry(fdes);
 			if (!fde) {
 				err = &drgn_enomem;
 				goto out;
 			}
-			struct drgn_dwarf_cie_map_entry entry = {
-				.key = cie_pointer,
-				.value = cies->size,
-			};
-			struct drgn_dwarf_cie_map_iterator it;
-			int r = drgn_dwarf_cie_map_insert(&cie_map, &entry,
-							  &it);
-			struct drgn_dwarf_cie *cie;
-			if (r > 0) {
-				cie = drgn_dwarf_cie_vector_append_entry(cies);
-				if (!cie) {
-					err = &drgn_enomem;
-					goto out;
-				}
-				err = drgn_parse_dwarf_cie(module, scn,
-							   cie_pointer, cie);
-				if (err)
-					goto out;
-			} else if (r == 0) {
-				cie = &cies->data[it.entry->value];
-			} else {
-				err = &drgn_enomem;
-				goto out;
-			}
-			if ((err = drgn_dwarf_cfi_next_encoded(&buffer,
-							       cie->address_size,
-							       cie->address_encoding,
-							       0,
-							       &fde->initial_location)) ||
-			    (err = drgn_dwarf_cfi_next_encoded(&buffer,
-							       cie->address_size,
-							       cie->address_encoding & 0xf,
-							       0,
-							       &fde->address_range)))
+			err = drgn_parse_dwarf_fde(&buffer, cie_pointer,
+						   &cie_map, cies, fde);
+			if (err)
 				goto out;
-			if (cie->have_augmentation_length) {
-				uint64_t augmentation_length;
-				if ((err = binary_buffer_next_uleb128(&buffer.bb,
-								      &augmentation_length)))
-					goto out;
-				if (augmentation_length >
-				    buffer.bb.end - buffer.bb.pos) {
-					err = binary_buffer_error(&buffer.bb,
-								  "augmentation length is out of bounds");
-					goto out;
-				}
-				buffer.bb.pos += augmentation_length;
-			}
-			fde->cie = it.entry->value;
-			fde->instructions = buffer.bb.pos;
-			fde->instructions_size = buffer.bb.end - buffer.bb.pos;
 		}
 
 		buffer.bb.pos = buffer.bb.end;
@@ -7307,6 +10351,111 @@ static int drgn_dwarf_fde_compar(const void *_a, const void *_b, void *arg)
 		return cies[a->cie].is_eh - cies[b->cie].is_eh;
 }
 
+/* Get the size of a fixed-size DW_EH_PE_* value, or 0 if it isn't fixed. */
+static uint8_t drgn_eh_pe_fixed_size(uint8_t encoding, uint8_t address_size)
+{
+	switch (encoding & 0xf) {
+	case DW_EH_PE_absptr:
+		return address_size;
+	case DW_EH_PE_udata2:
+	case DW_EH_PE_sdata2:
+		return 2;
+	case DW_EH_PE_udata4:
+	case DW_EH_PE_sdata4:
+		return 4;
+	case DW_EH_PE_udata8:
+	case DW_EH_PE_sdata8:
+		return 8;
+	default:
+		return 0;
+	}
+}
+
+/*
+ * Set up the binary search table from .eh_frame_hdr. If the module doesn't have
+ * a usable table, this returns NULL and leaves
+ * drgn_dwarf_module_info::eh_frame_hdr_table NULL.
+ */
+static struct drgn_error *
+drgn_debug_info_parse_eh_frame_hdr(struct drgn_debug_info_module *module)
+{
+	struct drgn_error *err;
+
+	/*
+	 * .debug_frame takes precedence over .eh_frame, so we can only use the
+	 * .eh_frame_hdr table if that's the only CFI.
+	 */
+	if (module->scns[DRGN_SCN_DEBUG_FRAME] ||
+	    !module->scns[DRGN_SCN_EH_FRAME] ||
+	    !module->scns[DRGN_SCN_EH_FRAME_HDR])
+		return NULL;
+	GElf_Shdr shdr_mem, *shdr;
+	shdr = gelf_getshdr(module->scns[DRGN_SCN_EH_FRAME_HDR], &shdr_mem);
+	if (!shdr)
+		return NULL;
+	uint64_t eh_frame_hdr_base = shdr->sh_addr;
+
+	err = drgn_debug_info_module_cache_section(module, DRGN_SCN_EH_FRAME);
+	if (err)
+		return err;
+	err = drgn_debug_info_module_cache_section(module,
+						   DRGN_SCN_EH_FRAME_HDR);
+	if (err)
+		return err;
+	if (!module->scn_data[DRGN_SCN_EH_FRAME]->d_buf ||
+	    !module->scn_data[DRGN_SCN_EH_FRAME_HDR]->d_buf)
+		return NULL;
+
+	/*
+	 * The header is a version, the encodings of eh_frame_ptr, fde_count,
+	 * and the table, and then eh_frame_ptr and fde_count. See
+	 * https://refspecs.linuxfoundation.org/LSB_5.0.0/LSB-Core-generic/LSB-Core-generic/ehframechpt.html.
+	 */
+	struct drgn_debug_info_buffer buffer;
+	drgn_debug_info_buffer_init(&buffer, module, DRGN_SCN_EH_FRAME_HDR);
+	uint8_t version, eh_frame_ptr_enc, fde_count_enc, table_enc;
+	if ((err = binary_buffer_next_u8(&buffer.bb, &version)) ||
+	    (err = binary_buffer_next_u8(&buffer.bb, &eh_frame_ptr_enc)) ||
+	    (err = binary_buffer_next_u8(&buffer.bb, &fde_count_enc)) ||
+	    (err = binary_buffer_next_u8(&buffer.bb, &table_enc)))
+		goto unusable;
+	/*
+	 * We can only binary search the table if its entries have a fixed
+	 * size. Every linker uses signed 4-byte offsets from the beginning of
+	 * .eh_frame_hdr, so that's the only encoding we handle.
+	 */
+	if (version != 1 || eh_frame_ptr_enc == DW_EH_PE_omit ||
+	    fde_count_enc == DW_EH_PE_omit ||
+	    (fde_count_enc & 0x70) != DW_EH_PE_absptr ||
+	    table_enc != (DW_EH_PE_datarel | DW_EH_PE_sdata4))
+		goto unusable;
+	uint8_t address_size = drgn_platform_address_size(&module->platform);
+	uint8_t eh_frame_ptr_size = drgn_eh_pe_fixed_size(eh_frame_ptr_enc,
+							  address_size);
+	uint8_t fde_count_size = drgn_eh_pe_fixed_size(fde_count_enc,
+						       address_size);
+	if (!eh_frame_ptr_size || !fde_count_size)
+		goto unusable;
+	uint64_t fde_count;
+	if ((err = binary_buffer_skip(&buffer.bb, eh_frame_ptr_size)) ||
+	    (err = binary_buffer_next_uint(&buffer.bb, fde_count_size,
+					   &fde_count)))
+		goto unusable;
+	if (fde_count > (buffer.bb.end - buffer.bb.pos) / 8)
+		goto unusable;
+
+	drgn_dwarf_cie_map_init(&module->dwarf.cie_map);
+	module->dwarf.eh_frame_hdr_table = buffer.bb.pos;
+	module->dwarf.eh_frame_hdr_table_size = fde_count;
+	module->dwarf.eh_frame_hdr_base = eh_frame_hdr_base;
+	return NULL;
+
+unusable:
+	/* Errors here aren't fatal; we can still parse .eh_frame fully. */
+	drgn_error_destroy(err);
+	return NULL;
+}
+
 static struct drgn_error *
 drgn_debug_info_parse_frames(struct drgn_debug_info_module *module)
 {
@@ -7319,6 +10468,10 @@ drgn_debug_info_parse_frames(struct drgn_debug_info_module *module)
 	drgn_debug_info_cache_sh_addr(module, DRGN_SCN_GOT,
 				      &module->dwarf.datarel_base);
 
+	err = drgn_debug_info_parse_eh_frame_hdr(module);
+	if (err || module->dwarf.eh_frame_hdr_table)
+		return err;
+
 	struct drgn_dwarf_cie_vector cies = VECTOR_INIT;
 	struct drgn_dwarf_fde_vector fdes = VECTOR_INIT;
 
@@ -7352,7 +10505,7 @@ drgn_debug_info_parse_frames(struct drgn_debug_info_module *module)
 	}
 	drgn_dwarf_fde_vector_shrink_to_fit(&fdes);
 
-	module->dwarf.cies = cies.data;
+	module->dwarf.cies = cies;
 	module->dwarf.fdes = fdes.data;
 	module->dwarf.num_fdes = fdes.size;
 	return NULL;
@@ -7363,9 +10516,79 @@ err:
 	return err;
 }
 
+static inline int32_t
+drgn_eh_frame_hdr_table_get(struct drgn_debug_info_module *module, size_t i)
+{
+	int32_t value;
+	memcpy(&value, module->dwarf.eh_frame_hdr_table + 4 * i, sizeof(value));
+	if (drgn_platform_bswap(&module->platform))
+		value = bswap_32(value);
+	return value;
+}
+
+/*
+ * Find and parse the FDE containing a program counter using the .eh_frame_hdr
+ * binary search table.
+ */
+static struct drgn_error *
+drgn_debug_info_find_fde_in_eh_frame_hdr(struct drgn_debug_info_module *module,
+					 uint64_t unbiased_pc,
+					 struct drgn_dwarf_fde *fde,
+					 bool *found_ret)
+{
+	struct drgn_error *err;
+	uint64_t base = module->dwarf.eh_frame_hdr_base;
+
+	*found_ret = false;
+	/* Find the last entry with an initial location <= unbiased_pc. */
+	size_t lo = 0, hi = module->dwarf.eh_frame_hdr_table_size;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		uint64_t initial_location =
+			base + drgn_eh_frame_hdr_table_get(module, 2 * mid);
+		if (initial_location <= unbiased_pc)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == 0)
+		return NULL;
+
+	Elf_Data *data = module->scn_data[DRGN_SCN_EH_FRAME];
+	uint64_t fde_offset = (base
+			       + drgn_eh_frame_hdr_table_get(module, 2 * lo - 1)
+			       - module->dwarf.pcrel_base);
+	if (fde_offset >= data->d_size) {
+		return drgn_error_create(DRGN_ERROR_OTHER,
+					 ".eh_frame_hdr FDE address is out of bounds");
+	}
+	struct drgn_debug_info_buffer buffer;
+	drgn_debug_info_buffer_init(&buffer, module, DRGN_SCN_EH_FRAME);
+	buffer.bb.pos += fde_offset;
+	bool terminator, is_fde;
+	size_t cie_pointer;
+	err = drgn_dwarf_cfi_next_entry(&buffer, &terminator, &is_fde,
+					&cie_pointer);
+	if (err)
+		return err;
+	if (terminator || !is_fde) {
+		return binary_buffer_error(&buffer.bb,
+					   ".eh_frame_hdr entry is not an FDE");
+	}
+	err = drgn_parse_dwarf_fde(&buffer, cie_pointer,
+				   &module->dwarf.cie_map, &module->dwarf.cies,
+				   fde);
+	if (err)
+		return err;
+	*found_ret = (unbiased_pc - fde->initial_location <
+		      fde->address_range);
+	return NULL;
+}
+
 static struct drgn_error *
 drgn_debug_info_find_fde(struct drgn_debug_info_module *module,
-			 uint64_t unbiased_pc, struct drgn_dwarf_fde **ret)
+			 uint64_t unbiased_pc, struct drgn_dwarf_fde *ret,
+			 bool *found_ret)
 {
 	struct drgn_error *err;
 
@@ -7376,6 +10599,13 @@ drgn_debug_info_find_fde(struct drgn_debug_info_module *module,
 		module->parsed_frames = true;
 	}
 
+	if (module->dwarf.eh_frame_hdr_table) {
+		return drgn_debug_info_find_fde_in_eh_frame_hdr(module,
+								unbiased_pc,
+								ret,
+								found_ret);
+	}
+
 	/* Binary search for the containing FDE. */
 	size_t lo = 0, hi = module->dwarf.num_fdes;
 	while (lo < hi) {
@@ -7387,11 +10617,12 @@ drgn_debug_info_find_fde(struct drgn_debug_info_module *module,
 			   fde->address_range) {
 			lo = mid + 1;
 		} else {
-			*ret = fde;
+			*ret = *fde;
+			*found_ret = true;
 			return NULL;
 		}
 	}
-	*ret = NULL;
+	*found_ret = false;
 	return NULL;
 }
 
@@ -7464,7 +10695,7 @@ drgn_eval_dwarf_cfi(struct drgn_debug_info_module *module,
 	struct drgn_error *err;
 	drgn_register_number (*dwarf_regno_to_internal)(uint64_t) =
 		module->platform.arch->dwarf_regno_to_internal;
-	struct drgn_dwarf_cie *cie = &module->dwarf.cies[fde->cie];
+	struct drgn_dwarf_cie *cie = &module->dwarf.cies.data[fde->cie];
 	uint64_t pc = fde->initial_location;
 
 	struct drgn_cfi_row_vector state_stack = VECTOR_INIT;
@@ -7777,7 +11008,7 @@ drgn_debug_info_find_cfi_in_fde(struct drgn_debug_info_module *module,
 				uint64_t unbiased_pc, struct drgn_cfi_row **ret)
 {
 	struct drgn_error *err;
-	struct drgn_dwarf_cie *cie = &module->dwarf.cies[fde->cie];
+	struct drgn_dwarf_cie *cie = &module->dwarf.cies.data[fde->cie];
 	struct drgn_cfi_row *initial_row =
 		(struct drgn_cfi_row *)module->platform.arch->default_dwarf_cfi_row;
 	err = drgn_eval_dwarf_cfi(module, fde, NULL, unbiased_pc,
@@ -7805,19 +11036,20 @@ drgn_debug_info_find_dwarf_cfi(struct drgn_debug_info_module *module,
 			       drgn_register_number *ret_addr_regno_ret)
 {
 	struct drgn_error *err;
-	struct drgn_dwarf_fde *fde;
-	err = drgn_debug_info_find_fde(module, unbiased_pc, &fde);
+	struct drgn_dwarf_fde fde;
+	bool found;
+	err = drgn_debug_info_find_fde(module, unbiased_pc, &fde, &found);
 	if (err)
 		return err;
-	if (!fde)
+	if (!found)
 		return &drgn_not_found;
-	err = drgn_debug_info_find_cfi_in_fde(module, fde, unbiased_pc,
+	err = drgn_debug_info_find_cfi_in_fde(module, &fde, unbiased_pc,
 					      row_ret);
 	if (err)
 		return err;
-	*interrupted_ret = module->dwarf.cies[fde->cie].signal_frame;
+	*interrupted_ret = module->dwarf.cies.data[fde.cie].signal_frame;
 	*ret_addr_regno_ret =
-		module->dwarf.cies[fde->cie].return_address_register;
+		module->dwarf.cies.data[fde.cie].return_address_register;
 	return NULL;
 }
 
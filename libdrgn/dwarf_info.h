@@ -23,17 +23,47 @@
 #include "cfi.h"
 #include "drgn.h"
 #include "hash_table.h"
+#include "openmp.h"
 #include "vector.h"
 
 struct drgn_debug_info;
 struct drgn_debug_info_module;
 struct drgn_register_state;
 
+/** DWARF Common Information Entry. */
+struct drgn_dwarf_cie {
+	/* Whether this CIE is from .eh_frame. */
+	bool is_eh;
+	/* Size of an address in this CIE in bytes. */
+	uint8_t address_size;
+	/* DW_EH_PE_* encoding of addresses in this CIE. */
+	uint8_t address_encoding;
+	/* Whether this CIE has a 'z' augmentation. */
+	bool have_augmentation_length;
+	/* Whether this CIE is for a signal handler ('S' augmentation). */
+	bool signal_frame;
+	drgn_register_number return_address_register;
+	uint64_t code_alignment_factor;
+	int64_t data_alignment_factor;
+	const char *initial_instructions;
+	size_t initial_instructions_size;
+};
+
+DEFINE_VECTOR_TYPE(drgn_dwarf_cie_vector, struct drgn_dwarf_cie)
+DEFINE_HASH_MAP_TYPE(drgn_dwarf_cie_map, size_t, size_t)
+
+struct drgn_dwarf_unit_scopes;
+DEFINE_HASH_MAP_TYPE(drgn_dwarf_unit_scopes_map, Dwarf_Off,
+		     struct drgn_dwarf_unit_scopes *)
+struct drgn_dwarf_location_list;
+DEFINE_HASH_MAP_TYPE(drgn_dwarf_location_list_map, uint64_t,
+		     struct drgn_dwarf_location_list *)
+
 /** DWARF Frame Description Entry. */
 struct drgn_dwarf_fde {
 	uint64_t initial_location;
 	uint64_t address_range;
-	/* CIE for this FDE as an index into drgn_debug_info_module::cies. */
+	/* CIE for this FDE as an index into drgn_dwarf_module_info::cies. */
 	size_t cie;
 	const char *instructions;
 	size_t instructions_size;
@@ -47,14 +77,59 @@ struct drgn_dwarf_module_info {
 	uint64_t textrel_base;
 	/** Base for `DW_EH_PE_datarel`. */
 	uint64_t datarel_base;
-	/** Array of DWARF Common Information Entries. */
-	struct drgn_dwarf_cie *cies;
+	/** DWARF Common Information Entries. */
+	struct drgn_dwarf_cie_vector cies;
 	/**
 	 * Array of DWARF Frame Description Entries sorted by initial_location.
+	 *
+	 * This is empty if FDEs are found with @ref eh_frame_hdr_table instead.
 	 */
 	struct drgn_dwarf_fde *fdes;
-	/** Number of elements in @ref drgn_debug_info_module::fdes. */
+	/** Number of elements in @ref drgn_dwarf_module_info::fdes. */
 	size_t num_fdes;
+	/**
+	 * Binary search table from `.eh_frame_hdr`, or @c NULL if not used.
+	 *
+	 * If a module only has `.eh_frame` and its `.eh_frame_hdr` has a search
+	 * table in the standard encoding, then the FDE containing a program
+	 * counter is found with this table and parsed on demand instead of
+	 * parsing all of `.eh_frame` up front. Each entry is a pair of signed
+	 * 4-byte offsets from @ref eh_frame_hdr_base: the initial location of
+	 * the FDE and the address of the FDE.
+	 */
+	const char *eh_frame_hdr_table;
+	/** Number of entries in @ref eh_frame_hdr_table. */
+	size_t eh_frame_hdr_table_size;
+	/** Address of the `.eh_frame_hdr` section. */
+	uint64_t eh_frame_hdr_base;
+	/**
+	 * Map from the offset of a CIE in `.eh_frame` to its index in @ref
+	 * cies. This is only used with @ref eh_frame_hdr_table, where CIEs are
+	 * parsed as they are encountered.
+	 */
+	struct drgn_dwarf_cie_map cie_map;
+	/**
+	 * Map from the offset of a unit DIE to an index of the scopes in that
+	 * unit by address, or @c NULL if no index has been built yet.
+	 *
+	 * Indexes are built on demand by @ref
+	 * drgn_debug_info_module_find_dwarf_scopes().
+	 */
+	struct drgn_dwarf_unit_scopes_map *unit_scopes;
+	/**
+	 * Map from the offset of a location list (with the high bit set for
+	 * `.debug_loclists` instead of `.debug_loc`) to its decoded entries, or
+	 * @c NULL if no location list has been decoded yet.
+	 *
+	 * Location lists are decoded on demand when a variable or frame base
+	 * is looked up.
+	 */
+	struct drgn_dwarf_location_list_map *location_lists;
+	/**
+	 * ID of this module in the DWARF index (its index in @ref
+	 * drgn_dwarf_info::index_modules).
+	 */
+	uint32_t index_id;
 };
 
 void drgn_dwarf_module_info_deinit(struct drgn_debug_info_module *module);
@@ -62,6 +137,8 @@ void drgn_dwarf_module_info_deinit(struct drgn_debug_info_module *module);
 DEFINE_VECTOR_TYPE(drgn_dwarf_index_pending_die_vector,
 		   struct drgn_dwarf_index_pending_die)
 
+struct drgn_dwarf_canonical_names;
+
 /**
  * Index of DWARF information for a namespace by entity name.
  *
@@ -83,6 +160,11 @@ struct drgn_namespace_dwarf_index {
 	struct drgn_dwarf_index_pending_die_vector pending_dies;
 	/** Saved error from a previous index. */
 	struct drgn_error *saved_err;
+	/**
+	 * Map from canonical C++ template name to the names in this index
+	 * that canonicalize to it, or @c NULL if it hasn't been built yet.
+	 */
+	struct drgn_dwarf_canonical_names *canonical_names;
 };
 
 /** DIE with a `DW_AT_specification` attribute. */
@@ -102,6 +184,27 @@ DEFINE_HASH_TABLE_TYPE(drgn_dwarf_specification_map,
 		       struct drgn_dwarf_specification)
 
 DEFINE_VECTOR_TYPE(drgn_dwarf_index_cu_vector, struct drgn_dwarf_index_cu)
+DEFINE_VECTOR_TYPE(drgn_dwarf_index_module_vector,
+		   struct drgn_debug_info_module *)
+DEFINE_HASH_MAP_TYPE(drgn_dwarf_file_name_id_map, uint64_t, uint32_t)
+
+/**
+ * Number of bits of a file name ID that identify its shard of @ref
+ * drgn_dwarf_file_name_ids.
+ */
+#define DRGN_DWARF_FILE_NAME_ID_SHARD_BITS 6
+#define DRGN_DWARF_FILE_NAME_ID_NUM_SHARDS \
+	(1 << DRGN_DWARF_FILE_NAME_ID_SHARD_BITS)
+
+/**
+ * Map from the hash of a file name to its ID, sharded by the high bits of the
+ * hash.
+ */
+struct drgn_dwarf_file_name_ids {
+	struct drgn_dwarf_file_name_id_map
+		shards[DRGN_DWARF_FILE_NAME_ID_NUM_SHARDS];
+};
+DEFINE_VECTOR_TYPE(drgn_dwarf_index_names_vector, struct drgn_dwarf_index_names)
 
 /** Cached type in a @ref drgn_debug_info. */
 struct drgn_dwarf_type {
@@ -134,6 +237,67 @@ struct drgn_dwarf_info {
 	struct drgn_dwarf_specification_map specifications;
 	/** Indexed compilation units. */
 	struct drgn_dwarf_index_cu_vector index_cus;
+	/**
+	 * Modules containing indexed DIEs, indexed by @ref
+	 * drgn_dwarf_module_info::index_id.
+	 */
+	struct drgn_dwarf_index_module_vector index_modules;
+	/**
+	 * Map from the hash of a file name to the ID used for it in indexed
+	 * DIEs.
+	 *
+	 * This is shared by all modules so that DIEs only need to store a
+	 * 32-bit ID. The low @ref DRGN_DWARF_FILE_NAME_ID_SHARD_BITS bits of an
+	 * ID are its shard. A hash of zero (no file name) always has an ID of
+	 * zero and is not in the map.
+	 */
+	struct drgn_dwarf_file_name_ids file_name_ids;
+	/**
+	 * Locks for the shards of @ref file_name_ids, so that CUs being indexed
+	 * in parallel rarely wait for each other.
+	 */
+	omp_lock_t file_name_id_locks[DRGN_DWARF_FILE_NAME_ID_NUM_SHARDS];
+	/**
+	 * Number of CUs at the beginning of @ref index_cus which have been
+	 * indexed. The rest are deferred until a lookup needs them.
+	 */
+	size_t num_indexed_cus;
+	/**
+	 * `.debug_names` name indexes which are used to index CUs in @ref
+	 * index_cus instead of parsing all of their DIEs.
+	 */
+	struct drgn_dwarf_index_names_vector index_names;
+	/** Saved error from indexing deferred CUs. */
+	struct drgn_error *deferred_err;
+	/**
+	 * Whether to defer indexing new CUs until the index is first used
+	 * (from the `DRGN_LAZY_DWARF_INDEX` environment variable).
+	 */
+	bool lazy;
+	/**
+	 * Whether to only index vmlinux when it is loaded and defer indexing
+	 * other CUs until a lookup doesn't find a match in the CUs that are
+	 * already indexed (from the `DRGN_STREAM_DWARF_INDEX` environment
+	 * variable).
+	 */
+	bool stream;
+	/**
+	 * Whether to index all nested namespaces as soon as every CU is indexed
+	 * instead of when each namespace is first used (from the
+	 * `DRGN_PREFETCH_DWARF_NAMESPACES` environment variable).
+	 */
+	bool prefetch_namespaces;
+	/**
+	 * Whether to use `.debug_names` sections when they are present (unless
+	 * disabled by the `DRGN_USE_DEBUG_NAMES` environment variable).
+	 */
+	bool use_debug_names;
+	/**
+	 * Whether to free memory only needed while indexing and evict section
+	 * data after CUs are indexed (from the `DRGN_LOW_MEMORY_DEBUG_INFO`
+	 * environment variable).
+	 */
+	bool low_memory;
 
 	/**
 	 * Cache of parsed types.
@@ -167,7 +331,23 @@ struct drgn_dwarf_index_state {
 	struct drgn_debug_info *dbinfo;
 	/** Per-thread arrays of CUs to be indexed. */
 	struct drgn_dwarf_index_pending_cu_vector *cus;
+	/**
+	 * Per-thread arrays of `.debug_names` name indexes for CUs in @ref
+	 * cus.
+	 */
+	struct drgn_dwarf_index_names_vector *names;
 	size_t max_threads;
+	/**
+	 * Directory containing DWARF index cache files (from the
+	 * `DRGN_DWARF_INDEX_CACHE_DIR` environment variable), or @c NULL if the
+	 * cache is disabled.
+	 */
+	const char *cache_dir;
+	/**
+	 * Per-thread DWARF index cache state, or @c NULL if the cache is
+	 * disabled.
+	 */
+	struct drgn_dwarf_index_cache_state *cache;
 };
 
 /**
@@ -195,6 +375,16 @@ drgn_dwarf_index_read_module(struct drgn_dwarf_index_state *state,
 struct drgn_error *
 drgn_dwarf_info_update_index(struct drgn_dwarf_index_state *state);
 
+/**
+ * Rebuild the DWARF index from scratch from the modules which are still in the
+ * @ref DRGN_DEBUG_INFO_MODULE_INDEXED state, dropping the DIEs of any other
+ * module.
+ *
+ * On failure, the existing index is left unchanged.
+ */
+struct drgn_error *
+drgn_dwarf_info_rebuild_index(struct drgn_debug_info *dbinfo);
+
 /**
  * Find the DWARF DIEs in a @ref drgn_debug_info_module for the scope containing
  * a given program counter.
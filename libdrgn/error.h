@@ -32,6 +32,20 @@ extern struct drgn_error drgn_stop;
 /** Global @ref DRGN_ERROR_OBJECT_ABSENT error. */
 extern struct drgn_error drgn_error_object_absent;
 
+/**
+ * Global @ref DRGN_ERROR_FAULT error returned in place of an allocated one when
+ * faults are quiet. Its address is not meaningful.
+ */
+extern struct drgn_error drgn_fault_quiet;
+
+/**
+ * While this is non-zero, @ref drgn_error_create_fault() and @ref
+ * drgn_error_format_fault() return @ref drgn_fault_quiet instead of allocating
+ * an error. This is per-thread. It is for reads whose faults are expected and
+ * only need to be detected, not reported.
+ */
+extern _Thread_local unsigned int drgn_quiet_faults;
+
 struct string_builder;
 
 /**
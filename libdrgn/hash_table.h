@@ -14,9 +14,13 @@
 
 #ifdef __SSE2__
 #include <emmintrin.h> // IWYU pragma: keep
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
 #endif
 #ifdef __SSE4_2__
 #include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
 #endif
 #include <stdalign.h>
 #include <stdbool.h>
@@ -341,6 +345,35 @@ static inline unsigned int table##_chunk_occupied(struct table##_chunk *chunk)	\
 	__m128i tag_vec = _mm_load_si128((__m128i *)chunk);			\
 	return _mm_movemask_epi8(tag_vec) & table##_chunk_full_mask;		\
 }
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+/*
+ * NEON doesn't have an equivalent of movemask, so keep a different bit of each
+ * byte of a comparison result and add across each half.
+ */
+static inline unsigned int hash_table_neon_movemask(uint8x16_t vec)
+{
+	uint8x8_t bits = vcreate_u8(UINT64_C(0x8040201008040201));
+	uint8x16_t masked = vandq_u8(vec, vcombine_u8(bits, bits));
+	return vaddv_u8(vget_low_u8(masked)) |
+	       ((unsigned int)vaddv_u8(vget_high_u8(masked)) << 8);
+}
+
+#define HASH_TABLE_CHUNK_MATCH(table)						\
+static inline unsigned int table##_chunk_match(struct table##_chunk *chunk,	\
+					       size_t needle)			\
+{										\
+	uint8x16_t tag_vec = vld1q_u8((const uint8_t *)chunk);			\
+	uint8x16_t eq_vec = vceqq_u8(tag_vec, vdupq_n_u8((uint8_t)needle));	\
+	return hash_table_neon_movemask(eq_vec) & table##_chunk_full_mask;	\
+}
+
+#define HASH_TABLE_CHUNK_OCCUPIED(table)					\
+static inline unsigned int table##_chunk_occupied(struct table##_chunk *chunk)	\
+{										\
+	uint8x16_t tag_vec = vld1q_u8((const uint8_t *)chunk);			\
+	uint8x16_t full_vec = vtstq_u8(tag_vec, vdupq_n_u8(0x80));		\
+	return hash_table_neon_movemask(full_vec) & table##_chunk_full_mask;	\
+}
 #else
 #define HASH_TABLE_CHUNK_MATCH(table)						\
 static inline unsigned int table##_chunk_match(struct table##_chunk *chunk,	\
@@ -1583,15 +1616,19 @@ static inline struct hash_pair hash_pair_from_non_avalanching_hash(size_t hash)
 #if SIZE_MAX == 0xffffffffffffffff
 	_Static_assert(sizeof(size_t) == sizeof(uint64_t),
 		       "size_t/SIZE_MAX doesn't make sense");
+#if defined(__SSE4_2__) || defined(__ARM_FEATURE_CRC32)
+	/* 64-bit with SSE4.2 or the ARMv8 CRC32 extension uses CRC32C */
 #ifdef __SSE4_2__
-	/* 64-bit with SSE4.2 uses CRC32 */
 	size_t c = _mm_crc32_u64(0, hash);
+#else
+	size_t c = __crc32cd(0, hash);
+#endif
 	return (struct hash_pair){
 		.first = hash + c,
 		.second = (c >> 24) | 0x80,
 	};
 #else
-	/* 64-bit without SSE4.2 uses a 128-bit multiplication-based mixer */
+	/* 64-bit without CRC32C uses a 128-bit multiplication-based mixer */
 	static const uint64_t multiplier = UINT64_C(0xc4ceb9fe1a85ec53);
 	uint64_t hi = ((unsigned __int128)hash * multiplier) >> 64;
 	uint64_t lo = hash * multiplier;
@@ -1605,15 +1642,19 @@ static inline struct hash_pair hash_pair_from_non_avalanching_hash(size_t hash)
 #elif SIZE_MAX == 0xffffffff
 	_Static_assert(sizeof(size_t) == sizeof(uint32_t),
 		       "size_t/SIZE_MAX doesn't make sense");
+#if defined(__SSE4_2__) || defined(__ARM_FEATURE_CRC32)
+	/* 32-bit with SSE4.2 or the ARMv8 CRC32 extension uses CRC32C */
 #ifdef __SSE4_2__
-	/* 32-bit with SSE4.2 uses CRC32 */
 	size_t c = _mm_crc32_u32(0, hash);
+#else
+	size_t c = __crc32cw(0, hash);
+#endif
 	return (struct hash_pair){
 		.first = hash + c,
 		.second = (uint8_t)(~(c >> 25)),
 	};
 #else
-	/* 32-bit without SSE4.2 uses the 32-bit Murmur2 finalizer */
+	/* 32-bit without CRC32C uses the 32-bit Murmur2 finalizer */
 	hash ^= hash >> 13;
 	hash *= 0x5bd1e995;
 	hash ^= hash >> 15;
@@ -13,18 +13,116 @@
 #ifndef DRGN_HELPERS_H
 #define DRGN_HELPERS_H
 
+#include <byteswap.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "drgn.h"
+#include "hash_table.h"
+#include "serialize.h"
+#include "vector.h"
 
 struct drgn_object;
 struct drgn_program;
+struct string_builder;
+
+/** Location of a member in a structure that was read into a buffer. */
+struct linux_helper_field {
+	uint64_t bit_offset;
+	uint64_t bit_size;
+};
+
+/**
+ * Find a member of a structure type. If @p integer is @c true, the member must
+ * be small enough to read with @ref linux_helper_field_read(). Otherwise, it
+ * must be byte-aligned.
+ */
+struct drgn_error *
+linux_helper_field_init(struct linux_helper_field *field,
+			struct drgn_type *type, const char *member_designator,
+			bool integer);
+
+/** Read an integer member found by @ref linux_helper_field_init(). */
+static inline uint64_t
+linux_helper_field_read(const struct linux_helper_field *field,
+			const char *buf, bool little_endian)
+{
+	return deserialize_bits(buf, field->bit_offset, field->bit_size,
+				little_endian);
+}
 
 struct drgn_error *linux_helper_read_vm(struct drgn_program *prog,
 					uint64_t pgtable, uint64_t virt_addr,
 					void *buf, size_t count);
 
+/** Range of virtual memory mapped by a page table. */
+struct linux_helper_pgtable_mapping {
+	uint64_t virt_addr;
+	uint64_t phys_addr;
+	uint64_t size;
+	/** Architecture-specific flags of the page table entry. */
+	uint64_t flags;
+};
+
+DEFINE_VECTOR_TYPE(linux_helper_pgtable_mapping_vector,
+		   struct linux_helper_pgtable_mapping)
+
+/**
+ * Get the mapped ranges of a page table in one pass.
+ *
+ * Adjacent ranges that are virtually and physically contiguous and have the
+ * same flags are merged.
+ *
+ * @param[in] pgtable Address of the top-level page table.
+ * @param[in] start First virtual address to include.
+ * @param[in] end Virtual address to stop at (exclusive), or 0 for the end of
+ * the address space.
+ * @param[out] mappings_ret Returned array of mappings in increasing order of
+ * virtual address. Must be freed with @c free().
+ * @param[out] num_mappings_ret Returned number of mappings.
+ */
+struct drgn_error *
+linux_helper_pgtable_mappings(struct drgn_program *prog, uint64_t pgtable,
+			      uint64_t start, uint64_t end,
+			      struct linux_helper_pgtable_mapping **mappings_ret,
+			      size_t *num_mappings_ret);
+
+/** Virtual address that maps a physical address. */
+struct linux_helper_reverse_mapping {
+	/** Index of the physical address that is mapped. */
+	size_t phys_index;
+	/** Index of the page table containing the mapping. */
+	size_t pgtable_index;
+	uint64_t virt_addr;
+};
+
+/**
+ * Find every virtual address mapping each of a list of physical addresses in
+ * a list of page tables.
+ *
+ * The page tables are walked in parallel and indexed by physical address. A
+ * page table that can't be read completely only contributes the mappings found
+ * before the fault.
+ *
+ * @param[in] pgtables Addresses of the top-level page tables.
+ * @param[in] ends For each page table, the virtual address to stop walking at
+ * (exclusive), or 0 to skip it.
+ * @param[in] num_pgtables Number of page tables.
+ * @param[in] phys_addrs Physical addresses to find.
+ * @param[in] num_phys_addrs Number of physical addresses.
+ * @param[out] mappings_ret Returned array of mappings ordered by @ref
+ * linux_helper_reverse_mapping::phys_index. Must be freed with @c free().
+ * @param[out] num_mappings_ret Returned number of mappings.
+ */
+struct drgn_error *
+linux_helper_reverse_map(struct drgn_program *prog, const uint64_t *pgtables,
+			 const uint64_t *ends, size_t num_pgtables,
+			 const uint64_t *phys_addrs, size_t num_phys_addrs,
+			 struct linux_helper_reverse_mapping **mappings_ret,
+			 size_t *num_mappings_ret);
+
 struct drgn_error *linux_helper_per_cpu_ptr(struct drgn_object *res,
 					    const struct drgn_object *ptr,
 					    uint64_t cpu);
@@ -32,6 +130,84 @@ struct drgn_error *linux_helper_per_cpu_ptr(struct drgn_object *res,
 struct drgn_error *linux_helper_idle_task(struct drgn_object *res,
 					  uint64_t cpu);
 
+/** Values of a per-CPU variable read by @ref linux_helper_read_per_cpu(). */
+struct linux_helper_per_cpu_values {
+	/** CPUs that were read, in increasing order. */
+	uint64_t *cpus;
+	/** Value for each CPU in @ref cpus. */
+	union drgn_value *values;
+	/** Number of CPUs in @ref cpus. */
+	size_t num_cpus;
+	/**
+	 * Whether the values are signed (@ref drgn_value::svalue) or unsigned
+	 * (@ref drgn_value::uvalue).
+	 */
+	bool is_signed;
+};
+
+/**
+ * Read an integer or pointer from a per-CPU variable for each CPU in a mask.
+ *
+ * `__per_cpu_offset` is read once, and the values for all of the CPUs are
+ * read together with @ref drgn_program_read_memory_batch().
+ *
+ * @param[in] ptr Per-CPU pointer (`type __percpu *`) or per-CPU variable
+ * (`type __percpu`).
+ * @param[in] member_designator Member of `type` to read, or @c NULL to read
+ * `type` itself.
+ * @param[in] cpumask CPUs to read (`struct cpumask` or `struct cpumask *`), or
+ * @c NULL to read the online CPUs.
+ * @param[out] ret Returned values. Must be deinitialized with @ref
+ * linux_helper_per_cpu_values_deinit().
+ */
+struct drgn_error *
+linux_helper_read_per_cpu(const struct drgn_object *ptr,
+			  const char *member_designator,
+			  const struct drgn_object *cpumask,
+			  struct linux_helper_per_cpu_values *ret);
+
+void
+linux_helper_per_cpu_values_deinit(struct linux_helper_per_cpu_values *values);
+
+/** Bitmap read by @ref linux_helper_bitmap_init(). */
+struct linux_helper_bitmap {
+	/**
+	 * Bits packed into 64-bit words in host byte order, regardless of the
+	 * word size and byte order of the program. Bits past @ref size are
+	 * zero.
+	 */
+	uint64_t *words;
+	/** Number of bits. */
+	uint64_t size;
+};
+
+/**
+ * Read a bitmap in one read.
+ *
+ * @param[in] obj `unsigned long *` or array of `unsigned long` (or another
+ * unsigned integer type).
+ * @param[in] size Number of bits in the bitmap.
+ */
+struct drgn_error *linux_helper_bitmap_init(struct linux_helper_bitmap *bitmap,
+					    const struct drgn_object *obj,
+					    uint64_t size);
+
+void linux_helper_bitmap_deinit(struct linux_helper_bitmap *bitmap);
+
+/**
+ * Find the next set or clear bit in a bitmap.
+ *
+ * @param[in] start First bit to consider.
+ * @param[in] set Whether to find a set bit or a clear bit.
+ * @return Bit number, or @ref linux_helper_bitmap::size if there are no more
+ * matching bits.
+ */
+uint64_t linux_helper_bitmap_next(const struct linux_helper_bitmap *bitmap,
+				  uint64_t start, bool set);
+
+/** Get the number of set bits in a bitmap. */
+uint64_t linux_helper_bitmap_weight(const struct linux_helper_bitmap *bitmap);
+
 struct drgn_error *
 linux_helper_radix_tree_lookup(struct drgn_object *res,
 			       const struct drgn_object *root, uint64_t index);
@@ -40,6 +216,97 @@ struct drgn_error *linux_helper_idr_find(struct drgn_object *res,
 					 const struct drgn_object *idr,
 					 uint64_t id);
 
+/** Node on the path to the current entry of a radix tree iterator. */
+struct linux_helper_radix_tree_frame {
+	/** Index of the first entry under the node. */
+	uint64_t index;
+	/** Address of the node. */
+	uint64_t address;
+	/** `node->shift`. */
+	uint64_t shift;
+	/** Next slot to visit. */
+	uint64_t slot;
+};
+
+/**
+ * Iterator over the entries in a radix tree or XArray.
+ *
+ * Each node is read once and its slots are decoded from the copy. Empty slots
+ * and internal entries other than nodes (retry and sibling entries) are
+ * skipped.
+ */
+struct linux_helper_radix_tree_iterator {
+	/** Current entry (`void *`). */
+	struct drgn_object entry;
+	/** Index of @ref entry. */
+	uint64_t index;
+	/** Value added to each index. */
+	uint64_t index_base;
+	/** `RADIX_TREE_INTERNAL_NODE` (or `XA_INTERNAL` tag). */
+	uint64_t internal_node;
+	/** Whether to skip value (exceptional) entries. */
+	bool skip_values;
+	bool is_64_bit;
+	bool bswap;
+	/** Root entry if it is not a node and hasn't been returned yet. */
+	uint64_t root_entry;
+	/** Offset of `shift` in the node type. */
+	uint64_t shift_offset;
+	/** Offset of `slots` in the node type. */
+	uint64_t slots_offset;
+	/** Number of slots in a node. */
+	uint64_t num_slots;
+	/** Size of the node type. */
+	uint64_t node_size;
+	/** Contents of the nodes in @ref frames. */
+	char *nodes;
+	/** Nodes on the path to the current entry, from the root down. */
+	struct linux_helper_radix_tree_frame *frames;
+	/** Number of valid entries in @ref frames. */
+	size_t depth;
+	/** Allocated size of @ref frames. */
+	size_t max_depth;
+};
+
+/**
+ * Initialize a @ref linux_helper_radix_tree_iterator.
+ *
+ * @param[in] root Radix tree root (`struct radix_tree_root *` or `struct
+ * xarray *`).
+ * @param[in] skip_values Whether to skip value entries (exceptional entries in
+ * older kernels), like the shadow entries in the page cache.
+ */
+struct drgn_error *
+linux_helper_radix_tree_iterator_init(struct linux_helper_radix_tree_iterator *it,
+				      const struct drgn_object *root,
+				      bool skip_values);
+
+/**
+ * Initialize a @ref linux_helper_radix_tree_iterator over the entries in an
+ * IDR.
+ *
+ * @param[in] idr IDR (`struct idr *`).
+ */
+struct drgn_error *
+linux_helper_idr_iterator_init(struct linux_helper_radix_tree_iterator *it,
+			       const struct drgn_object *idr);
+
+void
+linux_helper_radix_tree_iterator_deinit(struct linux_helper_radix_tree_iterator *it);
+
+/**
+ * Get the next entry from a @ref linux_helper_radix_tree_iterator in order of
+ * increasing index.
+ *
+ * @param[out] ret Returned entry (`void *`) object, or @c NULL if there are no
+ * more entries. This is valid until the next call to this function on the same
+ * @p it or until @p it is destroyed. Its index is in @ref
+ * linux_helper_radix_tree_iterator::index.
+ */
+struct drgn_error *
+linux_helper_radix_tree_iterator_next(struct linux_helper_radix_tree_iterator *it,
+				      const struct drgn_object **ret);
+
 struct drgn_error *linux_helper_find_pid(struct drgn_object *res,
 					 const struct drgn_object *ns,
 					 uint64_t pid);
@@ -57,6 +324,9 @@ struct linux_helper_task_iterator {
 	struct drgn_qualified_type task_struct_type;
 	uint64_t init_task_address;
 	uint64_t thread_group_address;
+	/* For prefetching the next task. Zero if it isn't possible. */
+	uint64_t task_struct_size;
+	uint64_t thread_group_offset;
 	bool done;
 };
 
@@ -76,4 +346,937 @@ struct drgn_error *
 linux_helper_task_iterator_next(struct linux_helper_task_iterator *it,
 				const struct drgn_object **ret);
 
+/** Size of `task_struct::comm` (`TASK_COMM_LEN`). */
+#define LINUX_HELPER_TASK_COMM_LEN 16
+
+/** Task in a @ref linux_helper_task_index. */
+struct linux_helper_task_index_entry {
+	/** Address of the `struct task_struct`. */
+	uint64_t address;
+	/** `task->pid`, the thread ID in the initial PID namespace. */
+	uint32_t pid;
+	/** `task->tgid`, the thread group ID in the initial PID namespace. */
+	uint32_t tgid;
+	/**
+	 * Index of the next task in the same thread group, or @c UINT32_MAX.
+	 */
+	uint32_t next_in_thread_group;
+	/** Index of the next task with the same comm, or @c UINT32_MAX. */
+	uint32_t next_with_comm;
+	/** Null-terminated `task->comm`. */
+	char comm[LINUX_HELPER_TASK_COMM_LEN];
+};
+
+DEFINE_VECTOR_TYPE(linux_helper_task_index_entry_vector,
+		   struct linux_helper_task_index_entry)
+DEFINE_HASH_MAP_TYPE(linux_helper_task_id_map, uint32_t, uint32_t)
+DEFINE_HASH_MAP_TYPE(linux_helper_task_comm_map, const char *, uint32_t)
+
+/**
+ * Index of the tasks in a kernel built in one pass over the task list.
+ *
+ * Lists of tasks are linked through indices into @ref entries in the order
+ * that the tasks were found.
+ */
+struct linux_helper_task_index {
+	/** Indexed tasks. */
+	struct linux_helper_task_index_entry_vector entries;
+	/** Map from PID to index of the task. */
+	struct linux_helper_task_id_map pids;
+	/** Map from thread group ID to index of the first task in the group. */
+	struct linux_helper_task_id_map tgids;
+	/** Map from comm to index of the first task with that comm. */
+	struct linux_helper_task_comm_map comms;
+	/** Address of `init_pid_ns`. */
+	uint64_t init_pid_ns_address;
+	/** `struct task_struct *`. */
+	struct drgn_qualified_type task_struct_pointer_type;
+};
+
+/**
+ * Create a @ref linux_helper_task_index by walking every task in the kernel.
+ *
+ * @param[out] ret Returned index. Must be freed with @ref
+ * linux_helper_task_index_destroy().
+ */
+struct drgn_error *
+linux_helper_task_index_create(struct drgn_program *prog,
+			       struct linux_helper_task_index **ret);
+
+/** Free a @ref linux_helper_task_index. */
+void linux_helper_task_index_destroy(struct linux_helper_task_index *index);
+
+/**
+ * Get the task index cached in a program, creating it the first time.
+ *
+ * The tasks of a running kernel change, so only core dumps are indexed. This
+ * can also be disabled with the `DRGN_INDEX_TASKS` environment variable.
+ *
+ * @param[out] ret Returned index, or @c NULL if the program doesn't cache a
+ * task index. This is valid until the program is destroyed.
+ */
+struct drgn_error *
+linux_helper_cached_task_index(struct drgn_program *prog,
+			       struct linux_helper_task_index **ret);
+
+/**
+ * Find an entry in a @ref linux_helper_task_index by PID.
+ *
+ * @return Entry, or @c NULL if there is no task with the given PID.
+ */
+const struct linux_helper_task_index_entry *
+linux_helper_task_index_find_pid(struct linux_helper_task_index *index,
+				 uint32_t pid);
+
+/**
+ * Find the first entry of a thread group in a @ref linux_helper_task_index.
+ * The rest are linked by @ref
+ * linux_helper_task_index_entry::next_in_thread_group.
+ *
+ * @return Entry, or @c NULL if there is no task with the given thread group ID.
+ */
+const struct linux_helper_task_index_entry *
+linux_helper_task_index_find_tgid(struct linux_helper_task_index *index,
+				  uint32_t tgid);
+
+/**
+ * Find the first entry with a comm in a @ref linux_helper_task_index. The rest
+ * are linked by @ref linux_helper_task_index_entry::next_with_comm.
+ *
+ * @return Entry, or @c NULL if there is no task with the given comm.
+ */
+const struct linux_helper_task_index_entry *
+linux_helper_task_index_find_comm(struct linux_helper_task_index *index,
+				  const char *comm);
+
+/** File open in a task, found by @ref linux_helper_task_files(). */
+struct linux_helper_open_file {
+	/** Address of the `struct task_struct`. */
+	uint64_t task;
+	/** File descriptor. */
+	uint64_t fd;
+	/** Address of the `struct file`. */
+	uint64_t file;
+};
+
+/**
+ * Find the files open in tasks by walking their file descriptor tables.
+ *
+ * Only the `open_fds` bitmap and the slots of the `fd` array covered by
+ * non-zero bitmap words are read. Multiple tasks are walked in parallel.
+ *
+ * @param[in] tasks Addresses of `struct task_struct`s.
+ * @param[in] skip_faults Skip tasks whose file descriptor tables can't be read
+ * (e.g., because they are exiting) instead of failing.
+ * @param[out] files_ret Returned files, grouped by task in the order of @p
+ * tasks and sorted by file descriptor. Must be freed with @c free().
+ * @param[out] file_pointer_type_ret Returned `struct file *` type.
+ */
+struct drgn_error *
+linux_helper_task_files(struct drgn_program *prog, const uint64_t *tasks,
+			size_t num_tasks, bool skip_faults,
+			struct linux_helper_open_file **files_ret,
+			size_t *num_files_ret,
+			struct drgn_qualified_type *file_pointer_type_ret);
+
+/**
+ * Cache of the paths of dentries and mounts for @ref linux_helper_d_path() and
+ * @ref linux_helper_dentry_path().
+ *
+ * Paths are built from the cached path of the parent dentry, so the chain of
+ * parents shared by many dentries is only walked once.
+ */
+struct linux_helper_path_cache;
+
+/**
+ * Create a @ref linux_helper_path_cache.
+ *
+ * @param[out] ret Returned cache. Must be freed with @ref
+ * linux_helper_path_cache_destroy().
+ */
+struct drgn_error *
+linux_helper_path_cache_create(struct drgn_program *prog,
+			       struct linux_helper_path_cache **ret);
+
+/** Free a @ref linux_helper_path_cache. */
+void linux_helper_path_cache_destroy(struct linux_helper_path_cache *cache);
+
+/**
+ * Get the path cache cached in a program, creating it the first time.
+ *
+ * Dentries of a running kernel can be renamed or freed, so only core dumps
+ * have a cache that lives as long as the program.
+ *
+ * @param[out] ret Returned cache, or @c NULL if the program doesn't cache
+ * paths. It must only be used with the program lock held.
+ */
+struct drgn_error *
+linux_helper_cached_path_cache(struct drgn_program *prog,
+			       struct linux_helper_path_cache **ret);
+
+/**
+ * Append the full path of a dentry given a mount (like the `d_path()` Python
+ * helper).
+ *
+ * @param[in] vfsmnt Address of the `struct vfsmount`.
+ * @param[in] dentry Address of the `struct dentry`.
+ */
+struct drgn_error *linux_helper_d_path(struct linux_helper_path_cache *cache,
+				       uint64_t vfsmnt, uint64_t dentry,
+				       struct string_builder *sb);
+
+/**
+ * Append the path of a dentry from the root of its filesystem (like the
+ * `dentry_path()` Python helper).
+ *
+ * @param[in] dentry Address of the `struct dentry`.
+ */
+struct drgn_error *
+linux_helper_dentry_path(struct linux_helper_path_cache *cache,
+			 uint64_t dentry, struct string_builder *sb);
+
+/** Cgroup subsystem state found by @ref linux_helper_css_descendants_pre(). */
+struct linux_helper_css_entry {
+	/** Address of the `struct cgroup_subsys_state`. */
+	uint64_t css;
+	/** Offset of the path of its cgroup in the returned paths buffer. */
+	size_t path_offset;
+	/** Length of the path. */
+	size_t path_len;
+};
+
+/**
+ * Find the online descendants of a cgroup subsystem state in pre-order (like
+ * the `css_for_each_descendant_pre()` Python helper) along with the paths of
+ * their cgroups.
+ *
+ * The path of each cgroup is built from the path of its parent and the kernfs
+ * name of the cgroup.
+ *
+ * @param[in] root Address of the root `struct cgroup_subsys_state`.
+ * @param[in] root_path Path of the cgroup of @p root.
+ * @param[in] root_path_len Length of @p root_path.
+ * @param[out] entries_ret Returned subsystem states. Must be freed with @c
+ * free().
+ * @param[out] paths_ret Returned buffer of paths, which are not
+ * null-terminated. Must be freed with @c free().
+ */
+struct drgn_error *
+linux_helper_css_descendants_pre(struct drgn_program *prog, uint64_t root,
+				 const char *root_path, size_t root_path_len,
+				 struct linux_helper_css_entry **entries_ret,
+				 size_t *num_entries_ret, char **paths_ret);
+
+/** Socket found by @ref linux_helper_sk_hash_sockets(). */
+struct linux_helper_sock_entry {
+	/** Address of the `struct sock`. */
+	uint64_t sk;
+	/** Address of the `struct net` of the socket. */
+	uint64_t net;
+	/** Inode number of the socket, or 0 if it doesn't have one. */
+	uint64_t ino;
+	/**
+	 * Source address in network byte order. Only the first 4 bytes are
+	 * used for `AF_INET`.
+	 */
+	uint8_t saddr[16];
+	/** Destination address, like @ref saddr. */
+	uint8_t daddr[16];
+	/** Address family. */
+	uint16_t family;
+	/** Source port in host byte order. */
+	uint16_t sport;
+	/** Destination port in host byte order. */
+	uint16_t dport;
+	/** Socket state (e.g., `TCP_ESTABLISHED`). */
+	uint8_t state;
+};
+
+/**
+ * Find the sockets in an array of hash buckets, like the buckets of `struct
+ * inet_hashinfo`, along with their addresses, ports, and other identifying
+ * information.
+ *
+ * The `struct sock_common` of each socket is read once, which is also where the
+ * list node usually is.
+ *
+ * @param[in] buckets Pointer to the first bucket.
+ * @param[in] num_buckets Number of buckets.
+ * @param[in] head_member Name of the `struct hlist_nulls_head` or `struct
+ * hlist_head` member in the bucket type.
+ * @param[in] node_member Name of the list node member in `struct sock` (e.g.,
+ * `__sk_common.skc_nulls_node`).
+ * @param[out] entries_ret Returned sockets. Must be freed with @c free().
+ */
+struct drgn_error *
+linux_helper_sk_hash_sockets(const struct drgn_object *buckets,
+			     uint64_t num_buckets, const char *head_member,
+			     const char *node_member,
+			     struct linux_helper_sock_entry **entries_ret,
+			     size_t *num_entries_ret);
+
+/** BPF program found by @ref linux_helper_bpf_progs(). */
+struct linux_helper_bpf_prog_entry {
+	/** Address of the `struct bpf_prog`. */
+	uint64_t prog;
+	/** Address of its `struct bpf_prog_aux`. */
+	uint64_t aux;
+	/** Address of the JITed image (`bpf_func`). */
+	uint64_t bpf_func;
+	/** Offset of the BTF name in the returned names buffer. */
+	size_t btf_name_offset;
+	/** Length of the BTF name, or 0 if the program doesn't have one. */
+	size_t btf_name_len;
+	/** `aux->id`. */
+	uint32_t id;
+	/** `enum bpf_prog_type`. */
+	uint32_t type;
+	/** `enum bpf_attach_type`, or 0 if the kernel doesn't have it. */
+	uint32_t expected_attach_type;
+	/** Number of instructions. */
+	uint32_t len;
+	/** Size of the JITed image in bytes. */
+	uint32_t jited_len;
+	/** `aux->name`, which is not necessarily null-terminated. */
+	char name[16];
+};
+
+/**
+ * Find all BPF programs in `prog_idr` along with their commonly displayed
+ * fields.
+ *
+ * The BTF name of a program is the name of its first function in its BTF
+ * information (`aux->func_info[0]`), which is not truncated like `aux->name`.
+ *
+ * @param[out] entries_ret Returned programs in order of ID. Must be freed with
+ * @c free().
+ * @param[out] names_ret Returned buffer of BTF names, which are not
+ * null-terminated. Must be freed with @c free().
+ */
+struct drgn_error *
+linux_helper_bpf_progs(struct drgn_program *prog,
+		       struct linux_helper_bpf_prog_entry **entries_ret,
+		       size_t *num_entries_ret, char **names_ret);
+
+/** BPF map found by @ref linux_helper_bpf_maps(). */
+struct linux_helper_bpf_map_entry {
+	/** Address of the `struct bpf_map`. */
+	uint64_t map;
+	/** `map->id`. */
+	uint32_t id;
+	/** `enum bpf_map_type`. */
+	uint32_t map_type;
+	uint32_t key_size;
+	uint32_t value_size;
+	uint32_t max_entries;
+	/** `map->name`, which is not necessarily null-terminated. */
+	char name[16];
+};
+
+/**
+ * Find all BPF maps in `map_idr` along with their commonly displayed fields.
+ *
+ * @param[out] entries_ret Returned maps in order of ID. Must be freed with @c
+ * free().
+ */
+struct drgn_error *
+linux_helper_bpf_maps(struct drgn_program *prog,
+		      struct linux_helper_bpf_map_entry **entries_ret,
+		      size_t *num_entries_ret);
+
+/** Kind of kernel linked list iterated by @ref linux_helper_list_iterator. */
+enum linux_helper_list_kind {
+	/** `struct list_head`, following `next` pointers. */
+	LINUX_HELPER_LIST,
+	/** `struct list_head`, following `prev` pointers. */
+	LINUX_HELPER_LIST_REVERSE,
+	/** `struct hlist_head`. */
+	LINUX_HELPER_HLIST,
+	/** `struct hlist_nulls_head`. */
+	LINUX_HELPER_HLIST_NULLS,
+};
+
+/**
+ * Iterator over the entries in a kernel linked list.
+ *
+ * This resolves the layout of the list when it is initialized, so each step
+ * only reads one pointer.
+ */
+struct linux_helper_list_iterator {
+	/** Current entry. */
+	struct drgn_object entry;
+	/** Type of @ref entry (pointer to the entry type). */
+	struct drgn_qualified_type entry_pointer_type;
+	/** Offset of the list node in the entry type. */
+	uint64_t member_offset;
+	/** Offset of the `next` (or `prev`) pointer in the list node. */
+	uint64_t next_offset;
+	/** Address of the list head, which terminates a circular list. */
+	uint64_t head_address;
+	/** Address of the pointer to the next node. */
+	uint64_t next_address;
+	enum linux_helper_list_kind kind;
+	bool done;
+};
+
+/**
+ * Initialize a @ref linux_helper_list_iterator.
+ *
+ * @param[in] head Pointer to list head (`struct list_head *`, `struct
+ * hlist_head *`, or `struct hlist_nulls_head *`, depending on @p kind).
+ * @param[in] entry_type Type of entries in the list.
+ * @param[in] member_designator Name of the list node member in @p entry_type.
+ */
+struct drgn_error *
+linux_helper_list_iterator_init(struct linux_helper_list_iterator *it,
+				const struct drgn_object *head,
+				struct drgn_qualified_type entry_type,
+				const char *member_designator,
+				enum linux_helper_list_kind kind);
+
+void linux_helper_list_iterator_deinit(struct linux_helper_list_iterator *it);
+
+/**
+ * Get the next entry from a @ref linux_helper_list_iterator.
+ *
+ * @param[out] ret Returned entry pointer object, or @c NULL if there are no
+ * more entries. This is valid until the next call to this function on the same
+ * @p it or until @p it is destroyed.
+ */
+struct drgn_error *
+linux_helper_list_iterator_next(struct linux_helper_list_iterator *it,
+				const struct drgn_object **ret);
+
+/** Node whose left subtree is being visited by a red-black tree iterator. */
+struct linux_helper_rbtree_frame {
+	/** Address of the node. */
+	uint64_t node;
+	/** `node->rb_right`. */
+	uint64_t right;
+};
+
+DEFINE_VECTOR_TYPE(linux_helper_rbtree_frame_vector,
+		   struct linux_helper_rbtree_frame)
+
+/**
+ * Iterator over the entries in a red-black tree in sort order.
+ *
+ * This walks the tree with an explicit stack and reads each node once.
+ */
+struct linux_helper_rbtree_iterator {
+	/** Current entry. */
+	struct drgn_object entry;
+	/** Type of @ref entry (pointer to the entry type). */
+	struct drgn_qualified_type entry_pointer_type;
+	/** Offset of the `struct rb_node` in the entry type. */
+	uint64_t member_offset;
+	/** Offset of `rb_left` in `struct rb_node`. */
+	uint64_t left_offset;
+	/** Offset of `rb_right` in `struct rb_node`. */
+	uint64_t right_offset;
+	/** Number of bytes of `struct rb_node` to read. */
+	uint64_t read_size;
+	bool is_64_bit;
+	bool bswap;
+	/** Root of the next subtree to visit, or 0. */
+	uint64_t next;
+	/** Ancestors of @ref next whose left subtrees are being visited. */
+	struct linux_helper_rbtree_frame_vector stack;
+};
+
+/**
+ * Initialize a @ref linux_helper_rbtree_iterator.
+ *
+ * @param[in] root Tree root (`struct rb_root *`).
+ * @param[in] entry_type Type of entries in the tree.
+ * @param[in] member_designator Name of the `struct rb_node` member in @p
+ * entry_type, or @c NULL to iterate over the nodes themselves (in which case
+ * @p entry_type should be `struct rb_node`).
+ */
+struct drgn_error *
+linux_helper_rbtree_iterator_init(struct linux_helper_rbtree_iterator *it,
+				  const struct drgn_object *root,
+				  struct drgn_qualified_type entry_type,
+				  const char *member_designator);
+
+void
+linux_helper_rbtree_iterator_deinit(struct linux_helper_rbtree_iterator *it);
+
+/**
+ * Get the next entry from a @ref linux_helper_rbtree_iterator.
+ *
+ * @param[out] ret Returned entry pointer object, or @c NULL if there are no
+ * more entries. This is valid until the next call to this function on the same
+ * @p it or until @p it is destroyed.
+ */
+struct drgn_error *
+linux_helper_rbtree_iterator_next(struct linux_helper_rbtree_iterator *it,
+				  const struct drgn_object **ret);
+
+/**
+ * Scanner over the page structures in the page array (`vmemmap`) of the Linux
+ * kernel.
+ *
+ * Page structures are read in large chunks and returned as raw bytes, so
+ * filtering them doesn't need an object per page. Pages in holes of the page
+ * array are skipped.
+ */
+struct linux_helper_page_scanner {
+	struct drgn_program *prog;
+	/** `struct page` type. */
+	struct drgn_type *page_type;
+	/** Address of the page array. */
+	uint64_t vmemmap;
+	/** `sizeof(struct page)`. */
+	uint64_t page_struct_size;
+	/** Next page frame number to return. */
+	uint64_t pfn;
+	/** `max_pfn`. */
+	uint64_t max_pfn;
+	/** Page structures read starting at @ref pages_pfn. */
+	char *pages;
+	/** Page frame number of the first page in @ref pages. */
+	uint64_t pages_pfn;
+	/** Number of page structures in @ref pages. */
+	uint64_t num_pages;
+	/**
+	 * Pages before this page frame number are read one at a time because a
+	 * bulk read of them failed.
+	 */
+	uint64_t fault_end_pfn;
+	/** Whether the word size of the kernel is 64 bits. */
+	bool is_64_bit;
+	/** Whether the kernel has the opposite byte order from the host. */
+	bool bswap;
+};
+
+struct drgn_error *
+linux_helper_page_scanner_init(struct linux_helper_page_scanner *scanner,
+			       struct drgn_program *prog);
+
+void
+linux_helper_page_scanner_deinit(struct linux_helper_page_scanner *scanner);
+
+/**
+ * Get the next page from a @ref linux_helper_page_scanner.
+ *
+ * @param[out] pfn_ret Returned page frame number.
+ * @param[out] page_ret Returned contents of the `struct page`, or @c NULL if
+ * there are no more pages. This is valid until the next call to this function
+ * on the same @p scanner or until @p scanner is destroyed.
+ */
+struct drgn_error *
+linux_helper_page_scanner_next(struct linux_helper_page_scanner *scanner,
+			       uint64_t *pfn_ret, const char **page_ret);
+
+/** Decode a word at the given offset in a buffer read from the kernel. */
+static inline uint64_t
+linux_helper_page_scanner_word(const struct linux_helper_page_scanner *scanner,
+			       const char *buf, uint64_t offset)
+{
+	if (scanner->is_64_bit) {
+		uint64_t word;
+		memcpy(&word, buf + offset, sizeof(word));
+		return scanner->bswap ? bswap_64(word) : word;
+	} else {
+		uint32_t word;
+		memcpy(&word, buf + offset, sizeof(word));
+		return scanner->bswap ? bswap_32(word) : word;
+	}
+}
+
+/**
+ * Decode a 32-bit integer at the given offset in a buffer read from the
+ * kernel.
+ */
+static inline uint32_t
+linux_helper_page_scanner_u32(const struct linux_helper_page_scanner *scanner,
+			      const char *buf, uint64_t offset)
+{
+	uint32_t value;
+	memcpy(&value, buf + offset, sizeof(value));
+	return scanner->bswap ? bswap_32(value) : value;
+}
+
+/** Predicates on page structures for @ref linux_helper_find_pages(). */
+struct linux_helper_page_filter {
+	/** Flags to check. */
+	uint64_t flags_mask;
+	/** Required value of `page->flags & flags_mask`. */
+	uint64_t flags_value;
+	/** Whether to check @ref mapping. */
+	bool match_mapping;
+	/** Required value of `page->mapping`. */
+	uint64_t mapping;
+	/** Whether to check @ref min_refcount. */
+	bool match_refcount;
+	/** Minimum value of `page->_refcount`. */
+	int32_t min_refcount;
+};
+
+/**
+ * Find the page frame numbers of all pages matching a filter.
+ *
+ * @param[out] pfns_ret Returned array of page frame numbers in increasing
+ * order. Must be freed with @c free().
+ * @param[out] num_pfns_ret Returned number of page frame numbers.
+ */
+struct drgn_error *
+linux_helper_find_pages(struct drgn_program *prog,
+			const struct linux_helper_page_filter *filter,
+			uint64_t **pfns_ret, size_t *num_pfns_ret);
+
+DEFINE_HASH_SET_TYPE(linux_helper_address_set, uint64_t)
+DEFINE_VECTOR_TYPE(linux_helper_address_vector, uint64_t)
+
+/** Scratch buffers for decoding a slab. */
+struct linux_helper_slab_buffers {
+	/** Contents of the slab's objects (SLUB) or freelist (SLAB). */
+	char *slab_buf;
+	/** Allocated size of @ref slab_buf. */
+	size_t slab_buf_size;
+	/** Bitmap of free objects in the slab. */
+	uint64_t *free_bitmap;
+	/** Allocated size of @ref free_bitmap in words. */
+	size_t free_bitmap_size;
+};
+
+/**
+ * Iterator over the allocated objects in a slab cache.
+ *
+ * This scans the page array in bulk reads and decodes the freelist of each
+ * slab in the cache into a bitmap. Slabs are found in batches, and the slabs in
+ * a batch are decoded in parallel. The allocated objects of each batch are then
+ * returned in order.
+ */
+struct linux_helper_slab_object_iterator {
+	/** Current object. */
+	struct drgn_object entry;
+	/** Type of @ref entry (pointer to the object type). */
+	struct drgn_qualified_type entry_pointer_type;
+	/** Address of the `struct kmem_cache`. */
+	uint64_t slab_cache_address;
+	/** `slab_cache->size`. */
+	uint64_t object_size;
+	/** Whether the slab allocator is SLUB (as opposed to SLAB). */
+	bool slub;
+	/** Whether the SLUB freelist pointers are obfuscated. */
+	bool freelist_hardened;
+	/** Whether the kernel is little-endian. */
+	bool little_endian;
+	/**
+	 * SLUB: offset of the freelist pointer in a free object. SLAB: size of
+	 * `freelist_idx_t`.
+	 */
+	uint64_t freelist_offset;
+	/** SLUB: `slab_cache->random`. */
+	uint64_t freelist_random;
+	/**
+	 * SLUB: `slab_cache->red_left_pad`. SLAB: `slab_cache->obj_offset`.
+	 */
+	uint64_t object_offset;
+	/** SLAB: number of objects per slab. */
+	uint64_t objects_per_slab;
+	/**
+	 * Free objects in per-CPU freelists (SLUB) or per-CPU array caches
+	 * (SLAB).
+	 */
+	struct linux_helper_address_set cpu_free;
+	/** Scanner over the page array. */
+	struct linux_helper_page_scanner page_scanner;
+	/** Offset of `flags` in `struct page`. */
+	uint64_t page_flags_offset;
+	/** Offset of `slab_cache` in `struct slab` (or `struct page`). */
+	uint64_t slab_cache_offset;
+	/**
+	 * `freelist` in `struct slab` (or `struct page`), which is decoded from
+	 * the page array.
+	 */
+	struct linux_helper_field slab_freelist;
+	/** SLUB: `objects` in `struct slab` (or `struct page`). */
+	struct linux_helper_field slab_objects;
+	/** SLAB: `active` in `struct slab` (or `struct page`). */
+	struct linux_helper_field slab_active;
+	/** SLAB: `s_mem` in `struct slab` (or `struct page`). */
+	struct linux_helper_field slab_s_mem;
+	/** `1 << PG_slab`. */
+	uint64_t pg_slab_mask;
+	/** `PAGE_OFFSET`. */
+	uint64_t page_offset;
+	/** `PAGE_SIZE`. */
+	uint64_t page_size;
+	/** Page frame numbers of the slabs in the current batch. */
+	uint64_t *batch_pfns;
+	/** Page structures of the slabs in the current batch. */
+	char *batch_pages;
+	/** Allocated objects of each slab in the current batch. */
+	struct linux_helper_address_vector *batch_objects;
+	/** Addresses of allocated objects in the current batch. */
+	struct linux_helper_address_vector objects;
+	/** Index of the next object in @ref objects. */
+	size_t next_object;
+};
+
+/**
+ * Initialize a @ref linux_helper_slab_object_iterator.
+ *
+ * Only the SLUB and SLAB allocators are supported.
+ *
+ * @param[in] slab_cache Slab cache (`struct kmem_cache *`).
+ * @param[in] entry_type Type of objects in the slab cache.
+ */
+struct drgn_error *
+linux_helper_slab_object_iterator_init(struct linux_helper_slab_object_iterator *it,
+				       const struct drgn_object *slab_cache,
+				       struct drgn_qualified_type entry_type);
+
+void
+linux_helper_slab_object_iterator_deinit(struct linux_helper_slab_object_iterator *it);
+
+/**
+ * Get the next allocated object from a @ref
+ * linux_helper_slab_object_iterator.
+ *
+ * @param[out] ret Returned object pointer, or @c NULL if there are no more
+ * objects. This is valid until the next call to this function on the same @p
+ * it or until @p it is destroyed.
+ */
+struct drgn_error *
+linux_helper_slab_object_iterator_next(struct linux_helper_slab_object_iterator *it,
+				       const struct drgn_object **ret);
+
+/**
+ * Index of the references between allocated slab objects.
+ *
+ * Every pointer-sized, aligned word of every allocated slab object (and
+ * optionally of every other page of memory) is checked for a value that points
+ * into an allocated slab object. The references are stored in compressed
+ * sparse row form keyed by the object that they point into, so the referrers
+ * of an object are found in time proportional to their number.
+ */
+struct linux_helper_heap_graph {
+	/** Start addresses of the indexed objects, sorted. */
+	uint64_t *addresses;
+	/** Sizes of the indexed objects (`slab_cache->object_size`). */
+	uint32_t *sizes;
+	/** Number of indexed objects. */
+	size_t num_objects;
+	/**
+	 * The referrers of object `i` are `referrers[referrer_offsets[i]]`
+	 * through `referrers[referrer_offsets[i + 1] - 1]`. This has @ref
+	 * num_objects + 1 entries.
+	 */
+	size_t *referrer_offsets;
+	/**
+	 * Addresses of the words that point into each object, sorted for each
+	 * object.
+	 */
+	uint64_t *referrers;
+	/** Total number of references. */
+	size_t num_referrers;
+};
+
+/**
+ * Create a @ref linux_helper_heap_graph by scanning every slab cache.
+ *
+ * Only the SLUB and SLAB allocators are supported. Slabs that can't be read
+ * are skipped. A word pointing into the object that contains it isn't counted
+ * as a reference.
+ *
+ * @param[in] scan_pages Whether to also scan memory that isn't in a slab for
+ * references to slab objects.
+ * @param[out] ret Returned graph. Must be freed with @ref
+ * linux_helper_heap_graph_destroy().
+ */
+struct drgn_error *
+linux_helper_heap_graph_create(struct drgn_program *prog, bool scan_pages,
+			       struct linux_helper_heap_graph **ret);
+
+/** Free a @ref linux_helper_heap_graph. */
+void linux_helper_heap_graph_destroy(struct linux_helper_heap_graph *graph);
+
+/**
+ * Find the indexed object containing an address.
+ *
+ * @return Index of the object, or @c SIZE_MAX if the address isn't in an
+ * indexed object.
+ */
+size_t linux_helper_heap_graph_find(struct linux_helper_heap_graph *graph,
+				    uint64_t address);
+
+/** Where a @ref linux_helper_pipeline gets its entries from. */
+enum linux_helper_pipeline_source {
+	/** `struct list_head`, following `next` pointers. */
+	LINUX_HELPER_PIPELINE_LIST,
+	/** `struct list_head`, following `prev` pointers. */
+	LINUX_HELPER_PIPELINE_LIST_REVERSE,
+	/** `struct hlist_head`. */
+	LINUX_HELPER_PIPELINE_HLIST,
+	/** `struct hlist_nulls_head`. */
+	LINUX_HELPER_PIPELINE_HLIST_NULLS,
+	/** `struct rb_root`, in order. */
+	LINUX_HELPER_PIPELINE_RBTREE,
+	/** `struct radix_tree_root` or `struct xarray`, skipping values. */
+	LINUX_HELPER_PIPELINE_RADIX_TREE,
+	/** Allocated objects in a `struct kmem_cache`. */
+	LINUX_HELPER_PIPELINE_SLAB,
+	/**
+	 * Elements of an array, or the entries pointed to by the non-null
+	 * elements of an array of pointers.
+	 */
+	LINUX_HELPER_PIPELINE_ARRAY,
+};
+
+/** Comparison done by a @ref linux_helper_pipeline_filter. */
+enum linux_helper_pipeline_op {
+	LINUX_HELPER_PIPELINE_EQ,
+	LINUX_HELPER_PIPELINE_NE,
+	LINUX_HELPER_PIPELINE_LT,
+	LINUX_HELPER_PIPELINE_LE,
+	LINUX_HELPER_PIPELINE_GT,
+	LINUX_HELPER_PIPELINE_GE,
+	/** Bitwise and is non-zero. Only for integers. */
+	LINUX_HELPER_PIPELINE_AND,
+};
+
+/** Comparison of a member of each entry against a constant. */
+struct linux_helper_pipeline_filter {
+	/** Member to compare. */
+	struct drgn_member_path path;
+	/** Comparison. The member is the left hand side. */
+	enum linux_helper_pipeline_op op;
+	/**
+	 * Encoding of @ref value: @ref DRGN_OBJECT_ENCODING_SIGNED, @ref
+	 * DRGN_OBJECT_ENCODING_UNSIGNED, or @ref DRGN_OBJECT_ENCODING_FLOAT.
+	 */
+	enum drgn_object_encoding encoding;
+	/** Constant right hand side. */
+	union drgn_value value;
+};
+
+/**
+ * Compiled "iterate, filter, project" query over kernel objects.
+ *
+ * The members are compiled once against the entry type. Running the pipeline
+ * walks the source with a native iterator, reads the members of a batch of
+ * entries at a time with @ref drgn_program_read_members(), and only returns
+ * the projected members of entries matching every filter, without creating a
+ * @ref drgn_object for each entry.
+ */
+struct linux_helper_pipeline {
+	enum linux_helper_pipeline_source source;
+	/** Type of the entries. */
+	struct drgn_qualified_type entry_type;
+	/** Name of the list or red-black tree node member in the entry type. */
+	char *node_member;
+	/** Filters. Every filter must match. */
+	struct linux_helper_pipeline_filter *filters;
+	size_t num_filters;
+	/** Members of @ref filters followed by the projected members. */
+	struct drgn_member_path *paths;
+	/** Encodings of @ref paths. */
+	enum drgn_object_encoding *encodings;
+	/** Number of projected members. */
+	size_t num_projections;
+};
+
+/**
+ * Initialize a @ref linux_helper_pipeline.
+ *
+ * @param[in] node_member Name of the list or red-black tree node member in @p
+ * entry_type. Only used for lists and red-black trees.
+ * @param[in] filters Filters. They are copied.
+ * @param[in] projections Members to return for each matching entry. They must
+ * have integer, boolean, pointer, or floating-point types.
+ */
+struct drgn_error *
+linux_helper_pipeline_init(struct linux_helper_pipeline *pipeline,
+			   enum linux_helper_pipeline_source source,
+			   struct drgn_qualified_type entry_type,
+			   const char *node_member,
+			   const struct linux_helper_pipeline_filter *filters,
+			   size_t num_filters,
+			   const struct drgn_member_path *projections,
+			   size_t num_projections);
+
+void linux_helper_pipeline_deinit(struct linux_helper_pipeline *pipeline);
+
+/**
+ * Callback for @ref linux_helper_pipeline_run().
+ *
+ * @param[in] address Address of the entry.
+ * @param[in] values Projected members, encoded as given by @ref
+ * linux_helper_pipeline::encodings.
+ */
+typedef struct drgn_error *
+linux_helper_pipeline_row_fn(uint64_t address, const union drgn_value *values,
+			     void *arg);
+
+/**
+ * Run a @ref linux_helper_pipeline.
+ *
+ * @param[in] root Pointer to the list head, red-black tree root, radix tree
+ * root, or slab cache, or an array object, depending on the source.
+ * @param[in] fn Callback called for each matching entry in order. If it
+ * returns an error, the pipeline stops and the error is returned.
+ */
+struct drgn_error *
+linux_helper_pipeline_run(const struct linux_helper_pipeline *pipeline,
+			  const struct drgn_object *root,
+			  linux_helper_pipeline_row_fn *fn, void *arg);
+
+/** Kernel log record passed to @ref linux_helper_for_each_printk_record(). */
+struct linux_helper_printk_record {
+	/** Sequence number. */
+	uint64_t seq;
+	/** Timestamp in nanoseconds. */
+	uint64_t timestamp;
+	/** Message text. This is not null-terminated. */
+	const char *text;
+	/** Length of @ref text. */
+	size_t text_len;
+	/**
+	 * Additional metadata as `KEY=VALUE` entries separated by null bytes.
+	 * This is not null-terminated.
+	 */
+	const char *dict;
+	/** Length of @ref dict. */
+	size_t dict_len;
+	/** `printk()` caller ID. Only valid if @ref has_caller_id. */
+	uint32_t caller_id;
+	/** Whether the kernel saved the caller ID. */
+	bool has_caller_id;
+	/** syslog facility. */
+	uint8_t facility;
+	/** Log level. */
+	uint8_t level;
+	/** Whether this record is a continuation of a previous record. */
+	bool continuation;
+};
+
+/** Callback for @ref linux_helper_for_each_printk_record(). */
+typedef struct drgn_error *
+linux_helper_printk_record_fn(const struct linux_helper_printk_record *record,
+			      void *arg);
+
+/**
+ * Call a function for each record in the Linux kernel log buffer in order.
+ *
+ * This supports the lockless ring buffer (Linux 5.10 and newer) and the
+ * structured log buffer (Linux 3.5 through 5.9). Rather than reading each
+ * record separately, the descriptors and the log text are read in bulk.
+ *
+ * @param[in] min_seq Skip records with a sequence number less than this. Only
+ * the text of the remaining records is read, so passing one more than the
+ * sequence number of the last record seen is an efficient way to follow the
+ * log of a running kernel.
+ * @param[in] fn Callback. The record and the memory it points to are only
+ * valid during the call. If it returns an error, iteration stops and the error
+ * is returned.
+ */
+struct drgn_error *
+linux_helper_for_each_printk_record(struct drgn_program *prog, uint64_t min_seq,
+				    linux_helper_printk_record_fn *fn,
+				    void *arg);
+
 #endif /* DRGN_HELPERS_H */
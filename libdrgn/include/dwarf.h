@@ -931,6 +931,20 @@ enum
   };
 
 
+/* DWARF name index attribute encodings (.debug_names).  */
+enum
+  {
+    DW_IDX_compile_unit = 0x1,
+    DW_IDX_type_unit = 0x2,
+    DW_IDX_die_offset = 0x3,
+    DW_IDX_parent = 0x4,
+    DW_IDX_type_hash = 0x5,
+
+    DW_IDX_lo_user = 0x2000,
+    DW_IDX_hi_user = 0x3fff
+  };
+
+
 /* DWARF call frame instruction encodings.  */
 enum
   {
@@ -0,0 +1,419 @@
+// Copyright (c) Meta Platforms, Inc. and affiliates.
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "drgn.h"
+#include "kallsyms.h"
+#include "program.h"
+#include "symbol.h"
+#include "util.h"
+#include "vector.h"
+
+DEFINE_HASH_MAP_FUNCTIONS(drgn_kallsyms_name_map, c_string_key_hash_pair,
+			  c_string_key_eq)
+DEFINE_VECTOR(drgn_kallsyms_symbol_vector, struct drgn_kallsyms_symbol)
+
+static struct drgn_error *drgn_kallsyms_read_file(const char *path,
+						  char **buf_ret,
+						  size_t *size_ret)
+{
+	struct drgn_error *err;
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return drgn_error_create_os("open", errno, path);
+
+	/*
+	 * The size of files in /proc is unknown, so grow the buffer as needed.
+	 * Leave room for a null terminator.
+	 */
+	size_t capacity = 1024 * 1024, size = 0;
+	char *buf = malloc(capacity);
+	if (!buf) {
+		err = &drgn_enomem;
+		goto out;
+	}
+	for (;;) {
+		if (capacity - size < 2) {
+			char *tmp = realloc(buf, capacity * 2);
+			if (!tmp) {
+				err = &drgn_enomem;
+				goto out;
+			}
+			buf = tmp;
+			capacity *= 2;
+		}
+		ssize_t r = read(fd, buf + size, capacity - size - 1);
+		if (r < 0) {
+			if (errno == EINTR)
+				continue;
+			err = drgn_error_create_os("read", errno, path);
+			goto out;
+		} else if (r == 0) {
+			break;
+		}
+		size += r;
+	}
+	buf[size] = '\0';
+	*buf_ret = buf;
+	*size_ret = size;
+	buf = NULL;
+	err = NULL;
+out:
+	free(buf);
+	close(fd);
+	return err;
+}
+
+static inline int hex_digit_value(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	else if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	else if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	else
+		return -1;
+}
+
+/*
+ * Parse lines of the form "<address> <type> <name>[\t[<module>]]", terminating
+ * the name and module in place.
+ */
+static bool drgn_kallsyms_parse(char *buf, size_t size,
+				struct drgn_kallsyms_symbol_vector *symbols,
+				bool *all_zero_ret)
+{
+	bool all_zero = true;
+	char *p = buf, *end = buf + size;
+	while (p < end) {
+		char *newline = memchr(p, '\n', end - p);
+		if (!newline)
+			newline = end;
+		*newline = '\0';
+
+		uint64_t address = 0;
+		char *s = p;
+		int digit;
+		while ((digit = hex_digit_value(*s)) >= 0) {
+			address = (address << 4) | digit;
+			s++;
+		}
+		if (s == p || s[0] != ' ' || !s[1] || s[2] != ' ')
+			goto invalid;
+		char type = s[1];
+		s += 3;
+		const char *name = s;
+		while (*s && *s != '\t' && *s != ' ')
+			s++;
+		if (s == name)
+			goto invalid;
+		const char *module = NULL;
+		if (*s) {
+			*s++ = '\0';
+			while (*s == '\t' || *s == ' ')
+				s++;
+			if (*s == '[') {
+				char *close = strchr(++s, ']');
+				if (!close)
+					goto invalid;
+				*close = '\0';
+				module = s;
+			}
+		}
+
+		struct drgn_kallsyms_symbol *sym =
+			drgn_kallsyms_symbol_vector_append_entry(symbols);
+		if (!sym)
+			return false;
+		sym->address = address;
+		sym->size = 0;
+		sym->name = name;
+		sym->module = module;
+		sym->next = UINT32_MAX;
+		sym->type = type;
+		if (address)
+			all_zero = false;
+		p = newline + 1;
+		continue;
+
+invalid:
+		/* Skip lines that we don't understand. */
+		p = newline + 1;
+	}
+	*all_zero_ret = all_zero;
+	return true;
+}
+
+static int drgn_kallsyms_symbol_compare(const void *_a, const void *_b)
+{
+	const struct drgn_kallsyms_symbol *a = _a;
+	const struct drgn_kallsyms_symbol *b = _b;
+	if (a->address != b->address)
+		return a->address < b->address ? -1 : 1;
+	/*
+	 * The names point into the file in order, so this keeps symbols with
+	 * the same address in file order.
+	 */
+	if (a->name != b->name)
+		return a->name < b->name ? -1 : 1;
+	return 0;
+}
+
+static bool drgn_kallsyms_same_module(const struct drgn_kallsyms_symbol *a,
+				      const struct drgn_kallsyms_symbol *b)
+{
+	if (!a->module || !b->module)
+		return a->module == b->module;
+	return strcmp(a->module, b->module) == 0;
+}
+
+struct drgn_error *drgn_kallsyms_create(const char *path,
+					struct drgn_kallsyms **ret)
+{
+	struct drgn_error *err;
+	struct drgn_kallsyms *kallsyms = malloc(sizeof(*kallsyms));
+	if (!kallsyms)
+		return &drgn_enomem;
+	kallsyms->symbols = NULL;
+	kallsyms->num_symbols = 0;
+	drgn_kallsyms_name_map_init(&kallsyms->names);
+
+	size_t size;
+	err = drgn_kallsyms_read_file(path, &kallsyms->buf, &size);
+	if (err) {
+		drgn_kallsyms_name_map_deinit(&kallsyms->names);
+		free(kallsyms);
+		return err;
+	}
+
+	struct drgn_kallsyms_symbol_vector symbols = VECTOR_INIT;
+	/* Lines are typically about 40 bytes long. */
+	if (!drgn_kallsyms_symbol_vector_reserve(&symbols, size / 40 + 1)) {
+		err = &drgn_enomem;
+		goto err;
+	}
+	bool all_zero;
+	if (!drgn_kallsyms_parse(kallsyms->buf, size, &symbols, &all_zero)) {
+		err = &drgn_enomem;
+		goto err;
+	}
+	if (symbols.size && all_zero) {
+		err = drgn_error_format(DRGN_ERROR_OTHER,
+					"%s: addresses are hidden (see kptr_restrict)",
+					path);
+		goto err;
+	}
+	if (symbols.size >= UINT32_MAX) {
+		err = drgn_error_format(DRGN_ERROR_OTHER,
+					"%s: too many symbols", path);
+		goto err;
+	}
+	drgn_kallsyms_symbol_vector_shrink_to_fit(&symbols);
+	kallsyms->symbols = symbols.data;
+	kallsyms->num_symbols = symbols.size;
+	drgn_kallsyms_symbol_vector_init(&symbols);
+
+	struct drgn_kallsyms_symbol *syms = kallsyms->symbols;
+	size_t n = kallsyms->num_symbols;
+	qsort(syms, n, sizeof(syms[0]), drgn_kallsyms_symbol_compare);
+
+	/*
+	 * Derive sizes from the next greater address, and chain symbols with
+	 * the same name in address order.
+	 */
+	size_t next_greater = n;
+	for (size_t i = n; i-- > 0;) {
+		if (i + 1 < n && syms[i + 1].address > syms[i].address)
+			next_greater = i + 1;
+		struct drgn_kallsyms_symbol *next = &syms[next_greater];
+		if (next_greater < n &&
+		    drgn_kallsyms_same_module(&syms[i], next))
+			syms[i].size = next->address - syms[i].address;
+
+		struct drgn_kallsyms_name_map_entry entry = {
+			.key = syms[i].name,
+			.value = i,
+		};
+		struct drgn_kallsyms_name_map_iterator it;
+		int r = drgn_kallsyms_name_map_insert(&kallsyms->names, &entry,
+						      &it);
+		if (r < 0) {
+			err = &drgn_enomem;
+			goto err;
+		} else if (r == 0) {
+			syms[i].next = it.entry->value;
+			it.entry->value = i;
+		}
+	}
+	*ret = kallsyms;
+	return NULL;
+
+err:
+	drgn_kallsyms_symbol_vector_deinit(&symbols);
+	drgn_kallsyms_destroy(kallsyms);
+	return err;
+}
+
+void drgn_kallsyms_destroy(struct drgn_kallsyms *kallsyms)
+{
+	if (!kallsyms)
+		return;
+	drgn_kallsyms_name_map_deinit(&kallsyms->names);
+	free(kallsyms->symbols);
+	free(kallsyms->buf);
+	free(kallsyms);
+}
+
+struct drgn_error *drgn_program_kallsyms(struct drgn_program *prog,
+					 struct drgn_kallsyms **ret)
+{
+	struct drgn_error *err;
+	if (!(prog->flags & DRGN_PROGRAM_IS_LINUX_KERNEL) ||
+	    !(prog->flags & DRGN_PROGRAM_IS_LIVE))
+		return &drgn_not_found;
+
+	drgn_program_lock(prog);
+	if (!prog->kallsyms && !prog->kallsyms_err) {
+		err = drgn_kallsyms_create("/proc/kallsyms", &prog->kallsyms);
+		/*
+		 * Remember the failure so that we don't parse the file again
+		 * for every lookup (unless we only ran out of memory).
+		 */
+		if (err && err != &drgn_enomem)
+			prog->kallsyms_err = err;
+		else if (err)
+			goto out;
+	}
+	if (prog->kallsyms) {
+		*ret = prog->kallsyms;
+		err = NULL;
+	} else {
+		err = drgn_error_copy(prog->kallsyms_err);
+	}
+out:
+	drgn_program_unlock(prog);
+	return err;
+}
+
+const struct drgn_kallsyms_symbol *
+drgn_kallsyms_find_first(struct drgn_kallsyms *kallsyms, const char *name)
+{
+	struct drgn_kallsyms_name_map_iterator it =
+		drgn_kallsyms_name_map_search(&kallsyms->names, &name);
+	return it.entry ? &kallsyms->symbols[it.entry->value] : NULL;
+}
+
+static int drgn_kallsyms_binding_rank(char type)
+{
+	if (type == 'w' || type == 'W' || type == 'v' || type == 'V')
+		return 1;
+	else if (type >= 'A' && type <= 'Z')
+		return 2;
+	else
+		return 0;
+}
+
+const struct drgn_kallsyms_symbol *
+drgn_kallsyms_find_by_name(struct drgn_kallsyms *kallsyms, const char *name)
+{
+	const struct drgn_kallsyms_symbol *found = NULL;
+	int found_rank = -1;
+	for (const struct drgn_kallsyms_symbol *sym =
+	     drgn_kallsyms_find_first(kallsyms, name);
+	     sym;
+	     sym = sym->next == UINT32_MAX ?
+		   NULL : &kallsyms->symbols[sym->next]) {
+		int rank = drgn_kallsyms_binding_rank(sym->type);
+		if (rank > found_rank) {
+			found = sym;
+			found_rank = rank;
+			if (rank == 2)
+				break;
+		}
+	}
+	return found;
+}
+
+size_t drgn_kallsyms_address_upper_bound(const struct drgn_kallsyms *kallsyms,
+					 uint64_t address)
+{
+	size_t lo = 0, hi = kallsyms->num_symbols;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (kallsyms->symbols[mid].address <= address)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+const struct drgn_kallsyms_symbol *
+drgn_kallsyms_find_by_address(const struct drgn_kallsyms *kallsyms,
+			      uint64_t address)
+{
+	size_t lo = drgn_kallsyms_address_upper_bound(kallsyms, address);
+	/*
+	 * Symbols with the same address can have different sizes if they are
+	 * in different modules, so check all of them.
+	 */
+	const struct drgn_kallsyms_symbol *found = NULL;
+	for (size_t i = lo; i-- > 0;) {
+		const struct drgn_kallsyms_symbol *sym = &kallsyms->symbols[i];
+		if (i + 1 < lo && sym->address != sym[1].address)
+			break;
+		if (address - sym->address < sym->size &&
+		    (!found || drgn_kallsyms_binding_rank(sym->type) >
+			       drgn_kallsyms_binding_rank(found->type)))
+			found = sym;
+	}
+	return found;
+}
+
+void drgn_symbol_from_kallsyms(const struct drgn_kallsyms_symbol *ksym,
+			       struct drgn_symbol *ret)
+{
+	ret->name = ksym->name;
+	ret->address = ksym->address;
+	ret->size = ksym->size;
+	switch (drgn_kallsyms_binding_rank(ksym->type)) {
+	case 0:
+		ret->binding = DRGN_SYMBOL_BINDING_LOCAL;
+		break;
+	case 1:
+		ret->binding = DRGN_SYMBOL_BINDING_WEAK;
+		break;
+	default:
+		ret->binding = DRGN_SYMBOL_BINDING_GLOBAL;
+		break;
+	}
+	switch (ksym->type) {
+	case 't':
+	case 'T':
+		ret->kind = DRGN_SYMBOL_KIND_FUNC;
+		break;
+	case 'b':
+	case 'B':
+	case 'd':
+	case 'D':
+	case 'g':
+	case 'G':
+	case 'r':
+	case 'R':
+	case 's':
+	case 'S':
+	case 'v':
+	case 'V':
+		ret->kind = DRGN_SYMBOL_KIND_OBJECT;
+		break;
+	default:
+		ret->kind = DRGN_SYMBOL_KIND_UNKNOWN;
+		break;
+	}
+}
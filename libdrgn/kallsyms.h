@@ -0,0 +1,151 @@
+// Copyright (c) Meta Platforms, Inc. and affiliates.
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/**
+ * @file
+ *
+ * Index of /proc/kallsyms.
+ *
+ * See @ref KallsymsIndex.
+ */
+
+#ifndef DRGN_KALLSYMS_H
+#define DRGN_KALLSYMS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hash_table.h"
+
+struct drgn_program;
+struct drgn_symbol;
+
+/**
+ * @ingroup Internals
+ *
+ * @defgroup KallsymsIndex Kallsyms index
+ *
+ * Index of the symbols of the running kernel.
+ *
+ * /proc/kallsyms is large and slow to read, so it is parsed at most once per
+ * program into a @ref drgn_kallsyms, which is indexed by name and by address.
+ * It is used to find symbols that are needed before debugging information is
+ * loaded and as a symbol source for live kernels without debugging information
+ * for vmlinux.
+ *
+ * @{
+ */
+
+/** Symbol in a @ref drgn_kallsyms. */
+struct drgn_kallsyms_symbol {
+	/** Start address of the symbol. */
+	uint64_t address;
+	/**
+	 * Size of the symbol.
+	 *
+	 * kallsyms doesn't record sizes, so this is the distance to the next
+	 * symbol in the same module. It is zero for the last symbol of each
+	 * module.
+	 */
+	uint64_t size;
+	/** Name of the symbol. */
+	const char *name;
+	/** Name of the module containing the symbol, or @c NULL for vmlinux. */
+	const char *module;
+	/**
+	 * Index of the next symbol with the same name in @ref
+	 * drgn_kallsyms::symbols, or @c UINT32_MAX if this is the last one.
+	 */
+	uint32_t next;
+	/** Type character from kallsyms (e.g., 'T' or 'd'). */
+	char type;
+};
+
+DEFINE_HASH_MAP_TYPE(drgn_kallsyms_name_map, const char *, uint32_t)
+
+/** Parsed /proc/kallsyms. */
+struct drgn_kallsyms {
+	/** Contents of the file, with the names terminated in place. */
+	char *buf;
+	/** Symbols sorted by address. */
+	struct drgn_kallsyms_symbol *symbols;
+	/** Number of symbols in @ref symbols. */
+	size_t num_symbols;
+	/**
+	 * Map from symbol name to the index in @ref symbols of the first
+	 * symbol with that name.
+	 */
+	struct drgn_kallsyms_name_map names;
+};
+
+/**
+ * Parse a kallsyms file.
+ *
+ * @param[in] path Path of the file, usually "/proc/kallsyms".
+ * @param[out] ret Returned index. Must be destroyed with @ref
+ * drgn_kallsyms_destroy().
+ */
+struct drgn_error *drgn_kallsyms_create(const char *path,
+					struct drgn_kallsyms **ret);
+
+/** Free a @ref drgn_kallsyms. */
+void drgn_kallsyms_destroy(struct drgn_kallsyms *kallsyms);
+
+/**
+ * Get the kallsyms index of a live kernel program, parsing /proc/kallsyms if
+ * it hasn't been parsed yet.
+ *
+ * @param[out] ret Returned index. It is owned by @p prog.
+ * @return @c NULL on success, @ref drgn_not_found if @p prog is not the running
+ * kernel or the running kernel's kallsyms are not available, non-@c NULL on
+ * other errors.
+ */
+struct drgn_error *drgn_program_kallsyms(struct drgn_program *prog,
+					 struct drgn_kallsyms **ret);
+
+/**
+ * Find the symbol with a given name, preferring global symbols over weak
+ * symbols over local symbols.
+ *
+ * @return Symbol, or @c NULL if not found.
+ */
+const struct drgn_kallsyms_symbol *
+drgn_kallsyms_find_by_name(struct drgn_kallsyms *kallsyms, const char *name);
+
+/**
+ * Find the first symbol with a given name.
+ *
+ * The remaining symbols with the same name can be iterated with @ref
+ * drgn_kallsyms_symbol::next.
+ *
+ * @return Symbol, or @c NULL if not found.
+ */
+const struct drgn_kallsyms_symbol *
+drgn_kallsyms_find_first(struct drgn_kallsyms *kallsyms, const char *name);
+
+/**
+ * Find the last symbol starting at or before an address.
+ *
+ * @return Index into @ref drgn_kallsyms::symbols plus one, or zero if no symbol
+ * starts at or before the address.
+ */
+size_t drgn_kallsyms_address_upper_bound(const struct drgn_kallsyms *kallsyms,
+					 uint64_t address);
+
+/**
+ * Find the symbol containing an address.
+ *
+ * @return Symbol, or @c NULL if not found.
+ */
+const struct drgn_kallsyms_symbol *
+drgn_kallsyms_find_by_address(const struct drgn_kallsyms *kallsyms,
+			      uint64_t address);
+
+/** Initialize a @ref drgn_symbol from a symbol in a @ref drgn_kallsyms. */
+void drgn_symbol_from_kallsyms(const struct drgn_kallsyms_symbol *ksym,
+			       struct drgn_symbol *ret);
+
+/** @} */
+
+#endif /* DRGN_KALLSYMS_H */
@@ -59,9 +59,8 @@ static struct drgn_error *drgn_platform_from_kdump(kdump_ctx_t *ctx,
 	return NULL;
 }
 
-static struct drgn_error *drgn_read_kdump(void *buf, uint64_t address,
-					  size_t count, uint64_t offset,
-					  void *arg, bool physical)
+struct drgn_error *drgn_read_kdump(void *buf, uint64_t address, size_t count,
+				   uint64_t offset, void *arg, bool physical)
 {
 	kdump_ctx_t *ctx = arg;
 	kdump_status ks;
@@ -51,7 +51,9 @@ typedef struct drgn_error *drgn_format_type_fn(struct drgn_qualified_type,
 typedef struct drgn_error *drgn_format_object_fn(const struct drgn_object *,
 						 size_t,
 						 enum drgn_format_object_flags,
-						 char **);
+						 uint64_t, size_t,
+						 drgn_format_object_write_fn *,
+						 void *);
 typedef struct drgn_error *drgn_find_type_fn(const struct drgn_language *lang,
 					     struct drgn_program *prog,
 					     const char *name,
@@ -60,7 +62,9 @@ typedef struct drgn_error *drgn_find_type_fn(const struct drgn_language *lang,
 typedef struct drgn_error *drgn_bit_offset_fn(struct drgn_program *prog,
 					      struct drgn_type *type,
 					      const char *member_designator,
-					      uint64_t *ret);
+					      struct drgn_qualified_type *member_type_ret,
+					      uint64_t *bit_field_size_ret,
+					      uint64_t *bit_offset_ret);
 typedef struct drgn_error *drgn_integer_literal_fn(struct drgn_object *res,
 						   uint64_t uvalue);
 typedef struct drgn_error *drgn_bool_literal_fn(struct drgn_object *res,
@@ -107,6 +111,8 @@ struct drgn_language {
 	 * This should parse @p member_designator (which may include one or more
 	 * member references and zero or more array subscripts) and calculate
 	 * the offset, in bits, of that member from the beginning of @p type.
+	 * If @p member_type_ret and @p bit_field_size_ret are not @c NULL, this
+	 * should also return the type and bit field size of the member.
 	 */
 	drgn_bit_offset_fn *bit_offset;
 	/**
@@ -154,6 +160,22 @@ extern const struct drgn_language * const drgn_languages[];
 /** Language to be used when actual language is unknown. */
 #define drgn_default_language drgn_language_c
 
+struct string_builder;
+
+/**
+ * Append the canonical form of a C++ name to a string builder.
+ *
+ * Compilers don't agree on the spelling of names with template arguments
+ * (e.g., `vector<int, std::allocator<int> >` vs. `vector<int,
+ * std::allocator<int>>`), so names are compared in a canonical form: a leading
+ * `::` is removed, and whitespace is removed except for a single space between
+ * two identifiers or numbers.
+ *
+ * @return @c false on allocation failure, @c true on success.
+ */
+bool drgn_cpp_canonicalize_name(const char *name, size_t len,
+				struct string_builder *sb);
+
 /**
  * Return flags that should be passed through when formatting an object
  * recursively.
@@ -42,6 +42,15 @@ static bool append_tabs(int n, struct string_builder *sb)
 	return true;
 }
 
+/*
+ * Append a type name, tag, or member or enumerator name. These are interned,
+ * so their lengths are already known.
+ */
+static bool append_type_string(struct string_builder *sb, const char *str)
+{
+	return string_builder_appendn(sb, str, drgn_interned_string(str)->len);
+}
+
 static struct drgn_error *c_variable_name(struct string_callback *name,
 					  void *arg, struct string_builder *sb)
 {
@@ -92,9 +101,9 @@ c_declare_basic(struct drgn_qualified_type qualified_type,
 		if (!string_builder_appendc(sb, ' '))
 			return &drgn_enomem;
 	}
-	if (!string_builder_append(sb,
-				   drgn_type_kind(qualified_type.type) == DRGN_TYPE_VOID ?
-				   "void" : drgn_type_name(qualified_type.type)))
+	if (drgn_type_kind(qualified_type.type) == DRGN_TYPE_VOID ?
+	    !string_builder_append(sb, "void") :
+	    !append_type_string(sb, drgn_type_name(qualified_type.type)))
 		return &drgn_enomem;
 	if (name) {
 		if (!string_builder_appendc(sb, ' '))
@@ -145,7 +154,7 @@ c_append_tagged_name(struct drgn_qualified_type qualified_type, size_t indent,
 	tag = drgn_type_tag(qualified_type.type);
 	if (tag) {
 		if (!string_builder_appendc(sb, ' ') ||
-		    !string_builder_append(sb, tag))
+		    !append_type_string(sb, tag))
 			return &drgn_enomem;
 	}
 
@@ -442,7 +451,7 @@ c_define_enum(struct drgn_qualified_type qualified_type, size_t indent,
 	is_signed = drgn_enum_type_is_signed(qualified_type.type);
 	for (i = 0; i < num_enumerators; i++) {
 		if (!append_tabs(indent + 1, sb) ||
-		    !string_builder_append(sb, enumerators[i].name) ||
+		    !append_type_string(sb, enumerators[i].name) ||
 		    !string_builder_append(sb, " = "))
 			return &drgn_enomem;
 		if (is_signed) {
@@ -567,11 +576,52 @@ c_format_type(struct drgn_qualified_type qualified_type, char **ret)
 	return NULL;
 }
 
+/* Output of c_format_object_impl(). */
+struct c_format_output {
+	/* Output that hasn't been passed to write_fn yet. */
+	struct string_builder sb;
+	/* Callback for finished output. */
+	drgn_format_object_write_fn *write_fn;
+	void *write_arg;
+	/* Number of bytes passed to write_fn. */
+	size_t written;
+	/*
+	 * While this is non-zero, the pending output may still be rewritten, so
+	 * it can't be passed to write_fn.
+	 */
+	unsigned int no_flush;
+	/* Maximum number of elements to format for each array, or 0. */
+	uint64_t max_elements;
+	/*
+	 * Once this many bytes have been output, the remaining initializers
+	 * are omitted. 0 if there is no limit.
+	 */
+	size_t max_size;
+};
+
+static struct drgn_error *c_format_flush(struct c_format_output *out)
+{
+	if (out->no_flush || !out->sb.len)
+		return NULL;
+	struct drgn_error *err = out->write_fn(out->sb.str, out->sb.len,
+					       out->write_arg);
+	if (err)
+		return err;
+	out->written += out->sb.len;
+	out->sb.len = 0;
+	return NULL;
+}
+
+static inline bool c_format_output_full(struct c_format_output *out)
+{
+	return out->max_size && out->written + out->sb.len >= out->max_size;
+}
+
 static struct drgn_error *
 c_format_object_impl(const struct drgn_object *obj, size_t indent,
 		     size_t one_line_columns, size_t multi_line_columns,
 		     enum drgn_format_object_flags flags,
-		     struct string_builder *sb);
+		     struct c_format_output *out);
 
 static bool is_character_type(struct drgn_type *type)
 {
@@ -641,6 +691,18 @@ no_escape:
 	return ret ? NULL : &drgn_enomem;
 }
 
+static struct drgn_error *c_format_string_chunk(const char *chunk, size_t size,
+						void *arg)
+{
+	struct drgn_error *err;
+	for (size_t i = 0; i < size; i++) {
+		err = c_format_character(chunk[i], false, true, arg);
+		if (err)
+			return err;
+	}
+	return NULL;
+}
+
 static struct drgn_error *
 c_format_string(struct drgn_program *prog, uint64_t address, uint64_t length,
 		struct string_builder *sb)
@@ -649,21 +711,10 @@ c_format_string(struct drgn_program *prog, uint64_t address, uint64_t length,
 
 	if (!string_builder_appendc(sb, '"'))
 		return &drgn_enomem;
-	while (length) {
-		unsigned char c;
-		err = drgn_program_read_memory(prog, &c, address++, 1, false);
-		if (err)
-			return err;
-
-		if (c == '\0') {
-			break;
-		} else {
-			err = c_format_character(c, false, true, sb);
-			if (err)
-				return err;
-		}
-		length--;
-	}
+	err = drgn_program_read_c_string_chunks(prog, address, false, length,
+						c_format_string_chunk, sb);
+	if (err)
+		return err;
 	if (!string_builder_appendc(sb, '"'))
 		return &drgn_enomem;
 	return NULL;
@@ -743,6 +794,15 @@ static struct drgn_error drgn_line_wrap = {
 	.message = "needs line wrap",
 };
 
+/*
+ * Returned by initializer_iter::next() to replace the remaining initializers
+ * with "...".
+ */
+static struct drgn_error c_format_ellipsis = {
+	.code = DRGN_ERROR_STOP,
+	.message = "omitted initializers",
+};
+
 struct initializer_iter {
 	struct drgn_error *(*next)(struct initializer_iter *,
 				   struct drgn_object *,
@@ -752,18 +812,42 @@ struct initializer_iter {
 						 struct string_builder *);
 };
 
+/*
+ * Get the next initializer, or c_format_ellipsis if the rest are omitted
+ * because the iterator says so or the output is too long.
+ */
+static struct drgn_error *
+c_format_next_initializer(struct initializer_iter *iter,
+			  struct c_format_output *out, bool *ellipsis,
+			  struct drgn_object *obj,
+			  enum drgn_format_object_flags *flags)
+{
+	if (*ellipsis)
+		return &drgn_stop;
+	struct drgn_error *err;
+	if (c_format_output_full(out))
+		err = &c_format_ellipsis;
+	else
+		err = iter->next(iter, obj, flags);
+	if (err == &c_format_ellipsis)
+		*ellipsis = true;
+	return err;
+}
+
 static struct drgn_error *c_format_initializer(struct drgn_program *prog,
 					       struct initializer_iter *iter,
 					       size_t indent,
 					       size_t one_line_columns,
 					       size_t multi_line_columns,
 					       bool same_line,
-					       struct string_builder *sb)
+					       struct c_format_output *out)
 {
 	struct drgn_error *err;
+	struct string_builder *sb = &out->sb;
 	struct drgn_object obj;
 	enum drgn_format_object_flags initializer_flags;
 	size_t brace, remaining_columns, start_columns;
+	bool ellipsis = false;
 
 	drgn_object_init(&obj, prog);
 
@@ -778,10 +862,11 @@ static struct drgn_error *c_format_initializer(struct drgn_program *prog,
 	for (;;) {
 		size_t initializer_start;
 
-		err = iter->next(iter, &obj, &initializer_flags);
+		err = c_format_next_initializer(iter, out, &ellipsis, &obj,
+						&initializer_flags);
 		if (err == &drgn_stop)
 			break;
-		else if (err)
+		else if (err && err != &c_format_ellipsis)
 			goto out;
 
 		if (!same_line) {
@@ -817,6 +902,19 @@ static struct drgn_error *c_format_initializer(struct drgn_program *prog,
 			remaining_columns -= 2;
 		}
 
+		if (ellipsis) {
+			if (!string_builder_append(sb, "...")) {
+				err = &drgn_enomem;
+				goto out;
+			}
+			if (__builtin_sub_overflow(remaining_columns, 3,
+						   &remaining_columns)) {
+				err = &drgn_line_wrap;
+				break;
+			}
+			continue;
+		}
+
 		if (iter->append_designation) {
 			size_t designation_start = sb->len;
 
@@ -834,7 +932,7 @@ static struct drgn_error *c_format_initializer(struct drgn_program *prog,
 		initializer_start = sb->len;
 		err = c_format_object_impl(&obj, indent + 1,
 					   remaining_columns - 2, 0,
-					   initializer_flags, sb);
+					   initializer_flags, out);
 		if (err == &drgn_line_wrap)
 			break;
 		else if (err)
@@ -880,13 +978,23 @@ static struct drgn_error *c_format_initializer(struct drgn_program *prog,
 		start_columns = 0;
 	remaining_columns = 0;
 	iter->reset(iter);
+	ellipsis = false;
 	for (;;) {
 		size_t newline, designation_start, line_columns;
 
-		err = iter->next(iter, &obj, &initializer_flags);
+		/*
+		 * Once we're on multiple lines, the output so far won't change,
+		 * so it can be written out.
+		 */
+		err = c_format_flush(out);
+		if (err)
+			goto out;
+
+		err = c_format_next_initializer(iter, out, &ellipsis, &obj,
+						&initializer_flags);
 		if (err == &drgn_stop)
 			break;
-		else if (err)
+		else if (err && err != &c_format_ellipsis)
 			goto out;
 
 		newline = sb->len;
@@ -896,6 +1004,14 @@ static struct drgn_error *c_format_initializer(struct drgn_program *prog,
 			goto out;
 		}
 
+		if (ellipsis) {
+			if (!string_builder_append(sb, "...")) {
+				err = &drgn_enomem;
+				goto out;
+			}
+			continue;
+		}
+
 		designation_start = sb->len;
 		line_columns = start_columns;
 		if (iter->append_designation) {
@@ -912,7 +1028,7 @@ static struct drgn_error *c_format_initializer(struct drgn_program *prog,
 			size_t initializer_start = sb->len;
 
 			err = c_format_object_impl(&obj, 0, line_columns - 1,
-						   0, initializer_flags, sb);
+						   0, initializer_flags, out);
 			if (!err) {
 				size_t len = sb->len - designation_start;
 
@@ -952,7 +1068,7 @@ static struct drgn_error *c_format_initializer(struct drgn_program *prog,
 
 		err = c_format_object_impl(&obj, indent + 1, 0,
 					   multi_line_columns,
-					   initializer_flags, sb);
+					   initializer_flags, out);
 		if (err)
 			goto out;
 		if (!string_builder_appendc(sb, ',')) {
@@ -1080,7 +1196,10 @@ compound_initializer_append_designation(struct initializer_iter *iter_,
 		&iter->stack.data[iter->stack.size - 1];
 	const char *name = top->member[-1].name;
 
-	if (name && !string_builder_appendf(sb, ".%s = ", name))
+	if (name &&
+	    (!string_builder_appendc(sb, '.') ||
+	     !append_type_string(sb, name) ||
+	     !string_builder_append(sb, " = ")))
 		return &drgn_enomem;
 	return NULL;
 }
@@ -1090,7 +1209,7 @@ c_format_compound_object(const struct drgn_object *obj,
 			 struct drgn_type *underlying_type, size_t indent,
 			 size_t one_line_columns, size_t multi_line_columns,
 			 enum drgn_format_object_flags flags,
-			 struct string_builder *sb)
+			 struct c_format_output *out)
 {
 	struct drgn_error *err;
 
@@ -1180,7 +1299,7 @@ c_format_compound_object(const struct drgn_object *obj,
 	err = c_format_initializer(drgn_object_program(obj), &iter.iter, indent,
 				   one_line_columns, multi_line_columns,
 				   flags & DRGN_FORMAT_OBJECT_MEMBERS_SAME_LINE,
-				   sb);
+				   out);
 out:
 	compound_initializer_stack_deinit(&iter.stack);
 	return err;
@@ -1192,29 +1311,25 @@ c_format_enum_object(const struct drgn_object *obj,
 		     struct string_builder *sb)
 {
 	struct drgn_error *err;
-	struct drgn_type_enumerator *enumerators;
-	size_t num_enumerators, i;
+	const struct drgn_type_enumerator *enumerator;
 
 	if (!drgn_type_is_complete(underlying_type)) {
 		return drgn_error_create(DRGN_ERROR_TYPE,
 					 "cannot format incomplete enum object");
 	}
 
-	enumerators = drgn_type_enumerators(underlying_type);
-	num_enumerators = drgn_type_num_enumerators(underlying_type);
 	if (drgn_enum_type_is_signed(underlying_type)) {
 		int64_t svalue;
 
 		err = drgn_object_read_signed(obj, &svalue);
 		if (err)
 			return err;
-		for (i = 0; i < num_enumerators; i++) {
-			if (enumerators[i].svalue == svalue) {
-				if (!string_builder_append(sb,
-							   enumerators[i].name))
-					return &drgn_enomem;
-				return NULL;
-			}
+		enumerator = drgn_enum_type_find_value(underlying_type,
+						       svalue);
+		if (enumerator) {
+			if (!string_builder_append(sb, enumerator->name))
+				return &drgn_enomem;
+			return NULL;
 		}
 		if (!string_builder_appendf(sb, "%" PRId64, svalue))
 			return &drgn_enomem;
@@ -1225,13 +1340,12 @@ c_format_enum_object(const struct drgn_object *obj,
 		err = drgn_object_read_unsigned(obj, &uvalue);
 		if (err)
 			return err;
-		for (i = 0; i < num_enumerators; i++) {
-			if (enumerators[i].uvalue == uvalue) {
-				if (!string_builder_append(sb,
-							   enumerators[i].name))
-					return &drgn_enomem;
-				return NULL;
-			}
+		enumerator = drgn_enum_type_find_value(underlying_type,
+						       uvalue);
+		if (enumerator) {
+			if (!string_builder_append(sb, enumerator->name))
+				return &drgn_enomem;
+			return NULL;
 		}
 		if (!string_builder_appendf(sb, "%" PRIu64, uvalue))
 			return &drgn_enomem;
@@ -1245,9 +1359,10 @@ c_format_pointer_object(const struct drgn_object *obj,
 			size_t indent, size_t one_line_columns,
 			size_t multi_line_columns,
 			enum drgn_format_object_flags flags,
-			struct string_builder *sb)
+			struct c_format_output *out)
 {
 	struct drgn_error *err;
+	struct string_builder *sb = &out->sb;
 	enum drgn_format_object_flags passthrough_flags =
 		drgn_passthrough_format_object_flags(flags);
 	bool dereference = flags & DRGN_FORMAT_OBJECT_DEREFERENCE;
@@ -1322,9 +1437,12 @@ c_format_pointer_object(const struct drgn_object *obj,
 		if (__builtin_sub_overflow(one_line_columns, sb->len - start,
 					   &one_line_columns))
 			one_line_columns = 0;
+		/* The output is rewritten below if this faults. */
+		out->no_flush++;
 		err = c_format_object_impl(&dereferenced, indent,
 					   one_line_columns, multi_line_columns,
-					   passthrough_flags, sb);
+					   passthrough_flags, out);
+		out->no_flush--;
 		drgn_object_deinit(&dereferenced);
 	}
 	if (!err || (err->code != DRGN_ERROR_FAULT && err->code != DRGN_ERROR_OUT_OF_BOUNDS)) {
@@ -1350,15 +1468,86 @@ no_dereference:
 	return NULL;
 }
 
+/*
+ * Array elements are read from memory in chunks of this many bytes instead of
+ * one at a time.
+ */
+#define C_FORMAT_ARRAY_CHUNK_SIZE 65536
+
 struct array_initializer_iter {
 	struct initializer_iter iter;
 	const struct drgn_object *obj;
 	struct drgn_qualified_type element_type;
 	uint64_t element_bit_size;
 	uint64_t length, i;
+	/* Whether there are more elements than length. */
+	bool truncated;
+	/*
+	 * Value of elements [chunk_start, chunk_start + chunk_length) if obj
+	 * is a reference.
+	 */
+	struct drgn_object chunk;
+	uint64_t chunk_start, chunk_length;
+	/* Maximum number of elements in chunk, or 0 to not use chunks. */
+	uint64_t max_chunk_length;
 	enum drgn_format_object_flags flags, element_flags;
 };
 
+static struct drgn_error *
+array_initializer_iter_read_chunk(struct array_initializer_iter *iter)
+{
+	struct drgn_error *err;
+	uint64_t length = min(iter->max_chunk_length, iter->length - iter->i);
+	struct drgn_qualified_type chunk_type;
+	err = drgn_array_type_create(drgn_object_program(iter->obj),
+				     iter->element_type, length,
+				     drgn_object_language(iter->obj),
+				     &chunk_type.type);
+	if (err)
+		return err;
+	chunk_type.qualifiers = 0;
+	err = drgn_object_slice(&iter->chunk, iter->obj, chunk_type,
+				iter->i * iter->element_bit_size, 0);
+	if (!err)
+		err = drgn_object_read(&iter->chunk, &iter->chunk);
+	if (err) {
+		if (err->code != DRGN_ERROR_FAULT)
+			return err;
+		/*
+		 * Part of the chunk isn't readable. Fall back to reading one
+		 * element at a time so that any fault is reported for an
+		 * element that is actually formatted.
+		 */
+		drgn_error_destroy(err);
+		iter->max_chunk_length = 0;
+		return NULL;
+	}
+	iter->chunk_start = iter->i;
+	iter->chunk_length = length;
+	return NULL;
+}
+
+static struct drgn_error *
+array_initializer_iter_element(struct array_initializer_iter *iter,
+			       struct drgn_object *ret)
+{
+	struct drgn_error *err;
+	if (iter->max_chunk_length &&
+	    (iter->i < iter->chunk_start ||
+	     iter->i - iter->chunk_start >= iter->chunk_length)) {
+		err = array_initializer_iter_read_chunk(iter);
+		if (err)
+			return err;
+	}
+	if (iter->max_chunk_length) {
+		return drgn_object_slice(ret, &iter->chunk, iter->element_type,
+					 (iter->i - iter->chunk_start) *
+					 iter->element_bit_size, 0);
+	}
+	return drgn_object_slice(ret, iter->obj, iter->element_type,
+				 iter->i * iter->element_bit_size, 0);
+}
+
 static struct drgn_error *
 array_initializer_iter_next(struct initializer_iter *iter_,
 			    struct drgn_object *obj_ret,
@@ -1372,9 +1561,8 @@ array_initializer_iter_next(struct initializer_iter *iter_,
 		bool zero;
 
 		if (iter->i >= iter->length)
-			return &drgn_stop;
-		err = drgn_object_slice(obj_ret, iter->obj, iter->element_type,
-					iter->i * iter->element_bit_size, 0);
+			return iter->truncated ? &c_format_ellipsis : &drgn_stop;
+		err = array_initializer_iter_element(iter, obj_ret);
 		if (err)
 			return err;
 		iter->i++;
@@ -1420,9 +1608,10 @@ c_format_array_object(const struct drgn_object *obj,
 		      struct drgn_type *underlying_type, size_t indent,
 		      size_t one_line_columns, size_t multi_line_columns,
 		      enum drgn_format_object_flags flags,
-		      struct string_builder *sb)
+		      struct c_format_output *out)
 {
 	struct drgn_error *err;
+	struct string_builder *sb = &out->sb;
 	struct array_initializer_iter iter = {
 		.iter = {
 			.next = array_initializer_iter_next,
@@ -1473,14 +1662,20 @@ c_format_array_object(const struct drgn_object *obj,
 	if (err)
 		return err;
 
+	if (out->max_elements && iter.length > out->max_elements) {
+		iter.length = out->max_elements;
+		iter.truncated = true;
+	}
+
 	/*
 	 * If we don't want zero elements, ignore any at the end. If we're
 	 * including indices, then we'll skip past zeroes as we iterate, so we
-	 * don't need to do this.
+	 * don't need to do this. If the array is truncated, the end isn't
+	 * formatted anyways.
 	 */
 	if (!(flags & (DRGN_FORMAT_OBJECT_ELEMENT_INDICES |
 		       DRGN_FORMAT_OBJECT_IMPLICIT_ELEMENTS)) &&
-	    iter.length) {
+	    iter.length && !iter.truncated) {
 		struct drgn_object element;
 
 		drgn_object_init(&element, drgn_object_program(obj));
@@ -1507,11 +1702,22 @@ c_format_array_object(const struct drgn_object *obj,
 		if (err)
 			return err;
 	}
-	return c_format_initializer(drgn_object_program(obj), &iter.iter,
-				    indent, one_line_columns,
-				    multi_line_columns,
-				    flags & DRGN_FORMAT_OBJECT_ELEMENTS_SAME_LINE,
-				    sb);
+
+	if (obj->kind == DRGN_OBJECT_REFERENCE &&
+	    iter.element_bit_size % 8 == 0 && iter.element_bit_size &&
+	    iter.length > 1) {
+		iter.max_chunk_length =
+			max(C_FORMAT_ARRAY_CHUNK_SIZE /
+			    (iter.element_bit_size / 8), (uint64_t)1);
+	}
+	drgn_object_init(&iter.chunk, drgn_object_program(obj));
+	err = c_format_initializer(drgn_object_program(obj), &iter.iter,
+				   indent, one_line_columns,
+				   multi_line_columns,
+				   flags & DRGN_FORMAT_OBJECT_ELEMENTS_SAME_LINE,
+				   out);
+	drgn_object_deinit(&iter.chunk);
+	return err;
 }
 
 static struct drgn_error *
@@ -1528,9 +1734,10 @@ static struct drgn_error *
 c_format_object_impl(const struct drgn_object *obj, size_t indent,
 		     size_t one_line_columns, size_t multi_line_columns,
 		     enum drgn_format_object_flags flags,
-		     struct string_builder *sb)
+		     struct c_format_output *out)
 {
 	struct drgn_error *err;
+	struct string_builder *sb = &out->sb;
 	struct drgn_type *underlying_type = drgn_underlying_type(obj->type);
 
 	if (drgn_type_kind(underlying_type) == DRGN_TYPE_VOID) {
@@ -1546,7 +1753,7 @@ c_format_object_impl(const struct drgn_object *obj, size_t indent,
 	    obj->kind != DRGN_OBJECT_ABSENT) {
 		return c_format_pointer_object(obj, underlying_type, indent,
 					       one_line_columns,
-					       multi_line_columns, flags, sb);
+					       multi_line_columns, flags, out);
 	}
 
 	if (flags & DRGN_FORMAT_OBJECT_TYPE_NAME) {
@@ -1583,13 +1790,13 @@ c_format_object_impl(const struct drgn_object *obj, size_t indent,
 	case DRGN_TYPE_CLASS:
 		return c_format_compound_object(obj, underlying_type, indent,
 						one_line_columns,
-						multi_line_columns, flags, sb);
+						multi_line_columns, flags, out);
 	case DRGN_TYPE_ENUM:
 		return c_format_enum_object(obj, underlying_type, sb);
 	case DRGN_TYPE_ARRAY:
 		return c_format_array_object(obj, underlying_type, indent,
 					     one_line_columns,
-					     multi_line_columns, flags, sb);
+					     multi_line_columns, flags, out);
 	case DRGN_TYPE_FUNCTION:
 		return c_format_function_object(obj, sb);
 	case DRGN_TYPE_VOID:
@@ -1598,23 +1805,26 @@ c_format_object_impl(const struct drgn_object *obj, size_t indent,
 	)
 }
 
-static struct drgn_error *c_format_object(const struct drgn_object *obj,
-					  size_t columns,
-					  enum drgn_format_object_flags flags,
-					  char **ret)
+static struct drgn_error *
+c_format_object(const struct drgn_object *obj, size_t columns,
+		enum drgn_format_object_flags flags, uint64_t max_elements,
+		size_t max_size, drgn_format_object_write_fn *write_fn,
+		void *write_arg)
 {
 	struct drgn_error *err;
-	struct string_builder sb = {};
+	struct c_format_output out = {
+		.write_fn = write_fn,
+		.write_arg = write_arg,
+		.max_elements = max_elements,
+		.max_size = max_size,
+	};
 
 	err = c_format_object_impl(obj, 0, columns, max(columns, (size_t)1),
-				   flags, &sb);
-	if (err) {
-		free(sb.str);
-		return err;
-	}
-	if (!string_builder_finalize(&sb, ret))
-		return &drgn_enomem;
-	return NULL;
+				   flags, &out);
+	if (!err)
+		err = c_format_flush(&out);
+	free(out.sb.str);
+	return err;
 }
 
 /* This obviously incomplete since we only handle the tokens we care about. */
@@ -1662,6 +1872,104 @@ struct drgn_c_family_lexer {
 	bool cpp;
 };
 
+static inline bool c_is_identifier_char(char c)
+{
+	return isalnum(c) || c == '_';
+}
+
+bool drgn_cpp_canonicalize_name(const char *name, size_t len,
+				struct string_builder *sb)
+{
+	const char *p = name, *end = name + len;
+	while (p < end && isspace(*p))
+		p++;
+	if (end - p >= 2 && p[0] == ':' && p[1] == ':')
+		p += 2;
+	char prev = '\0';
+	bool space = false;
+	for (; p < end; p++) {
+		if (isspace(*p)) {
+			space = true;
+			continue;
+		}
+		if (space && c_is_identifier_char(prev) &&
+		    c_is_identifier_char(*p) && !string_builder_appendc(sb, ' '))
+			return false;
+		if (!string_builder_appendc(sb, *p))
+			return false;
+		prev = *p;
+		space = false;
+	}
+	return true;
+}
+
+/*
+ * Find the end of a C++ name that may be qualified or have template arguments
+ * given the end of its first identifier. This returns NULL if a template
+ * argument list isn't closed.
+ */
+static const char *cpp_find_qualified_name_end(const char *p)
+{
+	for (;;) {
+		const char *q = p;
+		while (isspace(*q))
+			q++;
+		if (q[0] == ':' && q[1] == ':') {
+			q += 2;
+			while (isspace(*q))
+				q++;
+			if (!isalpha(*q) && *q != '_')
+				return p;
+			do {
+				q++;
+			} while (c_is_identifier_char(*q));
+		} else if (*q == '<') {
+			/* Angle brackets in parentheses are comparisons. */
+			int angle_depth = 0, paren_depth = 0;
+			for (;; q++) {
+				if (*q == '\0') {
+					return NULL;
+				} else if (*q == '(') {
+					paren_depth++;
+				} else if (*q == ')') {
+					if (paren_depth)
+						paren_depth--;
+				} else if (!paren_depth && *q == '<') {
+					angle_depth++;
+				} else if (!paren_depth && *q == '>' &&
+					   --angle_depth == 0) {
+					break;
+				}
+			}
+			q++;
+		} else {
+			return p;
+		}
+		p = q;
+	}
+}
+
+/*
+ * Advance *end past the rest of a C++ name that may be qualified or have
+ * template arguments (e.g., "std::vector<int>::iterator"). On entry, *end is
+ * the end of the first identifier (or start if the name begins with "::").
+ */
+static struct drgn_error *cpp_lex_qualified_name(const char *start,
+						 const char **end)
+{
+	const char *p = cpp_find_qualified_name_end(*end);
+	if (!p) {
+		return drgn_error_create(DRGN_ERROR_SYNTAX,
+					 "unterminated template argument list");
+	}
+	if (p == start) {
+		return drgn_error_create(DRGN_ERROR_SYNTAX,
+					 "expected identifier after '::'");
+	}
+	*end = p;
+	return NULL;
+}
+
 struct drgn_error *drgn_c_family_lexer_func(struct drgn_lexer *lexer,
 					    struct drgn_token *token) {
 	const char *p = lexer->p;
@@ -1700,13 +2008,30 @@ struct drgn_error *drgn_c_family_lexer_func(struct drgn_lexer *lexer,
 		p++;
 		break;
 	default:
-		if (isalpha(*p) || *p == '_') {
-			do {
-				p++;
-			} while (isalnum(*p) || *p == '_');
-			token->kind = identifier_token_kind(token->value,
-							    p - token->value,
-							    cpp);
+		if (isalpha(*p) || *p == '_' ||
+		    (cpp && p[0] == ':' && p[1] == ':')) {
+			/* A leading :: is only allowed by C++. */
+			if (*p == ':') {
+				token->kind = C_TOKEN_IDENTIFIER;
+			} else {
+				do {
+					p++;
+				} while (isalnum(*p) || *p == '_');
+				size_t len = p - token->value;
+				token->kind = identifier_token_kind(token->value,
+								    len, cpp);
+			}
+			/*
+			 * In C++, a qualified name or template name is lexed as
+			 * one identifier. The type finder canonicalizes it.
+			 */
+			if (cpp && token->kind == C_TOKEN_IDENTIFIER) {
+				struct drgn_error *err =
+					cpp_lex_qualified_name(token->value,
+							       &p);
+				if (err)
+					return err;
+			}
 		} else if ('0' <= *p && *p <= '9') {
 			token->kind = C_TOKEN_NUMBER;
 			if (*p++ == '0' && *p == 'x') {
@@ -2527,13 +2852,17 @@ out:
 static struct drgn_error *c_family_bit_offset(struct drgn_program *prog,
 					      struct drgn_type *type,
 					      const char *member_designator,
-					      uint64_t *ret)
+					      struct drgn_qualified_type *member_type_ret,
+					      uint64_t *bit_field_size_ret,
+					      uint64_t *bit_offset_ret)
 {
 	struct drgn_error *err;
 	struct drgn_c_family_lexer c_family_lexer;
 	struct drgn_lexer *lexer = &c_family_lexer.lexer;
 	int state = INT_MIN;
 	uint64_t bit_offset = 0;
+	struct drgn_qualified_type member_type = { type };
+	uint64_t bit_field_size = 0;
 
 	c_family_lexer.cpp = prog->lang == &drgn_language_cpp;
 	drgn_lexer_init(lexer, drgn_c_family_lexer_func, member_designator);
@@ -2565,9 +2894,8 @@ static struct drgn_error *c_family_bit_offset(struct drgn_program *prog,
 								"offset is too large");
 					goto out;
 				}
-				struct drgn_qualified_type member_type;
 				err = drgn_member_type(member, &member_type,
-						       NULL);
+						       &bit_field_size);
 				if (err)
 					goto out;
 				type = member_type.type;
@@ -2585,7 +2913,11 @@ static struct drgn_error *c_family_bit_offset(struct drgn_program *prog,
 		case C_TOKEN_RBRACKET:
 			switch (token.kind) {
 			case C_TOKEN_EOF:
-				*ret = bit_offset;
+				if (member_type_ret)
+					*member_type_ret = member_type;
+				if (bit_field_size_ret)
+					*bit_field_size_ret = bit_field_size;
+				*bit_offset_ret = bit_offset;
 				err = NULL;
 				goto out;
 			case C_TOKEN_DOT:
@@ -2606,7 +2938,6 @@ static struct drgn_error *c_family_bit_offset(struct drgn_program *prog,
 		case C_TOKEN_LBRACKET:
 			if (token.kind == C_TOKEN_NUMBER) {
 				struct drgn_type *underlying_type;
-				struct drgn_type *element_type;
 				uint64_t index, bit_size, element_offset;
 
 				err = c_token_to_u64(&token, &index);
@@ -2619,9 +2950,9 @@ static struct drgn_error *c_family_bit_offset(struct drgn_program *prog,
 							      type);
 					goto out;
 				}
-				element_type =
-					drgn_type_type(underlying_type).type;
-				err = drgn_type_bit_size(element_type,
+				member_type = drgn_type_type(underlying_type);
+				bit_field_size = 0;
+				err = drgn_type_bit_size(member_type.type,
 							 &bit_size);
 				if (err)
 					goto out;
@@ -2634,7 +2965,7 @@ static struct drgn_error *c_family_bit_offset(struct drgn_program *prog,
 								"offset is too large");
 					goto out;
 				}
-				type = element_type;
+				type = member_type.type;
 			} else {
 				err = drgn_error_create(DRGN_ERROR_SYNTAX,
 							"expected number after '['");
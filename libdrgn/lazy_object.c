@@ -2,29 +2,59 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include <assert.h>
+#include <pthread.h>
 
 #include "lazy_object.h"
+#include "program.h"
 
 static_assert(offsetof(union drgn_lazy_object, obj.type) ==
 	      offsetof(union drgn_lazy_object, thunk.dummy_type),
 	      "drgn_lazy_object layout is invalid");
 
+/*
+ * Lazy objects may be evaluated by multiple threads. Evaluation is done with
+ * the program lock held, but the program is stored in the thunk, which is
+ * overwritten by the evaluated object. This lock protects reading the thunk
+ * against the evaluated object being stored. It is never held while acquiring
+ * another lock.
+ */
+static pthread_mutex_t drgn_lazy_object_lock = PTHREAD_MUTEX_INITIALIZER;
+
 struct drgn_error *drgn_lazy_object_evaluate(union drgn_lazy_object *lazy_obj)
 {
-	struct drgn_error *err;
+	/* The type is stored last, so the object is complete if it is set. */
+	if (__atomic_load_n(&lazy_obj->obj.type, __ATOMIC_ACQUIRE))
+		return NULL;
+
+	pthread_mutex_lock(&drgn_lazy_object_lock);
+	bool evaluated = drgn_lazy_object_is_evaluated(lazy_obj);
+	struct drgn_program *prog = lazy_obj->thunk.prog;
+	pthread_mutex_unlock(&drgn_lazy_object_lock);
+	if (evaluated)
+		return NULL;
+
+	struct drgn_error *err = NULL;
+	drgn_program_lock(prog);
+	/* Another thread may have evaluated the object in the meantime. */
 	if (!drgn_lazy_object_is_evaluated(lazy_obj)) {
-		struct drgn_program *prog = lazy_obj->thunk.prog;
-		drgn_object_thunk_fn *fn = lazy_obj->thunk.fn;
-		void *arg = lazy_obj->thunk.arg;
-		drgn_object_init(&lazy_obj->obj, prog);
-		err = fn(&lazy_obj->obj, arg);
+		struct drgn_object obj;
+		drgn_object_init(&obj, prog);
+		err = lazy_obj->thunk.fn(&obj, lazy_obj->thunk.arg);
 		if (err) {
-			/* Oops, revert back to a thunk so it can be retried. */
-			drgn_lazy_object_init_thunk(lazy_obj, prog, fn, arg);
-			return err;
+			/* Leave the thunk in place so it can be retried. */
+			drgn_object_deinit(&obj);
+		} else {
+			struct drgn_type *type = obj.type;
+			obj.type = NULL;
+			pthread_mutex_lock(&drgn_lazy_object_lock);
+			lazy_obj->obj = obj;
+			__atomic_store_n(&lazy_obj->obj.type, type,
+					 __ATOMIC_RELEASE);
+			pthread_mutex_unlock(&drgn_lazy_object_lock);
 		}
 	}
-	return NULL;
+	drgn_program_unlock(prog);
+	return err;
 }
 
 void drgn_lazy_object_deinit(union drgn_lazy_object *lazy_obj)
@@ -23,6 +23,7 @@
 #include "error.h"
 #include "hash_table.h"
 #include "helpers.h"
+#include "kallsyms.h"
 #include "linux_kernel.h"
 #include "platform.h"
 #include "program.h"
@@ -79,6 +80,9 @@ struct drgn_error *parse_vmcoreinfo(const char *desc, size_t descsz,
 	ret->page_size = 0;
 	ret->kaslr_offset = 0;
 	ret->pgtable_l5_enabled = false;
+	ret->va_bits = 0;
+	ret->phys_base = 0;
+	ret->kernel_image_size = 0;
 	while (line < end) {
 		const char *newline;
 
@@ -115,6 +119,19 @@ struct drgn_error *parse_vmcoreinfo(const char *desc, size_t descsz,
 			if (err)
 				return err;
 			ret->pgtable_l5_enabled = tmp;
+		} else if (linematch(&line, "NUMBER(VA_BITS)=")) {
+			err = line_to_u64(line, newline, 0, &ret->va_bits);
+			if (err)
+				return err;
+		} else if (linematch(&line, "NUMBER(phys_base)=")) {
+			err = line_to_u64(line, newline, 0, &ret->phys_base);
+			if (err)
+				return err;
+		} else if (linematch(&line, "NUMBER(KERNEL_IMAGE_SIZE)=")) {
+			err = line_to_u64(line, newline, 0,
+					  &ret->kernel_image_size);
+			if (err)
+				return err;
 		}
 		line = newline + 1;
 	}
@@ -130,62 +147,28 @@ struct drgn_error *parse_vmcoreinfo(const char *desc, size_t descsz,
 		return drgn_error_create(DRGN_ERROR_OTHER,
 					 "VMCOREINFO does not contain valid swapper_pg_dir");
 	}
-	/* KERNELOFFSET and pgtable_l5_enabled are optional. */
+	/*
+	 * KERNELOFFSET, pgtable_l5_enabled, VA_BITS, phys_base, and
+	 * KERNEL_IMAGE_SIZE are optional.
+	 */
 	return NULL;
 }
 
-struct drgn_error *proc_kallsyms_symbol_addr(const char *name,
+struct drgn_error *proc_kallsyms_symbol_addr(struct drgn_program *prog,
+					     const char *name,
 					     unsigned long *ret)
 {
 	struct drgn_error *err;
-	FILE *file;
-	char *line = NULL;
-	size_t n = 0;
-
-	file = fopen("/proc/kallsyms", "r");
-	if (!file)
-		return drgn_error_create_os("fopen", errno, "/proc/kallsyms");
-
-	for (;;) {
-		char *addr_str, *sym_str, *saveptr, *end;
-
-		errno = 0;
-		if (getline(&line, &n, file) == -1) {
-			if (errno) {
-				err = drgn_error_create_os("getline", errno,
-							   "/proc/kallsyms");
-			} else {
-				err = &drgn_not_found;
-			}
-			break;
-		}
-
-		addr_str = strtok_r(line, "\t ", &saveptr);
-		if (!addr_str || !*addr_str)
-			goto invalid;
-		if (!strtok_r(NULL, "\t ", &saveptr))
-			goto invalid;
-		sym_str = strtok_r(NULL, "\t\n ", &saveptr);
-		if (!sym_str)
-			goto invalid;
-
-		if (strcmp(sym_str, name) != 0)
-			continue;
-
-		errno = 0;
-		*ret = strtoul(line, &end, 16);
-		if (errno || *end) {
-invalid:
-			err = drgn_error_create(DRGN_ERROR_OTHER,
-						"could not parse /proc/kallsyms");
-			break;
-		}
-		err = NULL;
-		break;
-	}
-	free(line);
-	fclose(file);
-	return err;
+	struct drgn_kallsyms *kallsyms;
+	err = drgn_program_kallsyms(prog, &kallsyms);
+	if (err)
+		return err;
+	const struct drgn_kallsyms_symbol *sym =
+		drgn_kallsyms_find_by_name(kallsyms, name);
+	if (!sym)
+		return &drgn_not_found;
+	*ret = sym->address;
+	return NULL;
 }
 
 /*
@@ -339,7 +322,445 @@ static struct drgn_error *linux_kernel_get_vmemmap(struct drgn_program *prog,
 
 #include "linux_kernel_object_find.inc"
 
+/* Section of a loaded kernel module. */
+struct kernel_module_section {
+	char *name;
+	uint64_t address;
+};
+
+/* Loaded kernel module found by walking the module list in memory. */
+struct cached_kernel_module {
+	/* Address of the struct module. */
+	uint64_t address;
+	char *name;
+	uint64_t start, end;
+	/* mod->sect_attrs. */
+	uint64_t sect_attrs;
+	/* GNU build ID. This is only valid if build_id_cached is true. */
+	void *build_id;
+	size_t build_id_len;
+	bool build_id_cached;
+	/* Section addresses. These are only valid if sections_cached is true. */
+	struct kernel_module_section *sections;
+	size_t num_sections;
+	bool sections_cached;
+	/* File found for the module at the standard locations, or NULL. */
+	char *path;
+};
+
+DEFINE_VECTOR(cached_kernel_module_vector, struct cached_kernel_module)
+
+/*
+ * Loaded kernel modules of a program. The module list is only walked once, and
+ * the build ID and section addresses of each module are read the first time
+ * that they are needed, so loading more debugging information later doesn't
+ * have to read them again.
+ */
+struct kernel_module_cache {
+	struct cached_kernel_module_vector modules;
+	/* Whether the whole module list has been walked. */
+	bool complete;
+	/*
+	 * vmlinux file found at the standard locations and its build ID, or
+	 * NULL.
+	 */
+	char *vmlinux_path;
+	void *vmlinux_build_id;
+	size_t vmlinux_build_id_len;
+	/* Whether anything changed since the checkpoint was read or written. */
+	bool dirty;
+};
+
+static void cached_kernel_module_deinit(struct cached_kernel_module *kmod)
+{
+	free(kmod->path);
+	for (size_t i = 0; i < kmod->num_sections; i++)
+		free(kmod->sections[i].name);
+	free(kmod->sections);
+	free(kmod->build_id);
+	free(kmod->name);
+}
+
+static void kernel_module_cache_clear(struct kernel_module_cache *cache)
+{
+	for (size_t i = 0; i < cache->modules.size; i++)
+		cached_kernel_module_deinit(&cache->modules.data[i]);
+	cache->modules.size = 0;
+	cache->complete = false;
+}
+
+void kernel_module_cache_destroy(struct kernel_module_cache *cache)
+{
+	if (!cache)
+		return;
+	kernel_module_cache_clear(cache);
+	cached_kernel_module_vector_deinit(&cache->modules);
+	free(cache->vmlinux_build_id);
+	free(cache->vmlinux_path);
+	free(cache);
+}
+
+/*
+ * A checkpoint saves the kernel module cache of a core dump along with the
+ * files that were found for vmlinux and the loaded kernel modules at the
+ * standard locations. Opening the same core dump again then doesn't need to
+ * walk the module list, read build IDs and section addresses from memory, or
+ * search for files. Checkpoints are enabled by DRGN_CORE_DUMP_CHECKPOINT and
+ * saved next to the core dump.
+ *
+ * A checkpoint file consists of a struct linux_kernel_checkpoint_header,
+ * followed by the vmlinux path and build ID, followed by each cached module in
+ * the order that it is loaded. Integers are 64 bits, and strings and byte
+ * arrays are a 64-bit length followed by the bytes without a null terminator.
+ * A module consists of its address, start address, end address, and
+ * mod->sect_attrs; its name; whether its build ID is cached, followed by the
+ * build ID if so; whether its sections are cached, followed by the number of
+ * sections and the address and name of each section if so; and its path
+ * (empty if unknown). Everything is in host byte order; like the DWARF index
+ * cache, checkpoints are only meant to be reused on the same machine.
+ */
+
+static const char linux_kernel_checkpoint_magic[8] = "DRGNCKPT";
+
+/* This must be incremented whenever the file format changes. */
+static const uint32_t LINUX_KERNEL_CHECKPOINT_VERSION = 1;
+
+struct linux_kernel_checkpoint_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t reserved;
+	/*
+	 * Identity of the core dump that the checkpoint was saved for. This
+	 * guards against reusing a checkpoint after the core dump is replaced.
+	 */
+	uint64_t core_size;
+	int64_t core_mtime_sec;
+	int64_t core_mtime_nsec;
+	uint64_t kaslr_offset;
+	char osrelease[128];
+	uint64_t num_modules;
+};
+
+static bool checkpoint_header_init(struct drgn_program *prog,
+				   struct linux_kernel_checkpoint_header *header)
+{
+	struct stat st;
+	if (fstat(prog->core_fd, &st) < 0)
+		return false;
+	/* Zero the header so that we can compare it with memcmp(). */
+	memset(header, 0, sizeof(*header));
+	memcpy(header->magic, linux_kernel_checkpoint_magic,
+	       sizeof(header->magic));
+	header->version = LINUX_KERNEL_CHECKPOINT_VERSION;
+	header->core_size = st.st_size;
+	header->core_mtime_sec = st.st_mtim.tv_sec;
+	header->core_mtime_nsec = st.st_mtim.tv_nsec;
+	header->kaslr_offset = prog->vmcoreinfo.kaslr_offset;
+	/* The header was zeroed, so this is null-terminated. */
+	memcpy(header->osrelease, prog->vmcoreinfo.osrelease,
+	       strnlen(prog->vmcoreinfo.osrelease,
+		       sizeof(header->osrelease) - 1));
+	return true;
+}
+
+struct checkpoint_reader {
+	const char *pos;
+	const char *end;
+};
+
+static bool checkpoint_read_u64(struct checkpoint_reader *reader,
+				uint64_t *ret)
+{
+	if (reader->end - reader->pos < sizeof(*ret))
+		return false;
+	memcpy(ret, reader->pos, sizeof(*ret));
+	reader->pos += sizeof(*ret);
+	return true;
+}
+
+/* Read a byte array into a new buffer, or NULL if it is empty. */
+static bool checkpoint_read_bytes(struct checkpoint_reader *reader,
+				  void **ret, size_t *len_ret)
+{
+	uint64_t len;
+	if (!checkpoint_read_u64(reader, &len) ||
+	    len > reader->end - reader->pos)
+		return false;
+	void *buf = NULL;
+	if (len) {
+		buf = memdup(reader->pos, len);
+		if (!buf)
+			return false;
+	}
+	reader->pos += len;
+	*ret = buf;
+	*len_ret = len;
+	return true;
+}
+
+/* Read a string into a new buffer, or NULL if it is empty. */
+static bool checkpoint_read_string(struct checkpoint_reader *reader,
+				   char **ret)
+{
+	uint64_t len;
+	if (!checkpoint_read_u64(reader, &len) ||
+	    len > reader->end - reader->pos)
+		return false;
+	char *str = NULL;
+	if (len) {
+		str = strndup(reader->pos, len);
+		if (!str)
+			return false;
+	}
+	reader->pos += len;
+	*ret = str;
+	return true;
+}
+
+static bool checkpoint_read_module(struct checkpoint_reader *reader,
+				   struct cached_kernel_module *kmod)
+{
+	uint64_t build_id_cached, sections_cached;
+	if (!checkpoint_read_u64(reader, &kmod->address) ||
+	    !checkpoint_read_u64(reader, &kmod->start) ||
+	    !checkpoint_read_u64(reader, &kmod->end) ||
+	    !checkpoint_read_u64(reader, &kmod->sect_attrs) ||
+	    !checkpoint_read_string(reader, &kmod->name) || !kmod->name ||
+	    !checkpoint_read_u64(reader, &build_id_cached))
+		return false;
+	if (build_id_cached) {
+		if (!checkpoint_read_bytes(reader, &kmod->build_id,
+					   &kmod->build_id_len))
+			return false;
+		kmod->build_id_cached = true;
+	}
+
+	if (!checkpoint_read_u64(reader, &sections_cached))
+		return false;
+	if (sections_cached) {
+		uint64_t num_sections;
+		/* Each section is at least an address and a length. */
+		if (!checkpoint_read_u64(reader, &num_sections) ||
+		    num_sections > (reader->end - reader->pos) / 16)
+			return false;
+		kmod->sections = malloc_array(num_sections,
+					      sizeof(kmod->sections[0]));
+		if (!kmod->sections && num_sections)
+			return false;
+		while (kmod->num_sections < num_sections) {
+			struct kernel_module_section *section =
+				&kmod->sections[kmod->num_sections];
+			if (!checkpoint_read_u64(reader, &section->address) ||
+			    !checkpoint_read_string(reader, &section->name))
+				return false;
+			kmod->num_sections++;
+			if (!section->name)
+				return false;
+		}
+		kmod->sections_cached = true;
+	}
+	return checkpoint_read_string(reader, &kmod->path);
+}
+
+/*
+ * Fill in an empty kernel module cache from the checkpoint if there is a valid
+ * one. Any failure just means that the cache starts empty.
+ */
+static void linux_kernel_checkpoint_read(struct drgn_program *prog,
+					 struct kernel_module_cache *cache)
+{
+	int fd = open(prog->checkpoint_path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return;
+
+	struct stat st;
+	if (fstat(fd, &st) < 0 ||
+	    st.st_size < sizeof(struct linux_kernel_checkpoint_header))
+		goto out_fd;
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED)
+		goto out_fd;
+
+	struct linux_kernel_checkpoint_header header, expected;
+	memcpy(&header, map, sizeof(header));
+	if (!checkpoint_header_init(prog, &expected))
+		goto out_map;
+	expected.num_modules = header.num_modules;
+	if (memcmp(&header, &expected, sizeof(header)) != 0)
+		goto out_map;
+
+	struct checkpoint_reader reader = {
+		(const char *)map + sizeof(header),
+		(const char *)map + st.st_size,
+	};
+	struct kernel_module_cache tmp = { .modules = VECTOR_INIT };
+	if (!checkpoint_read_string(&reader, &tmp.vmlinux_path) ||
+	    !checkpoint_read_bytes(&reader, &tmp.vmlinux_build_id,
+				   &tmp.vmlinux_build_id_len))
+		goto out_tmp;
+	for (uint64_t i = 0; i < header.num_modules; i++) {
+		struct cached_kernel_module *kmod =
+			cached_kernel_module_vector_append_entry(&tmp.modules);
+		if (!kmod)
+			goto out_tmp;
+		memset(kmod, 0, sizeof(*kmod));
+		if (!checkpoint_read_module(&reader, kmod))
+			goto out_tmp;
+	}
+	if (reader.pos != reader.end)
+		goto out_tmp;
+
+	tmp.complete = true;
+	*cache = tmp;
+	goto out_map;
+
+out_tmp:
+	kernel_module_cache_clear(&tmp);
+	cached_kernel_module_vector_deinit(&tmp.modules);
+	free(tmp.vmlinux_build_id);
+	free(tmp.vmlinux_path);
+out_map:
+	munmap(map, st.st_size);
+out_fd:
+	close(fd);
+}
+
+static bool checkpoint_write_u64(FILE *file, uint64_t value)
+{
+	return fwrite(&value, sizeof(value), 1, file) == 1;
+}
+
+static bool checkpoint_write_bytes(FILE *file, const void *buf, size_t len)
+{
+	return (checkpoint_write_u64(file, len) &&
+		(!len || fwrite(buf, len, 1, file) == 1));
+}
+
+static bool checkpoint_write_string(FILE *file, const char *str)
+{
+	return checkpoint_write_bytes(file, str, str ? strlen(str) : 0);
+}
+
+static bool checkpoint_write_module(FILE *file,
+				    const struct cached_kernel_module *kmod)
+{
+	if (!checkpoint_write_u64(file, kmod->address) ||
+	    !checkpoint_write_u64(file, kmod->start) ||
+	    !checkpoint_write_u64(file, kmod->end) ||
+	    !checkpoint_write_u64(file, kmod->sect_attrs) ||
+	    !checkpoint_write_string(file, kmod->name) ||
+	    !checkpoint_write_u64(file, kmod->build_id_cached))
+		return false;
+	if (kmod->build_id_cached &&
+	    !checkpoint_write_bytes(file, kmod->build_id, kmod->build_id_len))
+		return false;
+	if (!checkpoint_write_u64(file, kmod->sections_cached))
+		return false;
+	if (kmod->sections_cached) {
+		if (!checkpoint_write_u64(file, kmod->num_sections))
+			return false;
+		for (size_t i = 0; i < kmod->num_sections; i++) {
+			if (!checkpoint_write_u64(file,
+						  kmod->sections[i].address) ||
+			    !checkpoint_write_string(file,
+						     kmod->sections[i].name))
+				return false;
+		}
+	}
+	return checkpoint_write_string(file, kmod->path);
+}
+
+/*
+ * Save the kernel module cache to the checkpoint if it changed. Like reading,
+ * this is best effort: the core dump may well be in a read-only directory.
+ */
+static void linux_kernel_checkpoint_write(struct drgn_program *prog)
+{
+	struct kernel_module_cache *cache = prog->kernel_module_cache;
+	if (!prog->checkpoint_path || !cache || !cache->complete ||
+	    !cache->dirty)
+		return;
+
+	struct linux_kernel_checkpoint_header header;
+	if (!checkpoint_header_init(prog, &header))
+		return;
+	header.num_modules = cache->modules.size;
+
+	char *tmp_path;
+	if (asprintf(&tmp_path, "%s.XXXXXX", prog->checkpoint_path) == -1)
+		return;
+	int fd = mkstemp(tmp_path);
+	if (fd < 0)
+		goto out;
+	FILE *file = fdopen(fd, "w");
+	if (!file) {
+		close(fd);
+		unlink(tmp_path);
+		goto out;
+	}
+	bool success =
+		(fwrite(&header, sizeof(header), 1, file) == 1 &&
+		 checkpoint_write_string(file, cache->vmlinux_path) &&
+		 checkpoint_write_bytes(file, cache->vmlinux_build_id,
+					cache->vmlinux_build_id_len));
+	for (size_t i = 0; success && i < cache->modules.size; i++)
+		success = checkpoint_write_module(file, &cache->modules.data[i]);
+	if (fclose(file) != 0 || !success ||
+	    rename(tmp_path, prog->checkpoint_path) < 0)
+		unlink(tmp_path);
+	else
+		cache->dirty = false;
+out:
+	free(tmp_path);
+}
+
+/*
+ * Get the kernel module cache of a core dump, filling it in from the checkpoint
+ * the first time if there is one.
+ */
+static struct kernel_module_cache *
+drgn_program_kernel_module_cache(struct drgn_program *prog)
+{
+	if (!prog->kernel_module_cache) {
+		prog->kernel_module_cache =
+			calloc(1, sizeof(*prog->kernel_module_cache));
+		if (prog->kernel_module_cache && prog->checkpoint_path) {
+			linux_kernel_checkpoint_read(prog,
+						     prog->kernel_module_cache);
+		}
+	}
+	return prog->kernel_module_cache;
+}
+
+/*
+ * Open a file saved in the checkpoint if it still exists and has the expected
+ * build ID. Otherwise, the caller searches for the file as usual.
+ */
+static bool open_checkpoint_file(const char *path, const void *build_id,
+				 size_t build_id_len, int *fd_ret,
+				 Elf **elf_ret)
+{
+	struct drgn_error *err = open_elf_file(path, fd_ret, elf_ret);
+	if (err) {
+		drgn_error_destroy(err);
+		return false;
+	}
+	const void *file_build_id;
+	ssize_t file_build_id_len = dwelf_elf_gnu_build_id(*elf_ret,
+							   &file_build_id);
+	if (file_build_id_len > 0 && file_build_id_len == build_id_len &&
+	    memcmp(file_build_id, build_id, build_id_len) == 0)
+		return true;
+	elf_end(*elf_ret);
+	close(*fd_ret);
+	return false;
+}
+
 struct kernel_module_iterator {
+	/*
+	 * Name of the current module. This is owned by the iterator if using
+	 * /proc/modules and by the module cache otherwise.
+	 */
 	char *name;
 	/* /proc/modules file or NULL. */
 	FILE *modules_file;
@@ -352,8 +773,34 @@ struct kernel_module_iterator {
 		/* If not using /proc/modules. */
 		struct {
 			struct drgn_qualified_type module_type;
-			struct drgn_object mod, node, tmp1, tmp2, tmp3;
+			/* Current module. */
+			struct drgn_object mod;
+			/*
+			 * Module cache of the program, or a temporary one for
+			 * the running kernel, whose modules can change.
+			 */
+			struct kernel_module_cache *cache;
+			bool owns_cache;
+			/* Index of the next module in the cache. */
+			size_t next_index;
+			/*
+			 * The rest are only used while walking the module
+			 * list to fill in the cache.
+			 */
+			bool little_endian;
 			uint64_t head;
+			/* Address of the next list node. */
+			uint64_t next;
+			/* Contents of the last struct module that was read. */
+			char *module_buf;
+			uint64_t module_size;
+			uint64_t list_offset;
+			uint64_t name_offset;
+			uint64_t name_size;
+			struct linux_helper_field list_next;
+			struct linux_helper_field base;
+			struct linux_helper_field size;
+			struct linux_helper_field sect_attrs;
 		};
 	};
 };
@@ -362,15 +809,93 @@ static void kernel_module_iterator_deinit(struct kernel_module_iterator *it)
 {
 	if (it->modules_file) {
 		fclose(it->modules_file);
+		free(it->name);
 	} else {
-		drgn_object_deinit(&it->tmp3);
-		drgn_object_deinit(&it->tmp2);
-		drgn_object_deinit(&it->tmp1);
-		drgn_object_deinit(&it->node);
+		free(it->module_buf);
+		if (it->owns_cache)
+			kernel_module_cache_destroy(it->cache);
 		drgn_object_deinit(&it->mod);
 	}
 	free(it->build_id_buf);
-	free(it->name);
+}
+
+/* Prepare to walk the module list in memory. */
+static struct drgn_error *
+kernel_module_iterator_init_walk(struct kernel_module_iterator *it)
+{
+	struct drgn_error *err;
+	struct drgn_program *prog = drgn_object_program(&it->mod);
+
+	err = drgn_program_is_little_endian(prog, &it->little_endian);
+	if (err)
+		return err;
+	struct drgn_type *module_type =
+		drgn_underlying_type(it->module_type.type);
+	err = drgn_type_sizeof(module_type, &it->module_size);
+	if (err)
+		return err;
+	err = drgn_type_offsetof(module_type, "list", &it->list_offset);
+	if (err)
+		return err;
+	err = linux_helper_field_init(&it->list_next, module_type, "list.next",
+				      true);
+	if (err)
+		return err;
+	err = linux_helper_field_init(&it->base, module_type,
+				      "core_layout.base", true);
+	if (!err) {
+		// Since Linux kernel commit 7523e4dc5057 ("module: use a
+		// structure to encapsulate layout.") (in v4.5), the base and
+		// size are in the `struct module_layout core_layout` member of
+		// `struct module`.
+		err = linux_helper_field_init(&it->size, module_type,
+					      "core_layout.size", true);
+	} else if (err->code == DRGN_ERROR_LOOKUP) {
+		// Before that, they are directly in the `struct module`.
+		drgn_error_destroy(err);
+		err = linux_helper_field_init(&it->base, module_type,
+					      "module_core", true);
+		if (!err) {
+			err = linux_helper_field_init(&it->size, module_type,
+						      "core_size", true);
+		}
+	}
+	if (err)
+		return err;
+	err = linux_helper_field_init(&it->sect_attrs, module_type,
+				      "sect_attrs", true);
+	if (err)
+		return err;
+	struct linux_helper_field name;
+	err = linux_helper_field_init(&name, module_type, "name", false);
+	if (err)
+		return err;
+	it->name_offset = name.bit_offset / 8;
+	it->name_size = name.bit_size / 8;
+
+	it->module_buf = malloc64(it->module_size);
+	if (!it->module_buf)
+		return &drgn_enomem;
+
+	struct drgn_object node;
+	drgn_object_init(&node, prog);
+	err = drgn_program_find_object(prog, "modules", NULL,
+				       DRGN_FIND_OBJECT_VARIABLE, &node);
+	if (err)
+		goto out;
+	if (node.kind != DRGN_OBJECT_REFERENCE) {
+		err = drgn_error_create(DRGN_ERROR_OTHER,
+					"modules is not a reference");
+		goto out;
+	}
+	it->head = node.address;
+	err = drgn_object_member(&node, &node, "next");
+	if (err)
+		goto out;
+	err = drgn_object_read_unsigned(&node, &it->next);
+out:
+	drgn_object_deinit(&node);
+	return err;
 }
 
 static struct drgn_error *
@@ -398,25 +923,27 @@ kernel_module_iterator_init(struct kernel_module_iterator *it,
 			return err;
 
 		drgn_object_init(&it->mod, prog);
-		drgn_object_init(&it->node, prog);
-		drgn_object_init(&it->tmp1, prog);
-		drgn_object_init(&it->tmp2, prog);
-		drgn_object_init(&it->tmp3, prog);
-
-		err = drgn_program_find_object(prog, "modules", NULL,
-					       DRGN_FIND_OBJECT_VARIABLE,
-					       &it->node);
-		if (err)
-			goto err;
-		err = drgn_object_address_of(&it->node, &it->node);
-		if (err)
-			goto err;
-		err = drgn_object_read(&it->node, &it->node);
-		if (err)
-			goto err;
-		err = drgn_object_read_unsigned(&it->node, &it->head);
-		if (err)
+		it->module_buf = NULL;
+		it->next_index = 0;
+		if (prog->flags & DRGN_PROGRAM_IS_LIVE) {
+			it->cache = calloc(1, sizeof(*it->cache));
+			it->owns_cache = true;
+		} else {
+			it->cache = drgn_program_kernel_module_cache(prog);
+			it->owns_cache = false;
+		}
+		if (!it->cache) {
+			err = &drgn_enomem;
 			goto err;
+		}
+
+		if (!it->cache->complete) {
+			/* Start over if a previous walk didn't finish. */
+			kernel_module_cache_clear(it->cache);
+			err = kernel_module_iterator_init_walk(it);
+			if (err)
+				goto err;
+		}
 	}
 
 	return NULL;
@@ -452,6 +979,58 @@ kernel_module_iterator_next_live(struct kernel_module_iterator *it)
 	return NULL;
 }
 
+/*
+ * Read the next struct module in the module list with one read and add it to
+ * the cache.
+ */
+static struct drgn_error *
+kernel_module_iterator_walk(struct kernel_module_iterator *it)
+{
+	struct drgn_error *err;
+
+	if (it->next == it->head) {
+		it->cache->complete = true;
+		it->cache->dirty = true;
+		return &drgn_stop;
+	}
+
+	uint64_t address = it->next - it->list_offset;
+	err = drgn_program_read_memory(drgn_object_program(&it->mod),
+				       it->module_buf, address,
+				       it->module_size, false);
+	if (err)
+		return err;
+	char *name = strndup(it->module_buf + it->name_offset, it->name_size);
+	if (!name)
+		return &drgn_enomem;
+	struct cached_kernel_module *kmod =
+		cached_kernel_module_vector_append_entry(&it->cache->modules);
+	if (!kmod) {
+		free(name);
+		return &drgn_enomem;
+	}
+	memset(kmod, 0, sizeof(*kmod));
+	kmod->address = address;
+	kmod->name = name;
+	kmod->start = linux_helper_field_read(&it->base, it->module_buf,
+					      it->little_endian);
+	kmod->end = kmod->start +
+		    linux_helper_field_read(&it->size, it->module_buf,
+					    it->little_endian);
+	kmod->sect_attrs = linux_helper_field_read(&it->sect_attrs,
+						   it->module_buf,
+						   it->little_endian);
+	it->next = linux_helper_field_read(&it->list_next, it->module_buf,
+					   it->little_endian);
+	return NULL;
+}
+
+static struct cached_kernel_module *
+kernel_module_iterator_current(struct kernel_module_iterator *it)
+{
+	return &it->cache->modules.data[it->next_index - 1];
+}
+
 /**
  * Get the the next loaded kernel module.
  *
@@ -471,71 +1050,20 @@ kernel_module_iterator_next(struct kernel_module_iterator *it)
 
 	struct drgn_error *err;
 
-	err = drgn_object_member_dereference(&it->node, &it->node, "next");
-	if (err)
-		return err;
-	err = drgn_object_read(&it->node, &it->node);
-	if (err)
-		return err;
-	uint64_t addr;
-	err = drgn_object_read_unsigned(&it->node, &addr);
-	if (err)
-		return err;
-	if (addr == it->head)
-		return &drgn_stop;
-
-	err = drgn_object_container_of(&it->mod, &it->node, it->module_type,
-				       "list");
-	if (err)
-		return err;
-
-	// Set tmp1 to the module base address and tmp2 to the size.
-	err = drgn_object_member_dereference(&it->tmp1, &it->mod,
-					     "core_layout");
-	if (!err) {
-		// Since Linux kernel commit 7523e4dc5057 ("module: use a
-		// structure to encapsulate layout.") (in v4.5), the base and
-		// size are in the `struct module_layout core_layout` member of
-		// `struct module`.
-		err = drgn_object_member(&it->tmp2, &it->tmp1, "size");
-		if (err)
-			return err;
-		err = drgn_object_member(&it->tmp1, &it->tmp1, "base");
-		if (err)
-			return err;
-	} else if (err->code == DRGN_ERROR_LOOKUP) {
-		// Before that, they are directly in the `struct module`.
-		drgn_error_destroy(err);
-
-		err = drgn_object_member_dereference(&it->tmp2, &it->mod,
-						     "core_size");
-		if (err)
-			return err;
-		err = drgn_object_member_dereference(&it->tmp1, &it->mod,
-						     "module_core");
+	if (it->next_index >= it->cache->modules.size) {
+		if (it->cache->complete)
+			return &drgn_stop;
+		err = kernel_module_iterator_walk(it);
 		if (err)
 			return err;
-	} else {
-		return err;
 	}
-	err = drgn_object_read_unsigned(&it->tmp1, &it->start);
-	if (err)
-		return err;
-	err = drgn_object_read_unsigned(&it->tmp2, &it->end);
-	if (err)
-		return err;
-	it->end += it->start;
-
-	err = drgn_object_member_dereference(&it->tmp2, &it->mod, "name");
-	if (err)
-		return err;
-	char *name;
-	err = drgn_object_read_c_string(&it->tmp2, &name);
-	if (err)
-		return err;
-	free(it->name);
-	it->name = name;
-	return NULL;
+	struct cached_kernel_module *kmod =
+		&it->cache->modules.data[it->next_index++];
+	it->name = kmod->name;
+	it->start = kmod->start;
+	it->end = kmod->end;
+	return drgn_object_set_reference(&it->mod, it->module_type,
+					 kmod->address, 0, 0);
 }
 
 static size_t parse_gnu_build_id_from_note(const void *note, size_t note_size,
@@ -673,16 +1201,10 @@ out_path:
 }
 
 static struct drgn_error *
-kernel_module_iterator_gnu_build_id(struct kernel_module_iterator *it,
-				    const void **build_id_ret,
-				    size_t *build_id_len_ret)
+kernel_module_iterator_read_gnu_build_id(struct kernel_module_iterator *it,
+					 const void **build_id_ret,
+					 size_t *build_id_len_ret)
 {
-	if (it->modules_file) {
-		return kernel_module_iterator_gnu_build_id_live(it,
-								build_id_ret,
-								build_id_len_ret);
-	}
-
 	struct drgn_error *err;
 	struct drgn_program *prog = drgn_object_program(&it->mod);
 	const bool bswap =
@@ -765,16 +1287,178 @@ out:
 	return err;
 }
 
+static struct drgn_error *
+kernel_module_iterator_gnu_build_id(struct kernel_module_iterator *it,
+				    const void **build_id_ret,
+				    size_t *build_id_len_ret)
+{
+	if (it->modules_file) {
+		return kernel_module_iterator_gnu_build_id_live(it,
+								build_id_ret,
+								build_id_len_ret);
+	}
+
+	struct cached_kernel_module *kmod = kernel_module_iterator_current(it);
+	if (!kmod->build_id_cached) {
+		struct drgn_error *err;
+		const void *build_id;
+		size_t build_id_len;
+		err = kernel_module_iterator_read_gnu_build_id(it, &build_id,
+							       &build_id_len);
+		if (err)
+			return err;
+		if (build_id_len) {
+			kmod->build_id = memdup(build_id, build_id_len);
+			if (!kmod->build_id)
+				return &drgn_enomem;
+		}
+		kmod->build_id_len = build_id_len;
+		kmod->build_id_cached = true;
+		it->cache->dirty = true;
+	}
+	*build_id_ret = kmod->build_id;
+	*build_id_len_ret = kmod->build_id_len;
+	return NULL;
+}
+
 struct kernel_module_section_iterator {
 	struct kernel_module_iterator *kmod_it;
 	/* /sys/module/$module/sections directory or NULL. */
 	DIR *sections_dir;
 	/* If not using /sys/module/$module/sections. */
-	uint64_t i;
-	uint64_t nsections;
-	char *name;
+	struct cached_kernel_module *kmod;
+	size_t i;
 };
 
+/*
+ * Read the section addresses of a kernel module from mod->sect_attrs, reading
+ * the whole array of section attributes at once.
+ */
+static struct drgn_error *
+cache_kernel_module_section_addresses(struct kernel_module_iterator *kmod_it,
+				      struct cached_kernel_module *kmod)
+{
+	struct drgn_error *err;
+	struct drgn_program *prog = drgn_object_program(&kmod_it->mod);
+
+	bool little_endian;
+	err = drgn_program_is_little_endian(prog, &little_endian);
+	if (err)
+		return err;
+
+	// struct module_sect_attrs
+	struct drgn_type *module_type =
+		drgn_underlying_type(kmod_it->module_type.type);
+	struct drgn_member_path path;
+	err = drgn_member_path_init(&path, module_type, "sect_attrs");
+	if (err)
+		return err;
+	struct drgn_type *attrs_type =
+		drgn_underlying_type(path.member_type.type);
+	if (drgn_type_kind(attrs_type) != DRGN_TYPE_POINTER) {
+		return drgn_type_error("struct module::sect_attrs has unexpected type '%s'",
+				       attrs_type);
+	}
+	attrs_type = drgn_underlying_type(drgn_type_type(attrs_type).type);
+	struct linux_helper_field nsections_field;
+	err = linux_helper_field_init(&nsections_field, attrs_type,
+				      "nsections", true);
+	if (err)
+		return err;
+	uint64_t attrs_offset;
+	err = drgn_type_offsetof(attrs_type, "attrs", &attrs_offset);
+	if (err)
+		return err;
+
+	// struct module_sect_attr
+	err = drgn_member_path_init(&path, attrs_type, "attrs");
+	if (err)
+		return err;
+	struct drgn_type *attr_type =
+		drgn_underlying_type(path.member_type.type);
+	if (drgn_type_kind(attr_type) != DRGN_TYPE_ARRAY) {
+		return drgn_type_error("struct module_sect_attrs::attrs has unexpected type '%s'",
+				       attr_type);
+	}
+	attr_type = drgn_underlying_type(drgn_type_type(attr_type).type);
+	uint64_t attr_size;
+	err = drgn_type_sizeof(attr_type, &attr_size);
+	if (err)
+		return err;
+	struct linux_helper_field address_field, name_field;
+	err = linux_helper_field_init(&address_field, attr_type, "address",
+				      true);
+	if (err)
+		return err;
+	/*
+	 * Since Linux kernel commit ed66f991bb19 ("module: Refactor section
+	 * attr into bin attribute") (in v5.8), the section name is
+	 * module_sect_attr.battr.attr.name. Before that, it is simply
+	 * module_sect_attr.name.
+	 */
+	err = linux_helper_field_init(&name_field, attr_type,
+				      "battr.attr.name", true);
+	if (err && err->code == DRGN_ERROR_LOOKUP) {
+		drgn_error_destroy(err);
+		err = linux_helper_field_init(&name_field, attr_type, "name",
+					      true);
+	}
+	if (err)
+		return err;
+
+	char *buf = malloc64(attrs_offset);
+	if (!buf)
+		return &drgn_enomem;
+	err = drgn_program_read_memory(prog, buf, kmod->sect_attrs,
+				       attrs_offset, false);
+	if (err)
+		goto out;
+	uint64_t nsections = linux_helper_field_read(&nsections_field, buf,
+						     little_endian);
+	free(buf);
+	buf = malloc_array(nsections, attr_size);
+	struct kernel_module_section *sections =
+		malloc_array(nsections, sizeof(*sections));
+	if ((!buf || !sections) && nsections) {
+		err = &drgn_enomem;
+		goto out_sections;
+	}
+	err = drgn_program_read_memory(prog, buf,
+				       kmod->sect_attrs + attrs_offset,
+				       nsections * attr_size, false);
+	if (err)
+		goto out_sections;
+	size_t i;
+	for (i = 0; i < nsections; i++) {
+		const char *attr = buf + i * attr_size;
+		sections[i].address = linux_helper_field_read(&address_field,
+							      attr,
+							      little_endian);
+		uint64_t name = linux_helper_field_read(&name_field, attr,
+							little_endian);
+		err = drgn_program_read_c_string(prog, name, false, SIZE_MAX,
+						 &sections[i].name);
+		if (err)
+			break;
+	}
+	if (err) {
+		while (i-- > 0)
+			free(sections[i].name);
+		goto out_sections;
+	}
+	kmod->sections = sections;
+	kmod->num_sections = nsections;
+	kmod->sections_cached = true;
+	kmod_it->cache->dirty = true;
+	goto out;
+
+out_sections:
+	free(sections);
+out:
+	free(buf);
+	return err;
+}
+
 static struct drgn_error *
 kernel_module_section_iterator_init(struct kernel_module_section_iterator *it,
 				    struct kernel_module_iterator *kmod_it)
@@ -783,6 +1467,7 @@ kernel_module_section_iterator_init(struct kernel_module_section_iterator *it,
 
 	it->kmod_it = kmod_it;
 	if (kmod_it->modules_file) {
+		it->kmod = NULL;
 		char *path;
 		if (asprintf(&path, "/sys/module/%s/sections",
 			     kmod_it->name) == -1)
@@ -797,26 +1482,15 @@ kernel_module_section_iterator_init(struct kernel_module_section_iterator *it,
 		return NULL;
 	} else {
 		it->sections_dir = NULL;
+		it->kmod = kernel_module_iterator_current(kmod_it);
 		it->i = 0;
-		it->name = NULL;
-		/* it->nsections = mod->sect_attrs->nsections */
-		err = drgn_object_member_dereference(&kmod_it->tmp1,
-						     &kmod_it->mod,
-						     "sect_attrs");
-		if (err)
-			return err;
-		err = drgn_object_member_dereference(&kmod_it->tmp2,
-						     &kmod_it->tmp1,
-						     "nsections");
-		if (err)
-			return err;
-		err = drgn_object_read_unsigned(&kmod_it->tmp2,
-						&it->nsections);
-		if (err)
-			return err;
-		/* kmod_it->tmp1 = mod->sect_attrs->attrs */
-		return drgn_object_member_dereference(&kmod_it->tmp1,
-						      &kmod_it->tmp1, "attrs");
+		if (!it->kmod->sections_cached) {
+			err = cache_kernel_module_section_addresses(kmod_it,
+								    it->kmod);
+			if (err)
+				return err;
+		}
+		return NULL;
 	}
 }
 
@@ -825,8 +1499,6 @@ kernel_module_section_iterator_deinit(struct kernel_module_section_iterator *it)
 {
 	if (it->sections_dir)
 		closedir(it->sections_dir);
-	else
-		free(it->name);
 }
 
 static struct drgn_error *
@@ -894,46 +1566,11 @@ kernel_module_section_iterator_next(struct kernel_module_section_iterator *it,
 								address_ret);
 	}
 
-	struct drgn_error *err;
-	struct kernel_module_iterator *kmod_it = it->kmod_it;
-
-	if (it->i >= it->nsections)
+	if (it->i >= it->kmod->num_sections)
 		return &drgn_stop;
-	err = drgn_object_subscript(&kmod_it->tmp2, &kmod_it->tmp1, it->i++);
-	if (err)
-		return err;
-	err = drgn_object_member(&kmod_it->tmp3, &kmod_it->tmp2, "address");
-	if (err)
-		return err;
-	err = drgn_object_read_unsigned(&kmod_it->tmp3, address_ret);
-	if (err)
-		return err;
-	/*
-	 * Since Linux kernel commit ed66f991bb19 ("module: Refactor section
-	 * attr into bin attribute") (in v5.8), the section name is
-	 * module_sect_attr.battr.attr.name. Before that, it is simply
-	 * module_sect_attr.name.
-	 */
-	err = drgn_object_member(&kmod_it->tmp2, &kmod_it->tmp2, "battr");
-	if (!err) {
-		err = drgn_object_member(&kmod_it->tmp2, &kmod_it->tmp2,
-					 "attr");
-		if (err)
-			return err;
-	} else {
-		if (err->code != DRGN_ERROR_LOOKUP)
-			return err;
-		drgn_error_destroy(err);
-	}
-	err = drgn_object_member(&kmod_it->tmp3, &kmod_it->tmp2, "name");
-	if (err)
-		return err;
-	char *name;
-	err = drgn_object_read_c_string(&kmod_it->tmp3, &name);
-	if (err)
-		return err;
-	free(it->name);
-	*name_ret = it->name = name;
+	*name_ret = it->kmod->sections[it->i].name;
+	*address_ret = it->kmod->sections[it->i].address;
+	it->i++;
 	return NULL;
 }
 
@@ -953,6 +1590,10 @@ kernel_module_section_iterator_next(struct kernel_module_section_iterator *it,
 struct depmod_index {
 	void *addr;
 	size_t len;
+	/* Identity of the mapped file, to notice when depmod replaces it. */
+	dev_t dev;
+	ino_t ino;
+	struct timespec mtime;
 	char path[256];
 };
 
@@ -961,6 +1602,15 @@ static void depmod_index_deinit(struct depmod_index *depmod)
 	munmap(depmod->addr, depmod->len);
 }
 
+void depmod_index_destroy(struct depmod_index *depmod)
+{
+	if (!depmod)
+		return;
+	if (depmod->addr)
+		depmod_index_deinit(depmod);
+	free(depmod);
+}
+
 struct depmod_index_buffer {
 	struct binary_buffer bb;
 	struct depmod_index *depmod;
@@ -1040,6 +1690,9 @@ static struct drgn_error *depmod_index_init(struct depmod_index *depmod,
 
 	depmod->addr = addr;
 	depmod->len = st.st_size;
+	depmod->dev = st.st_dev;
+	depmod->ino = st.st_ino;
+	depmod->mtime = st.st_mtim;
 
 	err = depmod_index_validate(depmod);
 	if (err)
@@ -1150,6 +1803,42 @@ not_found:
 	return NULL;
 }
 
+/*
+ * Get the depmod index of the program. It stays mapped between calls to
+ * linux_kernel_report_debug_info(), but it is mapped again if depmod replaced
+ * the file since then (e.g., because a module was installed).
+ */
+static struct drgn_error *
+drgn_program_depmod_index(struct drgn_program *prog, struct depmod_index **ret)
+{
+	struct drgn_error *err;
+
+	struct depmod_index *depmod = prog->depmod_index;
+	if (depmod) {
+		struct stat st;
+		if (stat(depmod->path, &st) == 0 &&
+		    st.st_dev == depmod->dev && st.st_ino == depmod->ino &&
+		    st.st_mtim.tv_sec == depmod->mtime.tv_sec &&
+		    st.st_mtim.tv_nsec == depmod->mtime.tv_nsec) {
+			*ret = depmod;
+			return NULL;
+		}
+		depmod_index_destroy(depmod);
+		prog->depmod_index = NULL;
+	}
+
+	depmod = malloc(sizeof(*depmod));
+	if (!depmod)
+		return &drgn_enomem;
+	err = depmod_index_init(depmod, prog->vmcoreinfo.osrelease);
+	if (err) {
+		free(depmod);
+		return err;
+	}
+	prog->depmod_index = *ret = depmod;
+	return NULL;
+}
+
 /*
  * Identify an ELF file as a kernel module, vmlinux, or neither. We classify a
  * file as a kernel module if it has a section named .gnu.linkonce.this_module.
@@ -1265,6 +1954,51 @@ out_scn_map:
 	return err;
 }
 
+/*
+ * If we're debugging the running kernel, we can get the loaded kernel modules
+ * from /proc and /sys instead of from the core dump. This fast path can be
+ * disabled via an environment variable for testing.
+ */
+static bool use_proc_and_sys_modules(struct drgn_program *prog)
+{
+	if (!(prog->flags & DRGN_PROGRAM_IS_LIVE))
+		return false;
+	char *env = getenv("DRGN_USE_PROC_AND_SYS_MODULES");
+	return !env || atoi(env);
+}
+
+struct drgn_error *
+linux_kernel_cache_fetched_module_sections(struct drgn_program *prog,
+					   const char *name, Elf *elf)
+{
+	struct drgn_error *err;
+
+	/* Only kernel modules need their section addresses set. */
+	GElf_Ehdr ehdr_mem, *ehdr = gelf_getehdr(elf, &ehdr_mem);
+	if (!ehdr)
+		return drgn_error_libelf();
+	if (ehdr->e_type != ET_REL)
+		return NULL;
+
+	struct kernel_module_iterator kmod_it;
+	err = kernel_module_iterator_init(&kmod_it, prog,
+					  use_proc_and_sys_modules(prog));
+	if (err)
+		return err;
+	while (!(err = kernel_module_iterator_next(&kmod_it))) {
+		if (strcmp(kmod_it.name, name) == 0) {
+			err = cache_kernel_module_sections(&kmod_it, elf);
+			break;
+		}
+	}
+	if (err == &drgn_stop) {
+		err = drgn_error_format(DRGN_ERROR_LOOKUP,
+					"kernel module %s is not loaded", name);
+	}
+	kernel_module_iterator_deinit(&kmod_it);
+	return err;
+}
+
 struct kernel_module_file {
 	const char *path;
 	int fd;
@@ -1342,10 +2076,51 @@ next:
 	return NULL;
 }
 
+/* Loaded kernel module to look for at the standard locations. */
+struct default_kernel_module {
+	char *name;
+	/*
+	 * Path from depmod, relative to /lib/modules/$(uname -r). This is
+	 * @em not null-terminated.
+	 */
+	const char *depmod_path;
+	size_t depmod_path_len;
+	/*
+	 * File saved in the checkpoint, which is tried first, and the build ID
+	 * that it must have, or NULL. These are owned by the module cache.
+	 */
+	const char *checkpoint_path;
+	const void *build_id;
+	size_t build_id_len;
+	/* Result of find_default_kernel_module(). */
+	struct drgn_error *err;
+	char *path;
+	int fd;
+	Elf *elf;
+};
+
+DEFINE_VECTOR(default_kernel_module_vector, struct default_kernel_module)
+DEFINE_HASH_MAP(default_kernel_module_map, const char *, size_t,
+		c_string_key_hash_pair, c_string_key_eq)
+
+static void default_kernel_module_deinit(struct default_kernel_module *kmod)
+{
+	drgn_error_destroy(kmod->err);
+	if (kmod->elf) {
+		elf_end(kmod->elf);
+		close(kmod->fd);
+	}
+	free(kmod->path);
+	free(kmod->name);
+}
+
+/*
+ * Open the file for a kernel module found in depmod. This only does file I/O,
+ * so it is safe to call for multiple modules in parallel.
+ */
 static struct drgn_error *
-report_default_kernel_module(struct drgn_debug_info_load_state *load,
-			     struct kernel_module_iterator *kmod_it,
-			     struct depmod_index *depmod)
+find_default_kernel_module(const char *osrelease,
+			   struct default_kernel_module *kmod)
 {
 	static const char * const module_paths[] = {
 		"/usr/lib/debug/lib/modules/%s/%.*s",
@@ -1353,23 +2128,23 @@ report_default_kernel_module(struct drgn_debug_info_load_state *load,
 		"/lib/modules/%s/%.*s%.*s",
 		NULL,
 	};
-	struct drgn_error *err;
-
-	const char *depmod_path;
-	size_t depmod_path_len;
-	err = depmod_index_find(depmod, kmod_it->name, &depmod_path,
-				&depmod_path_len);
-	if (err) {
-		return drgn_debug_info_report_error(load,
-						    "kernel modules",
-						    "could not parse depmod",
-						    err);
-	} else if (!depmod_path) {
-		return drgn_debug_info_report_error(load, kmod_it->name,
-						    "could not find module in depmod",
-						    NULL);
+	if (kmod->checkpoint_path &&
+	    open_checkpoint_file(kmod->checkpoint_path, kmod->build_id,
+				 kmod->build_id_len, &kmod->fd, &kmod->elf)) {
+		kmod->path = strdup(kmod->checkpoint_path);
+		if (!kmod->path) {
+			elf_end(kmod->elf);
+			kmod->elf = NULL;
+			close(kmod->fd);
+			kmod->fd = -1;
+			return &drgn_enomem;
+		}
+		return NULL;
 	}
 
+	const char *depmod_path = kmod->depmod_path;
+	size_t depmod_path_len = kmod->depmod_path_len;
+
 	size_t extension_len;
 	if (depmod_path_len >= 3 &&
 	    (memcmp(depmod_path + depmod_path_len - 3, ".gz", 3) == 0 ||
@@ -1377,55 +2152,206 @@ report_default_kernel_module(struct drgn_debug_info_load_state *load,
 		extension_len = 3;
 	else
 		extension_len = 0;
-	char *path;
-	int fd;
-	Elf *elf;
-	err = find_elf_file(&path, &fd, &elf, module_paths,
-			    load->dbinfo->prog->vmcoreinfo.osrelease,
-			    depmod_path_len - extension_len, depmod_path,
-			    extension_len,
-			    depmod_path + depmod_path_len - extension_len);
-	if (err)
+	return find_elf_file(&kmod->path, &kmod->fd, &kmod->elf, module_paths,
+			     osrelease, depmod_path_len - extension_len,
+			     depmod_path, extension_len,
+			     depmod_path + depmod_path_len - extension_len);
+}
+
+static struct drgn_error *
+report_default_kernel_module(struct drgn_debug_info_load_state *load,
+			     struct kernel_module_iterator *kmod_it,
+			     struct default_kernel_module *kmod)
+{
+	struct drgn_error *err;
+
+	if (kmod->err) {
+		err = kmod->err;
+		kmod->err = NULL;
 		return drgn_debug_info_report_error(load, NULL, NULL, err);
-	if (!elf) {
+	}
+	if (!kmod->elf) {
 		return drgn_debug_info_report_error(load, kmod_it->name,
 						    "could not find .ko",
 						    NULL);
 	}
 
-	err = cache_kernel_module_sections(kmod_it, elf);
+	err = cache_kernel_module_sections(kmod_it, kmod->elf);
+	if (err) {
+		return drgn_debug_info_report_error(load, kmod->path,
+						    "could not get section addresses",
+						    err);
+	}
+
+	/* Remember where the file was for the checkpoint. */
+	if (!kmod_it->modules_file) {
+		struct cached_kernel_module *cached =
+			kernel_module_iterator_current(kmod_it);
+		if (!cached->path || strcmp(cached->path, kmod->path) != 0) {
+			char *path = strdup(kmod->path);
+			if (!path)
+				return &drgn_enomem;
+			free(cached->path);
+			cached->path = path;
+			kmod_it->cache->dirty = true;
+		}
+	}
+
+	Elf *elf = kmod->elf;
+	kmod->elf = NULL;
+	return drgn_debug_info_report_elf(load, kmod->path, kmod->fd, elf,
+					  kmod_it->start, kmod_it->end,
+					  kmod_it->name, NULL);
+}
+
+/*
+ * Find the loaded kernel modules that weren't reported explicitly at the
+ * standard locations. Opening the files is the slow part, so we first look up
+ * all of the modules in depmod, then open all of the files in parallel, and
+ * finally report them in the order that they are loaded.
+ */
+static struct drgn_error *
+report_default_kernel_modules(struct drgn_debug_info_load_state *load,
+			      struct default_kernel_module_vector *kmods,
+			      bool use_proc_and_sys)
+{
+	struct drgn_program *prog = load->dbinfo->prog;
+	struct drgn_error *err;
+
+	struct default_kernel_module_map map = HASH_TABLE_INIT;
+	for (size_t i = 0; i < kmods->size; i++) {
+		struct default_kernel_module_map_entry entry = {
+			.key = kmods->data[i].name,
+			.value = i,
+		};
+		if (default_kernel_module_map_insert(&map, &entry,
+						     NULL) == -1) {
+			err = &drgn_enomem;
+			goto out_map;
+		}
+	}
+
+	#pragma omp parallel for schedule(dynamic) \
+		num_threads(drgn_program_num_parallel_threads(prog))
+	for (size_t i = 0; i < kmods->size; i++) {
+		drgn_program_bind_parallel_thread(prog);
+		kmods->data[i].err =
+			find_default_kernel_module(prog->vmcoreinfo.osrelease,
+						   &kmods->data[i]);
+	}
+
+	struct kernel_module_iterator kmod_it;
+	err = kernel_module_iterator_init(&kmod_it, prog, use_proc_and_sys);
 	if (err) {
-		err = drgn_debug_info_report_error(load, path,
-						   "could not get section addresses",
+kernel_module_iterator_error:
+		err = drgn_debug_info_report_error(load, "kernel modules",
+						   "could not find loaded kernel modules",
 						   err);
-		elf_end(elf);
-		close(fd);
-		free(path);
-		return err;
+		goto out_map;
 	}
+	for (;;) {
+		err = kernel_module_iterator_next(&kmod_it);
+		if (err == &drgn_stop) {
+			err = NULL;
+			break;
+		} else if (err) {
+			kernel_module_iterator_deinit(&kmod_it);
+			goto kernel_module_iterator_error;
+		}
 
-	err = drgn_debug_info_report_elf(load, path, fd, elf, kmod_it->start,
-					 kmod_it->end, kmod_it->name, NULL);
-	free(path);
+		/*
+		 * Skip modules that we didn't look up, including any that the
+		 * running kernel loaded in the meantime.
+		 */
+		const char *name = kmod_it.name;
+		struct default_kernel_module_map_iterator it =
+			default_kernel_module_map_search(&map, &name);
+		if (!it.entry)
+			continue;
+		struct default_kernel_module *kmod =
+			&kmods->data[it.entry->value];
+		err = report_default_kernel_module(load, &kmod_it, kmod);
+		if (err)
+			break;
+	}
+	kernel_module_iterator_deinit(&kmod_it);
+out_map:
+	default_kernel_module_map_deinit(&map);
 	return err;
 }
 
+/* Look up a loaded kernel module in depmod to find it later. */
+static struct drgn_error *
+add_default_kernel_module(struct drgn_debug_info_load_state *load,
+			  struct depmod_index *depmod,
+			  struct kernel_module_iterator *kmod_it,
+			  struct default_kernel_module_vector *kmods)
+{
+	struct drgn_error *err;
+
+	const char *depmod_path;
+	size_t depmod_path_len;
+	err = depmod_index_find(depmod, kmod_it->name, &depmod_path,
+				&depmod_path_len);
+	if (err) {
+		return drgn_debug_info_report_error(load,
+						    "kernel modules",
+						    "could not parse depmod",
+						    err);
+	} else if (!depmod_path) {
+		return drgn_debug_info_report_error(load, kmod_it->name,
+						    "could not find module in depmod",
+						    NULL);
+	}
+
+	struct default_kernel_module kmod = {
+		.name = strdup(kmod_it->name),
+		.depmod_path = depmod_path,
+		.depmod_path_len = depmod_path_len,
+		.fd = -1,
+	};
+	if (!kmod.name)
+		return &drgn_enomem;
+	/*
+	 * A file saved in the checkpoint is only used if it has the build ID of
+	 * the loaded module.
+	 */
+	if (!kmod_it->modules_file &&
+	    kernel_module_iterator_current(kmod_it)->path) {
+		err = kernel_module_iterator_gnu_build_id(kmod_it,
+							  &kmod.build_id,
+							  &kmod.build_id_len);
+		if (err)
+			drgn_error_destroy(err);
+		else if (kmod.build_id_len)
+			kmod.checkpoint_path =
+				kernel_module_iterator_current(kmod_it)->path;
+	}
+	if (!default_kernel_module_vector_append(kmods, &kmod)) {
+		free(kmod.name);
+		return &drgn_enomem;
+	}
+	return NULL;
+}
+
 static struct drgn_error *
 report_loaded_kernel_modules(struct drgn_debug_info_load_state *load,
 			     struct kernel_module_table *kmod_table,
-			     struct depmod_index *depmod,
-			     bool use_proc_and_sys)
+			     bool load_default, bool use_proc_and_sys)
 {
 	struct drgn_program *prog = load->dbinfo->prog;
 	struct drgn_error *err;
 
+	struct depmod_index *depmod = NULL;
+	struct default_kernel_module_vector default_kmods = VECTOR_INIT;
 	struct kernel_module_iterator kmod_it;
 	err = kernel_module_iterator_init(&kmod_it, prog, use_proc_and_sys);
 	if (err) {
 kernel_module_iterator_error:
-		return drgn_debug_info_report_error(load, "kernel modules",
-						    "could not find loaded kernel modules",
-						    err);
+		err = drgn_debug_info_report_error(load, "kernel modules",
+						   "could not find loaded kernel modules",
+						   err);
+		goto out;
 	}
 	for (;;) {
 		err = kernel_module_iterator_next(&kmod_it);
@@ -1452,30 +2378,37 @@ kernel_module_iterator_error:
 		 * defaults, look for the module at the standard locations unless we've
 		 * already indexed that module.
 		 */
-		if (depmod &&
+		if (load_default &&
 		    !drgn_debug_info_is_indexed(load->dbinfo, kmod_it.name)) {
-			if (!depmod->addr) {
-				err = depmod_index_init(depmod,
-							prog->vmcoreinfo.osrelease);
+			if (!depmod) {
+				err = drgn_program_depmod_index(prog, &depmod);
 				if (err) {
-					depmod->addr = NULL;
 					err = drgn_debug_info_report_error(load,
 									   "kernel modules",
 									   "could not read depmod",
 									   err);
 					if (err)
 						break;
-					depmod = NULL;
+					load_default = false;
 					continue;
 				}
 			}
-			err = report_default_kernel_module(load, &kmod_it,
-							   depmod);
+
+			err = add_default_kernel_module(load, depmod, &kmod_it,
+							&default_kmods);
 			if (err)
 				break;
 		}
 	}
 	kernel_module_iterator_deinit(&kmod_it);
+	if (!err && default_kmods.size) {
+		err = report_default_kernel_modules(load, &default_kmods,
+						    use_proc_and_sys);
+	}
+out:
+	for (size_t i = 0; i < default_kmods.size; i++)
+		default_kernel_module_deinit(&default_kmods.data[i]);
+	default_kernel_module_vector_deinit(&default_kmods);
 	return err;
 }
 
@@ -1490,16 +2423,7 @@ report_kernel_modules(struct drgn_debug_info_load_state *load,
 	if (!num_kmods && !load->load_default)
 		return NULL;
 
-	/*
-	 * If we're debugging the running kernel, we can get the loaded kernel
-	 * modules from /proc and /sys instead of from the core dump. This fast
-	 * path can be disabled via an environment variable for testing.
-	 */
-	bool use_proc_and_sys = false;
-	if (prog->flags & DRGN_PROGRAM_IS_LIVE) {
-		char *env = getenv("DRGN_USE_PROC_AND_SYS_MODULES");
-		use_proc_and_sys = !env || atoi(env);
-	}
+	bool use_proc_and_sys = use_proc_and_sys_modules(prog);
 	/*
 	 * If we're not using /proc and /sys, then we need to index vmlinux now
 	 * so that we can walk the list of modules in the kernel.
@@ -1511,8 +2435,6 @@ report_kernel_modules(struct drgn_debug_info_load_state *load,
 	}
 
 	struct kernel_module_table kmod_table = HASH_TABLE_INIT;
-	struct depmod_index depmod;
-	depmod.addr = NULL;
 	struct kernel_module_table_iterator it;
 	for (size_t i = 0; i < num_kmods; i++) {
 		struct kernel_module_file *kmod = &kmods[i];
@@ -1548,7 +2470,7 @@ report_kernel_modules(struct drgn_debug_info_load_state *load,
 
 	err = report_loaded_kernel_modules(load,
 					   num_kmods ? &kmod_table : NULL,
-					   load->load_default ? &depmod : NULL,
+					   load->load_default,
 					   use_proc_and_sys);
 	if (err)
 		goto out;
@@ -1570,12 +2492,34 @@ report_kernel_modules(struct drgn_debug_info_load_state *load,
 	}
 	err = NULL;
 out:
-	if (depmod.addr)
-		depmod_index_deinit(&depmod);
 	kernel_module_table_deinit(&kmod_table);
 	return err;
 }
 
+/* Remember where vmlinux was for the checkpoint. */
+static struct drgn_error *cache_vmlinux_path(struct kernel_module_cache *cache,
+					     const char *path, Elf *elf)
+{
+	const void *build_id;
+	ssize_t build_id_len = dwelf_elf_gnu_build_id(elf, &build_id);
+	if (build_id_len <= 0)
+		return NULL;
+	char *path_copy = strdup(path);
+	void *build_id_copy = memdup(build_id, build_id_len);
+	if (!path_copy || !build_id_copy) {
+		free(build_id_copy);
+		free(path_copy);
+		return &drgn_enomem;
+	}
+	free(cache->vmlinux_build_id);
+	free(cache->vmlinux_path);
+	cache->vmlinux_path = path_copy;
+	cache->vmlinux_build_id = build_id_copy;
+	cache->vmlinux_build_id_len = build_id_len;
+	cache->dirty = true;
+	return NULL;
+}
+
 static struct drgn_error *
 report_vmlinux(struct drgn_debug_info_load_state *load,
 	       bool *vmlinux_is_pending)
@@ -1595,18 +2539,47 @@ report_vmlinux(struct drgn_debug_info_load_state *load,
 	struct drgn_program *prog = load->dbinfo->prog;
 	struct drgn_error *err;
 
+	/* Try the file saved in the checkpoint first. */
+	struct kernel_module_cache *cache = NULL;
+	if (!(prog->flags & DRGN_PROGRAM_IS_LIVE)) {
+		cache = drgn_program_kernel_module_cache(prog);
+		if (!cache)
+			return &drgn_enomem;
+	}
 	char *path;
 	int fd;
 	Elf *elf;
-	err = find_elf_file(&path, &fd, &elf, vmlinux_paths,
-			    prog->vmcoreinfo.osrelease);
-	if (err)
-		return drgn_debug_info_report_error(load, NULL, NULL, err);
-	if (!elf) {
-		err = drgn_error_format(DRGN_ERROR_OTHER,
-					"could not find vmlinux for %s",
-					prog->vmcoreinfo.osrelease);
-		return drgn_debug_info_report_error(load, "kernel", NULL, err);
+	if (cache && cache->vmlinux_path &&
+	    open_checkpoint_file(cache->vmlinux_path, cache->vmlinux_build_id,
+				 cache->vmlinux_build_id_len, &fd, &elf)) {
+		path = strdup(cache->vmlinux_path);
+		if (!path) {
+			elf_end(elf);
+			close(fd);
+			return &drgn_enomem;
+		}
+	} else {
+		err = find_elf_file(&path, &fd, &elf, vmlinux_paths,
+				    prog->vmcoreinfo.osrelease);
+		if (err)
+			return drgn_debug_info_report_error(load, NULL, NULL,
+							    err);
+		if (!elf) {
+			err = drgn_error_format(DRGN_ERROR_OTHER,
+						"could not find vmlinux for %s",
+						prog->vmcoreinfo.osrelease);
+			return drgn_debug_info_report_error(load, "kernel",
+							    NULL, err);
+		}
+		if (cache) {
+			err = cache_vmlinux_path(cache, path, elf);
+			if (err) {
+				elf_end(elf);
+				close(fd);
+				free(path);
+				return err;
+			}
+		}
 	}
 
 	uint64_t start, end;
@@ -1716,6 +2689,8 @@ linux_kernel_report_debug_info(struct drgn_debug_info_load_state *load)
 	}
 
 	err = report_kernel_modules(load, kmods, num_kmods, vmlinux_is_pending);
+	if (!err)
+		linux_kernel_checkpoint_write(prog);
 out:
 	for (size_t i = 0; i < num_kmods; i++) {
 		elf_end(kmods[i].elf);
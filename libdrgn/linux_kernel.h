@@ -4,9 +4,13 @@
 #ifndef DRGN_LINUX_KERNEL_H
 #define DRGN_LINUX_KERNEL_H
 
+#include <libelf.h>
+
 #include "drgn.h"
 
+struct depmod_index;
 struct drgn_debug_info_load_state;
+struct kernel_module_cache;
 struct vmcoreinfo;
 
 struct drgn_error *read_memory_via_pgtable(void *buf, uint64_t address,
@@ -16,7 +20,8 @@ struct drgn_error *read_memory_via_pgtable(void *buf, uint64_t address,
 struct drgn_error *parse_vmcoreinfo(const char *desc, size_t descsz,
 				    struct vmcoreinfo *ret);
 
-struct drgn_error *proc_kallsyms_symbol_addr(const char *name,
+struct drgn_error *proc_kallsyms_symbol_addr(struct drgn_program *prog,
+					     const char *name,
 					     unsigned long *ret);
 
 struct drgn_error *read_vmcoreinfo_fallback(struct drgn_program *prog);
@@ -29,10 +34,27 @@ struct drgn_error *linux_kernel_object_find(const char *name, size_t name_len,
 struct drgn_error *
 linux_kernel_report_debug_info(struct drgn_debug_info_load_state *load);
 
+/* Free the kernel modules cached by linux_kernel_report_debug_info(). */
+void kernel_module_cache_destroy(struct kernel_module_cache *cache);
+
+/* Unmap the depmod index cached by linux_kernel_report_debug_info(). */
+void depmod_index_destroy(struct depmod_index *depmod);
+
+/*
+ * Set the section addresses of a fetched debugging information file for the
+ * loaded kernel module with the given name. This does nothing for files that
+ * aren't kernel modules.
+ */
+struct drgn_error *
+linux_kernel_cache_fetched_module_sections(struct drgn_program *prog,
+					   const char *name, Elf *elf);
+
 #define KDUMP_SIGNATURE "KDUMP   "
 #define KDUMP_SIG_LEN (sizeof(KDUMP_SIGNATURE) - 1)
 
 #ifdef WITH_LIBKDUMPFILE
+struct drgn_error *drgn_read_kdump(void *buf, uint64_t address, size_t count,
+				   uint64_t offset, void *arg, bool physical);
 struct drgn_error *drgn_program_cache_kdump_notes(struct drgn_program *prog);
 struct drgn_error *drgn_program_set_kdump(struct drgn_program *prog);
 #else
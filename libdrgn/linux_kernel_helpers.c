@@ -1,27 +1,94 @@
 // Copyright (c) Meta Platforms, Inc. and affiliates.
 // SPDX-License-Identifier: GPL-3.0-or-later
 
+#include <byteswap.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <inttypes.h>
+#include <math.h>
 
+#include "bitops.h"
 #include "drgn.h"
+#include "error.h"
 #include "helpers.h"
 #include "minmax.h"
+#include "object.h"
+#include "openmp.h"
 #include "platform.h"
 #include "program.h"
+#include "serialize.h"
+#include "string_builder.h"
+#include "type.h"
 #include "util.h"
 
-struct drgn_error *linux_helper_read_vm(struct drgn_program *prog,
-					uint64_t pgtable, uint64_t virt_addr,
-					void *buf, size_t count)
+static inline struct drgn_tlb_entry *
+drgn_tlb_entry(struct drgn_tlb *tlb, uint64_t pgtable, uint64_t virt_addr,
+	       int page_shift)
 {
-	struct drgn_error *err;
-	struct pgtable_iterator *it;
-	pgtable_iterator_next_fn *next;
-	uint64_t read_addr = 0;
-	size_t read_size = 0;
+	size_t hash = hash_combine(hash_combine(pgtable, virt_addr >> page_shift),
+				   page_shift);
+	return &tlb->entries[hash & (DRGN_TLB_SIZE - 1)];
+}
+
+/*
+ * Look up the cached translation of a virtual address. On success, returns the
+ * first virtual address of the containing page, the physical address it maps
+ * to, and the end of the page (which is 0 if the page is at the end of the
+ * address space).
+ */
+static bool drgn_tlb_lookup(struct drgn_tlb *tlb, uint64_t pgtable,
+			    uint64_t virt_addr, uint64_t *start_virt_addr_ret,
+			    uint64_t *start_phys_addr_ret,
+			    uint64_t *end_virt_addr_ret)
+{
+	uint64_t page_shifts = tlb->page_shifts;
+	while (page_shifts) {
+		int page_shift = __builtin_ctzll(page_shifts);
+		page_shifts &= page_shifts - 1;
+		uint64_t start_virt_addr = virt_addr & (UINT64_MAX << page_shift);
+		struct drgn_tlb_entry *entry =
+			drgn_tlb_entry(tlb, pgtable, virt_addr, page_shift);
+		if (entry->page_shift == page_shift &&
+		    entry->pgtable == pgtable &&
+		    entry->virt_addr == start_virt_addr) {
+			*start_virt_addr_ret = start_virt_addr;
+			*start_phys_addr_ret = entry->phys_addr;
+			*end_virt_addr_ret =
+				start_virt_addr + (UINT64_C(1) << page_shift);
+			return true;
+		}
+	}
+	return false;
+}
 
+static void drgn_tlb_insert(struct drgn_tlb *tlb, uint64_t pgtable,
+			    uint64_t start_virt_addr, uint64_t start_phys_addr,
+			    uint64_t end_virt_addr)
+{
+	/*
+	 * Only cache naturally aligned pages with a power of two size. This
+	 * is always true for mapped pages, but check anyway.
+	 */
+	uint64_t size = end_virt_addr - start_virt_addr;
+	if (size == 0 || (size & (size - 1)) ||
+	    (start_virt_addr & (size - 1)) || (start_phys_addr & (size - 1)))
+		return;
+	int page_shift = __builtin_ctzll(size);
+	if (page_shift == 0)
+		return;
+	struct drgn_tlb_entry *entry =
+		drgn_tlb_entry(tlb, pgtable, start_virt_addr, page_shift);
+	entry->pgtable = pgtable;
+	entry->virt_addr = start_virt_addr;
+	entry->phys_addr = start_phys_addr;
+	entry->page_shift = page_shift;
+	tlb->page_shifts |= UINT64_C(1) << page_shift;
+}
+
+static struct drgn_error *
+linux_helper_check_pgtable_iterator(struct drgn_program *prog)
+{
 	if (!(prog->flags & DRGN_PROGRAM_IS_LINUX_KERNEL)) {
 		return drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
 					 "virtual address translation is only available for the Linux kernel");
@@ -35,49 +102,168 @@ struct drgn_error *linux_helper_read_vm(struct drgn_program *prog,
 					 "virtual address translation is not implemented for %s architecture",
 					 prog->platform.arch->name);
 	}
+	return NULL;
+}
+
+static struct pgtable_iterator *
+linux_helper_pgtable_iterator_create(struct drgn_program *prog)
+{
+	struct pgtable_iterator *it =
+		malloc(sizeof(*it) +
+		       prog->platform.arch->pgtable_iterator_arch_size);
+	if (it)
+		it->prog = prog;
+	return it;
+}
+
+/*
+ * Translate a range of kernel virtual addresses without walking the page table
+ * if it is entirely within a linearly mapped region. The program lock must be
+ * held.
+ */
+static bool linux_helper_linear_translate(struct drgn_program *prog,
+					  uint64_t virt_addr, size_t count,
+					  uint64_t *ret)
+{
+	if (!prog->linear_mappings_initialized) {
+		const struct drgn_architecture_info *arch =
+			prog->platform.arch;
+		/*
+		 * Wait until PAGE_OFFSET has been cached rather than looking it
+		 * up here, which could need to read memory.
+		 */
+		if (!arch->linux_kernel_linear_mappings ||
+		    prog->page_offset.kind == DRGN_OBJECT_ABSENT)
+			return false;
+		uint64_t page_offset;
+		struct drgn_error *err =
+			drgn_object_read_unsigned(&prog->page_offset,
+						  &page_offset);
+		if (err) {
+			drgn_error_destroy(err);
+			prog->num_linear_mappings = 0;
+		} else {
+			prog->num_linear_mappings =
+				arch->linux_kernel_linear_mappings(prog,
+								   page_offset,
+								   prog->linear_mappings);
+		}
+		prog->linear_mappings_initialized = true;
+	}
+	for (size_t i = 0; i < prog->num_linear_mappings; i++) {
+		const struct drgn_linear_mapping *mapping =
+			&prog->linear_mappings[i];
+		uint64_t offset = virt_addr - mapping->virt_addr;
+		if (virt_addr >= mapping->virt_addr && offset < mapping->size &&
+		    count <= mapping->size - offset) {
+			*ret = mapping->phys_addr + offset;
+			return true;
+		}
+	}
+	return false;
+}
+
+struct drgn_error *linux_helper_read_vm(struct drgn_program *prog,
+					uint64_t pgtable, uint64_t virt_addr,
+					void *buf, size_t count)
+{
+	struct drgn_error *err;
+	struct pgtable_iterator *it;
+	pgtable_iterator_next_fn *next;
+	uint64_t read_addr = 0;
+	size_t read_size = 0;
+
+	err = linux_helper_check_pgtable_iterator(prog);
+	if (err)
+		return err;
 
 	if (!count)
 		return NULL;
 
+	/* The page table iterator and TLB are shared by all threads. */
+	drgn_program_lock(prog);
+	uint64_t linear_phys_addr;
+	if (linux_helper_linear_translate(prog, virt_addr, count,
+					  &linear_phys_addr)) {
+		prog->stats.linear_translations++;
+		err = drgn_program_read_memory(prog, buf, linear_phys_addr,
+					       count, true);
+		/*
+		 * The physical memory may be missing from the core dump even
+		 * if it is reachable through the page table (e.g., if the core
+		 * dump only has virtual segments), so fall back to walking the
+		 * page table on faults.
+		 */
+		if (!err || err->code != DRGN_ERROR_FAULT)
+			goto out;
+		drgn_error_destroy(err);
+	}
 	if (prog->pgtable_it_in_use) {
-		return drgn_error_create_fault("recursive address translation; "
-					       "page table may be missing from core dump",
-					       virt_addr);
+		err = drgn_error_create_fault("recursive address translation; "
+					      "page table may be missing from core dump",
+					      virt_addr);
+		goto out;
 	}
 
 	if (prog->pgtable_it) {
 		it = prog->pgtable_it;
 	} else {
-		it = malloc(sizeof(*it) +
-			    prog->platform.arch->pgtable_iterator_arch_size);
-		if (!it)
-			return &drgn_enomem;
+		it = linux_helper_pgtable_iterator_create(prog);
+		if (!it) {
+			err = &drgn_enomem;
+			goto out;
+		}
 		prog->pgtable_it = it;
-		it->prog = prog;
 	}
-	it->pgtable = pgtable;
-	it->virt_addr = virt_addr;
 	prog->pgtable_it_in_use = true;
-	prog->platform.arch->pgtable_iterator_arch_init(it->arch);
 	next = prog->platform.arch->linux_kernel_pgtable_iterator_next;
+	/*
+	 * The iterator is only initialized when we first need to walk the page
+	 * table, and it is reinitialized if we skip ahead using the TLB.
+	 */
+	bool it_valid = false;
 	do {
-		uint64_t virt_addr, start_virt_addr, end_virt_addr;
-		uint64_t start_phys_addr, end_phys_addr;
+		uint64_t start_virt_addr, end_virt_addr;
+		uint64_t start_phys_addr, phys_addr;
 		size_t n;
 
-		virt_addr = it->virt_addr;
-		err = next(it, &start_virt_addr, &start_phys_addr);
-		if (err)
-			break;
-		if (start_phys_addr == UINT64_MAX) {
-			err = drgn_error_create_fault("address is not mapped",
-						      virt_addr);
-			break;
+		if (prog->tlb.enabled &&
+		    drgn_tlb_lookup(&prog->tlb, pgtable, virt_addr,
+				    &start_virt_addr, &start_phys_addr,
+				    &end_virt_addr)) {
+			prog->tlb.hits++;
+		} else {
+			if (!it_valid || it->virt_addr != virt_addr) {
+				it->pgtable = pgtable;
+				it->virt_addr = virt_addr;
+				prog->platform.arch->pgtable_iterator_arch_init(it->arch);
+				it_valid = true;
+			}
+			uint64_t start_time = monotonic_ns();
+			err = next(it, &start_virt_addr, &start_phys_addr);
+			prog->stats.page_table_walks++;
+			prog->stats.page_table_walk_ns +=
+				monotonic_ns() - start_time;
+			if (err)
+				break;
+			if (start_phys_addr == UINT64_MAX) {
+				err = drgn_error_create_fault("address is not mapped",
+							      virt_addr);
+				break;
+			}
+			end_virt_addr = it->virt_addr;
+			if (prog->tlb.enabled) {
+				prog->tlb.misses++;
+				drgn_tlb_insert(&prog->tlb, pgtable,
+						start_virt_addr,
+						start_phys_addr,
+						end_virt_addr);
+			}
 		}
-		end_virt_addr = it->virt_addr;
-		end_phys_addr = start_phys_addr + (end_virt_addr - start_virt_addr);
+		phys_addr = start_phys_addr + (virt_addr - start_virt_addr);
 		n = min(end_virt_addr - virt_addr, (uint64_t)count);
-		if (read_size && end_phys_addr == read_addr + read_size) {
+		/* Merge physically contiguous pages into one read. */
+		if (read_size && phys_addr == read_addr + read_size) {
 			read_size += n;
 		} else {
 			if (read_size) {
@@ -88,9 +274,10 @@ struct drgn_error *linux_helper_read_vm(struct drgn_program *prog,
 					break;
 				buf = (char *)buf + read_size;
 			}
-			read_addr = start_phys_addr + (virt_addr - start_virt_addr);
+			read_addr = phys_addr;
 			read_size = n;
 		}
+		virt_addr = end_virt_addr;
 		count -= n;
 	} while (count);
 	if (!err) {
@@ -98,6 +285,257 @@ struct drgn_error *linux_helper_read_vm(struct drgn_program *prog,
 					       true);
 	}
 	prog->pgtable_it_in_use = false;
+out:
+	drgn_program_unlock(prog);
+	return err;
+}
+
+DEFINE_VECTOR_FUNCTIONS(linux_helper_pgtable_mapping_vector)
+
+/*
+ * Append the mapped ranges of [start, end) in a page table to a vector using
+ * a private iterator.
+ */
+static struct drgn_error *
+linux_helper_walk_pgtable(struct pgtable_iterator *it, uint64_t pgtable,
+			  uint64_t start, uint64_t end,
+			  struct linux_helper_pgtable_mapping_vector *ret)
+{
+	struct drgn_error *err;
+	struct drgn_program *prog = it->prog;
+	pgtable_iterator_next_fn *next =
+		prog->platform.arch->linux_kernel_pgtable_iterator_next;
+	size_t first = ret->size;
+
+	it->pgtable = pgtable;
+	it->virt_addr = start;
+	prog->platform.arch->pgtable_iterator_arch_init(it->arch);
+	do {
+		uint64_t virt_addr, phys_addr;
+		err = next(it, &virt_addr, &phys_addr);
+		if (err)
+			return err;
+		if (phys_addr == UINT64_MAX)
+			continue;
+		/* The first range may start before start. */
+		if (virt_addr < start) {
+			phys_addr += start - virt_addr;
+			virt_addr = start;
+		}
+		/* it->virt_addr is 0 if the range ends the address space. */
+		uint64_t range_end = it->virt_addr;
+		if (end && (!range_end || range_end > end))
+			range_end = end;
+		uint64_t size = range_end - virt_addr;
+
+		/* Merge ranges that are contiguous and have the same flags. */
+		struct linux_helper_pgtable_mapping *last =
+			ret->size > first ? &ret->data[ret->size - 1] : NULL;
+		if (last && last->virt_addr + last->size == virt_addr &&
+		    last->phys_addr + last->size == phys_addr &&
+		    last->flags == it->flags) {
+			last->size += size;
+			continue;
+		}
+		struct linux_helper_pgtable_mapping *mapping =
+			linux_helper_pgtable_mapping_vector_append_entry(ret);
+		if (!mapping)
+			return &drgn_enomem;
+		mapping->virt_addr = virt_addr;
+		mapping->phys_addr = phys_addr;
+		mapping->size = size;
+		mapping->flags = it->flags;
+	} while (it->virt_addr && (!end || it->virt_addr < end));
+	return NULL;
+}
+
+struct drgn_error *
+linux_helper_pgtable_mappings(struct drgn_program *prog, uint64_t pgtable,
+			      uint64_t start, uint64_t end,
+			      struct linux_helper_pgtable_mapping **mappings_ret,
+			      size_t *num_mappings_ret)
+{
+	struct drgn_error *err;
+
+	err = linux_helper_check_pgtable_iterator(prog);
+	if (err)
+		return err;
+	struct pgtable_iterator *it = linux_helper_pgtable_iterator_create(prog);
+	if (!it)
+		return &drgn_enomem;
+	struct linux_helper_pgtable_mapping_vector mappings = VECTOR_INIT;
+	if (!end || start < end) {
+		err = linux_helper_walk_pgtable(it, pgtable, start, end,
+						&mappings);
+	}
+	free(it);
+	if (err) {
+		linux_helper_pgtable_mapping_vector_deinit(&mappings);
+		return err;
+	}
+	linux_helper_pgtable_mapping_vector_shrink_to_fit(&mappings);
+	*mappings_ret = mappings.data;
+	*num_mappings_ret = mappings.size;
+	return NULL;
+}
+
+/* Mapped range in the index built by linux_helper_reverse_map(). */
+struct linux_helper_reverse_map_entry {
+	uint64_t phys_addr;
+	uint64_t size;
+	uint64_t virt_addr;
+	size_t pgtable_index;
+};
+
+static int linux_helper_reverse_map_entry_compare(const void *_a,
+						  const void *_b)
+{
+	const struct linux_helper_reverse_map_entry *a = _a, *b = _b;
+	if (a->phys_addr != b->phys_addr)
+		return a->phys_addr < b->phys_addr ? -1 : 1;
+	if (a->pgtable_index != b->pgtable_index)
+		return a->pgtable_index < b->pgtable_index ? -1 : 1;
+	if (a->virt_addr != b->virt_addr)
+		return a->virt_addr < b->virt_addr ? -1 : 1;
+	return 0;
+}
+
+DEFINE_VECTOR(linux_helper_reverse_mapping_vector,
+	      struct linux_helper_reverse_mapping)
+
+struct drgn_error *
+linux_helper_reverse_map(struct drgn_program *prog, const uint64_t *pgtables,
+			 const uint64_t *ends, size_t num_pgtables,
+			 const uint64_t *phys_addrs, size_t num_phys_addrs,
+			 struct linux_helper_reverse_mapping **mappings_ret,
+			 size_t *num_mappings_ret)
+{
+	struct drgn_error *err = NULL;
+
+	err = linux_helper_check_pgtable_iterator(prog);
+	if (err)
+		return err;
+
+	struct linux_helper_pgtable_mapping_vector *mappings =
+		malloc_array(num_pgtables, sizeof(mappings[0]));
+	if (!mappings && num_pgtables)
+		return &drgn_enomem;
+	for (size_t i = 0; i < num_pgtables; i++)
+		linux_helper_pgtable_mapping_vector_init(&mappings[i]);
+
+	/* Page tables are independent, so walk them in parallel. */
+	#pragma omp parallel num_threads(drgn_program_num_parallel_threads(prog))
+	{
+		drgn_program_bind_parallel_thread(prog);
+		struct pgtable_iterator *it =
+			linux_helper_pgtable_iterator_create(prog);
+		if (!it) {
+			#pragma omp critical(linux_helper_reverse_map_error)
+			if (!err)
+				err = &drgn_enomem;
+		}
+		#pragma omp for schedule(dynamic)
+		for (size_t i = 0; i < num_pgtables; i++) {
+			if (err || !ends[i])
+				continue;
+			struct drgn_error *walk_err =
+				linux_helper_walk_pgtable(it, pgtables[i], 0,
+							  ends[i],
+							  &mappings[i]);
+			/*
+			 * The page tables of an address space may be partially
+			 * missing from a core dump or freed while we're walking
+			 * them. Keep the ranges found before the fault.
+			 */
+			if (walk_err && walk_err->code == DRGN_ERROR_FAULT) {
+				drgn_error_destroy(walk_err);
+			} else if (walk_err) {
+				#pragma omp critical(linux_helper_reverse_map_error)
+				if (err)
+					drgn_error_destroy(walk_err);
+				else
+					err = walk_err;
+			}
+		}
+		free(it);
+	}
+	if (err)
+		goto out_mappings;
+
+	size_t num_entries = 0;
+	for (size_t i = 0; i < num_pgtables; i++)
+		num_entries += mappings[i].size;
+	struct linux_helper_reverse_map_entry *entries =
+		malloc_array(num_entries, sizeof(entries[0]));
+	if (!entries && num_entries) {
+		err = &drgn_enomem;
+		goto out_mappings;
+	}
+	uint64_t max_size = 0;
+	size_t k = 0;
+	for (size_t i = 0; i < num_pgtables; i++) {
+		for (size_t j = 0; j < mappings[i].size; j++) {
+			const struct linux_helper_pgtable_mapping *mapping =
+				&mappings[i].data[j];
+			entries[k++] = (struct linux_helper_reverse_map_entry){
+				.phys_addr = mapping->phys_addr,
+				.size = mapping->size,
+				.virt_addr = mapping->virt_addr,
+				.pgtable_index = i,
+			};
+			max_size = max(max_size, mapping->size);
+		}
+		linux_helper_pgtable_mapping_vector_deinit(&mappings[i]);
+		linux_helper_pgtable_mapping_vector_init(&mappings[i]);
+	}
+	qsort(entries, num_entries, sizeof(entries[0]),
+	      linux_helper_reverse_map_entry_compare);
+
+	struct linux_helper_reverse_mapping_vector result = VECTOR_INIT;
+	for (size_t i = 0; i < num_phys_addrs; i++) {
+		uint64_t phys_addr = phys_addrs[i];
+		/*
+		 * Binary search for the first range that could contain the
+		 * address, i.e., that starts less than max_size before it.
+		 */
+		uint64_t min_start =
+			phys_addr >= max_size ? phys_addr - max_size + 1 : 0;
+		size_t lo = 0, hi = num_entries;
+		while (lo < hi) {
+			size_t mid = lo + (hi - lo) / 2;
+			if (entries[mid].phys_addr < min_start)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		for (; lo < num_entries && entries[lo].phys_addr <= phys_addr;
+		     lo++) {
+			const struct linux_helper_reverse_map_entry *entry =
+				&entries[lo];
+			uint64_t offset = phys_addr - entry->phys_addr;
+			if (offset >= entry->size)
+				continue;
+			struct linux_helper_reverse_mapping *mapping =
+				linux_helper_reverse_mapping_vector_append_entry(&result);
+			if (!mapping) {
+				linux_helper_reverse_mapping_vector_deinit(&result);
+				free(entries);
+				err = &drgn_enomem;
+				goto out_mappings;
+			}
+			mapping->phys_index = i;
+			mapping->pgtable_index = entry->pgtable_index;
+			mapping->virt_addr = entry->virt_addr + offset;
+		}
+	}
+	free(entries);
+	linux_helper_reverse_mapping_vector_shrink_to_fit(&result);
+	*mappings_ret = result.data;
+	*num_mappings_ret = result.size;
+out_mappings:
+	for (size_t i = 0; i < num_pgtables; i++)
+		linux_helper_pgtable_mapping_vector_deinit(&mappings[i]);
+	free(mappings);
 	return err;
 }
 
@@ -307,112 +745,414 @@ out:
 }
 
 /*
- * Before Linux kernel commit 95846ecf9dac ("pid: replace pid bitmap
- * implementation with IDR API") (in v4.15), (struct pid_namespace).idr does not
- * exist, so we have to search pid_hash. We could implement pid_hashfn() and
- * only search that bucket, but it's different for 32-bit and 64-bit systems,
- * and it has changed at least once, in v4.7. Searching the whole hash table is
- * slower but foolproof.
+ * In an XArray, internal entries greater than this are nodes. Smaller ones are
+ * sibling, retry, and zero entries.
+ */
+static const uint64_t LINUX_HELPER_XA_MAX_INTERNAL = 4096;
+
+static inline uint64_t
+linux_helper_radix_tree_word_size(struct linux_helper_radix_tree_iterator *it)
+{
+	return it->is_64_bit ? 8 : 4;
+}
+
+/* Get a word from a buffer read from the program. */
+static uint64_t linux_helper_buffer_word(const char *buf, bool is_64_bit,
+					 bool bswap)
+{
+	if (is_64_bit) {
+		uint64_t value;
+		memcpy(&value, buf, sizeof(value));
+		return bswap ? bswap_64(value) : value;
+	} else {
+		uint32_t value;
+		memcpy(&value, buf, sizeof(value));
+		return bswap ? bswap_32(value) : value;
+	}
+}
+
+/*
+ * Return whether an entry in a node whose slots are at the given address is a
+ * pointer to a child node.
  */
+static bool
+linux_helper_radix_tree_is_node(struct linux_helper_radix_tree_iterator *it,
+				uint64_t entry, uint64_t slots_address)
+{
+	if ((entry & 3) != it->internal_node ||
+	    entry <= LINUX_HELPER_XA_MAX_INTERNAL)
+		return false;
+	/*
+	 * Before XArray, sibling entries are internal pointers to a slot in
+	 * the same node.
+	 */
+	uint64_t address = entry & ~it->internal_node;
+	return (address - slots_address >=
+		it->num_slots * linux_helper_radix_tree_word_size(it));
+}
+
+/* Return whether an entry which is not a node should be skipped. */
+static bool
+linux_helper_radix_tree_skip(struct linux_helper_radix_tree_iterator *it,
+			     uint64_t entry)
+{
+	if (!entry || (entry & 3) == it->internal_node)
+		return true;
+	if (!it->skip_values)
+		return false;
+	/*
+	 * XArray value entries have the lowest bit set. Before that,
+	 * exceptional entries have the second lowest bit set.
+	 */
+	if (it->internal_node == 2)
+		return entry & 1;
+	else
+		return (entry & 3) == 2;
+}
+
+/* Read a node and push it onto the iterator's stack. */
 static struct drgn_error *
-find_pid_in_pid_hash(struct drgn_object *res, const struct drgn_object *ns,
-		     const struct drgn_object *pid_hash, uint64_t pid)
+linux_helper_radix_tree_push(struct linux_helper_radix_tree_iterator *it,
+			     uint64_t address, uint64_t index)
 {
 	struct drgn_error *err;
-
-	struct drgn_qualified_type pidp_type;
-	err = drgn_program_find_type(drgn_object_program(res), "struct pid *",
-				     NULL, &pidp_type);
+	if (it->depth >= it->max_depth) {
+		return drgn_error_create(DRGN_ERROR_OTHER,
+					 "radix tree is too deep");
+	}
+	char *node = it->nodes + it->depth * it->node_size;
+	err = drgn_program_read_memory(drgn_object_program(&it->entry), node,
+				       address, it->node_size, false);
 	if (err)
 		return err;
+	struct linux_helper_radix_tree_frame *frame = &it->frames[it->depth++];
+	frame->index = index;
+	frame->address = address;
+	frame->shift = (uint8_t)node[it->shift_offset];
+	frame->slot = 0;
+	return NULL;
+}
 
-	struct drgn_qualified_type upid_type;
-	err = drgn_program_find_type(drgn_object_program(res), "struct upid",
-				     NULL, &upid_type);
-	if (err)
-		return err;
+struct drgn_error *
+linux_helper_radix_tree_iterator_init(struct linux_helper_radix_tree_iterator *it,
+				      const struct drgn_object *root,
+				      bool skip_values)
+{
+	struct drgn_error *err;
+	struct drgn_program *prog = drgn_object_program(root);
 
-	struct drgn_type_member *pid_chain_member;
-	uint64_t pid_chain_bit_offset;
-	err = drgn_type_find_member(upid_type.type, "pid_chain",
-				    &pid_chain_member, &pid_chain_bit_offset);
-	if (err)
-		return err;
+	it->index = 0;
+	it->index_base = 0;
+	it->skip_values = skip_values;
+	it->root_entry = 0;
+	it->nodes = NULL;
+	it->frames = NULL;
+	it->depth = 0;
+	it->max_depth = 0;
+	drgn_object_init(&it->entry, prog);
+	struct drgn_object tmp;
+	drgn_object_init(&tmp, prog);
 
-	struct drgn_type_member *nr_member;
-	uint64_t nr_bit_offset;
-	err = drgn_type_find_member(upid_type.type, "nr", &nr_member,
-				    &nr_bit_offset);
+	err = drgn_program_is_64_bit(prog, &it->is_64_bit);
 	if (err)
-		return err;
-	struct drgn_qualified_type nr_type;
-	err = drgn_member_type(nr_member, &nr_type, NULL);
+		goto out;
+	err = drgn_program_bswap(prog, &it->bswap);
 	if (err)
-		return err;
+		goto out;
 
-	struct drgn_type_member *ns_member;
-	uint64_t ns_bit_offset;
-	err = drgn_type_find_member(upid_type.type, "ns", &ns_member,
-				    &ns_bit_offset);
-	if (err)
-		return err;
-	struct drgn_qualified_type ns_type;
-	err = drgn_member_type(ns_member, &ns_type, NULL);
+	const char *node_type_name;
+	err = drgn_object_member_dereference(&tmp, root, "xa_head");
+	if (!err) {
+		it->internal_node = 2;
+		node_type_name = "struct xa_node";
+	} else if (err->code == DRGN_ERROR_LOOKUP) {
+		drgn_error_destroy(err);
+		err = drgn_object_member_dereference(&tmp, root, "rnode");
+		if (err)
+			goto out;
+		it->internal_node = 1;
+		node_type_name = "struct radix_tree_node";
+	} else {
+		goto out;
+	}
+	uint64_t head;
+	err = drgn_object_read_unsigned(&tmp, &head);
 	if (err)
-		return err;
-
-	struct drgn_object node, tmp;
-	drgn_object_init(&node, drgn_object_program(res));
-	drgn_object_init(&tmp, drgn_object_program(res));
+		goto out;
 
-	err = drgn_object_read(&tmp, ns);
+	struct drgn_qualified_type node_type;
+	err = drgn_program_find_type(prog, node_type_name, NULL, &node_type);
 	if (err)
 		goto out;
-	uint64_t ns_addr;
-	err = drgn_object_read_unsigned(&tmp, &ns_addr);
+	struct drgn_member_path path;
+	err = drgn_member_path_init(&path, node_type.type, "slots");
 	if (err)
 		goto out;
-	union drgn_value ns_level;
-	err = drgn_object_member_dereference(&tmp, &tmp, "level");
+	struct drgn_type *slots_type =
+		drgn_underlying_type(path.member_type.type);
+	if (drgn_type_kind(slots_type) != DRGN_TYPE_ARRAY) {
+		err = drgn_error_format(DRGN_ERROR_TYPE,
+					"%s slots member is not an array",
+					node_type_name);
+		goto out;
+	}
+	it->slots_offset = path.bit_offset / 8;
+	it->num_slots = drgn_type_length(slots_type);
+	err = drgn_member_path_init(&path, node_type.type, "shift");
 	if (err)
 		goto out;
-	err = drgn_object_read_integer(&tmp, &ns_level);
+	it->shift_offset = path.bit_offset / 8;
+	err = drgn_type_sizeof(node_type.type, &it->node_size);
 	if (err)
 		goto out;
+	if (it->num_slots < 2 || (it->num_slots & (it->num_slots - 1)) ||
+	    it->num_slots > (it->node_size - it->slots_offset) /
+			    linux_helper_radix_tree_word_size(it) ||
+	    it->shift_offset >= it->node_size) {
+		err = drgn_error_format(DRGN_ERROR_TYPE,
+					"%s has unexpected layout",
+					node_type_name);
+		goto out;
+	}
 
-	/* i = 1 << pidhash_shift */
-	err = drgn_program_find_object(drgn_object_program(res),
-				       "pidhash_shift", NULL,
-				       DRGN_FIND_OBJECT_ANY, &tmp);
+	/* Every level uses at least one bit of the index. */
+	it->max_depth = 64 / ctz(it->num_slots) + 1;
+	it->frames = malloc_array(it->max_depth, sizeof(it->frames[0]));
+	it->nodes = malloc_array(it->max_depth, it->node_size);
+	if (!it->frames || !it->nodes) {
+		err = &drgn_enomem;
+		goto out;
+	}
+
+	struct drgn_qualified_type entry_type;
+	err = drgn_program_find_type(prog, "void *", NULL, &entry_type);
 	if (err)
 		goto out;
-	union drgn_value pidhash_shift;
-	err = drgn_object_read_integer(&tmp, &pidhash_shift);
+	err = drgn_object_set_unsigned(&it->entry, entry_type, 0, 0);
 	if (err)
 		goto out;
-	uint64_t i;
-	if (pidhash_shift.uvalue >= 64)
-		i = 0;
-	else
-		i = UINT64_C(1) << pidhash_shift.uvalue;
-	while (i--) {
-		/* for (node = pid_hash[i].first; node; node = node->next) */
-		err = drgn_object_subscript(&node, pid_hash, i);
-		if (err)
-			goto out;
-		err = drgn_object_member(&node, &node, "first");
-		if (err)
-			goto out;
-		for (;;) {
-			uint64_t addr, tmp_addr;
-			union drgn_value node_nr;
-			uint64_t node_ns;
 
-			err = drgn_object_read(&node, &node);
-			if (err)
-				goto out;
-			err = drgn_object_read_unsigned(&node, &addr);
-			if (err)
+	if (linux_helper_radix_tree_is_node(it, head, 0)) {
+		err = linux_helper_radix_tree_push(it,
+						   head & ~it->internal_node,
+						   0);
+	} else if (!linux_helper_radix_tree_skip(it, head)) {
+		/* A tree with only index 0 has the entry in the root. */
+		it->root_entry = head;
+	}
+out:
+	drgn_object_deinit(&tmp);
+	if (err)
+		linux_helper_radix_tree_iterator_deinit(it);
+	return err;
+}
+
+struct drgn_error *
+linux_helper_idr_iterator_init(struct linux_helper_radix_tree_iterator *it,
+			       const struct drgn_object *idr)
+{
+	struct drgn_error *err;
+	struct drgn_object tmp;
+	drgn_object_init(&tmp, drgn_object_program(idr));
+
+	uint64_t idr_base = 0;
+	err = drgn_object_member_dereference(&tmp, idr, "idr_base");
+	if (!err) {
+		union drgn_value value;
+		err = drgn_object_read_integer(&tmp, &value);
+		if (err)
+			goto out;
+		idr_base = value.uvalue;
+	} else if (err->code == DRGN_ERROR_LOOKUP) {
+		/* idr_base was added in v4.16. */
+		drgn_error_destroy(err);
+	} else {
+		goto out;
+	}
+
+	err = drgn_object_member_dereference(&tmp, idr, "idr_rt");
+	if (err)
+		goto out;
+	err = drgn_object_address_of(&tmp, &tmp);
+	if (err)
+		goto out;
+	err = linux_helper_radix_tree_iterator_init(it, &tmp, false);
+	if (!err)
+		it->index_base = idr_base;
+out:
+	drgn_object_deinit(&tmp);
+	return err;
+}
+
+void
+linux_helper_radix_tree_iterator_deinit(struct linux_helper_radix_tree_iterator *it)
+{
+	free(it->nodes);
+	free(it->frames);
+	drgn_object_deinit(&it->entry);
+}
+
+struct drgn_error *
+linux_helper_radix_tree_iterator_next(struct linux_helper_radix_tree_iterator *it,
+				      const struct drgn_object **ret)
+{
+	struct drgn_error *err;
+	uint64_t word_size = linux_helper_radix_tree_word_size(it);
+	uint64_t entry, index;
+
+	if (it->root_entry) {
+		entry = it->root_entry;
+		index = 0;
+		it->root_entry = 0;
+		goto found;
+	}
+	while (it->depth) {
+		struct linux_helper_radix_tree_frame *frame =
+			&it->frames[it->depth - 1];
+		if (frame->slot >= it->num_slots) {
+			it->depth--;
+			continue;
+		}
+		const char *node = it->nodes + (it->depth - 1) * it->node_size;
+		uint64_t slot = frame->slot++;
+		entry = linux_helper_buffer_word(node + it->slots_offset +
+						 slot * word_size,
+						 it->is_64_bit, it->bswap);
+		if (frame->shift < 64)
+			index = frame->index + (slot << frame->shift);
+		else
+			index = frame->index;
+		uint64_t slots_address = frame->address + it->slots_offset;
+		if (linux_helper_radix_tree_is_node(it, entry, slots_address)) {
+			uint64_t address = entry & ~it->internal_node;
+			err = linux_helper_radix_tree_push(it, address, index);
+			if (err)
+				return err;
+		} else if (!linux_helper_radix_tree_skip(it, entry)) {
+			goto found;
+		}
+	}
+	*ret = NULL;
+	return NULL;
+
+found:
+	err = drgn_object_set_unsigned(&it->entry,
+				       drgn_object_qualified_type(&it->entry),
+				       entry, 0);
+	if (err)
+		return err;
+	it->index = it->index_base + index;
+	*ret = &it->entry;
+	return NULL;
+}
+
+/*
+ * Before Linux kernel commit 95846ecf9dac ("pid: replace pid bitmap
+ * implementation with IDR API") (in v4.15), (struct pid_namespace).idr does not
+ * exist, so we have to search pid_hash. We could implement pid_hashfn() and
+ * only search that bucket, but it's different for 32-bit and 64-bit systems,
+ * and it has changed at least once, in v4.7. Searching the whole hash table is
+ * slower but foolproof.
+ */
+static struct drgn_error *
+find_pid_in_pid_hash(struct drgn_object *res, const struct drgn_object *ns,
+		     const struct drgn_object *pid_hash, uint64_t pid)
+{
+	struct drgn_error *err;
+
+	struct drgn_qualified_type pidp_type;
+	err = drgn_program_find_type(drgn_object_program(res), "struct pid *",
+				     NULL, &pidp_type);
+	if (err)
+		return err;
+
+	struct drgn_qualified_type upid_type;
+	err = drgn_program_find_type(drgn_object_program(res), "struct upid",
+				     NULL, &upid_type);
+	if (err)
+		return err;
+
+	struct drgn_type_member *pid_chain_member;
+	uint64_t pid_chain_bit_offset;
+	err = drgn_type_find_member(upid_type.type, "pid_chain",
+				    &pid_chain_member, &pid_chain_bit_offset);
+	if (err)
+		return err;
+
+	struct drgn_type_member *nr_member;
+	uint64_t nr_bit_offset;
+	err = drgn_type_find_member(upid_type.type, "nr", &nr_member,
+				    &nr_bit_offset);
+	if (err)
+		return err;
+	struct drgn_qualified_type nr_type;
+	err = drgn_member_type(nr_member, &nr_type, NULL);
+	if (err)
+		return err;
+
+	struct drgn_type_member *ns_member;
+	uint64_t ns_bit_offset;
+	err = drgn_type_find_member(upid_type.type, "ns", &ns_member,
+				    &ns_bit_offset);
+	if (err)
+		return err;
+	struct drgn_qualified_type ns_type;
+	err = drgn_member_type(ns_member, &ns_type, NULL);
+	if (err)
+		return err;
+
+	struct drgn_object node, tmp;
+	drgn_object_init(&node, drgn_object_program(res));
+	drgn_object_init(&tmp, drgn_object_program(res));
+
+	err = drgn_object_read(&tmp, ns);
+	if (err)
+		goto out;
+	uint64_t ns_addr;
+	err = drgn_object_read_unsigned(&tmp, &ns_addr);
+	if (err)
+		goto out;
+	union drgn_value ns_level;
+	err = drgn_object_member_dereference(&tmp, &tmp, "level");
+	if (err)
+		goto out;
+	err = drgn_object_read_integer(&tmp, &ns_level);
+	if (err)
+		goto out;
+
+	/* i = 1 << pidhash_shift */
+	err = drgn_program_find_object(drgn_object_program(res),
+				       "pidhash_shift", NULL,
+				       DRGN_FIND_OBJECT_ANY, &tmp);
+	if (err)
+		goto out;
+	union drgn_value pidhash_shift;
+	err = drgn_object_read_integer(&tmp, &pidhash_shift);
+	if (err)
+		goto out;
+	uint64_t i;
+	if (pidhash_shift.uvalue >= 64)
+		i = 0;
+	else
+		i = UINT64_C(1) << pidhash_shift.uvalue;
+	while (i--) {
+		/* for (node = pid_hash[i].first; node; node = node->next) */
+		err = drgn_object_subscript(&node, pid_hash, i);
+		if (err)
+			goto out;
+		err = drgn_object_member(&node, &node, "first");
+		if (err)
+			goto out;
+		for (;;) {
+			uint64_t addr, tmp_addr;
+			union drgn_value node_nr;
+			uint64_t node_ns;
+
+			err = drgn_object_read(&node, &node);
+			if (err)
+				goto out;
+			err = drgn_object_read_unsigned(&node, &addr);
+			if (err)
 				goto out;
 			if (!addr)
 				break;
@@ -592,6 +1332,29 @@ struct drgn_error *linux_helper_find_task(struct drgn_object *res,
 	drgn_object_init(&pid_obj, drgn_object_program(res));
 	drgn_object_init(&pid_type_obj, drgn_object_program(res));
 
+	struct linux_helper_task_index *index;
+	err = linux_helper_cached_task_index(drgn_object_program(res), &index);
+	if (err)
+		goto out;
+	if (index) {
+		uint64_t ns_address;
+		err = drgn_object_read_unsigned(ns, &ns_address);
+		if (err)
+			goto out;
+		if (ns_address == index->init_pid_ns_address) {
+			const struct linux_helper_task_index_entry *entry =
+				pid <= UINT32_MAX ?
+				linux_helper_task_index_find_pid(index, pid) :
+				NULL;
+			struct drgn_qualified_type task_structp_type =
+				index->task_struct_pointer_type;
+			err = drgn_object_set_unsigned(res, task_structp_type,
+						       entry ? entry->address :
+						       0, 0);
+			goto out;
+		}
+	}
+
 	err = linux_helper_find_pid(&pid_obj, ns, pid);
 	if (err)
 		goto out;
@@ -629,6 +1392,18 @@ linux_helper_task_iterator_init(struct linux_helper_task_iterator *it,
 	if (err)
 		goto err;
 	it->thread_group_address = it->init_task_address;
+	/* Prefetching is optional, so ignore errors. */
+	err = drgn_type_sizeof(it->task_struct_type.type,
+			       &it->task_struct_size);
+	if (!err) {
+		err = drgn_type_offsetof(it->task_struct_type.type,
+					 "thread_group.next",
+					 &it->thread_group_offset);
+	}
+	if (err) {
+		drgn_error_destroy(err);
+		it->task_struct_size = 0;
+	}
 	return NULL;
 
 err:
@@ -641,6 +1416,33 @@ void linux_helper_task_iterator_deinit(struct linux_helper_task_iterator *it)
 	drgn_object_deinit(&it->task);
 }
 
+/*
+ * Walking the task list is serialized on reading each task_struct. Read the
+ * pointer to the task after the one being returned now and start reading it in
+ * the background while the caller works on this one.
+ */
+static void
+linux_helper_task_iterator_prefetch(struct linux_helper_task_iterator *it,
+				    uint64_t task_address)
+{
+	struct drgn_program *prog = drgn_object_program(&it->task);
+	if (!it->task_struct_size || it->done ||
+	    !drgn_program_memory_cache_size(prog))
+		return;
+	uint64_t next;
+	struct drgn_error *err =
+		drgn_program_read_word(prog,
+				       task_address + it->thread_group_offset,
+				       false, &next);
+	if (err) {
+		/* The next call will report the error. */
+		drgn_error_destroy(err);
+		return;
+	}
+	drgn_program_prefetch(prog, next - it->thread_group_offset,
+			      it->task_struct_size, false);
+}
+
 struct drgn_error *
 linux_helper_task_iterator_next(struct linux_helper_task_iterator *it,
 				const struct drgn_object **ret)
@@ -682,7 +1484,5508 @@ linux_helper_task_iterator_next(struct linux_helper_task_iterator *it,
 			return err;
 		if (it->thread_group_address == it->init_task_address)
 			it->done = true;
+		task_address = it->thread_group_address;
 	}
+	linux_helper_task_iterator_prefetch(it, task_address);
 	*ret = task;
 	return NULL;
 }
+
+struct drgn_error *
+linux_helper_list_iterator_init(struct linux_helper_list_iterator *it,
+				const struct drgn_object *head,
+				struct drgn_qualified_type entry_type,
+				const char *member_designator,
+				enum linux_helper_list_kind kind)
+{
+	struct drgn_error *err;
+	struct drgn_program *prog = drgn_object_program(head);
+
+	struct drgn_type *head_type = drgn_underlying_type(head->type);
+	if (drgn_type_kind(head_type) != DRGN_TYPE_POINTER) {
+		return drgn_type_error("list head must be a pointer, not '%s'",
+				       head->type);
+	}
+	err = drgn_object_read_unsigned(head, &it->head_address);
+	if (err)
+		return err;
+
+	err = drgn_type_offsetof(entry_type.type, member_designator,
+				 &it->member_offset);
+	if (err)
+		return err;
+	char *next_designator;
+	if (asprintf(&next_designator, "%s.%s", member_designator,
+		     kind == LINUX_HELPER_LIST_REVERSE ? "prev" : "next") < 0)
+		return &drgn_enomem;
+	uint64_t next_member_offset;
+	err = drgn_type_offsetof(entry_type.type, next_designator,
+				 &next_member_offset);
+	free(next_designator);
+	if (err)
+		return err;
+	it->next_offset = next_member_offset - it->member_offset;
+
+	if (kind == LINUX_HELPER_LIST || kind == LINUX_HELPER_LIST_REVERSE) {
+		/* The head is a node of the circular list. */
+		it->next_address = it->head_address + it->next_offset;
+	} else {
+		uint64_t first_offset;
+		err = drgn_type_offsetof(drgn_type_type(head_type).type,
+					 "first", &first_offset);
+		if (err)
+			return err;
+		it->next_address = it->head_address + first_offset;
+	}
+
+	uint8_t address_size;
+	err = drgn_program_address_size(prog, &address_size);
+	if (err)
+		return err;
+	err = drgn_pointer_type_create(prog, entry_type, address_size,
+				       DRGN_PROGRAM_ENDIAN,
+				       drgn_type_language(entry_type.type),
+				       &it->entry_pointer_type.type);
+	if (err)
+		return err;
+	it->entry_pointer_type.qualifiers = 0;
+	it->kind = kind;
+	it->done = false;
+	drgn_object_init(&it->entry, prog);
+	return NULL;
+}
+
+void linux_helper_list_iterator_deinit(struct linux_helper_list_iterator *it)
+{
+	drgn_object_deinit(&it->entry);
+}
+
+struct drgn_error *
+linux_helper_list_iterator_next(struct linux_helper_list_iterator *it,
+				const struct drgn_object **ret)
+{
+	struct drgn_error *err;
+
+	if (it->done) {
+		*ret = NULL;
+		return NULL;
+	}
+
+	struct drgn_program *prog = drgn_object_program(&it->entry);
+	uint64_t pos;
+	err = drgn_program_read_word(prog, it->next_address, false, &pos);
+	if (err)
+		return err;
+	switch (it->kind) {
+	case LINUX_HELPER_LIST:
+	case LINUX_HELPER_LIST_REVERSE:
+		it->done = pos == it->head_address;
+		break;
+	case LINUX_HELPER_HLIST:
+		it->done = pos == 0;
+		break;
+	case LINUX_HELPER_HLIST_NULLS:
+		it->done = pos & 1;
+		break;
+	default:
+		UNREACHABLE();
+	}
+	if (it->done) {
+		*ret = NULL;
+		return NULL;
+	}
+
+	err = drgn_object_set_unsigned(&it->entry, it->entry_pointer_type,
+				       pos - it->member_offset, 0);
+	if (err)
+		return err;
+	it->next_address = pos + it->next_offset;
+	*ret = &it->entry;
+	return NULL;
+}
+
+DEFINE_VECTOR_FUNCTIONS(linux_helper_rbtree_frame_vector)
+
+/*
+ * A red-black tree with N nodes has a height of at most 2 * log2(N + 1), so a
+ * deeper stack means that the tree is corrupted and possibly has a cycle.
+ */
+#define LINUX_HELPER_RBTREE_MAX_DEPTH 128
+
+/* Maximum number of bytes of struct rb_node that we read (three words). */
+#define LINUX_HELPER_RBTREE_MAX_READ_SIZE 24
+
+struct drgn_error *
+linux_helper_rbtree_iterator_init(struct linux_helper_rbtree_iterator *it,
+				  const struct drgn_object *root,
+				  struct drgn_qualified_type entry_type,
+				  const char *member_designator)
+{
+	struct drgn_error *err;
+	struct drgn_program *prog = drgn_object_program(root);
+
+	if (member_designator) {
+		err = drgn_type_offsetof(entry_type.type, member_designator,
+					 &it->member_offset);
+		if (err)
+			return err;
+	} else {
+		it->member_offset = 0;
+	}
+
+	struct drgn_qualified_type node_type;
+	err = drgn_program_find_type(prog, "struct rb_node", NULL, &node_type);
+	if (err)
+		return err;
+	err = drgn_type_offsetof(node_type.type, "rb_left", &it->left_offset);
+	if (err)
+		return err;
+	err = drgn_type_offsetof(node_type.type, "rb_right", &it->right_offset);
+	if (err)
+		return err;
+	err = drgn_program_is_64_bit(prog, &it->is_64_bit);
+	if (err)
+		return err;
+	err = drgn_program_bswap(prog, &it->bswap);
+	if (err)
+		return err;
+	it->read_size = max(it->left_offset, it->right_offset) +
+			(it->is_64_bit ? 8 : 4);
+	if (it->read_size > LINUX_HELPER_RBTREE_MAX_READ_SIZE) {
+		return drgn_error_create(DRGN_ERROR_TYPE,
+					 "struct rb_node has unexpected layout");
+	}
+
+	uint8_t address_size;
+	err = drgn_program_address_size(prog, &address_size);
+	if (err)
+		return err;
+	err = drgn_pointer_type_create(prog, entry_type, address_size,
+				       DRGN_PROGRAM_ENDIAN,
+				       drgn_type_language(entry_type.type),
+				       &it->entry_pointer_type.type);
+	if (err)
+		return err;
+	it->entry_pointer_type.qualifiers = 0;
+
+	drgn_object_init(&it->entry, prog);
+	/* Accept struct rb_root as well as struct rb_root *. */
+	struct drgn_type *root_type = drgn_underlying_type(root->type);
+	if (drgn_type_kind(root_type) == DRGN_TYPE_POINTER) {
+		err = drgn_object_member_dereference(&it->entry, root,
+						     "rb_node");
+	} else {
+		err = drgn_object_member(&it->entry, root, "rb_node");
+	}
+	if (!err)
+		err = drgn_object_read_unsigned(&it->entry, &it->next);
+	if (err) {
+		drgn_object_deinit(&it->entry);
+		return err;
+	}
+	linux_helper_rbtree_frame_vector_init(&it->stack);
+	return NULL;
+}
+
+void
+linux_helper_rbtree_iterator_deinit(struct linux_helper_rbtree_iterator *it)
+{
+	linux_helper_rbtree_frame_vector_deinit(&it->stack);
+	drgn_object_deinit(&it->entry);
+}
+
+struct drgn_error *
+linux_helper_rbtree_iterator_next(struct linux_helper_rbtree_iterator *it,
+				  const struct drgn_object **ret)
+{
+	struct drgn_error *err;
+	struct drgn_program *prog = drgn_object_program(&it->entry);
+
+	/* Descend to the leftmost node of the next subtree. */
+	while (it->next) {
+		if (it->stack.size >= LINUX_HELPER_RBTREE_MAX_DEPTH) {
+			return drgn_error_create(DRGN_ERROR_OTHER,
+						 "red-black tree is too deep");
+		}
+		char node[LINUX_HELPER_RBTREE_MAX_READ_SIZE];
+		err = drgn_program_read_memory(prog, node, it->next,
+					       it->read_size, false);
+		if (err)
+			return err;
+		struct linux_helper_rbtree_frame *frame =
+			linux_helper_rbtree_frame_vector_append_entry(&it->stack);
+		if (!frame)
+			return &drgn_enomem;
+		frame->node = it->next;
+		frame->right = linux_helper_buffer_word(node + it->right_offset,
+							it->is_64_bit,
+							it->bswap);
+		it->next = linux_helper_buffer_word(node + it->left_offset,
+						    it->is_64_bit, it->bswap);
+	}
+
+	if (!it->stack.size) {
+		*ret = NULL;
+		return NULL;
+	}
+	struct linux_helper_rbtree_frame *frame =
+		linux_helper_rbtree_frame_vector_pop(&it->stack);
+	err = drgn_object_set_unsigned(&it->entry, it->entry_pointer_type,
+				       frame->node - it->member_offset, 0);
+	if (err)
+		return err;
+	it->next = frame->right;
+	*ret = &it->entry;
+	return NULL;
+}
+
+/* Number of page structures read at once by a page scanner. */
+#define LINUX_HELPER_PAGES_CHUNK 512
+
+struct drgn_error *
+linux_helper_page_scanner_init(struct linux_helper_page_scanner *scanner,
+			       struct drgn_program *prog)
+{
+	struct drgn_error *err;
+
+	scanner->prog = prog;
+	scanner->pages = NULL;
+	scanner->pfn = 0;
+	scanner->pages_pfn = 0;
+	scanner->num_pages = 0;
+	scanner->fault_end_pfn = 0;
+	if (!(prog->flags & DRGN_PROGRAM_IS_LINUX_KERNEL)) {
+		return drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+					 "not Linux kernel");
+	}
+	err = drgn_program_is_64_bit(prog, &scanner->is_64_bit);
+	if (err)
+		return err;
+	err = drgn_program_bswap(prog, &scanner->bswap);
+	if (err)
+		return err;
+
+	struct drgn_object tmp;
+	drgn_object_init(&tmp, prog);
+	err = drgn_program_find_object(prog, "vmemmap", NULL,
+				       DRGN_FIND_OBJECT_ANY, &tmp);
+	if (err)
+		goto out;
+	scanner->page_type =
+		drgn_type_type(drgn_underlying_type(tmp.type)).type;
+	err = drgn_object_read_unsigned(&tmp, &scanner->vmemmap);
+	if (err)
+		goto out;
+	err = drgn_type_sizeof(scanner->page_type,
+			       &scanner->page_struct_size);
+	if (err)
+		goto out;
+
+	err = drgn_program_find_object(prog, "max_pfn", NULL,
+				       DRGN_FIND_OBJECT_ANY, &tmp);
+	if (err)
+		goto out;
+	err = drgn_object_read_unsigned(&tmp, &scanner->max_pfn);
+	if (err)
+		goto out;
+
+	scanner->pages = malloc_array(LINUX_HELPER_PAGES_CHUNK,
+				      scanner->page_struct_size);
+	if (!scanner->pages)
+		err = &drgn_enomem;
+out:
+	drgn_object_deinit(&tmp);
+	return err;
+}
+
+void
+linux_helper_page_scanner_deinit(struct linux_helper_page_scanner *scanner)
+{
+	free(scanner->pages);
+}
+
+struct drgn_error *
+linux_helper_page_scanner_next(struct linux_helper_page_scanner *scanner,
+			       uint64_t *pfn_ret, const char **page_ret)
+{
+	struct drgn_error *err;
+
+	while (scanner->pfn < scanner->max_pfn) {
+		if (scanner->pfn >= scanner->pages_pfn &&
+		    scanner->pfn - scanner->pages_pfn < scanner->num_pages) {
+			*pfn_ret = scanner->pfn;
+			*page_ret = (scanner->pages +
+				     (scanner->pfn - scanner->pages_pfn) *
+				     scanner->page_struct_size);
+			scanner->pfn++;
+			return NULL;
+		}
+
+		/*
+		 * If a bulk read fails, read the pages it covered one at a
+		 * time so that only the pages in holes of the page array are
+		 * skipped.
+		 */
+		uint64_t count = min(scanner->max_pfn - scanner->pfn,
+				     (uint64_t)LINUX_HELPER_PAGES_CHUNK);
+		if (scanner->pfn < scanner->fault_end_pfn)
+			count = 1;
+		err = drgn_program_read_memory(scanner->prog, scanner->pages,
+					       scanner->vmemmap +
+					       scanner->pfn *
+					       scanner->page_struct_size,
+					       count * scanner->page_struct_size,
+					       false);
+		if (!err) {
+			scanner->pages_pfn = scanner->pfn;
+			scanner->num_pages = count;
+			continue;
+		}
+		if (err->code != DRGN_ERROR_FAULT)
+			return err;
+		drgn_error_destroy(err);
+		scanner->num_pages = 0;
+		if (count == 1)
+			scanner->pfn++;
+		else
+			scanner->fault_end_pfn = scanner->pfn + count;
+	}
+	*page_ret = NULL;
+	return NULL;
+}
+
+DEFINE_VECTOR(linux_helper_pfn_vector, uint64_t)
+
+struct drgn_error *
+linux_helper_find_pages(struct drgn_program *prog,
+			const struct linux_helper_page_filter *filter,
+			uint64_t **pfns_ret, size_t *num_pfns_ret)
+{
+	struct drgn_error *err;
+
+	struct linux_helper_page_scanner scanner;
+	err = linux_helper_page_scanner_init(&scanner, prog);
+	if (err)
+		goto out_scanner;
+
+	uint64_t flags_offset, mapping_offset = 0, refcount_offset = 0;
+	err = drgn_type_offsetof(scanner.page_type, "flags", &flags_offset);
+	if (err)
+		goto out_scanner;
+	if (filter->match_mapping) {
+		err = drgn_type_offsetof(scanner.page_type, "mapping",
+					 &mapping_offset);
+		if (err)
+			goto out_scanner;
+	}
+	if (filter->match_refcount) {
+		err = drgn_type_offsetof(scanner.page_type,
+					 "_refcount.counter",
+					 &refcount_offset);
+		if (err && err->code == DRGN_ERROR_LOOKUP) {
+			/*
+			 * Before Linux kernel commit 0139aa7b7fa1 ("mm: rename
+			 * _count, field of the struct page, to _refcount") (in
+			 * v4.7), the reference count is _count.
+			 */
+			drgn_error_destroy(err);
+			err = drgn_type_offsetof(scanner.page_type,
+						 "_count.counter",
+						 &refcount_offset);
+		}
+		if (err)
+			goto out_scanner;
+	}
+
+	struct linux_helper_pfn_vector pfns = VECTOR_INIT;
+	for (;;) {
+		uint64_t pfn;
+		const char *page;
+		err = linux_helper_page_scanner_next(&scanner, &pfn, &page);
+		if (err) {
+			linux_helper_pfn_vector_deinit(&pfns);
+			goto out_scanner;
+		}
+		if (!page)
+			break;
+		uint64_t flags = linux_helper_page_scanner_word(&scanner, page,
+								flags_offset);
+		if ((flags & filter->flags_mask) != filter->flags_value)
+			continue;
+		if (filter->match_mapping &&
+		    linux_helper_page_scanner_word(&scanner, page,
+						   mapping_offset) != filter->mapping)
+			continue;
+		if (filter->match_refcount &&
+		    (int32_t)linux_helper_page_scanner_u32(&scanner, page,
+							   refcount_offset) <
+		    filter->min_refcount)
+			continue;
+		if (!linux_helper_pfn_vector_append(&pfns, &pfn)) {
+			linux_helper_pfn_vector_deinit(&pfns);
+			err = &drgn_enomem;
+			goto out_scanner;
+		}
+	}
+	linux_helper_pfn_vector_shrink_to_fit(&pfns);
+	*pfns_ret = pfns.data;
+	*num_pfns_ret = pfns.size;
+out_scanner:
+	linux_helper_page_scanner_deinit(&scanner);
+	return err;
+}
+
+DEFINE_HASH_SET_FUNCTIONS(linux_helper_address_set, int_key_hash_pair,
+			  scalar_key_eq)
+DEFINE_VECTOR_FUNCTIONS(linux_helper_address_vector)
+
+/*
+ * Maximum number of slabs decoded in parallel by a slab object iterator before
+ * their objects are returned.
+ */
+#define LINUX_HELPER_SLAB_BATCH_SIZE 256
+
+/*
+ * Get the pointer to the next free object from the freelist pointer at the
+ * given address, undoing the obfuscation of CONFIG_SLAB_FREELIST_HARDENED.
+ */
+static uint64_t
+linux_helper_slub_freelist_decode(struct linux_helper_slab_object_iterator *it,
+				  uint64_t ptr_addr, uint64_t value)
+{
+	if (!it->freelist_hardened)
+		return value;
+	uint64_t swapped = it->page_scanner.is_64_bit ? bswap_64(ptr_addr)
+					 : bswap_32((uint32_t)ptr_addr);
+	return value ^ it->freelist_random ^ swapped;
+}
+
+/*
+ * Call a function for each CPU in a CPU mask (struct cpumask). The callback
+ * must not hold on to the CPU mask object.
+ */
+static struct drgn_error *
+linux_helper_for_each_cpu(const struct drgn_object *cpumask,
+			  struct drgn_error *(*cb)(uint64_t, void *),
+			  void *arg)
+{
+	struct drgn_error *err;
+	struct drgn_program *prog = drgn_object_program(cpumask);
+	struct drgn_object mask, word_obj;
+	drgn_object_init(&mask, prog);
+	drgn_object_init(&word_obj, prog);
+
+	uint64_t nr_cpu_ids;
+	err = drgn_program_find_object(prog, "nr_cpu_ids", NULL,
+				       DRGN_FIND_OBJECT_ANY, &mask);
+	if (!err) {
+		union drgn_value value;
+		err = drgn_object_read_integer(&mask, &value);
+		if (err)
+			goto out;
+		nr_cpu_ids = value.uvalue;
+	} else if (err->code == DRGN_ERROR_LOOKUP) {
+		drgn_error_destroy(err);
+		nr_cpu_ids = 1;
+	} else {
+		goto out;
+	}
+
+	err = drgn_object_member(&mask, cpumask, "bits");
+	if (err)
+		goto out;
+
+	uint64_t bits_per_word;
+	err = drgn_type_sizeof(drgn_type_type(drgn_underlying_type(mask.type)).type,
+			       &bits_per_word);
+	if (err)
+		goto out;
+	bits_per_word *= 8;
+	for (uint64_t i = 0; i < nr_cpu_ids; i += bits_per_word) {
+		err = drgn_object_subscript(&word_obj, &mask, i / bits_per_word);
+		if (err)
+			goto out;
+		uint64_t word;
+		err = drgn_object_read_unsigned(&word_obj, &word);
+		if (err)
+			goto out;
+		for (uint64_t bit = 0; word && bit < bits_per_word; bit++) {
+			if (!(word & (UINT64_C(1) << bit)))
+				continue;
+			word &= ~(UINT64_C(1) << bit);
+			if (i + bit >= nr_cpu_ids)
+				break;
+			err = cb(i + bit, arg);
+			if (err)
+				goto out;
+		}
+	}
+	err = NULL;
+out:
+	drgn_object_deinit(&word_obj);
+	drgn_object_deinit(&mask);
+	return err;
+}
+
+/* Call a function for each online CPU. */
+static struct drgn_error *
+linux_helper_for_each_online_cpu(struct drgn_program *prog,
+				 struct drgn_error *(*cb)(uint64_t, void *),
+				 void *arg)
+{
+	struct drgn_error *err;
+	struct drgn_object mask;
+	drgn_object_init(&mask, prog);
+	err = drgn_program_find_object(prog, "__cpu_online_mask", NULL,
+				       DRGN_FIND_OBJECT_ANY, &mask);
+	if (err && err->code == DRGN_ERROR_LOOKUP) {
+		/*
+		 * Before Linux kernel commit c4c54dd1caf1 ("kernel/cpu.c:
+		 * change type of cpu_possible_bits and friends") (in v4.5),
+		 * the CPU mask is struct cpumask *cpu_online_mask.
+		 */
+		drgn_error_destroy(err);
+		err = drgn_program_find_object(prog, "cpu_online_mask", NULL,
+					       DRGN_FIND_OBJECT_ANY, &mask);
+		if (err)
+			goto out;
+		err = drgn_object_dereference(&mask, &mask);
+	}
+	if (!err)
+		err = linux_helper_for_each_cpu(&mask, cb, arg);
+out:
+	drgn_object_deinit(&mask);
+	return err;
+}
+
+struct linux_helper_slab_cpu_arg {
+	struct linux_helper_slab_object_iterator *it;
+	const struct drgn_object *percpu;
+	/* SLUB: name of the current slab member of struct kmem_cache_cpu. */
+	const char *cpu_slab_member;
+};
+
+static struct drgn_error *linux_helper_slub_cpu_freelist(uint64_t cpu,
+							 void *arg_)
+{
+	struct drgn_error *err;
+	struct linux_helper_slab_cpu_arg *arg = arg_;
+	struct linux_helper_slab_object_iterator *it = arg->it;
+	struct drgn_program *prog = drgn_object_program(arg->percpu);
+
+	struct drgn_object cpu_slab, tmp;
+	drgn_object_init(&cpu_slab, prog);
+	drgn_object_init(&tmp, prog);
+	err = linux_helper_per_cpu_ptr(&cpu_slab, arg->percpu, cpu);
+	if (err)
+		goto out;
+	err = drgn_object_member_dereference(&tmp, &cpu_slab,
+					     arg->cpu_slab_member);
+	if (err)
+		goto out;
+	uint64_t slab;
+	err = drgn_object_read_unsigned(&tmp, &slab);
+	if (err || !slab)
+		goto out;
+	err = drgn_object_member_dereference(&tmp, &tmp, "slab_cache");
+	if (err)
+		goto out;
+	uint64_t slab_cache;
+	err = drgn_object_read_unsigned(&tmp, &slab_cache);
+	if (err || slab_cache != it->slab_cache_address)
+		goto out;
+
+	err = drgn_object_member_dereference(&tmp, &cpu_slab, "freelist");
+	if (err)
+		goto out;
+	uint64_t ptr;
+	err = drgn_object_read_unsigned(&tmp, &ptr);
+	if (err)
+		goto out;
+	while (ptr) {
+		int r = linux_helper_address_set_insert(&it->cpu_free, &ptr,
+							NULL);
+		if (r < 0) {
+			err = &drgn_enomem;
+			goto out;
+		}
+		/* Stop if the freelist is corrupted into a cycle. */
+		if (r == 0)
+			break;
+		uint64_t ptr_addr = ptr + it->freelist_offset;
+		uint64_t value;
+		err = drgn_program_read_word(prog, ptr_addr, false, &value);
+		if (err)
+			goto out;
+		ptr = linux_helper_slub_freelist_decode(it, ptr_addr, value);
+	}
+out:
+	drgn_object_deinit(&tmp);
+	drgn_object_deinit(&cpu_slab);
+	return err;
+}
+
+static struct drgn_error *linux_helper_slab_cpu_cache(uint64_t cpu, void *arg_)
+{
+	struct drgn_error *err;
+	struct linux_helper_slab_cpu_arg *arg = arg_;
+	struct linux_helper_slab_object_iterator *it = arg->it;
+	struct drgn_program *prog = drgn_object_program(arg->percpu);
+
+	struct drgn_object ac, tmp;
+	drgn_object_init(&ac, prog);
+	drgn_object_init(&tmp, prog);
+	err = linux_helper_per_cpu_ptr(&ac, arg->percpu, cpu);
+	if (err)
+		goto out;
+	err = drgn_object_member_dereference(&tmp, &ac, "avail");
+	if (err)
+		goto out;
+	uint64_t avail;
+	err = drgn_object_read_unsigned(&tmp, &avail);
+	if (err)
+		goto out;
+	err = drgn_object_member_dereference(&tmp, &ac, "entry");
+	if (err)
+		goto out;
+	err = drgn_object_address_of(&tmp, &tmp);
+	if (err)
+		goto out;
+	uint64_t entry_address;
+	err = drgn_object_read_unsigned(&tmp, &entry_address);
+	if (err)
+		goto out;
+	uint64_t word_size = it->page_scanner.is_64_bit ? 8 : 4;
+	for (uint64_t i = 0; i < avail; i++) {
+		uint64_t addr;
+		err = drgn_program_read_word(prog, entry_address + i * word_size,
+					     false, &addr);
+		if (err)
+			goto out;
+		if (linux_helper_address_set_insert(&it->cpu_free, &addr,
+						    NULL) < 0) {
+			err = &drgn_enomem;
+			goto out;
+		}
+	}
+out:
+	drgn_object_deinit(&tmp);
+	drgn_object_deinit(&ac);
+	return err;
+}
+
+/*
+ * Read an integer or pointer member of a structure pointed to by an object. If
+ * the member doesn't exist, return default_value if it is non-NULL or the
+ * lookup error otherwise.
+ */
+static struct drgn_error *
+linux_helper_read_member_integer(const struct drgn_object *ptr,
+				 const char *member, struct drgn_object *tmp,
+				 const uint64_t *default_value, uint64_t *ret)
+{
+	struct drgn_error *err;
+	err = drgn_object_member_dereference(tmp, ptr, member);
+	if (!err) {
+		union drgn_value value;
+		err = drgn_object_read_integer(tmp, &value);
+		if (!err)
+			*ret = value.uvalue;
+		return err;
+	}
+	if (err->code == DRGN_ERROR_LOOKUP && default_value) {
+		drgn_error_destroy(err);
+		*ret = *default_value;
+		return NULL;
+	}
+	return err;
+}
+
+static struct drgn_error *
+linux_helper_slab_object_iterator_init_cache(struct linux_helper_slab_object_iterator *it,
+					     const struct drgn_object *slab_cache)
+{
+	static const uint64_t zero = 0;
+	struct drgn_error *err;
+	struct drgn_program *prog = drgn_object_program(slab_cache);
+
+	struct drgn_qualified_type freelist_idx_type;
+	err = drgn_program_find_type(prog, "freelist_idx_t", NULL,
+				     &freelist_idx_type);
+	if (!err) {
+		it->slub = false;
+		err = drgn_type_sizeof(freelist_idx_type.type,
+				       &it->freelist_offset);
+		if (err)
+			return err;
+		if (it->freelist_offset != 1 && it->freelist_offset != 2) {
+			return drgn_error_create(DRGN_ERROR_OTHER,
+						 "unsupported freelist_idx_t size");
+		}
+	} else if (err->code == DRGN_ERROR_LOOKUP) {
+		drgn_error_destroy(err);
+		it->slub = true;
+	} else {
+		return err;
+	}
+
+	struct drgn_object tmp;
+	drgn_object_init(&tmp, prog);
+	err = linux_helper_read_member_integer(slab_cache, "size", &tmp, NULL,
+					       &it->object_size);
+	if (err)
+		goto out;
+
+	struct linux_helper_slab_cpu_arg arg = { .it = it, .percpu = &tmp };
+	if (it->slub) {
+		err = linux_helper_read_member_integer(slab_cache,
+						       "red_left_pad", &tmp,
+						       &zero,
+						       &it->object_offset);
+		if (err)
+			goto out;
+		/*
+		 * In SLUB, the freelist is a linked list with the next pointer
+		 * located at ptr + slab_cache->offset.
+		 */
+		err = linux_helper_read_member_integer(slab_cache, "offset",
+						       &tmp, NULL,
+						       &it->freelist_offset);
+		if (err && err->code == DRGN_ERROR_LOOKUP) {
+			drgn_error_destroy(err);
+			err = drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+						"SLOB is not supported");
+		}
+		if (err)
+			goto out;
+		/*
+		 * If CONFIG_SLAB_FREELIST_HARDENED is enabled, then the next
+		 * pointer is obfuscated using slab_cache->random.
+		 */
+		err = drgn_object_member_dereference(&tmp, slab_cache,
+						     "random");
+		if (!err) {
+			it->freelist_hardened = true;
+			err = drgn_object_read_unsigned(&tmp,
+							&it->freelist_random);
+			if (err)
+				goto out;
+		} else if (err->code == DRGN_ERROR_LOOKUP) {
+			drgn_error_destroy(err);
+			it->freelist_hardened = false;
+		} else {
+			goto out;
+		}
+
+		err = drgn_object_member_dereference(&tmp, slab_cache,
+						     "cpu_slab");
+		if (err)
+			goto out;
+		/*
+		 * Since Linux kernel commit bb192ed9aa71 ("mm/slub: Convert
+		 * most struct page to struct slab by spatch") (in v5.17), the
+		 * current slab for a CPU is `struct slab *slab`. Before that,
+		 * it is `struct page *page`.
+		 */
+		struct drgn_type_member *member;
+		uint64_t bit_offset;
+		err = drgn_type_find_member(drgn_type_type(drgn_underlying_type(tmp.type)).type,
+					    "slab", &member, &bit_offset);
+		if (!err) {
+			arg.cpu_slab_member = "slab";
+		} else if (err->code == DRGN_ERROR_LOOKUP) {
+			drgn_error_destroy(err);
+			arg.cpu_slab_member = "page";
+		} else {
+			goto out;
+		}
+		err = linux_helper_for_each_online_cpu(prog,
+						       linux_helper_slub_cpu_freelist,
+						       &arg);
+	} else {
+		err = linux_helper_read_member_integer(slab_cache,
+						       "obj_offset", &tmp,
+						       &zero,
+						       &it->object_offset);
+		if (err)
+			goto out;
+		err = linux_helper_read_member_integer(slab_cache, "num",
+						       &tmp, NULL,
+						       &it->objects_per_slab);
+		if (err)
+			goto out;
+		err = drgn_object_member_dereference(&tmp, slab_cache,
+						     "cpu_cache");
+		if (err)
+			goto out;
+		err = linux_helper_for_each_online_cpu(prog,
+						       linux_helper_slab_cpu_cache,
+						       &arg);
+	}
+out:
+	drgn_object_deinit(&tmp);
+	return err;
+}
+
+static struct drgn_error *
+linux_helper_slab_object_iterator_init_pages(struct linux_helper_slab_object_iterator *it,
+					     struct drgn_program *prog)
+{
+	struct drgn_error *err;
+
+	if (!prog->vmcoreinfo.page_size) {
+		return drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+					 "not Linux kernel");
+	}
+	it->page_size = prog->vmcoreinfo.page_size;
+	err = drgn_type_offsetof(it->page_scanner.page_type, "flags",
+				 &it->page_flags_offset);
+	if (err)
+		return err;
+
+	struct drgn_object tmp;
+	drgn_object_init(&tmp, prog);
+	err = drgn_program_find_object(prog, "PAGE_OFFSET", NULL,
+				       DRGN_FIND_OBJECT_ANY, &tmp);
+	if (err)
+		goto out;
+	err = drgn_object_read_unsigned(&tmp, &it->page_offset);
+	if (err)
+		goto out;
+
+	err = drgn_program_find_object(prog, "PG_slab", NULL,
+				       DRGN_FIND_OBJECT_CONSTANT, &tmp);
+	if (err)
+		goto out;
+	union drgn_value pg_slab;
+	err = drgn_object_read_integer(&tmp, &pg_slab);
+	if (err)
+		goto out;
+	if (pg_slab.uvalue >= 64) {
+		err = drgn_error_create(DRGN_ERROR_OTHER,
+					"PG_slab is out of range");
+		goto out;
+	}
+	it->pg_slab_mask = UINT64_C(1) << pg_slab.uvalue;
+
+	/*
+	 * Linux kernel commit d122019bf061 ("mm: Split slab into its own
+	 * type") (in v5.17) moved slab information from struct page to struct
+	 * slab. The former can be casted to the latter.
+	 */
+	struct drgn_qualified_type slab_type;
+	err = drgn_program_find_type(prog, "struct slab *", NULL, &slab_type);
+	if (err && err->code == DRGN_ERROR_LOOKUP) {
+		drgn_error_destroy(err);
+		err = drgn_program_find_type(prog, "struct page *", NULL,
+					     &slab_type);
+	}
+	if (err)
+		goto out;
+	struct drgn_type *slab_struct_type =
+		drgn_underlying_type(drgn_type_type(slab_type.type).type);
+	/*
+	 * The slab is decoded from the struct page that was read from the page
+	 * array, so struct slab must fit in it.
+	 */
+	uint64_t slab_struct_size;
+	err = drgn_type_sizeof(slab_struct_type, &slab_struct_size);
+	if (err)
+		goto out;
+	if (slab_struct_size > it->page_scanner.page_struct_size) {
+		err = drgn_error_create(DRGN_ERROR_OTHER,
+					"slab is larger than page");
+		goto out;
+	}
+	err = drgn_type_offsetof(slab_struct_type, "slab_cache",
+				 &it->slab_cache_offset);
+	if (err)
+		goto out;
+	err = linux_helper_field_init(&it->slab_freelist, slab_struct_type,
+				      "freelist", true);
+	if (err)
+		goto out;
+	if (it->slub) {
+		err = linux_helper_field_init(&it->slab_objects,
+					      slab_struct_type, "objects",
+					      true);
+	} else {
+		err = linux_helper_field_init(&it->slab_active,
+					      slab_struct_type, "active", true);
+		if (err)
+			goto out;
+		err = linux_helper_field_init(&it->slab_s_mem,
+					      slab_struct_type, "s_mem", true);
+	}
+out:
+	drgn_object_deinit(&tmp);
+	return err;
+}
+
+struct drgn_error *
+linux_helper_slab_object_iterator_init(struct linux_helper_slab_object_iterator *it,
+				       const struct drgn_object *slab_cache,
+				       struct drgn_qualified_type entry_type)
+{
+	struct drgn_error *err;
+	struct drgn_program *prog = drgn_object_program(slab_cache);
+
+	drgn_object_init(&it->entry, prog);
+	linux_helper_address_set_init(&it->cpu_free);
+	linux_helper_address_vector_init(&it->objects);
+	it->next_object = 0;
+	it->little_endian = drgn_platform_is_little_endian(&prog->platform);
+	it->batch_pfns = NULL;
+	it->batch_pages = NULL;
+	it->batch_objects = NULL;
+
+	err = linux_helper_page_scanner_init(&it->page_scanner, prog);
+	if (err)
+		goto err;
+	it->batch_pfns = malloc_array(LINUX_HELPER_SLAB_BATCH_SIZE,
+				      sizeof(it->batch_pfns[0]));
+	it->batch_pages = malloc_array(LINUX_HELPER_SLAB_BATCH_SIZE,
+				       it->page_scanner.page_struct_size);
+	it->batch_objects = malloc_array(LINUX_HELPER_SLAB_BATCH_SIZE,
+					 sizeof(it->batch_objects[0]));
+	if (!it->batch_pfns || !it->batch_pages || !it->batch_objects) {
+		err = &drgn_enomem;
+		goto err;
+	}
+	for (size_t i = 0; i < LINUX_HELPER_SLAB_BATCH_SIZE; i++)
+		linux_helper_address_vector_init(&it->batch_objects[i]);
+	uint8_t address_size = it->page_scanner.is_64_bit ? 8 : 4;
+	err = drgn_pointer_type_create(prog, entry_type, address_size,
+				       DRGN_PROGRAM_ENDIAN,
+				       drgn_type_language(entry_type.type),
+				       &it->entry_pointer_type.type);
+	if (err)
+		goto err;
+	it->entry_pointer_type.qualifiers = 0;
+
+	err = drgn_object_read_unsigned(slab_cache, &it->slab_cache_address);
+	if (err)
+		goto err;
+	err = linux_helper_slab_object_iterator_init_cache(it, slab_cache);
+	if (err)
+		goto err;
+	err = linux_helper_slab_object_iterator_init_pages(it, prog);
+	if (err)
+		goto err;
+	return NULL;
+
+err:
+	linux_helper_slab_object_iterator_deinit(it);
+	return err;
+}
+
+void
+linux_helper_slab_object_iterator_deinit(struct linux_helper_slab_object_iterator *it)
+{
+	if (it->batch_objects) {
+		for (size_t i = 0; i < LINUX_HELPER_SLAB_BATCH_SIZE; i++) {
+			struct linux_helper_address_vector *objects =
+				&it->batch_objects[i];
+			linux_helper_address_vector_deinit(objects);
+		}
+		free(it->batch_objects);
+	}
+	free(it->batch_pages);
+	free(it->batch_pfns);
+	linux_helper_page_scanner_deinit(&it->page_scanner);
+	linux_helper_address_vector_deinit(&it->objects);
+	linux_helper_address_set_deinit(&it->cpu_free);
+	drgn_object_deinit(&it->entry);
+}
+
+static void
+linux_helper_slab_buffers_deinit(struct linux_helper_slab_buffers *buffers)
+{
+	free(buffers->free_bitmap);
+	free(buffers->slab_buf);
+}
+
+static bool linux_helper_slab_reserve(struct linux_helper_slab_buffers *buffers,
+				      uint64_t num_objects, uint64_t buf_size)
+{
+	if (buf_size > buffers->slab_buf_size) {
+		if (buf_size > SIZE_MAX)
+			return false;
+		free(buffers->slab_buf);
+		buffers->slab_buf = malloc(buf_size);
+		if (!buffers->slab_buf) {
+			buffers->slab_buf_size = 0;
+			return false;
+		}
+		buffers->slab_buf_size = buf_size;
+	}
+	size_t bitmap_size = num_objects / 64 + 1;
+	if (bitmap_size > buffers->free_bitmap_size) {
+		free(buffers->free_bitmap);
+		buffers->free_bitmap =
+			malloc_array(bitmap_size,
+				     sizeof(buffers->free_bitmap[0]));
+		if (!buffers->free_bitmap) {
+			buffers->free_bitmap_size = 0;
+			return false;
+		}
+		buffers->free_bitmap_size = bitmap_size;
+	}
+	memset(buffers->free_bitmap, 0,
+	       bitmap_size * sizeof(buffers->free_bitmap[0]));
+	return true;
+}
+
+static inline void linux_helper_slab_set_free(uint64_t *bitmap, uint64_t i)
+{
+	bitmap[i / 64] |= UINT64_C(1) << (i % 64);
+}
+
+static inline bool linux_helper_slab_is_free(const uint64_t *bitmap,
+					     uint64_t i)
+{
+	return bitmap[i / 64] & (UINT64_C(1) << (i % 64));
+}
+
+/* Append the allocated objects of a decoded slab to a vector. */
+static struct drgn_error *
+linux_helper_slab_add_objects(struct linux_helper_slab_object_iterator *it,
+			      const uint64_t *free_bitmap, uint64_t start,
+			      uint64_t num_objects,
+			      struct linux_helper_address_vector *objects)
+{
+	if (!linux_helper_address_vector_reserve(objects,
+						 objects->size + num_objects))
+		return &drgn_enomem;
+	for (uint64_t i = 0; i < num_objects; i++) {
+		if (linux_helper_slab_is_free(free_bitmap, i))
+			continue;
+		uint64_t addr = start + i * it->object_size;
+		if (linux_helper_address_set_search(&it->cpu_free,
+						    &addr).entry)
+			continue;
+		objects->data[objects->size++] = addr;
+	}
+	return NULL;
+}
+
+static struct drgn_error *
+linux_helper_slub_decode_slab(struct linux_helper_slab_object_iterator *it,
+			      struct linux_helper_slab_buffers *buffers,
+			      uint64_t pfn, const char *page,
+			      struct linux_helper_address_vector *objects,
+			      uint64_t *start_ret, uint64_t *end_ret)
+{
+	struct drgn_error *err;
+
+	uint64_t num_objects = linux_helper_field_read(&it->slab_objects, page,
+						       it->little_endian);
+	uint64_t freelist = linux_helper_field_read(&it->slab_freelist, page,
+						    it->little_endian);
+	uint64_t start = it->page_offset + pfn * it->page_size +
+			 it->object_offset;
+	uint64_t size = num_objects * it->object_size;
+	*start_ret = start;
+	*end_ret = start + size;
+	if (!linux_helper_slab_reserve(buffers, num_objects, size))
+		return &drgn_enomem;
+	/* Read all of the objects at once to follow the freelist. */
+	err = drgn_program_read_memory(it->page_scanner.prog,
+				       buffers->slab_buf, start, size, false);
+	if (err)
+		return err;
+
+	uint64_t word_size = it->page_scanner.is_64_bit ? 8 : 4;
+	uint64_t ptr = freelist;
+	while (ptr) {
+		/*
+		 * A valid freelist only contains objects in its own slab. Stop
+		 * if it goes elsewhere or loops.
+		 */
+		if (ptr < start || ptr - start >= size ||
+		    (ptr - start) % it->object_size)
+			break;
+		uint64_t i = (ptr - start) / it->object_size;
+		if (linux_helper_slab_is_free(buffers->free_bitmap, i))
+			break;
+		linux_helper_slab_set_free(buffers->free_bitmap, i);
+		uint64_t offset = ptr - start + it->freelist_offset;
+		if (size < word_size || offset > size - word_size)
+			break;
+		uint64_t value =
+			linux_helper_page_scanner_word(&it->page_scanner,
+						       buffers->slab_buf,
+						       offset);
+		ptr = linux_helper_slub_freelist_decode(it, start + offset,
+							value);
+	}
+	return linux_helper_slab_add_objects(it, buffers->free_bitmap, start,
+					     num_objects, objects);
+}
+
+static struct drgn_error *
+linux_helper_slab_decode_slab(struct linux_helper_slab_object_iterator *it,
+			      struct linux_helper_slab_buffers *buffers,
+			      const char *page,
+			      struct linux_helper_address_vector *objects,
+			      uint64_t *start_ret, uint64_t *end_ret)
+{
+	struct drgn_error *err;
+
+	uint64_t freelist = linux_helper_field_read(&it->slab_freelist, page,
+						    it->little_endian);
+	uint64_t active = linux_helper_field_read(&it->slab_active, page,
+						  it->little_endian);
+	uint64_t s_mem = linux_helper_field_read(&it->slab_s_mem, page,
+						 it->little_endian);
+
+	uint64_t num_objects = it->objects_per_slab;
+	if (active > num_objects)
+		active = num_objects;
+	uint64_t start = s_mem + it->object_offset;
+	*start_ret = start;
+	*end_ret = start + num_objects * it->object_size;
+	/* In SLAB, the freelist is an array of free object indices. */
+	uint64_t idx_size = it->freelist_offset;
+	uint64_t size = (num_objects - active) * idx_size;
+	if (!linux_helper_slab_reserve(buffers, num_objects, size))
+		return &drgn_enomem;
+	err = drgn_program_read_memory(it->page_scanner.prog,
+				       buffers->slab_buf,
+				       freelist + active * idx_size, size,
+				       false);
+	if (err)
+		return err;
+	for (uint64_t i = 0; i < num_objects - active; i++) {
+		uint64_t idx;
+		if (idx_size == 1) {
+			idx = (uint8_t)buffers->slab_buf[i];
+		} else {
+			uint16_t idx16;
+			memcpy(&idx16, buffers->slab_buf + 2 * i,
+			       sizeof(idx16));
+			idx = it->page_scanner.bswap ? bswap_16(idx16) : idx16;
+		}
+		if (idx < num_objects)
+			linux_helper_slab_set_free(buffers->free_bitmap, idx);
+	}
+	return linux_helper_slab_add_objects(it, buffers->free_bitmap, start,
+					     num_objects, objects);
+}
+
+/*
+ * Append the allocated objects of the slab at a PFN to a vector, and return
+ * the range of its objects. page is the struct page read from the page array.
+ * This only reads it, so slabs of the same cache can be decoded in parallel
+ * with separate buffers.
+ */
+static struct drgn_error *
+linux_helper_slab_decode(struct linux_helper_slab_object_iterator *it,
+			 struct linux_helper_slab_buffers *buffers,
+			 uint64_t pfn, const char *page,
+			 struct linux_helper_address_vector *objects,
+			 uint64_t *start_ret, uint64_t *end_ret)
+{
+	if (it->slub) {
+		return linux_helper_slub_decode_slab(it, buffers, pfn, page,
+						     objects, start_ret,
+						     end_ret);
+	} else {
+		return linux_helper_slab_decode_slab(it, buffers, page, objects,
+						     start_ret, end_ret);
+	}
+}
+
+/*
+ * Find the next batch of slabs in the cache and decode their allocated objects
+ * into it->objects.
+ */
+static struct drgn_error *
+linux_helper_slab_next_batch(struct linux_helper_slab_object_iterator *it)
+{
+	struct drgn_error *err;
+	struct linux_helper_page_scanner *scanner = &it->page_scanner;
+	struct drgn_program *prog = scanner->prog;
+
+	size_t num_slabs = 0;
+	while (num_slabs < LINUX_HELPER_SLAB_BATCH_SIZE) {
+		uint64_t pfn;
+		const char *page;
+		err = linux_helper_page_scanner_next(scanner, &pfn, &page);
+		if (err)
+			return err;
+		if (!page)
+			break;
+		uint64_t flags =
+			linux_helper_page_scanner_word(scanner, page,
+						       it->page_flags_offset);
+		if (!(flags & it->pg_slab_mask))
+			continue;
+		uint64_t slab_cache =
+			linux_helper_page_scanner_word(scanner, page,
+						       it->slab_cache_offset);
+		if (slab_cache != it->slab_cache_address)
+			continue;
+		it->batch_pfns[num_slabs] = pfn;
+		memcpy(it->batch_pages + num_slabs * scanner->page_struct_size,
+		       page, scanner->page_struct_size);
+		num_slabs++;
+	}
+
+	/* Slabs are independent, so decode them in parallel. */
+	err = NULL;
+	#pragma omp parallel if (num_slabs > 1) \
+		num_threads(drgn_program_num_parallel_threads(prog))
+	{
+		drgn_program_bind_parallel_thread(prog);
+		struct linux_helper_slab_buffers buffers = {};
+		#pragma omp for schedule(dynamic)
+		for (size_t i = 0; i < num_slabs; i++) {
+			if (err)
+				continue;
+			struct linux_helper_address_vector *objects =
+				&it->batch_objects[i];
+			objects->size = 0;
+			uint64_t start, end;
+			const char *page = (it->batch_pages +
+					    i * scanner->page_struct_size);
+			struct drgn_error *decode_err =
+				linux_helper_slab_decode(it, &buffers,
+							 it->batch_pfns[i],
+							 page, objects, &start,
+							 &end);
+			if (decode_err) {
+				#pragma omp critical(linux_helper_slab_decode_error)
+				if (err)
+					drgn_error_destroy(decode_err);
+				else
+					err = decode_err;
+			}
+		}
+		linux_helper_slab_buffers_deinit(&buffers);
+	}
+	if (err)
+		return err;
+
+	/* Return the objects in the order of the page array. */
+	size_t num_objects = 0;
+	for (size_t i = 0; i < num_slabs; i++)
+		num_objects += it->batch_objects[i].size;
+	if (!linux_helper_address_vector_reserve(&it->objects, num_objects))
+		return &drgn_enomem;
+	for (size_t i = 0; i < num_slabs; i++) {
+		memcpy(it->objects.data + it->objects.size,
+		       it->batch_objects[i].data,
+		       it->batch_objects[i].size *
+		       sizeof(it->batch_objects[i].data[0]));
+		it->objects.size += it->batch_objects[i].size;
+	}
+	return NULL;
+}
+
+struct drgn_error *
+linux_helper_slab_object_iterator_next(struct linux_helper_slab_object_iterator *it,
+				       const struct drgn_object **ret)
+{
+	struct drgn_error *err;
+
+	while (it->next_object >= it->objects.size) {
+		if (it->page_scanner.pfn >= it->page_scanner.max_pfn) {
+			*ret = NULL;
+			return NULL;
+		}
+		it->objects.size = 0;
+		it->next_object = 0;
+		err = linux_helper_slab_next_batch(it);
+		if (err)
+			return err;
+	}
+	err = drgn_object_set_unsigned(&it->entry, it->entry_pointer_type,
+				       it->objects.data[it->next_object++], 0);
+	if (err)
+		return err;
+	*ret = &it->entry;
+	return NULL;
+}
+
+/* Allocated object found while building a heap graph. */
+struct linux_helper_heap_object {
+	uint64_t address;
+	uint64_t size;
+};
+
+/*
+ * Memory scanned for references while building a heap graph. Only the words in
+ * allocated objects of a slab region are scanned.
+ */
+struct linux_helper_heap_region {
+	uint64_t address;
+	uint64_t size;
+	bool slab;
+};
+
+/* Reference found while building a heap graph. */
+struct linux_helper_heap_reference {
+	size_t target;
+	uint64_t referrer;
+};
+
+DEFINE_VECTOR(linux_helper_heap_object_vector, struct linux_helper_heap_object)
+DEFINE_VECTOR(linux_helper_heap_region_vector, struct linux_helper_heap_region)
+DEFINE_VECTOR(linux_helper_heap_reference_vector,
+	      struct linux_helper_heap_reference)
+DEFINE_VECTOR(linux_helper_slab_iterator_vector,
+	      struct linux_helper_slab_object_iterator *)
+DEFINE_HASH_MAP(linux_helper_slab_cache_map, uint64_t, size_t,
+		int_key_hash_pair, scalar_key_eq)
+
+/* Maximum size of memory outside of slabs scanned at once. */
+#define LINUX_HELPER_HEAP_CHUNK (1024 * 1024)
+
+static int linux_helper_heap_object_compare(const void *_a, const void *_b)
+{
+	const struct linux_helper_heap_object *a = _a, *b = _b;
+	if (a->address != b->address)
+		return a->address < b->address ? -1 : 1;
+	return 0;
+}
+
+static int linux_helper_heap_referrer_compare(const void *_a, const void *_b)
+{
+	uint64_t a = *(const uint64_t *)_a, b = *(const uint64_t *)_b;
+	if (a != b)
+		return a < b ? -1 : 1;
+	return 0;
+}
+
+/* Append a run of pages outside of slabs, split into chunks. */
+static bool
+linux_helper_heap_append_pages(struct linux_helper_heap_region_vector *regions,
+			       const struct linux_helper_slab_object_iterator *it,
+			       uint64_t start_pfn, uint64_t end_pfn)
+{
+	uint64_t address = it->page_offset + start_pfn * it->page_size;
+	uint64_t size = (end_pfn - start_pfn) * it->page_size;
+	while (size) {
+		uint64_t chunk = min(size, (uint64_t)LINUX_HELPER_HEAP_CHUNK);
+		struct linux_helper_heap_region *region =
+			linux_helper_heap_region_vector_append_entry(regions);
+		if (!region)
+			return false;
+		region->address = address;
+		region->size = chunk;
+		region->slab = false;
+		address += chunk;
+		size -= chunk;
+	}
+	return true;
+}
+
+/* Create an iterator for every slab cache, indexed by its address. */
+static struct drgn_error *
+linux_helper_heap_graph_init_caches(struct drgn_program *prog,
+				    struct linux_helper_slab_iterator_vector *caches,
+				    struct linux_helper_slab_cache_map *cache_map,
+				    struct linux_helper_address_vector *object_sizes)
+{
+	struct drgn_error *err;
+
+	struct drgn_qualified_type kmem_cache_type, void_type;
+	err = drgn_program_find_type(prog, "struct kmem_cache", NULL,
+				     &kmem_cache_type);
+	if (err)
+		return err;
+	err = drgn_program_find_primitive_type(prog, DRGN_C_TYPE_VOID,
+					       &void_type.type);
+	if (err)
+		return err;
+	void_type.qualifiers = 0;
+
+	struct drgn_object tmp;
+	drgn_object_init(&tmp, prog);
+	err = drgn_program_find_object(prog, "slab_caches", NULL,
+				       DRGN_FIND_OBJECT_VARIABLE, &tmp);
+	if (err)
+		goto out;
+	err = drgn_object_address_of(&tmp, &tmp);
+	if (err)
+		goto out;
+	struct linux_helper_list_iterator list_it;
+	err = linux_helper_list_iterator_init(&list_it, &tmp, kmem_cache_type,
+					      "list", LINUX_HELPER_LIST);
+	if (err)
+		goto out;
+	for (;;) {
+		const struct drgn_object *slab_cache;
+		err = linux_helper_list_iterator_next(&list_it, &slab_cache);
+		if (err || !slab_cache)
+			break;
+		struct linux_helper_slab_object_iterator *it =
+			malloc(sizeof(*it));
+		if (!it) {
+			err = &drgn_enomem;
+			break;
+		}
+		err = linux_helper_slab_object_iterator_init(it, slab_cache,
+							     void_type);
+		if (err) {
+			free(it);
+			break;
+		}
+		if (!linux_helper_slab_iterator_vector_append(caches, &it)) {
+			linux_helper_slab_object_iterator_deinit(it);
+			free(it);
+			err = &drgn_enomem;
+			break;
+		}
+		/*
+		 * slab_cache->size includes metadata and padding. Only the
+		 * object itself can be pointed to.
+		 */
+		uint64_t object_size;
+		err = linux_helper_read_member_integer(slab_cache,
+						       "object_size", &tmp,
+						       &it->object_size,
+						       &object_size);
+		if (err)
+			break;
+		object_size = min(object_size, it->object_size);
+		if (!linux_helper_address_vector_append(object_sizes,
+							&object_size)) {
+			err = &drgn_enomem;
+			break;
+		}
+		struct linux_helper_slab_cache_map_entry entry = {
+			.key = it->slab_cache_address,
+			.value = caches->size - 1,
+		};
+		if (linux_helper_slab_cache_map_insert(cache_map, &entry,
+						       NULL) < 0) {
+			err = &drgn_enomem;
+			break;
+		}
+	}
+	linux_helper_list_iterator_deinit(&list_it);
+out:
+	drgn_object_deinit(&tmp);
+	return err;
+}
+
+/*
+ * Find the allocated objects of every slab in one pass over the page array, and
+ * the memory to scan for references to them.
+ */
+static struct drgn_error *
+linux_helper_heap_graph_collect(struct drgn_program *prog, bool scan_pages,
+				struct linux_helper_heap_object_vector *objects,
+				struct linux_helper_heap_region_vector *regions,
+				struct linux_helper_page_scanner *scanner)
+{
+	struct drgn_error *err;
+
+	struct linux_helper_slab_iterator_vector caches;
+	linux_helper_slab_iterator_vector_init(&caches);
+	struct linux_helper_slab_cache_map cache_map;
+	linux_helper_slab_cache_map_init(&cache_map);
+	struct linux_helper_address_vector object_sizes;
+	linux_helper_address_vector_init(&object_sizes);
+	struct linux_helper_slab_buffers buffers = {};
+
+	err = linux_helper_heap_graph_init_caches(prog, &caches, &cache_map,
+						  &object_sizes);
+	if (err)
+		goto out;
+	if (!caches.size)
+		goto out;
+	/* All of the caches share the page layout and kernel constants. */
+	const struct linux_helper_slab_object_iterator *first = caches.data[0];
+	uint64_t page_size = first->page_size;
+	uint64_t slab_cache_offset = first->slab_cache_offset;
+
+	/* Pages before this are the tail pages of the last slab. */
+	uint64_t slab_end_pfn = 0;
+	/* Run of pages outside of slabs to scan. */
+	uint64_t run_start_pfn = 0, run_end_pfn = 0;
+	for (;;) {
+		uint64_t pfn;
+		const char *page;
+		err = linux_helper_page_scanner_next(scanner, &pfn, &page);
+		if (err || !page)
+			break;
+		if (pfn < slab_end_pfn)
+			continue;
+		uint64_t flags =
+			linux_helper_page_scanner_word(scanner, page,
+						       first->page_flags_offset);
+		if (flags & first->pg_slab_mask) {
+			uint64_t slab_cache =
+				linux_helper_page_scanner_word(scanner, page,
+							       slab_cache_offset);
+			struct linux_helper_slab_cache_map_iterator map_it =
+				linux_helper_slab_cache_map_search(&cache_map,
+								   &slab_cache);
+			/* Slabs of caches not on the list are skipped. */
+			if (!map_it.entry)
+				continue;
+			struct linux_helper_slab_object_iterator *it =
+				caches.data[map_it.entry->value];
+			it->objects.size = 0;
+			uint64_t slab_start, slab_end;
+			err = linux_helper_slab_decode(it, &buffers, pfn, page,
+						       &it->objects,
+						       &slab_start, &slab_end);
+			if (err && err->code == DRGN_ERROR_FAULT) {
+				drgn_error_destroy(err);
+				continue;
+			} else if (err) {
+				break;
+			}
+			if (slab_end > it->page_offset) {
+				slab_end_pfn = ((slab_end - it->page_offset +
+						 page_size - 1) / page_size);
+			}
+			if (!it->objects.size)
+				continue;
+			size_t num_objects = objects->size + it->objects.size;
+			if (!linux_helper_heap_object_vector_reserve(objects,
+								     num_objects)) {
+				err = &drgn_enomem;
+				break;
+			}
+			uint64_t object_size =
+				object_sizes.data[map_it.entry->value];
+			for (size_t i = 0; i < it->objects.size; i++) {
+				objects->data[objects->size++] =
+					(struct linux_helper_heap_object){
+						.address = it->objects.data[i],
+						.size = object_size,
+					};
+			}
+			struct linux_helper_heap_region *region =
+				linux_helper_heap_region_vector_append_entry(regions);
+			if (!region) {
+				err = &drgn_enomem;
+				break;
+			}
+			region->address = slab_start;
+			region->size = slab_end - slab_start;
+			region->slab = true;
+		} else if (scan_pages) {
+			if (pfn != run_end_pfn) {
+				if (!linux_helper_heap_append_pages(regions,
+								    first,
+								    run_start_pfn,
+								    run_end_pfn)) {
+					err = &drgn_enomem;
+					break;
+				}
+				run_start_pfn = pfn;
+			}
+			run_end_pfn = pfn + 1;
+		}
+	}
+	if (!err &&
+	    !linux_helper_heap_append_pages(regions, first, run_start_pfn,
+					    run_end_pfn))
+		err = &drgn_enomem;
+
+out:
+	linux_helper_slab_buffers_deinit(&buffers);
+	linux_helper_address_vector_deinit(&object_sizes);
+	linux_helper_slab_cache_map_deinit(&cache_map);
+	for (size_t i = 0; i < caches.size; i++) {
+		linux_helper_slab_object_iterator_deinit(caches.data[i]);
+		free(caches.data[i]);
+	}
+	linux_helper_slab_iterator_vector_deinit(&caches);
+	return err;
+}
+
+size_t linux_helper_heap_graph_find(struct linux_helper_heap_graph *graph,
+				    uint64_t address)
+{
+	/* Find the last object starting at or before the address. */
+	size_t lo = 0, hi = graph->num_objects;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (graph->addresses[mid] <= address)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == 0 ||
+	    address - graph->addresses[lo - 1] >= graph->sizes[lo - 1])
+		return SIZE_MAX;
+	return lo - 1;
+}
+
+/* Scan a buffer read from a region for references to indexed objects. */
+static bool
+linux_helper_heap_scan(struct linux_helper_heap_graph *graph,
+		       const struct linux_helper_page_scanner *scanner,
+		       uint64_t address, uint64_t size, bool slab,
+		       const char *buf,
+		       struct linux_helper_heap_reference_vector *references)
+{
+	uint64_t word_size = scanner->is_64_bit ? 8 : 4;
+	uint64_t min_target = graph->addresses[0];
+	uint64_t max_target = (graph->addresses[graph->num_objects - 1] +
+			       (graph->sizes[graph->num_objects - 1] - 1));
+	/* Index of the object containing or following the current word. */
+	size_t source = SIZE_MAX;
+	if (slab) {
+		source = linux_helper_heap_graph_find(graph, address);
+		if (source == SIZE_MAX) {
+			size_t lo = 0, hi = graph->num_objects;
+			while (lo < hi) {
+				size_t mid = lo + (hi - lo) / 2;
+				if (graph->addresses[mid] < address)
+					lo = mid + 1;
+				else
+					hi = mid;
+			}
+			source = lo;
+		}
+	}
+	uint64_t offset = -address & (word_size - 1);
+	for (; size >= word_size && offset <= size - word_size;
+	     offset += word_size) {
+		uint64_t word_address = address + offset;
+		if (slab) {
+			while (source < graph->num_objects &&
+			       word_address >= graph->addresses[source] &&
+			       word_address - graph->addresses[source] >=
+			       graph->sizes[source])
+				source++;
+			/* Skip free objects and padding between objects. */
+			if (source >= graph->num_objects ||
+			    word_address < graph->addresses[source])
+				continue;
+		}
+		uint64_t value = linux_helper_page_scanner_word(scanner, buf,
+								offset);
+		if (value < min_target || value > max_target)
+			continue;
+		size_t target = linux_helper_heap_graph_find(graph, value);
+		if (target == SIZE_MAX || target == source)
+			continue;
+		struct linux_helper_heap_reference *reference =
+			linux_helper_heap_reference_vector_append_entry(references);
+		if (!reference)
+			return false;
+		reference->target = target;
+		reference->referrer = word_address;
+	}
+	return true;
+}
+
+/* Read and scan a region, skipping any pages that can't be read. */
+static struct drgn_error *
+linux_helper_heap_scan_region(struct drgn_program *prog,
+			      struct linux_helper_heap_graph *graph,
+			      const struct linux_helper_page_scanner *scanner,
+			      const struct linux_helper_heap_region *region,
+			      uint64_t page_size, char **buf, size_t *buf_size,
+			      struct linux_helper_heap_reference_vector *references)
+{
+	struct drgn_error *err;
+
+	if (region->size > *buf_size) {
+		free(*buf);
+		*buf = malloc(region->size);
+		if (!*buf) {
+			*buf_size = 0;
+			return &drgn_enomem;
+		}
+		*buf_size = region->size;
+	}
+	err = drgn_program_read_memory(prog, *buf, region->address,
+				       region->size, false);
+	if (!err) {
+		if (!linux_helper_heap_scan(graph, scanner, region->address,
+					    region->size, region->slab, *buf,
+					    references))
+			return &drgn_enomem;
+		return NULL;
+	}
+	if (err->code != DRGN_ERROR_FAULT)
+		return err;
+	drgn_error_destroy(err);
+	/* Slabs are only scanned whole, like they were decoded. */
+	if (region->slab)
+		return NULL;
+	for (uint64_t offset = 0; offset < region->size; offset += page_size) {
+		uint64_t size = min(page_size, region->size - offset);
+		err = drgn_program_read_memory(prog, *buf,
+					       region->address + offset, size,
+					       false);
+		if (err && err->code == DRGN_ERROR_FAULT) {
+			drgn_error_destroy(err);
+			continue;
+		} else if (err) {
+			return err;
+		}
+		if (!linux_helper_heap_scan(graph, scanner,
+					    region->address + offset, size,
+					    false, *buf, references))
+			return &drgn_enomem;
+	}
+	return NULL;
+}
+
+/* Scan all of the regions in parallel and build the referrer arrays. */
+static struct drgn_error *
+linux_helper_heap_graph_link(struct drgn_program *prog,
+			     struct linux_helper_heap_graph *graph,
+			     const struct linux_helper_page_scanner *scanner,
+			     const struct linux_helper_heap_region_vector *regions,
+			     uint64_t page_size)
+{
+	struct drgn_error *err = NULL;
+
+	int num_threads = drgn_program_num_parallel_threads(prog);
+	struct linux_helper_heap_reference_vector *references =
+		malloc_array(num_threads, sizeof(references[0]));
+	if (!references)
+		return &drgn_enomem;
+	for (int i = 0; i < num_threads; i++)
+		linux_helper_heap_reference_vector_init(&references[i]);
+
+	/* Regions are independent, so scan them in parallel. */
+	#pragma omp parallel num_threads(num_threads)
+	{
+		drgn_program_bind_parallel_thread(prog);
+		struct linux_helper_heap_reference_vector *thread_references =
+			&references[omp_get_thread_num()];
+		char *buf = NULL;
+		size_t buf_size = 0;
+		#pragma omp for schedule(dynamic, 64)
+		for (size_t i = 0; i < regions->size; i++) {
+			if (err)
+				continue;
+			struct drgn_error *region_err =
+				linux_helper_heap_scan_region(prog, graph,
+							      scanner,
+							      &regions->data[i],
+							      page_size, &buf,
+							      &buf_size,
+							      thread_references);
+			if (region_err) {
+				#pragma omp critical(linux_helper_heap_graph_error)
+				if (err)
+					drgn_error_destroy(region_err);
+				else
+					err = region_err;
+			}
+		}
+		free(buf);
+	}
+	if (err)
+		goto out;
+
+	graph->referrer_offsets = calloc(graph->num_objects + 1,
+					 sizeof(graph->referrer_offsets[0]));
+	if (!graph->referrer_offsets) {
+		err = &drgn_enomem;
+		goto out;
+	}
+	size_t num_referrers = 0;
+	for (int i = 0; i < num_threads; i++) {
+		num_referrers += references[i].size;
+		for (size_t j = 0; j < references[i].size; j++) {
+			size_t target = references[i].data[j].target;
+			graph->referrer_offsets[target + 1]++;
+		}
+	}
+	for (size_t i = 0; i < graph->num_objects; i++)
+		graph->referrer_offsets[i + 1] += graph->referrer_offsets[i];
+	graph->referrers = malloc_array(num_referrers,
+					sizeof(graph->referrers[0]));
+	if (!graph->referrers && num_referrers) {
+		err = &drgn_enomem;
+		goto out;
+	}
+	graph->num_referrers = num_referrers;
+	/*
+	 * Fill each object's referrers backwards from the end of its range,
+	 * which leaves referrer_offsets[i + 1] at the start of object i's
+	 * range. Then shift the offsets back into place.
+	 */
+	for (int i = 0; i < num_threads; i++) {
+		for (size_t j = 0; j < references[i].size; j++) {
+			const struct linux_helper_heap_reference *reference =
+				&references[i].data[j];
+			size_t k = --graph->referrer_offsets[reference->target + 1];
+			graph->referrers[k] = reference->referrer;
+		}
+	}
+	for (size_t i = 0; i < graph->num_objects; i++)
+		graph->referrer_offsets[i] = graph->referrer_offsets[i + 1];
+	graph->referrer_offsets[graph->num_objects] = num_referrers;
+	#pragma omp parallel for schedule(dynamic, 1024) \
+		num_threads(num_threads)
+	for (size_t i = 0; i < graph->num_objects; i++) {
+		size_t start = graph->referrer_offsets[i];
+		size_t end = graph->referrer_offsets[i + 1];
+		qsort(graph->referrers + start, end - start,
+		      sizeof(graph->referrers[0]),
+		      linux_helper_heap_referrer_compare);
+	}
+
+out:
+	for (int i = 0; i < num_threads; i++)
+		linux_helper_heap_reference_vector_deinit(&references[i]);
+	free(references);
+	return err;
+}
+
+struct drgn_error *
+linux_helper_heap_graph_create(struct drgn_program *prog, bool scan_pages,
+			       struct linux_helper_heap_graph **ret)
+{
+	struct drgn_error *err;
+
+	struct linux_helper_heap_graph *graph = calloc(1, sizeof(*graph));
+	if (!graph)
+		return &drgn_enomem;
+	struct linux_helper_heap_object_vector objects;
+	linux_helper_heap_object_vector_init(&objects);
+	struct linux_helper_heap_region_vector regions;
+	linux_helper_heap_region_vector_init(&regions);
+
+	struct linux_helper_page_scanner scanner;
+	err = linux_helper_page_scanner_init(&scanner, prog);
+	if (err)
+		goto out;
+	err = linux_helper_heap_graph_collect(prog, scan_pages, &objects,
+					      &regions, &scanner);
+	if (err)
+		goto out_scanner;
+
+	/*
+	 * The page array is in address order, but that isn't guaranteed for
+	 * SLAB's s_mem, so sort to be safe.
+	 */
+	qsort(objects.data, objects.size, sizeof(objects.data[0]),
+	      linux_helper_heap_object_compare);
+	graph->addresses = malloc_array(objects.size,
+					sizeof(graph->addresses[0]));
+	graph->sizes = malloc_array(objects.size, sizeof(graph->sizes[0]));
+	if ((!graph->addresses || !graph->sizes) && objects.size) {
+		err = &drgn_enomem;
+		goto out_scanner;
+	}
+	for (size_t i = 0; i < objects.size; i++) {
+		graph->addresses[i] = objects.data[i].address;
+		graph->sizes[i] = min(objects.data[i].size,
+				      (uint64_t)UINT32_MAX);
+	}
+	graph->num_objects = objects.size;
+	linux_helper_heap_object_vector_deinit(&objects);
+	linux_helper_heap_object_vector_init(&objects);
+
+	if (graph->num_objects) {
+		err = linux_helper_heap_graph_link(prog, graph, &scanner,
+						   &regions,
+						   prog->vmcoreinfo.page_size);
+	} else {
+		graph->referrer_offsets =
+			calloc(1, sizeof(graph->referrer_offsets[0]));
+		if (!graph->referrer_offsets)
+			err = &drgn_enomem;
+	}
+
+out_scanner:
+	linux_helper_page_scanner_deinit(&scanner);
+out:
+	linux_helper_heap_region_vector_deinit(&regions);
+	linux_helper_heap_object_vector_deinit(&objects);
+	if (err)
+		linux_helper_heap_graph_destroy(graph);
+	else
+		*ret = graph;
+	return err;
+}
+
+void linux_helper_heap_graph_destroy(struct linux_helper_heap_graph *graph)
+{
+	if (!graph)
+		return;
+	free(graph->referrers);
+	free(graph->referrer_offsets);
+	free(graph->sizes);
+	free(graph->addresses);
+	free(graph);
+}
+
+/* Number of entries read by a pipeline at once. */
+#define LINUX_HELPER_PIPELINE_BATCH 1024
+
+struct drgn_error *
+linux_helper_pipeline_init(struct linux_helper_pipeline *pipeline,
+			   enum linux_helper_pipeline_source source,
+			   struct drgn_qualified_type entry_type,
+			   const char *node_member,
+			   const struct linux_helper_pipeline_filter *filters,
+			   size_t num_filters,
+			   const struct drgn_member_path *projections,
+			   size_t num_projections)
+{
+	struct drgn_error *err;
+
+	pipeline->source = source;
+	pipeline->entry_type = entry_type;
+	pipeline->node_member = NULL;
+	pipeline->num_filters = num_filters;
+	pipeline->num_projections = num_projections;
+	size_t num_paths = num_filters + num_projections;
+	pipeline->filters = malloc_array(num_filters,
+					 sizeof(pipeline->filters[0]));
+	pipeline->paths = malloc_array(num_paths, sizeof(pipeline->paths[0]));
+	pipeline->encodings = malloc_array(num_paths,
+					   sizeof(pipeline->encodings[0]));
+	if ((!pipeline->filters && num_filters) ||
+	    ((!pipeline->paths || !pipeline->encodings) && num_paths)) {
+		err = &drgn_enomem;
+		goto err;
+	}
+	if (num_filters) {
+		memcpy(pipeline->filters, filters,
+		       num_filters * sizeof(filters[0]));
+	}
+
+	switch (source) {
+	case LINUX_HELPER_PIPELINE_LIST:
+	case LINUX_HELPER_PIPELINE_LIST_REVERSE:
+	case LINUX_HELPER_PIPELINE_HLIST:
+	case LINUX_HELPER_PIPELINE_HLIST_NULLS:
+	case LINUX_HELPER_PIPELINE_RBTREE: {
+		if (!node_member) {
+			err = drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+						"node member is required");
+			goto err;
+		}
+		/* Check the node member now rather than on every run. */
+		uint64_t offset;
+		err = drgn_type_offsetof(entry_type.type, node_member,
+					 &offset);
+		if (err)
+			goto err;
+		pipeline->node_member = strdup(node_member);
+		if (!pipeline->node_member) {
+			err = &drgn_enomem;
+			goto err;
+		}
+		break;
+	}
+	case LINUX_HELPER_PIPELINE_RADIX_TREE:
+	case LINUX_HELPER_PIPELINE_SLAB:
+	case LINUX_HELPER_PIPELINE_ARRAY:
+		break;
+	default:
+		err = drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+					"invalid pipeline source");
+		goto err;
+	}
+
+	for (size_t i = 0; i < num_paths; i++) {
+		pipeline->paths[i] = (i < num_filters ?
+				      filters[i].path :
+				      projections[i - num_filters]);
+		struct drgn_object_type type;
+		err = drgn_object_type(pipeline->paths[i].member_type,
+				       pipeline->paths[i].bit_field_size,
+				       &type);
+		if (err)
+			goto err;
+		if ((type.encoding != DRGN_OBJECT_ENCODING_SIGNED &&
+		     type.encoding != DRGN_OBJECT_ENCODING_UNSIGNED &&
+		     type.encoding != DRGN_OBJECT_ENCODING_FLOAT) ||
+		    type.bit_size > 64) {
+			err = drgn_qualified_type_error("cannot read '%s' in a pipeline",
+							pipeline->paths[i].member_type);
+			goto err;
+		}
+		pipeline->encodings[i] = type.encoding;
+		if (i >= num_filters)
+			continue;
+		if (filters[i].encoding != DRGN_OBJECT_ENCODING_SIGNED &&
+		    filters[i].encoding != DRGN_OBJECT_ENCODING_UNSIGNED &&
+		    filters[i].encoding != DRGN_OBJECT_ENCODING_FLOAT) {
+			err = drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+						"invalid filter value encoding");
+			goto err;
+		}
+		if ((unsigned int)filters[i].op > LINUX_HELPER_PIPELINE_AND) {
+			err = drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+						"invalid filter operator");
+			goto err;
+		}
+		if (filters[i].op == LINUX_HELPER_PIPELINE_AND &&
+		    (type.encoding == DRGN_OBJECT_ENCODING_FLOAT ||
+		     filters[i].encoding == DRGN_OBJECT_ENCODING_FLOAT)) {
+			err = drgn_error_create(DRGN_ERROR_TYPE,
+						"bitwise and filter requires integers");
+			goto err;
+		}
+	}
+	return NULL;
+
+err:
+	linux_helper_pipeline_deinit(pipeline);
+	return err;
+}
+
+void linux_helper_pipeline_deinit(struct linux_helper_pipeline *pipeline)
+{
+	free(pipeline->encodings);
+	free(pipeline->paths);
+	free(pipeline->filters);
+	free(pipeline->node_member);
+}
+
+static double linux_helper_pipeline_double(enum drgn_object_encoding encoding,
+					   const union drgn_value *value)
+{
+	switch (encoding) {
+	case DRGN_OBJECT_ENCODING_SIGNED:
+		return value->svalue;
+	case DRGN_OBJECT_ENCODING_UNSIGNED:
+		return value->uvalue;
+	default:
+		return value->fvalue;
+	}
+}
+
+/* Return whether a member value matches a filter. */
+static bool
+linux_helper_pipeline_match(const struct linux_helper_pipeline_filter *filter,
+			    enum drgn_object_encoding encoding,
+			    const union drgn_value *value)
+{
+	if (filter->op == LINUX_HELPER_PIPELINE_AND)
+		return value->uvalue & filter->value.uvalue;
+
+	int cmp;
+	if (encoding == DRGN_OBJECT_ENCODING_FLOAT ||
+	    filter->encoding == DRGN_OBJECT_ENCODING_FLOAT) {
+		double lhs = linux_helper_pipeline_double(encoding, value);
+		double rhs = linux_helper_pipeline_double(filter->encoding,
+							  &filter->value);
+		/* NaN is unordered, so it only matches !=. */
+		if (isnan(lhs) || isnan(rhs))
+			return filter->op == LINUX_HELPER_PIPELINE_NE;
+		cmp = (lhs > rhs) - (lhs < rhs);
+	} else {
+		/* Compare mixed signed and unsigned integers exactly. */
+		bool lhs_negative = (encoding == DRGN_OBJECT_ENCODING_SIGNED &&
+				     value->svalue < 0);
+		bool rhs_negative =
+			(filter->encoding == DRGN_OBJECT_ENCODING_SIGNED &&
+			 filter->value.svalue < 0);
+		if (lhs_negative != rhs_negative) {
+			cmp = lhs_negative ? -1 : 1;
+		} else {
+			cmp = ((value->uvalue > filter->value.uvalue) -
+			       (value->uvalue < filter->value.uvalue));
+		}
+	}
+	switch (filter->op) {
+	case LINUX_HELPER_PIPELINE_EQ:
+		return cmp == 0;
+	case LINUX_HELPER_PIPELINE_NE:
+		return cmp != 0;
+	case LINUX_HELPER_PIPELINE_LT:
+		return cmp < 0;
+	case LINUX_HELPER_PIPELINE_LE:
+		return cmp <= 0;
+	case LINUX_HELPER_PIPELINE_GT:
+		return cmp > 0;
+	case LINUX_HELPER_PIPELINE_GE:
+		return cmp >= 0;
+	default:
+		UNREACHABLE();
+	}
+}
+
+/* Native iterator over the entries of a pipeline source. */
+struct linux_helper_pipeline_iterator {
+	enum linux_helper_pipeline_source source;
+	union {
+		struct linux_helper_list_iterator list;
+		struct linux_helper_rbtree_iterator rbtree;
+		struct linux_helper_radix_tree_iterator radix_tree;
+		struct linux_helper_slab_object_iterator slab;
+		/* Array source. */
+		struct {
+			/* Address of the next array element. */
+			uint64_t address;
+			/* Number of remaining elements. */
+			uint64_t remaining;
+			/* Size of each element. */
+			uint64_t stride;
+			/* Whether the elements are pointers to the entries. */
+			bool pointers;
+			bool little_endian;
+			/* Elements read but not returned yet. */
+			char *buf;
+			uint64_t buf_index, buf_count;
+		} array;
+	};
+};
+
+static struct drgn_error *
+linux_helper_pipeline_array_init(struct linux_helper_pipeline_iterator *it,
+				 const struct drgn_object *array)
+{
+	struct drgn_error *err;
+
+	struct drgn_type *type = drgn_underlying_type(array->type);
+	if (drgn_type_kind(type) != DRGN_TYPE_ARRAY ||
+	    !drgn_type_is_complete(type)) {
+		return drgn_type_error("pipeline source must be a complete array, not '%s'",
+				       array->type);
+	}
+	if (array->kind != DRGN_OBJECT_REFERENCE) {
+		return drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+					 "pipeline source array must be a reference");
+	}
+	struct drgn_type *element_type =
+		drgn_underlying_type(drgn_type_type(type).type);
+	err = drgn_type_sizeof(element_type, &it->array.stride);
+	if (err)
+		return err;
+	if (!it->array.stride) {
+		return drgn_error_create(DRGN_ERROR_TYPE,
+					 "pipeline source array has empty elements");
+	}
+	it->array.pointers = drgn_type_kind(element_type) == DRGN_TYPE_POINTER;
+	if (it->array.pointers) {
+		it->array.little_endian =
+			drgn_type_little_endian(element_type);
+		it->array.buf = malloc_array(LINUX_HELPER_PIPELINE_BATCH,
+					     it->array.stride);
+		if (!it->array.buf)
+			return &drgn_enomem;
+	} else {
+		it->array.buf = NULL;
+	}
+	it->array.address = array->address;
+	it->array.remaining = drgn_type_length(type);
+	it->array.buf_index = it->array.buf_count = 0;
+	return NULL;
+}
+
+static struct drgn_error *
+linux_helper_pipeline_iterator_init(struct linux_helper_pipeline_iterator *it,
+				    const struct linux_helper_pipeline *pipeline,
+				    const struct drgn_object *root)
+{
+	it->source = pipeline->source;
+	switch (pipeline->source) {
+	case LINUX_HELPER_PIPELINE_LIST:
+	case LINUX_HELPER_PIPELINE_LIST_REVERSE:
+	case LINUX_HELPER_PIPELINE_HLIST:
+	case LINUX_HELPER_PIPELINE_HLIST_NULLS: {
+		static const enum linux_helper_list_kind kinds[] = {
+			[LINUX_HELPER_PIPELINE_LIST] = LINUX_HELPER_LIST,
+			[LINUX_HELPER_PIPELINE_LIST_REVERSE] =
+				LINUX_HELPER_LIST_REVERSE,
+			[LINUX_HELPER_PIPELINE_HLIST] = LINUX_HELPER_HLIST,
+			[LINUX_HELPER_PIPELINE_HLIST_NULLS] =
+				LINUX_HELPER_HLIST_NULLS,
+		};
+		return linux_helper_list_iterator_init(&it->list, root,
+						       pipeline->entry_type,
+						       pipeline->node_member,
+						       kinds[pipeline->source]);
+	}
+	case LINUX_HELPER_PIPELINE_RBTREE:
+		return linux_helper_rbtree_iterator_init(&it->rbtree, root,
+							 pipeline->entry_type,
+							 pipeline->node_member);
+	case LINUX_HELPER_PIPELINE_RADIX_TREE:
+		return linux_helper_radix_tree_iterator_init(&it->radix_tree,
+							     root, true);
+	case LINUX_HELPER_PIPELINE_SLAB:
+		return linux_helper_slab_object_iterator_init(&it->slab, root,
+							      pipeline->entry_type);
+	case LINUX_HELPER_PIPELINE_ARRAY:
+		return linux_helper_pipeline_array_init(it, root);
+	default:
+		UNREACHABLE();
+	}
+}
+
+static void
+linux_helper_pipeline_iterator_deinit(struct linux_helper_pipeline_iterator *it)
+{
+	switch (it->source) {
+	case LINUX_HELPER_PIPELINE_LIST:
+	case LINUX_HELPER_PIPELINE_LIST_REVERSE:
+	case LINUX_HELPER_PIPELINE_HLIST:
+	case LINUX_HELPER_PIPELINE_HLIST_NULLS:
+		linux_helper_list_iterator_deinit(&it->list);
+		break;
+	case LINUX_HELPER_PIPELINE_RBTREE:
+		linux_helper_rbtree_iterator_deinit(&it->rbtree);
+		break;
+	case LINUX_HELPER_PIPELINE_RADIX_TREE:
+		linux_helper_radix_tree_iterator_deinit(&it->radix_tree);
+		break;
+	case LINUX_HELPER_PIPELINE_SLAB:
+		linux_helper_slab_object_iterator_deinit(&it->slab);
+		break;
+	case LINUX_HELPER_PIPELINE_ARRAY:
+		free(it->array.buf);
+		break;
+	default:
+		UNREACHABLE();
+	}
+}
+
+static struct drgn_error *
+linux_helper_pipeline_array_next(struct linux_helper_pipeline_iterator *it,
+				 struct drgn_program *prog, uint64_t *ret)
+{
+	struct drgn_error *err;
+	if (!it->array.pointers) {
+		if (!it->array.remaining) {
+			*ret = 0;
+			return NULL;
+		}
+		*ret = it->array.address;
+		it->array.address += it->array.stride;
+		it->array.remaining--;
+		return NULL;
+	}
+	for (;;) {
+		while (it->array.buf_index < it->array.buf_count) {
+			uint64_t value =
+				deserialize_bits(it->array.buf +
+						 it->array.buf_index++ *
+						 it->array.stride,
+						 0, it->array.stride * 8,
+						 it->array.little_endian);
+			if (value) {
+				*ret = value;
+				return NULL;
+			}
+		}
+		if (!it->array.remaining) {
+			*ret = 0;
+			return NULL;
+		}
+		uint64_t count = min(it->array.remaining,
+				     (uint64_t)LINUX_HELPER_PIPELINE_BATCH);
+		err = drgn_program_read_memory(prog, it->array.buf,
+					       it->array.address,
+					       count * it->array.stride, false);
+		if (err)
+			return err;
+		it->array.address += count * it->array.stride;
+		it->array.remaining -= count;
+		it->array.buf_index = 0;
+		it->array.buf_count = count;
+	}
+}
+
+/* Get the address of the next entry, or 0 if there are no more entries. */
+static struct drgn_error *
+linux_helper_pipeline_iterator_next(struct linux_helper_pipeline_iterator *it,
+				    struct drgn_program *prog, uint64_t *ret)
+{
+	struct drgn_error *err;
+	const struct drgn_object *entry;
+	switch (it->source) {
+	case LINUX_HELPER_PIPELINE_LIST:
+	case LINUX_HELPER_PIPELINE_LIST_REVERSE:
+	case LINUX_HELPER_PIPELINE_HLIST:
+	case LINUX_HELPER_PIPELINE_HLIST_NULLS:
+		err = linux_helper_list_iterator_next(&it->list, &entry);
+		break;
+	case LINUX_HELPER_PIPELINE_RBTREE:
+		err = linux_helper_rbtree_iterator_next(&it->rbtree, &entry);
+		break;
+	case LINUX_HELPER_PIPELINE_RADIX_TREE:
+		err = linux_helper_radix_tree_iterator_next(&it->radix_tree,
+							    &entry);
+		break;
+	case LINUX_HELPER_PIPELINE_SLAB:
+		err = linux_helper_slab_object_iterator_next(&it->slab,
+							     &entry);
+		break;
+	case LINUX_HELPER_PIPELINE_ARRAY:
+		return linux_helper_pipeline_array_next(it, prog, ret);
+	default:
+		UNREACHABLE();
+	}
+	if (err)
+		return err;
+	if (!entry) {
+		*ret = 0;
+		return NULL;
+	}
+	return drgn_object_read_unsigned(entry, ret);
+}
+
+struct drgn_error *
+linux_helper_pipeline_run(const struct linux_helper_pipeline *pipeline,
+			  const struct drgn_object *root,
+			  linux_helper_pipeline_row_fn *fn, void *arg)
+{
+	struct drgn_error *err;
+	struct drgn_program *prog = drgn_object_program(root);
+	size_t num_filters = pipeline->num_filters;
+	size_t num_paths = num_filters + pipeline->num_projections;
+
+	/* Each column holds one member of every entry in the batch. */
+	uint64_t *addresses = malloc_array(LINUX_HELPER_PIPELINE_BATCH,
+					   sizeof(addresses[0]));
+	uint64_t *columns = malloc_array(num_paths,
+					 LINUX_HELPER_PIPELINE_BATCH *
+					 sizeof(columns[0]));
+	void **arrays = malloc_array(num_paths, sizeof(arrays[0]));
+	union drgn_value *values = malloc_array(num_paths, sizeof(values[0]));
+	if (!addresses ||
+	    ((!columns || !arrays || !values) && num_paths)) {
+		err = &drgn_enomem;
+		goto out;
+	}
+	for (size_t i = 0; i < num_paths; i++)
+		arrays[i] = &columns[i * LINUX_HELPER_PIPELINE_BATCH];
+
+	struct linux_helper_pipeline_iterator it;
+	err = linux_helper_pipeline_iterator_init(&it, pipeline, root);
+	if (err)
+		goto out;
+	bool done = false;
+	while (!done) {
+		size_t n = 0;
+		while (n < LINUX_HELPER_PIPELINE_BATCH) {
+			err = linux_helper_pipeline_iterator_next(&it, prog,
+								  &addresses[n]);
+			if (err)
+				goto out_it;
+			if (!addresses[n]) {
+				done = true;
+				break;
+			}
+			n++;
+		}
+		err = drgn_program_read_members(prog, pipeline->paths,
+						num_paths, addresses, n,
+						arrays);
+		if (err)
+			goto out_it;
+		for (size_t j = 0; j < n; j++) {
+			bool match = true;
+			for (size_t i = 0; match && i < num_paths; i++) {
+				const uint64_t *column = arrays[i];
+				enum drgn_object_encoding encoding =
+					pipeline->encodings[i];
+				if (encoding == DRGN_OBJECT_ENCODING_FLOAT) {
+					memcpy(&values[i].fvalue, &column[j],
+					       sizeof(column[j]));
+				} else {
+					values[i].uvalue = column[j];
+				}
+				if (i < num_filters) {
+					match = linux_helper_pipeline_match(&pipeline->filters[i],
+									    encoding,
+									    &values[i]);
+				}
+			}
+			if (!match)
+				continue;
+			err = fn(addresses[j], values + num_filters, arg);
+			if (err)
+				goto out_it;
+		}
+	}
+	err = NULL;
+out_it:
+	linux_helper_pipeline_iterator_deinit(&it);
+out:
+	free(values);
+	free(arrays);
+	free(columns);
+	free(addresses);
+	return err;
+}
+
+struct drgn_error *
+linux_helper_field_init(struct linux_helper_field *field,
+			struct drgn_type *type, const char *member_designator,
+			bool integer)
+{
+	struct drgn_error *err;
+	struct drgn_member_path path;
+	err = drgn_member_path_init(&path, type, member_designator);
+	if (err)
+		return err;
+	uint64_t bit_size = path.bit_field_size;
+	if (!bit_size) {
+		err = drgn_type_sizeof(path.member_type.type, &bit_size);
+		if (err)
+			return err;
+		bit_size *= 8;
+	}
+	uint64_t type_size;
+	err = drgn_type_sizeof(type, &type_size);
+	if (err)
+		return err;
+	if (bit_size == 0 || bit_size > type_size * 8 ||
+	    path.bit_offset > type_size * 8 - bit_size ||
+	    (integer ? bit_size > 64 :
+	     path.bit_offset % 8 != 0 || bit_size % 8 != 0)) {
+		return drgn_error_format(DRGN_ERROR_TYPE,
+					 "unexpected size of '%s' member",
+					 member_designator);
+	}
+	field->bit_offset = path.bit_offset;
+	field->bit_size = bit_size;
+	return NULL;
+}
+
+/*
+ * Read an integer member found by linux_helper_field_init() from a structure in
+ * memory.
+ */
+static struct drgn_error *
+linux_helper_field_read_memory(struct drgn_program *prog,
+			       const struct linux_helper_field *field,
+			       uint64_t address, bool little_endian,
+			       uint64_t *ret)
+{
+	char buf[9];
+	struct linux_helper_field tmp = {
+		.bit_offset = field->bit_offset % 8,
+		.bit_size = field->bit_size,
+	};
+	size_t size = (tmp.bit_offset + tmp.bit_size + 7) / 8;
+	struct drgn_error *err =
+		drgn_program_read_memory(prog, buf,
+					 address + field->bit_offset / 8, size,
+					 false);
+	if (err)
+		return err;
+	*ret = linux_helper_field_read(&tmp, buf, little_endian);
+	return NULL;
+}
+
+/* Read an integer or pointer member of a structure object. */
+static struct drgn_error *
+linux_helper_read_designator(const struct drgn_object *obj,
+			     const char *member_designator,
+			     struct drgn_object *tmp, uint64_t *ret)
+{
+	struct drgn_error *err;
+	struct drgn_member_path path;
+	err = drgn_member_path_init(&path, drgn_underlying_type(obj->type),
+				    member_designator);
+	if (err)
+		return err;
+	err = drgn_object_member_path(tmp, obj, &path);
+	if (err)
+		return err;
+	union drgn_value value;
+	err = drgn_object_read_integer(tmp, &value);
+	if (!err)
+		*ret = value.uvalue;
+	return err;
+}
+
+/* Read an integer variable or enumerator. */
+static struct drgn_error *
+linux_helper_read_global(struct drgn_program *prog, const char *name,
+			 struct drgn_object *tmp, uint64_t *ret)
+{
+	struct drgn_error *err;
+	err = drgn_program_find_object(prog, name, NULL, DRGN_FIND_OBJECT_ANY,
+				       tmp);
+	if (err)
+		return err;
+	union drgn_value value;
+	err = drgn_object_read_integer(tmp, &value);
+	if (!err)
+		*ret = value.uvalue;
+	return err;
+}
+
+/* Decoder for the lockless printk ring buffer. */
+struct linux_helper_printk_ring {
+	bool little_endian;
+	/* Mask of an unsigned long. */
+	uint64_t ulong_mask;
+	/* Size of an unsigned long in bytes. */
+	uint64_t ulong_size;
+	uint64_t desc_count;
+	uint64_t desc_size;
+	/* Bit position of the state in prb_desc::state_var. */
+	uint64_t flags_shift;
+	uint64_t id_mask;
+	uint64_t desc_committed;
+	uint64_t desc_finalized;
+	uint64_t data_size_bits;
+	uint64_t info_size;
+	struct linux_helper_field state_var;
+	struct linux_helper_field text_begin;
+	struct linux_helper_field text_next;
+	struct linux_helper_field seq;
+	char *descs;
+	char *infos;
+};
+
+/*
+ * Get the descriptor and info of a record with a given ID if it is committed
+ * and has a sequence number of at least min_seq.
+ */
+static bool linux_helper_printk_ring_get(struct linux_helper_printk_ring *ring,
+					 uint64_t id, uint64_t min_seq,
+					 const char **desc_ret,
+					 const char **info_ret)
+{
+	uint64_t idx = id & (ring->desc_count - 1);
+	const char *desc = ring->descs + idx * ring->desc_size;
+	uint64_t state_var = linux_helper_field_read(&ring->state_var, desc,
+						     ring->little_endian);
+	uint64_t state = (state_var >> ring->flags_shift) & 3;
+	if ((state_var & ring->id_mask) != id ||
+	    (state != ring->desc_committed && state != ring->desc_finalized))
+		return false;
+	const char *info = ring->infos + idx * ring->info_size;
+	if (linux_helper_field_read(&ring->seq, info, ring->little_endian)
+	    < min_seq)
+		return false;
+	*desc_ret = desc;
+	*info_ret = info;
+	return true;
+}
+
+/*
+ * Get the logical position range of a record's text like the kernel's
+ * get_data(). Returns false if the record has no text.
+ */
+static bool
+linux_helper_printk_ring_text(struct linux_helper_printk_ring *ring,
+			      const char *desc, uint64_t *begin_ret,
+			      uint64_t *len_ret)
+{
+	uint64_t begin = linux_helper_field_read(&ring->text_begin, desc,
+						 ring->little_endian);
+	uint64_t next = linux_helper_field_read(&ring->text_next, desc,
+						ring->little_endian);
+	uint64_t data_size = UINT64_C(1) << ring->data_size_bits;
+	/* Data-less records have the lowest bit set. */
+	if (begin & 1)
+		return false;
+	if (begin >> ring->data_size_bits == next >> ring->data_size_bits &&
+	    begin < next) {
+		/* Regular data block. */
+	} else if (((begin + data_size) & ring->ulong_mask)
+		   >> ring->data_size_bits == next >> ring->data_size_bits) {
+		/* Wrapping data block: the data is at the start of the ring. */
+		begin = next & ~(data_size - 1);
+	} else {
+		return false;
+	}
+	uint64_t len = (next - begin) & ring->ulong_mask;
+	/* Skip the block ID. */
+	if (len <= ring->ulong_size || len > data_size)
+		return false;
+	*begin_ret = (begin + ring->ulong_size) & ring->ulong_mask;
+	*len_ret = len - ring->ulong_size;
+	return true;
+}
+
+
+/*
+ * Append a KEY=VALUE entry for a null-padded value to a kernel log record
+ * dictionary if the value is not empty. Returns the new length.
+ */
+static size_t linux_helper_printk_dict_append(char *dict, size_t dict_len,
+					      const char *key,
+					      const char *value,
+					      size_t max_value_len)
+{
+	size_t value_len = strnlen(value, max_value_len);
+	if (!value_len)
+		return dict_len;
+	if (dict_len)
+		dict[dict_len++] = '\0';
+	size_t key_len = strlen(key);
+	memcpy(dict + dict_len, key, key_len);
+	dict_len += key_len;
+	dict[dict_len++] = '=';
+	memcpy(dict + dict_len, value, value_len);
+	return dict_len + value_len;
+}
+
+static struct drgn_error *
+linux_helper_printk_lockless(struct drgn_program *prog,
+			     const struct drgn_object *prb, uint64_t min_seq,
+			     linux_helper_printk_record_fn *fn,
+			     void *arg)
+{
+	struct drgn_error *err;
+	struct linux_helper_printk_ring ring = {};
+	char *text = NULL, *dict = NULL;
+	struct drgn_object rb, tmp;
+	drgn_object_init(&rb, prog);
+	drgn_object_init(&tmp, prog);
+
+	err = drgn_program_is_little_endian(prog, &ring.little_endian);
+	if (err)
+		goto out;
+	uint64_t log_cont;
+	err = linux_helper_read_global(prog, "LOG_CONT", &tmp, &log_cont);
+	if (err)
+		goto out;
+	err = linux_helper_read_global(prog, "desc_committed", &tmp,
+				       &ring.desc_committed);
+	if (err)
+		goto out;
+	err = linux_helper_read_global(prog, "desc_finalized", &tmp,
+				       &ring.desc_finalized);
+	if (err && err->code == DRGN_ERROR_LOOKUP) {
+		/*
+		 * Before Linux kernel commit 4cfc7258f876 ("printk:
+		 * ringbuffer: add finalization/extension support") (in v5.11),
+		 * there is no finalized state.
+		 */
+		drgn_error_destroy(err);
+		ring.desc_finalized = ring.desc_committed;
+	} else if (err) {
+		goto out;
+	}
+
+	err = drgn_object_dereference(&rb, prb);
+	if (err)
+		goto out;
+	uint64_t descs_address;
+	err = linux_helper_read_designator(&rb, "desc_ring.descs", &tmp,
+					   &descs_address);
+	if (err)
+		goto out;
+	struct drgn_type *desc_type =
+		drgn_type_type(drgn_underlying_type(tmp.type)).type;
+	uint64_t infos_address;
+	err = linux_helper_read_designator(&rb, "desc_ring.infos", &tmp,
+					   &infos_address);
+	if (err)
+		goto out;
+	struct drgn_type *info_type =
+		drgn_type_type(drgn_underlying_type(tmp.type)).type;
+	uint64_t count_bits, head_id, tail_id, data_address;
+	err = linux_helper_read_designator(&rb, "desc_ring.count_bits", &tmp,
+					   &count_bits);
+	if (!err) {
+		err = linux_helper_read_designator(&rb,
+						   "desc_ring.head_id.counter",
+						   &tmp, &head_id);
+	}
+	if (!err) {
+		err = linux_helper_read_designator(&rb,
+						   "desc_ring.tail_id.counter",
+						   &tmp, &tail_id);
+	}
+	if (!err) {
+		err = linux_helper_read_designator(&rb,
+						   "text_data_ring.size_bits",
+						   &tmp, &ring.data_size_bits);
+	}
+	if (!err) {
+		err = linux_helper_read_designator(&rb, "text_data_ring.data",
+						   &tmp, &data_address);
+	}
+	if (err)
+		goto out;
+	if (count_bits >= 32 || ring.data_size_bits >= 8 * sizeof(size_t) - 1) {
+		err = drgn_error_create(DRGN_ERROR_OTHER,
+					"invalid printk ring buffer size");
+		goto out;
+	}
+
+	struct linux_helper_field ts_nsec, text_len, facility, flags, level;
+	struct linux_helper_field caller_id, subsystem, device;
+	err = linux_helper_field_init(&ring.state_var, desc_type,
+				      "state_var.counter", true);
+	if (!err) {
+		err = linux_helper_field_init(&ring.text_begin, desc_type,
+					      "text_blk_lpos.begin", true);
+	}
+	if (!err) {
+		err = linux_helper_field_init(&ring.text_next, desc_type,
+					      "text_blk_lpos.next", true);
+	}
+	if (!err)
+		err = linux_helper_field_init(&ring.seq, info_type, "seq", true);
+	if (!err) {
+		err = linux_helper_field_init(&ts_nsec, info_type, "ts_nsec",
+					      true);
+	}
+	if (!err) {
+		err = linux_helper_field_init(&text_len, info_type, "text_len",
+					      true);
+	}
+	if (!err) {
+		err = linux_helper_field_init(&facility, info_type, "facility",
+					      true);
+	}
+	if (!err)
+		err = linux_helper_field_init(&flags, info_type, "flags", true);
+	if (!err)
+		err = linux_helper_field_init(&level, info_type, "level", true);
+	if (!err) {
+		err = linux_helper_field_init(&caller_id, info_type,
+					      "caller_id", true);
+	}
+	if (!err) {
+		err = linux_helper_field_init(&subsystem, info_type,
+					      "dev_info.subsystem", false);
+	}
+	if (!err) {
+		err = linux_helper_field_init(&device, info_type,
+					      "dev_info.device", false);
+	}
+	if (!err)
+		err = drgn_type_sizeof(desc_type, &ring.desc_size);
+	if (!err)
+		err = drgn_type_sizeof(info_type, &ring.info_size);
+	if (err)
+		goto out;
+	ring.ulong_size = ring.state_var.bit_size / 8;
+	ring.ulong_mask = UINT64_MAX >> (64 - ring.state_var.bit_size);
+	ring.flags_shift = ring.state_var.bit_size - 2;
+	ring.id_mask = ring.ulong_mask >> 2;
+
+	ring.desc_count = UINT64_C(1) << count_bits;
+	ring.descs = malloc_array(ring.desc_count, ring.desc_size);
+	ring.infos = malloc_array(ring.desc_count, ring.info_size);
+	dict = malloc(sizeof("SUBSYSTEM=") + subsystem.bit_size / 8 +
+		      sizeof("DEVICE=") + device.bit_size / 8);
+	if (!ring.descs || !ring.infos || !dict) {
+		err = &drgn_enomem;
+		goto out;
+	}
+	err = drgn_program_read_memory(prog, ring.descs, descs_address,
+				       ring.desc_count * ring.desc_size, false);
+	if (err)
+		goto out;
+	err = drgn_program_read_memory(prog, ring.infos, infos_address,
+				       ring.desc_count * ring.info_size, false);
+	if (err)
+		goto out;
+
+	head_id &= ring.id_mask;
+	tail_id &= ring.id_mask;
+	uint64_t num_ids = ((head_id - tail_id) & ring.id_mask) + 1;
+	if (num_ids > ring.desc_count) {
+		/* The ring is corrupted. Only look at the newest records. */
+		tail_id = (head_id - ring.desc_count + 1) & ring.id_mask;
+		num_ids = ring.desc_count;
+	}
+
+	/*
+	 * The text of consecutive records is contiguous in the data ring, so
+	 * find the range covering all of the records we want and read it at
+	 * once.
+	 */
+	uint64_t text_begin = 0, text_end = 0;
+	bool found = false;
+	for (uint64_t i = 0; i < num_ids; i++) {
+		const char *desc, *info;
+		uint64_t begin, len;
+		if (!linux_helper_printk_ring_get(&ring,
+						  (tail_id + i) & ring.id_mask,
+						  min_seq, &desc, &info) ||
+		    !linux_helper_printk_ring_text(&ring, desc, &begin, &len))
+			continue;
+		if (!found) {
+			text_begin = begin;
+			found = true;
+		}
+		text_end = begin + len;
+	}
+	uint64_t data_size = UINT64_C(1) << ring.data_size_bits;
+	uint64_t text_size = min((text_end - text_begin) & ring.ulong_mask,
+				 data_size);
+	if (!text_size)
+		goto out;
+	text = malloc(text_size);
+	if (!text) {
+		err = &drgn_enomem;
+		goto out;
+	}
+	uint64_t data_index = text_begin & (data_size - 1);
+	uint64_t first_size = min(text_size, data_size - data_index);
+	err = drgn_program_read_memory(prog, text, data_address + data_index,
+				       first_size, false);
+	if (err)
+		goto out;
+	if (first_size < text_size) {
+		err = drgn_program_read_memory(prog, text + first_size,
+					       data_address,
+					       text_size - first_size, false);
+		if (err)
+			goto out;
+	}
+
+	for (uint64_t i = 0; i < num_ids; i++) {
+		const char *desc, *info;
+		uint64_t begin, len;
+		if (!linux_helper_printk_ring_get(&ring,
+						  (tail_id + i) & ring.id_mask,
+						  min_seq, &desc, &info) ||
+		    !linux_helper_printk_ring_text(&ring, desc, &begin, &len))
+			continue;
+		uint64_t offset = (begin - text_begin) & ring.ulong_mask;
+		if (offset > text_size || len > text_size - offset)
+			continue;
+
+		bool little_endian = ring.little_endian;
+		const char *subsystem_value = info + subsystem.bit_offset / 8;
+		const char *device_value = info + device.bit_offset / 8;
+		size_t dict_len =
+			linux_helper_printk_dict_append(dict, 0, "SUBSYSTEM",
+							subsystem_value,
+							subsystem.bit_size / 8);
+		dict_len = linux_helper_printk_dict_append(dict, dict_len,
+							   "DEVICE",
+							   device_value,
+							   device.bit_size / 8);
+		uint64_t flags_value = linux_helper_field_read(&flags, info,
+							       little_endian);
+		uint64_t max_text_len = linux_helper_field_read(&text_len, info,
+								little_endian);
+		struct linux_helper_printk_record record = {
+			.seq = linux_helper_field_read(&ring.seq, info,
+						       little_endian),
+			.timestamp = linux_helper_field_read(&ts_nsec, info,
+							     little_endian),
+			.text = text + offset,
+			.text_len = min(len, max_text_len),
+			.dict = dict,
+			.dict_len = dict_len,
+			.caller_id = linux_helper_field_read(&caller_id, info,
+							     little_endian),
+			.has_caller_id = true,
+			.facility = linux_helper_field_read(&facility, info,
+							    little_endian),
+			.level = linux_helper_field_read(&level, info,
+							 little_endian),
+			.continuation = flags_value & log_cont,
+		};
+		err = fn(&record, arg);
+		if (err)
+			goto out;
+	}
+	err = NULL;
+out:
+	free(dict);
+	free(text);
+	free(ring.infos);
+	free(ring.descs);
+	drgn_object_deinit(&tmp);
+	drgn_object_deinit(&rb);
+	return err;
+}
+
+static struct drgn_error *
+linux_helper_printk_structured(struct drgn_program *prog, uint64_t min_seq,
+			       linux_helper_printk_record_fn *fn,
+			       void *arg)
+{
+	struct drgn_error *err;
+	char *buf = NULL;
+	struct drgn_object tmp;
+	drgn_object_init(&tmp, prog);
+
+	bool little_endian;
+	err = drgn_program_is_little_endian(prog, &little_endian);
+	if (err)
+		goto out;
+	uint64_t log_cont, log_buf, log_buf_len, first_idx, next_idx;
+	uint64_t first_seq, next_seq;
+	err = linux_helper_read_global(prog, "LOG_CONT", &tmp, &log_cont);
+	if (!err)
+		err = linux_helper_read_global(prog, "log_buf", &tmp, &log_buf);
+	if (!err) {
+		err = linux_helper_read_global(prog, "log_buf_len", &tmp,
+					       &log_buf_len);
+	}
+	if (!err) {
+		err = linux_helper_read_global(prog, "log_first_idx", &tmp,
+					       &first_idx);
+	}
+	if (!err) {
+		err = linux_helper_read_global(prog, "log_next_idx", &tmp,
+					       &next_idx);
+	}
+	if (!err) {
+		err = linux_helper_read_global(prog, "log_first_seq", &tmp,
+					       &first_seq);
+	}
+	if (!err) {
+		err = linux_helper_read_global(prog, "log_next_seq", &tmp,
+					       &next_seq);
+	}
+	if (err)
+		goto out;
+	/* Don't read the buffer if there is nothing new. */
+	if (min_seq >= next_seq || !log_buf_len)
+		goto out;
+
+	struct drgn_qualified_type printk_log_type;
+	err = drgn_program_find_type(prog, "struct printk_log", NULL,
+				     &printk_log_type);
+	if (err)
+		goto out;
+	struct drgn_type *type = printk_log_type.type;
+	uint64_t header_size;
+	struct linux_helper_field ts_nsec, len, text_len, dict_len, facility;
+	struct linux_helper_field flags, level, caller_id;
+	err = drgn_type_sizeof(type, &header_size);
+	if (!err)
+		err = linux_helper_field_init(&ts_nsec, type, "ts_nsec", true);
+	if (!err)
+		err = linux_helper_field_init(&len, type, "len", true);
+	if (!err)
+		err = linux_helper_field_init(&text_len, type, "text_len", true);
+	if (!err)
+		err = linux_helper_field_init(&dict_len, type, "dict_len", true);
+	if (!err)
+		err = linux_helper_field_init(&facility, type, "facility", true);
+	if (!err)
+		err = linux_helper_field_init(&flags, type, "flags", true);
+	if (!err)
+		err = linux_helper_field_init(&level, type, "level", true);
+	if (err)
+		goto out;
+	/*
+	 * The caller ID was added in Linux kernel commit 15ff2069cb7f
+	 * ("printk: Add caller information to printk() output.") (in v5.1).
+	 */
+	bool have_caller_id;
+	err = linux_helper_field_init(&caller_id, type, "caller_id", true);
+	if (!err) {
+		have_caller_id = true;
+	} else if (err->code == DRGN_ERROR_LOOKUP) {
+		drgn_error_destroy(err);
+		have_caller_id = false;
+	} else {
+		goto out;
+	}
+
+	buf = malloc(log_buf_len);
+	if (!buf) {
+		err = &drgn_enomem;
+		goto out;
+	}
+	err = drgn_program_read_memory(prog, buf, log_buf, log_buf_len, false);
+	if (err)
+		goto out;
+
+	uint64_t idx = first_idx, seq = first_seq;
+	bool wrapped = false;
+	while (idx != next_idx) {
+		if (idx > log_buf_len || header_size > log_buf_len - idx)
+			break;
+		const char *log = buf + idx;
+		uint64_t log_len = linux_helper_field_read(&len, log,
+							   little_endian);
+		if (!log_len) {
+			/*
+			 * Zero means the buffer wrapped around. Avoid getting
+			 * into an infinite loop if the buffer is corrupted.
+			 */
+			if (wrapped || idx < next_idx)
+				break;
+			wrapped = true;
+			idx = 0;
+			continue;
+		}
+		uint64_t log_text_len =
+			linux_helper_field_read(&text_len, log, little_endian);
+		uint64_t log_dict_len =
+			linux_helper_field_read(&dict_len, log, little_endian);
+		if (log_len > log_buf_len - idx ||
+		    header_size + log_text_len + log_dict_len > log_len)
+			break;
+		if (seq < min_seq)
+			goto next;
+
+		uint64_t flags_value = linux_helper_field_read(&flags, log,
+							       little_endian);
+		struct linux_helper_printk_record record = {
+			.seq = seq,
+			.timestamp = linux_helper_field_read(&ts_nsec, log,
+							     little_endian),
+			.text = log + header_size,
+			.text_len = log_text_len,
+			.dict = log + header_size + log_text_len,
+			.dict_len = log_dict_len,
+			.has_caller_id = have_caller_id,
+			.facility = linux_helper_field_read(&facility, log,
+							    little_endian),
+			.level = linux_helper_field_read(&level, log,
+							 little_endian),
+			.continuation = flags_value & log_cont,
+		};
+		if (have_caller_id) {
+			record.caller_id = linux_helper_field_read(&caller_id,
+								   log,
+								   little_endian);
+		}
+		err = fn(&record, arg);
+		if (err)
+			goto out;
+next:
+		idx += log_len;
+		seq++;
+	}
+	err = NULL;
+out:
+	free(buf);
+	drgn_object_deinit(&tmp);
+	return err;
+}
+
+struct drgn_error *
+linux_helper_for_each_printk_record(struct drgn_program *prog, uint64_t min_seq,
+				    linux_helper_printk_record_fn *fn,
+				    void *arg)
+{
+	struct drgn_error *err;
+
+	if (!(prog->flags & DRGN_PROGRAM_IS_LINUX_KERNEL)) {
+		return drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+					 "not Linux kernel");
+	}
+
+	struct drgn_object prb;
+	drgn_object_init(&prb, prog);
+	/*
+	 * Linux kernel commit 896fbe20b4e2 ("printk: use the lockless
+	 * ringbuffer") (in v5.10) changed the ring buffer structure
+	 * completely.
+	 */
+	err = drgn_program_find_object(prog, "prb", NULL, DRGN_FIND_OBJECT_ANY,
+				       &prb);
+	if (!err) {
+		err = linux_helper_printk_lockless(prog, &prb, min_seq, fn,
+						   arg);
+	} else if (err->code == DRGN_ERROR_LOOKUP) {
+		drgn_error_destroy(err);
+		err = linux_helper_printk_structured(prog, min_seq, fn, arg);
+	}
+	drgn_object_deinit(&prb);
+	return err;
+}
+
+DEFINE_VECTOR_FUNCTIONS(linux_helper_task_index_entry_vector)
+DEFINE_HASH_MAP_FUNCTIONS(linux_helper_task_id_map, int_key_hash_pair,
+			  scalar_key_eq)
+DEFINE_HASH_MAP_FUNCTIONS(linux_helper_task_comm_map, c_string_key_hash_pair,
+			  c_string_key_eq)
+
+/* Maximum number of bytes spanned by task_struct::pid and task_struct::tgid. */
+#define LINUX_HELPER_TASK_IDS_MAX_SIZE 16
+
+/* Add the tasks read by linux_helper_task_index_create() to the maps. */
+static struct drgn_error *
+linux_helper_task_index_link(struct linux_helper_task_index *index)
+{
+	/*
+	 * Going backwards and pushing each task onto the front of its lists
+	 * leaves the lists in the order that the tasks were found.
+	 */
+	for (size_t i = index->entries.size; i-- > 0;) {
+		struct linux_helper_task_index_entry *entry =
+			&index->entries.data[i];
+		struct linux_helper_task_id_map_iterator it;
+		int r;
+
+		/* The idle tasks don't have a PID. */
+		if (entry->pid) {
+			struct linux_helper_task_id_map_entry pid_entry = {
+				.key = entry->pid,
+				.value = i,
+			};
+			if (linux_helper_task_id_map_insert(&index->pids,
+							    &pid_entry,
+							    NULL) < 0)
+				return &drgn_enomem;
+
+			struct linux_helper_task_id_map_entry tgid_entry = {
+				.key = entry->tgid,
+				.value = i,
+			};
+			r = linux_helper_task_id_map_insert(&index->tgids,
+							    &tgid_entry, &it);
+			if (r < 0)
+				return &drgn_enomem;
+			if (r == 0) {
+				entry->next_in_thread_group = it.entry->value;
+				it.entry->value = i;
+			}
+		}
+
+		struct linux_helper_task_comm_map_entry comm_entry = {
+			.key = entry->comm,
+			.value = i,
+		};
+		struct linux_helper_task_comm_map_iterator comm_it;
+		r = linux_helper_task_comm_map_insert(&index->comms,
+						      &comm_entry, &comm_it);
+		if (r < 0)
+			return &drgn_enomem;
+		if (r == 0) {
+			entry->next_with_comm = comm_it.entry->value;
+			comm_it.entry->value = i;
+		}
+	}
+	return NULL;
+}
+
+struct drgn_error *
+linux_helper_task_index_create(struct drgn_program *prog,
+			       struct linux_helper_task_index **ret)
+{
+	struct drgn_error *err;
+
+	if (!(prog->flags & DRGN_PROGRAM_IS_LINUX_KERNEL)) {
+		return drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+					 "not Linux kernel");
+	}
+	bool little_endian;
+	err = drgn_program_is_little_endian(prog, &little_endian);
+	if (err)
+		return err;
+
+	struct linux_helper_task_index *index = malloc(sizeof(*index));
+	if (!index)
+		return &drgn_enomem;
+	linux_helper_task_index_entry_vector_init(&index->entries);
+	linux_helper_task_id_map_init(&index->pids);
+	linux_helper_task_id_map_init(&index->tgids);
+	linux_helper_task_comm_map_init(&index->comms);
+
+	struct drgn_object tmp;
+	drgn_object_init(&tmp, prog);
+	err = drgn_program_find_object(prog, "init_pid_ns", NULL,
+				       DRGN_FIND_OBJECT_VARIABLE, &tmp);
+	if (err)
+		goto out;
+	err = drgn_object_address_of(&tmp, &tmp);
+	if (err)
+		goto out;
+	err = drgn_object_read_unsigned(&tmp, &index->init_pid_ns_address);
+	if (err)
+		goto out;
+	err = drgn_program_find_type(prog, "struct task_struct *", NULL,
+				     &index->task_struct_pointer_type);
+	if (err)
+		goto out;
+	struct drgn_type *task_struct_type =
+		drgn_type_type(index->task_struct_pointer_type.type).type;
+	task_struct_type = drgn_underlying_type(task_struct_type);
+
+	struct linux_helper_field pid, tgid, comm;
+	err = linux_helper_field_init(&pid, task_struct_type, "pid", true);
+	if (!err) {
+		err = linux_helper_field_init(&tgid, task_struct_type, "tgid",
+					      true);
+	}
+	if (!err) {
+		err = linux_helper_field_init(&comm, task_struct_type, "comm",
+					      false);
+	}
+	if (err)
+		goto out;
+	/* pid and tgid are adjacent, so they are read together. */
+	uint64_t ids_bit_offset = min(pid.bit_offset, tgid.bit_offset) & ~7;
+	uint64_t ids_size = (max(pid.bit_offset + pid.bit_size,
+				 tgid.bit_offset + tgid.bit_size) -
+			     ids_bit_offset + 7) / 8;
+	if (ids_size > LINUX_HELPER_TASK_IDS_MAX_SIZE) {
+		err = drgn_error_create(DRGN_ERROR_TYPE,
+					"struct task_struct has unexpected layout");
+		goto out;
+	}
+	pid.bit_offset -= ids_bit_offset;
+	tgid.bit_offset -= ids_bit_offset;
+	uint64_t comm_size = min(comm.bit_size / 8,
+				 (uint64_t)LINUX_HELPER_TASK_COMM_LEN - 1);
+
+	struct linux_helper_task_iterator it;
+	err = linux_helper_task_iterator_init(&it, prog);
+	if (err)
+		goto out;
+	for (;;) {
+		const struct drgn_object *task;
+		err = linux_helper_task_iterator_next(&it, &task);
+		if (err || !task)
+			break;
+		if (index->entries.size >= UINT32_MAX) {
+			err = drgn_error_create(DRGN_ERROR_OUT_OF_BOUNDS,
+						"too many tasks");
+			break;
+		}
+		struct linux_helper_task_index_entry *entry =
+			linux_helper_task_index_entry_vector_append_entry(&index->entries);
+		if (!entry) {
+			err = &drgn_enomem;
+			break;
+		}
+		memset(entry, 0, sizeof(*entry));
+		entry->next_in_thread_group = UINT32_MAX;
+		entry->next_with_comm = UINT32_MAX;
+		err = drgn_object_read_unsigned(task, &entry->address);
+		if (err)
+			break;
+		char ids[LINUX_HELPER_TASK_IDS_MAX_SIZE];
+		err = drgn_program_read_memory(prog, ids,
+					       entry->address +
+					       ids_bit_offset / 8,
+					       ids_size, false);
+		if (err)
+			break;
+		entry->pid = linux_helper_field_read(&pid, ids, little_endian);
+		entry->tgid = linux_helper_field_read(&tgid, ids,
+						      little_endian);
+		err = drgn_program_read_memory(prog, entry->comm,
+					       entry->address +
+					       comm.bit_offset / 8,
+					       comm_size, false);
+		if (err)
+			break;
+	}
+	linux_helper_task_iterator_deinit(&it);
+	if (err)
+		goto out;
+
+	/* The comm map points into the entries, so they must be final. */
+	linux_helper_task_index_entry_vector_shrink_to_fit(&index->entries);
+	err = linux_helper_task_index_link(index);
+out:
+	drgn_object_deinit(&tmp);
+	if (err)
+		linux_helper_task_index_destroy(index);
+	else
+		*ret = index;
+	return err;
+}
+
+void linux_helper_task_index_destroy(struct linux_helper_task_index *index)
+{
+	if (!index)
+		return;
+	linux_helper_task_comm_map_deinit(&index->comms);
+	linux_helper_task_id_map_deinit(&index->tgids);
+	linux_helper_task_id_map_deinit(&index->pids);
+	linux_helper_task_index_entry_vector_deinit(&index->entries);
+	free(index);
+}
+
+struct drgn_error *
+linux_helper_cached_task_index(struct drgn_program *prog,
+			       struct linux_helper_task_index **ret)
+{
+	struct drgn_error *err = NULL;
+
+	if ((prog->flags & (DRGN_PROGRAM_IS_LINUX_KERNEL |
+			    DRGN_PROGRAM_IS_LIVE)) !=
+	    DRGN_PROGRAM_IS_LINUX_KERNEL || prog->task_index_disabled) {
+		*ret = NULL;
+		return NULL;
+	}
+
+	drgn_program_lock(prog);
+	if (!prog->task_index && !prog->task_index_disabled) {
+		err = linux_helper_task_index_create(prog, &prog->task_index);
+		if (err && err != &drgn_enomem) {
+			/*
+			 * The task list of this kernel can't be walked, so fall
+			 * back to looking up each task in the PID namespace.
+			 */
+			drgn_error_destroy(err);
+			err = NULL;
+			prog->task_index_disabled = true;
+		}
+	}
+	*ret = prog->task_index;
+	drgn_program_unlock(prog);
+	return err;
+}
+
+const struct linux_helper_task_index_entry *
+linux_helper_task_index_find_pid(struct linux_helper_task_index *index,
+				 uint32_t pid)
+{
+	struct linux_helper_task_id_map_iterator it =
+		linux_helper_task_id_map_search(&index->pids, &pid);
+	return it.entry ? &index->entries.data[it.entry->value] : NULL;
+}
+
+const struct linux_helper_task_index_entry *
+linux_helper_task_index_find_tgid(struct linux_helper_task_index *index,
+				  uint32_t tgid)
+{
+	struct linux_helper_task_id_map_iterator it =
+		linux_helper_task_id_map_search(&index->tgids, &tgid);
+	return it.entry ? &index->entries.data[it.entry->value] : NULL;
+}
+
+const struct linux_helper_task_index_entry *
+linux_helper_task_index_find_comm(struct linux_helper_task_index *index,
+				  const char *comm)
+{
+	struct linux_helper_task_comm_map_iterator it =
+		linux_helper_task_comm_map_search(&index->comms, &comm);
+	return it.entry ? &index->entries.data[it.entry->value] : NULL;
+}
+
+DEFINE_VECTOR(linux_helper_open_file_vector, struct linux_helper_open_file)
+
+/* Layout of the structures walked by linux_helper_task_files(). */
+struct linux_helper_fdtable_layout {
+	struct linux_helper_field task_files;
+	struct linux_helper_field files_fdt;
+	struct linux_helper_field max_fds;
+	struct linux_helper_field open_fds;
+	struct linux_helper_field fd;
+	uint64_t fdtable_size;
+	/* Size of a pointer and of an open_fds word. */
+	uint8_t word_size;
+	bool little_endian;
+};
+
+static struct drgn_error *
+linux_helper_fdtable_layout_init(struct linux_helper_fdtable_layout *layout,
+				 struct drgn_program *prog)
+{
+	struct drgn_error *err;
+	struct drgn_qualified_type task_struct_type, files_struct_type;
+	struct drgn_qualified_type fdtable_type;
+	err = drgn_program_find_type(prog, "struct task_struct", NULL,
+				     &task_struct_type);
+	if (err)
+		return err;
+	err = drgn_program_find_type(prog, "struct files_struct", NULL,
+				     &files_struct_type);
+	if (err)
+		return err;
+	err = drgn_program_find_type(prog, "struct fdtable", NULL,
+				     &fdtable_type);
+	if (err)
+		return err;
+	err = linux_helper_field_init(&layout->task_files,
+				      task_struct_type.type, "files", true);
+	if (err)
+		return err;
+	err = linux_helper_field_init(&layout->files_fdt,
+				      files_struct_type.type, "fdt", true);
+	if (err)
+		return err;
+	err = linux_helper_field_init(&layout->max_fds, fdtable_type.type,
+				      "max_fds", true);
+	if (err)
+		return err;
+	err = linux_helper_field_init(&layout->open_fds, fdtable_type.type,
+				      "open_fds", true);
+	if (err)
+		return err;
+	err = linux_helper_field_init(&layout->fd, fdtable_type.type, "fd",
+				      true);
+	if (err)
+		return err;
+	err = drgn_type_sizeof(fdtable_type.type, &layout->fdtable_size);
+	if (err)
+		return err;
+	err = drgn_program_address_size(prog, &layout->word_size);
+	if (err)
+		return err;
+	layout->little_endian = drgn_platform_is_little_endian(&prog->platform);
+	return NULL;
+}
+
+static struct drgn_error *
+linux_helper_walk_task_fdtable(struct drgn_program *prog,
+			       const struct linux_helper_fdtable_layout *layout,
+			       uint64_t task,
+			       struct linux_helper_open_file_vector *files)
+{
+	struct drgn_error *err;
+	uint64_t files_address, fdt;
+	err = linux_helper_field_read_memory(prog, &layout->task_files, task,
+					     layout->little_endian,
+					     &files_address);
+	if (err)
+		return err;
+	err = linux_helper_field_read_memory(prog, &layout->files_fdt,
+					     files_address,
+					     layout->little_endian, &fdt);
+	if (err)
+		return err;
+
+	char *fdtable_buf = malloc(layout->fdtable_size);
+	if (!fdtable_buf)
+		return &drgn_enomem;
+	err = drgn_program_read_memory(prog, fdtable_buf, fdt,
+				       layout->fdtable_size, false);
+	if (err) {
+		free(fdtable_buf);
+		return err;
+	}
+	uint64_t max_fds = linux_helper_field_read(&layout->max_fds,
+						   fdtable_buf,
+						   layout->little_endian);
+	uint64_t open_fds = linux_helper_field_read(&layout->open_fds,
+						    fdtable_buf,
+						    layout->little_endian);
+	uint64_t fd_array = linux_helper_field_read(&layout->fd, fdtable_buf,
+						    layout->little_endian);
+	free(fdtable_buf);
+
+	bool little_endian = layout->little_endian;
+	uint64_t word_size = layout->word_size;
+	uint64_t word_bits = 8 * word_size;
+	uint64_t num_words = max_fds / word_bits + (max_fds % word_bits != 0);
+	if (num_words > SIZE_MAX / word_size)
+		return &drgn_enomem;
+	char *bitmap = malloc(max(num_words * word_size, (uint64_t)1));
+	/* Pointers in the fd array covered by one bitmap word. */
+	char *pointers = malloc(word_bits * word_size);
+	if (!bitmap || !pointers) {
+		err = &drgn_enomem;
+		goto out;
+	}
+	err = drgn_program_read_memory(prog, bitmap, open_fds,
+				       num_words * word_size, false);
+	if (err)
+		goto out;
+
+	struct linux_helper_field word_field = { 0, word_bits };
+	for (uint64_t i = 0; i < num_words; i++) {
+		uint64_t word = linux_helper_field_read(&word_field,
+							bitmap + i * word_size,
+							little_endian);
+		if (!word)
+			continue;
+		/* Only read the slots between the lowest and highest set bit. */
+		uint64_t first = ctz(word);
+		uint64_t last = fls(word) - 1;
+		uint64_t base = i * word_bits;
+		err = drgn_program_read_memory(prog, pointers,
+					       fd_array +
+					       (base + first) * word_size,
+					       (last - first + 1) * word_size,
+					       false);
+		if (err)
+			goto out;
+		unsigned int j;
+		for_each_bit(j, word) {
+			struct linux_helper_open_file *file =
+				linux_helper_open_file_vector_append_entry(files);
+			if (!file) {
+				err = &drgn_enomem;
+				goto out;
+			}
+			file->task = task;
+			file->fd = base + j;
+			const char *pointer =
+				pointers + (j - first) * word_size;
+			file->file = linux_helper_field_read(&word_field,
+							     pointer,
+							     little_endian);
+		}
+	}
+	err = NULL;
+out:
+	free(pointers);
+	free(bitmap);
+	return err;
+}
+
+struct drgn_error *
+linux_helper_task_files(struct drgn_program *prog, const uint64_t *tasks,
+			size_t num_tasks, bool skip_faults,
+			struct linux_helper_open_file **files_ret,
+			size_t *num_files_ret,
+			struct drgn_qualified_type *file_pointer_type_ret)
+{
+	struct drgn_error *err = NULL;
+	struct linux_helper_fdtable_layout layout;
+	err = linux_helper_fdtable_layout_init(&layout, prog);
+	if (err)
+		return err;
+	err = drgn_program_find_type(prog, "struct file *", NULL,
+				     file_pointer_type_ret);
+	if (err)
+		return err;
+
+	struct linux_helper_open_file_vector *task_files =
+		malloc_array(num_tasks, sizeof(task_files[0]));
+	if (!task_files && num_tasks)
+		return &drgn_enomem;
+	for (size_t i = 0; i < num_tasks; i++)
+		linux_helper_open_file_vector_init(&task_files[i]);
+
+	/* File descriptor tables are independent, so walk them in parallel. */
+	#pragma omp parallel if (num_tasks > 1) \
+		num_threads(drgn_program_num_parallel_threads(prog))
+	{
+		drgn_program_bind_parallel_thread(prog);
+		#pragma omp for schedule(dynamic)
+		for (size_t i = 0; i < num_tasks; i++) {
+			if (err)
+				continue;
+			struct drgn_error *walk_err =
+				linux_helper_walk_task_fdtable(prog, &layout,
+							       tasks[i],
+							       &task_files[i]);
+			if (walk_err && skip_faults &&
+			    walk_err->code == DRGN_ERROR_FAULT) {
+				drgn_error_destroy(walk_err);
+				linux_helper_open_file_vector_deinit(&task_files[i]);
+				linux_helper_open_file_vector_init(&task_files[i]);
+			} else if (walk_err) {
+				#pragma omp critical(linux_helper_task_files_error)
+				if (err)
+					drgn_error_destroy(walk_err);
+				else
+					err = walk_err;
+			}
+		}
+	}
+	if (err)
+		goto out;
+
+	size_t num_files = 0;
+	for (size_t i = 0; i < num_tasks; i++)
+		num_files += task_files[i].size;
+	struct linux_helper_open_file *files =
+		malloc_array(max(num_files, (size_t)1), sizeof(files[0]));
+	if (!files) {
+		err = &drgn_enomem;
+		goto out;
+	}
+	size_t k = 0;
+	for (size_t i = 0; i < num_tasks; i++) {
+		memcpy(&files[k], task_files[i].data,
+		       task_files[i].size * sizeof(files[0]));
+		k += task_files[i].size;
+	}
+	*files_ret = files;
+	*num_files_ret = num_files;
+out:
+	for (size_t i = 0; i < num_tasks; i++)
+		linux_helper_open_file_vector_deinit(&task_files[i]);
+	free(task_files);
+	return err;
+}
+
+/*
+ * A cached path is a sequence of "/component" strings stored in
+ * linux_helper_path_cache::strings.
+ */
+struct linux_helper_path_value {
+	size_t offset;
+	size_t len;
+	/*
+	 * For a dentry, whether the walk stopped at the given root rather than
+	 * at the root of the filesystem.
+	 */
+	bool reached_stop;
+};
+
+struct linux_helper_path_key {
+	/* Dentry to stop at, or 0 to stop only at the root of the filesystem. */
+	uint64_t stop;
+	uint64_t dentry;
+};
+
+static struct hash_pair
+linux_helper_path_key_hash_pair(const struct linux_helper_path_key *key)
+{
+	return hash_pair_from_avalanching_hash(hash_combine(key->stop,
+							    key->dentry));
+}
+
+static bool linux_helper_path_key_eq(const struct linux_helper_path_key *a,
+				     const struct linux_helper_path_key *b)
+{
+	return a->stop == b->stop && a->dentry == b->dentry;
+}
+
+DEFINE_HASH_MAP(linux_helper_dentry_path_map, struct linux_helper_path_key,
+		struct linux_helper_path_value, linux_helper_path_key_hash_pair,
+		linux_helper_path_key_eq)
+DEFINE_HASH_MAP(linux_helper_mount_path_map, uint64_t,
+		struct linux_helper_path_value, int_key_hash_pair,
+		scalar_key_eq)
+
+struct linux_helper_path_cache {
+	struct drgn_program *prog;
+	struct linux_helper_field d_parent;
+	struct linux_helper_field d_name;
+	struct linux_helper_field d_op;
+	struct linux_helper_field d_inode;
+	struct linux_helper_field d_dname;
+	struct linux_helper_field i_sb;
+	struct linux_helper_field s_type;
+	struct linux_helper_field fs_type_name;
+	struct linux_helper_field mnt_parent;
+	struct linux_helper_field mnt_mountpoint;
+	struct linux_helper_field mnt_root;
+	/* Offset of the struct vfsmount in struct mount. */
+	uint64_t mount_mnt_offset;
+	bool little_endian;
+	/* Paths of dentries relative to a root. */
+	struct linux_helper_dentry_path_map dentries;
+	/*
+	 * Paths of the roots of mounts. The path of a dentry in a mount is the
+	 * path of the mount followed by its path relative to the mount root.
+	 */
+	struct linux_helper_mount_path_map mounts;
+	/* Storage for the cached paths. */
+	struct string_builder strings;
+};
+
+struct drgn_error *
+linux_helper_path_cache_create(struct drgn_program *prog,
+			       struct linux_helper_path_cache **ret)
+{
+	struct drgn_error *err;
+	struct drgn_qualified_type dentry_type, dentry_operations_type;
+	struct drgn_qualified_type inode_type, super_block_type;
+	struct drgn_qualified_type file_system_type_type, mount_type;
+	struct linux_helper_field mount_mnt;
+
+	struct linux_helper_path_cache *cache = calloc(1, sizeof(*cache));
+	if (!cache)
+		return &drgn_enomem;
+	cache->prog = prog;
+#define FIND_TYPE(var, name) do {					\
+	err = drgn_program_find_type(prog, name, NULL, &var);		\
+	if (err)							\
+		goto err;						\
+} while (0)
+	FIND_TYPE(dentry_type, "struct dentry");
+	FIND_TYPE(dentry_operations_type, "struct dentry_operations");
+	FIND_TYPE(inode_type, "struct inode");
+	FIND_TYPE(super_block_type, "struct super_block");
+	FIND_TYPE(file_system_type_type, "struct file_system_type");
+	FIND_TYPE(mount_type, "struct mount");
+#undef FIND_TYPE
+#define FIELD(field, qualified_type, designator, integer) do {		\
+	err = linux_helper_field_init(&field, qualified_type.type,	\
+				      designator, integer);		\
+	if (err)							\
+		goto err;						\
+} while (0)
+	FIELD(cache->d_parent, dentry_type, "d_parent", true);
+	FIELD(cache->d_name, dentry_type, "d_name.name", true);
+	FIELD(cache->d_op, dentry_type, "d_op", true);
+	FIELD(cache->d_inode, dentry_type, "d_inode", true);
+	FIELD(cache->d_dname, dentry_operations_type, "d_dname", true);
+	FIELD(cache->i_sb, inode_type, "i_sb", true);
+	FIELD(cache->s_type, super_block_type, "s_type", true);
+	FIELD(cache->fs_type_name, file_system_type_type, "name", true);
+	FIELD(cache->mnt_parent, mount_type, "mnt_parent", true);
+	FIELD(cache->mnt_mountpoint, mount_type, "mnt_mountpoint", true);
+	FIELD(cache->mnt_root, mount_type, "mnt.mnt_root", true);
+	FIELD(mount_mnt, mount_type, "mnt", false);
+#undef FIELD
+	cache->mount_mnt_offset = mount_mnt.bit_offset / 8;
+	cache->little_endian = drgn_platform_is_little_endian(&prog->platform);
+	linux_helper_dentry_path_map_init(&cache->dentries);
+	linux_helper_mount_path_map_init(&cache->mounts);
+	*ret = cache;
+	return NULL;
+
+err:
+	free(cache);
+	return err;
+}
+
+void linux_helper_path_cache_destroy(struct linux_helper_path_cache *cache)
+{
+	if (!cache)
+		return;
+	free(cache->strings.str);
+	linux_helper_mount_path_map_deinit(&cache->mounts);
+	linux_helper_dentry_path_map_deinit(&cache->dentries);
+	free(cache);
+}
+
+struct drgn_error *
+linux_helper_cached_path_cache(struct drgn_program *prog,
+			       struct linux_helper_path_cache **ret)
+{
+	struct drgn_error *err = NULL;
+
+	if ((prog->flags & (DRGN_PROGRAM_IS_LINUX_KERNEL |
+			    DRGN_PROGRAM_IS_LIVE)) !=
+	    DRGN_PROGRAM_IS_LINUX_KERNEL) {
+		*ret = NULL;
+		return NULL;
+	}
+
+	drgn_program_lock(prog);
+	if (!prog->path_cache)
+		err = linux_helper_path_cache_create(prog, &prog->path_cache);
+	*ret = prog->path_cache;
+	drgn_program_unlock(prog);
+	return err;
+}
+
+static inline struct drgn_error *
+linux_helper_path_cache_read(struct linux_helper_path_cache *cache,
+			     const struct linux_helper_field *field,
+			     uint64_t address, uint64_t *ret)
+{
+	return linux_helper_field_read_memory(cache->prog, field, address,
+					      cache->little_endian, ret);
+}
+
+/*
+ * Append a cached path followed by a slash and a component to the cached paths.
+ */
+static bool
+linux_helper_path_cache_append(struct linux_helper_path_cache *cache,
+			       const struct linux_helper_path_value *base,
+			       const char *component, size_t len,
+			       struct linux_helper_path_value *ret)
+{
+	struct string_builder *strings = &cache->strings;
+	if (!string_builder_reserve(strings, strings->len + base->len + 1 + len))
+		return false;
+	char *p = strings->str + strings->len;
+	memcpy(p, strings->str + base->offset, base->len);
+	p[base->len] = '/';
+	memcpy(p + base->len + 1, component, len);
+	ret->offset = strings->len;
+	ret->len = base->len + 1 + len;
+	strings->len += ret->len;
+	return true;
+}
+
+/* Append the concatenation of two cached paths to the cached paths. */
+static bool linux_helper_path_cache_join(struct linux_helper_path_cache *cache,
+					 const struct linux_helper_path_value *a,
+					 const struct linux_helper_path_value *b,
+					 struct linux_helper_path_value *ret)
+{
+	struct string_builder *strings = &cache->strings;
+	if (!string_builder_reserve(strings, strings->len + a->len + b->len))
+		return false;
+	memcpy(strings->str + strings->len, strings->str + a->offset, a->len);
+	memcpy(strings->str + strings->len + a->len, strings->str + b->offset,
+	       b->len);
+	ret->offset = strings->len;
+	ret->len = a->len + b->len;
+	strings->len += ret->len;
+	return true;
+}
+
+/* Get the path of a dentry relative to stop or the root of its filesystem. */
+static struct drgn_error *
+linux_helper_dentry_rel_path(struct linux_helper_path_cache *cache,
+			     uint64_t stop, uint64_t dentry,
+			     struct linux_helper_path_value *ret)
+{
+	struct drgn_error *err;
+	struct linux_helper_address_vector chain = VECTOR_INIT;
+	struct linux_helper_path_value value;
+
+	/* Walk up until we find a cached ancestor or the root. */
+	for (;;) {
+		struct linux_helper_path_key key = { stop, dentry };
+		struct linux_helper_dentry_path_map_iterator it =
+			linux_helper_dentry_path_map_search(&cache->dentries,
+							    &key);
+		if (it.entry) {
+			value = it.entry->value;
+			break;
+		}
+		if (dentry == stop) {
+			value = (struct linux_helper_path_value){
+				.reached_stop = true,
+			};
+			break;
+		}
+		uint64_t d_parent;
+		err = linux_helper_path_cache_read(cache, &cache->d_parent,
+						   dentry, &d_parent);
+		if (err)
+			goto out;
+		if (d_parent == dentry) {
+			value = (struct linux_helper_path_value){};
+			break;
+		}
+		if (!linux_helper_address_vector_append(&chain, &dentry)) {
+			err = &drgn_enomem;
+			goto out;
+		}
+		dentry = d_parent;
+	}
+
+	/* Build and cache the path of each dentry on the way back down. */
+	for (size_t i = chain.size; i-- > 0;) {
+		uint64_t name_address;
+		err = linux_helper_path_cache_read(cache, &cache->d_name,
+						   chain.data[i],
+						   &name_address);
+		if (err)
+			goto out;
+		char *name;
+		err = drgn_program_read_c_string(cache->prog, name_address,
+						 false, SIZE_MAX, &name);
+		if (err)
+			goto out;
+		struct linux_helper_path_value new_value = {
+			.reached_stop = value.reached_stop,
+		};
+		bool ok = linux_helper_path_cache_append(cache, &value, name,
+							 strlen(name),
+							 &new_value);
+		free(name);
+		struct linux_helper_dentry_path_map_entry entry = {
+			.key = { stop, chain.data[i] },
+			.value = new_value,
+		};
+		if (!ok ||
+		    linux_helper_dentry_path_map_insert(&cache->dentries,
+							&entry, NULL) < 0) {
+			err = &drgn_enomem;
+			goto out;
+		}
+		value = new_value;
+	}
+	err = NULL;
+out:
+	linux_helper_address_vector_deinit(&chain);
+	if (!err)
+		*ret = value;
+	return err;
+}
+
+/* Get the path of the root of a mount (given as a struct mount *). */
+static struct drgn_error *
+linux_helper_mount_path(struct linux_helper_path_cache *cache, uint64_t mnt,
+			struct linux_helper_path_value *ret)
+{
+	struct drgn_error *err;
+	struct linux_helper_address_vector chain = VECTOR_INIT;
+	struct linux_helper_path_value value;
+
+	for (;;) {
+		struct linux_helper_mount_path_map_iterator it =
+			linux_helper_mount_path_map_search(&cache->mounts,
+							   &mnt);
+		if (it.entry) {
+			value = it.entry->value;
+			break;
+		}
+		uint64_t mnt_parent;
+		err = linux_helper_path_cache_read(cache, &cache->mnt_parent,
+						   mnt, &mnt_parent);
+		if (err)
+			goto out;
+		if (mnt_parent == mnt) {
+			value = (struct linux_helper_path_value){};
+			break;
+		}
+		if (!linux_helper_address_vector_append(&chain, &mnt)) {
+			err = &drgn_enomem;
+			goto out;
+		}
+		mnt = mnt_parent;
+	}
+
+	for (size_t i = chain.size; i-- > 0;) {
+		uint64_t mnt = chain.data[i];
+		uint64_t mnt_parent, mountpoint, parent_root;
+		err = linux_helper_path_cache_read(cache, &cache->mnt_parent,
+						   mnt, &mnt_parent);
+		if (!err) {
+			err = linux_helper_path_cache_read(cache,
+							   &cache->mnt_mountpoint,
+							   mnt, &mountpoint);
+		}
+		if (!err) {
+			err = linux_helper_path_cache_read(cache,
+							   &cache->mnt_root,
+							   mnt_parent,
+							   &parent_root);
+		}
+		struct linux_helper_path_value rel;
+		if (!err) {
+			err = linux_helper_dentry_rel_path(cache, parent_root,
+							   mountpoint, &rel);
+		}
+		if (err)
+			goto out;
+		/*
+		 * If the mountpoint isn't under the root of the parent mount,
+		 * its path is relative to the root of its filesystem.
+		 */
+		struct linux_helper_path_value new_value = rel;
+		if (rel.reached_stop &&
+		    !linux_helper_path_cache_join(cache, &value, &rel,
+						  &new_value)) {
+			err = &drgn_enomem;
+			goto out;
+		}
+		struct linux_helper_mount_path_map_entry entry = {
+			.key = mnt,
+			.value = new_value,
+		};
+		if (linux_helper_mount_path_map_insert(&cache->mounts, &entry,
+						       NULL) < 0) {
+			err = &drgn_enomem;
+			goto out;
+		}
+		value = new_value;
+	}
+	err = NULL;
+out:
+	linux_helper_address_vector_deinit(&chain);
+	if (!err)
+		*ret = value;
+	return err;
+}
+
+struct drgn_error *linux_helper_d_path(struct linux_helper_path_cache *cache,
+				       uint64_t vfsmnt, uint64_t dentry,
+				       struct string_builder *sb)
+{
+	struct drgn_error *err;
+	uint64_t mnt = vfsmnt - cache->mount_mnt_offset;
+
+	uint64_t d_op, d_dname = 0;
+	err = linux_helper_path_cache_read(cache, &cache->d_op, dentry, &d_op);
+	if (!err && d_op) {
+		err = linux_helper_path_cache_read(cache, &cache->d_dname, d_op,
+						   &d_dname);
+	}
+	if (err)
+		return err;
+	if (d_dname) {
+		/* Like the Python helper, don't call d_dname(). */
+		uint64_t address;
+		err = linux_helper_path_cache_read(cache, &cache->d_inode,
+						   dentry, &address);
+		if (!err) {
+			err = linux_helper_path_cache_read(cache, &cache->i_sb,
+							   address, &address);
+		}
+		if (!err) {
+			err = linux_helper_path_cache_read(cache,
+							   &cache->s_type,
+							   address, &address);
+		}
+		if (!err) {
+			err = linux_helper_path_cache_read(cache,
+							   &cache->fs_type_name,
+							   address, &address);
+		}
+		char *name;
+		if (!err) {
+			err = drgn_program_read_c_string(cache->prog, address,
+							 false, SIZE_MAX,
+							 &name);
+		}
+		if (err)
+			return err;
+		bool ok = string_builder_appendf(sb, "[%s]", name);
+		free(name);
+		return ok ? NULL : &drgn_enomem;
+	}
+
+	uint64_t mnt_root;
+	err = linux_helper_path_cache_read(cache, &cache->mnt_root, mnt,
+					   &mnt_root);
+	if (err)
+		return err;
+	struct linux_helper_path_value rel, prefix = {};
+	err = linux_helper_dentry_rel_path(cache, mnt_root, dentry, &rel);
+	if (err)
+		return err;
+	if (rel.reached_stop) {
+		err = linux_helper_mount_path(cache, mnt, &prefix);
+		if (err)
+			return err;
+	}
+	if (!prefix.len && !rel.len)
+		return string_builder_appendc(sb, '/') ? NULL : &drgn_enomem;
+	if (!string_builder_appendn(sb, cache->strings.str + prefix.offset,
+				    prefix.len) ||
+	    !string_builder_appendn(sb, cache->strings.str + rel.offset,
+				    rel.len))
+		return &drgn_enomem;
+	return NULL;
+}
+
+struct drgn_error *
+linux_helper_dentry_path(struct linux_helper_path_cache *cache,
+			 uint64_t dentry, struct string_builder *sb)
+{
+	struct drgn_error *err;
+	struct linux_helper_path_value rel;
+	err = linux_helper_dentry_rel_path(cache, 0, dentry, &rel);
+	if (err)
+		return err;
+	/* Skip the leading slash. */
+	if (rel.len &&
+	    !string_builder_appendn(sb, cache->strings.str + rel.offset + 1,
+				    rel.len - 1))
+		return &drgn_enomem;
+	return NULL;
+}
+
+DEFINE_VECTOR(linux_helper_css_entry_vector, struct linux_helper_css_entry)
+
+struct linux_helper_css_frame {
+	/* Address of the struct cgroup_subsys_state. */
+	uint64_t css;
+	/* Next entry to visit in css->children. */
+	uint64_t next;
+	size_t path_offset;
+	size_t path_len;
+};
+
+DEFINE_VECTOR(linux_helper_css_frame_vector, struct linux_helper_css_frame)
+
+/* Layout of the structures walked by linux_helper_css_descendants_pre(). */
+struct linux_helper_css_layout {
+	struct linux_helper_field children;
+	struct linux_helper_field sibling;
+	struct linux_helper_field flags;
+	struct linux_helper_field cgroup;
+	struct linux_helper_field kn;
+	struct linux_helper_field name;
+	uint64_t css_online;
+	bool little_endian;
+};
+
+static struct drgn_error *
+linux_helper_css_layout_init(struct linux_helper_css_layout *layout,
+			     struct drgn_program *prog)
+{
+	struct drgn_error *err;
+	struct drgn_qualified_type css_type, cgroup_type, kernfs_node_type;
+	err = drgn_program_find_type(prog, "struct cgroup_subsys_state", NULL,
+				     &css_type);
+	if (err)
+		return err;
+	err = drgn_program_find_type(prog, "struct cgroup", NULL,
+				     &cgroup_type);
+	if (err)
+		return err;
+	err = drgn_program_find_type(prog, "struct kernfs_node", NULL,
+				     &kernfs_node_type);
+	if (err)
+		return err;
+	err = linux_helper_field_init(&layout->children, css_type.type,
+				      "children.next", true);
+	if (err)
+		return err;
+	err = linux_helper_field_init(&layout->sibling, css_type.type,
+				      "sibling.next", true);
+	if (err)
+		return err;
+	err = linux_helper_field_init(&layout->flags, css_type.type, "flags",
+				      true);
+	if (err)
+		return err;
+	err = linux_helper_field_init(&layout->cgroup, css_type.type, "cgroup",
+				      true);
+	if (err)
+		return err;
+	err = linux_helper_field_init(&layout->kn, cgroup_type.type, "kn",
+				      true);
+	if (err)
+		return err;
+	err = linux_helper_field_init(&layout->name, kernfs_node_type.type,
+				      "name", true);
+	if (err)
+		return err;
+	struct drgn_object tmp;
+	drgn_object_init(&tmp, prog);
+	err = linux_helper_read_global(prog, "CSS_ONLINE", &tmp,
+				       &layout->css_online);
+	drgn_object_deinit(&tmp);
+	if (err)
+		return err;
+	layout->little_endian = drgn_platform_is_little_endian(&prog->platform);
+	return NULL;
+}
+
+/* Append the path of a child cgroup given the path of its parent. */
+static struct drgn_error *
+linux_helper_css_child_path(struct drgn_program *prog,
+			    const struct linux_helper_css_layout *layout,
+			    uint64_t css, struct string_builder *paths,
+			    size_t parent_offset, size_t parent_len,
+			    size_t *len_ret)
+{
+	struct drgn_error *err;
+	uint64_t address;
+	err = linux_helper_field_read_memory(prog, &layout->cgroup, css,
+					     layout->little_endian, &address);
+	if (err)
+		return err;
+	err = linux_helper_field_read_memory(prog, &layout->kn, address,
+					     layout->little_endian, &address);
+	if (err)
+		return err;
+	err = linux_helper_field_read_memory(prog, &layout->name, address,
+					     layout->little_endian, &address);
+	if (err)
+		return err;
+	char *name;
+	err = drgn_program_read_c_string(prog, address, false, SIZE_MAX,
+					 &name);
+	if (err)
+		return err;
+	size_t name_len = strlen(name);
+	size_t len = parent_len + 1 + name_len;
+	if (!string_builder_reserve(paths, paths->len + len)) {
+		free(name);
+		return &drgn_enomem;
+	}
+	char *p = paths->str + paths->len;
+	memcpy(p, paths->str + parent_offset, parent_len);
+	p[parent_len] = '/';
+	memcpy(p + parent_len + 1, name, name_len);
+	paths->len += len;
+	free(name);
+	*len_ret = len;
+	return NULL;
+}
+
+static struct drgn_error *
+linux_helper_walk_css(struct drgn_program *prog,
+		      const struct linux_helper_css_layout *layout,
+		      uint64_t root, struct string_builder *paths,
+		      size_t root_path_len,
+		      struct linux_helper_css_entry_vector *entries)
+{
+	struct drgn_error *err;
+	uint64_t children_offset = layout->children.bit_offset / 8;
+	uint64_t sibling_offset = layout->sibling.bit_offset / 8;
+	/* Children of "/" are "/name", not "//name". */
+	bool root_is_slash = root_path_len == 1 && paths->str[0] == '/';
+	struct linux_helper_css_frame_vector stack = VECTOR_INIT;
+	uint64_t css = root;
+	size_t path_offset = 0, path_len = root_path_len;
+	for (;;) {
+		uint64_t flags;
+		err = linux_helper_field_read_memory(prog, &layout->flags, css,
+						     layout->little_endian,
+						     &flags);
+		if (err)
+			goto out;
+		if (flags & layout->css_online) {
+			struct linux_helper_css_entry *entry =
+				linux_helper_css_entry_vector_append_entry(entries);
+			if (!entry) {
+				err = &drgn_enomem;
+				goto out;
+			}
+			entry->css = css;
+			entry->path_offset = path_offset;
+			entry->path_len = path_len;
+		}
+
+		struct linux_helper_css_frame *frame =
+			linux_helper_css_frame_vector_append_entry(&stack);
+		if (!frame) {
+			err = &drgn_enomem;
+			goto out;
+		}
+		frame->css = css;
+		frame->path_offset = path_offset;
+		frame->path_len = css == root && root_is_slash ? 0 : path_len;
+		err = linux_helper_field_read_memory(prog, &layout->children,
+						     css, layout->little_endian,
+						     &frame->next);
+		if (err)
+			goto out;
+
+		/*
+		 * Find the next css: the next child of the deepest css that has
+		 * one left.
+		 */
+		for (;;) {
+			if (!stack.size) {
+				err = NULL;
+				goto out;
+			}
+			frame = &stack.data[stack.size - 1];
+			if (frame->next != frame->css + children_offset)
+				break;
+			stack.size--;
+		}
+		css = frame->next - sibling_offset;
+		err = linux_helper_field_read_memory(prog, &layout->sibling,
+						     css, layout->little_endian,
+						     &frame->next);
+		if (err)
+			goto out;
+		path_offset = paths->len;
+		err = linux_helper_css_child_path(prog, layout, css, paths,
+						  frame->path_offset,
+						  frame->path_len, &path_len);
+		if (err)
+			goto out;
+	}
+
+out:
+	linux_helper_css_frame_vector_deinit(&stack);
+	return err;
+}
+
+struct drgn_error *
+linux_helper_css_descendants_pre(struct drgn_program *prog, uint64_t root,
+				 const char *root_path, size_t root_path_len,
+				 struct linux_helper_css_entry **entries_ret,
+				 size_t *num_entries_ret, char **paths_ret)
+{
+	struct drgn_error *err;
+	struct linux_helper_css_layout layout;
+	err = linux_helper_css_layout_init(&layout, prog);
+	if (err)
+		return err;
+
+	struct linux_helper_css_entry_vector entries = VECTOR_INIT;
+	struct string_builder paths = {};
+	if (!string_builder_appendn(&paths, root_path, root_path_len)) {
+		err = &drgn_enomem;
+		goto err;
+	}
+	err = linux_helper_walk_css(prog, &layout, root, &paths, root_path_len,
+				    &entries);
+	if (err)
+		goto err;
+	linux_helper_css_entry_vector_shrink_to_fit(&entries);
+	*entries_ret = entries.data;
+	*num_entries_ret = entries.size;
+	*paths_ret = paths.str;
+	return NULL;
+
+err:
+	linux_helper_css_entry_vector_deinit(&entries);
+	free(paths.str);
+	return err;
+}
+
+/* Linux ABI constants used by linux_helper_sk_hash_sockets(). */
+#define LINUX_AF_INET 2
+#define LINUX_AF_INET6 10
+#define LINUX_TCP_TIME_WAIT 6
+#define LINUX_TCP_NEW_SYN_RECV 12
+
+/* Layout of the parts of a socket read by linux_helper_sk_hash_sockets(). */
+struct linux_helper_sock_layout {
+	uint64_t sock_common_size;
+	struct linux_helper_field family;
+	struct linux_helper_field state;
+	/* skc_dport is big endian, and skc_num is host byte order. */
+	struct linux_helper_field dport;
+	struct linux_helper_field num;
+	struct linux_helper_field daddr;
+	struct linux_helper_field rcv_saddr;
+	/* These are only valid if have_v6 is true (i.e., CONFIG_IPV6). */
+	struct linux_helper_field v6_daddr;
+	struct linux_helper_field v6_rcv_saddr;
+	bool have_v6;
+	/* This is only valid if have_net is true (i.e., CONFIG_NET_NS). */
+	struct linux_helper_field net;
+	bool have_net;
+	/* Otherwise, every socket is in init_net. */
+	uint64_t init_net;
+	/* sk->sk_socket. */
+	struct linux_helper_field socket;
+	/* Offset from a struct socket to the i_ino of its inode. */
+	uint64_t socket_ino_offset;
+	struct linux_helper_field ino;
+	/* Offset of the list node in struct sock and its next pointer. */
+	uint64_t node_offset;
+	struct linux_helper_field next;
+	bool little_endian;
+};
+
+/* Look up an optional member, returning whether it exists. */
+static struct drgn_error *
+linux_helper_optional_field_init(struct linux_helper_field *field,
+				 struct drgn_type *type,
+				 const char *member_designator, bool integer,
+				 bool *found_ret)
+{
+	struct drgn_error *err = linux_helper_field_init(field, type,
+							 member_designator,
+							 integer);
+	if (err && err->code == DRGN_ERROR_LOOKUP) {
+		drgn_error_destroy(err);
+		*found_ret = false;
+		return NULL;
+	}
+	*found_ret = !err;
+	return err;
+}
+
+static struct drgn_error *
+linux_helper_sock_layout_init(struct linux_helper_sock_layout *layout,
+			      struct drgn_program *prog,
+			      const char *node_member)
+{
+	struct drgn_error *err;
+	struct drgn_qualified_type sock_common_type, sock_type;
+	struct drgn_qualified_type socket_alloc_type;
+	err = drgn_program_find_type(prog, "struct sock_common", NULL,
+				     &sock_common_type);
+	if (err)
+		return err;
+	err = drgn_program_find_type(prog, "struct sock", NULL, &sock_type);
+	if (err)
+		return err;
+	err = drgn_program_find_type(prog, "struct socket_alloc", NULL,
+				     &socket_alloc_type);
+	if (err)
+		return err;
+	err = drgn_type_sizeof(sock_common_type.type,
+			       &layout->sock_common_size);
+	if (err)
+		return err;
+
+	struct drgn_type *type = sock_common_type.type;
+	if ((err = linux_helper_field_init(&layout->family, type, "skc_family",
+					   true)) ||
+	    (err = linux_helper_field_init(&layout->state, type, "skc_state",
+					   true)) ||
+	    (err = linux_helper_field_init(&layout->dport, type, "skc_dport",
+					   true)) ||
+	    (err = linux_helper_field_init(&layout->num, type, "skc_num",
+					   true)) ||
+	    (err = linux_helper_field_init(&layout->daddr, type, "skc_daddr",
+					   false)) ||
+	    (err = linux_helper_field_init(&layout->rcv_saddr, type,
+					   "skc_rcv_saddr", false)) ||
+	    (err = linux_helper_optional_field_init(&layout->v6_daddr, type,
+						    "skc_v6_daddr", false,
+						    &layout->have_v6)))
+		return err;
+	if (layout->have_v6) {
+		err = linux_helper_field_init(&layout->v6_rcv_saddr, type,
+					      "skc_v6_rcv_saddr", false);
+		if (err)
+			return err;
+	}
+	if (layout->daddr.bit_size != 32 || layout->rcv_saddr.bit_size != 32 ||
+	    (layout->have_v6 &&
+	     (layout->v6_daddr.bit_size != 128 ||
+	      layout->v6_rcv_saddr.bit_size != 128))) {
+		return drgn_error_create(DRGN_ERROR_TYPE,
+					 "unexpected size of struct sock_common address");
+	}
+	err = linux_helper_optional_field_init(&layout->net, type,
+					       "skc_net.net", true,
+					       &layout->have_net);
+	if (err)
+		return err;
+	if (!layout->have_net) {
+		struct drgn_object init_net;
+		drgn_object_init(&init_net, prog);
+		err = drgn_program_find_object(prog, "init_net", NULL,
+					       DRGN_FIND_OBJECT_VARIABLE,
+					       &init_net);
+		if (!err && init_net.kind != DRGN_OBJECT_REFERENCE) {
+			err = drgn_error_create(DRGN_ERROR_OTHER,
+						"init_net is not a reference");
+		}
+		if (!err)
+			layout->init_net = init_net.address;
+		drgn_object_deinit(&init_net);
+		if (err)
+			return err;
+	}
+
+	err = linux_helper_field_init(&layout->socket, sock_type.type,
+				      "sk_socket", true);
+	if (err)
+		return err;
+	uint64_t socket_offset, ino_offset;
+	err = drgn_type_offsetof(socket_alloc_type.type, "socket",
+				 &socket_offset);
+	if (err)
+		return err;
+	err = drgn_type_offsetof(socket_alloc_type.type, "vfs_inode.i_ino",
+				 &ino_offset);
+	if (err)
+		return err;
+	struct drgn_member_path path;
+	err = drgn_member_path_init(&path, socket_alloc_type.type,
+				    "vfs_inode");
+	if (err)
+		return err;
+	struct drgn_type *inode_type =
+		drgn_underlying_type(path.member_type.type);
+	err = linux_helper_field_init(&layout->ino, inode_type, "i_ino", true);
+	if (err)
+		return err;
+	/* The ino field is relative to the inode, so undo that. */
+	layout->socket_ino_offset =
+		ino_offset - socket_offset - layout->ino.bit_offset / 8;
+
+	err = drgn_type_offsetof(sock_type.type, node_member,
+				 &layout->node_offset);
+	if (err)
+		return err;
+	char *next_member;
+	if (asprintf(&next_member, "%s.next", node_member) < 0)
+		return &drgn_enomem;
+	err = linux_helper_field_init(&layout->next, sock_type.type,
+				      next_member, true);
+	free(next_member);
+	if (err)
+		return err;
+	layout->little_endian = drgn_platform_is_little_endian(&prog->platform);
+	return NULL;
+}
+
+/* Fill in a socket entry from its struct sock_common. */
+static struct drgn_error *
+linux_helper_sock_entry_init(struct drgn_program *prog,
+			     const struct linux_helper_sock_layout *layout,
+			     uint64_t sk, const char *buf,
+			     struct linux_helper_sock_entry *entry)
+{
+	struct drgn_error *err;
+	bool little_endian = layout->little_endian;
+	memset(entry, 0, sizeof(*entry));
+	entry->sk = sk;
+	entry->family = linux_helper_field_read(&layout->family, buf,
+						little_endian);
+	entry->state = linux_helper_field_read(&layout->state, buf,
+					       little_endian);
+	entry->sport = linux_helper_field_read(&layout->num, buf,
+					       little_endian);
+	entry->dport = linux_helper_field_read(&layout->dport, buf, false);
+	if (entry->family == LINUX_AF_INET6 && layout->have_v6) {
+		memcpy(entry->saddr, buf + layout->v6_rcv_saddr.bit_offset / 8,
+		       16);
+		memcpy(entry->daddr, buf + layout->v6_daddr.bit_offset / 8, 16);
+	} else if (entry->family == LINUX_AF_INET) {
+		memcpy(entry->saddr, buf + layout->rcv_saddr.bit_offset / 8, 4);
+		memcpy(entry->daddr, buf + layout->daddr.bit_offset / 8, 4);
+	}
+	if (layout->have_net) {
+		entry->net = linux_helper_field_read(&layout->net, buf,
+						     little_endian);
+	} else {
+		entry->net = layout->init_net;
+	}
+
+	/* Time-wait and request sockets don't have a struct socket. */
+	if (entry->state == LINUX_TCP_TIME_WAIT ||
+	    entry->state == LINUX_TCP_NEW_SYN_RECV)
+		return NULL;
+	uint64_t socket;
+	err = linux_helper_field_read_memory(prog, &layout->socket, sk,
+					     little_endian, &socket);
+	if (err || !socket)
+		return err;
+	return linux_helper_field_read_memory(prog, &layout->ino,
+					      socket + layout->socket_ino_offset,
+					      little_endian, &entry->ino);
+}
+
+/* Get the next list node after a socket given its struct sock_common. */
+static struct drgn_error *
+linux_helper_sock_next_node(struct drgn_program *prog,
+			    const struct linux_helper_sock_layout *layout,
+			    uint64_t sk, const char *buf, uint64_t *ret)
+{
+	/*
+	 * The list node is usually in the struct sock_common, so reading that
+	 * also got the next node.
+	 */
+	if (layout->next.bit_offset + layout->next.bit_size <=
+	    layout->sock_common_size * 8) {
+		*ret = linux_helper_field_read(&layout->next, buf,
+					       layout->little_endian);
+		return NULL;
+	}
+	return linux_helper_field_read_memory(prog, &layout->next, sk,
+					      layout->little_endian, ret);
+}
+
+DEFINE_VECTOR(linux_helper_sock_entry_vector, struct linux_helper_sock_entry)
+
+struct drgn_error *
+linux_helper_sk_hash_sockets(const struct drgn_object *buckets,
+			     uint64_t num_buckets, const char *head_member,
+			     const char *node_member,
+			     struct linux_helper_sock_entry **entries_ret,
+			     size_t *num_entries_ret)
+{
+	struct drgn_error *err;
+	struct drgn_program *prog = drgn_object_program(buckets);
+
+	struct drgn_type *buckets_type = drgn_underlying_type(buckets->type);
+	if (drgn_type_kind(buckets_type) != DRGN_TYPE_POINTER) {
+		return drgn_type_error("buckets must be a pointer, not '%s'",
+				       buckets->type);
+	}
+	struct drgn_type *bucket_type =
+		drgn_underlying_type(drgn_type_type(buckets_type).type);
+	uint64_t bucket_size;
+	err = drgn_type_sizeof(bucket_type, &bucket_size);
+	if (err)
+		return err;
+	struct drgn_member_path head_path;
+	err = drgn_member_path_init(&head_path, bucket_type, head_member);
+	if (err)
+		return err;
+	struct drgn_type *head_type =
+		drgn_underlying_type(head_path.member_type.type);
+	const char *head_tag = drgn_type_tag(head_type);
+	bool nulls;
+	if (head_tag && strcmp(head_tag, "hlist_nulls_head") == 0) {
+		nulls = true;
+	} else if (head_tag && strcmp(head_tag, "hlist_head") == 0) {
+		nulls = false;
+	} else {
+		return drgn_type_error("bucket head must be 'struct hlist_nulls_head' or 'struct hlist_head', not '%s'",
+				       head_path.member_type.type);
+	}
+	struct linux_helper_field first;
+	err = linux_helper_field_init(&first, head_type, "first", true);
+	if (err)
+		return err;
+
+	struct linux_helper_sock_layout layout;
+	err = linux_helper_sock_layout_init(&layout, prog, node_member);
+	if (err)
+		return err;
+	bool little_endian = layout.little_endian;
+
+	uint64_t address;
+	err = drgn_object_read_unsigned(buckets, &address);
+	if (err)
+		return err;
+	char *buf = malloc64(layout.sock_common_size);
+	if (!buf)
+		return &drgn_enomem;
+	struct linux_helper_sock_entry_vector entries = VECTOR_INIT;
+	for (uint64_t i = 0; i < num_buckets; i++) {
+		uint64_t node;
+		err = linux_helper_field_read_memory(prog, &first,
+						     address +
+						     i * bucket_size +
+						     head_path.bit_offset / 8,
+						     little_endian, &node);
+		if (err)
+			goto err;
+		while (nulls ? !(node & 1) : node) {
+			uint64_t sk = node - layout.node_offset;
+			err = drgn_program_read_memory(prog, buf, sk,
+						       layout.sock_common_size,
+						       false);
+			if (err)
+				goto err;
+			struct linux_helper_sock_entry *entry =
+				linux_helper_sock_entry_vector_append_entry(&entries);
+			if (!entry) {
+				err = &drgn_enomem;
+				goto err;
+			}
+			err = linux_helper_sock_entry_init(prog, &layout, sk,
+							   buf, entry);
+			if (err)
+				goto err;
+			err = linux_helper_sock_next_node(prog, &layout, sk,
+							  buf, &node);
+			if (err)
+				goto err;
+		}
+	}
+	free(buf);
+	linux_helper_sock_entry_vector_shrink_to_fit(&entries);
+	*entries_ret = entries.data;
+	*num_entries_ret = entries.size;
+	return NULL;
+
+err:
+	free(buf);
+	linux_helper_sock_entry_vector_deinit(&entries);
+	return err;
+}
+
+/* Call a function for each non-NULL entry of a global IDR. */
+static struct drgn_error *
+linux_helper_global_idr_for_each(struct drgn_program *prog, const char *name,
+				 struct drgn_error *(*fn)(uint64_t entry,
+							  void *arg),
+				 void *arg)
+{
+	struct drgn_error *err;
+	struct drgn_object idr, ptr;
+	drgn_object_init(&idr, prog);
+	drgn_object_init(&ptr, prog);
+	err = drgn_program_find_object(prog, name, NULL,
+				       DRGN_FIND_OBJECT_VARIABLE, &idr);
+	if (err)
+		goto out;
+	err = drgn_object_address_of(&ptr, &idr);
+	if (err)
+		goto out;
+	struct linux_helper_radix_tree_iterator it;
+	err = linux_helper_idr_iterator_init(&it, &ptr);
+	if (err)
+		goto out;
+	for (;;) {
+		const struct drgn_object *entry;
+		err = linux_helper_radix_tree_iterator_next(&it, &entry);
+		if (err || !entry)
+			break;
+		uint64_t address;
+		err = drgn_object_read_unsigned(entry, &address);
+		if (err)
+			break;
+		if (address) {
+			err = fn(address, arg);
+			if (err)
+				break;
+		}
+	}
+	linux_helper_radix_tree_iterator_deinit(&it);
+out:
+	drgn_object_deinit(&ptr);
+	drgn_object_deinit(&idr);
+	return err;
+}
+
+/* Grow the number of bytes to read from a structure to include a field. */
+static void linux_helper_field_extend(uint64_t *size,
+				      const struct linux_helper_field *field)
+{
+	uint64_t end = (field->bit_offset + field->bit_size + 7) / 8;
+	if (end > *size)
+		*size = end;
+}
+
+/* Copy a character array field into a fixed-size, zero-padded buffer. */
+static void linux_helper_field_copy_name(const struct linux_helper_field *field,
+					 const char *buf, char *name,
+					 size_t name_size)
+{
+	size_t size = min(field->bit_size / 8, (uint64_t)name_size);
+	memcpy(name, buf + field->bit_offset / 8, size);
+	memset(name + size, 0, name_size - size);
+}
+
+/* Layout of the parts of BPF programs read by linux_helper_bpf_progs(). */
+struct linux_helper_bpf_prog_layout {
+	/* struct bpf_prog. */
+	uint64_t prog_read_size;
+	struct linux_helper_field type;
+	struct linux_helper_field expected_attach_type;
+	bool have_attach_type;
+	struct linux_helper_field len;
+	struct linux_helper_field jited_len;
+	struct linux_helper_field bpf_func;
+	struct linux_helper_field aux;
+	/* struct bpf_prog_aux. */
+	uint64_t aux_read_size;
+	struct linux_helper_field id;
+	struct linux_helper_field name;
+	bool have_name;
+	struct linux_helper_field btf;
+	struct linux_helper_field func_info;
+	/* The remaining fields are only valid if have_btf is true. */
+	bool have_btf;
+	/* struct bpf_func_info. */
+	struct linux_helper_field func_info_type_id;
+	/* struct btf. */
+	struct linux_helper_field btf_types;
+	struct linux_helper_field btf_strings;
+	struct linux_helper_field btf_str_len;
+	/* struct btf_type. */
+	struct linux_helper_field btf_type_name_off;
+	bool little_endian;
+};
+
+static struct drgn_error *
+linux_helper_bpf_btf_layout_init(struct linux_helper_bpf_prog_layout *layout,
+				 struct drgn_program *prog)
+{
+	struct drgn_error *err;
+	struct drgn_qualified_type func_info_type, btf_type, btf_type_type;
+	if ((err = drgn_program_find_type(prog, "struct bpf_func_info", NULL,
+					  &func_info_type)) ||
+	    (err = drgn_program_find_type(prog, "struct btf", NULL,
+					  &btf_type)) ||
+	    (err = drgn_program_find_type(prog, "struct btf_type", NULL,
+					  &btf_type_type)))
+		return err;
+	if ((err = linux_helper_field_init(&layout->func_info_type_id,
+					   func_info_type.type, "type_id",
+					   true)) ||
+	    (err = linux_helper_field_init(&layout->btf_types, btf_type.type,
+					   "types", true)) ||
+	    (err = linux_helper_field_init(&layout->btf_strings, btf_type.type,
+					   "strings", true)) ||
+	    (err = linux_helper_field_init(&layout->btf_str_len, btf_type.type,
+					   "hdr.str_len", true)))
+		return err;
+	return linux_helper_field_init(&layout->btf_type_name_off,
+				       btf_type_type.type, "name_off", true);
+}
+
+static struct drgn_error *
+linux_helper_bpf_prog_layout_init(struct linux_helper_bpf_prog_layout *layout,
+				  struct drgn_program *prog)
+{
+	struct drgn_error *err;
+	struct drgn_qualified_type prog_type, aux_type;
+	err = drgn_program_find_type(prog, "struct bpf_prog", NULL, &prog_type);
+	if (err)
+		return err;
+	err = drgn_program_find_type(prog, "struct bpf_prog_aux", NULL,
+				     &aux_type);
+	if (err)
+		return err;
+
+	struct drgn_type *type = prog_type.type;
+	/* expected_attach_type was added in Linux 4.17. */
+	err = linux_helper_optional_field_init(&layout->expected_attach_type,
+					       type, "expected_attach_type",
+					       true, &layout->have_attach_type);
+	if (err)
+		return err;
+	if ((err = linux_helper_field_init(&layout->type, type, "type",
+					   true)) ||
+	    (err = linux_helper_field_init(&layout->len, type, "len", true)) ||
+	    (err = linux_helper_field_init(&layout->jited_len, type,
+					   "jited_len", true)) ||
+	    (err = linux_helper_field_init(&layout->bpf_func, type,
+					   "bpf_func", true)) ||
+	    (err = linux_helper_field_init(&layout->aux, type, "aux", true)))
+		return err;
+	layout->prog_read_size = 0;
+	linux_helper_field_extend(&layout->prog_read_size, &layout->type);
+	if (layout->have_attach_type) {
+		linux_helper_field_extend(&layout->prog_read_size,
+					  &layout->expected_attach_type);
+	}
+	linux_helper_field_extend(&layout->prog_read_size, &layout->len);
+	linux_helper_field_extend(&layout->prog_read_size, &layout->jited_len);
+	linux_helper_field_extend(&layout->prog_read_size, &layout->bpf_func);
+	linux_helper_field_extend(&layout->prog_read_size, &layout->aux);
+
+	type = aux_type.type;
+	bool have_func_info;
+	if ((err = linux_helper_field_init(&layout->id, type, "id", true)) ||
+	    /* name was added in Linux 4.15. */
+	    (err = linux_helper_optional_field_init(&layout->name, type,
+						    "name", false,
+						    &layout->have_name)) ||
+	    /* btf and func_info were added in Linux 5.0. */
+	    (err = linux_helper_optional_field_init(&layout->btf, type, "btf",
+						    true,
+						    &layout->have_btf)) ||
+	    (err = linux_helper_optional_field_init(&layout->func_info, type,
+						    "func_info", true,
+						    &have_func_info)))
+		return err;
+	layout->have_btf = layout->have_btf && have_func_info;
+	if (layout->have_btf) {
+		err = linux_helper_bpf_btf_layout_init(layout, prog);
+		if (err)
+			return err;
+	}
+	layout->aux_read_size = 0;
+	linux_helper_field_extend(&layout->aux_read_size, &layout->id);
+	if (layout->have_name)
+		linux_helper_field_extend(&layout->aux_read_size, &layout->name);
+	if (layout->have_btf) {
+		linux_helper_field_extend(&layout->aux_read_size, &layout->btf);
+		linux_helper_field_extend(&layout->aux_read_size,
+					  &layout->func_info);
+	}
+	layout->little_endian = drgn_platform_is_little_endian(&prog->platform);
+	return NULL;
+}
+
+/*
+ * Append the name of the first function in the BTF information of a BPF
+ * program to a buffer, like get_prog_btf_name() in tools/bpf_inspect.py.
+ */
+static struct drgn_error *
+linux_helper_bpf_prog_btf_name(struct drgn_program *prog,
+			       const struct linux_helper_bpf_prog_layout *layout,
+			       uint64_t btf, uint64_t func_info,
+			       struct string_builder *names, size_t *len_ret)
+{
+	struct drgn_error *err;
+	bool little_endian = layout->little_endian;
+	/* btf->types is an array of pointers. */
+	uint64_t pointer_size = layout->btf_types.bit_size / 8;
+	uint64_t type_id, types, btf_type, name_off, str_len, strings;
+	if ((err = linux_helper_field_read_memory(prog,
+						  &layout->func_info_type_id,
+						  func_info, little_endian,
+						  &type_id)) ||
+	    (err = linux_helper_field_read_memory(prog, &layout->btf_types,
+						  btf, little_endian,
+						  &types)) ||
+	    (err = drgn_program_read_word(prog, types + type_id * pointer_size,
+					  false, &btf_type)) ||
+	    (err = linux_helper_field_read_memory(prog,
+						  &layout->btf_type_name_off,
+						  btf_type, little_endian,
+						  &name_off)) ||
+	    (err = linux_helper_field_read_memory(prog, &layout->btf_str_len,
+						  btf, little_endian,
+						  &str_len)))
+		return err;
+	*len_ret = 0;
+	if (name_off >= str_len)
+		return NULL;
+	err = linux_helper_field_read_memory(prog, &layout->btf_strings, btf,
+					     little_endian, &strings);
+	if (err)
+		return err;
+	char *name;
+	/* KSYM_NAME_LEN is the longest name that the verifier accepts. */
+	err = drgn_program_read_c_string(prog, strings + name_off, false, 512,
+					 &name);
+	if (err)
+		return err;
+	*len_ret = strlen(name);
+	bool ok = string_builder_appendn(names, name, *len_ret);
+	free(name);
+	return ok ? NULL : &drgn_enomem;
+}
+
+DEFINE_VECTOR(linux_helper_bpf_prog_entry_vector,
+	      struct linux_helper_bpf_prog_entry)
+
+struct linux_helper_bpf_progs_arg {
+	struct drgn_program *prog;
+	struct linux_helper_bpf_prog_layout layout;
+	char *prog_buf;
+	char *aux_buf;
+	struct linux_helper_bpf_prog_entry_vector entries;
+	struct string_builder names;
+};
+
+static struct drgn_error *linux_helper_bpf_progs_add(uint64_t address,
+						     void *arg_)
+{
+	struct drgn_error *err;
+	struct linux_helper_bpf_progs_arg *arg = arg_;
+	struct drgn_program *prog = arg->prog;
+	const struct linux_helper_bpf_prog_layout *layout = &arg->layout;
+	bool little_endian = layout->little_endian;
+
+	err = drgn_program_read_memory(prog, arg->prog_buf, address,
+				       layout->prog_read_size, false);
+	if (err)
+		return err;
+	struct linux_helper_bpf_prog_entry *entry =
+		linux_helper_bpf_prog_entry_vector_append_entry(&arg->entries);
+	if (!entry)
+		return &drgn_enomem;
+	memset(entry, 0, sizeof(*entry));
+	const char *buf = arg->prog_buf;
+	entry->prog = address;
+	entry->aux = linux_helper_field_read(&layout->aux, buf, little_endian);
+	entry->bpf_func = linux_helper_field_read(&layout->bpf_func, buf,
+						  little_endian);
+	entry->type = linux_helper_field_read(&layout->type, buf,
+					      little_endian);
+	if (layout->have_attach_type) {
+		entry->expected_attach_type =
+			linux_helper_field_read(&layout->expected_attach_type,
+						buf, little_endian);
+	}
+	entry->len = linux_helper_field_read(&layout->len, buf, little_endian);
+	entry->jited_len = linux_helper_field_read(&layout->jited_len, buf,
+						   little_endian);
+
+	err = drgn_program_read_memory(prog, arg->aux_buf, entry->aux,
+				       layout->aux_read_size, false);
+	if (err)
+		return err;
+	buf = arg->aux_buf;
+	entry->id = linux_helper_field_read(&layout->id, buf, little_endian);
+	if (layout->have_name) {
+		linux_helper_field_copy_name(&layout->name, buf, entry->name,
+					     sizeof(entry->name));
+	}
+	if (layout->have_btf) {
+		uint64_t btf = linux_helper_field_read(&layout->btf, buf,
+						       little_endian);
+		uint64_t func_info =
+			linux_helper_field_read(&layout->func_info, buf,
+						little_endian);
+		entry->btf_name_offset = arg->names.len;
+		if (btf && func_info) {
+			size_t *len_ret = &entry->btf_name_len;
+			err = linux_helper_bpf_prog_btf_name(prog, layout, btf,
+							     func_info,
+							     &arg->names,
+							     len_ret);
+			if (err)
+				return err;
+		}
+	}
+	return NULL;
+}
+
+struct drgn_error *
+linux_helper_bpf_progs(struct drgn_program *prog,
+		       struct linux_helper_bpf_prog_entry **entries_ret,
+		       size_t *num_entries_ret, char **names_ret)
+{
+	struct drgn_error *err;
+	struct linux_helper_bpf_progs_arg arg = {
+		.prog = prog,
+		.entries = VECTOR_INIT,
+	};
+	err = linux_helper_bpf_prog_layout_init(&arg.layout, prog);
+	if (err)
+		return err;
+	arg.prog_buf = malloc64(arg.layout.prog_read_size);
+	arg.aux_buf = malloc64(arg.layout.aux_read_size);
+	if (!arg.prog_buf || !arg.aux_buf) {
+		err = &drgn_enomem;
+		goto out;
+	}
+	err = linux_helper_global_idr_for_each(prog, "prog_idr",
+					       linux_helper_bpf_progs_add,
+					       &arg);
+out:
+	free(arg.aux_buf);
+	free(arg.prog_buf);
+	if (err) {
+		linux_helper_bpf_prog_entry_vector_deinit(&arg.entries);
+		free(arg.names.str);
+		return err;
+	}
+	linux_helper_bpf_prog_entry_vector_shrink_to_fit(&arg.entries);
+	*entries_ret = arg.entries.data;
+	*num_entries_ret = arg.entries.size;
+	*names_ret = arg.names.str;
+	return NULL;
+}
+
+/* Layout of the parts of a BPF map read by linux_helper_bpf_maps(). */
+struct linux_helper_bpf_map_layout {
+	uint64_t read_size;
+	struct linux_helper_field id;
+	struct linux_helper_field map_type;
+	struct linux_helper_field key_size;
+	struct linux_helper_field value_size;
+	struct linux_helper_field max_entries;
+	struct linux_helper_field name;
+	bool have_name;
+	bool little_endian;
+};
+
+DEFINE_VECTOR(linux_helper_bpf_map_entry_vector,
+	      struct linux_helper_bpf_map_entry)
+
+struct linux_helper_bpf_maps_arg {
+	struct drgn_program *prog;
+	struct linux_helper_bpf_map_layout layout;
+	char *buf;
+	struct linux_helper_bpf_map_entry_vector entries;
+};
+
+static struct drgn_error *linux_helper_bpf_maps_add(uint64_t address,
+						    void *arg_)
+{
+	struct linux_helper_bpf_maps_arg *arg = arg_;
+	const struct linux_helper_bpf_map_layout *layout = &arg->layout;
+	bool little_endian = layout->little_endian;
+	struct drgn_error *err = drgn_program_read_memory(arg->prog, arg->buf,
+							  address,
+							  layout->read_size,
+							  false);
+	if (err)
+		return err;
+	struct linux_helper_bpf_map_entry *entry =
+		linux_helper_bpf_map_entry_vector_append_entry(&arg->entries);
+	if (!entry)
+		return &drgn_enomem;
+	memset(entry, 0, sizeof(*entry));
+	const char *buf = arg->buf;
+	entry->map = address;
+	entry->id = linux_helper_field_read(&layout->id, buf, little_endian);
+	entry->map_type = linux_helper_field_read(&layout->map_type, buf,
+						  little_endian);
+	entry->key_size = linux_helper_field_read(&layout->key_size, buf,
+						  little_endian);
+	entry->value_size = linux_helper_field_read(&layout->value_size, buf,
+						    little_endian);
+	entry->max_entries = linux_helper_field_read(&layout->max_entries, buf,
+						     little_endian);
+	if (layout->have_name) {
+		linux_helper_field_copy_name(&layout->name, buf, entry->name,
+					     sizeof(entry->name));
+	}
+	return NULL;
+}
+
+struct drgn_error *
+linux_helper_bpf_maps(struct drgn_program *prog,
+		      struct linux_helper_bpf_map_entry **entries_ret,
+		      size_t *num_entries_ret)
+{
+	struct drgn_error *err;
+	struct drgn_qualified_type map_type;
+	err = drgn_program_find_type(prog, "struct bpf_map", NULL, &map_type);
+	if (err)
+		return err;
+	struct linux_helper_bpf_maps_arg arg = {
+		.prog = prog,
+		.entries = VECTOR_INIT,
+	};
+	struct linux_helper_bpf_map_layout *layout = &arg.layout;
+	struct drgn_type *type = map_type.type;
+	if ((err = linux_helper_field_init(&layout->id, type, "id", true)) ||
+	    (err = linux_helper_field_init(&layout->map_type, type, "map_type",
+					   true)) ||
+	    (err = linux_helper_field_init(&layout->key_size, type, "key_size",
+					   true)) ||
+	    (err = linux_helper_field_init(&layout->value_size, type,
+					   "value_size", true)) ||
+	    (err = linux_helper_field_init(&layout->max_entries, type,
+					   "max_entries", true)) ||
+	    /* name was added in Linux 4.15. */
+	    (err = linux_helper_optional_field_init(&layout->name, type, "name",
+						    false,
+						    &layout->have_name)))
+		return err;
+	layout->read_size = 0;
+	linux_helper_field_extend(&layout->read_size, &layout->id);
+	linux_helper_field_extend(&layout->read_size, &layout->map_type);
+	linux_helper_field_extend(&layout->read_size, &layout->key_size);
+	linux_helper_field_extend(&layout->read_size, &layout->value_size);
+	linux_helper_field_extend(&layout->read_size, &layout->max_entries);
+	if (layout->have_name)
+		linux_helper_field_extend(&layout->read_size, &layout->name);
+	layout->little_endian = drgn_platform_is_little_endian(&prog->platform);
+
+	arg.buf = malloc64(layout->read_size);
+	if (!arg.buf)
+		return &drgn_enomem;
+	err = linux_helper_global_idr_for_each(prog, "map_idr",
+					       linux_helper_bpf_maps_add, &arg);
+	free(arg.buf);
+	if (err) {
+		linux_helper_bpf_map_entry_vector_deinit(&arg.entries);
+		return err;
+	}
+	linux_helper_bpf_map_entry_vector_shrink_to_fit(&arg.entries);
+	*entries_ret = arg.entries.data;
+	*num_entries_ret = arg.entries.size;
+	return NULL;
+}
+
+DEFINE_VECTOR(linux_helper_cpu_vector, uint64_t)
+
+static struct drgn_error *linux_helper_append_cpu(uint64_t cpu, void *arg)
+{
+	if (!linux_helper_cpu_vector_append(arg, &cpu))
+		return &drgn_enomem;
+	return NULL;
+}
+
+/*
+ * Maximum number of bytes read for each CPU by linux_helper_read_per_cpu(): a
+ * 64-bit value that doesn't start on a byte boundary.
+ */
+#define LINUX_HELPER_PER_CPU_MAX_READ_SIZE 9
+
+struct drgn_error *
+linux_helper_read_per_cpu(const struct drgn_object *ptr,
+			  const char *member_designator,
+			  const struct drgn_object *cpumask,
+			  struct linux_helper_per_cpu_values *ret)
+{
+	struct drgn_error *err;
+	struct drgn_program *prog = drgn_object_program(ptr);
+
+	if (!(prog->flags & DRGN_PROGRAM_IS_LINUX_KERNEL)) {
+		return drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+					 "not Linux kernel");
+	}
+	bool little_endian, bswap;
+	err = drgn_program_is_little_endian(prog, &little_endian);
+	if (err)
+		return err;
+	err = drgn_program_bswap(prog, &bswap);
+	if (err)
+		return err;
+	uint8_t address_size;
+	err = drgn_program_address_size(prog, &address_size);
+	if (err)
+		return err;
+	bool is_64_bit = address_size == 8;
+
+	/* Find the address of the variable and the field to read from it. */
+	uint64_t address;
+	struct drgn_type *type;
+	struct drgn_type *ptr_type = drgn_underlying_type(ptr->type);
+	if (drgn_type_kind(ptr_type) == DRGN_TYPE_POINTER) {
+		err = drgn_object_read_unsigned(ptr, &address);
+		if (err)
+			return err;
+		type = drgn_type_type(ptr_type).type;
+	} else if (ptr->kind == DRGN_OBJECT_REFERENCE) {
+		address = ptr->address;
+		type = ptr->type;
+	} else {
+		return drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+					 "per-CPU variable must be a pointer or a reference");
+	}
+	type = drgn_underlying_type(type);
+	struct drgn_type *value_type;
+	struct linux_helper_field field;
+	if (member_designator) {
+		struct drgn_member_path path;
+		err = drgn_member_path_init(&path, type, member_designator);
+		if (err)
+			return err;
+		value_type = path.member_type.type;
+		field.bit_offset = path.bit_offset;
+		field.bit_size = path.bit_field_size;
+	} else {
+		value_type = type;
+		field.bit_offset = 0;
+		field.bit_size = 0;
+	}
+	if (!field.bit_size) {
+		err = drgn_type_bit_size(value_type, &field.bit_size);
+		if (err)
+			return err;
+	}
+	enum drgn_object_encoding encoding =
+		drgn_type_object_encoding(value_type);
+	if ((encoding != DRGN_OBJECT_ENCODING_SIGNED &&
+	     encoding != DRGN_OBJECT_ENCODING_UNSIGNED) ||
+	    field.bit_size == 0 || field.bit_size > 64) {
+		return drgn_type_error("per-CPU value must be integer or pointer, not '%s'",
+				       value_type);
+	}
+	address += field.bit_offset / 8;
+	field.bit_offset %= 8;
+	size_t read_size = (field.bit_offset + field.bit_size + 7) / 8;
+
+	struct linux_helper_cpu_vector cpus = VECTOR_INIT;
+	struct drgn_object tmp;
+	drgn_object_init(&tmp, prog);
+	uint64_t *offsets = NULL;
+	struct drgn_memory_read_request *requests = NULL;
+	char *bufs = NULL;
+	union drgn_value *values = NULL;
+
+	if (cpumask) {
+		if (drgn_type_kind(drgn_underlying_type(cpumask->type)) ==
+		    DRGN_TYPE_POINTER) {
+			err = drgn_object_dereference(&tmp, cpumask);
+			if (err)
+				goto out;
+			err = linux_helper_for_each_cpu(&tmp,
+							linux_helper_append_cpu,
+							&cpus);
+		} else {
+			err = linux_helper_for_each_cpu(cpumask,
+							linux_helper_append_cpu,
+							&cpus);
+		}
+	} else {
+		err = linux_helper_for_each_online_cpu(prog,
+						       linux_helper_append_cpu,
+						       &cpus);
+	}
+	if (err)
+		goto out;
+
+	offsets = malloc_array(cpus.size, sizeof(offsets[0]));
+	requests = malloc_array(cpus.size, sizeof(requests[0]));
+	bufs = malloc_array(cpus.size, LINUX_HELPER_PER_CPU_MAX_READ_SIZE);
+	values = malloc_array(cpus.size, sizeof(values[0]));
+	if (cpus.size && (!offsets || !requests || !bufs || !values)) {
+		err = &drgn_enomem;
+		goto out;
+	}
+
+	/*
+	 * Read __per_cpu_offset up to the last CPU at once. It doesn't exist
+	 * on !SMP kernels, where per-CPU variables aren't offset.
+	 */
+	err = drgn_program_find_object(prog, "__per_cpu_offset", NULL,
+				       DRGN_FIND_OBJECT_ANY, &tmp);
+	if (!err && cpus.size) {
+		uint64_t last_cpu = cpus.data[cpus.size - 1];
+		struct drgn_type *offsets_type = drgn_underlying_type(tmp.type);
+		if (tmp.kind != DRGN_OBJECT_REFERENCE ||
+		    drgn_type_kind(offsets_type) != DRGN_TYPE_ARRAY ||
+		    last_cpu >= drgn_type_length(offsets_type)) {
+			err = drgn_error_create(DRGN_ERROR_OUT_OF_BOUNDS,
+						"CPU is out of bounds of __per_cpu_offset");
+			goto out;
+		}
+		char *offsets_buf = malloc_array(last_cpu + 1, address_size);
+		if (!offsets_buf) {
+			err = &drgn_enomem;
+			goto out;
+		}
+		err = drgn_program_read_memory(prog, offsets_buf, tmp.address,
+					       (last_cpu + 1) * address_size,
+					       false);
+		if (!err) {
+			for (size_t i = 0; i < cpus.size; i++) {
+				const char *word = offsets_buf +
+						   cpus.data[i] * address_size;
+				offsets[i] =
+					linux_helper_buffer_word(word,
+								 is_64_bit,
+								 bswap);
+			}
+		}
+		free(offsets_buf);
+		if (err)
+			goto out;
+	} else if (err && err->code == DRGN_ERROR_LOOKUP) {
+		drgn_error_destroy(err);
+		err = NULL;
+		for (size_t i = 0; i < cpus.size; i++)
+			offsets[i] = 0;
+	} else if (err) {
+		goto out;
+	}
+
+	uint64_t address_mask = is_64_bit ? UINT64_MAX : UINT32_MAX;
+	for (size_t i = 0; i < cpus.size; i++) {
+		requests[i].address = (address + offsets[i]) & address_mask;
+		requests[i].count = read_size;
+		requests[i].buf = bufs + i * LINUX_HELPER_PER_CPU_MAX_READ_SIZE;
+	}
+	err = drgn_program_read_memory_batch(prog, requests, cpus.size, false);
+	if (err)
+		goto out;
+	for (size_t i = 0; i < cpus.size; i++) {
+		if (requests[i].err) {
+			if (!err)
+				err = requests[i].err;
+			else
+				drgn_error_destroy(requests[i].err);
+		}
+	}
+	if (err)
+		goto out;
+
+	bool is_signed = encoding == DRGN_OBJECT_ENCODING_SIGNED;
+	for (size_t i = 0; i < cpus.size; i++) {
+		uint64_t uvalue = deserialize_bits(requests[i].buf,
+						   field.bit_offset,
+						   field.bit_size,
+						   little_endian);
+		if (is_signed) {
+			values[i].svalue = truncate_signed(uvalue,
+							   field.bit_size);
+		} else {
+			values[i].uvalue = uvalue;
+		}
+	}
+
+	linux_helper_cpu_vector_shrink_to_fit(&cpus);
+	ret->cpus = cpus.data;
+	ret->values = values;
+	ret->num_cpus = cpus.size;
+	ret->is_signed = is_signed;
+	cpus.data = NULL;
+	values = NULL;
+out:
+	free(values);
+	free(bufs);
+	free(requests);
+	free(offsets);
+	drgn_object_deinit(&tmp);
+	linux_helper_cpu_vector_deinit(&cpus);
+	return err;
+}
+
+void
+linux_helper_per_cpu_values_deinit(struct linux_helper_per_cpu_values *values)
+{
+	free(values->values);
+	free(values->cpus);
+}
+
+struct drgn_error *linux_helper_bitmap_init(struct linux_helper_bitmap *bitmap,
+					    const struct drgn_object *obj,
+					    uint64_t size)
+{
+	struct drgn_error *err;
+	struct drgn_program *prog = drgn_object_program(obj);
+
+	struct drgn_type *type = drgn_underlying_type(obj->type);
+	if (drgn_type_kind(type) != DRGN_TYPE_POINTER &&
+	    drgn_type_kind(type) != DRGN_TYPE_ARRAY) {
+		return drgn_type_error("bitmap must be a pointer or array, not '%s'",
+				       obj->type);
+	}
+	struct drgn_type *word_type =
+		drgn_underlying_type(drgn_type_type(type).type);
+	uint64_t word_size;
+	if (drgn_type_kind(word_type) != DRGN_TYPE_INT ||
+	    drgn_type_is_signed(word_type) ||
+	    ((word_size = drgn_type_size(word_type)) != 4 && word_size != 8)) {
+		return drgn_type_error("bitmap word must be a 32- or 64-bit unsigned integer, not '%s'",
+				       drgn_type_type(type).type);
+	}
+	bool bswap = drgn_type_little_endian(word_type) != HOST_LITTLE_ENDIAN;
+
+	uint64_t num_words = size / 64 + (size % 64 != 0);
+	uint64_t word_bits = word_size * 8;
+	uint64_t num_bytes = (size / word_bits + (size % word_bits != 0)) *
+			     word_size;
+	if (num_words > SIZE_MAX / sizeof(uint64_t))
+		return &drgn_enomem;
+	uint64_t *words = malloc_array(max(num_words, (uint64_t)1),
+				       sizeof(words[0]));
+	if (!words)
+		return &drgn_enomem;
+	/* Zero the padding after an odd number of 32-bit words. */
+	if (num_words)
+		words[num_words - 1] = 0;
+
+	if (drgn_type_kind(type) == DRGN_TYPE_POINTER ||
+	    obj->kind == DRGN_OBJECT_REFERENCE) {
+		uint64_t address;
+		if (drgn_type_kind(type) == DRGN_TYPE_POINTER) {
+			err = drgn_object_read_unsigned(obj, &address);
+			if (err)
+				goto err;
+		} else {
+			address = obj->address;
+		}
+		err = drgn_program_read_memory(prog, words, address, num_bytes,
+					       false);
+		if (err)
+			goto err;
+	} else {
+		/* A value array must be big enough for the whole bitmap. */
+		uint64_t obj_size = drgn_object_size(obj);
+		if (obj_size < num_bytes) {
+			err = drgn_error_create(DRGN_ERROR_OUT_OF_BOUNDS,
+						"bitmap size is larger than array");
+			goto err;
+		}
+		if (obj_size > num_bytes) {
+			char *buf = malloc(obj_size);
+			if (!buf) {
+				err = &drgn_enomem;
+				goto err;
+			}
+			err = drgn_object_read_bytes(obj, buf);
+			if (!err)
+				memcpy(words, buf, num_bytes);
+			free(buf);
+		} else {
+			err = drgn_object_read_bytes(obj, words);
+		}
+		if (err)
+			goto err;
+	}
+
+	if (word_size == 8) {
+		if (bswap) {
+			for (uint64_t i = 0; i < num_words; i++)
+				words[i] = bswap_64(words[i]);
+		}
+	} else {
+		/*
+		 * Combine pairs of 32-bit words into 64-bit words. Each pair
+		 * occupies the same bytes as the word it becomes.
+		 */
+		for (uint64_t i = 0; i < num_words; i++) {
+			uint32_t lo, hi;
+			memcpy(&lo, (char *)&words[i], sizeof(lo));
+			memcpy(&hi, (char *)&words[i] + sizeof(lo), sizeof(hi));
+			if (bswap) {
+				lo = bswap_32(lo);
+				hi = bswap_32(hi);
+			}
+			words[i] = lo | ((uint64_t)hi << 32);
+		}
+	}
+	/* Clear the bits past the end. */
+	if (size % 64)
+		words[num_words - 1] &= (UINT64_C(1) << (size % 64)) - 1;
+
+	bitmap->words = words;
+	bitmap->size = size;
+	return NULL;
+
+err:
+	free(words);
+	return err;
+}
+
+void linux_helper_bitmap_deinit(struct linux_helper_bitmap *bitmap)
+{
+	free(bitmap->words);
+}
+
+uint64_t linux_helper_bitmap_next(const struct linux_helper_bitmap *bitmap,
+				  uint64_t start, bool set)
+{
+	if (start >= bitmap->size)
+		return bitmap->size;
+	uint64_t num_words = bitmap->size / 64 + (bitmap->size % 64 != 0);
+	/* Searching for a clear bit is searching the inverted words. */
+	uint64_t invert = set ? 0 : UINT64_MAX;
+	uint64_t i = start / 64;
+	uint64_t word = bitmap->words[i] ^ invert;
+	word &= UINT64_MAX << (start % 64);
+	while (!word) {
+		if (++i >= num_words)
+			return bitmap->size;
+		word = bitmap->words[i] ^ invert;
+	}
+	/* The inverted padding in the last word may be "clear". */
+	return min(i * 64 + ctz(word), bitmap->size);
+}
+
+uint64_t linux_helper_bitmap_weight(const struct linux_helper_bitmap *bitmap)
+{
+	uint64_t num_words = bitmap->size / 64 + (bitmap->size % 64 != 0);
+	/*
+	 * Independent accumulators let the compiler vectorize this with a
+	 * vector popcount instruction when one is available.
+	 */
+	uint64_t weight[4] = {};
+	uint64_t i;
+	for (i = 0; i + 4 <= num_words; i += 4) {
+		weight[0] += popcount(bitmap->words[i]);
+		weight[1] += popcount(bitmap->words[i + 1]);
+		weight[2] += popcount(bitmap->words[i + 2]);
+		weight[3] += popcount(bitmap->words[i + 3]);
+	}
+	for (; i < num_words; i++)
+		weight[0] += popcount(bitmap->words[i]);
+	return weight[0] + weight[1] + weight[2] + weight[3];
+}
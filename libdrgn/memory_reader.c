@@ -4,10 +4,15 @@
 #include <assert.h>
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "memory_reader.h"
 #include "minmax.h"
+#include "seekable_zstd.h"
+#include "util.h"
 
 /** Memory segment in a @ref drgn_memory_reader. */
 struct drgn_memory_segment {
@@ -21,10 +26,14 @@ struct drgn_memory_segment {
 	 * drgn_memory_segment::min_address.
 	 */
 	uint64_t orig_min_address;
-	/** Read callback. */
+	/** Read callback, or @c NULL if @ref read_blocks_fn is used. */
 	drgn_memory_read_fn read_fn;
-	/** Argument to pass to @ref drgn_memory_segment::read_fn. */
+	/** Block read callback, or @c NULL if @ref read_fn is used. */
+	drgn_memory_read_blocks_fn read_blocks_fn;
+	/** Argument to pass to the read callback. */
 	void *arg;
+	/** Kind of segment for statistics. */
+	enum drgn_memory_segment_kind kind;
 };
 
 static inline uint64_t
@@ -37,10 +46,96 @@ DEFINE_BINARY_SEARCH_TREE_FUNCTIONS(drgn_memory_segment_tree, node,
 				    drgn_memory_segment_to_key,
 				    binary_search_tree_scalar_cmp, splay)
 
+/** Block of memory in a @ref drgn_memory_cache. */
+struct drgn_memory_cache_block {
+	/** Block number (address / block size). */
+	uint64_t number;
+	/** More recently used block. */
+	struct drgn_memory_cache_block *lru_prev;
+	/** Less recently used block. */
+	struct drgn_memory_cache_block *lru_next;
+	/** Contents of the block. */
+	char data[];
+};
+
+DEFINE_HASH_MAP_FUNCTIONS(drgn_memory_cache_map, int_key_hash_pair,
+			  scalar_key_eq)
+
+static void drgn_memory_cache_init(struct drgn_memory_cache *cache)
+{
+	drgn_memory_cache_map_init(&cache->map);
+	cache->lru_first = cache->lru_last = NULL;
+}
+
+static void drgn_memory_cache_clear(struct drgn_memory_cache *cache)
+{
+	struct drgn_memory_cache_block *block = cache->lru_first;
+	while (block) {
+		struct drgn_memory_cache_block *next = block->lru_next;
+		free(block);
+		block = next;
+	}
+	cache->lru_first = cache->lru_last = NULL;
+	drgn_memory_cache_map_clear(&cache->map);
+}
+
+static void drgn_memory_cache_deinit(struct drgn_memory_cache *cache)
+{
+	drgn_memory_cache_clear(cache);
+	drgn_memory_cache_map_deinit(&cache->map);
+}
+
+static void drgn_memory_cache_unlink(struct drgn_memory_cache *cache,
+				     struct drgn_memory_cache_block *block)
+{
+	if (block->lru_prev)
+		block->lru_prev->lru_next = block->lru_next;
+	else
+		cache->lru_first = block->lru_next;
+	if (block->lru_next)
+		block->lru_next->lru_prev = block->lru_prev;
+	else
+		cache->lru_last = block->lru_prev;
+}
+
+static void drgn_memory_cache_link_first(struct drgn_memory_cache *cache,
+					 struct drgn_memory_cache_block *block)
+{
+	block->lru_prev = NULL;
+	block->lru_next = cache->lru_first;
+	if (cache->lru_first)
+		cache->lru_first->lru_prev = block;
+	else
+		cache->lru_last = block;
+	cache->lru_first = block;
+}
+
+/* Evict blocks until there are at most max_blocks. */
+static void drgn_memory_cache_shrink(struct drgn_memory_cache *cache,
+				     size_t max_blocks)
+{
+	while (drgn_memory_cache_map_size(&cache->map) > max_blocks) {
+		struct drgn_memory_cache_block *block = cache->lru_last;
+		drgn_memory_cache_unlink(cache, block);
+		drgn_memory_cache_map_delete(&cache->map, &block->number);
+		free(block);
+	}
+}
+
 void drgn_memory_reader_init(struct drgn_memory_reader *reader)
 {
 	drgn_memory_segment_tree_init(&reader->virtual_segments);
 	drgn_memory_segment_tree_init(&reader->physical_segments);
+	drgn_memory_cache_init(&reader->virtual_cache);
+	drgn_memory_cache_init(&reader->physical_cache);
+	reader->frozen = false;
+	reader->cache_size = 0;
+	reader->cache_hits = 0;
+	reader->cache_misses = 0;
+	memset(reader->segment_reads, 0, sizeof(reader->segment_reads));
+	memset(reader->segment_read_bytes, 0,
+	       sizeof(reader->segment_read_bytes));
+	reader->cache_generation = 0;
 }
 
 static void free_memory_segment_tree(struct drgn_memory_segment_tree *tree)
@@ -56,8 +151,137 @@ static void free_memory_segment_tree(struct drgn_memory_segment_tree *tree)
 	}
 }
 
+static void
+drgn_memory_segment_array_deinit(struct drgn_memory_segment_array *array)
+{
+	free(array->segments);
+	free(array->min_addresses);
+}
+
+static bool
+drgn_memory_segment_array_init(struct drgn_memory_segment_array *array,
+			       struct drgn_memory_segment_tree *tree)
+{
+	struct drgn_memory_segment_tree_iterator it;
+	size_t size = 0;
+	for (it = drgn_memory_segment_tree_first(tree); it.entry;
+	     it = drgn_memory_segment_tree_next(it))
+		size++;
+
+	array->size = size;
+	if (!size) {
+		array->min_addresses = NULL;
+		array->segments = NULL;
+		return true;
+	}
+	array->min_addresses = malloc_array(size,
+					    sizeof(array->min_addresses[0]));
+	array->segments = malloc_array(size, sizeof(array->segments[0]));
+	if (!array->min_addresses || !array->segments) {
+		drgn_memory_segment_array_deinit(array);
+		return false;
+	}
+	size_t i = 0;
+	for (it = drgn_memory_segment_tree_first(tree); it.entry;
+	     it = drgn_memory_segment_tree_next(it), i++) {
+		array->min_addresses[i] = it.entry->min_address;
+		array->segments[i] = it.entry;
+	}
+	return true;
+}
+
+DEFINE_VECTOR_FUNCTIONS(drgn_memory_range_vector)
+
+bool drgn_memory_reader_ranges(struct drgn_memory_reader *reader,
+			       uint64_t min_address, uint64_t max_address,
+			       bool physical,
+			       struct drgn_memory_range_vector *ret)
+{
+	struct drgn_memory_segment_tree *tree = (physical ?
+						 &reader->physical_segments :
+						 &reader->virtual_segments);
+	struct drgn_memory_range *last = NULL;
+	for (struct drgn_memory_segment_tree_iterator it =
+	     drgn_memory_segment_tree_first(tree);
+	     it.entry; it = drgn_memory_segment_tree_next(it)) {
+		struct drgn_memory_segment *segment = it.entry;
+		if (segment->max_address < min_address)
+			continue;
+		if (segment->min_address > max_address)
+			break;
+		uint64_t segment_min = max(segment->min_address, min_address);
+		uint64_t segment_max = min(segment->max_address, max_address);
+		if (last && last->max_address + 1 == segment_min) {
+			last->max_address = segment_max;
+			continue;
+		}
+		last = drgn_memory_range_vector_append_entry(ret);
+		if (!last)
+			return false;
+		last->min_address = segment_min;
+		last->max_address = segment_max;
+	}
+	return true;
+}
+
+static void drgn_memory_reader_thaw(struct drgn_memory_reader *reader)
+{
+	if (!reader->frozen)
+		return;
+	drgn_memory_segment_array_deinit(&reader->physical_frozen);
+	drgn_memory_segment_array_deinit(&reader->virtual_frozen);
+	reader->frozen = false;
+}
+
+bool drgn_memory_reader_freeze(struct drgn_memory_reader *reader)
+{
+	if (reader->frozen)
+		return true;
+	if (!drgn_memory_segment_array_init(&reader->virtual_frozen,
+					    &reader->virtual_segments))
+		return false;
+	if (!drgn_memory_segment_array_init(&reader->physical_frozen,
+					    &reader->physical_segments)) {
+		drgn_memory_segment_array_deinit(&reader->virtual_frozen);
+		return false;
+	}
+	reader->frozen = true;
+	return true;
+}
+
+/*
+ * Find the last segment starting at or before an address. This doesn't modify
+ * the reader if it is frozen.
+ */
+static struct drgn_memory_segment *
+drgn_memory_reader_search_le(struct drgn_memory_reader *reader,
+			     uint64_t address, bool physical)
+{
+	if (reader->frozen) {
+		const struct drgn_memory_segment_array *array =
+			physical ? &reader->physical_frozen :
+			&reader->virtual_frozen;
+		size_t lo = 0, hi = array->size;
+		while (lo < hi) {
+			size_t mid = lo + (hi - lo) / 2;
+			if (array->min_addresses[mid] <= address)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		return lo ? array->segments[lo - 1] : NULL;
+	}
+	struct drgn_memory_segment_tree *tree = (physical ?
+						 &reader->physical_segments :
+						 &reader->virtual_segments);
+	return drgn_memory_segment_tree_search_le(tree, &address).entry;
+}
+
 void drgn_memory_reader_deinit(struct drgn_memory_reader *reader)
 {
+	drgn_memory_reader_thaw(reader);
+	drgn_memory_cache_deinit(&reader->physical_cache);
+	drgn_memory_cache_deinit(&reader->virtual_cache);
 	free_memory_segment_tree(&reader->physical_segments);
 	free_memory_segment_tree(&reader->virtual_segments);
 }
@@ -68,17 +292,24 @@ bool drgn_memory_reader_empty(struct drgn_memory_reader *reader)
 		drgn_memory_segment_tree_empty(&reader->physical_segments));
 }
 
-struct drgn_error *
-drgn_memory_reader_add_segment(struct drgn_memory_reader *reader,
-			       uint64_t min_address, uint64_t max_address,
-			       drgn_memory_read_fn read_fn, void *arg,
-			       bool physical)
+static struct drgn_error *
+drgn_memory_reader_insert_segment(struct drgn_memory_reader *reader,
+				  uint64_t min_address, uint64_t max_address,
+				  drgn_memory_read_fn read_fn,
+				  drgn_memory_read_blocks_fn read_blocks_fn,
+				  void *arg, enum drgn_memory_segment_kind kind,
+				  bool physical)
 {
 	assert(min_address <= max_address);
 
+	drgn_memory_reader_thaw(reader);
 	struct drgn_memory_segment_tree *tree = (physical ?
 						 &reader->physical_segments :
 						 &reader->virtual_segments);
+	/* Cached blocks may have been read from an overridden segment. */
+	drgn_memory_cache_clear(physical ? &reader->physical_cache :
+				&reader->virtual_cache);
+	reader->cache_generation++;
 
 	/*
 	 * This is split into two steps: the first step handles an overlapping
@@ -128,7 +359,9 @@ drgn_memory_reader_add_segment(struct drgn_memory_reader *reader,
 			tail->max_address = it.entry->max_address;
 			tail->orig_min_address = it.entry->orig_min_address;
 			tail->read_fn = it.entry->read_fn;
+			tail->read_blocks_fn = it.entry->read_blocks_fn;
 			tail->arg = it.entry->arg;
+			tail->kind = it.entry->kind;
 
 			drgn_memory_segment_tree_insert(tree, tail, NULL);
 			goto insert;
@@ -227,28 +460,167 @@ insert:
 	segment->min_address = segment->orig_min_address = min_address;
 	segment->max_address = max_address;
 	segment->read_fn = read_fn;
+	segment->read_blocks_fn = read_blocks_fn;
 	segment->arg = arg;
+	segment->kind = kind;
 	/* If the segment is stolen, then it's already in the tree. */
 	if (!stolen)
 		drgn_memory_segment_tree_insert(tree, segment, NULL);
 	return NULL;
 }
 
-struct drgn_error *drgn_memory_reader_read(struct drgn_memory_reader *reader,
-					   void *buf, uint64_t address,
-					   size_t count, bool physical)
+struct drgn_error *
+drgn_memory_reader_add_segment(struct drgn_memory_reader *reader,
+			       uint64_t min_address, uint64_t max_address,
+			       drgn_memory_read_fn read_fn, void *arg,
+			       enum drgn_memory_segment_kind kind,
+			       bool physical)
 {
-	assert(count == 0 || count - 1 <= UINT64_MAX - address);
+	return drgn_memory_reader_insert_segment(reader, min_address,
+						 max_address, read_fn, NULL,
+						 arg, kind, physical);
+}
+
+struct drgn_error *
+drgn_memory_reader_add_block_segment(struct drgn_memory_reader *reader,
+				     uint64_t min_address,
+				     uint64_t max_address,
+				     drgn_memory_read_blocks_fn read_fn,
+				     void *arg, bool physical)
+{
+	assert(min_address % DRGN_MEMORY_CACHE_BLOCK_SIZE == 0);
+	assert(max_address % DRGN_MEMORY_CACHE_BLOCK_SIZE ==
+	       DRGN_MEMORY_CACHE_BLOCK_SIZE - 1);
+	return drgn_memory_reader_insert_segment(reader, min_address,
+						 max_address, NULL, read_fn,
+						 arg,
+						 DRGN_MEMORY_SEGMENT_CUSTOM,
+						 physical);
+}
 
+void drgn_memory_reader_set_cache_size(struct drgn_memory_reader *reader,
+				       size_t size)
+{
+	reader->cache_size = size - size % DRGN_MEMORY_CACHE_BLOCK_SIZE;
+	size_t max_blocks = reader->cache_size / DRGN_MEMORY_CACHE_BLOCK_SIZE;
+	reader->cache_generation++;
+	drgn_memory_cache_shrink(&reader->virtual_cache, max_blocks);
+	drgn_memory_cache_shrink(&reader->physical_cache, max_blocks);
+}
+
+void drgn_memory_reader_invalidate_cache(struct drgn_memory_reader *reader)
+{
+	drgn_memory_cache_clear(&reader->virtual_cache);
+	drgn_memory_cache_clear(&reader->physical_cache);
+	reader->cache_generation++;
+}
+
+void
+drgn_memory_reader_invalidate_cache_range(struct drgn_memory_reader *reader,
+					  uint64_t address, uint64_t size,
+					  bool physical)
+{
+	if (size == 0)
+		return;
+	reader->cache_generation++;
+	struct drgn_memory_cache *cache =
+		physical ? &reader->physical_cache : &reader->virtual_cache;
+	uint64_t first = address / DRGN_MEMORY_CACHE_BLOCK_SIZE;
+	uint64_t end = size - 1 > UINT64_MAX - address ?
+		       UINT64_MAX : address + (size - 1);
+	uint64_t last = end / DRGN_MEMORY_CACHE_BLOCK_SIZE;
+	/* Don't probe more blocks than could possibly be cached. */
+	if (last - first >= drgn_memory_cache_map_size(&cache->map)) {
+		struct drgn_memory_cache_block *block = cache->lru_first;
+		while (block) {
+			struct drgn_memory_cache_block *next = block->lru_next;
+			if (block->number >= first && block->number <= last) {
+				drgn_memory_cache_unlink(cache, block);
+				drgn_memory_cache_map_delete(&cache->map,
+							     &block->number);
+				free(block);
+			}
+			block = next;
+		}
+		return;
+	}
+	for (uint64_t number = first;; number++) {
+		struct drgn_memory_cache_map_iterator it =
+			drgn_memory_cache_map_search(&cache->map, &number);
+		if (it.entry) {
+			struct drgn_memory_cache_block *block = it.entry->value;
+			drgn_memory_cache_unlink(cache, block);
+			drgn_memory_cache_map_delete(&cache->map, &number);
+			free(block);
+		}
+		if (number == last)
+			break;
+	}
+}
+
+/*
+ * Read from a block segment by rounding the read out to whole blocks. The
+ * rounded range is still in the segment as it was added, even if it was
+ * truncated since, because the original segment was aligned.
+ */
+static struct drgn_error *
+drgn_memory_segment_read_blocks(struct drgn_memory_reader *reader,
+				struct drgn_memory_segment *segment, void *buf,
+				uint64_t address, size_t count, bool physical)
+{
+	struct drgn_error *err;
+	uint64_t start = address & -DRGN_MEMORY_CACHE_BLOCK_SIZE;
+	uint64_t last = (address + (count - 1)) |
+			(DRGN_MEMORY_CACHE_BLOCK_SIZE - 1);
+	struct drgn_memory_block_range range = {
+		.address = start,
+		.count = last - start + 1,
+		.offset = start - segment->orig_min_address,
+	};
+	reader->segment_reads[segment->kind]++;
+	reader->segment_read_bytes[segment->kind] += range.count;
+	if (range.address == address && range.count == count) {
+		range.buf = buf;
+		return segment->read_blocks_fn(&range, 1, segment->arg,
+					       physical);
+	}
+	range.buf = malloc(range.count);
+	if (!range.buf)
+		return &drgn_enomem;
+	err = segment->read_blocks_fn(&range, 1, segment->arg, physical);
+	if (!err)
+		memcpy(buf, (char *)range.buf + (address - start), count);
+	free(range.buf);
+	return err;
+}
+
+static struct drgn_error *
+drgn_memory_segment_read(struct drgn_memory_reader *reader,
+			 struct drgn_memory_segment *segment, void *buf,
+			 uint64_t address, size_t count, bool physical)
+{
+	if (segment->read_blocks_fn) {
+		return drgn_memory_segment_read_blocks(reader, segment, buf,
+						       address, count,
+						       physical);
+	}
+	reader->segment_reads[segment->kind]++;
+	reader->segment_read_bytes[segment->kind] += count;
+	return segment->read_fn(buf, address, count,
+				address - segment->orig_min_address,
+				segment->arg, physical);
+}
+
+static struct drgn_error *
+drgn_memory_reader_read_uncached(struct drgn_memory_reader *reader,
+				 void *buf, uint64_t address, size_t count,
+				 bool physical)
+{
 	struct drgn_error *err;
-	struct drgn_memory_segment_tree *tree = (physical ?
-						 &reader->physical_segments :
-						 &reader->virtual_segments);
 	char *p = buf;
 	while (count > 0) {
 		struct drgn_memory_segment *segment =
-			drgn_memory_segment_tree_search_le(tree,
-							   &address).entry;
+			drgn_memory_reader_search_le(reader, address, physical);
 		if (!segment || segment->max_address < address) {
 			return drgn_error_create_fault("could not find memory segment",
 						       address);
@@ -256,9 +628,8 @@ struct drgn_error *drgn_memory_reader_read(struct drgn_memory_reader *reader,
 
 		size_t n = min((uint64_t)(count - 1),
 			       segment->max_address - address) + 1;
-		err = segment->read_fn(p, address, n,
-				       address - segment->orig_min_address,
-				       segment->arg, physical);
+		err = drgn_memory_segment_read(reader, segment, p, address, n,
+					       physical);
 		if (err)
 			return err;
 		p += n;
@@ -268,10 +639,504 @@ struct drgn_error *drgn_memory_reader_read(struct drgn_memory_reader *reader,
 	return NULL;
 }
 
+/*
+ * Return a pointer to the mapped contents of a segment for an address range
+ * contained in the segment, or NULL if the segment isn't mapped.
+ */
+static const void *
+drgn_memory_segment_mapping(const struct drgn_memory_segment *segment,
+			    uint64_t address, size_t count)
+{
+	if (segment->read_fn != drgn_read_memory_file)
+		return NULL;
+	const struct drgn_memory_file_segment *file_segment = segment->arg;
+	uint64_t offset = address - segment->orig_min_address;
+	if (!file_segment->map || offset > file_segment->file_size ||
+	    count > file_segment->file_size - offset)
+		return NULL;
+	return file_segment->map + offset;
+}
+
+const void *drgn_memory_reader_borrow(struct drgn_memory_reader *reader,
+				      uint64_t address, size_t count,
+				      bool physical)
+{
+	assert(count > 0 && count - 1 <= UINT64_MAX - address);
+
+	struct drgn_memory_segment *segment =
+		drgn_memory_reader_search_le(reader, address, physical);
+	if (!segment || segment->max_address < address ||
+	    segment->max_address - address < count - 1)
+		return NULL;
+	return drgn_memory_segment_mapping(segment, address, count);
+}
+
+/* Look up a cached block and mark it as the most recently used. */
+static struct drgn_memory_cache_block *
+drgn_memory_cache_lookup(struct drgn_memory_cache *cache, uint64_t number)
+{
+	struct drgn_memory_cache_map_iterator it =
+		drgn_memory_cache_map_search(&cache->map, &number);
+	if (!it.entry)
+		return NULL;
+	struct drgn_memory_cache_block *block = it.entry->value;
+	if (block != cache->lru_first) {
+		drgn_memory_cache_unlink(cache, block);
+		drgn_memory_cache_link_first(cache, block);
+	}
+	return block;
+}
+
+/*
+ * Get a block to cache, either newly allocated or by evicting the least
+ * recently used block. It isn't in the cache until it is inserted.
+ */
+static struct drgn_memory_cache_block *
+drgn_memory_cache_new_block(struct drgn_memory_reader *reader,
+			    struct drgn_memory_cache *cache)
+{
+	if (drgn_memory_cache_map_size(&cache->map) >=
+	    reader->cache_size / DRGN_MEMORY_CACHE_BLOCK_SIZE) {
+		struct drgn_memory_cache_block *block = cache->lru_last;
+		drgn_memory_cache_unlink(cache, block);
+		drgn_memory_cache_map_delete(&cache->map, &block->number);
+		return block;
+	}
+	return malloc(sizeof(struct drgn_memory_cache_block) +
+		      DRGN_MEMORY_CACHE_BLOCK_SIZE);
+}
+
+/*
+ * Insert a block that was read. Returns the cached block, which may be a
+ * different one if a reentrant read already cached it, or NULL if memory
+ * couldn't be allocated.
+ */
+static struct drgn_memory_cache_block *
+drgn_memory_cache_insert(struct drgn_memory_cache *cache, uint64_t number,
+			 struct drgn_memory_cache_block *block)
+{
+	struct drgn_memory_cache_map_entry entry = {
+		.key = number,
+		.value = block,
+	};
+	struct drgn_memory_cache_map_iterator it;
+	int ret = drgn_memory_cache_map_insert(&cache->map, &entry, &it);
+	if (ret <= 0) {
+		free(block);
+		return ret == 0 ? it.entry->value : NULL;
+	}
+	block->number = number;
+	drgn_memory_cache_link_first(cache, block);
+	return block;
+}
+
+/*
+ * Read a run of consecutive uncached blocks with one call to the segment's
+ * read function and cache them. Returns the first block, or NULL if the blocks
+ * can't be cached, in which case the caller should fall back to reading fewer
+ * blocks or an uncached read.
+ */
+static struct drgn_memory_cache_block *
+drgn_memory_cache_fill(struct drgn_memory_reader *reader,
+		       struct drgn_memory_cache *cache, uint64_t number,
+		       uint64_t num_blocks, bool physical)
+{
+	/*
+	 * Only cache blocks that lie entirely within one segment. Blocks that
+	 * span segments are rare, and this avoids repeatedly trying to cache a
+	 * block which is partially unreadable.
+	 */
+	uint64_t address = number * DRGN_MEMORY_CACHE_BLOCK_SIZE;
+	uint64_t size = num_blocks * DRGN_MEMORY_CACHE_BLOCK_SIZE;
+	struct drgn_memory_segment *segment =
+		drgn_memory_reader_search_le(reader, address, physical);
+	if (!segment || segment->max_address < address ||
+	    segment->max_address - address < size - 1)
+		return NULL;
+	/* Mapped memory is already as fast as the cache. */
+	if (drgn_memory_segment_mapping(segment, address, size))
+		return NULL;
+
+	/*
+	 * A single block is read directly into the block. It isn't in the cache
+	 * while it's being read, so a reentrant read (e.g., from a page table
+	 * walk) can't evict it.
+	 */
+	struct drgn_memory_cache_block *block = NULL;
+	char *buf;
+	if (num_blocks == 1) {
+		block = drgn_memory_cache_new_block(reader, cache);
+		if (!block)
+			return NULL;
+		buf = block->data;
+	} else {
+		buf = malloc(size);
+		if (!buf)
+			return NULL;
+	}
+	struct drgn_error *err =
+		drgn_memory_segment_read(reader, segment, buf, address, size,
+					 physical);
+	if (err) {
+		drgn_error_destroy(err);
+		if (block)
+			free(block);
+		else
+			free(buf);
+		return NULL;
+	}
+	reader->cache_misses += num_blocks;
+	if (block)
+		return drgn_memory_cache_insert(cache, number, block);
+
+	struct drgn_memory_cache_block *first = NULL;
+	for (uint64_t i = 0; i < num_blocks; i++) {
+		block = drgn_memory_cache_new_block(reader, cache);
+		if (!block)
+			break;
+		memcpy(block->data, buf + i * DRGN_MEMORY_CACHE_BLOCK_SIZE,
+		       DRGN_MEMORY_CACHE_BLOCK_SIZE);
+		block = drgn_memory_cache_insert(cache, number + i, block);
+		if (!block)
+			break;
+		if (i == 0)
+			first = block;
+	}
+	/*
+	 * Inserting the later blocks may have evicted the first one if the
+	 * cache is tiny, so look it up again.
+	 */
+	if (first)
+		first = drgn_memory_cache_lookup(cache, number);
+	free(buf);
+	return first;
+}
+
+DEFINE_VECTOR(drgn_block_range_vector, struct drgn_memory_block_range)
+
+/*
+ * If a block is uncached and entirely in a block segment, read it and all of
+ * the other uncached blocks of the segment up to another block with one call
+ * to the segment's block read function and cache them. Blocks that are
+ * already cached in between are counted as hits. Returns the first block and
+ * the number after the last block that was read or counted. If the block isn't
+ * entirely in a block segment, the returned block is NULL, in which case the
+ * caller should fall back to reading it individually. Errors from the block
+ * read function are returned as is.
+ */
+static struct drgn_error *
+drgn_memory_cache_fill_blocks(struct drgn_memory_reader *reader,
+			      struct drgn_memory_cache *cache, uint64_t number,
+			      uint64_t last_number, bool physical,
+			      struct drgn_memory_cache_block **block_ret,
+			      uint64_t *end_ret)
+{
+	*block_ret = NULL;
+	uint64_t address = number * DRGN_MEMORY_CACHE_BLOCK_SIZE;
+	struct drgn_memory_segment *segment =
+		drgn_memory_reader_search_le(reader, address, physical);
+	if (!segment || !segment->read_blocks_fn ||
+	    segment->max_address - address < DRGN_MEMORY_CACHE_BLOCK_SIZE - 1)
+		return NULL;
+	/* Don't read more blocks than can be cached. */
+	uint64_t max_blocks =
+		reader->cache_size / DRGN_MEMORY_CACHE_BLOCK_SIZE;
+	uint64_t segment_last_number =
+		(segment->max_address - (DRGN_MEMORY_CACHE_BLOCK_SIZE - 1)) /
+		DRGN_MEMORY_CACHE_BLOCK_SIZE;
+	last_number = min(last_number, segment_last_number);
+
+	struct drgn_error *err;
+	struct drgn_block_range_vector ranges = VECTOR_INIT;
+	struct drgn_memory_block_range *range = NULL;
+	uint64_t num_blocks = 0, num_hits = 0, hits_end = number;
+	uint64_t end;
+	for (end = number; end <= last_number && num_blocks < max_blocks;
+	     end++) {
+		if (drgn_memory_cache_map_search(&cache->map, &end).entry) {
+			num_hits++;
+			range = NULL;
+			continue;
+		}
+		hits_end = end + 1;
+		if (range) {
+			range->count += DRGN_MEMORY_CACHE_BLOCK_SIZE;
+		} else {
+			range = drgn_block_range_vector_append_entry(&ranges);
+			if (!range) {
+				err = &drgn_enomem;
+				goto out_ranges;
+			}
+			range->address = end * DRGN_MEMORY_CACHE_BLOCK_SIZE;
+			range->count = DRGN_MEMORY_CACHE_BLOCK_SIZE;
+			range->offset = (range->address -
+					 segment->orig_min_address);
+		}
+		num_blocks++;
+	}
+	/* Hits after the last block read are counted by the caller. */
+	num_hits -= end - hits_end;
+	end = hits_end;
+
+	char *buf = malloc_array(num_blocks, DRGN_MEMORY_CACHE_BLOCK_SIZE);
+	if (!buf) {
+		err = &drgn_enomem;
+		goto out_ranges;
+	}
+	char *p = buf;
+	for (size_t i = 0; i < ranges.size; i++) {
+		ranges.data[i].buf = p;
+		p += ranges.data[i].count;
+	}
+	err = segment->read_blocks_fn(ranges.data, ranges.size, segment->arg,
+				      physical);
+	if (err)
+		goto out_buf;
+	reader->segment_reads[segment->kind]++;
+	reader->segment_read_bytes[segment->kind] +=
+		num_blocks * DRGN_MEMORY_CACHE_BLOCK_SIZE;
+	reader->cache_misses += num_blocks;
+	reader->cache_hits += num_hits;
+
+	p = buf;
+	for (size_t i = 0; i < ranges.size; i++) {
+		uint64_t range_number =
+			ranges.data[i].address / DRGN_MEMORY_CACHE_BLOCK_SIZE;
+		for (size_t j = 0;
+		     j < ranges.data[i].count / DRGN_MEMORY_CACHE_BLOCK_SIZE;
+		     j++) {
+			struct drgn_memory_cache_block *block =
+				drgn_memory_cache_new_block(reader, cache);
+			if (!block) {
+				err = &drgn_enomem;
+				goto out_buf;
+			}
+			memcpy(block->data, p, DRGN_MEMORY_CACHE_BLOCK_SIZE);
+			if (!drgn_memory_cache_insert(cache, range_number + j,
+						      block)) {
+				err = &drgn_enomem;
+				goto out_buf;
+			}
+			p += DRGN_MEMORY_CACHE_BLOCK_SIZE;
+		}
+	}
+	*block_ret = drgn_memory_cache_lookup(cache, number);
+	*end_ret = end;
+out_buf:
+	free(buf);
+out_ranges:
+	drgn_block_range_vector_deinit(&ranges);
+	return err;
+}
+
+bool drgn_memory_reader_prefetch_begin(struct drgn_memory_reader *reader,
+				       uint64_t number, uint64_t last_number,
+				       bool physical,
+				       struct drgn_memory_prefetch *ret)
+{
+	ret->num_blocks = 1;
+	if (!reader->cache_size)
+		return false;
+	struct drgn_memory_cache *cache = (physical ?
+					   &reader->physical_cache :
+					   &reader->virtual_cache);
+	if (drgn_memory_cache_map_search(&cache->map, &number).entry)
+		return false;
+
+	uint64_t address = number * DRGN_MEMORY_CACHE_BLOCK_SIZE;
+	struct drgn_memory_segment *segment =
+		drgn_memory_reader_search_le(reader, address, physical);
+	if (!segment || segment->read_fn != drgn_read_memory_file ||
+	    segment->max_address - address < DRGN_MEMORY_CACHE_BLOCK_SIZE - 1)
+		return false;
+	const struct drgn_memory_file_segment *file_segment = segment->arg;
+	uint64_t offset = address - segment->orig_min_address;
+	if (file_segment->map) {
+		if (offset < file_segment->file_size) {
+			/* Start reading the pages of the file mapping. */
+			uintptr_t page_mask =
+				~(uintptr_t)(sysconf(_SC_PAGESIZE) - 1);
+			uintptr_t start =
+				(uintptr_t)(file_segment->map + offset);
+			size_t size = min(file_segment->file_size - offset,
+					  (last_number - number + 1) *
+					  DRGN_MEMORY_CACHE_BLOCK_SIZE);
+			madvise((void *)(start & page_mask),
+				size + (start & ~page_mask), MADV_WILLNEED);
+		}
+		ret->num_blocks = last_number - number + 1;
+		return false;
+	}
+
+	/* Extend to the following uncached blocks in the same segment. */
+	uint64_t max_blocks =
+		min((segment->max_address - address + 1) /
+		    DRGN_MEMORY_CACHE_BLOCK_SIZE,
+		    min(DRGN_MEMORY_CACHE_MAX_BATCH, last_number - number + 1));
+	uint64_t num_blocks = 1;
+	while (num_blocks < max_blocks) {
+		uint64_t next = number + num_blocks;
+		if (drgn_memory_cache_map_search(&cache->map, &next).entry)
+			break;
+		num_blocks++;
+	}
+	ret->buf = malloc(num_blocks * DRGN_MEMORY_CACHE_BLOCK_SIZE);
+	if (!ret->buf)
+		return false;
+	ret->number = number;
+	ret->num_blocks = num_blocks;
+	ret->generation = reader->cache_generation;
+	ret->arg = segment->arg;
+	ret->offset = offset;
+	ret->physical = physical;
+	return true;
+}
+
+struct drgn_error *
+drgn_memory_prefetch_read(struct drgn_memory_prefetch *prefetch)
+{
+	return drgn_read_memory_file(prefetch->buf,
+				     prefetch->number *
+				     DRGN_MEMORY_CACHE_BLOCK_SIZE,
+				     prefetch->num_blocks *
+				     DRGN_MEMORY_CACHE_BLOCK_SIZE,
+				     prefetch->offset, prefetch->arg,
+				     prefetch->physical);
+}
+
+void drgn_memory_reader_prefetch_end(struct drgn_memory_reader *reader,
+				     struct drgn_memory_prefetch *prefetch,
+				     bool success)
+{
+	if (success) {
+		reader->segment_reads[DRGN_MEMORY_SEGMENT_FILE]++;
+		reader->segment_read_bytes[DRGN_MEMORY_SEGMENT_FILE] +=
+			prefetch->num_blocks * DRGN_MEMORY_CACHE_BLOCK_SIZE;
+	}
+	if (!success || !reader->cache_size ||
+	    prefetch->generation != reader->cache_generation)
+		goto out;
+	struct drgn_memory_cache *cache = (prefetch->physical ?
+					   &reader->physical_cache :
+					   &reader->virtual_cache);
+	for (uint64_t i = 0; i < prefetch->num_blocks; i++) {
+		uint64_t number = prefetch->number + i;
+		/* The block may have been read while we weren't locked. */
+		if (drgn_memory_cache_map_search(&cache->map, &number).entry)
+			continue;
+		struct drgn_memory_cache_block *block =
+			drgn_memory_cache_new_block(reader, cache);
+		if (!block)
+			break;
+		memcpy(block->data,
+		       prefetch->buf + i * DRGN_MEMORY_CACHE_BLOCK_SIZE,
+		       DRGN_MEMORY_CACHE_BLOCK_SIZE);
+		if (!drgn_memory_cache_insert(cache, number, block))
+			break;
+		reader->cache_misses++;
+	}
+out:
+	free(prefetch->buf);
+}
+
+struct drgn_error *drgn_memory_reader_read(struct drgn_memory_reader *reader,
+					   void *buf, uint64_t address,
+					   size_t count, bool physical)
+{
+	assert(count == 0 || count - 1 <= UINT64_MAX - address);
+
+	if (count == 0)
+		return NULL;
+	const void *mapping = drgn_memory_reader_borrow(reader, address, count,
+							physical);
+	if (mapping) {
+		drgn_memory_reader_count_mapped_read(reader, count);
+		memcpy(buf, mapping, count);
+		return NULL;
+	}
+
+	struct drgn_error *err;
+	if (!reader->cache_size) {
+		return drgn_memory_reader_read_uncached(reader, buf, address,
+							count, physical);
+	}
+
+	struct drgn_memory_cache *cache = (physical ?
+					   &reader->physical_cache :
+					   &reader->virtual_cache);
+	uint64_t max_batch = min(DRGN_MEMORY_CACHE_MAX_BATCH,
+				 reader->cache_size /
+				 DRGN_MEMORY_CACHE_BLOCK_SIZE);
+	uint64_t last_number =
+		(address + (count - 1)) / DRGN_MEMORY_CACHE_BLOCK_SIZE;
+	/* Blocks cached by this read don't count as hits. */
+	uint64_t filled_end = 0;
+	char *p = buf;
+	while (count > 0) {
+		uint64_t number = address / DRGN_MEMORY_CACHE_BLOCK_SIZE;
+		size_t offset = address % DRGN_MEMORY_CACHE_BLOCK_SIZE;
+		size_t n = min((uint64_t)(count - 1),
+			       DRGN_MEMORY_CACHE_BLOCK_SIZE - 1 - offset) + 1;
+		struct drgn_memory_cache_block *block =
+			drgn_memory_cache_lookup(cache, number);
+		if (block) {
+			if (number >= filled_end)
+				reader->cache_hits++;
+		} else if ((err = drgn_memory_cache_fill_blocks(reader, cache,
+								number,
+								last_number,
+								physical,
+								&block,
+								&filled_end))) {
+			return err;
+		} else if (!block) {
+			/*
+			 * Read the following blocks of this read that also
+			 * aren't cached at the same time. This is much faster
+			 * for backends with a high per-call cost, like
+			 * libkdumpfile.
+			 */
+			uint64_t num_blocks = 1;
+			while (num_blocks < max_batch &&
+			       number + num_blocks <= last_number) {
+				uint64_t next = number + num_blocks;
+				if (drgn_memory_cache_map_search(&cache->map,
+								 &next).entry)
+					break;
+				num_blocks++;
+			}
+			block = drgn_memory_cache_fill(reader, cache, number,
+						       num_blocks, physical);
+			if (!block && num_blocks > 1) {
+				num_blocks = 1;
+				block = drgn_memory_cache_fill(reader, cache,
+							       number, 1,
+							       physical);
+			}
+			if (block)
+				filled_end = number + num_blocks;
+		}
+		if (block) {
+			memcpy(p, block->data + offset, n);
+		} else {
+			err = drgn_memory_reader_read_uncached(reader, p,
+							       address, n,
+							       physical);
+			if (err)
+				return err;
+		}
+		p += n;
+		address += n;
+		count -= n;
+	}
+	return NULL;
+}
+
 struct drgn_error *drgn_read_memory_file(void *buf, uint64_t address,
 					 size_t count, uint64_t offset,
 					 void *arg, bool physical)
 {
+	struct drgn_error *err;
 	struct drgn_memory_file_segment *file_segment = arg;
 
 	if (offset > file_segment->file_size ||
@@ -282,7 +1147,37 @@ struct drgn_error *drgn_read_memory_file(void *buf, uint64_t address,
 					       address);
 	}
 
+	if (file_segment->map) {
+		memcpy(buf, file_segment->map + offset, count);
+		return NULL;
+	}
+
 	uint64_t file_offset = file_segment->file_offset + offset;
+	if (file_segment->zstd) {
+		size_t n;
+		err = drgn_seekable_zstd_pread(file_segment->zstd, buf, count,
+					       file_offset, &n);
+		if (err)
+			return err;
+		if (n < count) {
+			return drgn_error_create_fault("short read from memory file",
+						       address + n);
+		}
+		return NULL;
+	}
+
+	if (file_segment->pid) {
+		size_t n;
+		err = drgn_read_process_memory(file_segment->pid, buf,
+					       file_offset, count, &n);
+		if (!err && n < count) {
+			return drgn_error_create_fault("could not read memory",
+						       address + n);
+		} else if (err != &drgn_not_found) {
+			return err;
+		}
+	}
+
 	char *p = buf;
 	while (count) {
 		ssize_t ret = pread(file_segment->fd, p, count, file_offset);
@@ -306,3 +1201,37 @@ struct drgn_error *drgn_read_memory_file(void *buf, uint64_t address,
 	}
 	return NULL;
 }
+
+struct drgn_error *drgn_read_process_memory(pid_t pid, void *buf,
+					    uint64_t address, size_t count,
+					    size_t *ret)
+{
+	size_t n = 0;
+	while (n < count) {
+		struct iovec local = {
+			.iov_base = (char *)buf + n,
+			.iov_len = count - n,
+		};
+		struct iovec remote = {
+			.iov_base = (void *)(uintptr_t)(address + n),
+			.iov_len = count - n,
+		};
+		ssize_t sret = process_vm_readv(pid, &local, 1, &remote, 1, 0);
+		if (sret == -1) {
+			if (errno == EINTR)
+				continue;
+			/* The rest of the range isn't mapped. */
+			if (errno == EFAULT)
+				break;
+			if (errno == ENOSYS || errno == EPERM)
+				return &drgn_not_found;
+			return drgn_error_create_os("process_vm_readv", errno,
+						    NULL);
+		} else if (sret == 0) {
+			break;
+		}
+		n += sret;
+	}
+	*ret = n;
+	return NULL;
+}
@@ -12,8 +12,12 @@
 #ifndef DRGN_MEMORY_READER_H
 #define DRGN_MEMORY_READER_H
 
+#include <sys/types.h>
+
 #include "binary_search_tree.h"
 #include "drgn.h"
+#include "hash_table.h"
+#include "vector.h"
 
 /**
  * @ingroup Internals
@@ -34,17 +38,103 @@
 DEFINE_BINARY_SEARCH_TREE_TYPE(drgn_memory_segment_tree,
 			       struct drgn_memory_segment)
 
+/** Size and alignment of blocks in a @ref drgn_memory_cache. */
+static const uint64_t DRGN_MEMORY_CACHE_BLOCK_SIZE = DRGN_MEMORY_BLOCK_SIZE;
+
+/**
+ * Maximum number of uncached blocks read at once by @ref
+ * drgn_memory_reader_read() from segments other than block segments (see @ref
+ * drgn_memory_reader_add_block_segment()).
+ */
+static const uint64_t DRGN_MEMORY_CACHE_MAX_BATCH = 16;
+
+/** Default cache size for programs whose memory can't change. */
+static const size_t DRGN_DEFAULT_MEMORY_CACHE_SIZE = 32 * 1024 * 1024;
+
+struct drgn_memory_cache_block;
+struct drgn_seekable_zstd;
+
+DEFINE_HASH_MAP_TYPE(drgn_memory_cache_map, uint64_t,
+		     struct drgn_memory_cache_block *)
+
+/**
+ * Cache of blocks of memory read from an address space.
+ *
+ * Blocks are evicted in least recently used order.
+ */
+struct drgn_memory_cache {
+	/** Map from block number (address / block size) to block. */
+	struct drgn_memory_cache_map map;
+	/** Most recently used block. */
+	struct drgn_memory_cache_block *lru_first;
+	/** Least recently used block. */
+	struct drgn_memory_cache_block *lru_last;
+};
+
+/**
+ * Segments of a @ref drgn_memory_segment_tree compiled into sorted arrays by
+ * @ref drgn_memory_reader_freeze().
+ */
+struct drgn_memory_segment_array {
+	/** Start address of each segment, in ascending order. */
+	uint64_t *min_addresses;
+	/** Segments, in the same order as @ref min_addresses. */
+	struct drgn_memory_segment **segments;
+	/** Number of segments. */
+	size_t size;
+};
+
 /**
  * Memory reader.
  *
  * A memory reader maps the segments of memory in an address space to callbacks
  * which can be used to read memory from those segments.
+ *
+ * Reads may optionally be cached in blocks of @ref
+ * DRGN_MEMORY_CACHE_BLOCK_SIZE bytes. The cache must be invalidated with @ref
+ * drgn_memory_reader_invalidate_cache() if the underlying memory may have
+ * changed.
+ *
+ * Searching the segment trees splays them, so by default, even reads that
+ * don't use the cache modify the reader. Once the segments are known not to
+ * change, @ref drgn_memory_reader_freeze() can be used to search sorted arrays
+ * instead.
  */
 struct drgn_memory_reader {
 	/** Virtual memory segments. */
 	struct drgn_memory_segment_tree virtual_segments;
 	/** Physical memory segments. */
 	struct drgn_memory_segment_tree physical_segments;
+	/** Frozen virtual memory segments. Only valid if @ref frozen. */
+	struct drgn_memory_segment_array virtual_frozen;
+	/** Frozen physical memory segments. Only valid if @ref frozen. */
+	struct drgn_memory_segment_array physical_frozen;
+	/** Whether the segments have been frozen. */
+	bool frozen;
+	/** Cache of virtual memory. */
+	struct drgn_memory_cache virtual_cache;
+	/** Cache of physical memory. */
+	struct drgn_memory_cache physical_cache;
+	/**
+	 * Maximum number of bytes to cache for each address space, rounded down
+	 * to a multiple of @ref DRGN_MEMORY_CACHE_BLOCK_SIZE. Zero if caching
+	 * is disabled.
+	 */
+	size_t cache_size;
+	/** Number of block reads served from the cache. */
+	uint64_t cache_hits;
+	/** Number of blocks read from the segments to be cached. */
+	uint64_t cache_misses;
+	/** Number of reads from segments of each kind. */
+	uint64_t segment_reads[DRGN_NUM_MEMORY_SEGMENT_KINDS];
+	/** Number of bytes read from segments of each kind. */
+	uint64_t segment_read_bytes[DRGN_NUM_MEMORY_SEGMENT_KINDS];
+	/**
+	 * Incremented whenever cached blocks are discarded so that blocks
+	 * prefetched before then aren't cached. See @ref
+	 * drgn_memory_reader_prefetch_begin().
+	 */
+	uint64_t cache_generation;
 };
 
 /**
@@ -63,11 +153,15 @@ bool drgn_memory_reader_empty(struct drgn_memory_reader *reader);
 /**
  * Add a segment to a @ref drgn_memory_reader.
  *
+ * If the reader was frozen with @ref drgn_memory_reader_freeze(), it is thawed
+ * first.
+ *
  * @param[in] reader Memory reader.
  * @param[in] min_address Start address (inclusive).
  * @param[in] max_address End address (inclusive). Must be `>= min_address`.
  * @param[in] read_fn Callback to read from segment.
  * @param[in] arg Argument to pass to @p read_fn.
+ * @param[in] kind Kind of segment for statistics.
  * @param[in] physical Whether to add a physical memory segment.
  * @return @c NULL on success, non-@c NULL on error.
  */
@@ -75,8 +169,116 @@ struct drgn_error *
 drgn_memory_reader_add_segment(struct drgn_memory_reader *reader,
 			       uint64_t min_address, uint64_t max_address,
 			       drgn_memory_read_fn read_fn, void *arg,
+			       enum drgn_memory_segment_kind kind,
 			       bool physical);
 
+/**
+ * Add a segment read in whole blocks to a @ref drgn_memory_reader.
+ *
+ * This is like @ref drgn_memory_reader_add_segment(), but reads are rounded
+ * out to whole blocks of @ref DRGN_MEMORY_CACHE_BLOCK_SIZE bytes, and when
+ * caching is enabled, all of the uncached blocks of the segment needed by one
+ * @ref drgn_memory_reader_read() are read with one call to @p read_fn. The
+ * segment is counted as @ref DRGN_MEMORY_SEGMENT_CUSTOM.
+ *
+ * @param[in] min_address Start address (inclusive). Must be a multiple of the
+ * block size.
+ * @param[in] max_address End address (inclusive). `max_address + 1` must be a
+ * multiple of the block size.
+ */
+struct drgn_error *
+drgn_memory_reader_add_block_segment(struct drgn_memory_reader *reader,
+				     uint64_t min_address,
+				     uint64_t max_address,
+				     drgn_memory_read_blocks_fn read_fn,
+				     void *arg, bool physical);
+
+/** Range of addresses covered by segments of a @ref drgn_memory_reader. */
+struct drgn_memory_range {
+	/** Start address (inclusive). */
+	uint64_t min_address;
+	/** End address (inclusive). */
+	uint64_t max_address;
+};
+
+DEFINE_VECTOR_TYPE(drgn_memory_range_vector, struct drgn_memory_range)
+
+/**
+ * Get the ranges of addresses covered by the segments of a @ref
+ * drgn_memory_reader that intersect a given range.
+ *
+ * Adjacent segments are merged into one range. This doesn't modify the reader.
+ *
+ * @param[in] min_address Start address of the range to intersect (inclusive).
+ * @param[in] max_address End address of the range to intersect (inclusive).
+ * @param[in] physical Whether to get physical memory segments.
+ * @param[out] ret Vector to append the ranges to in ascending order.
+ * @return @c true on success, @c false on failure to allocate memory.
+ */
+bool drgn_memory_reader_ranges(struct drgn_memory_reader *reader,
+			       uint64_t min_address, uint64_t max_address,
+			       bool physical,
+			       struct drgn_memory_range_vector *ret);
+
+/**
+ * Count a read of mapped memory borrowed from a @ref drgn_memory_reader.
+ *
+ * This may be called without holding the program lock.
+ */
+static inline void
+drgn_memory_reader_count_mapped_read(struct drgn_memory_reader *reader,
+				     size_t count)
+{
+	__atomic_fetch_add(&reader->segment_reads[DRGN_MEMORY_SEGMENT_FILE], 1,
+			   __ATOMIC_RELAXED);
+	__atomic_fetch_add(&reader->segment_read_bytes[DRGN_MEMORY_SEGMENT_FILE],
+			   count, __ATOMIC_RELAXED);
+}
+
+/**
+ * Freeze the segments of a @ref drgn_memory_reader.
+ *
+ * This compiles the segment trees into sorted arrays which are searched without
+ * modifying them. If caching is disabled, a frozen reader isn't modified by
+ * @ref drgn_memory_reader_read() or @ref drgn_memory_reader_borrow(), so they
+ * may be called from multiple threads at once. (Reads that are entirely
+ * contained in mapped memory never use the cache.)
+ *
+ * Adding a segment thaws the reader. Freezing an already frozen reader does
+ * nothing.
+ *
+ * @return @c true on success, @c false if memory couldn't be allocated, in which
+ * case the reader is left unfrozen.
+ */
+bool drgn_memory_reader_freeze(struct drgn_memory_reader *reader);
+
+/**
+ * Set the maximum number of bytes cached for each address space in a @ref
+ * drgn_memory_reader.
+ *
+ * @param[in] size Maximum size in bytes. Zero disables caching. If this is less
+ * than the current size, blocks are evicted.
+ */
+void drgn_memory_reader_set_cache_size(struct drgn_memory_reader *reader,
+				       size_t size);
+
+/** Discard all cached memory in a @ref drgn_memory_reader. */
+void drgn_memory_reader_invalidate_cache(struct drgn_memory_reader *reader);
+
+/**
+ * Discard cached memory in a range of addresses in a @ref drgn_memory_reader.
+ *
+ * Any cached block overlapping the range is discarded.
+ *
+ * @param[in] address Start address of the range.
+ * @param[in] size Size of the range in bytes.
+ * @param[in] physical Whether @p address is physical.
+ */
+void
+drgn_memory_reader_invalidate_cache_range(struct drgn_memory_reader *reader,
+					  uint64_t address, uint64_t size,
+					  bool physical);
+
 /**
  * Read from a @ref drgn_memory_reader.
  *
@@ -92,6 +294,88 @@ struct drgn_error *drgn_memory_reader_read(struct drgn_memory_reader *reader,
 					   void *buf, uint64_t address,
 					   size_t count, bool physical);
 
+/**
+ * Consecutive blocks being read into the cache of a @ref drgn_memory_reader by
+ * another thread.
+ */
+struct drgn_memory_prefetch {
+	/** Buffer to read into. */
+	char *buf;
+	/** Number of the first block. */
+	uint64_t number;
+	/** Number of blocks. */
+	uint64_t num_blocks;
+	/** @ref drgn_memory_reader::cache_generation when this was started. */
+	uint64_t generation;
+	/** Segment argument for @ref drgn_read_memory_file(). */
+	void *arg;
+	/** Offset of the first block in the segment. */
+	uint64_t offset;
+	/** Whether the blocks are physical. */
+	bool physical;
+};
+
+/**
+ * Start prefetching blocks into the cache of a @ref drgn_memory_reader.
+ *
+ * Only segments read by @ref drgn_read_memory_file() can be read without the
+ * caller's lock, so no other segments are prefetched. Mapped segments are
+ * passed to `madvise(MADV_WILLNEED)` instead of cached.
+ *
+ * This must be called with the lock protecting the reader held. After it
+ * returns @c true, the lock may be released to call @ref
+ * drgn_memory_prefetch_read(), then @ref drgn_memory_reader_prefetch_end()
+ * must be called with the lock held again.
+ *
+ * @param[in] number Number of the first block to prefetch.
+ * @param[in] last_number Number of the last block that may be prefetched.
+ * @param[in] physical Whether the blocks are physical.
+ * @param[out] ret Returned prefetch. @ref drgn_memory_prefetch::num_blocks is
+ * always set to the number of blocks that the caller should skip.
+ * @return @c true if the blocks need to be read, @c false if they are already
+ * cached or can't be prefetched.
+ */
+bool drgn_memory_reader_prefetch_begin(struct drgn_memory_reader *reader,
+				       uint64_t number, uint64_t last_number,
+				       bool physical,
+				       struct drgn_memory_prefetch *ret);
+
+/**
+ * Read the blocks of a @ref drgn_memory_prefetch. This doesn't access the
+ * reader, so it may be called without its lock.
+ */
+struct drgn_error *
+drgn_memory_prefetch_read(struct drgn_memory_prefetch *prefetch);
+
+/**
+ * Finish a @ref drgn_memory_prefetch, caching the blocks if they were read
+ * successfully and the cache wasn't invalidated in the meantime.
+ */
+void drgn_memory_reader_prefetch_end(struct drgn_memory_reader *reader,
+				     struct drgn_memory_prefetch *prefetch,
+				     bool success);
+
+/**
+ * Get a pointer directly to the contents of memory in a @ref
+ * drgn_memory_reader without copying it.
+ *
+ * This is only possible if the memory is entirely contained in a segment read by
+ * @ref drgn_read_memory_file() from a file that is mapped into memory (see @ref
+ * drgn_memory_file_segment::map). It bypasses the cache.
+ *
+ * @param[in] reader Memory reader.
+ * @param[in] address Starting address in memory.
+ * @param[in] count Number of bytes. Must be non-zero. `address + count - 1` must
+ * be `<= UINT64_MAX`
+ * @param[in] physical Whether @c address is physical.
+ * @return Borrowed pointer which is valid until the memory reader is
+ * deinitialized, or @c NULL if the memory must be read with @ref
+ * drgn_memory_reader_read() instead.
+ */
+const void *drgn_memory_reader_borrow(struct drgn_memory_reader *reader,
+				      uint64_t address, size_t count,
+				      bool physical);
+
 /** Argument for @ref drgn_read_memory_file(). */
 struct drgn_memory_file_segment {
 	/** Offset in the file where the segment starts. */
@@ -103,8 +387,25 @@ struct drgn_memory_file_segment {
 	 * to read these bytes is treated as a fault.
 	 */
 	uint64_t file_size;
+	/**
+	 * Contents of the segment in the file mapped into memory, or @c NULL if
+	 * the file should be read with `pread()`. If this is not @c NULL, it
+	 * must be valid for @ref file_size bytes.
+	 */
+	const char *map;
+	/**
+	 * Seekable zstd-compressed file to read the decompressed contents of
+	 * instead of @ref fd, or @c NULL.
+	 */
+	struct drgn_seekable_zstd *zstd;
 	/** File descriptor. */
 	int fd;
+	/**
+	 * If non-zero, read from the memory of this live process with
+	 * `process_vm_readv()`, falling back to @ref fd if that isn't
+	 * permitted.
+	 */
+	pid_t pid;
 	/**
 	 * If @c true, EIO is treated as a fault. Otherwise, it is treated as an
 	 * OS error.
@@ -117,6 +418,21 @@ struct drgn_error *drgn_read_memory_file(void *buf, uint64_t address,
 					 size_t count, uint64_t offset,
 					 void *arg, bool physical);
 
+/**
+ * Read from the memory of a live process with `process_vm_readv()`.
+ *
+ * This needs one system call for any amount of memory, and it doesn't fail
+ * if only part of the range is mapped.
+ *
+ * @param[out] ret Returned number of bytes read. This is less than @p count if
+ * the range is not entirely mapped.
+ * @return @c NULL on success, @ref drgn_not_found if `process_vm_readv()` is
+ * not available or not permitted, non-@c NULL on any other error.
+ */
+struct drgn_error *drgn_read_process_memory(pid_t pid, void *buf,
+					    uint64_t address, size_t count,
+					    size_t *ret);
+
 /** @} */
 
 #endif /* DRGN_MEMORY_READER_H */
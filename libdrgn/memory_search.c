@@ -0,0 +1,600 @@
+// Copyright (c) Meta Platforms, Inc. and affiliates.
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <byteswap.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "drgn.h"
+#include "error.h"
+#include "helpers.h"
+#include "memory_reader.h"
+#include "minmax.h"
+#include "openmp.h"
+#include "program.h"
+#include "util.h"
+#include "vector.h"
+
+/*
+ * Memory is searched in chunks of this many bytes (aligned to this size), which
+ * are distributed between threads.
+ */
+#define DRGN_MEMORY_SEARCH_CHUNK_SIZE (UINT64_C(1) << 20)
+/*
+ * If a chunk can't be read, it is read in pieces of this many bytes so that
+ * only the unreadable pieces are skipped.
+ */
+#define DRGN_MEMORY_SEARCH_PAGE_SIZE UINT64_C(4096)
+/* Number of bytes of words checked at once by the vectorized word search. */
+#define DRGN_MEMORY_SEARCH_BLOCK_SIZE 64
+
+DEFINE_VECTOR(drgn_memory_search_result_vector, uint64_t)
+DEFINE_VECTOR_FUNCTIONS(drgn_memory_range_vector)
+
+struct drgn_memory_search_state {
+	struct drgn_program *prog;
+	const struct drgn_memory_search *search;
+	/* Size of a match in bytes. */
+	size_t match_size;
+	uint64_t alignment;
+	/* Whether words need to be byte swapped. */
+	bool bswap;
+	/* Whether drgn_memory_search_block_may_match() can be used. */
+	bool use_blocks;
+	/* Ranges to search. */
+	struct drgn_memory_range_vector ranges;
+	/*
+	 * Index of the first chunk in each range, plus a final entry containing
+	 * the total number of chunks.
+	 */
+	uint64_t *range_chunks;
+};
+
+static inline uint64_t drgn_memory_search_load(const char *p,
+					       size_t word_size, bool bswap)
+{
+	switch (word_size) {
+	case 1:
+		return *(const uint8_t *)p;
+	case 2: {
+		uint16_t value;
+		memcpy(&value, p, sizeof(value));
+		return bswap ? bswap_16(value) : value;
+	}
+	case 4: {
+		uint32_t value;
+		memcpy(&value, p, sizeof(value));
+		return bswap ? bswap_32(value) : value;
+	}
+	case 8: {
+		uint64_t value;
+		memcpy(&value, p, sizeof(value));
+		return bswap ? bswap_64(value) : value;
+	}
+	default:
+		UNREACHABLE();
+	}
+}
+
+/*
+ * Return whether any of the native-endian words in the block of
+ * DRGN_MEMORY_SEARCH_BLOCK_SIZE bytes at p may be in [min_value, min_value +
+ * span]. Most blocks don't contain a match, so this compares all of the words
+ * in a block at once and only returns true if one of them matched (or if there
+ * is no vectorized implementation). For 4-byte words, min_value + span must be
+ * <= UINT32_MAX.
+ */
+static inline bool drgn_memory_search_block_may_match(const char *p,
+						      size_t word_size,
+						      uint64_t min_value,
+						      uint64_t span)
+{
+#if defined(__SSE2__)
+	/*
+	 * SSE doesn't have unsigned comparisons, so flip the sign bits and use
+	 * signed comparisons. No lanes being greater than the span means no
+	 * matches.
+	 */
+	__m128i greater = _mm_set1_epi32(-1);
+	if (word_size == 4) {
+		const __m128i sign = _mm_set1_epi32(INT32_MIN);
+		const __m128i min_vec = _mm_set1_epi32(min_value);
+		const __m128i span_vec = _mm_xor_si128(_mm_set1_epi32(span),
+						       sign);
+		for (int i = 0; i < DRGN_MEMORY_SEARCH_BLOCK_SIZE; i += 16) {
+			__m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+			v = _mm_xor_si128(_mm_sub_epi32(v, min_vec), sign);
+			greater = _mm_and_si128(greater,
+						_mm_cmpgt_epi32(v, span_vec));
+		}
+	} else {
+#ifdef __SSE4_2__
+		const __m128i sign = _mm_set1_epi64x(INT64_MIN);
+		const __m128i min_vec = _mm_set1_epi64x(min_value);
+		const __m128i span_vec = _mm_xor_si128(_mm_set1_epi64x(span),
+						       sign);
+		for (int i = 0; i < DRGN_MEMORY_SEARCH_BLOCK_SIZE; i += 16) {
+			__m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+			v = _mm_xor_si128(_mm_sub_epi64(v, min_vec), sign);
+			greater = _mm_and_si128(greater,
+						_mm_cmpgt_epi64(v, span_vec));
+		}
+#else
+		/* SSE2 doesn't have 64-bit comparisons. */
+		return true;
+#endif
+	}
+	return _mm_movemask_epi8(greater) != 0xffff;
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+	uint32x4_t match = vdupq_n_u32(0);
+	if (word_size == 4) {
+		const uint32x4_t min_vec = vdupq_n_u32(min_value);
+		const uint32x4_t span_vec = vdupq_n_u32(span);
+		for (int i = 0; i < DRGN_MEMORY_SEARCH_BLOCK_SIZE; i += 16) {
+			uint32x4_t v = vld1q_u32((const uint32_t *)(p + i));
+			match = vorrq_u32(match,
+					  vcleq_u32(vsubq_u32(v, min_vec),
+						    span_vec));
+		}
+	} else {
+		const uint64x2_t min_vec = vdupq_n_u64(min_value);
+		const uint64x2_t span_vec = vdupq_n_u64(span);
+		for (int i = 0; i < DRGN_MEMORY_SEARCH_BLOCK_SIZE; i += 16) {
+			uint64x2_t v = vld1q_u64((const uint64_t *)(p + i));
+			uint64x2_t le = vcleq_u64(vsubq_u64(v, min_vec),
+						  span_vec);
+			match = vorrq_u32(match, vreinterpretq_u32_u64(le));
+		}
+	}
+	return vmaxvq_u32(match) != 0;
+#else
+	return true;
+#endif
+}
+
+/*
+ * Find the matching words starting at aligned offsets in [offset, end) of a
+ * buffer of len bytes read from address.
+ */
+static bool
+drgn_memory_search_words(struct drgn_memory_search_state *state,
+			 const char *buf, size_t offset, size_t end,
+			 size_t len, uint64_t address,
+			 struct drgn_memory_search_result_vector *results)
+{
+	size_t word_size = state->search->word_size;
+	uint64_t min_value = state->search->min_value;
+	/* value is in range iff value - min_value <= span (unsigned). */
+	uint64_t span = state->search->max_value - min_value;
+
+	while (offset < end && len - offset >= word_size) {
+		size_t block_end = end;
+		if (state->use_blocks &&
+		    end - offset >= DRGN_MEMORY_SEARCH_BLOCK_SIZE &&
+		    len - offset >= DRGN_MEMORY_SEARCH_BLOCK_SIZE) {
+			if (!drgn_memory_search_block_may_match(buf + offset,
+								word_size,
+								min_value,
+								span)) {
+				offset += DRGN_MEMORY_SEARCH_BLOCK_SIZE;
+				continue;
+			}
+			block_end = offset + DRGN_MEMORY_SEARCH_BLOCK_SIZE;
+		}
+		while (offset < block_end && len - offset >= word_size) {
+			uint64_t value = drgn_memory_search_load(buf + offset,
+								 word_size,
+								 state->bswap);
+			uint64_t match = address + offset;
+			if (value - min_value <= span &&
+			    !drgn_memory_search_result_vector_append(results,
+								     &match))
+				return false;
+			if (state->alignment >= block_end - offset) {
+				offset = block_end;
+				break;
+			}
+			offset += state->alignment;
+		}
+	}
+	return true;
+}
+
+/*
+ * Find the occurrences of the pattern starting at aligned offsets in [offset,
+ * end) of a buffer of len bytes read from address.
+ */
+static bool
+drgn_memory_search_pattern(struct drgn_memory_search_state *state,
+			   const char *buf, size_t offset, size_t end,
+			   size_t len, uint64_t address,
+			   struct drgn_memory_search_result_vector *results)
+{
+	const char *pattern = state->search->pattern;
+	size_t size = state->search->pattern_size;
+	uint64_t alignment = state->alignment;
+
+	while (offset < end && len - offset >= size) {
+		const char *p;
+		if (alignment == 1) {
+			size_t search_end = min(len, end - 1 + size);
+			p = memmem(buf + offset, search_end - offset, pattern,
+				   size);
+		} else if (alignment >= 8) {
+			/* Aligned offsets are sparse enough to compare each. */
+			uint64_t match = address + offset;
+			if (memcmp(buf + offset, pattern, size) == 0 &&
+			    !drgn_memory_search_result_vector_append(results,
+								     &match))
+				return false;
+			if (alignment >= end - offset)
+				break;
+			offset += alignment;
+			continue;
+		} else {
+			p = memchr(buf + offset, pattern[0], end - offset);
+			if (p && (address + (p - buf)) & (alignment - 1)) {
+				/* Skip to the next aligned offset. */
+				offset = (p - buf) + 1;
+				offset += -(address + offset) & (alignment - 1);
+				continue;
+			}
+			if (p && (len - (p - buf) < size ||
+				  memcmp(p, pattern, size) != 0)) {
+				offset = (p - buf) + alignment;
+				continue;
+			}
+		}
+		if (!p)
+			break;
+		uint64_t match = address + (p - buf);
+		if (!drgn_memory_search_result_vector_append(results, &match))
+			return false;
+		offset = (p - buf) + alignment;
+	}
+	return true;
+}
+
+/*
+ * Search for matches starting in [min_address, max_address], which is part of
+ * a range ending at range_max.
+ */
+static struct drgn_error *
+drgn_memory_search_block(struct drgn_memory_search_state *state,
+			 uint64_t min_address, uint64_t max_address,
+			 uint64_t range_max, char *buf,
+			 struct drgn_memory_search_result_vector *results)
+{
+	struct drgn_error *err;
+	bool physical = state->search->physical;
+
+	/* Read enough past the block to find matches that start in it. */
+	uint64_t extra = min((uint64_t)state->match_size - 1,
+			     range_max - max_address);
+	size_t end = max_address - min_address + 1;
+	size_t len = end + extra;
+	err = drgn_program_read_memory(state->prog, buf, min_address, len,
+				       physical);
+	if (err && err->code == DRGN_ERROR_FAULT) {
+		drgn_error_destroy(err);
+		if (max_address - min_address >= DRGN_MEMORY_SEARCH_PAGE_SIZE) {
+			/* Search the readable pages of the block. */
+			const uint64_t page_mask =
+				DRGN_MEMORY_SEARCH_PAGE_SIZE - 1;
+			uint64_t page = min_address;
+			for (;;) {
+				uint64_t page_max = min(page | page_mask,
+							max_address);
+				err = drgn_memory_search_block(state, page,
+							       page_max,
+							       range_max, buf,
+							       results);
+				if (err || page_max == max_address)
+					return err;
+				page = page_max + 1;
+			}
+		}
+		if (extra == 0)
+			return NULL;
+		/*
+		 * The block is readable but the memory after it isn't, so
+		 * matches can't cross the end of the block anyways.
+		 */
+		len = end;
+		err = drgn_program_read_memory(state->prog, buf, min_address,
+					       len, physical);
+		if (err && err->code == DRGN_ERROR_FAULT) {
+			drgn_error_destroy(err);
+			return NULL;
+		}
+	}
+	if (err)
+		return err;
+
+	size_t offset = -min_address & (state->alignment - 1);
+	bool ok;
+	if (state->search->pattern) {
+		ok = drgn_memory_search_pattern(state, buf, offset, end, len,
+						min_address, results);
+	} else {
+		ok = drgn_memory_search_words(state, buf, offset, end, len,
+					      min_address, results);
+	}
+	return ok ? NULL : &drgn_enomem;
+}
+
+static struct drgn_error *
+drgn_memory_search_page_ranges(struct drgn_memory_search_state *state)
+{
+	struct drgn_error *err;
+	struct drgn_program *prog = state->prog;
+	const struct drgn_memory_search *search = state->search;
+
+	uint64_t page_size = prog->vmcoreinfo.page_size;
+	if (!page_size) {
+		return drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+					 "kernel page size is not known");
+	}
+	struct linux_helper_page_filter filter = {
+		.flags_mask = search->page_flags_mask,
+		.flags_value = search->page_flags_value,
+	};
+	uint64_t *pfns;
+	size_t num_pfns;
+	err = linux_helper_find_pages(prog, &filter, &pfns, &num_pfns);
+	if (err)
+		return err;
+	struct drgn_memory_range *last = NULL;
+	for (size_t i = 0; i < num_pfns; i++) {
+		if (pfns[i] > UINT64_MAX / page_size)
+			break;
+		uint64_t page_min = max(pfns[i] * page_size,
+					search->min_address);
+		uint64_t page_max = min(pfns[i] * page_size + (page_size - 1),
+					search->max_address);
+		if (page_min > page_max)
+			continue;
+		if (last && last->max_address + 1 == page_min) {
+			last->max_address = page_max;
+			continue;
+		}
+		last = drgn_memory_range_vector_append_entry(&state->ranges);
+		if (!last) {
+			err = &drgn_enomem;
+			break;
+		}
+		last->min_address = page_min;
+		last->max_address = page_max;
+	}
+	free(pfns);
+	return err;
+}
+
+static int drgn_memory_search_result_cmp(const void *_a, const void *_b)
+{
+	uint64_t a = *(const uint64_t *)_a;
+	uint64_t b = *(const uint64_t *)_b;
+	return (a > b) - (a < b);
+}
+
+static struct drgn_error *
+drgn_memory_search_check(struct drgn_program *prog,
+			 const struct drgn_memory_search *search)
+{
+	if (!prog->has_platform) {
+		return drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+					 "program byte order is not known");
+	}
+	if (search->pattern) {
+		if (search->pattern_size == 0) {
+			return drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+						 "pattern is empty");
+		}
+	} else {
+		if (search->word_size != 1 && search->word_size != 2 &&
+		    search->word_size != 4 && search->word_size != 8) {
+			return drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+						 "invalid word size");
+		}
+		if (search->min_value > search->max_value) {
+			return drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+						 "invalid value range");
+		}
+	}
+	if (search->alignment & (search->alignment - 1)) {
+		return drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+					 "alignment must be a power of two");
+	}
+	if (search->page_flags_mask) {
+		if (!(prog->flags & DRGN_PROGRAM_IS_LINUX_KERNEL)) {
+			return drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+						 "page flags require Linux kernel");
+		}
+		if (!search->physical) {
+			return drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+						 "page flags require physical search");
+		}
+	}
+	return NULL;
+}
+
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_program_search_memory(struct drgn_program *prog,
+			   const struct drgn_memory_search *search,
+			   uint64_t **addresses_ret, size_t *num_addresses_ret)
+{
+	struct drgn_error *err;
+
+	err = drgn_memory_search_check(prog, search);
+	if (err)
+		return err;
+
+	struct drgn_memory_search_state state = {
+		.prog = prog,
+		.search = search,
+		.ranges = VECTOR_INIT,
+	};
+	if (search->pattern) {
+		state.match_size = search->pattern_size;
+		state.alignment = search->alignment ? search->alignment : 1;
+	} else {
+		state.match_size = search->word_size;
+		state.alignment = (search->alignment ?
+				   search->alignment : search->word_size);
+	}
+	state.bswap = drgn_platform_bswap(&prog->platform);
+	state.use_blocks = (!state.bswap &&
+			    state.alignment == search->word_size &&
+			    (search->word_size == 8 ||
+			     (search->word_size == 4 &&
+			      search->max_value <= UINT32_MAX)));
+
+	uint64_t address_mask;
+	err = drgn_program_address_mask(prog, &address_mask);
+	if (err)
+		return err;
+	uint64_t max_address = min(search->max_address, address_mask);
+	if (search->min_address > max_address) {
+		*addresses_ret = NULL;
+		*num_addresses_ret = 0;
+		return NULL;
+	}
+	if (search->page_flags_mask) {
+		err = drgn_memory_search_page_ranges(&state);
+		if (err)
+			goto out_ranges;
+	} else {
+		drgn_program_lock(prog);
+		bool ok = drgn_memory_reader_ranges(&prog->reader,
+						    search->min_address,
+						    max_address,
+						    search->physical,
+						    &state.ranges);
+		drgn_program_unlock(prog);
+		if (!ok) {
+			err = &drgn_enomem;
+			goto out_ranges;
+		}
+	}
+
+	state.range_chunks = malloc_array(state.ranges.size + 1,
+					  sizeof(state.range_chunks[0]));
+	if (!state.range_chunks) {
+		err = &drgn_enomem;
+		goto out_ranges;
+	}
+	state.range_chunks[0] = 0;
+	for (size_t i = 0; i < state.ranges.size; i++) {
+		const struct drgn_memory_range *range = &state.ranges.data[i];
+		state.range_chunks[i + 1] =
+			state.range_chunks[i] +
+			range->max_address / DRGN_MEMORY_SEARCH_CHUNK_SIZE -
+			range->min_address / DRGN_MEMORY_SEARCH_CHUNK_SIZE + 1;
+	}
+	uint64_t num_chunks = state.range_chunks[state.ranges.size];
+
+	int num_threads = drgn_program_num_parallel_threads(prog);
+	struct drgn_memory_search_result_vector *results =
+		malloc_array(num_threads, sizeof(results[0]));
+	if (!results) {
+		err = &drgn_enomem;
+		goto out_range_chunks;
+	}
+	for (int i = 0; i < num_threads; i++)
+		drgn_memory_search_result_vector_init(&results[i]);
+
+	err = NULL;
+	/* Chunks are independent, so search them in parallel. */
+	#pragma omp parallel num_threads(num_threads)
+	{
+		drgn_program_bind_parallel_thread(prog);
+		struct drgn_memory_search_result_vector *thread_results =
+			&results[omp_get_thread_num()];
+		char *buf = malloc(DRGN_MEMORY_SEARCH_CHUNK_SIZE +
+				   state.match_size - 1);
+		if (!buf) {
+			#pragma omp critical(drgn_program_search_memory_error)
+			if (!err)
+				err = &drgn_enomem;
+		}
+		#pragma omp for schedule(dynamic)
+		for (uint64_t i = 0; i < num_chunks; i++) {
+			if (err)
+				continue;
+			/* Find the range containing this chunk. */
+			size_t lo = 0, hi = state.ranges.size;
+			while (hi - lo > 1) {
+				size_t mid = lo + (hi - lo) / 2;
+				if (state.range_chunks[mid] <= i)
+					lo = mid;
+				else
+					hi = mid;
+			}
+			const struct drgn_memory_range *range =
+				&state.ranges.data[lo];
+			uint64_t chunk_address =
+				(range->min_address /
+				 DRGN_MEMORY_SEARCH_CHUNK_SIZE +
+				 (i - state.range_chunks[lo])) *
+				DRGN_MEMORY_SEARCH_CHUNK_SIZE;
+			uint64_t chunk_min = max(chunk_address,
+						 range->min_address);
+			uint64_t chunk_max =
+				min(chunk_address +
+				    (DRGN_MEMORY_SEARCH_CHUNK_SIZE - 1),
+				    range->max_address);
+			struct drgn_error *chunk_err =
+				drgn_memory_search_block(&state, chunk_min,
+							 chunk_max,
+							 range->max_address,
+							 buf, thread_results);
+			if (chunk_err) {
+				#pragma omp critical(drgn_program_search_memory_error)
+				if (err)
+					drgn_error_destroy(chunk_err);
+				else
+					err = chunk_err;
+			}
+		}
+		free(buf);
+	}
+
+	if (!err) {
+		size_t num_addresses = 0;
+		for (int i = 0; i < num_threads; i++)
+			num_addresses += results[i].size;
+		uint64_t *addresses = malloc_array(num_addresses,
+						   sizeof(addresses[0]));
+		if (addresses || !num_addresses) {
+			size_t n = 0;
+			for (int i = 0; i < num_threads; i++) {
+				if (!results[i].size)
+					continue;
+				memcpy(addresses + n, results[i].data,
+				       results[i].size * sizeof(addresses[0]));
+				n += results[i].size;
+			}
+			qsort(addresses, num_addresses, sizeof(addresses[0]),
+			      drgn_memory_search_result_cmp);
+			*addresses_ret = addresses;
+			*num_addresses_ret = num_addresses;
+		} else {
+			err = &drgn_enomem;
+		}
+	}
+	for (int i = 0; i < num_threads; i++)
+		drgn_memory_search_result_vector_deinit(&results[i]);
+	free(results);
+out_range_chunks:
+	free(state.range_chunks);
+out_ranges:
+	drgn_memory_range_vector_deinit(&state.ranges);
+	return err;
+}
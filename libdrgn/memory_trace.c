@@ -0,0 +1,815 @@
+// Copyright (c) Meta Platforms, Inc. and affiliates.
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <elf.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <gelf.h>
+#include <inttypes.h>
+#include <libelf.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "drgn.h"
+#include "error.h"
+#include "hash_table.h"
+#include "minmax.h"
+#include "object.h"
+#include "platform.h"
+#include "program.h"
+#include "string_builder.h"
+#include "util.h"
+#include "vector.h"
+
+DEFINE_HASH_SET(drgn_memory_trace_page_set, uint64_t, int_key_hash_pair,
+		scalar_key_eq)
+
+DEFINE_VECTOR(gelf_phdr_vector, GElf_Phdr)
+
+/* Maximum number of pages to read from the program at once. */
+#define DRGN_MEMORY_TRACE_CHUNK_PAGES 256
+
+struct drgn_memory_trace {
+	pthread_mutex_t lock;
+	/*
+	 * Page numbers (address / DRGN_MEMORY_TRACE_PAGE_SIZE) read, indexed by
+	 * whether the reads were physical.
+	 */
+	struct drgn_memory_trace_page_set pages[2];
+	/* Whether we failed to allocate memory while recording a page. */
+	bool oom;
+};
+
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_memory_trace_create(struct drgn_memory_trace **ret)
+{
+	struct drgn_memory_trace *trace = malloc(sizeof(*trace));
+	if (!trace)
+		return &drgn_enomem;
+	pthread_mutex_init(&trace->lock, NULL);
+	drgn_memory_trace_page_set_init(&trace->pages[0]);
+	drgn_memory_trace_page_set_init(&trace->pages[1]);
+	trace->oom = false;
+	*ret = trace;
+	return NULL;
+}
+
+LIBDRGN_PUBLIC void drgn_memory_trace_destroy(struct drgn_memory_trace *trace)
+{
+	if (trace) {
+		drgn_memory_trace_page_set_deinit(&trace->pages[1]);
+		drgn_memory_trace_page_set_deinit(&trace->pages[0]);
+		pthread_mutex_destroy(&trace->lock);
+		free(trace);
+	}
+}
+
+LIBDRGN_PUBLIC void drgn_memory_trace_record(uint64_t address, size_t count,
+					     bool physical, void *arg)
+{
+	struct drgn_memory_trace *trace = arg;
+	if (count == 0)
+		return;
+	uint64_t page = address / DRGN_MEMORY_TRACE_PAGE_SIZE;
+	/* Reads that wrap around are recorded up to the end of memory. */
+	uint64_t last_page = (count - 1 > UINT64_MAX - address ?
+			      UINT64_MAX : address + (count - 1))
+			     / DRGN_MEMORY_TRACE_PAGE_SIZE;
+	pthread_mutex_lock(&trace->lock);
+	for (;;) {
+		if (drgn_memory_trace_page_set_insert(&trace->pages[physical],
+						      &page, NULL) < 0) {
+			trace->oom = true;
+			break;
+		}
+		if (page == last_page)
+			break;
+		page++;
+	}
+	pthread_mutex_unlock(&trace->lock);
+}
+
+LIBDRGN_PUBLIC size_t
+drgn_memory_trace_num_pages(struct drgn_memory_trace *trace)
+{
+	pthread_mutex_lock(&trace->lock);
+	size_t ret = (drgn_memory_trace_page_set_size(&trace->pages[0]) +
+		      drgn_memory_trace_page_set_size(&trace->pages[1]));
+	pthread_mutex_unlock(&trace->lock);
+	return ret;
+}
+
+struct drgn_memory_trace_object_key {
+	uint64_t address;
+	struct drgn_type *type;
+};
+
+static struct hash_pair drgn_memory_trace_object_key_hash_pair(
+	const struct drgn_memory_trace_object_key *key)
+{
+	return hash_pair_from_non_avalanching_hash(
+		hash_combine(key->address, (uintptr_t)key->type));
+}
+
+static bool
+drgn_memory_trace_object_key_eq(const struct drgn_memory_trace_object_key *a,
+				const struct drgn_memory_trace_object_key *b)
+{
+	return a->address == b->address && a->type == b->type;
+}
+
+/* Map from object visited by drgn_memory_trace_add_object() to its depth. */
+DEFINE_HASH_MAP(drgn_memory_trace_object_map,
+		struct drgn_memory_trace_object_key, uint64_t,
+		drgn_memory_trace_object_key_hash_pair,
+		drgn_memory_trace_object_key_eq)
+
+struct drgn_memory_trace_walk {
+	struct drgn_memory_trace *trace;
+	struct drgn_program *prog;
+	const char * const *members;
+	size_t num_members;
+	struct drgn_memory_trace_object_map visited;
+};
+
+static bool drgn_memory_trace_walk_follows(struct drgn_memory_trace_walk *walk,
+					   const char *name)
+{
+	if (!name)
+		return false;
+	if (walk->num_members == 0)
+		return true;
+	for (size_t i = 0; i < walk->num_members; i++) {
+		if (strcmp(walk->members[i], name) == 0)
+			return true;
+	}
+	return false;
+}
+
+static struct drgn_error *
+drgn_memory_trace_walk_object(struct drgn_memory_trace_walk *walk,
+			      struct drgn_type *type, uint64_t address,
+			      uint64_t depth);
+
+static struct drgn_error *
+drgn_memory_trace_walk_pointer(struct drgn_memory_trace_walk *walk,
+			       struct drgn_qualified_type qualified_type,
+			       uint64_t address, uint64_t depth)
+{
+	struct drgn_error *err;
+	struct drgn_object ptr;
+	drgn_object_init(&ptr, walk->prog);
+	uint64_t value;
+	err = drgn_object_set_reference(&ptr, qualified_type, address, 0, 0);
+	if (!err)
+		err = drgn_object_read_unsigned(&ptr, &value);
+	drgn_object_deinit(&ptr);
+	if (err) {
+		/* Skip pointers that can't be read. */
+		if (err->code == DRGN_ERROR_FAULT) {
+			drgn_error_destroy(err);
+			return NULL;
+		}
+		return err;
+	}
+	if (!value)
+		return NULL;
+	struct drgn_type *referenced_type =
+		drgn_type_type(drgn_underlying_type(qualified_type.type)).type;
+	return drgn_memory_trace_walk_object(walk, referenced_type, value,
+					     depth - 1);
+}
+
+/* Follow the pointer members of a structure, union, or class. */
+static struct drgn_error *
+drgn_memory_trace_walk_members(struct drgn_memory_trace_walk *walk,
+			       struct drgn_type *type, uint64_t address,
+			       uint64_t depth)
+{
+	struct drgn_error *err;
+	struct drgn_type_member *members = drgn_type_members(type);
+	size_t num_members = drgn_type_num_members(type);
+	for (size_t i = 0; i < num_members; i++) {
+		struct drgn_qualified_type member_type;
+		uint64_t bit_field_size;
+		err = drgn_member_type(&members[i], &member_type,
+				       &bit_field_size);
+		if (err)
+			return err;
+		if (bit_field_size || members[i].bit_offset % 8)
+			continue;
+		uint64_t member_address = address + members[i].bit_offset / 8;
+		struct drgn_type *underlying_type =
+			drgn_underlying_type(member_type.type);
+		if (drgn_type_has_members(underlying_type)) {
+			err = drgn_memory_trace_walk_members(walk,
+							     underlying_type,
+							     member_address,
+							     depth);
+		} else if (drgn_type_kind(underlying_type)
+			   == DRGN_TYPE_POINTER &&
+			   drgn_memory_trace_walk_follows(walk,
+							 members[i].name)) {
+			err = drgn_memory_trace_walk_pointer(walk, member_type,
+							     member_address,
+							     depth);
+		} else {
+			err = NULL;
+		}
+		if (err)
+			return err;
+	}
+	return NULL;
+}
+
+static struct drgn_error *
+drgn_memory_trace_walk_object(struct drgn_memory_trace_walk *walk,
+			      struct drgn_type *type, uint64_t address,
+			      uint64_t depth)
+{
+	struct drgn_error *err;
+
+	type = drgn_underlying_type(type);
+	/* Pointers to void, incomplete types, and functions aren't followed. */
+	if (!drgn_type_is_complete(type) ||
+	    drgn_type_kind(type) == DRGN_TYPE_FUNCTION)
+		return NULL;
+
+	/* Don't revisit an object unless we can now go deeper. */
+	struct drgn_memory_trace_object_map_entry entry = {
+		.key = { .address = address, .type = type },
+		.value = depth,
+	};
+	struct drgn_memory_trace_object_map_iterator it;
+	int r = drgn_memory_trace_object_map_insert(&walk->visited, &entry,
+						    &it);
+	if (r < 0)
+		return &drgn_enomem;
+	if (r == 0) {
+		if (it.entry->value >= depth)
+			return NULL;
+		it.entry->value = depth;
+	}
+
+	uint64_t size;
+	err = drgn_type_sizeof(type, &size);
+	if (err)
+		return err;
+	if (size > 0) {
+		drgn_memory_trace_record(address, min(size, (uint64_t)SIZE_MAX),
+					 false, walk->trace);
+	}
+	if (depth == 0 || !drgn_type_has_members(type))
+		return NULL;
+	return drgn_memory_trace_walk_members(walk, type, address, depth);
+}
+
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_memory_trace_add_object(struct drgn_memory_trace *trace,
+			     const struct drgn_object *obj,
+			     const char * const *members, size_t num_members,
+			     uint64_t depth)
+{
+	struct drgn_error *err;
+	struct drgn_memory_trace_walk walk = {
+		.trace = trace,
+		.prog = drgn_object_program(obj),
+		.members = members,
+		.num_members = num_members,
+	};
+	drgn_memory_trace_object_map_init(&walk.visited);
+	struct drgn_type *underlying_type = drgn_underlying_type(obj->type);
+	if (obj->kind == DRGN_OBJECT_REFERENCE) {
+		err = drgn_memory_trace_walk_object(&walk, obj->type,
+						    obj->address, depth);
+	} else if (drgn_type_kind(underlying_type) == DRGN_TYPE_POINTER) {
+		/* Record what a pointer value points to. */
+		struct drgn_type *referenced_type =
+			drgn_type_type(underlying_type).type;
+		uint64_t value;
+		err = drgn_object_read_unsigned(obj, &value);
+		if (!err && value) {
+			err = drgn_memory_trace_walk_object(&walk,
+							    referenced_type,
+							    value, depth);
+		}
+	} else {
+		err = drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+					"object must be reference or pointer");
+	}
+	drgn_memory_trace_object_map_deinit(&walk.visited);
+	return err;
+}
+
+struct core_writer {
+	const char *path;
+	int fd;
+	/* Offset of the end of the file written so far. */
+	uint64_t offset;
+	bool is_64_bit;
+	/* ELFDATA2LSB or ELFDATA2MSB. */
+	unsigned char ei_data;
+	struct gelf_phdr_vector phdrs;
+	/* PT_LOAD segment being extended by core_writer_add_pages(), if any. */
+	GElf_Phdr *load;
+};
+
+static struct drgn_error *core_writer_pwrite(struct core_writer *writer,
+					     const void *buf, size_t size,
+					     uint64_t offset)
+{
+	const char *p = buf;
+	while (size > 0) {
+		ssize_t ret = pwrite(writer->fd, p, size, offset);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return drgn_error_create_os("pwrite", errno,
+						    writer->path);
+		}
+		p += ret;
+		size -= ret;
+		offset += ret;
+	}
+	return NULL;
+}
+
+/* Append to the end of the file. */
+static struct drgn_error *core_writer_append(struct core_writer *writer,
+					     const void *buf, size_t size)
+{
+	struct drgn_error *err = core_writer_pwrite(writer, buf, size,
+						    writer->offset);
+	if (err)
+		return err;
+	writer->offset += size;
+	return NULL;
+}
+
+/* Pad the end of the file with zeroes to a multiple of @p align. */
+static struct drgn_error *core_writer_align(struct core_writer *writer,
+					    uint64_t align)
+{
+	static const char zeroes[DRGN_MEMORY_TRACE_PAGE_SIZE];
+	uint64_t padding = -writer->offset & (align - 1);
+	return core_writer_append(writer, zeroes, padding);
+}
+
+/*
+ * Convert ELF structures from the host representation to the file
+ * representation and write them.
+ */
+static struct drgn_error *core_writer_pwrite_xlated(struct core_writer *writer,
+						    Elf_Type type,
+						    void *buf, size_t size,
+						    uint64_t offset)
+{
+	struct drgn_error *err;
+	void *file_buf = malloc(size);
+	if (!file_buf)
+		return &drgn_enomem;
+	Elf_Data dst = {
+		.d_buf = file_buf,
+		.d_type = type,
+		.d_size = size,
+		.d_version = EV_CURRENT,
+	};
+	Elf_Data src = dst;
+	src.d_buf = buf;
+	if (writer->is_64_bit ?
+	    elf64_xlatetof(&dst, &src, writer->ei_data) :
+	    elf32_xlatetof(&dst, &src, writer->ei_data))
+		err = core_writer_pwrite(writer, file_buf, dst.d_size, offset);
+	else
+		err = drgn_error_libelf();
+	free(file_buf);
+	return err;
+}
+
+static struct drgn_error *core_writer_add_note(struct core_writer *writer,
+					       const char *name,
+					       uint32_t type, const void *desc,
+					       size_t descsz)
+{
+	struct drgn_error *err;
+	/* Elf32_Nhdr and Elf64_Nhdr are identical. */
+	Elf32_Nhdr nhdr = {
+		.n_namesz = strlen(name) + 1,
+		.n_descsz = descsz,
+		.n_type = type,
+	};
+	uint64_t start = writer->offset;
+	err = core_writer_pwrite_xlated(writer, ELF_T_NHDR, &nhdr, sizeof(nhdr),
+					writer->offset);
+	if (err)
+		return err;
+	writer->offset += sizeof(nhdr);
+	if ((err = core_writer_append(writer, name, nhdr.n_namesz)) ||
+	    (err = core_writer_align(writer, 4)) ||
+	    (err = core_writer_append(writer, desc, descsz)) ||
+	    (err = core_writer_align(writer, 4)))
+		return err;
+
+	GElf_Phdr *phdr = gelf_phdr_vector_append_entry(&writer->phdrs);
+	if (!phdr)
+		return &drgn_enomem;
+	*phdr = (GElf_Phdr){
+		.p_type = PT_NOTE,
+		.p_offset = start,
+		.p_filesz = writer->offset - start,
+		.p_align = 4,
+	};
+	return NULL;
+}
+
+static struct drgn_error *core_writer_add_notes(struct core_writer *writer,
+						struct drgn_program *prog)
+{
+	struct drgn_error *err;
+
+	if (prog->core) {
+		/* Copy the notes from the original core dump verbatim. */
+		size_t phnum;
+		if (elf_getphdrnum(prog->core, &phnum) != 0)
+			return drgn_error_libelf();
+		for (size_t i = 0; i < phnum; i++) {
+			GElf_Phdr phdr_mem, *phdr;
+			phdr = gelf_getphdr(prog->core, i, &phdr_mem);
+			if (!phdr)
+				return drgn_error_libelf();
+			if (phdr->p_type != PT_NOTE)
+				continue;
+			Elf_Data *data = elf_getdata_rawchunk(prog->core,
+							      phdr->p_offset,
+							      phdr->p_filesz,
+							      ELF_T_BYTE);
+			if (!data)
+				return drgn_error_libelf();
+			uint64_t align = phdr->p_align == 8 ? 8 : 4;
+			err = core_writer_align(writer, align);
+			if (err)
+				return err;
+			uint64_t start = writer->offset;
+			err = core_writer_append(writer, data->d_buf,
+						 data->d_size);
+			if (err)
+				return err;
+			GElf_Phdr *new_phdr =
+				gelf_phdr_vector_append_entry(&writer->phdrs);
+			if (!new_phdr)
+				return &drgn_enomem;
+			*new_phdr = (GElf_Phdr){
+				.p_type = PT_NOTE,
+				.p_offset = start,
+				.p_filesz = data->d_size,
+				.p_align = align,
+			};
+		}
+		return NULL;
+	} else if (prog->flags & DRGN_PROGRAM_IS_LINUX_KERNEL) {
+		/*
+		 * Synthesize the parts of VMCOREINFO that
+		 * drgn_program_set_core_dump() needs to recognize the kernel.
+		 */
+		const struct vmcoreinfo *vmcoreinfo = &prog->vmcoreinfo;
+		struct string_builder sb = {};
+		if (!string_builder_appendf(&sb,
+				"OSRELEASE=%s\n"
+				"PAGESIZE=%" PRIu64 "\n"
+				"KERNELOFFSET=%" PRIx64 "\n"
+				"SYMBOL(swapper_pg_dir)=%" PRIx64 "\n"
+				"NUMBER(pgtable_l5_enabled)=%d\n",
+				vmcoreinfo->osrelease, vmcoreinfo->page_size,
+				vmcoreinfo->kaslr_offset,
+				vmcoreinfo->swapper_pg_dir,
+				(int)vmcoreinfo->pgtable_l5_enabled) ||
+		    (vmcoreinfo->va_bits &&
+		     !string_builder_appendf(&sb,
+					     "NUMBER(VA_BITS)=%" PRIu64 "\n",
+					     vmcoreinfo->va_bits)) ||
+		    (vmcoreinfo->kernel_image_size &&
+		     !string_builder_appendf(&sb,
+					     "NUMBER(phys_base)=%" PRIu64 "\n"
+					     "NUMBER(KERNEL_IMAGE_SIZE)=%" PRIu64 "\n",
+					     vmcoreinfo->phys_base,
+					     vmcoreinfo->kernel_image_size))) {
+			free(sb.str);
+			return &drgn_enomem;
+		}
+		err = core_writer_add_note(writer, "VMCOREINFO", 0, sb.str,
+					   sb.len);
+		free(sb.str);
+		return err;
+	} else {
+		return NULL;
+	}
+}
+
+/* Append pages to the file and to the current PT_LOAD segment. */
+static struct drgn_error *core_writer_add_pages(struct core_writer *writer,
+						uint64_t page,
+						size_t num_pages,
+						const void *buf, bool physical)
+{
+	struct drgn_error *err;
+	uint64_t address = page * DRGN_MEMORY_TRACE_PAGE_SIZE;
+	uint64_t size = num_pages * DRGN_MEMORY_TRACE_PAGE_SIZE;
+	if (!writer->load ||
+	    (physical ? writer->load->p_paddr : writer->load->p_vaddr)
+	    + writer->load->p_memsz != address) {
+		GElf_Phdr *phdr = gelf_phdr_vector_append_entry(&writer->phdrs);
+		if (!phdr)
+			return &drgn_enomem;
+		uint64_t no_address = (writer->is_64_bit ?
+				       UINT64_MAX : UINT32_MAX);
+		*phdr = (GElf_Phdr){
+			.p_type = PT_LOAD,
+			.p_flags = PF_R,
+			.p_offset = writer->offset,
+			.p_vaddr = physical ? no_address : address,
+			.p_paddr = physical ? address : no_address,
+			.p_align = DRGN_MEMORY_TRACE_PAGE_SIZE,
+		};
+		writer->load = phdr;
+	}
+	err = core_writer_append(writer, buf, size);
+	if (err)
+		return err;
+	writer->load->p_filesz += size;
+	writer->load->p_memsz += size;
+	return NULL;
+}
+
+/*
+ * Read a run of pages and append them to the file. If a page can't be read, it
+ * is omitted.
+ */
+static struct drgn_error *core_writer_add_run(struct core_writer *writer,
+					      struct drgn_program *prog,
+					      uint64_t page, size_t num_pages,
+					      char *buf, bool physical)
+{
+	struct drgn_error *err;
+
+	err = drgn_program_read_memory(prog, buf,
+				       page * DRGN_MEMORY_TRACE_PAGE_SIZE,
+				       num_pages * DRGN_MEMORY_TRACE_PAGE_SIZE,
+				       physical);
+	if (!err) {
+		return core_writer_add_pages(writer, page, num_pages, buf,
+					     physical);
+	} else if (err->code != DRGN_ERROR_FAULT) {
+		return err;
+	}
+	drgn_error_destroy(err);
+	if (num_pages == 1) {
+		/* The next page can't extend the current segment. */
+		writer->load = NULL;
+		return NULL;
+	}
+	/* Part of the run can't be read. Fall back to reading page by page. */
+	for (size_t i = 0; i < num_pages; i++) {
+		err = core_writer_add_run(writer, prog, page + i, 1, buf,
+					  physical);
+		if (err)
+			return err;
+	}
+	return NULL;
+}
+
+static int uint64_cmp(const void *_a, const void *_b)
+{
+	uint64_t a = *(const uint64_t *)_a;
+	uint64_t b = *(const uint64_t *)_b;
+	return (a > b) - (a < b);
+}
+
+static struct drgn_error *
+core_writer_add_memory(struct core_writer *writer, struct drgn_program *prog,
+		       struct drgn_memory_trace_page_set *set, bool physical)
+{
+	struct drgn_error *err;
+
+	size_t num_pages = drgn_memory_trace_page_set_size(set);
+	if (num_pages == 0)
+		return NULL;
+	uint64_t *pages = malloc_array(num_pages, sizeof(pages[0]));
+	char *buf = malloc(DRGN_MEMORY_TRACE_CHUNK_PAGES *
+			   DRGN_MEMORY_TRACE_PAGE_SIZE);
+	if (!pages || !buf) {
+		err = &drgn_enomem;
+		goto out;
+	}
+	size_t n = 0;
+	for (struct drgn_memory_trace_page_set_iterator it =
+	     drgn_memory_trace_page_set_first(set);
+	     it.entry; it = drgn_memory_trace_page_set_next(it))
+		pages[n++] = *it.entry;
+	qsort(pages, num_pages, sizeof(pages[0]), uint64_cmp);
+
+	writer->load = NULL;
+	size_t i = 0;
+	while (i < num_pages) {
+		/* Read a run of consecutive pages at once if possible. */
+		size_t j = i + 1;
+		while (j < num_pages && j - i < DRGN_MEMORY_TRACE_CHUNK_PAGES &&
+		       pages[j] == pages[j - 1] + 1)
+			j++;
+		err = core_writer_add_run(writer, prog, pages[i], j - i, buf,
+					  physical);
+		if (err)
+			goto out;
+		i = j;
+	}
+	err = NULL;
+out:
+	writer->load = NULL;
+	free(buf);
+	free(pages);
+	return err;
+}
+
+static struct drgn_error *core_writer_finish(struct core_writer *writer,
+					     struct drgn_program *prog)
+{
+	struct drgn_error *err;
+
+	size_t phnum = writer->phdrs.size;
+	size_t phentsize = (writer->is_64_bit ?
+			    sizeof(Elf64_Phdr) : sizeof(Elf32_Phdr));
+	size_t shentsize = (writer->is_64_bit ?
+			    sizeof(Elf64_Shdr) : sizeof(Elf32_Shdr));
+
+	err = core_writer_align(writer, 8);
+	if (err)
+		return err;
+	uint64_t phoff = writer->offset;
+	if (writer->is_64_bit) {
+		err = core_writer_pwrite_xlated(writer, ELF_T_PHDR,
+						writer->phdrs.data,
+						phnum * sizeof(Elf64_Phdr),
+						phoff);
+		if (err)
+			return err;
+	} else {
+		Elf32_Phdr *phdrs32 = malloc_array(phnum, sizeof(*phdrs32));
+		if (!phdrs32 && phnum)
+			return &drgn_enomem;
+		for (size_t i = 0; i < phnum; i++) {
+			GElf_Phdr *phdr = &writer->phdrs.data[i];
+			phdrs32[i] = (Elf32_Phdr){
+				.p_type = phdr->p_type,
+				.p_offset = phdr->p_offset,
+				.p_vaddr = phdr->p_vaddr,
+				.p_paddr = phdr->p_paddr,
+				.p_filesz = phdr->p_filesz,
+				.p_memsz = phdr->p_memsz,
+				.p_flags = phdr->p_flags,
+				.p_align = phdr->p_align,
+			};
+		}
+		err = core_writer_pwrite_xlated(writer, ELF_T_PHDR, phdrs32,
+						phnum * sizeof(Elf32_Phdr),
+						phoff);
+		free(phdrs32);
+		if (err)
+			return err;
+	}
+	writer->offset += phnum * phentsize;
+
+	/*
+	 * If there are too many program headers for e_phnum, the real number
+	 * goes in sh_info of section header 0.
+	 */
+	uint64_t shoff = 0;
+	if (phnum >= PN_XNUM) {
+		shoff = writer->offset;
+		if (writer->is_64_bit) {
+			Elf64_Shdr shdr = { .sh_info = phnum };
+			err = core_writer_pwrite_xlated(writer, ELF_T_SHDR,
+							&shdr, sizeof(shdr),
+							shoff);
+		} else {
+			Elf32_Shdr shdr = { .sh_info = phnum };
+			err = core_writer_pwrite_xlated(writer, ELF_T_SHDR,
+							&shdr, sizeof(shdr),
+							shoff);
+		}
+		if (err)
+			return err;
+		writer->offset += shentsize;
+	}
+
+	unsigned char e_ident[EI_NIDENT] = {
+		[EI_MAG0] = ELFMAG0,
+		[EI_MAG1] = ELFMAG1,
+		[EI_MAG2] = ELFMAG2,
+		[EI_MAG3] = ELFMAG3,
+		[EI_CLASS] = writer->is_64_bit ? ELFCLASS64 : ELFCLASS32,
+		[EI_DATA] = writer->ei_data,
+		[EI_VERSION] = EV_CURRENT,
+		[EI_OSABI] = ELFOSABI_NONE,
+	};
+	uint16_t e_machine = drgn_platform_elf_machine(&prog->platform);
+	uint16_t e_phnum = phnum >= PN_XNUM ? PN_XNUM : phnum;
+	uint16_t e_shnum = phnum >= PN_XNUM ? 1 : 0;
+	if (writer->is_64_bit) {
+		Elf64_Ehdr ehdr = {
+			.e_type = ET_CORE,
+			.e_machine = e_machine,
+			.e_version = EV_CURRENT,
+			.e_phoff = phnum ? phoff : 0,
+			.e_shoff = shoff,
+			.e_ehsize = sizeof(ehdr),
+			.e_phentsize = phentsize,
+			.e_phnum = e_phnum,
+			.e_shentsize = e_shnum ? shentsize : 0,
+			.e_shnum = e_shnum,
+			.e_shstrndx = SHN_UNDEF,
+		};
+		memcpy(ehdr.e_ident, e_ident, EI_NIDENT);
+		return core_writer_pwrite_xlated(writer, ELF_T_EHDR, &ehdr,
+						 sizeof(ehdr), 0);
+	} else {
+		Elf32_Ehdr ehdr = {
+			.e_type = ET_CORE,
+			.e_machine = e_machine,
+			.e_version = EV_CURRENT,
+			.e_phoff = phnum ? phoff : 0,
+			.e_shoff = shoff,
+			.e_ehsize = sizeof(ehdr),
+			.e_phentsize = phentsize,
+			.e_phnum = e_phnum,
+			.e_shentsize = e_shnum ? shentsize : 0,
+			.e_shnum = e_shnum,
+			.e_shstrndx = SHN_UNDEF,
+		};
+		memcpy(ehdr.e_ident, e_ident, EI_NIDENT);
+		return core_writer_pwrite_xlated(writer, ELF_T_EHDR, &ehdr,
+						 sizeof(ehdr), 0);
+	}
+}
+
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_memory_trace_write_core(struct drgn_memory_trace *trace,
+			     struct drgn_program *prog, const char *path)
+{
+	struct drgn_error *err;
+
+	if (!prog->has_platform) {
+		return drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+					 "program platform is not known");
+	}
+
+	struct core_writer writer = {
+		.path = path,
+		.is_64_bit = drgn_platform_is_64_bit(&prog->platform),
+		.ei_data = (drgn_platform_is_little_endian(&prog->platform) ?
+			    ELFDATA2LSB : ELFDATA2MSB),
+		.phdrs = VECTOR_INIT,
+	};
+	writer.fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (writer.fd < 0)
+		return drgn_error_create_os("open", errno, path);
+	/* The ELF header is written last. Leave room for it. */
+	writer.offset = (writer.is_64_bit ?
+			 sizeof(Elf64_Ehdr) : sizeof(Elf32_Ehdr));
+
+	drgn_program_lock(prog);
+	/* Don't trace our own reads. */
+	drgn_memory_read_trace_fn *trace_fn = prog->memory_read_trace_fn;
+	prog->memory_read_trace_fn = NULL;
+	pthread_mutex_lock(&trace->lock);
+	if (trace->oom) {
+		err = &drgn_enomem;
+		goto out;
+	}
+
+	err = core_writer_add_notes(&writer, prog);
+	if (err)
+		goto out;
+	/* Keep the memory page-aligned in the file. */
+	err = core_writer_align(&writer, DRGN_MEMORY_TRACE_PAGE_SIZE);
+	if (err)
+		goto out;
+	for (int physical = 0; physical < 2; physical++) {
+		err = core_writer_add_memory(&writer, prog,
+					     &trace->pages[physical], physical);
+		if (err)
+			goto out;
+	}
+	err = core_writer_finish(&writer, prog);
+
+out:
+	pthread_mutex_unlock(&trace->lock);
+	prog->memory_read_trace_fn = trace_fn;
+	drgn_program_unlock(prog);
+	gelf_phdr_vector_deinit(&writer.phdrs);
+	if (close(writer.fd) < 0 && !err)
+		err = drgn_error_create_os("close", errno, path);
+	if (err)
+		unlink(path);
+	return err;
+}
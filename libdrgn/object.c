@@ -14,6 +14,7 @@
 #include "object.h"
 #include "program.h"
 #include "serialize.h"
+#include "string_builder.h"
 #include "type.h"
 #include "util.h"
 
@@ -240,10 +241,11 @@ drgn_object_set_float(struct drgn_object *res,
 	return NULL;
 }
 
-static void drgn_value_deserialize(union drgn_value *value, const void *buf,
-				   uint8_t bit_offset,
-				   enum drgn_object_encoding encoding,
-				   uint64_t bit_size, bool little_endian)
+/* Convert bits returned by deserialize_bits() to a value. */
+static inline void drgn_value_from_bits(union drgn_value *value,
+					uint64_t uvalue,
+					enum drgn_object_encoding encoding,
+					uint64_t bit_size)
 {
 	union {
 		int64_t svalue;
@@ -257,7 +259,7 @@ static void drgn_value_deserialize(union drgn_value *value, const void *buf,
 		};
 	} tmp;
 
-	tmp.uvalue = deserialize_bits(buf, bit_offset, bit_size, little_endian);
+	tmp.uvalue = uvalue;
 	switch (encoding) {
 	case DRGN_OBJECT_ENCODING_SIGNED:
 		value->svalue = truncate_signed(tmp.svalue, bit_size);
@@ -273,6 +275,22 @@ static void drgn_value_deserialize(union drgn_value *value, const void *buf,
 	}
 }
 
+static void drgn_value_deserialize(union drgn_value *value, const void *buf,
+				   uint8_t bit_offset,
+				   enum drgn_object_encoding encoding,
+				   uint64_t bit_size, bool little_endian)
+{
+	deserialize_fn *fn;
+	uint64_t uvalue;
+	if (bit_offset == 0 &&
+	    (fn = deserialize_bits_fn(bit_size, little_endian)))
+		uvalue = fn(buf);
+	else
+		uvalue = deserialize_bits(buf, bit_offset, bit_size,
+					  little_endian);
+	drgn_value_from_bits(value, uvalue, encoding, bit_size);
+}
+
 struct drgn_error *
 drgn_object_set_from_buffer_internal(struct drgn_object *res,
 				     const struct drgn_object_type *type,
@@ -573,11 +591,19 @@ drgn_object_read_reference(const struct drgn_object *obj,
 		uint64_t read_size = drgn_value_size(bit_offset + bit_size);
 		char buf[9];
 		assert(read_size <= sizeof(buf));
-		err = drgn_program_read_memory(drgn_object_program(obj), buf,
-					       obj->address, read_size, false);
-		if (err)
-			return err;
-		drgn_value_deserialize(value, buf, bit_offset, obj->encoding,
+		const void *p =
+			drgn_program_borrow_memory(drgn_object_program(obj),
+						   obj->address, read_size,
+						   false);
+		if (!p) {
+			err = drgn_program_read_memory(drgn_object_program(obj),
+						       buf, obj->address,
+						       read_size, false);
+			if (err)
+				return err;
+			p = buf;
+		}
+		drgn_value_deserialize(value, p, bit_offset, obj->encoding,
 				       bit_size, obj->little_endian);
 		return NULL;
 	}
@@ -864,8 +890,10 @@ drgn_object_read_c_string(const struct drgn_object *obj, char **ret)
 }
 
 LIBDRGN_PUBLIC struct drgn_error *
-drgn_format_object(const struct drgn_object *obj, size_t columns,
-		   enum drgn_format_object_flags flags, char **ret)
+drgn_format_object_stream(const struct drgn_object *obj, size_t columns,
+			  enum drgn_format_object_flags flags,
+			  uint64_t max_elements, size_t max_size,
+			  drgn_format_object_write_fn *write_fn, void *arg)
 {
 	const struct drgn_language *lang = drgn_object_language(obj);
 
@@ -873,7 +901,32 @@ drgn_format_object(const struct drgn_object *obj, size_t columns,
 		return drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
 					 "invalid format object flags");
 	}
-	return lang->format_object(obj, columns, flags, ret);
+	return lang->format_object(obj, columns, flags, max_elements, max_size,
+				   write_fn, arg);
+}
+
+static struct drgn_error *format_object_append(const char *str, size_t len,
+					       void *arg)
+{
+	if (!string_builder_appendn(arg, str, len))
+		return &drgn_enomem;
+	return NULL;
+}
+
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_format_object(const struct drgn_object *obj, size_t columns,
+		   enum drgn_format_object_flags flags, char **ret)
+{
+	struct drgn_error *err;
+	struct string_builder sb = {};
+
+	err = drgn_format_object_stream(obj, columns, flags, 0, 0,
+					format_object_append, &sb);
+	if (!err && !string_builder_finalize(&sb, ret))
+		err = &drgn_enomem;
+	if (err)
+		free(sb.str);
+	return err;
 }
 
 static struct drgn_error *
@@ -1432,6 +1485,216 @@ drgn_object_member_dereference(struct drgn_object *res,
 					      member_bit_field_size);
 }
 
+/*
+ * The same structure type from different compilation units is usually a
+ * different struct drgn_type, so also match by name and size.
+ */
+static bool drgn_member_path_type_matches(struct drgn_type *type,
+					  struct drgn_type *path_type)
+{
+	type = drgn_underlying_type(type);
+	path_type = drgn_underlying_type(path_type);
+	if (type == path_type)
+		return true;
+	if (drgn_type_kind(type) != drgn_type_kind(path_type) ||
+	    !drgn_type_has_members(type) || !drgn_type_is_complete(type) ||
+	    !drgn_type_is_complete(path_type))
+		return false;
+	const char *tag = drgn_type_tag(type);
+	const char *path_tag = drgn_type_tag(path_type);
+	return tag && path_tag && strcmp(tag, path_tag) == 0 &&
+	       drgn_type_size(type) == drgn_type_size(path_type);
+}
+
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_object_member_path(struct drgn_object *res, const struct drgn_object *obj,
+			const struct drgn_member_path *path)
+{
+	if (drgn_object_program(res) != drgn_object_program(obj) ||
+	    drgn_type_program(path->type) != drgn_object_program(obj)) {
+		return drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+					 "objects are from different programs");
+	}
+
+	if (drgn_member_path_type_matches(obj->type, path->type)) {
+		return drgn_object_slice(res, obj, path->member_type,
+					 path->bit_offset,
+					 path->bit_field_size);
+	}
+	struct drgn_type *underlying_type = drgn_underlying_type(obj->type);
+	if (drgn_type_kind(underlying_type) == DRGN_TYPE_POINTER &&
+	    drgn_member_path_type_matches(drgn_type_type(underlying_type).type,
+					  path->type)) {
+		return drgn_object_dereference_offset(res, obj,
+						      path->member_type,
+						      path->bit_offset,
+						      path->bit_field_size);
+	}
+	return drgn_type_error("'%s' is not the type of the member path or a pointer to it",
+			       obj->type);
+}
+
+/* Maximum number of bytes to read in one batch by drgn_read_members(). */
+#define DRGN_READ_MEMBERS_BATCH_SIZE (1024 * 1024)
+
+static struct drgn_error *
+drgn_read_members(struct drgn_program *prog,
+		  const struct drgn_member_path *paths, size_t num_paths,
+		  const uint64_t *addresses, uint64_t start, uint64_t stride,
+		  size_t count, void * const *arrays)
+{
+	struct drgn_error *err;
+
+	if (count == 0 || num_paths == 0)
+		return NULL;
+
+	struct drgn_object_type *types = malloc_array(num_paths,
+						      sizeof(*types));
+	if (!types)
+		return &drgn_enomem;
+	char *buf = NULL;
+	struct drgn_memory_read_request *requests = NULL;
+
+	/* Only read the bytes from the first member to the end of the last. */
+	uint64_t lo = UINT64_MAX, hi = 0;
+	for (size_t i = 0; i < num_paths; i++) {
+		if (drgn_type_program(paths[i].type) != prog) {
+			err = drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+						"member path is from different program");
+			goto out;
+		}
+		err = drgn_object_type(paths[i].member_type,
+				       paths[i].bit_field_size, &types[i]);
+		if (err)
+			goto out;
+		if ((types[i].encoding != DRGN_OBJECT_ENCODING_SIGNED &&
+		     types[i].encoding != DRGN_OBJECT_ENCODING_UNSIGNED &&
+		     types[i].encoding != DRGN_OBJECT_ENCODING_FLOAT) ||
+		    types[i].bit_size > 64) {
+			err = drgn_qualified_type_error("cannot read '%s' into an array",
+							paths[i].member_type);
+			goto out;
+		}
+		uint64_t end;
+		if (__builtin_add_overflow(paths[i].bit_offset,
+					   types[i].bit_size + 7, &end)) {
+			err = drgn_error_create(DRGN_ERROR_OVERFLOW,
+						"offset is too large");
+			goto out;
+		}
+		lo = min(lo, paths[i].bit_offset / 8);
+		hi = max(hi, end / 8);
+	}
+	if (hi - lo > SIZE_MAX) {
+		err = drgn_error_create(DRGN_ERROR_OVERFLOW,
+					"object is too large");
+		goto out;
+	}
+	size_t span = hi - lo;
+	size_t batch = min(max(DRGN_READ_MEMBERS_BATCH_SIZE / span, (size_t)1),
+			   count);
+
+	buf = malloc_array(batch, span);
+	requests = malloc_array(batch, sizeof(*requests));
+	if (!buf || !requests) {
+		err = &drgn_enomem;
+		goto out;
+	}
+
+	for (size_t i = 0; i < count; i += batch) {
+		size_t n = min(batch, count - i);
+		for (size_t j = 0; j < n; j++) {
+			uint64_t address = addresses ?
+					   addresses[i + j] :
+					   start + (i + j) * stride;
+			requests[j].address = address + lo;
+			requests[j].count = span;
+			requests[j].buf = buf + j * span;
+		}
+		err = drgn_program_read_memory_batch(prog, requests, n, false);
+		if (err)
+			goto out;
+		for (size_t j = 0; j < n; j++) {
+			if (!requests[j].err)
+				continue;
+			if (err)
+				drgn_error_destroy(requests[j].err);
+			else
+				err = requests[j].err;
+		}
+		if (err)
+			goto out;
+
+		for (size_t k = 0; k < num_paths; k++) {
+			const char *p = buf + (paths[k].bit_offset / 8 - lo);
+			uint8_t bit_offset = paths[k].bit_offset % 8;
+			uint64_t bit_size = types[k].bit_size;
+			bool little_endian = types[k].little_endian;
+			deserialize_fn *fn =
+				bit_offset == 0 ?
+				deserialize_bits_fn(bit_size, little_endian) :
+				NULL;
+			for (size_t j = 0; j < n; j++, p += span) {
+				uint64_t uvalue;
+				if (fn) {
+					uvalue = fn(p);
+				} else {
+					uvalue = deserialize_bits(p, bit_offset,
+								  bit_size,
+								  little_endian);
+				}
+				union drgn_value value;
+				drgn_value_from_bits(&value, uvalue,
+						     types[k].encoding,
+						     bit_size);
+				switch (types[k].encoding) {
+				case DRGN_OBJECT_ENCODING_SIGNED:
+					((int64_t *)arrays[k])[i + j] =
+						value.svalue;
+					break;
+				case DRGN_OBJECT_ENCODING_UNSIGNED:
+					((uint64_t *)arrays[k])[i + j] =
+						value.uvalue;
+					break;
+				case DRGN_OBJECT_ENCODING_FLOAT:
+					((double *)arrays[k])[i + j] =
+						value.fvalue;
+					break;
+				default:
+					UNREACHABLE();
+				}
+			}
+		}
+	}
+	err = NULL;
+out:
+	free(requests);
+	free(buf);
+	free(types);
+	return err;
+}
+
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_program_read_members(struct drgn_program *prog,
+			  const struct drgn_member_path *paths,
+			  size_t num_paths, const uint64_t *addresses,
+			  size_t count, void * const *arrays)
+{
+	return drgn_read_members(prog, paths, num_paths, addresses, 0, 0,
+				 count, arrays);
+}
+
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_program_read_members_strided(struct drgn_program *prog,
+				  const struct drgn_member_path *paths,
+				  size_t num_paths, uint64_t start,
+				  uint64_t stride, size_t count,
+				  void * const *arrays)
+{
+	return drgn_read_members(prog, paths, num_paths, NULL, start, stride,
+				 count, arrays);
+}
+
 LIBDRGN_PUBLIC struct drgn_error *
 drgn_object_container_of(struct drgn_object *res, const struct drgn_object *obj,
 			 struct drgn_qualified_type qualified_type,
@@ -6,27 +6,79 @@
 
 #include "object_index.h"
 
+static struct hash_pair
+drgn_object_index_key_hash_pair(const struct drgn_object_index_key *key)
+{
+	size_t hash = hash_c_string(key->name);
+	if (key->filename)
+		hash = hash_combine(hash, hash_c_string(key->filename));
+	hash = hash_combine((size_t)key->flags, hash);
+	return hash_pair_from_avalanching_hash(hash);
+}
+
+static bool drgn_object_index_key_eq(const struct drgn_object_index_key *a,
+				     const struct drgn_object_index_key *b)
+{
+	return (a->flags == b->flags && strcmp(a->name, b->name) == 0 &&
+		(a->filename ?
+		 b->filename && strcmp(a->filename, b->filename) == 0 :
+		 !b->filename));
+}
+
+DEFINE_HASH_MAP_FUNCTIONS(drgn_object_index_miss_map,
+			  drgn_object_index_key_hash_pair,
+			  drgn_object_index_key_eq)
+DEFINE_HASH_MAP_FUNCTIONS(drgn_object_finder_cache,
+			  drgn_object_index_key_hash_pair,
+			  drgn_object_index_key_eq)
+
+static void drgn_object_finder_destroy(struct drgn_object_finder *finder)
+{
+	if (finder->cached) {
+		for (struct drgn_object_finder_cache_iterator it =
+		     drgn_object_finder_cache_first(&finder->cache);
+		     it.entry; it = drgn_object_finder_cache_next(it)) {
+			free((char *)it.entry->key.name);
+			if (it.entry->value) {
+				drgn_object_deinit(it.entry->value);
+				free(it.entry->value);
+			}
+		}
+		drgn_object_finder_cache_deinit(&finder->cache);
+	}
+	free(finder);
+}
+
 void drgn_object_index_init(struct drgn_object_index *oindex)
 {
 	oindex->finders = NULL;
+	drgn_object_index_miss_map_init(&oindex->misses);
+	oindex->generation = 0;
 }
 
 void drgn_object_index_deinit(struct drgn_object_index *oindex)
 {
 	struct drgn_object_finder *finder;
 
+	for (struct drgn_object_index_miss_map_iterator it =
+	     drgn_object_index_miss_map_first(&oindex->misses);
+	     it.entry; it = drgn_object_index_miss_map_next(it))
+		free((char *)it.entry->key.name);
+	drgn_object_index_miss_map_deinit(&oindex->misses);
+
 	finder = oindex->finders;
 	while (finder) {
 		struct drgn_object_finder *next = finder->next;
 
-		free(finder);
+		drgn_object_finder_destroy(finder);
 		finder = next;
 	}
 }
 
 struct drgn_error *
 drgn_object_index_add_finder(struct drgn_object_index *oindex,
-			     drgn_object_find_fn fn, void *arg)
+			     drgn_object_find_fn fn, void *arg, bool cached,
+			     bool cacheable)
 {
 	struct drgn_object_finder *finder;
 
@@ -35,16 +87,129 @@ drgn_object_index_add_finder(struct drgn_object_index *oindex,
 		return &drgn_enomem;
 	finder->fn = fn;
 	finder->arg = arg;
+	finder->cached = cached;
+	if (cached)
+		drgn_object_finder_cache_init(&finder->cache);
+	finder->cacheable = cached || cacheable;
 	finder->next = oindex->finders;
 	oindex->finders = finder;
+	drgn_object_index_invalidate(oindex);
 	return NULL;
 }
 
 void drgn_object_index_remove_finder(struct drgn_object_index *oindex)
 {
 	struct drgn_object_finder *finder = oindex->finders->next;
-	free(oindex->finders);
+	drgn_object_finder_destroy(oindex->finders);
 	oindex->finders = finder;
+	drgn_object_index_invalidate(oindex);
+}
+
+/*
+ * Copy the name and filename of a lookup key so that it can be stored. Returns
+ * the allocation owning them, or NULL if memory couldn't be allocated.
+ */
+static char *drgn_object_index_key_copy(const struct drgn_object_index_key *key,
+					struct drgn_object_index_key *ret)
+{
+	size_t name_size = strlen(key->name) + 1;
+	size_t filename_size = key->filename ? strlen(key->filename) + 1 : 0;
+	char *copy = malloc(name_size + filename_size);
+	if (!copy)
+		return NULL;
+	memcpy(copy, key->name, name_size);
+	if (key->filename)
+		memcpy(copy + name_size, key->filename, filename_size);
+	ret->name = copy;
+	ret->filename = key->filename ? copy + name_size : NULL;
+	ret->flags = key->flags;
+	return copy;
+}
+
+/*
+ * Call a cached object finder, or return its result from a previous call with
+ * the same arguments. Successful lookups and lookups that didn't find anything
+ * are cached, but not errors, which may be transient. Failing to cache isn't
+ * fatal.
+ */
+static struct drgn_error *
+drgn_object_finder_find_cached(struct drgn_object_finder *finder,
+			       const struct drgn_object_index_key *key,
+			       size_t name_len, struct drgn_object *ret)
+{
+	struct drgn_error *err;
+	struct hash_pair hp = drgn_object_finder_cache_hash(key);
+	struct drgn_object_finder_cache_iterator it =
+		drgn_object_finder_cache_search_hashed(&finder->cache, key,
+						       hp);
+	if (it.entry) {
+		if (!it.entry->value)
+			return &drgn_not_found;
+		return drgn_object_copy(ret, it.entry->value);
+	}
+
+	err = finder->fn(key->name, name_len, key->filename, key->flags,
+			 finder->arg, ret);
+	if (err && err != &drgn_not_found)
+		return err;
+
+	struct drgn_object_finder_cache_entry entry = { .value = NULL };
+	if (!err) {
+		entry.value = malloc(sizeof(*entry.value));
+		if (!entry.value)
+			return NULL;
+		drgn_object_init(entry.value, drgn_object_program(ret));
+		struct drgn_error *copy_err = drgn_object_copy(entry.value,
+							       ret);
+		if (copy_err) {
+			drgn_error_destroy(copy_err);
+			goto err_value;
+		}
+	}
+	char *copy = drgn_object_index_key_copy(key, &entry.key);
+	if (!copy)
+		goto err_value;
+	/* The callback may have looked up the same object recursively. */
+	if (drgn_object_finder_cache_insert_hashed(&finder->cache, &entry, hp,
+						   NULL) <= 0) {
+		free(copy);
+		goto err_value;
+	}
+	return err;
+
+err_value:
+	if (entry.value) {
+		drgn_object_deinit(entry.value);
+		free(entry.value);
+	}
+	return err;
+}
+
+/*
+ * Remember that a lookup didn't find anything in the current generation.
+ * Failing to do so isn't fatal.
+ */
+static void drgn_object_index_add_miss(struct drgn_object_index *oindex,
+				       const struct drgn_object_index_key *key,
+				       struct hash_pair hp)
+{
+	struct drgn_object_index_miss_map_iterator it =
+		drgn_object_index_miss_map_search_hashed(&oindex->misses, key,
+							 hp);
+	if (it.entry) {
+		/* Reuse the stale entry. */
+		it.entry->value = oindex->generation;
+		return;
+	}
+	struct drgn_object_index_miss_map_entry entry = {
+		.value = oindex->generation,
+	};
+	char *copy = drgn_object_index_key_copy(key, &entry.key);
+	if (!copy)
+		return;
+	if (drgn_object_index_miss_map_insert_searched(&oindex->misses,
+						       &entry, hp, NULL) < 0)
+		free(copy);
 }
 
 struct drgn_error *drgn_object_index_find(struct drgn_object_index *oindex,
@@ -63,14 +228,42 @@ struct drgn_error *drgn_object_index_find(struct drgn_object_index *oindex,
 					 "invalid find object flags");
 	}
 
-	name_len = strlen(name);
-	finder = oindex->finders;
-	while (finder) {
-		err = finder->fn(name, name_len, filename, flags, finder->arg,
-				 ret);
-		if (err != &drgn_not_found)
-			return err;
-		finder = finder->next;
+	struct drgn_object_index_key key = {
+		.name = name,
+		.filename = filename,
+		.flags = flags,
+	};
+	struct hash_pair hp = drgn_object_index_miss_map_hash(&key);
+	struct drgn_object_index_miss_map_iterator it =
+		drgn_object_index_miss_map_search_hashed(&oindex->misses, &key,
+							 hp);
+	if (!it.entry || it.entry->value != oindex->generation) {
+		uint64_t generation = oindex->generation;
+		bool cacheable = true;
+		name_len = strlen(name);
+		finder = oindex->finders;
+		while (finder) {
+			cacheable &= finder->cacheable;
+			if (finder->cached) {
+				err = drgn_object_finder_find_cached(finder,
+								     &key,
+								     name_len,
+								     ret);
+			} else {
+				err = finder->fn(name, name_len, filename,
+						 flags, finder->arg, ret);
+			}
+			if (err != &drgn_not_found)
+				return err;
+			finder = finder->next;
+		}
+		/*
+		 * Don't remember the miss if a callback may find the object
+		 * later or changed the index (e.g., by loading debugging
+		 * information).
+		 */
+		if (cacheable && oindex->generation == generation)
+			drgn_object_index_add_miss(oindex, &key, hp);
 	}
 
 	switch (flags) {
@@ -13,6 +13,7 @@
 #define DRGN_OBJECT_INDEX_H
 
 #include "drgn.h"
+#include "hash_table.h"
 
 /**
  * @ingroup Internals
@@ -27,12 +28,60 @@
  * @{
  */
 
+/** Arguments of a @ref drgn_object_index_find() lookup. */
+struct drgn_object_index_key {
+	/** Object name. */
+	const char *name;
+	/** Filename, or @c NULL if none was given. */
+	const char *filename;
+	/** Bitmask of @ref drgn_find_object_flags. */
+	enum drgn_find_object_flags flags;
+};
+
+#ifdef DOXYGEN
+/**
+ * @struct drgn_object_index_miss_map
+ *
+ * Map of object lookups that didn't find anything.
+ *
+ * The key is a @ref drgn_object_index_key, and the value is the @ref
+ * drgn_object_index::generation that the lookup was done in.
+ *
+ * @struct drgn_object_finder_cache
+ *
+ * Map of the lookups done by a cached @ref drgn_object_finder to their
+ * results.
+ *
+ * The key is a @ref drgn_object_index_key, and the value is the found object,
+ * or @c NULL if the callback didn't find anything.
+ */
+#else
+DEFINE_HASH_MAP_TYPE(drgn_object_index_miss_map, struct drgn_object_index_key,
+		     uint64_t)
+DEFINE_HASH_MAP_TYPE(drgn_object_finder_cache, struct drgn_object_index_key,
+		     struct drgn_object *)
+#endif
+
 /** Registered callback in a @ref drgn_object_index. */
 struct drgn_object_finder {
 	/** The callback. */
 	drgn_object_find_fn fn;
 	/** Argument to pass to @ref drgn_object_finder::fn. */
 	void *arg;
+	/** Whether the results of @ref fn are cached in @ref cache. */
+	bool cached;
+	/**
+	 * Results of @ref fn. Only used if @ref cached. Entries are never
+	 * invalidated.
+	 */
+	struct drgn_object_finder_cache cache;
+	/**
+	 * Whether @ref fn only finds different objects after @ref
+	 * drgn_object_index_invalidate(), so that a lookup it doesn't find
+	 * can be remembered in @ref drgn_object_index::misses. This is true
+	 * for @ref cached finders and built-in finders.
+	 */
+	bool cacheable;
 	/** Next callback to try. */
 	struct drgn_object_finder *next;
 };
@@ -48,6 +97,17 @@ struct drgn_object_finder {
 struct drgn_object_index {
 	/** Callbacks for finding objects. */
 	struct drgn_object_finder *finders;
+	/**
+	 * Lookups that didn't find anything. An entry is only valid if it is
+	 * from the current @ref generation. Lookups are only remembered if
+	 * every callback is @ref drgn_object_finder::cacheable.
+	 */
+	struct drgn_object_index_miss_map misses;
+	/**
+	 * Incremented whenever the objects that can be found may have changed,
+	 * which invalidates every entry in @ref misses.
+	 */
+	uint64_t generation;
 };
 
 /** Initialize a @ref drgn_object_index. */
@@ -56,14 +116,36 @@ void drgn_object_index_init(struct drgn_object_index *oindex);
 /** Deinitialize a @ref drgn_object_index. */
 void drgn_object_index_deinit(struct drgn_object_index *oindex);
 
-/** @sa drgn_program_add_object_finder() */
+/**
+ * @sa drgn_program_add_object_finder()
+ * @sa drgn_program_add_cached_object_finder()
+ *
+ * @param[in] cached Whether to cache the results of @p fn.
+ * @param[in] cacheable Whether lookups @p fn doesn't find may be remembered
+ * (see @ref drgn_object_finder::cacheable). Implied by @p cached.
+ */
 struct drgn_error *
 drgn_object_index_add_finder(struct drgn_object_index *oindex,
-			     drgn_object_find_fn fn, void *arg);
+			     drgn_object_find_fn fn, void *arg, bool cached,
+			     bool cacheable);
 
 /** Remove the most recently added object finding callback. */
 void drgn_object_index_remove_finder(struct drgn_object_index *oindex);
 
+/**
+ * Invalidate the cached lookups in a @ref drgn_object_index that didn't find
+ * anything.
+ *
+ * This must be called whenever the objects that the callbacks can find may
+ * have changed (e.g., when debugging information is loaded). Adding or
+ * removing a callback does this automatically.
+ */
+static inline void
+drgn_object_index_invalidate(struct drgn_object_index *oindex)
+{
+	oindex->generation++;
+}
+
 /**
  * Find an object in a @ref drgn_object_index.
  *
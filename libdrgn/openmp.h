@@ -0,0 +1,39 @@
+// Copyright (c) Meta Platforms, Inc. and affiliates.
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/**
+ * @file
+ *
+ * OpenMP wrappers.
+ *
+ * This includes `<omp.h>` if libdrgn is built with OpenMP. Otherwise, it
+ * defines stubs for the OpenMP functions used by libdrgn that behave as if
+ * there is only one thread.
+ */
+
+#ifndef DRGN_OPENMP_H
+#define DRGN_OPENMP_H
+
+#ifdef _OPENMP
+#include <omp.h> // IWYU pragma: export
+#else
+typedef struct {} omp_lock_t;
+#define omp_init_lock(lock) do {} while (0)
+#define omp_destroy_lock(lock) do {} while (0)
+#define omp_set_lock(lock) do {} while (0)
+#define omp_unset_lock(lock) do {} while (0)
+static inline int omp_get_thread_num(void)
+{
+	return 0;
+}
+static inline int omp_get_max_threads(void)
+{
+	return 1;
+}
+static inline int omp_in_parallel(void)
+{
+	return 0;
+}
+#endif
+
+#endif /* DRGN_OPENMP_H */
@@ -3,6 +3,7 @@
 
 #include <byteswap.h>
 #include <gelf.h>
+#include <stdalign.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -13,8 +14,10 @@
 
 void drgn_orc_module_info_deinit(struct drgn_debug_info_module *module)
 {
-	free(module->orc.entries);
-	free(module->orc.pc_offsets);
+	if (module->orc.copied) {
+		free(module->orc.entries);
+		free(module->orc.pc_offsets);
+	}
 }
 
 /*
@@ -33,12 +36,9 @@ static inline uint64_t drgn_raw_orc_pc(struct drgn_debug_info_module *module,
 	return module->orc.pc_base + UINT64_C(4) * i + offset;
 }
 
-static int compare_orc_entries(const void *a, const void *b, void *arg)
+static int compare_raw_orc_entries(struct drgn_debug_info_module *module,
+				   size_t index_a, size_t index_b)
 {
-	struct drgn_debug_info_module *module = arg;
-	size_t index_a = *(size_t *)a;
-	size_t index_b = *(size_t *)b;
-
 	uint64_t pc_a = drgn_raw_orc_pc(module, index_a);
 	uint64_t pc_b = drgn_raw_orc_pc(module, index_b);
 	if (pc_a < pc_b)
@@ -63,6 +63,11 @@ static int compare_orc_entries(const void *a, const void *b, void *arg)
 		- drgn_orc_flags_is_terminator(flags_a));
 }
 
+static int compare_orc_entries(const void *a, const void *b, void *arg)
+{
+	return compare_raw_orc_entries(arg, *(size_t *)a, *(size_t *)b);
+}
+
 static size_t keep_orc_entry(struct drgn_debug_info_module *module,
 			     size_t *indices, size_t num_entries, size_t i)
 {
@@ -200,25 +205,47 @@ drgn_debug_info_parse_orc(struct drgn_debug_info_module *module)
 	if (!num_entries)
 		return NULL;
 
+	/*
+	 * Since Linux kernel commit f14bf6a350df ("x86/unwind/orc: Remove
+	 * boot-time ORC unwind tables sorting") (in v5.6), the ORC entries are
+	 * already sorted for vmlinux.
+	 */
+	bool sorted = true;
+	for (size_t i = 1; i < num_entries; i++) {
+		if (compare_raw_orc_entries(module, i - 1, i) > 0) {
+			sorted = false;
+			break;
+		}
+	}
+
+	bool bswap = drgn_platform_bswap(&module->platform);
+	if (sorted && !bswap &&
+	    (uintptr_t)orc_unwind_ip->d_buf % alignof(int32_t) == 0 &&
+	    (uintptr_t)orc_unwind->d_buf % alignof(struct drgn_orc_entry) == 0) {
+		/*
+		 * The sections are already in the format that we need, so we
+		 * can search them in place. This skips removing the entries
+		 * that are shadowed by DWARF CFI, but that's only an
+		 * optimization for the binary search, and it's not worth
+		 * copying hundreds of thousands of entries for.
+		 */
+		module->orc.pc_offsets = orc_unwind_ip->d_buf;
+		module->orc.entries = orc_unwind->d_buf;
+		module->orc.num_entries = num_entries;
+		module->orc.copied = false;
+		return NULL;
+	}
+
 	size_t *indices = malloc_array(num_entries, sizeof(indices[0]));
 	if (!indices)
 		return &drgn_enomem;
 	for (size_t i = 0; i < num_entries; i++)
 		indices[i] = i;
 
-	/*
-	 * Sort the ORC entries for binary search. Since Linux kernel commit
-	 * f14bf6a350df ("x86/unwind/orc: Remove boot-time ORC unwind tables
-	 * sorting") (in v5.6), this is already sorted for vmlinux, so only sort
-	 * it if necessary.
-	 */
-	for (size_t i = 1; i < num_entries; i++) {
-		if (compare_orc_entries(&indices[i - 1], &indices[i],
-					module) > 0) {
-			qsort_r(indices, num_entries, sizeof(indices[0]),
-				compare_orc_entries, module);
-			break;
-		}
+	/* Sort the ORC entries for binary search if necessary. */
+	if (!sorted) {
+		qsort_r(indices, num_entries, sizeof(indices[0]),
+			compare_orc_entries, module);
 	}
 
 	num_entries = remove_fdes_from_orc(module, indices, num_entries);
@@ -237,7 +264,6 @@ drgn_debug_info_parse_orc(struct drgn_debug_info_module *module)
 	}
 	const int32_t *orig_offsets = orc_unwind_ip->d_buf;
 	const struct drgn_orc_entry *orig_entries = orc_unwind->d_buf;
-	bool bswap = drgn_platform_bswap(&module->platform);
 	for (size_t i = 0; i < num_entries; i++) {
 		size_t index = indices[i];
 		int32_t offset;
@@ -257,6 +283,7 @@ drgn_debug_info_parse_orc(struct drgn_debug_info_module *module)
 	module->orc.pc_offsets = pc_offsets;
 	module->orc.entries = entries;
 	module->orc.num_entries = num_entries;
+	module->orc.copied = true;
 
 	err = NULL;
 out:
@@ -42,7 +42,8 @@ struct drgn_orc_module_info {
 	 * unwinder entry.
 	 *
 	 * This is the contents of the `.orc_unwind_ip` ELF section, byte
-	 * swapped to the host's byte order if necessary.
+	 * swapped to the host's byte order if necessary. If @ref copied is @c
+	 * false, this points directly to the section data.
 	 *
 	 * @sa drgn_orc_module_info::entries
 	 */
@@ -51,7 +52,8 @@ struct drgn_orc_module_info {
 	 * ORC unwinder entries.
 	 *
 	 * This is the contents of the `.orc_unwind` ELF section, byte swapped
-	 * to the host's byte order if necessary.
+	 * to the host's byte order if necessary. If @ref copied is @c false,
+	 * this points directly to the section data.
 	 *
 	 * Entry `i` specifies how to unwind the stack if
 	 * `orc_pc(i) <= PC < orc_pc(i + 1)`, where
@@ -60,6 +62,13 @@ struct drgn_orc_module_info {
 	struct drgn_orc_entry *entries;
 	/** Number of ORC unwinder entries. */
 	size_t num_entries;
+	/**
+	 * Whether @ref pc_offsets and @ref entries were allocated.
+	 *
+	 * If the sections are already sorted and in the host's byte order,
+	 * they are searched in place instead of being copied and sorted.
+	 */
+	bool copied;
 };
 
 void drgn_orc_module_info_deinit(struct drgn_debug_info_module *module);
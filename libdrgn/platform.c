@@ -170,6 +170,27 @@ void drgn_platform_from_elf(GElf_Ehdr *ehdr, struct drgn_platform *ret)
 				ehdr->e_ident[EI_DATA] == ELFDATA2LSB, ret);
 }
 
+uint16_t drgn_platform_elf_machine(const struct drgn_platform *platform)
+{
+	switch (platform->arch->arch) {
+	case DRGN_ARCH_X86_64:
+		return EM_X86_64;
+	case DRGN_ARCH_I386:
+		return EM_386;
+	case DRGN_ARCH_AARCH64:
+		return EM_AARCH64;
+	case DRGN_ARCH_ARM:
+		return EM_ARM;
+	case DRGN_ARCH_PPC64:
+		return EM_PPC64;
+	case DRGN_ARCH_RISCV64:
+	case DRGN_ARCH_RISCV32:
+		return EM_RISCV;
+	default:
+		return EM_NONE;
+	}
+}
+
 LIBDRGN_PUBLIC size_t
 drgn_platform_num_registers(const struct drgn_platform *platform)
 {
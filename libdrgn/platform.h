@@ -82,6 +82,11 @@ struct pgtable_iterator {
 	uint64_t pgtable;
 	/* Current virtual address to translate. */
 	uint64_t virt_addr;
+	/*
+	 * Architecture-specific flags of the page table entry that mapped the
+	 * range returned by the last translation, or 0 if it wasn't mapped.
+	 */
+	uint64_t flags;
 	/* Architecture-specific data. */
 	char arch[];
 };
@@ -113,6 +118,22 @@ typedef struct drgn_error *
 (pgtable_iterator_next_fn)(struct pgtable_iterator *it, uint64_t *virt_addr_ret,
 			   uint64_t *phys_addr_ret);
 
+/*
+ * Maximum number of linearly mapped regions returned by
+ * drgn_architecture_info::linux_kernel_linear_mappings().
+ */
+#define DRGN_MAX_LINEAR_MAPPINGS 2
+
+/*
+ * Range of kernel virtual addresses that maps physical memory at a constant
+ * offset, so translating it doesn't need the page table.
+ */
+struct drgn_linear_mapping {
+	uint64_t virt_addr;
+	uint64_t size;
+	uint64_t phys_addr;
+};
+
 struct drgn_architecture_info {
 	const char *name;
 	enum drgn_architecture arch;
@@ -155,6 +176,13 @@ struct drgn_architecture_info {
 	void (*pgtable_iterator_arch_init)(void *buf);
 	/* Iterate a (user or kernel) page table in the Linux kernel. */
 	pgtable_iterator_next_fn *linux_kernel_pgtable_iterator_next;
+	/*
+	 * Get the linearly mapped regions of the kernel address space (e.g.,
+	 * the direct mapping) given PAGE_OFFSET. Returns the number of regions
+	 * stored, at most DRGN_MAX_LINEAR_MAPPINGS.
+	 */
+	size_t (*linux_kernel_linear_mappings)(struct drgn_program *, uint64_t,
+					       struct drgn_linear_mapping *);
 };
 
 const struct drgn_register *drgn_register_by_name_unknown(const char *name);
@@ -215,4 +243,11 @@ void drgn_platform_from_arch(const struct drgn_architecture_info *arch,
 /** Initialize a @ref drgn_platform from an ELF header. */
 void drgn_platform_from_elf(GElf_Ehdr *ehdr, struct drgn_platform *ret);
 
+/**
+ * Get the ELF machine (`e_machine`) of a @ref drgn_platform, or `EM_NONE` if
+ * the architecture is unknown. This is the inverse of @ref
+ * drgn_platform_from_elf().
+ */
+uint16_t drgn_platform_elf_machine(const struct drgn_platform *platform);
+
 #endif /* DRGN_PLATFORM_H */
@@ -11,9 +11,13 @@
 #include <gelf.h>
 #include <inttypes.h>
 #include <limits.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/statfs.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -21,13 +25,18 @@
 #include "debug_info.h"
 #include "error.h"
 #include "helpers.h"
+#include "kallsyms.h"
 #include "language.h"
 #include "linux_kernel.h"
 #include "memory_reader.h"
 #include "minmax.h"
 #include "object_index.h"
+#include "openmp.h"
 #include "program.h"
+#include "seekable_zstd.h"
+#include "string_builder.h"
 #include "symbol.h"
+#include "symbol_index.h"
 #include "vector.h"
 #include "util.h"
 
@@ -91,10 +100,120 @@ void drgn_program_set_platform(struct drgn_program *prog,
 	}
 }
 
+/* Range of memory queued by drgn_program_prefetch(). */
+struct drgn_prefetch_request {
+	uint64_t address;
+	uint64_t size;
+	bool physical;
+};
+
+/* Maximum number of queued prefetches. Older ones are dropped. */
+#define DRGN_PREFETCH_QUEUE_SIZE 64
+
+/* Background thread that reads memory into the cache for a program. */
+struct drgn_prefetcher {
+	pthread_t thread;
+	/* Protects everything below. */
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct drgn_prefetch_request queue[DRGN_PREFETCH_QUEUE_SIZE];
+	size_t head;
+	size_t num_queued;
+	bool stop;
+};
+
+static void
+drgn_program_prefetch_request(struct drgn_program *prog,
+			      const struct drgn_prefetch_request *request)
+{
+	struct drgn_prefetcher *prefetcher = prog->prefetcher;
+	uint64_t number = request->address / DRGN_MEMORY_CACHE_BLOCK_SIZE;
+	uint64_t last_number =
+		(request->address + (request->size - 1)) /
+		DRGN_MEMORY_CACHE_BLOCK_SIZE;
+	while (number <= last_number) {
+		/* Don't hold up drgn_prefetcher_destroy() on a long request. */
+		pthread_mutex_lock(&prefetcher->lock);
+		bool stop = prefetcher->stop;
+		pthread_mutex_unlock(&prefetcher->lock);
+		if (stop)
+			break;
+
+		/*
+		 * Use the mutex directly: the blocking callbacks may only be
+		 * called from the threads using the program (e.g., to release
+		 * the Python GIL).
+		 */
+		struct drgn_memory_prefetch prefetch;
+		pthread_mutex_lock(&prog->lock);
+		bool begun = drgn_memory_reader_prefetch_begin(&prog->reader,
+							       number,
+							       last_number,
+							       request->physical,
+							       &prefetch);
+		pthread_mutex_unlock(&prog->lock);
+		if (begun) {
+			/* Read without the lock so that I/O is overlapped. */
+			struct drgn_error *err =
+				drgn_memory_prefetch_read(&prefetch);
+			pthread_mutex_lock(&prog->lock);
+			drgn_memory_reader_prefetch_end(&prog->reader,
+							&prefetch, !err);
+			pthread_mutex_unlock(&prog->lock);
+			drgn_error_destroy(err);
+		}
+		if (prefetch.num_blocks > last_number - number)
+			break;
+		number += prefetch.num_blocks;
+	}
+}
+
+static void *drgn_prefetcher_thread(void *arg)
+{
+	struct drgn_program *prog = arg;
+	struct drgn_prefetcher *prefetcher = prog->prefetcher;
+	pthread_mutex_lock(&prefetcher->lock);
+	for (;;) {
+		while (!prefetcher->num_queued && !prefetcher->stop)
+			pthread_cond_wait(&prefetcher->cond, &prefetcher->lock);
+		if (prefetcher->stop)
+			break;
+		struct drgn_prefetch_request request =
+			prefetcher->queue[prefetcher->head];
+		prefetcher->head =
+			(prefetcher->head + 1) % DRGN_PREFETCH_QUEUE_SIZE;
+		prefetcher->num_queued--;
+		pthread_mutex_unlock(&prefetcher->lock);
+		drgn_program_prefetch_request(prog, &request);
+		pthread_mutex_lock(&prefetcher->lock);
+	}
+	pthread_mutex_unlock(&prefetcher->lock);
+	return NULL;
+}
+
+static void drgn_prefetcher_destroy(struct drgn_prefetcher *prefetcher)
+{
+	if (!prefetcher)
+		return;
+	pthread_mutex_lock(&prefetcher->lock);
+	prefetcher->stop = true;
+	pthread_cond_signal(&prefetcher->cond);
+	pthread_mutex_unlock(&prefetcher->lock);
+	pthread_join(prefetcher->thread, NULL);
+	pthread_cond_destroy(&prefetcher->cond);
+	pthread_mutex_destroy(&prefetcher->lock);
+	free(prefetcher);
+}
+
 void drgn_program_init(struct drgn_program *prog,
 		       const struct drgn_platform *platform)
 {
 	memset(prog, 0, sizeof(*prog));
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&prog->lock, &attr);
+	pthread_mutexattr_destroy(&attr);
 	drgn_memory_reader_init(&prog->reader);
 	drgn_program_init_types(prog);
 	drgn_object_index_init(&prog->oindex);
@@ -103,12 +222,16 @@ void drgn_program_init(struct drgn_program *prog,
 		drgn_program_set_platform(prog, platform);
 	char *env = getenv("DRGN_PREFER_ORC_UNWINDER");
 	prog->prefer_orc_unwinder = env && atoi(env);
+	env = getenv("DRGN_INDEX_TASKS");
+	prog->task_index_disabled = env && !atoi(env);
+	drgn_program_init_pc_cache(prog);
 	drgn_object_init(&prog->page_offset, prog);
 	drgn_object_init(&prog->vmemmap, prog);
 }
 
 void drgn_program_deinit(struct drgn_program *prog)
 {
+	drgn_prefetcher_destroy(prog->prefetcher);
 	if (prog->core_dump_notes_cached) {
 		if (prog->flags & DRGN_PROGRAM_IS_LINUX_KERNEL)
 			drgn_prstatus_vector_deinit(&prog->prstatus_vector);
@@ -125,6 +248,14 @@ void drgn_program_deinit(struct drgn_program *prog)
 	else if (prog->flags & DRGN_PROGRAM_IS_LIVE)
 		drgn_thread_destroy(prog->main_thread);
 	free(prog->pgtable_it);
+	linux_helper_task_index_destroy(prog->task_index);
+	linux_helper_path_cache_destroy(prog->path_cache);
+	drgn_kallsyms_destroy(prog->kallsyms);
+	drgn_error_destroy(prog->kallsyms_err);
+	kernel_module_cache_destroy(prog->kernel_module_cache);
+	free(prog->checkpoint_path);
+	depmod_index_destroy(prog->depmod_index);
+	drgn_program_deinit_pc_cache(prog);
 
 	drgn_object_deinit(&prog->vmemmap);
 	drgn_object_deinit(&prog->page_offset);
@@ -134,16 +265,50 @@ void drgn_program_deinit(struct drgn_program *prog)
 	drgn_memory_reader_deinit(&prog->reader);
 
 	free(prog->file_segments);
+	if (prog->core_map)
+		munmap(prog->core_map, prog->core_map_size);
 
 #ifdef WITH_LIBKDUMPFILE
 	if (prog->kdump_ctx)
 		kdump_free(prog->kdump_ctx);
 #endif
 	elf_end(prog->core);
+	free(prog->core_zstd_headers);
+	drgn_seekable_zstd_destroy(prog->core_zstd);
 	if (prog->core_fd != -1)
 		close(prog->core_fd);
 
 	drgn_debug_info_destroy(prog->dbinfo);
+	free(prog->thread_cpus);
+	pthread_mutex_destroy(&prog->lock);
+}
+
+void drgn_program_lock(struct drgn_program *prog)
+{
+	if (pthread_mutex_trylock(&prog->lock) == 0)
+		return;
+	void *state = NULL;
+	if (prog->begin_blocking_fn)
+		state = prog->begin_blocking_fn(prog, prog->blocking_arg);
+	pthread_mutex_lock(&prog->lock);
+	if (prog->end_blocking_fn)
+		prog->end_blocking_fn(prog, prog->blocking_arg, state);
+}
+
+void drgn_program_unlock(struct drgn_program *prog)
+{
+	pthread_mutex_unlock(&prog->lock);
+}
+
+LIBDRGN_PUBLIC void
+drgn_program_set_blocking_callback(struct drgn_program *prog,
+				   drgn_program_begin_blocking_fn *begin_fn,
+				   drgn_program_end_blocking_fn *end_fn,
+				   void *arg)
+{
+	prog->begin_blocking_fn = begin_fn;
+	prog->end_blocking_fn = end_fn;
+	prog->blocking_arg = arg;
 }
 
 LIBDRGN_PUBLIC struct drgn_error *
@@ -180,16 +345,70 @@ drgn_program_add_memory_segment(struct drgn_program *prog, uint64_t address,
 	if (size == 0 || address > address_mask)
 		return NULL;
 	uint64_t max_address = address + min(size - 1, address_mask - address);
-	return drgn_memory_reader_add_segment(&prog->reader, address,
-					      max_address, read_fn, arg,
-					      physical);
+	enum drgn_memory_segment_kind kind;
+	if (read_fn == drgn_read_memory_file)
+		kind = DRGN_MEMORY_SEGMENT_FILE;
+	else if (read_fn == read_memory_via_pgtable)
+		kind = DRGN_MEMORY_SEGMENT_PAGE_TABLE;
+#ifdef WITH_LIBKDUMPFILE
+	else if (read_fn == drgn_read_kdump)
+		kind = DRGN_MEMORY_SEGMENT_KDUMP;
+#endif
+	else
+		kind = DRGN_MEMORY_SEGMENT_CUSTOM;
+	drgn_program_lock(prog);
+	err = drgn_memory_reader_add_segment(&prog->reader, address,
+					     max_address, read_fn, arg, kind,
+					     physical);
+	drgn_program_unlock(prog);
+	return err;
+}
+
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_program_add_memory_block_segment(struct drgn_program *prog,
+				      uint64_t address, uint64_t size,
+				      drgn_memory_read_blocks_fn read_fn,
+				      void *arg, bool physical)
+{
+	if (address % DRGN_MEMORY_BLOCK_SIZE || size % DRGN_MEMORY_BLOCK_SIZE) {
+		return drgn_error_format(DRGN_ERROR_INVALID_ARGUMENT,
+					 "block segment address and size must be multiples of %d",
+					 DRGN_MEMORY_BLOCK_SIZE);
+	}
+	uint64_t address_mask;
+	struct drgn_error *err = drgn_program_address_mask(prog, &address_mask);
+	if (err)
+		return err;
+	if (size == 0 || address > address_mask)
+		return NULL;
+	uint64_t max_address = address + min(size - 1, address_mask - address);
+	drgn_program_lock(prog);
+	err = drgn_memory_reader_add_block_segment(&prog->reader, address,
+						   max_address, read_fn, arg,
+						   physical);
+	/* Block segments rely on the cache to read each block only once. */
+	if (!err && !prog->reader.cache_size) {
+		size_t cache_size = DRGN_DEFAULT_MEMORY_CACHE_SIZE;
+		drgn_memory_reader_set_cache_size(&prog->reader, cache_size);
+	}
+	drgn_program_unlock(prog);
+	return err;
 }
 
 LIBDRGN_PUBLIC struct drgn_error *
 drgn_program_add_object_finder(struct drgn_program *prog,
 			       drgn_object_find_fn fn, void *arg)
 {
-	return drgn_object_index_add_finder(&prog->oindex, fn, arg);
+	return drgn_object_index_add_finder(&prog->oindex, fn, arg, false,
+					    false);
+}
+
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_program_add_cached_object_finder(struct drgn_program *prog,
+				      drgn_object_find_fn fn, void *arg)
+{
+	return drgn_object_index_add_finder(&prog->oindex, fn, arg, true,
+					    true);
 }
 
 static struct drgn_error *
@@ -202,37 +421,239 @@ drgn_program_check_initialized(struct drgn_program *prog)
 	return NULL;
 }
 
-static struct drgn_error *has_kdump_signature(const char *path, int fd,
-					      bool *ret)
+/*
+ * Read the start of a file to identify its format. If the file is shorter
+ * than the buffer, the rest of the buffer is zeroed.
+ */
+static struct drgn_error *read_core_dump_magic(const char *path, int fd,
+					       char *buf, size_t size)
 {
-	char signature[KDUMP_SIG_LEN];
 	size_t n = 0;
 
-	while (n < sizeof(signature)) {
+	while (n < size) {
 		ssize_t sret;
 
-		sret = pread(fd, signature + n, sizeof(signature) - n, n);
+		sret = pread(fd, buf + n, size - n, n);
 		if (sret == -1) {
 			if (errno == EINTR)
 				continue;
 			return drgn_error_create_os("pread", errno, path);
 		} else if (sret == 0) {
-			*ret = false;
-			return NULL;
+			memset(buf + n, 0, size - n);
+			break;
 		}
 		n += sret;
 	}
-	*ret = memcmp(signature, KDUMP_SIGNATURE, sizeof(signature)) == 0;
 	return NULL;
 }
 
+/* Magic number at the start of a zstd frame, in little endian. */
+#define ZSTD_FRAME_MAGIC "\x28\xb5\x2f\xfd"
+#define ZSTD_FRAME_MAGIC_LEN (sizeof(ZSTD_FRAME_MAGIC) - 1)
+
+/*
+ * Get the end of the ELF header, program header table, and section header
+ * table according to a raw ELF header. libelf can't parse an ELF file from
+ * memory unless all of these are in the image.
+ */
+static uint64_t raw_elf_header_tables_end(char *buf, size_t size)
+{
+	if (size < EI_NIDENT || memcmp(buf, ELFMAG, SELFMAG) != 0)
+		return size;
+
+	Elf_Data src = {
+		.d_buf = buf,
+		.d_type = ELF_T_EHDR,
+		.d_version = EV_CURRENT,
+	};
+	Elf_Data dst = src;
+	uint64_t phoff, shoff;
+	size_t phnum, phentsize, shnum, shentsize, ehsize;
+	if (buf[EI_CLASS] == ELFCLASS64) {
+		Elf64_Ehdr ehdr;
+		src.d_size = dst.d_size = ehsize = sizeof(ehdr);
+		dst.d_buf = &ehdr;
+		if (size < ehsize ||
+		    !elf64_xlatetom(&dst, &src, buf[EI_DATA]))
+			return size;
+		phoff = ehdr.e_phoff;
+		phnum = ehdr.e_phnum;
+		phentsize = ehdr.e_phentsize;
+		shoff = ehdr.e_shoff;
+		shnum = ehdr.e_shnum;
+		shentsize = ehdr.e_shentsize;
+	} else {
+		Elf32_Ehdr ehdr;
+		src.d_size = dst.d_size = ehsize = sizeof(ehdr);
+		dst.d_buf = &ehdr;
+		if (size < ehsize ||
+		    !elf32_xlatetom(&dst, &src, buf[EI_DATA]))
+			return size;
+		phoff = ehdr.e_phoff;
+		phnum = ehdr.e_phnum;
+		phentsize = ehdr.e_phentsize;
+		shoff = ehdr.e_shoff;
+		shnum = ehdr.e_shnum;
+		shentsize = ehdr.e_shentsize;
+	}
+
+	uint64_t end = ehsize;
+	if (phoff && phoff <= UINT64_MAX - phnum * phentsize)
+		end = max(end, phoff + phnum * phentsize);
+	/*
+	 * If there are too many sections or segments to fit in the ELF header,
+	 * the real counts are in the first section header.
+	 */
+	if (!shnum)
+		shnum = 1;
+	if (shoff && shoff <= UINT64_MAX - shnum * shentsize)
+		end = max(end, shoff + shnum * shentsize);
+	return end;
+}
+
+/*
+ * Get the end of the headers and notes of an ELF core dump that is parsed from
+ * memory.
+ */
+static uint64_t elf_core_headers_end(Elf *elf, size_t size)
+{
+	GElf_Ehdr ehdr_mem, *ehdr = gelf_getehdr(elf, &ehdr_mem);
+	size_t phnum;
+	if (!ehdr || elf_getphdrnum(elf, &phnum) != 0)
+		return size;
+	uint64_t end = size;
+	uint64_t phdrs_size = (uint64_t)phnum * ehdr->e_phentsize;
+	if (ehdr->e_phoff <= UINT64_MAX - phdrs_size)
+		end = max(end, ehdr->e_phoff + phdrs_size);
+	if (end > size)
+		return end;
+	for (size_t i = 0; i < phnum; i++) {
+		GElf_Phdr phdr_mem, *phdr = gelf_getphdr(elf, i, &phdr_mem);
+		if (phdr && phdr->p_type == PT_NOTE &&
+		    phdr->p_offset <= UINT64_MAX - phdr->p_filesz)
+			end = max(end, phdr->p_offset + phdr->p_filesz);
+	}
+	return end;
+}
+
+/*
+ * Open a seekable zstd-compressed ELF core dump. libelf can only parse it from
+ * memory, so this decompresses the prefix of the file containing the ELF
+ * headers and notes, which is tiny compared to the memory contents. The
+ * memory segments are decompressed on demand when they are read.
+ */
+static struct drgn_error *
+drgn_program_open_compressed_core_dump(struct drgn_program *prog,
+				       const char *path)
+{
+	struct drgn_error *err;
+
+	err = drgn_seekable_zstd_create(path, prog->core_fd, &prog->core_zstd);
+	if (err)
+		return err;
+	uint64_t total_size = drgn_seekable_zstd_size(prog->core_zstd);
+
+	size_t size = 0;
+	uint64_t needed = sizeof(Elf64_Ehdr);
+	for (;;) {
+		needed = min(needed, total_size);
+		if (needed > size) {
+			if (needed > SIZE_MAX)
+				return &drgn_enomem;
+			/* The image is about to move. */
+			elf_end(prog->core);
+			prog->core = NULL;
+			char *buf = realloc(prog->core_zstd_headers, needed);
+			if (!buf)
+				return &drgn_enomem;
+			prog->core_zstd_headers = buf;
+			err = drgn_seekable_zstd_pread(prog->core_zstd, buf,
+						       needed, 0, &size);
+			if (err)
+				return err;
+		} else if (prog->core) {
+			return NULL;
+		}
+
+		char *headers = prog->core_zstd_headers;
+		if (!prog->core) {
+			needed = raw_elf_header_tables_end(headers, size);
+			if (needed > size)
+				continue;
+			prog->core = elf_memory(headers, size);
+			if (!prog->core)
+				return drgn_error_libelf();
+		}
+		needed = elf_core_headers_end(prog->core, size);
+	}
+}
+
+/*
+ * The segments of a core dump or process don't change once they've been set
+ * up, so search them without modifying the memory reader. Failure isn't fatal;
+ * the reader just falls back to searching the segment trees.
+ */
+static void drgn_program_freeze_memory_segments(struct drgn_program *prog)
+{
+	drgn_memory_reader_freeze(&prog->reader);
+}
+
+/* The contents of a core dump can't change, so it's safe to cache them. */
+static void drgn_program_enable_core_dump_caches(struct drgn_program *prog)
+{
+	drgn_memory_reader_set_cache_size(&prog->reader,
+					  DRGN_DEFAULT_MEMORY_CACHE_SIZE);
+	prog->tlb.enabled = true;
+}
+
+/*
+ * Map an ELF core dump into memory so that reading from it doesn't need a
+ * system call. This is only attempted for regular files. Failure isn't fatal;
+ * segments that aren't mapped are read with pread() instead.
+ */
+static void drgn_program_map_core_dump(struct drgn_program *prog)
+{
+	char *env = getenv("DRGN_USE_MMAP_FOR_CORE_DUMP");
+	if (env && !atoi(env))
+		return;
+
+	struct stat st;
+	if (fstat(prog->core_fd, &st) == -1 || !S_ISREG(st.st_mode) ||
+	    st.st_size == 0 || (uint64_t)st.st_size > SIZE_MAX)
+		return;
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED,
+			 prog->core_fd, 0);
+	if (map == MAP_FAILED)
+		return;
+	prog->core_map = map;
+	prog->core_map_size = st.st_size;
+}
+
+/*
+ * Set where to checkpoint what is found when loading debugging information for
+ * a kernel core dump. This is opt-in because it writes a file next to the core
+ * dump. Failure isn't fatal; it just means there is no checkpoint.
+ */
+static void drgn_program_set_checkpoint_path(struct drgn_program *prog,
+					     const char *path)
+{
+	char *env = getenv("DRGN_CORE_DUMP_CHECKPOINT");
+	if (!env || !atoi(env) ||
+	    (prog->flags & (DRGN_PROGRAM_IS_LINUX_KERNEL |
+			    DRGN_PROGRAM_IS_LIVE)) !=
+	    DRGN_PROGRAM_IS_LINUX_KERNEL)
+		return;
+	if (asprintf(&prog->checkpoint_path, "%s.drgn_checkpoint", path) == -1)
+		prog->checkpoint_path = NULL;
+}
+
 LIBDRGN_PUBLIC struct drgn_error *
 drgn_program_set_core_dump(struct drgn_program *prog, const char *path)
 {
 	struct drgn_error *err;
 	GElf_Ehdr ehdr_mem, *ehdr;
 	bool had_platform;
-	bool is_64_bit, is_kdump;
+	bool is_64_bit, is_kdump, is_zstd;
 	size_t phnum, i;
 	size_t num_file_segments, j;
 	bool have_phys_addrs = false;
@@ -248,22 +669,34 @@ drgn_program_set_core_dump(struct drgn_program *prog, const char *path)
 	if (prog->core_fd == -1)
 		return drgn_error_create_os("open", errno, path);
 
-	err = has_kdump_signature(path, prog->core_fd, &is_kdump);
+	char magic[max_iconst(KDUMP_SIG_LEN, ZSTD_FRAME_MAGIC_LEN)];
+	err = read_core_dump_magic(path, prog->core_fd, magic, sizeof(magic));
 	if (err)
 		goto out_fd;
+	is_kdump = memcmp(magic, KDUMP_SIGNATURE, KDUMP_SIG_LEN) == 0;
+	is_zstd = memcmp(magic, ZSTD_FRAME_MAGIC, ZSTD_FRAME_MAGIC_LEN) == 0;
 	if (is_kdump) {
 		err = drgn_program_set_kdump(prog);
 		if (err)
 			goto out_fd;
+		drgn_program_enable_core_dump_caches(prog);
+		drgn_program_freeze_memory_segments(prog);
+		drgn_program_set_checkpoint_path(prog, path);
 		return NULL;
 	}
 
 	elf_version(EV_CURRENT);
 
-	prog->core = elf_begin(prog->core_fd, ELF_C_READ, NULL);
-	if (!prog->core) {
-		err = drgn_error_libelf();
-		goto out_fd;
+	if (is_zstd) {
+		err = drgn_program_open_compressed_core_dump(prog, path);
+		if (err)
+			goto out_elf;
+	} else {
+		prog->core = elf_begin(prog->core_fd, ELF_C_READ, NULL);
+		if (!prog->core) {
+			err = drgn_error_libelf();
+			goto out_fd;
+		}
 	}
 
 	ehdr = gelf_getehdr(prog->core, &ehdr_mem);
@@ -363,7 +796,18 @@ drgn_program_set_core_dump(struct drgn_program *prog, const char *path)
 		is_proc_kcore = false;
 	}
 
-	if (vmcoreinfo_note && !is_proc_kcore) {
+	/*
+	 * Only the headers and notes of a compressed core dump are available to
+	 * libelf and libdwfl, which is enough for the kernel but not for
+	 * reporting the files mapped in a userspace core dump.
+	 */
+	if (is_zstd && !vmcoreinfo_note) {
+		err = drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+					"compressed core dumps are only supported for Linux kernel vmcores");
+		goto out_platform;
+	}
+
+	if (vmcoreinfo_note && !is_proc_kcore && !is_zstd) {
 		char *env;
 
 		/* Use libkdumpfile for ELF vmcores if it was requested. */
@@ -372,6 +816,8 @@ drgn_program_set_core_dump(struct drgn_program *prog, const char *path)
 			err = drgn_program_set_kdump(prog);
 			if (err)
 				goto out_platform;
+			drgn_program_enable_core_dump_caches(prog);
+			drgn_program_freeze_memory_segments(prog);
 			return NULL;
 		}
 	}
@@ -398,6 +844,9 @@ drgn_program_set_core_dump(struct drgn_program *prog, const char *path)
 			goto out_segments;
 	}
 
+	if (!is_proc_kcore && !is_zstd)
+		drgn_program_map_core_dump(prog);
+
 	/* Second pass: add the segments. */
 	for (i = 0, j = 0; i < phnum && j < num_file_segments; i++) {
 		GElf_Phdr phdr_mem, *phdr;
@@ -413,22 +862,40 @@ drgn_program_set_core_dump(struct drgn_program *prog, const char *path)
 
 		prog->file_segments[j].file_offset = phdr->p_offset;
 		prog->file_segments[j].file_size = phdr->p_filesz;
+		/*
+		 * A truncated core dump may be missing part of the segment.
+		 * Accessing a mapping past the end of the file would crash, so
+		 * fall back to pread(), which reports it as a fault.
+		 */
+		if (prog->core_map &&
+		    phdr->p_offset <= prog->core_map_size &&
+		    phdr->p_filesz <= prog->core_map_size - phdr->p_offset) {
+			prog->file_segments[j].map =
+				(char *)prog->core_map + phdr->p_offset;
+		} else {
+			prog->file_segments[j].map = NULL;
+		}
+		prog->file_segments[j].zstd = prog->core_zstd;
 		prog->file_segments[j].fd = prog->core_fd;
+		prog->file_segments[j].pid = 0;
 		prog->file_segments[j].eio_is_fault = false;
-		err = drgn_program_add_memory_segment(prog, phdr->p_vaddr,
-						      /*
-						       * Don't override the page
-						       * table reader for
-						       * unsaved regions.
-						       */
-						      pgtable_reader ?
-						      phdr->p_filesz :
-						      phdr->p_memsz,
-						      drgn_read_memory_file,
-						      &prog->file_segments[j],
-						      false);
-		if (err)
-			goto out_segments;
+		/*
+		 * A p_vaddr of all ones means that the segment has no virtual
+		 * address. Don't override the page table reader for unsaved
+		 * regions.
+		 */
+		if (phdr->p_vaddr != (is_64_bit ? UINT64_MAX : UINT32_MAX)) {
+			err = drgn_program_add_memory_segment(prog,
+							      phdr->p_vaddr,
+							      pgtable_reader ?
+							      phdr->p_filesz :
+							      phdr->p_memsz,
+							      drgn_read_memory_file,
+							      &prog->file_segments[j],
+							      false);
+			if (err)
+				goto out_segments;
+		}
 		if (have_phys_addrs &&
 		    phdr->p_paddr != (is_64_bit ? UINT64_MAX : UINT32_MAX)) {
 			err = drgn_program_add_memory_segment(prog,
@@ -521,6 +988,10 @@ drgn_program_set_core_dump(struct drgn_program *prog, const char *path)
 		if (!prog->lang)
 			prog->lang = &drgn_language_c;
 	}
+	if (!(prog->flags & DRGN_PROGRAM_IS_LIVE))
+		drgn_program_enable_core_dump_caches(prog);
+	drgn_program_freeze_memory_segments(prog);
+	drgn_program_set_checkpoint_path(prog, path);
 
 	return NULL;
 
@@ -529,11 +1000,19 @@ out_segments:
 	drgn_memory_reader_init(&prog->reader);
 	free(prog->file_segments);
 	prog->file_segments = NULL;
+	if (prog->core_map) {
+		munmap(prog->core_map, prog->core_map_size);
+		prog->core_map = NULL;
+	}
 out_platform:
 	prog->has_platform = had_platform;
 out_elf:
 	elf_end(prog->core);
 	prog->core = NULL;
+	free(prog->core_zstd_headers);
+	prog->core_zstd_headers = NULL;
+	drgn_seekable_zstd_destroy(prog->core_zstd);
+	prog->core_zstd = NULL;
 out_fd:
 	close(prog->core_fd);
 	prog->core_fd = -1;
@@ -573,7 +1052,10 @@ drgn_program_set_pid(struct drgn_program *prog, pid_t pid)
 	}
 	prog->file_segments[0].file_offset = 0;
 	prog->file_segments[0].file_size = UINT64_MAX;
+	prog->file_segments[0].map = NULL;
+	prog->file_segments[0].zstd = NULL;
 	prog->file_segments[0].fd = prog->core_fd;
+	prog->file_segments[0].pid = pid;
 	prog->file_segments[0].eio_is_fault = true;
 	err = drgn_program_add_memory_segment(prog, 0, UINT64_MAX,
 					      drgn_read_memory_file,
@@ -583,6 +1065,7 @@ drgn_program_set_pid(struct drgn_program *prog, pid_t pid)
 
 	prog->pid = pid;
 	prog->flags |= DRGN_PROGRAM_IS_LIVE;
+	drgn_program_freeze_memory_segments(prog);
 	return NULL;
 
 out_segments:
@@ -632,30 +1115,33 @@ static int drgn_set_platform_from_dwarf(Dwfl_Module *module, void **userdatap,
 	return DWARF_CB_ABORT;
 }
 
-LIBDRGN_PUBLIC struct drgn_error *
-drgn_program_load_debug_info(struct drgn_program *prog, const char **paths,
-			     size_t n, bool load_default, bool load_main)
+/* The caller must hold the program lock. */
+static struct drgn_error *
+drgn_program_load_debug_info_locked(struct drgn_program *prog,
+				    const char **paths, size_t n,
+				    bool load_default, bool load_main)
 {
 	struct drgn_error *err;
 
-	if (!n && !load_default && !load_main)
-		return NULL;
-
 	struct drgn_debug_info *dbinfo = prog->dbinfo;
 	if (!dbinfo) {
 		err = drgn_debug_info_create(prog, &dbinfo);
 		if (err)
 			return err;
-		err = drgn_program_add_object_finder(prog,
-						     drgn_debug_info_find_object,
-						     dbinfo);
+		/*
+		 * The debugging information finders only find something new
+		 * after more debugging information is loaded, which
+		 * invalidates their lookups.
+		 */
+		err = drgn_object_index_add_finder(&prog->oindex,
+						   drgn_debug_info_find_object,
+						   dbinfo, false, true);
 		if (err) {
 			drgn_debug_info_destroy(dbinfo);
 			return err;
 		}
-		err = drgn_program_add_type_finder(prog,
-						   drgn_debug_info_find_type,
-						   dbinfo);
+		err = drgn_program_add_type_finder_impl(
+			prog, drgn_debug_info_find_type, dbinfo, false, true);
 		if (err) {
 			drgn_object_index_remove_finder(&prog->oindex);
 			drgn_debug_info_destroy(dbinfo);
@@ -665,6 +1151,10 @@ drgn_program_load_debug_info(struct drgn_program *prog, const char **paths,
 	}
 
 	err = drgn_debug_info_load(dbinfo, paths, n, load_default, load_main);
+	/* The set of modules and types may have changed. */
+	drgn_program_clear_pc_cache(prog);
+	drgn_program_clear_type_name_cache(prog);
+	drgn_object_index_invalidate(&prog->oindex);
 	if ((!err || err->code == DRGN_ERROR_MISSING_DEBUG_INFO)) {
 		if (!prog->lang)
 			drgn_program_set_language_from_main(prog);
@@ -676,6 +1166,55 @@ drgn_program_load_debug_info(struct drgn_program *prog, const char **paths,
 	return err;
 }
 
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_program_load_debug_info(struct drgn_program *prog, const char **paths,
+			     size_t n, bool load_default, bool load_main)
+{
+	if (!n && !load_default && !load_main)
+		return NULL;
+
+	/*
+	 * Loading modifies the debugging information used by the thread-safe
+	 * read paths, so it waits for them.
+	 */
+	drgn_program_lock(prog);
+	struct drgn_error *err =
+		drgn_program_load_debug_info_locked(prog, paths, n,
+						    load_default, load_main);
+	drgn_program_unlock(prog);
+	return err;
+}
+
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_program_unload_debug_info(struct drgn_program *prog, const char *name)
+{
+	struct drgn_error *err;
+	drgn_program_lock(prog);
+	if (prog->dbinfo) {
+		err = drgn_debug_info_unload(prog->dbinfo, name);
+	} else {
+		err = drgn_error_format(DRGN_ERROR_LOOKUP,
+					"debugging information for '%s' is not loaded",
+					name);
+	}
+	if (!err) {
+		/* The set of modules and types may have changed. */
+		drgn_program_clear_pc_cache(prog);
+		drgn_program_clear_type_name_cache(prog);
+		drgn_object_index_invalidate(&prog->oindex);
+	}
+	drgn_program_unlock(prog);
+	return err;
+}
+
+LIBDRGN_PUBLIC void
+drgn_program_set_debug_file_fetcher(struct drgn_program *prog,
+				    drgn_debug_file_fetch_fn *fn, void *arg)
+{
+	prog->debug_file_fetch_fn = fn;
+	prog->debug_file_fetch_arg = arg;
+}
+
 static struct drgn_error *get_prstatus_pid(struct drgn_program *prog, const char *data,
 					   size_t size, uint32_t *ret)
 {
@@ -1485,99 +2024,605 @@ drgn_program_from_pid(pid_t pid, struct drgn_program **ret)
 	return NULL;
 }
 
-LIBDRGN_PUBLIC struct drgn_error *
-drgn_program_read_memory(struct drgn_program *prog, void *buf, uint64_t address,
-			 size_t count, bool physical)
+/*
+ * Requests in a batch that are at most this many bytes apart are combined into
+ * one read, up to a maximum total size.
+ */
+static const uint64_t DRGN_READ_BATCH_MAX_GAP = 4096;
+static const uint64_t DRGN_READ_BATCH_MAX_SPAN = 1024 * 1024;
+
+static int drgn_memory_read_request_cmp(const void *_a, const void *_b)
 {
-	uint64_t address_mask;
-	struct drgn_error *err = drgn_program_address_mask(prog, &address_mask);
-	if (err)
-		return err;
-	char *p = buf;
-	address &= address_mask;
-	while (count > 0) {
-		size_t n = min((uint64_t)(count - 1), address_mask - address) + 1;
-		err = drgn_memory_reader_read(&prog->reader, p, address, n,
-					      physical);
-		if (err)
-			return err;
-		p += n;
-		address = 0;
-		count -= n;
-	}
-	return NULL;
+	const struct drgn_memory_read_request *a =
+		*(struct drgn_memory_read_request * const *)_a;
+	const struct drgn_memory_read_request *b =
+		*(struct drgn_memory_read_request * const *)_b;
+	if (a->address < b->address)
+		return -1;
+	else if (a->address > b->address)
+		return 1;
+	else
+		return 0;
 }
 
-DEFINE_VECTOR(char_vector, char)
-
 LIBDRGN_PUBLIC struct drgn_error *
-drgn_program_read_c_string(struct drgn_program *prog, uint64_t address,
-			   bool physical, size_t max_size, char **ret)
+drgn_program_read_memory_batch(struct drgn_program *prog,
+			       struct drgn_memory_read_request *requests,
+			       size_t num_requests, bool physical)
 {
+	struct drgn_error *err;
+
+	for (size_t i = 0; i < num_requests; i++)
+		requests[i].err = NULL;
+
 	uint64_t address_mask;
-	struct drgn_error *err = drgn_program_address_mask(prog, &address_mask);
+	err = drgn_program_address_mask(prog, &address_mask);
 	if (err)
 		return err;
-	struct char_vector str = VECTOR_INIT;
-	for (;;) {
-		address &= address_mask;
-		char *c = char_vector_append_entry(&str);
-		if (!c) {
-			char_vector_deinit(&str);
-			return &drgn_enomem;
+
+	/*
+	 * Sort the requests that can be combined by address. Requests that
+	 * reach the end of the address space (and may wrap around) or are too
+	 * large to combine are read individually.
+	 */
+	struct drgn_memory_read_request **sorted =
+		malloc_array(num_requests, sizeof(*sorted));
+	if (!sorted)
+		return &drgn_enomem;
+	size_t num_sorted = 0;
+	for (size_t i = 0; i < num_requests; i++) {
+		struct drgn_memory_read_request *request = &requests[i];
+		if (request->count == 0)
+			continue;
+		uint64_t address = request->address & address_mask;
+		if (request->count > address_mask - address ||
+		    request->count > DRGN_READ_BATCH_MAX_SPAN) {
+			request->err = drgn_program_read_memory(prog,
+								request->buf,
+								request->address,
+								request->count,
+								physical);
+		} else {
+			sorted[num_sorted++] = request;
 		}
-		if (str.size <= max_size) {
-			err = drgn_memory_reader_read(&prog->reader, c, address,
-						      1, physical);
-			if (err) {
-				char_vector_deinit(&str);
-				return err;
-			}
-			if (!*c)
+	}
+	qsort(sorted, num_sorted, sizeof(sorted[0]),
+	      drgn_memory_read_request_cmp);
+
+	char *span_buf = NULL;
+	size_t span_buf_size = 0;
+	size_t i = 0;
+	drgn_program_lock(prog);
+	while (i < num_sorted) {
+		uint64_t start = sorted[i]->address & address_mask;
+		uint64_t end = start + sorted[i]->count;
+		size_t j;
+		for (j = i + 1; j < num_sorted; j++) {
+			uint64_t next_start = sorted[j]->address & address_mask;
+			uint64_t next_end = next_start + sorted[j]->count;
+			if (next_start > end &&
+			    next_start - end > DRGN_READ_BATCH_MAX_GAP)
 				break;
-		} else {
-			*c = '\0';
-			break;
+			if (max(end, next_end) - start > DRGN_READ_BATCH_MAX_SPAN)
+				break;
+			end = max(end, next_end);
+		}
+
+		bool read_span = false;
+		if (j - i > 1) {
+			size_t size = end - start;
+			if (size > span_buf_size) {
+				char *tmp = realloc(span_buf, size);
+				if (tmp) {
+					span_buf = tmp;
+					span_buf_size = size;
+				}
+			}
+			if (size <= span_buf_size) {
+				err = drgn_memory_reader_read(&prog->reader,
+							      span_buf, start,
+							      size, physical);
+				if (err)
+					drgn_error_destroy(err);
+				else
+					read_span = true;
+			}
+		}
+		for (; i < j; i++) {
+			struct drgn_memory_read_request *request = sorted[i];
+			uint64_t address = request->address & address_mask;
+			drgn_program_account_memory_read(prog, address,
+							 request->count,
+							 physical);
+			if (read_span) {
+				memcpy(request->buf, span_buf + (address - start),
+				       request->count);
+			} else {
+				/*
+				 * Fall back to reading individually so that
+				 * each request gets its own error.
+				 */
+				request->err =
+					drgn_memory_reader_read(&prog->reader,
+								request->buf,
+								address,
+								request->count,
+								physical);
+			}
 		}
-		address++;
 	}
-	char_vector_shrink_to_fit(&str);
-	*ret = str.data;
+	drgn_program_unlock(prog);
+	free(span_buf);
+	free(sorted);
 	return NULL;
 }
 
-LIBDRGN_PUBLIC struct drgn_error *
-drgn_program_read_u8(struct drgn_program *prog, uint64_t address, bool physical,
-		     uint8_t *ret)
+LIBDRGN_PUBLIC size_t drgn_program_memory_cache_size(struct drgn_program *prog)
 {
-	return drgn_program_read_memory(prog, ret, address, sizeof(*ret),
-					physical);
+	return prog->reader.cache_size;
 }
 
-#define DEFINE_PROGRAM_READ_U(n)						\
-LIBDRGN_PUBLIC struct drgn_error *						\
-drgn_program_read_u##n(struct drgn_program *prog, uint64_t address,		\
-		       bool physical, uint##n##_t *ret)				\
-{										\
-	bool bswap;								\
-	struct drgn_error *err = drgn_program_bswap(prog, &bswap);		\
-	if (err)								\
-		return err;							\
-	uint##n##_t tmp;							\
-	err = drgn_program_read_memory(prog, &tmp, address, sizeof(tmp),	\
-				       physical);				\
-	if (err)								\
-		return err;							\
-	if (bswap)								\
-		tmp = bswap_##n(tmp);						\
-	*ret = tmp;								\
-	return NULL;								\
+LIBDRGN_PUBLIC void drgn_program_set_memory_cache_size(struct drgn_program *prog,
+						       size_t size)
+{
+	drgn_program_lock(prog);
+	drgn_memory_reader_set_cache_size(&prog->reader, size);
+	drgn_program_unlock(prog);
 }
 
-DEFINE_PROGRAM_READ_U(16)
-DEFINE_PROGRAM_READ_U(32)
-DEFINE_PROGRAM_READ_U(64)
-#undef DEFINE_PROGRAM_READ_U
+LIBDRGN_PUBLIC void
+drgn_program_memory_cache_stats(struct drgn_program *prog, uint64_t *hits_ret,
+				uint64_t *misses_ret)
+{
+	*hits_ret = prog->reader.cache_hits;
+	*misses_ret = prog->reader.cache_misses;
+}
+
+LIBDRGN_PUBLIC void
+drgn_program_invalidate_memory_cache(struct drgn_program *prog)
+{
+	drgn_program_lock(prog);
+	drgn_memory_reader_invalidate_cache(&prog->reader);
+	drgn_program_unlock(prog);
+	drgn_program_invalidate_translation_cache(prog);
+}
+
+/* Start the prefetch thread if it isn't running. Returns whether it is. */
+static bool drgn_program_start_prefetcher(struct drgn_program *prog)
+{
+	bool ret = true;
+	drgn_program_lock(prog);
+	if (prog->prefetcher)
+		goto out;
+	struct drgn_prefetcher *prefetcher = calloc(1, sizeof(*prefetcher));
+	if (!prefetcher) {
+		ret = false;
+		goto out;
+	}
+	pthread_mutex_init(&prefetcher->lock, NULL);
+	pthread_cond_init(&prefetcher->cond, NULL);
+	prog->prefetcher = prefetcher;
+	if (pthread_create(&prefetcher->thread, NULL, drgn_prefetcher_thread,
+			   prog)) {
+		prog->prefetcher = NULL;
+		pthread_cond_destroy(&prefetcher->cond);
+		pthread_mutex_destroy(&prefetcher->lock);
+		free(prefetcher);
+		ret = false;
+	}
+out:
+	drgn_program_unlock(prog);
+	return ret;
+}
+
+LIBDRGN_PUBLIC void drgn_program_prefetch(struct drgn_program *prog,
+					  uint64_t address, uint64_t size,
+					  bool physical)
+{
+	if (size == 0 || !prog->reader.cache_size || !prog->has_platform)
+		return;
+	uint64_t address_mask = drgn_platform_address_mask(&prog->platform);
+	if (!drgn_program_start_prefetcher(prog))
+		return;
+	address &= address_mask;
+	/* Don't read more than could be cached or past the end. */
+	size = min(size, (uint64_t)prog->reader.cache_size);
+	size = min(size - 1, address_mask - address) + 1;
+
+	struct drgn_prefetcher *prefetcher = prog->prefetcher;
+	pthread_mutex_lock(&prefetcher->lock);
+	/* Drop the oldest request if the queue is full. */
+	if (prefetcher->num_queued == DRGN_PREFETCH_QUEUE_SIZE) {
+		prefetcher->head =
+			(prefetcher->head + 1) % DRGN_PREFETCH_QUEUE_SIZE;
+		prefetcher->num_queued--;
+	}
+	struct drgn_prefetch_request *request =
+		&prefetcher->queue[(prefetcher->head + prefetcher->num_queued) %
+				   DRGN_PREFETCH_QUEUE_SIZE];
+	request->address = address;
+	request->size = size;
+	request->physical = physical;
+	prefetcher->num_queued++;
+	pthread_cond_signal(&prefetcher->cond);
+	pthread_mutex_unlock(&prefetcher->lock);
+}
+
+LIBDRGN_PUBLIC bool
+drgn_program_translation_cache_enabled(struct drgn_program *prog)
+{
+	return prog->tlb.enabled;
+}
+
+LIBDRGN_PUBLIC void
+drgn_program_set_translation_cache_enabled(struct drgn_program *prog,
+					   bool enabled)
+{
+	if (!enabled)
+		drgn_program_invalidate_translation_cache(prog);
+	prog->tlb.enabled = enabled;
+}
+
+LIBDRGN_PUBLIC void
+drgn_program_invalidate_translation_cache(struct drgn_program *prog)
+{
+	memset(prog->tlb.entries, 0, sizeof(prog->tlb.entries));
+	prog->tlb.page_shifts = 0;
+}
+
+LIBDRGN_PUBLIC void
+drgn_program_translation_cache_stats(struct drgn_program *prog,
+				     uint64_t *hits_ret, uint64_t *misses_ret)
+{
+	*hits_ret = prog->tlb.hits;
+	*misses_ret = prog->tlb.misses;
+}
+
+LIBDRGN_PUBLIC void drgn_program_stats(struct drgn_program *prog,
+				       struct drgn_program_stats *ret)
+{
+	drgn_program_lock(prog);
+	*ret = prog->stats;
+	memcpy(ret->segment_reads, prog->reader.segment_reads,
+	       sizeof(ret->segment_reads));
+	memcpy(ret->segment_read_bytes, prog->reader.segment_read_bytes,
+	       sizeof(ret->segment_read_bytes));
+	ret->memory_cache_hits = prog->reader.cache_hits;
+	ret->memory_cache_misses = prog->reader.cache_misses;
+	ret->translation_cache_hits = prog->tlb.hits;
+	ret->translation_cache_misses = prog->tlb.misses;
+	if (prog->dbinfo) {
+		const struct drgn_debug_info_timings *timings =
+			&prog->dbinfo->timings;
+		ret->read_modules_ns = timings->read_modules;
+		ret->dwarf_index_first_pass_ns = timings->first_pass;
+		ret->dwarf_index_second_pass_ns = timings->second_pass;
+		ret->dwarf_index_debug_names_ns = timings->debug_names;
+	}
+	drgn_program_unlock(prog);
+}
+
+LIBDRGN_PUBLIC void drgn_program_reset_stats(struct drgn_program *prog)
+{
+	drgn_program_lock(prog);
+	memset(&prog->stats, 0, sizeof(prog->stats));
+	memset(prog->reader.segment_reads, 0,
+	       sizeof(prog->reader.segment_reads));
+	memset(prog->reader.segment_read_bytes, 0,
+	       sizeof(prog->reader.segment_read_bytes));
+	prog->reader.cache_hits = 0;
+	prog->reader.cache_misses = 0;
+	prog->tlb.hits = 0;
+	prog->tlb.misses = 0;
+	if (prog->dbinfo) {
+		memset(&prog->dbinfo->timings, 0,
+		       sizeof(prog->dbinfo->timings));
+	}
+	drgn_program_unlock(prog);
+}
+
+LIBDRGN_PUBLIC void
+drgn_program_set_memory_read_trace(struct drgn_program *prog,
+				   drgn_memory_read_trace_fn *fn, void *arg)
+{
+	drgn_program_lock(prog);
+	prog->memory_read_trace_arg = arg;
+	prog->memory_read_trace_fn = fn;
+	drgn_program_unlock(prog);
+}
+
+LIBDRGN_PUBLIC int drgn_program_num_threads(struct drgn_program *prog)
+{
+	return prog->num_threads;
+}
+
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_program_set_num_threads(struct drgn_program *prog, int num_threads)
+{
+	if (num_threads < 0) {
+		return drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+					 "invalid number of threads");
+	}
+	prog->num_threads = num_threads;
+	return NULL;
+}
+
+LIBDRGN_PUBLIC void drgn_program_thread_cpus(struct drgn_program *prog,
+					     const int **cpus_ret,
+					     size_t *num_cpus_ret)
+{
+	*cpus_ret = prog->thread_cpus;
+	*num_cpus_ret = prog->num_thread_cpus;
+}
+
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_program_set_thread_cpus(struct drgn_program *prog, const int *cpus,
+			     size_t num_cpus)
+{
+	static uint64_t next_generation = 1;
+
+	/* Deduplicate and sort the CPUs. */
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (size_t i = 0; i < num_cpus; i++) {
+		if (cpus[i] < 0 || cpus[i] >= CPU_SETSIZE) {
+			return drgn_error_format(DRGN_ERROR_INVALID_ARGUMENT,
+						 "invalid CPU %d", cpus[i]);
+		}
+		CPU_SET(cpus[i], &set);
+	}
+	int count = CPU_COUNT(&set);
+	int *thread_cpus = NULL;
+	if (count) {
+		thread_cpus = malloc_array(count, sizeof(thread_cpus[0]));
+		if (!thread_cpus)
+			return &drgn_enomem;
+		for (int cpu = 0, i = 0; i < count; cpu++) {
+			if (CPU_ISSET(cpu, &set))
+				thread_cpus[i++] = cpu;
+		}
+	}
+	free(prog->thread_cpus);
+	prog->thread_cpus = thread_cpus;
+	prog->num_thread_cpus = count;
+	/*
+	 * Worker threads are shared between programs, so each set gets a
+	 * globally unique generation.
+	 */
+	prog->thread_cpus_generation =
+		count ? __atomic_fetch_add(&next_generation, 1,
+					   __ATOMIC_RELAXED) : 0;
+	return NULL;
+}
+
+int drgn_program_num_parallel_threads(struct drgn_program *prog)
+{
+#ifdef _OPENMP
+	if (prog->num_threads)
+		return prog->num_threads;
+	if (prog->num_thread_cpus)
+		return prog->num_thread_cpus;
+	return omp_get_max_threads();
+#else
+	return 1;
+#endif
+}
+
+/*
+ * Generation of the CPU set that the current thread is bound to, or 0 if its
+ * affinity is unchanged.
+ */
+static _Thread_local uint64_t drgn_bound_thread_cpus_generation;
+/* Affinity of the current thread before it was first bound. */
+static _Thread_local cpu_set_t drgn_original_thread_cpus;
+
+void drgn_program_bind_parallel_thread(struct drgn_program *prog)
+{
+	uint64_t generation = prog->thread_cpus_generation;
+	if (generation == drgn_bound_thread_cpus_generation ||
+	    omp_get_thread_num() == 0)
+		return;
+	if (generation) {
+		if (!drgn_bound_thread_cpus_generation &&
+		    pthread_getaffinity_np(pthread_self(),
+					   sizeof(drgn_original_thread_cpus),
+					   &drgn_original_thread_cpus))
+			return;
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (size_t i = 0; i < prog->num_thread_cpus; i++)
+			CPU_SET(prog->thread_cpus[i], &set);
+		/* This is best-effort, so ignore errors. */
+		pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	} else {
+		pthread_setaffinity_np(pthread_self(),
+				       sizeof(drgn_original_thread_cpus),
+				       &drgn_original_thread_cpus);
+	}
+	drgn_bound_thread_cpus_generation = generation;
+}
+
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_program_read_memory(struct drgn_program *prog, void *buf, uint64_t address,
+			 size_t count, bool physical)
+{
+	uint64_t address_mask;
+	struct drgn_error *err = drgn_program_address_mask(prog, &address_mask);
+	if (err)
+		return err;
+	address &= address_mask;
+	/*
+	 * Reads from mapped memory in a frozen memory reader don't modify any
+	 * state, so they don't need the lock.
+	 */
+	if (prog->reader.frozen) {
+		const void *mapping = drgn_program_borrow_memory(prog, address,
+								 count,
+								 physical);
+		if (mapping) {
+			memcpy(buf, mapping, count);
+			return NULL;
+		}
+	}
+	drgn_program_account_memory_read(prog, address, count, physical);
+	char *p = buf;
+	drgn_program_lock(prog);
+	while (count > 0) {
+		size_t n = min((uint64_t)(count - 1), address_mask - address) + 1;
+		err = drgn_memory_reader_read(&prog->reader, p, address, n,
+					      physical);
+		if (err)
+			break;
+		p += n;
+		address = 0;
+		count -= n;
+	}
+	drgn_program_unlock(prog);
+	return err;
+}
+
+const void *drgn_program_borrow_memory(struct drgn_program *prog,
+				       uint64_t address, size_t count,
+				       bool physical)
+{
+	uint64_t address_mask;
+	if (count == 0 || drgn_program_address_mask(prog, &address_mask))
+		return NULL;
+	address &= address_mask;
+	/* Reads that wrap around can't be borrowed. */
+	if (count - 1 > address_mask - address)
+		return NULL;
+	const void *ret;
+	/* Searching an unfrozen memory reader modifies it. */
+	if (prog->reader.frozen) {
+		ret = drgn_memory_reader_borrow(&prog->reader, address, count,
+						physical);
+	} else {
+		drgn_program_lock(prog);
+		ret = drgn_memory_reader_borrow(&prog->reader, address, count,
+						physical);
+		drgn_program_unlock(prog);
+	}
+	if (ret) {
+		drgn_program_account_memory_read(prog, address, count,
+						 physical);
+		drgn_memory_reader_count_mapped_read(&prog->reader, count);
+	}
+	return ret;
+}
+
+/*
+ * Chunks are aligned to the smallest page size so that they don't cross into a
+ * page that may not be mapped.
+ */
+#define DRGN_C_STRING_CHUNK_SIZE 4096
+
+struct drgn_error *
+drgn_program_read_c_string_chunks(struct drgn_program *prog, uint64_t address,
+				  bool physical, uint64_t max_size,
+				  drgn_c_string_chunk_fn *fn, void *arg)
+{
+	uint64_t address_mask;
+	struct drgn_error *err = drgn_program_address_mask(prog, &address_mask);
+	if (err)
+		return err;
+	char buf[DRGN_C_STRING_CHUNK_SIZE];
+	while (max_size) {
+		address &= address_mask;
+		size_t n = min(max_size,
+			       DRGN_C_STRING_CHUNK_SIZE -
+			       address % DRGN_C_STRING_CHUNK_SIZE);
+		err = drgn_program_read_memory(prog, buf, address, n, physical);
+		if (err && err->code == DRGN_ERROR_FAULT && n > 1) {
+			/*
+			 * The chunk may extend past the end of the string's
+			 * segment. Read it a byte at a time up to the null
+			 * byte.
+			 */
+			drgn_error_destroy(err);
+			for (size_t i = 0; i < n; i++) {
+				err = drgn_program_read_memory(prog, &buf[i],
+							       address + i, 1,
+							       physical);
+				if (err)
+					return err;
+				if (!buf[i])
+					break;
+			}
+		} else if (err) {
+			return err;
+		}
+		const char *nul = memchr(buf, '\0', n);
+		size_t len = nul ? nul - buf : n;
+		if (len) {
+			err = fn(buf, len, arg);
+			if (err)
+				return err;
+		}
+		if (nul)
+			break;
+		address += n;
+		max_size -= n;
+	}
+	return NULL;
+}
+
+static struct drgn_error *append_c_string_chunk(const char *chunk,
+						size_t size, void *arg)
+{
+	if (!string_builder_appendn(arg, chunk, size))
+		return &drgn_enomem;
+	return NULL;
+}
+
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_program_read_c_string(struct drgn_program *prog, uint64_t address,
+			   bool physical, size_t max_size, char **ret)
+{
+	struct drgn_error *err;
+	struct string_builder str = {};
+	err = drgn_program_read_c_string_chunks(prog, address, physical,
+						max_size, append_c_string_chunk,
+						&str);
+	if (!err && !string_builder_finalize(&str, ret))
+		err = &drgn_enomem;
+	if (err)
+		free(str.str);
+	return err;
+}
+
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_program_read_u8(struct drgn_program *prog, uint64_t address, bool physical,
+		     uint8_t *ret)
+{
+	return drgn_program_read_memory(prog, ret, address, sizeof(*ret),
+					physical);
+}
+
+#define DEFINE_PROGRAM_READ_U(n)						\
+LIBDRGN_PUBLIC struct drgn_error *						\
+drgn_program_read_u##n(struct drgn_program *prog, uint64_t address,		\
+		       bool physical, uint##n##_t *ret)				\
+{										\
+	bool bswap;								\
+	struct drgn_error *err = drgn_program_bswap(prog, &bswap);		\
+	if (err)								\
+		return err;							\
+	uint##n##_t tmp;							\
+	err = drgn_program_read_memory(prog, &tmp, address, sizeof(tmp),	\
+				       physical);				\
+	if (err)								\
+		return err;							\
+	if (bswap)								\
+		tmp = bswap_##n(tmp);						\
+	*ret = tmp;								\
+	return NULL;								\
+}
+
+DEFINE_PROGRAM_READ_U(16)
+DEFINE_PROGRAM_READ_U(32)
+DEFINE_PROGRAM_READ_U(64)
+#undef DEFINE_PROGRAM_READ_U
 
 LIBDRGN_PUBLIC struct drgn_error *
 drgn_program_read_word(struct drgn_program *prog, uint64_t address,
@@ -1612,6 +2657,44 @@ drgn_program_read_word(struct drgn_program *prog, uint64_t address,
 	return NULL;
 }
 
+/*
+ * Finish a read done with quiet faults, turning a fault into faulted_ret.
+ */
+static struct drgn_error *drgn_try_read_result(struct drgn_error *err,
+					       bool *faulted_ret)
+{
+	if (err && err->code == DRGN_ERROR_FAULT) {
+		drgn_error_destroy(err);
+		*faulted_ret = true;
+		return NULL;
+	}
+	*faulted_ret = false;
+	return err;
+}
+
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_program_try_read_memory(struct drgn_program *prog, void *buf,
+			     uint64_t address, size_t count, bool physical,
+			     bool *faulted_ret)
+{
+	drgn_quiet_faults++;
+	struct drgn_error *err = drgn_program_read_memory(prog, buf, address,
+							  count, physical);
+	drgn_quiet_faults--;
+	return drgn_try_read_result(err, faulted_ret);
+}
+
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_program_try_read_word(struct drgn_program *prog, uint64_t address,
+			   bool physical, uint64_t *ret, bool *faulted_ret)
+{
+	drgn_quiet_faults++;
+	struct drgn_error *err = drgn_program_read_word(prog, address,
+							physical, ret);
+	drgn_quiet_faults--;
+	return drgn_try_read_result(err, faulted_ret);
+}
+
 LIBDRGN_PUBLIC struct drgn_error *
 drgn_program_find_object(struct drgn_program *prog, const char *name,
 			 const char *filename,
@@ -1622,8 +2705,42 @@ drgn_program_find_object(struct drgn_program *prog, const char *name,
 		return drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
 					 "object is from wrong program");
 	}
-	return drgn_object_index_find(&prog->oindex, name, filename, flags,
-				      ret);
+	drgn_program_lock(prog);
+	struct drgn_error *err = drgn_object_index_find(&prog->oindex, name,
+							filename, flags, ret);
+	drgn_program_unlock(prog);
+	return err;
+}
+
+/*
+ * Get the kallsyms index of a live kernel, or NULL if it isn't available. This
+ * is used as a fallback symbol source, so errors are ignored.
+ */
+static struct drgn_kallsyms *
+drgn_program_fallback_kallsyms(struct drgn_program *prog)
+{
+	struct drgn_kallsyms *kallsyms;
+	struct drgn_error *err = drgn_program_kallsyms(prog, &kallsyms);
+	if (err) {
+		drgn_error_destroy(err);
+		return NULL;
+	}
+	return kallsyms;
+}
+
+static bool drgn_program_find_kallsyms_by_address(struct drgn_program *prog,
+						  uint64_t address,
+						  struct drgn_symbol *ret)
+{
+	struct drgn_kallsyms *kallsyms = drgn_program_fallback_kallsyms(prog);
+	if (!kallsyms)
+		return false;
+	const struct drgn_kallsyms_symbol *ksym =
+		drgn_kallsyms_find_by_address(kallsyms, address);
+	if (!ksym)
+		return false;
+	drgn_symbol_from_kallsyms(ksym, ret);
+	return true;
 }
 
 bool drgn_program_find_symbol_by_address_internal(struct drgn_program *prog,
@@ -1631,24 +2748,22 @@ bool drgn_program_find_symbol_by_address_internal(struct drgn_program *prog,
 						  Dwfl_Module *module,
 						  struct drgn_symbol *ret)
 {
-	if (!module) {
-		if (prog->dbinfo) {
-			module = dwfl_addrmodule(prog->dbinfo->dwfl, address);
-			if (!module)
-				return false;
-		} else {
-			return false;
+	if (!module && prog->dbinfo)
+		module = dwfl_addrmodule(prog->dbinfo->dwfl, address);
+	if (module) {
+		GElf_Off offset;
+		GElf_Sym elf_sym;
+		const char *name = dwfl_module_addrinfo(module, address,
+							&offset, &elf_sym,
+							NULL, NULL, NULL);
+		if (name) {
+			drgn_symbol_from_elf(name, address - offset, &elf_sym,
+					     ret);
+			return true;
 		}
 	}
-
-	GElf_Off offset;
-	GElf_Sym elf_sym;
-	const char *name = dwfl_module_addrinfo(module, address, &offset,
-						&elf_sym, NULL, NULL, NULL);
-	if (!name)
-		return false;
-	drgn_symbol_from_elf(name, address - offset, &elf_sym, ret);
-	return true;
+	/* Fall back to kallsyms for live kernels without symbol tables. */
+	return drgn_program_find_kallsyms_by_address(prog, address, ret);
 }
 
 struct drgn_error *drgn_error_symbol_not_found(uint64_t address)
@@ -1676,6 +2791,111 @@ drgn_program_find_symbol_by_address(struct drgn_program *prog, uint64_t address,
 	return NULL;
 }
 
+struct drgn_symbolize_entry {
+	uint64_t address;
+	size_t index;
+};
+
+static int drgn_symbolize_entry_compare(const void *_a, const void *_b)
+{
+	const struct drgn_symbolize_entry *a = _a;
+	const struct drgn_symbolize_entry *b = _b;
+	if (a->address != b->address)
+		return a->address < b->address ? -1 : 1;
+	return 0;
+}
+
+static void drgn_symbolize_address(Dwfl_Module *module, uint64_t address,
+				   struct drgn_symbolized_address *ret)
+{
+	GElf_Off offset;
+	GElf_Sym elf_sym;
+	ret->name = dwfl_module_addrinfo(module, address, &offset, &elf_sym,
+					 NULL, NULL, NULL);
+	if (ret->name) {
+		ret->offset = offset;
+		ret->size = elf_sym.st_size;
+	}
+	Dwfl_Line *line = dwfl_module_getsrc(module, address);
+	if (line) {
+		ret->filename = dwfl_lineinfo(line, NULL, &ret->line,
+					      &ret->column, NULL, NULL);
+	}
+}
+
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_program_symbolize(struct drgn_program *prog, const uint64_t *addresses,
+		       size_t count, struct drgn_symbolized_address *ret)
+{
+	memset(ret, 0, count * sizeof(ret[0]));
+	if (!count)
+		return NULL;
+	/* kallsyms is parsed the first time that it is needed. */
+	struct drgn_kallsyms *kallsyms = NULL;
+	bool kallsyms_tried = false;
+	if (!prog->dbinfo) {
+		kallsyms = drgn_program_fallback_kallsyms(prog);
+		if (!kallsyms)
+			return NULL;
+		kallsyms_tried = true;
+	}
+
+	struct drgn_symbolize_entry *sorted =
+		malloc_array(count, sizeof(sorted[0]));
+	if (!sorted)
+		return &drgn_enomem;
+	for (size_t i = 0; i < count; i++) {
+		sorted[i].address = addresses[i];
+		sorted[i].index = i;
+	}
+	qsort(sorted, count, sizeof(sorted[0]), drgn_symbolize_entry_compare);
+
+	/*
+	 * Walk the addresses in order so that consecutive addresses in the same
+	 * module reuse the module lookup.
+	 */
+	Dwfl_Module *module = NULL;
+	Dwarf_Addr module_start = 0, module_end = 0;
+	const struct drgn_symbolized_address *prev = NULL;
+	for (size_t i = 0; i < count; i++) {
+		uint64_t address = sorted[i].address;
+		struct drgn_symbolized_address *result = &ret[sorted[i].index];
+		if (prev && address == sorted[i - 1].address) {
+			*result = *prev;
+			continue;
+		}
+		prev = result;
+		if (prog->dbinfo &&
+		    (!module || address < module_start ||
+		     address >= module_end)) {
+			module = dwfl_addrmodule(prog->dbinfo->dwfl, address);
+			if (module) {
+				dwfl_module_info(module, NULL, &module_start,
+						 &module_end, NULL, NULL, NULL,
+						 NULL);
+			}
+		}
+		if (module)
+			drgn_symbolize_address(module, address, result);
+		if (!result->name && !kallsyms_tried) {
+			kallsyms = drgn_program_fallback_kallsyms(prog);
+			kallsyms_tried = true;
+		}
+		if (!result->name && kallsyms) {
+			const struct drgn_kallsyms_symbol *ksym =
+				drgn_kallsyms_find_by_address(kallsyms,
+							      address);
+			if (ksym) {
+				result->name = ksym->name;
+				result->offset = address - ksym->address;
+				result->size = ksym->size;
+			}
+		}
+	}
+	free(sorted);
+	return NULL;
+}
+
 DEFINE_VECTOR(symbolp_vector, struct drgn_symbol *)
 
 enum {
@@ -1691,22 +2911,31 @@ struct symbols_search_arg {
 	unsigned int flags;
 };
 
-static bool symbol_match(struct symbols_search_arg *arg, GElf_Addr addr,
-			 const GElf_Sym *sym, const char *name)
+static bool symbols_search_append(struct symbols_search_arg *arg,
+				  Dwfl_Module *dwfl_module, int sym_idx)
 {
-	if (arg->flags & SYMBOLS_SEARCH_ALL)
-		return true;
-	if ((arg->flags & SYMBOLS_SEARCH_NAME) && strcmp(name, arg->name) == 0)
-		return true;
-	if ((arg->flags & SYMBOLS_SEARCH_ADDRESS) &&
-	    arg->address >= addr && arg->address < addr + sym->st_size)
+	GElf_Sym elf_sym;
+	GElf_Addr elf_addr;
+	const char *name = dwfl_module_getsym_info(dwfl_module, sym_idx,
+						   &elf_sym, &elf_addr, NULL,
+						   NULL, NULL);
+	if (!name)
 		return true;
-	return false;
+
+	struct drgn_symbol *sym = malloc(sizeof(*sym));
+	if (!sym)
+		return false;
+	drgn_symbol_from_elf(name, elf_addr, &elf_sym, sym);
+	if (!symbolp_vector_append(&arg->results, &sym)) {
+		drgn_symbol_destroy(sym);
+		return false;
+	}
+	return true;
 }
 
-static int symbols_search_cb(Dwfl_Module *dwfl_module, void **userdatap,
-			     const char *module_name, Dwarf_Addr base,
-			     void *cb_arg)
+static int symbols_search_all_cb(Dwfl_Module *dwfl_module, void **userdatap,
+				 const char *module_name, Dwarf_Addr base,
+				 void *cb_arg)
 {
 	struct symbols_search_arg *arg = cb_arg;
 
@@ -1716,33 +2945,116 @@ static int symbols_search_cb(Dwfl_Module *dwfl_module, void **userdatap,
 
 	/* Ignore the zeroth null symbol */
 	for (int i = 1; i < symtab_len; i++) {
-		GElf_Sym elf_sym;
-		GElf_Addr elf_addr;
-		const char *name = dwfl_module_getsym_info(dwfl_module, i,
-							   &elf_sym, &elf_addr,
-							   NULL, NULL, NULL);
-		if (!name || !symbol_match(arg, elf_addr, &elf_sym, name))
-			continue;
-
-		struct drgn_symbol *sym = malloc(sizeof(*sym));
-		if (!sym)
-			return DWARF_CB_ABORT;
-		drgn_symbol_from_elf(name, elf_addr, &elf_sym, sym);
-		if (!symbolp_vector_append(&arg->results, &sym)) {
-			drgn_symbol_destroy(sym);
+		if (!symbols_search_append(arg, dwfl_module, i))
 			return DWARF_CB_ABORT;
-		}
 	}
 	return DWARF_CB_OK;
 }
 
+static struct drgn_error *
+symbols_search_by_name(struct drgn_symbol_index *index,
+		       struct symbols_search_arg *arg)
+{
+	for (const struct drgn_symbol_index_entry *entry =
+	     drgn_symbol_index_find(index, arg->name);
+	     entry; entry = drgn_symbol_index_next(index, entry)) {
+		Dwfl_Module *dwfl_module =
+			index->modules.data[entry->module].dwfl_module;
+		if (!symbols_search_append(arg, dwfl_module, entry->sym_idx))
+			return &drgn_enomem;
+	}
+	return NULL;
+}
+
+static struct drgn_error *
+symbols_search_by_address(struct drgn_symbol_index *index,
+			  Dwfl_Module *dwfl_module,
+			  struct symbols_search_arg *arg)
+{
+	const struct drgn_symbol_index_module *module =
+		drgn_symbol_index_module(index, dwfl_module);
+	if (!module)
+		return NULL;
+	/*
+	 * Symbols may overlap, so walk backwards from the last symbol starting
+	 * at or before the address until no earlier symbol can contain it.
+	 */
+	for (size_t i = drgn_symbol_index_module_address_upper_bound(module,
+								     arg->address);
+	     i-- > 0 && module->by_address[i].max_end > arg->address;) {
+		const struct drgn_symbol_index_address *sym =
+			&module->by_address[i];
+		if (arg->address < sym->address + sym->size &&
+		    !symbols_search_append(arg, dwfl_module, sym->sym_idx))
+			return &drgn_enomem;
+	}
+	return NULL;
+}
+
+static bool
+symbols_search_append_kallsyms(struct symbols_search_arg *arg,
+			       const struct drgn_kallsyms_symbol *ksym)
+{
+	struct drgn_symbol *sym = malloc(sizeof(*sym));
+	if (!sym)
+		return false;
+	drgn_symbol_from_kallsyms(ksym, sym);
+	if (!symbolp_vector_append(&arg->results, &sym)) {
+		drgn_symbol_destroy(sym);
+		return false;
+	}
+	return true;
+}
+
+static struct drgn_error *
+symbols_search_kallsyms(struct drgn_kallsyms *kallsyms,
+			struct symbols_search_arg *arg)
+{
+	const struct drgn_kallsyms_symbol *syms = kallsyms->symbols;
+	if (arg->flags & SYMBOLS_SEARCH_ADDRESS) {
+		size_t i = drgn_kallsyms_address_upper_bound(kallsyms,
+							     arg->address);
+		/* Only the symbols at the closest address can contain it. */
+		for (size_t end = i; i-- > 0;) {
+			if (i + 1 < end &&
+			    syms[i].address != syms[i + 1].address)
+				break;
+			if (arg->address - syms[i].address < syms[i].size &&
+			    !symbols_search_append_kallsyms(arg, &syms[i]))
+				return &drgn_enomem;
+		}
+	} else if (arg->flags & SYMBOLS_SEARCH_NAME) {
+		for (const struct drgn_kallsyms_symbol *ksym =
+		     drgn_kallsyms_find_first(kallsyms, arg->name);
+		     ksym;
+		     ksym = ksym->next == UINT32_MAX ?
+			    NULL : &syms[ksym->next]) {
+			if (!symbols_search_append_kallsyms(arg, ksym))
+				return &drgn_enomem;
+		}
+	} else {
+		for (size_t i = 0; i < kallsyms->num_symbols; i++) {
+			if (!symbols_search_append_kallsyms(arg, &syms[i]))
+				return &drgn_enomem;
+		}
+	}
+	return NULL;
+}
+
 static struct drgn_error *
 symbols_search(struct drgn_program *prog, struct symbols_search_arg *arg,
 	       struct drgn_symbol ***syms_ret, size_t *count_ret)
 {
 	struct drgn_error *err;
 
-	if (!prog->dbinfo) {
+	/*
+	 * For live kernels, kallsyms is used if there are no matching symbols
+	 * in the symbol tables.
+	 */
+	struct drgn_kallsyms *kallsyms = NULL;
+	if (!prog->dbinfo)
+		kallsyms = drgn_program_fallback_kallsyms(prog);
+	if (!prog->dbinfo && !kallsyms) {
 		return drgn_error_create(DRGN_ERROR_MISSING_DEBUG_INFO,
 					 "could not find matching symbols");
 	}
@@ -1750,20 +3062,41 @@ symbols_search(struct drgn_program *prog, struct symbols_search_arg *arg,
 	symbolp_vector_init(&arg->results);
 
 	/*
-	 * When searching for addresses, we can identify the exact module to
-	 * search. Otherwise we need to fall back to an exhaustive search.
+	 * Searches by name or address use the symbol index. Otherwise we need
+	 * to return every symbol anyways, so walk the symbol tables directly.
 	 */
-	err = NULL;
-	if (arg->flags & SYMBOLS_SEARCH_ADDRESS) {
+	if (!prog->dbinfo) {
+		err = NULL;
+	} else if (arg->flags & SYMBOLS_SEARCH_ADDRESS) {
+		struct drgn_symbol_index *index = &prog->dbinfo->symbols;
 		Dwfl_Module *module = dwfl_addrmodule(prog->dbinfo->dwfl,
 						      arg->address);
-		if (module && symbols_search_cb(module, NULL, NULL, 0, arg))
-			err = &drgn_enomem;
+		err = NULL;
+		if (module) {
+			err = drgn_symbol_index_build(index, prog,
+						      prog->dbinfo->dwfl);
+			if (!err)
+				err = symbols_search_by_address(index, module,
+								arg);
+		}
+	} else if (arg->flags & SYMBOLS_SEARCH_NAME) {
+		struct drgn_symbol_index *index = &prog->dbinfo->symbols;
+		err = drgn_symbol_index_build(index, prog,
+					      prog->dbinfo->dwfl);
+		if (!err)
+			err = symbols_search_by_name(index, arg);
 	} else {
-		if (dwfl_getmodules(prog->dbinfo->dwfl, symbols_search_cb, arg,
-				    0))
+		err = NULL;
+		if (dwfl_getmodules(prog->dbinfo->dwfl, symbols_search_all_cb,
+				    arg, 0))
 			err = &drgn_enomem;
 	}
+	if (!err && !arg->results.size) {
+		if (!kallsyms)
+			kallsyms = drgn_program_fallback_kallsyms(prog);
+		if (kallsyms)
+			err = symbols_search_kallsyms(kallsyms, arg);
+	}
 
 	if (err) {
 		for (size_t i = 0; i < arg->results.size; i++)
@@ -1802,35 +3135,39 @@ drgn_program_find_symbols_by_address(struct drgn_program *prog,
 	return symbols_search(prog, &arg, syms_ret, count_ret);
 }
 
-struct find_symbol_by_name_arg {
-	const char *name;
-	GElf_Sym sym;
-	GElf_Addr addr;
-	bool found;
-	bool bad_symtabs;
-};
-
-static int find_symbol_by_name_cb(Dwfl_Module *dwfl_module, void **userdatap,
-				  const char *module_name, Dwarf_Addr base,
-				  void *cb_arg)
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_program_find_symbol_by_name(struct drgn_program *prog,
+			const char *name, struct drgn_symbol **ret)
 {
-	struct find_symbol_by_name_arg *arg = cb_arg;
-	int symtab_len = dwfl_module_getsymtab(dwfl_module);
-	if (symtab_len == -1) {
-		arg->bad_symtabs = true;
-		return DWARF_CB_OK;
-	}
-	/*
-	 * Global symbols are after local symbols, so by iterating backwards we
-	 * might find a global symbol faster. Ignore the zeroth null symbol.
-	 */
-	for (int i = symtab_len - 1; i > 0; i--) {
-		GElf_Sym sym;
-		GElf_Addr addr;
-		const char *name = dwfl_module_getsym_info(dwfl_module, i, &sym,
-							   &addr, NULL, NULL,
-							   NULL);
-		if (name && strcmp(arg->name, name) == 0) {
+	struct drgn_error *err;
+	bool bad_symtabs = false;
+
+	if (prog->dbinfo) {
+		struct drgn_symbol_index *index = &prog->dbinfo->symbols;
+		err = drgn_symbol_index_build(index, prog,
+					      prog->dbinfo->dwfl);
+		if (err)
+			return err;
+		bad_symtabs = index->bad_symtabs;
+
+		GElf_Sym found_sym;
+		GElf_Addr found_addr;
+		bool found = false;
+		/*
+		 * Entries are in module order and in reverse symbol table order
+		 * within each module.
+		 */
+		for (const struct drgn_symbol_index_entry *entry =
+		     drgn_symbol_index_find(index, name);
+		     entry; entry = drgn_symbol_index_next(index, entry)) {
+			GElf_Sym sym;
+			GElf_Addr addr;
+			Dwfl_Module *dwfl_module =
+				index->modules.data[entry->module].dwfl_module;
+			if (!dwfl_module_getsym_info(dwfl_module,
+						     entry->sym_idx, &sym,
+						     &addr, NULL, NULL, NULL))
+				continue;
 			/*
 			 * The order of precedence is
 			 * GLOBAL = GNU_UNIQUE > WEAK > LOCAL = everything else
@@ -1844,41 +3181,40 @@ static int find_symbol_by_name_cb(Dwfl_Module *dwfl_module, void **userdatap,
 			if (GELF_ST_BIND(sym.st_info) == STB_GLOBAL ||
 			    GELF_ST_BIND(sym.st_info) == STB_GNU_UNIQUE ||
 			    GELF_ST_BIND(sym.st_info) == STB_WEAK ||
-			    !arg->found) {
-				arg->sym = sym;
-				arg->addr = addr;
-				arg->found = true;
+			    !found) {
+				found_sym = sym;
+				found_addr = addr;
+				found = true;
 			}
 			if (GELF_ST_BIND(sym.st_info) == STB_GLOBAL ||
 			    GELF_ST_BIND(sym.st_info) == STB_GNU_UNIQUE)
-				return DWARF_CB_ABORT;
+				break;
 		}
-	}
-	return DWARF_CB_OK;
-}
-
-LIBDRGN_PUBLIC struct drgn_error *
-drgn_program_find_symbol_by_name(struct drgn_program *prog,
-			const char *name, struct drgn_symbol **ret)
-{
-	struct find_symbol_by_name_arg arg = {
-		.name = name,
-	};
-	if (prog->dbinfo) {
-		dwfl_getmodules(prog->dbinfo->dwfl, find_symbol_by_name_cb,
-				&arg, 0);
-		if (arg.found) {
+		if (found) {
 			struct drgn_symbol *sym = malloc(sizeof(*sym));
 			if (!sym)
 				return &drgn_enomem;
-			drgn_symbol_from_elf(name, arg.addr, &arg.sym, sym);
+			drgn_symbol_from_elf(name, found_addr, &found_sym, sym);
 			*ret = sym;
 			return NULL;
 		}
 	}
+
+	/* Fall back to kallsyms for live kernels without symbol tables. */
+	struct drgn_kallsyms *kallsyms = drgn_program_fallback_kallsyms(prog);
+	const struct drgn_kallsyms_symbol *ksym =
+		kallsyms ? drgn_kallsyms_find_by_name(kallsyms, name) : NULL;
+	if (ksym) {
+		struct drgn_symbol *sym = malloc(sizeof(*sym));
+		if (!sym)
+			return &drgn_enomem;
+		drgn_symbol_from_kallsyms(ksym, sym);
+		*ret = sym;
+		return NULL;
+	}
 	return drgn_error_format(DRGN_ERROR_LOOKUP,
 				 "could not find symbol with name '%s'%s", name,
-				 arg.bad_symtabs ?
+				 bad_symtabs ?
 				 " (could not get some symbol tables)" : "");
 }
 
@@ -14,21 +14,30 @@
 
 #include <elfutils/libdwfl.h>
 #include <libelf.h>
+#include <pthread.h>
 #include <sys/types.h>
 #ifdef WITH_LIBKDUMPFILE
 #include <libkdumpfile/kdumpfile.h>
 #endif
 
+#include "arena.h"
 #include "drgn.h"
 #include "hash_table.h"
 #include "language.h"
 #include "memory_reader.h"
 #include "object_index.h"
 #include "platform.h"
+#include "stack_trace.h"
 #include "type.h"
 #include "vector.h"
 
+struct depmod_index;
+struct drgn_kallsyms;
+struct drgn_seekable_zstd;
 struct drgn_symbol;
+struct kernel_module_cache;
+struct linux_helper_path_cache;
+struct linux_helper_task_index;
 
 /**
  * @defgroup Internals Internals
@@ -62,6 +71,16 @@ struct vmcoreinfo {
 	uint64_t swapper_pg_dir;
 	/** Whether 5-level paging was enabled. */
 	bool pgtable_l5_enabled;
+	/** Number of bits in a virtual address (AArch64 only). */
+	uint64_t va_bits;
+	/**
+	 * Physical address that the kernel image was loaded at minus its
+	 * compiled physical address (x86-64 only). Only valid if @ref
+	 * kernel_image_size is non-zero.
+	 */
+	uint64_t phys_base;
+	/** Size of the kernel image mapping (x86-64 only), or 0 if unknown. */
+	uint64_t kernel_image_size;
 };
 
 struct drgn_thread {
@@ -75,6 +94,41 @@ DEFINE_VECTOR_TYPE(drgn_typep_vector, struct drgn_type *)
 DEFINE_VECTOR_TYPE(drgn_prstatus_vector, struct nstring)
 DEFINE_HASH_TABLE_TYPE(drgn_thread_set, struct drgn_thread)
 
+/**
+ * Number of entries in a @ref drgn_tlb. This must be a power of two.
+ */
+enum { DRGN_TLB_SIZE = 1024 };
+
+/** Cached virtual to physical address translation in a @ref drgn_tlb. */
+struct drgn_tlb_entry {
+	/** Address of the top-level page table. */
+	uint64_t pgtable;
+	/** First virtual address of the page. */
+	uint64_t virt_addr;
+	/** Physical address that @ref virt_addr maps to. */
+	uint64_t phys_addr;
+	/** log2 of the page size, or 0 if the entry is empty. */
+	uint8_t page_shift;
+};
+
+/**
+ * Software translation lookaside buffer for linux_helper_read_vm().
+ *
+ * This is a direct-mapped cache of translations of pages (including huge
+ * pages) keyed by page table and virtual page.
+ */
+struct drgn_tlb {
+	struct drgn_tlb_entry entries[DRGN_TLB_SIZE];
+	/** Bitmap of page shifts that have been cached. */
+	uint64_t page_shifts;
+	/** Number of translations found in the cache. */
+	uint64_t hits;
+	/** Number of translations that required a page table walk. */
+	uint64_t misses;
+	/** Whether translations are cached. */
+	bool enabled;
+};
+
 struct drgn_program {
 	/** @privatesection */
 
@@ -88,6 +142,16 @@ struct drgn_program {
 	Elf *core;
 	/* File descriptor for ELF core dump, kdump file, or /proc/pid/mem. */
 	int core_fd;
+	/* ELF core dump mapped into memory, or NULL if it is read with pread. */
+	void *core_map;
+	size_t core_map_size;
+	/* Seekable zstd-compressed ELF core dump, or NULL. */
+	struct drgn_seekable_zstd *core_zstd;
+	/*
+	 * Decompressed prefix of core_zstd containing the ELF headers and
+	 * notes, which core is parsed from.
+	 */
+	char *core_zstd_headers;
 	/* PID of live userspace program. */
 	pid_t pid;
 #ifdef WITH_LIBKDUMPFILE
@@ -116,6 +180,14 @@ struct drgn_program {
 	 * effort to hash and compare them.
 	 */
 	struct drgn_typep_vector created_types;
+	/**
+	 * Storage for deduplicated and created types and the member,
+	 * enumerator, parameter, and template parameter arrays of created
+	 * types. It is freed all at once by @ref drgn_program_deinit_types().
+	 */
+	struct drgn_arena types_arena;
+	/** Names and tags of types, allocated in @ref types_arena. */
+	struct drgn_interned_string_table type_strings;
 	/** Cache for @ref drgn_program_find_member(). */
 	struct drgn_member_map members;
 	/**
@@ -123,12 +195,28 @@ struct drgn_program {
 	 * drgn_program::members.
 	 */
 	struct drgn_type_set members_cached;
+	/** Cache for @ref drgn_program_find_type(). */
+	struct drgn_type_name_map type_names;
+	/**
+	 * Number of calls to type finders that aren't @ref
+	 * drgn_type_finder::cacheable. Lookups that change this aren't cached
+	 * in @ref type_names.
+	 */
+	uint64_t uncacheable_type_finds;
+	/**
+	 * Indexes of enumerated types for @ref drgn_enum_type_find_value() and
+	 * @ref drgn_enum_type_format_flags().
+	 */
+	struct drgn_enum_type_index_map enum_type_indexes;
 
 	/*
 	 * Debugging information.
 	 */
 	struct drgn_object_index oindex;
 	struct drgn_debug_info *dbinfo;
+	/* Callback for fetching missing debugging information files. */
+	drgn_debug_file_fetch_fn *debug_file_fetch_fn;
+	void *debug_file_fetch_arg;
 
 	/*
 	 * Program information.
@@ -156,6 +244,8 @@ struct drgn_program {
 	struct drgn_thread *crashed_thread;
 	bool core_dump_notes_cached;
 	bool prefer_orc_unwinder;
+	/** Cache of unwinding lookups by program counter. */
+	struct drgn_pc_cache pc_cache;
 
 	/*
 	 * Linux kernel-specific.
@@ -172,6 +262,79 @@ struct drgn_program {
 	 * to prevent address translation from recursing.
 	 */
 	bool pgtable_it_in_use;
+	/* Cache of translations for linux_helper_read_vm(). */
+	struct drgn_tlb tlb;
+	/*
+	 * Linearly mapped regions that linux_helper_read_vm() translates
+	 * without the page table. Initialized once PAGE_OFFSET is cached.
+	 */
+	struct drgn_linear_mapping linear_mappings[DRGN_MAX_LINEAR_MAPPINGS];
+	size_t num_linear_mappings;
+	bool linear_mappings_initialized;
+	/* Loaded kernel modules that were found in a core dump. */
+	struct kernel_module_cache *kernel_module_cache;
+	/*
+	 * Where the kernel module cache is checkpointed, or NULL if
+	 * DRGN_CORE_DUMP_CHECKPOINT isn't enabled.
+	 */
+	char *checkpoint_path;
+	/* Mapped modules.dep.bin for finding kernel module files. */
+	struct depmod_index *depmod_index;
+	/* Task index for linux_helper_cached_task_index(). */
+	struct linux_helper_task_index *task_index;
+	/*
+	 * Whether the task index was disabled by DRGN_INDEX_TASKS or couldn't
+	 * be built.
+	 */
+	bool task_index_disabled;
+	/* Path cache for linux_helper_cached_path_cache(). */
+	struct linux_helper_path_cache *path_cache;
+	/* Parsed /proc/kallsyms for drgn_program_kallsyms(). */
+	struct drgn_kallsyms *kallsyms;
+	/* Error from parsing /proc/kallsyms, which isn't retried. */
+	struct drgn_error *kallsyms_err;
+
+	/*
+	 * Locking.
+	 */
+	/**
+	 * Recursive lock protecting the caches and indexes that are modified by
+	 * the thread-safe entry points. See @ref drgn_program_lock().
+	 */
+	pthread_mutex_t lock;
+	drgn_program_begin_blocking_fn *begin_blocking_fn;
+	drgn_program_end_blocking_fn *end_blocking_fn;
+	void *blocking_arg;
+	/*
+	 * Background thread started by drgn_program_prefetch(), or NULL if it
+	 * hasn't been started.
+	 */
+	struct drgn_prefetcher *prefetcher;
+
+	/*
+	 * Parallelism.
+	 */
+	/** Number of threads for parallel regions, or 0 for the default. */
+	int num_threads;
+	/** CPUs that worker threads are bound to. */
+	int *thread_cpus;
+	size_t num_thread_cpus;
+	/**
+	 * Unique identifier of @ref drgn_program::thread_cpus, or 0 if worker
+	 * threads aren't restricted. See @ref
+	 * drgn_program_bind_parallel_thread().
+	 */
+	uint64_t thread_cpus_generation;
+
+	/*
+	 * Statistics. See @ref drgn_program_stats(). Counters that are also
+	 * kept elsewhere (e.g., in @ref drgn_program::reader) are filled in
+	 * when the statistics are queried.
+	 */
+	struct drgn_program_stats stats;
+	/* See drgn_program_set_memory_read_trace(). */
+	drgn_memory_read_trace_fn *memory_read_trace_fn;
+	void *memory_read_trace_arg;
 };
 
 /** Initialize a @ref drgn_program. */
@@ -181,6 +344,62 @@ void drgn_program_init(struct drgn_program *prog,
 /** Deinitialize a @ref drgn_program. */
 void drgn_program_deinit(struct drgn_program *prog);
 
+/**
+ * Acquire the lock of a @ref drgn_program.
+ *
+ * This must be held while modifying or looking up in the program's lazily
+ * populated state: the memory cache and page table iterator, the type caches
+ * (@ref drgn_program::dedupe_types, @ref drgn_program::created_types, @ref
+ * drgn_program::types_arena, @ref drgn_program::type_strings, @ref
+ * drgn_program::members, and @ref drgn_program::primitive_types), and the
+ * debugging information index and caches. The lock is recursive, so it may be
+ * acquired again by callbacks. If it's held by another thread, the program's
+ * blocking callbacks are called around waiting for it.
+ */
+void drgn_program_lock(struct drgn_program *prog);
+
+/** Release the lock acquired by @ref drgn_program_lock(). */
+void drgn_program_unlock(struct drgn_program *prog);
+
+/**
+ * Count a read of a @ref drgn_program's memory in its statistics and pass it
+ * to its memory read trace callback, if any.
+ *
+ * This may be called without holding the program lock.
+ */
+static inline void drgn_program_account_memory_read(struct drgn_program *prog,
+						    uint64_t address,
+						    size_t count,
+						    bool physical)
+{
+	__atomic_fetch_add(&prog->stats.memory_reads, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&prog->stats.memory_read_bytes, count,
+			   __ATOMIC_RELAXED);
+	if (prog->memory_read_trace_fn) {
+		prog->memory_read_trace_fn(address, count, physical,
+					   prog->memory_read_trace_arg);
+	}
+}
+
+/**
+ * Get the number of threads to use for a parallel region of a @ref
+ * drgn_program.
+ *
+ * Every OpenMP parallel region doing work for a program must pass this in a
+ * `num_threads` clause, since per-thread state is sized with it.
+ */
+int drgn_program_num_parallel_threads(struct drgn_program *prog);
+
+/**
+ * Bind the current OpenMP thread to the CPUs of a @ref drgn_program.
+ *
+ * This must be called at the start of the work done by each thread in a
+ * parallel region of the program. It doesn't change the affinity of the
+ * thread that started the parallel region, and it is cheap if the thread is
+ * already bound.
+ */
+void drgn_program_bind_parallel_thread(struct drgn_program *prog);
+
 /**
  * Set the @ref drgn_platform of a @ref drgn_program if it hasn't been set
  * yet.
@@ -265,6 +484,49 @@ drgn_program_address_mask(const struct drgn_program *prog, uint64_t *ret)
 	return NULL;
 }
 
+/**
+ * Get a pointer directly to the memory of a program without copying it, if
+ * possible.
+ *
+ * This is only possible for ELF core dumps that are mapped into memory; see
+ * @ref drgn_memory_reader_borrow().
+ *
+ * @return Borrowed pointer which is valid for the lifetime of the program, or
+ * @c NULL if the memory must be read with @ref drgn_program_read_memory()
+ * instead.
+ */
+const void *drgn_program_borrow_memory(struct drgn_program *prog,
+				       uint64_t address, size_t count,
+				       bool physical);
+
+/**
+ * Callback passed to @ref drgn_program_read_c_string_chunks().
+ *
+ * @param[in] chunk Bytes of the string, not including the null byte.
+ * @param[in] size Number of bytes in @p chunk. This is never zero.
+ * @param[in] arg Argument passed to @ref drgn_program_read_c_string_chunks().
+ */
+typedef struct drgn_error *drgn_c_string_chunk_fn(const char *chunk,
+						  size_t size, void *arg);
+
+/**
+ * Read a null-terminated string from a program's memory in chunks.
+ *
+ * Memory is read a page at a time instead of a byte at a time. If a chunk
+ * can't be read (e.g., because it extends past the end of a memory segment),
+ * it is retried a byte at a time, so a fault is only returned if the string
+ * itself isn't readable.
+ *
+ * @param[in] max_size Stop after this many bytes are read, not including the
+ * null byte.
+ * @param[in] fn Callback called with each chunk of the string.
+ * @param[in] arg Argument to pass to @p fn.
+ */
+struct drgn_error *
+drgn_program_read_c_string_chunks(struct drgn_program *prog, uint64_t address,
+				  bool physical, uint64_t max_size,
+				  drgn_c_string_chunk_fn *fn, void *arg);
+
 struct drgn_error *drgn_thread_dup_internal(const struct drgn_thread *thread,
 					    struct drgn_thread *ret);
 
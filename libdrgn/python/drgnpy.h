@@ -49,6 +49,15 @@
 typedef struct {
 	PyObject_HEAD
 	struct drgn_object obj;
+	/*
+	 * If this object was returned by Object.snapshot_() or is a member of
+	 * such an object, the value of the outermost object, which is read when
+	 * a member is first accessed, or Py_None if it hasn't been read yet.
+	 * Otherwise, NULL.
+	 */
+	PyObject *snapshot;
+	/* Address of the outermost object if snapshot is not NULL. */
+	uint64_t snapshot_address;
 } DrgnObject;
 
 typedef struct {
@@ -84,6 +93,14 @@ typedef struct {
 	struct drgn_platform *platform;
 } Platform;
 
+/* Read-only buffer borrowed from memory that another object keeps alive. */
+typedef struct {
+	PyObject_HEAD
+	PyObject *owner;
+	const void *buf;
+	Py_ssize_t size;
+} BorrowedBuffer;
+
 DEFINE_HASH_SET_TYPE(pyobjectp_set, PyObject *)
 
 typedef struct {
@@ -95,6 +112,8 @@ typedef struct {
 	 * lifetime of the Program.
 	 */
 	struct pyobjectp_set objects;
+	/* Trace started by Program.start_memory_trace(), or NULL. */
+	struct drgn_memory_trace *memory_trace;
 } Program;
 
 typedef struct {
@@ -108,6 +127,12 @@ typedef struct {
 	struct drgn_thread_iterator *iterator;
 } ThreadIterator;
 
+typedef struct {
+	PyObject_HEAD
+	Program *prog;
+	struct drgn_type_iterator *iterator;
+} TypeIterator;
+
 typedef struct {
 	PyObject_HEAD
 	const struct drgn_register *reg;
@@ -136,6 +161,12 @@ typedef struct {
 	PyObject *value;
 } TypeEnumerator;
 
+typedef struct {
+	PyObject_HEAD
+	Program *prog;
+	struct drgn_member_path path;
+} MemberPath;
+
 typedef struct {
 	PyObject_HEAD
 	PyObject *obj;
@@ -149,15 +180,23 @@ typedef struct {
 	union drgn_lazy_object *lazy_obj;
 } LazyObject;
 
+/*
+ * For members and parameters wrapped from a drgn_type, name and bit_offset are
+ * NULL until they are first accessed, and are created from name_str and
+ * bit_offset_value.
+ */
 typedef struct {
 	LazyObject lazy_obj;
 	PyObject *name;
 	PyObject *bit_offset;
+	const char *name_str;
+	uint64_t bit_offset_value;
 } TypeMember;
 
 typedef struct {
 	LazyObject lazy_obj;
 	PyObject *name;
+	const char *name_str;
 } TypeParameter;
 
 typedef struct {
@@ -175,10 +214,12 @@ extern PyObject *Qualifiers_class;
 extern PyObject *SymbolBinding_class;
 extern PyObject *SymbolKind_class;
 extern PyObject *TypeKind_class;
+extern PyTypeObject BorrowedBuffer_type;
 extern PyTypeObject DrgnObject_type;
 extern PyTypeObject DrgnType_type;
 extern PyTypeObject FaultError_type;
 extern PyTypeObject Language_type;
+extern PyTypeObject MemberPath_type;
 extern PyTypeObject ObjectIterator_type;
 extern PyTypeObject Platform_type;
 extern PyTypeObject Program_type;
@@ -188,9 +229,19 @@ extern PyTypeObject StackTrace_type;
 extern PyTypeObject Symbol_type;
 extern PyTypeObject Thread_type;
 extern PyTypeObject ThreadIterator_type;
+extern PyTypeObject LinuxHelperBitmapIterator_type;
+extern PyTypeObject LinuxHelperHeapGraph_type;
+extern PyTypeObject LinuxHelperListIterator_type;
+extern PyTypeObject LinuxHelperPipeline_type;
+extern PyTypeObject LinuxHelperRadixTreeIterator_type;
+extern PyTypeObject LinuxHelperRbtreeIterator_type;
+extern PyTypeObject LinuxHelperSlabObjectIterator_type;
 extern PyTypeObject TypeEnumerator_type;
+extern PyTypeObject TypeIterator_type;
 extern PyTypeObject TypeMember_type;
+extern PyTypeObject TypeMemberSequence_type;
 extern PyTypeObject TypeParameter_type;
+extern PyTypeObject TypeParameterSequence_type;
 extern PyTypeObject TypeTemplateParameter_type;
 extern PyObject *MissingDebugInfoError;
 extern PyObject *ObjectAbsentError;
@@ -209,17 +260,8 @@ PyObject *Language_wrap(const struct drgn_language *language);
 int language_converter(PyObject *o, void *p);
 int add_languages(void);
 
-static inline DrgnObject *DrgnObject_alloc(Program *prog)
-{
-	DrgnObject *ret;
-
-	ret = (DrgnObject *)DrgnObject_type.tp_alloc(&DrgnObject_type, 0);
-	if (ret) {
-		drgn_object_init(&ret->obj, &prog->prog);
-		Py_INCREF(prog);
-	}
-	return ret;
-}
+DrgnObject *DrgnObject_alloc(Program *prog);
+int DrgnObject_inherit_snapshot(DrgnObject *res, DrgnObject *self);
 static inline Program *DrgnObject_prog(DrgnObject *obj)
 {
 	return container_of(drgn_object_program(&obj->obj), Program, prog);
@@ -263,10 +305,19 @@ DrgnType *Program_typedef_type(Program *self, PyObject *args, PyObject *kwds);
 DrgnType *Program_pointer_type(Program *self, PyObject *args, PyObject *kwds);
 DrgnType *Program_array_type(Program *self, PyObject *args, PyObject *kwds);
 DrgnType *Program_function_type(Program *self, PyObject *args, PyObject *kwds);
+MemberPath *Program_member_path(Program *self, PyObject *args, PyObject *kwds);
+PyObject *drgnpy_decode_enum_type_flags(PyObject *self, PyObject *args,
+					PyObject *kwds);
 
 int append_string(PyObject *parts, const char *s);
 int append_format(PyObject *parts, const char *format, ...);
 PyObject *join_strings(PyObject *parts);
+/*
+ * Return a read-only memoryview of size bytes at buf without copying them. buf
+ * must remain valid for as long as owner is alive.
+ */
+PyObject *borrowed_memoryview(PyObject *owner, const void *buf,
+			      Py_ssize_t size);
 
 struct index_arg {
 	bool allow_none;
@@ -301,19 +352,94 @@ PyObject *drgnpy_linux_helper_read_vm(PyObject *self, PyObject *args,
 				      PyObject *kwds);
 DrgnObject *drgnpy_linux_helper_per_cpu_ptr(PyObject *self, PyObject *args,
 					    PyObject *kwds);
+PyObject *drgnpy_linux_helper_per_cpu_values(PyObject *self, PyObject *args,
+					     PyObject *kwds);
+PyObject *drgnpy_linux_helper_per_cpu_sum(PyObject *self, PyObject *args,
+					  PyObject *kwds);
 DrgnObject *drgnpy_linux_helper_idle_task(PyObject *self, PyObject *args,
 					  PyObject *kwds);
 DrgnObject *drgnpy_linux_helper_radix_tree_lookup(PyObject *self,
 						  PyObject *args,
 						  PyObject *kwds);
+PyObject *drgnpy_linux_helper_radix_tree_for_each(PyObject *self,
+						  PyObject *args,
+						  PyObject *kwds);
 DrgnObject *drgnpy_linux_helper_idr_find(PyObject *self, PyObject *args,
 					 PyObject *kwds);
+PyObject *drgnpy_linux_helper_idr_for_each(PyObject *self, PyObject *args,
+					   PyObject *kwds);
+PyObject *drgnpy_linux_helper_for_each_set_bit(PyObject *self, PyObject *args,
+					       PyObject *kwds);
+PyObject *drgnpy_linux_helper_for_each_clear_bit(PyObject *self,
+						 PyObject *args,
+						 PyObject *kwds);
+PyObject *drgnpy_linux_helper_bitmap_weight(PyObject *self, PyObject *args,
+					    PyObject *kwds);
 DrgnObject *drgnpy_linux_helper_find_pid(PyObject *self, PyObject *args,
 					 PyObject *kwds);
 DrgnObject *drgnpy_linux_helper_pid_task(PyObject *self, PyObject *args,
 					 PyObject *kwds);
 DrgnObject *drgnpy_linux_helper_find_task(PyObject *self, PyObject *args,
 					  PyObject *kwds);
+PyObject *drgnpy_linux_helper_find_thread_group(PyObject *self, PyObject *args,
+						PyObject *kwds);
+PyObject *drgnpy_linux_helper_find_tasks_by_comm(PyObject *self,
+						 PyObject *args,
+						 PyObject *kwds);
+PyObject *drgnpy_linux_helper_for_each_file(PyObject *self, PyObject *args,
+					    PyObject *kwds);
+PyObject *drgnpy_linux_helper_for_each_task_file(PyObject *self,
+						 PyObject *args,
+						 PyObject *kwds);
+PyObject *drgnpy_linux_helper_d_path(PyObject *self, PyObject *args,
+				     PyObject *kwds);
+PyObject *drgnpy_linux_helper_dentry_path(PyObject *self, PyObject *args,
+					  PyObject *kwds);
+PyObject *drgnpy_linux_helper_d_paths(PyObject *self, PyObject *args,
+				      PyObject *kwds);
+PyObject *drgnpy_linux_helper_css_descendants_pre(PyObject *self,
+						  PyObject *args,
+						  PyObject *kwds);
+PyObject *drgnpy_linux_helper_sk_hash_sockets(PyObject *self, PyObject *args,
+					      PyObject *kwds);
+PyObject *drgnpy_linux_helper_bpf_progs(PyObject *self, PyObject *args,
+					PyObject *kwds);
+PyObject *drgnpy_linux_helper_bpf_maps(PyObject *self, PyObject *args,
+				       PyObject *kwds);
+PyObject *drgnpy_linux_helper_list_for_each_entry(PyObject *self,
+						  PyObject *args,
+						  PyObject *kwds);
+PyObject *drgnpy_linux_helper_list_for_each_entry_reverse(PyObject *self,
+							  PyObject *args,
+							  PyObject *kwds);
+PyObject *drgnpy_linux_helper_hlist_for_each_entry(PyObject *self,
+						   PyObject *args,
+						   PyObject *kwds);
+PyObject *drgnpy_linux_helper_hlist_nulls_for_each_entry(PyObject *self,
+							 PyObject *args,
+							 PyObject *kwds);
+PyObject *drgnpy_linux_helper_rbtree_inorder_for_each(PyObject *self,
+						      PyObject *args,
+						      PyObject *kwds);
+PyObject *drgnpy_linux_helper_rbtree_inorder_for_each_entry(PyObject *self,
+							    PyObject *args,
+							    PyObject *kwds);
+PyObject *drgnpy_linux_helper_pgtable_mappings(PyObject *self, PyObject *args,
+					       PyObject *kwds);
+PyObject *drgnpy_linux_helper_reverse_map(PyObject *self, PyObject *args,
+					  PyObject *kwds);
+PyObject *drgnpy_linux_helper_heap_graph(PyObject *self, PyObject *args,
+					 PyObject *kwds);
+PyObject *drgnpy_linux_helper_find_page_pfns(PyObject *self, PyObject *args,
+					     PyObject *kwds);
+PyObject *drgnpy_linux_helper_pipeline(PyObject *self, PyObject *args,
+				       PyObject *kwds);
+PyObject *drgnpy_linux_helper_printk_records(PyObject *self, PyObject *args,
+					     PyObject *kwds);
+PyObject *
+drgnpy_linux_helper_slab_cache_for_each_allocated_object(PyObject *self,
+							 PyObject *args,
+							 PyObject *kwds);
 PyObject *drgnpy_linux_helper_kaslr_offset(PyObject *self, PyObject *args,
 					   PyObject *kwds);
 PyObject *drgnpy_linux_helper_pgtable_l5_enabled(PyObject *self, PyObject *args,
@@ -2,8 +2,10 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include "drgnpy.h"
+#include "../array.h"
 #include "../helpers.h"
 #include "../program.h"
+#include "../string_builder.h"
 
 PyObject *drgnpy_linux_helper_read_vm(PyObject *self, PyObject *args,
 				      PyObject *kwds)
@@ -38,6 +40,99 @@ PyObject *drgnpy_linux_helper_read_vm(PyObject *self, PyObject *args,
 	return buf;
 }
 
+PyObject *drgnpy_linux_helper_pgtable_mappings(PyObject *self, PyObject *args,
+					       PyObject *kwds)
+{
+	static char *keywords[] = {"prog", "pgtable", "start", "end", NULL};
+	struct drgn_error *err;
+	Program *prog;
+	struct index_arg pgtable = {};
+	struct index_arg start = {};
+	struct index_arg end = { .allow_none = true, .is_none = true };
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds,
+					 "O!O&|O&O&:pgtable_mappings", keywords,
+					 &Program_type, &prog,
+					 index_converter, &pgtable,
+					 index_converter, &start,
+					 index_converter, &end))
+		return NULL;
+
+	struct linux_helper_pgtable_mapping *mappings;
+	size_t num_mappings;
+	err = linux_helper_pgtable_mappings(&prog->prog, pgtable.uvalue,
+					    start.uvalue,
+					    end.is_none ? 0 : end.uvalue,
+					    &mappings, &num_mappings);
+	if (err)
+		return set_drgn_error(err);
+	/* Returned as an array of (virt_addr, phys_addr, size, flags). */
+	static_assert(sizeof(mappings[0]) == 4 * sizeof(uint64_t),
+		      "unexpected padding");
+	PyObject *ret = PyBytes_FromStringAndSize((char *)mappings,
+						  num_mappings *
+						  sizeof(mappings[0]));
+	free(mappings);
+	return ret;
+}
+
+PyObject *drgnpy_linux_helper_reverse_map(PyObject *self, PyObject *args,
+					  PyObject *kwds)
+{
+	static char *keywords[] = {
+		"prog", "pgtables", "ends", "phys_addrs", NULL
+	};
+	struct drgn_error *err;
+	Program *prog;
+	Py_buffer pgtables, ends, phys_addrs;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!y*y*y*:reverse_map",
+					 keywords, &Program_type, &prog,
+					 &pgtables, &ends, &phys_addrs))
+		return NULL;
+
+	PyObject *ret = NULL;
+	if (pgtables.len % sizeof(uint64_t) || pgtables.len != ends.len ||
+	    phys_addrs.len % sizeof(uint64_t)) {
+		PyErr_SetString(PyExc_ValueError, "invalid array length");
+		goto out;
+	}
+	struct linux_helper_reverse_mapping *mappings;
+	size_t num_mappings;
+	Py_BEGIN_ALLOW_THREADS
+	err = linux_helper_reverse_map(&prog->prog, pgtables.buf, ends.buf,
+				       pgtables.len / sizeof(uint64_t),
+				       phys_addrs.buf,
+				       phys_addrs.len / sizeof(uint64_t),
+				       &mappings, &num_mappings);
+	Py_END_ALLOW_THREADS
+	if (err) {
+		set_drgn_error(err);
+		goto out;
+	}
+	/* Returned as an array of (phys_index, pgtable_index, virt_addr). */
+	uint64_t *buf = malloc_array(num_mappings, 3 * sizeof(uint64_t));
+	if (!buf && num_mappings) {
+		free(mappings);
+		PyErr_NoMemory();
+		goto out;
+	}
+	for (size_t i = 0; i < num_mappings; i++) {
+		buf[3 * i] = mappings[i].phys_index;
+		buf[3 * i + 1] = mappings[i].pgtable_index;
+		buf[3 * i + 2] = mappings[i].virt_addr;
+	}
+	free(mappings);
+	ret = PyBytes_FromStringAndSize((char *)buf,
+					num_mappings * 3 * sizeof(uint64_t));
+	free(buf);
+out:
+	PyBuffer_Release(&phys_addrs);
+	PyBuffer_Release(&ends);
+	PyBuffer_Release(&pgtables);
+	return ret;
+}
+
 DrgnObject *drgnpy_linux_helper_per_cpu_ptr(PyObject *self, PyObject *args,
 					    PyObject *kwds)
 {
@@ -62,6 +157,118 @@ DrgnObject *drgnpy_linux_helper_per_cpu_ptr(PyObject *self, PyObject *args,
 	return res;
 }
 
+static PyObject *per_cpu_value_to_pylong(const union drgn_value *value,
+					 bool is_signed)
+{
+	if (is_signed)
+		return PyLong_FromLongLong(value->svalue);
+	else
+		return PyLong_FromUnsignedLongLong(value->uvalue);
+}
+
+/*
+ * Parse the arguments of the per-CPU value helpers and read the values. Returns
+ * -1 with a Python exception set on error.
+ */
+static int read_per_cpu_values(PyObject *args, PyObject *kwds,
+			       const char *format,
+			       struct linux_helper_per_cpu_values *ret)
+{
+	static char *keywords[] = {"ptr", "member", "mask", NULL};
+	struct drgn_error *err;
+	DrgnObject *ptr;
+	const char *member = NULL;
+	PyObject *mask = Py_None;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, format, keywords,
+					 &DrgnObject_type, &ptr, &member,
+					 &mask))
+		return -1;
+	if (mask != Py_None) {
+		if (!PyObject_TypeCheck(mask, &DrgnObject_type)) {
+			PyErr_SetString(PyExc_TypeError,
+					"mask must be Object or None");
+			return -1;
+		}
+		Program *mask_prog = DrgnObject_prog((DrgnObject *)mask);
+		if (mask_prog != DrgnObject_prog(ptr)) {
+			PyErr_SetString(PyExc_ValueError,
+					"objects are from different programs");
+			return -1;
+		}
+	}
+
+	err = linux_helper_read_per_cpu(&ptr->obj, member,
+					mask == Py_None ?
+					NULL : &((DrgnObject *)mask)->obj,
+					ret);
+	if (err) {
+		set_drgn_error(err);
+		return -1;
+	}
+	return 0;
+}
+
+PyObject *drgnpy_linux_helper_per_cpu_values(PyObject *self, PyObject *args,
+					     PyObject *kwds)
+{
+	struct linux_helper_per_cpu_values values;
+	if (read_per_cpu_values(args, kwds, "O!|zO:per_cpu_values", &values))
+		return NULL;
+
+	PyObject *ret = PyDict_New();
+	if (!ret)
+		goto out;
+	for (size_t i = 0; i < values.num_cpus; i++) {
+		PyObject *cpu = PyLong_FromUnsignedLongLong(values.cpus[i]);
+		if (!cpu)
+			goto err;
+		PyObject *value = per_cpu_value_to_pylong(&values.values[i],
+							  values.is_signed);
+		if (!value) {
+			Py_DECREF(cpu);
+			goto err;
+		}
+		int r = PyDict_SetItem(ret, cpu, value);
+		Py_DECREF(value);
+		Py_DECREF(cpu);
+		if (r)
+			goto err;
+	}
+out:
+	linux_helper_per_cpu_values_deinit(&values);
+	return ret;
+
+err:
+	Py_CLEAR(ret);
+	goto out;
+}
+
+PyObject *drgnpy_linux_helper_per_cpu_sum(PyObject *self, PyObject *args,
+					  PyObject *kwds)
+{
+	struct linux_helper_per_cpu_values values;
+	if (read_per_cpu_values(args, kwds, "O!|zO:per_cpu_sum", &values))
+		return NULL;
+
+	/* Sum as Python integers so that the sum can't overflow. */
+	PyObject *ret = PyLong_FromLong(0);
+	for (size_t i = 0; ret && i < values.num_cpus; i++) {
+		PyObject *value = per_cpu_value_to_pylong(&values.values[i],
+							  values.is_signed);
+		if (!value) {
+			Py_CLEAR(ret);
+			break;
+		}
+		PyObject *sum = PyNumber_Add(ret, value);
+		Py_DECREF(value);
+		Py_DECREF(ret);
+		ret = sum;
+	}
+	linux_helper_per_cpu_values_deinit(&values);
+	return ret;
+}
+
 DrgnObject *drgnpy_linux_helper_idle_task(PyObject *self, PyObject *args,
 					  PyObject *kwds)
 {
@@ -268,32 +475,1829 @@ out:
 	return res;
 }
 
-PyObject *drgnpy_linux_helper_kaslr_offset(PyObject *self, PyObject *args,
-					   PyObject *kwds)
+/*
+ * Get a list of the tasks in a thread group or, if comm is not NULL, with a
+ * comm, from the cached task index or from a temporary one.
+ */
+static PyObject *find_indexed_tasks(Program *prog, uint64_t tgid,
+				    const char *comm)
+{
+	struct drgn_error *err;
+	struct linux_helper_task_index *index, *tmp_index = NULL;
+	PyObject *tasks = NULL;
+
+	err = linux_helper_cached_task_index(&prog->prog, &index);
+	if (!err && !index) {
+		err = linux_helper_task_index_create(&prog->prog, &tmp_index);
+		index = tmp_index;
+	}
+	if (err)
+		return set_drgn_error(err);
+
+	tasks = PyList_New(0);
+	if (!tasks)
+		goto out;
+	const struct linux_helper_task_index_entry *entry;
+	if (comm)
+		entry = linux_helper_task_index_find_comm(index, comm);
+	else if (tgid <= UINT32_MAX)
+		entry = linux_helper_task_index_find_tgid(index, tgid);
+	else
+		entry = NULL;
+	while (entry) {
+		DrgnObject *task = DrgnObject_alloc(prog);
+		if (!task)
+			goto err;
+		err = drgn_object_set_unsigned(&task->obj,
+					       index->task_struct_pointer_type,
+					       entry->address, 0);
+		if (err) {
+			Py_DECREF(task);
+			set_drgn_error(err);
+			goto err;
+		}
+		int r = PyList_Append(tasks, (PyObject *)task);
+		Py_DECREF(task);
+		if (r)
+			goto err;
+		uint32_t next = comm ? entry->next_with_comm :
+			       entry->next_in_thread_group;
+		entry = next == UINT32_MAX ? NULL : &index->entries.data[next];
+	}
+out:
+	linux_helper_task_index_destroy(tmp_index);
+	return tasks;
+
+err:
+	Py_CLEAR(tasks);
+	goto out;
+}
+
+PyObject *drgnpy_linux_helper_find_thread_group(PyObject *self, PyObject *args,
+						PyObject *kwds)
+{
+	static char *keywords[] = {"prog", "tgid", NULL};
+	Program *prog;
+	struct index_arg tgid = {};
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!O&:find_thread_group",
+					 keywords, &Program_type, &prog,
+					 index_converter, &tgid))
+		return NULL;
+	return find_indexed_tasks(prog, tgid.uvalue, NULL);
+}
+
+PyObject *drgnpy_linux_helper_find_tasks_by_comm(PyObject *self,
+						 PyObject *args,
+						 PyObject *kwds)
+{
+	static char *keywords[] = {"prog", "comm", NULL};
+	Program *prog;
+	PyObject *comm_obj;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!O:find_tasks_by_comm",
+					 keywords, &Program_type, &prog,
+					 &comm_obj))
+		return NULL;
+
+	const char *comm;
+	if (PyUnicode_Check(comm_obj)) {
+		comm = PyUnicode_AsUTF8(comm_obj);
+	} else if (PyBytes_Check(comm_obj)) {
+		comm = PyBytes_AsString(comm_obj);
+	} else {
+		return PyErr_Format(PyExc_TypeError,
+				    "comm must be str or bytes, not %s",
+				    Py_TYPE(comm_obj)->tp_name);
+	}
+	if (!comm)
+		return NULL;
+	return find_indexed_tasks(prog, 0, comm);
+}
+
+static PyObject *
+address_object(Program *prog, struct drgn_qualified_type type, uint64_t value)
+{
+	DrgnObject *obj = DrgnObject_alloc(prog);
+	if (!obj)
+		return NULL;
+	struct drgn_error *err = drgn_object_set_unsigned(&obj->obj, type,
+							  value, 0);
+	if (err) {
+		Py_DECREF(obj);
+		return set_drgn_error(err);
+	}
+	return (PyObject *)obj;
+}
+
+/*
+ * Convert files found by linux_helper_task_files() to a list of (fd, file)
+ * tuples, or (task, fd, file) tuples if task_type is not NULL.
+ */
+static PyObject *
+open_files_to_list(Program *prog, const struct linux_helper_open_file *files,
+		   size_t num_files, struct drgn_qualified_type file_type,
+		   const struct drgn_qualified_type *task_type)
+{
+	PyObject *list = PyList_New(num_files);
+	if (!list)
+		return NULL;
+	for (size_t i = 0; i < num_files; i++) {
+		PyObject *item;
+		PyObject *file = address_object(prog, file_type, files[i].file);
+		if (!file)
+			goto err;
+		if (task_type) {
+			PyObject *task = address_object(prog, *task_type,
+							files[i].task);
+			if (!task) {
+				Py_DECREF(file);
+				goto err;
+			}
+			item = Py_BuildValue("NKN", task,
+					     (unsigned long long)files[i].fd,
+					     file);
+		} else {
+			item = Py_BuildValue("KN",
+					     (unsigned long long)files[i].fd,
+					     file);
+		}
+		if (!item)
+			goto err;
+		PyList_SET_ITEM(list, i, item);
+	}
+	return list;
+
+err:
+	Py_DECREF(list);
+	return NULL;
+}
 
+PyObject *drgnpy_linux_helper_for_each_file(PyObject *self, PyObject *args,
+					    PyObject *kwds)
+{
+	static char *keywords[] = {"task", NULL};
+	struct drgn_error *err;
+	DrgnObject *task;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!:for_each_file",
+					 keywords, &DrgnObject_type, &task))
+		return NULL;
+
+	uint64_t address;
+	err = drgn_object_read_unsigned(&task->obj, &address);
+	if (err)
+		return set_drgn_error(err);
+	struct linux_helper_open_file *files;
+	size_t num_files;
+	struct drgn_qualified_type file_type;
+	err = linux_helper_task_files(drgn_object_program(&task->obj),
+				      &address, 1, false, &files, &num_files,
+				      &file_type);
+	if (err)
+		return set_drgn_error(err);
+	PyObject *ret = open_files_to_list(DrgnObject_prog(task), files,
+					   num_files, file_type, NULL);
+	free(files);
+	return ret;
+}
+
+PyObject *drgnpy_linux_helper_for_each_task_file(PyObject *self,
+						 PyObject *args,
+						 PyObject *kwds)
 {
 	static char *keywords[] = {"prog", NULL};
+	struct drgn_error *err;
 	Program *prog;
-	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!:kaslr_offset",
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!:for_each_task_file",
 					 keywords, &Program_type, &prog))
 		return NULL;
 
-	if (!(prog->prog.flags & DRGN_PROGRAM_IS_LINUX_KERNEL))
-		return PyErr_Format(PyExc_ValueError, "not Linux kernel");
-	return PyLong_FromUnsignedLongLong(prog->prog.vmcoreinfo.kaslr_offset);
+	struct linux_helper_task_index *index, *tmp_index = NULL;
+	err = linux_helper_cached_task_index(&prog->prog, &index);
+	if (!err && !index) {
+		err = linux_helper_task_index_create(&prog->prog, &tmp_index);
+		index = tmp_index;
+	}
+	if (err)
+		return set_drgn_error(err);
+
+	PyObject *ret = NULL;
+	size_t num_tasks = index->entries.size;
+	uint64_t *tasks = malloc_array(max(num_tasks, (size_t)1),
+				       sizeof(tasks[0]));
+	if (!tasks) {
+		PyErr_NoMemory();
+		goto out;
+	}
+	for (size_t i = 0; i < num_tasks; i++)
+		tasks[i] = index->entries.data[i].address;
+
+	struct linux_helper_open_file *files;
+	size_t num_files;
+	struct drgn_qualified_type file_type;
+	/* Walking the tables doesn't need the GIL. */
+	Py_BEGIN_ALLOW_THREADS
+	err = linux_helper_task_files(&prog->prog, tasks, num_tasks, true,
+				      &files, &num_files, &file_type);
+	Py_END_ALLOW_THREADS
+	if (err) {
+		set_drgn_error(err);
+		goto out;
+	}
+	ret = open_files_to_list(prog, files, num_files, file_type,
+				 &index->task_struct_pointer_type);
+	free(files);
+out:
+	free(tasks);
+	linux_helper_task_index_destroy(tmp_index);
+	return ret;
 }
 
-PyObject *drgnpy_linux_helper_pgtable_l5_enabled(PyObject *self, PyObject *args,
-						 PyObject *kwds)
+/*
+ * Get the path cache of a program, or create a temporary one if the program
+ * doesn't cache paths. If the program's cache is returned, the program lock is
+ * held until path_cache_put().
+ */
+static struct drgn_error *path_cache_get(struct drgn_program *prog,
+					 struct linux_helper_path_cache **ret,
+					 bool *tmp_ret)
+{
+	struct drgn_error *err;
+	err = linux_helper_cached_path_cache(prog, ret);
+	if (err)
+		return err;
+	if (*ret) {
+		drgn_program_lock(prog);
+		*tmp_ret = false;
+		return NULL;
+	}
+	*tmp_ret = true;
+	return linux_helper_path_cache_create(prog, ret);
+}
+
+static void path_cache_put(struct drgn_program *prog,
+			   struct linux_helper_path_cache *cache, bool tmp)
+{
+	if (tmp)
+		linux_helper_path_cache_destroy(cache);
+	else
+		drgn_program_unlock(prog);
+}
+
+static PyObject *string_builder_to_bytes(struct string_builder *sb)
+{
+	PyObject *ret = PyBytes_FromStringAndSize(sb->str, sb->len);
+	free(sb->str);
+	return ret;
+}
+
+PyObject *drgnpy_linux_helper_d_path(PyObject *self, PyObject *args,
+				     PyObject *kwds)
+{
+	static char *keywords[] = {"vfsmnt", "dentry", NULL};
+	struct drgn_error *err;
+	DrgnObject *vfsmnt;
+	struct index_arg dentry = {};
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!O&:d_path", keywords,
+					 &DrgnObject_type, &vfsmnt,
+					 index_converter, &dentry))
+		return NULL;
+
+	struct drgn_program *prog = drgn_object_program(&vfsmnt->obj);
+	uint64_t vfsmnt_address;
+	err = drgn_object_read_unsigned(&vfsmnt->obj, &vfsmnt_address);
+	if (err)
+		return set_drgn_error(err);
+	struct linux_helper_path_cache *cache;
+	bool tmp;
+	err = path_cache_get(prog, &cache, &tmp);
+	if (err)
+		return set_drgn_error(err);
+	struct string_builder sb = {};
+	err = linux_helper_d_path(cache, vfsmnt_address, dentry.uvalue, &sb);
+	path_cache_put(prog, cache, tmp);
+	if (err) {
+		free(sb.str);
+		return set_drgn_error(err);
+	}
+	return string_builder_to_bytes(&sb);
+}
+
+PyObject *drgnpy_linux_helper_dentry_path(PyObject *self, PyObject *args,
+					  PyObject *kwds)
+{
+	static char *keywords[] = {"dentry", NULL};
+	struct drgn_error *err;
+	DrgnObject *dentry;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!:dentry_path",
+					 keywords, &DrgnObject_type, &dentry))
+		return NULL;
+
+	struct drgn_program *prog = drgn_object_program(&dentry->obj);
+	uint64_t dentry_address;
+	err = drgn_object_read_unsigned(&dentry->obj, &dentry_address);
+	if (err)
+		return set_drgn_error(err);
+	struct linux_helper_path_cache *cache;
+	bool tmp;
+	err = path_cache_get(prog, &cache, &tmp);
+	if (err)
+		return set_drgn_error(err);
+	struct string_builder sb = {};
+	err = linux_helper_dentry_path(cache, dentry_address, &sb);
+	path_cache_put(prog, cache, tmp);
+	if (err) {
+		free(sb.str);
+		return set_drgn_error(err);
+	}
+	return string_builder_to_bytes(&sb);
+}
+
+PyObject *drgnpy_linux_helper_d_paths(PyObject *self, PyObject *args,
+				      PyObject *kwds)
+{
+	static char *keywords[] = {"prog", "paths", NULL};
+	struct drgn_error *err;
+	Program *prog;
+	PyObject *paths_obj;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!O:d_paths", keywords,
+					 &Program_type, &prog, &paths_obj))
+		return NULL;
+
+	PyObject *paths_seq = PySequence_Fast(paths_obj,
+					      "paths must be iterable");
+	if (!paths_seq)
+		return NULL;
+	PyObject *ret = NULL;
+	Py_ssize_t num_paths = PySequence_Fast_GET_SIZE(paths_seq);
+	uint64_t *addresses = malloc_array(max(num_paths, (Py_ssize_t)1),
+					   2 * sizeof(addresses[0]));
+	if (!addresses) {
+		PyErr_NoMemory();
+		goto out;
+	}
+	for (Py_ssize_t i = 0; i < num_paths; i++) {
+		struct index_arg vfsmnt = {}, dentry = {};
+		if (!PyArg_ParseTuple(PySequence_Fast_GET_ITEM(paths_seq, i),
+				      "O&O&:d_paths", index_converter, &vfsmnt,
+				      index_converter, &dentry))
+			goto out;
+		addresses[2 * i] = vfsmnt.uvalue;
+		addresses[2 * i + 1] = dentry.uvalue;
+	}
+
+	ret = PyList_New(num_paths);
+	if (!ret)
+		goto out;
+	/* Share one cache between all of the paths, even for live kernels. */
+	struct linux_helper_path_cache *cache;
+	bool tmp;
+	err = path_cache_get(&prog->prog, &cache, &tmp);
+	if (err) {
+		set_drgn_error(err);
+		Py_CLEAR(ret);
+		goto out;
+	}
+	for (Py_ssize_t i = 0; i < num_paths; i++) {
+		struct string_builder sb = {};
+		err = linux_helper_d_path(cache, addresses[2 * i],
+					  addresses[2 * i + 1], &sb);
+		if (err) {
+			free(sb.str);
+			set_drgn_error(err);
+			Py_CLEAR(ret);
+			break;
+		}
+		PyObject *path = string_builder_to_bytes(&sb);
+		if (!path) {
+			Py_CLEAR(ret);
+			break;
+		}
+		PyList_SET_ITEM(ret, i, path);
+	}
+	path_cache_put(&prog->prog, cache, tmp);
+out:
+	free(addresses);
+	Py_DECREF(paths_seq);
+	return ret;
+}
+
+/*
+ * Get the value of a member path for a css. The path may be in struct
+ * cgroup_subsys_state itself, in its struct cgroup, or in a structure that
+ * embeds it as a member named "css" (e.g., struct mem_cgroup).
+ */
+static struct drgn_error *css_member_value(struct drgn_object *res,
+					   const struct drgn_object *css,
+					   const struct drgn_member_path *path,
+					   struct drgn_object *tmp)
+{
+	struct drgn_error *err;
+	struct drgn_type *css_type =
+		drgn_type_type(drgn_underlying_type(css->type)).type;
+	const char *tag = drgn_type_tag(path->type);
+	uint64_t address;
+	err = drgn_object_read_unsigned(css, &address);
+	if (err)
+		return err;
+	if (path->type == css_type ||
+	    (tag && strcmp(tag, "cgroup_subsys_state") == 0)) {
+		err = drgn_object_set_reference(tmp,
+						(struct drgn_qualified_type){
+							path->type
+						},
+						address, 0, 0);
+	} else if (tag && strcmp(tag, "cgroup") == 0) {
+		err = drgn_object_member_dereference(tmp, css, "cgroup");
+		if (!err)
+			err = drgn_object_dereference(tmp, tmp);
+	} else {
+		struct drgn_member_path css_member;
+		err = drgn_member_path_init(&css_member, path->type, "css");
+		if (err)
+			return err;
+		err = drgn_object_set_reference(tmp,
+						(struct drgn_qualified_type){
+							path->type
+						},
+						address - css_member.bit_offset / 8,
+						0, 0);
+	}
+	if (err)
+		return err;
+	err = drgn_object_member_path(res, tmp, path);
+	if (err)
+		return err;
+	return drgn_object_read(res, res);
+}
+
+PyObject *drgnpy_linux_helper_css_descendants_pre(PyObject *self,
+						  PyObject *args,
+						  PyObject *kwds)
+{
+	static char *keywords[] = {"css", "root_path", "members", NULL};
+	struct drgn_error *err;
+	DrgnObject *css;
+	const char *root_path;
+	Py_ssize_t root_path_len;
+	PyObject *members_obj = NULL;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds,
+					 "O!y#|O:css_descendants_pre", keywords,
+					 &DrgnObject_type, &css, &root_path,
+					 &root_path_len, &members_obj))
+		return NULL;
+
+	PyObject *members = (members_obj ? PySequence_Tuple(members_obj) :
+			     PyTuple_New(0));
+	if (!members)
+		return NULL;
+	Py_ssize_t num_members = PyTuple_GET_SIZE(members);
+	for (Py_ssize_t i = 0; i < num_members; i++) {
+		if (!PyObject_TypeCheck(PyTuple_GET_ITEM(members, i),
+					&MemberPath_type)) {
+			PyErr_SetString(PyExc_TypeError,
+					"members must be MemberPath objects");
+			Py_DECREF(members);
+			return NULL;
+		}
+	}
+
+	PyObject *ret = NULL;
+	uint64_t root;
+	struct linux_helper_css_entry *entries = NULL;
+	size_t num_entries;
+	char *paths = NULL;
+	err = drgn_object_read_unsigned(&css->obj, &root);
+	if (!err) {
+		err = linux_helper_css_descendants_pre(drgn_object_program(&css->obj),
+						       root, root_path,
+						       root_path_len, &entries,
+						       &num_entries, &paths);
+	}
+	if (err) {
+		set_drgn_error(err);
+		goto out;
+	}
+
+	ret = PyList_New(num_entries);
+	if (!ret)
+		goto out;
+	Program *prog = DrgnObject_prog(css);
+	struct drgn_object tmp;
+	drgn_object_init(&tmp, &prog->prog);
+	for (size_t i = 0; i < num_entries; i++) {
+		DrgnObject *entry_css = DrgnObject_alloc(prog);
+		if (!entry_css)
+			goto err;
+		PyObject *values = PyTuple_New(num_members);
+		if (!values) {
+			Py_DECREF(entry_css);
+			goto err;
+		}
+		PyObject *item = Py_BuildValue("Ny#N", entry_css,
+					       paths + entries[i].path_offset,
+					       (Py_ssize_t)entries[i].path_len,
+					       values);
+		if (!item)
+			goto err;
+		PyList_SET_ITEM(ret, i, item);
+
+		err = drgn_object_set_unsigned(&entry_css->obj,
+					       drgn_object_qualified_type(&css->obj),
+					       entries[i].css, 0);
+		if (err) {
+			set_drgn_error(err);
+			goto err;
+		}
+		for (Py_ssize_t j = 0; j < num_members; j++) {
+			MemberPath *member =
+				(MemberPath *)PyTuple_GET_ITEM(members, j);
+			DrgnObject *value = DrgnObject_alloc(prog);
+			if (!value)
+				goto err;
+			PyTuple_SET_ITEM(values, j, (PyObject *)value);
+			err = css_member_value(&value->obj, &entry_css->obj,
+					       &member->path, &tmp);
+			if (err) {
+				set_drgn_error(err);
+				goto err;
+			}
+		}
+	}
+	drgn_object_deinit(&tmp);
+out:
+	free(paths);
+	free(entries);
+	Py_DECREF(members);
+	return ret;
+
+err:
+	drgn_object_deinit(&tmp);
+	Py_CLEAR(ret);
+	goto out;
+}
+
+PyObject *drgnpy_linux_helper_sk_hash_sockets(PyObject *self, PyObject *args,
+					      PyObject *kwds)
+{
+	static char *keywords[] = {
+		"buckets", "num_buckets", "head_member", "node_member", NULL
+	};
+	struct drgn_error *err;
+	DrgnObject *buckets;
+	struct index_arg num_buckets = {};
+	const char *head_member, *node_member;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!O&ss:sk_hash_sockets",
+					 keywords, &DrgnObject_type, &buckets,
+					 index_converter, &num_buckets,
+					 &head_member, &node_member))
+		return NULL;
+
+	struct linux_helper_sock_entry *entries;
+	size_t num_entries;
+	err = linux_helper_sk_hash_sockets(&buckets->obj, num_buckets.uvalue,
+					   head_member, node_member, &entries,
+					   &num_entries);
+	if (err)
+		return set_drgn_error(err);
 
+	PyObject *ret = PyList_New(num_entries);
+	if (!ret)
+		goto out;
+	for (size_t i = 0; i < num_entries; i++) {
+		const struct linux_helper_sock_entry *entry = &entries[i];
+		Py_ssize_t addr_len;
+		if (entry->family == 2 /* AF_INET */)
+			addr_len = 4;
+		else if (entry->family == 10 /* AF_INET6 */)
+			addr_len = 16;
+		else
+			addr_len = 0;
+		PyObject *item = Py_BuildValue("KHy#y#HHBKK",
+					       (unsigned long long)entry->sk,
+					       entry->family, entry->saddr,
+					       addr_len, entry->daddr,
+					       addr_len, entry->sport,
+					       entry->dport, entry->state,
+					       (unsigned long long)entry->ino,
+					       (unsigned long long)entry->net);
+		if (!item) {
+			Py_CLEAR(ret);
+			goto out;
+		}
+		PyList_SET_ITEM(ret, i, item);
+	}
+out:
+	free(entries);
+	return ret;
+}
+
+PyObject *drgnpy_linux_helper_bpf_progs(PyObject *self, PyObject *args,
+					PyObject *kwds)
 {
 	static char *keywords[] = {"prog", NULL};
+	struct drgn_error *err;
 	Program *prog;
-	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!:pgtable_l5_enabled",
-					 keywords, &Program_type, &prog))
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!:bpf_progs", keywords,
+					 &Program_type, &prog))
 		return NULL;
 
-	if (!(prog->prog.flags & DRGN_PROGRAM_IS_LINUX_KERNEL))
-		return PyErr_Format(PyExc_ValueError, "not Linux kernel");
-	Py_RETURN_BOOL(prog->prog.vmcoreinfo.pgtable_l5_enabled);
+	struct linux_helper_bpf_prog_entry *entries;
+	size_t num_entries;
+	char *names;
+	err = linux_helper_bpf_progs(&prog->prog, &entries, &num_entries,
+				     &names);
+	if (err)
+		return set_drgn_error(err);
+
+	PyObject *ret = PyList_New(num_entries);
+	if (!ret)
+		goto out;
+	for (size_t i = 0; i < num_entries; i++) {
+		const struct linux_helper_bpf_prog_entry *entry = &entries[i];
+		Py_ssize_t name_len = strnlen(entry->name, sizeof(entry->name));
+		/* A NULL buffer would be converted to None. */
+		const char *btf_name =
+			entry->btf_name_len ?
+			names + entry->btf_name_offset : "";
+		unsigned long long bpf_func = entry->bpf_func;
+		PyObject *item = Py_BuildValue("KIIIy#y#IIKK",
+					       (unsigned long long)entry->prog,
+					       entry->id, entry->type,
+					       entry->expected_attach_type,
+					       entry->name, name_len, btf_name,
+					       (Py_ssize_t)entry->btf_name_len,
+					       entry->len, entry->jited_len,
+					       bpf_func,
+					       (unsigned long long)entry->aux);
+		if (!item) {
+			Py_CLEAR(ret);
+			goto out;
+		}
+		PyList_SET_ITEM(ret, i, item);
+	}
+out:
+	free(names);
+	free(entries);
+	return ret;
+}
+
+PyObject *drgnpy_linux_helper_bpf_maps(PyObject *self, PyObject *args,
+				       PyObject *kwds)
+{
+	static char *keywords[] = {"prog", NULL};
+	struct drgn_error *err;
+	Program *prog;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!:bpf_maps", keywords,
+					 &Program_type, &prog))
+		return NULL;
+
+	struct linux_helper_bpf_map_entry *entries;
+	size_t num_entries;
+	err = linux_helper_bpf_maps(&prog->prog, &entries, &num_entries);
+	if (err)
+		return set_drgn_error(err);
+
+	PyObject *ret = PyList_New(num_entries);
+	if (!ret)
+		goto out;
+	for (size_t i = 0; i < num_entries; i++) {
+		const struct linux_helper_bpf_map_entry *entry = &entries[i];
+		Py_ssize_t name_len = strnlen(entry->name, sizeof(entry->name));
+		PyObject *item = Py_BuildValue("KIIy#III",
+					       (unsigned long long)entry->map,
+					       entry->id, entry->map_type,
+					       entry->name, name_len,
+					       entry->key_size,
+					       entry->value_size,
+					       entry->max_entries);
+		if (!item) {
+			Py_CLEAR(ret);
+			goto out;
+		}
+		PyList_SET_ITEM(ret, i, item);
+	}
+out:
+	free(entries);
+	return ret;
+}
+
+PyObject *drgnpy_linux_helper_kaslr_offset(PyObject *self, PyObject *args,
+					   PyObject *kwds)
+
+{
+	static char *keywords[] = {"prog", NULL};
+	Program *prog;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!:kaslr_offset",
+					 keywords, &Program_type, &prog))
+		return NULL;
+
+	if (!(prog->prog.flags & DRGN_PROGRAM_IS_LINUX_KERNEL))
+		return PyErr_Format(PyExc_ValueError, "not Linux kernel");
+	return PyLong_FromUnsignedLongLong(prog->prog.vmcoreinfo.kaslr_offset);
+}
+
+PyObject *drgnpy_linux_helper_pgtable_l5_enabled(PyObject *self, PyObject *args,
+						 PyObject *kwds)
+
+{
+	static char *keywords[] = {"prog", NULL};
+	Program *prog;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!:pgtable_l5_enabled",
+					 keywords, &Program_type, &prog))
+		return NULL;
+
+	if (!(prog->prog.flags & DRGN_PROGRAM_IS_LINUX_KERNEL))
+		return PyErr_Format(PyExc_ValueError, "not Linux kernel");
+	Py_RETURN_BOOL(prog->prog.vmcoreinfo.pgtable_l5_enabled);
+}
+
+typedef struct {
+	PyObject_HEAD
+	Program *prog;
+	struct linux_helper_list_iterator it;
+} LinuxHelperListIterator;
+
+static void LinuxHelperListIterator_dealloc(LinuxHelperListIterator *self)
+{
+	if (self->prog) {
+		linux_helper_list_iterator_deinit(&self->it);
+		Py_DECREF(self->prog);
+	}
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static DrgnObject *LinuxHelperListIterator_next(LinuxHelperListIterator *self)
+{
+	struct drgn_error *err;
+	const struct drgn_object *entry;
+	err = linux_helper_list_iterator_next(&self->it, &entry);
+	if (err)
+		return set_drgn_error(err);
+	if (!entry)
+		return NULL;
+	DrgnObject *res = DrgnObject_alloc(self->prog);
+	if (!res)
+		return NULL;
+	err = drgn_object_copy(&res->obj, entry);
+	if (err) {
+		Py_DECREF(res);
+		return set_drgn_error(err);
+	}
+	return res;
+}
+
+PyTypeObject LinuxHelperListIterator_type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "_drgn._LinuxHelperListIterator",
+	.tp_basicsize = sizeof(LinuxHelperListIterator),
+	.tp_dealloc = (destructor)LinuxHelperListIterator_dealloc,
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_iter = PyObject_SelfIter,
+	.tp_iternext = (iternextfunc)LinuxHelperListIterator_next,
+};
+
+static PyObject *linux_helper_list_iterator(PyObject *args, PyObject *kwds,
+					    const char *format,
+					    enum linux_helper_list_kind kind)
+{
+	static char *keywords[] = {"type", "head", "member", NULL};
+	struct drgn_error *err;
+	PyObject *type_obj;
+	DrgnObject *head;
+	const char *member_designator;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, format, keywords,
+					 &type_obj, &DrgnObject_type, &head,
+					 &member_designator))
+		return NULL;
+
+	Program *prog = DrgnObject_prog(head);
+	struct drgn_qualified_type qualified_type;
+	if (Program_type_arg(prog, type_obj, false, &qualified_type) == -1)
+		return NULL;
+
+	LinuxHelperListIterator *it =
+		(LinuxHelperListIterator *)LinuxHelperListIterator_type.tp_alloc(&LinuxHelperListIterator_type,
+										 0);
+	if (!it)
+		return NULL;
+	err = linux_helper_list_iterator_init(&it->it, &head->obj,
+					      qualified_type,
+					      member_designator, kind);
+	if (err) {
+		Py_DECREF(it);
+		return set_drgn_error(err);
+	}
+	it->prog = prog;
+	Py_INCREF(prog);
+	return (PyObject *)it;
+}
+
+PyObject *drgnpy_linux_helper_list_for_each_entry(PyObject *self,
+						  PyObject *args,
+						  PyObject *kwds)
+{
+	return linux_helper_list_iterator(args, kwds,
+					  "OO!s:list_for_each_entry",
+					  LINUX_HELPER_LIST);
+}
+
+PyObject *drgnpy_linux_helper_list_for_each_entry_reverse(PyObject *self,
+							  PyObject *args,
+							  PyObject *kwds)
+{
+	return linux_helper_list_iterator(args, kwds,
+					  "OO!s:list_for_each_entry_reverse",
+					  LINUX_HELPER_LIST_REVERSE);
+}
+
+PyObject *drgnpy_linux_helper_hlist_for_each_entry(PyObject *self,
+						   PyObject *args,
+						   PyObject *kwds)
+{
+	return linux_helper_list_iterator(args, kwds,
+					  "OO!s:hlist_for_each_entry",
+					  LINUX_HELPER_HLIST);
+}
+
+PyObject *drgnpy_linux_helper_hlist_nulls_for_each_entry(PyObject *self,
+							 PyObject *args,
+							 PyObject *kwds)
+{
+	return linux_helper_list_iterator(args, kwds,
+					  "OO!s:hlist_nulls_for_each_entry",
+					  LINUX_HELPER_HLIST_NULLS);
+}
+
+typedef struct {
+	PyObject_HEAD
+	Program *prog;
+	struct linux_helper_rbtree_iterator it;
+} LinuxHelperRbtreeIterator;
+
+static void LinuxHelperRbtreeIterator_dealloc(LinuxHelperRbtreeIterator *self)
+{
+	if (self->prog) {
+		linux_helper_rbtree_iterator_deinit(&self->it);
+		Py_DECREF(self->prog);
+	}
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static DrgnObject *
+LinuxHelperRbtreeIterator_next(LinuxHelperRbtreeIterator *self)
+{
+	struct drgn_error *err;
+	const struct drgn_object *entry;
+	err = linux_helper_rbtree_iterator_next(&self->it, &entry);
+	if (err)
+		return set_drgn_error(err);
+	if (!entry)
+		return NULL;
+	DrgnObject *res = DrgnObject_alloc(self->prog);
+	if (!res)
+		return NULL;
+	err = drgn_object_copy(&res->obj, entry);
+	if (err) {
+		Py_DECREF(res);
+		return set_drgn_error(err);
+	}
+	return res;
+}
+
+PyTypeObject LinuxHelperRbtreeIterator_type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "_drgn._LinuxHelperRbtreeIterator",
+	.tp_basicsize = sizeof(LinuxHelperRbtreeIterator),
+	.tp_dealloc = (destructor)LinuxHelperRbtreeIterator_dealloc,
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_iter = PyObject_SelfIter,
+	.tp_iternext = (iternextfunc)LinuxHelperRbtreeIterator_next,
+};
+
+static PyObject *
+linux_helper_rbtree_iterator(DrgnObject *root,
+			     struct drgn_qualified_type entry_type,
+			     const char *member_designator)
+{
+	struct drgn_error *err;
+	LinuxHelperRbtreeIterator *it =
+		(LinuxHelperRbtreeIterator *)LinuxHelperRbtreeIterator_type.tp_alloc(&LinuxHelperRbtreeIterator_type,
+										     0);
+	if (!it)
+		return NULL;
+	err = linux_helper_rbtree_iterator_init(&it->it, &root->obj,
+						entry_type, member_designator);
+	if (err) {
+		Py_DECREF(it);
+		return set_drgn_error(err);
+	}
+	it->prog = DrgnObject_prog(root);
+	Py_INCREF(it->prog);
+	return (PyObject *)it;
+}
+
+PyObject *drgnpy_linux_helper_rbtree_inorder_for_each(PyObject *self,
+						      PyObject *args,
+						      PyObject *kwds)
+{
+	static char *keywords[] = {"root", NULL};
+	struct drgn_error *err;
+	DrgnObject *root;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds,
+					 "O!:rbtree_inorder_for_each", keywords,
+					 &DrgnObject_type, &root))
+		return NULL;
+
+	struct drgn_qualified_type node_type;
+	err = drgn_program_find_type(&DrgnObject_prog(root)->prog,
+				     "struct rb_node", NULL, &node_type);
+	if (err)
+		return set_drgn_error(err);
+	return linux_helper_rbtree_iterator(root, node_type, NULL);
+}
+
+PyObject *drgnpy_linux_helper_rbtree_inorder_for_each_entry(PyObject *self,
+							    PyObject *args,
+							    PyObject *kwds)
+{
+	static char *keywords[] = {"type", "root", "member", NULL};
+	PyObject *type_obj;
+	DrgnObject *root;
+	const char *member_designator;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds,
+					 "OO!s:rbtree_inorder_for_each_entry",
+					 keywords, &type_obj, &DrgnObject_type,
+					 &root, &member_designator))
+		return NULL;
+
+	struct drgn_qualified_type entry_type;
+	if (Program_type_arg(DrgnObject_prog(root), type_obj, false,
+			     &entry_type) == -1)
+		return NULL;
+	return linux_helper_rbtree_iterator(root, entry_type,
+					    member_designator);
+}
+
+typedef struct {
+	PyObject_HEAD
+	Program *prog;
+	struct linux_helper_radix_tree_iterator it;
+} LinuxHelperRadixTreeIterator;
+
+static void
+LinuxHelperRadixTreeIterator_dealloc(LinuxHelperRadixTreeIterator *self)
+{
+	if (self->prog) {
+		linux_helper_radix_tree_iterator_deinit(&self->it);
+		Py_DECREF(self->prog);
+	}
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *
+LinuxHelperRadixTreeIterator_next(LinuxHelperRadixTreeIterator *self)
+{
+	struct drgn_error *err;
+	const struct drgn_object *entry;
+	err = linux_helper_radix_tree_iterator_next(&self->it, &entry);
+	if (err)
+		return set_drgn_error(err);
+	if (!entry)
+		return NULL;
+	DrgnObject *res = DrgnObject_alloc(self->prog);
+	if (!res)
+		return NULL;
+	err = drgn_object_copy(&res->obj, entry);
+	if (err) {
+		Py_DECREF(res);
+		return set_drgn_error(err);
+	}
+	return Py_BuildValue("KN", (unsigned long long)self->it.index, res);
+}
+
+PyTypeObject LinuxHelperRadixTreeIterator_type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "_drgn._LinuxHelperRadixTreeIterator",
+	.tp_basicsize = sizeof(LinuxHelperRadixTreeIterator),
+	.tp_dealloc = (destructor)LinuxHelperRadixTreeIterator_dealloc,
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_iter = PyObject_SelfIter,
+	.tp_iternext = (iternextfunc)LinuxHelperRadixTreeIterator_next,
+};
+
+PyObject *drgnpy_linux_helper_radix_tree_for_each(PyObject *self,
+						  PyObject *args,
+						  PyObject *kwds)
+{
+	static char *keywords[] = {"root", "skip_values", NULL};
+	struct drgn_error *err;
+	DrgnObject *root;
+	int skip_values = 0;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds,
+					 "O!|$p:radix_tree_for_each", keywords,
+					 &DrgnObject_type, &root, &skip_values))
+		return NULL;
+
+	LinuxHelperRadixTreeIterator *it =
+		(LinuxHelperRadixTreeIterator *)LinuxHelperRadixTreeIterator_type.tp_alloc(&LinuxHelperRadixTreeIterator_type,
+											   0);
+	if (!it)
+		return NULL;
+	err = linux_helper_radix_tree_iterator_init(&it->it, &root->obj,
+						    skip_values);
+	if (err) {
+		Py_DECREF(it);
+		return set_drgn_error(err);
+	}
+	it->prog = DrgnObject_prog(root);
+	Py_INCREF(it->prog);
+	return (PyObject *)it;
+}
+
+PyObject *drgnpy_linux_helper_idr_for_each(PyObject *self, PyObject *args,
+					   PyObject *kwds)
+{
+	static char *keywords[] = {"idr", NULL};
+	struct drgn_error *err;
+	DrgnObject *idr;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!:idr_for_each",
+					 keywords, &DrgnObject_type, &idr))
+		return NULL;
+
+	LinuxHelperRadixTreeIterator *it =
+		(LinuxHelperRadixTreeIterator *)LinuxHelperRadixTreeIterator_type.tp_alloc(&LinuxHelperRadixTreeIterator_type,
+											   0);
+	if (!it)
+		return NULL;
+	err = linux_helper_idr_iterator_init(&it->it, &idr->obj);
+	if (err) {
+		Py_DECREF(it);
+		return set_drgn_error(err);
+	}
+	it->prog = DrgnObject_prog(idr);
+	Py_INCREF(it->prog);
+	return (PyObject *)it;
+}
+
+typedef struct {
+	PyObject_HEAD
+	struct linux_helper_bitmap bitmap;
+	uint64_t next;
+	bool set;
+	bool initialized;
+} LinuxHelperBitmapIterator;
+
+static void LinuxHelperBitmapIterator_dealloc(LinuxHelperBitmapIterator *self)
+{
+	if (self->initialized)
+		linux_helper_bitmap_deinit(&self->bitmap);
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *LinuxHelperBitmapIterator_next(LinuxHelperBitmapIterator *self)
+{
+	uint64_t bit = linux_helper_bitmap_next(&self->bitmap, self->next,
+						self->set);
+	if (bit >= self->bitmap.size) {
+		self->next = self->bitmap.size;
+		return NULL;
+	}
+	self->next = bit + 1;
+	return PyLong_FromUnsignedLongLong(bit);
+}
+
+PyTypeObject LinuxHelperBitmapIterator_type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "_drgn._LinuxHelperBitmapIterator",
+	.tp_basicsize = sizeof(LinuxHelperBitmapIterator),
+	.tp_dealloc = (destructor)LinuxHelperBitmapIterator_dealloc,
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_iter = PyObject_SelfIter,
+	.tp_iternext = (iternextfunc)LinuxHelperBitmapIterator_next,
+};
+
+static PyObject *linux_helper_bitmap_iterator(PyObject *args, PyObject *kwds,
+					      const char *format, bool set)
+{
+	static char *keywords[] = {"bitmap", "size", NULL};
+	struct drgn_error *err;
+	DrgnObject *bitmap;
+	struct index_arg size = {};
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, format, keywords,
+					 &DrgnObject_type, &bitmap,
+					 index_converter, &size))
+		return NULL;
+
+	LinuxHelperBitmapIterator *it =
+		(LinuxHelperBitmapIterator *)LinuxHelperBitmapIterator_type.tp_alloc(&LinuxHelperBitmapIterator_type,
+										     0);
+	if (!it)
+		return NULL;
+	err = linux_helper_bitmap_init(&it->bitmap, &bitmap->obj, size.uvalue);
+	if (err) {
+		Py_DECREF(it);
+		return set_drgn_error(err);
+	}
+	it->initialized = true;
+	it->set = set;
+	return (PyObject *)it;
+}
+
+PyObject *drgnpy_linux_helper_for_each_set_bit(PyObject *self, PyObject *args,
+					       PyObject *kwds)
+{
+	return linux_helper_bitmap_iterator(args, kwds,
+					    "O!O&:for_each_set_bit", true);
+}
+
+PyObject *drgnpy_linux_helper_for_each_clear_bit(PyObject *self,
+						 PyObject *args,
+						 PyObject *kwds)
+{
+	return linux_helper_bitmap_iterator(args, kwds,
+					    "O!O&:for_each_clear_bit", false);
+}
+
+PyObject *drgnpy_linux_helper_bitmap_weight(PyObject *self, PyObject *args,
+					    PyObject *kwds)
+{
+	static char *keywords[] = {"bitmap", "size", NULL};
+	struct drgn_error *err;
+	DrgnObject *bitmap;
+	struct index_arg size = {};
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!O&:bitmap_weight",
+					 keywords, &DrgnObject_type, &bitmap,
+					 index_converter, &size))
+		return NULL;
+
+	struct linux_helper_bitmap b;
+	err = linux_helper_bitmap_init(&b, &bitmap->obj, size.uvalue);
+	if (err)
+		return set_drgn_error(err);
+	uint64_t weight = linux_helper_bitmap_weight(&b);
+	linux_helper_bitmap_deinit(&b);
+	return PyLong_FromUnsignedLongLong(weight);
+}
+
+typedef struct {
+	PyObject_HEAD
+	Program *prog;
+	struct linux_helper_slab_object_iterator it;
+} LinuxHelperSlabObjectIterator;
+
+static void
+LinuxHelperSlabObjectIterator_dealloc(LinuxHelperSlabObjectIterator *self)
+{
+	if (self->prog) {
+		linux_helper_slab_object_iterator_deinit(&self->it);
+		Py_DECREF(self->prog);
+	}
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static DrgnObject *
+LinuxHelperSlabObjectIterator_next(LinuxHelperSlabObjectIterator *self)
+{
+	struct drgn_error *err;
+	const struct drgn_object *entry;
+	err = linux_helper_slab_object_iterator_next(&self->it, &entry);
+	if (err)
+		return set_drgn_error(err);
+	if (!entry)
+		return NULL;
+	DrgnObject *res = DrgnObject_alloc(self->prog);
+	if (!res)
+		return NULL;
+	err = drgn_object_copy(&res->obj, entry);
+	if (err) {
+		Py_DECREF(res);
+		return set_drgn_error(err);
+	}
+	return res;
+}
+
+PyTypeObject LinuxHelperSlabObjectIterator_type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "_drgn._LinuxHelperSlabObjectIterator",
+	.tp_basicsize = sizeof(LinuxHelperSlabObjectIterator),
+	.tp_dealloc = (destructor)LinuxHelperSlabObjectIterator_dealloc,
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_iter = PyObject_SelfIter,
+	.tp_iternext = (iternextfunc)LinuxHelperSlabObjectIterator_next,
+};
+
+PyObject *
+drgnpy_linux_helper_slab_cache_for_each_allocated_object(PyObject *self,
+							 PyObject *args,
+							 PyObject *kwds)
+{
+	static char *keywords[] = {"slab_cache", "type", NULL};
+	struct drgn_error *err;
+	DrgnObject *slab_cache;
+	PyObject *type_obj;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds,
+					 "O!O:slab_cache_for_each_allocated_object",
+					 keywords, &DrgnObject_type,
+					 &slab_cache, &type_obj))
+		return NULL;
+
+	Program *prog = DrgnObject_prog(slab_cache);
+	struct drgn_qualified_type qualified_type;
+	if (Program_type_arg(prog, type_obj, false, &qualified_type) == -1)
+		return NULL;
+
+	LinuxHelperSlabObjectIterator *it =
+		(LinuxHelperSlabObjectIterator *)LinuxHelperSlabObjectIterator_type.tp_alloc(&LinuxHelperSlabObjectIterator_type,
+											     0);
+	if (!it)
+		return NULL;
+	err = linux_helper_slab_object_iterator_init(&it->it, &slab_cache->obj,
+						     qualified_type);
+	if (err) {
+		Py_DECREF(it);
+		return set_drgn_error(err);
+	}
+	it->prog = prog;
+	Py_INCREF(prog);
+	return (PyObject *)it;
+}
+
+typedef struct {
+	PyObject_HEAD
+	struct linux_helper_heap_graph *graph;
+} LinuxHelperHeapGraph;
+
+static void LinuxHelperHeapGraph_dealloc(LinuxHelperHeapGraph *self)
+{
+	linux_helper_heap_graph_destroy(self->graph);
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static Py_ssize_t LinuxHelperHeapGraph_length(LinuxHelperHeapGraph *self)
+{
+	return self->graph->num_objects;
+}
+
+static PyObject *LinuxHelperHeapGraph_find(LinuxHelperHeapGraph *self,
+					   PyObject *args, PyObject *kwds)
+{
+	static char *keywords[] = {"address", NULL};
+	struct index_arg address = {};
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&:find", keywords,
+					 index_converter, &address))
+		return NULL;
+	size_t i = linux_helper_heap_graph_find(self->graph, address.uvalue);
+	if (i == SIZE_MAX)
+		Py_RETURN_NONE;
+	return Py_BuildValue("KI",
+			     (unsigned long long)self->graph->addresses[i],
+			     (unsigned int)self->graph->sizes[i]);
+}
+
+static PyObject *LinuxHelperHeapGraph_referrers(LinuxHelperHeapGraph *self,
+						PyObject *args, PyObject *kwds)
+{
+	static char *keywords[] = {"address", NULL};
+	struct index_arg address = {};
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&:referrers", keywords,
+					 index_converter, &address))
+		return NULL;
+	struct linux_helper_heap_graph *graph = self->graph;
+	size_t i = linux_helper_heap_graph_find(graph, address.uvalue);
+	if (i == SIZE_MAX)
+		return PyList_New(0);
+	size_t start = graph->referrer_offsets[i];
+	size_t end = graph->referrer_offsets[i + 1];
+	PyObject *ret = PyList_New(end - start);
+	if (!ret)
+		return NULL;
+	for (size_t j = start; j < end; j++) {
+		PyObject *item = PyLong_FromUnsignedLongLong(graph->referrers[j]);
+		if (!item) {
+			Py_DECREF(ret);
+			return NULL;
+		}
+		PyList_SET_ITEM(ret, j - start, item);
+	}
+	return ret;
+}
+
+static PyObject *
+LinuxHelperHeapGraph_get_num_referrers(LinuxHelperHeapGraph *self, void *arg)
+{
+	return PyLong_FromSize_t(self->graph->num_referrers);
+}
+
+static PyMethodDef LinuxHelperHeapGraph_methods[] = {
+	{"find", (PyCFunction)LinuxHelperHeapGraph_find,
+	 METH_VARARGS | METH_KEYWORDS},
+	{"referrers", (PyCFunction)LinuxHelperHeapGraph_referrers,
+	 METH_VARARGS | METH_KEYWORDS},
+	{},
+};
+
+static PyGetSetDef LinuxHelperHeapGraph_getset[] = {
+	{"num_referrers", (getter)LinuxHelperHeapGraph_get_num_referrers},
+	{},
+};
+
+static PySequenceMethods LinuxHelperHeapGraph_as_sequence = {
+	.sq_length = (lenfunc)LinuxHelperHeapGraph_length,
+};
+
+PyTypeObject LinuxHelperHeapGraph_type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "_drgn._LinuxHelperHeapGraph",
+	.tp_basicsize = sizeof(LinuxHelperHeapGraph),
+	.tp_dealloc = (destructor)LinuxHelperHeapGraph_dealloc,
+	.tp_as_sequence = &LinuxHelperHeapGraph_as_sequence,
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_methods = LinuxHelperHeapGraph_methods,
+	.tp_getset = LinuxHelperHeapGraph_getset,
+};
+
+PyObject *drgnpy_linux_helper_heap_graph(PyObject *self, PyObject *args,
+					 PyObject *kwds)
+{
+	static char *keywords[] = {"prog", "scan_pages", NULL};
+	struct drgn_error *err;
+	Program *prog;
+	int scan_pages = 0;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!|p:heap_graph",
+					 keywords, &Program_type, &prog,
+					 &scan_pages))
+		return NULL;
+
+	LinuxHelperHeapGraph *ret =
+		(LinuxHelperHeapGraph *)LinuxHelperHeapGraph_type.tp_alloc(&LinuxHelperHeapGraph_type,
+									   0);
+	if (!ret)
+		return NULL;
+	bool clear = set_drgn_in_python();
+	Py_BEGIN_ALLOW_THREADS
+	err = linux_helper_heap_graph_create(&prog->prog, scan_pages,
+					     &ret->graph);
+	Py_END_ALLOW_THREADS
+	if (clear)
+		clear_drgn_in_python();
+	if (err) {
+		Py_DECREF(ret);
+		return set_drgn_error(err);
+	}
+	return (PyObject *)ret;
+}
+
+typedef struct {
+	PyObject_HEAD
+	Program *prog;
+	struct linux_helper_pipeline pipeline;
+} LinuxHelperPipeline;
+
+static void LinuxHelperPipeline_dealloc(LinuxHelperPipeline *self)
+{
+	if (self->prog) {
+		linux_helper_pipeline_deinit(&self->pipeline);
+		Py_DECREF(self->prog);
+	}
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static struct drgn_error *
+append_pipeline_row(uint64_t address, const union drgn_value *values,
+		    void *arg)
+{
+	PyObject **args = arg;
+	LinuxHelperPipeline *self = (LinuxHelperPipeline *)args[0];
+	PyObject *rows = args[1];
+	const struct linux_helper_pipeline *pipeline = &self->pipeline;
+	size_t num_projections = pipeline->num_projections;
+	PyObject *row = PyTuple_New(num_projections + 1);
+	if (!row)
+		return drgn_error_from_python();
+	PyObject *item = PyLong_FromUnsignedLongLong(address);
+	if (!item)
+		goto err;
+	PyTuple_SET_ITEM(row, 0, item);
+	for (size_t i = 0; i < num_projections; i++) {
+		switch (pipeline->encodings[pipeline->num_filters + i]) {
+		case DRGN_OBJECT_ENCODING_SIGNED:
+			item = PyLong_FromLongLong(values[i].svalue);
+			break;
+		case DRGN_OBJECT_ENCODING_FLOAT:
+			item = PyFloat_FromDouble(values[i].fvalue);
+			break;
+		default:
+			item = PyLong_FromUnsignedLongLong(values[i].uvalue);
+			break;
+		}
+		if (!item)
+			goto err;
+		PyTuple_SET_ITEM(row, i + 1, item);
+	}
+	int ret = PyList_Append(rows, row);
+	Py_DECREF(row);
+	if (ret)
+		return drgn_error_from_python();
+	return NULL;
+
+err:
+	Py_DECREF(row);
+	return drgn_error_from_python();
+}
+
+static PyObject *LinuxHelperPipeline_run(LinuxHelperPipeline *self,
+					 PyObject *args, PyObject *kwds)
+{
+	static char *keywords[] = {"root", NULL};
+	struct drgn_error *err;
+	DrgnObject *root;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!:run", keywords,
+					 &DrgnObject_type, &root))
+		return NULL;
+	if (DrgnObject_prog(root) != self->prog) {
+		PyErr_SetString(PyExc_ValueError,
+				"object is from different program");
+		return NULL;
+	}
+
+	PyObject *rows = PyList_New(0);
+	if (!rows)
+		return NULL;
+	PyObject *arg[] = { (PyObject *)self, rows };
+	err = linux_helper_pipeline_run(&self->pipeline, &root->obj,
+					append_pipeline_row, arg);
+	if (err) {
+		Py_DECREF(rows);
+		return set_drgn_error(err);
+	}
+	return rows;
+}
+
+static PyMethodDef LinuxHelperPipeline_methods[] = {
+	{"run", (PyCFunction)LinuxHelperPipeline_run,
+	 METH_VARARGS | METH_KEYWORDS},
+	{},
+};
+
+PyTypeObject LinuxHelperPipeline_type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "_drgn._LinuxHelperPipeline",
+	.tp_basicsize = sizeof(LinuxHelperPipeline),
+	.tp_dealloc = (destructor)LinuxHelperPipeline_dealloc,
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_methods = LinuxHelperPipeline_methods,
+};
+
+/* Get a member path from a MemberPath or a string compiled against a type. */
+static int pipeline_member_path(Program *prog, struct drgn_type *type,
+				PyObject *item, struct drgn_member_path *ret)
+{
+	if (PyObject_TypeCheck(item, &MemberPath_type)) {
+		if (((MemberPath *)item)->prog != prog) {
+			PyErr_SetString(PyExc_ValueError,
+					"member path is from different program");
+			return -1;
+		}
+		*ret = ((MemberPath *)item)->path;
+		return 0;
+	} else if (PyUnicode_Check(item)) {
+		const char *member = PyUnicode_AsUTF8(item);
+		if (!member)
+			return -1;
+		struct drgn_error *err = drgn_member_path_init(ret, type,
+							       member);
+		if (err) {
+			set_drgn_error(err);
+			return -1;
+		}
+		return 0;
+	} else {
+		PyErr_SetString(PyExc_TypeError,
+				"member must be str or MemberPath");
+		return -1;
+	}
+}
+
+static int pipeline_filter_arg(Program *prog, struct drgn_type *type,
+			       PyObject *item,
+			       struct linux_helper_pipeline_filter *ret)
+{
+	static const char * const ops[] = {
+		[LINUX_HELPER_PIPELINE_EQ] = "==",
+		[LINUX_HELPER_PIPELINE_NE] = "!=",
+		[LINUX_HELPER_PIPELINE_LT] = "<",
+		[LINUX_HELPER_PIPELINE_LE] = "<=",
+		[LINUX_HELPER_PIPELINE_GT] = ">",
+		[LINUX_HELPER_PIPELINE_GE] = ">=",
+		[LINUX_HELPER_PIPELINE_AND] = "&",
+	};
+	PyObject *member, *value;
+	const char *op;
+	if (!PyArg_ParseTuple(item, "OsO:pipeline filter", &member, &op,
+			      &value))
+		return -1;
+	if (pipeline_member_path(prog, type, member, &ret->path))
+		return -1;
+	size_t i;
+	for (i = 0; i < array_size(ops); i++) {
+		if (strcmp(op, ops[i]) == 0)
+			break;
+	}
+	if (i == array_size(ops)) {
+		PyErr_Format(PyExc_ValueError, "invalid filter operator '%s'",
+			     op);
+		return -1;
+	}
+	ret->op = i;
+
+	if (PyFloat_Check(value)) {
+		ret->encoding = DRGN_OBJECT_ENCODING_FLOAT;
+		ret->value.fvalue = PyFloat_AS_DOUBLE(value);
+		return 0;
+	}
+	PyObject *index = PyNumber_Index(value);
+	if (!index)
+		return -1;
+	int overflow;
+	long long svalue = PyLong_AsLongLongAndOverflow(index, &overflow);
+	if (svalue == -1 && PyErr_Occurred()) {
+		Py_DECREF(index);
+		return -1;
+	}
+	if (overflow > 0) {
+		ret->encoding = DRGN_OBJECT_ENCODING_UNSIGNED;
+		ret->value.uvalue = PyLong_AsUnsignedLongLong(index);
+		Py_DECREF(index);
+		return ret->value.uvalue == (uint64_t)-1 && PyErr_Occurred() ?
+		       -1 : 0;
+	}
+	Py_DECREF(index);
+	if (overflow < 0) {
+		PyErr_SetString(PyExc_OverflowError,
+				"filter value is out of range");
+		return -1;
+	}
+	if (svalue < 0) {
+		ret->encoding = DRGN_OBJECT_ENCODING_SIGNED;
+		ret->value.svalue = svalue;
+	} else {
+		ret->encoding = DRGN_OBJECT_ENCODING_UNSIGNED;
+		ret->value.uvalue = svalue;
+	}
+	return 0;
+}
+
+PyObject *drgnpy_linux_helper_pipeline(PyObject *self, PyObject *args,
+				       PyObject *kwds)
+{
+	static char *keywords[] = {
+		"prog", "type", "source", "member", "filters", "projections",
+		NULL,
+	};
+	static const char * const sources[] = {
+		[LINUX_HELPER_PIPELINE_LIST] = "list",
+		[LINUX_HELPER_PIPELINE_LIST_REVERSE] = "list_reverse",
+		[LINUX_HELPER_PIPELINE_HLIST] = "hlist",
+		[LINUX_HELPER_PIPELINE_HLIST_NULLS] = "hlist_nulls",
+		[LINUX_HELPER_PIPELINE_RBTREE] = "rbtree",
+		[LINUX_HELPER_PIPELINE_RADIX_TREE] = "radix_tree",
+		[LINUX_HELPER_PIPELINE_SLAB] = "slab",
+		[LINUX_HELPER_PIPELINE_ARRAY] = "array",
+	};
+	struct drgn_error *err;
+	Program *prog;
+	PyObject *type_obj, *filters_obj, *projections_obj;
+	const char *source_name, *member;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!OszOO:pipeline",
+					 keywords, &Program_type, &prog,
+					 &type_obj, &source_name, &member,
+					 &filters_obj, &projections_obj))
+		return NULL;
+
+	size_t source;
+	for (source = 0; source < array_size(sources); source++) {
+		if (strcmp(source_name, sources[source]) == 0)
+			break;
+	}
+	/* An XArray is iterated like a radix tree. */
+	if (strcmp(source_name, "xarray") == 0)
+		source = LINUX_HELPER_PIPELINE_RADIX_TREE;
+	if (source == array_size(sources)) {
+		PyErr_Format(PyExc_ValueError, "invalid pipeline source '%s'",
+			     source_name);
+		return NULL;
+	}
+
+	struct drgn_qualified_type qualified_type;
+	if (Program_type_arg(prog, type_obj, false, &qualified_type) == -1)
+		return NULL;
+	struct drgn_type *type = drgn_underlying_type(qualified_type.type);
+
+	PyObject *ret = NULL;
+	struct linux_helper_pipeline_filter *filters = NULL;
+	struct drgn_member_path *projections = NULL;
+	PyObject *filters_seq = PySequence_Fast(filters_obj,
+						"filters must be iterable");
+	if (!filters_seq)
+		return NULL;
+	PyObject *projections_seq =
+		PySequence_Fast(projections_obj,
+				"projections must be iterable");
+	if (!projections_seq)
+		goto out;
+	Py_ssize_t num_filters = PySequence_Fast_GET_SIZE(filters_seq);
+	Py_ssize_t num_projections = PySequence_Fast_GET_SIZE(projections_seq);
+	filters = malloc_array(num_filters, sizeof(filters[0]));
+	projections = malloc_array(num_projections, sizeof(projections[0]));
+	if ((!filters && num_filters) || (!projections && num_projections)) {
+		PyErr_NoMemory();
+		goto out;
+	}
+	for (Py_ssize_t i = 0; i < num_filters; i++) {
+		if (pipeline_filter_arg(prog, type,
+					PySequence_Fast_GET_ITEM(filters_seq,
+								 i),
+					&filters[i]))
+			goto out;
+	}
+	for (Py_ssize_t i = 0; i < num_projections; i++) {
+		if (pipeline_member_path(prog, type,
+					 PySequence_Fast_GET_ITEM(projections_seq,
+								  i),
+					 &projections[i]))
+			goto out;
+	}
+
+	LinuxHelperPipeline *pipeline =
+		(LinuxHelperPipeline *)LinuxHelperPipeline_type.tp_alloc(&LinuxHelperPipeline_type,
+									 0);
+	if (!pipeline)
+		goto out;
+	err = linux_helper_pipeline_init(&pipeline->pipeline, source,
+					 qualified_type, member, filters,
+					 num_filters, projections,
+					 num_projections);
+	if (err) {
+		Py_DECREF(pipeline);
+		set_drgn_error(err);
+		goto out;
+	}
+	pipeline->prog = prog;
+	Py_INCREF(prog);
+	ret = (PyObject *)pipeline;
+out:
+	free(projections);
+	free(filters);
+	Py_XDECREF(projections_seq);
+	Py_DECREF(filters_seq);
+	return ret;
+}
+
+PyObject *drgnpy_linux_helper_find_page_pfns(PyObject *self, PyObject *args,
+					     PyObject *kwds)
+{
+	static char *keywords[] = {
+		"prog", "flags_mask", "flags_value", "mapping", "min_refcount",
+		NULL
+	};
+	struct drgn_error *err;
+	Program *prog;
+	struct index_arg flags_mask = {};
+	struct index_arg flags_value = { .allow_none = true, .is_none = true };
+	struct index_arg mapping = { .allow_none = true, .is_none = true };
+	struct index_arg min_refcount = {
+		.allow_none = true,
+		.is_none = true,
+		.is_signed = true,
+	};
+	if (!PyArg_ParseTupleAndKeywords(args, kwds,
+					 "O!|O&O&$O&O&:find_page_pfns",
+					 keywords, &Program_type, &prog,
+					 index_converter, &flags_mask,
+					 index_converter, &flags_value,
+					 index_converter, &mapping,
+					 index_converter, &min_refcount))
+		return NULL;
+
+	if (!min_refcount.is_none &&
+	    (min_refcount.svalue < INT32_MIN ||
+	     min_refcount.svalue > INT32_MAX)) {
+		PyErr_SetString(PyExc_OverflowError,
+				"min_refcount is out of range");
+		return NULL;
+	}
+	struct linux_helper_page_filter filter = {
+		.flags_mask = flags_mask.uvalue,
+		.flags_value = (flags_value.is_none ?
+				flags_mask.uvalue : flags_value.uvalue),
+		.match_mapping = !mapping.is_none,
+		.mapping = mapping.uvalue,
+		.match_refcount = !min_refcount.is_none,
+		.min_refcount = min_refcount.svalue,
+	};
+	uint64_t *pfns;
+	size_t num_pfns;
+	err = linux_helper_find_pages(&prog->prog, &filter, &pfns, &num_pfns);
+	if (err)
+		return set_drgn_error(err);
+	PyObject *ret = PyBytes_FromStringAndSize((char *)pfns,
+						  num_pfns * sizeof(pfns[0]));
+	free(pfns);
+	return ret;
+}
+
+static struct drgn_error *
+append_printk_record(const struct linux_helper_printk_record *record,
+		     void *arg)
+{
+	PyObject *records = arg;
+	PyObject *context = PyDict_New();
+	if (!context)
+		return drgn_error_from_python();
+	const char *p = record->dict, *end = record->dict + record->dict_len;
+	while (p < end) {
+		const char *entry_end = memchr(p, '\0', end - p);
+		if (!entry_end)
+			entry_end = end;
+		const char *eq = memchr(p, '=', entry_end - p);
+		if (eq) {
+			PyObject *key = PyBytes_FromStringAndSize(p, eq - p);
+			if (!key)
+				goto err_context;
+			PyObject *value =
+				PyBytes_FromStringAndSize(eq + 1,
+							  entry_end - (eq + 1));
+			if (!value) {
+				Py_DECREF(key);
+				goto err_context;
+			}
+			int ret = PyDict_SetItem(context, key, value);
+			Py_DECREF(value);
+			Py_DECREF(key);
+			if (ret)
+				goto err_context;
+		}
+		p = entry_end + 1;
+	}
+
+	PyObject *caller = NULL, *caller_tid = Py_None, *caller_cpu = Py_None;
+	if (record->has_caller_id) {
+		caller = PyLong_FromUnsignedLong(record->caller_id &
+						 ~UINT32_C(0x80000000));
+		if (!caller)
+			goto err_context;
+		if (record->caller_id & UINT32_C(0x80000000))
+			caller_cpu = caller;
+		else
+			caller_tid = caller;
+	}
+	PyObject *item = Py_BuildValue("y#BBKKOOOO", record->text,
+				       (Py_ssize_t)record->text_len,
+				       record->facility, record->level,
+				       (unsigned long long)record->seq,
+				       (unsigned long long)record->timestamp,
+				       caller_tid, caller_cpu,
+				       record->continuation ? Py_True : Py_False,
+				       context);
+	Py_XDECREF(caller);
+	Py_DECREF(context);
+	if (!item)
+		return drgn_error_from_python();
+	int ret = PyList_Append(records, item);
+	Py_DECREF(item);
+	if (ret)
+		return drgn_error_from_python();
+	return NULL;
+
+err_context:
+	Py_DECREF(context);
+	return drgn_error_from_python();
+}
+
+PyObject *drgnpy_linux_helper_printk_records(PyObject *self, PyObject *args,
+					     PyObject *kwds)
+{
+	static char *keywords[] = {"prog", "min_seq", NULL};
+	struct drgn_error *err;
+	Program *prog;
+	struct index_arg min_seq = {};
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!|O&:printk_records",
+					 keywords, &Program_type, &prog,
+					 index_converter, &min_seq))
+		return NULL;
+
+	PyObject *records = PyList_New(0);
+	if (!records)
+		return NULL;
+	bool clear = set_drgn_in_python();
+	err = linux_helper_for_each_printk_record(&prog->prog, min_seq.uvalue,
+						  append_printk_record,
+						  records);
+	if (clear)
+		clear_drgn_in_python();
+	if (err) {
+		Py_DECREF(records);
+		return set_drgn_error(err);
+	}
+	return records;
 }
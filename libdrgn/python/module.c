@@ -122,24 +122,116 @@ static PyMethodDef drgn_methods[] = {
 	 METH_NOARGS, drgn_program_from_kernel_DOC},
 	{"program_from_pid", (PyCFunction)program_from_pid,
 	 METH_VARARGS | METH_KEYWORDS, drgn_program_from_pid_DOC},
+	{"_decode_enum_type_flags",
+	 (PyCFunction)drgnpy_decode_enum_type_flags,
+	 METH_VARARGS | METH_KEYWORDS},
 	{"_linux_helper_read_vm", (PyCFunction)drgnpy_linux_helper_read_vm,
 	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_pgtable_mappings",
+	 (PyCFunction)drgnpy_linux_helper_pgtable_mappings,
+	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_reverse_map",
+	 (PyCFunction)drgnpy_linux_helper_reverse_map,
+	 METH_VARARGS | METH_KEYWORDS},
 	{"_linux_helper_per_cpu_ptr",
 	 (PyCFunction)drgnpy_linux_helper_per_cpu_ptr,
 	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_per_cpu_values",
+	 (PyCFunction)drgnpy_linux_helper_per_cpu_values,
+	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_per_cpu_sum",
+	 (PyCFunction)drgnpy_linux_helper_per_cpu_sum,
+	 METH_VARARGS | METH_KEYWORDS},
 	{"_linux_helper_idle_task", (PyCFunction)drgnpy_linux_helper_idle_task,
 	 METH_VARARGS | METH_KEYWORDS},
 	{"_linux_helper_radix_tree_lookup",
 	 (PyCFunction)drgnpy_linux_helper_radix_tree_lookup,
 	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_radix_tree_for_each",
+	 (PyCFunction)drgnpy_linux_helper_radix_tree_for_each,
+	 METH_VARARGS | METH_KEYWORDS},
 	{"_linux_helper_idr_find", (PyCFunction)drgnpy_linux_helper_idr_find,
 	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_idr_for_each",
+	 (PyCFunction)drgnpy_linux_helper_idr_for_each,
+	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_for_each_set_bit",
+	 (PyCFunction)drgnpy_linux_helper_for_each_set_bit,
+	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_for_each_clear_bit",
+	 (PyCFunction)drgnpy_linux_helper_for_each_clear_bit,
+	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_bitmap_weight",
+	 (PyCFunction)drgnpy_linux_helper_bitmap_weight,
+	 METH_VARARGS | METH_KEYWORDS},
 	{"_linux_helper_find_pid", (PyCFunction)drgnpy_linux_helper_find_pid,
 	 METH_VARARGS | METH_KEYWORDS},
 	{"_linux_helper_pid_task", (PyCFunction)drgnpy_linux_helper_pid_task,
 	 METH_VARARGS | METH_KEYWORDS},
 	{"_linux_helper_find_task", (PyCFunction)drgnpy_linux_helper_find_task,
 	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_find_thread_group",
+	 (PyCFunction)drgnpy_linux_helper_find_thread_group,
+	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_find_tasks_by_comm",
+	 (PyCFunction)drgnpy_linux_helper_find_tasks_by_comm,
+	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_for_each_file",
+	 (PyCFunction)drgnpy_linux_helper_for_each_file,
+	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_for_each_task_file",
+	 (PyCFunction)drgnpy_linux_helper_for_each_task_file,
+	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_d_path", (PyCFunction)drgnpy_linux_helper_d_path,
+	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_dentry_path",
+	 (PyCFunction)drgnpy_linux_helper_dentry_path,
+	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_d_paths", (PyCFunction)drgnpy_linux_helper_d_paths,
+	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_css_descendants_pre",
+	 (PyCFunction)drgnpy_linux_helper_css_descendants_pre,
+	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_sk_hash_sockets",
+	 (PyCFunction)drgnpy_linux_helper_sk_hash_sockets,
+	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_bpf_progs", (PyCFunction)drgnpy_linux_helper_bpf_progs,
+	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_bpf_maps", (PyCFunction)drgnpy_linux_helper_bpf_maps,
+	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_list_for_each_entry",
+	 (PyCFunction)drgnpy_linux_helper_list_for_each_entry,
+	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_list_for_each_entry_reverse",
+	 (PyCFunction)drgnpy_linux_helper_list_for_each_entry_reverse,
+	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_hlist_for_each_entry",
+	 (PyCFunction)drgnpy_linux_helper_hlist_for_each_entry,
+	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_hlist_nulls_for_each_entry",
+	 (PyCFunction)drgnpy_linux_helper_hlist_nulls_for_each_entry,
+	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_rbtree_inorder_for_each",
+	 (PyCFunction)drgnpy_linux_helper_rbtree_inorder_for_each,
+	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_rbtree_inorder_for_each_entry",
+	 (PyCFunction)drgnpy_linux_helper_rbtree_inorder_for_each_entry,
+	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_find_page_pfns",
+	 (PyCFunction)drgnpy_linux_helper_find_page_pfns,
+	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_heap_graph",
+	 (PyCFunction)drgnpy_linux_helper_heap_graph,
+	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_pipeline",
+	 (PyCFunction)drgnpy_linux_helper_pipeline,
+	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_printk_records",
+	 (PyCFunction)drgnpy_linux_helper_printk_records,
+	 METH_VARARGS | METH_KEYWORDS},
+	{"_linux_helper_slab_cache_for_each_allocated_object",
+	 (PyCFunction)drgnpy_linux_helper_slab_cache_for_each_allocated_object,
+	 METH_VARARGS | METH_KEYWORDS},
 	{"_linux_helper_kaslr_offset",
 	 (PyCFunction)drgnpy_linux_helper_kaslr_offset,
 	 METH_VARARGS | METH_KEYWORDS},
@@ -227,7 +319,16 @@ DRGNPY_PUBLIC PyMODINIT_FUNC PyInit__drgn(void)
 	    add_type_aliases(m) ||
 	    add_type(m, &Language_type) || add_languages() ||
 	    add_type(m, &DrgnObject_type) ||
+	    add_type(m, &MemberPath_type) ||
+	    PyType_Ready(&BorrowedBuffer_type) ||
 	    PyType_Ready(&ObjectIterator_type) ||
+	    PyType_Ready(&LinuxHelperBitmapIterator_type) ||
+	    PyType_Ready(&LinuxHelperHeapGraph_type) ||
+	    PyType_Ready(&LinuxHelperListIterator_type) ||
+	    PyType_Ready(&LinuxHelperPipeline_type) ||
+	    PyType_Ready(&LinuxHelperRadixTreeIterator_type) ||
+	    PyType_Ready(&LinuxHelperRbtreeIterator_type) ||
+	    PyType_Ready(&LinuxHelperSlabObjectIterator_type) ||
 	    add_type(m, &Platform_type) ||
 	    add_type(m, &Program_type) ||
 	    add_type(m, &Register_type) ||
@@ -237,9 +338,12 @@ DRGNPY_PUBLIC PyMODINIT_FUNC PyInit__drgn(void)
 	    add_type(m, &DrgnType_type) ||
 	    add_type(m, &Thread_type) ||
 	    add_type(m, &ThreadIterator_type) ||
+	    add_type(m, &TypeIterator_type) ||
 	    add_type(m, &TypeEnumerator_type) ||
 	    add_type(m, &TypeMember_type) ||
+	    PyType_Ready(&TypeMemberSequence_type) ||
 	    add_type(m, &TypeParameter_type) ||
+	    PyType_Ready(&TypeParameterSequence_type) ||
 	    add_type(m, &TypeTemplateParameter_type))
 		goto err;
 
@@ -304,6 +408,18 @@ DRGNPY_PUBLIC PyMODINIT_FUNC PyInit__drgn(void)
 		goto err;
 	}
 
+	PyObject *with_libzstd;
+#ifdef WITH_LIBZSTD
+	with_libzstd = Py_True;
+#else
+	with_libzstd = Py_False;
+#endif
+	Py_INCREF(with_libzstd);
+	if (PyModule_AddObject(m, "_with_libzstd", with_libzstd)) {
+		Py_DECREF(with_libzstd);
+		goto err;
+	}
+
 	return m;
 
 err:
@@ -8,6 +8,7 @@
 #include "../error.h"
 #include "../object.h"
 #include "../serialize.h"
+#include "../string_builder.h"
 #include "../type.h"
 #include "../util.h"
 
@@ -499,11 +500,145 @@ err:
 	return NULL;
 }
 
+/*
+ * Scripts walking large data structures create and destroy huge numbers of
+ * short-lived objects, so keep some freed objects around to reuse instead of
+ * going through the allocator every time. This is protected by the GIL.
+ */
+#define DRGNOBJECT_FREE_LIST_SIZE 256
+static DrgnObject *DrgnObject_free_list[DRGNOBJECT_FREE_LIST_SIZE];
+static size_t DrgnObject_num_free;
+
+DrgnObject *DrgnObject_alloc(Program *prog)
+{
+	DrgnObject *ret;
+
+	if (DrgnObject_num_free > 0) {
+		ret = DrgnObject_free_list[--DrgnObject_num_free];
+		PyObject_Init((PyObject *)ret, &DrgnObject_type);
+	} else {
+		ret = (DrgnObject *)DrgnObject_type.tp_alloc(&DrgnObject_type,
+							     0);
+		if (!ret)
+			return NULL;
+	}
+	drgn_object_init(&ret->obj, &prog->prog);
+	ret->snapshot = NULL;
+	Py_INCREF(prog);
+	return ret;
+}
+
 static void DrgnObject_dealloc(DrgnObject *self)
 {
+	Py_XDECREF(self->snapshot);
 	Py_DECREF(DrgnObject_prog(self));
 	drgn_object_deinit(&self->obj);
-	Py_TYPE(self)->tp_free((PyObject *)self);
+	if (DrgnObject_num_free < DRGNOBJECT_FREE_LIST_SIZE)
+		DrgnObject_free_list[DrgnObject_num_free++] = self;
+	else
+		Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+/*
+ * Read the snapshot of an object returned by Object.snapshot_() if it hasn't
+ * been read yet.
+ */
+static int DrgnObject_read_snapshot(DrgnObject *self)
+{
+	struct drgn_error *err;
+
+	if (self->snapshot != Py_None)
+		return 0;
+	DrgnObject *snapshot = DrgnObject_alloc(DrgnObject_prog(self));
+	if (!snapshot)
+		return -1;
+	Py_BEGIN_ALLOW_THREADS
+	err = drgn_object_read(&snapshot->obj, &self->obj);
+	Py_END_ALLOW_THREADS
+	if (err) {
+		Py_DECREF(snapshot);
+		set_drgn_error(err);
+		return -1;
+	}
+	Py_DECREF(self->snapshot);
+	self->snapshot = (PyObject *)snapshot;
+	self->snapshot_address = self->obj.address;
+	return 0;
+}
+
+/*
+ * Make a member, element, or other part of an object share the object's
+ * snapshot if it is entirely within the snapshot.
+ */
+int DrgnObject_inherit_snapshot(DrgnObject *res, DrgnObject *self)
+{
+	if (!self->snapshot || res->obj.kind != DRGN_OBJECT_REFERENCE)
+		return 0;
+	if (DrgnObject_read_snapshot(self))
+		return -1;
+	const struct drgn_object *snapshot =
+		&((DrgnObject *)self->snapshot)->obj;
+	uint64_t offset = res->obj.address - self->snapshot_address;
+	if (res->obj.address < self->snapshot_address ||
+	    offset > drgn_object_size(snapshot) ||
+	    res->obj.bit_offset + res->obj.bit_size >
+	    (drgn_object_size(snapshot) - offset) * 8)
+		return 0;
+	res->snapshot = self->snapshot;
+	Py_INCREF(res->snapshot);
+	res->snapshot_address = self->snapshot_address;
+	return 0;
+}
+
+/*
+ * Get the object to read a value from: the part of the snapshot corresponding
+ * to the object, which is set in tmp, if the object has a snapshot, or the
+ * object itself otherwise. Returns NULL with an exception set on error.
+ */
+static struct drgn_object *DrgnObject_value_source(DrgnObject *self,
+						   struct drgn_object *tmp)
+{
+	struct drgn_error *err;
+
+	if (!self->snapshot)
+		return &self->obj;
+	if (DrgnObject_read_snapshot(self))
+		return NULL;
+	const struct drgn_object *snapshot =
+		&((DrgnObject *)self->snapshot)->obj;
+	err = drgn_object_slice(tmp, snapshot,
+				drgn_object_qualified_type(&self->obj),
+				(self->obj.address - self->snapshot_address) * 8
+				+ self->obj.bit_offset,
+				self->obj.is_bit_field ? self->obj.bit_size : 0);
+	if (err) {
+		set_drgn_error(err);
+		return NULL;
+	}
+	return tmp;
+}
+
+/* Read the value of a scalar object, using its snapshot if it has one. */
+static int DrgnObject_read_scalar(DrgnObject *self, union drgn_value *ret)
+{
+	struct drgn_error *err;
+	struct drgn_object tmp;
+	drgn_object_init(&tmp, drgn_object_program(&self->obj));
+	struct drgn_object *obj = DrgnObject_value_source(self, &tmp);
+	if (!obj) {
+		drgn_object_deinit(&tmp);
+		return -1;
+	}
+	const union drgn_value *value;
+	err = drgn_object_read_value(obj, ret, &value);
+	if (!err && value != ret)
+		*ret = *value;
+	drgn_object_deinit(&tmp);
+	if (err) {
+		set_drgn_error(err);
+		return -1;
+	}
+	return 0;
 }
 
 static PyObject *DrgnObject_value_impl(struct drgn_object *obj);
@@ -686,7 +821,15 @@ static PyObject *DrgnObject_value_impl(struct drgn_object *obj)
 
 static PyObject *DrgnObject_value(DrgnObject *self)
 {
-	return DrgnObject_value_impl(&self->obj);
+	if (!self->snapshot)
+		return DrgnObject_value_impl(&self->obj);
+
+	struct drgn_object tmp;
+	drgn_object_init(&tmp, drgn_object_program(&self->obj));
+	struct drgn_object *obj = DrgnObject_value_source(self, &tmp);
+	PyObject *ret = obj ? DrgnObject_value_impl(obj) : NULL;
+	drgn_object_deinit(&tmp);
+	return ret;
 }
 
 static PyObject *DrgnObject_string(DrgnObject *self)
@@ -735,7 +878,17 @@ static DrgnObject *DrgnObject_read(DrgnObject *self)
 		if (!res)
 			return NULL;
 
+		if (self->snapshot) {
+			if (!DrgnObject_value_source(self, &res->obj)) {
+				Py_DECREF(res);
+				return NULL;
+			}
+			return res;
+		}
+
+		Py_BEGIN_ALLOW_THREADS
 		err = drgn_object_read(&res->obj, &self->obj);
+		Py_END_ALLOW_THREADS
 		if (err) {
 			Py_DECREF(res);
 			return set_drgn_error(err);
@@ -746,6 +899,29 @@ static DrgnObject *DrgnObject_read(DrgnObject *self)
 	)
 }
 
+static DrgnObject *DrgnObject_snapshot(DrgnObject *self)
+{
+	struct drgn_error *err;
+
+	if (self->obj.kind != DRGN_OBJECT_REFERENCE ||
+	    self->obj.encoding != DRGN_OBJECT_ENCODING_BUFFER) {
+		Py_INCREF(self);
+		return self;
+	}
+
+	DrgnObject *res = DrgnObject_alloc(DrgnObject_prog(self));
+	if (!res)
+		return NULL;
+	err = drgn_object_copy(&res->obj, &self->obj);
+	if (err) {
+		Py_DECREF(res);
+		return set_drgn_error(err);
+	}
+	Py_INCREF(Py_None);
+	res->snapshot = Py_None;
+	return res;
+}
+
 static PyObject *DrgnObject_to_bytes(DrgnObject *self)
 {
 	struct drgn_error *err;
@@ -761,6 +937,40 @@ static PyObject *DrgnObject_to_bytes(DrgnObject *self)
 	return buf;
 }
 
+static PyObject *DrgnObject_to_bytes_view(DrgnObject *self)
+{
+	struct drgn_object *obj = &self->obj;
+	uint64_t size = drgn_object_size(obj);
+	if (drgn_object_encoding_is_complete(obj->encoding) && size > 0 &&
+	    size <= PY_SSIZE_T_MAX) {
+		/* Objects are immutable, so their buffers can be shared. */
+		if (obj->kind == DRGN_OBJECT_VALUE &&
+		    obj->encoding == DRGN_OBJECT_ENCODING_BUFFER) {
+			return borrowed_memoryview((PyObject *)self,
+						   drgn_object_buffer(obj),
+						   size);
+		}
+		if (obj->kind == DRGN_OBJECT_REFERENCE &&
+		    obj->bit_offset == 0) {
+			Program *prog = DrgnObject_prog(self);
+			const void *p =
+				drgn_program_borrow_memory(&prog->prog,
+							   obj->address, size,
+							   false);
+			if (p) {
+				return borrowed_memoryview((PyObject *)prog, p,
+							   size);
+			}
+		}
+	}
+	PyObject *buf = DrgnObject_to_bytes(self);
+	if (!buf)
+		return NULL;
+	PyObject *view = PyMemoryView_FromObject(buf);
+	Py_DECREF(buf);
+	return view;
+}
+
 static DrgnObject *DrgnObject_from_bytes(PyTypeObject *type, PyObject *args,
 					 PyObject *kwds)
 {
@@ -930,6 +1140,14 @@ static int format_object_flag_converter(PyObject *o, void *p)
 	return 1;
 }
 
+static struct drgn_error *format_object_append(const char *str, size_t len,
+					       void *arg)
+{
+	if (!string_builder_appendn(arg, str, len))
+		return &drgn_enomem;
+	return NULL;
+}
+
 static PyObject *DrgnObject_format(DrgnObject *self, PyObject *args,
 				   PyObject *kwds)
 {
@@ -953,29 +1171,39 @@ static PyObject *DrgnObject_format(DrgnObject *self, PyObject *args,
 		FLAGS
 #undef X
 		"columns",
+		"max_elements",
+		"max_size",
 		NULL,
 	};
 	struct drgn_error *err;
 	PyObject *columns_obj = Py_None;
+	struct index_arg max_elements = { .allow_none = true, .is_none = true };
+	struct index_arg max_size = { .allow_none = true, .is_none = true };
 	size_t columns = SIZE_MAX;
 	enum drgn_format_object_flags flags = DRGN_FORMAT_OBJECT_PRETTY;
 #define X(name, value)	\
 	struct format_object_flag_arg name##_arg = { &flags, value };
 	FLAGS
 #undef X
-	char *str;
+	struct string_builder sb = {};
 	PyObject *ret;
 
 	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|$"
 #define X(name, value) "O&"
 					 FLAGS
 #undef X
-					 "O:format_", keywords,
+					 "OO&O&:format_", keywords,
 #define X(name, value) format_object_flag_converter, &name##_arg,
 					 FLAGS
 #undef X
-					 &columns_obj))
+					 &columns_obj, index_converter,
+					 &max_elements, index_converter,
+					 &max_size))
+		return NULL;
+	if (!max_size.is_none && max_size.uvalue > SIZE_MAX) {
+		PyErr_SetString(PyExc_OverflowError, "max_size is too large");
 		return NULL;
+	}
 
 	if (columns_obj != Py_None) {
 		columns_obj = PyNumber_Index(columns_obj);
@@ -987,12 +1215,18 @@ static PyObject *DrgnObject_format(DrgnObject *self, PyObject *args,
 			return NULL;
 	}
 
-	err = drgn_format_object(&self->obj, columns, flags, &str);
-	if (err)
+	err = drgn_format_object_stream(&self->obj, columns, flags,
+					max_elements.is_none ?
+					0 : max_elements.uvalue,
+					max_size.is_none ? 0 : max_size.uvalue,
+					format_object_append, &sb);
+	if (err) {
+		free(sb.str);
 		return set_drgn_error(err);
+	}
 
-	ret = PyUnicode_FromString(str);
-	free(str);
+	ret = PyUnicode_FromStringAndSize(sb.str, sb.len);
+	free(sb.str);
 	return ret;
 
 #undef FLAGS
@@ -1140,7 +1374,15 @@ static int DrgnObject_bool(DrgnObject *self)
 	struct drgn_error *err;
 	bool ret;
 
-	err = drgn_object_bool(&self->obj, &ret);
+	struct drgn_object tmp;
+	drgn_object_init(&tmp, drgn_object_program(&self->obj));
+	struct drgn_object *obj = DrgnObject_value_source(self, &tmp);
+	if (!obj) {
+		drgn_object_deinit(&tmp);
+		return -1;
+	}
+	err = drgn_object_bool(obj, &ret);
+	drgn_object_deinit(&tmp);
 	if (err) {
 		set_drgn_error(err);
 		return -1;
@@ -1150,9 +1392,7 @@ static int DrgnObject_bool(DrgnObject *self)
 
 static PyObject *DrgnObject_int(DrgnObject *self)
 {
-	struct drgn_error *err;
-	union drgn_value value_mem;
-	const union drgn_value *value;
+	union drgn_value value;
 	PyObject *ret;
 
 	if (!drgn_type_is_scalar(self->obj.type)) {
@@ -1160,32 +1400,28 @@ static PyObject *DrgnObject_int(DrgnObject *self)
 					   drgn_object_qualified_type(&self->obj));
 	}
 
-	err = drgn_object_read_value(&self->obj, &value_mem, &value);
-	if (err)
-		return set_drgn_error(err);
+	if (DrgnObject_read_scalar(self, &value))
+		return NULL;
 
 	switch (self->obj.encoding) {
 	case DRGN_OBJECT_ENCODING_SIGNED:
-		ret = PyLong_FromLongLong(value->svalue);
+		ret = PyLong_FromLongLong(value.svalue);
 		break;
 	case DRGN_OBJECT_ENCODING_UNSIGNED:
-		ret = PyLong_FromUnsignedLongLong(value->uvalue);
+		ret = PyLong_FromUnsignedLongLong(value.uvalue);
 		break;
 	case DRGN_OBJECT_ENCODING_FLOAT:
-		ret = PyLong_FromDouble(value->fvalue);
+		ret = PyLong_FromDouble(value.fvalue);
 		break;
 	default:
 		UNREACHABLE();
 	}
-	drgn_object_deinit_value(&self->obj, value);
 	return ret;
 }
 
 static PyObject *DrgnObject_float(DrgnObject *self)
 {
-	struct drgn_error *err;
-	union drgn_value value_mem;
-	const union drgn_value *value;
+	union drgn_value value;
 	PyObject *ret;
 
 	if (!drgn_type_is_arithmetic(self->obj.type)) {
@@ -1193,33 +1429,29 @@ static PyObject *DrgnObject_float(DrgnObject *self)
 					   drgn_object_qualified_type(&self->obj));
 	}
 
-	err = drgn_object_read_value(&self->obj, &value_mem, &value);
-	if (err)
-		return set_drgn_error(err);
+	if (DrgnObject_read_scalar(self, &value))
+		return NULL;
 
 	switch (self->obj.encoding) {
 	case DRGN_OBJECT_ENCODING_SIGNED:
-		ret = PyFloat_FromDouble(value->svalue);
+		ret = PyFloat_FromDouble(value.svalue);
 		break;
 	case DRGN_OBJECT_ENCODING_UNSIGNED:
-		ret = PyFloat_FromDouble(value->uvalue);
+		ret = PyFloat_FromDouble(value.uvalue);
 		break;
 	case DRGN_OBJECT_ENCODING_FLOAT:
-		ret = PyFloat_FromDouble(value->fvalue);
+		ret = PyFloat_FromDouble(value.fvalue);
 		break;
 	default:
 		UNREACHABLE();
 	}
-	drgn_object_deinit_value(&self->obj, value);
 	return ret;
 }
 
 static PyObject *DrgnObject_index(DrgnObject *self)
 {
-	struct drgn_error *err;
 	struct drgn_type *underlying_type;
-	union drgn_value value_mem;
-	const union drgn_value *value;
+	union drgn_value value;
 	PyObject *ret;
 
 	underlying_type = drgn_underlying_type(self->obj.type);
@@ -1229,21 +1461,19 @@ static PyObject *DrgnObject_index(DrgnObject *self)
 					   drgn_object_qualified_type(&self->obj));
 	}
 
-	err = drgn_object_read_value(&self->obj, &value_mem, &value);
-	if (err)
-		return set_drgn_error(err);
+	if (DrgnObject_read_scalar(self, &value))
+		return NULL;
 
 	switch (self->obj.encoding) {
 	case DRGN_OBJECT_ENCODING_SIGNED:
-		ret = PyLong_FromLongLong(value->svalue);
+		ret = PyLong_FromLongLong(value.svalue);
 		break;
 	case DRGN_OBJECT_ENCODING_UNSIGNED:
-		ret = PyLong_FromUnsignedLongLong(value->uvalue);
+		ret = PyLong_FromUnsignedLongLong(value.uvalue);
 		break;
 	default:
 		UNREACHABLE();
 	}
-	drgn_object_deinit_value(&self->obj, value);
 	return ret;
 }
 
@@ -1312,9 +1542,7 @@ static PyObject *DrgnObject_round(DrgnObject *self, PyObject *args,
 #define DrgnObject_round_method(func)					\
 static PyObject *DrgnObject_##func(DrgnObject *self)			\
 {									\
-	struct drgn_error *err;						\
-	union drgn_value value_mem;					\
-	const union drgn_value *value;					\
+	union drgn_value value;						\
 	PyObject *ret;							\
 									\
 	if (!drgn_type_is_arithmetic(self->obj.type)) {			\
@@ -1322,24 +1550,22 @@ static PyObject *DrgnObject_##func(DrgnObject *self)			\
 					   drgn_object_qualified_type(&self->obj));\
 	}								\
 									\
-	err = drgn_object_read_value(&self->obj, &value_mem, &value);	\
-	if (err)							\
-		return set_drgn_error(err);				\
+	if (DrgnObject_read_scalar(self, &value))			\
+		return NULL;						\
 									\
 	switch (self->obj.encoding) {					\
 	case DRGN_OBJECT_ENCODING_SIGNED:				\
-		ret = PyLong_FromLongLong(value->svalue);		\
+		ret = PyLong_FromLongLong(value.svalue);		\
 		break;							\
 	case DRGN_OBJECT_ENCODING_UNSIGNED:				\
-		ret = PyLong_FromUnsignedLongLong(value->uvalue);	\
+		ret = PyLong_FromUnsignedLongLong(value.uvalue);	\
 		break;							\
 	case DRGN_OBJECT_ENCODING_FLOAT:				\
-		ret = PyLong_FromDouble(func(value->fvalue));		\
+		ret = PyLong_FromDouble(func(value.fvalue));		\
 		break;							\
 	default:							\
 		UNREACHABLE();						\
 	}								\
-	drgn_object_deinit_value(&self->obj, value);			\
 	return ret;							\
 }
 DrgnObject_round_method(trunc)
@@ -1405,6 +1631,10 @@ static DrgnObject *DrgnObject_member(DrgnObject *self, PyObject *args,
 		Py_DECREF(res);
 		return set_drgn_error(err);
 	}
+	if (DrgnObject_inherit_snapshot(res, self)) {
+		Py_DECREF(res);
+		return NULL;
+	}
 	return res;
 }
 
@@ -1474,6 +1704,8 @@ static PyObject *DrgnObject_getattro(DrgnObject *self, PyObject *attr_name)
 		} else {
 			set_drgn_error(err);
 		}
+	} else if (DrgnObject_inherit_snapshot(res, self)) {
+		Py_CLEAR(res);
 	}
 out:
 #if !GETATTR_SUPPRESS
@@ -1520,6 +1752,10 @@ static DrgnObject *DrgnObject_subscript_impl(DrgnObject *self,
 		Py_DECREF(res);
 		return set_drgn_error(err);
 	}
+	if (DrgnObject_inherit_snapshot(res, self)) {
+		Py_DECREF(res);
+		return NULL;
+	}
 	return res;
 }
 
@@ -1646,8 +1882,12 @@ static PyMethodDef DrgnObject_methods[] = {
 	 drgn_Object_address_of__DOC},
 	{"read_", (PyCFunction)DrgnObject_read, METH_NOARGS,
 	 drgn_Object_read__DOC},
+	{"snapshot_", (PyCFunction)DrgnObject_snapshot, METH_NOARGS,
+	 drgn_Object_snapshot__DOC},
 	{"to_bytes_", (PyCFunction)DrgnObject_to_bytes, METH_NOARGS,
 	 drgn_Object_to_bytes__DOC},
+	{"to_bytes_view_", (PyCFunction)DrgnObject_to_bytes_view, METH_NOARGS,
+	 drgn_Object_to_bytes_view__DOC},
 	{"from_bytes_", (PyCFunction)DrgnObject_from_bytes,
 	 METH_CLASS | METH_VARARGS | METH_KEYWORDS,
 	 drgn_Object_from_bytes__DOC},
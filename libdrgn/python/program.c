@@ -1,8 +1,13 @@
 // Copyright (c) Meta Platforms, Inc. and affiliates.
 // SPDX-License-Identifier: GPL-3.0-or-later
 
+#include <errno.h>
+#include <time.h>
+
 #include "drgnpy.h"
+#include "../array.h"
 #include "../hash_table.h"
+#include "../object.h"
 #include "../program.h"
 #include "../vector.h"
 #include "../util.h"
@@ -62,6 +67,25 @@ int Program_type_arg(Program *prog, PyObject *type_obj, bool can_be_none,
 	return 0;
 }
 
+/*
+ * Operations that are called with the GIL released may need to call back into
+ * Python with the GIL held, so the GIL must be released while waiting for
+ * another thread.
+ */
+static void *drgnpy_begin_blocking(struct drgn_program *prog, void *arg)
+{
+	if (!PyGILState_Check())
+		return NULL;
+	return PyEval_SaveThread();
+}
+
+static void drgnpy_end_blocking(struct drgn_program *prog, void *arg,
+				void *state)
+{
+	if (state)
+		PyEval_RestoreThread(state);
+}
+
 static Program *Program_new(PyTypeObject *subtype, PyObject *args,
 			    PyObject *kwds)
 {
@@ -94,12 +118,15 @@ static Program *Program_new(PyTypeObject *subtype, PyObject *args,
 	prog->cache = cache;
 	pyobjectp_set_init(&prog->objects);
 	drgn_program_init(&prog->prog, platform);
+	drgn_program_set_blocking_callback(&prog->prog, drgnpy_begin_blocking,
+					   drgnpy_end_blocking, NULL);
 	return prog;
 }
 
 static void Program_dealloc(Program *self)
 {
 	drgn_program_deinit(&self->prog);
+	drgn_memory_trace_destroy(self->memory_trace);
 	for (struct pyobjectp_set_iterator it =
 	     pyobjectp_set_first(&self->objects); it.entry;
 	     it = pyobjectp_set_next(it))
@@ -206,6 +233,105 @@ static PyObject *Program_add_memory_segment(Program *self, PyObject *args,
 	Py_RETURN_NONE;
 }
 
+static struct drgn_error *
+py_memory_read_blocks_fn(struct drgn_memory_block_range *ranges,
+			 size_t num_ranges, void *arg, bool physical)
+{
+	struct drgn_error *err;
+	PyGILState_STATE gstate;
+	PyObject *ranges_obj, *ret;
+
+	gstate = PyGILState_Ensure();
+	ranges_obj = PyList_New(num_ranges);
+	if (!ranges_obj) {
+		err = drgn_error_from_python();
+		goto out;
+	}
+	for (size_t i = 0; i < num_ranges; i++) {
+		PyObject *view = PyMemoryView_FromMemory(ranges[i].buf,
+							 ranges[i].count,
+							 PyBUF_WRITE);
+		if (!view) {
+			err = drgn_error_from_python();
+			goto out_ranges;
+		}
+		unsigned long long address = ranges[i].address;
+		unsigned long long offset = ranges[i].offset;
+		PyObject *item = Py_BuildValue("KKN", address, offset, view);
+		if (!item) {
+			err = drgn_error_from_python();
+			goto out_ranges;
+		}
+		PyList_SET_ITEM(ranges_obj, i, item);
+	}
+
+	ret = PyObject_CallFunction(arg, "OO", ranges_obj,
+				    physical ? Py_True : Py_False);
+	Py_XDECREF(ret);
+
+	/*
+	 * The buffers are only valid during the call, so release the views
+	 * even if the callback raised an exception, keeping the first error.
+	 */
+	PyObject *exc_type, *exc_value, *exc_traceback;
+	PyErr_Fetch(&exc_type, &exc_value, &exc_traceback);
+	for (size_t i = 0; i < num_ranges; i++) {
+		PyObject *item = PyList_GET_ITEM(ranges_obj, i);
+		PyObject *tmp = PyObject_CallMethod(PyTuple_GET_ITEM(item, 2),
+						    "release", NULL);
+		if (tmp)
+			Py_DECREF(tmp);
+		else if (exc_type)
+			PyErr_Clear();
+		else
+			PyErr_Fetch(&exc_type, &exc_value, &exc_traceback);
+	}
+	PyErr_Restore(exc_type, exc_value, exc_traceback);
+	err = PyErr_Occurred() ? drgn_error_from_python() : NULL;
+out_ranges:
+	Py_DECREF(ranges_obj);
+out:
+	PyGILState_Release(gstate);
+	return err;
+}
+
+static PyObject *Program_add_memory_block_segment(Program *self,
+						  PyObject *args,
+						  PyObject *kwds)
+{
+	static char *keywords[] = {
+		"address", "size", "read_fn", "physical", NULL,
+	};
+	struct drgn_error *err;
+	struct index_arg address = {};
+	struct index_arg size = {};
+	PyObject *read_fn;
+	int physical = 0;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds,
+					 "O&O&O|p:add_memory_block_segment",
+					 keywords, index_converter, &address,
+					 index_converter, &size, &read_fn,
+					 &physical))
+	    return NULL;
+
+	if (!PyCallable_Check(read_fn)) {
+		PyErr_SetString(PyExc_TypeError, "read_fn must be callable");
+		return NULL;
+	}
+
+	if (Program_hold_object(self, read_fn) == -1)
+		return NULL;
+	err = drgn_program_add_memory_block_segment(&self->prog,
+						    address.uvalue,
+						    size.uvalue,
+						    py_memory_read_blocks_fn,
+						    read_fn, physical);
+	if (err)
+		return set_drgn_error(err);
+	Py_RETURN_NONE;
+}
+
 static struct drgn_error *py_type_find_fn(enum drgn_type_kind kind,
 					  const char *name, size_t name_len,
 					  const char *filename, void *arg,
@@ -274,13 +400,14 @@ out_gstate:
 static PyObject *Program_add_type_finder(Program *self, PyObject *args,
 					 PyObject *kwds)
 {
-	static char *keywords[] = {"fn", NULL};
+	static char *keywords[] = {"fn", "cache", NULL};
 	struct drgn_error *err;
 	PyObject *fn, *arg;
+	int cache = 0;
 	int ret;
 
-	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O:add_type_finder",
-					 keywords, &fn))
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|$p:add_type_finder",
+					 keywords, &fn, &cache))
 	    return NULL;
 
 	if (!PyCallable_Check(fn)) {
@@ -296,7 +423,14 @@ static PyObject *Program_add_type_finder(Program *self, PyObject *args,
 	if (ret == -1)
 		return NULL;
 
-	err = drgn_program_add_type_finder(&self->prog, py_type_find_fn, arg);
+	if (cache) {
+		err = drgn_program_add_cached_type_finder(&self->prog,
+							  py_type_find_fn,
+							  arg);
+	} else {
+		err = drgn_program_add_type_finder(&self->prog,
+						   py_type_find_fn, arg);
+	}
 	if (err)
 		return set_drgn_error(err);
 	Py_RETURN_NONE;
@@ -357,13 +491,14 @@ out_gstate:
 static PyObject *Program_add_object_finder(Program *self, PyObject *args,
 					   PyObject *kwds)
 {
-	static char *keywords[] = {"fn", NULL};
+	static char *keywords[] = {"fn", "cache", NULL};
 	struct drgn_error *err;
 	PyObject *fn, *arg;
+	int cache = 0;
 	int ret;
 
-	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O:add_object_finder",
-					 keywords, &fn))
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|$p:add_object_finder",
+					 keywords, &fn, &cache))
 	    return NULL;
 
 	if (!PyCallable_Check(fn)) {
@@ -379,8 +514,14 @@ static PyObject *Program_add_object_finder(Program *self, PyObject *args,
 	if (ret == -1)
 		return NULL;
 
-	err = drgn_program_add_object_finder(&self->prog, py_object_find_fn,
-					     arg);
+	if (cache) {
+		err = drgn_program_add_cached_object_finder(&self->prog,
+							    py_object_find_fn,
+							    arg);
+	} else {
+		err = drgn_program_add_object_finder(&self->prog,
+						     py_object_find_fn, arg);
+	}
 	if (err)
 		return set_drgn_error(err);
 	Py_RETURN_NONE;
@@ -496,8 +637,10 @@ static PyObject *Program_load_debug_info(Program *self, PyObject *args,
 		for (size_t i = 0; i < path_args.size; i++)
 			paths[i] = path_args.data[i].path;
 	}
+	Py_BEGIN_ALLOW_THREADS
 	err = drgn_program_load_debug_info(&self->prog, paths, path_args.size,
 					   load_default, load_main);
+	Py_END_ALLOW_THREADS
 	free(paths);
 	if (err)
 		set_drgn_error(err);
@@ -515,46 +658,491 @@ static PyObject *Program_load_default_debug_info(Program *self)
 {
 	struct drgn_error *err;
 
+	Py_BEGIN_ALLOW_THREADS
 	err = drgn_program_load_debug_info(&self->prog, NULL, 0, true, true);
+	Py_END_ALLOW_THREADS
+	if (err)
+		return set_drgn_error(err);
+	Py_RETURN_NONE;
+}
+
+static PyObject *Program_unload_debug_info(Program *self, PyObject *args,
+					   PyObject *kwds)
+{
+	static char *keywords[] = {"name", NULL};
+	const char *name;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "s:unload_debug_info",
+					 keywords, &name))
+		return NULL;
+
+	struct drgn_error *err;
+	Py_BEGIN_ALLOW_THREADS
+	err = drgn_program_unload_debug_info(&self->prog, name);
+	Py_END_ALLOW_THREADS
 	if (err)
 		return set_drgn_error(err);
 	Py_RETURN_NONE;
 }
 
+static struct drgn_error *py_debug_file_fetch_fn(const void *build_id,
+						 size_t build_id_len,
+						 void *arg, char **path_ret)
+{
+	struct drgn_error *err;
+	PyGILState_STATE gstate;
+
+	gstate = PyGILState_Ensure();
+	PyObject *path_obj = PyObject_CallFunction(arg, "y#", build_id,
+						   (Py_ssize_t)build_id_len);
+	if (!path_obj) {
+		err = drgn_error_from_python();
+		goto out_gstate;
+	}
+	struct path_arg path = { .allow_none = true };
+	if (!path_converter(path_obj, &path)) {
+		err = drgn_error_from_python();
+		goto out_path_obj;
+	}
+	if (path.path) {
+		*path_ret = strdup(path.path);
+		err = *path_ret ? NULL : &drgn_enomem;
+	} else {
+		*path_ret = NULL;
+		err = NULL;
+	}
+	path_cleanup(&path);
+out_path_obj:
+	Py_DECREF(path_obj);
+out_gstate:
+	PyGILState_Release(gstate);
+	return err;
+}
+
+static PyObject *Program_set_debug_file_fetcher(Program *self, PyObject *args,
+						PyObject *kwds)
+{
+	static char *keywords[] = {"fn", NULL};
+	PyObject *fn;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds,
+					 "O:set_debug_file_fetcher", keywords,
+					 &fn))
+		return NULL;
+
+	if (fn == Py_None) {
+		drgn_program_set_debug_file_fetcher(&self->prog, NULL, NULL);
+		Py_RETURN_NONE;
+	}
+	if (!PyCallable_Check(fn)) {
+		PyErr_SetString(PyExc_TypeError, "fn must be callable or None");
+		return NULL;
+	}
+	if (Program_hold_object(self, fn) == -1)
+		return NULL;
+	drgn_program_set_debug_file_fetcher(&self->prog, py_debug_file_fetch_fn,
+					    fn);
+	Py_RETURN_NONE;
+}
+
+static PyObject *Program_read_impl(Program *self, uint64_t address,
+				   Py_ssize_t size, bool physical)
+{
+	struct drgn_error *err;
+	PyObject *buf;
+	bool clear;
+
+	if (size < 0) {
+		PyErr_SetString(PyExc_ValueError, "negative size");
+		return NULL;
+	}
+	buf = PyBytes_FromStringAndSize(NULL, size);
+	if (!buf)
+		return NULL;
+	clear = set_drgn_in_python();
+	Py_BEGIN_ALLOW_THREADS
+	err = drgn_program_read_memory(&self->prog, PyBytes_AS_STRING(buf),
+				       address, size, physical);
+	Py_END_ALLOW_THREADS
+	if (clear)
+		clear_drgn_in_python();
+	if (err) {
+		Py_DECREF(buf);
+		return set_drgn_error(err);
+	}
+	return buf;
+}
+
 static PyObject *Program_read(Program *self, PyObject *args, PyObject *kwds)
 {
 	static char *keywords[] = {"address", "size", "physical", NULL};
-	struct drgn_error *err;
 	struct index_arg address = {};
 	Py_ssize_t size;
 	int physical = 0;
-	PyObject *buf;
-	bool clear;
 
 	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&n|p:read", keywords,
 					 index_converter, &address, &size,
 					 &physical))
 	    return NULL;
 
+	return Program_read_impl(self, address.uvalue, size, physical);
+}
+
+static PyObject *Program_read_view(Program *self, PyObject *args,
+				   PyObject *kwds)
+{
+	static char *keywords[] = {"address", "size", "physical", NULL};
+	struct index_arg address = {};
+	Py_ssize_t size;
+	int physical = 0;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&n|p:read_view",
+					 keywords, index_converter, &address,
+					 &size, &physical))
+	    return NULL;
+
+	if (size > 0) {
+		const void *p = drgn_program_borrow_memory(&self->prog,
+							   address.uvalue,
+							   size, physical);
+		if (p)
+			return borrowed_memoryview((PyObject *)self, p, size);
+	}
+	PyObject *buf = Program_read_impl(self, address.uvalue, size,
+					  physical);
+	if (!buf)
+		return NULL;
+	PyObject *view = PyMemoryView_FromObject(buf);
+	Py_DECREF(buf);
+	return view;
+}
+
+static PyObject *Program_try_read(Program *self, PyObject *args,
+				  PyObject *kwds)
+{
+	static char *keywords[] = {"address", "size", "physical", NULL};
+	struct drgn_error *err;
+	struct index_arg address = {};
+	Py_ssize_t size;
+	int physical = 0;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&n|p:try_read", keywords,
+					 index_converter, &address, &size,
+					 &physical))
+	    return NULL;
+
 	if (size < 0) {
 		PyErr_SetString(PyExc_ValueError, "negative size");
 		return NULL;
 	}
-	buf = PyBytes_FromStringAndSize(NULL, size);
+	PyObject *buf = PyBytes_FromStringAndSize(NULL, size);
 	if (!buf)
 		return NULL;
-	clear = set_drgn_in_python();
-	err = drgn_program_read_memory(&self->prog, PyBytes_AS_STRING(buf),
-				       address.uvalue, size, physical);
+	bool faulted;
+	bool clear = set_drgn_in_python();
+	Py_BEGIN_ALLOW_THREADS
+	err = drgn_program_try_read_memory(&self->prog, PyBytes_AS_STRING(buf),
+					   address.uvalue, size, physical,
+					   &faulted);
+	Py_END_ALLOW_THREADS
 	if (clear)
 		clear_drgn_in_python();
 	if (err) {
 		Py_DECREF(buf);
 		return set_drgn_error(err);
 	}
+	if (faulted) {
+		Py_DECREF(buf);
+		Py_RETURN_NONE;
+	}
 	return buf;
 }
 
+static PyObject *Program_read_batch(Program *self, PyObject *args,
+				    PyObject *kwds)
+{
+	static char *keywords[] = {"requests", "physical", NULL};
+	struct drgn_error *err;
+	PyObject *requests_obj;
+	int physical = 0;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|p:read_batch",
+					 keywords, &requests_obj, &physical))
+		return NULL;
+
+	PyObject *seq = PySequence_Fast(requests_obj,
+					"requests must be iterable");
+	if (!seq)
+		return NULL;
+	Py_ssize_t num_requests = PySequence_Fast_GET_SIZE(seq);
+	struct drgn_memory_read_request *requests = NULL;
+	PyObject *ret = PyList_New(num_requests);
+	if (!ret)
+		goto err;
+	requests = malloc_array(num_requests, sizeof(*requests));
+	if (!requests && num_requests) {
+		PyErr_NoMemory();
+		goto err;
+	}
+	for (Py_ssize_t i = 0; i < num_requests; i++) {
+		PyObject *request = PySequence_Fast_GET_ITEM(seq, i);
+		if (!PyTuple_Check(request)) {
+			PyErr_Format(PyExc_TypeError,
+				     "expected (address, size) tuple, not %s",
+				     Py_TYPE(request)->tp_name);
+			goto err;
+		}
+		struct index_arg address = {};
+		Py_ssize_t size;
+		if (!PyArg_ParseTuple(request, "O&n:read_batch",
+				      index_converter, &address, &size))
+			goto err;
+		if (size < 0) {
+			PyErr_SetString(PyExc_ValueError, "negative size");
+			goto err;
+		}
+		PyObject *buf = PyBytes_FromStringAndSize(NULL, size);
+		if (!buf)
+			goto err;
+		PyList_SET_ITEM(ret, i, buf);
+		requests[i].address = address.uvalue;
+		requests[i].count = size;
+		requests[i].buf = PyBytes_AS_STRING(buf);
+	}
+
+	bool clear = set_drgn_in_python();
+	Py_BEGIN_ALLOW_THREADS
+	err = drgn_program_read_memory_batch(&self->prog, requests,
+					     num_requests, physical);
+	Py_END_ALLOW_THREADS
+	if (clear)
+		clear_drgn_in_python();
+	if (err) {
+		set_drgn_error(err);
+		goto err;
+	}
+
+	/*
+	 * Replace the result of each request that faulted with a FaultError.
+	 * Any other error is raised.
+	 */
+	bool failed = false;
+	for (Py_ssize_t i = 0; i < num_requests; i++) {
+		err = requests[i].err;
+		if (!err)
+			continue;
+		if (failed) {
+			drgn_error_destroy(err);
+		} else if (err->code == DRGN_ERROR_FAULT) {
+			PyObject *exc =
+				PyObject_CallFunction((PyObject *)&FaultError_type,
+						      "sK", err->message,
+						      err->address);
+			drgn_error_destroy(err);
+			if (exc)
+				PyList_SetItem(ret, i, exc);
+			else
+				failed = true;
+		} else {
+			set_drgn_error(err);
+			failed = true;
+		}
+	}
+	if (failed)
+		goto err;
+	free(requests);
+	Py_DECREF(seq);
+	return ret;
+
+err:
+	free(requests);
+	Py_XDECREF(ret);
+	Py_DECREF(seq);
+	return NULL;
+}
+
+static PyObject *Program_read_members(Program *self, PyObject *args,
+				      PyObject *kwds)
+{
+	static char *keywords[] = {"type", "members", "addresses", NULL};
+	struct drgn_error *err;
+	PyObject *type_obj, *members_obj, *addresses_obj;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "OOO:read_members",
+					 keywords, &type_obj, &members_obj,
+					 &addresses_obj))
+		return NULL;
+
+	struct drgn_qualified_type qualified_type;
+	if (Program_type_arg(self, type_obj, false, &qualified_type) == -1)
+		return NULL;
+
+	PyObject *members_seq = PySequence_Fast(members_obj,
+						"members must be iterable");
+	if (!members_seq)
+		return NULL;
+	Py_ssize_t num_paths = PySequence_Fast_GET_SIZE(members_seq);
+	struct drgn_member_path *paths = NULL;
+	void **arrays = NULL;
+	const char **formats = NULL;
+	uint64_t *addresses = NULL;
+	PyObject *ret = PyTuple_New(num_paths);
+	if (!ret)
+		goto err;
+	paths = malloc_array(num_paths, sizeof(*paths));
+	arrays = malloc_array(num_paths, sizeof(*arrays));
+	formats = malloc_array(num_paths, sizeof(*formats));
+	if ((!paths || !arrays || !formats) && num_paths) {
+		PyErr_NoMemory();
+		goto err;
+	}
+	for (Py_ssize_t i = 0; i < num_paths; i++) {
+		PyObject *item = PySequence_Fast_GET_ITEM(members_seq, i);
+		if (PyObject_TypeCheck(item, &MemberPath_type)) {
+			if (((MemberPath *)item)->prog != self) {
+				PyErr_SetString(PyExc_ValueError,
+						"member path is from different program");
+				goto err;
+			}
+			paths[i] = ((MemberPath *)item)->path;
+		} else if (PyUnicode_Check(item)) {
+			const char *member = PyUnicode_AsUTF8(item);
+			if (!member)
+				goto err;
+			err = drgn_member_path_init(&paths[i],
+						    qualified_type.type,
+						    member);
+			if (err) {
+				set_drgn_error(err);
+				goto err;
+			}
+		} else {
+			PyErr_SetString(PyExc_TypeError,
+					"member must be str or MemberPath");
+			goto err;
+		}
+
+		/*
+		 * Unsupported types are rejected by
+		 * drgn_program_read_members() before anything is read.
+		 */
+		struct drgn_object_type type;
+		err = drgn_object_type(paths[i].member_type,
+				       paths[i].bit_field_size, &type);
+		if (err) {
+			set_drgn_error(err);
+			goto err;
+		}
+		if (type.encoding == DRGN_OBJECT_ENCODING_SIGNED)
+			formats[i] = "q";
+		else if (type.encoding == DRGN_OBJECT_ENCODING_FLOAT)
+			formats[i] = "d";
+		else
+			formats[i] = "Q";
+	}
+
+	Py_ssize_t count;
+	uint64_t start = 0, stride = 0;
+	if (PyRange_Check(addresses_obj)) {
+		count = PyObject_Length(addresses_obj);
+		if (count < 0)
+			goto err;
+		PyObject *tmp = PyObject_GetAttrString(addresses_obj, "start");
+		if (!tmp)
+			goto err;
+		start = PyLong_AsUnsignedLongLongMask(tmp);
+		Py_DECREF(tmp);
+		tmp = PyObject_GetAttrString(addresses_obj, "step");
+		if (!tmp)
+			goto err;
+		stride = PyLong_AsUnsignedLongLongMask(tmp);
+		Py_DECREF(tmp);
+		if (PyErr_Occurred())
+			goto err;
+	} else {
+		PyObject *addresses_seq =
+			PySequence_Fast(addresses_obj,
+					"addresses must be iterable");
+		if (!addresses_seq)
+			goto err;
+		count = PySequence_Fast_GET_SIZE(addresses_seq);
+		addresses = malloc_array(count, sizeof(*addresses));
+		if (!addresses && count) {
+			Py_DECREF(addresses_seq);
+			PyErr_NoMemory();
+			goto err;
+		}
+		for (Py_ssize_t i = 0; i < count; i++) {
+			PyObject *item = PySequence_Fast_GET_ITEM(addresses_seq,
+								  i);
+			struct index_arg address = {};
+			if (!index_converter(item, &address)) {
+				Py_DECREF(addresses_seq);
+				goto err;
+			}
+			addresses[i] = address.uvalue;
+		}
+		Py_DECREF(addresses_seq);
+	}
+
+	if (count > PY_SSIZE_T_MAX / sizeof(uint64_t)) {
+		PyErr_NoMemory();
+		goto err;
+	}
+	Py_ssize_t size = count * sizeof(uint64_t);
+	for (Py_ssize_t i = 0; i < num_paths; i++) {
+		PyObject *buf = PyByteArray_FromStringAndSize(NULL, size);
+		if (!buf)
+			goto err;
+		PyTuple_SET_ITEM(ret, i, buf);
+		arrays[i] = PyByteArray_AS_STRING(buf);
+	}
+
+	bool clear = set_drgn_in_python();
+	Py_BEGIN_ALLOW_THREADS
+	if (addresses) {
+		err = drgn_program_read_members(&self->prog, paths, num_paths,
+						addresses, count, arrays);
+	} else {
+		err = drgn_program_read_members_strided(&self->prog, paths,
+							num_paths, start,
+							stride, count, arrays);
+	}
+	Py_END_ALLOW_THREADS
+	if (clear)
+		clear_drgn_in_python();
+	if (err) {
+		set_drgn_error(err);
+		goto err;
+	}
+
+	for (Py_ssize_t i = 0; i < num_paths; i++) {
+		PyObject *view =
+			PyMemoryView_FromObject(PyTuple_GET_ITEM(ret, i));
+		if (!view)
+			goto err;
+		PyObject *array = PyObject_CallMethod(view, "cast", "s",
+						      formats[i]);
+		Py_DECREF(view);
+		if (!array)
+			goto err;
+		PyTuple_SetItem(ret, i, array);
+	}
+	free(addresses);
+	free(formats);
+	free(arrays);
+	free(paths);
+	Py_DECREF(members_seq);
+	return ret;
+
+err:
+	free(addresses);
+	free(formats);
+	free(arrays);
+	free(paths);
+	Py_XDECREF(ret);
+	Py_DECREF(members_seq);
+	return NULL;
+}
+
 #define METHOD_READ(x, type)							\
 static PyObject *Program_read_##x(Program *self, PyObject *args,		\
 				  PyObject *kwds)				\
@@ -585,15 +1173,42 @@ METHOD_READ(u64, uint64_t)
 METHOD_READ(word, uint64_t)
 #undef METHOD_READ
 
-static PyObject *Program_find_type(Program *self, PyObject *args, PyObject *kwds)
+static PyObject *Program_read_word_or(Program *self, PyObject *args,
+				      PyObject *kwds)
 {
-	static char *keywords[] = {"name", "filename", NULL};
+	static char *keywords[] = {"address", "default", "physical", NULL};
 	struct drgn_error *err;
-	PyObject *name_or_type;
-	struct path_arg filename = {.allow_none = true};
-	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|O&:type", keywords,
-					 &name_or_type, path_converter,
-					 &filename))
+	struct index_arg address = {};
+	PyObject *default_obj;
+	int physical = 0;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O|p:read_word_or",
+					 keywords, index_converter, &address,
+					 &default_obj, &physical))
+	    return NULL;
+
+	uint64_t value;
+	bool faulted;
+	err = drgn_program_try_read_word(&self->prog, address.uvalue, physical,
+					 &value, &faulted);
+	if (err)
+		return set_drgn_error(err);
+	if (faulted) {
+		Py_INCREF(default_obj);
+		return default_obj;
+	}
+	return PyLong_FromUnsignedLongLong(value);
+}
+
+static PyObject *Program_find_type(Program *self, PyObject *args, PyObject *kwds)
+{
+	static char *keywords[] = {"name", "filename", NULL};
+	struct drgn_error *err;
+	PyObject *name_or_type;
+	struct path_arg filename = {.allow_none = true};
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|O&:type", keywords,
+					 &name_or_type, path_converter,
+					 &filename))
 		return NULL;
 
 	if (PyObject_TypeCheck(name_or_type, &DrgnType_type)) {
@@ -615,8 +1230,10 @@ static PyObject *Program_find_type(Program *self, PyObject *args, PyObject *kwds
 		return NULL;
 	bool clear = set_drgn_in_python();
 	struct drgn_qualified_type qualified_type;
+	Py_BEGIN_ALLOW_THREADS
 	err = drgn_program_find_type(&self->prog, name, filename.path,
 				     &qualified_type);
+	Py_END_ALLOW_THREADS
 	if (clear)
 		clear_drgn_in_python();
 	path_cleanup(&filename);
@@ -625,6 +1242,66 @@ static PyObject *Program_find_type(Program *self, PyObject *args, PyObject *kwds
 	return DrgnType_wrap(qualified_type);
 }
 
+static TypeIterator *Program_types(Program *self, PyObject *args,
+				   PyObject *kwds)
+{
+	static char *keywords[] = {"kinds", NULL};
+	struct drgn_error *err;
+	PyObject *kinds_obj = Py_None;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O:types", keywords,
+					 &kinds_obj))
+		return NULL;
+
+	enum drgn_type_kind *kinds = NULL;
+	size_t num_kinds = 0;
+	if (kinds_obj != Py_None) {
+		PyObject *kinds_seq = PySequence_Fast(kinds_obj,
+						      "kinds must be iterable");
+		if (!kinds_seq)
+			return NULL;
+		num_kinds = PySequence_Fast_GET_SIZE(kinds_seq);
+		/* An empty list still needs a non-NULL array. */
+		kinds = malloc_array(num_kinds ? num_kinds : 1,
+				     sizeof(kinds[0]));
+		if (!kinds) {
+			Py_DECREF(kinds_seq);
+			PyErr_NoMemory();
+			return NULL;
+		}
+		for (size_t i = 0; i < num_kinds; i++) {
+			struct enum_arg kind = { .type = TypeKind_class };
+			if (!enum_converter(PySequence_Fast_GET_ITEM(kinds_seq,
+								     i),
+					    &kind)) {
+				free(kinds);
+				Py_DECREF(kinds_seq);
+				return NULL;
+			}
+			kinds[i] = kind.value;
+		}
+		Py_DECREF(kinds_seq);
+	}
+
+	struct drgn_type_iterator *it;
+	Py_BEGIN_ALLOW_THREADS
+	err = drgn_type_iterator_create(&self->prog, kinds, num_kinds, &it);
+	Py_END_ALLOW_THREADS
+	free(kinds);
+	if (err)
+		return set_drgn_error(err);
+	TypeIterator *ret =
+		(TypeIterator *)TypeIterator_type.tp_alloc(&TypeIterator_type,
+							   0);
+	if (!ret) {
+		drgn_type_iterator_destroy(it);
+		return NULL;
+	}
+	ret->prog = self;
+	ret->iterator = it;
+	Py_INCREF(self);
+	return ret;
+}
+
 static DrgnObject *Program_find_object(Program *self, const char *name,
 				       struct path_arg *filename,
 				       enum drgn_find_object_flags flags)
@@ -638,8 +1315,10 @@ static DrgnObject *Program_find_object(Program *self, const char *name,
 		return NULL;
 
 	clear = set_drgn_in_python();
+	Py_BEGIN_ALLOW_THREADS
 	err = drgn_program_find_object(&self->prog, name, filename->path, flags,
 				       &ret->obj);
+	Py_END_ALLOW_THREADS
 	if (clear)
 		clear_drgn_in_python();
 	path_cleanup(filename);
@@ -727,14 +1406,18 @@ static PyObject *Program_stack_trace(Program *self, PyObject *args,
 		return NULL;
 
 	if (PyObject_TypeCheck(thread, &DrgnObject_type)) {
+		Py_BEGIN_ALLOW_THREADS
 		err = drgn_object_stack_trace(&((DrgnObject *)thread)->obj,
 					      &trace);
+		Py_END_ALLOW_THREADS
 	} else {
 		struct index_arg tid = {};
 
 		if (!index_converter(thread, &tid))
 			return NULL;
+		Py_BEGIN_ALLOW_THREADS
 		err = drgn_program_stack_trace(&self->prog, tid.uvalue, &trace);
+		Py_END_ALLOW_THREADS
 	}
 	if (err)
 		return set_drgn_error(err);
@@ -745,6 +1428,479 @@ static PyObject *Program_stack_trace(Program *self, PyObject *args,
 	return ret;
 }
 
+/*
+ * Unwind every thread in an iterable of Thread objects. On success, returns an
+ * array of the traces (which must be destroyed) and, if tids_ret is not NULL,
+ * an array of the thread IDs. Both arrays must be freed.
+ */
+/* Get the threads in a sequence returned by PySequence_Fast(). */
+static int Program_thread_array(Program *self, PyObject *seq,
+				struct drgn_thread **ret)
+{
+	for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(seq); i++) {
+		PyObject *item = PySequence_Fast_GET_ITEM(seq, i);
+		if (!PyObject_TypeCheck(item, &Thread_type)) {
+			PyErr_SetString(PyExc_TypeError,
+					"threads must be Thread objects");
+			return -1;
+		}
+		ret[i] = &((Thread *)item)->thread;
+		if (ret[i]->prog != &self->prog) {
+			PyErr_SetString(PyExc_ValueError,
+					"thread is from different program");
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int Program_unwind_threads(Program *self, PyObject *threads_obj,
+				  bool raw,
+				  struct drgn_stack_trace ***traces_ret,
+				  uint32_t **tids_ret, Py_ssize_t *count_ret)
+{
+	struct drgn_error *err;
+
+	PyObject *seq = PySequence_Fast(threads_obj, "threads must be iterable");
+	if (!seq)
+		return -1;
+	int ret = -1;
+	Py_ssize_t count = PySequence_Fast_GET_SIZE(seq);
+	struct drgn_thread **threads = malloc_array(count, sizeof(threads[0]));
+	struct drgn_stack_trace **traces =
+		malloc_array(count, sizeof(traces[0]));
+	uint32_t *tids = NULL;
+	if (tids_ret)
+		tids = malloc_array(count, sizeof(tids[0]));
+	if ((!threads || !traces || (tids_ret && !tids)) && count) {
+		PyErr_NoMemory();
+		goto out;
+	}
+	if (Program_thread_array(self, seq, threads))
+		goto out;
+	if (tids) {
+		for (Py_ssize_t i = 0; i < count; i++)
+			tids[i] = threads[i]->tid;
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	if (raw) {
+		err = drgn_program_raw_stack_traces(&self->prog, threads,
+						    count, traces);
+	} else {
+		err = drgn_program_stack_traces(&self->prog, threads, count,
+						traces);
+	}
+	Py_END_ALLOW_THREADS
+	if (err) {
+		set_drgn_error(err);
+		goto out;
+	}
+	*traces_ret = traces;
+	traces = NULL;
+	if (tids_ret) {
+		*tids_ret = tids;
+		tids = NULL;
+	}
+	*count_ret = count;
+	ret = 0;
+out:
+	free(tids);
+	free(traces);
+	free(threads);
+	Py_DECREF(seq);
+	return ret;
+}
+
+static PyObject *Program_stack_traces(Program *self, PyObject *args,
+				      PyObject *kwds)
+{
+	static char *keywords[] = {"threads", "raw", NULL};
+	PyObject *threads_obj;
+	int raw = 0;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|$p:stack_traces",
+					 keywords, &threads_obj, &raw))
+		return NULL;
+
+	struct drgn_stack_trace **traces;
+	Py_ssize_t count;
+	if (Program_unwind_threads(self, threads_obj, raw, &traces, NULL,
+				   &count))
+		return NULL;
+
+	PyObject *ret = PyList_New(count);
+	Py_ssize_t i = 0;
+	if (ret) {
+		for (; i < count; i++) {
+			PyObject *trace_obj = StackTrace_wrap(traces[i]);
+			if (!trace_obj) {
+				Py_CLEAR(ret);
+				break;
+			}
+			PyList_SET_ITEM(ret, i, trace_obj);
+		}
+	}
+	/* Free the traces that weren't wrapped. */
+	for (; i < count; i++)
+		drgn_stack_trace_destroy(traces[i]);
+	free(traces);
+	return ret;
+}
+
+static PyObject *Program_sample_stack_traces(Program *self, PyObject *args,
+					     PyObject *kwds)
+{
+	static char *keywords[] = {"threads", "samples", "interval", NULL};
+	struct drgn_error *err;
+	PyObject *threads_obj;
+	Py_ssize_t samples;
+	double interval = 0.01;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds,
+					 "On|d:sample_stack_traces", keywords,
+					 &threads_obj, &samples, &interval))
+		return NULL;
+	if (samples < 0) {
+		PyErr_SetString(PyExc_ValueError,
+				"samples must be non-negative");
+		return NULL;
+	}
+	if (!(interval >= 0.0 && interval < 1e9)) {
+		PyErr_SetString(PyExc_ValueError, "invalid interval");
+		return NULL;
+	}
+	uint64_t interval_ns = interval * 1e9;
+
+	PyObject *seq = PySequence_Fast(threads_obj, "threads must be iterable");
+	if (!seq)
+		return NULL;
+	PyObject *ret = NULL;
+	struct drgn_stack_sampler *sampler = NULL;
+	char *folded = NULL;
+	Py_ssize_t count = PySequence_Fast_GET_SIZE(seq);
+	struct drgn_thread **threads = malloc_array(count, sizeof(threads[0]));
+	if (!threads && count) {
+		PyErr_NoMemory();
+		goto out;
+	}
+	if (Program_thread_array(self, seq, threads))
+		goto out;
+
+	err = drgn_stack_sampler_create(&self->prog, threads, count, &sampler);
+	if (err) {
+		set_drgn_error(err);
+		goto out;
+	}
+
+	struct timespec deadline;
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	for (Py_ssize_t i = 0; i < samples; i++) {
+		if (i) {
+			/* Keep the interval between the start of snapshots. */
+			uint64_t nsec = deadline.tv_nsec + interval_ns;
+			deadline.tv_sec += nsec / 1000000000;
+			deadline.tv_nsec = nsec % 1000000000;
+			for (;;) {
+				int r;
+				Py_BEGIN_ALLOW_THREADS
+				r = clock_nanosleep(CLOCK_MONOTONIC,
+						    TIMER_ABSTIME, &deadline,
+						    NULL);
+				Py_END_ALLOW_THREADS
+				if (PyErr_CheckSignals())
+					goto out;
+				if (r != EINTR)
+					break;
+			}
+		}
+		Py_BEGIN_ALLOW_THREADS
+		err = drgn_stack_sampler_sample(sampler);
+		Py_END_ALLOW_THREADS
+		if (err) {
+			set_drgn_error(err);
+			goto out;
+		}
+		if (PyErr_CheckSignals())
+			goto out;
+	}
+
+	err = drgn_stack_sampler_format_folded(sampler, &folded);
+	if (err) {
+		set_drgn_error(err);
+		goto out;
+	}
+	ret = PyUnicode_FromString(folded);
+out:
+	free(folded);
+	drgn_stack_sampler_destroy(sampler);
+	free(threads);
+	Py_DECREF(seq);
+	return ret;
+}
+
+static PyObject *Program_stack_trace_groups(Program *self, PyObject *args,
+					    PyObject *kwds)
+{
+	static char *keywords[] = {"threads", "raw", NULL};
+	struct drgn_error *err;
+	PyObject *threads_obj;
+	int raw = 0;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|$p:stack_trace_groups",
+					 keywords, &threads_obj, &raw))
+		return NULL;
+
+	struct drgn_stack_trace **traces;
+	uint32_t *tids;
+	Py_ssize_t count;
+	if (Program_unwind_threads(self, threads_obj, raw, &traces, &tids,
+				   &count))
+		return NULL;
+
+	PyObject *ret = NULL;
+	size_t num_groups;
+	size_t *groups = malloc_array(count, sizeof(groups[0]));
+	if (!groups && count) {
+		PyErr_NoMemory();
+		goto out;
+	}
+	err = drgn_group_stack_traces(traces, count, groups, &num_groups);
+	if (err) {
+		set_drgn_error(err);
+		goto out;
+	}
+
+	ret = PyList_New(num_groups);
+	if (!ret)
+		goto out;
+	for (Py_ssize_t i = 0; i < count; i++) {
+		PyObject *tid_obj = PyLong_FromUnsignedLong(tids[i]);
+		if (!tid_obj)
+			goto err;
+		PyObject *group = PyList_GET_ITEM(ret, groups[i]);
+		if (group) {
+			/* Only the first trace in each group is kept. */
+			drgn_stack_trace_destroy(traces[i]);
+			traces[i] = NULL;
+			int r = PyList_Append(PyTuple_GET_ITEM(group, 1),
+					      tid_obj);
+			Py_DECREF(tid_obj);
+			if (r)
+				goto err;
+			continue;
+		}
+		PyObject *tids_obj = PyList_New(1);
+		if (!tids_obj) {
+			Py_DECREF(tid_obj);
+			goto err;
+		}
+		PyList_SET_ITEM(tids_obj, 0, tid_obj);
+		PyObject *trace_obj = StackTrace_wrap(traces[i]);
+		if (!trace_obj) {
+			Py_DECREF(tids_obj);
+			goto err;
+		}
+		traces[i] = NULL;
+		group = PyTuple_Pack(2, trace_obj, tids_obj);
+		Py_DECREF(trace_obj);
+		Py_DECREF(tids_obj);
+		if (!group)
+			goto err;
+		PyList_SET_ITEM(ret, groups[i], group);
+	}
+	goto out;
+
+err:
+	Py_CLEAR(ret);
+out:
+	for (Py_ssize_t i = 0; i < count; i++)
+		drgn_stack_trace_destroy(traces[i]);
+	free(groups);
+	free(tids);
+	free(traces);
+	return ret;
+}
+
+static PyObject *Program_find_frame_objects(Program *self, PyObject *args,
+					    PyObject *kwds)
+{
+	static char *keywords[] = {"traces", "function", "names", NULL};
+	struct drgn_error *err;
+	PyObject *traces_obj, *names_obj;
+	const char *function;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "OsO:find_frame_objects",
+					 keywords, &traces_obj, &function,
+					 &names_obj))
+		return NULL;
+
+	PyObject *traces_seq = PySequence_Fast(traces_obj,
+					       "traces must be iterable");
+	if (!traces_seq)
+		return NULL;
+	PyObject *names_seq = PySequence_Fast(names_obj,
+					      "names must be iterable");
+	if (!names_seq) {
+		Py_DECREF(traces_seq);
+		return NULL;
+	}
+	Py_ssize_t num_traces = PySequence_Fast_GET_SIZE(traces_seq);
+	Py_ssize_t num_names = PySequence_Fast_GET_SIZE(names_seq);
+	Py_ssize_t num_objs = 0;
+	PyObject *ret = NULL;
+	struct drgn_stack_trace **traces =
+		malloc_array(num_traces, sizeof(traces[0]));
+	const char **names = malloc_array(num_names, sizeof(names[0]));
+	size_t *frames = malloc_array(num_traces, sizeof(frames[0]));
+	struct drgn_object *objs = NULL;
+	if (!__builtin_mul_overflow(num_traces, num_names, &num_objs))
+		objs = malloc_array(num_objs, sizeof(objs[0]));
+	if (((!traces || !frames) && num_traces) || (!names && num_names) ||
+	    (!objs && num_objs)) {
+		num_objs = 0;
+		PyErr_NoMemory();
+		goto out;
+	}
+	for (Py_ssize_t i = 0; i < num_objs; i++)
+		drgn_object_init(&objs[i], &self->prog);
+
+	for (Py_ssize_t i = 0; i < num_traces; i++) {
+		PyObject *item = PySequence_Fast_GET_ITEM(traces_seq, i);
+		if (!PyObject_TypeCheck(item, &StackTrace_type)) {
+			PyErr_SetString(PyExc_TypeError,
+					"trace must be StackTrace");
+			goto out;
+		}
+		traces[i] = ((StackTrace *)item)->trace;
+		if (traces[i]->prog != &self->prog) {
+			PyErr_SetString(PyExc_ValueError,
+					"trace is from different program");
+			goto out;
+		}
+	}
+	for (Py_ssize_t i = 0; i < num_names; i++) {
+		PyObject *item = PySequence_Fast_GET_ITEM(names_seq, i);
+		if (!PyUnicode_Check(item)) {
+			PyErr_SetString(PyExc_TypeError, "name must be str");
+			goto out;
+		}
+		names[i] = PyUnicode_AsUTF8(item);
+		if (!names[i])
+			goto out;
+	}
+
+	bool clear = set_drgn_in_python();
+	err = drgn_stack_traces_find_objects(traces, num_traces, function,
+					     names, num_names, frames, objs);
+	if (clear)
+		clear_drgn_in_python();
+	if (err) {
+		set_drgn_error(err);
+		goto out;
+	}
+
+	ret = PyList_New(num_traces);
+	if (!ret)
+		goto out;
+	for (Py_ssize_t i = 0; i < num_traces; i++) {
+		if (frames[i] == SIZE_MAX) {
+			Py_INCREF(Py_None);
+			PyList_SET_ITEM(ret, i, Py_None);
+			continue;
+		}
+		PyObject *row = PyTuple_New(num_names);
+		if (!row)
+			goto err;
+		PyList_SET_ITEM(ret, i, row);
+		for (Py_ssize_t j = 0; j < num_names; j++) {
+			struct drgn_object *obj = &objs[i * num_names + j];
+			/* Objects that weren't found are still void. */
+			if (drgn_type_kind(obj->type) == DRGN_TYPE_VOID) {
+				Py_INCREF(Py_None);
+				PyTuple_SET_ITEM(row, j, Py_None);
+				continue;
+			}
+			DrgnObject *obj_obj = DrgnObject_alloc(self);
+			if (!obj_obj)
+				goto err;
+			PyTuple_SET_ITEM(row, j, (PyObject *)obj_obj);
+			err = drgn_object_copy(&obj_obj->obj, obj);
+			if (err) {
+				set_drgn_error(err);
+				goto err;
+			}
+		}
+	}
+	goto out;
+
+err:
+	Py_CLEAR(ret);
+out:
+	for (Py_ssize_t i = 0; i < num_objs; i++)
+		drgn_object_deinit(&objs[i]);
+	free(objs);
+	free(frames);
+	free(names);
+	free(traces);
+	Py_DECREF(names_seq);
+	Py_DECREF(traces_seq);
+	return ret;
+}
+
+static PyObject *Program_symbolize(Program *self, PyObject *arg)
+{
+	struct drgn_error *err;
+
+	PyObject *seq = PySequence_Fast(arg, "addresses must be iterable");
+	if (!seq)
+		return NULL;
+	Py_ssize_t count = PySequence_Fast_GET_SIZE(seq);
+	uint64_t *addresses = malloc_array(count, sizeof(addresses[0]));
+	struct drgn_symbolized_address *results =
+		malloc_array(count, sizeof(results[0]));
+	PyObject *ret = NULL;
+	if ((!addresses || !results) && count) {
+		PyErr_NoMemory();
+		goto out;
+	}
+	for (Py_ssize_t i = 0; i < count; i++) {
+		struct index_arg address = {};
+		if (!index_converter(PySequence_Fast_GET_ITEM(seq, i),
+				     &address))
+			goto out;
+		addresses[i] = address.uvalue;
+	}
+
+	err = drgn_program_symbolize(&self->prog, addresses, count, results);
+	if (err) {
+		set_drgn_error(err);
+		goto out;
+	}
+
+	ret = PyList_New(count);
+	if (!ret)
+		goto out;
+	for (Py_ssize_t i = 0; i < count; i++) {
+		PyObject *item = Py_BuildValue("zKzii", results[i].name,
+					       (unsigned long long)results[i].offset,
+					       results[i].filename,
+					       results[i].line,
+					       results[i].column);
+		if (!item) {
+			Py_CLEAR(ret);
+			goto out;
+		}
+		PyList_SET_ITEM(ret, i, item);
+	}
+
+out:
+	free(results);
+	free(addresses);
+	Py_DECREF(seq);
+	return ret;
+}
+
 static PyObject *Program_symbols(Program *self, PyObject *args)
 {
 	struct drgn_error *err;
@@ -911,8 +2067,10 @@ static DrgnObject *Program_subscript(Program *self, PyObject *key)
 		return NULL;
 
 	clear = set_drgn_in_python();
+	Py_BEGIN_ALLOW_THREADS
 	err = drgn_program_find_object(&self->prog, name, NULL,
 				       DRGN_FIND_OBJECT_ANY, &ret->obj);
+	Py_END_ALLOW_THREADS
 	if (clear)
 		clear_drgn_in_python();
 	if (err) {
@@ -946,8 +2104,10 @@ static int Program_contains(Program *self, PyObject *key)
 
 	drgn_object_init(&tmp, &self->prog);
 	clear = set_drgn_in_python();
+	Py_BEGIN_ALLOW_THREADS
 	err = drgn_program_find_object(&self->prog, name, NULL,
 				       DRGN_FIND_OBJECT_ANY, &tmp);
+	Py_END_ALLOW_THREADS
 	if (clear)
 		clear_drgn_in_python();
 	drgn_object_deinit(&tmp);
@@ -995,9 +2155,535 @@ static int Program_set_language(Program *self, PyObject *value, void *arg)
 	return 0;
 }
 
+static PyObject *Program_get_memory_cache_size(Program *self, void *arg)
+{
+	return PyLong_FromSize_t(drgn_program_memory_cache_size(&self->prog));
+}
+
+static int Program_set_memory_cache_size(Program *self, PyObject *value,
+					 void *arg)
+{
+	if (!value) {
+		PyErr_SetString(PyExc_AttributeError,
+				"can't delete memory_cache_size");
+		return -1;
+	}
+	struct index_arg size = {};
+	if (!index_converter(value, &size))
+		return -1;
+	if (size.uvalue > SIZE_MAX) {
+		PyErr_SetString(PyExc_OverflowError,
+				"memory_cache_size is too large");
+		return -1;
+	}
+	drgn_program_set_memory_cache_size(&self->prog, size.uvalue);
+	return 0;
+}
+
+static PyObject *Program_memory_cache_stats(Program *self)
+{
+	uint64_t hits, misses;
+	drgn_program_memory_cache_stats(&self->prog, &hits, &misses);
+	return Py_BuildValue("KK", (unsigned long long)hits,
+			     (unsigned long long)misses);
+}
+
+static PyObject *Program_prefetch(Program *self, PyObject *args,
+				  PyObject *kwds)
+{
+	static char *keywords[] = {"address", "size", "physical", NULL};
+	struct index_arg address = {};
+	struct index_arg size = {};
+	int physical = 0;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&|p:prefetch",
+					 keywords, index_converter, &address,
+					 index_converter, &size, &physical))
+		return NULL;
+	drgn_program_prefetch(&self->prog, address.uvalue, size.uvalue,
+			      physical);
+	Py_RETURN_NONE;
+}
+
+static PyObject *Program_invalidate_memory_cache(Program *self)
+{
+	drgn_program_invalidate_memory_cache(&self->prog);
+	Py_RETURN_NONE;
+}
+
+static PyObject *Program_get_translation_cache_enabled(Program *self,
+						      void *arg)
+{
+	Py_RETURN_BOOL(drgn_program_translation_cache_enabled(&self->prog));
+}
+
+static int Program_set_translation_cache_enabled(Program *self,
+						 PyObject *value, void *arg)
+{
+	if (!value) {
+		PyErr_SetString(PyExc_AttributeError,
+				"can't delete translation_cache_enabled");
+		return -1;
+	}
+	int enabled = PyObject_IsTrue(value);
+	if (enabled < 0)
+		return -1;
+	drgn_program_set_translation_cache_enabled(&self->prog, enabled);
+	return 0;
+}
+
+static PyObject *Program_invalidate_translation_cache(Program *self)
+{
+	drgn_program_invalidate_translation_cache(&self->prog);
+	Py_RETURN_NONE;
+}
+
+static PyObject *Program_translation_cache_stats(Program *self)
+{
+	uint64_t hits, misses;
+	drgn_program_translation_cache_stats(&self->prog, &hits, &misses);
+	return Py_BuildValue("KK", (unsigned long long)hits,
+			     (unsigned long long)misses);
+}
+
+static int add_stat(PyObject *dict, const char *name, uint64_t value)
+{
+	PyObject *value_obj = PyLong_FromUnsignedLongLong(value);
+	if (!value_obj)
+		return -1;
+	int ret = PyDict_SetItemString(dict, name, value_obj);
+	Py_DECREF(value_obj);
+	return ret;
+}
+
+static PyObject *Program_stats(Program *self)
+{
+	static const char * const segment_kind_names[] = {
+		[DRGN_MEMORY_SEGMENT_FILE] = "file",
+		[DRGN_MEMORY_SEGMENT_PAGE_TABLE] = "page_table",
+		[DRGN_MEMORY_SEGMENT_KDUMP] = "kdump",
+		[DRGN_MEMORY_SEGMENT_CUSTOM] = "custom",
+	};
+	static_assert(array_size(segment_kind_names) ==
+		      DRGN_NUM_MEMORY_SEGMENT_KINDS,
+		      "missing memory segment kind name");
+#define STAT(name) { #name, offsetof(struct drgn_program_stats, name) }
+	static const struct {
+		const char *name;
+		size_t offset;
+	} stats[] = {
+		STAT(memory_reads),
+		STAT(memory_read_bytes),
+		STAT(memory_cache_hits),
+		STAT(memory_cache_misses),
+		STAT(page_table_walks),
+		STAT(page_table_walk_ns),
+		STAT(linear_translations),
+		STAT(translation_cache_hits),
+		STAT(translation_cache_misses),
+		STAT(read_modules_ns),
+		STAT(dwarf_index_first_pass_ns),
+		STAT(dwarf_index_second_pass_ns),
+		STAT(dwarf_index_debug_names_ns),
+		STAT(dwarf_types),
+		STAT(dwarf_type_cache_hits),
+		STAT(dwarf_type_ns),
+		STAT(cfi_cache_hits),
+		STAT(dwarf_cfi_lookups),
+		STAT(orc_lookups),
+		STAT(cfi_lookup_ns),
+	};
+#undef STAT
+
+	struct drgn_program_stats values;
+	drgn_program_stats(&self->prog, &values);
+
+	PyObject *ret = PyDict_New();
+	if (!ret)
+		return NULL;
+	for (size_t i = 0; i < array_size(stats); i++) {
+		uint64_t value;
+		memcpy(&value, (char *)&values + stats[i].offset,
+		       sizeof(value));
+		if (add_stat(ret, stats[i].name, value))
+			goto err;
+	}
+	for (int i = 0; i < DRGN_NUM_MEMORY_SEGMENT_KINDS; i++) {
+		char name[64];
+		snprintf(name, sizeof(name), "%s_segment_reads",
+			 segment_kind_names[i]);
+		if (add_stat(ret, name, values.segment_reads[i]))
+			goto err;
+		snprintf(name, sizeof(name), "%s_segment_read_bytes",
+			 segment_kind_names[i]);
+		if (add_stat(ret, name, values.segment_read_bytes[i]))
+			goto err;
+	}
+	return ret;
+
+err:
+	Py_DECREF(ret);
+	return NULL;
+}
+
+static PyObject *Program_reset_stats(Program *self)
+{
+	drgn_program_reset_stats(&self->prog);
+	Py_RETURN_NONE;
+}
+
+static PyObject *Program_search_memory(Program *self, PyObject *args,
+				       PyObject *kwds)
+{
+	static char *keywords[] = {
+		"value", "min_address", "max_address", "max_value", "size",
+		"alignment", "physical", "page_flags_mask", "page_flags_value",
+		NULL
+	};
+	struct drgn_error *err;
+	PyObject *value_obj;
+	struct index_arg min_address = {};
+	struct index_arg max_address = {
+		.allow_none = true,
+		.is_none = true,
+		.uvalue = UINT64_MAX,
+	};
+	struct index_arg max_value = { .allow_none = true, .is_none = true };
+	struct index_arg size = { .allow_none = true, .is_none = true };
+	struct index_arg alignment = { .allow_none = true, .is_none = true };
+	int physical = 0;
+	struct index_arg page_flags_mask = {};
+	struct index_arg page_flags_value = {
+		.allow_none = true,
+		.is_none = true,
+	};
+	if (!PyArg_ParseTupleAndKeywords(args, kwds,
+					 "O|O&O&$O&O&O&pO&O&:search_memory",
+					 keywords, &value_obj,
+					 index_converter, &min_address,
+					 index_converter, &max_address,
+					 index_converter, &max_value,
+					 index_converter, &size,
+					 index_converter, &alignment,
+					 &physical,
+					 index_converter, &page_flags_mask,
+					 index_converter, &page_flags_value))
+		return NULL;
+
+	struct drgn_memory_search search = {
+		.min_address = min_address.uvalue,
+		.max_address = max_address.uvalue,
+		.physical = physical,
+		.alignment = alignment.is_none ? 0 : alignment.uvalue,
+		.page_flags_mask = page_flags_mask.uvalue,
+		.page_flags_value = (page_flags_value.is_none ?
+				     page_flags_mask.uvalue :
+				     page_flags_value.uvalue),
+	};
+	Py_buffer pattern = {};
+	if (PyObject_CheckBuffer(value_obj)) {
+		if (!max_value.is_none || !size.is_none) {
+			PyErr_SetString(PyExc_ValueError,
+					"max_value and size require int value");
+			return NULL;
+		}
+		if (PyObject_GetBuffer(value_obj, &pattern, PyBUF_SIMPLE) < 0)
+			return NULL;
+		search.pattern = pattern.buf;
+		search.pattern_size = pattern.len;
+	} else {
+		struct index_arg value = {};
+		if (!index_converter(value_obj, &value))
+			return NULL;
+		search.min_value = value.uvalue;
+		search.max_value = (max_value.is_none ?
+				    value.uvalue : max_value.uvalue);
+		if (size.is_none) {
+			bool is_64_bit;
+			err = drgn_program_is_64_bit(&self->prog, &is_64_bit);
+			if (err)
+				return set_drgn_error(err);
+			search.word_size = is_64_bit ? 8 : 4;
+		} else {
+			search.word_size = size.uvalue;
+		}
+	}
+
+	uint64_t *addresses;
+	size_t num_addresses;
+	Py_BEGIN_ALLOW_THREADS
+	err = drgn_program_search_memory(&self->prog, &search, &addresses,
+					 &num_addresses);
+	Py_END_ALLOW_THREADS
+	if (pattern.obj)
+		PyBuffer_Release(&pattern);
+	if (err)
+		return set_drgn_error(err);
+
+	PyObject *ret = PyList_New(num_addresses);
+	if (!ret)
+		goto out;
+	for (size_t i = 0; i < num_addresses; i++) {
+		PyObject *item = PyLong_FromUnsignedLongLong(addresses[i]);
+		if (!item) {
+			Py_CLEAR(ret);
+			goto out;
+		}
+		PyList_SET_ITEM(ret, i, item);
+	}
+out:
+	free(addresses);
+	return ret;
+}
+
+static PyObject *Program_start_memory_trace(Program *self)
+{
+	struct drgn_memory_trace *trace;
+	struct drgn_error *err = drgn_memory_trace_create(&trace);
+	if (err)
+		return set_drgn_error(err);
+	drgn_program_set_memory_read_trace(&self->prog,
+					   drgn_memory_trace_record, trace);
+	drgn_memory_trace_destroy(self->memory_trace);
+	self->memory_trace = trace;
+	Py_RETURN_NONE;
+}
+
+static PyObject *Program_stop_memory_trace(Program *self)
+{
+	drgn_program_set_memory_read_trace(&self->prog, NULL, NULL);
+	if (!self->memory_trace)
+		Py_RETURN_NONE;
+	size_t num_pages = drgn_memory_trace_num_pages(self->memory_trace);
+	return PyLong_FromSize_t(num_pages);
+}
+
+static PyObject *Program_add_memory_trace_objects(Program *self,
+						  PyObject *args,
+						  PyObject *kwds)
+{
+	static char *keywords[] = {"objs", "follow", "depth", NULL};
+	struct drgn_error *err;
+	PyObject *objs_obj, *follow_obj = Py_None;
+	unsigned long long depth = 0;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds,
+					 "O|OK:add_memory_trace_objects",
+					 keywords, &objs_obj, &follow_obj,
+					 &depth))
+		return NULL;
+
+	PyObject *ret = NULL;
+	PyObject *follow_seq = NULL;
+	const char **follow = NULL;
+	Py_ssize_t num_follow = 0;
+	PyObject *objs_seq = PySequence_Fast(objs_obj, "objs must be iterable");
+	if (!objs_seq)
+		return NULL;
+	if (follow_obj != Py_None) {
+		follow_seq = PySequence_Fast(follow_obj,
+					     "follow must be iterable or None");
+		if (!follow_seq)
+			goto out;
+		num_follow = PySequence_Fast_GET_SIZE(follow_seq);
+		follow = malloc_array(num_follow, sizeof(*follow));
+		if (!follow && num_follow) {
+			PyErr_NoMemory();
+			goto out;
+		}
+		for (Py_ssize_t i = 0; i < num_follow; i++) {
+			PyObject *item = PySequence_Fast_GET_ITEM(follow_seq, i);
+			if (!PyUnicode_Check(item)) {
+				PyErr_SetString(PyExc_TypeError,
+						"member name must be str");
+				goto out;
+			}
+			follow[i] = PyUnicode_AsUTF8(item);
+			if (!follow[i])
+				goto out;
+		}
+		/* An empty list follows nothing. */
+		if (num_follow == 0)
+			depth = 0;
+	}
+
+	Py_ssize_t num_objs = PySequence_Fast_GET_SIZE(objs_seq);
+	for (Py_ssize_t i = 0; i < num_objs; i++) {
+		PyObject *item = PySequence_Fast_GET_ITEM(objs_seq, i);
+		if (!PyObject_TypeCheck(item, &DrgnObject_type)) {
+			PyErr_SetString(PyExc_TypeError, "objs must be Objects");
+			goto out;
+		}
+		if (DrgnObject_prog((DrgnObject *)item) != self) {
+			PyErr_SetString(PyExc_ValueError,
+					"object is from different program");
+			goto out;
+		}
+	}
+
+	if (!self->memory_trace) {
+		err = drgn_memory_trace_create(&self->memory_trace);
+		if (err) {
+			set_drgn_error(err);
+			goto out;
+		}
+	}
+	for (Py_ssize_t i = 0; i < num_objs; i++) {
+		PyObject *item = PySequence_Fast_GET_ITEM(objs_seq, i);
+		err = drgn_memory_trace_add_object(self->memory_trace,
+						   &((DrgnObject *)item)->obj,
+						   follow, num_follow, depth);
+		if (err) {
+			set_drgn_error(err);
+			goto out;
+		}
+	}
+	Py_INCREF(Py_None);
+	ret = Py_None;
+out:
+	free(follow);
+	Py_XDECREF(follow_seq);
+	Py_DECREF(objs_seq);
+	return ret;
+}
+
+static PyObject *Program_write_memory_trace_core(Program *self,
+						 PyObject *args,
+						 PyObject *kwds)
+{
+	static char *keywords[] = {"path", NULL};
+	struct path_arg path = {};
+	if (!PyArg_ParseTupleAndKeywords(args, kwds,
+					 "O&:write_memory_trace_core", keywords,
+					 path_converter, &path))
+		return NULL;
+
+	if (!self->memory_trace) {
+		path_cleanup(&path);
+		PyErr_SetString(PyExc_ValueError, "no memory trace");
+		return NULL;
+	}
+	struct drgn_error *err =
+		drgn_memory_trace_write_core(self->memory_trace, &self->prog,
+					     path.path);
+	path_cleanup(&path);
+	if (err)
+		return set_drgn_error(err);
+	Py_RETURN_NONE;
+}
+
+static PyObject *Program_get_num_threads(Program *self, void *arg)
+{
+	return PyLong_FromLong(drgn_program_num_threads(&self->prog));
+}
+
+static int Program_set_num_threads(Program *self, PyObject *value, void *arg)
+{
+	if (!value) {
+		PyErr_SetString(PyExc_AttributeError,
+				"can't delete num_threads");
+		return -1;
+	}
+	struct index_arg num_threads = { .is_signed = true };
+	if (!index_converter(value, &num_threads))
+		return -1;
+	if (num_threads.svalue > INT_MAX) {
+		PyErr_SetString(PyExc_OverflowError,
+				"num_threads is too large");
+		return -1;
+	}
+	if (num_threads.svalue < 0) {
+		PyErr_SetString(PyExc_ValueError,
+				"num_threads must be non-negative");
+		return -1;
+	}
+	struct drgn_error *err =
+		drgn_program_set_num_threads(&self->prog, num_threads.svalue);
+	if (err) {
+		set_drgn_error(err);
+		return -1;
+	}
+	return 0;
+}
+
+static PyObject *Program_get_thread_cpus(Program *self, void *arg)
+{
+	const int *cpus;
+	size_t num_cpus;
+	drgn_program_thread_cpus(&self->prog, &cpus, &num_cpus);
+	if (!num_cpus)
+		Py_RETURN_NONE;
+	PyObject *ret = PyTuple_New(num_cpus);
+	if (!ret)
+		return NULL;
+	for (size_t i = 0; i < num_cpus; i++) {
+		PyObject *cpu = PyLong_FromLong(cpus[i]);
+		if (!cpu) {
+			Py_DECREF(ret);
+			return NULL;
+		}
+		PyTuple_SET_ITEM(ret, i, cpu);
+	}
+	return ret;
+}
+
+static int Program_set_thread_cpus(Program *self, PyObject *value, void *arg)
+{
+	if (!value) {
+		PyErr_SetString(PyExc_AttributeError,
+				"can't delete thread_cpus");
+		return -1;
+	}
+	if (value == Py_None) {
+		struct drgn_error *err =
+			drgn_program_set_thread_cpus(&self->prog, NULL, 0);
+		if (err) {
+			set_drgn_error(err);
+			return -1;
+		}
+		return 0;
+	}
+
+	PyObject *seq = PySequence_Fast(value,
+					"thread_cpus must be iterable or None");
+	if (!seq)
+		return -1;
+	int ret = -1;
+	Py_ssize_t num_cpus = PySequence_Fast_GET_SIZE(seq);
+	int *cpus = malloc_array(num_cpus, sizeof(cpus[0]));
+	if (!cpus && num_cpus) {
+		PyErr_NoMemory();
+		goto out;
+	}
+	for (Py_ssize_t i = 0; i < num_cpus; i++) {
+		struct index_arg cpu = { .is_signed = true };
+		if (!index_converter(PySequence_Fast_GET_ITEM(seq, i), &cpu))
+			goto out;
+		if (cpu.svalue < 0 || cpu.svalue > INT_MAX) {
+			PyErr_Format(PyExc_ValueError, "invalid CPU %lld",
+				     cpu.svalue);
+			goto out;
+		}
+		cpus[i] = cpu.svalue;
+	}
+	struct drgn_error *err = drgn_program_set_thread_cpus(&self->prog,
+							      cpus, num_cpus);
+	if (err) {
+		set_drgn_error(err);
+		goto out;
+	}
+	ret = 0;
+out:
+	free(cpus);
+	Py_DECREF(seq);
+	return ret;
+}
+
 static PyMethodDef Program_methods[] = {
 	{"add_memory_segment", (PyCFunction)Program_add_memory_segment,
 	 METH_VARARGS | METH_KEYWORDS, drgn_Program_add_memory_segment_DOC},
+	{"add_memory_block_segment",
+	 (PyCFunction)Program_add_memory_block_segment,
+	 METH_VARARGS | METH_KEYWORDS,
+	 drgn_Program_add_memory_block_segment_DOC},
 	{"add_type_finder", (PyCFunction)Program_add_type_finder,
 	 METH_VARARGS | METH_KEYWORDS, drgn_Program_add_type_finder_DOC},
 	{"add_object_finder", (PyCFunction)Program_add_object_finder,
@@ -1013,12 +2699,18 @@ static PyMethodDef Program_methods[] = {
 	{"load_default_debug_info",
 	 (PyCFunction)Program_load_default_debug_info, METH_NOARGS,
 	 drgn_Program_load_default_debug_info_DOC},
+	{"unload_debug_info", (PyCFunction)Program_unload_debug_info,
+	 METH_VARARGS | METH_KEYWORDS, drgn_Program_unload_debug_info_DOC},
+	{"set_debug_file_fetcher", (PyCFunction)Program_set_debug_file_fetcher,
+	 METH_VARARGS | METH_KEYWORDS, drgn_Program_set_debug_file_fetcher_DOC},
 	{"__getitem__", (PyCFunction)Program_subscript, METH_O | METH_COEXIST,
 	 drgn_Program___getitem___DOC},
 	{"__contains__", (PyCFunction)Program_contains, METH_O | METH_COEXIST,
 	 drgn_Program___contains___DOC},
 	{"read", (PyCFunction)Program_read, METH_VARARGS | METH_KEYWORDS,
 	 drgn_Program_read_DOC},
+	{"read_view", (PyCFunction)Program_read_view,
+	 METH_VARARGS | METH_KEYWORDS, drgn_Program_read_view_DOC},
 #define METHOD_DEF_READ(x)						\
 	{"read_"#x, (PyCFunction)Program_read_##x,			\
 	 METH_VARARGS | METH_KEYWORDS, drgn_Program_read_##x##_DOC}
@@ -1028,6 +2720,44 @@ static PyMethodDef Program_methods[] = {
 	METHOD_DEF_READ(u64),
 	METHOD_DEF_READ(word),
 #undef METHOD_READ_U
+	{"try_read", (PyCFunction)Program_try_read,
+	 METH_VARARGS | METH_KEYWORDS, drgn_Program_try_read_DOC},
+	{"read_word_or", (PyCFunction)Program_read_word_or,
+	 METH_VARARGS | METH_KEYWORDS, drgn_Program_read_word_or_DOC},
+	{"read_batch", (PyCFunction)Program_read_batch,
+	 METH_VARARGS | METH_KEYWORDS, drgn_Program_read_batch_DOC},
+	{"read_members", (PyCFunction)Program_read_members,
+	 METH_VARARGS | METH_KEYWORDS, drgn_Program_read_members_DOC},
+	{"memory_cache_stats", (PyCFunction)Program_memory_cache_stats,
+	 METH_NOARGS, drgn_Program_memory_cache_stats_DOC},
+	{"prefetch", (PyCFunction)Program_prefetch,
+	 METH_VARARGS | METH_KEYWORDS, drgn_Program_prefetch_DOC},
+	{"invalidate_memory_cache",
+	 (PyCFunction)Program_invalidate_memory_cache, METH_NOARGS,
+	 drgn_Program_invalidate_memory_cache_DOC},
+	{"invalidate_translation_cache",
+	 (PyCFunction)Program_invalidate_translation_cache, METH_NOARGS,
+	 drgn_Program_invalidate_translation_cache_DOC},
+	{"translation_cache_stats",
+	 (PyCFunction)Program_translation_cache_stats, METH_NOARGS,
+	 drgn_Program_translation_cache_stats_DOC},
+	{"stats", (PyCFunction)Program_stats, METH_NOARGS,
+	 drgn_Program_stats_DOC},
+	{"reset_stats", (PyCFunction)Program_reset_stats, METH_NOARGS,
+	 drgn_Program_reset_stats_DOC},
+	{"search_memory", (PyCFunction)Program_search_memory,
+	 METH_VARARGS | METH_KEYWORDS, drgn_Program_search_memory_DOC},
+	{"start_memory_trace", (PyCFunction)Program_start_memory_trace,
+	 METH_NOARGS, drgn_Program_start_memory_trace_DOC},
+	{"stop_memory_trace", (PyCFunction)Program_stop_memory_trace,
+	 METH_NOARGS, drgn_Program_stop_memory_trace_DOC},
+	{"add_memory_trace_objects",
+	 (PyCFunction)Program_add_memory_trace_objects,
+	 METH_VARARGS | METH_KEYWORDS,
+	 drgn_Program_add_memory_trace_objects_DOC},
+	{"write_memory_trace_core",
+	 (PyCFunction)Program_write_memory_trace_core,
+	 METH_VARARGS | METH_KEYWORDS, drgn_Program_write_memory_trace_core_DOC},
 	{"type", (PyCFunction)Program_find_type, METH_VARARGS | METH_KEYWORDS,
 	 drgn_Program_type_DOC},
 	{"object", (PyCFunction)Program_object, METH_VARARGS | METH_KEYWORDS,
@@ -1040,10 +2770,22 @@ static PyMethodDef Program_methods[] = {
 	 METH_VARARGS | METH_KEYWORDS, drgn_Program_variable_DOC},
 	{"stack_trace", (PyCFunction)Program_stack_trace,
 	 METH_VARARGS | METH_KEYWORDS, drgn_Program_stack_trace_DOC},
+	{"stack_trace_groups", (PyCFunction)Program_stack_trace_groups,
+	 METH_VARARGS | METH_KEYWORDS, drgn_Program_stack_trace_groups_DOC},
+	{"stack_traces", (PyCFunction)Program_stack_traces,
+	 METH_VARARGS | METH_KEYWORDS, drgn_Program_stack_traces_DOC},
+	{"sample_stack_traces", (PyCFunction)Program_sample_stack_traces,
+	 METH_VARARGS | METH_KEYWORDS, drgn_Program_sample_stack_traces_DOC},
+	{"find_frame_objects", (PyCFunction)Program_find_frame_objects,
+	 METH_VARARGS | METH_KEYWORDS, drgn_Program_find_frame_objects_DOC},
 	{"symbols", (PyCFunction)Program_symbols, METH_VARARGS,
 	 drgn_Program_symbols_DOC},
+	{"symbolize", (PyCFunction)Program_symbolize, METH_O,
+	 drgn_Program_symbolize_DOC},
 	{"symbol", (PyCFunction)Program_symbol, METH_O,
 	 drgn_Program_symbol_DOC},
+	{"types", (PyCFunction)Program_types, METH_VARARGS | METH_KEYWORDS,
+	 drgn_Program_types_DOC},
 	{"threads", (PyCFunction)Program_threads, METH_NOARGS,
 	 drgn_Program_threads_DOC},
 	{"thread", (PyCFunction)Program_thread,
@@ -1076,6 +2818,8 @@ static PyMethodDef Program_methods[] = {
 	 METH_VARARGS | METH_KEYWORDS, drgn_Program_array_type_DOC},
 	{"function_type", (PyCFunction)Program_function_type,
 	 METH_VARARGS | METH_KEYWORDS, drgn_Program_function_type_DOC},
+	{"member_path", (PyCFunction)Program_member_path,
+	 METH_VARARGS | METH_KEYWORDS, drgn_Program_member_path_DOC},
 	{},
 };
 
@@ -1091,6 +2835,17 @@ static PyGetSetDef Program_getset[] = {
 	 drgn_Program_platform_DOC},
 	{"language", (getter)Program_get_language, (setter)Program_set_language,
 	 drgn_Program_language_DOC},
+	{"memory_cache_size", (getter)Program_get_memory_cache_size,
+	 (setter)Program_set_memory_cache_size,
+	 drgn_Program_memory_cache_size_DOC},
+	{"translation_cache_enabled",
+	 (getter)Program_get_translation_cache_enabled,
+	 (setter)Program_set_translation_cache_enabled,
+	 drgn_Program_translation_cache_enabled_DOC},
+	{"num_threads", (getter)Program_get_num_threads,
+	 (setter)Program_set_num_threads, drgn_Program_num_threads_DOC},
+	{"thread_cpus", (getter)Program_get_thread_cpus,
+	 (setter)Program_set_thread_cpus, drgn_Program_thread_cpus_DOC},
 	{},
 };
 
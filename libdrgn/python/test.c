@@ -10,6 +10,7 @@
  */
 
 #include "drgnpy.h"
+#include "../debug_info.h"
 #include "../lexer.h"
 #include "../path.h"
 #include "../serialize.h"
@@ -90,3 +91,24 @@ DRGNPY_PUBLIC uint64_t drgn_test_deserialize_bits(const void *buf,
 {
 	return deserialize_bits(buf, bit_offset, bit_size, little_endian);
 }
+
+DRGNPY_PUBLIC bool drgn_test_deserialize_bits_fn(const void *buf,
+						 uint8_t bit_size,
+						 bool little_endian,
+						 uint64_t *ret)
+{
+	deserialize_fn *fn = deserialize_bits_fn(bit_size, little_endian);
+	if (!fn)
+		return false;
+	*ret = fn(buf);
+	return true;
+}
+
+DRGNPY_PUBLIC void
+drgn_test_debug_info_timings(Program *prog, struct drgn_debug_info_timings *ret)
+{
+	if (prog->prog.dbinfo)
+		*ret = prog->prog.dbinfo->timings;
+	else
+		memset(ret, 0, sizeof(*ret));
+}
@@ -62,7 +62,9 @@ static PyObject *Thread_stack_trace(Thread *self)
 {
 	struct drgn_error *err;
 	struct drgn_stack_trace *trace;
+	Py_BEGIN_ALLOW_THREADS
 	err = drgn_thread_stack_trace(&self->thread, &trace);
+	Py_END_ALLOW_THREADS
 	if (err)
 		return set_drgn_error(err);
 	PyObject *ret = StackTrace_wrap(trace);
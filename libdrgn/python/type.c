@@ -7,6 +7,7 @@
 #include "../lazy_object.h"
 #include "../platform.h"
 #include "../program.h"
+#include "../string_builder.h"
 #include "../type.h"
 #include "../util.h"
 
@@ -178,6 +179,10 @@ static PyObject *DrgnType_get_type(DrgnType *self)
 		return DrgnType_wrap(drgn_type_type(self->type));
 }
 
+/*
+ * The name and bit offset of members wrapped from a drgn_type are only
+ * converted to Python objects when they are first accessed.
+ */
 static TypeMember *TypeMember_wrap(PyObject *parent,
 				   struct drgn_type_member *member,
 				   uint64_t bit_offset)
@@ -190,30 +195,151 @@ static TypeMember *TypeMember_wrap(PyObject *parent,
 	Py_INCREF(parent);
 	py_member->lazy_obj.obj = parent;
 	py_member->lazy_obj.lazy_obj = &member->object;
-	if (member->name) {
-		py_member->name = PyUnicode_FromString(member->name);
-		if (!py_member->name)
-			goto err;
-	} else {
-		Py_INCREF(Py_None);
-		py_member->name = Py_None;
-	}
-	py_member->bit_offset = PyLong_FromUnsignedLongLong(bit_offset);
-	if (!py_member->bit_offset)
-		goto err;
+	py_member->name_str = member->name;
+	py_member->bit_offset_value = bit_offset;
 	return py_member;
+}
 
-err:
-	Py_DECREF(py_member);
+/* Get the name of a member as a borrowed reference. */
+static PyObject *TypeMember_name(TypeMember *self)
+{
+	if (!self->name) {
+		if (self->name_str) {
+			self->name = PyUnicode_FromString(self->name_str);
+			if (!self->name)
+				return NULL;
+		} else {
+			Py_INCREF(Py_None);
+			self->name = Py_None;
+		}
+	}
+	return self->name;
+}
+
+/* Get the bit offset of a member as a borrowed reference. */
+static PyObject *TypeMember_bit_offset(TypeMember *self)
+{
+	if (!self->bit_offset) {
+		self->bit_offset =
+			PyLong_FromUnsignedLongLong(self->bit_offset_value);
+	}
+	return self->bit_offset;
+}
+
+static TypeParameter *TypeParameter_wrap(PyObject *parent,
+					 struct drgn_type_parameter *parameter)
+{
+	TypeParameter *py_parameter =
+		(TypeParameter *)TypeParameter_type.tp_alloc(&TypeParameter_type,
+							     0);
+	if (!py_parameter)
+		return NULL;
+
+	Py_INCREF(parent);
+	py_parameter->lazy_obj.obj = parent;
+	py_parameter->lazy_obj.lazy_obj = &parameter->default_argument;
+	py_parameter->name_str = parameter->name;
+	return py_parameter;
+}
+
+/* Get the name of a parameter as a borrowed reference. */
+static PyObject *TypeParameter_name(TypeParameter *self)
+{
+	if (!self->name) {
+		if (self->name_str) {
+			self->name = PyUnicode_FromString(self->name_str);
+			if (!self->name)
+				return NULL;
+		} else {
+			Py_INCREF(Py_None);
+			self->name = Py_None;
+		}
+	}
+	return self->name;
+}
+
+/*
+ * Return whether the name of a TypeMember or TypeParameter equals a string,
+ * without creating the name object if it hasn't been created yet.
+ */
+static int type_item_name_eq(PyObject *name_obj, const char *name_str,
+			     PyObject *key)
+{
+	if (name_obj) {
+		if (name_obj == Py_None)
+			return 0;
+		return PyUnicode_Compare(name_obj, key) == 0 ? 1 :
+		       PyErr_Occurred() ? -1 : 0;
+	}
+	if (!name_str)
+		return 0;
+	const char *key_str = PyUnicode_AsUTF8(key);
+	if (!key_str)
+		return -1;
+	return strcmp(name_str, key_str) == 0;
+}
+
+/*
+ * Tuples of the members or parameters of a type that can also be indexed by
+ * name.
+ */
+static PyObject *TypeItemSequence_subscript(PyObject *self, PyObject *key)
+{
+	if (!PyUnicode_Check(key))
+		return PyTuple_Type.tp_as_mapping->mp_subscript(self, key);
+
+	bool members = Py_TYPE(self) == &TypeMemberSequence_type;
+	for (Py_ssize_t i = 0; i < PyTuple_GET_SIZE(self); i++) {
+		PyObject *item = PyTuple_GET_ITEM(self, i);
+		int r;
+		if (members) {
+			TypeMember *member = (TypeMember *)item;
+			r = type_item_name_eq(member->name, member->name_str,
+					      key);
+		} else {
+			TypeParameter *parameter = (TypeParameter *)item;
+			r = type_item_name_eq(parameter->name,
+					      parameter->name_str, key);
+		}
+		if (r < 0)
+			return NULL;
+		if (r) {
+			Py_INCREF(item);
+			return item;
+		}
+	}
+	PyErr_SetObject(PyExc_KeyError, key);
 	return NULL;
 }
 
-static PyObject *DrgnType_get_members(DrgnType *self)
+static Py_ssize_t TypeItemSequence_length(PyObject *self)
 {
-	PyObject *members_obj;
-	struct drgn_type_member *members;
-	size_t num_members, i;
+	return PyTuple_GET_SIZE(self);
+}
+
+static PyMappingMethods TypeItemSequence_as_mapping = {
+	.mp_length = TypeItemSequence_length,
+	.mp_subscript = TypeItemSequence_subscript,
+};
+
+PyTypeObject TypeMemberSequence_type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "_drgn._TypeMemberSequence",
+	.tp_as_mapping = &TypeItemSequence_as_mapping,
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_base = &PyTuple_Type,
+};
+
+PyTypeObject TypeParameterSequence_type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "_drgn._TypeParameterSequence",
+	.tp_as_mapping = &TypeItemSequence_as_mapping,
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_base = &PyTuple_Type,
+};
 
+static PyObject *DrgnType_get_members(DrgnType *self)
+{
 	if (!drgn_type_has_members(self->type)) {
 		return PyErr_Format(PyExc_AttributeError,
 				    "%s type does not have members",
@@ -223,25 +349,25 @@ static PyObject *DrgnType_get_members(DrgnType *self)
 	if (!drgn_type_is_complete(self->type))
 		Py_RETURN_NONE;
 
-	members = drgn_type_members(self->type);
-	num_members = drgn_type_num_members(self->type);
-	members_obj = PyTuple_New(num_members);
+	struct drgn_type_member *members = drgn_type_members(self->type);
+	size_t num_members = drgn_type_num_members(self->type);
+	PyObject *members_obj =
+		TypeMemberSequence_type.tp_alloc(&TypeMemberSequence_type,
+						 num_members);
 	if (!members_obj)
 		return NULL;
 
-	for (i = 0; i < num_members; i++) {
+	for (size_t i = 0; i < num_members; i++) {
 		TypeMember *item = TypeMember_wrap((PyObject *)self,
 						   &members[i],
 						   members[i].bit_offset);
-		if (!item)
-			goto err;
+		if (!item) {
+			Py_DECREF(members_obj);
+			return NULL;
+		}
 		PyTuple_SET_ITEM(members_obj, i, (PyObject *)item);
 	}
 	return members_obj;
-
-err:
-	Py_DECREF(members_obj);
-	return NULL;
 }
 
 static PyObject *DrgnType_get_enumerators(DrgnType *self)
@@ -292,48 +418,31 @@ static PyObject *DrgnType_get_enumerators(DrgnType *self)
 
 static PyObject *DrgnType_get_parameters(DrgnType *self)
 {
-	PyObject *parameters_obj;
-	struct drgn_type_parameter *parameters;
-	size_t num_parameters, i;
-
 	if (!drgn_type_has_parameters(self->type)) {
 		return PyErr_Format(PyExc_AttributeError,
 				    "%s type does not have parameters",
 				    drgn_type_kind_str(self->type));
 	}
 
-	parameters = drgn_type_parameters(self->type);
-	num_parameters = drgn_type_num_parameters(self->type);
-	parameters_obj = PyTuple_New(num_parameters);
+	struct drgn_type_parameter *parameters =
+		drgn_type_parameters(self->type);
+	size_t num_parameters = drgn_type_num_parameters(self->type);
+	PyObject *parameters_obj =
+		TypeParameterSequence_type.tp_alloc(&TypeParameterSequence_type,
+						    num_parameters);
 	if (!parameters_obj)
 		return NULL;
 
-	for (i = 0; i < num_parameters; i++) {
-		struct drgn_type_parameter *parameter = &parameters[i];
-		TypeParameter *item;
-
-		item = (TypeParameter *)TypeParameter_type.tp_alloc(&TypeParameter_type,
-								    0);
-		if (!item)
-			goto err;
-		PyTuple_SET_ITEM(parameters_obj, i, (PyObject *)item);
-		Py_INCREF(self);
-		item->lazy_obj.obj = (PyObject *)self;
-		item->lazy_obj.lazy_obj = &parameter->default_argument;
-		if (parameter->name) {
-			item->name = PyUnicode_FromString(parameter->name);
-			if (!item->name)
-				goto err;
-		} else {
-			Py_INCREF(Py_None);
-			item->name = Py_None;
+	for (size_t i = 0; i < num_parameters; i++) {
+		TypeParameter *item = TypeParameter_wrap((PyObject *)self,
+							 &parameters[i]);
+		if (!item) {
+			Py_DECREF(parameters_obj);
+			return NULL;
 		}
+		PyTuple_SET_ITEM(parameters_obj, i, (PyObject *)item);
 	}
 	return parameters_obj;
-
-err:
-	Py_DECREF(parameters_obj);
-	return NULL;
 }
 
 static PyObject *DrgnType_get_is_variadic(DrgnType *self)
@@ -1088,9 +1197,13 @@ static PyObject *TypeMember_get_offset(TypeMember *self, void *arg)
 {
 	unsigned long long bit_offset;
 
-	bit_offset = PyLong_AsUnsignedLongLong(self->bit_offset);
-	if (bit_offset == (unsigned long long)-1 && PyErr_Occurred())
-		return NULL;
+	if (self->bit_offset) {
+		bit_offset = PyLong_AsUnsignedLongLong(self->bit_offset);
+		if (bit_offset == (unsigned long long)-1 && PyErr_Occurred())
+			return NULL;
+	} else {
+		bit_offset = self->bit_offset_value;
+	}
 	if (bit_offset % 8) {
 		PyErr_SetString(PyExc_ValueError,
 				"member is not byte-aligned");
@@ -1118,11 +1231,14 @@ static PyObject *TypeMember_repr(TypeMember *self)
 	if (append_format(parts, "TypeMember(") < 0 ||
 	    append_lazy_object_repr(parts, (LazyObject *)self) < 0)
 		goto out;
-	if (self->name != Py_None &&
-	    append_format(parts, ", name=%R", self->name) < 0)
+	PyObject *name = TypeMember_name(self);
+	if (!name ||
+	    (name != Py_None && append_format(parts, ", name=%R", name) < 0))
 		goto out;
 	/* Include the bit offset even if it is the default of 0 for clarity. */
-	if (append_format(parts, ", bit_offset=%R)", self->bit_offset) < 0)
+	PyObject *bit_offset = TypeMember_bit_offset(self);
+	if (!bit_offset ||
+	    append_format(parts, ", bit_offset=%R)", bit_offset) < 0)
 		goto out;
 	ret = join_strings(parts);
 out:
@@ -1130,15 +1246,25 @@ out:
 	return ret;
 }
 
-static PyMemberDef TypeMember_members[] = {
-	{"name", T_OBJECT, offsetof(TypeMember, name), READONLY,
-	 drgn_TypeMember_name_DOC},
-	{"bit_offset", T_OBJECT, offsetof(TypeMember, bit_offset), READONLY,
-	 drgn_TypeMember_bit_offset_DOC},
-	{},
-};
+static PyObject *TypeMember_get_name(TypeMember *self, void *arg)
+{
+	PyObject *name = TypeMember_name(self);
+	Py_XINCREF(name);
+	return name;
+}
+
+static PyObject *TypeMember_get_bit_offset(TypeMember *self, void *arg)
+{
+	PyObject *bit_offset = TypeMember_bit_offset(self);
+	Py_XINCREF(bit_offset);
+	return bit_offset;
+}
 
 static PyGetSetDef TypeMember_getset[] = {
+	{"name", (getter)TypeMember_get_name, NULL, drgn_TypeMember_name_DOC,
+	 NULL},
+	{"bit_offset", (getter)TypeMember_get_bit_offset, NULL,
+	 drgn_TypeMember_bit_offset_DOC, NULL},
 	{"object", (getter)LazyObject_get, NULL, drgn_TypeMember_object_DOC,
 	 NULL},
 	{"type", (getter)LazyObject_get_type, NULL, drgn_TypeMember_type_DOC,
@@ -1158,7 +1284,6 @@ PyTypeObject TypeMember_type = {
 	.tp_repr = (reprfunc)TypeMember_repr,
 	.tp_flags = Py_TPFLAGS_DEFAULT,
 	.tp_doc = drgn_TypeMember_DOC,
-	.tp_members = TypeMember_members,
 	.tp_getset = TypeMember_getset,
 	.tp_new = (newfunc)TypeMember_new,
 };
@@ -1211,8 +1336,9 @@ static PyObject *TypeParameter_repr(TypeParameter *self)
 	if (append_format(parts, "TypeParameter(") < 0 ||
 	    append_lazy_object_repr(parts, (LazyObject *)self) < 0)
 		goto out;
-	if (self->name != Py_None &&
-	    append_format(parts, ", name=%R", self->name) < 0)
+	PyObject *name = TypeParameter_name(self);
+	if (!name ||
+	    (name != Py_None && append_format(parts, ", name=%R", name) < 0))
 		goto out;
 	if (append_string(parts, ")") < 0)
 		goto out;
@@ -1222,13 +1348,16 @@ out:
 	return ret;
 }
 
-static PyMemberDef TypeParameter_members[] = {
-	{"name", T_OBJECT, offsetof(TypeParameter, name), READONLY,
-	 drgn_TypeParameter_name_DOC},
-	{},
-};
+static PyObject *TypeParameter_get_name(TypeParameter *self, void *arg)
+{
+	PyObject *name = TypeParameter_name(self);
+	Py_XINCREF(name);
+	return name;
+}
 
 static PyGetSetDef TypeParameter_getset[] = {
+	{"name", (getter)TypeParameter_get_name, NULL,
+	 drgn_TypeParameter_name_DOC, NULL},
 	{"default_argument", (getter)LazyObject_get, NULL,
 	 drgn_TypeParameter_default_argument_DOC, NULL},
 	{"type", (getter)LazyObject_get_type, NULL, drgn_TypeParameter_type_DOC,
@@ -1244,7 +1373,6 @@ PyTypeObject TypeParameter_type = {
 	.tp_repr = (reprfunc)TypeParameter_repr,
 	.tp_flags = Py_TPFLAGS_DEFAULT,
 	.tp_doc = drgn_TypeParameter_DOC,
-	.tp_members = TypeParameter_members,
 	.tp_getset = TypeParameter_getset,
 	.tp_new = (newfunc)TypeParameter_new,
 };
@@ -1629,17 +1757,23 @@ static int unpack_member(struct drgn_compound_type_builder *builder,
 	}
 	TypeMember *member = (TypeMember *)item;
 
+	PyObject *name_obj = TypeMember_name(member);
+	if (!name_obj)
+		return -1;
 	const char *name;
-	if (member->name == Py_None) {
+	if (name_obj == Py_None) {
 		name = NULL;
 	} else {
-		name = PyUnicode_AsUTF8(member->name);
+		name = PyUnicode_AsUTF8(name_obj);
 		if (!name)
 			return -1;
 	}
 
+	PyObject *bit_offset_obj = TypeMember_bit_offset(member);
+	if (!bit_offset_obj)
+		return -1;
 	unsigned long long bit_offset =
-		PyLong_AsUnsignedLongLong(member->bit_offset);
+		PyLong_AsUnsignedLongLong(bit_offset_obj);
 	if (bit_offset == (unsigned long long)-1 && PyErr_Occurred())
 		return -1;
 
@@ -2202,11 +2336,14 @@ static int unpack_parameter(struct drgn_function_type_builder *builder,
 	}
 	TypeParameter *parameter = (TypeParameter *)item;
 
+	PyObject *name_obj = TypeParameter_name(parameter);
+	if (!name_obj)
+		return -1;
 	const char *name;
-	if (parameter->name == Py_None) {
+	if (name_obj == Py_None) {
 		name = NULL;
 	} else {
-		name = PyUnicode_AsUTF8(parameter->name);
+		name = PyUnicode_AsUTF8(name_obj);
 		if (!name)
 			return -1;
 	}
@@ -2340,3 +2477,158 @@ err_parameters:
 	Py_DECREF(cached_parameters);
 	return NULL;
 }
+
+MemberPath *Program_member_path(Program *self, PyObject *args, PyObject *kwds)
+{
+	static char *keywords[] = {"type", "member", NULL};
+	struct drgn_error *err;
+	PyObject *type_obj;
+	const char *member;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "Os:member_path", keywords,
+					 &type_obj, &member))
+		return NULL;
+
+	struct drgn_qualified_type qualified_type;
+	if (Program_type_arg(self, type_obj, false, &qualified_type) == -1)
+		return NULL;
+
+	MemberPath *ret =
+		(MemberPath *)MemberPath_type.tp_alloc(&MemberPath_type, 0);
+	if (!ret)
+		return NULL;
+	err = drgn_member_path_init(&ret->path, qualified_type.type, member);
+	if (err) {
+		Py_DECREF(ret);
+		return set_drgn_error(err);
+	}
+	ret->prog = self;
+	Py_INCREF(self);
+	return ret;
+}
+
+static void MemberPath_dealloc(MemberPath *self)
+{
+	Py_XDECREF(self->prog);
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static DrgnObject *MemberPath_call(MemberPath *self, PyObject *args,
+				   PyObject *kwds)
+{
+	static char *keywords[] = {"obj", NULL};
+	struct drgn_error *err;
+	DrgnObject *obj;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!:MemberPath", keywords,
+					 &DrgnObject_type, &obj))
+		return NULL;
+
+	DrgnObject *res = DrgnObject_alloc(DrgnObject_prog(obj));
+	if (!res)
+		return NULL;
+	err = drgn_object_member_path(&res->obj, &obj->obj, &self->path);
+	if (err) {
+		Py_DECREF(res);
+		return set_drgn_error(err);
+	}
+	if (DrgnObject_inherit_snapshot(res, obj)) {
+		Py_DECREF(res);
+		return NULL;
+	}
+	return res;
+}
+
+static PyObject *MemberPath_get_type(MemberPath *self, void *arg)
+{
+	return DrgnType_wrap((struct drgn_qualified_type){ self->path.type });
+}
+
+static PyObject *MemberPath_get_member_type(MemberPath *self, void *arg)
+{
+	return DrgnType_wrap(self->path.member_type);
+}
+
+static PyObject *MemberPath_get_bit_offset(MemberPath *self, void *arg)
+{
+	return PyLong_FromUnsignedLongLong(self->path.bit_offset);
+}
+
+static PyObject *MemberPath_get_bit_field_size(MemberPath *self, void *arg)
+{
+	if (self->path.bit_field_size)
+		return PyLong_FromUnsignedLongLong(self->path.bit_field_size);
+	else
+		Py_RETURN_NONE;
+}
+
+static PyGetSetDef MemberPath_getset[] = {
+	{"type", (getter)MemberPath_get_type, NULL, drgn_MemberPath_type_DOC},
+	{"member_type", (getter)MemberPath_get_member_type, NULL,
+	 drgn_MemberPath_member_type_DOC},
+	{"bit_offset", (getter)MemberPath_get_bit_offset, NULL,
+	 drgn_MemberPath_bit_offset_DOC},
+	{"bit_field_size", (getter)MemberPath_get_bit_field_size, NULL,
+	 drgn_MemberPath_bit_field_size_DOC},
+	{},
+};
+
+PyTypeObject MemberPath_type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "_drgn.MemberPath",
+	.tp_basicsize = sizeof(MemberPath),
+	.tp_dealloc = (destructor)MemberPath_dealloc,
+	.tp_call = (ternaryfunc)MemberPath_call,
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_doc = drgn_MemberPath_DOC,
+	.tp_getset = MemberPath_getset,
+};
+
+static void TypeIterator_dealloc(TypeIterator *self)
+{
+	drgn_type_iterator_destroy(self->iterator);
+	Py_XDECREF(self->prog);
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *TypeIterator_next(TypeIterator *self)
+{
+	struct drgn_type *type = drgn_type_iterator_next(self->iterator);
+	if (!type)
+		return NULL;
+	return DrgnType_wrap((struct drgn_qualified_type){ type });
+}
+
+PyTypeObject TypeIterator_type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "_drgn._TypeIterator",
+	.tp_basicsize = sizeof(TypeIterator),
+	.tp_dealloc = (destructor)TypeIterator_dealloc,
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_iter = PyObject_SelfIter,
+	.tp_iternext = (iternextfunc)TypeIterator_next,
+};
+
+PyObject *drgnpy_decode_enum_type_flags(PyObject *self, PyObject *args,
+					PyObject *kwds)
+{
+	static char *keywords[] = {"value", "type", "bit_numbers", NULL};
+	struct drgn_error *err;
+	struct index_arg value = {};
+	DrgnType *type;
+	int bit_numbers = 1;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds,
+					 "O&O!|p:_decode_enum_type_flags",
+					 keywords, index_converter, &value,
+					 &DrgnType_type, &type, &bit_numbers))
+		return NULL;
+
+	struct string_builder sb = {};
+	err = drgn_enum_type_format_flags(type->type, value.uvalue, bit_numbers,
+					  &sb);
+	if (err) {
+		free(sb.str);
+		return set_drgn_error(err);
+	}
+	PyObject *ret = PyUnicode_FromStringAndSize(sb.str, sb.len);
+	free(sb.str);
+	return ret;
+}
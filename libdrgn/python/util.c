@@ -54,6 +54,49 @@ PyObject *join_strings(PyObject *parts)
 	return ret;
 }
 
+static void BorrowedBuffer_dealloc(BorrowedBuffer *self)
+{
+	Py_XDECREF(self->owner);
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static int BorrowedBuffer_getbuffer(BorrowedBuffer *self, Py_buffer *view,
+				    int flags)
+{
+	return PyBuffer_FillInfo(view, (PyObject *)self, (void *)self->buf,
+				 self->size, 1, flags);
+}
+
+static PyBufferProcs BorrowedBuffer_as_buffer = {
+	.bf_getbuffer = (getbufferproc)BorrowedBuffer_getbuffer,
+};
+
+PyTypeObject BorrowedBuffer_type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "_drgn._BorrowedBuffer",
+	.tp_basicsize = sizeof(BorrowedBuffer),
+	.tp_dealloc = (destructor)BorrowedBuffer_dealloc,
+	.tp_as_buffer = &BorrowedBuffer_as_buffer,
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+};
+
+PyObject *borrowed_memoryview(PyObject *owner, const void *buf,
+			      Py_ssize_t size)
+{
+	BorrowedBuffer *buffer = PyObject_New(BorrowedBuffer,
+					      &BorrowedBuffer_type);
+	if (!buffer)
+		return NULL;
+	Py_INCREF(owner);
+	buffer->owner = owner;
+	buffer->buf = buf;
+	buffer->size = size;
+	/* The memoryview holds a reference to the buffer, and thus the owner. */
+	PyObject *view = PyMemoryView_FromObject((PyObject *)buffer);
+	Py_DECREF(buffer);
+	return view;
+}
+
 int index_converter(PyObject *o, void *p)
 {
 	struct index_arg *arg = p;
@@ -1,12 +1,12 @@
 // Copyright (c) Meta Platforms, Inc. and affiliates.
 // SPDX-License-Identifier: GPL-3.0-or-later
 
-#include <elfutils/libdwfl.h>
 #include <limits.h>
 
 #include "debug_info.h"
 #include "drgn.h"
 #include "register_state.h"
+#include "stack_trace.h"
 
 #define drgn_register_state_known_bitset(regs) ({	\
 	__auto_type _state = (regs);			\
@@ -87,21 +87,9 @@ void drgn_register_state_set_pc(struct drgn_program *prog,
 	regs->_pc = pc;
 	drgn_register_state_set_known(regs, 0);
 	if (prog->dbinfo) {
-		Dwfl_Module *dwfl_module = dwfl_addrmodule(prog->dbinfo->dwfl,
+		regs->module =
+			drgn_program_find_pc_module_locked(prog,
 							   pc - !regs->interrupted);
-		if (dwfl_module) {
-			void **userdatap;
-			dwfl_module_info(dwfl_module, &userdatap, NULL, NULL,
-					 NULL, NULL, NULL, NULL);
-			struct drgn_debug_info_module *module = *userdatap;
-			static const enum drgn_platform_flags check_flags =
-				(DRGN_PLATFORM_IS_64_BIT |
-				 DRGN_PLATFORM_IS_LITTLE_ENDIAN);
-			if (module->platform.arch == prog->platform.arch &&
-			    (module->platform.flags & check_flags) ==
-			    (prog->platform.flags & check_flags))
-				regs->module = module;
-		}
 	}
 }
 
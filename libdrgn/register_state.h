@@ -156,7 +156,7 @@ drgn_register_state_get_pc(const struct drgn_register_state *regs)
 
 /**
  * Set the value of the program counter in a @ref drgn_register_state and mark
- * it as known.
+ * it as known. The caller must hold the program lock.
  */
 void drgn_register_state_set_pc(struct drgn_program *prog,
 				struct drgn_register_state *regs, uint64_t pc);
@@ -0,0 +1,332 @@
+// Copyright (c) Meta Platforms, Inc. and affiliates.
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <endian.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zstd.h>
+
+#include "array.h"
+#include "error.h"
+#include "minmax.h"
+#include "seekable_zstd.h"
+#include "util.h"
+
+#define ZSTD_SEEKABLE_MAGIC_NUMBER UINT32_C(0x8F92EAB1)
+#define ZSTD_SEEKABLE_SKIPPABLE_MAGIC_NUMBER UINT32_C(0x184D2A5E)
+#define ZSTD_SEEKABLE_FOOTER_SIZE 9
+#define ZSTD_SEEKABLE_CHECKSUM_FLAG 0x80
+#define ZSTD_SEEKABLE_RESERVED_FLAGS 0x7c
+
+struct drgn_seekable_zstd_cached_frame {
+	/* Decompressed contents, or NULL if this entry is unused. */
+	char *buf;
+	/* Index of the frame. */
+	size_t frame;
+	/* Value of drgn_seekable_zstd::clock when this was last used. */
+	uint64_t last_used;
+};
+
+struct drgn_seekable_zstd {
+	int fd;
+	size_t num_frames;
+	/*
+	 * Compressed and decompressed offsets of the start of each frame, plus
+	 * one more entry each for the end of the last frame.
+	 */
+	uint64_t *compressed_offsets;
+	uint64_t *decompressed_offsets;
+	/* Protects everything below. */
+	pthread_mutex_t lock;
+	ZSTD_DCtx *dctx;
+	/* Buffer for reading a compressed frame. */
+	void *compressed_buf;
+	size_t compressed_buf_capacity;
+	struct drgn_seekable_zstd_cached_frame cache[DRGN_SEEKABLE_ZSTD_CACHE_SIZE];
+	uint64_t clock;
+};
+
+static struct drgn_error *pread_all(const char *path, int fd, void *buf,
+				    size_t count, uint64_t offset)
+{
+	char *p = buf;
+	while (count) {
+		ssize_t sret = pread(fd, p, count, offset);
+		if (sret == -1) {
+			if (errno == EINTR)
+				continue;
+			return drgn_error_create_os("pread", errno, path);
+		} else if (sret == 0) {
+			return drgn_error_format(DRGN_ERROR_OTHER,
+						 "%s: unexpected end of file",
+						 path ? path : "zstd");
+		}
+		p += sret;
+		count -= sret;
+		offset += sret;
+	}
+	return NULL;
+}
+
+static inline uint32_t read_le32(const char *p)
+{
+	uint32_t value;
+	memcpy(&value, p, sizeof(value));
+	return le32toh(value);
+}
+
+static struct drgn_error *
+drgn_seekable_zstd_read_seek_table(struct drgn_seekable_zstd *zstd,
+				   const char *path)
+{
+	struct drgn_error *err;
+
+	struct stat st;
+	if (fstat(zstd->fd, &st) == -1)
+		return drgn_error_create_os("fstat", errno, path);
+	if (st.st_size < 8 + ZSTD_SEEKABLE_FOOTER_SIZE)
+		goto not_seekable;
+	uint64_t file_size = st.st_size;
+
+	char footer[ZSTD_SEEKABLE_FOOTER_SIZE];
+	err = pread_all(path, zstd->fd, footer, sizeof(footer),
+			file_size - sizeof(footer));
+	if (err)
+		return err;
+	if (read_le32(footer + 5) != ZSTD_SEEKABLE_MAGIC_NUMBER ||
+	    (footer[4] & ZSTD_SEEKABLE_RESERVED_FLAGS))
+		goto not_seekable;
+	uint32_t num_frames = read_le32(footer);
+	size_t entry_size =
+		(footer[4] & ZSTD_SEEKABLE_CHECKSUM_FLAG) ? 12 : 8;
+	uint64_t table_size = (uint64_t)num_frames * entry_size;
+	if (table_size > file_size - 8 - ZSTD_SEEKABLE_FOOTER_SIZE ||
+	    table_size > SIZE_MAX)
+		goto not_seekable;
+	/* The seek table is in a skippable frame at the end of the file. */
+	uint64_t table_frame_offset =
+		file_size - 8 - table_size - ZSTD_SEEKABLE_FOOTER_SIZE;
+	char frame_header[8];
+	err = pread_all(path, zstd->fd, frame_header, sizeof(frame_header),
+			table_frame_offset);
+	if (err)
+		return err;
+	if (read_le32(frame_header) != ZSTD_SEEKABLE_SKIPPABLE_MAGIC_NUMBER ||
+	    read_le32(frame_header + 4) !=
+	    table_size + ZSTD_SEEKABLE_FOOTER_SIZE)
+		goto not_seekable;
+
+	zstd->compressed_offsets = malloc_array((size_t)num_frames + 1,
+						sizeof(zstd->compressed_offsets[0]));
+	zstd->decompressed_offsets =
+		malloc_array((size_t)num_frames + 1,
+			     sizeof(zstd->decompressed_offsets[0]));
+	if (!zstd->compressed_offsets || !zstd->decompressed_offsets)
+		return &drgn_enomem;
+	char *table = malloc(table_size);
+	if (table_size && !table)
+		return &drgn_enomem;
+	err = pread_all(path, zstd->fd, table, table_size,
+			table_frame_offset + 8);
+	if (err)
+		goto out_table;
+
+	uint64_t compressed_offset = 0, decompressed_offset = 0;
+	for (uint32_t i = 0; i < num_frames; i++) {
+		zstd->compressed_offsets[i] = compressed_offset;
+		zstd->decompressed_offsets[i] = decompressed_offset;
+		/* These can't overflow since they're sums of 32-bit sizes. */
+		compressed_offset += read_le32(table + i * entry_size);
+		decompressed_offset += read_le32(table + i * entry_size + 4);
+	}
+	zstd->compressed_offsets[num_frames] = compressed_offset;
+	zstd->decompressed_offsets[num_frames] = decompressed_offset;
+	zstd->num_frames = num_frames;
+	if (compressed_offset > table_frame_offset) {
+		zstd->num_frames = 0;
+		free(table);
+		goto not_seekable;
+	}
+	err = NULL;
+out_table:
+	free(table);
+	return err;
+
+not_seekable:
+	return drgn_error_format(DRGN_ERROR_INVALID_ARGUMENT,
+				 "%s: zstd file is not in the seekable format (compress it with a tool that writes a seek table, e.g., t2sz or zstd's seekable_format)",
+				 path ? path : "zstd");
+}
+
+struct drgn_error *drgn_seekable_zstd_create(const char *path, int fd,
+					     struct drgn_seekable_zstd **ret)
+{
+	struct drgn_error *err;
+
+	struct drgn_seekable_zstd *zstd = calloc(1, sizeof(*zstd));
+	if (!zstd)
+		return &drgn_enomem;
+	zstd->fd = fd;
+	pthread_mutex_init(&zstd->lock, NULL);
+
+	err = drgn_seekable_zstd_read_seek_table(zstd, path);
+	if (err)
+		goto err;
+
+	zstd->dctx = ZSTD_createDCtx();
+	if (!zstd->dctx) {
+		err = &drgn_enomem;
+		goto err;
+	}
+	*ret = zstd;
+	return NULL;
+
+err:
+	drgn_seekable_zstd_destroy(zstd);
+	return err;
+}
+
+void drgn_seekable_zstd_destroy(struct drgn_seekable_zstd *zstd)
+{
+	if (!zstd)
+		return;
+	for (size_t i = 0; i < array_size(zstd->cache); i++)
+		free(zstd->cache[i].buf);
+	free(zstd->compressed_buf);
+	ZSTD_freeDCtx(zstd->dctx);
+	pthread_mutex_destroy(&zstd->lock);
+	free(zstd->decompressed_offsets);
+	free(zstd->compressed_offsets);
+	free(zstd);
+}
+
+uint64_t drgn_seekable_zstd_size(struct drgn_seekable_zstd *zstd)
+{
+	return zstd->decompressed_offsets[zstd->num_frames];
+}
+
+/* Find the frame containing a decompressed offset, which must be in bounds. */
+static size_t drgn_seekable_zstd_find_frame(struct drgn_seekable_zstd *zstd,
+					    uint64_t offset)
+{
+	size_t lo = 0, hi = zstd->num_frames;
+	while (hi - lo > 1) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (zstd->decompressed_offsets[mid] <= offset)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/*
+ * Get the decompressed contents of a frame, from the cache if possible.
+ * zstd->lock must be held. The returned buffer is valid until the lock is
+ * released.
+ */
+static struct drgn_error *
+drgn_seekable_zstd_get_frame(struct drgn_seekable_zstd *zstd, size_t frame,
+			     const char **ret)
+{
+	struct drgn_error *err;
+
+	/* On a miss, replace an unused or the least recently used entry. */
+	struct drgn_seekable_zstd_cached_frame *cached = NULL;
+	for (size_t i = 0; i < array_size(zstd->cache); i++) {
+		struct drgn_seekable_zstd_cached_frame *entry = &zstd->cache[i];
+		if (entry->buf && entry->frame == frame) {
+			entry->last_used = ++zstd->clock;
+			*ret = entry->buf;
+			return NULL;
+		}
+		if (!cached ||
+		    (cached->buf &&
+		     (!entry->buf || entry->last_used < cached->last_used)))
+			cached = entry;
+	}
+
+	size_t compressed_size = (zstd->compressed_offsets[frame + 1] -
+				  zstd->compressed_offsets[frame]);
+	size_t decompressed_size = (zstd->decompressed_offsets[frame + 1] -
+				    zstd->decompressed_offsets[frame]);
+	if (compressed_size > zstd->compressed_buf_capacity) {
+		void *tmp = realloc(zstd->compressed_buf, compressed_size);
+		if (!tmp)
+			return &drgn_enomem;
+		zstd->compressed_buf = tmp;
+		zstd->compressed_buf_capacity = compressed_size;
+	}
+	err = pread_all(NULL, zstd->fd, zstd->compressed_buf, compressed_size,
+			zstd->compressed_offsets[frame]);
+	if (err)
+		return err;
+
+	free(cached->buf);
+	cached->buf = malloc(decompressed_size);
+	if (!cached->buf)
+		return &drgn_enomem;
+	size_t zret = ZSTD_decompressDCtx(zstd->dctx, cached->buf,
+					  decompressed_size,
+					  zstd->compressed_buf,
+					  compressed_size);
+	if (ZSTD_isError(zret) || zret != decompressed_size) {
+		free(cached->buf);
+		cached->buf = NULL;
+		return drgn_error_format(DRGN_ERROR_OTHER,
+					 "could not decompress zstd frame %zu: %s",
+					 frame,
+					 ZSTD_isError(zret) ?
+					 ZSTD_getErrorName(zret) :
+					 "size does not match seek table");
+	}
+	cached->frame = frame;
+	cached->last_used = ++zstd->clock;
+	*ret = cached->buf;
+	return NULL;
+}
+
+struct drgn_error *drgn_seekable_zstd_pread(struct drgn_seekable_zstd *zstd,
+					    void *buf, size_t count,
+					    uint64_t offset, size_t *ret)
+{
+	struct drgn_error *err = NULL;
+
+	uint64_t size = drgn_seekable_zstd_size(zstd);
+	if (offset >= size) {
+		*ret = 0;
+		return NULL;
+	}
+	count = min((uint64_t)count, size - offset);
+
+	char *p = buf;
+	size_t remaining = count;
+	pthread_mutex_lock(&zstd->lock);
+	size_t frame = drgn_seekable_zstd_find_frame(zstd, offset);
+	while (remaining) {
+		/* Skip frames with no decompressed data. */
+		if (zstd->decompressed_offsets[frame + 1] <= offset) {
+			frame++;
+			continue;
+		}
+		const char *frame_buf;
+		err = drgn_seekable_zstd_get_frame(zstd, frame, &frame_buf);
+		if (err)
+			break;
+		size_t frame_offset = offset - zstd->decompressed_offsets[frame];
+		size_t n = min((uint64_t)remaining,
+			       zstd->decompressed_offsets[frame + 1] - offset);
+		memcpy(p, frame_buf + frame_offset, n);
+		p += n;
+		offset += n;
+		remaining -= n;
+		frame++;
+	}
+	pthread_mutex_unlock(&zstd->lock);
+	*ret = count - remaining;
+	return err;
+}
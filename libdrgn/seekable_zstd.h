@@ -0,0 +1,106 @@
+// Copyright (c) Meta Platforms, Inc. and affiliates.
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/**
+ * @file
+ *
+ * Random access to files compressed in the zstd seekable format.
+ *
+ * See @ref SeekableZstd.
+ */
+
+#ifndef DRGN_SEEKABLE_ZSTD_H
+#define DRGN_SEEKABLE_ZSTD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "drgn.h"
+
+/**
+ * @ingroup Internals
+ *
+ * @defgroup SeekableZstd Seekable zstd
+ *
+ * Random access to files compressed in the zstd seekable format.
+ *
+ * The zstd seekable format is a sequence of independently compressed zstd
+ * frames followed by a skippable frame containing a table of the compressed
+ * and decompressed size of every frame. This allows reading an arbitrary range
+ * of the decompressed file by only decompressing the frames that cover it.
+ *
+ * @{
+ */
+
+/**
+ * Number of decompressed frames kept in the cache of a @ref
+ * drgn_seekable_zstd.
+ */
+#define DRGN_SEEKABLE_ZSTD_CACHE_SIZE 8
+
+struct drgn_seekable_zstd;
+
+#ifdef WITH_LIBZSTD
+/**
+ * Open a file compressed in the zstd seekable format.
+ *
+ * @param[in] path Path of file, used for error messages.
+ * @param[in] fd File descriptor. This is borrowed and must remain open until
+ * the returned object is destroyed.
+ * @param[out] ret Returned object.
+ */
+struct drgn_error *drgn_seekable_zstd_create(const char *path, int fd,
+					     struct drgn_seekable_zstd **ret);
+
+/** Free a @ref drgn_seekable_zstd. */
+void drgn_seekable_zstd_destroy(struct drgn_seekable_zstd *zstd);
+
+/** Get the decompressed size of a @ref drgn_seekable_zstd. */
+uint64_t drgn_seekable_zstd_size(struct drgn_seekable_zstd *zstd);
+
+/**
+ * Read from the decompressed contents of a @ref drgn_seekable_zstd.
+ *
+ * Only the frames covering the requested range are decompressed. Recently used
+ * frames are cached. This is thread-safe.
+ *
+ * @param[out] buf Buffer to read into.
+ * @param[in] count Number of bytes to read.
+ * @param[in] offset Decompressed offset to read from.
+ * @param[out] ret Number of bytes read. This is less than @p count only if the
+ * end of the file was reached.
+ */
+struct drgn_error *drgn_seekable_zstd_pread(struct drgn_seekable_zstd *zstd,
+					    void *buf, size_t count,
+					    uint64_t offset, size_t *ret);
+#else
+static inline struct drgn_error *
+drgn_seekable_zstd_create(const char *path, int fd,
+			  struct drgn_seekable_zstd **ret)
+{
+	return drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+				 "drgn was built without libzstd support");
+}
+
+static inline void drgn_seekable_zstd_destroy(struct drgn_seekable_zstd *zstd)
+{
+}
+
+static inline uint64_t drgn_seekable_zstd_size(struct drgn_seekable_zstd *zstd)
+{
+	return 0;
+}
+
+static inline struct drgn_error *
+drgn_seekable_zstd_pread(struct drgn_seekable_zstd *zstd, void *buf,
+			 size_t count, uint64_t offset, size_t *ret)
+{
+	*ret = 0;
+	return NULL;
+}
+#endif
+
+/** @} */
+
+#endif /* DRGN_SEEKABLE_ZSTD_H */
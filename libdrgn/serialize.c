@@ -172,3 +172,43 @@ uint64_t deserialize_bits(const void *buf, uint64_t bit_offset,
 	}
 	return truncate_unsigned(ret, bit_size);
 }
+
+static uint64_t deserialize_u8(const void *buf)
+{
+	return *(const uint8_t *)buf;
+}
+
+#define DEFINE_DESERIALIZE(bits)			\
+static uint64_t deserialize_le##bits(const void *buf)	\
+{							\
+	uint##bits##_t value;				\
+	memcpy(&value, buf, sizeof(value));		\
+	return le##bits##toh(value);			\
+}							\
+							\
+static uint64_t deserialize_be##bits(const void *buf)	\
+{							\
+	uint##bits##_t value;				\
+	memcpy(&value, buf, sizeof(value));		\
+	return be##bits##toh(value);			\
+}
+DEFINE_DESERIALIZE(16)
+DEFINE_DESERIALIZE(32)
+DEFINE_DESERIALIZE(64)
+#undef DEFINE_DESERIALIZE
+
+deserialize_fn *deserialize_bits_fn(uint8_t bit_size, bool little_endian)
+{
+	switch (bit_size) {
+	case 8:
+		return deserialize_u8;
+	case 16:
+		return little_endian ? deserialize_le16 : deserialize_be16;
+	case 32:
+		return little_endian ? deserialize_le32 : deserialize_be32;
+	case 64:
+		return little_endian ? deserialize_le64 : deserialize_be64;
+	default:
+		return NULL;
+	}
+}
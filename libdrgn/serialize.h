@@ -149,6 +149,26 @@ void serialize_bits(void *buf, uint64_t bit_offset, uint64_t uvalue,
 uint64_t deserialize_bits(const void *buf, uint64_t bit_offset,
 			  uint8_t bit_size, bool little_endian);
 
+/**
+ * Function that deserializes a byte-aligned value with a fixed size and byte
+ * order. See @ref deserialize_bits_fn().
+ */
+typedef uint64_t deserialize_fn(const void *buf);
+
+/**
+ * Get a specialized function equivalent to <tt>deserialize_bits(buf, 0,
+ * bit_size, little_endian)</tt>.
+ *
+ * This is only available for 8-, 16-, 32-, and 64-bit values, which are by far
+ * the most common and are just a load and possibly a byte swap. Callers
+ * deserializing many values of the same type should get this once and call it
+ * for each value.
+ *
+ * @return Function, or @c NULL if there is no specialized function for @p
+ * bit_size.
+ */
+deserialize_fn *deserialize_bits_fn(uint8_t bit_size, bool little_endian);
+
 /** @} */
 
 #endif /* DRGN_SERIALIZE_H */
@@ -9,6 +9,10 @@
 #include <inttypes.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/procfs.h>
+#include <sys/ptrace.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
 
 #include "cfi.h"
 #include "debug_info.h"
@@ -16,6 +20,7 @@
 #include "dwarf_info.h"
 #include "error.h"
 #include "helpers.h"
+#include "memory_reader.h"
 #include "minmax.h"
 #include "nstring.h"
 #include "platform.h"
@@ -27,6 +32,7 @@
 #include "symbol.h"
 #include "type.h"
 #include "util.h"
+#include "vector.h"
 
 static struct drgn_error *
 drgn_stack_trace_append_frame(struct drgn_stack_trace **trace, size_t *capacity,
@@ -60,6 +66,7 @@ drgn_stack_trace_append_frame(struct drgn_stack_trace **trace, size_t *capacity,
 	frame->scopes = scopes;
 	frame->num_scopes = num_scopes;
 	frame->function_scope = function_scope;
+	frame->scopes_pending = false;
 	return NULL;
 }
 
@@ -223,9 +230,88 @@ enomem:
 	return &drgn_enomem;
 }
 
+/*
+ * Look up the scopes of a frame in a raw stack trace. The frame is the
+ * innermost function containing the program counter, like the first frame that
+ * drgn_stack_trace_add_frames() would add. Errors are ignored, leaving the
+ * frame without scopes, since the callers can't report them.
+ */
+static void drgn_stack_frame_find_pending_scopes(struct drgn_stack_frame *frame)
+{
+	struct drgn_error *err;
+	struct drgn_register_state *regs = frame->regs;
+
+	frame->scopes_pending = false;
+
+	uint64_t pc = regs->_pc - !regs->interrupted;
+	uint64_t bias;
+	Dwarf_Die *scopes;
+	size_t num_scopes;
+	err = drgn_debug_info_module_find_dwarf_scopes(regs->module, pc, &bias,
+						       &scopes, &num_scopes);
+	if (err) {
+		drgn_error_destroy(err);
+		return;
+	}
+	pc -= bias;
+
+	/* See drgn_stack_trace_add_frames(). */
+	size_t frame_end = num_scopes;
+	for (size_t i = num_scopes; i-- > 1;) {
+		if (i < num_scopes - 1) {
+			int r = dwarf_haspc(&scopes[i], pc);
+			if (r < 0)
+				break;
+			if (r == 0) {
+				frame_end = i;
+				continue;
+			}
+		}
+		switch (dwarf_tag(&scopes[i])) {
+		case DW_TAG_subprogram:
+			frame->scopes = scopes;
+			frame->num_scopes = frame_end;
+			frame->function_scope = i;
+			return;
+		case DW_TAG_inlined_subroutine:
+			memmove(scopes, &scopes[i],
+				(frame_end - i) * sizeof(scopes[0]));
+			frame->scopes = scopes;
+			frame->num_scopes = frame_end - i;
+			frame->function_scope = 0;
+			return;
+		default:
+			break;
+		}
+	}
+	/* If we at least found the unit DIE, keep it. */
+	if (num_scopes > 0) {
+		frame->scopes = scopes;
+		frame->num_scopes = 1;
+		frame->function_scope = 1;
+	} else {
+		free(scopes);
+	}
+}
+
+/* Get a frame, looking up its scopes first if necessary. */
+static struct drgn_stack_frame *
+drgn_stack_trace_frame(struct drgn_stack_trace *trace, size_t frame_i)
+{
+	struct drgn_stack_frame *frame = &trace->frames[frame_i];
+	if (trace->raw) {
+		drgn_program_lock(trace->prog);
+		if (frame->scopes_pending)
+			drgn_stack_frame_find_pending_scopes(frame);
+		drgn_program_unlock(trace->prog);
+	}
+	return frame;
+}
+
 LIBDRGN_PUBLIC const char *drgn_stack_frame_name(struct drgn_stack_trace *trace,
 						 size_t frame)
 {
+	drgn_stack_trace_frame(trace, frame);
 	Dwarf_Die *scopes = trace->frames[frame].scopes;
 	size_t num_scopes = trace->frames[frame].num_scopes;
 	size_t function_scope = trace->frames[frame].function_scope;
@@ -237,6 +323,7 @@ LIBDRGN_PUBLIC const char *drgn_stack_frame_name(struct drgn_stack_trace *trace,
 LIBDRGN_PUBLIC bool drgn_stack_frame_is_inline(struct drgn_stack_trace *trace,
 					       size_t frame)
 {
+	drgn_stack_trace_frame(trace, frame);
 	Dwarf_Die *scopes = trace->frames[frame].scopes;
 	size_t num_scopes = trace->frames[frame].num_scopes;
 	size_t function_scope = trace->frames[frame].function_scope;
@@ -249,6 +336,7 @@ LIBDRGN_PUBLIC const char *
 drgn_stack_frame_source(struct drgn_stack_trace *trace, size_t frame,
 			int *line_ret, int *column_ret)
 {
+	drgn_stack_trace_frame(trace, frame);
 	if (frame > 0 &&
 	    trace->frames[frame].regs == trace->frames[frame - 1].regs) {
 		/*
@@ -372,22 +460,25 @@ drgn_stack_frame_symbol(struct drgn_stack_trace *trace, size_t frame,
 	return NULL;
 }
 
-LIBDRGN_PUBLIC struct drgn_error *
-drgn_stack_frame_find_object(struct drgn_stack_trace *trace, size_t frame_i,
-			     const char *name, struct drgn_object *ret)
+/* The caller must hold the program lock. */
+static struct drgn_error *
+drgn_stack_frame_find_object_die(struct drgn_stack_trace *trace,
+				 size_t frame_i, const char *name,
+				 Dwarf_Die *die_ret, Dwarf_Die *type_die_ret)
 {
 	struct drgn_error *err;
-	struct drgn_stack_frame *frame = &trace->frames[frame_i];
+	struct drgn_stack_frame *frame = drgn_stack_trace_frame(trace, frame_i);
 
-	if (frame->function_scope >= frame->num_scopes)
-		goto not_found;
+	if (frame->function_scope >= frame->num_scopes) {
+		die_ret->addr = NULL;
+		return NULL;
+	}
 
-	Dwarf_Die die, type_die;
 	err = drgn_find_in_dwarf_scopes(frame->scopes, frame->num_scopes, name,
-					&die, &type_die);
+					die_ret, type_die_ret);
 	if (err)
 		return err;
-	if (!die.addr && frame->function_scope == 0) {
+	if (!die_ret->addr && frame->function_scope == 0) {
 		/*
 		 * Scope 0 must be a DW_TAG_inlined_subroutine, and we didn't
 		 * find the name in the concrete inlined instance tree. We need
@@ -399,7 +490,7 @@ drgn_stack_frame_find_object(struct drgn_stack_trace *trace, size_t frame_i,
 		Dwarf_Attribute attr_mem, *attr;
 		if (!(attr = dwarf_attr(frame->scopes, DW_AT_abstract_origin,
 					&attr_mem)))
-			goto not_found;
+			return NULL;
 		Dwarf_Die abstract_origin;
 		if (!dwarf_formref_die(attr, &abstract_origin))
 			return drgn_error_libdw();
@@ -427,13 +518,39 @@ drgn_stack_frame_find_object(struct drgn_stack_trace *trace, size_t frame_i,
 		frame->function_scope = num_ancestors;
 
 		/* Look for the name in the new scopes. */
-		err = drgn_find_in_dwarf_scopes(frame->scopes, num_ancestors,
-						name, &die, &type_die);
-		if (err)
-			return err;
+		return drgn_find_in_dwarf_scopes(frame->scopes, num_ancestors,
+						 name, die_ret, type_die_ret);
 	}
+	return NULL;
+}
+
+static struct drgn_error *
+drgn_stack_frame_object_from_die(struct drgn_stack_trace *trace,
+				 size_t frame_i, Dwarf_Die *die,
+				 Dwarf_Die *type_die, struct drgn_object *ret)
+{
+	struct drgn_stack_frame *frame = &trace->frames[frame_i];
+	Dwarf_Die function_die = frame->scopes[frame->function_scope];
+	return drgn_object_from_dwarf(trace->prog->dbinfo, frame->regs->module,
+				      die,
+				      dwarf_tag(die) == DW_TAG_enumerator ?
+				      type_die : NULL,
+				      &function_die, frame->regs, ret);
+}
+
+static struct drgn_error *
+drgn_stack_frame_find_object_locked(struct drgn_stack_trace *trace,
+				    size_t frame_i, const char *name,
+				    struct drgn_object *ret)
+{
+	struct drgn_error *err;
+
+	Dwarf_Die die, type_die;
+	err = drgn_stack_frame_find_object_die(trace, frame_i, name, &die,
+					       &type_die);
+	if (err)
+		return err;
 	if (!die.addr) {
-not_found:;
 		const char *frame_name = drgn_stack_frame_name(trace, frame_i);
 		if (frame_name) {
 			return drgn_error_format(DRGN_ERROR_LOOKUP,
@@ -444,13 +561,19 @@ not_found:;
 						 "could not find '%s'", name);
 		}
 	}
+	return drgn_stack_frame_object_from_die(trace, frame_i, &die,
+						&type_die, ret);
+}
 
-	Dwarf_Die function_die = frame->scopes[frame->function_scope];
-	return drgn_object_from_dwarf(trace->prog->dbinfo, frame->regs->module,
-				      &die,
-				      dwarf_tag(&die) == DW_TAG_enumerator ?
-				      &type_die : NULL,
-				      &function_die, frame->regs, ret);
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_stack_frame_find_object(struct drgn_stack_trace *trace, size_t frame_i,
+			     const char *name, struct drgn_object *ret)
+{
+	drgn_program_lock(trace->prog);
+	struct drgn_error *err =
+		drgn_stack_frame_find_object_locked(trace, frame_i, name, ret);
+	drgn_program_unlock(trace->prog);
+	return err;
 }
 
 LIBDRGN_PUBLIC bool drgn_stack_frame_register(struct drgn_stack_trace *trace,
@@ -868,10 +991,58 @@ out:
 	return err;
 }
 
+/*
+ * Stack memory of a stopped thread in a live process, read ahead in one system
+ * call instead of one for each saved register.
+ */
+struct drgn_stack_read_ahead {
+	pid_t pid;
+	uint64_t address;
+	size_t size;
+	char buf[16384];
+};
+
+static struct drgn_error *
+drgn_stack_read_memory(struct drgn_program *prog,
+		       struct drgn_stack_read_ahead *read_ahead, void *buf,
+		       uint64_t address, size_t size)
+{
+	struct drgn_error *err;
+	if (read_ahead && size <= sizeof(read_ahead->buf)) {
+		uint64_t offset = address - read_ahead->address;
+		if (address < read_ahead->address ||
+		    offset > read_ahead->size ||
+		    size > read_ahead->size - offset) {
+			/*
+			 * Callers' frames are at higher addresses, so read
+			 * forward from here.
+			 */
+			read_ahead->address = address;
+			offset = 0;
+			err = drgn_read_process_memory(read_ahead->pid,
+						       read_ahead->buf,
+						       address,
+						       sizeof(read_ahead->buf),
+						       &read_ahead->size);
+			if (err == &drgn_not_found)
+				read_ahead->size = 0;
+			else if (err)
+				return err;
+		}
+		if (size <= read_ahead->size - offset) {
+			memcpy(buf, read_ahead->buf + offset, size);
+			return NULL;
+		}
+	}
+	/* Let the normal path report the fault. */
+	return drgn_program_read_memory(prog, buf, address, size, false);
+}
+
 static struct drgn_error *
 drgn_unwind_one_register(struct drgn_program *prog,
 			 const struct drgn_cfi_rule *rule,
-			 const struct drgn_register_state *regs, void *buf,
+			 const struct drgn_register_state *regs,
+			 struct drgn_stack_read_ahead *read_ahead, void *buf,
 			 size_t size)
 {
 	struct drgn_error *err;
@@ -883,9 +1054,8 @@ drgn_unwind_one_register(struct drgn_program *prog,
 		struct optional_uint64 cfa = drgn_register_state_get_cfa(regs);
 		if (!cfa.has_value)
 			return &drgn_not_found;
-		err = drgn_program_read_memory(prog, buf,
-					       cfa.value + rule->offset, size,
-					       false);
+		err = drgn_stack_read_memory(prog, read_ahead, buf,
+					     cfa.value + rule->offset, size);
 		break;
 	}
 	case DRGN_CFI_RULE_CFA_PLUS_OFFSET: {
@@ -910,7 +1080,8 @@ drgn_unwind_one_register(struct drgn_program *prog,
 		if (rule->kind == DRGN_CFI_RULE_AT_REGISTER_PLUS_OFFSET)
 			address += rule->offset;
 		address &= drgn_platform_address_mask(&prog->platform);
-		err = drgn_program_read_memory(prog, buf, address, size, false);
+		err = drgn_stack_read_memory(prog, read_ahead, buf, address,
+					     size);
 		if (!err && rule->kind == DRGN_CFI_RULE_AT_REGISTER_ADD_OFFSET) {
 			drgn_add_to_register(buf, size, buf, size, rule->offset,
 					     little_endian);
@@ -928,8 +1099,11 @@ drgn_unwind_one_register(struct drgn_program *prog,
 	}
 	case DRGN_CFI_RULE_AT_DWARF_EXPRESSION:
 	case DRGN_CFI_RULE_DWARF_EXPRESSION:
+		/* Expressions may refer to the module's debugging information. */
+		drgn_program_lock(prog);
 		err = drgn_eval_cfi_dwarf_expression(prog, rule, regs, buf,
 						     size);
+		drgn_program_unlock(prog);
 		break;
 	)
 	/*
@@ -943,16 +1117,18 @@ drgn_unwind_one_register(struct drgn_program *prog,
 	return err;
 }
 
-static struct drgn_error *drgn_unwind_cfa(struct drgn_program *prog,
-					  const struct drgn_cfi_row *row,
-					  struct drgn_register_state *regs)
+static struct drgn_error *
+drgn_unwind_cfa(struct drgn_program *prog, const struct drgn_cfi_row *row,
+		struct drgn_register_state *regs,
+		struct drgn_stack_read_ahead *read_ahead)
 {
 	struct drgn_error *err;
 	struct drgn_cfi_rule rule;
 	drgn_cfi_row_get_cfa(row, &rule);
 	uint8_t address_size = drgn_platform_address_size(&prog->platform);
 	char buf[8];
-	err = drgn_unwind_one_register(prog, &rule, regs, buf, address_size);
+	err = drgn_unwind_one_register(prog, &rule, regs, read_ahead, buf,
+				       address_size);
 	if (!err) {
 		uint64_t cfa;
 		copy_lsbytes(&cfa, sizeof(cfa), HOST_LITTLE_ENDIAN, buf,
@@ -965,9 +1141,145 @@ static struct drgn_error *drgn_unwind_cfa(struct drgn_program *prog,
 	return err;
 }
 
+DEFINE_HASH_MAP_FUNCTIONS(drgn_pc_cache, int_key_hash_pair, scalar_key_eq)
+
+void drgn_program_init_pc_cache(struct drgn_program *prog)
+{
+	drgn_pc_cache_init(&prog->pc_cache);
+}
+
+void drgn_program_deinit_pc_cache(struct drgn_program *prog)
+{
+	for (struct drgn_pc_cache_iterator it =
+	     drgn_pc_cache_first(&prog->pc_cache);
+	     it.entry; it = drgn_pc_cache_next(it)) {
+		if (it.entry->value.row)
+			drgn_cfi_row_destroy(it.entry->value.row);
+	}
+	drgn_pc_cache_deinit(&prog->pc_cache);
+}
+
+void drgn_program_clear_pc_cache(struct drgn_program *prog)
+{
+	if (drgn_pc_cache_empty(&prog->pc_cache))
+		return;
+	drgn_program_deinit_pc_cache(prog);
+	drgn_program_init_pc_cache(prog);
+}
+
+static struct drgn_debug_info_module *
+drgn_program_find_pc_module_uncached(struct drgn_program *prog, uint64_t pc)
+{
+	Dwfl_Module *dwfl_module = dwfl_addrmodule(prog->dbinfo->dwfl, pc);
+	if (!dwfl_module)
+		return NULL;
+	void **userdatap;
+	dwfl_module_info(dwfl_module, &userdatap, NULL, NULL, NULL, NULL, NULL,
+			 NULL);
+	struct drgn_debug_info_module *module = *userdatap;
+	/* Unloaded modules stay in libdwfl but shouldn't be used. */
+	if (module->state != DRGN_DEBUG_INFO_MODULE_INDEXED)
+		return NULL;
+	static const enum drgn_platform_flags check_flags =
+		(DRGN_PLATFORM_IS_64_BIT | DRGN_PLATFORM_IS_LITTLE_ENDIAN);
+	if (module->platform.arch != prog->platform.arch ||
+	    (module->platform.flags & check_flags) !=
+	    (prog->platform.flags & check_flags))
+		return NULL;
+	return module;
+}
+
+/*
+ * Get the cache entry for a program counter, adding it if it doesn't exist.
+ * The entry is only valid until the cache is modified, i.e., until the next
+ * call. The caller must hold the program lock.
+ */
+static struct drgn_cached_pc *
+drgn_program_cache_pc_locked(struct drgn_program *prog, uint64_t pc)
+{
+	struct hash_pair hp = drgn_pc_cache_hash(&pc);
+	struct drgn_pc_cache_iterator it =
+		drgn_pc_cache_search_hashed(&prog->pc_cache, &pc, hp);
+	if (it.entry)
+		return &it.entry->value;
+	struct drgn_pc_cache_entry entry = {
+		.key = pc,
+		.value = {
+			.module = drgn_program_find_pc_module_uncached(prog, pc),
+		},
+	};
+	if (drgn_pc_cache_insert_searched(&prog->pc_cache, &entry, hp, &it) < 0)
+		return NULL;
+	return &it.entry->value;
+}
+
+struct drgn_debug_info_module *
+drgn_program_find_pc_module_locked(struct drgn_program *prog, uint64_t pc)
+{
+	struct drgn_cached_pc *cached = drgn_program_cache_pc_locked(prog, pc);
+	if (!cached) {
+		/* Not being able to cache the module isn't fatal. */
+		return drgn_program_find_pc_module_uncached(prog, pc);
+	}
+	return cached->module;
+}
+
+/*
+ * Find the CFI for the frame described by regs, using and filling in the
+ * program's cache. This has the same interface as
+ * drgn_debug_info_module_find_cfi(). The caller must hold the program lock.
+ */
+static struct drgn_error *
+drgn_find_cfi_cached_locked(struct drgn_program *prog,
+			    struct drgn_register_state *regs,
+			    struct drgn_cfi_row **row_ret,
+			    bool *interrupted_ret,
+			    drgn_register_number *ret_addr_regno_ret)
+{
+	struct drgn_error *err;
+
+	/* If we found the module, then we must have the PC. */
+	uint64_t pc = regs->_pc - !regs->interrupted;
+	struct drgn_cached_pc *cached = drgn_program_cache_pc_locked(prog, pc);
+	if (!cached)
+		return &drgn_enomem;
+	if (cached->cfi_cached) {
+		prog->stats.cfi_cache_hits++;
+	} else {
+		struct drgn_cfi_row *row = drgn_empty_cfi_row;
+		uint64_t start_time = monotonic_ns();
+		err = drgn_debug_info_module_find_cfi(prog, regs->module, pc,
+						      &row,
+						      &cached->interrupted,
+						      &cached->ret_addr_regno);
+		prog->stats.cfi_lookup_ns += monotonic_ns() - start_time;
+		if (err == &drgn_not_found) {
+			drgn_cfi_row_destroy(row);
+			row = NULL;
+		} else if (err) {
+			drgn_cfi_row_destroy(row);
+			return err;
+		}
+		cached->row = row;
+		cached->cfi_cached = true;
+	}
+	if (!cached->row)
+		return &drgn_not_found;
+	/*
+	 * Copy the row so that it stays valid if the cache is cleared after we
+	 * release the lock.
+	 */
+	if (!drgn_cfi_row_copy(row_ret, cached->row))
+		return &drgn_enomem;
+	*interrupted_ret = cached->interrupted;
+	*ret_addr_regno_ret = cached->ret_addr_regno;
+	return NULL;
+}
+
 static struct drgn_error *
 drgn_unwind_with_cfi(struct drgn_program *prog, struct drgn_cfi_row **row,
 		     struct drgn_register_state *regs,
+		     struct drgn_stack_read_ahead *read_ahead,
 		     struct drgn_register_state **ret)
 {
 	struct drgn_error *err;
@@ -977,15 +1289,14 @@ drgn_unwind_with_cfi(struct drgn_program *prog, struct drgn_cfi_row **row,
 
 	bool interrupted;
 	drgn_register_number ret_addr_regno;
-	/* If we found the module, then we must have the PC. */
-	err = drgn_debug_info_module_find_cfi(prog, regs->module,
-					      regs->_pc - !regs->interrupted,
-					      row, &interrupted,
-					      &ret_addr_regno);
+	drgn_program_lock(prog);
+	err = drgn_find_cfi_cached_locked(prog, regs, row, &interrupted,
+					  &ret_addr_regno);
+	drgn_program_unlock(prog);
 	if (err)
 		return err;
 
-	err = drgn_unwind_cfa(prog, *row, regs);
+	err = drgn_unwind_cfa(prog, *row, regs, read_ahead);
 	if (err)
 		return err;
 
@@ -1006,7 +1317,7 @@ drgn_unwind_with_cfi(struct drgn_program *prog, struct drgn_cfi_row **row,
 		struct drgn_cfi_rule rule;
 		drgn_cfi_row_get_register(*row, regno, &rule);
 		layout = &prog->platform.arch->register_layout[regno];
-		err = drgn_unwind_one_register(prog, &rule, regs,
+		err = drgn_unwind_one_register(prog, &rule, regs, read_ahead,
 					       &unwound->buf[layout->offset],
 					       layout->size);
 		if (!err) {
@@ -1024,19 +1335,87 @@ drgn_unwind_with_cfi(struct drgn_program *prog, struct drgn_cfi_row **row,
 	}
 	if (drgn_register_state_has_register(unwound, ret_addr_regno)) {
 		layout = &prog->platform.arch->register_layout[ret_addr_regno];
+		drgn_program_lock(prog);
 		drgn_register_state_set_pc_from_register_impl(prog, unwound,
 							      ret_addr_regno,
 							      layout->offset,
 							      layout->size);
+		drgn_program_unlock(prog);
 	}
 	*ret = unwound;
 	return NULL;
 }
 
+/*
+ * Stop a thread in a live process with PTRACE_SEIZE and PTRACE_INTERRUPT so
+ * that its registers can be read and its stack doesn't change while it is
+ * being unwound. It must be resumed with drgn_resume_live_thread().
+ */
+static struct drgn_error *drgn_stop_live_thread(pid_t tid,
+						struct elf_prstatus *prstatus,
+						int *sig_ret)
+{
+	struct drgn_error *err;
+
+	if (ptrace(PTRACE_SEIZE, tid, NULL, NULL) == -1)
+		return drgn_error_create_os("PTRACE_SEIZE", errno, NULL);
+	if (ptrace(PTRACE_INTERRUPT, tid, NULL, NULL) == -1) {
+		err = drgn_error_create_os("PTRACE_INTERRUPT", errno, NULL);
+		goto err;
+	}
+	int status;
+	while (waitpid(tid, &status, __WALL) == -1) {
+		if (errno != EINTR) {
+			err = drgn_error_create_os("waitpid", errno, NULL);
+			goto err;
+		}
+	}
+	if (!WIFSTOPPED(status)) {
+		/* The thread exited, so it's no longer traced. */
+		return drgn_error_create(DRGN_ERROR_LOOKUP, "thread exited");
+	}
+	/*
+	 * If the thread stopped for a signal rather than our interrupt, the
+	 * signal must be redelivered when we detach.
+	 */
+	*sig_ret = status >> 16 == PTRACE_EVENT_STOP ? 0 : WSTOPSIG(status);
+
+	memset(prstatus, 0, sizeof(*prstatus));
+	prstatus->pr_pid = tid;
+	struct iovec iov = {
+		.iov_base = &prstatus->pr_reg,
+		.iov_len = sizeof(prstatus->pr_reg),
+	};
+	if (ptrace(PTRACE_GETREGSET, tid, (void *)NT_PRSTATUS, &iov) == -1) {
+		err = drgn_error_create_os("PTRACE_GETREGSET", errno, NULL);
+		goto err_resume;
+	}
+	return NULL;
+
+err_resume:
+	ptrace(PTRACE_DETACH, tid, NULL, (void *)(uintptr_t)*sig_ret);
+	return err;
+
+err:
+	ptrace(PTRACE_DETACH, tid, NULL, NULL);
+	return err;
+}
+
+static void drgn_resume_live_thread(pid_t tid, int sig)
+{
+	ptrace(PTRACE_DETACH, tid, NULL, (void *)(uintptr_t)sig);
+}
+
+/*
+ * Unwind a stack. This takes the program lock only around steps that use
+ * shared state (the initial registers, debugging information, and the PC
+ * cache), so the memory reads for multiple stacks can proceed concurrently.
+ */
 static struct drgn_error *drgn_get_stack_trace(struct drgn_program *prog,
 					       uint32_t tid,
 					       const struct drgn_object *obj,
 					       struct nstring *prstatus,
+					       bool raw,
 					       struct drgn_stack_trace **ret)
 {
 	struct drgn_error *err;
@@ -1045,12 +1424,6 @@ static struct drgn_error *drgn_get_stack_trace(struct drgn_program *prog,
 		return drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
 					 "cannot unwind stack without platform");
 	}
-	if ((prog->flags & (DRGN_PROGRAM_IS_LINUX_KERNEL |
-			    DRGN_PROGRAM_IS_LIVE)) == DRGN_PROGRAM_IS_LIVE) {
-		return drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
-					 "stack unwinding is not yet supported for live processes");
-	}
-
 	size_t trace_capacity = 1;
 	struct drgn_stack_trace *trace =
 		malloc(offsetof(struct drgn_stack_trace,
@@ -1058,26 +1431,75 @@ static struct drgn_error *drgn_get_stack_trace(struct drgn_program *prog,
 	if (!trace)
 		return &drgn_enomem;
 	trace->prog = prog;
+	trace->raw = raw;
 	trace->num_frames = 0;
 
 	struct drgn_cfi_row *row = drgn_empty_cfi_row;
 
+	/*
+	 * For a thread in a live process, stop the thread to get its registers
+	 * and keep it stopped until we're done reading its stack.
+	 */
+	bool stopped = false;
+	int stop_sig;
+	struct elf_prstatus live_prstatus;
+	struct nstring live_prstatus_str;
+	struct drgn_stack_read_ahead *read_ahead = NULL;
+	if ((prog->flags & (DRGN_PROGRAM_IS_LINUX_KERNEL |
+			    DRGN_PROGRAM_IS_LIVE)) == DRGN_PROGRAM_IS_LIVE &&
+	    !obj) {
+		err = drgn_stop_live_thread(tid, &live_prstatus, &stop_sig);
+		if (err)
+			goto out;
+		stopped = true;
+		live_prstatus_str.str = (const char *)&live_prstatus;
+		live_prstatus_str.len = sizeof(live_prstatus);
+		prstatus = &live_prstatus_str;
+
+		/* This is only an optimization, so allocation may fail. */
+		read_ahead = malloc(sizeof(*read_ahead));
+		if (read_ahead) {
+			read_ahead->pid = tid;
+			read_ahead->size = 0;
+		}
+	}
+
 	struct drgn_register_state *regs;
+	drgn_program_lock(prog);
 	err = drgn_get_initial_registers(prog, tid, obj, prstatus, &regs);
+	drgn_program_unlock(prog);
 	if (err)
 		goto out;
 
 	/* Limit iterations so we don't get caught in a loop. */
 	for (int i = 0; i < 1024; i++) {
-		err = drgn_stack_trace_add_frames(&trace, &trace_capacity,
-						  regs);
-		if (err)
-			goto out;
+		if (raw) {
+			err = drgn_stack_trace_append_frame(&trace,
+							    &trace_capacity,
+							    regs, NULL, 0, 0);
+			if (err) {
+				drgn_register_state_destroy(regs);
+				goto out;
+			}
+			trace->frames[trace->num_frames - 1].scopes_pending =
+				regs->module != NULL;
+		} else {
+			drgn_program_lock(prog);
+			err = drgn_stack_trace_add_frames(&trace,
+							  &trace_capacity,
+							  regs);
+			drgn_program_unlock(prog);
+			if (err)
+				goto out;
+		}
 
-		err = drgn_unwind_with_cfi(prog, &row, regs, &regs);
+		err = drgn_unwind_with_cfi(prog, &row, regs, read_ahead,
+					   &regs);
 		if (err == &drgn_not_found) {
+			drgn_program_lock(prog);
 			err = prog->platform.arch->fallback_unwind(prog, regs,
 								   &regs);
+			drgn_program_unlock(prog);
 		}
 		if (err == &drgn_stop)
 			break;
@@ -1087,6 +1509,9 @@ static struct drgn_error *drgn_get_stack_trace(struct drgn_program *prog,
 
 	err = NULL;
 out:
+	if (stopped)
+		drgn_resume_live_thread(tid, stop_sig);
+	free(read_ahead);
 	drgn_cfi_row_destroy(row);
 	if (err) {
 		drgn_stack_trace_destroy(trace);
@@ -1101,7 +1526,7 @@ LIBDRGN_PUBLIC struct drgn_error *
 drgn_program_stack_trace(struct drgn_program *prog, uint32_t tid,
 			 struct drgn_stack_trace **ret)
 {
-	return drgn_get_stack_trace(prog, tid, NULL, NULL, ret);
+	return drgn_get_stack_trace(prog, tid, NULL, NULL, false, ret);
 }
 
 LIBDRGN_PUBLIC struct drgn_error *
@@ -1117,24 +1542,622 @@ drgn_object_stack_trace(const struct drgn_object *obj,
 		if (err)
 			return err;
 		return drgn_get_stack_trace(drgn_object_program(obj),
-					    value.uvalue, NULL, NULL, ret);
+					    value.uvalue, NULL, NULL, false,
+					    ret);
 	} else {
 		return drgn_get_stack_trace(drgn_object_program(obj), 0, obj,
-					    NULL, ret);
+					    NULL, false, ret);
 	}
 }
 
-LIBDRGN_PUBLIC struct drgn_error *
-drgn_thread_stack_trace(struct drgn_thread *thread,
-			struct drgn_stack_trace **ret)
+static struct drgn_error *
+drgn_get_thread_stack_trace(struct drgn_thread *thread, bool raw,
+			    struct drgn_stack_trace **ret)
 {
 	if (thread->prog->flags & DRGN_PROGRAM_IS_LINUX_KERNEL) {
 		struct nstring *prstatus =
 		        thread->prstatus.str ? &thread->prstatus : NULL;
 		return drgn_get_stack_trace(thread->prog, thread->tid,
-					    &thread->object, prstatus, ret);
+					    &thread->object, prstatus, raw,
+					    ret);
 	} else {
 		return drgn_get_stack_trace(thread->prog, thread->tid, NULL,
-					    &thread->prstatus, ret);
+					    &thread->prstatus, raw, ret);
+	}
+}
+
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_thread_stack_trace(struct drgn_thread *thread,
+			struct drgn_stack_trace **ret)
+{
+	return drgn_get_thread_stack_trace(thread, false, ret);
+}
+
+static struct drgn_error *
+drgn_get_thread_stack_traces(struct drgn_program *prog,
+			     struct drgn_thread * const *threads,
+			     size_t num_threads, bool raw,
+			     struct drgn_stack_trace **ret)
+{
+	struct drgn_error *err = NULL;
+	size_t err_index = SIZE_MAX;
+
+	for (size_t i = 0; i < num_threads; i++) {
+		if (threads[i]->prog != prog) {
+			return drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+						 "thread is from different program");
+		}
+		ret[i] = NULL;
+	}
+
+	#pragma omp parallel for schedule(dynamic) \
+		num_threads(drgn_program_num_parallel_threads(prog))
+	for (size_t i = 0; i < num_threads; i++) {
+		drgn_program_bind_parallel_thread(prog);
+		if (err)
+			continue;
+		struct drgn_error *thread_err =
+			drgn_get_thread_stack_trace(threads[i], raw, &ret[i]);
+		if (thread_err) {
+			/* Report the error for the first failing thread. */
+			#pragma omp critical(drgn_program_stack_traces_error)
+			if (i < err_index) {
+				drgn_error_destroy(err);
+				err = thread_err;
+				err_index = i;
+			} else {
+				drgn_error_destroy(thread_err);
+			}
+		}
+	}
+
+	if (err) {
+		for (size_t i = 0; i < num_threads; i++)
+			drgn_stack_trace_destroy(ret[i]);
+	}
+	return err;
+}
+
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_program_stack_traces(struct drgn_program *prog,
+			  struct drgn_thread * const *threads,
+			  size_t num_threads, struct drgn_stack_trace **ret)
+{
+	return drgn_get_thread_stack_traces(prog, threads, num_threads, false,
+					    ret);
+}
+
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_program_raw_stack_traces(struct drgn_program *prog,
+			      struct drgn_thread * const *threads,
+			      size_t num_threads, struct drgn_stack_trace **ret)
+{
+	return drgn_get_thread_stack_traces(prog, threads, num_threads, true,
+					    ret);
+}
+
+/* Stack trace keyed by the hash of its program counters. */
+struct drgn_stack_trace_group_key {
+	struct drgn_stack_trace *trace;
+	size_t hash;
+};
+
+static size_t drgn_stack_trace_pc_hash(struct drgn_stack_trace *trace)
+{
+	size_t hash = trace->num_frames;
+	for (size_t i = 0; i < trace->num_frames; i++) {
+		struct drgn_register_state *regs = trace->frames[i].regs;
+		struct optional_uint64 pc = drgn_register_state_get_pc(regs);
+		hash = hash_combine(hash, pc.has_value ? pc.value : 0);
+		hash = hash_combine(hash,
+				    (pc.has_value << 1) | regs->interrupted);
+	}
+	return hash;
+}
+
+static struct hash_pair
+drgn_stack_trace_group_key_hash_pair(const struct drgn_stack_trace_group_key *key)
+{
+	return hash_pair_from_avalanching_hash(key->hash);
+}
+
+static bool
+drgn_stack_trace_group_key_eq(const struct drgn_stack_trace_group_key *a,
+			      const struct drgn_stack_trace_group_key *b)
+{
+	if (a->hash != b->hash ||
+	    a->trace->num_frames != b->trace->num_frames)
+		return false;
+	for (size_t i = 0; i < a->trace->num_frames; i++) {
+		struct drgn_register_state *a_regs = a->trace->frames[i].regs;
+		struct drgn_register_state *b_regs = b->trace->frames[i].regs;
+		struct optional_uint64 a_pc = drgn_register_state_get_pc(a_regs);
+		struct optional_uint64 b_pc = drgn_register_state_get_pc(b_regs);
+		if (a_pc.has_value != b_pc.has_value ||
+		    (a_pc.has_value && a_pc.value != b_pc.value) ||
+		    a_regs->interrupted != b_regs->interrupted)
+			return false;
+	}
+	return true;
+}
+
+DEFINE_HASH_MAP(drgn_stack_trace_group_map, struct drgn_stack_trace_group_key,
+		size_t, drgn_stack_trace_group_key_hash_pair,
+		drgn_stack_trace_group_key_eq)
+
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_group_stack_traces(struct drgn_stack_trace * const *traces,
+			size_t num_traces, size_t *groups_ret,
+			size_t *num_groups_ret)
+{
+	struct drgn_error *err = NULL;
+	struct drgn_stack_trace_group_map map = HASH_TABLE_INIT;
+	if (!drgn_stack_trace_group_map_reserve(&map, num_traces)) {
+		err = &drgn_enomem;
+		goto out;
+	}
+	for (size_t i = 0; i < num_traces; i++) {
+		struct drgn_stack_trace_group_map_entry entry = {
+			.key = {
+				.trace = traces[i],
+				.hash = drgn_stack_trace_pc_hash(traces[i]),
+			},
+			.value = drgn_stack_trace_group_map_size(&map),
+		};
+		struct drgn_stack_trace_group_map_iterator it;
+		if (drgn_stack_trace_group_map_insert(&map, &entry, &it) < 0) {
+			err = &drgn_enomem;
+			goto out;
+		}
+		groups_ret[i] = it.entry->value;
+	}
+	*num_groups_ret = drgn_stack_trace_group_map_size(&map);
+out:
+	drgn_stack_trace_group_map_deinit(&map);
+	return err;
+}
+
+/* What a sampler needs to know about each thread to invalidate its memory. */
+struct drgn_stack_sampler_thread {
+	struct drgn_thread *thread;
+	uint64_t task_address;
+	uint64_t task_size;
+	/* Lowest address of the task's stack. */
+	uint64_t stack_address;
+};
+
+/* Distinct stack trace seen by a sampler and how many times it was seen. */
+struct drgn_stack_sample {
+	struct drgn_stack_trace *trace;
+	uint64_t count;
+};
+
+DEFINE_VECTOR(drgn_stack_sample_vector, struct drgn_stack_sample)
+
+struct drgn_stack_sampler {
+	struct drgn_program *prog;
+	struct drgn_stack_sampler_thread *threads;
+	size_t num_threads;
+	/* Traces of the current snapshot. */
+	struct drgn_stack_trace **traces;
+	/*
+	 * Size of a kernel stack, or 0 if it couldn't be determined, in which
+	 * case the entire memory cache is invalidated after each snapshot.
+	 */
+	uint64_t thread_size;
+	/* Maps a trace in samples to its index. */
+	struct drgn_stack_trace_group_map map;
+	struct drgn_stack_sample_vector samples;
+	uint64_t num_snapshots;
+	/* Whether the caches were enabled by the sampler and must be reset. */
+	bool enabled_memory_cache;
+	bool enabled_translation_cache;
+};
+
+static struct drgn_error *
+drgn_stack_sampler_init_thread(struct drgn_stack_sampler *sampler,
+			       struct drgn_stack_sampler_thread *sampler_thread)
+{
+	struct drgn_error *err;
+	struct drgn_program *prog = sampler->prog;
+	const struct drgn_object *task = &sampler_thread->thread->object;
+
+	struct drgn_object tmp;
+	drgn_object_init(&tmp, prog);
+	err = drgn_object_read_unsigned(task, &sampler_thread->task_address);
+	if (err)
+		goto out;
+	err = drgn_type_sizeof(drgn_type_type(task->type).type,
+			       &sampler_thread->task_size);
+	if (err)
+		goto out;
+	/* The stack of a task doesn't move, so it only needs to be read once. */
+	err = drgn_object_member_dereference(&tmp, task, "stack");
+	if (err)
+		goto out;
+	err = drgn_object_read_unsigned(&tmp, &sampler_thread->stack_address);
+out:
+	drgn_object_deinit(&tmp);
+	return err;
+}
+
+static void
+drgn_stack_sampler_find_thread_size(struct drgn_stack_sampler *sampler)
+{
+	struct drgn_error *err;
+	struct drgn_object tmp;
+	drgn_object_init(&tmp, sampler->prog);
+	/* init_stack is declared as an array of THREAD_SIZE bytes. */
+	err = drgn_program_find_object(sampler->prog, "init_stack", NULL,
+				       DRGN_FIND_OBJECT_VARIABLE, &tmp);
+	if (!err)
+		err = drgn_object_sizeof(&tmp, &sampler->thread_size);
+	if (err) {
+		drgn_error_destroy(err);
+		sampler->thread_size = 0;
+	}
+	drgn_object_deinit(&tmp);
+}
+
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_stack_sampler_create(struct drgn_program *prog,
+			  struct drgn_thread * const *threads,
+			  size_t num_threads,
+			  struct drgn_stack_sampler **ret)
+{
+	struct drgn_error *err;
+
+	for (size_t i = 0; i < num_threads; i++) {
+		if (threads[i]->prog != prog) {
+			return drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+						 "thread is from different program");
+		}
+	}
+
+	struct drgn_stack_sampler *sampler = calloc(1, sizeof(*sampler));
+	if (!sampler)
+		return &drgn_enomem;
+	sampler->prog = prog;
+	sampler->map = (struct drgn_stack_trace_group_map)HASH_TABLE_INIT;
+	drgn_stack_sample_vector_init(&sampler->samples);
+	sampler->threads = malloc_array(num_threads,
+					sizeof(sampler->threads[0]));
+	sampler->traces = malloc_array(num_threads,
+				       sizeof(sampler->traces[0]));
+	if ((!sampler->threads || !sampler->traces) && num_threads) {
+		err = &drgn_enomem;
+		goto err;
+	}
+	sampler->num_threads = num_threads;
+	for (size_t i = 0; i < num_threads; i++) {
+		sampler->threads[i].thread = threads[i];
+		sampler->traces[i] = NULL;
+	}
+
+	if ((prog->flags & (DRGN_PROGRAM_IS_LINUX_KERNEL |
+			    DRGN_PROGRAM_IS_LIVE)) ==
+	    (DRGN_PROGRAM_IS_LINUX_KERNEL | DRGN_PROGRAM_IS_LIVE)) {
+		for (size_t i = 0; i < num_threads; i++) {
+			err = drgn_stack_sampler_init_thread(sampler,
+							     &sampler->threads[i]);
+			if (err)
+				goto err;
+		}
+		drgn_stack_sampler_find_thread_size(sampler);
+
+		/*
+		 * Memory that isn't in a sampled stack or task_struct is never
+		 * invalidated, so cache it between snapshots.
+		 */
+		drgn_program_lock(prog);
+		if (!prog->reader.cache_size) {
+			drgn_memory_reader_set_cache_size(&prog->reader,
+							  DRGN_DEFAULT_MEMORY_CACHE_SIZE);
+			sampler->enabled_memory_cache = true;
+		}
+		if (!prog->tlb.enabled) {
+			prog->tlb.enabled = true;
+			sampler->enabled_translation_cache = true;
+		}
+		drgn_program_unlock(prog);
+	}
+	*ret = sampler;
+	return NULL;
+
+err:
+	drgn_stack_sampler_destroy(sampler);
+	return err;
+}
+
+LIBDRGN_PUBLIC void
+drgn_stack_sampler_destroy(struct drgn_stack_sampler *sampler)
+{
+	if (!sampler)
+		return;
+	struct drgn_program *prog = sampler->prog;
+	drgn_program_lock(prog);
+	if (sampler->enabled_memory_cache)
+		drgn_memory_reader_set_cache_size(&prog->reader, 0);
+	if (sampler->enabled_translation_cache)
+		drgn_program_set_translation_cache_enabled(prog, false);
+	drgn_program_unlock(prog);
+	for (size_t i = 0; i < sampler->samples.size; i++)
+		drgn_stack_trace_destroy(sampler->samples.data[i].trace);
+	drgn_stack_sample_vector_deinit(&sampler->samples);
+	drgn_stack_trace_group_map_deinit(&sampler->map);
+	free(sampler->traces);
+	free(sampler->threads);
+	free(sampler);
+}
+
+static void
+drgn_stack_sampler_invalidate_thread(struct drgn_stack_sampler *sampler,
+				     struct drgn_stack_sampler_thread *thread)
+{
+	struct drgn_memory_reader *reader = &sampler->prog->reader;
+	drgn_memory_reader_invalidate_cache_range(reader, thread->task_address,
+						  thread->task_size, false);
+	drgn_memory_reader_invalidate_cache_range(reader, thread->stack_address,
+						  sampler->thread_size, false);
+}
+
+/* Discard cached memory that may have changed since the last snapshot. */
+static void drgn_stack_sampler_invalidate(struct drgn_stack_sampler *sampler)
+{
+	struct drgn_program *prog = sampler->prog;
+	if (!(prog->flags & DRGN_PROGRAM_IS_LIVE) || !prog->reader.cache_size)
+		return;
+	drgn_program_lock(prog);
+	if (!(prog->flags & DRGN_PROGRAM_IS_LINUX_KERNEL) ||
+	    !sampler->thread_size) {
+		drgn_memory_reader_invalidate_cache(&prog->reader);
+	} else {
+		for (size_t i = 0; i < sampler->num_threads; i++) {
+			drgn_stack_sampler_invalidate_thread(sampler,
+							     &sampler->threads[i]);
+		}
 	}
+	drgn_program_unlock(prog);
+}
+
+static struct drgn_error *
+drgn_stack_sampler_add(struct drgn_stack_sampler *sampler,
+		       struct drgn_stack_trace *trace)
+{
+	struct drgn_stack_trace_group_map_entry entry = {
+		.key = {
+			.trace = trace,
+			.hash = drgn_stack_trace_pc_hash(trace),
+		},
+		.value = sampler->samples.size,
+	};
+	struct hash_pair hp = drgn_stack_trace_group_map_hash(&entry.key);
+	struct drgn_stack_trace_group_map_iterator it =
+		drgn_stack_trace_group_map_search_hashed(&sampler->map,
+							 &entry.key, hp);
+	if (it.entry) {
+		sampler->samples.data[it.entry->value].count++;
+		drgn_stack_trace_destroy(trace);
+		return NULL;
+	}
+	struct drgn_stack_sample *sample =
+		drgn_stack_sample_vector_append_entry(&sampler->samples);
+	if (!sample)
+		return &drgn_enomem;
+	if (drgn_stack_trace_group_map_insert_searched(&sampler->map, &entry,
+						       hp, NULL) < 0) {
+		drgn_stack_sample_vector_pop(&sampler->samples);
+		return &drgn_enomem;
+	}
+	sample->trace = trace;
+	sample->count = 1;
+	return NULL;
+}
+
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_stack_sampler_sample(struct drgn_stack_sampler *sampler)
+{
+	struct drgn_error *err = NULL;
+
+	#pragma omp parallel for schedule(dynamic) \
+		num_threads(drgn_program_num_parallel_threads(sampler->prog))
+	for (size_t i = 0; i < sampler->num_threads; i++) {
+		drgn_program_bind_parallel_thread(sampler->prog);
+		if (err)
+			continue;
+		struct drgn_error *thread_err =
+			drgn_get_thread_stack_trace(sampler->threads[i].thread,
+						    true, &sampler->traces[i]);
+		if (!thread_err)
+			continue;
+		sampler->traces[i] = NULL;
+		/*
+		 * Running tasks can't be unwound, and tasks may exit between
+		 * snapshots. Those are simply not sampled.
+		 */
+		if (thread_err->code == DRGN_ERROR_NO_MEMORY) {
+			#pragma omp critical(drgn_stack_sampler_sample_error)
+			if (err)
+				drgn_error_destroy(thread_err);
+			else
+				err = thread_err;
+		} else {
+			drgn_error_destroy(thread_err);
+		}
+	}
+
+	for (size_t i = 0; i < sampler->num_threads; i++) {
+		struct drgn_stack_trace *trace = sampler->traces[i];
+		if (!trace)
+			continue;
+		sampler->traces[i] = NULL;
+		if (!err)
+			err = drgn_stack_sampler_add(sampler, trace);
+		if (err)
+			drgn_stack_trace_destroy(trace);
+	}
+	drgn_stack_sampler_invalidate(sampler);
+	if (!err)
+		sampler->num_snapshots++;
+	return err;
+}
+
+LIBDRGN_PUBLIC uint64_t
+drgn_stack_sampler_num_snapshots(struct drgn_stack_sampler *sampler)
+{
+	return sampler->num_snapshots;
+}
+
+static bool drgn_stack_sampler_append_frame(struct string_builder *str,
+					    struct drgn_stack_trace *trace,
+					    size_t frame)
+{
+	const char *name = drgn_stack_frame_name(trace, frame);
+	if (name)
+		return string_builder_append(str, name);
+	struct drgn_register_state *regs = trace->frames[frame].regs;
+	struct optional_uint64 pc = drgn_register_state_get_pc(regs);
+	if (!pc.has_value)
+		return string_builder_append(str, "???");
+	Dwfl_Module *dwfl_module =
+		regs->module ? regs->module->dwfl_module : NULL;
+	struct drgn_symbol sym;
+	if (dwfl_module &&
+	    drgn_program_find_symbol_by_address_internal(trace->prog,
+							 pc.value - !regs->interrupted,
+							 dwfl_module, &sym))
+		return string_builder_append(str, sym.name);
+	return string_builder_appendf(str, "0x%" PRIx64, pc.value);
+}
+
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_stack_sampler_format_folded(struct drgn_stack_sampler *sampler,
+				 char **ret)
+{
+	struct string_builder str = {};
+	for (size_t i = 0; i < sampler->samples.size; i++) {
+		struct drgn_stack_sample *sample = &sampler->samples.data[i];
+		struct drgn_stack_trace *trace = sample->trace;
+		/* Folded stacks go from the outermost frame to the innermost. */
+		for (size_t frame = trace->num_frames; frame-- > 0;) {
+			if (!drgn_stack_sampler_append_frame(&str, trace,
+							     frame) ||
+			    (frame && !string_builder_appendc(&str, ';')))
+				goto enomem;
+		}
+		if (!string_builder_appendf(&str, " %" PRIu64 "\n",
+					    sample->count))
+			goto enomem;
+	}
+	if (!string_builder_finalize(&str, ret))
+		goto enomem;
+	return NULL;
+
+enomem:
+	free(str.str);
+	return &drgn_enomem;
+}
+
+/* DIEs found for a name in a frame, cached by program counter. */
+struct drgn_frame_dies {
+	/* addr is NULL if the name wasn't found. */
+	Dwarf_Die die;
+	Dwarf_Die type_die;
+};
+
+DEFINE_VECTOR(drgn_frame_dies_vector, struct drgn_frame_dies)
+DEFINE_HASH_MAP(drgn_frame_dies_map, uint64_t, size_t,
+		int_key_hash_pair, scalar_key_eq)
+
+static size_t
+drgn_stack_trace_find_function_frame(struct drgn_stack_trace *trace,
+				     const char *function)
+{
+	for (size_t i = 0; i < trace->num_frames; i++) {
+		const char *name = drgn_stack_frame_name(trace, i);
+		if (name && strcmp(name, function) == 0)
+			return i;
+	}
+	return SIZE_MAX;
+}
+
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_stack_traces_find_objects(struct drgn_stack_trace * const *traces,
+			       size_t num_traces, const char *function,
+			       const char * const *names, size_t num_names,
+			       size_t *frames_ret, struct drgn_object *ret)
+{
+	struct drgn_error *err = NULL;
+	if (!num_traces)
+		return NULL;
+	struct drgn_program *prog = traces[0]->prog;
+	/*
+	 * Indexed by the values in the map. Each program counter gets
+	 * num_names consecutive entries.
+	 */
+	struct drgn_frame_dies_vector dies = VECTOR_INIT;
+	struct drgn_frame_dies_map map = HASH_TABLE_INIT;
+
+	drgn_program_lock(prog);
+	for (size_t i = 0; i < num_traces; i++) {
+		struct drgn_stack_trace *trace = traces[i];
+		size_t frame_i =
+			drgn_stack_trace_find_function_frame(trace, function);
+		frames_ret[i] = frame_i;
+		if (frame_i == SIZE_MAX)
+			continue;
+
+		/*
+		 * The frame was found by name, so it has scopes and therefore
+		 * a program counter.
+		 */
+		struct drgn_register_state *regs = trace->frames[frame_i].regs;
+		struct drgn_frame_dies_map_entry entry = {
+			.key = (drgn_register_state_get_pc(regs).value
+				- !regs->interrupted),
+			.value = dies.size,
+		};
+		struct drgn_frame_dies_map_iterator it;
+		int r = drgn_frame_dies_map_insert(&map, &entry, &it);
+		if (r < 0) {
+			err = &drgn_enomem;
+			goto out;
+		}
+		/* This is the first time we've seen this program counter. */
+		for (size_t j = 0; r > 0 && j < num_names; j++) {
+			struct drgn_frame_dies *new_dies =
+				drgn_frame_dies_vector_append_entry(&dies);
+			if (!new_dies) {
+				err = &drgn_enomem;
+				goto out;
+			}
+			Dwarf_Die *die = &new_dies->die;
+			Dwarf_Die *type_die = &new_dies->type_die;
+			err = drgn_stack_frame_find_object_die(trace, frame_i,
+							       names[j], die,
+							       type_die);
+			if (err)
+				goto out;
+		}
+
+		struct drgn_frame_dies *found =
+			&dies.data[it.entry->value];
+		struct drgn_object *objs = &ret[i * num_names];
+		for (size_t j = 0; j < num_names; j++) {
+			if (!found[j].die.addr)
+				continue;
+			Dwarf_Die *die = &found[j].die;
+			Dwarf_Die *type_die = &found[j].type_die;
+			err = drgn_stack_frame_object_from_die(trace, frame_i,
+							       die, type_die,
+							       &objs[j]);
+			if (err)
+				goto out;
+		}
+	}
+out:
+	drgn_program_unlock(prog);
+	drgn_frame_dies_map_deinit(&map);
+	drgn_frame_dies_vector_deinit(&dies);
+	return err;
 }
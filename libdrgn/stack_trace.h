@@ -13,7 +13,15 @@
 #define DRGN_STACK_TRACE_H
 
 #include <elfutils/libdw.h>
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+
+#include "cfi.h"
+#include "hash_table.h"
+
+struct drgn_debug_info_module;
+struct drgn_program;
 
 /**
  * @ingroup Internals
@@ -32,14 +40,78 @@ struct drgn_stack_frame {
 	Dwarf_Die *scopes;
 	size_t num_scopes;
 	size_t function_scope;
+	/**
+	 * Whether @ref scopes still need to be looked up. This is only set in
+	 * raw stack traces.
+	 */
+	bool scopes_pending;
 };
 
 struct drgn_stack_trace {
 	struct drgn_program *prog;
+	/**
+	 * Whether this is a raw stack trace, which has one frame per unwound
+	 * register state (i.e., inline frames are not expanded) and looks up
+	 * the scopes of each frame the first time it is inspected.
+	 */
+	bool raw;
 	size_t num_frames;
 	struct drgn_stack_frame frames[];
 };
 
+/**
+ * Cached results of the lookups done while unwinding through a program
+ * counter.
+ *
+ * The same return addresses appear in most stack traces, so these are cached
+ * per program in @ref drgn_program::pc_cache, keyed by the program counter
+ * used for lookups (i.e., the return address minus one for frames that didn't
+ * interrupt their caller).
+ */
+struct drgn_cached_pc {
+	/** Module containing the program counter, or @c NULL if none. */
+	struct drgn_debug_info_module *module;
+	/**
+	 * Call frame information row, or @c NULL if no CFI was found. Owned by
+	 * the cache. Only valid if @ref cfi_cached is @c true.
+	 */
+	struct drgn_cfi_row *row;
+	/** Whether the CFI has been looked up. */
+	bool cfi_cached;
+	/** Whether the frame interrupted its caller. */
+	bool interrupted;
+	/** Return address register number. */
+	drgn_register_number ret_addr_regno;
+};
+
+DEFINE_HASH_MAP_TYPE(drgn_pc_cache, uint64_t, struct drgn_cached_pc)
+
+/** Initialize @ref drgn_program::pc_cache. */
+void drgn_program_init_pc_cache(struct drgn_program *prog);
+
+/** Deinitialize @ref drgn_program::pc_cache. */
+void drgn_program_deinit_pc_cache(struct drgn_program *prog);
+
+/**
+ * Discard the contents of @ref drgn_program::pc_cache.
+ *
+ * This must be called whenever the program's modules change. The caller must
+ * hold the program lock.
+ */
+void drgn_program_clear_pc_cache(struct drgn_program *prog);
+
+/**
+ * Get the module containing a program counter, using @ref
+ * drgn_program::pc_cache. The caller must hold the program lock.
+ *
+ * @param[in] pc Program counter to look up, adjusted as described in @ref
+ * drgn_cached_pc.
+ * @return Module, or @c NULL if the program counter isn't in a module with a
+ * matching platform.
+ */
+struct drgn_debug_info_module *
+drgn_program_find_pc_module_locked(struct drgn_program *prog, uint64_t pc);
+
 /** @} */
 
 #endif /* DRGN_STACK_TRACE_H */
@@ -0,0 +1,302 @@
+// Copyright (c) Meta Platforms, Inc. and affiliates.
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <stdlib.h>
+
+#include "drgn.h"
+#include "program.h"
+#include "symbol_index.h"
+#include "util.h"
+
+DEFINE_HASH_MAP_FUNCTIONS(drgn_symbol_name_map, c_string_key_hash_pair,
+			  c_string_key_eq)
+DEFINE_HASH_MAP_FUNCTIONS(drgn_symbol_module_map, ptr_key_hash_pair,
+			  scalar_key_eq)
+DEFINE_VECTOR_FUNCTIONS(drgn_symbol_index_entry_vector)
+DEFINE_VECTOR_FUNCTIONS(drgn_symbol_index_module_vector)
+
+void drgn_symbol_index_init(struct drgn_symbol_index *index)
+{
+	drgn_symbol_name_map_init(&index->names);
+	drgn_symbol_module_map_init(&index->module_map);
+	drgn_symbol_index_entry_vector_init(&index->entries);
+	drgn_symbol_index_module_vector_init(&index->modules);
+	index->built = false;
+	index->bad_symtabs = false;
+}
+
+void drgn_symbol_index_deinit(struct drgn_symbol_index *index)
+{
+	for (size_t i = 0; i < index->modules.size; i++)
+		free(index->modules.data[i].by_address);
+	drgn_symbol_index_module_vector_deinit(&index->modules);
+	drgn_symbol_index_entry_vector_deinit(&index->entries);
+	drgn_symbol_module_map_deinit(&index->module_map);
+	drgn_symbol_name_map_deinit(&index->names);
+}
+
+void drgn_symbol_index_clear(struct drgn_symbol_index *index)
+{
+	if (!index->built && !index->modules.size)
+		return;
+	drgn_symbol_index_deinit(index);
+	drgn_symbol_index_init(index);
+}
+
+/* Named symbol of a module that hasn't been added to the name map yet. */
+struct drgn_symbol_index_pending {
+	const char *name;
+	struct hash_pair hp;
+	uint32_t sym_idx;
+};
+
+struct drgn_symbol_index_pending_module {
+	int symtab_len;
+	struct drgn_symbol_index_pending *syms;
+	size_t num_syms;
+};
+
+static int drgn_symbol_index_add_module(Dwfl_Module *dwfl_module,
+					void **userdatap, const char *name,
+					Dwarf_Addr base, void *arg)
+{
+	struct drgn_symbol_index *index = arg;
+	struct drgn_symbol_index_module *module =
+		drgn_symbol_index_module_vector_append_entry(&index->modules);
+	if (!module)
+		return DWARF_CB_ABORT;
+	module->dwfl_module = dwfl_module;
+	module->by_address = NULL;
+	module->num_by_address = 0;
+	return DWARF_CB_OK;
+}
+
+static int drgn_symbol_index_address_compare(const void *_a, const void *_b)
+{
+	const struct drgn_symbol_index_address *a = _a;
+	const struct drgn_symbol_index_address *b = _b;
+	if (a->address != b->address)
+		return a->address < b->address ? -1 : 1;
+	if (a->sym_idx != b->sym_idx)
+		return a->sym_idx < b->sym_idx ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Read the symbol table of a module into its address index and a list of
+ * pending named symbols. This is called for different modules in parallel, so
+ * it must only touch state belonging to the given module.
+ */
+static bool
+drgn_symbol_index_read_module(struct drgn_symbol_index_module *module,
+			      struct drgn_symbol_index_pending_module *pending)
+{
+	if (pending->symtab_len <= 1)
+		return true;
+
+	/* Ignore the zeroth null symbol. */
+	size_t max_syms = pending->symtab_len - 1;
+	pending->syms = malloc_array(max_syms, sizeof(pending->syms[0]));
+	module->by_address = malloc_array(max_syms,
+					  sizeof(module->by_address[0]));
+	if (!pending->syms || !module->by_address)
+		return false;
+
+	/*
+	 * Global symbols are after local symbols, so add them in reverse order
+	 * so that lookups by name find global symbols first.
+	 */
+	for (int i = pending->symtab_len - 1; i > 0; i--) {
+		GElf_Sym elf_sym;
+		GElf_Addr addr;
+		const char *name = dwfl_module_getsym_info(module->dwfl_module,
+							   i, &elf_sym, &addr,
+							   NULL, NULL, NULL);
+		if (!name)
+			continue;
+		struct drgn_symbol_index_pending *sym =
+			&pending->syms[pending->num_syms++];
+		sym->name = name;
+		sym->hp = drgn_symbol_name_map_hash(&name);
+		sym->sym_idx = i;
+		if (elf_sym.st_size) {
+			module->by_address[module->num_by_address++] =
+				(struct drgn_symbol_index_address){
+					.address = addr,
+					.size = elf_sym.st_size,
+					.sym_idx = i,
+				};
+		}
+	}
+
+	qsort(module->by_address, module->num_by_address,
+	      sizeof(module->by_address[0]),
+	      drgn_symbol_index_address_compare);
+	uint64_t max_end = 0;
+	for (size_t i = 0; i < module->num_by_address; i++) {
+		struct drgn_symbol_index_address *sym = &module->by_address[i];
+		uint64_t end = sym->address + sym->size;
+		if (end > max_end)
+			max_end = end;
+		sym->max_end = max_end;
+	}
+	return true;
+}
+
+static bool
+drgn_symbol_index_add_names(struct drgn_symbol_index *index, uint32_t module,
+			    const struct drgn_symbol_index_pending_module *pending)
+{
+	for (size_t i = 0; i < pending->num_syms; i++) {
+		const struct drgn_symbol_index_pending *sym = &pending->syms[i];
+		if (index->entries.size >= UINT32_MAX)
+			return false;
+		uint32_t entry_index = index->entries.size;
+		struct drgn_symbol_name_map_entry map_entry = {
+			.key = sym->name,
+			.value = { entry_index, entry_index },
+		};
+		struct drgn_symbol_name_map_iterator it;
+		int ret = drgn_symbol_name_map_insert_hashed(&index->names,
+							     &map_entry,
+							     sym->hp, &it);
+		if (ret < 0)
+			return false;
+		if (ret == 0) {
+			index->entries.data[it.entry->value.last].next =
+				entry_index;
+			it.entry->value.last = entry_index;
+		}
+		/* Reserved by drgn_symbol_index_build(). */
+		struct drgn_symbol_index_entry *entry =
+			drgn_symbol_index_entry_vector_append_entry(&index->entries);
+		entry->module = module;
+		entry->sym_idx = sym->sym_idx;
+		entry->next = UINT32_MAX;
+	}
+	return true;
+}
+
+struct drgn_error *drgn_symbol_index_build(struct drgn_symbol_index *index,
+					   struct drgn_program *prog,
+					   Dwfl *dwfl)
+{
+	struct drgn_error *err = NULL;
+
+	if (index->built)
+		return NULL;
+
+	if (dwfl_getmodules(dwfl, drgn_symbol_index_add_module, index, 0)) {
+		err = &drgn_enomem;
+		goto out;
+	}
+
+	size_t num_modules = index->modules.size;
+	struct drgn_symbol_index_pending_module *pending =
+		calloc(num_modules, sizeof(*pending));
+	if (!pending && num_modules) {
+		err = &drgn_enomem;
+		goto out;
+	}
+
+	/*
+	 * Loading a symbol table may call back into drgn to find debugging
+	 * information, and relocating symbols in relocatable files lazily sets
+	 * up the module's relocation information, so do both serially. After
+	 * that, reading symbols only touches per-module state.
+	 */
+	for (size_t i = 0; i < num_modules; i++) {
+		Dwfl_Module *dwfl_module = index->modules.data[i].dwfl_module;
+		pending[i].symtab_len = dwfl_module_getsymtab(dwfl_module);
+		if (pending[i].symtab_len == -1) {
+			index->bad_symtabs = true;
+			continue;
+		}
+		dwfl_module_relocations(dwfl_module);
+		if (drgn_symbol_module_map_insert(&index->module_map,
+						  &(struct drgn_symbol_module_map_entry){
+							.key = dwfl_module,
+							.value = i,
+						  }, NULL) < 0) {
+			err = &drgn_enomem;
+			goto out_pending;
+		}
+	}
+
+	#pragma omp parallel for schedule(dynamic) \
+		num_threads(drgn_program_num_parallel_threads(prog))
+	for (size_t i = 0; i < num_modules; i++) {
+		drgn_program_bind_parallel_thread(prog);
+		if (err)
+			continue;
+		if (!drgn_symbol_index_read_module(&index->modules.data[i],
+						   &pending[i])) {
+			#pragma omp critical(drgn_symbol_index_build_error)
+			if (!err)
+				err = &drgn_enomem;
+		}
+	}
+	if (err)
+		goto out_pending;
+
+	size_t num_syms = 0;
+	for (size_t i = 0; i < num_modules; i++)
+		num_syms += pending[i].num_syms;
+	if (!drgn_symbol_index_entry_vector_reserve(&index->entries, num_syms)) {
+		err = &drgn_enomem;
+		goto out_pending;
+	}
+	for (size_t i = 0; i < num_modules; i++) {
+		if (!drgn_symbol_index_add_names(index, i, &pending[i])) {
+			err = &drgn_enomem;
+			goto out_pending;
+		}
+	}
+	index->built = true;
+
+out_pending:
+	for (size_t i = 0; i < num_modules; i++)
+		free(pending[i].syms);
+	free(pending);
+out:
+	if (err)
+		drgn_symbol_index_clear(index);
+	return err;
+}
+
+const struct drgn_symbol_index_entry *
+drgn_symbol_index_find(struct drgn_symbol_index *index,
+		       const char *name)
+{
+	struct drgn_symbol_name_map_iterator it =
+		drgn_symbol_name_map_search(&index->names, &name);
+	if (!it.entry)
+		return NULL;
+	return &index->entries.data[it.entry->value.first];
+}
+
+const struct drgn_symbol_index_module *
+drgn_symbol_index_module(struct drgn_symbol_index *index,
+			 Dwfl_Module *dwfl_module)
+{
+	struct drgn_symbol_module_map_iterator it =
+		drgn_symbol_module_map_search(&index->module_map, &dwfl_module);
+	if (!it.entry)
+		return NULL;
+	return &index->modules.data[it.entry->value];
+}
+
+size_t
+drgn_symbol_index_module_address_upper_bound(const struct drgn_symbol_index_module *module,
+					     uint64_t address)
+{
+	size_t lo = 0, hi = module->num_by_address;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (module->by_address[mid].address <= address)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
@@ -0,0 +1,195 @@
+// Copyright (c) Meta Platforms, Inc. and affiliates.
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/**
+ * @file
+ *
+ * ELF symbol table index.
+ *
+ * See @ref SymbolIndex.
+ */
+
+#ifndef DRGN_SYMBOL_INDEX_H
+#define DRGN_SYMBOL_INDEX_H
+
+#include <elfutils/libdwfl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hash_table.h"
+#include "vector.h"
+
+struct drgn_program;
+
+/**
+ * @ingroup Internals
+ *
+ * @defgroup SymbolIndex Symbol index
+ *
+ * Index of the ELF symbol tables of all modules.
+ *
+ * Searching for symbols by name with libdwfl requires a linear scan of the
+ * symbol table of every module, and libdwfl has no interface for finding every
+ * symbol containing an address. @ref drgn_symbol_index indexes the symbol
+ * tables of all modules by name and by address so that both searches avoid
+ * scanning every symbol.
+ *
+ * The index is built lazily by @ref drgn_symbol_index_build() and must be
+ * cleared with @ref drgn_symbol_index_clear() whenever modules are added or
+ * removed.
+ *
+ * @{
+ */
+
+/** Symbol with a given name in a @ref drgn_symbol_index. */
+struct drgn_symbol_index_entry {
+	/** Index of the module in @ref drgn_symbol_index::modules. */
+	uint32_t module;
+	/** Index of the symbol in the module's symbol table. */
+	uint32_t sym_idx;
+	/**
+	 * Index of the next entry with the same name in @ref
+	 * drgn_symbol_index::entries, or @c UINT32_MAX if this is the last
+	 * one.
+	 */
+	uint32_t next;
+};
+
+/** Symbol in the address index of a @ref drgn_symbol_index_module. */
+struct drgn_symbol_index_address {
+	/** Start address of the symbol. */
+	uint64_t address;
+	/** Size of the symbol. */
+	uint64_t size;
+	/**
+	 * Maximum end address of this symbol and every symbol before it in the
+	 * address index.
+	 *
+	 * This bounds how far back a search for symbols containing an address
+	 * needs to look.
+	 */
+	uint64_t max_end;
+	/** Index of the symbol in the module's symbol table. */
+	uint32_t sym_idx;
+};
+
+/** Indexed module in a @ref drgn_symbol_index. */
+struct drgn_symbol_index_module {
+	Dwfl_Module *dwfl_module;
+	/** Symbols with a non-zero size sorted by start address. */
+	struct drgn_symbol_index_address *by_address;
+	/** Number of symbols in @ref by_address. */
+	size_t num_by_address;
+};
+
+/** First and last entries with a given name. */
+struct drgn_symbol_index_chain {
+	uint32_t first;
+	uint32_t last;
+};
+
+DEFINE_HASH_MAP_TYPE(drgn_symbol_name_map, const char *,
+		     struct drgn_symbol_index_chain)
+DEFINE_HASH_MAP_TYPE(drgn_symbol_module_map, Dwfl_Module *, uint32_t)
+DEFINE_VECTOR_TYPE(drgn_symbol_index_entry_vector,
+		   struct drgn_symbol_index_entry)
+DEFINE_VECTOR_TYPE(drgn_symbol_index_module_vector,
+		   struct drgn_symbol_index_module)
+
+/** Index of the ELF symbol tables of all modules. */
+struct drgn_symbol_index {
+	/** Map from symbol name to chain of entries in @ref entries. */
+	struct drgn_symbol_name_map names;
+	/** Map from libdwfl module to index in @ref modules. */
+	struct drgn_symbol_module_map module_map;
+	/** Entries for every named symbol. */
+	struct drgn_symbol_index_entry_vector entries;
+	/** Indexed modules, in the order returned by `dwfl_getmodules()`. */
+	struct drgn_symbol_index_module_vector modules;
+	/** Whether the index has been built. */
+	bool built;
+	/** Whether the symbol table of any module could not be read. */
+	bool bad_symtabs;
+};
+
+/** Initialize an empty @ref drgn_symbol_index. */
+void drgn_symbol_index_init(struct drgn_symbol_index *index);
+
+/** Deinitialize a @ref drgn_symbol_index. */
+void drgn_symbol_index_deinit(struct drgn_symbol_index *index);
+
+/**
+ * Discard the contents of a @ref drgn_symbol_index.
+ *
+ * This must be called whenever modules are reported to or removed from the
+ * libdwfl handle that the index was built from. The index will be rebuilt on
+ * the next call to @ref drgn_symbol_index_build().
+ */
+void drgn_symbol_index_clear(struct drgn_symbol_index *index);
+
+/**
+ * Build a @ref drgn_symbol_index if it hasn't been built already.
+ *
+ * The symbol tables of different modules are indexed in parallel using the
+ * threads of @p prog.
+ */
+struct drgn_error *drgn_symbol_index_build(struct drgn_symbol_index *index,
+					   struct drgn_program *prog,
+					   Dwfl *dwfl);
+
+/**
+ * Find the first symbol with the given name in a @ref drgn_symbol_index.
+ *
+ * Symbols are returned in module order. Within each module, symbols are
+ * returned from the end of the symbol table to the beginning, which finds
+ * global symbols before local symbols.
+ *
+ * @return Entry, or @c NULL if there are no symbols with the given name.
+ */
+const struct drgn_symbol_index_entry *
+drgn_symbol_index_find(struct drgn_symbol_index *index,
+		       const char *name);
+
+/**
+ * Get the next symbol with the same name as a symbol returned by @ref
+ * drgn_symbol_index_find().
+ *
+ * @return Entry, or @c NULL if there are no more symbols with the name.
+ */
+static inline const struct drgn_symbol_index_entry *
+drgn_symbol_index_next(const struct drgn_symbol_index *index,
+		       const struct drgn_symbol_index_entry *entry)
+{
+	if (entry->next == UINT32_MAX)
+		return NULL;
+	return &index->entries.data[entry->next];
+}
+
+/**
+ * Get the indexed module for a libdwfl module.
+ *
+ * @return Module, or @c NULL if the module is not in the index.
+ */
+const struct drgn_symbol_index_module *
+drgn_symbol_index_module(struct drgn_symbol_index *index,
+			 Dwfl_Module *dwfl_module);
+
+/**
+ * Find the last symbol in a module's address index that starts at or before an
+ * address.
+ *
+ * The symbols containing the address can be found by iterating backwards from
+ * the returned index while @ref drgn_symbol_index_address::max_end is greater
+ * than the address.
+ *
+ * @return Index into @ref drgn_symbol_index_module::by_address plus one, or
+ * zero if no symbol starts at or before the address.
+ */
+size_t
+drgn_symbol_index_module_address_upper_bound(const struct drgn_symbol_index_module *module,
+					     uint64_t address);
+
+/** @} */
+
+#endif /* DRGN_SYMBOL_INDEX_H */
@@ -1,16 +1,20 @@
 // Copyright (c) Meta Platforms, Inc. and affiliates.
 // SPDX-License-Identifier: GPL-3.0-or-later
 
+#include <inttypes.h>
 #include <limits.h>
+#include <stdalign.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "array.h"
+#include "debug_info.h"
 #include "error.h"
 #include "hash_table.h"
 #include "language.h"
 #include "lazy_object.h"
 #include "program.h"
+#include "string_builder.h"
 #include "type.h"
 #include "util.h"
 
@@ -154,20 +158,14 @@ drgn_primitive_type_is_signed(enum drgn_primitive_type primitive)
 static struct hash_pair
 drgn_member_key_hash_pair(const struct drgn_member_key *key)
 {
-	size_t hash;
-	if (key->name)
-		hash = hash_bytes(key->name, key->name_len);
-	else
-		hash = 0;
-	hash = hash_combine((uintptr_t)key->type, hash);
+	size_t hash = hash_combine((uintptr_t)key->type, (uintptr_t)key->name);
 	return hash_pair_from_avalanching_hash(hash);
 }
 
 static bool drgn_member_key_eq(const struct drgn_member_key *a,
 			       const struct drgn_member_key *b)
 {
-	return (a->type == b->type && a->name_len == b->name_len &&
-		(!a->name_len || memcmp(a->name, b->name, a->name_len) == 0));
+	return a->type == b->type && a->name == b->name;
 }
 
 DEFINE_HASH_MAP_FUNCTIONS(drgn_member_map, drgn_member_key_hash_pair,
@@ -175,6 +173,148 @@ DEFINE_HASH_MAP_FUNCTIONS(drgn_member_map, drgn_member_key_hash_pair,
 
 DEFINE_HASH_SET_FUNCTIONS(drgn_type_set, ptr_key_hash_pair, scalar_key_eq)
 
+struct drgn_interned_string_key {
+	const char *str;
+	size_t len;
+	size_t hash;
+};
+
+static inline struct drgn_interned_string_key
+drgn_interned_string_to_key(struct drgn_interned_string * const *entry)
+{
+	return (struct drgn_interned_string_key){
+		.str = (*entry)->str,
+		.len = (*entry)->len,
+		.hash = (*entry)->hash,
+	};
+}
+
+static struct hash_pair
+drgn_interned_string_key_hash_pair(const struct drgn_interned_string_key *key)
+{
+	return hash_pair_from_avalanching_hash(key->hash);
+}
+
+static bool
+drgn_interned_string_key_eq(const struct drgn_interned_string_key *a,
+			    const struct drgn_interned_string_key *b)
+{
+	return (a->hash == b->hash && a->len == b->len &&
+		memcmp(a->str, b->str, a->len) == 0);
+}
+
+DEFINE_HASH_TABLE_FUNCTIONS(drgn_interned_string_table,
+			    drgn_interned_string_to_key,
+			    drgn_interned_string_key_hash_pair,
+			    drgn_interned_string_key_eq)
+
+/*
+ * Find the interned copy of a string in a program, or return NULL if there
+ * isn't one, in which case no type in the program has it as a name. The
+ * program lock must be held.
+ */
+static const char *drgn_program_find_interned_string(struct drgn_program *prog,
+						     const char *str,
+						     size_t len)
+{
+	struct drgn_interned_string_key key = {
+		.str = str,
+		.len = len,
+		.hash = hash_bytes(str, len),
+	};
+	struct drgn_interned_string_table_iterator it =
+		drgn_interned_string_table_search(&prog->type_strings, &key);
+	return it.entry ? (*it.entry)->str : NULL;
+}
+
+/*
+ * Replace a string with its interned copy in a program, interning it first if
+ * needed. A NULL string is left alone. Returns false if out of memory. The
+ * program lock must be held.
+ */
+static bool drgn_program_intern_string(struct drgn_program *prog,
+				       const char **str)
+{
+	if (!*str)
+		return true;
+	size_t len = strlen(*str);
+	struct drgn_interned_string_key key = {
+		.str = *str,
+		.len = len,
+		.hash = hash_bytes(*str, len),
+	};
+	struct hash_pair hp = drgn_interned_string_table_hash(&key);
+	struct drgn_interned_string_table_iterator it =
+		drgn_interned_string_table_search_hashed(&prog->type_strings,
+							 &key, hp);
+	if (it.entry) {
+		*str = (*it.entry)->str;
+		return true;
+	}
+
+	struct drgn_interned_string *interned =
+		drgn_arena_alloc(&prog->types_arena,
+				 sizeof(*interned) + len + 1,
+				 alignof(struct drgn_interned_string));
+	if (!interned)
+		return false;
+	interned->hash = key.hash;
+	interned->len = len;
+	memcpy(interned->str, *str, len + 1);
+	if (drgn_interned_string_table_insert_searched(&prog->type_strings,
+						       &interned, hp,
+						       NULL) < 0)
+		return false;
+	*str = interned->str;
+	return true;
+}
+
+static struct hash_pair
+drgn_type_name_key_hash_pair(const struct drgn_type_name_key *key)
+{
+	size_t hash = hash_c_string(key->name);
+	if (key->filename)
+		hash = hash_combine(hash, hash_c_string(key->filename));
+	hash = hash_combine((uintptr_t)key->lang, hash);
+	return hash_pair_from_avalanching_hash(hash);
+}
+
+static bool drgn_type_name_key_eq(const struct drgn_type_name_key *a,
+				  const struct drgn_type_name_key *b)
+{
+	return (a->lang == b->lang && strcmp(a->name, b->name) == 0 &&
+		(a->filename ?
+		 b->filename && strcmp(a->filename, b->filename) == 0 :
+		 !b->filename));
+}
+
+DEFINE_HASH_MAP_FUNCTIONS(drgn_type_name_map, drgn_type_name_key_hash_pair,
+			  drgn_type_name_key_eq)
+
+static struct hash_pair
+drgn_type_finder_key_hash_pair(const struct drgn_type_finder_key *key)
+{
+	size_t hash = hash_bytes(key->name, key->name_len);
+	if (key->filename)
+		hash = hash_combine(hash, hash_c_string(key->filename));
+	hash = hash_combine((size_t)key->kind, hash);
+	return hash_pair_from_avalanching_hash(hash);
+}
+
+static bool drgn_type_finder_key_eq(const struct drgn_type_finder_key *a,
+				    const struct drgn_type_finder_key *b)
+{
+	return (a->kind == b->kind && a->name_len == b->name_len &&
+		memcmp(a->name, b->name, a->name_len) == 0 &&
+		(a->filename ?
+		 b->filename && strcmp(a->filename, b->filename) == 0 :
+		 !b->filename));
+}
+
+DEFINE_HASH_MAP_FUNCTIONS(drgn_type_finder_cache,
+			  drgn_type_finder_key_hash_pair,
+			  drgn_type_finder_key_eq)
+
 LIBDRGN_PUBLIC struct drgn_error *
 drgn_member_object(struct drgn_type_member *member,
 		   const struct drgn_object **ret)
@@ -258,17 +398,17 @@ drgn_type_dedupe_hash_pair(struct drgn_type * const *entry)
 	size_t hash = hash_combine(drgn_type_kind(type),
 				   drgn_type_is_complete(type));
 	hash = hash_combine(hash, (uintptr_t)drgn_type_language(type));
+	/* Names and tags are interned, so they can be hashed by address. */
 	if (drgn_type_has_name(type))
-		hash = hash_combine(hash, hash_c_string(drgn_type_name(type)));
+		hash = hash_combine(hash, (uintptr_t)drgn_type_name(type));
 	if (drgn_type_has_size(type))
 		hash = hash_combine(hash, drgn_type_size(type));
 	if (drgn_type_has_is_signed(type))
 		hash = hash_combine(hash, drgn_type_is_signed(type));
 	if (drgn_type_has_little_endian(type))
 		hash = hash_combine(hash, drgn_type_little_endian(type));
-	const char *tag;
-	if (drgn_type_has_tag(type) && (tag = drgn_type_tag(type)))
-		hash = hash_combine(hash, hash_c_string(tag));
+	if (drgn_type_has_tag(type))
+		hash = hash_combine(hash, (uintptr_t)drgn_type_tag(type));
 	if (drgn_type_has_type(type)) {
 		struct drgn_qualified_type qualified_type =
 			drgn_type_type(type);
@@ -292,8 +432,7 @@ static bool drgn_type_dedupe_eq(struct drgn_type * const *entry_a,
 	    drgn_type_is_complete(a) != drgn_type_is_complete(b) ||
 	    drgn_type_language(a) != drgn_type_language(b))
 		return false;
-	if (drgn_type_has_name(a) &&
-	    strcmp(drgn_type_name(a), drgn_type_name(b)) != 0)
+	if (drgn_type_has_name(a) && drgn_type_name(a) != drgn_type_name(b))
 		return false;
 	if (drgn_type_has_size(a) && drgn_type_size(a) != drgn_type_size(b))
 		return false;
@@ -303,12 +442,8 @@ static bool drgn_type_dedupe_eq(struct drgn_type * const *entry_a,
 	if (drgn_type_has_little_endian(a) &&
 	    drgn_type_little_endian(a) != drgn_type_little_endian(b))
 		return false;
-	if (drgn_type_has_tag(a)) {
-		const char *tag_a = drgn_type_tag(a);
-		const char *tag_b = drgn_type_tag(b);
-		if ((!tag_a != !tag_b) || (tag_a && strcmp(tag_a, tag_b) != 0))
-			return false;
-	}
+	if (drgn_type_has_tag(a) && drgn_type_tag(a) != drgn_type_tag(b))
+		return false;
 	if (drgn_type_has_type(a)) {
 		struct drgn_qualified_type type_a = drgn_type_type(a);
 		struct drgn_qualified_type type_b = drgn_type_type(b);
@@ -337,30 +472,114 @@ DEFINE_VECTOR_FUNCTIONS(drgn_typep_vector)
 static struct drgn_error *find_or_create_type(struct drgn_type *key,
 					      struct drgn_type **ret)
 {
+	struct drgn_error *err = NULL;
 	struct drgn_program *prog = key->_private.program;
+	drgn_program_lock(prog);
+	/* The name and tag share storage. */
+	if ((drgn_type_has_name(key) || drgn_type_has_tag(key)) &&
+	    !drgn_program_intern_string(prog, &key->_private.name)) {
+		err = &drgn_enomem;
+		goto out;
+	}
 	struct hash_pair hp = drgn_dedupe_type_set_hash(&key);
 	struct drgn_dedupe_type_set_iterator it =
 		drgn_dedupe_type_set_search_hashed(&prog->dedupe_types, &key,
 						   hp);
 	if (it.entry) {
 		*ret = *it.entry;
-		return NULL;
+		goto out;
 	}
 
-	struct drgn_type *type = malloc(sizeof(*type));
-	if (!type)
-		return &drgn_enomem;
+	struct drgn_type *type = drgn_arena_alloc(&prog->types_arena,
+						  sizeof(*type),
+						  alignof(struct drgn_type));
+	if (!type) {
+		err = &drgn_enomem;
+		goto out;
+	}
 
 	*type = *key;
+	/*
+	 * If this fails, the type stays allocated in the arena until the
+	 * program is destroyed, which is harmless.
+	 */
 	if (drgn_dedupe_type_set_insert_searched(&prog->dedupe_types, &type, hp,
 						 NULL) < 0) {
-		free(type);
-		return &drgn_enomem;
+		err = &drgn_enomem;
+		goto out;
 	}
 	*ret = type;
-	return NULL;
+out:
+	drgn_program_unlock(prog);
+	return err;
 }
 
+/* Allocate a type that isn't deduplicated and add it to created_types. */
+static struct drgn_type *drgn_program_create_type(struct drgn_program *prog)
+{
+	drgn_program_lock(prog);
+	struct drgn_type *type = drgn_arena_alloc(&prog->types_arena,
+						  sizeof(*type),
+						  alignof(struct drgn_type));
+	if (type && !drgn_typep_vector_append(&prog->created_types, &type))
+		type = NULL;
+	drgn_program_unlock(prog);
+	return type;
+}
+
+/* Intern the tag of a created type. Returns false if out of memory. */
+static bool drgn_program_intern_tag(struct drgn_program *prog,
+				    const char **tag)
+{
+	drgn_program_lock(prog);
+	bool success = drgn_program_intern_string(prog, tag);
+	drgn_program_unlock(prog);
+	return success;
+}
+
+static bool drgn_program_copy_type_array_impl(struct drgn_program *prog,
+					      const void *src, size_t nmemb,
+					      size_t size, size_t align,
+					      size_t name_offset, void **ret)
+{
+	if (!nmemb) {
+		*ret = NULL;
+		return true;
+	}
+	bool success = false;
+	drgn_program_lock(prog);
+	char *copy = drgn_arena_memdup(&prog->types_arena, src, nmemb * size,
+				       align);
+	if (!copy)
+		goto out;
+	for (size_t i = 0; i < nmemb; i++) {
+		if (!drgn_program_intern_string(prog,
+						(const char **)(copy + i * size
+								+ name_offset)))
+			goto out;
+	}
+	*ret = copy;
+	success = true;
+out:
+	drgn_program_unlock(prog);
+	return success;
+}
+
+/*
+ * Copy the members, enumerators, parameters, or template parameters in a type
+ * builder's vector into the program's type arena and intern their names. The
+ * caller frees the original with the vector once the type is created. Returns
+ * false if out of memory. An empty vector is copied as NULL.
+ */
+#define drgn_program_copy_type_array(prog, vector, ret)			\
+	drgn_program_copy_type_array_impl((prog), (vector)->data,		\
+					  (vector)->size,			\
+					  sizeof((vector)->data[0]),		\
+					  alignof(typeof((vector)->data[0])),	\
+					  offsetof(typeof((vector)->data[0]),	\
+						   name),			\
+					  (void **)(ret))
+
 struct drgn_type *drgn_void_type(struct drgn_program *prog,
 				 const struct drgn_language *lang)
 {
@@ -608,30 +827,34 @@ drgn_compound_type_create(struct drgn_compound_type_builder *builder,
 		return err;
 	}
 
-	struct drgn_type *type = malloc(sizeof(*type));
-	if (!type)
-		return &drgn_enomem;
-	if (!drgn_typep_vector_append(&prog->created_types, &type)) {
-		free(type);
+	struct drgn_type_member *members;
+	struct drgn_type_template_parameter *template_parameters;
+	if (!drgn_program_intern_tag(prog, &tag) ||
+	    !drgn_program_copy_type_array(prog, &builder->members, &members) ||
+	    !drgn_program_copy_type_array(prog,
+					  &builder->template_builder.parameters,
+					  &template_parameters))
 		return &drgn_enomem;
-	}
 
-	drgn_type_member_vector_shrink_to_fit(&builder->members);
-	drgn_type_template_parameter_vector_shrink_to_fit(&builder->template_builder.parameters);
+	struct drgn_type *type = drgn_program_create_type(prog);
+	if (!type)
+		return &drgn_enomem;
 
 	type->_private.kind = builder->kind;
 	type->_private.is_complete = is_complete;
 	type->_private.primitive = DRGN_NOT_PRIMITIVE_TYPE;
 	type->_private.tag = tag;
 	type->_private.size = size;
-	type->_private.members = builder->members.data;
+	type->_private.members = members;
 	type->_private.num_members = builder->members.size;
-	type->_private.template_parameters =
-		builder->template_builder.parameters.data;
+	type->_private.template_parameters = template_parameters;
 	type->_private.num_template_parameters =
 		builder->template_builder.parameters.size;
 	type->_private.program = prog;
 	type->_private.language = lang ? lang : drgn_program_language(prog);
+	/* The lazy objects now belong to the type, so only free the arrays. */
+	drgn_type_member_vector_deinit(&builder->members);
+	drgn_type_template_parameter_vector_deinit(&builder->template_builder.parameters);
 	*ret = type;
 	return NULL;
 }
@@ -712,15 +935,15 @@ struct drgn_error *drgn_enum_type_create(struct drgn_enum_type_builder *builder,
 		return err;
 	}
 
-	struct drgn_type *type = malloc(sizeof(*type));
-	if (!type)
-		return &drgn_enomem;
-	if (!drgn_typep_vector_append(&builder->prog->created_types, &type)) {
-		free(type);
+	struct drgn_type_enumerator *enumerators;
+	if (!drgn_program_intern_tag(builder->prog, &tag) ||
+	    !drgn_program_copy_type_array(builder->prog, &builder->enumerators,
+					  &enumerators))
 		return &drgn_enomem;
-	}
 
-	drgn_type_enumerator_vector_shrink_to_fit(&builder->enumerators);
+	struct drgn_type *type = drgn_program_create_type(builder->prog);
+	if (!type)
+		return &drgn_enomem;
 
 	type->_private.kind = DRGN_TYPE_ENUM;
 	type->_private.is_complete = true;
@@ -728,11 +951,12 @@ struct drgn_error *drgn_enum_type_create(struct drgn_enum_type_builder *builder,
 	type->_private.tag = tag;
 	type->_private.type = compatible_type;
 	type->_private.qualifiers = 0;
-	type->_private.enumerators = builder->enumerators.data;
+	type->_private.enumerators = enumerators;
 	type->_private.num_enumerators = builder->enumerators.size;
 	type->_private.program = builder->prog;
 	type->_private.language =
 		lang ? lang : drgn_program_language(builder->prog);
+	drgn_type_enumerator_vector_deinit(&builder->enumerators);
 	*ret = type;
 	return NULL;
 }
@@ -945,31 +1169,35 @@ drgn_function_type_create(struct drgn_function_type_builder *builder,
 		return err;
 	}
 
-	struct drgn_type *type = malloc(sizeof(*type));
-	if (!type)
+	struct drgn_type_parameter *parameters;
+	struct drgn_type_template_parameter *template_parameters;
+	if (!drgn_program_copy_type_array(prog, &builder->parameters,
+					  &parameters) ||
+	    !drgn_program_copy_type_array(prog,
+					  &builder->template_builder.parameters,
+					  &template_parameters))
 		return &drgn_enomem;
-	if (!drgn_typep_vector_append(&prog->created_types, &type)) {
-		free(type);
-		return &drgn_enomem;
-	}
 
-	drgn_type_parameter_vector_shrink_to_fit(&builder->parameters);
-	drgn_type_template_parameter_vector_shrink_to_fit(&builder->template_builder.parameters);
+	struct drgn_type *type = drgn_program_create_type(prog);
+	if (!type)
+		return &drgn_enomem;
 
 	type->_private.kind = DRGN_TYPE_FUNCTION;
 	type->_private.is_complete = true;
 	type->_private.primitive = DRGN_NOT_PRIMITIVE_TYPE;
 	type->_private.type = return_type.type;
 	type->_private.qualifiers = return_type.qualifiers;
-	type->_private.parameters = builder->parameters.data;
+	type->_private.parameters = parameters;
 	type->_private.num_parameters = builder->parameters.size;
 	type->_private.is_variadic = is_variadic;
-	type->_private.template_parameters =
-		builder->template_builder.parameters.data;
+	type->_private.template_parameters = template_parameters;
 	type->_private.num_template_parameters =
 		builder->template_builder.parameters.size;
 	type->_private.program = prog;
 	type->_private.language = lang ? lang : drgn_program_language(prog);
+	/* The lazy objects now belong to the type, so only free the arrays. */
+	drgn_type_parameter_vector_deinit(&builder->parameters);
+	drgn_type_template_parameter_vector_deinit(&builder->template_builder.parameters);
 	*ret = type;
 	return NULL;
 }
@@ -1293,6 +1521,230 @@ struct drgn_error *drgn_error_incomplete_type(const char *format,
 	}
 }
 
+DEFINE_HASH_MAP_FUNCTIONS(drgn_enum_type_index_map, ptr_key_hash_pair,
+			  scalar_key_eq)
+
+DEFINE_HASH_MAP(drgn_enumerator_value_map, uint64_t, size_t, int_key_hash_pair,
+		scalar_key_eq)
+
+/*
+ * Enumerated types with fewer enumerators than this are searched linearly
+ * instead of being indexed by value.
+ */
+#define DRGN_ENUM_TYPE_INDEX_MIN_ENUMERATORS 16
+
+struct drgn_enum_type_flag {
+	uint64_t value;
+	const char *name;
+};
+
+struct drgn_enum_type_flag_table {
+	/** Flags with nonzero values in enumerator order. */
+	struct drgn_enum_type_flag *flags;
+	size_t num_flags;
+	/** Whether an enumerator has a negative bit number. */
+	bool negative_bit_number;
+	bool built;
+};
+
+struct drgn_enum_type_index {
+	/** Map from value to index of the first enumerator with that value. */
+	struct drgn_enumerator_value_map values;
+	bool values_built;
+	/** Flag tables indexed by the bit_numbers argument. */
+	struct drgn_enum_type_flag_table flag_tables[2];
+};
+
+static void drgn_enum_type_index_destroy(struct drgn_enum_type_index *index)
+{
+	drgn_enumerator_value_map_deinit(&index->values);
+	for (size_t i = 0; i < array_size(index->flag_tables); i++)
+		free(index->flag_tables[i].flags);
+	free(index);
+}
+
+/* Must be called with the program lock held. Returns NULL on OOM. */
+static struct drgn_enum_type_index *
+drgn_enum_type_get_index(struct drgn_type *type)
+{
+	struct drgn_program *prog = drgn_type_program(type);
+	struct drgn_enum_type_index_map_iterator it =
+		drgn_enum_type_index_map_search(&prog->enum_type_indexes,
+						&type);
+	if (it.entry)
+		return it.entry->value;
+
+	struct drgn_enum_type_index *index = calloc(1, sizeof(*index));
+	if (!index)
+		return NULL;
+	drgn_enumerator_value_map_init(&index->values);
+	struct drgn_enum_type_index_map_entry entry = {
+		.key = type,
+		.value = index,
+	};
+	if (drgn_enum_type_index_map_insert(&prog->enum_type_indexes, &entry,
+					    NULL) < 0) {
+		drgn_enum_type_index_destroy(index);
+		return NULL;
+	}
+	return index;
+}
+
+static bool
+drgn_enum_type_index_build_values(struct drgn_enum_type_index *index,
+				  struct drgn_type *type)
+{
+	const struct drgn_type_enumerator *enumerators =
+		drgn_type_enumerators(type);
+	size_t num_enumerators = drgn_type_num_enumerators(type);
+	if (!drgn_enumerator_value_map_reserve(&index->values,
+					       num_enumerators))
+		return false;
+	for (size_t i = 0; i < num_enumerators; i++) {
+		struct drgn_enumerator_value_map_entry entry = {
+			.key = enumerators[i].uvalue,
+			.value = i,
+		};
+		// Keep the first enumerator if there are duplicates.
+		if (drgn_enumerator_value_map_insert(&index->values, &entry,
+						     NULL) < 0)
+			return false;
+	}
+	index->values_built = true;
+	return true;
+}
+
+const struct drgn_type_enumerator *
+drgn_enum_type_find_value(struct drgn_type *type, uint64_t value)
+{
+	const struct drgn_type_enumerator *enumerators =
+		drgn_type_enumerators(type);
+	size_t num_enumerators = drgn_type_num_enumerators(type);
+
+	if (num_enumerators >= DRGN_ENUM_TYPE_INDEX_MIN_ENUMERATORS) {
+		struct drgn_program *prog = drgn_type_program(type);
+		const struct drgn_type_enumerator *ret = NULL;
+		bool found = false;
+		drgn_program_lock(prog);
+		struct drgn_enum_type_index *index =
+			drgn_enum_type_get_index(type);
+		if (index
+		    && (index->values_built
+			|| drgn_enum_type_index_build_values(index, type))) {
+			struct drgn_enumerator_value_map_iterator it =
+				drgn_enumerator_value_map_search(&index->values,
+								 &value);
+			if (it.entry)
+				ret = &enumerators[it.entry->value];
+			found = true;
+		}
+		drgn_program_unlock(prog);
+		// If we couldn't build the index, fall back to a linear search.
+		if (found)
+			return ret;
+	}
+
+	for (size_t i = 0; i < num_enumerators; i++) {
+		if (enumerators[i].uvalue == value)
+			return &enumerators[i];
+	}
+	return NULL;
+}
+
+static bool
+drgn_enum_type_flag_table_build(struct drgn_enum_type_flag_table *table,
+				struct drgn_type *type, bool bit_numbers)
+{
+	const struct drgn_type_enumerator *enumerators =
+		drgn_type_enumerators(type);
+	size_t num_enumerators = drgn_type_num_enumerators(type);
+	bool is_signed = drgn_enum_type_is_signed(type);
+
+	table->flags = malloc_array(num_enumerators, sizeof(table->flags[0]));
+	if (!table->flags && num_enumerators)
+		return false;
+	table->num_flags = 0;
+	for (size_t i = 0; i < num_enumerators; i++) {
+		uint64_t value;
+		if (bit_numbers) {
+			if (is_signed && enumerators[i].svalue < 0) {
+				table->negative_bit_number = true;
+				continue;
+			}
+			// Higher bits can't be set in a 64-bit value.
+			if (enumerators[i].uvalue >= 64)
+				continue;
+			value = UINT64_C(1) << enumerators[i].uvalue;
+		} else {
+			value = enumerators[i].uvalue;
+			if (!value)
+				continue;
+		}
+		table->flags[table->num_flags].value = value;
+		table->flags[table->num_flags].name = enumerators[i].name;
+		table->num_flags++;
+	}
+	table->built = true;
+	return true;
+}
+
+struct drgn_error *drgn_enum_type_format_flags(struct drgn_type *type,
+					       uint64_t value, bool bit_numbers,
+					       struct string_builder *sb)
+{
+	if (drgn_type_kind(type) != DRGN_TYPE_ENUM) {
+		return drgn_error_create(DRGN_ERROR_TYPE,
+					 "cannot decode flags of non-enumerated type");
+	}
+	if (!drgn_type_is_complete(type)) {
+		return drgn_error_create(DRGN_ERROR_TYPE,
+					 "cannot decode incomplete enumerated type");
+	}
+	if (value == 0) {
+		if (!string_builder_appendc(sb, '0'))
+			return &drgn_enomem;
+		return NULL;
+	}
+
+	struct drgn_program *prog = drgn_type_program(type);
+	struct drgn_enum_type_flag_table *table = NULL;
+	drgn_program_lock(prog);
+	struct drgn_enum_type_index *index = drgn_enum_type_get_index(type);
+	if (index) {
+		table = &index->flag_tables[bit_numbers];
+		if (!table->built
+		    && !drgn_enum_type_flag_table_build(table, type,
+							bit_numbers))
+			table = NULL;
+	}
+	drgn_program_unlock(prog);
+	// Once built, the table is never modified, so it can be used unlocked.
+	if (!table)
+		return &drgn_enomem;
+	if (table->negative_bit_number) {
+		return drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+					 "negative bit number");
+	}
+
+	uint64_t mask = 0;
+	bool first = true;
+	for (size_t i = 0; i < table->num_flags; i++) {
+		if (!(value & table->flags[i].value))
+			continue;
+		if ((!first && !string_builder_appendc(sb, '|'))
+		    || !string_builder_append(sb, table->flags[i].name))
+			return &drgn_enomem;
+		mask |= table->flags[i].value;
+		first = false;
+	}
+	if (value & ~mask) {
+		if ((!first && !string_builder_appendc(sb, '|'))
+		    || !string_builder_appendf(sb, "0x%" PRIx64, value & ~mask))
+			return &drgn_enomem;
+	}
+	return NULL;
+}
+
 void drgn_program_init_types(struct drgn_program *prog)
 {
 	for (size_t i = 0; i < array_size(prog->void_types); i++) {
@@ -1305,15 +1757,41 @@ void drgn_program_init_types(struct drgn_program *prog)
 	}
 	drgn_dedupe_type_set_init(&prog->dedupe_types);
 	drgn_typep_vector_init(&prog->created_types);
+	drgn_arena_init(&prog->types_arena);
+	drgn_interned_string_table_init(&prog->type_strings);
 	drgn_member_map_init(&prog->members);
 	drgn_type_set_init(&prog->members_cached);
+	drgn_type_name_map_init(&prog->type_names);
+	prog->uncacheable_type_finds = 0;
+	drgn_enum_type_index_map_init(&prog->enum_type_indexes);
+}
+
+void drgn_program_clear_type_name_cache(struct drgn_program *prog)
+{
+	for (struct drgn_type_name_map_iterator it =
+	     drgn_type_name_map_first(&prog->type_names);
+	     it.entry; it = drgn_type_name_map_next(it))
+		free((char *)it.entry->key.name);
+	drgn_type_name_map_deinit(&prog->type_names);
+	drgn_type_name_map_init(&prog->type_names);
 }
 
 void drgn_program_deinit_types(struct drgn_program *prog)
 {
+	drgn_program_clear_type_name_cache(prog);
+	drgn_type_name_map_deinit(&prog->type_names);
 	drgn_member_map_deinit(&prog->members);
 	drgn_type_set_deinit(&prog->members_cached);
+	for (struct drgn_enum_type_index_map_iterator it =
+	     drgn_enum_type_index_map_first(&prog->enum_type_indexes);
+	     it.entry; it = drgn_enum_type_index_map_next(it))
+		drgn_enum_type_index_destroy(it.entry->value);
+	drgn_enum_type_index_map_deinit(&prog->enum_type_indexes);
 
+	/*
+	 * The types and their arrays are all freed with the arena, but the lazy
+	 * objects in them may own memory.
+	 */
 	for (size_t i = 0; i < prog->created_types.size; i++) {
 		struct drgn_type *type = prog->created_types.data[i];
 		if (drgn_type_has_members(type)) {
@@ -1322,50 +1800,136 @@ void drgn_program_deinit_types(struct drgn_program *prog)
 			size_t num_members = drgn_type_num_members(type);
 			for (size_t j = 0; j < num_members; j++)
 				drgn_lazy_object_deinit(&members[j].object);
-			free(members);
 		}
-		if (drgn_type_has_enumerators(type))
-			free(drgn_type_enumerators(type));
 		if (drgn_type_has_parameters(type)) {
 			struct drgn_type_parameter *parameters =
 				drgn_type_parameters(type);
 			size_t num_parameters = drgn_type_num_parameters(type);
 			for (size_t j = 0; j < num_parameters; j++)
 				drgn_lazy_object_deinit(&parameters[j].default_argument);
-			free(parameters);
 		}
-		free(type);
+		if (drgn_type_has_template_parameters(type)) {
+			struct drgn_type_template_parameter *template_parameters =
+				drgn_type_template_parameters(type);
+			size_t num_template_parameters =
+				drgn_type_num_template_parameters(type);
+			for (size_t j = 0; j < num_template_parameters; j++)
+				drgn_lazy_object_deinit(&template_parameters[j].argument);
+		}
 	}
 	drgn_typep_vector_deinit(&prog->created_types);
-
-	for (struct drgn_dedupe_type_set_iterator it =
-	     drgn_dedupe_type_set_first(&prog->dedupe_types);
-	     it.entry; it = drgn_dedupe_type_set_next(it))
-		free(*it.entry);
 	drgn_dedupe_type_set_deinit(&prog->dedupe_types);
+	drgn_interned_string_table_deinit(&prog->type_strings);
+	drgn_arena_deinit(&prog->types_arena);
 
 	struct drgn_type_finder *finder = prog->type_finders;
 	while (finder) {
 		struct drgn_type_finder *next = finder->next;
+		if (finder->cached) {
+			for (struct drgn_type_finder_cache_iterator it =
+			     drgn_type_finder_cache_first(&finder->cache);
+			     it.entry; it = drgn_type_finder_cache_next(it))
+				free((char *)it.entry->key.name);
+			drgn_type_finder_cache_deinit(&finder->cache);
+		}
 		free(finder);
 		finder = next;
 	}
 }
 
-LIBDRGN_PUBLIC struct drgn_error *
-drgn_program_add_type_finder(struct drgn_program *prog, drgn_type_find_fn fn,
-			     void *arg)
+struct drgn_error *
+drgn_program_add_type_finder_impl(struct drgn_program *prog,
+				  drgn_type_find_fn fn, void *arg, bool cached,
+				  bool cacheable)
 {
 	struct drgn_type_finder *finder = malloc(sizeof(*finder));
 	if (!finder)
 		return &drgn_enomem;
 	finder->fn = fn;
 	finder->arg = arg;
+	finder->cached = cached;
+	if (cached)
+		drgn_type_finder_cache_init(&finder->cache);
+	finder->cacheable = cached || cacheable;
 	finder->next = prog->type_finders;
 	prog->type_finders = finder;
+	drgn_program_clear_type_name_cache(prog);
 	return NULL;
 }
 
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_program_add_type_finder(struct drgn_program *prog, drgn_type_find_fn fn,
+			     void *arg)
+{
+	return drgn_program_add_type_finder_impl(prog, fn, arg, false, false);
+}
+
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_program_add_cached_type_finder(struct drgn_program *prog,
+				    drgn_type_find_fn fn, void *arg)
+{
+	return drgn_program_add_type_finder_impl(prog, fn, arg, true, true);
+}
+
+/*
+ * Call a cached type finder, or return its result from a previous call with
+ * the same arguments. Successful lookups and lookups that didn't find anything
+ * are cached, but not errors, which may be transient. Failing to cache isn't
+ * fatal.
+ */
+static struct drgn_error *
+drgn_type_finder_find_cached(struct drgn_program *prog,
+			     struct drgn_type_finder *finder,
+			     enum drgn_type_kind kind, const char *name,
+			     size_t name_len, const char *filename,
+			     struct drgn_qualified_type *ret)
+{
+	struct drgn_type_finder_key key = {
+		.kind = kind,
+		.name = name,
+		.name_len = name_len,
+		.filename = filename,
+	};
+	struct hash_pair hp = drgn_type_finder_cache_hash(&key);
+	drgn_program_lock(prog);
+	struct drgn_type_finder_cache_iterator it =
+		drgn_type_finder_cache_search_hashed(&finder->cache, &key, hp);
+	if (it.entry)
+		*ret = it.entry->value;
+	drgn_program_unlock(prog);
+	if (it.entry)
+		return ret->type ? NULL : &drgn_not_found;
+
+	struct drgn_error *err = finder->fn(kind, name, name_len, filename,
+					    finder->arg, ret);
+	if (err && err != &drgn_not_found)
+		return err;
+
+	size_t filename_size = filename ? strlen(filename) + 1 : 0;
+	char *copy = malloc(name_len + filename_size);
+	if (!copy)
+		return err;
+	memcpy(copy, name, name_len);
+	if (filename)
+		memcpy(copy + name_len, filename, filename_size);
+	struct drgn_type_finder_cache_entry entry = {
+		.key = {
+			.kind = kind,
+			.name = copy,
+			.name_len = name_len,
+			.filename = filename ? copy + name_len : NULL,
+		},
+		.value = err ? (struct drgn_qualified_type){} : *ret,
+	};
+	drgn_program_lock(prog);
+	/* The callback may have looked up the same type recursively. */
+	if (drgn_type_finder_cache_insert_hashed(&finder->cache, &entry, hp,
+						 NULL) <= 0)
+		free(copy);
+	drgn_program_unlock(prog);
+	return err;
+}
+
 struct drgn_error *
 drgn_program_find_type_impl(struct drgn_program *prog,
 			    enum drgn_type_kind kind, const char *name,
@@ -1374,9 +1938,17 @@ drgn_program_find_type_impl(struct drgn_program *prog,
 {
 	struct drgn_type_finder *finder = prog->type_finders;
 	while (finder) {
-		struct drgn_error *err =
-			finder->fn(kind, name, name_len, filename, finder->arg,
-				   ret);
+		struct drgn_error *err;
+		if (!finder->cacheable)
+			prog->uncacheable_type_finds++;
+		if (finder->cached) {
+			err = drgn_type_finder_find_cached(prog, finder, kind,
+							   name, name_len,
+							   filename, ret);
+		} else {
+			err = finder->fn(kind, name, name_len, filename,
+					 finder->arg, ret);
+		}
 		if (!err) {
 			if (drgn_type_program(ret->type) != prog) {
 				return drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
@@ -1395,13 +1967,66 @@ drgn_program_find_type_impl(struct drgn_program *prog,
 	return &drgn_not_found;
 }
 
+static void drgn_program_cache_type_name(struct drgn_program *prog,
+					 const struct drgn_type_name_key *key,
+					 struct hash_pair hp,
+					 const struct drgn_qualified_type *type)
+{
+	size_t name_size = strlen(key->name) + 1;
+	size_t filename_size = key->filename ? strlen(key->filename) + 1 : 0;
+	char *copy = malloc(name_size + filename_size);
+	if (!copy)
+		return;
+	memcpy(copy, key->name, name_size);
+	if (key->filename)
+		memcpy(copy + name_size, key->filename, filename_size);
+	struct drgn_type_name_map_entry entry = {
+		.key = {
+			.lang = key->lang,
+			.name = copy,
+			.filename = key->filename ? copy + name_size : NULL,
+		},
+		.value = type ? *type : (struct drgn_qualified_type){},
+	};
+	/* A type finder may have looked up the same name recursively. */
+	if (drgn_type_name_map_insert_hashed(&prog->type_names, &entry, hp,
+					     NULL) <= 0)
+		free(copy);
+}
+
 LIBDRGN_PUBLIC struct drgn_error *
 drgn_program_find_type(struct drgn_program *prog, const char *name,
 		       const char *filename, struct drgn_qualified_type *ret)
 {
 	struct drgn_error *err;
 	const struct drgn_language *lang = drgn_program_language(prog);
-	err = lang->find_type(lang, prog, name, filename, ret);
+	struct drgn_type_name_key key = {
+		.lang = lang,
+		.name = name,
+		.filename = filename,
+	};
+	struct hash_pair hp = drgn_type_name_map_hash(&key);
+	drgn_program_lock(prog);
+	struct drgn_type_name_map_iterator it =
+		drgn_type_name_map_search_hashed(&prog->type_names, &key, hp);
+	if (it.entry) {
+		*ret = it.entry->value;
+		err = ret->type ? NULL : &drgn_not_found;
+	} else {
+		uint64_t uncacheable_type_finds = prog->uncacheable_type_finds;
+		err = lang->find_type(lang, prog, name, filename, ret);
+		/*
+		 * Cache successful lookups and lookups that didn't find
+		 * anything, but not errors, which may be transient, or lookups
+		 * that called a type finder which may return something
+		 * different next time. Failing to cache isn't fatal.
+		 */
+		if ((!err || err == &drgn_not_found) &&
+		    prog->uncacheable_type_finds == uncacheable_type_finds)
+			drgn_program_cache_type_name(prog, &key, hp,
+						     err ? NULL : ret);
+	}
+	drgn_program_unlock(prog);
 	if (err != &drgn_not_found)
 		return err;
 
@@ -1415,6 +2040,96 @@ drgn_program_find_type(struct drgn_program *prog, const char *name,
 	}
 }
 
+struct drgn_type_iterator {
+	struct drgn_typep_vector types;
+	size_t next;
+};
+
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_type_iterator_create(struct drgn_program *prog,
+			  const enum drgn_type_kind *kinds, size_t num_kinds,
+			  struct drgn_type_iterator **ret)
+{
+	struct drgn_error *err;
+	static const uint64_t supported_kinds =
+		(UINT64_C(1) << DRGN_TYPE_INT) |
+		(UINT64_C(1) << DRGN_TYPE_BOOL) |
+		(UINT64_C(1) << DRGN_TYPE_FLOAT) |
+		(UINT64_C(1) << DRGN_TYPE_STRUCT) |
+		(UINT64_C(1) << DRGN_TYPE_UNION) |
+		(UINT64_C(1) << DRGN_TYPE_CLASS) |
+		(UINT64_C(1) << DRGN_TYPE_ENUM) |
+		(UINT64_C(1) << DRGN_TYPE_TYPEDEF);
+	uint64_t kinds_mask = kinds ? 0 : supported_kinds;
+	for (size_t i = 0; kinds && i < num_kinds; i++) {
+		if ((unsigned int)kinds[i] >= 64 ||
+		    !(supported_kinds & (UINT64_C(1) << kinds[i]))) {
+			return drgn_error_create(DRGN_ERROR_INVALID_ARGUMENT,
+						 "cannot enumerate types of this kind");
+		}
+		kinds_mask |= UINT64_C(1) << kinds[i];
+	}
+
+	struct drgn_type_iterator *it = malloc(sizeof(*it));
+	if (!it)
+		return &drgn_enomem;
+	drgn_typep_vector_init(&it->types);
+	it->next = 0;
+	if (!prog->dbinfo || !kinds_mask)
+		goto out;
+
+	struct drgn_typep_vector types = VECTOR_INIT;
+	drgn_program_lock(prog);
+	err = drgn_debug_info_types(prog->dbinfo, kinds_mask, &types);
+	drgn_program_unlock(prog);
+	if (err)
+		goto err;
+
+	/*
+	 * Different DIEs can produce the same deduplicated type (e.g., equal
+	 * typedefs in different files).
+	 */
+	struct drgn_type_set seen = HASH_TABLE_INIT;
+	for (size_t i = 0; i < types.size; i++) {
+		int r = drgn_type_set_insert(&seen, &types.data[i], NULL);
+		if (r < 0 ||
+		    (r > 0 &&
+		     !drgn_typep_vector_append(&it->types, &types.data[i]))) {
+			drgn_type_set_deinit(&seen);
+			err = &drgn_enomem;
+			goto err;
+		}
+	}
+	drgn_type_set_deinit(&seen);
+	drgn_typep_vector_deinit(&types);
+	drgn_typep_vector_shrink_to_fit(&it->types);
+out:
+	*ret = it;
+	return NULL;
+
+err:
+	drgn_typep_vector_deinit(&types);
+	drgn_typep_vector_deinit(&it->types);
+	free(it);
+	return err;
+}
+
+LIBDRGN_PUBLIC void drgn_type_iterator_destroy(struct drgn_type_iterator *it)
+{
+	if (it) {
+		drgn_typep_vector_deinit(&it->types);
+		free(it);
+	}
+}
+
+LIBDRGN_PUBLIC struct drgn_type *
+drgn_type_iterator_next(struct drgn_type_iterator *it)
+{
+	if (it->next >= it->types.size)
+		return NULL;
+	return it->types.data[it->next++];
+}
+
 /*
  * size_t and ptrdiff_t default to typedefs of whatever integer type matches the
  * word size.
@@ -1461,10 +2176,11 @@ default_size_t_or_ptrdiff_t(struct drgn_program *prog,
 				 drgn_primitive_type_spellings[type][0]);
 }
 
-struct drgn_error *
-drgn_program_find_primitive_type(struct drgn_program *prog,
-				 enum drgn_primitive_type type,
-				 struct drgn_type **ret)
+/* The caller must hold the program lock. */
+static struct drgn_error *
+drgn_program_find_primitive_type_locked(struct drgn_program *prog,
+					enum drgn_primitive_type type,
+					struct drgn_type **ret)
 {
 	struct drgn_error *err;
 	struct drgn_qualified_type qualified_type;
@@ -1587,6 +2303,18 @@ out:
 	return NULL;
 }
 
+struct drgn_error *
+drgn_program_find_primitive_type(struct drgn_program *prog,
+				 enum drgn_primitive_type type,
+				 struct drgn_type **ret)
+{
+	drgn_program_lock(prog);
+	struct drgn_error *err =
+		drgn_program_find_primitive_type_locked(prog, type, ret);
+	drgn_program_unlock(prog);
+	return err;
+}
+
 static struct drgn_error *
 drgn_type_cache_members(struct drgn_type *outer_type,
 			struct drgn_type *type, uint64_t bit_offset)
@@ -1605,7 +2333,6 @@ drgn_type_cache_members(struct drgn_type *outer_type,
 				.key = {
 					.type = outer_type,
 					.name = member->name,
-					.name_len = strlen(member->name),
 				},
 				.value = {
 					.member = member,
@@ -1643,7 +2370,7 @@ drgn_type_offsetof(struct drgn_type *type, const char *member_designator,
 	const struct drgn_language *lang = drgn_type_language(type);
 	uint64_t bit_offset;
 	err = lang->bit_offset(drgn_type_program(type), type, member_designator,
-			       &bit_offset);
+			       NULL, NULL, &bit_offset);
 	if (err)
 		return err;
 	if (bit_offset % 8) {
@@ -1654,6 +2381,17 @@ drgn_type_offsetof(struct drgn_type *type, const char *member_designator,
 	return NULL;
 }
 
+LIBDRGN_PUBLIC struct drgn_error *
+drgn_member_path_init(struct drgn_member_path *path, struct drgn_type *type,
+		      const char *member_designator)
+{
+	const struct drgn_language *lang = drgn_type_language(type);
+	path->type = type;
+	return lang->bit_offset(drgn_type_program(type), type,
+				member_designator, &path->member_type,
+				&path->bit_field_size, &path->bit_offset);
+}
+
 static struct drgn_error *
 drgn_type_find_member_impl(struct drgn_type *type, const char *member_name,
 			   size_t member_name_len,
@@ -1662,15 +2400,21 @@ drgn_type_find_member_impl(struct drgn_type *type, const char *member_name,
 	struct drgn_program *prog = drgn_type_program(type);
 	const struct drgn_member_key key = {
 		.type = drgn_underlying_type(type),
-		.name = member_name,
-		.name_len = member_name_len,
+		/*
+		 * If the name was never interned, then no type has a member by
+		 * that name, but we still need to check the type below.
+		 */
+		.name = drgn_program_find_interned_string(prog, member_name,
+							  member_name_len),
 	};
 	struct hash_pair hp = drgn_member_map_hash(&key);
-	struct drgn_member_map_iterator it =
-		drgn_member_map_search_hashed(&prog->members, &key, hp);
-	if (it.entry) {
-		*ret = &it.entry->value;
-		return NULL;
+	struct drgn_member_map_iterator it;
+	if (key.name) {
+		it = drgn_member_map_search_hashed(&prog->members, &key, hp);
+		if (it.entry) {
+			*ret = &it.entry->value;
+			return NULL;
+		}
 	}
 
 	/*
@@ -1687,6 +2431,10 @@ drgn_type_find_member_impl(struct drgn_type *type, const char *member_name,
 		return drgn_type_error("'%s' is not a structure, union, or class",
 				       type);
 	}
+	if (!key.name) {
+		*ret = NULL;
+		return NULL;
+	}
 	struct hash_pair cached_hp = drgn_type_set_hash(&key.type);
 	if (drgn_type_set_search_hashed(&prog->members_cached, &key.type,
 					cached_hp).entry) {
@@ -1719,9 +2467,20 @@ drgn_type_find_member_len(struct drgn_type *type, const char *member_name,
 			  uint64_t *bit_offset_ret)
 {
 	struct drgn_error *err;
+	struct drgn_program *prog = drgn_type_program(type);
 	struct drgn_member_value *member;
+	/*
+	 * The member map may be resized by other threads, so the value must be
+	 * copied out while holding the lock.
+	 */
+	drgn_program_lock(prog);
 	err = drgn_type_find_member_impl(type, member_name, member_name_len,
 					 &member);
+	if (!err && member) {
+		*member_ret = member->member;
+		*bit_offset_ret = member->bit_offset;
+	}
+	drgn_program_unlock(prog);
 	if (err)
 		return err;
 	if (!member) {
@@ -1739,8 +2498,6 @@ drgn_type_find_member_len(struct drgn_type *type, const char *member_name,
 		free(type_name);
 		return err;
 	}
-	*member_ret = member->member;
-	*bit_offset_ret = member->bit_offset;
 	return NULL;
 }
 
@@ -1749,9 +2506,12 @@ drgn_type_has_member_len(struct drgn_type *type, const char *member_name,
 			 size_t member_name_len, bool *ret)
 {
 	struct drgn_error *err;
+	struct drgn_program *prog = drgn_type_program(type);
 	struct drgn_member_value *member;
+	drgn_program_lock(prog);
 	err = drgn_type_find_member_impl(type, member_name, member_name_len,
 					 &member);
+	drgn_program_unlock(prog);
 	if (err)
 		return err;
 	*ret = member != NULL;
@@ -13,12 +13,14 @@
 #define DRGN_TYPE_H
 
 #include <assert.h>
+#include <stddef.h>
 
 #include "drgn.h"
 #include "hash_table.h"
 #include "vector.h"
 
 struct drgn_language;
+struct string_builder;
 
 /**
  * @ingroup Internals
@@ -50,23 +52,66 @@ drgn_byte_order_from_little_endian(bool little_endian)
 	return little_endian ? DRGN_LITTLE_ENDIAN : DRGN_BIG_ENDIAN;
 }
 
+/** Arguments of a lookup in a @ref drgn_type_finder_cache. */
+struct drgn_type_finder_key {
+	/** Kind of type. */
+	enum drgn_type_kind kind;
+	/** Name of type. This is not null-terminated. */
+	const char *name;
+	/** Length of @ref name. */
+	size_t name_len;
+	/** Filename, or @c NULL if none was given. */
+	const char *filename;
+};
+
+#ifdef DOXYGEN
+/**
+ * @struct drgn_type_finder_cache
+ *
+ * Map of the lookups done by a cached @ref drgn_type_finder to their results.
+ *
+ * The key is a @ref drgn_type_finder_key, and the value is a @ref
+ * drgn_qualified_type, whose type is @c NULL if the callback didn't find
+ * anything.
+ */
+#else
+DEFINE_HASH_MAP_TYPE(drgn_type_finder_cache, struct drgn_type_finder_key,
+		     struct drgn_qualified_type)
+#endif
+
 /** Registered type finding callback in a @ref drgn_program. */
 struct drgn_type_finder {
 	/** The callback. */
 	drgn_type_find_fn fn;
 	/** Argument to pass to @ref drgn_type_finder::fn. */
 	void *arg;
+	/** Whether the results of @ref fn are cached in @ref cache. */
+	bool cached;
+	/**
+	 * Results of @ref fn. Only used if @ref cached. Entries are never
+	 * invalidated.
+	 */
+	struct drgn_type_finder_cache cache;
+	/**
+	 * Whether @ref fn only finds different types after @ref
+	 * drgn_program_clear_type_name_cache(), so that lookups it is called
+	 * for can be cached in @ref drgn_program::type_names. This is true for
+	 * @ref cached finders and built-in finders.
+	 */
+	bool cacheable;
 	/** Next callback to try. */
 	struct drgn_type_finder *next;
 };
 
 DEFINE_HASH_SET_TYPE(drgn_dedupe_type_set, struct drgn_type *)
 
-/** <tt>(type, member name)</tt> pair. */
+/**
+ * <tt>(type, member name)</tt> pair. The name is interned, so it is compared by
+ * pointer.
+ */
 struct drgn_member_key {
 	struct drgn_type *type;
 	const char *name;
-	size_t name_len;
 };
 
 /** Type, offset, and bit field size of a type member. */
@@ -75,6 +120,53 @@ struct drgn_member_value {
 	uint64_t bit_offset;
 };
 
+/** Arguments of a @ref drgn_program_find_type() lookup. */
+struct drgn_type_name_key {
+	/** Language that the name was parsed in. */
+	const struct drgn_language *lang;
+	/** Type name. */
+	const char *name;
+	/** Filename, or @c NULL if none was given. */
+	const char *filename;
+};
+
+/**
+ * String interned in a @ref drgn_program.
+ *
+ * Every name and tag in a type created by a program (type names, tags, and the
+ * names of members, enumerators, parameters, and template parameters) points
+ * to the @c str of one of these. Two such names in the same program are equal
+ * if and only if they are the same pointer, and their lengths and hashes are
+ * stored with them.
+ */
+struct drgn_interned_string {
+	/** @c hash_bytes() of the string. */
+	size_t hash;
+	/** Length of the string, excluding the null terminator. */
+	size_t len;
+	/** Null-terminated string. */
+	char str[];
+};
+
+/**
+ * Get the @ref drgn_interned_string of a name or tag in a type created by a
+ * program.
+ */
+static inline const struct drgn_interned_string *
+drgn_interned_string(const char *str)
+{
+	return (const struct drgn_interned_string *)
+		(str - offsetof(struct drgn_interned_string, str));
+}
+
+/**
+ * Lookup indexes of an enumerated type.
+ *
+ * These are created lazily by @ref drgn_enum_type_find_value() and @ref
+ * drgn_enum_type_format_flags() and are owned by the program.
+ */
+struct drgn_enum_type_index;
+
 #ifdef DOXYGEN
 /**
  * @struct drgn_member_map
@@ -86,20 +178,44 @@ struct drgn_member_value {
  * @struct drgn_type_set
  *
  * Set of types compared by address.
+ *
+ * @struct drgn_interned_string_table
+ *
+ * Set of @ref drgn_interned_string "interned strings" compared by value.
+ *
+ * @struct drgn_type_name_map
+ *
+ * Map of type name lookups to results.
+ *
+ * The key is a @ref drgn_type_name_key, and the value is a @ref
+ * drgn_qualified_type, whose type is @c NULL if the name was not found.
+ *
+ * @struct drgn_enum_type_index_map
+ *
+ * Map from enumerated type to its @ref drgn_enum_type_index.
  */
 #else
 DEFINE_HASH_MAP_TYPE(drgn_member_map, struct drgn_member_key,
 		      struct drgn_member_value)
 DEFINE_HASH_SET_TYPE(drgn_type_set, struct drgn_type *)
+DEFINE_HASH_TABLE_TYPE(drgn_interned_string_table,
+		       struct drgn_interned_string *)
+DEFINE_HASH_MAP_TYPE(drgn_type_name_map, struct drgn_type_name_key,
+		     struct drgn_qualified_type)
+DEFINE_HASH_MAP_TYPE(drgn_enum_type_index_map, struct drgn_type *,
+		     struct drgn_enum_type_index *)
 #endif
 
+
 /**
  * @defgroup TypeCreation Type creation
  *
  * Creating type descriptors.
  *
  * These functions create type descriptors. They are valid for the lifetime of
- * the program that owns them.
+ * the program that owns them. Names and tags are interned in the program (see
+ * @ref drgn_interned_string), so the types don't refer to the strings passed
+ * to these functions.
  *
  * A few kinds of types have variable-length fields: structure, union, and class
  * types have members, enumerated types have enumerators, and function types
@@ -563,11 +679,64 @@ struct drgn_error *drgn_type_bit_size(struct drgn_type *type,
 /** Get the appropriate @ref drgn_object_encoding for a @ref drgn_type. */
 enum drgn_object_encoding drgn_type_object_encoding(struct drgn_type *type);
 
+/**
+ * Find the first enumerator of an enumerated type with a given value.
+ *
+ * Enumerated types with many enumerators are indexed by value the first time
+ * they are searched.
+ *
+ * @param[in] type Complete enumerated type.
+ * @param[in] value Value to find. For signed enumerated types, this is the
+ * two's complement representation of the value.
+ * @return Enumerator, or @c NULL if no enumerator has the value.
+ */
+const struct drgn_type_enumerator *
+drgn_enum_type_find_value(struct drgn_type *type, uint64_t value);
+
+/**
+ * Format a bitmask of flags defined by the enumerators of an enumerated type.
+ *
+ * This is the C implementation of @c drgn.helpers.decode_enum_type_flags(). The
+ * flags of the type are compiled into a table the first time it is decoded.
+ *
+ * @param[in] type Enumerated type.
+ * @param[in] value Bitmask to decode.
+ * @param[in] bit_numbers Whether the enumerator values specify the bit numbers
+ * or values of the flags.
+ * @param[in] sb String builder to append to.
+ */
+struct drgn_error *drgn_enum_type_format_flags(struct drgn_type *type,
+					       uint64_t value, bool bit_numbers,
+					       struct string_builder *sb);
+
 /** Initialize type-related fields in a @ref drgn_program. */
 void drgn_program_init_types(struct drgn_program *prog);
 /** Deinitialize type-related fields in a @ref drgn_program. */
 void drgn_program_deinit_types(struct drgn_program *prog);
 
+/**
+ * Discard the results of @ref drgn_program_find_type() cached in @ref
+ * drgn_program::type_names.
+ *
+ * This must be called whenever the types that can be found may have changed
+ * (e.g., when a type finder is added or debugging information is loaded).
+ */
+void drgn_program_clear_type_name_cache(struct drgn_program *prog);
+
+/**
+ * @sa drgn_program_add_type_finder()
+ * @sa drgn_program_add_cached_type_finder()
+ *
+ * @param[in] cached Whether to cache the results of @p fn.
+ * @param[in] cacheable Whether lookups that call @p fn may be cached in @ref
+ * drgn_program::type_names (see @ref drgn_type_finder::cacheable). Implied by
+ * @p cached.
+ */
+struct drgn_error *
+drgn_program_add_type_finder_impl(struct drgn_program *prog,
+				  drgn_type_find_fn fn, void *arg, bool cached,
+				  bool cacheable);
+
 /**
  * Find a parsed type in a @ref drgn_program.
  *
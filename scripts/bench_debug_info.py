@@ -0,0 +1,221 @@
+#!/usr/bin/env python3
+# Copyright (c) Meta Platforms, Inc. and affiliates.
+# SPDX-License-Identifier: GPL-3.0-or-later
+
+# Benchmark loading debugging information. Build drgn in place first (e.g.,
+# with "python3 setup.py build_ext -i"), then run this from the top of the
+# source tree.
+
+import argparse
+import json
+import os
+import resource
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+METRICS = (
+    "wall_time",
+    "peak_rss",
+    "read_modules",
+    "first_pass",
+    "second_pass",
+    "debug_names",
+)
+
+
+def synthetic_dwarf(num_cus, debug_names):
+    from tests.dwarf import DW_AT, DW_ATE, DW_FORM, DW_TAG
+    from tests.dwarfwriter import DwarfAttrib, DwarfDie, compile_dwarf
+
+    def cu(i):
+        return DwarfDie(
+            DW_TAG.compile_unit,
+            (DwarfAttrib(DW_AT.name, DW_FORM.string, f"file{i}.c"),),
+            (
+                DwarfDie(
+                    DW_TAG.base_type,
+                    (
+                        DwarfAttrib(DW_AT.byte_size, DW_FORM.data1, 4),
+                        DwarfAttrib(DW_AT.encoding, DW_FORM.data1, DW_ATE.signed),
+                        DwarfAttrib(DW_AT.name, DW_FORM.string, "int"),
+                    ),
+                ),
+                *(
+                    DwarfDie(
+                        DW_TAG.structure_type,
+                        (
+                            DwarfAttrib(DW_AT.name, DW_FORM.string, f"s{i}_{j}"),
+                            DwarfAttrib(DW_AT.byte_size, DW_FORM.data1, 16),
+                            DwarfAttrib(DW_AT.decl_line, DW_FORM.udata, 100 * j),
+                        ),
+                        tuple(
+                            DwarfDie(
+                                DW_TAG.member,
+                                (
+                                    DwarfAttrib(DW_AT.name, DW_FORM.string, f"m{k}"),
+                                    DwarfAttrib(DW_AT.type, DW_FORM.ref4, 0),
+                                    DwarfAttrib(
+                                        DW_AT.data_member_location,
+                                        DW_FORM.data1,
+                                        4 * k,
+                                    ),
+                                ),
+                            )
+                            for k in range(4)
+                        ),
+                    )
+                    for j in range(16)
+                ),
+                *(
+                    DwarfDie(
+                        DW_TAG.variable,
+                        (
+                            DwarfAttrib(DW_AT.name, DW_FORM.string, f"v{i}_{j}"),
+                            DwarfAttrib(DW_AT.type, DW_FORM.ref4, 0),
+                            DwarfAttrib(DW_AT.const_value, DW_FORM.sdata, j),
+                        ),
+                    )
+                    for j in range(16)
+                ),
+            ),
+        )
+
+    return compile_dwarf([cu(i) for i in range(num_cus)], debug_names=debug_names)
+
+
+def run_once(paths):
+    import drgn
+    from tests.libdrgn import debug_info_timings
+
+    prog = drgn.Program()
+    start = time.monotonic()
+    try:
+        prog.load_debug_info(paths)
+    except drgn.MissingDebugInfoError as e:
+        print(e, file=sys.stderr)
+    wall_time = time.monotonic() - start
+    result = {
+        "wall_time": wall_time,
+        # ru_maxrss is in kilobytes on Linux.
+        "peak_rss": resource.getrusage(resource.RUSAGE_SELF).ru_maxrss * 1024,
+    }
+    result.update(debug_info_timings(prog))
+    return result
+
+
+def run_case(name, paths, runs, env):
+    results = []
+    for _ in range(runs):
+        # Run each load in a new process so that the peak RSS and the page
+        # cache warmup of one run don't affect the next one.
+        output = subprocess.check_output(
+            [sys.executable, __file__, "--child", "--", *paths],
+            env={**os.environ, **env},
+        )
+        results.append(json.loads(output))
+    return {
+        "name": name,
+        "paths": paths,
+        "env": env,
+        "runs": results,
+        "median": {
+            metric: statistics.median(result[metric] for result in results)
+            for metric in METRICS
+        },
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="benchmark loading debugging information and output JSON"
+    )
+    parser.add_argument(
+        "-n", "--runs", type=int, default=5, help="number of runs of each case"
+    )
+    parser.add_argument(
+        "-s",
+        "--synthetic",
+        type=int,
+        default=1000,
+        metavar="N",
+        help="number of compilation units in the synthetic DWARF cases "
+        "(0 to skip them; default: 1000)",
+    )
+    parser.add_argument(
+        "-e",
+        "--env",
+        action="append",
+        default=[],
+        metavar="VAR=VALUE",
+        help="set an environment variable for every run (e.g., "
+        "DRGN_LAZY_DWARF_INDEX=1); may be given multiple times",
+    )
+    parser.add_argument(
+        "-t",
+        "--threads",
+        type=lambda s: [int(n) for n in s.split(",")],
+        metavar="N[,N...]",
+        help="run every case with each of these numbers of threads (via "
+        "OMP_NUM_THREADS) to measure scaling, e.g., 1,2,4,8,16,32,64,128 "
+        "(default: OpenMP's default)",
+    )
+    parser.add_argument(
+        "-o", "--output", help="file to write JSON results to (default: stdout)"
+    )
+    parser.add_argument("--child", action="store_true", help=argparse.SUPPRESS)
+    parser.add_argument(
+        "paths",
+        metavar="PATH",
+        nargs="*",
+        help="debugging information file (e.g., vmlinux or a kernel module) to "
+        "load together as one case",
+    )
+    args = parser.parse_args()
+
+    if args.child:
+        json.dump(run_once(args.paths), sys.stdout)
+        return
+
+    import drgn
+
+    base_env = dict(var.split("=", 1) for var in args.env)
+    if args.threads:
+        envs = [
+            (f"_{threads}_threads", {**base_env, "OMP_NUM_THREADS": str(threads)})
+            for threads in args.threads
+        ]
+    else:
+        envs = [("", base_env)]
+    cases = []
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        paths = []
+        if args.synthetic:
+            for debug_names in (False, True):
+                name = "synthetic" + ("_debug_names" if debug_names else "")
+                path = os.path.join(tmp_dir, name)
+                with open(path, "wb") as f:
+                    f.write(synthetic_dwarf(args.synthetic, debug_names))
+                paths.append((name, [path]))
+        if args.paths:
+            paths.append(("files", args.paths))
+        for name, case_paths in paths:
+            for suffix, env in envs:
+                cases.append(run_case(name + suffix, case_paths, args.runs, env))
+
+    results = {"drgn_version": drgn.__version__, "cases": cases}
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(results, f, indent=2)
+            f.write("\n")
+    else:
+        json.dump(results, sys.stdout, indent=2)
+        print()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,73 @@
+// Copyright (c) Meta Platforms, Inc. and affiliates.
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/*
+ * Micro-benchmark comparing the generic deserialize_bits() to the specialized
+ * functions from deserialize_bits_fn() for byte-aligned values, which is what
+ * reading most integer and pointer members looks like. Build and run with:
+ *
+ *   gcc -O2 -I libdrgn -o bench_deserialize scripts/bench_deserialize.c \
+ *     libdrgn/serialize.c && ./bench_deserialize
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "serialize.h"
+
+#define BUF_SIZE (64 * 1024 * 1024)
+#define ITERATIONS 5
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(void)
+{
+	char *buf = malloc(BUF_SIZE);
+	assert(buf);
+	srand(1);
+	for (size_t i = 0; i < BUF_SIZE; i++)
+		buf[i] = rand();
+
+	static const unsigned int bit_sizes[] = { 8, 16, 32, 64 };
+	for (size_t i = 0; i < sizeof(bit_sizes) / sizeof(bit_sizes[0]); i++) {
+		for (int little_endian = 1; little_endian >= 0; little_endian--) {
+			unsigned int bit_size = bit_sizes[i];
+			size_t size = bit_size / 8;
+			size_t num_values = BUF_SIZE / size;
+			deserialize_fn *fn = deserialize_bits_fn(bit_size,
+								 little_endian);
+			assert(fn);
+			double generic = 0, specialized = 0;
+			for (int j = 0; j < ITERATIONS; j++) {
+				uint64_t sum1 = 0, sum2 = 0;
+				double start = now();
+				for (size_t k = 0; k < num_values; k++) {
+					sum1 += deserialize_bits(buf + k * size,
+								 0, bit_size,
+								 little_endian);
+				}
+				double mid = now();
+				for (size_t k = 0; k < num_values; k++)
+					sum2 += fn(buf + k * size);
+				double end = now();
+
+				assert(sum1 == sum2);
+				generic += mid - start;
+				specialized += end - mid;
+			}
+			printf("%2u-bit %s: %.2f ns/value generic, %.2f ns/value specialized\n",
+			       bit_size, little_endian ? "little-endian" : "big-endian   ",
+			       generic * 1e9 / (ITERATIONS * num_values),
+			       specialized * 1e9 / (ITERATIONS * num_values));
+		}
+	}
+	free(buf);
+	return 0;
+}
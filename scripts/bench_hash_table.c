@@ -0,0 +1,370 @@
+// Copyright (c) Meta Platforms, Inc. and affiliates.
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/*
+ * Micro-benchmark and stress test for hash tables. Build with:
+ *
+ *   gcc -O2 -I libdrgn -o bench_hash_table scripts/bench_hash_table.c \
+ *     libdrgn/hash_table.c
+ *
+ * Run ./bench_hash_table to time insert, search (hits and misses), iteration,
+ * and delete for the key types drgn uses (u64, pointer, and nstring) at
+ * several sizes and load factors, and to report memory per entry. u64 keys are
+ * hashed both with int_key_hash_pair() and with cityhash to compare the two.
+ *
+ * Compare the vectorized and CRC32C paths against the scalar fallbacks by
+ * building with different target flags. E.g., add -msse4.2 on x86-64 or
+ * -march=armv8-a+crc on AArch64 for CRC32C, or -U__SSE2__ or -U__ARM_NEON for
+ * the scalar tag matching fallback.
+ *
+ * Run ./bench_hash_table stress [iterations [seed]] to instead apply random
+ * operations to tables using both storage policies and check them against a
+ * reference after every operation. This is best built with -fsanitize=address
+ * and without -DNDEBUG.
+ */
+
+#include <assert.h>
+#include <inttypes.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "array.h"
+#include "hash_table.h"
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t splitmix64(uint64_t *state)
+{
+	uint64_t z = (*state += UINT64_C(0x9e3779b97f4a7c15));
+	z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+	z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+	return z ^ (z >> 31);
+}
+
+static size_t allocated_bytes(void)
+{
+	/* Large allocations are mmap()ed and only counted in hblkhd. */
+	struct mallinfo2 info = mallinfo2();
+	return info.uordblks + info.hblkhd;
+}
+
+static inline struct hash_pair u64_cityhash_pair(const uint64_t *key)
+{
+	return hash_pair_from_avalanching_hash(hash_bytes(key, sizeof(*key)));
+}
+
+struct big_value {
+	uint64_t a[3];
+};
+
+DEFINE_HASH_SET(u64_set, uint64_t, int_key_hash_pair, scalar_key_eq);
+DEFINE_HASH_SET(u64_city_set, uint64_t, u64_cityhash_pair, scalar_key_eq);
+DEFINE_HASH_SET(ptr_set, const void *, ptr_key_hash_pair, scalar_key_eq);
+DEFINE_HASH_SET(nstring_set, struct nstring, nstring_hash_pair, nstring_eq);
+/* Entries are 32 bytes, so this uses the vector storage policy. */
+DEFINE_HASH_MAP(u64_big_map, uint64_t, struct big_value, int_key_hash_pair,
+		scalar_key_eq);
+
+/* Run enough operations per measurement to get a stable result. */
+#define MIN_OPS (4 * 1024 * 1024)
+
+/*
+ * Benchmark a table. keys[0] through keys[n - 1] are inserted, and keys[n]
+ * through keys[2 * n - 1] are searched for but never inserted. If reserve is
+ * true, space for 2 * n entries is reserved first to get a lower load factor.
+ */
+#define DEFINE_BENCH(table)							\
+static void bench_##table(const char *name, const table##_key_type *keys,	\
+			  size_t n, bool reserve)				\
+{										\
+	size_t reps = n >= MIN_OPS ? 1 : MIN_OPS / n;				\
+	double insert = 0, hit = 0, miss = 0, iterate = 0, delete = 0;		\
+	double load = 0;							\
+	size_t memory = 0, found = 0;						\
+	for (size_t rep = 0; rep < reps; rep++) {				\
+		struct table t;							\
+		table##_init(&t);						\
+		size_t allocated_before = allocated_bytes();			\
+		if (reserve) {							\
+			bool ok = table##_reserve(&t, 2 * n);			\
+			assert(ok);						\
+			(void)ok;						\
+		}								\
+										\
+		double start = now();						\
+		for (size_t i = 0; i < n; i++) {				\
+			table##_entry_type entry;				\
+			memset(&entry, 0, sizeof(entry));			\
+			memcpy(&entry, &keys[i], sizeof(keys[i]));		\
+			int r = table##_insert(&t, &entry, NULL);		\
+			assert(r > 0);						\
+			(void)r;						\
+		}								\
+		double end = now();						\
+		insert += end - start;						\
+		if (rep == 0) {							\
+			memory = allocated_bytes() - allocated_before;		\
+			size_t capacity = table##_compute_capacity(		\
+				table##_chunk_mask(&t) + 1,			\
+				table##_chunk_capacity_scale(t.chunks));	\
+			load = (double)n / capacity;				\
+		}								\
+										\
+		start = now();							\
+		for (size_t i = 0; i < n; i++)					\
+			found += table##_search(&t, &keys[i]).entry != NULL;	\
+		end = now();							\
+		hit += end - start;						\
+										\
+		start = now();							\
+		for (size_t i = n; i < 2 * n; i++)				\
+			found += table##_search(&t, &keys[i]).entry != NULL;	\
+		end = now();							\
+		miss += end - start;						\
+										\
+		start = now();							\
+		size_t count = 0;						\
+		for (struct table##_iterator it = table##_first(&t);		\
+		     it.entry; it = table##_next(it))				\
+			count++;						\
+		end = now();							\
+		iterate += end - start;						\
+		assert(count == n);						\
+										\
+		start = now();							\
+		for (size_t i = 0; i < n; i++) {				\
+			bool deleted = table##_delete(&t, &keys[i]);		\
+			assert(deleted);					\
+			(void)deleted;						\
+		}								\
+		end = now();							\
+		delete += end - start;						\
+										\
+		table##_deinit(&t);						\
+	}									\
+	assert(found == reps * n);						\
+	double ops = (double)reps * n;						\
+	printf("%-28s %8zu %5.2f %7.1f %7.2f %7.2f %7.2f %7.2f %7.2f\n",	\
+	       name, n, load, (double)memory / n, insert * 1e9 / ops,		\
+	       hit * 1e9 / ops, miss * 1e9 / ops, iterate * 1e9 / ops,		\
+	       delete * 1e9 / ops);						\
+}
+
+DEFINE_BENCH(u64_set)
+DEFINE_BENCH(u64_city_set)
+DEFINE_BENCH(ptr_set)
+DEFINE_BENCH(nstring_set)
+DEFINE_BENCH(u64_big_map)
+
+static void shuffle_u64(uint64_t *array, size_t n, uint64_t *state)
+{
+	for (size_t i = n - 1; i > 0; i--) {
+		size_t j = splitmix64(state) % (i + 1);
+		uint64_t tmp = array[i];
+		array[i] = array[j];
+		array[j] = tmp;
+	}
+}
+
+static void bench(void)
+{
+	static const size_t sizes[] = { 1024, 64 * 1024, 1024 * 1024 };
+	const size_t max_n = sizes[array_size(sizes) - 1];
+	uint64_t state = 1;
+
+	/*
+	 * Integer keys in drgn are mostly addresses and offsets, which are
+	 * aligned and clustered, so use multiples of 16 in a random order.
+	 * Misses are the odd multiples of 8 in between.
+	 */
+	uint64_t *u64_keys = malloc_array(2 * max_n, sizeof(*u64_keys));
+	const void **ptr_keys = malloc_array(2 * max_n, sizeof(*ptr_keys));
+	struct nstring *nstring_keys = malloc_array(2 * max_n,
+						    sizeof(*nstring_keys));
+	/* Enough for "miss_" or "name_" and 16 hex digits. */
+	char *strings = malloc(2 * max_n * 24);
+	assert(u64_keys && ptr_keys && nstring_keys && strings);
+	char *p = strings;
+	for (size_t i = 0; i < 2 * max_n; i++) {
+		int len = sprintf(p, "%s_%" PRIx64,
+				  i < max_n ? "name" : "miss",
+				  splitmix64(&state));
+		nstring_keys[i].str = p;
+		nstring_keys[i].len = len;
+		p += len + 1;
+	}
+
+	printf("int_key_hash_pair() uses %s; tag matching uses %s\n\n",
+#if defined(__SSE4_2__) || defined(__ARM_FEATURE_CRC32)
+	       "CRC32C",
+#else
+	       "a multiplicative mixer",
+#endif
+#if defined(__SSE2__)
+	       "SSE2"
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+	       "NEON"
+#else
+	       "a scalar loop"
+#endif
+	       );
+	printf("%-28s %8s %5s %7s %7s %7s %7s %7s %7s\n", "table", "entries",
+	       "load", "B/entry", "insert", "hit", "miss", "iterate",
+	       "delete");
+	printf("%28s %8s %5s %7s %7s %7s %7s %7s %7s\n", "", "", "", "",
+	       "ns/op", "ns/op", "ns/op", "ns/op", "ns/op");
+
+	for (size_t i = 0; i < array_size(sizes); i++) {
+		size_t n = sizes[i];
+		for (size_t j = 0; j < n; j++) {
+			u64_keys[j] = UINT64_C(0x1000) + 16 * j;
+			u64_keys[n + j] = u64_keys[j] + 8;
+		}
+		shuffle_u64(u64_keys, n, &state);
+		shuffle_u64(u64_keys + n, n, &state);
+		/* Like kernel direct mapping addresses of 64-byte objects. */
+		for (size_t j = 0; j < 2 * n; j++) {
+			ptr_keys[j] = (const void *)(uintptr_t)
+				(UINT64_C(0xffff888000000000) + 4 * u64_keys[j]);
+		}
+		/* Use the names at the start and the misses at the end. */
+		struct nstring *nstrings = nstring_keys + max_n - n;
+
+		for (int reserve = 0; reserve <= 1; reserve++) {
+			bench_u64_set("u64 (int_key_hash_pair)", u64_keys, n,
+				      reserve);
+			bench_u64_city_set("u64 (cityhash)", u64_keys, n,
+					   reserve);
+			bench_ptr_set("pointer", ptr_keys, n, reserve);
+			bench_nstring_set("nstring", nstrings, n, reserve);
+			bench_u64_big_map("u64 -> 24 bytes (vector)",
+					  u64_keys, n, reserve);
+		}
+		printf("\n");
+	}
+
+	free(strings);
+	free(nstring_keys);
+	free(ptr_keys);
+	free(u64_keys);
+}
+
+/* Keys are drawn from a small range so that operations often collide. */
+#define STRESS_KEY_RANGE 4096
+
+/*
+ * Apply random operations to a table and check it against a reference
+ * after each one.
+ */
+#define DEFINE_STRESS(table)							\
+static void stress_##table(size_t iterations, uint64_t *state)			\
+{										\
+	static bool present[STRESS_KEY_RANGE];					\
+	size_t size = 0;							\
+	memset(present, 0, sizeof(present));					\
+	struct table t;								\
+	table##_init(&t);							\
+	for (size_t i = 0; i < iterations; i++) {				\
+		uint64_t r = splitmix64(state);					\
+		uint64_t key = (r >> 8) % STRESS_KEY_RANGE;			\
+		table##_entry_type entry;					\
+		memset(&entry, 0, sizeof(entry));				\
+		memcpy(&entry, &key, sizeof(key));				\
+		switch (r % 16) {						\
+		case 0 ... 6: {							\
+			int ret = table##_insert(&t, &entry, NULL);		\
+			assert(ret == (present[key] ? 0 : 1));			\
+			if (!present[key]) {					\
+				present[key] = true;				\
+				size++;						\
+			}							\
+			break;							\
+		}								\
+		case 7 ... 11: {						\
+			bool deleted = table##_delete(&t, &key);		\
+			assert(deleted == present[key]);			\
+			if (deleted) {						\
+				present[key] = false;				\
+				size--;						\
+			}							\
+			break;							\
+		}								\
+		case 12 ... 13: {						\
+			struct table##_iterator it = table##_search(&t, &key);	\
+			assert((it.entry != NULL) == present[key]);		\
+			if (it.entry) {						\
+				table##_delete_iterator(&t, it);		\
+				present[key] = false;				\
+				size--;						\
+			}							\
+			break;							\
+		}								\
+		case 14: {							\
+			size_t count = 0;					\
+			for (struct table##_iterator it = table##_first(&t);	\
+			     it.entry; it = table##_next(it)) {			\
+				uint64_t k;					\
+				memcpy(&k, it.entry, sizeof(k));		\
+				assert(present[k]);				\
+				count++;					\
+			}							\
+			assert(count == size);					\
+			break;							\
+		}								\
+		case 15:							\
+			if (r % 1024 == 15) {					\
+				table##_clear(&t);				\
+				memset(present, 0, sizeof(present));		\
+				size = 0;					\
+			} else {						\
+				bool ok = table##_reserve(&t,			\
+							  size + r % 512);	\
+				assert(ok);					\
+				(void)ok;					\
+			}							\
+			break;							\
+		}								\
+		assert(table##_size(&t) == size);				\
+	}									\
+	for (uint64_t key = 0; key < STRESS_KEY_RANGE; key++) {			\
+		assert((table##_search(&t, &key).entry != NULL) ==		\
+		       present[key]);						\
+	}									\
+	table##_deinit(&t);							\
+}
+
+DEFINE_STRESS(u64_set)
+DEFINE_STRESS(u64_big_map)
+
+static void stress(size_t iterations, uint64_t seed)
+{
+	uint64_t state = seed;
+	stress_u64_set(iterations, &state);
+	stress_u64_big_map(iterations, &state);
+	printf("%zu iterations with seed %" PRIu64 " passed\n", iterations,
+	       seed);
+}
+
+int main(int argc, char **argv)
+{
+	if (argc >= 2 && strcmp(argv[1], "stress") == 0) {
+		size_t iterations = argc >= 3 ? strtoull(argv[2], NULL, 0)
+					       : 10000000;
+		uint64_t seed = argc >= 4 ? strtoull(argv[3], NULL, 0) : 1;
+		stress(iterations, seed);
+	} else if (argc >= 2) {
+		fprintf(stderr, "usage: %s [stress [iterations [seed]]]\n",
+			argv[0]);
+		return 1;
+	} else {
+		bench();
+	}
+	return 0;
+}
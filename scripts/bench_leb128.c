@@ -0,0 +1,96 @@
+// Copyright (c) Meta Platforms, Inc. and affiliates.
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/*
+ * Micro-benchmark for skipping runs of LEB128 numbers, which the DWARF indexer
+ * does for consecutive LEB128 attributes. Build and run with:
+ *
+ *   gcc -O2 -I libdrgn -o bench_leb128 scripts/bench_leb128.c && ./bench_leb128
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "binary_buffer.h"
+
+/*
+ * The benchmark never hits an error, so it doesn't need the real error
+ * formatting from libdrgn.
+ */
+struct drgn_error *binary_buffer_error_at(struct binary_buffer *bb,
+					  const char *pos, const char *format,
+					  ...)
+{
+	abort();
+}
+
+static struct drgn_error *error_fn(struct binary_buffer *bb, const char *pos,
+				   const char *message)
+{
+	abort();
+}
+
+#define NUM_NUMBERS (16 * 1024 * 1024)
+#define ITERATIONS 10
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(void)
+{
+	/* Mostly one- and two-byte numbers, like typical DWARF constants. */
+	char *buf = malloc(NUM_NUMBERS * 10);
+	assert(buf);
+	size_t size = 0;
+	srand(1);
+	for (size_t i = 0; i < NUM_NUMBERS; i++) {
+		int r = rand() % 16;
+		uint64_t value = r < 10 ? rand() % 128 :
+				 r < 15 ? rand() % 16384 : (uint64_t)rand() << 20;
+		do {
+			uint8_t byte = value & 0x7f;
+			value >>= 7;
+			if (value)
+				byte |= 0x80;
+			buf[size++] = byte;
+		} while (value);
+	}
+
+	static const size_t run_lengths[] = { 1, 2, 3, 4, 8, 16 };
+	for (size_t i = 0; i < sizeof(run_lengths) / sizeof(run_lengths[0]);
+	     i++) {
+		size_t run = run_lengths[i];
+		size_t num_runs = NUM_NUMBERS / run;
+		double one_at_a_time = 0, batched = 0;
+		for (int j = 0; j < ITERATIONS; j++) {
+			struct binary_buffer bb1, bb2;
+			binary_buffer_init(&bb1, buf, size, true, error_fn);
+			binary_buffer_init(&bb2, buf, size, true, error_fn);
+
+			double start = now();
+			for (size_t k = 0; k < num_runs; k++) {
+				for (size_t l = 0; l < run; l++)
+					binary_buffer_skip_leb128(&bb1);
+			}
+			double mid = now();
+			for (size_t k = 0; k < num_runs; k++)
+				binary_buffer_skip_leb128s(&bb2, run);
+			double end = now();
+
+			assert(bb1.pos == bb2.pos);
+			one_at_a_time += mid - start;
+			batched += end - mid;
+		}
+		printf("run of %2zu: %.2f ns/number one at a time, %.2f ns/number batched\n",
+		       run, one_at_a_time * 1e9 / (ITERATIONS * num_runs * run),
+		       batched * 1e9 / (ITERATIONS * num_runs * run));
+	}
+	free(buf);
+	return 0;
+}
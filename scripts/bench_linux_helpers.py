@@ -0,0 +1,221 @@
+#!/usr/bin/env python3
+# Copyright (c) Meta Platforms, Inc. and affiliates.
+# SPDX-License-Identifier: GPL-3.0-or-later
+
+# Benchmark the Linux kernel helpers on standard workloads. Build drgn in place
+# first (e.g., with "python3 setup.py build_ext -i"), then run this from the
+# top of the source tree, either as root on the running kernel (e.g., in a
+# vmtest VM) or against a vmcore with -c.
+
+import argparse
+import json
+import os
+import resource
+import statistics
+import subprocess
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+METRICS = (
+    "load_time",
+    "wall_time",
+    "count",
+    "objects_per_second",
+    "megabytes_per_second",
+    "peak_rss",
+)
+
+
+def bench_for_each_task(prog):
+    from drgn.helpers.linux.pid import for_each_task
+
+    count = 0
+    for task in for_each_task(prog):
+        task.comm.string_()
+        count += 1
+    return count, count * prog.type("struct task_struct").size
+
+
+def bench_slab_dentry(prog):
+    from drgn.helpers.linux.slab import (
+        find_slab_cache,
+        slab_cache_for_each_allocated_object,
+    )
+
+    slab_cache = find_slab_cache(prog, "dentry")
+    if slab_cache is None:
+        raise LookupError("dentry slab cache not found")
+    count = 0
+    for _ in slab_cache_for_each_allocated_object(slab_cache, "struct dentry"):
+        count += 1
+    return count, count * slab_cache.object_size.value_()
+
+
+def bench_for_each_page(prog):
+    from drgn import FaultError
+    from drgn.helpers.linux.mm import for_each_page
+
+    count = 0
+    for page in for_each_page(prog):
+        try:
+            page.flags.value_()
+        except FaultError:
+            continue
+        count += 1
+    return count, count * prog.type("struct page").size
+
+
+def bench_get_dmesg(prog):
+    from drgn.helpers.linux.printk import get_dmesg
+
+    dmesg = get_dmesg(prog)
+    return dmesg.count(b"\n"), len(dmesg)
+
+
+def bench_stack_traces(prog):
+    from drgn.helpers.linux.pid import for_each_task
+
+    count = 0
+    for task in for_each_task(prog):
+        try:
+            trace = prog.stack_trace(task)
+        except ValueError:
+            # Running tasks can't be unwound on a live kernel.
+            continue
+        count += len(trace)
+    return count, None
+
+
+WORKLOADS = {
+    "for_each_task": bench_for_each_task,
+    "slab_dentry": bench_slab_dentry,
+    "for_each_page": bench_for_each_page,
+    "get_dmesg": bench_get_dmesg,
+    "stack_traces": bench_stack_traces,
+    # Only measures creating the program and loading debugging information.
+    "load_debug_info": None,
+}
+
+
+def run_once(workload, core_dump, debug_info):
+    import drgn
+
+    start = time.monotonic()
+    prog = drgn.Program()
+    if core_dump:
+        prog.set_core_dump(core_dump)
+    else:
+        prog.set_kernel()
+    try:
+        prog.load_debug_info(debug_info, default=True)
+    except drgn.MissingDebugInfoError as e:
+        print(e, file=sys.stderr)
+    load_time = time.monotonic() - start
+
+    count = nbytes = None
+    start = time.monotonic()
+    if WORKLOADS[workload]:
+        count, nbytes = WORKLOADS[workload](prog)
+    wall_time = time.monotonic() - start
+    return {
+        "load_time": load_time,
+        "wall_time": wall_time,
+        "count": count,
+        "objects_per_second": count / wall_time if count and wall_time else None,
+        "megabytes_per_second": (
+            nbytes / wall_time / 1e6 if nbytes and wall_time else None
+        ),
+        # ru_maxrss is in kilobytes on Linux.
+        "peak_rss": resource.getrusage(resource.RUSAGE_SELF).ru_maxrss * 1024,
+    }
+
+
+def median(results, metric):
+    values = [result[metric] for result in results if result[metric] is not None]
+    return statistics.median(values) if values else None
+
+
+def run_case(workload, runs, core_dump, debug_info):
+    results = []
+    for _ in range(runs):
+        # Run each workload in a new process so that the peak RSS and the
+        # caches of one run don't affect the next one.
+        argv = [sys.executable, __file__, "--child", workload]
+        if core_dump:
+            argv += ["-c", core_dump]
+        for path in debug_info:
+            argv += ["-s", path]
+        results.append(json.loads(subprocess.check_output(argv)))
+    return {
+        "name": workload,
+        "runs": results,
+        "median": {metric: median(results, metric) for metric in METRICS},
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="benchmark the Linux kernel helpers and output JSON"
+    )
+    parser.add_argument(
+        "-n", "--runs", type=int, default=5, help="number of runs of each workload"
+    )
+    parser.add_argument(
+        "-c",
+        "--core",
+        metavar="PATH",
+        help="vmcore to benchmark (default: the running kernel)",
+    )
+    parser.add_argument(
+        "-s",
+        "--symbols",
+        metavar="PATH",
+        action="append",
+        default=[],
+        help="load additional debugging symbols from the given file; may be "
+        "given multiple times",
+    )
+    parser.add_argument(
+        "-o", "--output", help="file to write JSON results to (default: stdout)"
+    )
+    parser.add_argument("--child", action="store_true", help=argparse.SUPPRESS)
+    parser.add_argument(
+        "workloads",
+        metavar="WORKLOAD",
+        nargs="*",
+        help="workload to run (default: all of them): " + ", ".join(WORKLOADS),
+    )
+    args = parser.parse_args()
+    for workload in args.workloads:
+        if workload not in WORKLOADS:
+            parser.error(f"unknown workload: {workload}")
+
+    if args.child:
+        json.dump(run_once(args.workloads[0], args.core, args.symbols), sys.stdout)
+        return
+
+    import drgn
+
+    cases = [
+        run_case(workload, args.runs, args.core, args.symbols)
+        for workload in (args.workloads or WORKLOADS)
+    ]
+    results = {
+        "drgn_version": drgn.__version__,
+        "kernel": None if args.core else os.uname().release,
+        "core_dump": args.core,
+        "cases": cases,
+    }
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(results, f, indent=2)
+            f.write("\n")
+    else:
+        json.dump(results, sys.stdout, indent=2)
+        print()
+
+
+if __name__ == "__main__":
+    main()
@@ -23,6 +23,7 @@ ENUMS = {
         "DW_CHILDREN",
         "DW_END",
         "DW_FORM",
+        "DW_IDX",
         "DW_LANG",
         "DW_LNE",
         "DW_LNS",
@@ -306,6 +306,23 @@ class DW_FORM(enum.IntEnum):
             return hex(value)
 
 
+class DW_IDX(enum.IntEnum):
+    compile_unit = 0x1
+    type_unit = 0x2
+    die_offset = 0x3
+    parent = 0x4
+    type_hash = 0x5
+    lo_user = 0x2000
+    hi_user = 0x3FFF
+
+    @classmethod
+    def str(cls, value: int) -> Text:
+        try:
+            return f"DW_IDX_{cls(value).name}"
+        except ValueError:
+            return hex(value)
+
+
 class DW_LANG(enum.IntEnum):
     C89 = 0x1
     C = 0x2
@@ -5,7 +5,7 @@ from collections import namedtuple
 import os.path
 
 from tests.assembler import _append_sleb128, _append_uleb128
-from tests.dwarf import DW_AT, DW_FORM, DW_TAG
+from tests.dwarf import DW_AT, DW_FORM, DW_IDX, DW_TAG
 from tests.elf import ET, SHT
 from tests.elfwriter import ElfSection, create_elf_file
 
@@ -13,6 +13,24 @@ DwarfAttrib = namedtuple("DwarfAttrib", ["name", "form", "value"])
 DwarfDie = namedtuple("DwarfAttrib", ["tag", "attribs", "children"])
 DwarfDie.__new__.__defaults__ = (None,)
 
+# Entry in a .debug_names name index. parent is the index of the parent entry,
+# or None.
+_DebugNamesEntry = namedtuple(
+    "_DebugNamesEntry", ["name", "tag", "unit", "offset", "parent"]
+)
+_DEBUG_NAMES_TAGS = frozenset(
+    {
+        DW_TAG.base_type,
+        DW_TAG.enumeration_type,
+        DW_TAG.enumerator,
+        DW_TAG.structure_type,
+        DW_TAG.subprogram,
+        DW_TAG.typedef,
+        DW_TAG.union_type,
+        DW_TAG.variable,
+    }
+)
+
 
 def _compile_debug_abbrev(unit_dies, use_dw_form_indirect):
     buf = bytearray()
@@ -41,17 +59,35 @@ def _compile_debug_abbrev(unit_dies, use_dw_form_indirect):
     return buf
 
 
-def _compile_debug_info(unit_dies, little_endian, bits, use_dw_form_indirect):
+def _compile_debug_info(
+    unit_dies, little_endian, bits, use_dw_form_indirect, cu_offsets, names_entries
+):
     byteorder = "little" if little_endian else "big"
     die_offsets = []
     relocations = []
     code = 1
     decl_file = 1
 
-    def aux(buf, die, depth):
+    def aux(buf, die, depth, parent):
         nonlocal code, decl_file
         if depth == 1:
             die_offsets.append(len(buf))
+        if depth > 0 and buf is debug_info and die.tag in _DEBUG_NAMES_TAGS:
+            name = next(
+                (attrib.value for attrib in die.attribs if attrib.name == DW_AT.name),
+                None,
+            )
+            if name is not None:
+                names_entries.append(
+                    _DebugNamesEntry(
+                        name, die.tag, len(cu_offsets) - 1, len(buf) - orig_len, parent
+                    )
+                )
+                parent = len(names_entries) - 1
+            else:
+                parent = None
+        elif depth > 0:
+            parent = None
         _append_uleb128(buf, code)
         code += 1
         for attrib in die.attribs:
@@ -91,7 +127,7 @@ def _compile_debug_info(unit_dies, little_endian, bits, use_dw_form_indirect):
             elif attrib.form == DW_FORM.ref_sig8:
                 buf.extend((value + 1).to_bytes(8, byteorder))
             elif attrib.form == DW_FORM.sec_offset:
-                buf.extend(b"\0\0\0\0")
+                buf.extend(value.to_bytes(4, byteorder))
             elif attrib.form == DW_FORM.flag_present:
                 pass
             elif attrib.form == DW_FORM.exprloc:
@@ -101,7 +137,7 @@ def _compile_debug_info(unit_dies, little_endian, bits, use_dw_form_indirect):
                 assert False, attrib.form
         if die.children:
             for child in die.children:
-                aux(buf, child, depth + 1)
+                aux(buf, child, depth + 1, parent)
             buf.append(0)
 
     debug_info = bytearray()
@@ -112,6 +148,8 @@ def _compile_debug_info(unit_dies, little_endian, bits, use_dw_form_indirect):
         die_offsets.clear()
         buf = debug_info if die.tag == DW_TAG.compile_unit else debug_types
         orig_len = len(buf)
+        if die.tag == DW_TAG.compile_unit:
+            cu_offsets.append(orig_len)
         buf.extend(b"\0\0\0\0")  # unit_length
         buf.extend((4).to_bytes(2, byteorder))  # version
         buf.extend((0).to_bytes(4, byteorder))  # debug_abbrev_offset
@@ -124,7 +162,7 @@ def _compile_debug_info(unit_dies, little_endian, bits, use_dw_form_indirect):
             relocations.append((len(buf), 0))
             buf.extend(b"\0\0\0\0")  # type_offset
 
-        aux(buf, die, 0)
+        aux(buf, die, 0, None)
 
         unit_length = len(buf) - orig_len - 4
         buf[orig_len : orig_len + 4] = unit_length.to_bytes(4, byteorder)
@@ -200,11 +238,97 @@ def _compile_debug_line(unit_dies, little_endian):
     return buf
 
 
+def _compile_debug_names(cu_offsets, entries, little_endian):
+    byteorder = "little" if little_endian else "big"
+
+    # Entries with the same name are grouped together in the entry pool.
+    names = {}
+    for i, entry in enumerate(entries):
+        names.setdefault(entry.name, []).append(i)
+
+    # One abbreviation for each combination of tag and whether there is a
+    # parent entry.
+    abbrevs = {}
+    for entry in entries:
+        abbrevs.setdefault((entry.tag, entry.parent is not None), len(abbrevs) + 1)
+
+    abbrev_table = bytearray()
+    for (tag, has_parent), code in abbrevs.items():
+        _append_uleb128(abbrev_table, code)
+        _append_uleb128(abbrev_table, tag)
+        for idx, form in (
+            (DW_IDX.compile_unit, DW_FORM.udata),
+            (DW_IDX.die_offset, DW_FORM.ref4),
+            (DW_IDX.parent, DW_FORM.ref4 if has_parent else DW_FORM.flag_present),
+        ):
+            _append_uleb128(abbrev_table, idx)
+            _append_uleb128(abbrev_table, form)
+        abbrev_table.extend(b"\0\0")
+    abbrev_table.append(0)
+
+    def compile_entry(entry, entry_offsets):
+        buf = bytearray()
+        _append_uleb128(buf, abbrevs[entry.tag, entry.parent is not None])
+        _append_uleb128(buf, entry.unit)
+        buf.extend(entry.offset.to_bytes(4, byteorder))
+        if entry.parent is not None:
+            buf.extend(entry_offsets[entry.parent].to_bytes(4, byteorder))
+        return buf
+
+    # Entries have a fixed size for a given abbreviation, so lay out the entry
+    # pool first to get the offsets that parents are referenced by.
+    entry_offsets = [0] * len(entries)
+    name_offsets = []
+    offset = 0
+    for indices in names.values():
+        name_offsets.append(offset)
+        for i in indices:
+            entry_offsets[i] = offset
+            offset += len(compile_entry(entries[i], entry_offsets))
+        offset += 1  # Terminator.
+    entry_pool = bytearray()
+    for indices in names.values():
+        for i in indices:
+            entry_pool.extend(compile_entry(entries[i], entry_offsets))
+        entry_pool.append(0)
+
+    debug_str = bytearray(b"\0")
+    buf = bytearray()
+    buf.extend(b"\0\0\0\0")  # unit_length
+    buf.extend((5).to_bytes(2, byteorder))  # version
+    buf.extend(b"\0\0")  # padding
+    buf.extend(len(cu_offsets).to_bytes(4, byteorder))  # comp_unit_count
+    buf.extend((0).to_bytes(4, byteorder))  # local_type_unit_count
+    buf.extend((0).to_bytes(4, byteorder))  # foreign_type_unit_count
+    buf.extend((0).to_bytes(4, byteorder))  # bucket_count
+    buf.extend(len(names).to_bytes(4, byteorder))  # name_count
+    buf.extend(len(abbrev_table).to_bytes(4, byteorder))  # abbrev_table_size
+    buf.extend((0).to_bytes(4, byteorder))  # augmentation_string_size
+    for cu_offset in cu_offsets:
+        buf.extend(cu_offset.to_bytes(4, byteorder))
+    for name in names:
+        buf.extend(len(debug_str).to_bytes(4, byteorder))
+        debug_str.extend(name.encode())
+        debug_str.append(0)
+    for name_offset in name_offsets:
+        buf.extend(name_offset.to_bytes(4, byteorder))
+    buf.extend(abbrev_table)
+    buf.extend(entry_pool)
+    buf[:4] = (len(buf) - 4).to_bytes(4, byteorder)
+    return buf, debug_str
+
+
 UNIT_HEADER_TYPES = frozenset({DW_TAG.type_unit, DW_TAG.compile_unit})
 
 
 def dwarf_sections(
-    dies, little_endian=True, bits=64, *, lang=None, use_dw_form_indirect=False
+    dies,
+    little_endian=True,
+    bits=64,
+    *,
+    lang=None,
+    use_dw_form_indirect=False,
+    debug_names=False,
 ):
     if isinstance(dies, DwarfDie):
         dies = (dies,)
@@ -233,9 +357,22 @@ def dwarf_sections(
         for die in unit_dies
     ]
 
+    cu_offsets = []
+    names_entries = []
     debug_info, debug_types = _compile_debug_info(
-        unit_dies, little_endian, bits, use_dw_form_indirect
+        unit_dies,
+        little_endian,
+        bits,
+        use_dw_form_indirect,
+        cu_offsets,
+        names_entries,
     )
+    if debug_names:
+        debug_names_data, debug_str = _compile_debug_names(
+            cu_offsets, names_entries, little_endian
+        )
+    else:
+        debug_str = b"\0"
 
     sections = [
         ElfSection(
@@ -249,8 +386,14 @@ def dwarf_sections(
             sh_type=SHT.PROGBITS,
             data=_compile_debug_line(unit_dies, little_endian),
         ),
-        ElfSection(name=".debug_str", sh_type=SHT.PROGBITS, data=b"\0"),
+        ElfSection(name=".debug_str", sh_type=SHT.PROGBITS, data=debug_str),
     ]
+    if debug_names:
+        sections.append(
+            ElfSection(
+                name=".debug_names", sh_type=SHT.PROGBITS, data=debug_names_data
+            )
+        )
     if debug_types:
         sections.append(
             ElfSection(name=".debug_types", sh_type=SHT.PROGBITS, data=debug_types)
@@ -259,7 +402,13 @@ def dwarf_sections(
 
 
 def compile_dwarf(
-    dies, little_endian=True, bits=64, *, lang=None, use_dw_form_indirect=False
+    dies,
+    little_endian=True,
+    bits=64,
+    *,
+    lang=None,
+    use_dw_form_indirect=False,
+    debug_names=False,
 ):
     return create_elf_file(
         ET.EXEC,
@@ -269,6 +418,7 @@ def compile_dwarf(
             bits=bits,
             lang=lang,
             use_dw_form_indirect=use_dw_form_indirect,
+            debug_names=debug_names,
         ),
         little_endian=little_endian,
         bits=bits,
@@ -21,6 +21,8 @@ class ElfSection:
         sh_link: int = 0,
         sh_info: int = 0,
         sh_entsize: int = 0,
+        sh_flags: int = 0,
+        sh_addralign: Optional[int] = None,
     ):
         self.data = data
         self.name = name
@@ -33,6 +35,8 @@ class ElfSection:
         self.sh_link = sh_link
         self.sh_info = sh_info
         self.sh_entsize = sh_entsize
+        self.sh_flags = sh_flags
+        self.sh_addralign = sh_addralign
 
         assert (self.name is not None) or (self.p_type is not None)
         assert (self.name is None) == (self.sh_type is None)
@@ -116,6 +120,7 @@ def create_elf_file(
     symbols: Sequence[ElfSymbol] = (),
     little_endian: bool = True,
     bits: int = 64,
+    machine: Optional[int] = None,
 ):
     endian = "<" if little_endian else ">"
     if bits == 64:
@@ -129,6 +134,8 @@ def create_elf_file(
         shdr_struct = struct.Struct(endian + "10I")
         phdr_struct = struct.Struct(endian + "8I")
         e_machine = 3 if little_endian else 8  # EM_386 or EM_MIPS
+    if machine is not None:
+        e_machine = machine
 
     sections = list(sections)
     if symbols:
@@ -192,19 +199,23 @@ def create_elf_file(
         if section.p_align:
             padding = section.vaddr % section.p_align - len(buf) % section.p_align
             buf.extend(bytes(padding))
+        if section.sh_addralign:
+            buf.extend(bytes(-len(buf) % section.sh_addralign))
         if section.name is not None:
             shdr_struct.pack_into(
                 buf,
                 shdr_offset,
                 shstrtab.index(section.name.encode()),  # sh_name
                 section.sh_type,  # sh_type
-                0,  # sh_flags
+                section.sh_flags,  # sh_flags
                 section.vaddr,  # sh_addr
                 len(buf),  # sh_offset
                 section.memsz,  # sh_size
                 section.sh_link,  # sh_link
                 section.sh_info,  # sh_info
-                1 if section.p_type is None else bits // 8,  # sh_addralign
+                # sh_addralign
+                section.sh_addralign
+                or (1 if section.p_type is None else bits // 8),
                 section.sh_entsize,  # sh_entsize
             )
             shdr_offset += shdr_struct.size
@@ -73,3 +73,38 @@ class TestDecodeFlags(TestCase):
             2,
             Program().enum_type(None),
         )
+
+    def test_decode_enum_type_flags_alias(self):
+        prog = Program(MOCK_PLATFORM)
+        type = prog.enum_type(
+            None,
+            prog.int_type("int", 4, True),
+            [
+                TypeEnumerator("NONE", 0),
+                TypeEnumerator("SMALL", 1),
+                TypeEnumerator("BIG", 2),
+                TypeEnumerator("LARGE", 2),
+            ],
+        )
+        self.assertEqual(decode_enum_type_flags(2, type, False), "BIG|LARGE")
+        self.assertEqual(decode_enum_type_flags(3, type, False), "SMALL|BIG|LARGE")
+        self.assertEqual(decode_enum_type_flags(0, type, False), "0")
+
+    def test_decode_enum_type_flags_high_bits(self):
+        prog = Program(MOCK_PLATFORM)
+        type = prog.enum_type(
+            None,
+            prog.int_type("unsigned long", 8, False),
+            [TypeEnumerator("LOW", 0), TypeEnumerator("HIGH", 63)],
+        )
+        self.assertEqual(decode_enum_type_flags(1 << 63 | 1, type), "LOW|HIGH")
+        self.assertEqual(
+            decode_enum_type_flags(1 << 64 | 1, type), "LOW|0x10000000000000000"
+        )
+
+    def test_decode_enum_type_flags_negative_bit_number(self):
+        prog = Program(MOCK_PLATFORM)
+        type = prog.enum_type(
+            None, prog.int_type("int", 4, True), [TypeEnumerator("BAD", -1)]
+        )
+        self.assertRaises(ValueError, decode_enum_type_flags, 1, type)
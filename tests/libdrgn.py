@@ -265,6 +265,13 @@ _drgn_cdll.drgn_test_deserialize_bits.argtypes = [
     ctypes.c_uint8,
     ctypes.c_bool,
 ]
+_drgn_cdll.drgn_test_deserialize_bits_fn.restype = ctypes.c_bool
+_drgn_cdll.drgn_test_deserialize_bits_fn.argtypes = [
+    ctypes.c_void_p,
+    ctypes.c_uint8,
+    ctypes.c_bool,
+    ctypes.POINTER(ctypes.c_uint64),
+]
 
 
 def serialize_bits(buf, bit_offset, uvalue, bit_size, little_endian):
@@ -281,3 +288,41 @@ def deserialize_bits(buf, bit_offset, bit_size, little_endian):
     return _drgn_cdll.drgn_test_deserialize_bits(
         c_buf, bit_offset, bit_size, little_endian
     )
+
+
+def deserialize_bits_fn(buf, bit_size, little_endian):
+    assert (bit_size + 7) // 8 <= len(buf)
+    c_buf = (ctypes.c_char * len(buf)).from_buffer_copy(buf)
+    value = ctypes.c_uint64()
+    if not _drgn_cdll.drgn_test_deserialize_bits_fn(
+        c_buf, bit_size, little_endian, ctypes.byref(value)
+    ):
+        return None
+    return value.value
+
+
+class _drgn_debug_info_timings(ctypes.Structure):
+    _fields_ = [
+        ("read_modules", ctypes.c_uint64),
+        ("first_pass", ctypes.c_uint64),
+        ("second_pass", ctypes.c_uint64),
+        ("debug_names", ctypes.c_uint64),
+    ]
+
+
+_drgn_cdll.drgn_test_debug_info_timings.restype = None
+_drgn_cdll.drgn_test_debug_info_timings.argtypes = [
+    ctypes.py_object,
+    ctypes.POINTER(_drgn_debug_info_timings),
+]
+
+
+# Return the cumulative time in seconds spent in each phase of loading debugging
+# information.
+def debug_info_timings(prog):
+    timings = _drgn_debug_info_timings()
+    _drgn_cdll.drgn_test_debug_info_timings(prog, ctypes.pointer(timings))
+    return {
+        name: getattr(timings, name) / 1e9
+        for name, _ in _drgn_debug_info_timings._fields_
+    }
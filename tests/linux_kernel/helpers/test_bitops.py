@@ -2,7 +2,12 @@
 # SPDX-License-Identifier: GPL-3.0-or-later
 
 from drgn import Object
-from drgn.helpers.linux.bitops import for_each_clear_bit, for_each_set_bit, test_bit
+from drgn.helpers.linux.bitops import (
+    bitmap_weight,
+    for_each_clear_bit,
+    for_each_set_bit,
+    test_bit,
+)
 from tests import MockProgramTestCase
 
 
@@ -40,6 +45,26 @@ class TestBitOps(MockProgramTestCase):
             [bit for bit in self.CLEAR_BITS if bit < 100],
         )
 
+    def test_for_each_set_bit_32(self):
+        words = []
+        for word in self.BITMAP:
+            words.extend((word & 0xFFFFFFFF, word >> 32))
+        bitmap = Object(self.prog, "unsigned int [4]", words)
+        self.assertEqual(list(for_each_set_bit(bitmap, 128)), self.SET_BITS)
+        self.assertEqual(
+            list(for_each_clear_bit(bitmap, 70)),
+            [bit for bit in self.CLEAR_BITS if bit < 70],
+        )
+
+    def test_bitmap_weight(self):
+        bitmap = Object(self.prog, "unsigned long [2]", self.BITMAP)
+        self.assertEqual(bitmap_weight(bitmap, 128), len(self.SET_BITS))
+        self.assertEqual(
+            bitmap_weight(bitmap, 101),
+            len([bit for bit in self.SET_BITS if bit < 101]),
+        )
+        self.assertEqual(bitmap_weight(bitmap, 0), 0)
+
     def test_test_bit(self):
         bitmap = Object(self.prog, "unsigned long [2]", self.BITMAP)
         for bit in self.SET_BITS:
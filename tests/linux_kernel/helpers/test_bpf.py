@@ -0,0 +1,57 @@
+# Copyright (c) Meta Platforms, Inc. and affiliates.
+# SPDX-License-Identifier: GPL-3.0-or-later
+
+from drgn.helpers.linux.bpf import (
+    BpfMapInfo,
+    BpfProgInfo,
+    bpf_map_for_each,
+    bpf_map_info_for_each,
+    bpf_prog_for_each,
+    bpf_prog_info_for_each,
+)
+from tests.linux_kernel import LinuxKernelTestCase
+
+
+class TestBpf(LinuxKernelTestCase):
+    def setUp(self):
+        super().setUp()
+        try:
+            self.prog["prog_idr"]
+        except KeyError:
+            self.skipTest("kernel not built with CONFIG_BPF_SYSCALL")
+
+    def test_bpf_prog_info_for_each(self):
+        expected = []
+        for bpf_prog in bpf_prog_for_each(self.prog):
+            aux = bpf_prog.aux
+            try:
+                name = aux.name.string_()
+            except AttributeError:
+                name = b""
+            expected.append((bpf_prog.value_(), aux.id.value_(), name))
+        infos = list(bpf_prog_info_for_each(self.prog))
+        for info in infos:
+            self.assertIsInstance(info, BpfProgInfo)
+        self.assertEqual(
+            [(info.address, info.id, info.name) for info in infos], expected
+        )
+
+    def test_bpf_map_info_for_each(self):
+        expected = []
+        for map_ in bpf_map_for_each(self.prog):
+            try:
+                name = map_.name.string_()
+            except AttributeError:
+                name = b""
+            expected.append(
+                BpfMapInfo(
+                    map_.value_(),
+                    map_.id.value_(),
+                    map_.map_type.value_(),
+                    name,
+                    map_.key_size.value_(),
+                    map_.value_size.value_(),
+                    map_.max_entries.value_(),
+                )
+            )
+        self.assertEqual(list(bpf_map_info_for_each(self.prog)), expected)
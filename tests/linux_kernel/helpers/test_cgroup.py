@@ -14,6 +14,7 @@ from drgn.helpers.linux.cgroup import (
     cgroup_path,
     css_for_each_child,
     css_for_each_descendant_pre,
+    css_for_each_descendant_pre_with_path,
 )
 from drgn.helpers.linux.pid import find_task
 from tests.linux_kernel import (
@@ -152,3 +153,21 @@ class TestCgroup(LinuxKernelTestCase):
             self._cgroup_iter_paths(css_for_each_descendant_pre, self.child_cgroup),
             [self.child_cgroup_path],
         )
+
+    def test_css_for_each_descendant_pre_with_path(self):
+        for cgroup in (self.root_cgroup, self.parent_cgroup, self.child_cgroup):
+            css = cgroup.self.address_of_()
+            self.assertEqual(
+                [
+                    path
+                    for _, path, _ in css_for_each_descendant_pre_with_path(css)
+                ],
+                self._cgroup_iter_paths(css_for_each_descendant_pre, cgroup),
+            )
+
+        kn = self.prog.member_path("struct cgroup", "kn")
+        for css, path, values in css_for_each_descendant_pre_with_path(
+            self.parent_cgroup.self.address_of_(), (kn,)
+        ):
+            self.assertEqual(path, cgroup_path(css.cgroup))
+            self.assertEqual(values, (css.cgroup.kn.read_(),))
@@ -7,10 +7,12 @@ import tempfile
 
 from drgn.helpers.linux.fs import (
     d_path,
+    d_paths,
     dentry_path,
     fget,
     for_each_file,
     for_each_mount,
+    for_each_task_file,
     inode_path,
     inode_paths,
     mount_dst,
@@ -42,6 +44,18 @@ class TestFs(LinuxKernelTestCase):
         task = find_task(self.prog, os.getpid())
         self.assertEqual(d_path(task.fs.pwd.address_of_()), os.fsencode(os.getcwd()))
 
+    def test_d_paths(self):
+        task = find_task(self.prog, os.getpid())
+        files = [file for _, file in for_each_file(task)]
+        self.assertEqual(
+            d_paths(
+                self.prog,
+                [(file.f_path.mnt, file.f_path.dentry) for file in files]
+                + [(task.fs.pwd.mnt, task.fs.pwd.dentry)],
+            ),
+            [d_path(file.f_path) for file in files] + [os.fsencode(os.getcwd())],
+        )
+
     def test_dentry_path(self):
         pwd = os.fsencode(os.getcwd())
         task = find_task(self.prog, os.getpid())
@@ -84,3 +98,17 @@ class TestFs(LinuxKernelTestCase):
                 {fd for fd, file in for_each_file(task)},
                 {int(entry.name) for entry in dir},
             )
+
+    def test_for_each_task_file(self):
+        task = find_task(self.prog, os.getpid())
+        with tempfile.NamedTemporaryFile(prefix="drgn-tests-") as f:
+            files = {
+                fd: file
+                for file_task, fd, file in for_each_task_file(self.prog)
+                if file_task == task
+            }
+            self.assertEqual(
+                d_path(files[f.fileno()].f_path),
+                os.fsencode(os.path.abspath(f.name)),
+            )
+            self.assertEqual(files.keys(), {fd for fd, _ in for_each_file(task)})
@@ -17,9 +17,12 @@ from drgn.helpers.linux.mm import (
     cmdline,
     decode_page_flags,
     environ,
+    find_page_pfns,
+    find_phys_mappings,
     page_to_pfn,
     pfn_to_page,
     pfn_to_virt,
+    pgtable_mappings,
     virt_to_pfn,
 )
 from drgn.helpers.linux.pid import find_task
@@ -62,6 +65,84 @@ class TestMm(LinuxKernelTestCase):
             page = pfn_to_page(self.prog, pfns[0])
             self.assertIn("PG_swapbacked", decode_page_flags(page))
 
+    def test_find_page_pfns(self):
+        with self._pages() as (map, _, pfns):
+            page = pfn_to_page(self.prog, pfns[0])
+            self.assertEqual(
+                list(find_page_pfns(self.prog, mapping=page.mapping)), sorted(pfns)
+            )
+            PG_swapbacked = self.prog.constant("PG_swapbacked")
+            self.assertEqual(
+                list(
+                    find_page_pfns(
+                        self.prog,
+                        1 << PG_swapbacked,
+                        mapping=page.mapping,
+                        min_refcount=1,
+                    )
+                ),
+                sorted(pfns),
+            )
+            self.assertEqual(
+                list(
+                    find_page_pfns(
+                        self.prog, 1 << PG_swapbacked, 0, mapping=page.mapping
+                    )
+                ),
+                [],
+            )
+
+    def test_pgtable_mappings(self):
+        with self._pages() as (map, address, pfns):
+            mm = find_task(self.prog, os.getpid()).mm
+            mappings = pgtable_mappings(mm.pgd, end=mm.task_size)
+            self.assertEqual(
+                mappings, sorted(mappings, key=lambda mapping: mapping[0])
+            )
+            for i, pfn in enumerate(pfns):
+                virt_addr = address + i * mmap.PAGESIZE
+                for start, phys_addr, size, _ in mappings:
+                    if start <= virt_addr < start + size:
+                        self.assertEqual(
+                            phys_addr + virt_addr - start, pfn * mmap.PAGESIZE
+                        )
+                        break
+                else:
+                    self.fail(f"{hex(virt_addr)} not mapped")
+
+            self.assertEqual(
+                pgtable_mappings(mm.pgd, address, address + mmap.PAGESIZE),
+                [
+                    (address, phys_addr + address - start, mmap.PAGESIZE, flags)
+                    for start, phys_addr, size, flags in mappings
+                    if start <= address < start + size
+                ],
+            )
+
+    def test_find_phys_mappings(self):
+        with self._pages() as (map, address, pfns):
+            mm = find_task(self.prog, os.getpid()).mm
+            found = find_phys_mappings(
+                self.prog, [pfn * mmap.PAGESIZE + 8 for pfn in pfns], [mm]
+            )
+            for i, mappings in enumerate(found):
+                self.assertIn(
+                    address + i * mmap.PAGESIZE + 8,
+                    [virt_addr for _, virt_addr in mappings],
+                )
+                for found_mm, _ in mappings:
+                    self.assertEqual(found_mm.value_(), mm.value_())
+
+            # The default is to search the address spaces of all tasks.
+            found = find_phys_mappings(self.prog, [pfns[0] * mmap.PAGESIZE])
+            self.assertIn(
+                (mm.value_(), address),
+                [
+                    (found_mm.value_(), virt_addr)
+                    for found_mm, virt_addr in found[0]
+                ],
+            )
+
     def test_virt_to_from_pfn(self):
         with self._pages() as (map, _, pfns):
             for i, pfn in enumerate(pfns):
@@ -113,6 +194,38 @@ class TestMm(LinuxKernelTestCase):
                 access_process_vm(task, address + 1, len(map) - 2), map[1:-1]
             )
 
+    def test_access_process_vm_translation_cache(self):
+        task = find_task(self.prog, os.getpid())
+        self.prog.translation_cache_enabled = True
+        try:
+            with self._pages() as (map, address, _):
+                self.assertEqual(access_process_vm(task, address, len(map)), map[:])
+                hits, misses = self.prog.translation_cache_stats()
+                self.assertEqual(access_process_vm(task, address, len(map)), map[:])
+                self.assertGreater(self.prog.translation_cache_stats()[0], hits)
+                self.assertEqual(self.prog.translation_cache_stats()[1], misses)
+
+                self.prog.invalidate_translation_cache()
+                self.assertEqual(access_process_vm(task, address, len(map)), map[:])
+                self.assertGreater(self.prog.translation_cache_stats()[1], misses)
+        finally:
+            self.prog.translation_cache_enabled = False
+
+    @unittest.skipUnless(platform.machine() == "x86_64", "machine is not x86_64")
+    def test_access_remote_vm_direct_mapping(self):
+        # task_struct is allocated from the slab, so it is in the direct
+        # mapping. Looking up PAGE_OFFSET enables the linear translation.
+        self.prog["PAGE_OFFSET"]
+        address = find_task(self.prog, os.getpid()).value_()
+        linear_translations = self.prog.stats()["linear_translations"]
+        self.assertEqual(
+            access_remote_vm(self.prog["init_mm"].address_of_(), address, 64),
+            self.prog.read(address, 64),
+        )
+        self.assertGreater(
+            self.prog.stats()["linear_translations"], linear_translations
+        )
+
     @unittest.skipUnless(platform.machine() == "x86_64", "machine is not x86_64")
     def test_non_canonical_x86_64(self):
         task = find_task(self.prog, os.getpid())
@@ -14,6 +14,7 @@ from drgn.helpers.linux.net import (
     SOCKET_I,
     for_each_net,
     get_net_ns_by_fd,
+    inet_hashinfo_sockets,
     netdev_for_each_tx_queue,
     netdev_get_by_index,
     netdev_get_by_name,
@@ -38,6 +39,50 @@ class TestNet(LinuxKernelTestCase):
             sk = cast("struct socket *", file.private_data).sk.read_()
             self.assertTrue(sk_fullsock(sk))
 
+    def test_inet_hashinfo_sockets(self):
+        hashinfo = self.prog["tcp_hashinfo"].address_of_()
+        localhost = socket.inet_aton("127.0.0.1")
+        with socket.socket(socket.AF_INET, socket.SOCK_STREAM) as listener:
+            listener.bind(("127.0.0.1", 0))
+            listener.listen()
+            port = listener.getsockname()[1]
+            with socket.create_connection(("127.0.0.1", port)) as client:
+                server = listener.accept()[0]
+                with server:
+                    client_port = client.getsockname()[1]
+
+                    def find(table, sport, dport):
+                        return [
+                            row
+                            for row in inet_hashinfo_sockets(hashinfo, table)
+                            if row[4] == sport and row[5] == dport
+                        ]
+
+                    rows = find("lhash", port, 0)
+                    self.assertEqual(len(rows), 1)
+                    self.assertEqual(rows[0][1], socket.AF_INET)
+                    self.assertEqual(rows[0][2], localhost)
+                    self.assertEqual(rows[0][6], self.prog["TCP_LISTEN"])
+                    self.assertEqual(rows[0][7], os.fstat(listener.fileno()).st_ino)
+                    self.assertEqual(rows[0][8], self.net.value_())
+
+                    for sock, sport, dport in (
+                        (server, port, client_port),
+                        (client, client_port, port),
+                    ):
+                        rows = find("ehash", sport, dport)
+                        self.assertEqual(len(rows), 1)
+                        self.assertEqual(rows[0][2:4], (localhost, localhost))
+                        self.assertEqual(rows[0][6], self.prog["TCP_ESTABLISHED"])
+                        self.assertEqual(rows[0][7], os.fstat(sock.fileno()).st_ino)
+                        sk = cast(
+                            "struct socket *",
+                            fget(self.task, sock.fileno()).private_data,
+                        ).sk
+                        self.assertEqual(rows[0][0], sk.value_())
+
+                    self.assertTrue(find("bhash", port, 0))
+
     def test_netdev_get_by_index(self):
         for index, name in socket.if_nameindex():
             netdev = netdev_get_by_index(self.net, index)
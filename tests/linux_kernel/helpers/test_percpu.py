@@ -1,8 +1,10 @@
 # Copyright (c) Meta Platforms, Inc. and affiliates.
 # SPDX-License-Identifier: GPL-3.0-or-later
 
-from drgn.helpers.linux.cpumask import for_each_possible_cpu
-from drgn.helpers.linux.percpu import per_cpu
+import unittest
+
+from drgn.helpers.linux.cpumask import for_each_online_cpu, for_each_possible_cpu
+from drgn.helpers.linux.percpu import per_cpu, per_cpu_sum, per_cpu_values
 from tests.linux_kernel import LinuxKernelTestCase, smp_enabled
 
 
@@ -18,3 +20,28 @@ class TestPerCpu(LinuxKernelTestCase):
                 self.assertEqual(
                     per_cpu(self.prog["runqueues"], cpu).idle.comm.string_(), b"swapper"
                 )
+
+    @unittest.skipUnless(smp_enabled(), "requires CONFIG_SMP")
+    def test_per_cpu_values(self):
+        self.assertEqual(
+            per_cpu_values(self.prog["runqueues"], "cpu"),
+            {cpu: cpu for cpu in for_each_online_cpu(self.prog)},
+        )
+
+    @unittest.skipUnless(smp_enabled(), "requires CONFIG_SMP")
+    def test_per_cpu_values_mask(self):
+        self.assertEqual(
+            per_cpu_values(
+                self.prog["runqueues"].address_of_(),
+                "cpu",
+                self.prog["__cpu_possible_mask"].address_of_(),
+            ),
+            {cpu: cpu for cpu in for_each_possible_cpu(self.prog)},
+        )
+
+    @unittest.skipUnless(smp_enabled(), "requires CONFIG_SMP")
+    def test_per_cpu_sum(self):
+        self.assertEqual(
+            per_cpu_sum(self.prog["runqueues"], "cpu"),
+            sum(for_each_online_cpu(self.prog)),
+        )
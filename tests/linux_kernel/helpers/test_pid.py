@@ -3,8 +3,16 @@
 
 from multiprocessing import Barrier, Process
 import os
+import threading
 
-from drgn.helpers.linux.pid import find_pid, find_task, for_each_pid, for_each_task
+from drgn.helpers.linux.pid import (
+    find_pid,
+    find_task,
+    find_tasks_by_comm,
+    find_thread_group,
+    for_each_pid,
+    for_each_task,
+)
 from tests.linux_kernel import LinuxKernelTestCase
 
 
@@ -30,6 +38,46 @@ class TestPid(LinuxKernelTestCase):
         self.assertEqual(task.pid, pid)
         self.assertEqual(task.comm.string_(), comm)
 
+    def test_find_thread_group(self):
+        tids = []
+        barrier = threading.Barrier(2)
+        event = threading.Event()
+
+        def thread_func():
+            tids.append(int(os.readlink("/proc/thread-self").rpartition("/")[2]))
+            barrier.wait()
+            event.wait()
+
+        thread = threading.Thread(target=thread_func)
+        thread.start()
+        try:
+            barrier.wait()
+            threads = find_thread_group(self.prog, os.getpid())
+            tgids = {task.tgid.value_() for task in threads}
+            self.assertEqual(tgids, {os.getpid()})
+            pids = {task.pid.value_() for task in threads}
+            self.assertIn(os.getpid(), pids)
+            self.assertIn(tids[0], pids)
+        finally:
+            event.set()
+            thread.join()
+
+    def test_find_thread_group_not_found(self):
+        self.assertEqual(find_thread_group(self.prog, 2**32), [])
+
+    def test_find_tasks_by_comm(self):
+        with open("/proc/self/comm", "rb") as f:
+            comm = f.read()[:-1]
+        pids = {task.pid.value_() for task in find_tasks_by_comm(self.prog, comm)}
+        self.assertIn(os.getpid(), pids)
+        self.assertEqual(
+            {
+                task.pid.value_()
+                for task in find_tasks_by_comm(self.prog, os.fsdecode(comm))
+            },
+            pids,
+        )
+
     def test_for_each_task(self):
         NUM_PROCS = 12
         barrier = Barrier(NUM_PROCS + 1)
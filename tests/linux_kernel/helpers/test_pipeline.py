@@ -0,0 +1,114 @@
+# Copyright (c) Meta Platforms, Inc. and affiliates.
+# SPDX-License-Identifier: GPL-3.0-or-later
+
+from drgn.helpers.linux.list import list_for_each_entry
+from drgn.helpers.linux.pipeline import Pipeline
+from tests.linux_kernel import LinuxKernelTestCase, skip_unless_have_test_kmod
+
+
+@skip_unless_have_test_kmod
+class TestPipeline(LinuxKernelTestCase):
+    def test_list(self):
+        head = self.prog["drgn_test_full_list"].address_of_()
+        pipeline = Pipeline(
+            self.prog, "struct drgn_test_list_entry", "list", member="node"
+        )
+        self.assertEqual(
+            pipeline.run(head),
+            [
+                (entry.value_(),)
+                for entry in list_for_each_entry(
+                    "struct drgn_test_list_entry", head, "node"
+                )
+            ],
+        )
+
+    def test_rbtree(self):
+        entries = self.prog["drgn_test_rb_entries"]
+        pipeline = Pipeline(
+            self.prog,
+            "struct drgn_test_rb_entry",
+            "rbtree",
+            member="node",
+            where=[("value", ">=", 1), ("value", "!=", 2)],
+            select=["value"],
+        )
+        self.assertEqual(
+            pipeline.run(self.prog["drgn_test_rb_root"].address_of_()),
+            [(entries[i].address_, i) for i in (1, 3)],
+        )
+
+    def test_array(self):
+        entries = self.prog["drgn_test_rb_entries"]
+        pipeline = Pipeline(
+            self.prog,
+            "struct drgn_test_rb_entry",
+            "array",
+            where=[("value", "&", 1)],
+            select=["value"],
+        )
+        self.assertEqual(
+            pipeline.run(entries),
+            [(entries[i].address_, i) for i in (1, 3)],
+        )
+
+    def test_array_of_pointers(self):
+        if self.prog["drgn_test_slob"]:
+            self.skipTest("SLOB is not supported")
+        objects = self.prog["drgn_test_slab_objects"]
+        pipeline = Pipeline(
+            self.prog,
+            "struct drgn_test_slab_object",
+            "array",
+            where=[("value", "<", 2)],
+            select=["value"],
+        )
+        self.assertEqual(
+            pipeline.run(objects), [(objects[i].value_(), i) for i in range(2)]
+        )
+
+    def test_slab(self):
+        if self.prog["drgn_test_slob"]:
+            self.skipTest("SLOB is not supported")
+        objects = self.prog["drgn_test_slab_objects"]
+        pipeline = Pipeline(
+            self.prog,
+            "struct drgn_test_slab_object",
+            "slab",
+            where=[("value", ">", -1)],
+            select=["value"],
+        )
+        self.assertEqual(
+            sorted(
+                pipeline.run(self.prog["drgn_test_kmem_cache"]),
+                key=lambda row: row[1],
+            ),
+            [(objects[i].value_(), i) for i in range(5)],
+        )
+
+    def test_invalid(self):
+        self.assertRaisesRegex(
+            ValueError,
+            "invalid pipeline source",
+            Pipeline,
+            self.prog,
+            "struct drgn_test_rb_entry",
+            "foo",
+        )
+        self.assertRaisesRegex(
+            ValueError,
+            "node member is required",
+            Pipeline,
+            self.prog,
+            "struct drgn_test_rb_entry",
+            "rbtree",
+        )
+        self.assertRaisesRegex(
+            TypeError,
+            "cannot read",
+            Pipeline,
+            self.prog,
+            "struct drgn_test_rb_entry",
+            "array",
+            select=["node"],
+        )
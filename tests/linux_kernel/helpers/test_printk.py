@@ -70,3 +70,15 @@ class TestPrintk(LinuxKernelTestCase):
                 for record in get_printk_records(self.prog)
             ],
         )
+
+    def test_get_printk_records_min_seq(self):
+        records = get_printk_records(self.prog)
+        self.assertGreater(len(records), 1)
+        seq = records[len(records) // 2].seq
+        self.assertEqual(
+            get_printk_records(self.prog, min_seq=seq),
+            [record for record in records if record.seq >= seq],
+        )
+        self.assertEqual(
+            get_printk_records(self.prog, min_seq=records[-1].seq + 2**32), []
+        )
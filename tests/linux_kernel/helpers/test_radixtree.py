@@ -0,0 +1,36 @@
+# Copyright (c) Meta Platforms, Inc. and affiliates.
+# SPDX-License-Identifier: GPL-3.0-or-later
+
+import os
+import tempfile
+
+from drgn.helpers.linux.fs import fget
+from drgn.helpers.linux.pid import find_task
+from drgn.helpers.linux.radixtree import radix_tree_for_each, radix_tree_lookup
+from tests.linux_kernel import LinuxKernelTestCase
+
+
+class TestRadixTree(LinuxKernelTestCase):
+    def test_radix_tree_for_each(self):
+        # Enough pages to need more than one level of nodes.
+        size = os.sysconf("SC_PAGESIZE") * 200
+        with tempfile.TemporaryFile(prefix="drgn-tests-") as f:
+            f.write(b"\xff" * size)
+            f.flush()
+            file = fget(find_task(self.prog, os.getpid()), f.fileno())
+            mapping = file.f_mapping
+            try:
+                root = mapping.i_pages.address_of_()
+            except AttributeError:
+                root = mapping.page_tree.address_of_()
+
+            entries = list(radix_tree_for_each(root))
+            self.assertTrue(entries)
+            indices = [index for index, _ in entries]
+            self.assertEqual(indices, sorted(set(indices)))
+            for index, entry in entries:
+                self.assertEqual(radix_tree_lookup(root, index), entry)
+
+            self.assertTrue(
+                set(radix_tree_for_each(root, skip_values=True)) <= set(entries)
+            )
@@ -88,6 +88,15 @@ class TestRbtree(LinuxKernelTestCase):
             [self.entry(i) for i in range(self.num_entries)],
         )
 
+    def test_rbtree_inorder_for_each_root_value(self):
+        self.assertEqual(
+            list(rbtree_inorder_for_each(self.root[0])),
+            [self.node(i) for i in range(self.num_entries)],
+        )
+
+    def test_rbtree_inorder_for_each_empty(self):
+        self.assertEqual(list(rbtree_inorder_for_each(self.empty_root)), [])
+
     def test_rb_find(self):
         def cmp(key, obj):
             value = obj.value.value_()
@@ -5,6 +5,7 @@ from collections import defaultdict
 from pathlib import Path
 
 from drgn.helpers.linux.slab import (
+    SlabHeapGraph,
     find_slab_cache,
     for_each_slab_cache,
     slab_cache_for_each_allocated_object,
@@ -115,3 +116,63 @@ class TestSlab(LinuxKernelTestCase):
                 ),
                 [objects[i] for i in range(5)],
             )
+
+    def _big_slab_cache_objects(self, num_threads):
+        old_num_threads = self.prog.num_threads
+        self.prog.num_threads = num_threads
+        try:
+            return [
+                obj.value_()
+                for obj in slab_cache_for_each_allocated_object(
+                    self.prog["drgn_test_big_kmem_cache"],
+                    "struct drgn_test_slab_object",
+                )
+            ]
+        finally:
+            self.prog.num_threads = old_num_threads
+
+    @skip_unless_have_test_kmod
+    def test_slab_cache_for_each_allocated_object_many_slabs(self):
+        if self.prog["drgn_test_slob"]:
+            self.skipTest("SLOB is not supported")
+        expected = {
+            obj.value_()
+            for obj in self.prog["drgn_test_big_slab_objects"].read_()
+            if obj
+        }
+        for num_threads in (1, 0):
+            with self.subTest(num_threads=num_threads):
+                objects = self._big_slab_cache_objects(num_threads)
+                self.assertEqual(len(objects), len(expected))
+                self.assertEqual(set(objects), expected)
+
+    @skip_unless_have_test_kmod
+    def test_slab_cache_for_each_allocated_object_parallel_order(self):
+        if self.prog["drgn_test_slob"]:
+            self.skipTest("SLOB is not supported")
+        # Slabs decoded in parallel are still returned in page array order.
+        self.assertEqual(
+            self._big_slab_cache_objects(0), self._big_slab_cache_objects(1)
+        )
+
+    @skip_unless_have_test_kmod
+    def test_slab_heap_graph(self):
+        if self.prog["drgn_test_slob"]:
+            self.assertRaisesRegex(
+                ValueError, "SLOB is not supported", SlabHeapGraph, self.prog
+            )
+            return
+        objects = self.prog["drgn_test_slab_objects"]
+        graph = SlabHeapGraph(self.prog)
+        self.assertGreaterEqual(len(graph), len(objects))
+        for i in range(len(objects)):
+            self.assertEqual(
+                graph.object_containing(objects[i].value.address_),
+                objects[i].value_(),
+            )
+        for i in range(len(objects) - 1):
+            self.assertIn(
+                objects[i + 1].prev.address_, graph.referrers(objects[i])
+            )
+        self.assertIsNone(graph.object_containing(objects.address_))
+        self.assertEqual(graph.referrers(objects.address_), [])
@@ -215,16 +215,31 @@ const int drgn_test_slob = IS_ENABLED(CONFIG_SLOB);
 struct kmem_cache *drgn_test_kmem_cache;
 
 struct drgn_test_slab_object {
-	int padding[11];
+	struct drgn_test_slab_object *prev;
+	int padding[9];
 	int value;
 };
 
 struct drgn_test_slab_object *drgn_test_slab_objects[5];
 
+// Cache with hundreds of slabs, with every third object freed.
+struct kmem_cache *drgn_test_big_kmem_cache;
+struct drgn_test_slab_object *drgn_test_big_slab_objects[40000];
+
 static void drgn_test_slab_exit(void)
 {
 	size_t i;
 
+	if (drgn_test_big_kmem_cache) {
+		for (i = 0; i < ARRAY_SIZE(drgn_test_big_slab_objects); i++) {
+			if (drgn_test_big_slab_objects[i]) {
+				kmem_cache_free(drgn_test_big_kmem_cache,
+						drgn_test_big_slab_objects[i]);
+			}
+		}
+		kmem_cache_destroy(drgn_test_big_kmem_cache);
+	}
+
 	if (!drgn_test_kmem_cache)
 		return;
 
@@ -237,7 +252,7 @@ static void drgn_test_slab_exit(void)
 	kmem_cache_destroy(drgn_test_kmem_cache);
 }
 
-// Dummy constructor so test slab cache won't get merged.
+// Dummy constructor so test slab caches won't get merged.
 static void drgn_test_slab_ctor(void *arg)
 {
 }
@@ -259,6 +274,28 @@ static int drgn_test_slab_init(void)
 		if (!drgn_test_slab_objects[i])
 			return -ENOMEM;
 		drgn_test_slab_objects[i]->value = i;
+		drgn_test_slab_objects[i]->prev =
+			i ? drgn_test_slab_objects[i - 1] : NULL;
+	}
+
+	drgn_test_big_kmem_cache =
+		kmem_cache_create("drgn_test_big",
+				  sizeof(struct drgn_test_slab_object),
+				  __alignof__(struct drgn_test_slab_object), 0,
+				  drgn_test_slab_ctor);
+	if (!drgn_test_big_kmem_cache)
+		return -ENOMEM;
+	for (i = 0; i < ARRAY_SIZE(drgn_test_big_slab_objects); i++) {
+		drgn_test_big_slab_objects[i] =
+			kmem_cache_alloc(drgn_test_big_kmem_cache, GFP_KERNEL);
+		if (!drgn_test_big_slab_objects[i])
+			return -ENOMEM;
+		drgn_test_big_slab_objects[i]->value = i;
+	}
+	for (i = 0; i < ARRAY_SIZE(drgn_test_big_slab_objects); i += 3) {
+		kmem_cache_free(drgn_test_big_kmem_cache,
+				drgn_test_big_slab_objects[i]);
+		drgn_test_big_slab_objects[i] = NULL;
 	}
 	return 0;
 }
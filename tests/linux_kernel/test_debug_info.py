@@ -6,7 +6,11 @@ from pathlib import Path
 import unittest
 
 from drgn import Program
-from tests.linux_kernel import LinuxKernelTestCase, setenv
+from tests.linux_kernel import (
+    LinuxKernelTestCase,
+    setenv,
+    skip_unless_have_test_kmod,
+)
 
 KALLSYMS_PATH = Path("/proc/kallsyms")
 
@@ -55,3 +59,44 @@ class TestModuleDebugInfo(LinuxKernelTestCase):
 
     def test_module_debug_info_use_core_dump(self):
         self._test_module_debug_info(False)
+
+    def test_module_debug_info_serial(self):
+        # The module files are opened without parallelism.
+        prog = Program()
+        prog.num_threads = 1
+        prog.set_kernel()
+        self._load_debug_info(prog)
+        self.assertEqual(prog.symbol(self.SYMBOL).address, self.symbol_address)
+
+    def test_module_debug_info_reload(self):
+        # Finding the unloaded module again reuses the depmod index mapped by
+        # the first load.
+        prog = Program()
+        prog.set_kernel()
+        self._load_debug_info(prog)
+        prog.unload_debug_info("loop")
+        self._load_debug_info(prog)
+        self.assertEqual(prog.symbol(self.SYMBOL).address, self.symbol_address)
+
+
+@skip_unless_have_test_kmod
+class TestUnloadDebugInfo(LinuxKernelTestCase):
+    def test_unload_debug_info(self):
+        prog = Program()
+        prog.set_kernel()
+        self._load_debug_info(prog)
+        obj = prog["drgn_test_empty_list"]
+        type_ = prog.type("struct drgn_test_list_entry")
+
+        prog.unload_debug_info("drgn_test")
+        self.assertRaises(KeyError, prog.__getitem__, "drgn_test_empty_list")
+        self.assertRaises(LookupError, prog.type, "struct drgn_test_list_entry")
+        self.assertRaises(LookupError, prog.unload_debug_info, "drgn_test")
+        # Objects and types that already exist are still usable.
+        self.assertEqual(obj.address_of_(), obj.next)
+        self.assertEqual(type_.members[0].name, "node")
+        # Other modules are unaffected.
+        prog["init_task"]
+
+        self._load_debug_info(prog)
+        self.assertEqual(prog["drgn_test_empty_list"].address_, obj.address_)
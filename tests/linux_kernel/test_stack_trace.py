@@ -44,6 +44,18 @@ class TestStackTrace(LinuxKernelTestCase):
     def test_by_pid_orc(self):
         self._test_by_pid(True)
 
+    def test_repeated(self):
+        # The second unwind uses the cached lookups from the first one.
+        pid = fork_and_pause()
+        wait_until(proc_blocked, pid)
+        traces = [self.prog.stack_trace(pid) for _ in range(2)]
+        self.assertEqual(
+            [(frame.pc, frame.name) for frame in traces[0]],
+            [(frame.pc, frame.name) for frame in traces[1]],
+        )
+        os.kill(pid, signal.SIGKILL)
+        os.waitpid(pid, 0)
+
     def test_local_variable(self):
         pid = fork_and_pause()
         wait_until(proc_blocked, pid)
@@ -85,3 +97,124 @@ class TestStackTrace(LinuxKernelTestCase):
         self.assertTrue(have_registers)
         os.kill(pid, signal.SIGKILL)
         os.waitpid(pid, 0)
+
+    def test_stack_traces(self):
+        pids = [fork_and_pause() for _ in range(4)]
+        try:
+            for pid in pids:
+                wait_until(proc_blocked, pid)
+            threads = [self.prog.thread(pid) for pid in pids]
+            traces = self.prog.stack_traces(threads)
+            self.assertEqual(len(traces), len(threads))
+            for thread, trace in zip(threads, traces):
+                self.assertIn("pause", str(trace))
+                self.assertEqual(
+                    [frame.pc for frame in trace],
+                    [frame.pc for frame in thread.stack_trace()],
+                )
+            self.assertEqual(self.prog.stack_traces([]), [])
+        finally:
+            for pid in pids:
+                os.kill(pid, signal.SIGKILL)
+                os.waitpid(pid, 0)
+
+    def test_stack_trace_groups(self):
+        pids = [fork_and_pause() for _ in range(3)]
+        try:
+            for pid in pids:
+                wait_until(proc_blocked, pid)
+            threads = [self.prog.thread(pid) for pid in pids]
+            groups = self.prog.stack_trace_groups(threads + threads)
+            self.assertEqual(
+                sorted(tid for _, tids in groups for tid in tids),
+                sorted(pids + pids),
+            )
+            for tid in pids:
+                self.assertEqual(sum(tids.count(tid) for _, tids in groups), 2)
+            for trace, tids in groups:
+                pcs = [frame.pc for frame in trace]
+                for tid in tids:
+                    self.assertEqual(
+                        [frame.pc for frame in self.prog.stack_trace(tid)], pcs
+                    )
+            self.assertEqual(self.prog.stack_trace_groups([]), [])
+        finally:
+            for pid in pids:
+                os.kill(pid, signal.SIGKILL)
+                os.waitpid(pid, 0)
+
+    def test_find_frame_objects(self):
+        pids = [fork_and_pause() for _ in range(3)]
+        try:
+            for pid in pids:
+                wait_until(proc_blocked, pid)
+            traces = self.prog.stack_traces([self.prog.thread(pid) for pid in pids])
+            for function in ("context_switch", "__schedule"):
+                rows = self.prog.find_frame_objects(
+                    traces, function, ["prev", "not_a_variable"]
+                )
+                self.assertEqual(len(rows), len(traces))
+                for trace, row in zip(traces, rows):
+                    frame = next(
+                        (frame for frame in trace if frame.name == function), None
+                    )
+                    if frame is None:
+                        self.assertIsNone(row)
+                        continue
+                    prev, missing = row
+                    self.assertIsNone(missing)
+                    if "prev" in frame:
+                        self.assertIdentical(prev, frame["prev"])
+                    else:
+                        self.assertIsNone(prev)
+            self.assertEqual(
+                self.prog.find_frame_objects([], "__schedule", ["prev"]), []
+            )
+        finally:
+            for pid in pids:
+                os.kill(pid, signal.SIGKILL)
+                os.waitpid(pid, 0)
+
+    def test_raw_stack_traces(self):
+        pids = [fork_and_pause() for _ in range(2)]
+        try:
+            for pid in pids:
+                wait_until(proc_blocked, pid)
+            threads = [self.prog.thread(pid) for pid in pids]
+            raw_traces = self.prog.stack_traces(threads, raw=True)
+            for thread, raw_trace in zip(threads, raw_traces):
+                trace = thread.stack_trace()
+                # Raw traces have one frame per call frame, so they have the
+                # same program counters without the repeats for inline frames.
+                self.assertEqual(
+                    [frame.pc for frame in raw_trace],
+                    [frame.pc for frame in trace if not frame.is_inline],
+                )
+                self.assertIn("pause", str(raw_trace))
+            groups = self.prog.stack_trace_groups(threads, raw=True)
+            self.assertEqual(
+                sorted(tid for _, tids in groups for tid in tids), sorted(pids)
+            )
+        finally:
+            for pid in pids:
+                os.kill(pid, signal.SIGKILL)
+                os.waitpid(pid, 0)
+
+    def test_sample_stack_traces(self):
+        pids = [fork_and_pause() for _ in range(2)]
+        try:
+            for pid in pids:
+                wait_until(proc_blocked, pid)
+            threads = [self.prog.thread(pid) for pid in pids]
+            folded = self.prog.sample_stack_traces(threads, 3, 0.001)
+            lines = folded.splitlines()
+            # Both processes are blocked in the same place.
+            self.assertEqual(len(lines), 1)
+            stack, count = lines[0].rsplit(" ", 1)
+            self.assertEqual(count, "6")
+            self.assertIn("pause", stack)
+            self.assertEqual(self.prog.sample_stack_traces(threads, 0), "")
+        finally:
+            for pid in pids:
+                os.kill(pid, signal.SIGKILL)
+                os.waitpid(pid, 0)
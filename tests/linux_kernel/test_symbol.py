@@ -1,7 +1,10 @@
 # Copyright (c) 2021, Oracle and/or its affiliates.
 # SPDX-License-Identifier: GPL-3.0-or-later
 
-from drgn import SymbolBinding, SymbolKind
+import os
+import unittest
+
+from drgn import Program, SymbolBinding, SymbolKind
 from tests.linux_kernel import LinuxKernelTestCase
 
 
@@ -11,3 +14,24 @@ class TestSymbol(LinuxKernelTestCase):
         self.assertEqual(symbol.name, "jiffies")
         self.assertEqual(symbol.binding, SymbolBinding.GLOBAL)
         self.assertEqual(symbol.kind, SymbolKind.OBJECT)
+
+    @unittest.skipUnless(
+        os.path.exists("/proc/kallsyms"),
+        "kernel does not have kallsyms (CONFIG_KALLSYMS)",
+    )
+    def test_kallsyms_without_debug_info(self):
+        prog = Program()
+        prog.set_kernel()
+        expected = self.prog.symbol("schedule")
+
+        symbol = prog.symbol("schedule")
+        self.assertEqual(symbol.name, "schedule")
+        self.assertEqual(symbol.address, expected.address)
+        self.assertEqual(symbol.binding, SymbolBinding.GLOBAL)
+        self.assertEqual(symbol.kind, SymbolKind.FUNC)
+        self.assertGreater(symbol.size, 0)
+
+        self.assertIn(
+            "schedule", [s.name for s in prog.symbols(expected.address + 1)]
+        )
+        self.assertEqual(prog.symbol(expected.address + 1).address, expected.address)
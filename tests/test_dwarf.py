@@ -3,9 +3,14 @@
 
 import functools
 import operator
+import os
 import os.path
 import re
+import struct
 import tempfile
+import threading
+import unittest.mock
+import zlib
 
 import drgn
 from drgn import (
@@ -17,6 +22,7 @@ from drgn import (
     ProgramFlags,
     Qualifiers,
     TypeEnumerator,
+    TypeKind,
     TypeMember,
     TypeParameter,
     TypeTemplateParameter,
@@ -30,7 +36,10 @@ from tests import (
 )
 import tests.assembler as assembler
 from tests.dwarf import DW_AT, DW_ATE, DW_END, DW_FORM, DW_LANG, DW_OP, DW_TAG
-from tests.dwarfwriter import DwarfAttrib, DwarfDie, compile_dwarf
+from tests.dwarfwriter import DwarfAttrib, DwarfDie, compile_dwarf, dwarf_sections
+from tests.elf import ET, PT, SHT, STB, STT
+from tests.elfwriter import ElfSection, ElfSymbol, create_elf_file
+from tests.libdrgn import debug_info_timings
 
 bool_die = DwarfDie(
     DW_TAG.base_type,
@@ -538,6 +547,69 @@ class TestTypes(TestCase):
             ),
         )
 
+    def test_struct_members_sequence(self):
+        prog = dwarf_program(
+            wrap_test_type_dies(
+                (
+                    DwarfDie(
+                        DW_TAG.structure_type,
+                        (
+                            DwarfAttrib(DW_AT.name, DW_FORM.string, "point"),
+                            DwarfAttrib(DW_AT.byte_size, DW_FORM.data1, 8),
+                        ),
+                        (
+                            DwarfDie(
+                                DW_TAG.member,
+                                (
+                                    DwarfAttrib(DW_AT.name, DW_FORM.string, "x"),
+                                    DwarfAttrib(
+                                        DW_AT.data_member_location, DW_FORM.data1, 0
+                                    ),
+                                    DwarfAttrib(DW_AT.type, DW_FORM.ref4, 1),
+                                ),
+                            ),
+                            DwarfDie(
+                                DW_TAG.member,
+                                (
+                                    DwarfAttrib(DW_AT.name, DW_FORM.string, "y"),
+                                    DwarfAttrib(
+                                        DW_AT.data_member_location, DW_FORM.data1, 4
+                                    ),
+                                    DwarfAttrib(DW_AT.type, DW_FORM.ref4, 1),
+                                ),
+                            ),
+                        ),
+                    ),
+                    int_die,
+                )
+            )
+        )
+        members = prog.type("TEST").type.members
+        self.assertIsInstance(members, tuple)
+        self.assertEqual(len(members), 2)
+        self.assertEqual(members[0].name, "x")
+        self.assertEqual(members[-1].name, "y")
+        self.assertEqual(members[1].bit_offset, 32)
+        self.assertEqual(members[1].offset, 4)
+        self.assertIs(members[1], members[1])
+        self.assertIs(members["y"], members[1])
+        self.assertEqual(members[::-1], (members[1], members[0]))
+        self.assertEqual(members, (members[0], members[1]))
+        self.assertEqual(list(members), [members[0], members[1]])
+        self.assertEqual(repr(members), repr(tuple(members)))
+        self.assertRaises(IndexError, members.__getitem__, 2)
+        self.assertRaises(IndexError, members.__getitem__, -3)
+        self.assertRaises(KeyError, members.__getitem__, "z")
+        self.assertEqual(hash(members), hash(tuple(members)))
+        self.assertEqual(members + (), tuple(members))
+        self.assertEqual((members[1],) + members, (members[1],) + tuple(members))
+        self.assertEqual(members + members, tuple(members) * 2)
+        self.assertEqual(members * 2, tuple(members) * 2)
+        self.assertEqual(members.index(members[1]), 1)
+        self.assertEqual(members.count(members[0]), 1)
+        self.assertIn(members[0], members)
+        self.assertRaises(TypeError, lambda: members + [])
+
     def test_struct_anonymous(self):
         prog = dwarf_program(
             wrap_test_type_dies(
@@ -2304,6 +2376,65 @@ class TestTypes(TestCase):
             prog.typedef_type("pid_t", prog.int_type("int", 4, True)),
         )
 
+    def test_types(self):
+        prog = dwarf_program(
+            (
+                int_die,
+                DwarfDie(
+                    DW_TAG.structure_type,
+                    (
+                        DwarfAttrib(DW_AT.name, DW_FORM.string, "point"),
+                        DwarfAttrib(DW_AT.byte_size, DW_FORM.data1, 4),
+                    ),
+                    (
+                        DwarfDie(
+                            DW_TAG.member,
+                            (
+                                DwarfAttrib(DW_AT.name, DW_FORM.string, "x"),
+                                DwarfAttrib(
+                                    DW_AT.data_member_location, DW_FORM.data1, 0
+                                ),
+                                DwarfAttrib(DW_AT.type, DW_FORM.ref4, 0),
+                            ),
+                        ),
+                    ),
+                ),
+                DwarfDie(
+                    DW_TAG.typedef,
+                    (
+                        DwarfAttrib(DW_AT.name, DW_FORM.string, "pid_t"),
+                        DwarfAttrib(DW_AT.type, DW_FORM.ref4, 0),
+                    ),
+                ),
+                DwarfDie(
+                    DW_TAG.pointer_type,
+                    (
+                        DwarfAttrib(DW_AT.byte_size, DW_FORM.data1, 8),
+                        DwarfAttrib(DW_AT.type, DW_FORM.ref4, 0),
+                    ),
+                ),
+            )
+        )
+
+        types = list(prog.types([TypeKind.STRUCT]))
+        self.assertEqual(len(types), 1)
+        self.assertIdentical(types[0], prog.type("struct point"))
+
+        types = list(prog.types([TypeKind.TYPEDEF, TypeKind.INT]))
+        self.assertCountEqual([type.type_name() for type in types], ["int", "pid_t"])
+
+        self.assertCountEqual(
+            [type.type_name() for type in prog.types()],
+            ["int", "struct point", "pid_t"],
+        )
+        self.assertEqual(list(prog.types([TypeKind.UNION])), [])
+        self.assertEqual(list(prog.types([])), [])
+        self.assertRaises(ValueError, prog.types, [TypeKind.POINTER])
+        self.assertRaises(TypeError, prog.types, [1])
+
+    def test_types_no_debug_info(self):
+        self.assertEqual(list(Program().types()), [])
+
     def test_pointer(self):
         prog = dwarf_program(
             wrap_test_type_dies(
@@ -3385,6 +3516,37 @@ class TestTypes(TestCase):
             ),
         )
 
+    def test_function_parameters_sequence(self):
+        # int foo(char c)
+        prog = dwarf_program(
+            wrap_test_type_dies(
+                (
+                    DwarfDie(
+                        DW_TAG.subroutine_type,
+                        (DwarfAttrib(DW_AT.type, DW_FORM.ref4, 1),),
+                        (
+                            DwarfDie(
+                                DW_TAG.formal_parameter,
+                                (
+                                    DwarfAttrib(DW_AT.type, DW_FORM.ref4, 2),
+                                    DwarfAttrib(DW_AT.name, DW_FORM.string, "c"),
+                                ),
+                            ),
+                        ),
+                    ),
+                    int_die,
+                    char_die,
+                )
+            )
+        )
+        parameters = prog.type("TEST").type.parameters
+        self.assertIsInstance(parameters, tuple)
+        self.assertEqual(len(parameters), 1)
+        self.assertIs(parameters["c"], parameters[0])
+        self.assertIdentical(parameters[0].type, prog.int_type("char", 1, True))
+        self.assertEqual(parameters, (parameters[0],))
+        self.assertRaises(KeyError, parameters.__getitem__, "d")
+
     def test_function_unspecified_parameters(self):
         # int foo()
         prog = dwarf_program(
@@ -6011,6 +6173,43 @@ class TestScopes(TestCase):
             Object(prog, prog.int_type("int", 4, True), 47),
         )
 
+    def test_template_type_spelling(self):
+        prog = dwarf_program(
+            (
+                DwarfDie(
+                    DW_TAG.namespace,
+                    (DwarfAttrib(DW_AT.name, DW_FORM.string, "std"),),
+                    (
+                        DwarfDie(
+                            DW_TAG.class_type,
+                            (
+                                DwarfAttrib(
+                                    DW_AT.name,
+                                    DW_FORM.string,
+                                    "vector<int, std::allocator<int> >",
+                                ),
+                                DwarfAttrib(DW_AT.byte_size, DW_FORM.data1, 24),
+                            ),
+                        ),
+                    ),
+                ),
+            ),
+            lang=DW_LANG.C_plus_plus,
+        )
+        prog.language = Language.CPP
+        type = prog.type("class std::vector<int, std::allocator<int> >")
+        self.assertEqual(type.tag, "vector<int, std::allocator<int> >")
+        for name in (
+            "class std::vector<int,std::allocator<int>>",
+            "class ::std::vector< int, std :: allocator<int>>",
+        ):
+            with self.subTest(name=name):
+                self.assertIdentical(prog.type(name), type)
+        self.assertRaises(
+            LookupError, prog.type, "class std::vector<long, std::allocator<long>>"
+        )
+        self.assertRaises(LookupError, prog.type, "class vector<int>")
+
 
 class TestProgram(TestCase):
     def test_language(self):
@@ -6040,6 +6239,48 @@ class TestProgram(TestCase):
             Language.CPP,
         )
 
+    def test_skip_leb128_attributes(self):
+        # Runs of LEB128 attributes are skipped with a single instruction.
+        # Make sure that long runs with multi-byte values are skipped
+        # correctly before and after an indexed attribute.
+        leb128_attribs = [
+            DwarfAttrib(DW_AT.decl_line, DW_FORM.udata, 1 << (7 * (i % 10)))
+            for i in range(300)
+        ]
+        dies = (
+            int_die,
+            DwarfDie(
+                DW_TAG.variable,
+                (
+                    *leb128_attribs,
+                    DwarfAttrib(DW_AT.name, DW_FORM.string, "x"),
+                    DwarfAttrib(DW_AT.decl_column, DW_FORM.sdata, -(1 << 40)),
+                    DwarfAttrib(DW_AT.decl_column, DW_FORM.sdata, -1),
+                    DwarfAttrib(DW_AT.type, DW_FORM.ref4, 0),
+                    DwarfAttrib(DW_AT.const_value, DW_FORM.sdata, -1000),
+                ),
+            ),
+            DwarfDie(
+                DW_TAG.variable,
+                (
+                    DwarfAttrib(DW_AT.name, DW_FORM.string, "y"),
+                    DwarfAttrib(DW_AT.type, DW_FORM.ref4, 0),
+                    DwarfAttrib(DW_AT.const_value, DW_FORM.udata, 1000),
+                ),
+            ),
+        )
+        prog = dwarf_program(dies)
+        int_type = prog.int_type("int", 4, True)
+        self.assertIdentical(prog["x"], Object(prog, int_type, -1000))
+        self.assertIdentical(prog["y"], Object(prog, int_type, 1000))
+
+    def test_debug_info_timings(self):
+        self.assertEqual(set(debug_info_timings(Program()).values()), {0})
+        timings = debug_info_timings(dwarf_program(TestDwarfIndexCache.DIES))
+        self.assertGreater(timings["read_modules"], 0)
+        self.assertGreater(timings["first_pass"], 0)
+        self.assertGreater(timings["second_pass"], 0)
+
     def test_reference_counting(self):
         # Test that we keep the appropriate objects alive even if we don't have
         # an explicit reference (e.g., from a temporary variable).
@@ -6105,3 +6346,798 @@ class TestProgram(TestCase):
             )
         )
         self.assertIsNotNone(repr(dwarf_program(dies).type("TEST").type.parameters[0]))
+
+
+class TestDwarfIndexCache(TestCase):
+    BUILD_ID = bytes.fromhex("0123456789abcdef0123456789abcdef01234567")
+
+    DIES = (
+        DwarfDie(
+            DW_TAG.structure_type,
+            (
+                DwarfAttrib(DW_AT.name, DW_FORM.string, "point"),
+                DwarfAttrib(DW_AT.byte_size, DW_FORM.data1, 8),
+            ),
+            (
+                DwarfDie(
+                    DW_TAG.member,
+                    (
+                        DwarfAttrib(DW_AT.name, DW_FORM.string, "x"),
+                        DwarfAttrib(DW_AT.data_member_location, DW_FORM.data1, 0),
+                        DwarfAttrib(DW_AT.type, DW_FORM.ref4, 1),
+                    ),
+                ),
+                DwarfDie(
+                    DW_TAG.member,
+                    (
+                        DwarfAttrib(DW_AT.name, DW_FORM.string, "y"),
+                        DwarfAttrib(DW_AT.data_member_location, DW_FORM.data1, 4),
+                        DwarfAttrib(DW_AT.type, DW_FORM.ref4, 1),
+                    ),
+                ),
+            ),
+        ),
+        int_die,
+        DwarfDie(
+            DW_TAG.enumeration_type,
+            (
+                DwarfAttrib(DW_AT.name, DW_FORM.string, "color"),
+                DwarfAttrib(DW_AT.type, DW_FORM.ref4, 3),
+                DwarfAttrib(DW_AT.byte_size, DW_FORM.data1, 4),
+            ),
+            (
+                DwarfDie(
+                    DW_TAG.enumerator,
+                    (
+                        DwarfAttrib(DW_AT.name, DW_FORM.string, "RED"),
+                        DwarfAttrib(DW_AT.const_value, DW_FORM.data1, 0),
+                    ),
+                ),
+                DwarfDie(
+                    DW_TAG.enumerator,
+                    (
+                        DwarfAttrib(DW_AT.name, DW_FORM.string, "GREEN"),
+                        DwarfAttrib(DW_AT.const_value, DW_FORM.data1, 1),
+                    ),
+                ),
+            ),
+        ),
+        unsigned_int_die,
+    )
+
+    def setUp(self):
+        super().setUp()
+        cache_dir = tempfile.TemporaryDirectory(prefix="drgn-tests-")
+        self.addCleanup(cache_dir.cleanup)
+        self.cache_dir = cache_dir.name
+        patcher = unittest.mock.patch.dict(
+            os.environ, {"DRGN_DWARF_INDEX_CACHE_DIR": self.cache_dir}
+        )
+        patcher.start()
+        self.addCleanup(patcher.stop)
+
+        # NT_GNU_BUILD_ID note.
+        note = (
+            struct.pack("<III", 4, len(self.BUILD_ID), 3)
+            + b"GNU\0"
+            + self.BUILD_ID
+        )
+        f = tempfile.NamedTemporaryFile()
+        self.addCleanup(f.close)
+        f.write(
+            create_elf_file(
+                ET.EXEC,
+                [
+                    ElfSection(
+                        name=".note.gnu.build-id",
+                        sh_type=SHT.NOTE,
+                        data=note,
+                    ),
+                    *dwarf_sections(self.DIES),
+                ],
+            )
+        )
+        f.flush()
+        self.path = f.name
+        self.cache_path = os.path.join(self.cache_dir, self.BUILD_ID.hex() + ".dwidx")
+
+    def load(self):
+        prog = Program()
+        prog.load_debug_info([self.path])
+        return prog
+
+    def assertIndexed(self, prog):
+        self.assertEqual(
+            prog.type("struct point").members[1].name,
+            "y",
+        )
+        self.assertEqual(prog.type("enum color").enumerators[1].name, "GREEN")
+        self.assertIdentical(
+            prog["GREEN"], Object(prog, prog.type("enum color"), 1)
+        )
+        self.assertRaises(LookupError, prog.type, "struct line")
+
+    def test_write_and_read(self):
+        self.assertIndexed(self.load())
+        self.assertTrue(os.path.exists(self.cache_path))
+        self.assertIndexed(self.load())
+
+    def test_invalid_cache_file(self):
+        with open(self.cache_path, "wb") as f:
+            f.write(b"DRGNDIDX" + b"\0" * 92)
+        self.assertIndexed(self.load())
+
+    def test_stale_cache_file(self):
+        self.load()
+        # Truncate the DIE entries. The file should be rejected and rewritten.
+        size = os.path.getsize(self.cache_path)
+        os.truncate(self.cache_path, size - 1)
+        self.assertIndexed(self.load())
+        self.assertEqual(os.path.getsize(self.cache_path), size)
+
+
+class TestCompressedDebugSections(TestCase):
+    SHF_COMPRESSED = 0x800
+    ELFCOMPRESS_ZLIB = 1
+
+    def setUp(self):
+        super().setUp()
+        sections = []
+        for section in dwarf_sections(TestDwarfIndexCache.DIES):
+            sections.append(
+                ElfSection(
+                    name=section.name,
+                    sh_type=section.sh_type,
+                    # Elf64_Chdr followed by the compressed data.
+                    data=struct.pack(
+                        "<IIQQ", self.ELFCOMPRESS_ZLIB, 0, len(section.data), 1
+                    )
+                    + zlib.compress(section.data),
+                    sh_flags=self.SHF_COMPRESSED,
+                    sh_addralign=8,
+                )
+            )
+        build_id = TestDwarfIndexCache.BUILD_ID
+        note = struct.pack("<III", 4, len(build_id), 3) + b"GNU\0" + build_id
+        f = tempfile.NamedTemporaryFile()
+        self.addCleanup(f.close)
+        f.write(
+            create_elf_file(
+                ET.EXEC,
+                [
+                    ElfSection(name=".note.gnu.build-id", sh_type=SHT.NOTE, data=note),
+                    *sections,
+                ],
+            )
+        )
+        f.flush()
+        self.path = f.name
+
+    def load(self):
+        prog = Program()
+        prog.load_debug_info([self.path])
+        return prog
+
+    def assertLoaded(self, prog):
+        self.assertEqual(prog.type("struct point").members[1].name, "y")
+        self.assertIdentical(prog["GREEN"], Object(prog, prog.type("enum color"), 1))
+
+    def test_decompress(self):
+        self.assertLoaded(self.load())
+
+    def test_cache(self):
+        cache_dir = tempfile.TemporaryDirectory(prefix="drgn-tests-")
+        self.addCleanup(cache_dir.cleanup)
+        with unittest.mock.patch.dict(
+            os.environ, {"DRGN_DECOMPRESSED_DEBUG_INFO_CACHE_DIR": cache_dir.name}
+        ):
+            self.assertLoaded(self.load())
+            cache_path = os.path.join(
+                cache_dir.name, TestDwarfIndexCache.BUILD_ID.hex() + ".debug"
+            )
+            self.assertTrue(os.path.exists(cache_path))
+            self.assertLoaded(self.load())
+        # The cached copy must be usable on its own.
+        prog = Program()
+        prog.load_debug_info([cache_path])
+        self.assertLoaded(prog)
+
+    def test_invalid_cache_file(self):
+        cache_dir = tempfile.TemporaryDirectory(prefix="drgn-tests-")
+        self.addCleanup(cache_dir.cleanup)
+        cache_path = os.path.join(
+            cache_dir.name, TestDwarfIndexCache.BUILD_ID.hex() + ".debug"
+        )
+        with open(cache_path, "wb") as f:
+            f.write(b"\x7fELF")
+        with unittest.mock.patch.dict(
+            os.environ, {"DRGN_DECOMPRESSED_DEBUG_INFO_CACHE_DIR": cache_dir.name}
+        ):
+            self.assertLoaded(self.load())
+class TestUserspaceCoreDumpFiles(TestCase):
+    NT_FILE = 0x46494C45
+    PAGE_SIZE = 0x1000
+    # File offset and address of the loadable segment of each mapped file.
+    LOAD_OFFSET = 0x800
+    NUM_FILES = 30
+
+    @staticmethod
+    def build_id(i):
+        return i.to_bytes(2, "little") * 10
+
+    def mapped_file(self, i, build_id):
+        note = struct.pack("<III", 4, len(build_id), 3) + b"GNU\0" + build_id
+        sections = dwarf_sections(
+            (
+                int_die,
+                DwarfDie(
+                    DW_TAG.variable,
+                    (
+                        DwarfAttrib(DW_AT.name, DW_FORM.string, f"x{i}"),
+                        DwarfAttrib(DW_AT.type, DW_FORM.ref4, 0),
+                        DwarfAttrib(DW_AT.const_value, DW_FORM.udata, i),
+                    ),
+                ),
+            )
+        )
+        # The note is right after the ELF header, section headers, and two
+        # program headers. Its address is its file offset.
+        note_offset = 64 + 64 * (len(sections) + 3) + 56 * 2
+        return create_elf_file(
+            ET.DYN,
+            [
+                ElfSection(
+                    name=".note.gnu.build-id",
+                    sh_type=SHT.NOTE,
+                    p_type=PT.NOTE,
+                    vaddr=note_offset,
+                    p_align=4,
+                    sh_addralign=4,
+                    data=note,
+                ),
+                ElfSection(
+                    p_type=PT.LOAD,
+                    vaddr=self.LOAD_OFFSET,
+                    p_align=self.PAGE_SIZE,
+                    data=bytes(16),
+                ),
+                *sections,
+            ],
+        )
+
+    def setUp(self):
+        super().setUp()
+        # Every third file is dumped but doesn't match on disk, and every
+        # third file isn't dumped, so its path is trusted.
+        tmp = tempfile.TemporaryDirectory(prefix="drgn-tests-")
+        self.addCleanup(tmp.cleanup)
+        self.tmp_dir = tmp.name
+        self.paths = []
+        self.mismatched = []
+        mappings = []
+        core_sections = []
+        for i in range(self.NUM_FILES):
+            path = os.path.join(self.tmp_dir, f"lib{i}.so")
+            self.paths.append(path)
+            data = self.mapped_file(i, self.build_id(i))
+            with open(path, "wb") as f:
+                if i % 3 == 1:
+                    f.write(self.mapped_file(i, self.build_id(i + 1000)))
+                    self.mismatched.append(i)
+                else:
+                    f.write(data)
+            start = 0x10000000 + i * 0x100000
+            end = start + -(-len(data) // self.PAGE_SIZE) * self.PAGE_SIZE
+            mappings.append((start, end, path))
+            if i % 3 != 2:
+                core_sections.append(
+                    ElfSection(
+                        p_type=PT.LOAD, vaddr=start, data=data[: self.PAGE_SIZE]
+                    )
+                )
+
+        desc = bytearray(struct.pack("<QQ", len(mappings), self.PAGE_SIZE))
+        for start, end, _ in mappings:
+            desc.extend(struct.pack("<QQQ", start, end, 0))
+        for _, _, path in mappings:
+            desc.extend(path.encode())
+            desc.append(0)
+        desc.extend(bytes(-len(desc) % 4))
+        note = struct.pack("<III", 5, len(desc), self.NT_FILE) + b"CORE\0\0\0\0" + desc
+        self.core_path = os.path.join(self.tmp_dir, "core")
+        with open(self.core_path, "wb") as f:
+            f.write(
+                create_elf_file(
+                    ET.CORE,
+                    [ElfSection(p_type=PT.NOTE, p_align=4, data=note), *core_sections],
+                )
+            )
+
+    def core_program(self):
+        prog = Program()
+        prog.set_core_dump(self.core_path)
+        return prog
+
+    def assertLoaded(self, prog, indices):
+        int_type = prog.int_type("int", 4, True)
+        for i in indices:
+            self.assertIdentical(prog[f"x{i}"], Object(prog, int_type, i))
+
+    def test_mapped_files(self):
+        prog = self.core_program()
+        with self.assertRaises(drgn.MissingDebugInfoError) as cm:
+            prog.load_debug_info(None, True)
+        self.assertLoaded(
+            prog, [i for i in range(self.NUM_FILES) if i not in self.mismatched]
+        )
+        for i in self.mismatched:
+            with self.subTest(i=i):
+                self.assertIn(self.paths[i], str(cm.exception))
+                self.assertRaises(KeyError, prog.__getitem__, f"x{i}")
+
+    def fetched_file(self, build_id):
+        # The mismatched files are fetched by the build ID in the core dump.
+        i = int.from_bytes(build_id[:2], "little")
+        path = os.path.join(self.tmp_dir, f"{build_id.hex()}.debug")
+        with open(path, "wb") as f:
+            f.write(self.mapped_file(i, build_id))
+        return path
+
+    def test_fetch(self):
+        build_ids = []
+        lock = threading.Lock()
+
+        def fetch(build_id):
+            with lock:
+                build_ids.append(build_id)
+            return self.fetched_file(build_id)
+
+        prog = self.core_program()
+        prog.set_debug_file_fetcher(fetch)
+        prog.load_debug_info(None, True)
+        self.assertLoaded(prog, range(self.NUM_FILES))
+        self.assertCountEqual(build_ids, [self.build_id(i) for i in self.mismatched])
+
+    def test_fetch_not_found(self):
+        prog = self.core_program()
+        prog.set_debug_file_fetcher(lambda build_id: None)
+        with self.assertRaises(drgn.MissingDebugInfoError) as cm:
+            prog.load_debug_info(None, True)
+        for i in self.mismatched:
+            self.assertIn(self.paths[i], str(cm.exception))
+
+    def test_fetch_error(self):
+        def fetch(build_id):
+            raise OSError("server is down")
+
+        prog = self.core_program()
+        prog.set_debug_file_fetcher(fetch)
+        with self.assertRaisesRegex(
+            drgn.MissingDebugInfoError, "could not fetch debugging information"
+        ):
+            prog.load_debug_info(None, True)
+
+    def test_no_fetcher(self):
+        prog = self.core_program()
+        prog.set_debug_file_fetcher(self.fetched_file)
+        prog.set_debug_file_fetcher(None)
+        self.assertRaises(drgn.MissingDebugInfoError, prog.load_debug_info, None, True)
+
+    def test_fetch_cache(self):
+        cache_dir = os.path.join(self.tmp_dir, "cache")
+        with unittest.mock.patch.dict(
+            os.environ, {"DRGN_DEBUG_FILE_CACHE_DIR": cache_dir}
+        ):
+            prog = self.core_program()
+            prog.set_debug_file_fetcher(self.fetched_file)
+            prog.load_debug_info(None, True)
+            self.assertLoaded(prog, range(self.NUM_FILES))
+            for i in self.mismatched:
+                self.assertTrue(
+                    os.path.exists(
+                        os.path.join(cache_dir, self.build_id(i).hex() + ".debug")
+                    )
+                )
+
+            # The cached files are used without calling the fetcher.
+            def fetch(build_id):
+                raise AssertionError("fetcher called")
+
+            prog = self.core_program()
+            prog.set_debug_file_fetcher(fetch)
+            prog.load_debug_info(None, True)
+            self.assertLoaded(prog, range(self.NUM_FILES))
+
+
+class TestRelocations(TestCase):
+    R_X86_64_64 = 1
+    # More than one chunk of relocations in relocate_elf_file().
+    NUM_VARIABLES = 40000
+    PLACEHOLDER = 0xDEADBEEF00000000
+    SYMBOL_VALUE = 0x10000000
+
+    def relocatable_program(self, bad_symbol=False):
+        dies = (
+            unsigned_long_die,
+            *(
+                DwarfDie(
+                    DW_TAG.variable,
+                    (
+                        DwarfAttrib(DW_AT.name, DW_FORM.string, f"x{i}"),
+                        DwarfAttrib(DW_AT.type, DW_FORM.ref4, 0),
+                        DwarfAttrib(
+                            DW_AT.const_value, DW_FORM.data8, self.PLACEHOLDER + i
+                        ),
+                    ),
+                )
+                for i in range(self.NUM_VARIABLES)
+            ),
+        )
+        sections = dwarf_sections(dies)
+        debug_info_index = next(
+            i for i, section in enumerate(sections, 1) if section.name == ".debug_info"
+        )
+        debug_info = sections[debug_info_index - 1].data
+        rela = bytearray()
+        offset = 0
+        for i in range(self.NUM_VARIABLES):
+            offset = debug_info.index(struct.pack("<Q", self.PLACEHOLDER + i), offset)
+            # Symbol 1 is the only symbol. The last relocation optionally
+            # refers to a nonexistent one.
+            sym = 2 if bad_symbol and i == self.NUM_VARIABLES - 1 else 1
+            rela.extend(struct.pack("<QQq", offset, (sym << 32) | self.R_X86_64_64, i))
+        sections.append(
+            ElfSection(
+                name=".rela.debug_info",
+                sh_type=SHT.RELA,
+                data=rela,
+                # .symtab is added after this section.
+                sh_link=len(sections) + 2,
+                sh_info=debug_info_index,
+                sh_entsize=24,
+            )
+        )
+        with tempfile.NamedTemporaryFile() as f:
+            f.write(
+                create_elf_file(
+                    ET.REL,
+                    sections,
+                    [
+                        ElfSymbol(
+                            "base",
+                            self.SYMBOL_VALUE,
+                            0,
+                            STT.NOTYPE,
+                            STB.GLOBAL,
+                            debug_info_index,
+                        )
+                    ],
+                )
+            )
+            f.flush()
+            prog = Program()
+            prog.load_debug_info([f.name])
+        return prog
+
+    def test_relocations(self):
+        prog = self.relocatable_program()
+        type = prog.type("unsigned long")
+        for i in (0, 1, 16383, 16384, 32768, self.NUM_VARIABLES - 1):
+            self.assertIdentical(
+                prog[f"x{i}"], Object(prog, type, self.SYMBOL_VALUE + i)
+            )
+
+    def test_error_in_last_chunk(self):
+        self.assertRaisesRegex(
+            Exception,
+            "invalid ELF relocation symbol",
+            self.relocatable_program,
+            bad_symbol=True,
+        )
+
+
+class TestLazyDwarfIndex(TestCase):
+    def setUp(self):
+        super().setUp()
+        patcher = unittest.mock.patch.dict(os.environ, {"DRGN_LAZY_DWARF_INDEX": "1"})
+        patcher.start()
+        self.addCleanup(patcher.stop)
+
+    def test_lookup(self):
+        prog = dwarf_program(TestDwarfIndexCache.DIES)
+        self.assertEqual(prog.type("struct point").members[1].name, "y")
+        self.assertIdentical(prog["GREEN"], Object(prog, prog.type("enum color"), 1))
+        self.assertRaises(LookupError, prog.type, "struct line")
+
+    def test_multiple_loads(self):
+        prog = Program()
+        for dies in (TestDwarfIndexCache.DIES, (int_die,)):
+            with tempfile.NamedTemporaryFile() as f:
+                f.write(compile_dwarf(dies))
+                f.flush()
+                prog.load_debug_info([f.name])
+        self.assertEqual(prog.type("struct point").members[0].name, "x")
+        self.assertIdentical(prog.type("int"), prog.int_type("int", 4, True))
+
+
+class TestStreamDwarfIndex(TestCase):
+    def setUp(self):
+        super().setUp()
+        patcher = unittest.mock.patch.dict(
+            os.environ, {"DRGN_STREAM_DWARF_INDEX": "1"}
+        )
+        patcher.start()
+        self.addCleanup(patcher.stop)
+
+    def test_lookup(self):
+        prog = dwarf_program(TestDwarfIndexCache.DIES)
+        self.assertEqual(prog.type("struct point").members[1].name, "y")
+        self.assertIdentical(prog["GREEN"], Object(prog, prog.type("enum color"), 1))
+        self.assertRaises(LookupError, prog.type, "struct line")
+
+    def test_lookup_after_load(self):
+        prog = Program()
+        with tempfile.NamedTemporaryFile() as f:
+            f.write(compile_dwarf((int_die,)))
+            f.flush()
+            prog.load_debug_info([f.name])
+        self.assertIdentical(prog.type("int"), prog.int_type("int", 4, True))
+        # Names that were already looked up must also find DIEs from files
+        # loaded later.
+        self.assertRaises(LookupError, prog.type, "struct point")
+        with tempfile.NamedTemporaryFile() as f:
+            f.write(compile_dwarf(TestDwarfIndexCache.DIES))
+            f.flush()
+            prog.load_debug_info([f.name])
+        self.assertEqual(prog.type("struct point").members[0].name, "x")
+        self.assertIdentical(prog.type("int"), prog.int_type("int", 4, True))
+
+class TestPrefetchDebugSections(TestCase):
+    # Enough DIEs that the sections span several pages.
+    NUM_VARIABLES = 10000
+    DIES = (
+        int_die,
+        *(
+            DwarfDie(
+                DW_TAG.variable,
+                (
+                    DwarfAttrib(DW_AT.name, DW_FORM.string, f"x{i}"),
+                    DwarfAttrib(DW_AT.type, DW_FORM.ref4, 0),
+                    DwarfAttrib(DW_AT.const_value, DW_FORM.udata, i),
+                ),
+            )
+            for i in range(NUM_VARIABLES)
+        ),
+    )
+
+    def assertLoaded(self, prog):
+        int_type = prog.int_type("int", 4, True)
+        for i in (0, self.NUM_VARIABLES // 2, self.NUM_VARIABLES - 1):
+            self.assertIdentical(prog[f"x{i}"], Object(prog, int_type, i))
+
+    def test_without_debug_names(self):
+        self.assertLoaded(dwarf_program(self.DIES))
+
+    def test_with_debug_names(self):
+        self.assertLoaded(dwarf_program(self.DIES, debug_names=True))
+
+    def test_low_memory(self):
+        # The prefetched pages are paged out again after indexing.
+        with unittest.mock.patch.dict(os.environ, {"DRGN_LOW_MEMORY_DEBUG_INFO": "1"}):
+            self.assertLoaded(dwarf_program(self.DIES))
+            self.assertLoaded(dwarf_program(self.DIES, debug_names=True))
+
+
+class TestLowMemoryDebugInfo(TestCase):
+    def setUp(self):
+        super().setUp()
+        patcher = unittest.mock.patch.dict(
+            os.environ, {"DRGN_LOW_MEMORY_DEBUG_INFO": "1"}
+        )
+        patcher.start()
+        self.addCleanup(patcher.stop)
+
+    def test_lookup(self):
+        prog = dwarf_program(TestDwarfIndexCache.DIES)
+        self.assertEqual(prog.type("struct point").members[1].name, "y")
+        self.assertIdentical(prog["GREEN"], Object(prog, prog.type("enum color"), 1))
+        self.assertRaises(LookupError, prog.type, "struct line")
+
+    def test_namespace(self):
+        prog = dwarf_program(
+            (
+                int_die,
+                DwarfDie(
+                    DW_TAG.namespace,
+                    (DwarfAttrib(DW_AT.name, DW_FORM.string, "moho"),),
+                    (
+                        DwarfDie(
+                            DW_TAG.namespace,
+                            (DwarfAttrib(DW_AT.name, DW_FORM.string, "eve"),),
+                            (
+                                DwarfDie(
+                                    DW_TAG.variable,
+                                    (
+                                        DwarfAttrib(
+                                            DW_AT.name, DW_FORM.string, "gilly"
+                                        ),
+                                        DwarfAttrib(DW_AT.type, DW_FORM.ref4, 0),
+                                        DwarfAttrib(
+                                            DW_AT.const_value, DW_FORM.data1, 13
+                                        ),
+                                    ),
+                                ),
+                            ),
+                        ),
+                    ),
+                ),
+            )
+        )
+        self.assertIdentical(
+            prog["moho::eve::gilly"], Object(prog, prog.int_type("int", 4, True), 13)
+        )
+
+    def test_multiple_loads(self):
+        prog = Program()
+        for dies in (TestDwarfIndexCache.DIES, (int_die,)):
+            with tempfile.NamedTemporaryFile() as f:
+                f.write(compile_dwarf(dies))
+                f.flush()
+                prog.load_debug_info([f.name])
+        self.assertEqual(prog.type("struct point").members[0].name, "x")
+        self.assertIdentical(prog.type("int"), prog.int_type("int", 4, True))
+
+
+class TestPrefetchDwarfNamespaces(TestCase):
+    def setUp(self):
+        super().setUp()
+        patcher = unittest.mock.patch.dict(
+            os.environ, {"DRGN_PREFETCH_DWARF_NAMESPACES": "1"}
+        )
+        patcher.start()
+        self.addCleanup(patcher.stop)
+
+    def test_nested(self):
+        def variable_die(name, value):
+            return DwarfDie(
+                DW_TAG.variable,
+                (
+                    DwarfAttrib(DW_AT.name, DW_FORM.string, name),
+                    DwarfAttrib(DW_AT.type, DW_FORM.ref4, 0),
+                    DwarfAttrib(DW_AT.const_value, DW_FORM.data1, value),
+                ),
+            )
+
+        prog = dwarf_program(
+            (
+                int_die,
+                DwarfDie(
+                    DW_TAG.namespace,
+                    (DwarfAttrib(DW_AT.name, DW_FORM.string, "moho"),),
+                    (
+                        variable_die("kerbin", 1),
+                        DwarfDie(
+                            DW_TAG.namespace,
+                            (DwarfAttrib(DW_AT.name, DW_FORM.string, "eve"),),
+                            (variable_die("gilly", 13),),
+                        ),
+                    ),
+                ),
+                DwarfDie(
+                    DW_TAG.namespace,
+                    (DwarfAttrib(DW_AT.name, DW_FORM.string, "duna"),),
+                    (variable_die("ike", 2),),
+                ),
+            )
+        )
+        int_type = prog.int_type("int", 4, True)
+        self.assertIdentical(prog["moho::kerbin"], Object(prog, int_type, 1))
+        self.assertIdentical(prog["moho::eve::gilly"], Object(prog, int_type, 13))
+        self.assertIdentical(prog["duna::ike"], Object(prog, int_type, 2))
+        self.assertRaises(LookupError, prog.object, "duna::gilly")
+
+
+class TestDebugNames(TestCase):
+    DIES = (
+        int_die,
+        DwarfDie(
+            DW_TAG.variable,
+            (
+                DwarfAttrib(DW_AT.name, DW_FORM.string, "x"),
+                DwarfAttrib(DW_AT.type, DW_FORM.ref4, 0),
+                DwarfAttrib(
+                    DW_AT.location,
+                    DW_FORM.exprloc,
+                    b"\x03\x04\x03\x02\x01\xff\xff\xff\xff",
+                ),
+            ),
+        ),
+        DwarfDie(
+            DW_TAG.enumeration_type,
+            (
+                DwarfAttrib(DW_AT.name, DW_FORM.string, "color"),
+                DwarfAttrib(DW_AT.type, DW_FORM.ref4, 0),
+                DwarfAttrib(DW_AT.byte_size, DW_FORM.data1, 4),
+            ),
+            (
+                DwarfDie(
+                    DW_TAG.enumerator,
+                    (
+                        DwarfAttrib(DW_AT.name, DW_FORM.string, "RED"),
+                        DwarfAttrib(DW_AT.const_value, DW_FORM.data1, 0),
+                    ),
+                ),
+            ),
+        ),
+        DwarfDie(
+            DW_TAG.enumeration_type,
+            (
+                DwarfAttrib(DW_AT.type, DW_FORM.ref4, 0),
+                DwarfAttrib(DW_AT.byte_size, DW_FORM.data1, 4),
+            ),
+            (
+                DwarfDie(
+                    DW_TAG.enumerator,
+                    (
+                        DwarfAttrib(DW_AT.name, DW_FORM.string, "BLUE"),
+                        DwarfAttrib(DW_AT.const_value, DW_FORM.data1, 2),
+                    ),
+                ),
+            ),
+        ),
+        DwarfDie(
+            DW_TAG.subprogram,
+            (DwarfAttrib(DW_AT.name, DW_FORM.string, "main"),),
+            (
+                DwarfDie(
+                    DW_TAG.variable,
+                    (
+                        DwarfAttrib(DW_AT.name, DW_FORM.string, "y"),
+                        DwarfAttrib(DW_AT.type, DW_FORM.ref4, 0),
+                        DwarfAttrib(
+                            DW_AT.location,
+                            DW_FORM.exprloc,
+                            b"\x03\x04\x03\x02\x01\xff\xff\xff\xff",
+                        ),
+                    ),
+                ),
+            ),
+        ),
+    )
+
+    def load(self, use_debug_names):
+        with unittest.mock.patch.dict(
+            os.environ, {"DRGN_USE_DEBUG_NAMES": str(int(use_debug_names))}
+        ):
+            return dwarf_program(self.DIES, debug_names=True)
+
+    def test_types_and_variables(self):
+        for use_debug_names in (True, False):
+            with self.subTest(use_debug_names=use_debug_names):
+                prog = self.load(use_debug_names)
+                self.assertIdentical(prog.type("int"), prog.int_type("int", 4, True))
+                self.assertIdentical(
+                    prog["x"],
+                    Object(
+                        prog,
+                        prog.int_type("int", 4, True),
+                        address=0xFFFFFFFF01020304,
+                    ),
+                )
+                self.assertEqual(prog.type("enum color").enumerators[0].name, "RED")
+
+    def test_enumerators(self):
+        for use_debug_names in (True, False):
+            with self.subTest(use_debug_names=use_debug_names):
+                prog = self.load(use_debug_names)
+                self.assertIdentical(
+                    prog["RED"], Object(prog, prog.type("enum color"), 0)
+                )
+                self.assertEqual(prog["BLUE"].value_(), 2)
+                self.assertEqual(prog["BLUE"].type_.enumerators[0].name, "BLUE")
+
+    def test_local_variable(self):
+        for use_debug_names in (True, False):
+            with self.subTest(use_debug_names=use_debug_names):
+                prog = self.load(use_debug_names)
+                self.assertRaises(LookupError, prog.object, "y")
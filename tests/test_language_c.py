@@ -796,6 +796,31 @@ class TestLexer(TestCase):
             [(C_TOKEN.IDENTIFIER, value) for value in tokens],
         )
 
+    def test_cpp_qualified_identifiers(self):
+        s = "::foo std::vector<std::pair<int, int> > ns :: bar<(1 > 2)>"
+        self.assertEqual(
+            [(token.kind, token.value) for token in self.lex(s, cpp=True)],
+            [
+                (C_TOKEN.IDENTIFIER, "::foo"),
+                (C_TOKEN.IDENTIFIER, "std::vector<std::pair<int, int> >"),
+                (C_TOKEN.IDENTIFIER, "ns :: bar<(1 > 2)>"),
+            ],
+        )
+
+    def test_cpp_invalid_qualified_identifiers(self):
+        self.assertRaisesRegex(
+            SyntaxError,
+            "unterminated template argument list",
+            list,
+            self.lex("foo<int", cpp=True),
+        )
+        self.assertRaisesRegex(
+            SyntaxError,
+            "expected identifier after '::'",
+            list,
+            self.lex(":: *", cpp=True),
+        )
+
     def test_almost_keywords(self):
         s = """voi cha shor in lon signe unsigne _Boo floa doubl
         _Comple cons restric volatil _Atomi struc unio enu"""
@@ -1988,6 +2013,27 @@ class TestPrettyPrintObject(MockProgramTestCase):
         obj = Object(self.prog, self.prog.enum_type("color"), address=0)
         self.assertRaisesRegex(TypeError, "cannot format incomplete enum", str, obj)
 
+    def test_enum_many_enumerators(self):
+        for signed in (False, True):
+            with self.subTest(signed=signed):
+                type = self.prog.enum_type(
+                    "big",
+                    self.prog.int_type("int", 4, signed),
+                    [TypeEnumerator(f"BIG_{i}", i - 50 * signed) for i in range(100)]
+                    # The first enumerator with a value is used.
+                    + [TypeEnumerator("BIG_ALIAS", 10)],
+                )
+                for value in (-50, -1, 0, 10, 49):
+                    if value < 0 and not signed:
+                        continue
+                    self.assertEqual(
+                        str(Object(self.prog, type, value=value)),
+                        f"(enum big)BIG_{value + 50 * signed}",
+                    )
+                self.assertEqual(
+                    str(Object(self.prog, type, value=100)), "(enum big)100"
+                )
+
     def test_pointer(self):
         self.add_memory_segment((99).to_bytes(4, "little"), virt_addr=0xFFFF0000)
         obj = Object(self.prog, "int *", value=0xFFFF0000)
@@ -2035,6 +2081,20 @@ class TestPrettyPrintObject(MockProgramTestCase):
             r'(char *)0xffff0020 = "\"escape\tme\\"',
         )
 
+    def test_c_string_page_boundary(self):
+        # The string crosses a page boundary, and the rest of the second page
+        # isn't mapped.
+        self.add_memory_segment(b"a" * 16, virt_addr=0xFFFF0FF0)
+        self.add_memory_segment(b"b" * 16 + b"\0", virt_addr=0xFFFF1000)
+        self.assertEqual(
+            str(Object(self.prog, "char *", value=0xFFFF0FF0)),
+            '(char *)0xffff0ff0 = "' + "a" * 16 + "b" * 16 + '"',
+        )
+        self.assertEqual(
+            Object(self.prog, "char *", value=0xFFFF0FF0).string_(),
+            b"a" * 16 + b"b" * 16,
+        )
+
     def test_basic_array(self):
         segment = bytearray()
         for i in range(5):
@@ -2117,6 +2177,40 @@ class TestPrettyPrintObject(MockProgramTestCase):
 }""",
         )
 
+    def test_array_limits(self):
+        segment = bytearray()
+        for i in range(5):
+            segment.extend(i.to_bytes(4, "little"))
+        self.add_memory_segment(segment, virt_addr=0xFFFF0000)
+        obj = Object(self.prog, "int [5]", address=0xFFFF0000)
+
+        self.assertEqual(obj.format_(max_elements=2), "(int [5]){ 0, 1, ... }")
+        self.assertEqual(obj.format_(max_elements=5), str(obj))
+        self.assertEqual(obj.format_(max_elements=None), str(obj))
+        self.assertEqual(
+            obj.format_(max_elements=2, columns=20),
+            """\
+(int [5]){
+	0, 1,
+	...
+}""",
+        )
+        self.assertEqual(obj.format_(max_size=12), "(int [5]){ 0, ... }")
+        self.assertEqual(obj.format_(max_size=1000), str(obj))
+
+    def test_large_array(self):
+        # Larger than the chunk size used to read arrays.
+        segment = bytearray()
+        for i in range(20000):
+            segment.extend(i.to_bytes(4, "little"))
+        self.add_memory_segment(segment, virt_addr=0xFFFF0000)
+        obj = Object(self.prog, "int [20000]", address=0xFFFF0000)
+        self.assertEqual(
+            str(obj),
+            "(int [20000]){ " + ", ".join(str(i) for i in range(20000)) + " }",
+        )
+        self.assertEqual(obj.format_(max_elements=3), "(int [20000]){ 0, 1, 2, ... }")
+
     def test_nested_array(self):
         segment = bytearray()
         for i in range(10):
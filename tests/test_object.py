@@ -280,6 +280,55 @@ class TestReference(MockProgramTestCase):
             obj.value_(), {"point": {"x": 99, "y": -1}, "bar": 12345, "baz": 0}
         )
 
+    def test_snapshot(self):
+        buf = bytearray(struct.pack("<4i", 1, 2, 3, 4))
+        reads = []
+
+        def read_fn(address, count, offset, physical):
+            reads.append((address, count))
+            return buf[offset : offset + count]
+
+        self.prog.add_memory_segment(0xFFFF0000, len(buf), read_fn)
+
+        obj = Object(self.prog, self.line_segment_type, address=0xFFFF0000)
+        snapshot = obj.snapshot_()
+        # Comparing the objects would read them, so only check the type and
+        # address.
+        self.assertIdentical(snapshot.type_, obj.type_)
+        self.assertEqual(snapshot.address_, 0xFFFF0000)
+        self.assertEqual(reads, [])
+        self.assertIdentical(snapshot.b.type_, self.point_type)
+        self.assertEqual(snapshot.b.address_, 0xFFFF0008)
+        self.assertEqual(snapshot.b.x.value_(), 3)
+        self.assertEqual(reads, [(0xFFFF0000, 16)])
+
+        buf[:] = struct.pack("<4i", 5, 6, 7, 8)
+        self.assertEqual(snapshot.a.x.value_(), 1)
+        self.assertEqual(int(snapshot.a.y), 2)
+        self.assertIdentical(
+            snapshot.b.read_(), Object(self.prog, self.point_type, {"x": 3, "y": 4})
+        )
+        self.assertEqual(
+            snapshot.value_(), {"a": {"x": 1, "y": 2}, "b": {"x": 3, "y": 4}}
+        )
+        self.assertTrue(snapshot.b.y)
+        self.assertEqual(len(reads), 1)
+
+        self.assertEqual(obj.a.x.value_(), 5)
+        self.assertEqual(snapshot.snapshot_().a.x.value_(), 5)
+
+    def test_snapshot_array(self):
+        self.add_memory_segment(struct.pack("<4i", 1, 2, 3, 4), virt_addr=0xFFFF0000)
+        obj = Object(self.prog, "int [4]", address=0xFFFF0000).snapshot_()
+        self.assertEqual([element.value_() for element in obj], [1, 2, 3, 4])
+        self.assertEqual(obj[3].address_, 0xFFFF000C)
+
+    def test_snapshot_scalar(self):
+        obj = Object(self.prog, "int", address=0xFFFF0000)
+        self.assertIs(obj.snapshot_(), obj)
+        obj = Object(self.prog, "int", value=1)
+        self.assertIs(obj.snapshot_(), obj)
+
     def test_read_struct_bit_offset(self):
         value = 12345678912345678989
         for bit_size in range(1, 65):
@@ -821,6 +870,22 @@ class TestValue(MockProgramTestCase):
             value=[1, 2],
         )
 
+    def test_array_inline_size(self):
+        # Values up to 8 bytes are stored inline in the object; make sure that
+        # both sides of the boundary work.
+        for length in (1, 2, 3):
+            with self.subTest(length=length):
+                address = 0xFFFF0000 + 0x1000 * length
+                self.add_memory_segment(
+                    struct.pack(f"<{length}i", *range(length)), virt_addr=address
+                )
+                obj = Object(self.prog, f"int [{length}]", address=address).read_()
+                self.assertEqual(obj.value_(), list(range(length)))
+                self.assertEqual(obj[length - 1].value_(), length - 1)
+                copy = Object(self.prog, obj.type_, value=obj.value_())
+                self.assertIdentical(copy, obj)
+                self.assertEqual(copy.to_bytes_(), obj.to_bytes_())
+
     def test_non_scalar_bit_offset(self):
         obj = Object(
             self.prog,
@@ -1092,6 +1157,11 @@ class TestConversions(MockProgramTestCase):
             b"\x01\x00\x00\x00\x02\x00\x00\x00",
         )
 
+    def test_struct_value_to_bytes_view(self):
+        view = Object(self.prog, self.point_type, {"x": 1, "y": 2}).to_bytes_view_()
+        self.assertTrue(view.readonly)
+        self.assertEqual(view, b"\x01\x00\x00\x00\x02\x00\x00\x00")
+
     def test_int_reference_to_bytes(self):
         self.add_memory_segment(b"\x78\x56\x34\x12", virt_addr=0xFFFF0000)
         self.assertEqual(
@@ -1099,6 +1169,13 @@ class TestConversions(MockProgramTestCase):
             b"\x78\x56\x34\x12",
         )
 
+    def test_int_reference_to_bytes_view(self):
+        self.add_memory_segment(b"\xe0Y\xd1H\x00", virt_addr=0xFFFF0000)
+        self.assertEqual(
+            Object(self.prog, "int", address=0xFFFF0000, bit_offset=2).to_bytes_view_(),
+            b"\x78\x56\x34\x12",
+        )
+
     def test_int_reference_bit_offset_to_bytes(self):
         self.add_memory_segment(b"\xe0Y\xd1H\x00", virt_addr=0xFFFF0000)
         self.assertEqual(
@@ -1587,6 +1664,198 @@ class TestGenericOperators(MockProgramTestCase):
         ).read_()
         self.assertRaisesRegex(OutOfBoundsError, "out of bounds", getattr, obj, "y")
 
+    def test_member_path(self):
+        path = self.prog.member_path(self.line_segment_type, "b.y")
+        self.assertIdentical(path.type, self.line_segment_type)
+        self.assertIdentical(path.member_type, self.prog.int_type("int", 4, True))
+        self.assertEqual(path.bit_offset, 96)
+        self.assertIsNone(path.bit_field_size)
+
+        reference = Object(self.prog, self.line_segment_type, address=0xFFFF0000)
+        ptr = Object(
+            self.prog, self.prog.pointer_type(self.line_segment_type), value=0xFFFF0000
+        )
+        for obj in (reference, ptr):
+            self.assertIdentical(
+                path(obj), Object(self.prog, "int", address=0xFFFF000C)
+            )
+
+        # The same type from a different compilation unit also matches.
+        other_type = self.prog.struct_type(
+            "line_segment", 16, self.line_segment_type.members
+        )
+        self.assertIdentical(
+            path(Object(self.prog, other_type, address=0xFFFF0000)),
+            Object(self.prog, "int", address=0xFFFF000C),
+        )
+
+        self.assertRaisesRegex(
+            TypeError,
+            "'struct point' is not the type of the member path",
+            path,
+            Object(self.prog, self.point_type, address=0xFFFF0000),
+        )
+        self.assertRaisesRegex(
+            TypeError,
+            "'struct line_segment' is not the type of the member path",
+            self.prog.member_path(self.point_type, "x"),
+            reference,
+        )
+        self.assertRaisesRegex(
+            LookupError,
+            "'struct point' has no member 'z'",
+            self.prog.member_path,
+            self.line_segment_type,
+            "a.z",
+        )
+
+    def test_member_path_array(self):
+        type_ = self.prog.struct_type(
+            "foo",
+            36,
+            (
+                TypeMember(self.prog.int_type("int", 4, True), "n"),
+                TypeMember(self.prog.array_type(self.point_type, 4), "points", 32),
+            ),
+        )
+        path = self.prog.member_path(type_, "points[2].y")
+        self.assertEqual(path.bit_offset, 32 + 2 * 64 + 32)
+        self.assertIdentical(
+            path(Object(self.prog, type_, address=0xFFFF0000)),
+            Object(self.prog, "int", address=0xFFFF0018),
+        )
+
+        path = self.prog.member_path(type_, "points[1]")
+        self.assertIdentical(path.member_type, self.point_type)
+        self.assertIdentical(
+            path(Object(self.prog, self.prog.pointer_type(type_), value=0xFFFF0000)),
+            Object(self.prog, self.point_type, address=0xFFFF000C),
+        )
+
+    def test_member_path_bit_field(self):
+        self.add_memory_segment(b"\x07\x10\x5e\x5f\x1f\0\0\0", virt_addr=0xFFFF8000)
+        type_ = self.prog.struct_type(
+            "bits",
+            8,
+            (
+                TypeMember(
+                    Object(
+                        self.prog, self.prog.int_type("int", 4, True), bit_field_size=4
+                    ),
+                    "x",
+                    0,
+                ),
+                TypeMember(
+                    Object(
+                        self.prog, self.prog.int_type("int", 4, True), bit_field_size=28
+                    ),
+                    "y",
+                    4,
+                ),
+            ),
+        )
+        path = self.prog.member_path(type_, "y")
+        self.assertEqual(path.bit_offset, 4)
+        self.assertEqual(path.bit_field_size, 28)
+        obj = Object(self.prog, type_, address=0xFFFF8000)
+        self.assertIdentical(path(obj), obj.y)
+        self.assertIdentical(path(obj.read_()), obj.y.read_())
+
+    def test_read_members(self):
+        self.add_memory_segment(
+            struct.pack("<8i", 0, 1, -2, 3, 4, -5, 6, 7), virt_addr=0xFFFF0000
+        )
+        for addresses in (
+            range(0xFFFF0000, 0xFFFF0020, 8),
+            [0xFFFF0000, 0xFFFF0008, 0xFFFF0010, 0xFFFF0018],
+        ):
+            with self.subTest(addresses=addresses):
+                x, y = self.prog.read_members(
+                    self.point_type,
+                    ["x", self.prog.member_path(self.point_type, "y")],
+                    addresses,
+                )
+                self.assertEqual(x.format, "q")
+                self.assertEqual(x.tolist(), [0, -2, 4, 6])
+                self.assertEqual(y.tolist(), [1, 3, -5, 7])
+
+        (y,) = self.prog.read_members(
+            self.point_type, ["y"], range(0xFFFF0018, 0xFFFEFFFF, -8)
+        )
+        self.assertEqual(y.tolist(), [7, -5, 3, 1])
+
+        self.assertEqual(
+            self.prog.read_members(self.point_type, ["x", "y"], []),
+            (memoryview(b"").cast("q"), memoryview(b"").cast("q")),
+        )
+
+    def test_read_members_types(self):
+        self.add_memory_segment(
+            struct.pack("<IfQ", 0x5F5E1007, 1.5, 0xFFFF0000), virt_addr=0xFFFF0000
+        )
+        type_ = self.prog.struct_type(
+            "foo",
+            16,
+            (
+                TypeMember(
+                    Object(
+                        self.prog,
+                        self.prog.int_type("unsigned int", 4, False),
+                        bit_field_size=4,
+                    ),
+                    "x",
+                    0,
+                ),
+                TypeMember(
+                    Object(
+                        self.prog, self.prog.int_type("int", 4, True), bit_field_size=28
+                    ),
+                    "y",
+                    4,
+                ),
+                TypeMember(self.prog.float_type("float", 4), "f", 32),
+                TypeMember(self.prog.pointer_type(self.point_type), "p", 64),
+            ),
+        )
+        x, y, f, p = self.prog.read_members(type_, ["x", "y", "f", "p"], [0xFFFF0000])
+        self.assertEqual(x.format, "Q")
+        self.assertEqual(x.tolist(), [7])
+        self.assertEqual(y.format, "q")
+        self.assertEqual(y.tolist(), [0x5F5E100])
+        self.assertEqual(f.format, "d")
+        self.assertEqual(f.tolist(), [1.5])
+        self.assertEqual(p.format, "Q")
+        self.assertEqual(p.tolist(), [0xFFFF0000])
+
+    def test_read_members_errors(self):
+        self.add_memory_segment(b"\0" * 16, virt_addr=0xFFFF0000)
+        self.assertRaisesRegex(
+            TypeError,
+            "cannot read 'struct point' into an array",
+            self.prog.read_members,
+            self.line_segment_type,
+            ["a"],
+            [0xFFFF0000],
+        )
+        self.assertRaisesRegex(
+            LookupError,
+            "has no member 'z'",
+            self.prog.read_members,
+            self.point_type,
+            ["z"],
+            [0xFFFF0000],
+        )
+        self.assertRaises(
+            TypeError, self.prog.read_members, self.point_type, [1], [0xFFFF0000]
+        )
+        self.assertRaises(
+            FaultError,
+            self.prog.read_members,
+            self.point_type,
+            ["x"],
+            range(0xFFFF0000, 0xFFFF0020, 8),
+        )
+
     def test_string(self):
         self.add_memory_segment(
             b"\x00\x00\xff\xff\x00\x00\x00\x00", virt_addr=0xFFFEFFF8
@@ -1,11 +1,18 @@
 # Copyright (c) Meta Platforms, Inc. and affiliates.
 # SPDX-License-Identifier: GPL-3.0-or-later
+import array
+import concurrent.futures
 import ctypes
 import itertools
 import os
+import struct
+import subprocess
 import tempfile
+import time
 import unittest.mock
 
+from _drgn import _linux_helper_pgtable_mappings, _linux_helper_read_vm
+import drgn
 from drgn import (
     Architecture,
     FaultError,
@@ -29,6 +36,7 @@ from tests import (
     MockObject,
     MockProgramTestCase,
     TestCase,
+    add_mock_memory_segments,
     mock_program,
 )
 from tests.elf import ET, PT
@@ -127,6 +135,11 @@ class TestProgram(TestCase):
     def test_debug_info(self):
         Program().load_debug_info([])
 
+    def test_unload_debug_info_not_loaded(self):
+        self.assertRaisesRegex(
+            LookupError, "is not loaded", Program().unload_debug_info, "foo"
+        )
+
     def test_language(self):
         prog = Program()
         self.assertEqual(prog.language, DEFAULT_LANGUAGE)
@@ -138,6 +151,38 @@ class TestProgram(TestCase):
             TypeError, "language must be Language", setattr, prog, "language", "CPP"
         )
 
+    def test_num_threads(self):
+        prog = Program()
+        self.assertEqual(prog.num_threads, 0)
+        prog.num_threads = 2
+        self.assertEqual(prog.num_threads, 2)
+        prog.num_threads = 0
+        self.assertEqual(prog.num_threads, 0)
+        self.assertRaises(ValueError, setattr, prog, "num_threads", -1)
+        self.assertRaises(OverflowError, setattr, prog, "num_threads", 2**40)
+        self.assertRaises(TypeError, setattr, prog, "num_threads", "2")
+        # The program still works with a single thread.
+        prog.num_threads = 1
+        prog.load_debug_info([])
+
+    def test_thread_cpus(self):
+        prog = Program()
+        self.assertIsNone(prog.thread_cpus)
+        prog.thread_cpus = [3, 1, 3, 0]
+        self.assertEqual(prog.thread_cpus, (0, 1, 3))
+        prog.thread_cpus = range(2)
+        self.assertEqual(prog.thread_cpus, (0, 1))
+        self.assertRaisesRegex(
+            ValueError, "invalid CPU -1", setattr, prog, "thread_cpus", [0, -1]
+        )
+        self.assertRaises(ValueError, setattr, prog, "thread_cpus", [1 << 20])
+        self.assertEqual(prog.thread_cpus, (0, 1))
+        prog.thread_cpus = []
+        self.assertIsNone(prog.thread_cpus)
+        prog.thread_cpus = [0]
+        prog.thread_cpus = None
+        self.assertIsNone(prog.thread_cpus)
+
 
 class TestMemory(TestCase):
     def test_simple_read(self):
@@ -182,6 +227,172 @@ class TestMemory(TestCase):
             FaultError, "could not find memory segment", prog.read, 0xFFFF0000, 4, True
         )
 
+    def test_try_read(self):
+        data = b"\x01\x02\x03\x04\x05\x06\x07\x08"
+        prog = mock_program(segments=[MockMemorySegment(data, 0xFFFF0000)])
+        self.assertEqual(prog.try_read(0xFFFF0000, len(data)), data)
+        self.assertIsNone(prog.try_read(0xDEADBEEF, 4))
+        self.assertIsNone(prog.try_read(0xFFFF0004, 8))
+        self.assertIsNone(prog.try_read(0xFFFF0000, 4, True))
+        self.assertRaises(ValueError, prog.try_read, 0xFFFF0000, -1)
+        # A suppressed fault doesn't affect later reads.
+        self.assertRaisesRegex(
+            FaultError, "could not find memory segment", prog.read, 0xDEADBEEF, 4
+        )
+
+    def test_read_word_or(self):
+        data = b"\x01\x02\x03\x04\x05\x06\x07\x08"
+        prog = mock_program(segments=[MockMemorySegment(data, 0xFFFF0000)])
+        self.assertEqual(prog.read_word_or(0xFFFF0000, None), 0x0807060504030201)
+        self.assertIsNone(prog.read_word_or(0xDEADBEEF, None))
+        sentinel = object()
+        self.assertIs(prog.read_word_or(0xFFFF0004, sentinel), sentinel)
+
+    def test_stats(self):
+        prog = Program(MOCK_PLATFORM)
+        stats = prog.stats()
+        self.assertTrue(all(value == 0 for value in stats.values()))
+        self.assertIn("dwarf_index_second_pass_ns", stats)
+
+        prog.memory_cache_size = 0
+        segment = unittest.mock.Mock(side_effect=zero_memory_read)
+        prog.add_memory_segment(0xFFFF0000, 8192, segment)
+        prog.read(0xFFFF0010, 8)
+        prog.read(0xFFFF0FF8, 16)
+        self.assertRaises(FaultError, prog.read, 0xFFFF2000, 4)
+        stats = prog.stats()
+        self.assertEqual(stats["memory_reads"], 3)
+        self.assertEqual(stats["memory_read_bytes"], 28)
+        self.assertEqual(stats["custom_segment_reads"], 2)
+        self.assertEqual(stats["custom_segment_read_bytes"], 24)
+        self.assertEqual(stats["file_segment_reads"], 0)
+
+        prog.memory_cache_size = 1024 * 1024
+        prog.read(0xFFFF0010, 8)
+        prog.read(0xFFFF0020, 8)
+        stats = prog.stats()
+        self.assertEqual(stats["custom_segment_reads"], 3)
+        self.assertEqual(stats["custom_segment_read_bytes"], 24 + 4096)
+        self.assertEqual(
+            (stats["memory_cache_hits"], stats["memory_cache_misses"]),
+            prog.memory_cache_stats(),
+        )
+        self.assertEqual(prog.memory_cache_stats(), (1, 1))
+
+        prog.reset_stats()
+        self.assertTrue(all(value == 0 for value in prog.stats().values()))
+        self.assertEqual(prog.memory_cache_stats(), (0, 0))
+
+    def test_search_memory(self):
+        data = bytearray(0x3000)
+        data[0x10:0x18] = (0xFFFF888012345678).to_bytes(8, "little")
+        data[0x2FF8:0x3000] = (0xFFFF888012345678).to_bytes(8, "little")
+        data[0x1001:0x1005] = b"drgn"
+        data[0x1104:0x1108] = (0x1234).to_bytes(4, "little")
+        prog = Program(MOCK_PLATFORM)
+        add_mock_memory_segments(
+            prog,
+            [
+                MockMemorySegment(data[:0x2000], virt_addr=0xFFFF0000),
+                MockMemorySegment(data[0x2000:], virt_addr=0xFFFF2000),
+            ],
+        )
+
+        self.assertEqual(
+            prog.search_memory(0xFFFF888012345678), [0xFFFF0010, 0xFFFF2FF8]
+        )
+        self.assertEqual(
+            prog.search_memory(0xFFFF888012345678, 0xFFFF0011), [0xFFFF2FF8]
+        )
+        self.assertEqual(
+            prog.search_memory(0xFFFF888012345678, max_address=0xFFFF2FFE),
+            [0xFFFF0010],
+        )
+        self.assertEqual(
+            prog.search_memory(0xFFFF888012345678, alignment=16), [0xFFFF0010]
+        )
+        self.assertEqual(
+            prog.search_memory(0x1000, max_value=0x2000, size=4), [0xFFFF1104]
+        )
+        self.assertEqual(prog.search_memory(b"drgn"), [0xFFFF1001])
+        self.assertEqual(prog.search_memory(b"drgn", alignment=2), [])
+        self.assertEqual(prog.search_memory(b"drgn", physical=True), [])
+        self.assertRaises(ValueError, prog.search_memory, 0, size=3)
+        self.assertRaises(ValueError, prog.search_memory, 2, max_value=1)
+        self.assertRaises(ValueError, prog.search_memory, b"")
+        self.assertRaises(ValueError, prog.search_memory, b"drgn", size=1)
+
+    def test_memory_trace(self):
+        data = bytes(range(256)) * 64
+        prog = Program(MOCK_PLATFORM)
+        prog.add_memory_segment(
+            0xFFFF0000,
+            len(data),
+            lambda address, count, offset, physical: data[offset : offset + count],
+        )
+        self.assertIsNone(prog.stop_memory_trace())
+        self.assertRaises(ValueError, prog.write_memory_trace_core, "/dev/null")
+
+        prog.start_memory_trace()
+        prog.read(0xFFFF0010, 8)
+        prog.read(0xFFFF2FF8, 16)
+        self.assertRaises(FaultError, prog.read, 0xFFFF8000, 4)
+        self.assertEqual(prog.stop_memory_trace(), 4)
+        # Reads after stopping aren't recorded.
+        prog.read(0xFFFF1000, 8)
+
+        with tempfile.NamedTemporaryFile() as f:
+            prog.write_memory_trace_core(f.name)
+            replay = Program()
+            replay.set_core_dump(f.name)
+        self.assertEqual(replay.platform.arch, prog.platform.arch)
+        self.assertEqual(replay.read(0xFFFF0000, 4096), data[:4096])
+        self.assertEqual(replay.read(0xFFFF2FF8, 16), data[0x2FF8:0x3008])
+        self.assertRaises(FaultError, replay.read, 0xFFFF1000, 8)
+        self.assertRaises(FaultError, replay.read, 0xFFFF8000, 4)
+
+    def test_memory_trace_objects(self):
+        prog = Program(MOCK_PLATFORM)
+        node_type = prog.struct_type(
+            "node",
+            24,
+            (
+                TypeMember(lambda: prog.pointer_type(node_type), "next"),
+                TypeMember(lambda: prog.pointer_type(node_type), "prev", 64),
+                TypeMember(prog.int_type("long", 8, True), "value", 128),
+            ),
+        )
+        data = bytearray(0x5000)
+        data[0x0000:0x0018] = struct.pack("<QQq", 0x12000, 0x14000, 1)
+        data[0x2000:0x2018] = struct.pack("<QQq", 0x14000, 0, 2)
+        data[0x4000:0x4018] = struct.pack("<QQq", 0, 0x10000, 3)
+        add_mock_memory_segments(prog, [MockMemorySegment(data, virt_addr=0x10000)])
+
+        self.assertRaises(
+            ValueError,
+            prog.add_memory_trace_objects,
+            [Object(prog, prog.int_type("int", 4, True), 1)],
+        )
+        prog.add_memory_trace_objects(
+            [Object(prog, node_type, address=0x10000)], follow=["next"], depth=1
+        )
+        self.assertEqual(prog.stop_memory_trace(), 2)
+        # A pointer value records what it points to.
+        prog.add_memory_trace_objects(
+            [Object(prog, prog.pointer_type(node_type), 0x14000)]
+        )
+        self.assertEqual(prog.stop_memory_trace(), 3)
+
+        with tempfile.NamedTemporaryFile() as f:
+            prog.write_memory_trace_core(f.name)
+            replay = Program()
+            replay.set_core_dump(f.name)
+        for address in (0x10000, 0x12000, 0x14000):
+            self.assertEqual(
+                replay.read(address, 24), data[address - 0x10000 :][:24]
+            )
+        self.assertRaises(FaultError, replay.read, 0x11000, 8)
+
     def test_segment_overflow(self):
         data = b"hello, world!"
         prog = mock_program(segments=[MockMemorySegment(data, 0xFFFF0000)])
@@ -345,6 +556,228 @@ class TestMemory(TestCase):
         segment1.assert_not_called()
         segment2.assert_called_once_with(0xFFFF0000, 128, 0, False)
 
+    def test_read_batch(self):
+        data = bytes(range(256)) * 16
+        segment = unittest.mock.Mock(
+            side_effect=lambda address, count, offset, physical: data[
+                offset : offset + count
+            ]
+        )
+        prog = Program(MOCK_PLATFORM)
+        prog.add_memory_segment(0xFFFF0000, len(data), segment)
+        self.assertEqual(prog.read_batch([]), [])
+        self.assertEqual(
+            prog.read_batch([(0xFFFF0100, 4), (0xFFFF0000, 8), (0xFFFF0102, 0)]),
+            [data[0x100:0x104], data[:8], b""],
+        )
+        # The reads were combined.
+        segment.assert_called_once_with(0xFFFF0000, 0x104, 0, False)
+
+    def test_read_batch_fault(self):
+        prog = Program(MOCK_PLATFORM)
+        prog.add_memory_segment(0xFFFF0000, 16, zero_memory_read)
+        result = prog.read_batch([(0xFFFF0000, 8), (0xFFFF000C, 8), (0x0, 1)])
+        self.assertEqual(result[0], bytes(8))
+        self.assertIsInstance(result[1], FaultError)
+        self.assertEqual(result[1].address, 0xFFFF0010)
+        self.assertIsInstance(result[2], FaultError)
+        self.assertEqual(result[2].address, 0x0)
+
+    def test_read_batch_invalid(self):
+        prog = Program(MOCK_PLATFORM)
+        self.assertRaises(ValueError, prog.read_batch, [(0xFFFF0000, -1)])
+        self.assertRaisesRegex(
+            TypeError,
+            r"expected \(address, size\) tuple",
+            prog.read_batch,
+            [0xFFFF0000],
+        )
+        self.assertRaises(TypeError, prog.read_batch, None)
+
+    def test_cache_disabled_by_default(self):
+        self.assertEqual(Program(MOCK_PLATFORM).memory_cache_size, 0)
+
+    def test_cache(self):
+        prog = Program(MOCK_PLATFORM)
+        prog.memory_cache_size = 1024 * 1024
+        self.assertEqual(prog.memory_cache_size, 1024 * 1024)
+        segment = unittest.mock.Mock(side_effect=zero_memory_read)
+        prog.add_memory_segment(0xFFFF0000, 8192, segment)
+        self.assertEqual(prog.read(0xFFFF0010, 8), bytes(8))
+        self.assertEqual(prog.read(0xFFFF0100, 16), bytes(16))
+        segment.assert_called_once_with(0xFFFF0000, 4096, 0, False)
+
+        segment.reset_mock()
+        prog.read(0xFFFF0FF8, 16)
+        segment.assert_called_once_with(0xFFFF1000, 4096, 4096, False)
+
+        segment.reset_mock()
+        prog.invalidate_memory_cache()
+        prog.read(0xFFFF0010, 8)
+        segment.assert_called_once_with(0xFFFF0000, 4096, 0, False)
+
+    def test_cache_batch(self):
+        prog = Program(MOCK_PLATFORM)
+        prog.memory_cache_size = 1024 * 1024
+        segment = unittest.mock.Mock(side_effect=zero_memory_read)
+        prog.add_memory_segment(0xFFFF0000, 4 * 4096, segment)
+        prog.read(0xFFFF1000, 8)
+        self.assertEqual(prog.memory_cache_stats(), (0, 1))
+
+        # The uncached blocks on either side of the cached one are each read
+        # with one call.
+        segment.reset_mock()
+        self.assertEqual(prog.read(0xFFFF0000, 4 * 4096), bytes(4 * 4096))
+        segment.assert_has_calls(
+            [
+                unittest.mock.call(0xFFFF0000, 4096, 0, False),
+                unittest.mock.call(0xFFFF2000, 8192, 8192, False),
+            ]
+        )
+        self.assertEqual(segment.call_count, 2)
+        self.assertEqual(prog.memory_cache_stats(), (1, 4))
+
+        prog.read(0xFFFF2000, 8)
+        self.assertEqual(prog.memory_cache_stats(), (2, 4))
+
+    def test_translation_cache(self):
+        prog = Program(MOCK_PLATFORM)
+        self.assertFalse(prog.translation_cache_enabled)
+        prog.translation_cache_enabled = True
+        self.assertTrue(prog.translation_cache_enabled)
+        self.assertEqual(prog.translation_cache_stats(), (0, 0))
+        prog.invalidate_translation_cache()
+
+    def test_cache_size_rounded(self):
+        prog = Program(MOCK_PLATFORM)
+        prog.memory_cache_size = 4097
+        self.assertEqual(prog.memory_cache_size, 4096)
+        prog.memory_cache_size = 4095
+        self.assertEqual(prog.memory_cache_size, 0)
+        self.assertRaises(OverflowError, setattr, prog, "memory_cache_size", -1)
+
+    def test_cache_eviction(self):
+        prog = Program(MOCK_PLATFORM)
+        prog.memory_cache_size = 4096
+        segment = unittest.mock.Mock(side_effect=zero_memory_read)
+        prog.add_memory_segment(0xFFFF0000, 8192, segment)
+        prog.read(0xFFFF0000, 8)
+        prog.read(0xFFFF1000, 8)
+        prog.read(0xFFFF0000, 8)
+        self.assertEqual(segment.call_count, 3)
+
+    def test_cache_partial_block(self):
+        # Blocks that aren't entirely within a segment aren't cached.
+        prog = Program(MOCK_PLATFORM)
+        prog.memory_cache_size = 1024 * 1024
+        segment = unittest.mock.Mock(side_effect=zero_memory_read)
+        prog.add_memory_segment(0xFFFF0000, 64, segment)
+        prog.read(0xFFFF0000, 8)
+        prog.read(0xFFFF0000, 8)
+        segment.assert_has_calls(
+            [
+                unittest.mock.call(0xFFFF0000, 8, 0, False),
+                unittest.mock.call(0xFFFF0000, 8, 0, False),
+            ]
+        )
+        self.assertRaises(FaultError, prog.read, 0xFFFF0000, 65)
+
+    def test_cache_add_segment(self):
+        prog = Program(MOCK_PLATFORM)
+        prog.memory_cache_size = 1024 * 1024
+        prog.add_memory_segment(
+            0xFFFF0000, 4096, lambda address, count, offset, physical: b"a" * count
+        )
+        self.assertEqual(prog.read(0xFFFF0000, 1), b"a")
+        prog.add_memory_segment(
+            0xFFFF0000, 4096, lambda address, count, offset, physical: b"b" * count
+        )
+        self.assertEqual(prog.read(0xFFFF0000, 1), b"b")
+
+    def test_block_segment(self):
+        data = bytes(range(256)) * 128
+        calls = []
+
+        def read_blocks(ranges, physical):
+            calls.append(
+                [(address, offset, len(buf)) for address, offset, buf in ranges]
+            )
+            for address, offset, buf in ranges:
+                buf[:] = data[offset : offset + len(buf)]
+
+        prog = Program(MOCK_PLATFORM)
+        prog.add_memory_block_segment(0xFFFF0000, len(data), read_blocks)
+        self.assertEqual(prog.memory_cache_size, 32 * 1024 * 1024)
+
+        self.assertEqual(prog.read(0xFFFF1010, 8), data[0x1010:0x1018])
+        self.assertEqual(prog.read(0xFFFF3FF8, 16), data[0x3FF8:0x4008])
+        self.assertEqual(
+            calls,
+            [[(0xFFFF1000, 0x1000, 4096)], [(0xFFFF3000, 0x3000, 8192)]],
+        )
+
+        # The uncached blocks of one read are read with one call, and the
+        # cached blocks are skipped.
+        calls.clear()
+        self.assertEqual(prog.read(0xFFFF0000, len(data)), data)
+        self.assertEqual(
+            calls,
+            [
+                [
+                    (0xFFFF0000, 0, 4096),
+                    (0xFFFF2000, 0x2000, 4096),
+                    (0xFFFF5000, 0x5000, 3 * 4096),
+                ]
+            ],
+        )
+        self.assertEqual(prog.memory_cache_stats(), (3, 8))
+        stats = prog.stats()
+        self.assertEqual(stats["custom_segment_reads"], 3)
+        self.assertEqual(stats["custom_segment_read_bytes"], 8 * 4096)
+
+        calls.clear()
+        self.assertEqual(prog.read(0xFFFF4321, 100), data[0x4321:0x4385])
+        self.assertEqual(calls, [])
+
+    def test_block_segment_uncached(self):
+        prog = Program(MOCK_PLATFORM)
+        read_blocks = unittest.mock.Mock()
+        prog.add_memory_block_segment(0xFFFF0000, 8192, read_blocks)
+        prog.memory_cache_size = 0
+        prog.read(0xFFFF0FFC, 8)
+        # The read is rounded out to whole blocks.
+        read_blocks.assert_called_once()
+        ((ranges, physical), _) = read_blocks.call_args
+        self.assertEqual(
+            [(address, offset) for address, offset, _ in ranges], [(0xFFFF0000, 0)]
+        )
+        self.assertFalse(physical)
+        # The views are released after the call.
+        self.assertRaises(ValueError, len, ranges[0][2])
+        self.assertEqual(prog.stats()["custom_segment_read_bytes"], 8192)
+
+    def test_block_segment_invalid(self):
+        prog = Program(MOCK_PLATFORM)
+        self.assertRaises(
+            ValueError, prog.add_memory_block_segment, 0xFFFF0010, 4096, lambda: None
+        )
+        self.assertRaises(
+            ValueError, prog.add_memory_block_segment, 0xFFFF0000, 100, lambda: None
+        )
+
+        calls = []
+
+        def read_blocks(ranges, physical):
+            calls.append(ranges)
+            raise OSError("remote read failed")
+
+        prog.add_memory_block_segment(0xFFFF0000, 4096, read_blocks)
+        self.assertRaisesRegex(
+            OSError, "remote read failed", prog.read, 0xFFFF0000, 8
+        )
+        # The error is returned rather than retried.
+        self.assertEqual(len(calls), 1)
+
     def test_invalid_read_fn(self):
         prog = mock_program()
 
@@ -407,6 +840,62 @@ class TestTypes(MockProgramTestCase):
         self.prog.add_type_finder(lambda kind, name, filename: None)
         self.assertRaises(LookupError, self.prog.type, "struct foo")
 
+    def test_uncached_finder(self):
+        calls = []
+        int_type = self.prog.int_type("int", 4, True)
+        point_type = self.prog.struct_type(
+            "point", 8, (TypeMember(int_type, "x", 0), TypeMember(int_type, "y", 32))
+        )
+        found = set()
+
+        def finder(kind, name, filename):
+            calls.append((kind, name, filename))
+            if kind == TypeKind.STRUCT and name in found:
+                return point_type
+            return None
+
+        # Lookups that call a finder registered without cache=True aren't
+        # cached, including lookups that it didn't find.
+        self.prog.add_type_finder(finder)
+        self.assertRaises(LookupError, self.prog.type, "struct point")
+        found.add("point")
+        self.assertIdentical(self.prog.type("struct point"), point_type)
+        self.assertIdentical(self.prog.type("struct point"), point_type)
+        self.assertEqual(calls, [(TypeKind.STRUCT, "point", None)] * 3)
+
+    def test_cached_finder(self):
+        calls = []
+        int_type = self.prog.int_type("int", 4, True)
+        point_type = self.prog.struct_type(
+            "point", 8, (TypeMember(int_type, "x", 0), TypeMember(int_type, "y", 32))
+        )
+
+        def finder(kind, name, filename):
+            calls.append((kind, name, filename))
+            if kind == TypeKind.STRUCT and name == "point":
+                return point_type
+            return None
+
+        self.prog.add_type_finder(finder, cache=True)
+        for _ in range(2):
+            self.assertIdentical(self.prog.type("struct point"), point_type)
+            self.assertRaises(LookupError, self.prog.type, "struct line")
+            # Adding a finder discards the results of type(), but not the
+            # results of the cached finder.
+            self.prog.add_type_finder(lambda kind, name, filename: None)
+        self.assertIdentical(self.prog.type("struct point", "foo.c"), point_type)
+        self.assertEqual(
+            calls,
+            [
+                (TypeKind.STRUCT, "point", None),
+                (TypeKind.STRUCT, "line", None),
+                (TypeKind.STRUCT, "point", "foo.c"),
+            ],
+        )
+
+        # cache is keyword-only.
+        self.assertRaises(TypeError, self.prog.add_type_finder, finder, True)
+
     def test_already_type(self):
         self.assertIdentical(
             self.prog.type(self.prog.pointer_type(self.prog.void_type())),
@@ -741,6 +1230,68 @@ class TestObjects(MockProgramTestCase):
         self.assertRaises(LookupError, self.prog.object, "foo")
         self.assertFalse("foo" in self.prog)
 
+    def test_uncached_finder_not_found(self):
+        calls = []
+        found = set()
+
+        def finder(prog, name, flags, filename):
+            calls.append((name, flags, filename))
+            return Object(prog, "int", 1) if name in found else None
+
+        # Lookups that no finder found aren't remembered if a finder was
+        # registered without cache=True.
+        self.prog.add_object_finder(finder)
+        self.assertRaises(LookupError, self.prog.object, "foo")
+        self.assertRaises(LookupError, self.prog.object, "foo")
+        found.add("foo")
+        self.assertIdentical(self.prog["foo"], Object(self.prog, "int", 1))
+        self.assertEqual(calls, [("foo", FindObjectFlags.ANY, None)] * 3)
+
+    def test_not_found_cache(self):
+        calls = []
+
+        def finder(prog, name, flags, filename):
+            calls.append((name, flags, filename))
+            return None
+
+        self.prog.add_object_finder(finder, cache=True)
+        for _ in range(2):
+            self.assertRaises(LookupError, self.prog.object, "foo")
+            self.assertRaises(LookupError, self.prog.object, "foo", filename="foo.c")
+            self.assertRaises(LookupError, self.prog.constant, "foo")
+        self.assertEqual(
+            calls,
+            [
+                ("foo", FindObjectFlags.ANY, None),
+                ("foo", FindObjectFlags.ANY, "foo.c"),
+                ("foo", FindObjectFlags.CONSTANT, None),
+            ],
+        )
+
+    def test_cached_finder(self):
+        calls = []
+
+        def finder(prog, name, flags, filename):
+            calls.append((name, flags, filename))
+            return Object(prog, "int", 1) if name == "foo" else None
+
+        self.prog.add_object_finder(finder, cache=True)
+        for _ in range(2):
+            self.assertIdentical(self.prog["foo"], Object(self.prog, "int", 1))
+            self.assertRaises(LookupError, self.prog.object, "bar")
+            # Adding a finder invalidates the cache of lookups that didn't find
+            # anything, but not the results of the cached finder.
+            self.prog.add_object_finder(lambda prog, name, flags, filename: None)
+        self.assertRaises(LookupError, self.prog.constant, "bar")
+        self.assertEqual(
+            calls,
+            [
+                ("foo", FindObjectFlags.ANY, None),
+                ("bar", FindObjectFlags.ANY, None),
+                ("bar", FindObjectFlags.CONSTANT, None),
+            ],
+        )
+
     def test_constant(self):
         self.objects.append(
             MockObject("PAGE_SIZE", self.prog.int_type("int", 4, True), value=4096)
@@ -832,6 +1383,113 @@ class TestCoreDump(TestCase):
         self.assertEqual(prog.read(0xFFFF0000, len(data)), data)
         self.assertRaises(FaultError, prog.read, 0x0, len(data), physical=True)
 
+    def test_cache(self):
+        data = bytes(range(256)) * 32
+        prog = Program()
+        with tempfile.NamedTemporaryFile() as f:
+            f.write(
+                create_elf_file(
+                    ET.CORE, [ElfSection(p_type=PT.LOAD, vaddr=0xFFFF0000, data=data)]
+                )
+            )
+            f.flush()
+            prog.set_core_dump(f.name)
+        self.assertGreater(prog.memory_cache_size, 0)
+        self.assertTrue(prog.translation_cache_enabled)
+        for address in (0xFFFF0000, 0xFFFF0FFC, 0xFFFF1FFC):
+            self.assertEqual(
+                prog.read(address, 4), data[address - 0xFFFF0000 :][:4]
+            )
+        self.assertEqual(prog.read(0xFFFF0000, len(data)), data)
+
+    def test_no_mmap(self):
+        data = b"hello, world"
+        prog = Program()
+        with tempfile.NamedTemporaryFile() as f:
+            f.write(
+                create_elf_file(
+                    ET.CORE, [ElfSection(p_type=PT.LOAD, vaddr=0xFFFF0000, data=data)]
+                )
+            )
+            f.flush()
+            with unittest.mock.patch.dict(
+                os.environ, {"DRGN_USE_MMAP_FOR_CORE_DUMP": "0"}
+            ):
+                prog.set_core_dump(f.name)
+        self.assertEqual(prog.read(0xFFFF0000, len(data)), data)
+
+    def test_read_view(self):
+        data = bytes(range(256)) * 32
+        for use_mmap in ("1", "0"):
+            with self.subTest(use_mmap=use_mmap):
+                prog = Program()
+                with tempfile.NamedTemporaryFile() as f:
+                    f.write(
+                        create_elf_file(
+                            ET.CORE,
+                            [ElfSection(p_type=PT.LOAD, vaddr=0xFFFF0000, data=data)],
+                        )
+                    )
+                    f.flush()
+                    with unittest.mock.patch.dict(
+                        os.environ, {"DRGN_USE_MMAP_FOR_CORE_DUMP": use_mmap}
+                    ):
+                        prog.set_core_dump(f.name)
+                view = prog.read_view(0xFFFF0100, 4096)
+                obj_view = Object(
+                    prog,
+                    prog.array_type(prog.int_type("char", 1, True), 16),
+                    address=0xFFFF0000,
+                ).to_bytes_view_()
+                # The views must remain valid without the Program.
+                del prog
+                self.assertTrue(view.readonly)
+                self.assertEqual(view, data[0x100:0x1100])
+                self.assertEqual(obj_view, data[:16])
+
+    def test_prefetch(self):
+        data = bytes(range(256)) * 32
+        prog = Program()
+        with tempfile.NamedTemporaryFile() as f:
+            f.write(
+                create_elf_file(
+                    ET.CORE, [ElfSection(p_type=PT.LOAD, vaddr=0xFFFF0000, data=data)]
+                )
+            )
+            f.flush()
+            with unittest.mock.patch.dict(
+                os.environ, {"DRGN_USE_MMAP_FOR_CORE_DUMP": "0"}
+            ):
+                prog.set_core_dump(f.name)
+        prog.prefetch(0xFFFF0000, len(data))
+        # The blocks are read in the background.
+        deadline = time.monotonic() + 10
+        while prog.memory_cache_stats()[1] < 2 and time.monotonic() < deadline:
+            time.sleep(0.01)
+        self.assertEqual(prog.memory_cache_stats(), (0, 2))
+        self.assertEqual(prog.read(0xFFFF0000, len(data)), data)
+        self.assertEqual(prog.memory_cache_stats(), (2, 2))
+
+    def test_truncated(self):
+        data = b"hello, world"
+        prog = Program()
+        with tempfile.NamedTemporaryFile() as f:
+            f.write(
+                create_elf_file(
+                    ET.CORE, [ElfSection(p_type=PT.LOAD, vaddr=0xFFFF0000, data=data)]
+                )[:-4]
+            )
+            f.flush()
+            prog.set_core_dump(f.name)
+            self.assertEqual(prog.read(0xFFFF0000, len(data) - 4), data[:-4])
+            self.assertRaisesRegex(
+                FaultError,
+                "short read from memory file",
+                prog.read,
+                0xFFFF0000,
+                len(data),
+            )
+
     def test_physical(self):
         data = b"hello, world"
         prog = Program()
@@ -873,3 +1531,342 @@ class TestCoreDump(TestCase):
         with self.assertRaisesRegex(FaultError, "memory not saved in core dump") as cm:
             prog.read(0xFFFF0000, len(data) + 4)
         self.assertEqual(cm.exception.address, 0xFFFF000C)
+
+    def test_add_memory_segment(self):
+        data = b"hello, world"
+        prog = Program()
+        with tempfile.NamedTemporaryFile() as f:
+            f.write(
+                create_elf_file(
+                    ET.CORE,
+                    [
+                        ElfSection(p_type=PT.LOAD, vaddr=0xFFFF0000, data=data),
+                        ElfSection(p_type=PT.LOAD, vaddr=0xFFFF1000, data=data),
+                    ],
+                )
+            )
+            f.flush()
+            prog.set_core_dump(f.name)
+        self.assertEqual(prog.read(0xFFFF1000, len(data)), data)
+        # Segments can still be added after the core dump's segments are set
+        # up.
+        add_mock_memory_segments(prog, [MockMemorySegment(b"WORLD", 0xFFFF0007)])
+        self.assertEqual(prog.read(0xFFFF0000, len(data)), b"hello, WORLD")
+        self.assertEqual(prog.read(0xFFFF1000, len(data)), data)
+
+def compress_zstd(data):
+    try:
+        return subprocess.run(
+            ["zstd", "--quiet", "--stdout", "-"],
+            input=data,
+            stdout=subprocess.PIPE,
+            check=True,
+        ).stdout
+    except FileNotFoundError:
+        raise unittest.SkipTest("zstd not found")
+
+
+def compress_seekable_zstd(data, frame_size):
+    # Independent frames followed by a seek table in a skippable frame. See
+    # contrib/seekable_format/zstd_seekable_compression_format.md in zstd.
+    buf = bytearray()
+    seek_table = bytearray()
+    for i in range(0, len(data), frame_size):
+        chunk = data[i : i + frame_size]
+        frame = compress_zstd(chunk)
+        buf.extend(frame)
+        seek_table.extend(struct.pack("<II", len(frame), len(chunk)))
+    num_frames = len(seek_table) // 8
+    buf.extend(struct.pack("<II", 0x184D2A5E, len(seek_table) + 9))
+    buf.extend(seek_table)
+    buf.extend(struct.pack("<IBI", num_frames, 0, 0x8F92EAB1))
+    return buf
+
+
+def vmcoreinfo_note(vmcoreinfo):
+    return ElfSection(
+        p_type=PT.NOTE,
+        p_align=4,
+        data=struct.pack("<III", len(b"VMCOREINFO\0"), len(vmcoreinfo), 0)
+        + b"VMCOREINFO\0\0"
+        + vmcoreinfo
+        + bytes(-len(vmcoreinfo) % 4),
+    )
+
+
+@unittest.skipUnless(drgn._with_libzstd, "drgn was built without libzstd")
+class TestCompressedCoreDump(TestCase):
+    VMCOREINFO = (
+        b"OSRELEASE=6.0.0\n"
+        b"PAGESIZE=4096\n"
+        b"SYMBOL(swapper_pg_dir)=ffffffff82000000\n"
+    )
+    ADDRESS = 0xFFFF0000
+    # Every 4 bytes are different so that misplaced reads are caught.
+    DATA = b"".join(i.to_bytes(4, "little") for i in range(32 * 1024))
+
+    def vmcore(self, vmcoreinfo=VMCOREINFO):
+        sections = [ElfSection(p_type=PT.LOAD, vaddr=self.ADDRESS, data=self.DATA)]
+        if vmcoreinfo is not None:
+            sections.insert(0, vmcoreinfo_note(vmcoreinfo))
+        return create_elf_file(ET.CORE, sections)
+
+    def open(self, data):
+        f = tempfile.NamedTemporaryFile()
+        self.addCleanup(f.close)
+        f.write(data)
+        f.flush()
+        prog = Program()
+        prog.set_core_dump(f.name)
+        return prog
+
+    def test_read(self):
+        # With 256-byte frames, the ELF headers and notes span two frames.
+        for frame_size in (256, 4096, 32768):
+            with self.subTest(frame_size=frame_size):
+                prog = self.open(compress_seekable_zstd(self.vmcore(), frame_size))
+                self.assertTrue(prog.flags & ProgramFlags.IS_LINUX_KERNEL)
+                for offset, size in (
+                    (0, 16),
+                    (frame_size - 3, 6),
+                    (len(self.DATA) // 3, 2 * frame_size),
+                    (len(self.DATA) - 8, 8),
+                ):
+                    self.assertEqual(
+                        prog.read(self.ADDRESS + offset, size),
+                        self.DATA[offset : offset + size],
+                    )
+                self.assertEqual(prog.read(self.ADDRESS, len(self.DATA)), self.DATA)
+
+    def test_concurrent_reads(self):
+        prog = self.open(compress_seekable_zstd(self.vmcore(), 4096))
+
+        def read(i):
+            offset = (i * 4099) % (len(self.DATA) - 8192)
+            return prog.read(self.ADDRESS + offset, 8192) == self.DATA[
+                offset : offset + 8192
+            ]
+
+        with concurrent.futures.ThreadPoolExecutor(max_workers=8) as executor:
+            self.assertTrue(all(executor.map(read, range(256))))
+
+    def test_not_seekable(self):
+        self.assertRaisesRegex(
+            ValueError,
+            "not in the seekable format",
+            self.open,
+            compress_zstd(self.vmcore()),
+        )
+
+    def test_userspace_core_dump(self):
+        self.assertRaisesRegex(
+            ValueError,
+            "only supported for Linux kernel vmcores",
+            self.open,
+            compress_seekable_zstd(self.vmcore(vmcoreinfo=None), 4096),
+        )
+
+
+class TestAArch64PageTable(TestCase):
+    EM_AARCH64 = 183
+    # Page table descriptor bits.
+    VALID = 0x1
+    TABLE = 0x2
+    PAGE = 0x3
+    CONT = 1 << 52
+
+    # The page tables are mapped at a kernel address outside of the range
+    # that they map so that they can be read without translation.
+    TABLES_VIRT = 0xFFFFFFFFFFF00000
+    TABLES_PHYS = 0x1000
+    SWAPPER_PG_DIR = TABLES_VIRT
+    USER_PGD = TABLES_VIRT + 0x4000
+    KERNEL_BASE = 0xFFFF800000000000
+    # Physical memory referenced by pages.
+    DATA_PHYS = 0x10000
+    DATA = b"".join(i.to_bytes(4, "little") for i in range(0x20000 // 4))
+
+    def tables(self):
+        # 4K pages with 48-bit virtual addresses, so 4 levels of 512 entries.
+        pgd = [0] * 512
+        pud = [0] * 512
+        pmd = [0] * 512
+        pte = [0] * 512
+        user_pgd = [0] * 512
+
+        # The kernel and user page tables share the lower levels, so
+        # KERNEL_BASE + x and x map the same physical address.
+        pgd[256] = (self.TABLES_PHYS + 0x1000) | self.PAGE
+        user_pgd[0] = (self.TABLES_PHYS + 0x1000) | self.PAGE
+        pud[0] = (self.TABLES_PHYS + 0x2000) | self.PAGE
+        # 1G block.
+        pud[1] = 0x40000000 | self.VALID
+        pmd[0] = (self.TABLES_PHYS + 0x3000) | self.PAGE
+        # 2M block.
+        pmd[1] = 0x200000 | self.VALID
+        # 16 contiguous 2M blocks.
+        for i in range(16, 32):
+            pmd[i] = (0x2000000 + (i - 16) * 0x200000) | self.CONT | self.VALID
+        pte[0] = 0x10000 | self.PAGE
+        # pte[1] is not mapped.
+        pte[2] = 0x11000 | self.PAGE
+        # 16 contiguous 4K pages.
+        for i in range(16, 32):
+            pte[i] = (0x20000 + (i - 16) * 0x1000) | self.CONT | self.PAGE
+        return b"".join(
+            struct.pack("<512Q", *table) for table in (pgd, pud, pmd, pte, user_pgd)
+        )
+
+    # (virtual address relative to KERNEL_BASE or 0, physical address, size,
+    # flags) of each mapping.
+    MAPPINGS = (
+        (0x0, 0x10000, 0x1000, PAGE),
+        (0x2000, 0x11000, 0x1000, PAGE),
+        (0x10000, 0x20000, 0x10000, CONT | PAGE),
+        (0x200000, 0x200000, 0x200000, VALID),
+        (0x2000000, 0x2000000, 0x2000000, CONT | VALID),
+        (0x40000000, 0x40000000, 0x40000000, VALID),
+    )
+
+    def setUp(self):
+        super().setUp()
+        vmcoreinfo = (
+            b"OSRELEASE=6.0.0\n"
+            b"PAGESIZE=4096\n"
+            + f"SYMBOL(swapper_pg_dir)={self.SWAPPER_PG_DIR:x}\n".encode()
+            + b"NUMBER(VA_BITS)=48\n"
+        )
+        f = tempfile.NamedTemporaryFile()
+        self.addCleanup(f.close)
+        f.write(
+            create_elf_file(
+                ET.CORE,
+                [
+                    vmcoreinfo_note(vmcoreinfo),
+                    ElfSection(
+                        p_type=PT.LOAD,
+                        vaddr=self.TABLES_VIRT,
+                        paddr=self.TABLES_PHYS,
+                        data=self.tables(),
+                    ),
+                    # Physical memory only.
+                    ElfSection(
+                        p_type=PT.LOAD,
+                        vaddr=0xFFFFFFFFFFFFFFFF,
+                        paddr=self.DATA_PHYS,
+                        data=self.DATA,
+                    ),
+                ],
+                machine=self.EM_AARCH64,
+            )
+        )
+        f.flush()
+        self.prog = Program()
+        self.prog.set_core_dump(f.name)
+
+    def phys(self, address, size):
+        offset = address - self.DATA_PHYS
+        return self.DATA[offset : offset + size]
+
+    def read_vm(self, pgtable, address, size):
+        return _linux_helper_read_vm(self.prog, pgtable, address, size)
+
+    def test_platform(self):
+        self.assertEqual(self.prog.platform.arch, Architecture.AARCH64)
+        self.assertTrue(self.prog.flags & ProgramFlags.IS_LINUX_KERNEL)
+
+    def test_read_vm(self):
+        for base in (0, self.KERNEL_BASE):
+            with self.subTest(base=hex(base)):
+                self.assertEqual(
+                    self.read_vm(self.USER_PGD, base + 0x8, 16),
+                    self.phys(0x10008, 16),
+                )
+                self.assertEqual(
+                    self.read_vm(self.USER_PGD, base + 0x2FF8, 8),
+                    self.phys(0x11FF8, 8),
+                )
+                # Spans pages within a contiguous range.
+                self.assertEqual(
+                    self.read_vm(self.USER_PGD, base + 0x15800, 0x2000),
+                    self.phys(0x25800, 0x2000),
+                )
+                self.assertEqual(
+                    self.read_vm(self.USER_PGD, base + 0x10000, 0x10000),
+                    self.phys(0x20000, 0x10000),
+                )
+                # Runs into an unmapped page.
+                self.assertRaises(
+                    FaultError, self.read_vm, self.USER_PGD, base + 0xFF8, 16
+                )
+
+    def test_kernel_uses_swapper_pg_dir(self):
+        # Kernel addresses are translated through swapper_pg_dir even when
+        # another page table is given. Address 0 isn't in the core dump, so
+        # user addresses can't be translated with it.
+        self.assertEqual(
+            self.read_vm(0, self.KERNEL_BASE + 0x2000, 8), self.phys(0x11000, 8)
+        )
+        self.assertRaises(FaultError, self.read_vm, 0, 0x2000, 8)
+        # The user half of swapper_pg_dir is not mapped.
+        self.assertRaises(FaultError, self.read_vm, self.SWAPPER_PG_DIR, 0x2000, 8)
+
+    def test_hole(self):
+        # Addresses between the TTBR0 and TTBR1 ranges are never mapped.
+        for address in (1 << 48, 0x8000000000000000, 0xFFFEFFFFFFFFFFF8):
+            with self.subTest(address=hex(address)):
+                self.assertRaises(FaultError, self.read_vm, self.USER_PGD, address, 8)
+
+    def test_read_missing_from_core_dump(self):
+        # Kernel memory that isn't in the core dump is read through the page
+        # table.
+        self.assertEqual(
+            self.prog.read(self.KERNEL_BASE + 0x2010, 16), self.phys(0x11010, 16)
+        )
+        self.assertRaises(FaultError, self.prog.read, self.KERNEL_BASE + 0x1000, 8)
+
+    def test_pgtable_mappings(self):
+        mappings = array.array("Q")
+        mappings.frombytes(_linux_helper_pgtable_mappings(self.prog, self.USER_PGD))
+        it = iter(mappings)
+        self.assertEqual(
+            list(zip(it, it, it, it)),
+            [
+                (base + virt_addr, phys_addr, size, flags)
+                for base in (0, self.KERNEL_BASE)
+                for virt_addr, phys_addr, size, flags in self.MAPPINGS
+            ],
+        )
+
+    def test_pgtable_mappings_start_in_contiguous_range(self):
+        mappings = array.array("Q")
+        mappings.frombytes(
+            _linux_helper_pgtable_mappings(
+                self.prog, self.USER_PGD, 0x2800000, 0x3000000
+            )
+        )
+        self.assertEqual(
+            list(mappings), [0x2800000, 0x2800000, 0x800000, self.CONT | self.VALID]
+        )
+
+
+class TestThreads(MockProgramTestCase):
+    def test_concurrent_lookups(self):
+        data = bytes(range(256)) * 16
+        add_mock_memory_segments(self.prog, [MockMemorySegment(data, 0xFFFF0000)])
+        self.types.append(self.point_type)
+        self.objects.append(MockObject("p", self.point_type, address=0xFFFF0010))
+
+        def work(i):
+            for _ in range(100):
+                address = 0xFFFF0000 + (i * 8) % len(data)
+                self.assertEqual(
+                    self.prog.read(address, 8),
+                    data[address - 0xFFFF0000 :][:8],
+                )
+                self.assertIdentical(self.prog.type("struct point"), self.point_type)
+                self.assertEqual(self.prog["p"].y.value_(), 0x17161514)
+
+        with concurrent.futures.ThreadPoolExecutor(max_workers=4) as executor:
+            for future in [executor.submit(work, i) for i in range(8)]:
+                future.result()
@@ -1,7 +1,7 @@
 # Copyright (c) Meta Platforms, Inc. and affiliates.
 # SPDX-License-Identifier: GPL-3.0-or-later
 from tests import TestCase
-from tests.libdrgn import deserialize_bits, serialize_bits
+from tests.libdrgn import deserialize_bits, deserialize_bits_fn, serialize_bits
 
 VALUE = 12345678912345678989
 
@@ -46,6 +46,17 @@ class TestSerialize(TestCase):
                         )
                         self.assertEqual(value, expected)
 
+    def test_deserialize_fn(self):
+        for bit_size in range(1, 65):
+            expected = VALUE & ((1 << bit_size) - 1)
+            for little_endian in [True, False]:
+                buf = py_serialize_bits(expected, 0, bit_size, little_endian)[0]
+                value = deserialize_bits_fn(buf, bit_size, little_endian)
+                if bit_size in (8, 16, 32, 64):
+                    self.assertEqual(value, expected)
+                else:
+                    self.assertIsNone(value)
+
     def test_serialize(self):
         for bit_size in range(1, 65):
             value = VALUE & ((1 << bit_size) - 1)
@@ -0,0 +1,706 @@
+# Copyright (c) Meta Platforms, Inc. and affiliates.
+# SPDX-License-Identifier: GPL-3.0-or-later
+import struct
+import tempfile
+
+from drgn import Architecture, Object, Platform, PlatformFlags, Program
+from tests import MockMemorySegment, TestCase, add_mock_memory_segments
+from tests.assembler import _append_sleb128, _append_uleb128
+from tests.dwarf import DW_AT, DW_ATE, DW_FORM, DW_OP, DW_TAG
+from tests.dwarfwriter import DwarfAttrib, DwarfDie, dwarf_sections
+from tests.elf import ET, PT, SHT
+from tests.elfwriter import ElfSection, create_elf_file
+
+SHF_ALLOC = 0x2
+
+DW_CFA_def_cfa = 0xC
+DW_CFA_offset = 0x80
+
+DW_EH_PE_udata4 = 0x3
+DW_EH_PE_sdata4 = 0xB
+DW_EH_PE_pcrel = 0x10
+DW_EH_PE_datarel = 0x30
+
+# ORC entry flags for a call frame with the CFA at rsp + sp_offset.
+ORC_CALL = 0x5
+# ORC entry flags for an address without unwind information, which is also
+# used as a terminator.
+ORC_UNDEFINED = 0x0
+
+TEXT_ADDRESS = 0x400000
+EH_FRAME_ADDRESS = 0x401000
+EH_FRAME_HDR_ADDRESS = 0x402000
+ORC_UNWIND_IP_ADDRESS = 0x403000
+ORC_UNWIND_ADDRESS = 0x404000
+STACK_ADDRESS = 0x7FF000
+
+# (initial location, size) of each function with an FDE.
+FUNCTIONS = ((0x400010, 0x10), (0x400040, 0x20), (0x400070, 0x10))
+
+# Offsets of registers in struct pt_regs on x86-64.
+PT_REGS_RBX = 5 * 8
+PT_REGS_RIP = 16 * 8
+PT_REGS_RSP = 19 * 8
+PT_REGS_SIZE = 21 * 8
+
+
+def _cfi_entry(contents):
+    # Pad with DW_CFA_nop to a multiple of the address size.
+    contents = contents + bytes(-(len(contents) + 4) % 8)
+    return struct.pack("<I", len(contents)) + contents
+
+
+def create_eh_frame(functions):
+    """
+    Return the contents of an .eh_frame section with one CIE and an FDE for
+    each function, and the offset of each FDE in the section.
+    """
+    cie = bytearray(struct.pack("<I", 0))  # CIE ID
+    cie.append(1)  # Version
+    cie.extend(b"zR\0")  # Augmentation
+    _append_uleb128(cie, 1)  # Code alignment factor
+    _append_sleb128(cie, -8)  # Data alignment factor
+    _append_uleb128(cie, 16)  # Return address register (rip)
+    _append_uleb128(cie, 1)  # Augmentation length
+    cie.append(DW_EH_PE_pcrel | DW_EH_PE_sdata4)  # FDE pointer encoding
+    # The CFA is rsp + 8, and the return address is saved at CFA - 8.
+    cie.extend((DW_CFA_def_cfa, 7, 8, DW_CFA_offset | 16, 1))
+    buf = bytearray(_cfi_entry(cie))
+
+    offsets = []
+    for initial_location, size in functions:
+        offset = len(buf)
+        offsets.append(offset)
+        fde = bytearray(struct.pack("<I", offset + 4))  # CIE pointer
+        fde.extend(
+            struct.pack(
+                "<iI", initial_location - (EH_FRAME_ADDRESS + offset + 8), size
+            )
+        )
+        _append_uleb128(fde, 0)  # Augmentation length
+        buf.extend(_cfi_entry(fde))
+    buf.extend(bytes(4))  # Terminator
+    return buf, offsets
+
+
+def create_eh_frame_hdr(table, fde_count=None):
+    """
+    Return the contents of an .eh_frame_hdr section with a binary search table
+    of (initial location, FDE address) pairs.
+    """
+    buf = bytearray(
+        (
+            1,  # Version
+            DW_EH_PE_pcrel | DW_EH_PE_sdata4,  # eh_frame_ptr encoding
+            DW_EH_PE_udata4,  # fde_count encoding
+            DW_EH_PE_datarel | DW_EH_PE_sdata4,  # Table encoding
+        )
+    )
+    buf.extend(
+        struct.pack(
+            "<iI",
+            EH_FRAME_ADDRESS - (EH_FRAME_HDR_ADDRESS + 4),
+            len(table) if fde_count is None else fde_count,
+        )
+    )
+    for initial_location, fde_address in table:
+        buf.extend(
+            struct.pack(
+                "<ii",
+                initial_location - EH_FRAME_HDR_ADDRESS,
+                fde_address - EH_FRAME_HDR_ADDRESS,
+            )
+        )
+    return buf
+
+
+def create_orc(entries):
+    """
+    Return the contents of .orc_unwind_ip and .orc_unwind sections for
+    (initial location, flags, sp_offset) entries, in the given order.
+    """
+    orc_unwind_ip = bytearray()
+    orc_unwind = bytearray()
+    for i, (initial_location, flags, sp_offset) in enumerate(entries):
+        orc_unwind_ip.extend(
+            struct.pack("<i", initial_location - (ORC_UNWIND_IP_ADDRESS + 4 * i))
+        )
+        orc_unwind.extend(struct.pack("<hhH", sp_offset, 0, flags))
+    return orc_unwind_ip, orc_unwind
+
+
+def default_orc_entries():
+    entries = []
+    for initial_location, size in FUNCTIONS:
+        entries.append((initial_location, ORC_CALL, 8))
+        entries.append((initial_location + size, ORC_UNDEFINED, 0))
+    return entries
+
+
+def default_eh_frame_hdr_table(fde_offsets):
+    return [
+        (initial_location, EH_FRAME_ADDRESS + offset)
+        for (initial_location, _), offset in zip(FUNCTIONS, fde_offsets)
+    ]
+
+
+def cfi_program(eh_frame=None, eh_frame_hdr=None, orc=None, dies=(), debug_loc=None):
+    # We need some DWARF data so that libdwfl will load the file.
+    sections = dwarf_sections(dies)
+    if debug_loc is not None:
+        sections.append(
+            ElfSection(name=".debug_loc", sh_type=SHT.PROGBITS, data=debug_loc)
+        )
+    sections.append(
+        ElfSection(
+            name=".text",
+            sh_type=SHT.NOBITS,
+            p_type=PT.LOAD,
+            vaddr=TEXT_ADDRESS,
+            memsz=0x1000,
+        )
+    )
+    if eh_frame is not None:
+        sections.append(
+            ElfSection(
+                data=eh_frame,
+                name=".eh_frame",
+                sh_type=SHT.PROGBITS,
+                sh_flags=SHF_ALLOC,
+                vaddr=EH_FRAME_ADDRESS,
+                sh_addralign=8,
+            )
+        )
+    if eh_frame_hdr is not None:
+        sections.append(
+            ElfSection(
+                data=eh_frame_hdr,
+                name=".eh_frame_hdr",
+                sh_type=SHT.PROGBITS,
+                sh_flags=SHF_ALLOC,
+                vaddr=EH_FRAME_HDR_ADDRESS,
+                sh_addralign=4,
+            )
+        )
+    if orc is not None:
+        orc_unwind_ip, orc_unwind = orc
+        sections.append(
+            ElfSection(
+                data=orc_unwind_ip,
+                name=".orc_unwind_ip",
+                sh_type=SHT.PROGBITS,
+                sh_flags=SHF_ALLOC,
+                vaddr=ORC_UNWIND_IP_ADDRESS,
+                sh_addralign=4,
+            )
+        )
+        sections.append(
+            ElfSection(
+                data=orc_unwind,
+                name=".orc_unwind",
+                sh_type=SHT.PROGBITS,
+                sh_flags=SHF_ALLOC,
+                vaddr=ORC_UNWIND_ADDRESS,
+                sh_addralign=2,
+            )
+        )
+    prog = Program(
+        Platform(
+            Architecture.X86_64,
+            PlatformFlags.IS_64_BIT | PlatformFlags.IS_LITTLE_ENDIAN,
+        )
+    )
+    with tempfile.NamedTemporaryFile() as f:
+        f.write(create_elf_file(ET.EXEC, sections))
+        f.flush()
+        prog.load_debug_info([f.name])
+    # The second function called the first one, which was called by an
+    # address without CFI. rbp is zero, so the frame pointer fallback stops
+    # there.
+    add_mock_memory_segments(
+        prog,
+        [MockMemorySegment(struct.pack("<QQ", 0x400048, 0x400090), STACK_ADDRESS)],
+    )
+    return prog
+
+
+def stack_trace(prog, pc, rbx=0):
+    regs = bytearray(PT_REGS_SIZE)
+    struct.pack_into("<Q", regs, PT_REGS_RBX, rbx)
+    struct.pack_into("<Q", regs, PT_REGS_RIP, pc)
+    struct.pack_into("<Q", regs, PT_REGS_RSP, STACK_ADDRESS)
+    return prog.stack_trace(
+        Object.from_bytes_(
+            prog, prog.struct_type("pt_regs", PT_REGS_SIZE, ()), bytes(regs)
+        )
+    )
+
+
+def stack_trace_pcs(prog, pc):
+    return [frame.pc for frame in stack_trace(prog, pc)]
+
+
+class TestEhFrameHdr(TestCase):
+    def test_no_eh_frame_hdr(self):
+        eh_frame, _ = create_eh_frame(FUNCTIONS)
+        prog = cfi_program(eh_frame)
+        self.assertEqual(
+            stack_trace_pcs(prog, 0x400018), [0x400018, 0x400048, 0x400090]
+        )
+
+    def test_found(self):
+        eh_frame, offsets = create_eh_frame(FUNCTIONS)
+        prog = cfi_program(
+            eh_frame, create_eh_frame_hdr(default_eh_frame_hdr_table(offsets))
+        )
+        self.assertEqual(
+            stack_trace_pcs(prog, 0x400018), [0x400018, 0x400048, 0x400090]
+        )
+        # The last function and its last instruction.
+        self.assertEqual(stack_trace_pcs(prog, 0x40007F)[:2], [0x40007F, 0x400048])
+
+    def test_not_found(self):
+        eh_frame, offsets = create_eh_frame(FUNCTIONS)
+        prog = cfi_program(
+            eh_frame, create_eh_frame_hdr(default_eh_frame_hdr_table(offsets))
+        )
+        for pc, desc in (
+            (0x400008, "before first FDE"),
+            (0x400030, "between FDEs"),
+            (0x400080, "after last FDE"),
+        ):
+            with self.subTest(desc):
+                # Without CFI, this falls back to the frame pointer, which is
+                # zero.
+                self.assertEqual(stack_trace_pcs(prog, pc), [pc])
+
+    def test_empty_table(self):
+        eh_frame, _ = create_eh_frame(FUNCTIONS)
+        prog = cfi_program(eh_frame, create_eh_frame_hdr(()))
+        self.assertEqual(stack_trace_pcs(prog, 0x400018), [0x400018])
+
+    def test_truncated_table(self):
+        # If fde_count is larger than the table, the table is ignored and
+        # .eh_frame is parsed fully.
+        eh_frame, offsets = create_eh_frame(FUNCTIONS)
+        prog = cfi_program(
+            eh_frame,
+            create_eh_frame_hdr(
+                default_eh_frame_hdr_table(offsets), fde_count=len(FUNCTIONS) + 1
+            ),
+        )
+        self.assertEqual(
+            stack_trace_pcs(prog, 0x400018), [0x400018, 0x400048, 0x400090]
+        )
+
+    def test_truncated_header(self):
+        eh_frame, _ = create_eh_frame(FUNCTIONS)
+        prog = cfi_program(eh_frame, create_eh_frame_hdr(())[:6])
+        self.assertEqual(
+            stack_trace_pcs(prog, 0x400018), [0x400018, 0x400048, 0x400090]
+        )
+
+    def test_unsupported_table_encoding(self):
+        eh_frame, offsets = create_eh_frame(FUNCTIONS)
+        eh_frame_hdr = create_eh_frame_hdr(default_eh_frame_hdr_table(offsets))
+        eh_frame_hdr[3] = DW_EH_PE_pcrel | DW_EH_PE_sdata4
+        prog = cfi_program(eh_frame, eh_frame_hdr)
+        self.assertEqual(
+            stack_trace_pcs(prog, 0x400018), [0x400018, 0x400048, 0x400090]
+        )
+
+    def test_fde_address_out_of_bounds(self):
+        eh_frame, offsets = create_eh_frame(FUNCTIONS)
+        table = default_eh_frame_hdr_table(offsets)
+        table[0] = (table[0][0], EH_FRAME_ADDRESS + len(eh_frame))
+        prog = cfi_program(eh_frame, create_eh_frame_hdr(table))
+        self.assertRaisesRegex(
+            Exception, "FDE address is out of bounds", stack_trace_pcs, prog, 0x400018
+        )
+
+    def test_entry_not_fde(self):
+        eh_frame, offsets = create_eh_frame(FUNCTIONS)
+        table = default_eh_frame_hdr_table(offsets)
+        # Point at the CIE instead.
+        table[0] = (table[0][0], EH_FRAME_ADDRESS)
+        prog = cfi_program(eh_frame, create_eh_frame_hdr(table))
+        self.assertRaisesRegex(
+            Exception, "entry is not an FDE", stack_trace_pcs, prog, 0x400018
+        )
+
+
+class TestOrc(TestCase):
+    def test_sorted(self):
+        prog = cfi_program(orc=create_orc(default_orc_entries()))
+        self.assertEqual(
+            stack_trace_pcs(prog, 0x400018), [0x400018, 0x400048, 0x400090]
+        )
+
+    def test_unsorted(self):
+        prog = cfi_program(orc=create_orc(default_orc_entries()[::-1]))
+        self.assertEqual(
+            stack_trace_pcs(prog, 0x400018), [0x400018, 0x400048, 0x400090]
+        )
+
+    def test_not_found(self):
+        for desc, entries in (
+            ("sorted", default_orc_entries()),
+            ("unsorted", default_orc_entries()[::-1]),
+        ):
+            prog = cfi_program(orc=create_orc(entries))
+            for pc in (0x400008, 0x400030, 0x400080):
+                with self.subTest(desc, pc=hex(pc)):
+                    self.assertEqual(stack_trace_pcs(prog, pc), [pc])
+
+    def test_duplicate_pc(self):
+        # When a real entry and a terminator have the same PC, the real entry
+        # is used whether or not it is already sorted after the terminator.
+        terminators_first = []
+        for initial_location, flags, sp_offset in default_orc_entries():
+            if flags != ORC_UNDEFINED:
+                terminators_first.append((initial_location, ORC_UNDEFINED, 0))
+            terminators_first.append((initial_location, flags, sp_offset))
+        terminators_last = []
+        for i in range(0, len(terminators_first), 3):
+            terminators_last.append(terminators_first[i + 1])
+            terminators_last.append(terminators_first[i])
+            terminators_last.append(terminators_first[i + 2])
+        for desc, entries in (
+            ("sorted", terminators_first),
+            ("unsorted", terminators_last),
+        ):
+            with self.subTest(desc):
+                prog = cfi_program(orc=create_orc(entries))
+                self.assertEqual(
+                    stack_trace_pcs(prog, 0x400018), [0x400018, 0x400048, 0x400090]
+                )
+
+    def test_with_dwarf_cfi(self):
+        # Only the first function has DWARF CFI. The ORC entries for the other
+        # functions must still be found, whether or not the ORC entries covered
+        # by DWARF CFI are removed.
+        eh_frame, _ = create_eh_frame(FUNCTIONS[:1])
+        for desc, entries in (
+            ("sorted", default_orc_entries()),
+            ("unsorted", default_orc_entries()[::-1]),
+        ):
+            with self.subTest(desc):
+                prog = cfi_program(eh_frame=eh_frame, orc=create_orc(entries))
+                self.assertEqual(
+                    stack_trace_pcs(prog, 0x400018), [0x400018, 0x400048, 0x400090]
+                )
+
+    def test_invalid_size(self):
+        orc_unwind_ip, orc_unwind = create_orc(default_orc_entries())
+        prog = cfi_program(orc=(orc_unwind_ip, orc_unwind[:-6]))
+        self.assertRaisesRegex(
+            Exception, "invalid size", stack_trace_pcs, prog, 0x400018
+        )
+
+
+def pc_range_attribs(start, size):
+    return (
+        DwarfAttrib(DW_AT.low_pc, DW_FORM.addr, start),
+        DwarfAttrib(DW_AT.high_pc, DW_FORM.data4, size),
+    )
+
+
+def constant_die(name, value):
+    return DwarfDie(
+        DW_TAG.variable,
+        (
+            DwarfAttrib(DW_AT.name, DW_FORM.string, name),
+            DwarfAttrib(DW_AT.type, DW_FORM.ref4, 0),
+            DwarfAttrib(DW_AT.const_value, DW_FORM.data1, value),
+        ),
+    )
+
+
+class TestScopes(TestCase):
+    # A compilation unit containing:
+    # - outer() at [0x400100, 0x400200) with:
+    #   - A block at [0x400120, 0x400140) declaring x.
+    #   - inlined() inlined at [0x400180, 0x4001c0) with a block at
+    #     [0x4001a0, 0x4001b0) declaring y.
+    # - other() at [0x400300, 0x400310).
+    DIES = (
+        DwarfDie(
+            DW_TAG.compile_unit,
+            pc_range_attribs(TEXT_ADDRESS, 0x1000),
+            (
+                DwarfDie(
+                    DW_TAG.base_type,
+                    (
+                        DwarfAttrib(DW_AT.byte_size, DW_FORM.data1, 4),
+                        DwarfAttrib(DW_AT.encoding, DW_FORM.data1, DW_ATE.signed),
+                        DwarfAttrib(DW_AT.name, DW_FORM.string, "int"),
+                    ),
+                ),
+                DwarfDie(
+                    DW_TAG.subprogram,
+                    (
+                        DwarfAttrib(DW_AT.name, DW_FORM.string, "inlined"),
+                        DwarfAttrib(DW_AT.inline, DW_FORM.data1, 1),
+                    ),
+                ),
+                DwarfDie(
+                    DW_TAG.subprogram,
+                    (
+                        DwarfAttrib(DW_AT.name, DW_FORM.string, "outer"),
+                        *pc_range_attribs(0x400100, 0x100),
+                    ),
+                    (
+                        DwarfDie(
+                            DW_TAG.lexical_block,
+                            pc_range_attribs(0x400120, 0x20),
+                            (constant_die("x", 1),),
+                        ),
+                        DwarfDie(
+                            DW_TAG.inlined_subroutine,
+                            (
+                                DwarfAttrib(DW_AT.abstract_origin, DW_FORM.ref4, 1),
+                                *pc_range_attribs(0x400180, 0x40),
+                            ),
+                            (
+                                DwarfDie(
+                                    DW_TAG.lexical_block,
+                                    pc_range_attribs(0x4001A0, 0x10),
+                                    (constant_die("y", 2),),
+                                ),
+                            ),
+                        ),
+                    ),
+                ),
+                DwarfDie(
+                    DW_TAG.subprogram,
+                    (
+                        DwarfAttrib(DW_AT.name, DW_FORM.string, "other"),
+                        *pc_range_attribs(0x400300, 0x10),
+                    ),
+                ),
+            ),
+        ),
+    )
+
+    def setUp(self):
+        super().setUp()
+        self.prog = cfi_program(dies=self.DIES)
+
+    def frames(self, pc):
+        return [(frame.name, frame.is_inline) for frame in stack_trace(self.prog, pc)]
+
+    def test_function(self):
+        for pc in (0x400100, 0x400110, 0x400140, 0x400170, 0x4001C0, 0x4001FF):
+            with self.subTest(pc=hex(pc)):
+                self.assertEqual(self.frames(pc), [("outer", False)])
+        self.assertEqual(self.frames(0x400308), [("other", False)])
+
+    def test_inlined(self):
+        for pc in (0x400180, 0x400198, 0x4001A8, 0x4001BF):
+            with self.subTest(pc=hex(pc)):
+                self.assertEqual(self.frames(pc), [("inlined", True), ("outer", False)])
+
+    def test_no_function(self):
+        for pc in (0x400000, 0x4000FF, 0x400200, 0x400310, 0x400FFF):
+            with self.subTest(pc=hex(pc)):
+                self.assertEqual(self.frames(pc), [(None, False)])
+
+    def test_block_variables(self):
+        int_type = self.prog.int_type("int", 4, True)
+        trace = stack_trace(self.prog, 0x400130)
+        self.assertIdentical(trace[0]["x"], Object(self.prog, int_type, 1))
+        self.assertRaises(KeyError, trace[0].__getitem__, "y")
+
+        trace = stack_trace(self.prog, 0x4001A8)
+        self.assertIdentical(trace[0]["y"], Object(self.prog, int_type, 2))
+        self.assertRaises(KeyError, trace[1].__getitem__, "x")
+
+        # Just past the end of each block.
+        for pc, name in ((0x400140, "x"), (0x4001B0, "y")):
+            with self.subTest(pc=hex(pc)):
+                trace = stack_trace(self.prog, pc)
+                self.assertRaises(KeyError, trace[0].__getitem__, name)
+
+    def test_repeated_lookups(self):
+        # Later lookups in the unit use the index built by the first one.
+        for _ in range(3):
+            for pc, frames in (
+                (0x400308, [("other", False)]),
+                (0x400190, [("inlined", True), ("outer", False)]),
+                (0x400110, [("outer", False)]),
+            ):
+                self.assertEqual(self.frames(pc), frames)
+
+
+def sleb128(value):
+    buf = bytearray()
+    _append_sleb128(buf, value)
+    return bytes(buf)
+
+
+def uleb128(value):
+    buf = bytearray()
+    _append_uleb128(buf, value)
+    return bytes(buf)
+
+
+def location_die(name, form, value):
+    return DwarfDie(
+        DW_TAG.variable,
+        (
+            DwarfAttrib(DW_AT.name, DW_FORM.string, name),
+            DwarfAttrib(DW_AT.type, DW_FORM.ref4, 0),
+            DwarfAttrib(DW_AT.location, form, value),
+        ),
+    )
+
+
+class TestLocations(TestCase):
+    RBX = 0x12345678
+
+    def location_program(self, variables, debug_loc=None):
+        # The second function in FUNCTIONS, whose frame base is the CFA
+        # (rsp + 8 per the CIE).
+        function_address, function_size = FUNCTIONS[1]
+        eh_frame, _ = create_eh_frame(FUNCTIONS)
+        return cfi_program(
+            eh_frame,
+            dies=(
+                DwarfDie(
+                    DW_TAG.compile_unit,
+                    pc_range_attribs(TEXT_ADDRESS, 0x1000),
+                    (
+                        DwarfDie(
+                            DW_TAG.base_type,
+                            (
+                                DwarfAttrib(DW_AT.byte_size, DW_FORM.data1, 4),
+                                DwarfAttrib(
+                                    DW_AT.encoding, DW_FORM.data1, DW_ATE.signed
+                                ),
+                                DwarfAttrib(DW_AT.name, DW_FORM.string, "int"),
+                            ),
+                        ),
+                        DwarfDie(
+                            DW_TAG.subprogram,
+                            (
+                                DwarfAttrib(DW_AT.name, DW_FORM.string, "f"),
+                                *pc_range_attribs(function_address, function_size),
+                                DwarfAttrib(
+                                    DW_AT.frame_base,
+                                    DW_FORM.exprloc,
+                                    bytes((DW_OP.call_frame_cfa,)),
+                                ),
+                            ),
+                            variables,
+                        ),
+                    ),
+                ),
+            ),
+            debug_loc=debug_loc,
+        )
+
+    def variable(self, prog, name, pc=0x400044):
+        return stack_trace(prog, pc, rbx=self.RBX)[0][name]
+
+    def assertValue(self, obj, value):
+        self.assertIdentical(obj, Object(obj.prog_, obj.type_, value))
+
+    def assertReference(self, obj, address, value):
+        self.assertIdentical(obj, Object(obj.prog_, obj.type_, address=address))
+        self.assertEqual(obj.value_(), value)
+
+    def test_register(self):
+        prog = self.location_program(
+            (
+                location_die("reg", DW_FORM.exprloc, bytes((DW_OP.reg0 + 3,))),
+                location_die(
+                    "regx", DW_FORM.exprloc, bytes((DW_OP.regx,)) + uleb128(3)
+                ),
+            )
+        )
+        self.assertValue(self.variable(prog, "reg"), self.RBX)
+        self.assertValue(self.variable(prog, "regx"), self.RBX)
+
+    def test_register_relative(self):
+        prog = self.location_program(
+            (
+                location_die(
+                    "breg", DW_FORM.exprloc, bytes((DW_OP.breg0 + 7,)) + sleb128(8)
+                ),
+                location_die(
+                    "bregx",
+                    DW_FORM.exprloc,
+                    bytes((DW_OP.bregx,)) + uleb128(7) + sleb128(8),
+                ),
+            )
+        )
+        self.assertReference(self.variable(prog, "breg"), STACK_ADDRESS + 8, 0x400090)
+        self.assertReference(self.variable(prog, "bregx"), STACK_ADDRESS + 8, 0x400090)
+
+    def test_frame_base_relative(self):
+        prog = self.location_program(
+            (
+                location_die(
+                    "fbreg", DW_FORM.exprloc, bytes((DW_OP.fbreg,)) + sleb128(-8)
+                ),
+            )
+        )
+        self.assertReference(self.variable(prog, "fbreg"), STACK_ADDRESS, 0x400048)
+
+    def test_general_expression(self):
+        prog = self.location_program(
+            (
+                location_die(
+                    "addr",
+                    DW_FORM.exprloc,
+                    bytes((DW_OP.addr,)) + (STACK_ADDRESS + 8).to_bytes(8, "little"),
+                ),
+                # A simple operation followed by more operations must use the
+                # general evaluator.
+                location_die(
+                    "piece",
+                    DW_FORM.exprloc,
+                    bytes((DW_OP.reg0 + 3, DW_OP.piece)) + uleb128(4),
+                ),
+            )
+        )
+        self.assertReference(self.variable(prog, "addr"), STACK_ADDRESS + 8, 0x400090)
+        self.assertValue(self.variable(prog, "piece"), self.RBX)
+
+    def test_location_list(self):
+        function_address, _ = FUNCTIONS[1]
+
+        def entry(start, end, expr):
+            # Offsets are relative to the compilation unit's base address.
+            return (
+                struct.pack(
+                    "<QQH",
+                    function_address + start - TEXT_ADDRESS,
+                    function_address + end - TEXT_ADDRESS,
+                    len(expr),
+                )
+                + expr
+            )
+
+        # The first list is padding so that the second one has a nonzero
+        # offset.
+        first = entry(0x0, 0x20, bytes((DW_OP.reg0,))) + bytes(16)
+        second = (
+            entry(0x0, 0x8, bytes((DW_OP.reg0 + 3,)))
+            + entry(0x10, 0x18, bytes((DW_OP.breg0 + 7,)) + sleb128(8))
+            + bytes(16)
+        )
+        prog = self.location_program(
+            (location_die("x", DW_FORM.sec_offset, len(first)),),
+            debug_loc=first + second,
+        )
+        # Look up each PC more than once to use the cached list.
+        for _ in range(2):
+            with self.subTest("register"):
+                self.assertValue(self.variable(prog, "x", 0x400044), self.RBX)
+            with self.subTest("memory"):
+                self.assertReference(
+                    self.variable(prog, "x", 0x400054), STACK_ADDRESS + 8, 0x400090
+                )
+            with self.subTest("absent"):
+                self.assertTrue(self.variable(prog, "x", 0x40004C).absent_)
@@ -101,6 +101,65 @@ class TestElfSymbol(TestCase):
                 self.assert_symbols_equal_unordered(prog.symbols(0xFFFF000C), [second])
                 self.assertRaises(LookupError, prog.symbol, 0xFFFF0010)
 
+    def test_by_address_overlapping(self):
+        elf_outer = ElfSymbol("outer", 0xFFFF0000, 0x20, STT.FUNC, STB.GLOBAL)
+        elf_before = ElfSymbol("before", 0xFFFF0004, 0x4, STT.OBJECT, STB.LOCAL)
+        elf_inner = ElfSymbol("inner", 0xFFFF0010, 0x8, STT.OBJECT, STB.LOCAL)
+        outer = Symbol("outer", 0xFFFF0000, 0x20, SymbolBinding.GLOBAL, SymbolKind.FUNC)
+        before = Symbol(
+            "before", 0xFFFF0004, 0x4, SymbolBinding.LOCAL, SymbolKind.OBJECT
+        )
+        inner = Symbol("inner", 0xFFFF0010, 0x8, SymbolBinding.LOCAL, SymbolKind.OBJECT)
+
+        prog = elf_symbol_program((elf_before, elf_inner, elf_outer))
+        self.assert_symbols_equal_unordered(prog.symbols(0xFFFF0000), [outer])
+        self.assert_symbols_equal_unordered(prog.symbols(0xFFFF0004), [outer, before])
+        self.assert_symbols_equal_unordered(prog.symbols(0xFFFF000C), [outer])
+        self.assert_symbols_equal_unordered(prog.symbols(0xFFFF0014), [outer, inner])
+        self.assert_symbols_equal_unordered(prog.symbols(0xFFFF001C), [outer])
+        self.assertEqual(prog.symbols(0xFFFF0020), [])
+
+    def test_load_after_search(self):
+        first = Symbol("first", 0xFFFF0000, 0x8, SymbolBinding.LOCAL, SymbolKind.OBJECT)
+        second = Symbol(
+            "second", 0xFFFF0008, 0x8, SymbolBinding.LOCAL, SymbolKind.OBJECT
+        )
+        prog = elf_symbol_program(
+            (ElfSymbol("first", 0xFFFF0000, 0x8, STT.OBJECT, STB.LOCAL),)
+        )
+        self.assertEqual(prog.symbols("second"), [])
+        self.assertRaises(LookupError, prog.symbol, "second")
+
+        # Loading another module must invalidate the symbol index.
+        with tempfile.NamedTemporaryFile() as f:
+            f.write(
+                create_elf_symbol_file(
+                    [ElfSymbol("second", 0xFFFF0008, 0x8, STT.OBJECT, STB.LOCAL)]
+                )
+            )
+            f.flush()
+            prog.load_debug_info([f.name])
+        self.assert_symbol_equal(prog.symbol("second"), second)
+        self.assert_symbols_equal_unordered(prog.symbols("second"), [second])
+        self.assert_symbols_equal_unordered(prog.symbols(0xFFFF000C), [second])
+        self.assert_symbols_equal_unordered(prog.symbols("first"), [first])
+
+    def test_symbolize(self):
+        prog = elf_symbol_program(
+            (ElfSymbol("first", 0xFFFF0000, 0x8, STT.OBJECT, STB.LOCAL),),
+            (ElfSymbol("second", 0xFFFF0008, 0x8, STT.OBJECT, STB.LOCAL),),
+        )
+        self.assertEqual(
+            prog.symbolize([0xFFFF000C, 0xFFFEFFFF, 0xFFFF0004, 0xFFFF000C]),
+            [
+                ("second", 4, None, 0, 0),
+                (None, 0, None, 0, 0),
+                ("first", 4, None, 0, 0),
+                ("second", 4, None, 0, 0),
+            ],
+        )
+        self.assertEqual(prog.symbolize([]), [])
+
     def test_by_address_precedence(self):
         precedence = (STB.GLOBAL, STB.WEAK, STB.LOCAL)
         drgn_precedence = (
@@ -7,7 +7,7 @@ import subprocess
 import tempfile
 import unittest
 
-from drgn import Program
+from drgn import MissingDebugInfoError, Program
 from tests import TestCase
 
 
@@ -36,6 +36,36 @@ class TestLive(TestCase):
             self.prog.crashed_thread,
         )
 
+    def test_stack_trace(self):
+        proc = subprocess.Popen(["sleep", "60"])
+        try:
+            # Wait until the child is sleeping in the sleep program.
+            while True:
+                with open(f"/proc/{proc.pid}/stat", "r") as f:
+                    state = f.read().rpartition(")")[2].split()[0]
+                if state == "S" and os.readlink(f"/proc/{proc.pid}/exe").endswith(
+                    "sleep"
+                ):
+                    break
+            prog = Program()
+            prog.set_pid(proc.pid)
+            try:
+                prog.load_default_debug_info()
+            except MissingDebugInfoError:
+                pass
+            try:
+                trace = prog.stack_trace(proc.pid)
+            except PermissionError:
+                self.skipTest("not permitted to ptrace child")
+            self.assertGreater(len(trace), 0)
+            self.assertIsNotNone(trace[0].pc)
+            # The child is resumed after unwinding.
+            with open(f"/proc/{proc.pid}/status", "r") as f:
+                self.assertIn("TracerPid:\t0\n", f.read())
+        finally:
+            proc.kill()
+            proc.wait()
+
 
 class TestCoreDump(TestCase):
     TIDS = (
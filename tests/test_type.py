@@ -568,6 +568,38 @@ class TestType(MockProgramTestCase):
 
         self.assertRaises(TypeError, self.prog.int_type("int", 4, True).member, "foo")
 
+    def test_member_name_not_in_program(self):
+        # No type in the program has a member with this name, so the lookup
+        # must still produce the right errors without finding the name.
+        t = self.prog.struct_type(
+            "point", 4, (TypeMember(self.prog.int_type("int", 4, True), "x", 0),)
+        )
+        self.assertRaisesRegex(
+            LookupError,
+            "'struct point' has no member 'nonexistent'",
+            t.member,
+            "nonexistent",
+        )
+        self.assertFalse(t.has_member("nonexistent"))
+        self.assertRaises(
+            TypeError, self.prog.int_type("int", 4, True).member, "nonexistent"
+        )
+
+    def test_member_names_from_different_strings(self):
+        # Equal names passed as distinct string objects are the same name.
+        name = "".join(["fo", "o"])
+        t = self.prog.struct_type(
+            None, 4, (TypeMember(self.prog.int_type("int", 4, True), name, 0),)
+        )
+        self.assertIdentical(
+            t.member("foo"), TypeMember(self.prog.int_type("int", 4, True), "foo", 0)
+        )
+        int_type = self.prog.int_type("int", 4, True)
+        self.assertIdentical(
+            self.prog.typedef_type("".join(["my", "_int"]), int_type),
+            self.prog.typedef_type("my_int", int_type),
+        )
+
     def test_offsetof(self):
         self.assertEqual(offsetof(self.line_segment_type, "b"), 8)
         self.assertEqual(offsetof(self.line_segment_type, "a.y"), 4)
@@ -4,8 +4,13 @@
 
 import argparse
 
+from drgn import Object
 from drgn.helpers import enum_type_to_class
-from drgn.helpers.linux import bpf_map_for_each, bpf_prog_for_each, hlist_for_each_entry
+from drgn.helpers.linux import (
+    bpf_map_info_for_each,
+    bpf_prog_info_for_each,
+    hlist_for_each_entry,
+)
 
 BpfMapType = enum_type_to_class(prog.type("enum bpf_map_type"), "BpfMapType")
 BpfProgType = enum_type_to_class(prog.type("enum bpf_prog_type"), "BpfProgType")
@@ -64,15 +69,8 @@ def get_linked_func(bpf_prog):
     return f"{linked_prog_id}->{linked_btf_id}: {kind.name} {linked_name}"
 
 
-def get_tramp_progs(bpf_prog):
-    try:
-        tr = bpf_prog.aux.member_("trampoline")
-    except LookupError:
-        # Trampoline is available since Linux kernel commit
-        # fec56f5890d9 ("bpf: Introduce BPF trampoline") (in v5.5).
-        # Skip trampoline if current kernel doesn't support it.
-        return
-
+def get_tramp_progs(aux):
+    tr = aux.trampoline
     if not tr:
         return
 
@@ -87,25 +85,30 @@ def get_tramp_progs(bpf_prog):
 
 
 def list_bpf_progs(args):
-    for bpf_prog in bpf_prog_for_each(prog):
-        id_ = bpf_prog.aux.id.value_()
-        type_ = BpfProgType(bpf_prog.type).name
-        name = get_prog_name(bpf_prog)
+    # Trampoline is available since Linux kernel commit fec56f5890d9 ("bpf:
+    # Introduce BPF trampoline") (in v5.5). Skip trampoline if current kernel
+    # doesn't support it.
+    aux_type = prog.type("struct bpf_prog_aux")
+    have_trampoline = aux_type.has_member("trampoline")
 
-        linked = ", ".join([get_linked_func(p) for p in get_tramp_progs(bpf_prog)])
-        if linked:
-            linked = f" linked:[{linked}]"
+    for info in bpf_prog_info_for_each(prog):
+        type_ = BpfProgType(info.type).name
+        name = (info.btf_name or info.name).decode()
 
-        print(f"{id_:>6}: {type_:32} {name:32} {linked}")
+        linked = ""
+        if have_trampoline:
+            aux = Object(prog, aux_type, address=info.aux)
+            linked = ", ".join([get_linked_func(p) for p in get_tramp_progs(aux)])
+            if linked:
+                linked = f" linked:[{linked}]"
 
+        print(f"{info.id:>6}: {type_:32} {name:32} {linked}")
 
-def list_bpf_maps(args):
-    for map_ in bpf_map_for_each(prog):
-        id_ = map_.id.value_()
-        type_ = BpfMapType(map_.map_type).name
-        name = map_.name.string_().decode()
 
-        print(f"{id_:>6}: {type_:32} {name}")
+def list_bpf_maps(args):
+    for info in bpf_map_info_for_each(prog):
+        type_ = BpfMapType(info.map_type).name
+        print(f"{info.id:>6}: {type_:32} {info.name.decode()}")
 
 
 def main():